@@ -2,7 +2,7 @@
  * @file
  * @brief	DMA Control Block
  * @author	Ralf Gerhauser
- * @version	2018-10-09
+ * @version	2026-10-15
  *
  * This file contains the DMA Control Blocks for all DMA channels.  It should
  * be linked as the first module in the list, so its data address is located
@@ -11,6 +11,8 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	The callback structures are managed by DmaChan.c.
+2026-10-14,agnt	Alternate structures are used for DMA ping-pong mode now.
 2018-10-09,rage	Initial version.
 */
 
@@ -30,8 +32,10 @@ Revision History:
  * zero.  There is a total of 16 entries in the array.  The first 8 are used
  * for the primary DMA structures, the second 8 for alternate DMA structures
  * as used for DMA scatter-gather mode, where one buffer is still available,
- * while the other can be re-configured.  This application uses only the first
- * 8 entries.
+ * while the other can be re-configured.  Channels in basic mode, like LEUART
+ * Rx and Audio Tx, use only the primary structure, @ref DMA_CHAN_RFID_RX and
+ * @ref DMA_CHAN_LEUART_TX run in ping-pong mode and therefore also use their
+ * alternate structure.
  *
  * @see  DMA Channel Assignment
  *
@@ -56,9 +60,9 @@ Revision History:
  *
  * This array contains the addresses of the DMA callback functions, which are
  * executed for a dedicated DMA channel at the end of a DMA transfer.
- * The entries of this array will be set by the initialization routines of the
- * driver, which was assigned to the respective channel.  Unused entries remain
- * zero.
+ * The entries of this array are set by DmaChanConfig() for the driver, which
+ * was assigned to the respective channel, or by DmaChanAlloc() for a shared
+ * channel.  Unused entries remain zero.
  */
 DMA_CB_TypeDef g_DMA_Callback[DMA_CHAN_COUNT];
 
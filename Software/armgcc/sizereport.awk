@@ -0,0 +1,90 @@
+#
+# sizereport.awk - Report Flash and RAM usage per module
+#
+# Input is the output of "arm-none-eabi-nm -S -l --size-sort" for the linked
+# image, i.e. the sizes after link-time optimization and garbage collection.
+# Each symbol is assigned to the source file of its debug line information,
+# so a function that has been inlined is counted for the module of the caller.
+# Flash is text + rodata + data (initial values), RAM is data + bss.
+# Functions which are executed from RAM, see RAMFUNC in config.h, are counted
+# as data, and listed separately.
+#
+# Usage:  arm-none-eabi-nm -S -l --size-sort AUDIO.out | awk -f sizereport.awk
+#
+# With "-v ramfunc=1" only the functions in RAM are reported, the debug line
+# information (option -l) is not required then.
+#
+
+# Convert a hexadecimal string into a number (no strtonum() in POSIX awk)
+function hex(s,   i, n)
+{
+    s = tolower(s)
+    n = 0
+    for (i = 1;  i <= length(s);  i++)
+	n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+    return n
+}
+
+{
+    # <address> <size> <type> <name> [<TAB><file>:<line>]
+    split($0, part, "\t")
+    if (split(part[1], f, " ") < 4)
+	next				# symbol without size
+
+    size = hex(f[2])
+    type = tolower(f[3])
+
+    module = "(unknown)"
+    if (part[2] != "")
+    {
+	module = part[2]
+	gsub(/\\/, "/", module)
+	sub(/:[0-9]+$/, "", module)
+	module = substr(module, match(module, /[^\/]*$/))
+    }
+
+    if ((type == "t"  ||  type == "w")  &&  hex(f[1]) >= 536870912)
+    {
+	data[module] += size		# function in RAM (0x20000000)
+	ramfn[f[4]] = size
+	sum_ramfn += size
+    }
+    else if (type == "t"  ||  type == "w")
+	text[module] += size
+    else if (type == "r")
+	rodata[module] += size
+    else if (type == "d"  ||  type == "v")
+	data[module] += size
+    else if (type == "b")
+	bss[module] += size
+    else
+	next
+
+    seen[module] = 1
+}
+
+END {
+    if (ramfunc)
+    {
+	for (n in ramfn)
+	    printf "  %-30s %5d\n", n, ramfn[n] | "sort -k2 -n -r"
+	close("sort -k2 -n -r")
+	printf "RAM functions: %d bytes\n", sum_ramfn
+	exit
+    }
+
+    printf "%-24s %7s %7s %7s %7s %7s %7s\n", "Module", "text", "rodata",
+	   "data", "bss", "Flash", "RAM"
+    for (m in seen)
+    {
+	flash = text[m] + rodata[m] + data[m]
+	ram   = data[m] + bss[m]
+	printf "%-24s %7d %7d %7d %7d %7d %7d\n", m, text[m], rodata[m],
+	       data[m], bss[m], flash, ram | "sort -k6 -n -r"
+	sum_t += text[m];  sum_r += rodata[m];  sum_d += data[m];  sum_b += bss[m]
+    }
+    close("sort -k6 -n -r")
+    printf "%-24s %7d %7d %7d %7d %7d %7d\n", "Total", sum_t, sum_r, sum_d,
+	   sum_b, sum_t + sum_r + sum_d, sum_d + sum_b
+    printf "RAM functions (included in data): %d bytes\n", sum_ramfn
+}
@@ -0,0 +1,920 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Micro-Benchmark of the Drivers
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module is only part of the image of the Makefile target <b>bench</b>,
+ * which defines @ref BENCH.  When an SD-Card has been mounted, main.c calls
+ * BenchRun(), which measures the following routines with the DWT cycle
+ * counter, see @ref ISR_PROFILE:
+ * - MICROSD_BlockRx() and MICROSD_BlockTx() at each SPI clock from
+ *   @ref MICROSD_LO_SPI_FREQ, and @ref MICROSD_HI_SPI_FREQ up to
+ *   @ref MICROSD_MAX_SPI_FREQ.  The benchmark reads the first sector of the
+ *   file @ref BENCH_DATA_FILE, and writes the same data back.
+ * - f_write() with the sizes of @ref l_BenchWriteSize, and the final f_sync().
+ * - Log() with a constant message, and with a formatted one, and the
+ *   LogFlush() of these messages.
+ * - CfgRead() for generated configuration files of 10, 100, and 1000 IDs,
+ *   first from the text file, then from the binary image.  The ID table
+ *   only holds @ref CFG_ID_TABLE_SIZE entries, the remaining IDs are parsed,
+ *   but not stored.
+ * - A FatFs workload at @ref MICROSD_HI_SPI_FREQ and at the SPI clock of
+ *   MICROSD_SpiClkTune(), see BenchFs(): appending lines to a log file,
+ *   reading @ref CONFIG_FILE_NAME, seeking backwards through
+ *   @ref BENCH_DATA_FILE, scanning the root directory, and querying the free
+ *   space, with the cached number of free clusters and with a scan of the
+ *   FAT.
+ * - RFID_Decode() for frames of the Short Range reader, see
+ *   RFID_BenchDecode(), and for the recorded frames of @ref l_BenchRfidRec,
+ *   i.e. valid and corrupted frames of both reader types.  A wrong result
+ *   counts as failed call.
+ * - RTC_IRQHandler(), i.e. the statistics of the ISR profiler while the
+ *   system is idle for @ref BENCH_IDLE_TIME seconds.  With @ref DEFER_WORK,
+ *   the alarms and timers are processed by PendSV_Handler(), which is
+ *   recorded as separate result.
+ *
+ * Each measurement results in one line of the CSV file @ref BENCH_CSV_FILE,
+ * which is also sent to the LEUART.  The columns are the name of the test,
+ * its parameter, i.e. the SPI clock in [Hz] or the size in bytes, the bytes
+ * per call, the number of calls and failed calls, the minimum, average, and
+ * maximum number of CPU cycles, the average in [us], the cycles per byte,
+ * and the throughput in [kB/s].  The first line is a comment with the FatFs
+ * options of "ffconf.h" and the sizes of the FatFs objects.
+ *
+ * The Makefile target <b>bench-fatfs</b> builds an image BFS<i>n</i>.UPD for
+ * each FatFs configuration of a matrix, which defines @ref BENCH_FS_CFG, and
+ * reports the flash and RAM usage of each image.  Such an image writes its
+ * results to the file BFS<i>n</i>.CSV, so all configurations can be measured
+ * with the same SD-Card.
+ *
+ * At the end the generated files are removed, and the configuration is read
+ * again from @ref CONFIG_FILE_NAME.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Added BenchFs() for the FatFs workload, and BENCH_FS_CFG for the
+		configuration matrix of the target "bench-fatfs".
+2026-10-15,agnt	BenchRTC() also records PendSV_Handler(), the deferred work.
+2026-10-15,agnt	BenchRFID() also decodes recorded SR and LR frames.
+2026-10-15,agnt	Use StrFormat() instead of sprintf().
+2026-10-14,agnt	Initial version.
+*/
+
+#ifdef BENCH	/*################ ONLY FOR THE MICRO-BENCHMARK ################*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "em_cmu.h"
+#include "em_emu.h"
+#include "em_int.h"
+#include "em_usart.h"
+#include "config.h"		// include project configuration parameters
+#include "AlarmClock.h"		// RTC_COUNTS_PER_SEC, MS2TICS()
+#include "CfgData.h"
+#include "Control.h"
+#include "IsrProfile.h"
+#include "LEUART.h"
+#include "Logging.h"
+#include "RFID.h"
+#include "ff.h"
+#include "diskio.h"
+#include "microsd.h"
+#include "StrFormat.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief File to measure f_write(), its first sector is used for the
+     * block transfers.
+     */
+#define BENCH_DATA_FILE		"BENCH.DAT"
+
+    /*!@brief CSV file with the results. */
+#define BENCH_CSV_FILE		"BENCH.CSV"
+
+    /*!@brief Number of the FatFs configuration of the target "bench-fatfs",
+     * 0 is the production configuration of "ffconf.h".
+     */
+#ifndef BENCH_FS_CFG
+    #define BENCH_FS_CFG	0
+#endif
+
+    /*!@brief CSV file of the images of the FatFs configuration matrix, "%d"
+     * is @ref BENCH_FS_CFG.
+     */
+#define BENCH_FS_CSV_FILE	"BFS%d.CSV"
+
+    /*!@brief Log file of the FatFs workload. */
+#define BENCH_FS_LOG_FILE	"BLOG.TXT"
+
+    /*!@brief Name of the generated configuration files, "%d" is the number
+     * of IDs.
+     */
+#define BENCH_CFG_FILE		"BCFG%d.TXT"
+
+    /*!@brief Maximum number of result lines. */
+#define BENCH_MAX_RESULTS	48
+
+    /*!@brief Number of block transfers per SPI clock. */
+#define BENCH_BLOCK_CNT		8
+
+    /*!@brief Number of f_write() calls per size. */
+#define BENCH_WRITE_CNT		32
+
+    /*!@brief Number of calls of each operation of the FatFs workload. */
+#define BENCH_FS_CNT		16
+
+    /*!@brief Number of f_getfree() calls with a scan of the FAT, which may
+     * take seconds on a large SD-Card.
+     */
+#define BENCH_FS_SCAN_CNT	2
+
+    /*!@brief Size of a line appended to @ref BENCH_FS_LOG_FILE. */
+#define BENCH_FS_LINE_SIZE	64
+
+    /*!@brief Bytes read at each position of the backward seeks. */
+#define BENCH_FS_SEEK_SIZE	16
+
+    /*!@brief Number of Log() calls per message, all of them must fit into
+     * the log buffer, see @ref LOG_BUF_SIZE.
+     */
+#define BENCH_LOG_CNT		8
+
+    /*!@brief Number of frames for RFID_Decode(), each new ID is logged, so
+     * all messages must fit into the log buffer.
+     */
+#define BENCH_RFID_FRAMES	32
+
+    /*!@brief Size of a frame of the Short Range reader. */
+#define BENCH_RFID_FRAME_SIZE	14
+
+    /*!@brief Number of calls for each recorded frame. */
+#define BENCH_RFID_REC_CNT	8
+
+    /*!@brief Duration in [s] for the statistics of RTC_IRQHandler(). */
+#define BENCH_IDLE_TIME		10
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Result of a measurement, i.e. one line of the CSV file. */
+typedef struct
+{
+    const char	*pName;		//!< Name of the measured routine
+    uint32_t	 Param;		//!< Parameter, e.g. SPI clock or size
+    uint32_t	 Bytes;		//!< Bytes per call for the throughput, or 0
+    uint32_t	 ErrCnt;	//!< Number of failed calls
+    ISR_PROF	 Prof;		//!< Cycle statistics of the calls
+} BENCH_RESULT;
+
+    /*!@brief Recorded frame of an RFID reader for RFID_Decode(). */
+typedef struct
+{
+    const char	*pName;		//!< Name of the measurement, NULL at the end
+    RFID_TYPE	 Type;		//!< Reader type of the frame
+    int		 IDs;		//!< Expected number of IDs of the first call
+    uint8_t	 Cnt;		//!< Number of bytes
+    uint8_t	 Data[BENCH_RFID_FRAME_SIZE];	//!< Frame data
+} BENCH_RFID_REC;
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Sizes for f_write() in bytes. */
+static const uint16_t l_BenchWriteSize[] = { 16, 64, 256, 512 };
+
+    /*!@brief Number of IDs of the generated configuration files. */
+static const uint16_t l_BenchCfgIDs[] = { 10, 100, 1000 };
+
+    /*!@brief Recorded frames with valid and corrupted checksums. */
+static const BENCH_RFID_REC l_BenchRfidRec[] =
+{
+    { "RFID_Decode SR", RFID_TYPE_SR, 1, 14,
+      { 0x0E, 0x00, 0x11, 0x00, 0x05, 0x01, 0x00, 0xAF,
+	0x01, 0xD0, 0xE7, 0xEC, 0xD2, 0xBC } },
+    { "RFID_Decode SR bad XOR", RFID_TYPE_SR, 0, 14,
+      { 0x0E, 0x00, 0x11, 0x00, 0x05, 0x01, 0x00, 0xAF,
+	0x01, 0xD0, 0xE7, 0xEC, 0xD2, 0xBD } },
+    { "RFID_Decode LR", RFID_TYPE_LR, 1, 11,
+      { 0x54, 0x03, 0x00, 0xAF, 0x01, 0xD0, 0xE7, 0x00,
+	0x00, 0x03, 0x41 } },
+    { "RFID_Decode LR bad CRC", RFID_TYPE_LR, 0, 11,
+      { 0x54, 0x03, 0x00, 0xAF, 0x01, 0xD0, 0xE7, 0x00,
+	0x00, 0x03, 0x42 } },
+    { NULL }
+};
+
+    /*!@brief Results of the measurements. */
+static BENCH_RESULT l_Result[BENCH_MAX_RESULTS];
+static int	 l_ResultCnt;
+
+    /*!@brief Data buffer, DMA transfers require 16bit alignment. */
+static uint8_t	 l_Buf[512] __attribute__((aligned(4)));
+
+    /*!@brief File handle for the benchmark files. */
+static FIL	 l_fh;
+
+#if _USE_FASTSEEK
+    /*!@brief Cluster link map of the fast seek mode, for 15 fragments. */
+static DWORD	 l_FsClmt[32];
+#endif
+
+/*=========================== Forward Declarations ===========================*/
+
+static BENCH_RESULT *BenchNew (const char *pName, uint32_t param,
+			       uint32_t bytes);
+static void	BenchAccount (BENCH_RESULT *pRes, uint32_t cycles, bool flgOk);
+static void	BenchBlock (DWORD sector);
+static void	BenchFs (uint32_t freq);
+static void	BenchWrite (DWORD *pSector);
+static void	BenchLog (void);
+static void	BenchCfg (void);
+static void	BenchRFID (void);
+static void	BenchRTC (void);
+static void	BenchReport (void);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Run the Micro-Benchmark
+ *
+ * This routine is called once after each mount of an SD-Card.  It runs all
+ * measurements, writes the results, and restores the configuration.  The
+ * main loop is blocked meanwhile.
+ *
+ ******************************************************************************/
+void	BenchRun (void)
+{
+DWORD	 sector = 0;
+uint32_t freq;
+char	 name[13];
+unsigned int i;
+
+    Log ("Bench: Starting the micro-benchmark");
+    LogFlush(true);	// keep SD-Card power on!
+
+    l_ResultCnt = 0;
+
+    if (DiskAcquire() != 0)
+    {
+	LogError ("Bench: SD-Card Initialization Failed");
+	return;
+    }
+
+    BenchWrite (&sector);
+    if (sector != 0)
+	BenchBlock (sector);
+
+    /* FatFs workload at the high speed clock, then at the tuned one */
+    USART_BaudrateSyncSet (MICROSD_USART, 0, MICROSD_HI_SPI_FREQ);
+    freq = USART_BaudrateGet (MICROSD_USART);
+    BenchFs (freq);
+    MICROSD_SpiClkFast();
+    if (USART_BaudrateGet (MICROSD_USART) > freq)
+	BenchFs (USART_BaudrateGet (MICROSD_USART));
+
+    BenchLog();
+    BenchCfg();
+    BenchRFID();
+    BenchRTC();
+
+    if (DiskAcquire() == 0)
+    {
+	BenchReport();
+
+	/* Remove the generated files, CONFIG.BIN is built again */
+	f_unlink (BENCH_DATA_FILE);
+	f_unlink (BENCH_FS_LOG_FILE);
+	for (i = 0;  i < sizeof(l_BenchCfgIDs) / sizeof(l_BenchCfgIDs[0]);  i++)
+	{
+	    StrFormat (name, BENCH_CFG_FILE, l_BenchCfgIDs[i]);
+	    f_unlink (name);
+	}
+	f_unlink (CFG_BIN_FILE_NAME);
+    }
+
+    /* Restore the configuration of this SD-Card */
+    CfgRead (CONFIG_FILE_NAME);
+    ControlCompileActions();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Allocate a new Result
+ *
+ * @return
+ *	Address of the result, or NULL if @ref BENCH_MAX_RESULTS is reached.
+ *
+ ******************************************************************************/
+static BENCH_RESULT *BenchNew (const char *pName, uint32_t param,
+			       uint32_t bytes)
+{
+BENCH_RESULT *pRes;
+
+    if (l_ResultCnt >= BENCH_MAX_RESULTS)
+	return NULL;
+
+    pRes = &l_Result[l_ResultCnt++];
+    memset (pRes, 0, sizeof(*pRes));
+    pRes->pName = pName;
+    pRes->Param = param;
+    pRes->Bytes = bytes;
+
+    return pRes;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Account the Cycles of a Call
+ *
+ * Only successful calls are part of the cycle statistics.
+ *
+ ******************************************************************************/
+static void	BenchAccount (BENCH_RESULT *pRes, uint32_t cycles, bool flgOk)
+{
+ISR_PROF *pProf;
+
+    if (pRes == NULL)
+	return;
+
+    if (! flgOk)
+    {
+	pRes->ErrCnt++;
+	return;
+    }
+
+    pProf = &pRes->Prof;
+    if (cycles < pProf->Min  ||  pProf->Cnt == 0)
+	pProf->Min = cycles;
+    if (cycles > pProf->Max)
+	pProf->Max = cycles;
+    pProf->Sum += cycles;
+    pProf->Cnt++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Measure f_write()
+ *
+ * This routine writes @ref BENCH_WRITE_CNT blocks of each size of
+ * @ref l_BenchWriteSize into @ref BENCH_DATA_FILE, measures the f_sync(),
+ * and closes the file.
+ *
+ * @param[out] pSector
+ *	Returns the first sector of the file, or 0 on error.
+ *
+ ******************************************************************************/
+static void	BenchWrite (DWORD *pSector)
+{
+BENCH_RESULT *pRes;
+FATFS	*pFs;
+FRESULT	 res;
+UINT	 bw;
+uint32_t start;
+unsigned int i, n;
+
+    *pSector = 0;
+
+    res = f_open (&l_fh, BENCH_DATA_FILE, FA_WRITE | FA_CREATE_ALWAYS);
+    if (res != FR_OK)
+    {
+	LogError ("Bench: " BENCH_DATA_FILE " FILE OPEN - Error Code %d", res);
+	return;
+    }
+
+    for (i = 0;  i < sizeof(l_Buf);  i++)
+	l_Buf[i] = (uint8_t)i;
+
+    for (i = 0;  i < sizeof(l_BenchWriteSize) / sizeof(l_BenchWriteSize[0]);
+	 i++)
+    {
+	pRes = BenchNew ("f_write", l_BenchWriteSize[i], l_BenchWriteSize[i]);
+
+	for (n = 0;  n < BENCH_WRITE_CNT;  n++)
+	{
+	    start = DWT->CYCCNT;
+	    res = f_write (&l_fh, l_Buf, l_BenchWriteSize[i], &bw);
+	    BenchAccount (pRes, DWT->CYCCNT - start,
+			  res == FR_OK  &&  bw == l_BenchWriteSize[i]);
+	}
+    }
+
+    pRes = BenchNew ("f_sync", 0, 0);
+    start = DWT->CYCCNT;
+    res = f_sync (&l_fh);
+    BenchAccount (pRes, DWT->CYCCNT - start, res == FR_OK);
+
+    /* The file has been allocated now, get its first sector */
+    pFs = l_fh.fs;
+    if (res == FR_OK  &&  l_fh.sclust >= 2)
+	*pSector = pFs->database + (l_fh.sclust - 2) * pFs->csize;
+
+    f_close (&l_fh);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Measure the Block Transfers at each SPI Clock
+ *
+ * The sector is read, and the same data is written back, so the content of
+ * the file does not change.  A transfer with a CRC error counts as failed,
+ * MICROSD_BlockRx() downgrades the SPI clock in this case.  Afterwards the
+ * clock of MICROSD_SpiClkFast() is restored.
+ *
+ * @param[in] sector
+ *	Sector to be used for the transfers.
+ *
+ ******************************************************************************/
+static void	BenchBlock (DWORD sector)
+{
+BENCH_RESULT *pResRx, *pResTx;
+uint32_t freq, start;
+BYTE	 cardType;
+int	 i, ok;
+
+    /* Convert to byte address if required, see disk_read() */
+    if (disk_ioctl (0, MMC_GET_TYPE, &cardType) != RES_OK)
+	return;
+    if (! (cardType & CT_BLOCK))
+	sector *= 512;
+
+    for (freq = MICROSD_LO_SPI_FREQ;  freq <= MICROSD_MAX_SPI_FREQ;
+	 freq = (freq < MICROSD_HI_SPI_FREQ ? MICROSD_HI_SPI_FREQ
+					    : freq + MICROSD_SPI_FREQ_STEP))
+    {
+	USART_BaudrateSyncSet (MICROSD_USART, 0, freq);
+
+	pResRx = BenchNew ("MICROSD_BlockRx", freq, 512);
+	pResTx = BenchNew ("MICROSD_BlockTx", freq, 512);
+
+	for (i = 0;  i < BENCH_BLOCK_CNT;  i++)
+	{
+	    /* READ_SINGLE_BLOCK */
+	    ok = (MICROSD_SendCmd (CMD17, sector) == 0);
+	    start = DWT->CYCCNT;
+	    ok = ok  &&  MICROSD_BlockRx (l_Buf, 512);
+	    BenchAccount (pResRx, DWT->CYCCNT - start, ok);
+	    MICROSD_Deselect();
+	    MICROSD_RxCrcError();	// clear flag, the result counts it
+
+	    if (! ok)
+		continue;		// do not write back invalid data
+
+	    /* WRITE_BLOCK */
+	    ok = (MICROSD_SendCmd (CMD24, sector) == 0);
+	    start = DWT->CYCCNT;
+	    ok = ok  &&  MICROSD_BlockTx (l_Buf, 0xFE);
+	    BenchAccount (pResTx, DWT->CYCCNT - start, ok);
+	    MICROSD_Deselect();
+	}
+    }
+
+    MICROSD_SpiClkFast();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Measure the FatFs Workload
+ *
+ * This routine measures the file operations of the firmware at the current
+ * SPI clock, with the sector cache of diskio.c as in the field:
+ * - Appending a line to @ref BENCH_FS_LOG_FILE, i.e. f_open(), f_lseek() to
+ *   the end, f_write(), and f_close(), like LogFlush() does.
+ * - Reading @ref CONFIG_FILE_NAME completely, the bytes per call are the
+ *   size of the file.
+ * - Seeking backwards through @ref BENCH_DATA_FILE, and reading
+ *   @ref BENCH_FS_SEEK_SIZE bytes at each position.  With @ref _USE_FASTSEEK,
+ *   the file is opened in fast seek mode.
+ * - Scanning the root directory, the bytes per call are the number of
+ *   entries.
+ * - Querying the free space with f_getfree(), once with the cached number of
+ *   free clusters, and once with a scan of the FAT.
+ *
+ * The operations which have been removed by @ref _FS_MINIMIZE are skipped.
+ *
+ * @param[in] freq
+ *	SPI clock in [Hz], the parameter of the results.
+ *
+ ******************************************************************************/
+static void	BenchFs (uint32_t freq)
+{
+BENCH_RESULT *pRes;
+FRESULT	 res;
+UINT	 cnt;
+DWORD	 size, ofs;
+uint32_t start;
+int	 n;
+#if _FS_MINIMIZE <= 1
+DIR	 dir;
+FILINFO	 fno;
+#endif
+#if _FS_MINIMIZE == 0
+FATFS	*pFs;
+DWORD	 clust;
+#endif
+
+    LogFlush(true);	// keep SD-Card power on!
+
+    /* Append lines to a log file */
+    memset (l_Buf, 'x', BENCH_FS_LINE_SIZE - 2);
+    l_Buf[BENCH_FS_LINE_SIZE - 2] = '\r';
+    l_Buf[BENCH_FS_LINE_SIZE - 1] = '\n';
+
+    pRes = BenchNew ("FS append", freq, BENCH_FS_LINE_SIZE);
+    for (n = 0;  n < BENCH_FS_CNT;  n++)
+    {
+	cnt = 0;
+	start = DWT->CYCCNT;
+	res = f_open (&l_fh, BENCH_FS_LOG_FILE,
+		      FA_READ | FA_WRITE | FA_OPEN_ALWAYS);
+	if (res == FR_OK)
+	{
+	    res = f_lseek (&l_fh, f_size(&l_fh));
+	    if (res == FR_OK)
+		res = f_write (&l_fh, l_Buf, BENCH_FS_LINE_SIZE, &cnt);
+	    if (f_close (&l_fh) != FR_OK)
+		res = FR_DISK_ERR;
+	}
+	BenchAccount (pRes, DWT->CYCCNT - start,
+		      res == FR_OK  &&  cnt == BENCH_FS_LINE_SIZE);
+    }
+
+    /* Read the configuration file completely */
+    pRes = BenchNew ("FS read config", freq, 0);
+    for (n = 0;  n < BENCH_FS_CNT;  n++)
+    {
+	size = 0;
+	start = DWT->CYCCNT;
+	res = f_open (&l_fh, CONFIG_FILE_NAME, FA_READ | FA_OPEN_EXISTING);
+	if (res == FR_OK)
+	{
+	    do
+	    {
+		res = f_read (&l_fh, l_Buf, sizeof(l_Buf), &cnt);
+		size += cnt;
+	    } while (res == FR_OK  &&  cnt == sizeof(l_Buf));
+	    f_close (&l_fh);
+	}
+	BenchAccount (pRes, DWT->CYCCNT - start, res == FR_OK);
+	if (pRes != NULL)
+	    pRes->Bytes = size;
+    }
+
+    /* Seek backwards through the data file */
+    pRes = BenchNew ("FS lseek", freq, BENCH_FS_SEEK_SIZE);
+    if (f_open (&l_fh, BENCH_DATA_FILE, FA_READ | FA_OPEN_EXISTING) == FR_OK)
+    {
+#if _USE_FASTSEEK
+	l_FsClmt[0] = sizeof(l_FsClmt) / sizeof(l_FsClmt[0]);
+	l_fh.cltbl = l_FsClmt;
+	if (f_lseek (&l_fh, CREATE_LINKMAP) != FR_OK)
+	{
+	    LogError ("Bench: Cluster link map too small for "
+		      BENCH_DATA_FILE);
+	    l_fh.cltbl = NULL;
+	}
+#endif
+	size = (f_size(&l_fh) > BENCH_FS_SEEK_SIZE
+		? f_size(&l_fh) - BENCH_FS_SEEK_SIZE : 0);
+	for (n = 0;  n < BENCH_FS_CNT;  n++)
+	{
+	    cnt = 0;
+	    ofs = size - size / BENCH_FS_CNT * n;
+	    start = DWT->CYCCNT;
+	    res = f_lseek (&l_fh, ofs);
+	    if (res == FR_OK)
+		res = f_read (&l_fh, l_Buf, BENCH_FS_SEEK_SIZE, &cnt);
+	    BenchAccount (pRes, DWT->CYCCNT - start,
+			  res == FR_OK  &&  cnt == BENCH_FS_SEEK_SIZE);
+	}
+	f_close (&l_fh);
+    }
+
+#if _FS_MINIMIZE <= 1
+    /* Scan the root directory */
+    pRes = BenchNew ("FS dir scan", freq, 0);
+    for (n = 0;  n < BENCH_FS_CNT;  n++)
+    {
+	cnt = 0;
+	start = DWT->CYCCNT;
+	res = f_opendir (&dir, "/");
+	while (res == FR_OK)
+	{
+	    res = f_readdir (&dir, &fno);
+	    if (res != FR_OK  ||  fno.fname[0] == EOS)
+		break;
+	    cnt++;
+	}
+	BenchAccount (pRes, DWT->CYCCNT - start, res == FR_OK);
+	if (pRes != NULL)
+	    pRes->Bytes = cnt;
+    }
+#endif
+
+#if _FS_MINIMIZE == 0
+    /* Query the free space, the number of free clusters is cached */
+    pRes = BenchNew ("FS getfree", freq, 0);
+    for (n = 0;  n < BENCH_FS_CNT;  n++)
+    {
+	start = DWT->CYCCNT;
+	res = f_getfree ("/", &clust, &pFs);
+	BenchAccount (pRes, DWT->CYCCNT - start, res == FR_OK);
+    }
+
+    /* The same after a mount without valid FSInfo, i.e. with a FAT scan */
+    pRes = BenchNew ("FS getfree scan", freq, 0);
+    for (n = 0;  n < BENCH_FS_SCAN_CNT  &&  res == FR_OK;  n++)
+    {
+	pFs->free_clust = 0xFFFFFFFF;
+	start = DWT->CYCCNT;
+	res = f_getfree ("/", &clust, &pFs);
+	BenchAccount (pRes, DWT->CYCCNT - start, res == FR_OK);
+    }
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Measure Log() and LogFlush()
+ *
+ ******************************************************************************/
+static void	BenchLog (void)
+{
+BENCH_RESULT *pRes;
+uint32_t start;
+int	 i;
+
+    LogFlush(true);	// start with an empty log buffer
+
+    pRes = BenchNew ("Log", 0, 0);
+    for (i = 0;  i < BENCH_LOG_CNT;  i++)
+    {
+	start = DWT->CYCCNT;
+	Log ("Bench: Constant message without any format conversion");
+	BenchAccount (pRes, DWT->CYCCNT - start, true);
+    }
+
+    pRes = BenchNew ("Log", 1, 0);
+    for (i = 0;  i < BENCH_LOG_CNT;  i++)
+    {
+	start = DWT->CYCCNT;
+	Log ("Bench: Formatted #%d, %s, 0x%08lX, %ldms", i, "string",
+	     DWT->CYCCNT, RTC->CNT * 1000 / RTC_COUNTS_PER_SEC);
+	BenchAccount (pRes, DWT->CYCCNT - start, true);
+    }
+
+    pRes = BenchNew ("LogFlush", 2 * BENCH_LOG_CNT, 0);
+    start = DWT->CYCCNT;
+    LogFlush(true);
+    BenchAccount (pRes, DWT->CYCCNT - start, true);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Measure CfgRead()
+ *
+ * For each entry of @ref l_BenchCfgIDs, a configuration file is generated
+ * with the reader type and this number of IDs.  The parameter sets of the
+ * IDs alternate, so the table contains more than one.  The first CfgRead()
+ * parses the text file and generates the binary image, the second one loads
+ * the image.
+ *
+ ******************************************************************************/
+static void	BenchCfg (void)
+{
+BENCH_RESULT *pRes;
+FRESULT	 res;
+char	 name[13];
+char	 line[48];
+UINT	 bw;
+uint32_t start;
+int	 len;
+unsigned int i, n, cnt;
+
+    for (i = 0;  i < sizeof(l_BenchCfgIDs) / sizeof(l_BenchCfgIDs[0]);  i++)
+    {
+	cnt = l_BenchCfgIDs[i];
+	StrFormat (name, BENCH_CFG_FILE, cnt);
+
+	if (DiskAcquire() != 0)
+	    return;
+
+	res = f_open (&l_fh, name, FA_WRITE | FA_CREATE_ALWAYS);
+	if (res != FR_OK)
+	{
+	    LogError ("Bench: %s FILE OPEN - Error Code %d", name, res);
+	    return;
+	}
+
+	len = StrFormat (line, "RFID_TYPE = SR\r\n");
+	res = f_write (&l_fh, line, len, &bw);
+
+	for (n = 0;  n < cnt  &&  res == FR_OK;  n++)
+	{
+	    len = StrFormat (line, "ID = BE000000%08X:%d:0:%d\r\n",
+			     n, 10 + (n & 3), 1 + (n & 3));
+	    res = f_write (&l_fh, line, len, &bw);
+	}
+	f_close (&l_fh);
+
+	if (res != FR_OK)
+	{
+	    LogError ("Bench: %s FILE WRITE - Error Code %d", name, res);
+	    return;
+	}
+
+	for (n = 0;  n < 2;  n++)
+	{
+	    pRes = BenchNew (n == 0 ? "CfgRead text" : "CfgRead bin", cnt, 0);
+	    LogFlush(true);	// keep SD-Card power on!
+	    start = DWT->CYCCNT;
+	    CfgRead (name);
+	    BenchAccount (pRes, DWT->CYCCNT - start, true);
+	}
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Measure RFID_Decode()
+ *
+ * The frames of the Short Range reader consist of a fixed prefix, the 8
+ * bytes of the transponder ID with the least significant byte first, and
+ * the XOR of all bytes.  Each frame contains another ID, so every frame is
+ * processed as a new transponder.
+ *
+ * Then each frame of @ref l_BenchRfidRec is decoded, the call fails if the
+ * number of IDs differs from the expected one.  Only the first call of a
+ * valid frame posts its ID, the repetitions are the same transponder.
+ *
+ ******************************************************************************/
+static void	BenchRFID (void)
+{
+BENCH_RESULT *pRes;
+const BENCH_RFID_REC *pRec;
+uint8_t	 frame[BENCH_RFID_FRAME_SIZE] = { 0x0E, 0x00, 0x11, 0x00, 0x05 };
+uint32_t start;
+int	 i, n, ids;
+
+    LogFlush(true);	// start with an empty log buffer
+
+    pRes = BenchNew ("RFID_Decode", BENCH_RFID_FRAMES, BENCH_RFID_FRAME_SIZE);
+
+    for (n = 0;  n < BENCH_RFID_FRAMES;  n++)
+    {
+	memset (frame + 5, 0, 8);
+	frame[5]  = (uint8_t)n;		// LSB of the ID
+	frame[12] = 0xBE;		// MSB of the ID
+	frame[13] = 0;
+	for (i = 0;  i < BENCH_RFID_FRAME_SIZE - 1;  i++)
+	    frame[13] ^= frame[i];
+
+	start = DWT->CYCCNT;
+	ids = RFID_BenchDecode (RFID_TYPE_SR, frame, BENCH_RFID_FRAME_SIZE);
+	BenchAccount (pRes, DWT->CYCCNT - start, ids == 1);
+    }
+
+    for (pRec = l_BenchRfidRec;  pRec->pName != NULL;  pRec++)
+    {
+	pRes = BenchNew (pRec->pName, BENCH_RFID_REC_CNT, pRec->Cnt);
+
+	for (n = 0;  n < BENCH_RFID_REC_CNT;  n++)
+	{
+	    start = DWT->CYCCNT;
+	    ids = RFID_BenchDecode (pRec->Type, pRec->Data, pRec->Cnt);
+	    BenchAccount (pRes, DWT->CYCCNT - start,
+			  ids == (n == 0 ? pRec->IDs : 0));
+	}
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Measure RTC_IRQHandler()
+ *
+ * The statistics of the ISR profiler are reset, then the system is idle for
+ * @ref BENCH_IDLE_TIME seconds in EM1.  Every interrupt wakes it up, so the
+ * RTC counter is checked again.  The work deferred to PendSV_Handler() is
+ * recorded as a second result.
+ *
+ ******************************************************************************/
+static void	BenchRTC (void)
+{
+BENCH_RESULT *pRes;
+uint32_t start;
+
+    LogFlush(false);	// the SD-Card is not required meanwhile
+
+    INT_Disable();
+    memset (&g_IsrProf[ISR_PROF_RTC], 0, sizeof(g_IsrProf[ISR_PROF_RTC]));
+    memset (&g_IsrProf[ISR_PROF_DEFER], 0, sizeof(g_IsrProf[ISR_PROF_DEFER]));
+    INT_Enable();
+
+    start = RTC->CNT;
+    while (((RTC->CNT - start) & 0xFFFFFF) < MS2TICS(BENCH_IDLE_TIME * 1000))
+	EMU_EnterEM1();
+
+    pRes = BenchNew ("RTC_IRQHandler", BENCH_IDLE_TIME, 0);
+    if (pRes != NULL)
+    {
+	INT_Disable();
+	pRes->Prof = g_IsrProf[ISR_PROF_RTC];
+	INT_Enable();
+    }
+
+#if DEFER_WORK
+    pRes = BenchNew ("PendSV_Handler", BENCH_IDLE_TIME, 0);
+    if (pRes != NULL)
+    {
+	INT_Disable();
+	pRes->Prof = g_IsrProf[ISR_PROF_DEFER];
+	INT_Enable();
+    }
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Results
+ *
+ * The results are written into @ref BENCH_CSV_FILE, or @ref BENCH_FS_CSV_FILE
+ * for an image of the FatFs configuration matrix, and sent to the LEUART.
+ *
+ ******************************************************************************/
+static void	BenchReport (void)
+{
+BENCH_RESULT *pRes;
+FRESULT	 res;
+UINT	 bw;
+uint32_t freqMHz = CMU_ClockFreqGet(cmuClock_HF) / 1000000;
+uint32_t avg, perByte, kBps;
+char	 name[13];
+char	 line[120];
+int	 i, len;
+
+    if (BENCH_FS_CFG > 0)
+	StrFormat (name, BENCH_FS_CSV_FILE, BENCH_FS_CFG);
+    else
+	strcpy (name, BENCH_CSV_FILE);
+
+    res = f_open (&l_fh, name, FA_WRITE | FA_CREATE_ALWAYS);
+    if (res != FR_OK)
+	LogError ("Bench: %s FILE OPEN - Error Code %d", name, res);
+
+    /* FatFs configuration of this image */
+    len = StrFormat (line, "# FatFs config %d: _FS_TINY=%d _USE_FASTSEEK=%d "
+		     "_WORD_ACCESS=%d _FS_MINIMIZE=%d, sizeof FATFS=%d FIL=%d "
+		     "DIR=%d\n", BENCH_FS_CFG, _FS_TINY, _USE_FASTSEEK,
+		     _WORD_ACCESS, _FS_MINIMIZE, (int)sizeof(FATFS),
+		     (int)sizeof(FIL), (int)sizeof(DIR));
+    drvLEUART_putsWait (line);
+    if (res == FR_OK)
+	res = f_write (&l_fh, line, len, &bw);
+
+    len = StrFormat (line, "test,param,bytes,count,errors,min,avg,max,us,"
+		     "cyc_per_byte,kB_per_s\n");
+    drvLEUART_putsWait (line);
+    if (res == FR_OK)
+	res = f_write (&l_fh, line, len, &bw);
+
+    for (i = 0;  i < l_ResultCnt;  i++)
+    {
+	pRes = &l_Result[i];
+	avg = (pRes->Prof.Cnt ? (uint32_t)(pRes->Prof.Sum / pRes->Prof.Cnt) : 0);
+	perByte = kBps = 0;
+	if (pRes->Bytes > 0  &&  avg > 0)
+	{
+	    perByte = avg / pRes->Bytes;
+	    kBps = (uint32_t)((uint64_t)pRes->Bytes * freqMHz * 1000000
+			      / avg / 1024);
+	}
+
+	len = StrFormat (line, "%s,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld\n",
+			 pRes->pName, pRes->Param, pRes->Bytes, pRes->Prof.Cnt,
+			 pRes->ErrCnt, pRes->Prof.Min, avg, pRes->Prof.Max,
+			 freqMHz ? avg / freqMHz : 0, perByte, kBps);
+	drvLEUART_putsWait (line);
+	if (res == FR_OK)
+	    res = f_write (&l_fh, line, len, &bw);
+    }
+
+    if (res == FR_OK)
+	res = f_close (&l_fh);
+
+    if (res != FR_OK)
+	LogError ("Bench: %s FILE WRITE - Error Code %d", name, res);
+    else
+	Log ("Bench: %d results written to %s", l_ResultCnt, name);
+}
+
+#endif /* BENCH */
@@ -2,13 +2,106 @@
  * @file
  * @brief	Project configuration file
  * @author	Ralf Gerhauser / Peter Loes
- * @version	2016-02-27
+ * @version	2026-10-15
  *
  * This file allows to set miscellaneous configuration parameters.  It must be
  * included by all modules.
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	EM_PROFILE_INTERVAL is limited to 36h.
+2026-10-15,agnt	Removed ENERGY_LEDGER, ALARM_ENERGY_LEDGER, and EVT_ENERGY, the
+		energy ledger did not fit into the RAM of the device.
+2026-10-15,agnt	Removed TIMELINE and INT_CEIL_TIMELINE, the timeline did not fit
+		into the RAM of the device.
+2026-10-15,agnt	Removed DISK_HEALTH, the SD-Card health monitor did not fit
+		into the RAM of the device.
+2026-10-15,agnt	Removed LATENCY_TRACE, EVT_LATENCY, and INT_CEIL_LATENCY, the
+		latency trace did not fit into the RAM of the device.
+2026-10-15,agnt	Reduced LOG_TAIL_SIZE to 192, one telemetry response.
+2026-10-15,agnt	Added ITM_TRACE.
+2026-10-15,agnt	Added TASK_SCHED.
+2026-10-15,agnt	Added ALARM_SESSION_1~2 and ALARM_SESSION_WARM_1~2.
+2026-10-15,agnt	Added MEM_PROFILE to scale the RAM buffers to the device.
+2026-10-15,agnt	Added TASK_ENTRY, TASK_REGISTER(), and the TASK_PRIO_xxx
+		priorities of the main loop tasks.
+2026-10-15,agnt	Set MAX_MS_TIMERS to 18 for the record segments.
+2026-10-15,agnt	Added PLAY_THROTTLE.
+2026-10-15,agnt	Added SUPPLY_MON, EM1_MOD_SUPPLY, and CLK_OWN_SUPPLY.  Set
+		MAX_MS_TIMERS to 17.
+2026-10-15,agnt	Added SOUND_DETECT, CLK_OWN_SOUND, and INT_PRIO_ACMP.  Set
+		MAX_MS_TIMERS to 16.
+2026-10-15,agnt	Added WARM_START.  Set MAX_SEC_TIMERS to 19.
+2026-10-15,agnt	Added the INT_CEIL_xxx ceilings of the critical sections.
+2026-10-15,agnt	Added RFID_EM2_RX.
+2026-10-15,agnt	Added DCF77_LEARN_WINDOW and EVT_DCF77.  Set MAX_SEC_TIMERS to
+		18.
+2026-10-15,agnt	Added TIME_SOURCE and CLK_OWN_GPS.
+2026-10-15,agnt	Added TEMP_COMP, CLK_OWN_TEMP, and EVT_TEMP_COMP.  Set
+		MAX_SEC_TIMERS to 17.
+2026-10-15,agnt	Enabled TLM_FILE_EXPORT.
+2026-10-15,agnt	DMA channel 7 is shared, see DMA_CHAN_SHARED_FIRST.
+2026-10-15,agnt	Enabled LOG_PRIORITY.
+2026-10-15,agnt	Enabled LOG_FLUSH_ADAPTIVE.
+2026-10-15,agnt	Added DISK_HEALTH, see microsd.c.
+2026-10-15,agnt	Added TIMELINE, see Timeline.c.
+2026-10-15,agnt	Added INT_PRIO_PCPROF and PC_PROFILE_FILE_NAME, see PcProfile.c.
+2026-10-15,agnt	Added EVT_WAKE, FLAG_SET(), FLAG_CLR(), FLAG_TEST(), and
+		FlagTestClr().  Removed g_flgIRQ, the main loop does not sleep
+		while an event is pending in g_EventMask.
+2026-10-15,agnt	Added RAM_FUNCTIONS and RAMFUNC.
+2026-10-15,agnt	MAX_MS_TIMERS: msDelay().
+2026-10-15,agnt	Added FAST_BOOT.
+2026-10-15,agnt	Added PWR_SEQ, MAX_MS_TIMERS: power-up sequencer.
+2026-10-15,agnt	Added ENERGY_LEDGER, ALARM_ENERGY_LEDGER, and EVT_ENERGY.
+2026-10-15,agnt	Added FORECAST, ALARM_FORECAST, and EVT_FORECAST.
+2026-10-15,agnt	Added DEFER_WORK and INT_PRIO_DEFER, see Defer.c.
+2026-10-15,agnt	Added CLK_OWNERS, see ClockMgr.c.
+2026-10-15,agnt	Added HF_CLOCK_GOVERNOR.
+2026-10-15,agnt	Added RFID_READERS and DMA_CHAN_RFID2_RX, MAX_MS_TIMERS: gap
+		timer of the second RFID reader.
+2026-10-15,agnt	MAX_MS_TIMERS: RFID duty cycling.
+2026-10-15,agnt	MAX_MS_TIMERS: RFID early power-off.
+2026-10-15,agnt	MAX_MS_TIMERS: Light barrier filter and debouncing.
+2026-10-15,agnt	Added LB_TIMELINE and LB_TIMELINE_FILE_NAME.
+2026-10-15,agnt	Added VISIT_RECORDS and VISIT_REC_FILE_NAME.
+2026-10-15,agnt	Added VISIT_STATS, VISIT_STATS_FILE_NAME, ALARM_VISIT_STATS,
+		and EVT_STATS.
+2026-10-15,agnt	Added CFG_IDX_FILE_NAME and CFG_IDX_TMP_FILE_NAME.
+2026-10-15,agnt	Enabled LOG_INTEGRITY.
+2026-10-15,agnt	MAX_MS_TIMERS is 7, two of them are used for the LEDs.
+2026-10-15,agnt	Added PF_FAST_RESUME_TIME.
+2026-10-15,agnt	Added PF_VCMP_WARNING, PF_VCMP_LEVEL, and INT_PRIO_VCMP.
+2026-10-15,agnt	Added PF_HOLDUP_TIME and the settings of the power-fail stages.
+2026-10-15,agnt	Added EXTI_CAPTURE and its TIMER and PRS settings.
+2026-10-14,agnt	ISR_PROFILE is enabled for the micro-benchmark image, see BENCH.
+		Added prototype for BenchRun().
+2026-10-14,agnt	Bit() and IO_Bit() are mapped to SimBitSet() and SimBitGet() for
+		the host simulation, see SIMULATION.
+2026-10-14,agnt	Added EM1_MOD_CONSOLE.  Set MAX_SEC_TIMERS to 16.
+2026-10-14,agnt	Added TELEMETRY and LOG_TAIL_SIZE.
+2026-10-14,agnt	Enabled ALARM_ON_TIME_2~5 and ALARM_OFF_TIME_2~5.
+2026-10-14,agnt	Added MEM_MONITOR.  Set LOG_ALIVE_INTERVAL to 6h, it reports the
+		memory usage.  Set MAX_SEC_TIMERS to 15.
+2026-10-14,agnt	Enabled LOG_ROTATE, LOG_JOURNAL, and LOG_RETAIN.
+		Added compile-time log levels LOG_LEVEL and LOG_LEVEL_xxx.
+		Set DFLT_LOG_LEVEL to LOG_LVL_INFO, light barrier edges are
+		summarized.  Enabled DCF77_SAMPLE_MODE.
+		Set DCF77_VOTE_FRAMES to 4.  Enabled DCF77_ADAPTIVE_SYNC.
+		Added EM1_MOD_SMB and MAX_MS_TIMERS.
+		Enabled BAT_SNAPSHOT_LOG.
+		Enabled ENERGY_GOVERNOR.
+		Added EM_PROFILE and EM_PROFILE_INTERVAL.
+		Set MAX_SEC_TIMERS to 12.
+		Added ISR_PROFILE.  Enabled LATENCY_TRACE.
+		Added ALARM_AUDIO_TELEMETRY.
+		Added EVT_TASK, g_EventMask, and EVENT_POST() for the event
+		driven main loop.  Set MAX_SEC_TIMERS to 13.
+		Set MAX_SEC_TIMERS to 14 for DISK_RETAIN_TIME.
+2026-10-14,agnt	Added DMA channels for USART2 Tx/Rx (SD-Card).
+2026-10-14,agnt	Added DMA channels for USART0 Tx (Audio) and USART1 Rx (RFID).
+2026-10-14,agnt	Added type TRANSPONDER_ID and the special IDs ID_ANY and
+		ID_UNKNOWN.  Added CFG_BIN_FILE_NAME.
 2016-02-26,rage	Increased LOG_BUF_SIZE to 4KB.
 2016-02-10,rage	Set DFLT_RFID_POWER_OFF_TIMEOUT to 6 minutes.
 2014-11-11,rage	Derived from project "AlarmClock".
@@ -25,6 +118,36 @@ Revision History:
 
 /*=============================== Definitions ================================*/
 
+/*
+ * Memory profile of the device
+ */
+    /*!@brief The RAM buffers are scaled to the SRAM of the device, i.e. the
+     * log buffer, the in-RAM ID table and the fences of the ID index, the
+     * presence table of the RFID reader, the scratch pool, and the sector
+     * cache of diskio.c (see _DISK_CACHE_SECTORS in ffconf.h).  Each EFM32G
+     * part with 128KB of flash has 16KB of RAM, see DEVICE in armgcc/Makefile.
+     */
+#define MEM_PROFILE_16K		1	// 16KB RAM, e.g. EFM32G230F128
+#define MEM_PROFILE_32K		2	// 32KB RAM or more
+
+#if SRAM_SIZE >= 0x8000
+    #define MEM_PROFILE		MEM_PROFILE_32K
+#elif SRAM_SIZE >= 0x4000
+    #define MEM_PROFILE		MEM_PROFILE_16K
+#else
+    #error "The firmware requires a device with at least 16KB of RAM"
+#endif
+
+#if MEM_PROFILE == MEM_PROFILE_32K
+    #define MEM_LOG_BUF_SIZE	8192
+    #define CFG_ID_TABLE_SIZE	512
+    #define CFG_ID_INDEX_FENCES	128
+    #define RFID_PRESENCE_SIZE	8
+    #define SCRATCH_BLOCK_CNT	4
+#else
+    #define MEM_LOG_BUF_SIZE	4096
+#endif
+
 /*
  * Basic defines
  */
@@ -61,12 +184,34 @@ Revision History:
  */
 #define USE_EXT_32MHZ_CLOCK	1
 
+/*!
+ * @brief HF Clock Governor.
+ *
+ * Set to 1 to run the MCU from the internal RC oscillator, band
+ * @ref HF_CLOCK_HFRCO_BAND, and to start the external 32MHz XTAL only while
+ * the SD-Card is in use, see HfClock.c.  This requires the XTAL, see
+ * @ref USE_EXT_32MHZ_CLOCK.
+ */
+#define HF_CLOCK_GOVERNOR	1
+
 /*
  * Configuration for module "AlarmClock"
  */
     /*!@brief RTC frequency in [Hz]. */
 #define RTC_COUNTS_PER_SEC	32768
 
+    /*!@brief Number of msTimers (two LEDs, Control, DCF77, BatteryMon, RFID
+     * gap of both readers, early power-off and duty cycling, Audio playback
+     * chaining and record segments, light barrier filter and debouncing,
+     * power-up sequencer, sound detector, supply monitor, msDelay()). */
+#define MAX_MS_TIMERS		18
+
+    /*!@brief Number of sTimers, 19 are in use (Audio idle timeout, pre-roll,
+     * SD-Card detect poll, SD-Card retain, log alive interval, console
+     * high-speed idle timeout, temperature compensation, DCF77 reception
+     * check, watchdog heartbeat). */
+#define MAX_SEC_TIMERS		19
+
 
 /*!
  * @brief Interrupt Priority Settings
@@ -77,13 +222,50 @@ Revision History:
  * both use function localtime() and this is not multithreading save.
  * Funktion localtime_r() would be the right choice here, unfortunately it
  * is not available with the IAR compiler library.
+ * With @ref DEFER_WORK, the alarm clock and DCF77 are executed in the
+ * PendSV handler, which serializes them at the lowest priority
+ * @ref INT_PRIO_DEFER, see Defer.c.
  */
+#define INT_PRIO_PCPROF	1		//!<  SysTick samples all other ISRs
 #define INT_PRIO_UART	2		//!<  UART IRQs for RFID and Scales
 #define INT_PRIO_LEUART	2		//!<  LEUART RX interrupt (not used)
-#define INT_PRIO_DMA	2		//!<  DMA is used for LEUART
+#define INT_PRIO_DMA	2		//!<  DMA is used for LEUART and USARTs
 #define INT_PRIO_SMB	2		//!<  SMBus used by the battery monitor
 #define INT_PRIO_RTC	3		//!<  lower priority than others
 #define INT_PRIO_EXTI	INT_PRIO_RTC	//!<  must be the same as @ref INT_PRIO_RTC
+#define INT_PRIO_VCMP	INT_PRIO_EXTI	//!<  early power-fail warning
+#define INT_PRIO_ACMP	INT_PRIO_RTC	//!<  must be the same as @ref INT_PRIO_RTC
+#define INT_PRIO_DEFER	7		//!<  PendSV for the deferred work
+
+/*!
+ * @brief Ceilings of the Critical Sections
+ *
+ * Each structure which is shared with interrupt service routines is
+ * protected by CritEnter() with the priority of its most urgent user, see
+ * CritSect.h.  Interrupts of a higher priority are not delayed by it.
+ */
+#define INT_CEIL_LOG	INT_PRIO_SMB	//!<  log buffer, SMBus and VCMP log
+#define INT_CEIL_CONSOLE INT_PRIO_DMA	//!<  LEUART FIFO, DMA call-backs
+#define INT_CEIL_CLOCK	INT_PRIO_RTC	//!<  time() and localtime() of the RTC
+
+
+/*
+ * Configuration for External Interrupts "ExtInt.c"
+ */
+    /*!@brief Capture the edges of the light barriers and the DCF77 signal by
+     * a TIMER via PRS, so their time stamps do not include the interrupt
+     * latency, see ExtIntCaptureInit(). */
+#define EXTI_CAPTURE		1
+
+    /*!@brief TIMER and its clock used for capturing, three channels. */
+#define EXTI_CAPTURE_TIMER	TIMER2
+#define EXTI_CAPTURE_CLOCK	cmuClock_TIMER2
+
+    /*!@brief First of three PRS channels used for capturing. */
+#define EXTI_CAPTURE_PRS_CH	5
+
+    /*!@brief Maximum latency [ms], older captures are ignored. */
+#define EXTI_CAPTURE_MAX_MS	100
 
 
 /*
@@ -98,6 +280,74 @@ Revision History:
     /*!@brief Call ShowDCF77Indicator() to flash red LED on DCF77 signal. */
 #define DCF77_INDICATOR		1
 
+    /*!@brief Sample the DCF77 signal once per second instead of two EXTIs. */
+#define DCF77_SAMPLE_MODE	1
+
+    /*!@brief Validate DCF77 time by voting over the last 4 frames. */
+#define DCF77_VOTE_FRAMES	4
+
+    /*!@brief Skip daily DCF77 synchronizations while the clock drift is low. */
+#define DCF77_ADAPTIVE_SYNC	1
+
+    /*!@brief Move the daily DCF77 wake-up to the hour with the best reception,
+     * abort futile attempts. */
+#define DCF77_LEARN_WINDOW	1
+
+/*
+ * Configuration for module "TimeSrc"
+ */
+    /*!@brief The DCF77 receiver synchronizes the system clock.  Select
+     * TIME_SRC_GPS for a GPS receiver with PPS at the same connector, which
+     * requires RFID_READERS to be 1, see GPS.c. */
+#define TIME_SOURCE		TIME_SRC_DCF77
+
+/*
+ * Configuration for module "BatteryMon"
+ */
+    /*!@brief Log only changes of the battery status, read in one burst. */
+#define BAT_SNAPSHOT_LOG	1
+
+/*
+ * Configuration for module "Control"
+ */
+    /*!@brief Adapt durations and settings to the state of charge. */
+#define ENERGY_GOVERNOR		1
+
+/*
+ * Configuration for module "PowerFail"
+ */
+    /*!@brief Hold-up time [ms] of the supply after the power-fail signal,
+     * a stage which does not fit into the remaining time is skipped. */
+#define PF_HOLDUP_TIME		100
+
+    /*!@brief Time budget [ms] to cut the high-current loads. */
+#define PF_LOADS_BUDGET		2
+
+    /*!@brief Minimum supply [mV] and time budget [ms] to save the log
+     * buffer into the flash journal. */
+#define PF_JOURNAL_MIN_SUPPLY	2200
+#define PF_JOURNAL_BUDGET	40
+
+    /*!@brief Minimum supply [mV] and time budget [ms] to write back the
+     * sector cache and power off the SD-Card. */
+#define PF_DISK_MIN_SUPPLY	2800
+#define PF_DISK_BUDGET		50
+
+    /*!@brief Early warning by the voltage comparator (VCMP): the staged
+     * shutdown already begins when VDD falls below @ref PF_VCMP_LEVEL,
+     * before the power-fail signal of the regulator is asserted. */
+#define PF_VCMP_WARNING		1
+
+    /*!@brief Threshold [mV] of the early warning, 1667 to 3809 in steps of
+     * 34mV.  It must be above the supply level of the power-fail signal. */
+#define PF_VCMP_LEVEL		3100
+
+    /*!@brief Maximum duration [s] of an outage for a fast resume: if the
+     * Battery Pack has not been changed, the previous state of the RFID
+     * reader and the Audio module is restored, without probing and logging
+     * the battery again.  Set to 0 to disable this feature. */
+#define PF_FAST_RESUME_TIME	10
+
 /*
  * Configuration for module "RFID"
  */
@@ -105,11 +355,18 @@ Revision History:
    /*!@brief Duration in [s] during the RFID reader tries to read an ID. */
 #define DFLT_RFID_DETECT_TIMEOUT	 20	// 20s
 
+   /*!@brief A second RFID reader may be connected to LEUART1. */
+#define RFID_READERS		2
+
+   /*!@brief Set 1 to connect the only reader to LEUART1, so the MCU stays in
+    * EM2 while it is streaming, requires RFID_READERS to be 1. */
+#define RFID_EM2_RX		0
+
 /*
  * Configuration for module "Logging"
  */
-    /*!@brief Size of the log buffer in bytes. */
-#define LOG_BUF_SIZE	4096
+    /*!@brief Size of the log buffer in bytes, see MEM_PROFILE. */
+#define LOG_BUF_SIZE	MEM_LOG_BUF_SIZE
 
     /*!@brief Use this define to specify a function to be called for monitoring
      * the log activity.  Here, monitoring is done via the LEUART interface.
@@ -119,8 +376,43 @@ Revision History:
 /* forward declaration */
 void    drvLEUART_puts(const char *str);
 
-    /*!@brief Disable "alive" message by setting this interval to 0. */
-#define LOG_ALIVE_INTERVAL	0
+    /*!@brief Disable "alive" message by setting this interval to 0.  The
+     * alive message also logs the memory usage, see MEM_MONITOR.
+     */
+#define LOG_ALIVE_INTERVAL	(6 * 3600)	// every 6h
+
+    /*!@brief Keep the most recent messages for the telemetry protocol, one
+     * response carries up to TLM_PAYLOAD_MAX - 2 characters of them. */
+#define LOG_TAIL_SIZE	192
+
+    /*!@brief Split the log file into daily segments of up to 1MB. */
+#define LOG_ROTATE		1
+
+    /*!@brief Save the log buffer into internal flash in case of power-fail. */
+#define LOG_JOURNAL		1
+
+    /*!@brief Keep the contents of the log buffer after a warm reset. */
+#define LOG_RETAIN		1
+
+    /*!@brief Adapt log flushing to the fill level and the power state. */
+#define LOG_FLUSH_ADAPTIVE	1
+
+    /*!@brief Keep free space in the log buffer for errors and events. */
+#define LOG_PRIORITY		1
+
+    /*!@brief Append an integrity record to each flushed block of the log. */
+#define LOG_INTEGRITY		1
+
+    /*!@brief Compile-time log level, debug messages are removed. */
+#define LOG_LEVEL		LOG_LVL_INFO
+
+    /*!@brief Log level of the light barriers, every edge is a debug message. */
+#define LOG_LEVEL_LB		LOG_LVL_DBG
+
+    /*!@brief Runtime log level, set LOG_LEVEL = 4 in CONFIG.TXT to log every
+     * light barrier edge in addition to the summary.
+     */
+#define DFLT_LOG_LEVEL		LOG_LVL_INFO
 
 
 /*!@name DMA Channel Assignment
@@ -128,15 +420,48 @@ void    drvLEUART_puts(const char *str);
  * The following definitions assign the 8 DMA channels to the respective
  * devices or drivers.  These defines are used as index within the global
  * DMA_DESCRIPTOR_TypeDef structure @ref g_DMA_ControlBlock.
+ * The DMA controller itself is initialized by drvLEUART_Init(), the other
+ * drivers only configure their channels via DmaChanConfig().  The remaining
+ * channels from DMA_CHAN_SHARED_FIRST on are allocated on demand for single
+ * transfers, see DmaChanAlloc().
  */
 //@{
 #define DMA_CHAN_LEUART_RX	0	//! LEUART Rx uses DMA channel 0
 #define DMA_CHAN_LEUART_TX	1	//! LEUART Tx uses DMA channel 1
+#define DMA_CHAN_AUDIO_TX	2	//! USART0 Tx (Audio) uses DMA channel 2
+#define DMA_CHAN_RFID_RX	3	//! USART1 Rx (RFID) uses DMA channel 3
+#define DMA_CHAN_MICROSD_TX	4	//! USART2 Tx (SD-Card) uses DMA channel 4
+#define DMA_CHAN_MICROSD_RX	5	//! USART2 Rx (SD-Card) uses DMA channel 5
+#define DMA_CHAN_RFID2_RX	6	//! LEUART1 Rx (RFID 2) uses DMA channel 6
+#define DMA_CHAN_SHARED_FIRST	7	//! DMA channel 7 is shared on demand
 //@}
 
 /*!@brief Name of the configuration file. */
 #define CONFIG_FILE_NAME	"CONFIG.TXT"
 
+/*!@brief Name of the binary configuration image, see CfgRead(). */
+#define CFG_BIN_FILE_NAME	"CONFIG.BIN"
+
+/*!@brief Name of the sorted ID index and its scratch file, see CFG_ID_INDEX. */
+//@{
+#define CFG_IDX_FILE_NAME	"CONFIG.IDX"
+#define CFG_IDX_TMP_FILE_NAME	"CONFIG.TMP"
+//@}
+
+/*!@brief Name of the daily visit statistics, the number is the day of the
+ * year, see VISIT_STATS.
+ */
+#define VISIT_STATS_FILE_NAME	"STATS%03d.TXT"
+
+/*!@brief Name of the binary visit records, see VISIT_RECORDS. */
+#define VISIT_REC_FILE_NAME	"VISITS.BIN"
+
+/*!@brief Name of the dump of the PC profile, see PcProfileWrite(). */
+#define PC_PROFILE_FILE_NAME	"PCPROF.TXT"
+
+/*!@brief Name of the light barrier occupancy timeline, see LB_TIMELINE. */
+#define LB_TIMELINE_FILE_NAME	"LBTIME.BIN"
+
 /*================================== Macros ==================================*/
 
 #ifdef DEBUG
@@ -174,6 +499,15 @@ void    drvLEUART_puts(const char *str);
     #define DEBUG_TRACE_STOP
 #endif    
 
+#ifdef SIMULATION
+    /*
+     * The host simulation (see sim/Makefile) has no bit-band area.  SIM_BIT()
+     * is not a macro, it remains in the preprocessed source and is translated
+     * into SimBitSet() for an assignment, or SimBitGet() otherwise.
+     */
+#define IO_Bit(regName, bitNum)	SIM_BIT(regName, bitNum)
+#define Bit(varName, bitNum)	SIM_BIT(varName, bitNum)
+#else
     /*! Macro to address a single bit in the I/O range (peripheral range) in
      *  an atomic manner.
      * @param address   I/O register address.
@@ -198,9 +532,26 @@ void    drvLEUART_puts(const char *str);
 
     /*! Shortcut to directly access a bit in a variable. */
 #define Bit(varName, bitNum)	*SRAM_BIT_ADDR(&varName, bitNum)
+#endif
 
 /*=========================== Typedefs and Structs ===========================*/
 
+/*!@brief Binary representation of a transponder ID
+ *
+ * The 8 ID bytes delivered by the RFID reader are packed into a 64bit value.
+ * The string representation (16 hex digits) is only generated for logging.
+ */
+typedef uint64_t TRANSPONDER_ID;
+
+/*!@brief Special transponder IDs, see configuration file. */
+//@{
+#define ID_UNKNOWN	((TRANSPONDER_ID)0xFFFFFFFFFFFFFFFFULL)	//!< "UNKNOWN"
+#define ID_ANY		((TRANSPONDER_ID)0xFFFFFFFFFFFFFFFEULL)	//!< "ANY"
+//@}
+
+/*!@brief Buffer size for the string representation of a transponder ID. */
+#define ID_STR_SIZE	17
+
 /*!@brief Structure to hold Project Information */
 typedef struct
 {
@@ -222,16 +573,23 @@ typedef enum
     ALARM_DCF77_WAKE_UP,    //!< Wake up DCF77 to synchronize the system clock
     ALARM_BATTERY_MON_1,    //!< Time #1 for logging battery status
     ALARM_BATTERY_MON_2,    //!< Time #2 for logging battery status
+    ALARM_AUDIO_TELEMETRY,  //!< Time for logging the Audio telemetry
+    ALARM_VISIT_STATS,      //!< Time for writing the visit statistics
+    ALARM_FORECAST,         //!< Time for logging the storage/battery forecast
     ALARM_ON_TIME_1,        //!< Time #1 when to switch the system ON
-    //ALARM_ON_TIME_2,        //!< Time #2 when to switch the system ON
-    //ALARM_ON_TIME_3,        //!< Time #3 when to switch the system ON
-    //ALARM_ON_TIME_4,        //!< Time #4 when to switch the system ON
-    //ALARM_ON_TIME_5,        //!< Time #5 when to switch the system ON
+    ALARM_ON_TIME_2,        //!< Time #2 when to switch the system ON
+    ALARM_ON_TIME_3,        //!< Time #3 when to switch the system ON
+    ALARM_ON_TIME_4,        //!< Time #4 when to switch the system ON
+    ALARM_ON_TIME_5,        //!< Time #5 when to switch the system ON
     ALARM_OFF_TIME_1,       //!< Time #1 when to switch te system OFF
-    //ALARM_OFF_TIME_2,       //!< Time #2 when to switch te system OFF
-    //ALARM_OFF_TIME_3,       //!< Time #3 when to switch te system OFF
-    //ALARM_OFF_TIME_4,       //!< Time #4 when to switch te system OFF
-    //ALARM_OFF_TIME_5,       //!< Time #5 when to switch te system OFF
+    ALARM_OFF_TIME_2,       //!< Time #2 when to switch te system OFF
+    ALARM_OFF_TIME_3,       //!< Time #3 when to switch te system OFF
+    ALARM_OFF_TIME_4,       //!< Time #4 when to switch te system OFF
+    ALARM_OFF_TIME_5,       //!< Time #5 when to switch te system OFF
+    ALARM_SESSION_1,        //!< Time #1 when to start a stimulus session
+    ALARM_SESSION_2,        //!< Time #2 when to start a stimulus session
+    ALARM_SESSION_WARM_1,   //!< Warm-up of the Audio module for session #1
+    ALARM_SESSION_WARM_2,   //!< Warm-up of the Audio module for session #2
     NUM_ALARM_IDS
 } ALARM_ID;
 
@@ -241,24 +599,276 @@ typedef enum
  */
 //@{
 #define FIRST_POWER_ALARM	ALARM_ON_TIME_1
-#define LAST_POWER_ALARM	ALARM_OFF_TIME_1
+#define LAST_POWER_ALARM	ALARM_OFF_TIME_5
 #define NUM_POWER_ALARMS	(LAST_POWER_ALARM - ALARM_OFF_TIME_1 + 1)
 //@}
 
+/*
+ * !@brief These defines hold the first and last alarm time ENUM of the
+ * stimulus sessions, and the number of sessions.  The SESSION_TIME_n
+ * variables must directly follow OFF_TIME_5 in the configuration variable
+ * list, see Control.c.
+ */
+//@{
+#define FIRST_SESSION_ALARM	ALARM_SESSION_1
+#define LAST_SESSION_ALARM	ALARM_SESSION_WARM_2
+#define NUM_SESSIONS		(ALARM_SESSION_WARM_1 - ALARM_SESSION_1)
+//@}
+
 /*!@brief Enumeration of the EM1 Modules
  *
  * This is the list of Software Modules that require EM1 to work, i.e. they
  * will not work in EM2 because clocks, etc. would be disabled.  These enums
- * are used to set/clear the appropriate bit in the @ref g_EM1_ModuleMask.
+ * are passed to EM1_Acquire() and EM1_Release() to set/clear the appropriate
+ * bit in the @ref g_EM1_ModuleMask.
+ * Keep in sync with the module names @ref g_EM1_ModName in ClockMgr.c!
  */
 
 typedef enum
 {
     EM1_MOD_RFID,	//!<  0: The RFID Module uses the UART
     EM1_MOD_AUDIO,	//!<  1: The Audio Module uses the UART
+    EM1_MOD_SMB,	//!<  2: Asynchronous SMBus transfer of BatteryMon
+    EM1_MOD_CONSOLE,	//!<  3: High-speed mode of the LEUART console
+    EM1_MOD_SUPPLY,	//!<  4: DMA burst of the supply monitor
     END_EM1_MODULES
 } EM1_MODULES;
 
+/*!@brief Enumeration of the Clock Owners
+ *
+ * This is the list of Software Modules that acquire peripheral clocks via
+ * ClockAcquire().  A clock is disabled when its last owner has released it.
+ * Keep in sync with the owner names @ref l_ClkOwnerName in ClockMgr.c!
+ */
+
+typedef enum
+{
+    CLK_OWN_SYSTEM,	//!<  0: main.c, clocks which are always on
+    CLK_OWN_RFID,	//!<  1: UARTs of the RFID readers
+    CLK_OWN_AUDIO,	//!<  2: USART of the Audio Module
+    CLK_OWN_SMB,	//!<  3: I2C controller of BatteryMon
+    CLK_OWN_DISK,	//!<  4: SPI of the SD-Card
+    CLK_OWN_PWRFAIL,	//!<  5: VCMP and ADC of PowerFail
+    CLK_OWN_EXTINT,	//!<  6: Capture TIMER and PRS of ExtInt
+    CLK_OWN_LB,		//!<  7: Pulse counters of LightBarrier
+    CLK_OWN_LOG,	//!<  8: AES for the log encryption
+    CLK_OWN_TEMP,	//!<  9: ADC of TempComp
+    CLK_OWN_GPS,	//!< 10: LEUART of the GPS receiver
+    CLK_OWN_SOUND,	//!< 11: ACMP of the sound detector
+    CLK_OWN_SUPPLY,	//!< 12: ADC of the supply monitor
+    END_CLK_OWNERS
+} CLK_OWNERS;
+
+/*!@brief Enumeration of the Main Loop Tasks
+ *
+ * This is the list of tasks which are called from the service execution loop
+ * in main.c.  Each task has a bit in @ref g_EventMask, which is set via
+ * EVENT_POST() when there is something to do for it, e.g. by an interrupt
+ * service routine or a timer function.  The main loop only calls the tasks
+ * whose bits are set, and clears them before.  It does not enter a sleep mode
+ * while any bit is set.
+ */
+typedef enum
+{
+    EVT_COMMAND,	//!<  0: CheckCommand(), a command line has been received
+    EVT_RFID,		//!<  1: RFID_Check()
+    EVT_DISK,		//!<  2: DiskCheck()
+    EVT_BATTERY,	//!<  3: BatteryCheck()
+    EVT_AUDIO,		//!<  4: AudioCheck()
+    EVT_LOG,		//!<  5: LogFlushCheck()
+    EVT_STATS,		//!<  6: VisitStatsCheck()
+    EVT_FORECAST,	//!<  7: ForecastCheck()
+    EVT_TEMP_COMP,	//!<  8: TempCompCheck()
+    EVT_DCF77,		//!<  9: DCF77Check()
+    EVT_WAKE,		//!< 10: no task, just another pass of the main loop
+    END_EVT_TASKS
+} EVT_TASK;
+
+    /*! Bit mask of all tasks in @ref EVT_TASK. */
+#define EVT_ALL		((1 << END_EVT_TASKS) - 1)
+
+    /*! Post an event for a task of @ref EVT_TASK and keep the main loop
+     * running.  The bit is set via bit-band, so this may be used in interrupt
+     * context as well. */
+#define EVENT_POST(task)	do { Bit(g_EventMask, task) = 1; } while (0)
+
+    /*! Post events for all tasks, e.g. after the configuration has changed.
+     * Requires "em_int.h". */
+#define EVENT_POST_ALL()	do { INT_Disable();  g_EventMask |= EVT_ALL;	\
+				     INT_Enable(); } while (0)
+
+/*!@brief Entry of the task table of the main loop, see TASK_REGISTER(). */
+typedef struct
+{
+    uint32_t	EventMask;	//!< Bits of @ref g_EventMask to call the task
+    void	(*pFct)(void);	//!< Task function
+} TASK_ENTRY;
+
+    /*! Register a function of a module as task of the main loop, which is
+     * called when the event <b>evt</b> of @ref EVT_TASK has been posted.  The
+     * entries are collected by the linker in section ".task_table", sorted by
+     * their priority <b>prio</b>, i.e. one of the three-digit TASK_PRIO_xxx
+     * numbers below.  The table is located between @ref __task_start and
+     * @ref __task_end, so a new module registers its task without changes of
+     * main.c. */
+#define TASK_REGISTER(prio, evt, fct)	TASK_REGISTER_(prio, evt, fct)
+#define TASK_REGISTER_(prio, evt, fct)					\
+    static const TASK_ENTRY l_Task_##fct					\
+    __attribute__((used, section(".task_table." #prio))) = { 1 << (evt), fct }
+
+/*!@name Priorities of the main loop tasks, i.e. their order in a pass. */
+//@{
+#define TASK_PRIO_COMMAND	100	//!< CheckCommand()
+#define TASK_PRIO_RFID		110	//!< RFID_Check()
+#define TASK_PRIO_DISK		120	//!< DiskCheck(), configuration
+#define TASK_PRIO_BATTERY	130	//!< BatteryCheck()
+#define TASK_PRIO_MEM_MONITOR	135	//!< MemMonitorCheck()
+#define TASK_PRIO_AUDIO		140	//!< AudioCheck()
+#define TASK_PRIO_LOG		150	//!< LogFlushCheck()
+#define TASK_PRIO_STATS		170	//!< VisitStatsCheck()
+#define TASK_PRIO_FORECAST	180	//!< ForecastCheck()
+#define TASK_PRIO_TEMP_COMP	200	//!< TempCompCheck()
+#define TASK_PRIO_DCF77		210	//!< DCF77Check()
+//@}
+
+#ifndef TASK_SCHED
+    /*!@brief Set 1 to call the tasks of the main loop by a priority scheduler,
+     * which always selects the pending task of the highest priority, also
+     * for events posted during the pass, see TaskSchedule() in main.c.  If
+     * 0, the tasks pending at the start of a pass are called in one sweep.
+     */
+    #define TASK_SCHED		0
+#endif
+
+    /*! Atomic access to a single flag of a flag word in SRAM, for flags which
+     * are shared between interrupt and main context.  The bit is accessed via
+     * bit-band, so neither a read-modify-write sequence nor a critical
+     * section is required.  See also FlagTestClr(). */
+#define FLAG_SET(word, bit)	do { Bit(word, bit) = 1; } while (0)
+#define FLAG_CLR(word, bit)	do { Bit(word, bit) = 0; } while (0)
+#define FLAG_TEST(word, bit)	(Bit(word, bit) != 0)
+
+/*!@brief Set this define 1 to measure the time spent in EM0, EM1, and EM2,
+ * and which module of @ref EM1_MODULES keeps the system in EM1.
+ */
+#define EM_PROFILE		1
+
+/*!@brief Interval in [s] for logging the energy mode profile, at most 36h,
+ * since the ticks are accumulated in 32 bits. */
+#define EM_PROFILE_INTERVAL	(6 * 3600)	// every 6h
+
+#if EM_PROFILE  &&  (EM_PROFILE_INTERVAL < 1  ||  EM_PROFILE_INTERVAL > 36 * 3600)
+    #error "EM_PROFILE_INTERVAL must be 1s to 36h"
+#endif
+
+/*!@brief Set this define 1 to initialize the RFID reader and the Audio module
+ * right after the configuration has been read, and to defer the MCU and
+ * battery information, the battery probe, and the free disk space until the
+ * main loop is idle, see BootDone() in main.c.
+ */
+#define FAST_BOOT		1
+
+/*!@brief Set this define 1 to measure the CPU cycles of the interrupt
+ * service routines, see module IsrProfile.c.  This enables the trace unit of
+ * the core, so it is disabled for field use.
+ */
+#define ISR_PROFILE		0
+
+#ifdef BENCH
+    /* The micro-benchmark image measures with the cycle counter, see bench.c */
+    #undef  ISR_PROFILE
+    #define ISR_PROFILE		1
+#endif
+
+#ifndef ITM_TRACE
+    /*!@brief Set this define 1 to stream binary records of the interrupts,
+     * tasks, state transitions, and queues via SWO, see module ItmTrace.c.
+     * This uses the trace unit of the core and pin PF2, it is for the lab.
+     */
+    #define ITM_TRACE		0
+#endif
+
+/*!@brief Set this define 1 to execute the alarm clock, the timers, and the
+ * handlers of the light barriers and DCF77 in the PendSV handler, i.e. after
+ * the interrupt service routines, see Defer.c.
+ */
+#define DEFER_WORK		1
+
+/*!@brief Track the stack high-water marks and the heap usage, see
+ * MemMonitor.c.  If MEM_ISR_STACK_SIZE is not 0, this also moves the
+ * interrupt service routines to a separate stack of this size.
+ */
+#define MEM_MONITOR		1
+
+#ifdef SIMULATION
+    /* The host simulation has no separate stack for interrupts */
+    #undef  MEM_MONITOR
+    #define MEM_MONITOR		0
+#endif
+
+/*!@brief Execute the timing-critical interrupt paths from RAM, so they do not
+ * depend on the flash wait states at 32MHz.  These functions are marked with
+ * @ref RAMFUNC, the linker script puts them into the initialized data, which
+ * is copied to RAM by the startup code.  The RAM they use is reported when
+ * the image is linked, see armgcc/Makefile.  Only short functions qualify,
+ * i.e. the byte loop of the SPI transfer, since each byte of code costs a
+ * byte of RAM.
+ */
+#define RAM_FUNCTIONS		1
+
+#ifdef SIMULATION
+    /* The host simulation executes all code from the same memory */
+    #undef  RAM_FUNCTIONS
+    #define RAM_FUNCTIONS	0
+#endif
+
+#if RAM_FUNCTIONS
+    /*! Attribute to execute a function from RAM, see @ref RAM_FUNCTIONS.
+     *  Calls between flash and RAM get long branch veneers by the linker. */
+    #define RAMFUNC	__attribute__ ((section(".ramfunc"), noinline))
+#else
+    #define RAMFUNC
+#endif
+
+/*!@brief Binary telemetry protocol on the LEUART console, see Telemetry.c */
+#define TELEMETRY		1
+
+/*!@brief Read access to the files on the SD-Card via telemetry requests */
+#define TLM_FILE_EXPORT		1
+
+/*!@brief Per-ID visit statistics, written once a day, see VisitStats.c */
+#define VISIT_STATS		1
+
+/*!@brief Binary record of each visit, appended by LogFlush(), see VisitStats.c */
+#define VISIT_RECORDS		1
+
+/*!@brief Daily forecast of the storage and battery runway, see Forecast.c */
+#define FORECAST		1
+
+/*!@brief Temperature compensation of the LFXO, see TempComp.c */
+#define TEMP_COMP		1
+
+/*!@brief Staggered power-up at the begin of a power window, see PowerSeq.c */
+#define PWR_SEQ			1
+
+/*!@brief Light barrier occupancy timeline, see LightBarrier.c */
+#define LB_TIMELINE		1
+
+/*!@brief Watchdog supervision, and the system clock is restored after a
+ * warm reset, see WarmStart.c */
+#define WARM_START		1
+
+/*!@brief Records are gated by a sound-activity detector, see SoundDetect.c */
+#define SOUND_DETECT		1
+
+/*!@brief Battery status by the ADC if no battery controller is connected,
+ * see SupplyMon.c */
+#define SUPPLY_MON		1
+
+/*!@brief Playbacks per transponder ID are limited by a token bucket, see
+ * Throttle.c */
+#define PLAY_THROTTLE		1
+
 /*!@brief Enumeration of Error Bits
  *
  * This is the list of error sources, i.e. these enums identify sources for
@@ -272,8 +882,10 @@ typedef enum
 
 /*======================== External Data and Routines ========================*/
 
-extern volatile bool	 g_flgIRQ;		// Flag: Interrupt occurred
 extern volatile uint16_t g_EM1_ModuleMask;	// Modules that require EM1
+extern volatile uint16_t g_EventMask;		// Pending main loop tasks
+extern const TASK_ENTRY __task_start[];		// Task table, see TASK_REGISTER()
+extern const TASK_ENTRY __task_end[];
 
 /*================================ Prototypes ================================*/
 
@@ -283,5 +895,13 @@ void	SetError (ERR_SRC errorSource);
     /* Clear source of a system error */
 void	ClearError (ERR_SRC errorSource);
 
+    /* Test and clear a flag of a flag word, see FLAG_SET() */
+bool	FlagTestClr (volatile uint32_t *pWord, int bit);
+
+#ifdef BENCH
+    /* Run the micro-benchmark of the drivers, see bench.c */
+void	BenchRun (void);
+#endif
+
 
 #endif /* __INC_config_h */
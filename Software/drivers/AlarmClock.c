@@ -2,17 +2,35 @@
  * @file
  * @brief	Alarm Clock Module
  * @author	Ralf Gerhauser
- * @version	2020-05-12
+ * @version	2026-10-15
  *
  * This module implements an Alarm Clock.  It uses the Real Time Counter (RTC)
  * for this purpose.  The main features are:
- * - Base clock (1 second) for counting date and time.
+ * - Base clock (1 second) for counting date and time.  If @ref RTC_TICKLESS
+ *   is enabled, the RTC interrupt does not occur every second, but only for
+ *   the next deadline, i.e. the next sTimer expiry or alarm time.  Then
+ *   @ref g_CurrDateTime is updated on demand, see ClockGet().
  * - Up to @ref MAX_SEC_TIMERS software timers with callback functionality
- *   and a granularity of one second.
- * - One high-resolution timer for short time measurements, e.g. timeout or
- *   autorepeat features for keys (push buttons).
+ *   and a granularity of one second.  Running timers are kept in a delta
+ *   list, sorted by expiration time, so the RTC interrupt only decrements
+ *   the first entry.  Periodic tasks may use sTimerStartSlack() to join the
+ *   wake-up of another timer, if it is within their tolerance.
+ * - Up to @ref MAX_MS_TIMERS high-resolution software timers with callback
+ *   functionality and a granularity of one millisecond, e.g. for timeouts,
+ *   autorepeat features for keys (push buttons), or exact playback durations.
+ *   They share the RTC compare register COMP1, which is always programmed
+ *   for the timer that expires next.
  * - Up to @ref MAX_ALARMS alarm times with callback functionality and a
- *   granularity of one minute (repeated after 24h).
+ *   granularity of one minute (repeated after 24h).  The next alarm time
+ *   is calculated in advance, so the alarm list is only scanned if an
+ *   alarm is due, or the alarm settings or the time have been changed.
+ * - A monotonic 64 bit clock in RTC ticks or milliseconds since the start
+ *   of the RTC, which is not affected by ClockSet(), see ClockMonoTicks().
+ *   It may be read from any context without disabling interrupts.
+ * - A power schedule of @ref NUM_POWER_ALARMS ON/OFF windows, each valid on
+ *   the weekdays of @ref g_PowerWeekdays.  The windows are compiled into a
+ *   sorted list of intervals, so PowerScheduleIsOn() determines the state
+ *   by a binary search.
  *
  * @note
  * The index for specifying a dedicated alarm time (i.e. the <b>alarmNum</b>
@@ -32,6 +50,50 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	The table g_WeekdayName is constant, i.e. kept in flash.
+2026-10-15,agnt	Added ClockSlew() to absorb a small correction over several
+		minutes, instead of stepping the time base.
+2026-10-15,agnt	RTC_BottomHalf: Decrement the sTimers before the alarms are
+		processed, otherwise a timer started by an alarm function
+		refers to the outdated counters, and expires too early.
+2026-10-15,agnt	Added sTimerStartSlack(): the timer expires together with an
+		already running timer, if its expiry is within the specified
+		slack, so periodic tasks share their wake-ups.
+2026-10-15,agnt	Added ClockGetTicks() to compare the system clock with an
+		external time reference to a fraction of a millisecond.
+2026-10-15,agnt	Added ClockAdjust() to advance or retard the time base by some
+		RTC ticks, e.g. for the temperature compensation of the LFXO.
+		ClockGetMilliSec considers the tick offset of clock.c.
+2026-10-15,agnt	msDelay() sleeps in EM2, or EM1 if a module requires it, until
+		the msTimer <l_thDelay> expires.  It only spins in interrupt
+		context, with interrupts disabled, or before AlarmClockInit().
+2026-10-15,agnt	Added the monotonic clock ClockMonoTicks(), ClockMonoMs(), and
+		ClockMonoStamp().  RTC_IRQHandler and ClockSet() maintain its
+		base, ClockSet() also discards a pending overflow of the old
+		counter.  msDelayStart(), msDelayIsDone(), and msDelay() use the
+		monotonic clock, so a delay is not disturbed by ClockSet().
+2026-10-15,agnt	RTC_IRQHandler only clears the interrupt flags, the alarms and
+		timers are processed by RTC_BottomHalf() via DeferCall().
+2026-10-14,agnt	Power Schedule: The ON and OFF times of all NUM_POWER_ALARMS
+		windows, restricted to the days of g_PowerWeekdays, are
+		compiled into a sorted list of disjoint intervals within the
+		week, see PowerScheduleCompile().  CheckAlarmTimes() and the
+		power alarms only look up the current state there, see
+		PowerScheduleIsOn().
+2026-10-14,agnt	CheckAlarmTimes: Log message is a debug message, see
+		LOG_LEVEL_ALARM.
+2026-10-14,agnt	Added tickless mode RTC_TICKLESS: COMP0 is programmed for the
+		next sTimer expiry or alarm time, <g_CurrDateTime> is updated
+		on demand by ClockGet(), ClockGetMilliSec(), and the RTC IRQ.
+		ClockSet: Call CheckAlarmTimes() after the clock has been set.
+		ClockRefresh: Advance <g_CurrDateTime> incrementally, call
+		localtime() only when crossing midnight or after ClockSet().
+2026-10-14,agnt	Running sTimers are kept in a delta list, RTC_IRQHandler only
+		decrements the first entry.  The alarm list is only scanned
+		when the precomputed next alarm time <l_NextAlarmTime> is due.
+2026-10-14,agnt	Replaced the single high-resolution timer by up to MAX_MS_TIMERS
+		msTimers with handles, see msTimerCreate().  COMP1 is always
+		set to the next deadline, durations above 512s are supported.
 2020-06-20,rage	CheckAlarmTimes: Also consider to switch off power outputs.
 2020-05-12,rage	Implemented CheckAlarmTimes() to call the respective alarm
 		action if the current time matches the alarm time.
@@ -64,15 +126,45 @@ Revision History:
 #include "em_device.h"
 #include "em_assert.h"
 #include "em_bitband.h"
+#include "em_emu.h"
 #include "em_int.h"
 #include "AlarmClock.h"
+#include "Defer.h"
+#include "IsrProfile.h"
 #include "Logging.h"
 
 /*=============================== Definitions ================================*/
 
+    // Module Log Level
+#ifndef LOG_LEVEL_ALARM
+    #define LOG_LEVEL_ALARM	LOG_LEVEL
+#endif
+#undef  LOG_MODULE_LEVEL
+#define LOG_MODULE_LEVEL	LOG_LEVEL_ALARM
+
 /*!@brief Calculate maximum value to prevent overflow of a 32bit register. */
 #define MAX_VALUE_FOR_32BIT	(0xFFFFFFFFUL / RTC_COUNTS_PER_SEC)
 
+/*!@brief Maximum distance of COMP1 in RTC ticks, must be below the 24bit
+ * wrap-around of the RTC counter, i.e. 256s.  Longer msTimer durations are
+ * split into several COMP1 intervals.
+ */
+#define MS_TIMER_MAX_TICKS	0x800000UL
+
+/*!@brief Minimum distance of COMP1 in RTC ticks to be sure the compare value
+ * has been synchronized into the low frequency domain before it matches.
+ */
+#define MS_TIMER_MIN_TICKS	3
+
+/*!@brief Maximum number of seconds between two COMP0 interrupts in tickless
+ * mode.  This must be below the 24bit wrap-around of the RTC counter (512s).
+ */
+#define TICKLESS_MAX_SECS	256
+
+/*!@brief Minimum distance of COMP0 in RTC ticks, see @ref MS_TIMER_MIN_TICKS.
+ */
+#define TICKLESS_MIN_TICKS	3
+
 /*=========================== Typedefs and Structs ===========================*/
 
 /*!@brief Alarm entry.
@@ -91,13 +183,29 @@ typedef struct
 
 /*!
  * @brief Structure for a one-second timer.
+ *
+ * Running timers are linked into a delta list, starting with
+ * @ref l_sTimerHead.  The <b>Counter</b> of each entry holds the number of
+ * seconds relative to its predecessor, i.e. the remaining time of a timer
+ * is the sum of all counters up to and including its own entry.
  */
 typedef struct
 {
-    uint32_t  Counter;		//!< Time counter (number of remaining seconds).
+    uint32_t  Counter;		//!< Seconds relative to the previous timer
     TIMER_FCT Function;		//!< Function to be called when timer expires
+    TIM_HDL   Next;		//!< Next timer in the delta list, or NONE
+    bool      Running;		//!< Timer is linked into the delta list
 } SEC_TIMER;
 
+/*!
+ * @brief Structure for a millisecond timer.
+ */
+typedef struct
+{
+    uint32_t  Remain;		//!< Remaining RTC ticks, see @ref l_msTimerBase
+    TIMER_FCT Function;		//!< Function to be called when timer expires
+} MS_TIMER;
+
 /*================================ Global Data ===============================*/
 
 /*!@brief Current date and time structure. */
@@ -117,8 +225,45 @@ volatile bool	 g_isdst;
  */
 volatile time_t	 g_PowerUpTime;
 
+/*!@brief Weekdays of the power windows, set by WEEKDAYS_1 to WEEKDAYS_5.
+ * Bit n enables the window on weekday n, i.e. <b>tm_wday</b>, where 0 is
+ * Sunday.  A window that passes midnight belongs to the day it starts.
+ */
+int32_t		 g_PowerWeekdays[NUM_POWER_ALARMS];
+
+/*!@brief Names of the weekdays, the index is the <b>tm_wday</b> value. */
+const char * const g_WeekdayName[7] =
+{ "SU", "MO", "TU", "WE", "TH", "FR", "SA" };
+
 /*================================ Local Data ================================*/
 
+/*!@brief Interval of the power schedule in minutes since Sunday 00:00. */
+typedef struct
+{
+    uint16_t	Start;		//!< first minute of the interval
+    uint16_t	End;		//!< first minute after the interval
+} SCHED_INTERVAL;
+
+/*!@brief Number of minutes per day and per week. */
+//@{
+#define MIN_PER_DAY	(24 * 60)
+#define MIN_PER_WEEK	(7 * MIN_PER_DAY)
+//@}
+
+/*!@brief Maximum number of intervals: each window on all 7 days, plus one
+ * that is split at the end of the week.
+ */
+#define SCHED_MAX_INTERVALS	(NUM_POWER_ALARMS * 8)
+
+/*!@brief Sorted list of the disjoint ON intervals of the power schedule. */
+static SCHED_INTERVAL l_Sched[SCHED_MAX_INTERVALS];
+
+/*!@brief Number of entries in @ref l_Sched. */
+static uint8_t	      l_SchedCnt;
+
+/*!@brief Flag to recompile @ref l_Sched, see PowerScheduleCompile(). */
+static volatile bool  l_flgSchedUpdate = true;
+
 /*!@brief List of alarm times. */
 static volatile ALARM l_Alarm[MAX_ALARMS];
 
@@ -128,12 +273,100 @@ static volatile SEC_TIMER l_sTimer[MAX_SEC_TIMERS];
 /*!@brief Maximum handle, currently in use. */
 static volatile int   l_MaxHdl;
 
-/*!@brief Function to call when high-resolution timer expires. */
-static void  (*l_msTimerFunction) (void);
+/*!@brief First entry of the sTimer delta list, i.e. the next to expire. */
+static volatile TIM_HDL l_sTimerHead = NONE;
+
+/*!@brief Next alarm time in minutes since midnight, or NONE if no alarm is
+ * enabled.  It is recalculated when an alarm has been processed, and if
+ * @ref l_flgAlarmUpdate is set.
+ */
+static volatile int16_t l_NextAlarmTime = NONE;
+
+/*!@brief Flag to recalculate @ref l_NextAlarmTime, set whenever an alarm
+ * or the system time has been changed.
+ */
+static volatile bool  l_flgAlarmUpdate = true;
+
+/*!@brief UNIX time of the contents of @ref g_CurrDateTime, or -1 if it must
+ * be recalculated by localtime().
+ */
+static time_t	      l_CurrTime = (time_t)(-1);
+
+#if RTC_TICKLESS
+/*!@brief RTC counter value of the last processed COMP0 interrupt.  The
+ * counters of the sTimer delta list refer to this value.
+ */
+static volatile uint32_t l_TickBase;
+
+/*!@brief Number of seconds after @ref l_TickBase COMP0 has been set to, or 0
+ * while the RTC interrupt handler is processing the COMP0 interrupt.
+ */
+static volatile uint32_t l_TickSecs;
+#endif
+
+/*!@brief List of millisecond timers. */
+static volatile MS_TIMER l_msTimer[MAX_MS_TIMERS];
+
+/*!@brief Maximum msTimer handle, currently in use. */
+static volatile int   l_msMaxHdl;
+
+/*!@brief Bit mask of the msTimers which are currently running. */
+static volatile uint32_t l_msActive;
+
+/*!@brief RTC counter value the <b>Remain</b> ticks of all msTimers refer to. */
+static volatile uint32_t l_msTimerBase;
+
+/*!@brief msTimer handle for msDelay(), see DelayExpired(). */
+static volatile TIM_HDL l_thDelay = NONE;
+
+/*!@brief Flag that the duration of msDelay() is over. */
+static volatile bool  l_flgDelayDone;
 
 /*!@brief Function to call for a display update. */
 static void  (*l_DisplayUpdateFct) (void);
 
+/*!@brief RTC interrupt flags COMP0 and COMP1 which have been cleared by
+ * RTC_IRQHandler(), but not processed by RTC_BottomHalf() yet.
+ */
+static volatile uint32_t l_RtcPending;
+
+/*!@brief Number of seconds of the COMP0 interrupts in @ref l_RtcPending. */
+static volatile uint32_t l_RtcElapsed;
+
+/*!@brief Ticks of the monotonic clock at RTC counter value 0, see
+ * ClockMonoTicks().  It is advanced by RTC_IRQHandler() for each overflow,
+ * and by ClockSet() when the counter is restarted.
+ */
+static volatile uint64_t l_MonoBase;
+
+/*!@brief Sequence number of @ref l_MonoBase, it is incremented by 2 with
+ * each update.  An odd value means that ClockSet() has stopped the RTC, and
+ * the monotonic clock is frozen at @ref l_MonoFrozen.
+ */
+static volatile uint32_t l_MonoSeq;
+
+/*!@brief Value of the monotonic clock while the RTC is stopped. */
+static volatile uint64_t l_MonoFrozen;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	RTC_BottomHalf (uint32_t arg1, uint32_t arg2);
+static void	msTimerAdvance (void);
+static void	msTimerSchedule (void);
+static void	sTimerUnlink (TIM_HDL hdl);
+static int16_t	AlarmNextTime (int time);
+static void	AlarmUpdate (void);
+static void	PowerScheduleCompile (void);
+static void	PowerScheduleAdd (int start, int end);
+static void	ClockRefresh (void);
+static uint64_t	MonoRead (uint32_t *pCnt);
+static void	DelayExpired (TIM_HDL hdl);
+#if RTC_TICKLESS
+static void	TickSet (uint32_t secs);
+static void	TickSchedule (void);
+static void	TickWakeUp (uint32_t secs);
+#endif
+
 
 /***************************************************************************//**
  *
@@ -166,11 +399,19 @@ void	AlarmClockInit (void)
     /* Initialize the RTC */
     RTC_Init (&rtcInit);
 
+#if RTC_TICKLESS
+    /* First COMP0 interrupt after one second, then for the next deadline */
+    RTC_CompareSet (0, RTC_COUNTS_PER_SEC);
+    l_TickBase = 0;
+    l_TickSecs = 1;
+#endif
+
     /*
      * We use all 3 interrupts:
      *   Overflow - to count above 24bit
-     *   COMP0    - for the 1s base clock and the software timers
-     *   COMP1    - for the high-resolution timer (will be enabled on request)
+     *   COMP0    - for the 1s base clock (or the next deadline in tickless
+     *              mode) and the software timers
+     *   COMP1    - for the msTimers (will be enabled on request)
      */
     RTC_IntEnable (RTC_IEN_COMP0 | RTC_IEN_OF);
 
@@ -181,6 +422,9 @@ void	AlarmClockInit (void)
     NVIC_SetPriority(RTC_IRQn, INT_PRIO_RTC);
     NVIC_ClearPendingIRQ(RTC_IRQn);
     NVIC_EnableIRQ(RTC_IRQn);
+
+    /* msTimer to wake up the CPU from msDelay() */
+    l_thDelay = msTimerCreate (DelayExpired);
 }
 
 /***************************************************************************//**
@@ -193,24 +437,25 @@ void	AlarmClockInit (void)
  *   so a variable needs to be incremented that holds the higher bits.
  *   With a clock frequency of 32.768Hz this happens every 512s (8.5min).
  * - <b>COMP0</b> is used for the 1s base clock and the software timers, and
- *   every minute all alarm times are compared to the current time.
- * - <b>COMP1</b> is used as a high-resolution timer, see @ref msTimerStart().
- *   It may be used as autorepeat timer for the keys, for example.
+ *   every minute the next alarm time is compared to the current time.  In
+ *   tickless mode (@ref RTC_TICKLESS) COMP0 is set to the next deadline only,
+ *   i.e. the next sTimer expiry or alarm time, see TickSchedule().
+ * - <b>COMP1</b> is used for the high-resolution timers, see @ref msTimerStart().
+ *   It is set to the next deadline of all running msTimers.
+ *
+ * This handler is the top half: it only handles the overflow, clears the
+ * flags of COMP0 and COMP1, and defers all further work to RTC_BottomHalf(),
+ * see DeferCall().
  *
  ******************************************************************************/
 void	RTC_IRQHandler (void)
 {
-static int8_t	processed_min = (-1);	// already processed minute
 uint32_t	status;			// interrupt status flags
-int		i;			// index variable
+uint32_t	elapsed;		// number of elapsed seconds
+bool		flgQueue;		// bottom half must be queued
 
     DEBUG_TRACE(0x01);
-    /*
-     * Measured execution times:
-     * - 130us for COMP0 interrupt (1s) without sTimer and alarms.
-     * - 150us for COMP0 interrupt (1s) without sTimer, but checking
-     *   all MAX_ALARMS (no execution of any alarm functions).
-     */
+    ISR_PROF_ENTER();
 
     /* get interrupt status and mask out disabled IRQs */
     status  = RTC->IF;
@@ -219,83 +464,230 @@ int		i;			// index variable
     /* First of all check for OverFlow interrupt and increase high counter */
     if (status & RTC_IF_OF)
     {
+	INT_Disable();
 	clockOverflow();		// see clock.c
+	l_MonoBase += 0x1000000;	// 24bit wrap-around
+	l_MonoSeq  += 2;
 	RTC->IFC = RTC_IFC_OF;
+	INT_Enable();
     }
 
-    /* Check for COMP0 interrupt which occurs every second */
+    /* Check for COMP0 interrupt which occurs every second or for a deadline */
     if (status & RTC_IF_COMP0)
     {
+#if RTC_TICKLESS
+	/* COMP0 has been set <l_TickSecs> seconds after <l_TickBase> */
+	INT_Disable();
+	elapsed = l_TickSecs;
+	l_TickSecs = 0;			// TickSchedule() is pending
+	l_TickBase = RTC->COMP0;
+	INT_Enable();
+#else
 	/* Generate next COMP0 interrupt after another second */
 	RTC_CompareSet (0, (RTC->COMP0 + RTC_COUNTS_PER_SEC) & 0xFFFFFF);
+	elapsed = 1;
+#endif
 	RTC->IFC = RTC_IFC_COMP0;
+	l_RtcElapsed += elapsed;
+    }
+
+    /* Check for COMP1 interrupt (high-resolution timers) */
+    if (status & RTC_IF_COMP1)
+	RTC->IFC = RTC_IFC_COMP1;
+
+    /* Queue the bottom half, unless it is already pending */
+    status &= (RTC_IF_COMP0 | RTC_IF_COMP1);
+    if (status)
+    {
+	INT_Disable();
+	flgQueue = (l_RtcPending == 0);
+	l_RtcPending |= status;
+	INT_Enable();
+
+	if (flgQueue  &&  ! DeferCall (RTC_BottomHalf, 0, 0))
+	    RTC_BottomHalf (0, 0);	// queue is full, do the work here
+    }
+    ISR_PROF_EXIT(ISR_PROF_RTC);
+    DEBUG_TRACE(0x81);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Bottom Half of the RTC Interrupt
+ *
+ * This routine is queued by RTC_IRQHandler() via DeferCall().  It processes
+ * all COMP0 and COMP1 interrupts since its last call:
+ * - For COMP0, the date and time is updated, the alarm times are checked,
+ *   and the sTimers are advanced by the elapsed seconds.  The functions of
+ *   alarms and expired sTimers are called.
+ * - For COMP1, the functions of all expired msTimers are called, and COMP1
+ *   is set to the next deadline.
+ *
+ * Measured execution times of the COMP0 part: 130us (1s) without sTimer and
+ * alarms, 150us when checking all MAX_ALARMS.  Alarms are now only checked if
+ * <l_NextAlarmTime> is due, and only the first entry of the sTimer delta list
+ * is decremented.
+ *
+ * @param[in] arg1
+ *	Not used.
+ *
+ * @param[in] arg2
+ *	Not used.
+ *
+ ******************************************************************************/
+static void	RTC_BottomHalf (uint32_t arg1, uint32_t arg2)
+{
+static int8_t	processed_min = (-1);	// already processed minute
+uint32_t	status;			// pending interrupt flags
+int		i;			// index variable
+int		time;			// current time in minutes
+uint32_t	elapsed;		// number of elapsed seconds
+TIM_HDL		hdl;			// timer handle
+
+    (void) arg1;  (void) arg2;	// suppress compiler warning "unused parameter"
+
+    /* take the pending interrupts, a new one queues another call */
+    INT_Disable();
+    status  = l_RtcPending;
+    elapsed = l_RtcElapsed;
+    l_RtcPending = 0;
+    l_RtcElapsed = 0;
+    INT_Enable();
+
+    if (status & RTC_IF_COMP0)
+    {
+	/*
+	 * Only the first timers of the delta list need to be decremented.
+	 * This is done before the alarms are processed, since an alarm
+	 * function may start a timer relative to the current time.
+	 */
+	INT_Disable();
+	for (hdl = l_sTimerHead;  hdl != NONE  &&  elapsed > 0;
+	     hdl = l_sTimer[hdl].Next)
+	{
+	    if (l_sTimer[hdl].Counter >= elapsed)
+	    {
+		l_sTimer[hdl].Counter -= elapsed;
+		elapsed = 0;
+	    }
+	    else
+	    {
+		elapsed -= l_sTimer[hdl].Counter;
+		l_sTimer[hdl].Counter = 0;
+	    }
+	}
+	INT_Enable();
 
 	/*
 	 * Get current UNIX time, convert to <tm>, and store in global struct
-	 * <g_CurrDateTime>.  This requires about 100us which is quite long
-	 * for an interrupt routine.  Nevertheless we need this information
-	 * for comparing the alarm times below.
+	 * <g_CurrDateTime>.  The complete conversion requires about 100us,
+	 * but is only done once a day, otherwise the time elements are just
+	 * advanced.  We need this information for comparing the alarm times.
 	 */
 	ClockUpdate (true);
 
-	/* compare all alarm times for every minute */
+	time = g_CurrDateTime.tm_hour * 60 + g_CurrDateTime.tm_min;
+
+	/* alarms or time have been changed, find the next alarm */
+	if (l_flgAlarmUpdate)
+	{
+	    l_flgAlarmUpdate = false;
+
+	    /* current minute may already have been processed */
+	    l_NextAlarmTime = AlarmNextTime (processed_min
+				== g_CurrDateTime.tm_min ? time + 1 : time);
+	}
+
+	/* check alarm times once every minute */
 	if (processed_min != g_CurrDateTime.tm_min)
 	{
 	    processed_min = g_CurrDateTime.tm_min;
 
-	    for (i = 0;  i < MAX_ALARMS;  i++)
+	    /* only compare all alarm times if one of them is due */
+	    if (l_NextAlarmTime == time)
 	    {
-		/* we compare hours and minutes only */
-		if (l_Alarm[i].Enabled
-		&&  l_Alarm[i].Minute == g_CurrDateTime.tm_min
-		&&  (l_Alarm[i].Hour  == NONE	// repeat every hour
-		  || l_Alarm[i].Hour  == g_CurrDateTime.tm_hour))
+		for (i = 0;  i < MAX_ALARMS;  i++)
 		{
-		    /* reached alarm time, call the specified function */
-		    if (l_Alarm[i].Function)
-			l_Alarm[i].Function (i);
+		    /* we compare hours and minutes only */
+		    if (l_Alarm[i].Enabled
+		    &&  l_Alarm[i].Minute == g_CurrDateTime.tm_min
+		    &&  (l_Alarm[i].Hour  == NONE	// repeat every hour
+		      || l_Alarm[i].Hour  == g_CurrDateTime.tm_hour))
+		    {
+			/* reached alarm time, call the specified function */
+			if (l_Alarm[i].Function)
+			    l_Alarm[i].Function (i);
+		    }
 		}
+
+		/* alarm time has been processed, find the next one */
+		l_NextAlarmTime = AlarmNextTime (time + 1);
 	    }
 	}
 
-	/* decrement software timers and call functions if reaching 0 */
-	for (i = 0;  i <= l_MaxHdl;  i++)
+	/* remove expired timers from the list and call their functions */
+	INT_Disable();
+	while (l_sTimerHead != NONE  &&  l_sTimer[l_sTimerHead].Counter == 0)
 	{
-	    if (l_sTimer[i].Counter)
-	    {
-		/* only decrement if not already 0 */
-		if (--(l_sTimer[i].Counter) == 0)
-		{
-		    /* if reaching 0, call the specified function */
-		    if (l_sTimer[i].Function)
-			l_sTimer[i].Function (i);
-		}
-	    }
+	    hdl = l_sTimerHead;
+	    l_sTimerHead = l_sTimer[hdl].Next;
+	    l_sTimer[hdl].Running = false;
+	    INT_Enable();
+
+	    /* function may restart this timer */
+	    if (l_sTimer[hdl].Function)
+		l_sTimer[hdl].Function (hdl);
+
+	    INT_Disable();
 	}
+	INT_Enable();
+
+#if RTC_TICKLESS
+	/* Set COMP0 to the next deadline */
+	TickSchedule();
+#endif
     }	// if (status & RTC_IF_COMP0)
 
-    /* Check for COMP1 interrupt (high-resolution timer) */
+    /* COMP1 interrupt (high-resolution timers) */
     if (status & RTC_IF_COMP1)
     {
-	/* disable and clear COMP1 interrupt */
-	BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 0);
-	RTC->IFC = RTC_IFC_COMP1;
+	/* update remaining ticks, expired timers are set to 0 */
+	INT_Disable();
+	msTimerAdvance();
+
+	/* call the specified function of all expired timers */
+	for (i = 0;  i <= l_msMaxHdl;  i++)
+	{
+	    if ((l_msActive & (1UL << i))  &&  l_msTimer[i].Remain == 0)
+	    {
+		l_msActive &= ~(1UL << i);
+		INT_Enable();
+
+		/* function may restart this timer */
+		if (l_msTimer[i].Function)
+		    l_msTimer[i].Function (i);
+
+		INT_Disable();
+	    }
+	}
 
-	/* call the specified function */
-	if (l_msTimerFunction)
-	    l_msTimerFunction();
+	/* set COMP1 to the next deadline, or disable it */
+	msTimerAdvance();
+	msTimerSchedule();
+	INT_Enable();
     }
-    DEBUG_TRACE(0x81);
 }
 
 /***************************************************************************//**
  *
  * @brief	Check Alarm Times if actions are required
  *
- * This routine checks ON_TIME_1~5 and OFF_TIME_1~5 if the current time
- * satisfies to turn devices on or off.  It must be called <b>after</b> a new
+ * This routine checks the power schedule, i.e. ON_TIME_1~5 and OFF_TIME_1~5
+ * together with WEEKDAYS_1~5, if the current time satisfies to turn devices
+ * on or off, and calls the action of @ref ALARM_ON_TIME_1, or
+ * @ref ALARM_OFF_TIME_1 respectively.  It must be called <b>after</b> a new
  * configuration has been loaded and all initialization routines have been
- * executed.
+ * executed.  The schedule is compiled again at this point.
  *
  * @note
  * The initial state for all alarm times is OFF.  This is true after booting,
@@ -304,76 +696,220 @@ int		i;			// index variable
  ******************************************************************************/
 void	CheckAlarmTimes (void)
 {
-int	i, alarm_on, alarm_off;
-int	time, on_time, off_time;	// time in minutes
-int8_t	on_hour, on_min, off_hour, off_min;
+int	i, alarmNum;
+int32_t	next;			// minute of the week of the next change
+bool	flgOn;
 
     /* Initial DCF77 time synchronisation is required */
     if (g_PowerUpTime == 0)
 	return;		// no valid time set yet, abort
-         
-    /* Get current time */
-    time = g_CurrDateTime.tm_hour * 60 + g_CurrDateTime.tm_min;
+
+    /* See if a power window is enabled at all */
+    for (i = 0;  i < NUM_POWER_ALARMS;  i++)
+	if (AlarmIsEnabled(ALARM_ON_TIME_1 + i))
+	    break;
+
+    if (i >= NUM_POWER_ALARMS)
+	return;		// no power alarms, nothing to do
+
+    /* Configuration or time may have changed - compile the schedule again */
+    l_flgSchedUpdate = true;
+    flgOn = PowerScheduleIsOn (&next);
+
+    LOG_DBG ("Checking alarm times against current time %s %02d:%02d",
+	     g_WeekdayName[Y2K38_WDAY(g_CurrDateTime.tm_wday)],
+	     g_CurrDateTime.tm_hour, g_CurrDateTime.tm_min);
+
 #ifdef LOGGING
-    Log ("Checking alarm times against current time %02d:%02d",
-	 g_CurrDateTime.tm_hour, g_CurrDateTime.tm_min);
-#endif    
-    
-    
-    /* Check all power-related alarms */
+    if (next < 0)
+	Log ("- Power Schedule (%d intervals) is %s", l_SchedCnt,
+	     flgOn ? "ON":"off");
+    else
+	Log ("- Power Schedule (%d intervals) is %s until %s %02d:%02d",
+	     l_SchedCnt, flgOn ? "ON":"off", g_WeekdayName[next / MIN_PER_DAY],
+	     (int)(next % MIN_PER_DAY) / 60, (int)(next % 60));
+#endif
+
+    /* Call the action for the current state */
+    alarmNum = (flgOn ? ALARM_ON_TIME_1 : ALARM_OFF_TIME_1);
+    if (l_Alarm[alarmNum].Function != NULL)
+	l_Alarm[alarmNum].Function (alarmNum);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Get the State of the Power Schedule
+ *
+ * This routine determines whether the current time is within one of the ON
+ * windows of the power schedule.  It looks up the current minute of the week
+ * in @ref l_Sched by a binary search.  If the schedule has been changed, it
+ * is compiled first.  The routine may be called from interrupt context, e.g.
+ * by the power alarm actions.
+ *
+ * @param[out] pNextChange
+ *	If not NULL, the minute of the week (0 is Sunday 00:00) of the next
+ *	change of the state is stored here, or -1 if the state never changes.
+ *
+ * @return
+ *	The value <i>true</i> if the power outputs should be ON now.
+ *
+ ******************************************************************************/
+bool	PowerScheduleIsOn (int32_t *pNextChange)
+{
+int	time;			// current minute of the week
+int	lo, hi, mid;
+bool	flgOn;
+
+    INT_Disable();
+
+    if (l_flgSchedUpdate)
+    {
+	l_flgSchedUpdate = false;
+	PowerScheduleCompile();
+    }
+
+    ClockRefresh();
+    time = Y2K38_WDAY(g_CurrDateTime.tm_wday) * MIN_PER_DAY
+	 + g_CurrDateTime.tm_hour * 60 + g_CurrDateTime.tm_min;
+
+    /* find the first interval that starts after the current time */
+    for (lo = 0, hi = l_SchedCnt;  lo < hi;  )
+    {
+	mid = (lo + hi) / 2;
+	if (l_Sched[mid].Start <= time)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    /* the interval before may contain the current time */
+    flgOn = (lo > 0  &&  time < l_Sched[lo - 1].End);
+
+    if (pNextChange != NULL)
+    {
+	if (l_SchedCnt == 0
+	||  (l_SchedCnt == 1  &&  l_Sched[0].Start == 0
+	     &&  l_Sched[0].End == MIN_PER_WEEK))
+	    *pNextChange = -1;			// always off, or always on
+	else if (flgOn  &&  l_Sched[lo - 1].End == MIN_PER_WEEK
+		 &&  l_Sched[0].Start == 0)
+	    *pNextChange = l_Sched[0].End;	// continues next week
+	else if (flgOn)
+	    *pNextChange = l_Sched[lo - 1].End % MIN_PER_WEEK;
+	else if (lo < l_SchedCnt)
+	    *pNextChange = l_Sched[lo].Start;
+	else
+	    *pNextChange = l_Sched[0].Start;	// next week
+    }
+
+    INT_Enable();
+
+    return flgOn;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Compile the Power Schedule
+ *
+ * This routine converts the enabled ON/OFF windows into intervals in minutes
+ * since Sunday 00:00, one for each weekday of @ref g_PowerWeekdays.  As in
+ * the former check, an OFF time that is earlier than the ON time ends on the
+ * next day, and a window with equal times is never ON.  The intervals are
+ * sorted, overlapping ones are merged, so @ref l_Sched is a list of disjoint
+ * intervals.  It must be called with interrupts disabled.
+ *
+ ******************************************************************************/
+static void	PowerScheduleCompile (void)
+{
+int	i, j, day;
+int	on_time, off_time;	// time in minutes
+int8_t	hour, min;
+
+    l_SchedCnt = 0;
+
     for (i = 0;  i < NUM_POWER_ALARMS;  i++)
     {
-	alarm_on  = (int)ALARM_ON_TIME_1  + i;
-	alarm_off = (int)ALARM_OFF_TIME_1 + i;
+	if (! l_Alarm[ALARM_ON_TIME_1 + i].Enabled)
+	    continue;		// skip windows which are disabled
 
-	if (AlarmIsEnabled(alarm_on) == false)
-	    continue;		// skip alarms which are disabled
+	AlarmGet (ALARM_ON_TIME_1 + i, &hour, &min);
+	on_time = hour * 60 + min;
+	AlarmGet (ALARM_OFF_TIME_1 + i, &hour, &min);
+	off_time = hour * 60 + min;
 
-	/* Be sure functions have been defined */
-	if ((l_Alarm[alarm_on].Function == NULL)
-	||  (l_Alarm[alarm_off].Function == NULL))
-          continue;		// skip these alarms
-        
-             
-           /* Get alarm times */
-	AlarmGet(alarm_on, &on_hour,  &on_min);
-	on_time = on_hour * 60 + on_min;
-	AlarmGet(alarm_off, &off_hour, &off_min);
-	off_time = off_hour * 60 + off_min;
+	if (off_time == on_time)
+	    continue;		// empty window
 
-	/*
-	 * Consider the case where on-time seems to be later than off-time,
-	 * e.g. 23:15 to 01:30.  Let off-time end 24h later in this case.
-	 */
+	/* e.g. 23:15 to 01:30: let off-time end 24h later */
 	if (off_time < on_time)
+	    off_time += MIN_PER_DAY;
+
+	for (day = 0;  day < 7;  day++)
 	{
-	    off_time += (24 * 60);	// 24h wrap around
+	    if ((g_PowerWeekdays[i] & (1 << day)) == 0)
+		continue;
+
+	    on_time  += day * MIN_PER_DAY;
+	    off_time += day * MIN_PER_DAY;
+
+	    /* a window on Saturday night is split at the end of the week */
+	    if (off_time > MIN_PER_WEEK)
+	    {
+		PowerScheduleAdd (on_time, MIN_PER_WEEK);
+		PowerScheduleAdd (0, off_time - MIN_PER_WEEK);
+	    }
+	    else
+	    {
+		PowerScheduleAdd (on_time, off_time);
+	    }
 
-	    /* This also applies to the current time */
-	    if (time < on_time)
-		time += (24 * 60);
+	    on_time  -= day * MIN_PER_DAY;
+	    off_time -= day * MIN_PER_DAY;
 	}
+    }
 
-	/* See if current time is between on- and off-time */
-	if (on_time <= time  &&  time < off_time)
+    /* merge overlapping and adjacent intervals */
+    for (i = 0, j = 1;  j < l_SchedCnt;  j++)
+    {
+	if (l_Sched[j].Start <= l_Sched[i].End)
 	{
-	    /* Yes, alarm is currently active */
-#ifdef LOGGING
-	    Log ("- Alarm %d (%02d:%02d - %02d:%02d) is ON",
-		 i+1, on_hour, on_min, off_hour, off_min);
-#endif
-	    l_Alarm[alarm_on].Function (alarm_on);
+	    if (l_Sched[j].End > l_Sched[i].End)
+		l_Sched[i].End = l_Sched[j].End;
 	}
 	else
 	{
-	    /* No, alarm is currently inactive */
-#ifdef LOGGING
-	    Log ("- Alarm %d (%02d:%02d - %02d:%02d) is off",
-		 i+1, on_hour, on_min, off_hour, off_min);
-#endif
-	    l_Alarm[alarm_off].Function (alarm_off);
+	    l_Sched[++i] = l_Sched[j];
 	}
-    } // for (i = 0;  i < NUM_POWER_ALARMS;  i++)
+    }
+    if (l_SchedCnt > 0)
+	l_SchedCnt = i + 1;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Add an Interval to the Power Schedule
+ *
+ * This routine inserts an interval into @ref l_Sched, sorted by its start.
+ *
+ * @param[in] start
+ *	First minute of the interval, since Sunday 00:00.
+ *
+ * @param[in] end
+ *	First minute after the interval.
+ *
+ ******************************************************************************/
+static void	PowerScheduleAdd (int start, int end)
+{
+int	i;
+
+    EFM_ASSERT (l_SchedCnt < SCHED_MAX_INTERVALS);
+
+    for (i = l_SchedCnt;  i > 0  &&  l_Sched[i - 1].Start > start;  i--)
+	l_Sched[i] = l_Sched[i - 1];
+
+    l_Sched[i].Start = (uint16_t)start;
+    l_Sched[i].End   = (uint16_t)end;
+    l_SchedCnt++;
 }
 
 /***************************************************************************//**
@@ -468,6 +1004,9 @@ bool	orgState;	// original state of the alarm
 
     /* Restore original state */
     l_Alarm[alarmNum].Enabled = orgState;
+
+    /* Next alarm time, and the power schedule may have changed */
+    AlarmUpdate();
 }
 
 /***************************************************************************//**
@@ -544,6 +1083,9 @@ void	AlarmEnable (int alarmNum)
 
     /* Set enable flag */
     l_Alarm[alarmNum].Enabled = true;
+
+    /* Next alarm time may have changed */
+    AlarmUpdate();
 }
 
 /***************************************************************************//**
@@ -566,6 +1108,82 @@ void	AlarmDisable (int alarmNum)
 
     /* Clear enable flag */
     l_Alarm[alarmNum].Enabled = false;
+
+    /* Next alarm time may have changed */
+    AlarmUpdate();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Request Update of the next Alarm Time
+ *
+ * This routine must be called whenever an alarm or the system time has been
+ * changed.  It sets @ref l_flgAlarmUpdate, so the RTC interrupt handler
+ * recalculates @ref l_NextAlarmTime.  In tickless mode the RTC interrupt is
+ * triggered at the next full second for this purpose.
+ *
+ ******************************************************************************/
+static void	AlarmUpdate (void)
+{
+    l_flgAlarmUpdate = true;
+    l_flgSchedUpdate = true;
+
+#if RTC_TICKLESS
+    TickWakeUp (0);
+#endif
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Calculate the next Alarm Time
+ *
+ * This routine determines the enabled alarm that occurs next, starting with
+ * the specified time.  Alarms which are repeated every hour are considered.
+ *
+ * @param[in] time
+ *	Time in minutes since midnight to start with.  Values above 23:59 wrap
+ *	around to the next day.
+ *
+ * @return
+ *	Time of the next alarm in minutes since midnight, or @ref NONE if no
+ *	alarm is enabled.
+ *
+ ******************************************************************************/
+static int16_t	AlarmNextTime (int time)
+{
+int	i, alarmTime, dist, minDist;
+int16_t	nextTime = NONE;
+
+    time %= (24 * 60);
+    minDist = (24 * 60);
+
+    for (i = 0;  i < MAX_ALARMS;  i++)
+    {
+	if (! l_Alarm[i].Enabled)
+	    continue;		// skip alarms which are disabled
+
+	if (l_Alarm[i].Hour == NONE)
+	{
+	    /* repeated every hour, use the next occurrence */
+	    alarmTime = (time / 60) * 60 + l_Alarm[i].Minute;
+	    if (alarmTime < time)
+		alarmTime += 60;
+	}
+	else
+	{
+	    alarmTime = l_Alarm[i].Hour * 60 + l_Alarm[i].Minute;
+	}
+
+	/* distance in minutes, consider 24h wrap around */
+	dist = (alarmTime - time + (24 * 60)) % (24 * 60);
+	if (dist < minDist)
+	{
+	    minDist  = dist;
+	    nextTime = (int16_t)(alarmTime % (24 * 60));
+	}
+    }
+
+    return nextTime;
 }
 
 /***************************************************************************//**
@@ -602,6 +1220,7 @@ int	i;	// index variable
 	{
 	    /* yes, allocate it and return handle */
 	    l_sTimer[i].Counter  = 0;
+	    l_sTimer[i].Running  = false;
 	    l_sTimer[i].Function = function;
 	    return i;	// return handle for the newly created timer
 	}
@@ -618,6 +1237,7 @@ int	i;	// index variable
     /* increase the current handle count and allocate the new entry */
     i = l_MaxHdl + 1;
     l_sTimer[i].Counter  = 0;
+    l_sTimer[i].Running  = false;
     l_sTimer[i].Function = function;
 
     l_MaxHdl = i;
@@ -642,8 +1262,8 @@ void	sTimerDelete (TIM_HDL hdl)
     /* Parameter check */
     EFM_ASSERT (0 <= hdl  &&  hdl <= l_MaxHdl);
 
-    /* De-allocate the specified entry */
-    l_sTimer[hdl].Counter  = 0;
+    /* Be sure the timer is not running, then de-allocate the entry */
+    sTimerCancel (hdl);
     l_sTimer[hdl].Function = NULL;
 }
 
@@ -661,77 +1281,245 @@ void	sTimerDelete (TIM_HDL hdl)
  * @param[in] seconds
  *	Duration in seconds how long the timer should run.
  *
- * @see sTimerCancel().
+ * @see sTimerStartSlack(), sTimerCancel().
  *
  ******************************************************************************/
 void	sTimerStart (TIM_HDL hdl, uint32_t seconds)
 {
-    /* Parameter check */
-    EFM_ASSERT (0 <= hdl  &&  hdl <= l_MaxHdl  &&  0 < seconds);
-
-    /* Check specified entry */
-    EFM_ASSERT (l_sTimer[hdl].Function != NULL);
-
-    /* Load counter +1 since timer may be decremented immediately */
-    l_sTimer[hdl].Counter = seconds + 1;
+    sTimerStartSlack (hdl, seconds, 0);
 }
 
 /***************************************************************************//**
  *
- * @brief	Cancel a running 1-s Timer
+ * @brief	Start 1-s Timer with a Tolerance
  *
- * Call this routine to cancel a running one-second timer, i.e. no action is
- * performed when the timer expires.
+ * This routine starts the timer like sTimerStart(), but the expiry may be
+ * delayed by up to <b>slack</b> seconds.  If another timer expires within
+ * this window, the timer is aligned to the earliest one of them, so both
+ * are handled by the same RTC interrupt.  This way periodic housekeeping
+ * tasks share a wake-up, i.e. the SD-Card or the HFXO is powered once for
+ * several tasks.  If there is no such timer, <b>seconds</b> is used as is.
  *
  * @param[in] hdl
  *	Handle to specify the timer.
  *
- * @see sTimerStart().
+ * @param[in] seconds
+ *	Minimum duration in seconds how long the timer should run.
+ *
+ * @param[in] slack
+ *	Number of seconds the expiry may be delayed to join another timer.
+ *
+ * @see sTimerStart(), sTimerCancel().
  *
  ******************************************************************************/
-void	sTimerCancel (TIM_HDL hdl)
+void	sTimerStartSlack (TIM_HDL hdl, uint32_t seconds, uint32_t slack)
 {
+volatile TIM_HDL *pLink;	// link to be updated
+
     /* Parameter check */
-    EFM_ASSERT (0 <= hdl  &&  hdl <= l_MaxHdl);
+    EFM_ASSERT (0 <= hdl  &&  hdl <= l_MaxHdl  &&  0 < seconds);
+
+    /* Check specified entry */
+    EFM_ASSERT (l_sTimer[hdl].Function != NULL);
+
+    INT_Disable();
+
+    /* A running timer is restarted */
+    sTimerUnlink (hdl);
+
+    /* Counter +1 since timer may be decremented immediately */
+    seconds++;
+
+#if RTC_TICKLESS
+    /* The delta list refers to the last processed COMP0 interrupt */
+    seconds += ((RTC->CNT - l_TickBase) & 0xFFFFFF) / RTC_COUNTS_PER_SEC;
+#endif
+
+    /* Find position in the delta list, convert into relative seconds */
+    for (pLink = &l_sTimerHead;  *pLink != NONE;  pLink = &l_sTimer[*pLink].Next)
+    {
+	if (seconds <= l_sTimer[*pLink].Counter
+	&&  l_sTimer[*pLink].Counter - seconds <= slack)
+	{
+	    /* join the expiry of this entry, i.e. insert after it */
+	    seconds = l_sTimer[*pLink].Counter;
+	    slack = 0;
+	}
+
+	if (seconds < l_sTimer[*pLink].Counter)
+	{
+	    /* insert before this entry, which keeps the remaining delta */
+	    l_sTimer[*pLink].Counter -= seconds;
+	    break;
+	}
+	seconds -= l_sTimer[*pLink].Counter;
+    }
+
+    l_sTimer[hdl].Counter = seconds;
+    l_sTimer[hdl].Next    = *pLink;
+    l_sTimer[hdl].Running = true;
+    *pLink = hdl;
+
+#if RTC_TICKLESS
+    /* The new timer may expire before COMP0 is reached */
+    if (l_sTimerHead == hdl)
+	TickWakeUp (seconds);
+#endif
+
+    INT_Enable();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Cancel a running 1-s Timer
+ *
+ * Call this routine to cancel a running one-second timer, i.e. no action is
+ * performed when the timer expires.
+ *
+ * @param[in] hdl
+ *	Handle to specify the timer.
+ *
+ * @see sTimerStart().
+ *
+ ******************************************************************************/
+void	sTimerCancel (TIM_HDL hdl)
+{
+    /* Parameter check */
+    EFM_ASSERT (0 <= hdl  &&  hdl <= l_MaxHdl);
+
+    /* Remove the timer from the delta list */
+    INT_Disable();
+    sTimerUnlink (hdl);
+    INT_Enable();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Remove 1-s Timer from the Delta List
+ *
+ * This routine removes the specified timer from the delta list, if it is
+ * running.  Its remaining seconds are added to the successor, so all other
+ * timers keep their expiration time.
+ *
+ * @note
+ * This routine must be called with interrupts disabled.
+ *
+ * @param[in] hdl
+ *	Handle to specify the timer.
+ *
+ ******************************************************************************/
+static void	sTimerUnlink (TIM_HDL hdl)
+{
+volatile TIM_HDL *pLink;	// link to be updated
+
+    if (! l_sTimer[hdl].Running)
+	return;			// timer is not in the list
+
+    for (pLink = &l_sTimerHead;  *pLink != NONE;  pLink = &l_sTimer[*pLink].Next)
+    {
+	if (*pLink == hdl)
+	{
+	    *pLink = l_sTimer[hdl].Next;
+	    if (*pLink != NONE)
+		l_sTimer[*pLink].Counter += l_sTimer[hdl].Counter;
+	    break;
+	}
+    }
 
-    /* Set the counter to 0 to disable further decrements */
     l_sTimer[hdl].Counter = 0;
+    l_sTimer[hdl].Running = false;
 }
 
 /***************************************************************************//**
  *
- * @brief	Define an Action for the millisecond Timer
+ * @brief	Create a new millisecond Timer
  *
- * Defines the function that should be called, when the high-resolution timer
- * expires.
+ * Create a new high-resolution timer, i.e. a timer with a granularity of 1ms.
+ * The routine returns a reference handle for the new timer.  After the timer
+ * has been created, msTimerStart() must be used to specify the number of
+ * milliseconds the timer should run until <b>function</b> is called.
  *
  * @param[in] function
  *	Function to be called when the timer expires.
  *
+ * @return
+ *	Handle for the newly created timer.
+ *
+ * @see msTimerDelete().
+ *
  ******************************************************************************/
-void	msTimerAction	(void (*function)(void))
+TIM_HDL	msTimerCreate  (TIMER_FCT function)
 {
+int	i;	// index variable
+
+
     /* Parameter check */
     EFM_ASSERT (function != NULL);
 
+    /* Search the next available entry in the list */
+    for (i = 0;  i <= l_msMaxHdl;  i++)
+    {
+	/* see if this entry is free */
+	if (l_msTimer[i].Function == NULL)
+	{
+	    /* yes, allocate it and return handle */
+	    l_msTimer[i].Remain   = 0;
+	    l_msTimer[i].Function = function;
+	    return i;	// return handle for the newly created timer
+	}
+    }
+
 #ifdef LOGGING
-    /* Check if such a function has been defined already */
-    if (l_msTimerFunction != NULL  &&  l_msTimerFunction != function)
-	Log ("WARNING: msTimerAction(): ANOTHER FUNCTION IS ALREADY ASSIGNED");
+    /* no free entry found - try to extend the current handle count */
+    if (l_msMaxHdl >= (MAX_MS_TIMERS - 1))
+	LogError("msTimerCreate(): No more Timer Handles (%d)", MAX_MS_TIMERS);
 #endif
 
-    /* Set function pointer */
-    l_msTimerFunction = function;
+    EFM_ASSERT (l_msMaxHdl < (MAX_MS_TIMERS - 1));
+
+    /* increase the current handle count and allocate the new entry */
+    i = l_msMaxHdl + 1;
+    l_msTimer[i].Remain   = 0;
+    l_msTimer[i].Function = function;
+
+    l_msMaxHdl = i;
+
+    return i;
 }
 
 /***************************************************************************//**
  *
- * @brief	Start the millisecond Timer
+ * @brief	Delete millisecond Timer
  *
- * This routine allows you to specify the number of milliseconds the
- * high-resolution timer should run, and starts it.  When the timer expires,
- * the function that was introduced by msTimerAction(), will be called.
- * Use msTimerCancel() to abort this duration.
+ * This routine cancels and deletes the specified millisecond timer.
+ *
+ * @param[in] hdl
+ *	Handle to specify the timer.
+ *
+ * @see msTimerCreate().
+ *
+ ******************************************************************************/
+void	msTimerDelete (TIM_HDL hdl)
+{
+    /* Parameter check */
+    EFM_ASSERT (0 <= hdl  &&  hdl <= l_msMaxHdl);
+
+    /* Be sure the timer is not running, then de-allocate the entry */
+    msTimerCancel (hdl);
+    l_msTimer[hdl].Function = NULL;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Start millisecond Timer
+ *
+ * This routine allows you to specify the number of milliseconds the timer
+ * should run, and starts it.  When the timer expires, the function that was
+ * introduced by msTimerCreate(), will be called.  Use msTimerCancel() to
+ * abort this duration.  A running timer is restarted with the new duration.
+ *
+ * @param[in] hdl
+ *	Handle to specify the timer.
  *
  * @param[in] ms
  *	Duration in milliseconds how long the timer should run.
@@ -739,37 +1527,144 @@ void	msTimerAction	(void (*function)(void))
  * @see msTimerCancel().
  *
  ******************************************************************************/
-void	msTimerStart (uint32_t ms)
+void	msTimerStart (TIM_HDL hdl, uint32_t ms)
 {
     /* Parameter check */
-    EFM_ASSERT (0 < ms  &&  ms <= MAX_VALUE_FOR_32BIT);
+    EFM_ASSERT (0 <= hdl  &&  hdl <= l_msMaxHdl  &&  0 < ms
+		&&  ms / 1000 < MAX_VALUE_FOR_32BIT);
 
-    /* Verify that a function has been defined for the timer */
-    EFM_ASSERT (l_msTimerFunction != NULL);
+    /* Check specified entry */
+    EFM_ASSERT (l_msTimer[hdl].Function != NULL);
 
-    /* Convert the [ms] value in number of ticks and set COMP1 */
-    RTC_CompareSet (1, (RTC->CNT + (ms * RTC_COUNTS_PER_SEC) / 1000) & 0xFFFFFF);
+    INT_Disable();
 
-    /* Be sure to clear IRQ flag, then enable the COMP1 interrupt */
-    RTC_IntClear (RTC_IFC_COMP1);
-    BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 1);
+    /* Let all running timers refer to the current RTC counter value */
+    msTimerAdvance();
+
+    /* Convert the [ms] value in number of ticks without 32bit overflow */
+    l_msTimer[hdl].Remain = (ms / 1000) * RTC_COUNTS_PER_SEC
+			  + MS2TICS(ms % 1000);
+    l_msActive |= (1UL << hdl);
+
+    /* The new timer may expire before all others */
+    msTimerSchedule();
+
+    INT_Enable();
 }
 
 /***************************************************************************//**
  *
- * @brief	Cancel the running millisecond Timer
+ * @brief	Cancel a running millisecond Timer
  *
- * Call this routine to cancel the running millisecond timer, i.e. no action is
+ * Call this routine to cancel a running millisecond timer, i.e. no action is
  * performed when the timer expires.
  *
+ * @param[in] hdl
+ *	Handle to specify the timer.
+ *
  * @see msTimerStart().
  *
  ******************************************************************************/
-void	msTimerCancel (void)
+void	msTimerCancel (TIM_HDL hdl)
 {
-    /* Disable COMP1 interrupt */
-    BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 0);
+    /* Parameter check */
+    EFM_ASSERT (0 <= hdl  &&  hdl <= l_msMaxHdl);
+
+    INT_Disable();
+
+    l_msActive &= ~(1UL << hdl);
+    l_msTimer[hdl].Remain = 0;
+
+    /* Disable COMP1 interrupt if no more timer is running */
+    if (l_msActive == 0)
+    {
+	BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 0);
+	RTC_IntClear (RTC_IFC_COMP1);
+    }
+
+    INT_Enable();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Advance all running millisecond Timers
+ *
+ * This routine subtracts the RTC ticks which elapsed since the last call from
+ * the remaining ticks of all running msTimers, and sets @ref l_msTimerBase to
+ * the current RTC counter value.  Expired timers get a <b>Remain</b> value
+ * of 0, but are still marked active in @ref l_msActive, so the RTC interrupt
+ * handler will call their functions.
+ *
+ * @note
+ * This routine must be called with interrupts disabled, or from the RTC
+ * interrupt handler.
+ *
+ ******************************************************************************/
+static void	msTimerAdvance (void)
+{
+uint32_t cnt, elapsed;
+int	 i;
+
+    /* Get the elapsed ticks, consider 24bit wrap-around */
+    cnt = RTC->CNT;
+    elapsed = (cnt - l_msTimerBase) & 0xFFFFFF;
+    l_msTimerBase = cnt;
+
+    for (i = 0;  i <= l_msMaxHdl;  i++)
+    {
+	if ((l_msActive & (1UL << i)) == 0)
+	    continue;		// skip timers which are not running
+
+	if (l_msTimer[i].Remain > elapsed)
+	    l_msTimer[i].Remain -= elapsed;
+	else
+	    l_msTimer[i].Remain = 0;	// timer has expired
+    }
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Schedule the next millisecond Timer Interrupt
+ *
+ * This routine sets COMP1 to the deadline of the msTimer that expires next.
+ * The distance is limited to @ref MS_TIMER_MAX_TICKS, so longer durations
+ * just result in an intermediate interrupt.  If no timer is running, the
+ * COMP1 interrupt is disabled.
+ *
+ * @note
+ * This routine must be called immediately after msTimerAdvance(), with
+ * interrupts disabled, or from the RTC interrupt handler.
+ *
+ ******************************************************************************/
+static void	msTimerSchedule (void)
+{
+uint32_t next = MS_TIMER_MAX_TICKS;
+int	 i;
+
+    if (l_msActive == 0)
+    {
+	/* no more timer is running - disable COMP1 interrupt */
+	BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 0);
+	RTC_IntClear (RTC_IFC_COMP1);
+	return;
+    }
+
+    /* Find the timer that expires next */
+    for (i = 0;  i <= l_msMaxHdl;  i++)
+    {
+	if ((l_msActive & (1UL << i))  &&  l_msTimer[i].Remain < next)
+	    next = l_msTimer[i].Remain;
+    }
+
+    if (next < MS_TIMER_MIN_TICKS)
+	next = MS_TIMER_MIN_TICKS;
+
+    /* Set COMP1 relative to the reference counter value */
+    RTC_CompareSet (1, (l_msTimerBase + next) & 0xFFFFFF);
+
+    /* Be sure to clear IRQ flag, then enable the COMP1 interrupt */
     RTC_IntClear (RTC_IFC_COMP1);
+    BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_COMP1_SHIFT, 1);
 }
 
 /***************************************************************************//**
@@ -785,8 +1680,8 @@ void	msTimerCancel (void)
  ******************************************************************************/
 uint32_t msDelayStart (void)
 {
-    /* Return current time counter values */
-    return RTC->CNT;
+    /* Return the lower 32 bits of the monotonic clock */
+    return (uint32_t)ClockMonoTicks();
 }
 
 /***************************************************************************//**
@@ -819,10 +1714,10 @@ uint32_t msTics;
     EFM_ASSERT (0 < ms  &&  ms <= MAX_VALUE_FOR_32BIT);
 
     /* Convert the [ms] value in number of ticks */
-    msTics = ((ms * RTC_COUNTS_PER_SEC) / 1000) & 0xFFFFFF;
+    msTics = (ms * RTC_COUNTS_PER_SEC) / 1000;
 
     /* Check if delay is done */
-    return ((RTC->CNT - startCnt) & 0xFFFFFF) < msTics ? false : true;
+    return ((uint32_t)ClockMonoTicks() - startCnt) < msTics ? false : true;
 }
 
 /***************************************************************************//**
@@ -830,13 +1725,15 @@ uint32_t msTics;
  * @brief	Delay for milliseconds
  *
  * This is a delay routine, it returns to the caller after the specified amount
- * of milliseconds has elapsed.
+ * of milliseconds has elapsed.  Meanwhile the CPU sleeps in EM2, or in EM1 if
+ * a module requires it, see @ref g_EM1_ModuleMask, and is woken up by the
+ * msTimer @ref l_thDelay.  Other interrupts are served as usual.
  *
  * @note
- * This routine permanently reads the Real Time Counter until the calculated
- * value has been reached.  No interrupts are used, i.e. the CPU is kept busy
- * all the time.  Usually delay routines are only used for hardware-related
- * timing constraints and must not be called from interrupt routines.
+ * In interrupt context, with interrupts disabled, or before AlarmClockInit()
+ * the interrupt of the msTimer cannot be taken.  Then this routine
+ * permanently reads the monotonic clock until the calculated value has been
+ * reached, i.e. the CPU is kept busy all the time.
  *
  * @param[in] ms
  *	Duration in milliseconds to wait before returning to the caller.
@@ -849,14 +1746,34 @@ uint32_t startCnt, msTics;
     /* Parameter check */
     EFM_ASSERT (0 < ms  &&  ms <= MAX_VALUE_FOR_32BIT);
 
+    /* Sleep until the msTimer has expired, if its interrupt can be taken */
+    if (l_thDelay != NONE  &&  __get_IPSR() == 0  &&  INT_LockCnt == 0)
+    {
+	l_flgDelayDone = false;
+	msTimerStart (l_thDelay, ms);
+
+	INT_Disable();
+	while (! l_flgDelayDone)
+	{
+	    if (g_EM1_ModuleMask)
+		EMU_EnterEM1();		// EM1 - Sleep Mode
+	    else
+		EMU_EnterEM2(true);	// EM2 - Deep Sleep Mode
+	    INT_Enable();		// let the interrupt be served
+	    INT_Disable();
+	}
+	INT_Enable();
+	return;
+    }
+
     /* Get current time counter values */
-    startCnt = RTC->CNT;
+    startCnt = (uint32_t)ClockMonoTicks();
 
     /* Convert the [ms] value in number of ticks */
-    msTics = ((ms * RTC_COUNTS_PER_SEC) / 1000) & 0xFFFFFF;
+    msTics = (ms * RTC_COUNTS_PER_SEC) / 1000;
 
     /* Wait until time is over */
-    while (((RTC->CNT - startCnt) & 0xFFFFFF) < msTics)
+    while ((uint32_t)ClockMonoTicks() - startCnt < msTics)
 	;
 }
 
@@ -866,7 +1783,8 @@ uint32_t startCnt, msTics;
  *
  * This is a delay routine for very short durations, it returns to the caller
  * after one tick, i.e. with a 32kHz XTAL about 30 microseconds (may be up to
- * 59 microseconds).
+ * 59 microseconds).  It is too short for entering a sleep mode, so the CPU
+ * polls the Real Time Counter.
  *
  ******************************************************************************/
 void	DelayTick (void)
@@ -886,6 +1804,229 @@ uint32_t currCnt;
 	;
 }
 
+/***************************************************************************//**
+ *
+ * @brief	msDelay() Timer expired
+ *
+ * This routine is called by the msTimer @ref l_thDelay when the duration of
+ * msDelay() is over.  It sets @ref l_flgDelayDone to end its sleep loop.
+ *
+ ******************************************************************************/
+static void	DelayExpired (TIM_HDL hdl)
+{
+    (void) hdl;
+
+    l_flgDelayDone = true;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Read the Monotonic Clock
+ *
+ * This routine combines @ref l_MonoBase with the RTC counter.  It does not
+ * disable interrupts: if the base has been changed meanwhile, i.e. the
+ * sequence number @ref l_MonoSeq differs, the values are read again.  An
+ * overflow which has not been counted by RTC_IRQHandler() yet, e.g. when
+ * called with interrupts disabled, is considered via the OF flag.  Since
+ * the flag is set with the wrap-around, a counter value read after it is
+ * surely a wrapped one.
+ *
+ * @param[out] pCnt
+ *	RTC counter value the result refers to.
+ *
+ * @return
+ *	Ticks of the monotonic clock.
+ *
+ ******************************************************************************/
+static uint64_t	MonoRead (uint32_t *pCnt)
+{
+uint32_t seq;			// sequence number before reading
+uint64_t base;			// ticks at counter value 0
+uint32_t cnt;			// RTC counter value
+
+    do
+    {
+	seq = l_MonoSeq;
+	if (seq & 1)
+	{
+	    /* RTC is stopped by ClockSet() */
+	    *pCnt = RTC->CNT;
+	    return l_MonoFrozen;
+	}
+	base = l_MonoBase;
+	cnt  = RTC->CNT;
+	if (RTC->IF & RTC_IF_OF)
+	{
+	    cnt   = RTC->CNT;		// read again, after the wrap-around
+	    base += 0x1000000;
+	}
+    } while (seq != l_MonoSeq);
+
+    *pCnt = cnt;
+    return base + cnt;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Monotonic Clock in RTC Ticks
+ *
+ * This routine returns the number of RTC ticks since the RTC has been
+ * started by AlarmClockInit().  In contrast to the 24bit RTC counter, this
+ * clock does not wrap around, and it is not affected by ClockSet(), so the
+ * difference of two values is always the elapsed time.  The lower 32 bits
+ * are sufficient for durations up to 36 hours.  It may be called from any
+ * context, interrupts are not disabled.
+ *
+ * @return
+ *	Ticks of the monotonic clock, see @ref RTC_COUNTS_PER_SEC.
+ *
+ ******************************************************************************/
+uint64_t ClockMonoTicks (void)
+{
+uint32_t cnt;
+
+    return MonoRead (&cnt);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Monotonic Clock in Milliseconds
+ *
+ * This routine returns the monotonic clock of ClockMonoTicks() in [ms].
+ *
+ * @return
+ *	Milliseconds since the RTC has been started.
+ *
+ ******************************************************************************/
+uint64_t ClockMonoMs (void)
+{
+    return ClockMonoTicks() * 1000 / RTC_COUNTS_PER_SEC;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Convert a Time Stamp to the Monotonic Clock
+ *
+ * This routine converts a 24bit RTC time stamp, e.g. of an external
+ * interrupt, into ticks of the monotonic clock.  The time stamp must be
+ * within 256s before or after the current RTC counter value.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value of the event.
+ *
+ * @return
+ *	Ticks of the monotonic clock at the time stamp.
+ *
+ ******************************************************************************/
+uint64_t ClockMonoStamp (uint32_t timeStamp)
+{
+uint32_t cnt;			// RTC counter value of <now>
+uint64_t now = MonoRead (&cnt);
+uint32_t delta = (cnt - timeStamp) & 0xFFFFFF;
+
+    if (delta & 0x800000)
+	return now + (0x1000000 - delta);	// time stamp is ahead
+
+    return now - delta;
+}
+
+#if RTC_TICKLESS
+/***************************************************************************//**
+ *
+ * @brief	Set COMP0 for Tickless Mode
+ *
+ * This routine sets COMP0 to <b>secs</b> seconds after @ref l_TickBase.  If
+ * this is not a minimum of @ref TICKLESS_MIN_TICKS in the future, the next
+ * full second is used instead.
+ *
+ * @note
+ * This routine must be called with interrupts disabled.
+ *
+ * @param[in] secs
+ *	Number of seconds after @ref l_TickBase.
+ *
+ ******************************************************************************/
+static void	TickSet (uint32_t secs)
+{
+uint32_t ticks;		// ticks since the last processed COMP0 interrupt
+
+    ticks = (RTC->CNT - l_TickBase) & 0xFFFFFF;
+    if (secs * RTC_COUNTS_PER_SEC < ticks + TICKLESS_MIN_TICKS)
+	secs = (ticks + TICKLESS_MIN_TICKS) / RTC_COUNTS_PER_SEC + 1;
+
+    l_TickSecs = secs;
+    RTC_CompareSet (0, (l_TickBase + secs * RTC_COUNTS_PER_SEC) & 0xFFFFFF);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Schedule the next COMP0 Interrupt
+ *
+ * This routine is called by the RTC interrupt handler after all timers and
+ * alarms have been processed.  It sets COMP0 to the earliest deadline of the
+ * next sTimer expiry, and the next alarm time.  The distance is limited to
+ * @ref TICKLESS_MAX_SECS.
+ *
+ ******************************************************************************/
+static void	TickSchedule (void)
+{
+uint32_t secs = TICKLESS_MAX_SECS;
+uint32_t alarmSecs;
+int	 dist;
+
+    INT_Disable();
+
+    /* Next sTimer expiry, the counter refers to <l_TickBase> */
+    if (l_sTimerHead != NONE  &&  l_sTimer[l_sTimerHead].Counter < secs)
+	secs = l_sTimer[l_sTimerHead].Counter;
+
+    /* Next alarm time, <g_CurrDateTime> has just been updated */
+    if (l_flgAlarmUpdate)
+    {
+	secs = 1;		// let the RTC interrupt recalculate it
+    }
+    else if (l_NextAlarmTime != NONE)
+    {
+	dist = (l_NextAlarmTime - g_CurrDateTime.tm_hour * 60
+		- g_CurrDateTime.tm_min + (24 * 60)) % (24 * 60);
+	if (dist == 0)
+	    dist = (24 * 60);	// current minute has already been processed
+
+	alarmSecs = dist * 60 - g_CurrDateTime.tm_sec;
+	if (alarmSecs < secs)
+	    secs = alarmSecs;
+    }
+
+    TickSet (secs);
+
+    INT_Enable();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Wake up earlier in Tickless Mode
+ *
+ * This routine moves COMP0 to <b>secs</b> seconds after @ref l_TickBase, if
+ * this is earlier than the current setting.  A value of 0 requests the RTC
+ * interrupt for the next full second.  Nothing is done if the COMP0 interrupt
+ * is pending or being processed, since TickSchedule() will be called then.
+ *
+ * @param[in] secs
+ *	Number of seconds after @ref l_TickBase.
+ *
+ ******************************************************************************/
+static void	TickWakeUp (uint32_t secs)
+{
+    INT_Disable();
+
+    if (l_TickSecs != 0  &&  (RTC->IF & RTC_IF_COMP0) == 0
+    &&  secs < l_TickSecs)
+	TickSet (secs);
+
+    INT_Enable();
+}
+#endif	// RTC_TICKLESS
+
 /***************************************************************************//**
  *
  * @brief	Install a Display Update function
@@ -930,25 +2071,17 @@ void	DisplayUpdateFctInstall	(void (*function)(void))
  ******************************************************************************/
 void	ClockUpdate (bool readTime)
 {
-time_t	now;
-
     /*
-     * Measured execution time: 110us without calling l_DisplayUpdateFct().
+     * Measured execution time: 110us without calling l_DisplayUpdateFct()
+     * for a complete conversion, see ClockRefresh().
      */
 
-    /*
-     * Get current UNIX time, convert to <tm>, and store in global struct.
-     * We have to use function localtime() here instead of the reentrant
-     * version localtime_r() because this does not exist in the IAR libraries.
-     *
-     * THIS IS NOT MULTI-THREADING SAVE AND ONLY WORKS BECAUSE localtime() IS
-     * CALLED FROM INTERRUPT SERVICE ROUTINES WHICH HAVE THE SAME PRIORITY
-     * LEVEL, SO THEY DO NOT INTERFERE.
-     */
+    /* Get current UNIX time, convert to <tm>, and store in global struct */
     if (readTime)
     {
-	now = time (NULL);
-	g_CurrDateTime = *localtime(&now);
+	INT_Disable();
+	ClockRefresh();
+	INT_Enable();
     }
 
     /* Also update display, if a function has been defined for that purpose */
@@ -956,6 +2089,52 @@ time_t	now;
 	l_DisplayUpdateFct();
 }
 
+/***************************************************************************//**
+ *
+ * @brief	Refresh the System Clock Structure
+ *
+ * This routine updates @ref g_CurrDateTime with the current date and time,
+ * if the UNIX time has changed since the last call.  As long as the date does
+ * not change, only the time elements are advanced.  The complete conversion
+ * via localtime() (about 100us) is only done when crossing midnight, or if
+ * @ref l_CurrTime has been invalidated by ClockSet().
+ *
+ * We have to use function localtime() here instead of the reentrant version
+ * localtime_r() because this does not exist in the IAR libraries.  Therefore
+ * this routine must be called with interrupts disabled.
+ *
+ ******************************************************************************/
+static void	ClockRefresh (void)
+{
+time_t	now;
+int32_t	secs;		// seconds since midnight
+
+    now = time (NULL);
+    if (now == l_CurrTime)
+	return;			// structure is up to date
+
+    if (l_CurrTime != (time_t)(-1)  &&  now > l_CurrTime
+    &&  now - l_CurrTime < 24 * 3600)
+    {
+	secs = g_CurrDateTime.tm_hour * 3600 + g_CurrDateTime.tm_min * 60
+	     + g_CurrDateTime.tm_sec + (int32_t)(now - l_CurrTime);
+
+	if (secs < 24 * 3600)
+	{
+	    /* still the same day, advance time elements only */
+	    g_CurrDateTime.tm_hour = secs / 3600;
+	    g_CurrDateTime.tm_min  = (secs / 60) % 60;
+	    g_CurrDateTime.tm_sec  = secs % 60;
+	    l_CurrTime = now;
+	    return;
+	}
+    }
+
+    /* date has changed, do a complete conversion */
+    l_CurrTime = now;
+    g_CurrDateTime = *localtime(&now);
+}
+
 /***************************************************************************//**
  *
  * @brief	Get System Clock
@@ -974,6 +2153,11 @@ void	ClockGet (struct tm *pTimeDateVar)
     /* Disable interrupts */
     INT_Disable();
 
+#if RTC_TICKLESS
+    /* Structure is not updated every second */
+    ClockRefresh();
+#endif
+
     /* Get current date and time */
     *pTimeDateVar = g_CurrDateTime;
 
@@ -1005,6 +2189,16 @@ uint32_t	currSubSec;
     /* Disable interrupts */
     INT_Disable();
 
+#if RTC_TICKLESS
+    /*
+     * Structure is not updated every second, refresh it and take the
+     * sub-seconds from the counter value which is also used by time().
+     */
+    currSubSec = (RTC->CNT + clockGetTickOffset()) % RTC_COUNTS_PER_SEC;
+    ClockRefresh();
+    *pTimeDateVar = g_CurrDateTime;
+    *pMsVar = currSubSec * 1000 / RTC_COUNTS_PER_SEC;
+#else
     /* Read current RTC value - only sub-seconds are of interest */
     currSubSec = (RTC->CNT - RTC->COMP0) % RTC_COUNTS_PER_SEC;
 
@@ -1016,6 +2210,7 @@ uint32_t	currSubSec;
 	*pMsVar = 999;			// use maximum [ms] value
     else				// Calculate remaining [ms]
 	*pMsVar = currSubSec * 1000 / RTC_COUNTS_PER_SEC;
+#endif
 
     /* Enable interrupts again */
     INT_Enable();
@@ -1043,6 +2238,10 @@ void	ClockSet (struct tm *pNewTimeDate, bool sync)
 time_t    newRtcStartTime;
 uint32_t  rtcIEN;	// save state of the RTC Interrupt Enable register
 uint32_t  rtcCNT;	// save state of the RTC Interrupt Enable register
+#if RTC_TICKLESS
+uint32_t  elapsed;	// seconds elapsed since the last COMP0 interrupt
+#endif
+bool	  flgInitialSync = false;
 
 
     EFM_ASSERT (pNewTimeDate != NULL);
@@ -1064,14 +2263,19 @@ uint32_t  rtcCNT;	// save state of the RTC Interrupt Enable register
 #ifdef LOGGING
 	Log ("Initial Time Synchronisation");
 #endif
-	/* Now we've got a valid time, check power alarms */
-	CheckAlarmTimes();
+	flgInitialSync = true;
     }
 
     /* Be sure to disable RTC interrupts while manipulating registers */
     rtcIEN = RTC->IEN;
     RTC->IEN = 0;		// disable all RTC interrupts
 
+    /* Freeze the monotonic clock while the RTC is stopped */
+    INT_Disable();
+    l_MonoFrozen = ClockMonoTicks();
+    l_MonoSeq++;
+    INT_Enable();
+
     /* Get current counter value and stop the clock */
     rtcCNT = RTC->CNT;
     RTC_Enable (false);
@@ -1085,19 +2289,152 @@ uint32_t  rtcCNT;	// save state of the RTC Interrupt Enable register
      * Calculate the respective COMP values if counter is zero.  If <sync>
      * flag is true, the milliseconds portion of the counter is also reset by
      * setting COMP0 to RTC_COUNTS_PER_SEC (i.e. the next full second).
-     * The high-resolution timer COMP1 is always changed in a way that the
-     * remaining time will be correct.
+     * The high-resolution timer COMP1 and its reference l_msTimerBase are
+     * always changed in a way that the remaining time will be correct.
+     */
+#if RTC_TICKLESS
+    /*
+     * In tickless mode the seconds elapsed since <l_TickBase> are still to
+     * be counted by the sTimers, so <l_TickBase> is moved accordingly.
      */
+    if (sync)
+    {
+	elapsed = ((rtcCNT - l_TickBase) & 0xFFFFFF) / RTC_COUNTS_PER_SEC;
+	l_TickSecs = elapsed + 1;
+	l_TickBase = (RTC_COUNTS_PER_SEC - l_TickSecs * RTC_COUNTS_PER_SEC)
+		     & 0xFFFFFF;
+	RTC->COMP0 = RTC_COUNTS_PER_SEC;
+	RTC->IFC = RTC_IFC_COMP0;	// already considered in <elapsed>
+    }
+    else
+    {
+	RTC->COMP0 -= rtcCNT;
+	l_TickBase = (l_TickBase - rtcCNT) & 0xFFFFFF;
+    }
+#else
     RTC->COMP0 = (sync ? RTC_COUNTS_PER_SEC : RTC->COMP0 - rtcCNT);
+#endif
     RTC->COMP1 -= rtcCNT;
+    l_msTimerBase = (l_msTimerBase - rtcCNT) & 0xFFFFFF;
+
+    /* Structure <g_CurrDateTime> must be recalculated */
+    l_CurrTime = (time_t)(-1);
 
     /* Set new start time and reset overflow counter */
     clockSetStartTime (newRtcStartTime);
     clockSetOverflowCounter (0);
+    RTC->IFC = RTC_IFC_OF;	// overflow of the old counter is obsolete
 
     /* Start the clock */
     RTC_Enable (true);
 
+    /* The monotonic clock continues from the frozen value */
+    INT_Disable();
+    l_MonoBase = l_MonoFrozen - RTC->CNT;
+    l_MonoSeq++;
+    INT_Enable();
+
     /* Finally restore the original state of the IEN register */
     RTC->IEN = rtcIEN;
+
+    /* Time has been changed, the next alarm time must be recalculated */
+    AlarmUpdate();
+
+    /* Now we've got a valid time, check power alarms */
+    if (flgInitialSync)
+	CheckAlarmTimes();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Adjust System Clock
+ *
+ * This routine advances or retards the System Clock by the specified number
+ * of RTC ticks.  In contrast to ClockSet(), the RTC keeps running, only the
+ * tick offset of time() is changed, see clockAdjust().  The sTimers, the
+ * msTimers, and the monotonic clock are not affected.  It is intended for
+ * small corrections, i.e. a fraction of a second, like the compensation of
+ * the temperature drift of the LFXO.
+ *
+ * @param[in] ticks
+ *	Number of RTC ticks, positive to advance the clock.
+ *
+ ******************************************************************************/
+void	ClockAdjust (int32_t ticks)
+{
+    if (ticks == 0)
+	return;
+
+    INT_Disable();
+    clockAdjust (ticks);
+    l_CurrTime = (time_t)(-1);	// <g_CurrDateTime> must be recalculated
+    INT_Enable();
+
+    /* Time has been changed, the next alarm time must be recalculated */
+    AlarmUpdate();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Slew System Clock
+ *
+ * This routine advances or retards the System Clock by the specified number
+ * of RTC ticks like ClockAdjust(), but gradually: the tick offset of time()
+ * is changed by one tick per @ref CLOCK_SLEW_DIV RTC ticks, see clockSlew().
+ * In contrast to a step, the time never runs backwards and no second is
+ * skipped, so no minute alarm is processed twice or missed, and durations
+ * measured by the system clock remain valid.  The RTC interrupt occurs at
+ * least every @ref TICKLESS_MAX_SECS, when ClockUpdate() applies the due part
+ * of the slew.  A slew which is still in progress is replaced, ClockSet()
+ * cancels it.
+ *
+ * @param[in] ticks
+ *	Number of RTC ticks, positive to advance the clock.
+ *
+ ******************************************************************************/
+void	ClockSlew (int32_t ticks)
+{
+    INT_Disable();
+    clockSlew (ticks, CLOCK_SLEW_DIV);
+    INT_Enable();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Get System Clock in RTC Ticks
+ *
+ * This routine returns the system time at the specified RTC time stamp in
+ * RTC ticks, i.e. the seconds of time() multiplied by
+ * @ref RTC_COUNTS_PER_SEC, plus the sub-seconds.  It allows to compare the
+ * system clock with an external time reference, e.g. the PPS signal of a
+ * GPS receiver, to a fraction of a millisecond.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value of the event, it must not be older than 256s and
+ *	must have been taken after the last ClockSet().
+ *
+ * @return
+ *	System time in RTC ticks at the time stamp.
+ *
+ ******************************************************************************/
+int64_t	ClockGetTicks (uint32_t timeStamp)
+{
+uint32_t offs;			// tick offset of time()
+uint32_t cnt;			// RTC counter value of <now>
+time_t	 now;			// seconds of time() at <cnt>
+
+    /* Read counter and seconds again if a second boundary is crossed */
+    INT_Disable();
+    offs = clockGetTickOffset();
+    do
+    {
+	cnt = RTC->CNT;
+	now = time (NULL);
+    } while ((cnt + offs) / RTC_COUNTS_PER_SEC
+	     != (RTC->CNT + offs) / RTC_COUNTS_PER_SEC);
+    INT_Enable();
+
+    return (int64_t)now * RTC_COUNTS_PER_SEC
+	   + (cnt + offs) % RTC_COUNTS_PER_SEC
+	   - ((cnt - timeStamp) & 0xFFFFFF);
 }
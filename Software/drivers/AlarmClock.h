@@ -2,9 +2,21 @@
  * @file
  * @brief	Header file of module AlarmClock.c
  * @author	Ralf Gerhauser
- * @version	2020-05-12
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	g_WeekdayName is a constant table.
+2026-10-15,agnt	Added CLOCK_SLEW, CLOCK_SLEW_MAX_MS, CLOCK_SLEW_DIV, and the
+		prototype for ClockSlew().
+2026-10-15,agnt	Added prototype for sTimerStartSlack().
+2026-10-15,agnt	Added prototype for ClockGetTicks().
+2026-10-15,agnt	Added prototype for ClockAdjust().
+2026-10-15,agnt	Added ClockMonoTicks(), ClockMonoMs(), and ClockMonoStamp().
+2026-10-14,agnt	Added WEEKDAYS_ALL, g_PowerWeekdays, g_WeekdayName, and the
+		prototype for PowerScheduleIsOn().
+2026-10-14,agnt	Added MAX_MS_TIMERS, msTimerCreate() and msTimerDelete(),
+		msTimerStart() and msTimerCancel() require a timer handle.
+		Added RTC_TICKLESS.
 2020-05-12,rage	Added prototypes for CheckAlarmTimes() and ExecuteAlarmAction().
 2018-10-09,rage	Reduced size of type TIM_HDL from 4 to 1 byte to save memory.
 2018-03-24,rage	Increased MAX_SEC_TIMERS from 10 to 16..
@@ -37,6 +49,11 @@ Revision History:
     #define MAX_SEC_TIMERS	10
 #endif
 
+#ifndef MAX_MS_TIMERS
+    /*!@brief Maximum number of msTimer entries (32 at most) */
+    #define MAX_MS_TIMERS	4
+#endif
+
 #ifndef MAX_ALARMS
     /*!@brief Maximum number of alarms */
     #define MAX_ALARMS		NUM_ALARM_IDS
@@ -47,6 +64,41 @@ Revision History:
     #define RTC_COUNTS_PER_SEC	32768
 #endif
 
+#ifndef RTC_TICKLESS
+    /*!@brief Set 1 to let the RTC interrupt only occur for the next deadline,
+     * i.e. the next sTimer expiry or alarm time, instead of every second.
+     * Then @ref g_CurrDateTime is only updated on demand, so always use
+     * ClockGet() or ClockGetMilliSec() to read the current time.
+     */
+    #define RTC_TICKLESS	1
+#endif
+
+#ifndef CLOCK_SLEW
+    /*!@brief Set 1 to let TimeSrcSync() slew small corrections of the time
+     * source via ClockSlew(), instead of setting the clock, so the time base
+     * remains monotonic.  Larger offsets are still corrected by ClockSet().
+     */
+    #define CLOCK_SLEW		1
+#endif
+
+#ifndef CLOCK_SLEW_MAX_MS
+    /*!@brief Maximum offset in [ms] which is corrected by ClockSlew(). */
+    #define CLOCK_SLEW_MAX_MS	2000
+#endif
+
+#ifndef CLOCK_SLEW_DIV
+    /*!@brief Slew rate of ClockSlew(): the clock is corrected by one RTC tick
+     * per CLOCK_SLEW_DIV ticks.  The default of 1024 corresponds to about
+     * 1ms per second, i.e. an offset of 1s is absorbed within 17 minutes.
+     */
+    #define CLOCK_SLEW_DIV	1024
+#endif
+
+    /*!@brief Bit mask of all weekdays for @ref g_PowerWeekdays, bit 0 is
+     * Sunday, i.e. the bit number is the <b>tm_wday</b> value.
+     */
+#define WEEKDAYS_ALL	0x7F
+
     /*!@brief Macro to convert milliseconds to RTC tics. */
 #define MS2TICS(ms)	((ms) * RTC_COUNTS_PER_SEC / 1000)
 
@@ -106,6 +158,8 @@ typedef struct
 extern struct tm  	g_CurrDateTime;	//!< Current date and time structure
 extern volatile bool	g_isdst;	//!< Flag for "daylight saving time"
 extern volatile time_t	g_PowerUpTime;	//!< Power-Up Time as UNIX time
+extern int32_t		g_PowerWeekdays[NUM_POWER_ALARMS]; //!< Weekday masks
+extern const char * const g_WeekdayName[7];	//!< "SU" to "SA"
 
 /*================================ Prototypes ================================*/
 
@@ -114,6 +168,7 @@ void	AlarmClockInit (void);
 
     /* Alarm handling functions */
 void	CheckAlarmTimes (void);
+bool	PowerScheduleIsOn (int32_t *pNextChange);
 void	AlarmAction (int alarmNum, ALARM_FCT function);
 void	ExecuteAlarmAction (int alarmNum);
 void	AlarmSet    (int alarmNum, int8_t hour, int8_t min);
@@ -126,12 +181,14 @@ void	AlarmDisable(int alarmNum);
 TIM_HDL	sTimerCreate(TIMER_FCT function);
 void	sTimerDelete(TIM_HDL hdl);
 void	sTimerStart (TIM_HDL hdl, uint32_t seconds);
+void	sTimerStartSlack (TIM_HDL hdl, uint32_t seconds, uint32_t slack);
 void	sTimerCancel(TIM_HDL hdl);
 
-    /* msTimer handling functions (high-resolution timer) */
-void	msTimerAction(void (*function)(void));
-void	msTimerStart (uint32_t ms);
-void	msTimerCancel(void);
+    /* msTimer handling functions (1 millisecond granularity) */
+TIM_HDL	msTimerCreate(TIMER_FCT function);
+void	msTimerDelete(TIM_HDL hdl);
+void	msTimerStart (TIM_HDL hdl, uint32_t ms);
+void	msTimerCancel(TIM_HDL hdl);
 uint32_t msDelayStart (void);
 bool	msDelayIsDone (uint32_t startCnt, uint32_t ms);
 void	msDelay (uint32_t ms);
@@ -143,6 +200,14 @@ void	ClockUpdate (bool readTime);
 void	ClockGet (struct tm *pTimeDateVar);
 void	ClockGetMilliSec (struct tm *pTimeDateVar, unsigned int *pMsVar);
 void	ClockSet (struct tm *pNewTimeDate, bool sync);
+void	ClockAdjust (int32_t ticks);
+void	ClockSlew (int32_t ticks);
+int64_t	ClockGetTicks (uint32_t timeStamp);
+
+    /* Monotonic clock, not affected by ClockSet() */
+uint64_t ClockMonoTicks (void);
+uint64_t ClockMonoMs (void);
+uint64_t ClockMonoStamp (uint32_t timeStamp);
 
 
 #endif /* __INC_AlarmClock_h */
@@ -2,12 +2,14 @@
  * @file
  * @brief	AUDIO
  * @author	Peter Loes
- * @version	2019-11-12
+ * @version	2026-10-15
  *
  * This module provides the functionality to communicate with the AUDIO module.
  * It contains the following parts:
- * - USART driver to transmit and receive data from the Audio module.
- * - Handler for the received data
+ * - USART driver to transmit (via DMA) and receive data from the Audio module.
+ * - Frame assembler for the received data, running in the USART RX interrupt
+ * - Handler for the received frames, called by AudioCheck() in the main loop
+ * - Command queue, see AudioCmdEnqueue()
  * - Power management for FN-RM01 MP3 Audio Recorder and USART
  *
  * After powering up the Audio module, the following actions are performed:
@@ -23,7 +25,7 @@
  *     4.4.3 Total file numbers on SD card or USB flash
  * -# Sending <b>0x7E,0x03,0xCE,0xD1,0x7E</b> command
  *    4.4.9 Space left in the storage device
- * -# Sending <b>0x7E,0x04,0xAE,g_AudioCfg_VC,checksum_int,0x7E</b> command
+ * -# Sending <b>0x7E,0x04,0xAE,g_AudioCfg_VC,checksum,0x7E</b> command
  *    4.3.9. Volume control 1 to 31
  * -# Sending <b>0x7E,0x04,0xD2,0x01,0xD7,0x7E)</b> command
  *     4.3.13. Storage device
@@ -31,6 +33,43 @@
  *    4.3.14. Input Mode
  * -# Sending <b>0x7E,0x04,0xD4,0x01 0xD9,0x7E</b> command
  *    4.3.15. Recording quality 
+ *
+ * This power-up session is written as protothread, see AudioSession() and
+ * "Protothread.h".  It is resumed by AudioCheck() and waits for the prompt
+ * of the module, the power-up delay, and the responses to its commands,
+ * which are still sent via the command queue.
+ *
+ * The work status of the module is kept in a status model, see
+ * AudioStatusSet().  It is updated by the acknowledges of the playback and
+ * record commands, and by the notifications which the module sends on its
+ * own, i.e. the work status 0xC2 at the end of a playback, and the storage
+ * device status 0xCA.  The work status is only queried via
+ * @ref AUDIO_GET_WORK_STATUS if the model is stale.  The end of a playback
+ * starts the next chained file at once, see @ref PLAYBACK_CHAIN.
+ *
+ * With @ref g_AudioRecSegment a long record is split into several files.
+ * At the end of a segment, the stop and the next record command are queued
+ * back to back.  Each segment is reported to the visit records with the RTC
+ * time stamp of its acknowledge, which the RX interrupt handler has taken,
+ * so the audio can be aligned to the light barrier and RFID events.
+ *
+ * The inventory cache also contains a map of the playback files which are
+ * missing on the storage device.  The FN-RM01 has no command to query a
+ * single file, so a file is entered into the map when its playback command
+ * has been rejected.  From then on it is skipped without any command to the
+ * module, until the storage device has been removed or the file count has
+ * changed, see AudioFileMissing().  The map covers the file numbers up to
+ * @ref AUDIO_MISSING_MAX_FILE, higher numbers are always sent to the module.
+ *
+ * With @ref g_AudioServiceDate the recording quality is adapted at each
+ * power-up, so the storage device lasts until the service date, see
+ * AudioRqAdapt().
+ *
+ * The link runs at @ref AUDIO_BAUDRATE if the module has been set up for a
+ * higher rate than 9600.  The FN-RM01 has no command to change its rate, so
+ * the rate is probed by the prompt of the module after power-up.  If frames
+ * are received with errors, the link falls back to 9600, see
+ * AudioBaudFallback().  The higher rate is tried again after a recovery.
  * 
  * - Include Playback_Type
  *  Playback_Type: 5 playback files T001.wav/mp3 -T005.wav/mp3 on MicroSDCard 
@@ -38,6 +77,15 @@
  *  Playback_Type: 6,7,8,9 random.
  *  random, 6 for P001.wav and P002.wav over duration in seconds.
  *  random, 9 for P001.wav,P002.wav,P003.wav,P004.wav and P005.wav over duration in seconds.
+ *  Playback_Type: 10 random with the files and weights of PLAYLIST.
+ *  Playback_Type: 11 to 14 random with the stimulus groups STIM_SET_1 to
+ *  STIM_SET_4, which may contain files up to P999.
+ *  The random types use a shuffle bag, see Playlist.c.
+ *
+ * With @ref SOUND_DETECT and SOUND_THRESHOLD, a requested record is only
+ * started when there is sound at the microphone, and it is stopped after
+ * SOUND_HANG_TIME seconds of silence, see SoundDetect.c.  The pre-roll
+ * record is not gated.
 
  * -# Sending <b>0x7E,0x07,0xA3,0x50,0x30,0x30,0x31,0x8B,0x7E</b> command
  *    4.3.2 Specify playback of a file by name 
@@ -56,34 +104,175 @@
  ****************************************************************************//*
 
 Revision History:
+2026-10-15,agnt	The DMA configuration of the Tx channel is kept on the stack.
+2026-10-15,agnt	The response time histograms only cover the commands.
+2026-10-15,agnt	The map of missing files covers the file numbers up to 255.
+2026-10-15,agnt	The request counters and the response time histogram of the
+		telemetry are 16 bit, they are reset every day.
+2026-10-15,agnt	Removed the timeline marks of a session.
+2026-10-15,agnt	Removed the latency stamps of a playback.
+2026-10-15,agnt	The range check of g_AudioCfg_VC uses a logical or.
+2026-10-15,agnt	The RX handler reads RXDATAX and discards the frame on a
+		framing or parity error, or a receive overflow of the USART.
+		These are counted in l_Telem like the invalid frames.
+2026-10-15,agnt	AudioCheck() and SendFrame() emit ITM trace records of the state
+		and the transmit ring, see ITM_TRACE.
+2026-10-15,agnt	Registered AudioCheck() as task of the main loop, see
+		TASK_REGISTER().
+2026-10-15,agnt	Availability map of the playback files in the inventory cache.
+		A file which has been rejected by the module is logged once,
+		and skipped by AudioPlaybackSelect() from then on, so a
+		missing stimulus costs no command, see AudioFileMissing().
+2026-10-15,agnt	Segmented records: With RECORD_SEGMENT the record is stopped and
+		continued in the next file by one burst of the command queue.
+		The receive time of each frame is stamped by the RX handler,
+		the start of a segment is reported with the time stamp of the
+		acknowledge, see VisitStatsSegment().
+2026-10-15,agnt	Per-ID volume and input mode, see AudioParmSet().  They are
+		sent in the same burst as the playback or record command, and
+		only if the module has another value, see l_ModuleVC.
+2026-10-15,agnt	With SOUND_DETECT, a requested record only runs while there
+		is sound at the microphone, see SoundDetect.c.
+2026-10-15,agnt	Tiered recovery after a communication timeout: the receiver
+		is resynchronized and the commands are repeated, then the
+		work status is queried as probe, then the receiver of the
+		USART is reset and probed again.  The module is only power
+		cycled as last resort, see AudioRecover().
+2026-10-15,agnt	The inventory cache is saved in the parameter store when the
+		module is switched off, and restored from there after a
+		power-on reset.  The file count is verified then.
+2026-10-15,agnt	The DMA channel is set up via DmaChanConfig().
+2026-10-15,agnt	The power transitions, the first response, and the first
+		playback of a session are recorded in the timeline, see
+		TIMELINE.
+2026-10-15,agnt	The command latency is measured with the monotonic clock, see
+		ClockMonoTicks().
+2026-10-15,agnt	Added AudioStorageForecast() for the forecast of Forecast.c,
+		the record rate is observed without AUDIO_SERVICE_DATE, too.
+2026-10-15,agnt	Adaptive recording quality: With AUDIO_SERVICE_DATE the bit
+		rate is chosen from the space left and the observed record
+		rate, see AudioRqAdapt().
+2026-10-15,agnt	The link runs at AUDIO_BAUDRATE, with fallback to 9600 on
+		receive errors, see AudioBaudFallback().
+2026-10-15,agnt	Status model of the Audio module, updated by acknowledges and
+		by the notifications 0xC2 and 0xCA.  AUDIO_GET_WORK_STATUS is
+		only sent if the model is stale, see AudioStatusStale().
+2026-10-15,agnt	The power-up session is a protothread, see AudioSession().  It
+		replaces AudioInitSeq() and the handling of AUDIO_STATE_POWER_ON
+		in AudioFrameHandler() and AudioComTimeoutHandler().
+2026-10-15,agnt	The USART clock and EM1 are acquired via ClockMgr.c.
+2026-10-15,agnt	AudioClockChange() recalculates the baud rate of the USART after
+		a switch of the HF clock, see HF_CLOCK_GOVERNOR.
+2026-10-15,agnt	AudioCmdDone() also reports the file numbers and rejected
+		playbacks and records for the visit records.
+2026-10-15,agnt	AudioCmdDone() reports the start and stop of playbacks and
+		records for the visit statistics, see VISIT_STATS.
+2026-10-15,agnt	Use StrFormat() instead of sprintf().
+2026-10-15,agnt	AudioPowerFailResume() restores the state after a short outage.
+2026-10-14,agnt	Events for AudioCheck() are posted via EVENT_POST(EVT_AUDIO).
+		After received frames have been processed, AudioCheck() is
+		called once more, as the state may allow a pending action now.
+2026-10-14,agnt	Telemetry: Requests per command, a response time histogram,
+		receive errors, timeouts, and recoveries are counted in
+		@ref l_Telem, see AudioTelemetryReport().  They are logged
+		daily at ALARM_AUDIO_TELEM_TIME.
+2026-10-14,agnt	Adaptive command timeouts: The response time of each command is
+		recorded in a histogram, the watchdog uses its 99th percentile
+		plus AUDIO_TIMEOUT_MARGIN, see AudioCmdTimeout().  A timeout is
+		retried once before it counts as error, the error count and
+		MAX_COM_ERROR_CNT apply per command.
+2026-10-14,agnt	Pre-roll: With RECORD_PREROLL the light barrier starts a record
+		before the transponder ID is known.  AudioPreRollDecide()
+		continues it as the KEEP_RECORD record, stops it, or marks it
+		as not needed, see AudioPreRollRequest().
+2026-10-14,agnt	Playback chaining: With PLAYBACK_CHAIN the next file of the
+		playlist is selected in advance and sent at an msTimer
+		deadline, measured from the acknowledge of the current one,
+		without a Stop Playback command in between.
+2026-10-14,agnt	The playback command addresses P001 to P999, the file number
+		is encoded by AudioQueueCmd() as three ASCII digits.  Added
+		the PLAYBACK_TYPEs for the stimulus groups STIM_SET_n.
+2026-10-14,agnt	AudioPlayback: The random PLAYBACK_TYPEs 6 to 9 and the new
+		type PLAY_TYPE_PLAYLIST get their file numbers from the
+		shuffle bag of PlaylistNext() instead of rand().  Playback
+		file numbers up to P009 are accepted.
+2026-10-14,agnt	The record file name is allocated by RecordSeqNext(), it no
+		longer depends on the file count of the Audio module.  The file
+		count is only queried as long as the record sequence has not
+		been seeded.
+2026-10-14,agnt	Inventory Cache: File count, space left, and the next record
+		number are kept in a no-init RAM block.  If it is valid, the
+		power-up sequence skips GET_SPACE_LEFT and GET_FILE_NUMBERS,
+		the file count is reconciled after a record when the module is
+		idle, see AUDIO_INVENTORY_CACHE.
+2026-10-14,agnt	Keep-warm mode: During ON_TIME the Audio module stays powered
+		until it has been idle for AUDIO_IDLE_TIMEOUT seconds, and is
+		woken up again by the light barrier or a playback request,
+		see AudioIdleCheck().
+2026-10-14,agnt	USART0_RX_IRQHandler, AudioTxDone: Cycles are measured, see
+		ISR_PROFILE.
+		The playback command and its acknowledge are stamped for the
+		latency trace.
+2026-10-14,agnt	AudioFrameHandler: Received frames are logged as debug
+		messages, see LOG_LEVEL_AUDIO.
+2026-10-14,agnt	Added SendFrame() with a transmit ring, several frames can be
+		queued for DMA transmission.
+2026-10-14,agnt	Command frames are built from the const template table
+		l_CmdTemplate[] by AudioFramePatch(), no more sprintf().
+2026-10-14,agnt	Commands are sent via a command queue with expected response,
+		timeout and completion callback.  Configuration values are sent
+		back to back, no more dummy "Stop playback" commands.
+2026-10-14,agnt	Commands are transmitted via DMA channel DMA_CHAN_AUDIO_TX.
+2026-10-14,agnt	Received data is assembled to frames in the RX interrupt and
+		processed by AudioFrameHandler() from AudioCheck().
 2020-07-29,rage	Changed serial driver (avoid requirement for atomic execution).
 2020-07-29,rage	Reworked power management and interrupt handling.
 2019-11-12,Loes	Initial version.
 */
 
 /*=============================== Header Files ===============================*/
-#include <stdlib.h>   // Intializes random number generator 
-#include <time.h>     // Intializes random number generator 
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include "em_gpio.h"
 #include "em_cmu.h"
 #include "em_usart.h"
 #include "em_emu.h"
+#include "em_dma.h"
+#include "em_int.h"
 #include "ExtInt.h"
 #include "config.h"		// include project configuration parameters
 #include "AlarmClock.h"
 #include "Audio.h"
 #include "Logging.h"
 #include "Control.h"
+#include "LightBarrier.h"
+#include "RecordSeq.h"
+#include "ParamStore.h"
+#include "Playlist.h"
+#include "IsrProfile.h"
+#include "ItmTrace.h"
+#include "VisitStats.h"
+#include "StrFormat.h"
+#include "ClockMgr.h"
+#include "Protothread.h"
+#include "DmaChan.h"
+#include "SoundDetect.h"
 
 /*=============================== Definitions ================================*/
 
-    // Module Debugging
-#define MOD_DEBUG	0	// set 1 to enable debugging of this module
+    // Module Log Level
+#ifndef LOG_LEVEL_AUDIO
+    #define LOG_LEVEL_AUDIO	LOG_LEVEL
+#endif
+#undef  LOG_MODULE_LEVEL
+#define LOG_MODULE_LEVEL	LOG_LEVEL_AUDIO
 
-   /*!@brief Internal logical states of the AUDIO system. Used from control.c*/
+   /*!@brief Internal logical states of the AUDIO system.  The states between
+    * AUDIO_GET_WORK_STATUS and AUDIO_SEND_RECORD_STOP also identify the
+    * commands in the command queue. */
 typedef enum
 {
     AUDIO_STATE_OFF,		 //!<   0: Audio system is OFF
@@ -95,7 +284,7 @@ typedef enum
     AUDIO_STATE_SEND_ST,         //!<   6: Send Storage Device Parameter [x]  
     AUDIO_STATE_SEND_IM,         //!<   7: Send Input Mode Parameter [x]
     AUDIO_STATE_SEND_RQ,         //!<   8: Send recording quality Parameter [x]
-    AUDIO_SEND_PLAYBACK,         //!<   9: Send play specific file [P001-P005]
+    AUDIO_SEND_PLAYBACK,         //!<   9: Send play specific file [P001-P999]
     AUDIO_SEND_RECORD,	         //!<  10: Send record specific file [R001]
     AUDIO_SEND_PLAYBACK_STOP,    //!<  11: Send Stop playback
     AUDIO_SEND_RECORD_STOP,	 //!<  12: Send Stop recording
@@ -104,6 +293,19 @@ typedef enum
     END_AUDIO_STATE
 } AUDIO_STATE;
 
+/*!@brief Tiers of the recovery after a communication timeout, see
+ * AudioRecover().  The next tier is entered if the module still does not
+ * respond, a response completes the recovery. */
+typedef enum
+{
+    AUDIO_RECOVER_NONE,		//!< No recovery in progress
+    AUDIO_RECOVER_RESYNC,	//!< Receiver flushed, commands repeated
+    AUDIO_RECOVER_PROBE,	//!< Work status queried as probe
+    AUDIO_RECOVER_RESET,	//!< Receiver of the USART reset, probe again
+    AUDIO_RECOVER_POWER,	//!< Power cycle, last resort
+    END_AUDIO_RECOVER
+} AUDIO_RECOVER;
+
 
     /*!@brief Time in [s] to wait for Audio being ready after power-up. */
 #define POWER_UP_DELAY		5
@@ -111,6 +313,100 @@ typedef enum
     /*!@brief Maximum Communication Error Count before giving up. */
 #define MAX_COM_ERROR_CNT	10
 
+    /*!@brief Start and end delimiter of a framed message. */
+#define AUDIO_FRAME_DELIM	0x7E
+
+    /*!@brief Maximum number of data bytes (opcode and parameters) per frame. */
+#define AUDIO_FRAME_MAX_DATA	8
+
+    /*!@brief Number of received frames the ring can hold, must be 2^n. */
+#define AUDIO_RX_FRAME_CNT	4
+
+    /*!@brief Operation codes of the replies sent by the Audio module. */
+#define AUDIO_OP_WORK_STATUS	0xC2	//!< 4.4.2 Current work status
+#define AUDIO_OP_FILE_NUMBERS	0xC5	//!< 4.4.3 Total file numbers
+#define AUDIO_OP_DEVICE_STATUS	0xCA	//!< 4.4.6 Current status SD or USB
+#define AUDIO_OP_SPACE_LEFT	0xCE	//!< 4.4.9 Space left in storage device
+#define AUDIO_ACK_OK		0x00	//!< Command executed successfully
+#define AUDIO_ACK_FAILED	0x01	//!< Command execution failed
+#define AUDIO_ACK_FAILED_2	0x02	//!< Command execution failed (record)
+
+    /*!@brief Work status of the Audio module, parameter of the 0xC2 reply. */
+#define AUDIO_WORK_UNKNOWN	0x00	//!< Not known, must be queried
+#define AUDIO_WORK_PLAYING	0x01	//!< Playing
+#define AUDIO_WORK_STOPPED	0x02	//!< Stopped
+#define AUDIO_WORK_PAUSED	0x03	//!< Paused
+#define AUDIO_WORK_RECORDING	0x04	//!< Recording
+#define AUDIO_WORK_FAST_FWD	0x05	//!< Fast forward/backward
+
+    /*!@brief Time in [s] after which the work status is queried again. */
+#define AUDIO_STATUS_MAX_AGE	60
+
+    /*!@brief Time in [s] the record rate is observed before the recording
+     * quality is adapted, see AudioRqAdapt(). */
+#define AUDIO_RQ_MIN_OBSERVE	(24 * 3600)
+
+    /*!@brief Value of @ref l_ModuleVC and @ref l_ModuleIM if not known. */
+#define AUDIO_PARM_UNKNOWN	0xFF
+
+    /*!@brief Expected response is an acknowledge byte, see AudioCmdEnqueue(). */
+#define AUDIO_RESP_ACK		AUDIO_ACK_OK
+
+    /*!@brief Size of the transmit ring in bytes, must be 2^n and <= 128. */
+#define AUDIO_TX_RING_SIZE	64
+
+    /*!@brief Number of entries in the command queue, must be 2^n. */
+#define AUDIO_CMD_QUEUE_SIZE	8
+
+    /*!@brief Maximum number of commands sent without having a response. */
+#define AUDIO_CMD_MAX_PENDING	4
+
+    /*!@brief Maximum length of a command frame in bytes. */
+#define AUDIO_CMD_MAX_LEN	10
+
+    /*!@brief Time in [s] to wait for the response to a command. */
+#define AUDIO_CMD_TIMEOUT	10
+
+    /*!@brief Time in [s] to wait for the response to a storage query. */
+#define AUDIO_CMD_TIMEOUT_LONG	60
+
+    /*!@brief Number of commands, i.e. the states AUDIO_GET_WORK_STATUS to
+     * AUDIO_SEND_RECORD_STOP, each has a response time histogram. */
+#define AUDIO_CMD_CNT		(AUDIO_SEND_RECORD_STOP - AUDIO_GET_WORK_STATUS + 1)
+
+    /*!@brief Number of buckets of the response time histogram per command,
+     * bucket n counts responses below AUDIO_LAT_BASE_MS << n. */
+#define AUDIO_LAT_BUCKETS	11
+
+    /*!@brief Upper limit in [ms] of the first histogram bucket. */
+#define AUDIO_LAT_BASE_MS	64
+
+    /*!@brief Number of responses a command needs before its timeout is
+     * learned, up to then the timeout of the template is used. */
+#define AUDIO_LAT_MIN_SAMPLES	16
+
+    /*!@brief Margin in [s] which is added to the 99th percentile. */
+#define AUDIO_TIMEOUT_MARGIN	1
+
+    /*!@brief Lower limit in [s] of a learned timeout, the sTimer has a
+     * granularity of 1s. */
+#define AUDIO_TIMEOUT_MIN	2
+
+#if AUDIO_INVENTORY_CACHE
+    /*!@brief Place a variable into the RAM section which is not cleared at
+     * reset, see @ref l_Inventory. */
+#define AUDIO_NOINIT		__attribute__((section(".noinit")))
+    /*!@brief Magic value of a valid inventory cache ("AINV"). */
+#define AUDIO_INV_MAGIC		((uint32_t)0x41494E56)
+    /*!@brief Highest file number in the map of missing files.  The map takes
+     * 32 bytes instead of 125 bytes for @ref PLAYLIST_MAX_FILE. */
+#define AUDIO_MISSING_MAX_FILE	255
+#endif
+
+
+/*======================== External Data and Routines ========================*/
+
+extern DMA_DESCRIPTOR_TypeDef g_DMA_ControlBlock[];
 
 /*=========================== Typedefs and Structs ===========================*/
 
@@ -122,16 +418,119 @@ typedef struct
     IRQn_Type		   const UART_Rx_IRQn;	//!< Rx interrupt number
     GPIO_Port_TypeDef	   const UART_Rx_Port;	//!< Port for RX pin
     uint32_t		   const UART_Rx_Pin;	//!< Rx pin on this port
-    IRQn_Type		   const UART_Tx_IRQn;	//!< Tx interrupt number
+    unsigned int	   const DMA_Req_Tx;	//!< DMA request for Tx
     GPIO_Port_TypeDef	   const UART_Tx_Port;	//!< Port for TX pin
     uint32_t		   const UART_Tx_Pin;	//!< Tx pin on this port
     uint32_t		   const UART_Route;	//!< Route location
-    uint32_t		   const Baudrate;	//!< Baudrate for the Audio
+    uint32_t		   const Baudrate;	//!< Factory baudrate, fallback
     USART_Databits_TypeDef const DataBits;	//!< Number of data bits
     USART_Parity_TypeDef   const Parity;	//!< Parity mode
     USART_Stopbits_TypeDef const StopBits;	//!< Number of stop bits
 } USART_ParmsAudio;
 
+/*!@brief Frame received from the Audio module.
+ *
+ * Data[0] contains the operation code or acknowledge byte, followed by the
+ * parameters.  Delimiters, length and checksum have already been removed.
+ */
+typedef struct
+{
+    uint8_t	Len;				//!< Number of valid bytes in Data[]
+    uint8_t	Data[AUDIO_FRAME_MAX_DATA];	//!< Opcode and parameters
+    uint32_t	Stamp;				//!< RTC->CNT at the last byte
+} AUDIO_FRAME;
+
+/*!@brief States of the receive frame assembler. */
+typedef enum
+{
+    RX_IDLE,		//!< Waiting for an opcode, acknowledge, or 0x7E
+    RX_RAW,		//!< Collecting the parameters of an unframed reply
+    RX_LEN,		//!< Framed: waiting for the length byte
+    RX_DATA,		//!< Framed: collecting opcode and parameters
+    RX_CSUM,		//!< Framed: waiting for the checksum
+    RX_END		//!< Framed: waiting for the closing 0x7E
+} RX_STATE;
+
+/*!@brief Completion callback of a command, pFrame is NULL on timeout. */
+typedef void (*AUDIO_CMD_CB)(AUDIO_STATE cmd, const AUDIO_FRAME *pFrame);
+
+/*!@brief Entry of the command queue. */
+typedef struct
+{
+    AUDIO_CMD_CB pCallback;		//!< Completion callback, may be NULL
+    uint8_t	Cmd;			//!< Command identifier, @ref AUDIO_STATE
+    uint8_t	RespOp;			//!< Expected response opcode
+    uint8_t	Timeout;		//!< Response timeout in [s]
+    bool	flgOverlap;		//!< Next command may be sent at once
+    bool	flgRetry;		//!< Command has already been repeated
+    uint32_t	SendTime;		//!< ClockMonoTicks() when it was sent
+    uint8_t	Len;			//!< Number of bytes in Frame[]
+    uint8_t	Frame[AUDIO_CMD_MAX_LEN]; //!< Command frame
+} AUDIO_CMD;
+
+/*!@brief Communication statistics of one day, see AudioTelemetryReport(). */
+typedef struct
+{
+    uint16_t	ReqCnt[END_AUDIO_STATE];	//!< Requests per command
+    uint16_t	LatHist[AUDIO_LAT_BUCKETS];	//!< Response times, all commands
+    uint32_t	LatMax;			//!< Longest response time in [ms]
+    uint16_t	CsumErr;		//!< Frames with checksum error
+    uint16_t	FrameErr;		//!< Frames with invalid length or end
+    uint16_t	Overrun;		//!< Frames lost, receive ring full
+    uint16_t	UartFerr;		//!< Bytes with USART framing error
+    uint16_t	UartPerr;		//!< Bytes with USART parity error
+    uint16_t	UartOverrun;		//!< USART receive buffer overflows
+    uint16_t	Timeout;		//!< Commands without response
+    uint16_t	Retry;			//!< Fast retries after a timeout
+    uint16_t	Recover;		//!< Power cycles to recover the module
+    uint16_t	GiveUp;			//!< MAX_COM_ERROR_CNT exceeded
+    uint16_t	RecoverOk[END_AUDIO_RECOVER]; //!< Recoveries per tier
+} AUDIO_TELEMETRY;
+
+/*!@brief Inventory of the storage device of the Audio module. */
+typedef struct
+{
+    uint32_t	Magic;			//!< @ref AUDIO_INV_MAGIC if valid
+    uint16_t	FileCnt;		//!< Total file numbers incl. playback
+    uint16_t	SpaceLeft;		//!< Space left in [MB]
+    uint16_t	Check;			//!< Inverted sum of the fields above
+    uint8_t	Missing[AUDIO_MISSING_MAX_FILE / 8 + 1]; //!< Bit map of missing files
+} AUDIO_INVENTORY;
+
+/*!@brief Status model of the Audio module, see AudioStatusSet(). */
+typedef struct
+{
+    uint8_t	Work;			//!< Work status, see AUDIO_WORK_PLAYING
+    uint32_t	Time;			//!< time() of the last update
+} AUDIO_STATUS;
+
+/*!@brief Context of the power-up session, see AudioSession(). */
+typedef struct
+{
+    PT		Pt;			//!< Continuation of the protothread
+    AUDIO_STATE	WaitCmd;		//!< Awaited command, or END_AUDIO_STATE
+    bool	flgOK;			//!< Response to WaitCmd has been received
+    bool	flgTimer;		//!< Delay of the session is running
+    bool	flgFrame;		//!< Frame has been received, see Frame
+    bool	flgFullSeq;		//!< Retrieve the status information
+    AUDIO_FRAME	Frame;			//!< Response, or power-up prompt
+} AUDIO_SESSION;
+
+/*!@brief Template of a command frame, located in flash.
+ *
+ * The checksum byte is calculated by AudioFramePatch(), so it is specified
+ * as 0x00 here, the same applies to the variable bytes at <i>ParmIdx</i>.
+ */
+typedef struct
+{
+    uint8_t	Len;			//!< Total number of bytes in Frame[]
+    uint8_t	ParmIdx;		//!< Index of the first variable byte
+    uint8_t	RespOp;			//!< Expected response opcode
+    uint8_t	Timeout;		//!< Response timeout in [s]
+    bool	flgOverlap;		//!< Next command may be sent at once
+    uint8_t	Frame[AUDIO_CMD_MAX_LEN]; //!< Frame including delimiters
+} AUDIO_CMD_TEMPLATE;
+
 
 /*========================= Global Data and Routines =========================*/
 
@@ -150,6 +549,22 @@ uint32_t  g_AudioCfg_IM;
    /*!@brief Recording quality(bit rate): Parameter [xx]. */
 uint32_t  g_AudioCfg_RQ;
 
+   /*!@brief Service date as YYYYMMDD, the recording quality is adapted to
+    * last until then, 0 uses @ref g_AudioCfg_RQ all the time. */
+uint32_t  g_AudioServiceDate;
+
+   /*!@brief Idle time in [s] before the Audio module is powered off. */
+uint32_t  g_AudioIdleTimeout = DFLT_AUDIO_IDLE_TIMEOUT;
+
+   /*!@brief Interval in [ms] for playback chaining, 0 disables it. */
+int32_t   g_AudioPlaybackChain = DFLT_PLAYBACK_CHAIN;
+
+   /*!@brief Maximum duration in [s] of a pre-roll record, 0 disables it. */
+uint32_t  g_AudioPreRoll = DFLT_RECORD_PREROLL;
+
+   /*!@brief Maximum length in [ms] of a record file, 0 disables segments. */
+int32_t   g_AudioRecSegment = DFLT_RECORD_SEGMENT;
+
 /*================================ Local Data ================================*/  
 
     /*!@brief Retrieve information after AUDIO module has been initialized. */
@@ -158,12 +573,61 @@ static bool	 l_flgInit;
     /*!@brief Flag that determines if AUDIO module is in use. */
 static bool	 l_flgAudioActivate;
 
+    /*! Command frame templates, addressed via @ref AUDIO_STATE. */
+static const AUDIO_CMD_TEMPLATE l_CmdTemplate[END_AUDIO_STATE] =
+{
+	// 4.4.2 Current work status
+    [AUDIO_GET_WORK_STATUS]	= { 5, 0, AUDIO_OP_WORK_STATUS,
+				    AUDIO_CMD_TIMEOUT, false,
+				    { 0x7E, 0x03, 0xC2, 0x00, 0x7E } },
+	// 4.4.9 Space left in the storage device, needs up to 60s for 32GB
+    [AUDIO_GET_SPACE_LEFT]	= { 5, 0, AUDIO_OP_SPACE_LEFT,
+				    AUDIO_CMD_TIMEOUT_LONG, false,
+				    { 0x7E, 0x03, 0xCE, 0x00, 0x7E } },
+	// 4.4.3 Total file numbers on SD card or USB flash
+    [AUDIO_GET_FILE_NUMBERS]	= { 5, 0, AUDIO_OP_FILE_NUMBERS,
+				    AUDIO_CMD_TIMEOUT_LONG, false,
+				    { 0x7E, 0x03, 0xC5, 0x00, 0x7E } },
+	// 4.3.9. Volume control 1 to 31
+    [AUDIO_STATE_SEND_VC]	= { 6, 3, AUDIO_RESP_ACK,
+				    AUDIO_CMD_TIMEOUT, true,
+				    { 0x7E, 0x04, 0xAE, 0x00, 0x00, 0x7E } },
+	// 4.3.13. Storage device
+    [AUDIO_STATE_SEND_ST]	= { 6, 3, AUDIO_RESP_ACK,
+				    AUDIO_CMD_TIMEOUT, true,
+				    { 0x7E, 0x04, 0xD2, 0x00, 0x00, 0x7E } },
+	// 4.3.14. Input Mode
+    [AUDIO_STATE_SEND_IM]	= { 6, 3, AUDIO_RESP_ACK,
+				    AUDIO_CMD_TIMEOUT, true,
+				    { 0x7E, 0x04, 0xD3, 0x00, 0x00, 0x7E } },
+	// 4.3.15. Recording quality
+    [AUDIO_STATE_SEND_RQ]	= { 6, 3, AUDIO_RESP_ACK,
+				    AUDIO_CMD_TIMEOUT, false,
+				    { 0x7E, 0x04, 0xD4, 0x00, 0x00, 0x7E } },
+	// 4.3.2 Specify playback of a file by name "Pxxx"
+    [AUDIO_SEND_PLAYBACK]	= { 9, 4, AUDIO_RESP_ACK,
+				    AUDIO_CMD_TIMEOUT, false,
+				    { 0x7E, 0x07, 0xA3, 'P', 0x00, 0x00, 0x00, 0x00, 0x7E } },
+	// 4.3.17 Specify recording of a file by name "Rxxx"
+    [AUDIO_SEND_RECORD]		= { 9, 4, AUDIO_RESP_ACK,
+				    AUDIO_CMD_TIMEOUT, false,
+				    { 0x7E, 0x07, 0xD6, 'R', 0x00, 0x00, 0x00, 0x00, 0x7E } },
+	// 4.3.6 Stop playback
+    [AUDIO_SEND_PLAYBACK_STOP]	= { 5, 0, AUDIO_RESP_ACK,
+				    AUDIO_CMD_TIMEOUT, false,
+				    { 0x7E, 0x03, 0xAB, 0x00, 0x7E } },
+	// 4.3.20 Stop recording
+    [AUDIO_SEND_RECORD_STOP]	= { 5, 0, AUDIO_RESP_ACK,
+				    AUDIO_CMD_TIMEOUT, false,
+				    { 0x7E, 0x03, 0xD9, 0x00, 0x7E } },
+};
+
  /*! USART parameters for Audio communication */
 static const USART_ParmsAudio l_Audio_USART =
 {
     USART0, cmuClock_USART0,		//!< select USART0
     USART0_RX_IRQn, gpioPortE, 11,	//!< Rx is PE11
-    USART0_TX_IRQn, gpioPortE, 10,	//!< Tx is PE10
+    DMAREQ_USART0_TXBL, gpioPortE, 10,	//!< Tx is PE10, sent via DMA
     USART_ROUTE_LOCATION_LOC0,		//!< routed thru location #0
     9600, usartDatabits8,		//!< Communication parameters for the
     usartNoParity, usartStopbits1	//!< FN-RM01 MP3 Audio 9600/8/N/1
@@ -175,39 +639,174 @@ static volatile bool	l_flgAudioOn;
     /*! Flag if AUDIO module is currently powered on. */
 static volatile bool	l_flgAudioIsOn;
 
+    /*! Flag if AUDIO was on before the power-fail, see AudioPowerFailResume(). */
+static volatile bool	l_flgAudioResume;
+
     /*! Current state of the Audio system. */
 volatile AUDIO_STATE l_State;
 
+#if ITM_TRACE
+    /*! State of the last ITM trace record, see AudioCheck(). */
+static AUDIO_STATE	l_ItmState = (AUDIO_STATE)-1;
+#endif
+
+    /*! Current baud rate of the link, see @ref AUDIO_BAUDRATE. */
+static uint32_t		l_Baudrate = AUDIO_BAUDRATE;
+
     /*! Timer handle for "Communication Watchdog". */
 static volatile TIM_HDL	l_hdlWdog = NONE;
 
+    /*! Flag if AUDIO may be powered, i.e. during ON_TIME. */
+static volatile bool	l_flgAudioWindow;
+
+    /*! Timer handle for the idle timeout, see @ref g_AudioIdleTimeout. */
+static volatile TIM_HDL	l_hdlIdle = NONE;
+
+    /*! Flag if the idle timer is running. */
+static bool		l_flgIdleRunning;
+
+    /*! Flag set by AudioIdleTimeout(), handled by AudioIdleCheck(). */
+static volatile bool	l_flgIdleOff;
+
+    /*! Timer handle for playback chaining, see @ref g_AudioPlaybackChain. */
+static volatile TIM_HDL	l_hdlChain = NONE;
+
+    /*! Flag set by AudioChainTimeout(), handled by AudioCheck(). */
+static volatile bool	l_flgChainDue;
+
+    /*! File number of the next chained playback, selected in advance. */
+static int		l_ChainFile;
+
+    /*! Timer handle for record segments, see @ref g_AudioRecSegment. */
+static volatile TIM_HDL	l_hdlSegment = NONE;
+
+    /*! Flag set by AudioSegmentTimeout(), handled by AudioCheck(). */
+static volatile bool	l_flgSegmentDue;
+
+    /*! Number of the current segment of a record, 0 for the first file. */
+static int		l_RecSegment;
+
+    /*! The next record continues the current one, see AudioRecord(). */
+static bool		l_flgSegmentNext;
+
+    /*! State of the pre-roll record, see AudioPreRollRequest(). */
+static volatile enum
+{
+    PREROLL_NONE,		//!< no pre-roll record
+    PREROLL_PENDING,		//!< requested, waiting for the Audio module
+    PREROLL_RUNNING,		//!< record is running, no decision yet
+} l_PreRoll;
+
+    /*! Timer handle to limit the pre-roll, see @ref g_AudioPreRoll. */
+static volatile TIM_HDL	l_hdlPreRoll = NONE;
+
+    /*! Flag set by AudioPreRollTimeout(), handled by AudioCheck(). */
+static volatile bool	l_flgPreRollOver;
+
 
     /*! Variables for the communication with the AUDIO module. */
-static char	l_TxBuffer[30];		//!< Transmit buffer 
-static volatile uint8_t l_TxIdx;	//!< Index within the transmit buffer
-static volatile bool	l_flgTxComplete;//!< true: Command has been sent
-static volatile uint8_t	l_ComErrorCnt;	//!< Communication Error Count
-static char	l_RxBuffer[150];	//!< Receive buffer
-static volatile uint8_t	l_RxIdx;	//!< Index within the receive buffer
+static uint8_t	l_TxRing[AUDIO_TX_RING_SIZE]; //!< Transmit ring, DMA source
+static volatile uint8_t	l_TxPut;	//!< Put index, only changed by SendFrame
+static volatile uint8_t	l_TxGet;	//!< Get index, only changed by DMA
+static volatile uint8_t	l_TxDMA_Cnt;	//!< Bytes of running DMA, 0 if idle
+
+    /*! Communication error count per command, see @ref MAX_COM_ERROR_CNT. */
+static volatile uint8_t	l_ComErrorCnt[END_AUDIO_STATE];
+
+    /*! Response time histogram per command, see AudioLatRecord(). */
+static uint8_t		l_LatHist[AUDIO_CMD_CNT][AUDIO_LAT_BUCKETS];
+
+    /*! Communication statistics since the last daily report. */
+static volatile AUDIO_TELEMETRY l_Telem;
+
+    /*! Flag set by AudioTelemetryAlarm(), handled by AudioCheck(). */
+static volatile bool	l_flgTelemReport;
+
+    /*! Receive frame assembler, only accessed by the RX interrupt handler. */
+static volatile RX_STATE l_RxState;	//!< Current state of the assembler
+static AUDIO_FRAME	l_RxFrame;	//!< Frame currently being assembled
+static uint8_t		l_RxRemain;	//!< Number of bytes still expected
+static uint8_t		l_RxCsum;	//!< Running checksum of framed data
+
+    /*! Ring of complete frames, filled by the ISR, read by AudioCheck(). */
+static AUDIO_FRAME	l_RxRing[AUDIO_RX_FRAME_CNT];
+static volatile uint8_t	l_RxPut;	//!< Put index, only changed by ISR
+static volatile uint8_t	l_RxGet;	//!< Get index, only changed by main
+static volatile uint8_t	l_RxErrCnt;	//!< Number of discarded frames
+static volatile uint8_t	l_RxOverrunCnt;	//!< Number of frames lost, ring full
 
-    /*!@brief Counter for l_RxBuffer [0x00] is really received. */
-static volatile int l_CheckData = 1;
+    /*! Command queue, only accessed from the main loop. */
+static AUDIO_CMD	l_CmdQueue[AUDIO_CMD_QUEUE_SIZE];
+static uint8_t		l_CmdPut;	//!< Next free entry
+static uint8_t		l_CmdSend;	//!< Next entry to be sent
+static uint8_t		l_CmdGet;	//!< Oldest entry waiting for response
 
-    /*!@brief l_RxBuffer Command completed set 0 (l_RxIdx). */
-static volatile bool l_flgComCompleted = false;
+    /*! Flag set by AudioComTimeout(), handled by AudioCheck(). */
+static volatile bool	l_flgComTimeout;
 
-    /*!@brief Converter hex into int */
-static volatile int a, b, c, d;
+    /*! Current tier of the recovery, only accessed from the main loop. */
+static AUDIO_RECOVER	l_RecoverTier;
 
-    /*!@brief Current RecordFileNumber */
-static volatile int RecordFileNumber;
-static volatile int digit_1, digit_2, digit_3;
+    /*! Names of the recovery tiers for the log. */
+static const char * const l_RecoverName[END_AUDIO_RECOVER] =
+{ "-", "resync", "probe", "reset", "power cycle" };
 
-    /*!@brief Current state of the PlaybackType: 1 to 9 */
-static volatile int AudioPlaybackType; // is 1 to 9
+    /*! Power-up session, only accessed from the main loop. */
+static AUDIO_SESSION	l_Sess;
 
-    /*!@brief Current state of the PlaybackFileNumber: <= 5 */
-static volatile int PlaybackFileNumber; // is <= 5
+    /*! Status model, only accessed from the main loop. */
+static AUDIO_STATUS	l_Status;
+
+#if AUDIO_INVENTORY_CACHE
+    /*!@brief Inventory cache, kept after a warm reset. */
+static AUDIO_INVENTORY	l_Inventory AUDIO_NOINIT;
+
+    /*!@brief Flag to query the file count when the module is idle. */
+static bool		l_flgReconcile;
+
+    /*!@brief Flag that the inventory has been restored from the flash. */
+static bool		l_flgInvRestored;
+#endif
+
+    /*!@brief Name of the current record file without 'R', see RecordSeqNext(). */
+static char	l_RecName[4];
+
+    /*!@brief Bit rate in [kbps] of the recording quality 0 to 3. */
+static const uint8_t l_RqKbps[4] = { 128, 96, 64, 32 };
+
+    /*!@brief Recording quality which is sent to the module, see AudioRqAdapt(). */
+static uint32_t	l_AudioRQ;
+
+    /*!@brief Volume and input mode of the current ID, or a negative value
+     * for AUDIO_CFG_VC and AUDIO_CFG_IM, see AudioParmSet(). */
+static int32_t	l_ReqVC = -1;
+static int32_t	l_ReqIM = -1;
+
+    /*!@brief Volume and input mode the module has been set to, or
+     * @ref AUDIO_PARM_UNKNOWN after power-on, a flush, or an error. */
+static uint8_t	l_ModuleVC = AUDIO_PARM_UNKNOWN;
+static uint8_t	l_ModuleIM = AUDIO_PARM_UNKNOWN;
+
+    /*!@brief Record rate: time() of the current record, or 0 if none. */
+static uint32_t	l_RecStart;
+
+    /*!@brief Record rate: seconds recorded since @ref l_RecObserveStart. */
+static uint32_t	l_RecSecTotal;
+
+    /*!@brief Record rate: time() when the observation has been started,
+     * 0 if not yet. */
+static uint32_t	l_RecObserveStart;
+
+#if AUDIO_INVENTORY_CACHE
+    /*!@brief Recorded bytes which are not subtracted from the space left yet. */
+static uint32_t	l_RecBytes;
+#endif
+
+    /*!@brief Current state of the PlaybackType: 1 to PLAY_TYPE_MAX */
+static volatile int AudioPlaybackType; // is 1 to 14
+
+    /*!@brief Current state of the PlaybackFileNumber: <= PLAYLIST_MAX_FILE */
+static volatile int PlaybackFileNumber; // is <= 999
 
     /*!@brief Current state of playback run/stop true means RUN, false means STOP. */
 static volatile bool l_flgIsPlayAction;
@@ -231,18 +830,82 @@ static volatile bool l_flgLocked;
 
        /*! AUDIO Communication Timeout */
 static void AudioComTimeout(TIM_HDL hdl);
+static void AudioComTimeoutHandler(void);
+static void AudioRecover(AUDIO_RECOVER tier);
+static void AudioRecoverDone(void);
+
+       /*! AUDIO Keep-Warm Mode */
+static void AudioIdleTimeout(TIM_HDL hdl);
+static void AudioIdleCheck(bool flgRequest);
+
+       /*! Pre-Roll Record */
+static void AudioPreRollTimeout(TIM_HDL hdl);
+static void AudioPreRollStop(const char *pReason);
+
+       /*! Playback Chaining */
+static void AudioChainTimeout(TIM_HDL hdl);
+static void AudioChainCancel(void);
+static void AudioSegmentTimeout(TIM_HDL hdl);
+static int  AudioPlaybackSelect(void);
+
+#if AUDIO_INVENTORY_CACHE
+       /*! AUDIO Inventory Cache */
+static bool AudioInvValid (void);
+static void AudioInvUpdate (int fileCnt, int spaceLeft);
+static void AudioInvSave (void);
+static bool AudioFileMissing (int file);
+static void AudioFileMissingSet (int file);
+#endif
 
       /* Power On AUDIO */
 static void AudioPowerOn(void);
 
-    /*! Start sending a Command Sequence to Audio module. */
-void   AudioSendCmdSeq (AUDIO_STATE state);
+       /*! Adaptive Recording Quality */
+static void AudioRecAccount (void);
+static void AudioRqAdapt (void);
+
+       /*! Per-ID parameters */
+static uint32_t AudioParmVC (void);
+static uint32_t AudioParmIM (void);
+
+    /*! Command queue */
+static bool AudioCmdEnqueue (AUDIO_STATE cmd, const uint8_t *pFrame, int len,
+			     uint8_t respOp, uint8_t timeout, bool flgOverlap,
+			     AUDIO_CMD_CB pCallback);
+static void AudioCmdPump (void);
+static void AudioCmdFlush (void);
+static uint8_t AudioCmdTimeout (const AUDIO_CMD *pCmd);
+static void AudioLatRecord (const AUDIO_CMD *pCmd);
+static uint8_t AudioComErrorMax (void);
+static void AudioTelemetryAlarm (int alarmNum);
+
+    /*! Power-up session */
+static int  AudioSession (void);
+static void AudioSessionCmd (AUDIO_STATE cmd);
+static void AudioSessionResume (AUDIO_STATE cmd, const AUDIO_FRAME *pFrame);
+static void AudioLogDeviceStatus (uint8_t status);
 
-    /*! Check AUDIO data */
-static void CheckAudioData(void);
+    /*! Status model */
+static void AudioStatusSet (uint8_t work);
+static bool AudioStatusStale (void);
+static void AudioStatusNotify (uint8_t work);
+
+    /*! Queue commands for the Audio module */
+static bool AudioQueueCmd (AUDIO_STATE cmd);
+static void AudioCmdDone (AUDIO_STATE cmd, const AUDIO_FRAME *pFrame);
+
+    /*! Start DMA transmission of the transmit ring */
+static void AudioTxDMA_Start (void);
+
+    /*! Handle a frame received from the AUDIO module */
+static void AudioFrameHandler(const AUDIO_FRAME *pFrame);
+
+    /*! Reset receive frame assembler and ring */
+static void AudioRxReset(void);
 
     /*! AUDIO USART Setup Routine */
 static void AudioUartSetup(void);
+static void AudioBaudFallback(void);
 
     /* Playback Actions with Playback_Type <= 9 */
 void   AudioPlayback(void);
@@ -283,7 +946,7 @@ void	AudioInit (void)
 #ifdef LOGGING   
     Log ("Audio Volume control VC is %ld", g_AudioCfg_VC);
 #endif
-    if (g_AudioCfg_VC < 1 | g_AudioCfg_VC > 32)
+    if (g_AudioCfg_VC < 1  ||  g_AudioCfg_VC > 32)
 	LogError("Volume control must be between 1 and 31");
         
 #ifdef LOGGING   
@@ -304,10 +967,75 @@ void	AudioInit (void)
 #endif
     if (g_AudioCfg_RQ > 3)
 	LogError("Recording quality (bit rate) must be between 0 and 3");
+
+    /* The record rate is observed from the next power-up on */
+    l_AudioRQ = g_AudioCfg_RQ;
+    l_RecStart = l_RecSecTotal = l_RecObserveStart = 0;
+#ifdef LOGGING
+    if (g_AudioServiceDate > 0)
+	Log ("Audio Recording quality is adapted until service date %ld",
+	     g_AudioServiceDate);
+#endif
      
     /* Create timer for a "Communication Watchdog" */
     if (l_hdlWdog == NONE)
 	l_hdlWdog = sTimerCreate (AudioComTimeout);
+
+    /* Get the record sequence counter from flash */
+    RecordSeqInit();
+
+    /* Random generator for the playlist */
+    PlaylistInit();
+
+#if AUDIO_INVENTORY_CACHE
+    /* Discard random contents of the no-init RAM after power-on reset */
+    if (! AudioInvValid())
+    {
+	uint32_t inv;
+
+	memset (&l_Inventory, 0, sizeof(l_Inventory));
+
+	/* Take the inventory which has been saved in the flash */
+	if (ParamGet (PARAM_AUDIO_INV, &inv))
+	{
+	    AudioInvUpdate (inv >> 16, inv & 0xFFFF);
+	    l_flgInvRestored = AudioInvValid();
+	}
+    }
+#endif
+
+    /* Create timer for the keep-warm mode */
+    if (l_hdlIdle == NONE)
+	l_hdlIdle = sTimerCreate (AudioIdleTimeout);
+
+    /* Create timer for playback chaining */
+    if (l_hdlChain == NONE)
+	l_hdlChain = msTimerCreate (AudioChainTimeout);
+
+    /* Create timer for record segments */
+    if (l_hdlSegment == NONE)
+	l_hdlSegment = msTimerCreate (AudioSegmentTimeout);
+
+    /* Create timer to limit the pre-roll record */
+    if (l_hdlPreRoll == NONE)
+	l_hdlPreRoll = sTimerCreate (AudioPreRollTimeout);
+
+    /* Log the communication statistics once a day */
+    AlarmAction (ALARM_AUDIO_TELEMETRY, AudioTelemetryAlarm);
+    AlarmSet (ALARM_AUDIO_TELEMETRY, ALARM_AUDIO_TELEM_TIME);
+    AlarmEnable (ALARM_AUDIO_TELEMETRY);
+
+#ifdef LOGGING
+    if (g_AudioIdleTimeout > 0)
+	Log ("Audio is powered off after %lds idle time", g_AudioIdleTimeout);
+    if (g_AudioPlaybackChain > 0)
+	Log ("Audio playbacks are chained every %ldms", g_AudioPlaybackChain);
+    if (g_AudioPreRoll > 0)
+	Log ("Audio pre-roll record of up to %lds", g_AudioPreRoll);
+    if (g_AudioRecSegment > 0)
+	Log ("Audio records are split into segments of %ldms",
+	     g_AudioRecSegment);
+#endif
 }
 
 
@@ -315,170 +1043,609 @@ void	AudioInit (void)
  *
  * @brief	Receive from control.c new Play_Type
  *
- * This routine get the new PlayType from control.c
+ * This routine get the new PlayType from control.c and starts the playback
+ * of the file selected by AudioPlaybackSelect().
  *
  ******************************************************************************/
 void AudioPlayback()
 {
+   PlaybackFileNumber = AudioPlaybackSelect();
 
-time_t t;  
-srand((unsigned) time(&t)); // Init only once ??
-
-   if (AudioPlaybackType <= 5)
-   {
-      PlaybackFileNumber = AudioPlaybackType;
-      /*! Start sending a Command Sequence to AUDIO module. */
-      AudioSendCmdSeq(AUDIO_SEND_PLAYBACK);
-   }
-   else
+#if AUDIO_INVENTORY_CACHE
+   /* A missing file is not sent, the record does not wait for its stop */
+   if (PlaybackFileNumber < 0)
    {
-      if (AudioPlaybackType == 6)
-      {
-         PlaybackFileNumber = rand() % 2 + 1;// generate number between 1 and 2
-      } 
-      else if (AudioPlaybackType == 7)
-      {
-         PlaybackFileNumber = rand() % 3 + 1;// generate number between 1 and 3
-      }    
-      else if (AudioPlaybackType == 8)
-      {
-         PlaybackFileNumber = rand() % 4 + 1;// generate number between 1 and 4
-      }
-      else if (AudioPlaybackType == 9)
-      {
-         PlaybackFileNumber = rand() % 5 + 1;// generate number between 1 and 5
-      }
-      /*! Start sending a Command Sequence to AUDIO module. */
-      AudioSendCmdSeq(AUDIO_SEND_PLAYBACK);
+      PlaybackFileNumber = 0;
+      l_flgIsRecordBlocked = false;
+      return;
    }
+#endif
+
+   /* Per-ID volume, pipelined with the playback if not already set */
+   if (AudioParmVC() != 0  &&  AudioParmVC() != l_ModuleVC)
+      AudioQueueCmd(AUDIO_STATE_SEND_VC);
+
+   /*! Queue command for the AUDIO module. */
+   AudioQueueCmd(AUDIO_SEND_PLAYBACK);
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Receive from control.c Record
+ * @brief	Set the Audio Parameters of a Transponder ID
+ *
+ * This routine is called by ControlUpdateID() with the volume and input mode
+ * of the current ID.  They are not sent now, but by AudioPlayback() and
+ * AudioRecord() in the same burst as their command, and only if the module
+ * has been set to another value before.  So an ID with its own settings does
+ * not wait for additional responses.
  *
- * This routine send number of record files into AUDIO.c  
+ * @param[in] volume
+ *	Volume 1 to 31, a negative value selects AUDIO_CFG_VC.
+ *
+ * @param[in] inputMode
+ *	Input mode 0 to 2, a negative value selects AUDIO_CFG_IM.
  *
  ******************************************************************************/
-void    AudioRecord(void)
+void AudioParmSet (int32_t volume, int32_t inputMode)
 {
-    RecordFileNumber++;    
-    digit_1 = (RecordFileNumber % 10);                       // 001
-    digit_2 = (((RecordFileNumber - digit_1) % 100) / 10);   // 010
-    digit_3 = (((RecordFileNumber - digit_2) % 1000) / 100); // 100
-    
-    if (digit_3 >= 9 && digit_2 >= 8 && digit_1 >= 0)
-    {
-      /* [R980.wav] reached */
-       LogError("Audio: Supports maximum 999 record files");
-    }
-    
-    digit_1 = digit_1 + 48; // 0 into 48 dez
-    digit_2 = digit_2 + 48; // 0 into 48 dez
-    digit_3 = digit_3 + 48; // 0 into 48 dez
-      
-    /*! Start sending a Command Sequence to AUDIO module. */
-    AudioSendCmdSeq(AUDIO_SEND_RECORD); 
+    l_ReqVC = volume;
+    l_ReqIM = inputMode;
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Enable AUDIO module
+ * @brief	Volume and Input Mode to Send
  *
- * This routine enables the audio module, i.e. it notifies the audio module 
- * software to power up and initialize the module and the related hardware.
- * It is usually called by PowerControl().
+ * These routines return the value of the current ID, or the configured one,
+ * which may have been reduced by the energy governor meanwhile.
  *
- * @see AudioDisable(), AudioTimedDisable(), AudioCheck()
+ ******************************************************************************/
+static uint32_t AudioParmVC (void)
+{
+    return (l_ReqVC < 0 ? g_AudioCfg_VC : (uint32_t)l_ReqVC);
+}
+
+static uint32_t AudioParmIM (void)
+{
+    return (l_ReqIM < 0 ? g_AudioCfg_IM : (uint32_t)l_ReqIM);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Select the File for a Playback
+ *
+ * The PLAYBACK_TYPEs 1 to 5 play this file, all others get the next file of
+ * the playlist sequence, see PlaylistNext().  Files which are known to be
+ * missing are skipped, the random types take the next file of the sequence
+ * instead.
+ *
+ * @return
+ *	File number of the playback, or -1 if all files are missing.
  *
  ******************************************************************************/
-void AudioEnable(void)
+static int AudioPlaybackSelect(void)
 {
-    /* initiate power-on of the AUDIO hardware */
-    l_flgAudioOn = true;
+#if AUDIO_INVENTORY_CACHE
+int	file, tries;
+
+   if (AudioPlaybackType <= PLAY_TYPE_FIXED_MAX)
+      return (AudioFileMissing(AudioPlaybackType) ? -1 : AudioPlaybackType);
+
+   for (tries = 0;  tries < PLAYLIST_SEQ_SIZE;  tries++)
+   {
+      file = PlaylistNext(AudioPlaybackType);
+      if (! AudioFileMissing(file))
+	 return file;
+   }
+   return -1;
+#else
+   if (AudioPlaybackType <= PLAY_TYPE_FIXED_MAX)
+      return AudioPlaybackType;
+
+   return PlaylistNext(AudioPlaybackType);
+#endif
 }
 
+
 /***************************************************************************//**
  *
- * @brief	Disable AUDIO module
+ * @brief	Playback Chaining Timeout
  *
- * This routine immediately disables the AUDIO module.
+ * This routine is called from the RTC interrupt handler when the current
+ * file has been played for @ref g_AudioPlaybackChain milliseconds.  It only
+ * sets a flag, the next file is sent by AudioCheck().
  *
- * @see AudioEnable(), AudioCheck()
+ ******************************************************************************/
+static void AudioChainTimeout(TIM_HDL hdl)
+{
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    l_flgChainDue = true;
+    EVENT_POST(EVT_AUDIO);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Cancel Playback Chaining
+ *
+ * This routine stops the chaining timer, e.g. at the end of the KEEP_PLAYBACK
+ * duration.  A file which has already been selected is discarded.
  *
  ******************************************************************************/
-void AudioDisable (void)
+static void AudioChainCancel(void)
 {
-    if (l_flgAudioOn)
-    {
-	l_flgAudioOn = false;    
-       
-	/* Audio module should be powered OFF */
-	if (l_flgAudioIsOn)
-	{
-	    AudioPowerOff();
-	    l_flgAudioIsOn = false;
-	}
-    }
+    if (l_hdlChain != NONE)
+	msTimerCancel (l_hdlChain);
+
+    l_flgChainDue = false;
+    l_ChainFile = 0;
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Power Audio module On
+ * @brief	Record Segment Timeout
  *
- * This routine powers the Audio module on and initializes the related hardware.
+ * This routine is called from the RTC interrupt handler when the current
+ * record file has been recorded for @ref g_AudioRecSegment milliseconds.  It
+ * only sets a flag, the next segment is started by AudioCheck().
  *
  ******************************************************************************/
-static void AudioPowerOn (void)
+static void AudioSegmentTimeout(TIM_HDL hdl)
 {
-    if (l_flgAudioActivate)
-    {      
-#ifdef LOGGING
-	/* Generate Log Message */
-	Log ("Audio is powered ON");
-#endif
-         
-    /* (Re-)initialize variables */
-    l_flgTxComplete = false;
-    l_RxIdx = l_TxIdx = 0;
-   
-    /* Module Audio requires EM1, set bit in bit mask */
-    Bit(g_EM1_ModuleMask, EM1_MOD_AUDIO) = 1;
-    
-    /* Prepare UART to communicate with AUDIO module */
-    AudioUartSetup();
-    
-    /* Set Power Enable Pin for the scales hardware to ON */
-    PowerOutput (g_AudioPower, PWR_ON);
-     
-    /* Wait some time until Audio is up and running */
-    l_State = AUDIO_STATE_POWER_ON;
-    /* Log Message see state =  AUDIO_STATE_POWER_ON */
-    
-    l_flgAudioInitIsDone = false;
-    l_flgLocked = false;
-   }
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    l_flgSegmentDue = true;
+    EVENT_POST(EVT_AUDIO);
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Audio Check
+ * @brief	Account a Record
  *
- * This routine is called from main.c
+ * This routine is called when a record has been stopped.  Its duration is
+ * added to the observed record rate.  With @ref AUDIO_INVENTORY_CACHE, the
+ * size of the file is estimated from the bit rate and subtracted from the
+ * cached space left, since the space left is not queried again.
  *
  ******************************************************************************/
-void	AudioCheck (void)
+static void AudioRecAccount (void)
 {
-   bool	isControlPlayRun, isControlPlayStop;
-   bool	isControlRecRun, isControlRecStop;
-   int  isControlPlaybackType;
-  
-   /* Get current state of playback run and stop from control.c */
-   isControlPlayRun  = IsControlPlayRun();
+uint32_t sec;
+#if AUDIO_INVENTORY_CACHE
+uint32_t mb;
+#endif
+
+    if (l_RecStart == 0)
+	return;			// no record running
+
+    sec = (uint32_t)time(NULL) - l_RecStart;
+    l_RecStart = 0;
+    l_RecSecTotal += sec;
+
+#if AUDIO_INVENTORY_CACHE
+    l_RecBytes += sec * l_RqKbps[l_AudioRQ & 3] * 125;
+    mb = l_RecBytes >> 20;
+    if (mb > 0  &&  AudioInvValid())
+    {
+	l_RecBytes -= mb << 20;
+	AudioInvUpdate (l_Inventory.FileCnt, l_Inventory.SpaceLeft > mb
+			? l_Inventory.SpaceLeft - mb : 0);
+    }
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Adapt the Recording Quality
+ *
+ * This routine is called by AudioSession() before the recording quality is
+ * sent to the module.  If @ref g_AudioServiceDate is set, the best quality,
+ * but not better than @ref g_AudioCfg_RQ, is chosen which lets the space
+ * left last until the service date at the observed record rate.  The
+ * forecast is logged.
+ *
+ * The observation of the record rate starts with the first call, i.e. when
+ * the module is powered during ON_TIME, the clock has usually been set
+ * then.  The quality is only adapted after the record rate has been
+ * observed for @ref AUDIO_RQ_MIN_OBSERVE seconds, and if the space left is
+ * known from the inventory cache, see @ref AUDIO_INVENTORY_CACHE.
+ *
+ ******************************************************************************/
+static void AudioRqAdapt (void)
+{
+uint32_t now = (uint32_t)time(NULL);
+#if AUDIO_INVENTORY_CACHE
+struct tm svc;
+uint32_t observed, days, secPerDay, kbPerDay, needMB;
+uint32_t rq;
+#endif
+
+    if (l_RecObserveStart == 0)
+	l_RecObserveStart = now;
+
+#if AUDIO_INVENTORY_CACHE
+    if (g_AudioServiceDate == 0)
+	return;
+
+    if (! AudioInvValid())
+	return;
+
+    observed = now - l_RecObserveStart;
+    if (observed < AUDIO_RQ_MIN_OBSERVE)
+	return;
+
+    /* The system clock uses a 2-digit year, i.e. counts from 2000 */
+    memset (&svc, 0, sizeof(svc));
+    svc.tm_year = g_AudioServiceDate / 10000 - 2000;
+    svc.tm_mon  = (g_AudioServiceDate / 100) % 100 - 1;
+    svc.tm_mday = g_AudioServiceDate % 100;
+    days = (uint32_t)mktime (&svc);
+    days = (days > now ? (days - now) / (24 * 3600) + 1 : 0);
+
+    secPerDay = l_RecSecTotal / (observed / (24 * 3600));
+
+    /* Lower the quality until the space left is sufficient */
+    for (rq = (g_AudioCfg_RQ < 3 ? g_AudioCfg_RQ : 3);  ;  rq++)
+    {
+	kbPerDay = secPerDay * l_RqKbps[rq] * 125 / 1024;
+	needMB = kbPerDay / 1024 * days + (kbPerDay % 1024) * days / 1024;
+	if (needMB <= l_Inventory.SpaceLeft  ||  rq == 3)
+	    break;
+    }
+
+    Log ("Audio: Forecast %ld days, %lds/day recorded, %dkbps needs"
+	 " %ldMB of %dMB", days, secPerDay, l_RqKbps[rq], needMB,
+	 l_Inventory.SpaceLeft);
+    if (needMB > l_Inventory.SpaceLeft)
+	LOG_WARN ("Audio: Storage device will be full before service date");
+
+    l_AudioRQ = rq;
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Storage Consumption of the Audio Module
+ *
+ * This routine returns the space left of the storage device and the
+ * consumption per day, which is estimated from the observed record rate and
+ * the bit rate of the current recording quality, see AudioRqAdapt().  No
+ * command is sent to the module.
+ *
+ * @param[out] pSpaceMB
+ *	Space left of the storage device in [MB], see @ref l_Inventory.
+ *
+ * @param[out] pKbPerDay
+ *	Consumption in [KB] per day.
+ *
+ * @return
+ *	The value <i>true</i> if the space left is known, and the record rate
+ *	has been observed for @ref AUDIO_RQ_MIN_OBSERVE seconds.
+ *
+ ******************************************************************************/
+bool	AudioStorageForecast (uint32_t *pSpaceMB, uint32_t *pKbPerDay)
+{
+#if AUDIO_INVENTORY_CACHE
+uint32_t observed, secPerDay;
+
+    if (l_RecObserveStart == 0  ||  ! AudioInvValid())
+	return false;
+
+    observed = (uint32_t)time(NULL) - l_RecObserveStart;
+    if (observed < AUDIO_RQ_MIN_OBSERVE)
+	return false;
+
+    secPerDay = l_RecSecTotal / (observed / (24 * 3600));
+    *pSpaceMB  = l_Inventory.SpaceLeft;
+    *pKbPerDay = secPerDay * l_RqKbps[l_AudioRQ & 3] * 125 / 1024;
+    return true;
+#else
+    (void) pSpaceMB;	// suppress compiler warnings "unused parameter"
+    (void) pKbPerDay;
+    return false;
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Receive from control.c Record
+ *
+ * This routine allocates the name of the next record file, see
+ * RecordSeqNext(), and starts the recording.
+ *
+ ******************************************************************************/
+void    AudioRecord(void)
+{
+    if (! RecordSeqIsValid())
+	LOG_WARN ("Audio: Record sequence is not seeded by the file count");
+
+    RecordSeqNext (l_RecName);
+
+    /* A segment continues the record, otherwise a new record starts */
+    l_RecSegment = (l_flgSegmentNext ? l_RecSegment + 1 : 0);
+    l_flgSegmentNext = false;
+
+#if AUDIO_INVENTORY_CACHE
+    /* This file number is used now, also after a warm reset */
+    if (AudioInvValid())
+	AudioInvUpdate (l_Inventory.FileCnt + 1, l_Inventory.SpaceLeft);
+#endif
+
+    /* Per-ID input mode, pipelined with the record if not already set */
+    if (AudioParmIM() != l_ModuleIM)
+	AudioQueueCmd(AUDIO_STATE_SEND_IM);
+
+    /*! Queue command for the AUDIO module. */
+    AudioQueueCmd(AUDIO_SEND_RECORD);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Enable AUDIO module
+ *
+ * This routine enables the audio module, i.e. it notifies the audio module 
+ * software to power up and initialize the module and the related hardware.
+ * It is usually called by PowerControl().
+ *
+ * @see AudioDisable(), AudioTimedDisable(), AudioCheck()
+ *
+ ******************************************************************************/
+void AudioEnable(void)
+{
+    /* initiate power-on of the AUDIO hardware */
+    l_flgAudioWindow = true;
+    l_flgAudioOn = true;
+    EVENT_POST(EVT_AUDIO);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Disable AUDIO module
+ *
+ * This routine immediately disables the AUDIO module.
+ *
+ * @see AudioEnable(), AudioCheck()
+ *
+ ******************************************************************************/
+void AudioDisable (void)
+{
+    l_flgAudioWindow = false;
+    l_flgAudioResume = false;
+
+    /* be sure to cancel the idle timer */
+    if (l_hdlIdle != NONE)
+	sTimerCancel (l_hdlIdle);
+    l_flgIdleRunning = false;
+    l_flgIdleOff = false;
+
+    if (l_flgAudioOn)
+    {
+	l_flgAudioOn = false;    
+       
+	/* Audio module should be powered OFF */
+	if (l_flgAudioIsOn)
+	{
+	    AudioPowerOff();
+	    l_flgAudioIsOn = false;
+	}
+    }
+    EVENT_POST(EVT_AUDIO);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Wake-up AUDIO module
+ *
+ * This routine is called by the light barrier handler for the first edge of
+ * a visit.  In keep-warm mode, i.e. if @ref g_AudioIdleTimeout is set, the
+ * Audio module is powered on again if it has been switched off after being
+ * idle.  The power-up delay then elapses while the bird approaches.
+ *
+ ******************************************************************************/
+void AudioWake (void)
+{
+    if (g_AudioIdleTimeout > 0  &&  l_flgAudioWindow  &&  ! l_flgAudioOn)
+    {
+	l_flgAudioOn = true;
+	EVENT_POST(EVT_AUDIO);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Request a Pre-Roll Record
+ *
+ * This routine is called by the light barrier handler for the first edge of
+ * a visit, i.e. from interrupt context.  If @ref g_AudioPreRoll is set, a
+ * record is started by AudioCheck() as soon as the Audio module is idle, so
+ * the vocalizations of the arrival are recorded while the transponder is
+ * still being read.  The later ID decision calls AudioPreRollDecide().
+ * If there is no decision within @ref g_AudioPreRoll seconds, the record is
+ * stopped.
+ *
+ ******************************************************************************/
+void AudioPreRollRequest (void)
+{
+    if (g_AudioPreRoll == 0  ||  ! l_flgAudioWindow  ||  l_PreRoll != PREROLL_NONE)
+	return;
+
+    l_PreRoll = PREROLL_PENDING;
+    l_flgPreRollOver = false;
+
+    if (l_hdlPreRoll != NONE)
+	sTimerStart (l_hdlPreRoll, g_AudioPreRoll);
+
+    EVENT_POST(EVT_AUDIO);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Decide about the Pre-Roll Record
+ *
+ * This routine is called by ControlUpdateID() when the parameters of the
+ * transponder ID are known:
+ * - No playback, but a KEEP_RECORD duration: the pre-roll record is just
+ *   continued as the regular record, no new file is started.
+ * - A playback and a KEEP_RECORD duration: the pre-roll record is stopped
+ *   and kept, the playback and the regular record follow.
+ * - No KEEP_RECORD duration: the record is stopped and logged as not
+ *   needed.  The Audio module has no command to delete a file, so it stays
+ *   on the card and can be removed by its name.
+ *
+ * @param[in] keepPlayback
+ *	KEEP_PLAYBACK duration of the transponder ID.
+ *
+ * @param[in] keepRecord
+ *	KEEP_RECORD duration of the transponder ID.
+ *
+ * @return
+ *	The value <i>true</i> if the pre-roll record continues as the regular
+ *	record.
+ *
+ ******************************************************************************/
+bool	AudioPreRollDecide (int32_t keepPlayback, int32_t keepRecord)
+{
+    if (l_PreRoll == PREROLL_NONE)
+	return false;
+
+    if (l_hdlPreRoll != NONE)
+	sTimerCancel (l_hdlPreRoll);
+
+    if (l_PreRoll == PREROLL_PENDING)
+    {
+	l_PreRoll = PREROLL_NONE;	// not started yet
+	return false;
+    }
+
+    if (keepRecord > 0  &&  keepPlayback == 0)
+    {
+	l_PreRoll = PREROLL_NONE;
+	Log ("Audio: Pre-roll R%s.wav continues as record", l_RecName);
+	return true;
+    }
+
+    AudioPreRollStop (keepRecord > 0 ? NULL : "not needed");
+    return false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Pre-Roll Timeout
+ *
+ * This routine is called from the RTC interrupt handler if there was no ID
+ * decision within @ref g_AudioPreRoll seconds.  It only sets a flag, the
+ * record is stopped by AudioCheck().
+ *
+ ******************************************************************************/
+static void AudioPreRollTimeout(TIM_HDL hdl)
+{
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    l_flgPreRollOver = true;
+    EVENT_POST(EVT_AUDIO);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop the Pre-Roll Record
+ *
+ * This routine stops a running pre-roll record.
+ *
+ * @param[in] pReason
+ *	Reason why the file is not needed, or NULL if the file is kept.
+ *
+ ******************************************************************************/
+static void AudioPreRollStop(const char *pReason)
+{
+    if (l_PreRoll == PREROLL_RUNNING)
+    {
+	if (pReason != NULL)
+	    Log ("Audio: Pre-roll R%s.wav %s, may be deleted", l_RecName, pReason);
+
+	l_flgIsRecAction = false;
+	AudioQueueCmd(AUDIO_SEND_RECORD_STOP);
+    }
+    l_PreRoll = PREROLL_NONE;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Power Audio module On
+ *
+ * This routine powers the Audio module on and initializes the related hardware.
+ *
+ ******************************************************************************/
+static void AudioPowerOn (void)
+{
+    if (l_flgAudioActivate)
+    {      
+#ifdef LOGGING
+	/* Generate Log Message */
+	Log ("Audio is powered ON");
+#endif
+         
+    /* (Re-)initialize variables */
+    l_TxPut = l_TxGet = l_TxDMA_Cnt = 0;
+    l_flgComTimeout = false;
+    AudioRxReset();
+    AudioCmdFlush();
+   
+    /* Module Audio requires EM1 */
+    EM1_Acquire (EM1_MOD_AUDIO);
+    
+    /* Prepare UART to communicate with AUDIO module */
+    AudioUartSetup();
+    
+    /* Set Power Enable Pin for the scales hardware to ON */
+    PowerOutput (g_AudioPower, PWR_ON);
+     
+    /* Wait some time until Audio is up and running, see AudioSession() */
+    l_State = AUDIO_STATE_POWER_ON;
+    PT_INIT(&l_Sess.Pt);
+    l_Sess.WaitCmd  = END_AUDIO_STATE;
+    l_Sess.flgTimer = false;
+    l_Sess.flgFrame = false;
+    l_Status.Work   = AUDIO_WORK_UNKNOWN;
+    
+    l_flgAudioInitIsDone = false;
+    l_flgLocked = false;
+   }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Audio Check
+ *
+ * This routine is called from main.c
+ *
+ ******************************************************************************/
+void	AudioCheck (void)
+{
+   bool	isControlPlayRun, isControlPlayStop;
+   bool	isControlRecRun, isControlRecStop;
+   int  isControlPlaybackType;
+   AUDIO_FRAME frame;
+   uint8_t errCnt, overrunCnt;
+  
+   /* Get current state of playback run and stop from control.c */
+   isControlPlayRun  = IsControlPlayRun();
    isControlPlayStop = IsControlPlayStop();
    
    /* Get current state of record run and stop from control.c*/
@@ -510,12 +1677,19 @@ void	AudioCheck (void)
 	    AudioPowerOff();
 	    l_flgAudioIsOn = false;
             l_flgSingleAction = false;
+#if AUDIO_INVENTORY_CACHE
+	    AudioInvSave();
+#endif
             
              /* Replay external interrupts to consider new power state */
              ExtIntReplay();
    	}
     }   
 
+   /* Keep-warm mode: power-off when idle, wake-up on request */
+   if (g_AudioIdleTimeout > 0  &&  l_flgAudioWindow)
+      AudioIdleCheck (isControlPlayRun || isControlRecRun);
+
      /* Start Audio Playback */
    if (isControlPlayRun && !isControlPlayStop && !l_flgIsPlayAction)
    {
@@ -538,16 +1712,61 @@ void	AudioCheck (void)
       }
    }
 
+   /* Playback chaining: send the next file at the deadline, no stop */
+   if (l_flgChainDue)
+   {
+      l_flgChainDue = false;
+      if (isControlPlayRun && !isControlPlayStop && l_flgIsPlayAction
+      &&  l_ChainFile > 0)
+      {
+         PlaybackFileNumber = l_ChainFile;
+         l_ChainFile = 0;
+         AudioQueueCmd(AUDIO_SEND_PLAYBACK);
+      }
+   }
+
+   /* Record segments: stop and start the next file in one burst */
+   if (l_flgSegmentDue)
+   {
+      l_flgSegmentDue = false;
+      if (isControlRecRun && !isControlRecStop && l_flgIsRecAction)
+      {
+         AudioQueueCmd(AUDIO_SEND_RECORD_STOP);
+         l_flgSegmentNext = true;
+         AudioRecord();
+      }
+   }
+
    /* Stop Audio Playback */
    if (isControlPlayStop && !isControlPlayRun  && l_flgIsPlayAction)   
    {
       l_flgIsPlayAction = false;
-      /*! Start sending a Command Sequence to AUDIO module. */
-      AudioSendCmdSeq(AUDIO_SEND_PLAYBACK_STOP);
+      AudioChainCancel();
+      /*! Queue command for the AUDIO module. */
+      AudioQueueCmd(AUDIO_SEND_PLAYBACK_STOP);
    }
    
+#if SOUND_DETECT
+   /* Listen for sound while a record is requested */
+   SoundDetectArm (isControlRecRun && !isControlRecStop && l_flgAudioIsOn);
+
+   /* Pause the record after the hang time of the sound detector */
+   if (isControlRecRun && l_flgIsRecAction && !SoundIsActive()
+   &&  l_PreRoll != PREROLL_RUNNING)
+   {
+      l_flgIsRecAction = false;
+      Log ("Audio: Record paused, no sound for %lds", g_SoundHangTime);
+      /*! Queue command for the AUDIO module. */
+      AudioQueueCmd(AUDIO_SEND_RECORD_STOP);
+   }
+#endif
+
    /* Start Audio Record */
-   if (isControlRecRun && !isControlRecStop && !l_flgIsRecAction && !l_flgIsRecordBlocked)
+   if (isControlRecRun && !isControlRecStop && !l_flgIsRecAction && !l_flgIsRecordBlocked
+#if SOUND_DETECT
+   &&  SoundIsActive()
+#endif
+   )
    {
       if (l_flgAudioInitIsDone)
       {
@@ -567,14 +1786,101 @@ void	AudioCheck (void)
       }
    } 
 
-   /* Stop Audio Record */
-   if (isControlRecStop && !isControlRecRun && l_flgIsRecAction) 
+   /* Pre-roll record, requested by the light barrier */
+   if (l_flgPreRollOver)
+   {
+      l_flgPreRollOver = false;
+      AudioPreRollStop("without ID decision");
+   }
+   if (l_PreRoll == PREROLL_PENDING  &&  l_flgAudioInitIsDone
+   &&  !l_flgIsPlayAction && !l_flgIsRecAction && !l_flgIsRecordBlocked
+   &&  !isControlPlayRun && !isControlRecRun)
+   {
+      l_PreRoll = PREROLL_RUNNING;
+      l_flgIsRecAction = true;
+      Log ("Audio: Pre-roll record");
+      AudioRecord();
+   }
+
+   /* Stop Audio Record, but not the pre-roll record of a new visit */
+   if (isControlRecStop && !isControlRecRun && l_flgIsRecAction
+   &&  l_PreRoll != PREROLL_RUNNING) 
    {
       l_flgIsRecAction = false; 
-      /*! Start sending a Command Sequence to AUDIO module. */
-      AudioSendCmdSeq(AUDIO_SEND_RECORD_STOP);
+      /*! Queue command for the AUDIO module. */
+      AudioQueueCmd(AUDIO_SEND_RECORD_STOP);
    }
+
+   /* Handle communication timeout */
+   if (l_flgComTimeout)
+   {
+      l_flgComTimeout = false;
+      AudioComTimeoutHandler();
+   }
+
+   /* Report frames which have been discarded by the RX interrupt handler */
+   if (l_RxErrCnt != 0  ||  l_RxOverrunCnt != 0)
+   {
+      INT_Disable();
+      errCnt = l_RxErrCnt;
+      overrunCnt = l_RxOverrunCnt;
+      l_RxErrCnt = l_RxOverrunCnt = 0;
+      INT_Enable();
+
+      if (errCnt)
+      {
+	 LogError("Audio: %d invalid frame(s) discarded", errCnt);
+	 if (l_Baudrate != l_Audio_USART.Baudrate)
+	    AudioBaudFallback();
+      }
+      if (overrunCnt)
+	 LogError("Audio: %d frame(s) lost, receive ring full", overrunCnt);
+   }
+
+   /* Daily report of the communication statistics */
+   if (l_flgTelemReport)
+   {
+      l_flgTelemReport = false;
+      AudioTelemetryReport(true);
+   }
+
+   /* Process all frames which have been received from the Audio module */
+   while (l_RxGet != l_RxPut)
+   {
+      frame = l_RxRing[l_RxGet % AUDIO_RX_FRAME_CNT];
+      l_RxGet++;		// release slot for the ISR
+      AudioFrameHandler(&frame);
+      EVENT_POST(EVT_AUDIO);	// state may have changed, check again
+   }
+
+   /* Continue the power-up session, it may wait for the frames above */
+   if (l_flgAudioIsOn)
+      AudioSession();
+
+#if AUDIO_INVENTORY_CACHE
+   /* Reconcile the file count when the module is idle after a record */
+   if (l_flgReconcile  &&  l_State == AUDIO_STATE_OPERATIONAL
+   &&  l_CmdGet == l_CmdPut  &&  ! l_flgIsPlayAction  &&  ! l_flgIsRecAction
+   &&  g_LB_ActiveMask == 0)
+   {
+      l_flgReconcile = false;
+      AudioQueueCmd(AUDIO_GET_FILE_NUMBERS);
+   }
+#endif
+
+   /* Send the next command(s) if the USART is available again */
+   AudioCmdPump();
+
+#if ITM_TRACE
+   /* Trace the transitions of the state since the last call */
+   if (l_State != l_ItmState)
+   {
+      l_ItmState = l_State;
+      ITM_TRACE_STATE(ITM_MOD_AUDIO, l_ItmState);
+   }
+#endif
 }
+TASK_REGISTER(TASK_PRIO_AUDIO, EVT_AUDIO, AudioCheck);
 /***************************************************************************//**
  *
  * @brief	Determine if Audio Module is locked  
@@ -611,9 +1917,16 @@ void AudioPowerOff (void)
       
     /* Clear Audio-related error conditions */
     ClearError(ERR_SRC_AUDIO);
+
+    /* Abort a DMA transfer which may still be in progress, clear the ring */
+    DMA->CHENC = (1 << DMA_CHAN_AUDIO_TX);
+    l_TxPut = l_TxGet = l_TxDMA_Cnt = 0;
+
+    /* Discard all commands */
+    AudioCmdFlush();
   
-    /* Disable clock for USART module */
-    CMU_ClockEnable(l_Audio_USART.cmuClock_UART, false);
+    /* Release clock for USART module */
+    ClockRelease (CLK_OWN_AUDIO, l_Audio_USART.cmuClock_UART);
 
     /* Disable Rx and Tx pins */
     GPIO_PinModeSet(l_Audio_USART.UART_Rx_Port,
@@ -621,8 +1934,8 @@ void AudioPowerOff (void)
     GPIO_PinModeSet(l_Audio_USART.UART_Tx_Port,
 		    l_Audio_USART.UART_Tx_Pin, gpioModeDisabled, 0);
     
-    /* Module Audio is no longer active, clear bit in bit mask */
-    Bit(g_EM1_ModuleMask, EM1_MOD_AUDIO) = 0;
+    /* Module Audio is no longer active */
+    EM1_Release (EM1_MOD_AUDIO);
 
 #ifdef LOGGING
     /* Generate Log Message */
@@ -634,6 +1947,14 @@ void AudioPowerOff (void)
     l_flgSingleAction = true;
     l_flgIsPlayAction = false;
     l_flgAudioInitIsDone = false;
+    AudioChainCancel();
+    if (l_hdlSegment != NONE)
+	msTimerCancel (l_hdlSegment);
+    l_flgSegmentDue = false;
+    AudioRecAccount();		// a running record ends here
+    if (l_PreRoll == PREROLL_RUNNING)
+	l_flgIsRecAction = false;
+    l_PreRoll = PREROLL_NONE;
 }
   
 
@@ -648,7 +1969,8 @@ void AudioPowerOff (void)
 void	AudioPowerFailHandler (void)
 {
  
-    /* Switch AUDIO module off */
+    /* Switch AUDIO module off, remember its state */
+    l_flgAudioResume = l_flgAudioOn;
     l_flgAudioOn = false;
 
     if (l_flgAudioIsOn)
@@ -659,24 +1981,162 @@ void	AudioPowerFailHandler (void)
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Audio Fast Resume after Power Fail
+ *
+ * This function is called by PowerFailCheck() after a short outage.  If the
+ * Audio module was on before the power-fail, and the ON_TIME has not ended
+ * meanwhile, it is powered on again.  Since the module lost its supply, the
+ * power-up delay still applies.
+ *
+ ******************************************************************************/
+void	AudioPowerFailResume (void)
+{
+    if (l_flgAudioResume  &&  l_flgAudioWindow)
+    {
+	l_flgAudioOn = true;
+	EVENT_POST(EVT_AUDIO);
+    }
+    l_flgAudioResume = false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Audio Clock Change
+ *
+ * This function is called by the HF clock governor after the HF clock has
+ * been switched, see HfClockBoost().  It recalculates the baud rate of the
+ * USART, if the Audio module is powered on.
+ *
+ ******************************************************************************/
+void	AudioClockChange (void)
+{
+    if (l_flgAudioIsOn)
+	USART_BaudrateAsyncSet (l_Audio_USART.UART, 0, l_Baudrate, usartOVS16);
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Audio Communication Timeout
  *
  * This routine is called from the RTC interrupt handler, after the specified
- * amount of time has elapsed to notify a "Communication Timeout" with the
- * audio module.  This means the firmware did not respond within time.
- * The error is logged, then the recovery of the audio module is initiated.
+ * amount of time has elapsed.  It only sets a flag, the timeout is handled
+ * by AudioComTimeoutHandler() which is called from AudioCheck(), so that all
+ * accesses to the command queue happen in the main loop.
  *
  ******************************************************************************/
 static void AudioComTimeout(TIM_HDL hdl)
 {
-AUDIO_STATE	startState;
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    l_flgComTimeout = true;
+    EVENT_POST(EVT_AUDIO);
+}
+
 
+/***************************************************************************//**
+ *
+ * @brief	Audio Idle Timeout
+ *
+ * This routine is called from the RTC interrupt handler, after the Audio
+ * module has been idle for @ref g_AudioIdleTimeout seconds.  It only sets a
+ * flag, the power-off is initiated by AudioIdleCheck().
+ *
+ ******************************************************************************/
+static void AudioIdleTimeout(TIM_HDL hdl)
+{
     (void) hdl;		// suppress compiler warning "unused parameter"
 
+    l_flgIdleOff = true;
+    EVENT_POST(EVT_AUDIO);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Audio Idle Check
+ *
+ * This routine is called from AudioCheck() in keep-warm mode.  The Audio
+ * module is idle as long as there is neither a playback or record, nor an
+ * active light barrier.  The idle timer is started when the module becomes
+ * idle, and cancelled when it gets busy again.  After the timeout, the
+ * module is powered off, but stays configured, so a playback or record
+ * request, or the next light barrier edge, see AudioWake(), powers it on
+ * again.
+ *
+ * @param[in] flgRequest
+ *	True if Control requests a playback or record.
+ *
+ ******************************************************************************/
+static void AudioIdleCheck(bool flgRequest)
+{
+bool	flgBusy;
+
+    flgBusy = flgRequest  ||  l_flgIsPlayAction  ||  l_flgIsRecAction
+	      ||  g_LB_ActiveMask != 0;
+
+    if (flgRequest  &&  ! l_flgAudioOn)
+    {
+	/* playback or record requested - power-on again */
+	l_flgAudioOn = true;
+	EVENT_POST(EVT_AUDIO);
+    }
+
+    if (l_flgIdleOff)
+    {
+	l_flgIdleOff = false;
+	l_flgIdleRunning = false;
+
+	if (! flgBusy  &&  l_flgAudioOn)
+	{
+#ifdef LOGGING
+	    Log ("Audio has been idle for %lds", g_AudioIdleTimeout);
+#endif
+	    l_flgAudioOn = false;	// power-off by next AudioCheck()
+	    EVENT_POST(EVT_AUDIO);
+	}
+    }
+
+    if (! l_flgAudioIsOn  ||  l_hdlIdle == NONE)
+	return;
+
+    if (flgBusy)
+    {
+	if (l_flgIdleRunning)
+	{
+	    sTimerCancel (l_hdlIdle);
+	    l_flgIdleRunning = false;
+	}
+    }
+    else if (! l_flgIdleRunning)
+    {
+	sTimerStart (l_hdlIdle, g_AudioIdleTimeout);
+	l_flgIdleRunning = true;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Audio Communication Timeout Handler
+ *
+ * This routine is called from AudioCheck() after AudioComTimeout() has been
+ * triggered.  Apart from the power-up delay, this means the audio module did
+ * not respond within the timeout of the oldest pending command.  The first
+ * timeout of a command is retried after the receiver has been
+ * resynchronized.  A second one is logged as error, then the next tier of
+ * the recovery is entered, see AudioRecover().
+ *
+ ******************************************************************************/
+static void AudioComTimeoutHandler(void)
+{
+AUDIO_CMD	cmd;
+
     /* Check error count */
-    if (l_ComErrorCnt > MAX_COM_ERROR_CNT)
+    if (AudioComErrorMax() > MAX_COM_ERROR_CNT)
     {
 	l_State = AUDIO_STATE_OFF;
 	AudioDisable();
@@ -686,724 +2146,1659 @@ AUDIO_STATE	startState;
     if (l_State == AUDIO_STATE_RECOVER)
     {
 	l_State = AUDIO_STATE_POWER_ON;
+	l_Baudrate = AUDIO_BAUDRATE;	// try the higher rate again
 	AudioEnable();
 	return;
     }
 
+    /* Delay of the power-up session is over */
+    if (l_Sess.flgTimer)
+    {
+	l_Sess.flgTimer = false;
+	return;
+    }
+
+    /* Command which did not get a response */
+    if (l_CmdGet == l_CmdSend)
+	return;			// no command pending (any more)
+
+    cmd = l_CmdQueue[l_CmdGet % AUDIO_CMD_QUEUE_SIZE];
+
+    /* Fast retry: resynchronize, send all pending commands once more */
+    if (! cmd.flgRetry)
+    {
+#ifdef LOGGING
+	Log ("Audio: No response to command %d within %ds, retrying",
+	     cmd.Cmd, AudioCmdTimeout(&cmd));
+#endif
+	l_CmdQueue[l_CmdGet % AUDIO_CMD_QUEUE_SIZE].flgRetry = true;
+	l_Telem.Retry++;
+	if (l_RecoverTier == AUDIO_RECOVER_NONE)
+	    AudioRecover (AUDIO_RECOVER_RESYNC);
+	l_CmdSend = l_CmdGet;
+	AudioCmdPump();
+	return;
+    }
+
     /* Check for power-up problems */
-    if (l_ComErrorCnt == 0  &&  l_State == AUDIO_GET_WORK_STATUS)
+    if (l_ComErrorCnt[cmd.Cmd] == 0  &&  cmd.Cmd == AUDIO_GET_WORK_STATUS
+    &&  l_State != AUDIO_STATE_OPERATIONAL)
     {
 #ifdef LOGGING
 	LogError ("Audio: Timeout during initialization"
 		  " - Audio not connected?");
 #endif
-      
+
+      AudioCmdFlush();
       l_State = AUDIO_STATE_OFF;
       AudioDisable();
       return;
     }
 
-       /* See if power-up time of audio module is over */
-    if (l_State == AUDIO_STATE_POWER_ON)
-    {
-	if (l_flgInit)
-	{
-	    l_flgInit = false;		// do this only once
-#ifdef LOGGING
-	    Log ("Audio should be ready, retrieving hard- and software"
-		 " information");
-#endif
-	     
-            startState = AUDIO_GET_WORK_STATUS;
-        }
-	else
-	{
-#ifdef LOGGING
-	    Log ("Audio should be ready, sending configuration values");
-#endif
-	    startState = AUDIO_GET_FILE_NUMBERS;
-
-	}
-	l_flgTxComplete = true;
-	AudioSendCmdSeq(startState);
-
-	return;
-    }
-    
     /* Otherwise it is a real timeout, i.e. error */
-    l_ComErrorCnt++;	// increase error count
+    l_ComErrorCnt[cmd.Cmd]++;	// increase error count of this command
+    l_Telem.Timeout++;
 
 #ifdef LOGGING
-    LogError ("Audio: %d. Communication Timeout in state %d",
-	      l_ComErrorCnt, l_State);
+    LogError ("Audio: %d. Communication Timeout for command %d",
+	      l_ComErrorCnt[cmd.Cmd], cmd.Cmd);
 #endif
 
+    /* Notify the command owner, then discard all remaining commands */
+    if (cmd.pCallback != NULL)
+	cmd.pCallback ((AUDIO_STATE)cmd.Cmd, NULL);
+
+    AudioCmdFlush();
+
     /* Otherwise initiate recovery of the audio module */
-    if (l_ComErrorCnt < MAX_COM_ERROR_CNT)
+    if (l_ComErrorCnt[cmd.Cmd] < MAX_COM_ERROR_CNT)
     {
+	/* A configured module is probed first, before it is power cycled */
+	if (l_State == AUDIO_STATE_OPERATIONAL
+	&&  l_RecoverTier < AUDIO_RECOVER_RESET)
+	{
+	    AudioRecover (l_RecoverTier < AUDIO_RECOVER_PROBE
+			  ? AUDIO_RECOVER_PROBE : AUDIO_RECOVER_RESET);
+	    return;
+	}
+
 	/* Immediately disable and power off the audio system */
 	AudioDisable();	// calls AudioPowerOff(), sets AUDIO_STATE_OFF
 
 	/* Try to recover in 60 seconds */
 	l_State = AUDIO_STATE_RECOVER;
+	l_RecoverTier = AUDIO_RECOVER_POWER;
+	l_Telem.Recover++;
 #ifdef LOGGING
     Log ("Try to recover Audio");
 #endif
-        /* We need up to 60 sec. to check state AUDIO_GET_SPACE_LEFT */
         if (l_hdlWdog != NONE)
         sTimerStart (l_hdlWdog, 60);
     }
     else
+    {
+	l_RecoverTier = AUDIO_RECOVER_NONE;
+#ifdef LOGGING
+	LogError ("Audio: MAX_COM_ERROR_CNT (%d) exceeded for command %d",
+		  MAX_COM_ERROR_CNT, cmd.Cmd);
+	l_Telem.GiveUp++;
+#endif
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Enter a Tier of the Recovery
+ *
+ * This routine is called by AudioComTimeoutHandler() when the Audio module
+ * did not respond.  Most communication errors are glitches of the serial
+ * line, so the cheap tiers are tried first, the power cycle with the
+ * @ref POWER_UP_DELAY and the power-up session is the last resort:
+ * - @ref AUDIO_RECOVER_RESYNC discards the receive buffer and a partial
+ *   frame, i.e. the frame assembler hunts for the next 0x7E, then the
+ *   caller repeats the pending commands.
+ * - @ref AUDIO_RECOVER_PROBE queries the work status of the module, which
+ *   also updates the status model.
+ * - @ref AUDIO_RECOVER_RESET disables and clears the receiver of the USART,
+ *   sets the baud rate again, and repeats the probe.  The FN-RM01 has no
+ *   command for a soft reset, so this is the last step before the power
+ *   cycle.
+ *
+ * The probe is not retried, its timeout enters the next tier.  The first
+ * response of the module completes the recovery, see AudioRecoverDone().
+ *
+ * @param[in] tier
+ *	Tier of the recovery to be entered.
+ *
+ ******************************************************************************/
+static void AudioRecover(AUDIO_RECOVER tier)
+{
+    l_RecoverTier = tier;
+
+    if (tier == AUDIO_RECOVER_RESET)
+    {
+	l_Audio_USART.UART->CMD = USART_CMD_RXDIS | USART_CMD_CLEARRX;
+	USART_BaudrateAsyncSet (l_Audio_USART.UART, 0, l_Baudrate, usartOVS16);
+	l_Audio_USART.UART->CMD = USART_CMD_RXEN;
+    }
+    else
+    {
+	l_Audio_USART.UART->CMD = USART_CMD_CLEARRX;
+    }
+    AudioRxReset();		// hunt for the next frame
+
+    if (tier == AUDIO_RECOVER_RESYNC)
+	return;			// caller repeats the pending commands
+
+#ifdef LOGGING
+    Log ("Audio: Recovery by %s", l_RecoverName[tier]);
+#endif
+    if (AudioQueueCmd (AUDIO_GET_WORK_STATUS))
+	l_CmdQueue[(uint8_t)(l_CmdPut - 1) % AUDIO_CMD_QUEUE_SIZE].flgRetry = true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Recovery completed
+ *
+ * This routine is called by AudioFrameHandler() when the Audio module
+ * responds to a command again.  The success of the current tier is counted
+ * for the telemetry, see AudioTelemetryReport().
+ *
+ ******************************************************************************/
+static void AudioRecoverDone(void)
+{
+#ifdef LOGGING
+    Log ("Audio: Recovered by %s", l_RecoverName[l_RecoverTier]);
+#endif
+    l_Telem.RecoverOk[l_RecoverTier]++;
+    l_RecoverTier = AUDIO_RECOVER_NONE;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Enqueue a Command for the Audio module
+ *
+ * This routine puts a command frame into the command queue.  The frame is
+ * sent by AudioCmdPump() as soon as the queue allows it.  Commands which
+ * have been enqueued with <i>flgOverlap</i> set allow the next command to be
+ * sent before their response has been received, up to a number of
+ * @ref AUDIO_CMD_MAX_PENDING commands.  Responses are assigned to the pending
+ * commands in the order these have been sent.
+ *
+ * @param[in] cmd
+ *	Command identifier of type @ref AUDIO_STATE, passed to the callback.
+ *
+ * @param[in] pFrame
+ *	Address of the command frame, may contain 0x00 bytes.
+ *
+ * @param[in] len
+ *	Number of bytes in the frame.
+ *
+ * @param[in] respOp
+ *	Expected response, i.e. the operation code of the reply, or
+ *	@ref AUDIO_RESP_ACK if the module answers with an acknowledge byte.
+ *
+ * @param[in] timeout
+ *	Time in [s] to wait for the response, after the command has been sent.
+ *
+ * @param[in] flgOverlap
+ *	If true, the next command may be sent before the response arrived.
+ *
+ * @param[in] pCallback
+ *	Function to be called with the response, or with NULL on timeout.
+ *	May be NULL.
+ *
+ * @return
+ *	The value <i>true</i> if the command has been enqueued, <i>false</i>
+ *	if the queue is full or the frame is too long.
+ *
+ ******************************************************************************/
+static bool AudioCmdEnqueue (AUDIO_STATE cmd, const uint8_t *pFrame, int len,
+			     uint8_t respOp, uint8_t timeout, bool flgOverlap,
+			     AUDIO_CMD_CB pCallback)
+{
+AUDIO_CMD  *pCmd;
+
+    if ((uint8_t)(l_CmdPut - l_CmdGet) >= AUDIO_CMD_QUEUE_SIZE)
+    {
+#ifdef LOGGING
+	LogError("Audio: Command queue full, command %d discarded", cmd);
+#endif
+	return false;
+    }
+
+    if (len <= 0  ||  len > AUDIO_CMD_MAX_LEN)
     {
 #ifdef LOGGING
-	LogError ("Audio: MAX_COM_ERROR_CNT (%d) exceeded", MAX_COM_ERROR_CNT);
+	LogError("Audio: Command %d has invalid length (%d bytes)", cmd, len);
 #endif
+	return false;
+    }
+
+    pCmd = &l_CmdQueue[l_CmdPut % AUDIO_CMD_QUEUE_SIZE];
+    memcpy (pCmd->Frame, pFrame, len);
+    pCmd->Len	     = len;
+    pCmd->Cmd	     = cmd;
+    pCmd->RespOp     = respOp;
+    pCmd->Timeout    = timeout;
+    pCmd->flgOverlap = flgOverlap;
+    pCmd->flgRetry   = false;
+    pCmd->pCallback  = pCallback;
+    l_CmdPut++;
+
+    l_Telem.ReqCnt[cmd]++;
+
+    /* Start sending immediately if possible */
+    AudioCmdPump();
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Send enqueued Commands
+ *
+ * This routine sends the next command(s) from the queue, as long as all
+ * pending commands allow it via their overlap flag.
+ * The communication watchdog is started for the oldest pending command.
+ *
+ ******************************************************************************/
+static void AudioCmdPump (void)
+{
+AUDIO_CMD  *pCmd;
+
+    while (l_CmdSend != l_CmdPut)
+    {
+	if (l_CmdSend != l_CmdGet)
+	{
+	    /* Commands are pending - see if we may go on */
+	    if ((uint8_t)(l_CmdSend - l_CmdGet) >= AUDIO_CMD_MAX_PENDING
+	    ||  ! l_CmdQueue[(uint8_t)(l_CmdSend - 1) % AUDIO_CMD_QUEUE_SIZE].flgOverlap)
+		break;
+	}
+
+	pCmd = &l_CmdQueue[l_CmdSend % AUDIO_CMD_QUEUE_SIZE];
+
+	if (l_CmdSend == l_CmdGet)
+	    l_RxState = RX_IDLE;	// discard any partial reply
+
+	if (! SendFrame (pCmd->Frame, pCmd->Len))
+	    break;			// try again later
+
+	pCmd->SendTime = (uint32_t)ClockMonoTicks();
+
+	/* Start watchdog for the oldest pending command */
+	if (l_CmdSend == l_CmdGet  &&  l_hdlWdog != NONE)
+	    sTimerStart (l_hdlWdog, AudioCmdTimeout(pCmd));
+
+	l_CmdSend++;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Flush the Command Queue
+ *
+ * All commands, the pending ones and those not sent yet, are discarded.
+ * The callbacks are not called, but a command awaited by AudioSession() is
+ * completed as failed.
+ *
+ ******************************************************************************/
+static void AudioCmdFlush (void)
+{
+    l_CmdGet = l_CmdSend = l_CmdPut;
+
+    /* The parameters of discarded commands may not have been set */
+    l_ModuleVC = l_ModuleIM = AUDIO_PARM_UNKNOWN;
+
+    AudioSessionResume (l_Sess.WaitCmd, NULL);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the Response Timeout of a Command
+ *
+ * This routine returns the time in [s] the watchdog waits for the response
+ * to the specified command.  As soon as @ref AUDIO_LAT_MIN_SAMPLES responses
+ * have been recorded by AudioLatRecord(), this is the 99th percentile of the
+ * response times plus @ref AUDIO_TIMEOUT_MARGIN, limited to the range
+ * @ref AUDIO_TIMEOUT_MIN to the timeout of the command template.  Before, the
+ * template value is used as is.
+ *
+ * @param[in] pCmd
+ *	Address of the command queue entry.
+ *
+ * @return
+ *	Timeout in [s].
+ *
+ ******************************************************************************/
+static uint8_t AudioCmdTimeout (const AUDIO_CMD *pCmd)
+{
+const uint8_t *pHist = l_LatHist[pCmd->Cmd - AUDIO_GET_WORK_STATUS];
+uint32_t	total, sum, ms, timeout;
+int		i;
+
+    for (total = 0, i = 0;  i < AUDIO_LAT_BUCKETS;  i++)
+	total += pHist[i];
+
+    if (total < AUDIO_LAT_MIN_SAMPLES)
+	return pCmd->Timeout;		// not enough responses yet
+
+    /* Find the bucket which contains the 99th percentile */
+    for (sum = 0, i = 0;  i < AUDIO_LAT_BUCKETS - 1;  i++)
+    {
+	sum += pHist[i];
+	if ((total - sum) * 100 <= total)
+	    break;
     }
+
+    ms = (uint32_t)AUDIO_LAT_BASE_MS << i;	// upper limit of this bucket
+    timeout = (ms + 999) / 1000 + AUDIO_TIMEOUT_MARGIN;
+
+    if (timeout < AUDIO_TIMEOUT_MIN)
+	timeout = AUDIO_TIMEOUT_MIN;
+    if (timeout > pCmd->Timeout)
+	timeout = pCmd->Timeout;
+
+    return (uint8_t)timeout;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Record the Response Time of a Command
+ *
+ * This routine is called by AudioFrameHandler() when the response to a
+ * command has been received.  The time since the command has been sent is
+ * counted in the histogram @ref l_LatHist of this command.  When a bucket
+ * overflows, all buckets of the command are halved, i.e. older responses
+ * lose weight.
+ *
+ * @param[in] pCmd
+ *	Address of the command queue entry.
+ *
+ ******************************************************************************/
+static void AudioLatRecord (const AUDIO_CMD *pCmd)
+{
+uint8_t	       *pHist = l_LatHist[pCmd->Cmd - AUDIO_GET_WORK_STATUS];
+uint32_t	ms;
+int		i;
+
+    /* Elapsed time, the timeout of the command limits it to some seconds */
+    ms = ((uint32_t)ClockMonoTicks() - pCmd->SendTime) * 1000
+	 / RTC_COUNTS_PER_SEC;
+
+    for (i = 0;  i < AUDIO_LAT_BUCKETS - 1;  i++)
+	if (ms < ((uint32_t)AUDIO_LAT_BASE_MS << i))
+	    break;
+
+    if (pHist[i] == 0xFF)
+    {
+	for (i = 0;  i < AUDIO_LAT_BUCKETS;  i++)
+	    pHist[i] >>= 1;
+
+	for (i = 0;  i < AUDIO_LAT_BUCKETS - 1;  i++)
+	    if (ms < ((uint32_t)AUDIO_LAT_BASE_MS << i))
+		break;
+    }
+    pHist[i]++;
+
+    l_Telem.LatHist[i]++;
+    if (ms > l_Telem.LatMax)
+	l_Telem.LatMax = ms;
+
+    LOG_DBG ("Audio: Response to command %d after %ldms, timeout %ds",
+	     pCmd->Cmd, ms, AudioCmdTimeout(pCmd));
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the highest Communication Error Count
+ *
+ * @return
+ *	Maximum of the error counts of all commands.
+ *
+ ******************************************************************************/
+static uint8_t AudioComErrorMax (void)
+{
+uint8_t	max = 0;
+int	i;
+
+    for (i = 0;  i < END_AUDIO_STATE;  i++)
+	if (l_ComErrorCnt[i] > max)
+	    max = l_ComErrorCnt[i];
+
+    return max;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Alarm Routine for the Telemetry Report
+ *
+ * This routine is called by the alarm clock at @ref ALARM_AUDIO_TELEM_TIME.
+ * It triggers AudioTelemetryReport() in AudioCheck().
+ *
+ ******************************************************************************/
+static void AudioTelemetryAlarm (int alarmNum)
+{
+    (void) alarmNum;	// suppress compiler warning "unused parameter"
+
+    l_flgTelemReport = true;
+    EVENT_POST(EVT_AUDIO);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Output a Telemetry Line
+ *
+ * @param[in] line
+ *	Line to be logged or shown.
+ *
+ * @param[in] flgLog
+ *	If true, the line is logged, otherwise it is shown on the debug
+ *	console.
+ *
+ ******************************************************************************/
+static void AudioTelemetryPut (const char *line, bool flgLog)
+{
+    if (flgLog)
+    {
+	Log (line);
+    }
+    else
+    {
+	drvLEUART_puts (line);
+	drvLEUART_puts ("\n");
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Communication Statistics
+ *
+ * This routine generates five lines: the number of requests per command
+ * identifier, the histogram of the response times in [ms] and the longest
+ * response time, and the error counters: checksum errors and other invalid
+ * frames, frames lost because the receive ring was full, timeouts, fast
+ * retries, power cycles, and how often @ref MAX_COM_ERROR_CNT was exceeded.
+ * The fourth line shows the errors of the USART receiver, i.e. framing and
+ * parity errors, and overflows of its receive buffer.  The fifth line counts
+ * the successful recoveries per tier, see AudioRecover().
+ *
+ * @param[in] flgLog
+ *	If true, the statistics are logged and reset.  If false, they are only
+ *	shown on the debug console.
+ *
+ ******************************************************************************/
+void	AudioTelemetryReport (bool flgLog)
+{
+char	 line[80];
+int	 len;
+AUDIO_TELEMETRY telem;
+int	 i;
+
+    INT_Disable();
+    telem = *(AUDIO_TELEMETRY *)&l_Telem;
+    if (flgLog)
+	memset ((void *)&l_Telem, 0, sizeof(l_Telem));
+    INT_Enable();
+
+    len = StrFormat (line, "Audio req");
+    for (i = 0;  i < END_AUDIO_STATE;  i++)
+    {
+	if (telem.ReqCnt[i] > 0)
+	    len += StrFormat (line + len, " %d:%u", i, telem.ReqCnt[i]);
+
+	if (len > (int)sizeof(line) - 16)
+	{
+	    AudioTelemetryPut (line, flgLog);	// line is full, continue
+	    len = StrFormat (line, "Audio req");
+	}
+    }
+    AudioTelemetryPut (line, flgLog);
+
+    len = StrFormat (line, "Audio lat max=%ldms", telem.LatMax);
+    for (i = 0;  i < AUDIO_LAT_BUCKETS;  i++)
+    {
+	if (telem.LatHist[i] == 0)
+	    continue;			// only show used buckets
+
+	if (i < AUDIO_LAT_BUCKETS - 1)
+	    len += StrFormat (line + len, " <%d:%u", AUDIO_LAT_BASE_MS << i,
+			      telem.LatHist[i]);
+	else
+	    len += StrFormat (line + len, " >=%d:%u", AUDIO_LAT_BASE_MS << (i-1),
+			      telem.LatHist[i]);
+
+	if (len > (int)sizeof(line) - 20)
+	{
+	    AudioTelemetryPut (line, flgLog);	// line is full, continue
+	    len = StrFormat (line, "Audio lat");
+	}
+    }
+    AudioTelemetryPut (line, flgLog);
+
+    StrFormat (line, "Audio err csum=%d frame=%d ovr=%d tmo=%d retry=%d"
+	       " recover=%d giveup=%d", telem.CsumErr, telem.FrameErr,
+	       telem.Overrun, telem.Timeout, telem.Retry, telem.Recover,
+	       telem.GiveUp);
+    AudioTelemetryPut (line, flgLog);
+
+    StrFormat (line, "Audio uart ferr=%d perr=%d ovr=%d",
+	       telem.UartFerr, telem.UartPerr, telem.UartOverrun);
+    AudioTelemetryPut (line, flgLog);
+
+    StrFormat (line, "Audio recovered resync=%d probe=%d reset=%d power=%d",
+	       telem.RecoverOk[AUDIO_RECOVER_RESYNC],
+	       telem.RecoverOk[AUDIO_RECOVER_PROBE],
+	       telem.RecoverOk[AUDIO_RECOVER_RESET],
+	       telem.RecoverOk[AUDIO_RECOVER_POWER]);
+    AudioTelemetryPut (line, flgLog);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Power-up Session
+ *
+ * This protothread is started by AudioPowerOn() and resumed by AudioCheck()
+ * until it ends.  It performs the power-up of the Audio module step by step:
+ * -# Wait for the prompt 0xCA of the module, i.e. the current status of the
+ *    storage device, see AudioFrameHandler().
+ * -# Wait @ref POWER_UP_DELAY seconds until the module accepts commands.
+ * -# After the first power-up, retrieve the work status, unless it is known
+ *    from the status model, the space left, and the file count.  If the
+ *    module is stopped, the session ends here.
+ * -# Send the configuration values.  These commands are independent of each
+ *    other and therefore sent back to back.
+ * -# The module is operational when the last one has been acknowledged.
+ *
+ * If the inventory cache is valid, see @ref AUDIO_INVENTORY_CACHE, the slow
+ * storage queries @ref AUDIO_GET_SPACE_LEFT and @ref AUDIO_GET_FILE_NUMBERS
+ * are skipped.  Apart from the first power-up, the file count is only
+ * queried as long as the record sequence has not been seeded, see
+ * RecordSeqSeed().
+ *
+ * If a command fails, AudioCmdDone() logs the error and flushes the queue,
+ * the session ends then and the module is not operational.  A timeout is
+ * handled by AudioComTimeoutHandler(), which powers the module off, i.e.
+ * the session starts again with the next power-up.
+ *
+ * @return
+ *	@ref PT_WAITING while the session is in progress, @ref PT_ENDED
+ *	afterwards.
+ *
+ ******************************************************************************/
+static int AudioSession (void)
+{
+    PT_BEGIN(&l_Sess.Pt);
+
+    /* Prompt after power-up 4.4.6 Current status SD or USB */
+    while (1)
+    {
+	PT_WAIT_UNTIL(&l_Sess.Pt, l_Sess.flgFrame);
+	l_Sess.flgFrame = false;
+
+	if (l_Sess.Frame.Data[0] == AUDIO_OP_DEVICE_STATUS
+	&&  l_Sess.Frame.Len >= 2)
+	    break;
+
+	/* Connection status 0xCA is not received */
+	LogError("Audio: Connection MicroSD card or USB flash execution failed");
+	SetError(ERR_SRC_AUDIO);	// indicate error via LED
+    }
+    AudioLogDeviceStatus(l_Sess.Frame.Data[1]);
+
+#ifdef LOGGING
+    Log ("Waiting %ds for Audio module being ready to accept commands...",
+	 POWER_UP_DELAY);
+#endif
+    l_Sess.flgTimer = true;
+    if (l_hdlWdog != NONE)
+	sTimerStart (l_hdlWdog, POWER_UP_DELAY);
+    PT_WAIT_UNTIL(&l_Sess.Pt, ! l_Sess.flgTimer);
+
+    l_Sess.flgFullSeq = l_flgInit;
+    l_flgInit = false;		// do this only once
+#ifdef LOGGING
+    if (l_Sess.flgFullSeq)
+	Log ("Audio should be ready, retrieving hard- and software"
+	     " information");
+    else
+	Log ("Audio should be ready, sending configuration values");
+#endif
+
+#if AUDIO_INVENTORY_CACHE
+    if (AudioInvValid())
+    {
+	/* The storage device may have been replaced after a power-on reset */
+	l_flgReconcile = l_flgInvRestored;
+	l_flgInvRestored = false;
+	Log ("Audio: Cached inventory %d files, %dMB left",
+	     l_Inventory.FileCnt, l_Inventory.SpaceLeft);
+    }
+#endif
+
+    if (l_Sess.flgFullSeq)
+    {
+	if (AudioStatusStale())
+	{
+	    AudioSessionCmd (AUDIO_GET_WORK_STATUS);
+	    PT_WAIT_UNTIL(&l_Sess.Pt, l_Sess.WaitCmd == END_AUDIO_STATE);
+	    if (! l_Sess.flgOK)
+		PT_EXIT(&l_Sess.Pt);
+	}
+
+	if (l_Status.Work == AUDIO_WORK_STOPPED)
+	{
+	    /* Stopped: skip rest of the sequence */
+	    l_State = AUDIO_STATE_OPERATIONAL;
+	    PT_EXIT(&l_Sess.Pt);
+	}
+    }
+
+#if AUDIO_INVENTORY_CACHE
+    if (! AudioInvValid())
+#endif
+    {
+	if (l_Sess.flgFullSeq)
+	{
+	    AudioSessionCmd (AUDIO_GET_SPACE_LEFT);
+	    PT_WAIT_UNTIL(&l_Sess.Pt, l_Sess.WaitCmd == END_AUDIO_STATE);
+	    if (! l_Sess.flgOK)
+		PT_EXIT(&l_Sess.Pt);
+	}
+
+	/* The file count is only required to seed the record sequence */
+	if (l_Sess.flgFullSeq  ||  ! RecordSeqIsValid())
+	{
+	    AudioSessionCmd (AUDIO_GET_FILE_NUMBERS);
+	    PT_WAIT_UNTIL(&l_Sess.Pt, l_Sess.WaitCmd == END_AUDIO_STATE);
+	    if (! l_Sess.flgOK)
+		PT_EXIT(&l_Sess.Pt);
+	}
+    }
+
+    /* Configuration values back to back, wait for the last one */
+    AudioRqAdapt();
+    AudioQueueCmd(AUDIO_STATE_SEND_VC);
+    AudioQueueCmd(AUDIO_STATE_SEND_ST);
+    AudioQueueCmd(AUDIO_STATE_SEND_IM);
+    AudioSessionCmd (AUDIO_STATE_SEND_RQ);
+    PT_WAIT_UNTIL(&l_Sess.Pt, l_Sess.WaitCmd == END_AUDIO_STATE);
+    if (! l_Sess.flgOK)
+	PT_EXIT(&l_Sess.Pt);
+
+    l_State = AUDIO_STATE_OPERATIONAL;
+    l_flgLocked = false;
+    l_flgAudioInitIsDone = true;
+
+    PT_END(&l_Sess.Pt);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Send a Command of the Power-up Session
+ *
+ * This routine queues the specified command, which is awaited by
+ * AudioSession() then.  If the command cannot be queued, it is completed
+ * as failed at once.
+ *
+ * @param[in] cmd
+ *	Command to be sent.
+ *
+ ******************************************************************************/
+static void AudioSessionCmd (AUDIO_STATE cmd)
+{
+    l_State = cmd;		// initialization is in progress
+    l_Sess.WaitCmd = cmd;
+    l_Sess.flgOK = false;
+
+    if (! AudioQueueCmd(cmd))
+	l_Sess.WaitCmd = END_AUDIO_STATE;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Resume the Power-up Session
+ *
+ * This routine is called by AudioCmdDone() when a command has been completed,
+ * and by AudioCmdFlush().  If AudioSession() awaits this command, the
+ * response is stored, and the session continues with its next call.
+ *
+ * @param[in] cmd
+ *	Command which has been completed.
+ *
+ * @param[in] pFrame
+ *	Address of the response frame, or NULL if the command failed.
+ *
+ ******************************************************************************/
+static void AudioSessionResume (AUDIO_STATE cmd, const AUDIO_FRAME *pFrame)
+{
+    if (cmd == END_AUDIO_STATE  ||  cmd != l_Sess.WaitCmd)
+	return;
+
+    l_Sess.WaitCmd = END_AUDIO_STATE;
+    l_Sess.flgOK = (pFrame != NULL);
+    if (pFrame != NULL)
+	l_Sess.Frame = *pFrame;
+}
+
+
+#if AUDIO_INVENTORY_CACHE
+/***************************************************************************//**
+ *
+ * @brief	Check the Inventory Cache
+ *
+ * @return
+ *	The value <i>true</i> if @ref l_Inventory contains valid data.  After a
+ *	power-on reset the no-init RAM is random, so the magic value and the
+ *	check sum must match.
+ *
+ ******************************************************************************/
+static bool AudioInvValid (void)
+{
+    return (l_Inventory.Magic == AUDIO_INV_MAGIC
+	    &&  l_Inventory.FileCnt != 0
+	    &&  l_Inventory.Check == (uint16_t)~(l_Inventory.FileCnt
+						 + l_Inventory.SpaceLeft));
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Update the Inventory Cache
+ *
+ * This routine stores the file count and the space left of the storage
+ * device in @ref l_Inventory.  A file count of 0 invalidates the cache.
+ *
+ * @param[in] fileCnt
+ *	Total file numbers of the storage device.
+ *
+ * @param[in] spaceLeft
+ *	Space left in [MB].
+ *
+ ******************************************************************************/
+static void AudioInvUpdate (int fileCnt, int spaceLeft)
+{
+    l_Inventory.Magic = (fileCnt > 0 ? AUDIO_INV_MAGIC : 0);
+    l_Inventory.FileCnt = fileCnt;
+    l_Inventory.SpaceLeft = spaceLeft;
+    l_Inventory.Check = ~(l_Inventory.FileCnt + l_Inventory.SpaceLeft);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Save the Inventory Cache
+ *
+ * This routine saves a valid @ref l_Inventory in the parameter store, so it
+ * survives a power-on reset.  It is called by AudioCheck() in the main loop
+ * after the module has been switched off, the flash is only programmed if
+ * the inventory has changed.
+ *
+ ******************************************************************************/
+static void AudioInvSave (void)
+{
+    if (AudioInvValid())
+	ParamSet (PARAM_AUDIO_INV, ((uint32_t)l_Inventory.FileCnt << 16)
+				   | l_Inventory.SpaceLeft);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check the Availability Map
+ *
+ * @param[in] file
+ *	Number of the playback file, 1 to @ref PLAYLIST_MAX_FILE.
+ *
+ * @return
+ *	The value <i>true</i> if the module has rejected this file before.
+ *	File numbers above @ref AUDIO_MISSING_MAX_FILE are never missing.
+ *
+ ******************************************************************************/
+static bool AudioFileMissing (int file)
+{
+    if (file < 1  ||  file > AUDIO_MISSING_MAX_FILE)
+	return false;	// invalid numbers are reported by AudioQueueCmd()
+
+    return (l_Inventory.Missing[file / 8] & (1 << (file % 8))) != 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Enter a Missing File into the Availability Map
+ *
+ * This routine is called when the module has rejected the playback command
+ * of a file.  The file is logged once, then it is skipped by
+ * AudioPlaybackSelect() until the map is cleared.
+ *
+ * @param[in] file
+ *	Number of the playback file, 1 to @ref PLAYLIST_MAX_FILE.
+ *
+ ******************************************************************************/
+static void AudioFileMissingSet (int file)
+{
+    if (file < 1  ||  file > AUDIO_MISSING_MAX_FILE  ||  AudioFileMissing(file))
+	return;
+
+    l_Inventory.Missing[file / 8] |= (1 << (file % 8));
+    LOG_WARN ("Audio: P%03d is missing, skipped from now on", file);
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Build a Command Frame from a Template
+ *
+ * This routine copies the frame template into the specified buffer, patches
+ * the variable bytes, and calculates the checksum.  The checksum is the low
+ * byte of the sum of all bytes between the start delimiter and the checksum
+ * itself, i.e. length, opcode, and parameters.
+ *
+ * @param[out] pBuf
+ *	Buffer of @ref AUDIO_CMD_MAX_LEN bytes to store the frame into.
+ *
+ * @param[in] pTmpl
+ *	Address of the frame template.
+ *
+ * @param[in] pParm
+ *	Variable bytes to be stored at position <i>ParmIdx</i> of the frame.
+ *
+ * @param[in] parmCnt
+ *	Number of variable bytes, may be 0.
+ *
+ * @return
+ *	Total number of bytes in the frame.
+ *
+ ******************************************************************************/
+static int AudioFramePatch(uint8_t *pBuf, const AUDIO_CMD_TEMPLATE *pTmpl,
+			   const uint8_t *pParm, int parmCnt)
+{
+int	len = pTmpl->Len;
+uint8_t	sum = 0;
+int	i;
+
+    memcpy (pBuf, pTmpl->Frame, len);
+
+    for (i = 0;  i < parmCnt;  i++)
+	pBuf[pTmpl->ParmIdx + i] = pParm[i];
+
+    for (i = 1;  i < len - 2;  i++)
+	sum += pBuf[i];
+
+    pBuf[len - 2] = sum;
+
+    return len;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Queue a Command for the Audio module
+ *
+ * This routine builds the frame of the specified command from its template
+ * in @ref l_CmdTemplate and puts it into the command queue, together with the
+ * expected response, the timeout, and AudioCmdDone() as completion callback.
+ *
+ * @param[in] cmd
+ *	Must be of type @ref AUDIO_STATE.  Specifies the command to send.
+ *
+ * @return
+ *	The value <i>true</i> if the command has been enqueued.
+ *
+ ******************************************************************************/
+static bool AudioQueueCmd(AUDIO_STATE cmd)
+{
+const AUDIO_CMD_TEMPLATE *pTmpl;
+uint8_t	frame[AUDIO_CMD_MAX_LEN];
+uint8_t	parm[3];
+int	parmCnt = 0;
+int	len;
+
+    if (cmd >= END_AUDIO_STATE  ||  l_CmdTemplate[cmd].Len == 0)
+    {
+#ifdef LOGGING
+	LogError("Audio AudioQueueCmd(): INVALID COMMAND %d", cmd);
+#endif
+	return false;
+    }
+    pTmpl = &l_CmdTemplate[cmd];
+
+    /* Determine the variable bytes of the command */
+    switch (cmd)
+    {
+       case AUDIO_STATE_SEND_VC:    // 4.3.9. Volume control 1 to 31
+            if (AudioParmVC() == 0)
+            {
+               /* 0 is not a valid volume, keep the current setting */
+               Log ("ERROR Audio: Volume %i value must be between 1 and 31", AudioParmVC());
+               return false;
+            }
+            parm[parmCnt++] = AudioParmVC();
+            break;
+
+       case AUDIO_STATE_SEND_ST:    // 4.3.13. Storage device
+            parm[parmCnt++] = g_AudioCfg_ST;	// 00: MicroSD, 01: USB flash
+            break;
+
+       case AUDIO_STATE_SEND_IM:    // 4.3.14. Input Mode
+            parm[parmCnt++] = AudioParmIM();	// 00: MIC, 01: LINE-IN, 02: AUX
+            break;
+
+       case AUDIO_STATE_SEND_RQ:    // 4.3.15. Recording quality
+            parm[parmCnt++] = l_AudioRQ;	// 00: 128kbps ... 03: 32kbps
+            break;
+
+       case AUDIO_SEND_PLAYBACK:    // 4.3.2 Specify playback of a file by name [P001-P999]
+            if (PlaybackFileNumber < 1  ||  PlaybackFileNumber > PLAYLIST_MAX_FILE)
+            {
+               LogError("Audio: Invalid playback file number %d", PlaybackFileNumber);
+               return false;
+            }
+            l_flgLocked = true;
+            parm[parmCnt++] = '0' + PlaybackFileNumber / 100;
+            parm[parmCnt++] = '0' + PlaybackFileNumber / 10 % 10;
+            parm[parmCnt++] = '0' + PlaybackFileNumber % 10;
+            break;
+
+       case AUDIO_SEND_RECORD:      // 4.3.17 Specify recording of a file by name [R001.wav]
+            l_flgLocked = true;
+            parm[parmCnt++] = l_RecName[0];
+            parm[parmCnt++] = l_RecName[1];
+            parm[parmCnt++] = l_RecName[2];
+            break;
+
+       case AUDIO_SEND_RECORD_STOP: // 4.3.20 Stop recording
+            /* the record ends, or the next segment is started */
+            if (l_hdlSegment != NONE)
+               msTimerCancel (l_hdlSegment);
+            l_flgSegmentDue = false;
+            break;
+
+       default:			// no variable bytes
+            break;
+    }
+
+    len = AudioFramePatch (frame, pTmpl, parm, parmCnt);
+
+    if (! AudioCmdEnqueue (cmd, frame, len, pTmpl->RespOp, pTmpl->Timeout,
+			   pTmpl->flgOverlap, AudioCmdDone))
+	return false;
+
+    /* The following commands see the new value, even before the response */
+    if (cmd == AUDIO_STATE_SEND_VC)
+	l_ModuleVC = parm[0];
+    else if (cmd == AUDIO_STATE_SEND_IM)
+	l_ModuleIM = parm[0];
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Send Command
+ *
+ * Send a command string to the Audio module.  The string must not contain
+ * 0x00 bytes, use SendFrame() for binary frames.
+ *
+ * @param[in] pCmdStr
+ *	Address pointer of the string to be written into the transmit ring.
+ *
+ ******************************************************************************/
+void SendCmd(const char *pCmdStr)
+{
+    SendFrame ((const uint8_t *)pCmdStr, strlen(pCmdStr));
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Send Frame
+ *
+ * Copy a frame into the transmit ring and start the DMA to send it to the
+ * Audio module, if not already running.  Several frames may be queued this
+ * way, they are sent back to back.
+ *
+ * @param[in] pBuf
+ *	Address of the frame, may contain 0x00 bytes.
+ *
+ * @param[in] len
+ *	Number of bytes to send.
+ *
+ * @return
+ *	The value <i>true</i> if the frame has been put into the transmit ring,
+ *	<i>false</i> if there is not enough space left.
+ *
+ ******************************************************************************/
+bool SendFrame(const uint8_t *pBuf, size_t len)
+{
+unsigned int	i;
+
+   /* Check length against free space, l_TxGet only increases meanwhile */
+    if (len == 0  ||  len > (size_t)(AUDIO_TX_RING_SIZE - (uint8_t)(l_TxPut - l_TxGet)))
+    {
+#ifdef LOGGING
+	LogError("Audio SendFrame(): No space for %d bytes in transmit ring",
+		 len);
+#endif
+	return false;		// ignore this frame
+    }
+
+    /* Copy frame into transmit ring */
+    for (i = 0;  i < len;  i++)
+	l_TxRing[(uint8_t)(l_TxPut + i) % AUDIO_TX_RING_SIZE] = pBuf[i];
+
+    /* Make data available to DMA, start transfer if DMA is idle */
+    INT_Disable();
+    l_TxPut += len;
+    ITM_TRACE_QUEUE(ITM_QUE_AUDIO_TX, (uint8_t)(l_TxPut - l_TxGet));
+    AudioTxDMA_Start();
+    INT_Enable();
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start DMA Transmission
+ *
+ * If the DMA is idle, start to transfer the data of the transmit ring, up to
+ * its end.  The remaining data is sent by the next call from AudioTxDone().
+ *
+ * @note
+ * This routine must be called with interrupts disabled, or from the DMA
+ * interrupt handler.
+ *
+ ******************************************************************************/
+static void AudioTxDMA_Start(void)
+{
+uint8_t	idxGet = l_TxGet % AUDIO_TX_RING_SIZE;
+uint8_t	cnt = (uint8_t)(l_TxPut - l_TxGet);
+
+    if (l_TxDMA_Cnt != 0  ||  cnt == 0)
+	return;			// DMA is busy, or no data to send
+
+    /* Limit DMA transfer to end of the ring */
+    if (cnt > AUDIO_TX_RING_SIZE - idxGet)
+	cnt = AUDIO_TX_RING_SIZE - idxGet;
+
+    l_TxDMA_Cnt = cnt;
+
+    /* Let the DMA transfer the data without any further CPU activity */
+    DMA_ActivateBasic(DMA_CHAN_AUDIO_TX,	// Activate channel selected
+		      true,			// Use primary descriptor
+		      false,			// No DMA burst
+		      (void *) &l_Audio_USART.UART->TXDATA, // Destination
+		      (void *) &l_TxRing[idxGet],	// Source address
+		      cnt - 1);			// Number of bytes - 1
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Log Storage Device Status
+ *
+ * This routine logs the storage device status which is reported by the
+ * Audio module via operation code 0xCA.
+ *
+ * @param[in] status
+ *	Status byte of the 0xCA reply.
+ *
+ ******************************************************************************/
+static void AudioLogDeviceStatus(uint8_t status)
+{
+    switch (status)
+    {
+	case 0x00:	// both MicroSD card and USB flash connected
+	    Log ("Audio: Both MicroSD card and USB flash drive inserted");
+	    break;
+
+	case 0x01:	// MicroSD card connected only
+	    Log ("Audio: MicroSD card inserted");
+	    break;
+
+	case 0x02:	// USB flash connected only
+	    Log ("Audio: USB flash inserted");
+	    break;
+
+	case 0x03:	// neither MicroSD card or USB flash drive connected
+	    Log ("Audio: MicroSD card or USB flash removed");
+	    break;
+
+	default:
+	    break;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set the Work Status
+ *
+ * This routine updates the status model of the Audio module.  It is called
+ * when a command has been acknowledged, and when the module has sent a
+ * notification on its own.
+ *
+ * @param[in] work
+ *	New work status, e.g. @ref AUDIO_WORK_PLAYING, or
+ *	@ref AUDIO_WORK_UNKNOWN if it must be queried.
+ *
+ ******************************************************************************/
+static void AudioStatusSet (uint8_t work)
+{
+    l_Status.Work = work;
+    l_Status.Time = (uint32_t)time(NULL);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if the Work Status is Stale
+ *
+ * @return
+ *	The value <i>true</i> if the work status is not known, or has not been
+ *	updated for @ref AUDIO_STATUS_MAX_AGE seconds, i.e. it must be queried
+ *	via @ref AUDIO_GET_WORK_STATUS.
+ *
+ ******************************************************************************/
+static bool AudioStatusStale (void)
+{
+    return (l_Status.Work == AUDIO_WORK_UNKNOWN
+	    ||  (uint32_t)time(NULL) - l_Status.Time > AUDIO_STATUS_MAX_AGE);
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Start sending a Command Sequence to Audio
+ * @brief	Work Status Notification
  *
- * This routine starts to send the specified command of a complete sequence.
- * The next command is usually selected by CheckAudioData().
+ * This routine is called by AudioFrameHandler() when the Audio module has
+ * reported its work status 0xC2 on its own, e.g. at the end of a playback.
+ * If the next file of a chained playback has already been selected, it is
+ * started at once instead of waiting for the deadline.
  *
- * @param[in] state
- *	Must be of type @ref AUDIO_STATE.  Specifies the command to send.
+ * @param[in] work
+ *	Work status reported by the module.
  *
  ******************************************************************************/
-void AudioSendCmdSeq(AUDIO_STATE state)
+static void AudioStatusNotify (uint8_t work)
 {
-char  buffer[40];
-const char *cmd;
-int  checksum_int;
+    LOG_DBG ("Audio: Work status %d reported", work);
 
-    cmd = buffer;
-    switch (state)
+    if (work == AUDIO_WORK_STOPPED  &&  l_Status.Work == AUDIO_WORK_PLAYING
+    &&  l_flgIsPlayAction  &&  l_ChainFile > 0)
     {
-       case AUDIO_GET_WORK_STATUS:  // 4.4.2 Current work status (send)
-            sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xC2, 0xC5, 0x7E);
-            break;
-       
-        case AUDIO_GET_SPACE_LEFT:  // 4.4.9 Space left in the storage device
-            sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xCE, 0xD1, 0x7E);
-            break;
-            
-       case AUDIO_GET_FILE_NUMBERS:  // 4.4.3 Total file numbers on SD card or USB flash (send)
-            sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xC5, 0xC8, 0x7E);
-            break;
-
-       case AUDIO_STATE_SEND_VC:    // 4.3.9. Volume control 1 to 31 (send)
-            if (g_AudioCfg_VC != 0)
-            {
-               /* checksum integer calculation [0x04, 0xAE, 0x1F]*/
-               checksum_int = 4 + 174 + g_AudioCfg_VC;
-               sprintf(buffer, "%c%c%c%c%c%c", 0x7E, 0x04, 0xAE, g_AudioCfg_VC, checksum_int, 0x7E);
-            }
-            else
-            {
-               /* send dummy "Stop playback" without 0x00 go into next state */
-               sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xAB, 0xAE, 0x7E);
-            }
-            break;
-                 
-       case AUDIO_STATE_SEND_ST:    // 4.3.13. Storage device (send)
-            if (g_AudioCfg_ST != 0)   
-            {
-               /* 01: shift to USB flash drive */
-               sprintf(buffer, "%c%c%c%c%c%c", 0x7E, 0x04, 0xD2, 0x01, 0xD7, 0x7E);
-            }
-            else
-            {  
-               /* send dummy "Stop playback" without 0x00 go into next state */
-               sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xAB, 0xAE, 0x7E);
-            }              
-            break;
-          
-       case AUDIO_STATE_SEND_IM:    // 4.3.14. Input Mode (send)
-            if (g_AudioCfg_IM != 0)   
-            {
-                if(g_AudioCfg_IM == 1)
-                {
-                   /* 01: connect with LINE-IN */
-                  sprintf(buffer, "%c%c%c%c%c%c", 0x7E, 0x04, 0xD3, 0x01, 0xD8, 0x7E);
-                }
-                if(g_AudioCfg_IM == 2)
-                {
-                   /* 02: connect with 2-channel Aux-In signal */
-                  sprintf(buffer, "%c%c%c%c%c%c", 0x7E, 0x04, 0xD3, 0x02, 0xD9, 0x7E);
-                }
-            }
-            else
-            {  
-               /* send dummy "Stop playback" without 0x00 go into next state */
-               sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xAB, 0xAE, 0x7E);
-            }
-            break;
-
-       case AUDIO_STATE_SEND_RQ:   // 4.3.15. Recording quality (send)
-            if (g_AudioCfg_RQ != 0)
-            {
-               if(g_AudioCfg_RQ == 1)
-               {
-                  /* 01: 96kbps */
-                  sprintf(buffer, "%c%c%c%c%c%c", 0x7E, 0x04, 0xD4, 0x01, 0xD9, 0x7E);
-               }
-               else
-               {
-                  if(g_AudioCfg_RQ == 2)
-                  {
-                     /* 02: 64kbps */
-                     sprintf(buffer, "%c%c%c%c%c%c", 0x7E, 0x04, 0xD4, 0x02, 0xDA, 0x7E);
-                  }
-                  else
-                  {  
-                     /* 03: 32kps */
-                     sprintf(buffer, "%c%c%c%c%c%c", 0x7E, 0x04, 0xD4, 0x03, 0xDB, 0x7E);
-                  }
-               }
-            }
-            else
-            {  
-               /* send dummy "Stop playback" without 0x00 go into next state */
-               sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xAB, 0xAE, 0x7E);
-            }
-            break;
-         
-       case AUDIO_SEND_PLAYBACK: // 4.3.2 Specify playback of a file by name [P001-P005] (send)
-            l_flgLocked = true;
-            if (PlaybackFileNumber <= 5)
-            {
-               PlaybackFileNumber = PlaybackFileNumber + 48;// 49 dez. -> 0x31
-               /* checksum integer calculation [0x07, 0xA3, 0x50, 0x30, 0x30]*/
-               checksum_int = 7 + 163 + 80 + 48 + 48 + PlaybackFileNumber;//18B
-               sprintf(buffer, "%c%c%c%c%c%c%c%c%c", 0x7E, 0x07, 0xA3, 0x50, 0x30, 0x30, PlaybackFileNumber, checksum_int, 0x7E);
-            }           
-            else
-            {
-               /* send dummy "Stop playback" without 0x00 go into next state */
-               sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xAB, 0xAE, 0x7E);
-            }
-            break;
-            
-       case AUDIO_SEND_RECORD: // 4.3.17 Specify recording of a file by name [R001.wav] (send)
-            l_flgLocked = true;
-            /* checksum integer calculation [0x07,0xD6,0x52,0x30,0x30,0x31]*/
-            checksum_int = 7 + 214 + 82 + digit_3 + digit_2 + digit_1;
-            sprintf(buffer, "%c%c%c%c%c%c%c%c%c", 0x7E, 0x07, 0xD6, 0x52, digit_3, digit_2, digit_1, checksum_int, 0x7E);
-            // checksum decimal: 7+214+82+48+48+49 = 448 dec. / 0x1C0
-            break;
-       
-       case AUDIO_SEND_PLAYBACK_STOP: // 4.3.6 Stop playback (send)
-	    sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xAB, 0xAE, 0x7E);
-             //cmd = "7E03ABAE7E";
-	    break;
- 
-       case AUDIO_SEND_RECORD_STOP: // 4.3.20 Stop recording (send) 
-             sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xD9, 0xDC, 0x7E);
-             //cmd = "7E03D9DC7E";
-             break;
-             
-    //  case AUDIO_STATE_OPERATIONAL: // 4.4.6 Current status SD or USB flash (send)
-    //       /* send dummy "Stop playback" without 0x00 go into next state */
-    //        sprintf(buffer, "%c%c%c%c%c", 0x7E, 0x03, 0xAB, 0xAE, 0x7E);
-    //      break;
-    
-
-     default:
-#ifdef LOGGING
-	    LogError("Audio AudioSendCmdSeq(): INVALID STATE %d", state);
-#endif       
-	    cmd =  NULL;
-	    state = AUDIO_STATE_OFF;
+	/* End of the track, chain the next file now */
+	if (l_hdlChain != NONE)
+	    msTimerCancel (l_hdlChain);
+	l_flgChainDue = true;
+	EVENT_POST(EVT_AUDIO);
     }
 
-    l_State = state;		// save current state into local variable
-
-    if (cmd != NULL)
-	SendCmd(cmd);
+    AudioStatusSet (work);
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Send Command
+ * @brief	Audio Frame Handler
  *
- * Send a command to the Audio module.
+ * This routine is called by AudioCheck() for every complete frame that has
+ * been received from the Audio module.  After power-up the status prompt of
+ * the module is passed to AudioSession().  Otherwise the frame is the
+ * response to the oldest
+ * pending command, which is removed from the queue and its callback gets
+ * called.  Storage device and work status frames which are not expected by
+ * the pending command, are reported by the module on its own.  They update
+ * the status model, see AudioStatusNotify().
  *
- * @param[in] pCmdStr
- *	Address pointer of the string to be written into the transmit buffer.
+ * @param[in] pFrame
+ *	Address of the received frame.  Data[0] is the operation code or the
+ *	acknowledge byte, followed by the parameters.
  *
  ******************************************************************************/
-void SendCmd(const char *pCmdStr)
+static void AudioFrameHandler(const AUDIO_FRAME *pFrame)
 {
-  
-   /* Check if previous command has been written already */
-    if (! l_flgTxComplete)
+uint8_t		op = pFrame->Data[0];
+AUDIO_CMD	cmd;
+
+    LOG_DBG ("Audio Frame: 0x%02X, %d byte(s), state=%d",
+	     op, pFrame->Len, l_State);
+
+    if (l_State == AUDIO_STATE_POWER_ON) // Prompt after power-up 4.4.6 Current status SD or USB
     {
-#ifdef LOGGING
-       LogError("Audio SendCmd(%s): Previous command still pending", pCmdStr);
-#endif
-    }  
+	/* Frames during the power-up delay are ignored */
+	if (! l_Sess.flgTimer)
+	{
+	    l_Sess.Frame = *pFrame;
+	    l_Sess.flgFrame = true;
+	}
+	return;
+    }
 
-   /* Check length */
-    unsigned int len = strlen(pCmdStr);
-    if (len > sizeof(l_TxBuffer) - 2)
+    /* See if this is the response to a pending command */
+    if (l_CmdGet == l_CmdSend
+    ||  ((op == AUDIO_OP_DEVICE_STATUS  ||  op == AUDIO_OP_WORK_STATUS)
+	 &&  l_CmdQueue[l_CmdGet % AUDIO_CMD_QUEUE_SIZE].RespOp != op))
     {
-#ifdef LOGGING
-	LogError("Audio SendCmd(%s): Command too long (%d bytes)", pCmdStr, len);
+	if (op == AUDIO_OP_DEVICE_STATUS  &&  pFrame->Len >= 2)
+	{
+	    /* 4.4.6 Current status SD or USB, sent by the module itself */
+	    AudioLogDeviceStatus(pFrame->Data[1]);
+	    if (pFrame->Data[1] == 0x01)
+		Log ("Remove and Insert SD Card to Refresh System");
+
+#if AUDIO_INVENTORY_CACHE
+	    /* Another storage device may be inserted next */
+	    if (pFrame->Data[1] == 0x03)
+		memset (l_Inventory.Missing, 0, sizeof(l_Inventory.Missing));
 #endif
-	return;		// ignore this command
+	    /* Without storage device nothing is played or recorded */
+	    AudioStatusSet (pFrame->Data[1] == 0x03 ? AUDIO_WORK_STOPPED
+						    : AUDIO_WORK_UNKNOWN);
+	}
+	else if (op == AUDIO_OP_WORK_STATUS  &&  pFrame->Len >= 2)
+	{
+	    /* 4.4.2 Current work status, sent by the module itself */
+	    AudioStatusNotify (pFrame->Data[1]);
+	}
+	else
+	{
+	    LogError("Audio: Received 0x%02X in state %d, no command pending",
+		     op, l_State);
+	    SetError(ERR_SRC_AUDIO);	// indicate error via LED
+	}
+	return;
     }
 
-    /* Copy command string into transmit buffer */
-    strcpy(l_TxBuffer, pCmdStr);
+    /* Remove command from the queue */
+    cmd = l_CmdQueue[l_CmdGet % AUDIO_CMD_QUEUE_SIZE];
+    l_CmdGet++;
 
-    /* Clear flag, reset index */
-    l_flgTxComplete = false;
-    l_TxIdx = 0;
+    AudioLatRecord (&cmd);
 
-    /* Enable Tx interrupt to start sending */
-    USART_IntSet(l_Audio_USART.UART, USART_IF_TXBL);
-    USART_IntEnable(l_Audio_USART.UART, USART_IEN_TXBL);
+    if (l_RecoverTier != AUDIO_RECOVER_NONE)
+	AudioRecoverDone();
 
-    /* Start watchdog */
-    /* We need up to 60 sec. to check state AUDIO_GET_SPACE_LEFT */
+    /* Restart watchdog for the next pending command, or cancel it */
     if (l_hdlWdog != NONE)
-	sTimerStart (l_hdlWdog, 60);
+    {
+	if (l_CmdGet != l_CmdSend)
+	    sTimerStart (l_hdlWdog, AudioCmdTimeout(
+			 &l_CmdQueue[l_CmdGet % AUDIO_CMD_QUEUE_SIZE]));
+	else
+	    sTimerCancel(l_hdlWdog);
+    }
+
+    if (cmd.pCallback != NULL)
+	cmd.pCallback ((AUDIO_STATE)cmd.Cmd, pFrame);
+
+    /* Commands may have been waiting for this response */
+    AudioCmdPump();
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Check Audio Data
+ * @brief	Audio Command Done
+ *
+ * This is the completion callback for all commands enqueued by
+ * AudioQueueCmd().  It evaluates the work status and other information
+ * returned by the Audio module.  A command of the power-up session is
+ * passed to AudioSessionResume() afterwards, unless it failed.
+ *
+ * @param[in] cmd
+ *	The command which has been completed.
  *
- * This routine is called from Audio RX Handler to check the Work Status 
- * and other information from the audio module.
+ * @param[in] pFrame
+ *	Address of the response frame, or NULL if a timeout occurred.  Data[0]
+ *	is the operation code or the acknowledge byte, followed by the
+ *	parameters.
  *
  ******************************************************************************/
-static void CheckAudioData(void)
+static void AudioCmdDone(AUDIO_STATE cmd, const AUDIO_FRAME *pFrame)
 {
-    /* Cancel watchdog timer */
-    if (l_hdlWdog != NONE)
-	sTimerCancel(l_hdlWdog);
+uint8_t		op;
+unsigned int	value;
 
-#if MOD_DEBUG	// for debugging only
-    Log("Audio Data: '%s' state=%d", l_RxBuffer, l_State);
-#endif
-    /* Consider state */
-    switch (l_State)
+    if (pFrame == NULL)
     {
-        case AUDIO_STATE_POWER_ON: // Prompt after power-up 4.4.6 Current status SD or USB (answer)
-          if (strncmp(l_RxBuffer, "", 1) == 0)  
-          {      
-             /* Connection Status operation code 0xCA is received */
-             if (l_CheckData >= 2)  //l_CheckData = 1
-             {  
-                 if (strncmp(l_RxBuffer, "\0", 2) == 0) // 0x00: both MicroSD card and USB flash connected
-	         {
-                    Log ("Audio: Both MicroSD card and USB flash drive inserted");
-                 }
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x01: MicroSD card connected only	         
-                 {
-                    Log ("Audio: MicroSD card inserted");
-                 }
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x02: USB flash connected only
-                 { 
-                    Log ("Audio: USB flash inserted");
-                 }
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x03: neither MicroSD card or USB flash drive connected
-                 {
-                    Log ("Audio: MicroSD card or USB flash removed");
-                 }
-#ifdef LOGGING
-                 /* Generate Log Message */
- 	         Log ("Waiting %ds for Audio module being ready to accept commands...",
-	               POWER_UP_DELAY);
+	AudioSessionResume (cmd, NULL);
+	return;		// timeout, handled by AudioComTimeoutHandler()
+    }
+
+    op = pFrame->Data[0];
+
+    /* 16bit parameter of the 0xCE and 0xC5 replies */
+    value = (pFrame->Len >= 3 ? (pFrame->Data[1] << 8) | pFrame->Data[2] : 0);
+
+    /* Consider command */
+    switch (cmd)
+    {
+	case AUDIO_GET_WORK_STATUS:	 // 4.4.2 Current work status 0xC2 (answer)
+	    if (op == AUDIO_OP_WORK_STATUS  &&  pFrame->Len >= 2)
+	    {
+		AudioStatusSet (pFrame->Data[1]);
+
+		switch (pFrame->Data[1])
+		{
+		    case AUDIO_WORK_PLAYING:
+			Log("Audio: Work Status Playing");
+			break;
+
+		    case AUDIO_WORK_STOPPED:
+			Log("Audio: Work Status Stopped");
+			break;
+
+		    case AUDIO_WORK_PAUSED:
+			Log ("Audio: Work Status Paused");
+			Log ("Audio: Waiting up to 50s for capacity left (SD 32GB)");
+			break;
+
+		    case AUDIO_WORK_RECORDING:
+			Log ("Audio: Work Status Recording");
+			break;
+
+		    case AUDIO_WORK_FAST_FWD:
+			Log ("Audio: Work Status Fast forward/backward");
+			break;
+
+		    default:
+			break;
+		}
+	    }
+	    else
+	    {
+		/* Work Status replay 0xC2 is not received */
+		LogError("Audio: Work Status execution failed");
+		SetError(ERR_SRC_AUDIO);	// indicate error via LED
+		AudioCmdFlush();
+	    }
+	    break;
+
+	case AUDIO_GET_SPACE_LEFT:   // 4.4.9 Space left in the storage device (answer)
+	    if (op == AUDIO_OP_SPACE_LEFT  &&  pFrame->Len >= 3)
+	    {
+		if (value != 0)
+		{
+		    Log ("Audio: Capacity left (Mb) %d", value);
+#if AUDIO_INVENTORY_CACHE
+		    l_Inventory.SpaceLeft = value;  // file count will follow
 #endif
-                 /* After delay call AudioComTimeout */
-                 if (l_hdlWdog != NONE)
-	         sTimerStart (l_hdlWdog, POWER_UP_DELAY);
- 
-                 l_CheckData = 0;
-                 l_flgComCompleted = true;
-             }
-             l_CheckData++;
-          }
-          else
-          {
-             /* Connection status 0xCA is not received */
-             LogError("Audio: Connection MicroSD card or USB flash execution failed");
-             SetError(ERR_SRC_AUDIO);	// indicate error via LED
-             l_flgComCompleted = true;
-          }
-          break;
-          
-       case AUDIO_GET_WORK_STATUS:	 // 4.4.2 Current work status 0xC2 (answer)
-          if (strncmp(l_RxBuffer, "", 1) == 0)
-	  {      
-               /* Connection Status operation code 0xCA is received */
-              if (l_CheckData >= 2)  // l_CheckData = 1
-              {  
-                 /* Work Status operation code 0xC2 is received */
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x01: Playing
-                 {
-                    Log("Audio: Work Status Playing");
-                    AudioSendCmdSeq(l_State+1);
-                 } 
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x02: Stopped
-                 {
-                    Log("Audio: Work Status Stopped");
-                    l_State = AUDIO_STATE_OPERATIONAL;
-                 }
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x03: Paused
-                 {
-                    Log ("Audio: Work Status Paused");
-                    Log ("Audio: Waiting up to 50s for capacity left (SD 32GB)");  
-                    AudioSendCmdSeq(l_State+1);
-                 }
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x04: Recording
-                 {
-                    Log ("Audio: Work Status Recording");
-                    AudioSendCmdSeq(l_State+1);
-                 }
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x05: Fast forward/backward
-                 {
-                    Log ("Audio: Work Status Fast forward/backward");
-                    AudioSendCmdSeq(l_State+1);
-                 }
-                 l_CheckData = 0;
-                 l_flgComCompleted = true;
-              }
-              l_CheckData++;
-          }
-          else
-          {
-              /* Work Status replay 0xC2 is not received */
-              LogError("Audio: Work Status execution failed");
-              SetError(ERR_SRC_AUDIO);	// indicate error via LED
-              l_flgComCompleted = true;
-          }
-          break;
-          
-       case AUDIO_GET_SPACE_LEFT:   // 4.4.9 Space left in the storage device (answer)
-          if (strncmp(l_RxBuffer, "", 1) == 0)     
-          {
-              /* Connection Status operation code 0xCE is received */
-              if (l_CheckData >= 3) //l_CheckData = 1
-              { 
-                  /* Operation code 0xCE is received */
-                  if (l_RxBuffer[2] != 0x00) // no space left on SD Card or USB flash
-                  {
-                     // Umrechnung hex into dez
-                     a = ((l_RxBuffer[1] >> 4) & 0x0F) * 4096;// 16x16x16
-                     b =  (l_RxBuffer[1] & 0x0F) * 256;       // 16x16
-                     c = ((l_RxBuffer[2] >> 4) & 0x0F) * 16;  // 16
-                     d =  (l_RxBuffer[2] & 0x0F) * 1;         // 1
-                    
-                     Log ("Audio: Capacity left (Mb) %d", a+b+c+d);
-                     
-                     l_CheckData = 0;
-                     l_flgComCompleted = true;
-                     AudioSendCmdSeq(l_State+1);
-                 }
-                 else
-                 {
-                     LogError("Audio: No Space left");
-                     SetError(ERR_SRC_AUDIO);	// indicate error via LED
-                     l_CheckData = 0;
-                     l_flgComCompleted = true;
-                 }
-              }
-              l_CheckData++;
-           }
-           else
-           {
-              /* "" command execution failed */
-              LogError("Audio: Get Space Volume execution failed");
-              SetError(ERR_SRC_AUDIO);	// indicate error via LED
-              l_CheckData = 0;
-           } 
-           break;   
- 
-        case AUDIO_GET_FILE_NUMBERS:  // 4.4.3 Total file numbers in root directory 0xC5 (answer)
-          if (strncmp(l_RxBuffer, "", 1) == 0) // tested for 160 files
-	  { 
-              /* Connection Status operation code 0xC5 is received */
-              if (l_CheckData >= 3) //l_CheckAUDIOData = 1
-              {     
-                  if (l_RxBuffer[2] != 0x00) // file number low digits
-                  {
-                      // Umrechnung hex into dez
-                       a = ((l_RxBuffer[1] >> 4) & 0x0F) * 4096;// 16x16x16
-                       b =  (l_RxBuffer[1] & 0x0F) * 256;       // 16x16
-                       c = ((l_RxBuffer[2] >> 4) & 0x0F) * 16;  // 16
-                       d =  (l_RxBuffer[2] & 0x0F) * 1;         // 1
-                       
-                       RecordFileNumber = (a+b+c+d)-5;
-                       
-                       Log ("Audio: Total file numbers %d (Includes 5 playback files)", a+b+c+d);
-                       Log ("Audio: Next Record file is [R%03d.wav]", RecordFileNumber + 1);
-                       l_CheckData = 0;
-                       l_flgComCompleted = true;
-                       AudioSendCmdSeq(l_State+1);
-                   }
-                   else
-                   {
-                      LogError("Audio: No file numbers");
-                      SetError(ERR_SRC_AUDIO);	// indicate error via LED
-                      l_CheckData = 0;
-                      l_flgComCompleted = true;
-                   }
-              }
-              l_CheckData++;
-          }
-          else
-          {
-             LogError("Audio: No file numbers execution failed");
-             SetError(ERR_SRC_AUDIO);	// indicate error via LED
-             l_CheckData = 0;
-          }
-          break;
- 
-       case AUDIO_STATE_SEND_VC:    // 4.3.9. Volume control (answer)
-          if (strncmp(l_RxBuffer, "", 1) == 0)     
-          { 
-              /* 0x01 command execution failed */
-              LogError("Audio: Volume execution failed");
-              SetError(ERR_SRC_AUDIO);	// indicate error via LED
-          }
-          else
-          {
-              if (g_AudioCfg_VC == 0)
-              {
-                 Log ("ERROR Audio: Volume %i value must be between 1 and 31", g_AudioCfg_VC);
-              }
-              else
-              {
-                  Log ("Audio: Volume %i is executed successfully", g_AudioCfg_VC);
-              }
-          }
-          l_CheckData = 1;
-          l_flgComCompleted = true;
-          AudioSendCmdSeq(l_State+1);
-          break;
-   
-       case AUDIO_STATE_SEND_ST:    // 4.3.13. Storage device (answer)
-           if (strncmp(l_RxBuffer, "", 1) == 0)
-           {
-              /* 0x01 command execution failed */ 
-              LogError("Audio: Storage device execution failed");
-              SetError(ERR_SRC_AUDIO);	// indicate error via LED
-           }
-           else
-           {
-              if (g_AudioCfg_ST == 0)
-              {
-                 Log ("Audio: MicroSD card is supported");
-              }
-              else 
-              {
-                 Log ("Audio: USB flash drive is supported");
-              }
-           }
-           l_CheckData = 1;
-           l_flgComCompleted = true;
-           AudioSendCmdSeq(l_State+1);
-           break; 
-          
-       case AUDIO_STATE_SEND_IM:    // 4.3.14. Input mode (answer)
-          if (strncmp(l_RxBuffer, "", 1) == 0)     
-          {
-             /* 0x01 command execution failed */  
-             LogError("Audio: Input Mode execution failed");
-             SetError(ERR_SRC_AUDIO);	// indicate error via LED
-          }
-          else
-          {
-             if (g_AudioCfg_IM == 0)
-             {  
-                Log ("Audio: Input Mode connected with MIC");
-             }
-             if (g_AudioCfg_IM == 1)
-             {  
-                Log ("Audio: Input Mode connected with LINE-IN");
-             }
-             if (g_AudioCfg_IM == 2)
-             {  
-                Log ("Audio: Input Mode connected with 2-channel AUX");
-             }
-          }
-          l_CheckData = 1;          
-          l_flgComCompleted = true;
-          AudioSendCmdSeq(l_State+1);
-          break;
-   
-      case AUDIO_STATE_SEND_RQ:   // 4.3.15. Recording quality (answer)
-         if (strncmp(l_RxBuffer, "", 1) == 0)     
-         {  
-            /* 0x01 command execution failed */   
-            LogError("Audio: Recording quality execution failed");
-            SetError(ERR_SRC_AUDIO);	// indicate error via LED
-            l_flgAudioInitIsDone = false;
-         }
-         else
-         { 
-            if (g_AudioCfg_RQ == 0)
-            {  
-               Log ("Audio: Recording quality is 128 Kbps");
-            }
-            if (g_AudioCfg_RQ == 1)
-            {  
-               Log ("Audio: Recording quality is 96 Kbps");
-            }
-            if (g_AudioCfg_RQ == 2)
-            {  
-               Log ("Audio: Recording quality is 64 Kbps");
-            }
-            if (g_AudioCfg_RQ == 3)
-            {  
-               Log ("Audio: Recording quality is 32 Kbps");
-            }
-            Log ("Audio module is operational now");
-	    ClearError(ERR_SRC_AUDIO);	// command sequence completed
-         }
-         l_CheckData = 1;
-         l_flgComCompleted = true;
-         l_State = AUDIO_STATE_OPERATIONAL;
-         l_flgLocked = false;
-         l_flgAudioInitIsDone = true;
-         break;
-     
-      case AUDIO_SEND_PLAYBACK: // 4.3.2 Specify playback of a file by name [P001-P005] (answer)
-          if (strncmp(l_RxBuffer, "", 1) == 0) 
-          {
-               /* 0x01 command execution failed */
-               LogError("Audio: Playback ON execution failed - Control Playback Type - Wait for Playback off");
-          }
-	  else
-	  {
-              if (PlaybackFileNumber == 1 || PlaybackFileNumber == 49)// 49 dez. -> 0x31
-              {   
-                 Log ("Audio: Playback ON [P001.x]");
-	      }
-              if (PlaybackFileNumber == 2 || PlaybackFileNumber == 50)// 50 dez. -> 0x32
-              {   
-                 Log ("Audio: Playback ON [P002.x]");
-	      }
-              if (PlaybackFileNumber == 3 || PlaybackFileNumber == 51)// 51 dez. -> 0x33
-              {   
-                 Log ("Audio: Playback ON [P003.x]");
-	      }
-              if (PlaybackFileNumber == 4 || PlaybackFileNumber == 52)// 52 dez. -> 0x34
-              {   
-                 Log ("Audio: Playback ON [P004.x]");
-	      }
-              if (PlaybackFileNumber == 5 || PlaybackFileNumber == 53)// 53 dez. -> 0x35
-              {   
-                 Log ("Audio: Playback ON [P005.x]");
-	      }
-          }
-          PlaybackFileNumber = 0;
-          l_flgComCompleted = true;
-          l_State = AUDIO_STATE_OPERATIONAL;
-       	  break;
-              
-      case  AUDIO_SEND_RECORD: // 4.3.17 Specify recording of a file by name [R001.wav] (answer)
-          if (strncmp(l_RxBuffer, "", 1) == 0) 
-          {
-              /* 0x01 command execution failed */
-              LogError("Audio: Storage device is full");
-          }          
-	  else
-	  {
-             /* 3-Digit Integer Value */ 
-             Log ("Audio: Record ON [R%03d.wav]", RecordFileNumber);
-          }
-          if (strncmp(l_RxBuffer, "", 1) == 0)
-          {
-              /* 0x02 command execution failed */
-              LogError("Audio: Record ON execution failed");
-          }
-          digit_1 = 0;
-          digit_2 = 0;
-          digit_3 = 0;
-          l_flgComCompleted = true;
-          l_State = AUDIO_STATE_OPERATIONAL;
-          break;
-            
-       case AUDIO_SEND_PLAYBACK_STOP: // 4.3.6 Stop playback (answer)
-	   if (strncmp(l_RxBuffer, "", 1) == 0) 
-           {
-	        /* 0x01 command execution failed */
-                LogError("Audio: Playback off execution failed");
-	    }    
-            else
+		}
+		else
+		{
+		    /* no space left on SD Card or USB flash */
+		    LogError("Audio: No Space left");
+		    SetError(ERR_SRC_AUDIO);	// indicate error via LED
+		    AudioCmdFlush();
+		}
+	    }
+	    else
 	    {
-               Log("Audio: Playback off");
-               l_flgLocked = false;
-            }
-            l_flgIsRecordBlocked = false;
-            l_flgComCompleted = true;
-            l_State = AUDIO_STATE_OPERATIONAL;
+		/* 0xCE command execution failed */
+		LogError("Audio: Get Space Volume execution failed");
+		SetError(ERR_SRC_AUDIO);	// indicate error via LED
+		AudioCmdFlush();
+	    }
 	    break;
-            
+
+	case AUDIO_GET_FILE_NUMBERS:  // 4.4.3 Total file numbers in root directory 0xC5 (answer)
+	    if (op == AUDIO_OP_FILE_NUMBERS  &&  pFrame->Len >= 3)
+	    {
+		if (value != 0)
+		{
+#if AUDIO_INVENTORY_CACHE
+		    if (AudioInvValid()  &&  value != l_Inventory.FileCnt)
+		    {
+			LOG_WARN ("Audio: Inventory changed, %d files instead"
+				  " of %d", value, l_Inventory.FileCnt);
+
+			/* Other files may have been copied, check them again */
+			memset (l_Inventory.Missing, 0,
+				sizeof(l_Inventory.Missing));
+		    }
+
+		    AudioInvUpdate (value, l_Inventory.SpaceLeft);
+#endif
+		    Log ("Audio: Total file numbers %d (Includes 5 playback files)", value);
+
+		    /* Continue after the existing records */
+		    RecordSeqSeed (value - 5);
+		}
+		else
+		{
+		    LogError("Audio: No file numbers");
+		    SetError(ERR_SRC_AUDIO);	// indicate error via LED
+		    AudioCmdFlush();
+#if AUDIO_INVENTORY_CACHE
+		    AudioInvUpdate (0, 0);	// query again next time
+#endif
+		}
+	    }
+	    else
+	    {
+		LogError("Audio: No file numbers execution failed");
+		SetError(ERR_SRC_AUDIO);	// indicate error via LED
+		AudioCmdFlush();
+	    }
+	    break;
+
+	case AUDIO_STATE_SEND_VC:    // 4.3.9. Volume control (answer)
+	    if (op == AUDIO_ACK_FAILED)
+	    {
+		/* 0x01 command execution failed */
+		LogError("Audio: Volume execution failed");
+		SetError(ERR_SRC_AUDIO);	// indicate error via LED
+		l_ModuleVC = AUDIO_PARM_UNKNOWN;
+	    }
+	    else
+	    {
+		Log ("Audio: Volume %i is executed successfully", l_ModuleVC);
+	    }
+	    break;
+
+	case AUDIO_STATE_SEND_ST:    // 4.3.13. Storage device (answer)
+	    if (op == AUDIO_ACK_FAILED)
+	    {
+		/* 0x01 command execution failed */
+		LogError("Audio: Storage device execution failed");
+		SetError(ERR_SRC_AUDIO);	// indicate error via LED
+	    }
+	    else if (g_AudioCfg_ST == 0)
+	    {
+		Log ("Audio: MicroSD card is supported");
+	    }
+	    else
+	    {
+		Log ("Audio: USB flash drive is supported");
+	    }
+	    break;
+
+	case AUDIO_STATE_SEND_IM:    // 4.3.14. Input mode (answer)
+	    if (op == AUDIO_ACK_FAILED)
+	    {
+		/* 0x01 command execution failed */
+		LogError("Audio: Input Mode execution failed");
+		SetError(ERR_SRC_AUDIO);	// indicate error via LED
+		l_ModuleIM = AUDIO_PARM_UNKNOWN;
+	    }
+	    else if (l_ModuleIM == 0)
+	    {
+		Log ("Audio: Input Mode connected with MIC");
+	    }
+	    else if (l_ModuleIM == 1)
+	    {
+		Log ("Audio: Input Mode connected with LINE-IN");
+	    }
+	    else if (l_ModuleIM == 2)
+	    {
+		Log ("Audio: Input Mode connected with 2-channel AUX");
+	    }
+	    break;
+
+	case AUDIO_STATE_SEND_RQ:   // 4.3.15. Recording quality (answer)
+	    if (op == AUDIO_ACK_FAILED)
+	    {
+		/* 0x01 command execution failed */
+		LogError("Audio: Recording quality execution failed");
+		SetError(ERR_SRC_AUDIO);	// indicate error via LED
+	    }
+	    else
+	    {
+		if (l_AudioRQ == 0)
+		    Log ("Audio: Recording quality is 128 Kbps");
+		else if (l_AudioRQ == 1)
+		    Log ("Audio: Recording quality is 96 Kbps");
+		else if (l_AudioRQ == 2)
+		    Log ("Audio: Recording quality is 64 Kbps");
+		else if (l_AudioRQ == 3)
+		    Log ("Audio: Recording quality is 32 Kbps");
+
+		Log ("Audio module is operational now");
+		ClearError(ERR_SRC_AUDIO);	// command sequence completed
+	    }
+	    break;
+
+	case AUDIO_SEND_PLAYBACK: // 4.3.2 Specify playback of a file by name [P001-P999] (answer)
+	    if (op == AUDIO_ACK_FAILED)
+	    {
+		/* 0x01 command execution failed */
+		LogError("Audio: Playback ON execution failed - Control Playback Type - Wait for Playback off");
+#if AUDIO_INVENTORY_CACHE
+		AudioFileMissingSet (PlaybackFileNumber);
+#endif
+#if VISIT_STATS
+		VisitStatsAudio (VISIT_PLAY_FAIL, PlaybackFileNumber);
+#endif
+	    }
+	    else
+	    {
+		AudioStatusSet (AUDIO_WORK_PLAYING);
+
+		if (PlaybackFileNumber >= 1
+		&&  PlaybackFileNumber <= PLAYLIST_MAX_FILE)
+		    Log ("Audio: Playback ON [P%03d.x]", PlaybackFileNumber);
+#if VISIT_STATS
+		VisitStatsAudio (VISIT_PLAY_ON, PlaybackFileNumber);
+#endif
+
+		/* select the next file now, send it at the deadline */
+		if (g_AudioPlaybackChain > 0  &&  l_flgIsPlayAction
+		&&  l_hdlChain != NONE)
+		{
+		    l_ChainFile = AudioPlaybackSelect();
+		    msTimerStart (l_hdlChain, g_AudioPlaybackChain);
+		}
+	    }
+	    PlaybackFileNumber = 0;
+	    break;
+
+	case AUDIO_SEND_RECORD: // 4.3.17 Specify recording of a file by name [R001.wav] (answer)
+	    if (op == AUDIO_ACK_FAILED)
+	    {
+		/* 0x01 command execution failed */
+		LogError("Audio: Storage device is full");
+#if VISIT_STATS
+		VisitStatsAudio (VISIT_REC_FAIL, atoi (l_RecName));
+#endif
+	    }
+	    else if (op == AUDIO_ACK_FAILED_2)
+	    {
+		/* 0x02 command execution failed */
+		LogError("Audio: Record ON execution failed");
+#if VISIT_STATS
+		VisitStatsAudio (VISIT_REC_FAIL, atoi (l_RecName));
+#endif
+	    }
+	    else
+	    {
+		if (l_RecSegment == 0)
+		    Log ("Audio: Record ON [R%s.wav]", l_RecName);
+		else
+		    Log ("Audio: Record ON [R%s.wav], segment %d", l_RecName,
+			 l_RecSegment);
+		AudioStatusSet (AUDIO_WORK_RECORDING);
+		l_RecStart = (uint32_t)time(NULL);
+#if VISIT_STATS
+		VisitStatsAudio (VISIT_REC_ON, atoi (l_RecName));
+#endif
+#if VISIT_RECORDS
+		VisitStatsSegment (atoi (l_RecName), l_RecSegment,
+				   pFrame->Stamp);
+#endif
+		/* the next segment starts after the maximum length */
+		if (g_AudioRecSegment > 0  &&  l_hdlSegment != NONE)
+		    msTimerStart (l_hdlSegment, g_AudioRecSegment);
+	    }
+	    break;
+
+	case AUDIO_SEND_PLAYBACK_STOP: // 4.3.6 Stop playback (answer)
+	    if (op == AUDIO_ACK_FAILED)
+	    {
+		/* 0x01 command execution failed */
+		LogError("Audio: Playback off execution failed");
+	    }
+	    else
+	    {
+		Log("Audio: Playback off");
+		l_flgLocked = false;
+		AudioStatusSet (AUDIO_WORK_STOPPED);
+#if VISIT_STATS
+		VisitStatsAudio (VISIT_PLAY_OFF, 0);
+#endif
+	    }
+	    l_flgIsRecordBlocked = false;
+	    break;
+
 	case AUDIO_SEND_RECORD_STOP: // 4.3.20 Stop recording (answer)
-           if (strncmp(l_RxBuffer, "", 1) == 0) 
-           {
-                LogError("Audio: Record off execution failed");
-           }
-	   else
-	   {
-              Log("Audio: Record off");
-              l_flgLocked = false;
-           }
-           l_flgComCompleted = true;
-           l_State = AUDIO_STATE_OPERATIONAL;
-	   break;
-           
-      case AUDIO_STATE_OPERATIONAL: // 4.4.6 Current status SD or USB (answer)
-          if (strncmp(l_RxBuffer, "", 1) == 0)  
-	  {      
-              /* Connection Status operation code 0xCA is received */
-              if (l_CheckData >= 2)  // even or odd (ungerade) CheckData = 0
-              {  
-                 if (strncmp(l_RxBuffer, "\0", 2) == 0) // 0x00: both MicroSD card and USB flash connected
-	         {
-                    Log ("Audio: Both MicroSD card and USB flash drive inserted");
-                 }
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x01: MicroSD card connected only	         
-                 {
-                    Log ("Audio: MicroSD card inserted");
-                    Log ("Remove and Insert SD Card to Refresh System");
-                 }
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x02: USB flash connected only
-                 { 
-                    Log ("Audio: USB flash inserted");
-                 }
-                 if (strncmp(l_RxBuffer, "", 2) == 0) // 0x03: neither MicroSD card or USB flash drive connected
-                 {
-                    Log ("Audio: MicroSD card or USB flash removed");
-                 }
-                 l_CheckData = 0;
-                 l_flgComCompleted = true;
-              }
-              l_CheckData++;
-           }
-           else
-           {
-              l_flgComCompleted = true;
-           }
-           break;
-   
-   
-	default:			// unknown state
-            LogError("Audio: Received \"%s\" for unhandled state %d",
-		     l_RxBuffer, l_State);
+	    if (op == AUDIO_ACK_FAILED)
+	    {
+		LogError("Audio: Record off execution failed");
+	    }
+	    else
+	    {
+		Log("Audio: Record off");
+		l_flgLocked = false;
+		AudioStatusSet (AUDIO_WORK_STOPPED);
+		AudioRecAccount();
+#if VISIT_STATS
+		VisitStatsAudio (VISIT_REC_OFF, 0);
+#endif
+	    }
+#if AUDIO_INVENTORY_CACHE
+	    l_flgReconcile = true;	// verify the file count when idle
+#endif
+	    break;
+
+	default:			// unknown command
+	    LogError("Audio: Received 0x%02X for unhandled command %d",
+		     op, cmd);
 	    SetError(ERR_SRC_AUDIO);		// indicate error via LED
-            l_flgComCompleted = true;
+	    break;
     }
+
+    /* The power-up session may wait for this response */
+    AudioSessionResume (cmd, pFrame);
 }
 
 
@@ -1415,13 +3810,63 @@ static void CheckAudioData(void)
 static USART_InitAsync_TypeDef uartInit = USART_INITASYNC_DEFAULT;
 
 
+/**************************************************************************//**
+ * @brief  DMA Callback function for Audio Tx
+ *
+ * Called from the DMA interrupt handler when a transfer has been completed.
+ * The transferred data is released from the transmit ring, then the next
+ * transfer is started if more data is available.
+ *****************************************************************************/
+static void AudioTxDone(unsigned int channel, bool primary, void *user)
+{
+    (void) channel;		// suppress compiler warnings "unused parameter"
+    (void) primary;
+    (void) user;
+
+    ISR_PROF_ENTER();
+
+    /* Release transmitted data, go on with the rest */
+    l_TxGet += l_TxDMA_Cnt;
+    l_TxDMA_Cnt = 0;
+    AudioTxDMA_Start();
+
+    /* Commands may be waiting for space in the transmit ring */
+    if (l_CmdSend != l_CmdPut)
+	EVENT_POST(EVT_AUDIO);
+
+    ISR_PROF_EXIT(ISR_PROF_AUDIO_TX);
+}
+
+
 /**************************************************************************//**
  * @brief Audio UART Setup Routine
+ *
+ * The DMA configuration is only needed here, DMA_CfgChannel() and
+ * DMA_CfgDescr() copy it into the controller, so it lives on the stack.
  *****************************************************************************/
 static void AudioUartSetup(void)
 {
+/* Setting up DMA channel for Tx */
+DMA_CfgChannel_TypeDef chnlCfgTx =
+{
+    .highPri   = false,			// Normal priority
+    .enableInt = true,			// Interrupt for callback function
+    .select    = l_Audio_USART.DMA_Req_Tx,
+    .cb        = NULL,			// Callback is set by DmaChanConfig()
+};
+
+/* Setting up channel descriptor for Tx */
+DMA_CfgDescr_TypeDef descrCfgTx =
+{
+    .dstInc  = dmaDataIncNone,		// Do not increment destination address
+    .srcInc  = dmaDataInc1,		// Increment source address by one byte
+    .size    = dmaDataSize1,		// Data size is one byte
+    .arbRate = dmaArbitrate1,		// Rearbitrate for each byte
+    .hprot   = 0,			// No read/write source protection
+};
+
     /* Enable clock for USART module */
-    CMU_ClockEnable(l_Audio_USART.cmuClock_UART, true);
+    ClockAcquire (CLK_OWN_AUDIO, l_Audio_USART.cmuClock_UART);
 
     /* Configure GPIO Rx and Tx pins - enable pull-up for Rx */
     GPIO_PinModeSet(l_Audio_USART.UART_Rx_Port,
@@ -1432,7 +3877,7 @@ static void AudioUartSetup(void)
     /* Prepare structure for initializing UART in asynchronous mode */
     uartInit.enable       = usartDisable;   // Don't enable UART upon initialization
     uartInit.refFreq      = 0;              // Set to 0 to use reference frequency
-    uartInit.baudrate     = l_Audio_USART.Baudrate;
+    uartInit.baudrate     = l_Baudrate;
     uartInit.oversampling = usartOVS16;     // Oversampling. Range is 4x, 6x, 8x or 16x
     uartInit.databits     = l_Audio_USART.DataBits;
     uartInit.parity       = l_Audio_USART.Parity;
@@ -1450,11 +3895,13 @@ static void AudioUartSetup(void)
     USART_IntClear(l_Audio_USART.UART, _USART_IFC_MASK);
     USART_IntEnable(l_Audio_USART.UART, USART_IEN_RXDATAV);
     NVIC_SetPriority(l_Audio_USART.UART_Rx_IRQn, INT_PRIO_UART);
-    NVIC_SetPriority(l_Audio_USART.UART_Tx_IRQn, INT_PRIO_UART);
     NVIC_ClearPendingIRQ(l_Audio_USART.UART_Rx_IRQn);
-    NVIC_ClearPendingIRQ(l_Audio_USART.UART_Tx_IRQn);
     NVIC_EnableIRQ(l_Audio_USART.UART_Rx_IRQn);
-    NVIC_EnableIRQ(l_Audio_USART.UART_Tx_IRQn);
+
+    /* Prepare DMA channel for Tx, the DMA controller is already initialized */
+    DmaChanConfig(DMA_CHAN_AUDIO_TX, "Audio Tx", &chnlCfgTx,
+		  AudioTxDone, NULL);
+    DMA_CfgDescr(DMA_CHAN_AUDIO_TX, true, &descrCfgTx);
 
     /* Enable I/O pins at UART location #2 */
     l_Audio_USART.UART->ROUTE  = USART_ROUTE_RXPEN
@@ -1467,79 +3914,230 @@ static void AudioUartSetup(void)
 
 
 /**************************************************************************//**
- * @brief USART0 RX IRQ Handler
+ * @brief Fall back to the factory baud rate
+ *
+ * This routine is called by AudioCheck() when frames have been received with
+ * errors at @ref AUDIO_BAUDRATE, i.e. the module does not support this rate.
+ * The link is switched to 9600.  During power-up the prompt of the module
+ * has been lost, so it is powered off, and AudioCheck() powers it on again.
+ * Otherwise the pending commands are repeated by the timeout handler.
  *****************************************************************************/
-void USART0_RX_IRQHandler(void)
+static void AudioBaudFallback(void)
 {
-uint8_t rxData;
+    LOG_WARN ("Audio: Receive errors at %ld baud, falling back to %ld",
+	      l_Baudrate, l_Audio_USART.Baudrate);
 
-    /* Check for RX data valid interrupt */
-    if (l_Audio_USART.UART->IF & USART_IF_RXDATAV)
+    l_Baudrate = l_Audio_USART.Baudrate;
+    AudioRxReset();		// discard frames received at the old rate
+
+    if (l_State == AUDIO_STATE_POWER_ON)
     {
-	/* Get byte from RX data register */
-	rxData = l_Audio_USART.UART->RXDATA;
-        
-#if MOD_DEBUG	// for debugging only
-	Log("DBG: 0x%02X ('%c')", rxData,rxData < ' '? '.':rxData);
-#endif
-	switch (rxData)
-	{
-           case 0xFF: // may be sent after power-up - just ignore
-           break;
-                
-           default:	// any other character
-	      if (l_RxIdx < sizeof(l_RxBuffer) - 2)
-              {	
-	          if (l_flgComCompleted)
-                  {
-                      l_RxIdx = 0;
-                      l_RxBuffer[1] = EOS;
-                      l_RxBuffer[2] = EOS;
-                      l_RxBuffer[3] = EOS;
-                      l_flgComCompleted = false;
-                  }
-                  l_RxBuffer[l_RxIdx++] = rxData;
-                  CheckAudioData();
-               }  
-	       else if (l_RxIdx < sizeof(l_RxBuffer) - 1)
-               {
-		   l_RxBuffer[l_RxIdx++] = EOS;
-		   LogError("Audio: l_RxBuffer full - Data=\"%s\"",
-			     l_RxBuffer);
-	       }
-	       break;               
-              
-	} // switch (rxData)
+	AudioPowerOff();
+	l_flgAudioIsOn = false;
+	EVENT_POST(EVT_AUDIO);
+    }
+    else
+    {
+	USART_BaudrateAsyncSet (l_Audio_USART.UART, 0, l_Baudrate, usartOVS16);
+    }
+}
+
+
+/**************************************************************************//**
+ * @brief Reset the receive frame assembler and the ring of frames
+ *****************************************************************************/
+static void AudioRxReset(void)
+{
+    INT_Disable();
+    l_RxState = RX_IDLE;
+    l_RxPut = l_RxGet = 0;
+    l_RxErrCnt = l_RxOverrunCnt = 0;
+    INT_Enable();
+}
+
+
+/**************************************************************************//**
+ * @brief Number of bytes of an unframed reply, including the opcode
+ *****************************************************************************/
+static uint8_t AudioRawReplyLen(uint8_t op)
+{
+    switch (op)
+    {
+	case AUDIO_OP_WORK_STATUS:	// opcode and status byte
+	case AUDIO_OP_DEVICE_STATUS:
+	    return 2;
+
+	case AUDIO_OP_FILE_NUMBERS:	// opcode and 16bit value
+	case AUDIO_OP_SPACE_LEFT:
+	    return 3;
+
+	default:			// acknowledge 0x00, 0x01, 0x02
+	    return 1;
+    }
+}
+
+
+/**************************************************************************//**
+ * @brief Store the assembled frame into the ring and restart the assembler
+ *****************************************************************************/
+static void AudioRxFrameStore(void)
+{
+    if ((uint8_t)(l_RxPut - l_RxGet) < AUDIO_RX_FRAME_CNT)
+    {
+	l_RxFrame.Stamp = RTC->CNT;	// time of reception, e.g. of a record
+
+	l_RxRing[l_RxPut % AUDIO_RX_FRAME_CNT] = l_RxFrame;
+	l_RxPut++;
+	EVENT_POST(EVT_AUDIO);	// process frame in the main loop
+    }
+    else
+    {
+	l_RxOverrunCnt++;	// ring full, frame is lost
+	l_Telem.Overrun++;
     }
+    l_RxState = RX_IDLE;
 }
 
 
 /**************************************************************************//**
- * @brief USART0 TX IRQ Handler
+ * @brief USART0 RX IRQ Handler
+ *
+ * Assembles the received bytes to frames.  Two formats are accepted:
+ * - Framed messages <b>0x7E,len,opcode,parameters,checksum,0x7E</b>, where
+ *   <i>len</i> counts the bytes from itself up to the checksum, and the
+ *   checksum is the low byte of the sum of <i>len</i>, opcode and parameters.
+ * - Unframed replies, i.e. an opcode followed by a number of parameter bytes
+ *   determined by AudioRawReplyLen(), or a single acknowledge byte.
+ *
+ * Complete frames are put into @ref l_RxRing and processed by AudioCheck().
+ * Frames with invalid length, checksum, or delimiter are discarded.  So is
+ * the frame in progress if a byte has a framing or parity error, or if the
+ * receive buffer of the USART has overflowed, i.e. a byte has been lost.
  *****************************************************************************/
-void USART0_TX_IRQHandler(void)
+void USART0_RX_IRQHandler(void)
 {
-uint8_t  txData;
+uint16_t rxDataX;
+uint8_t rxData;
+
+    ISR_PROF_ENTER();
 
-    /* Check TX buffer level status */
-    if (l_Audio_USART.UART->IF & USART_IF_TXBL)
+    /* Check for RX data valid interrupt */
+    if (l_Audio_USART.UART->IF & USART_IF_RXDATAV)
     {
-	/* Get the next character from the transmit buffer */
-	txData = l_TxBuffer[l_TxIdx];
+	/* A byte has been lost before this one - discard the frame */
+	if (l_Audio_USART.UART->IF & USART_IF_RXOF)
+	{
+	    l_Audio_USART.UART->IFC = USART_IFC_RXOF;
+	    l_Telem.UartOverrun++;
+	    if (l_RxState != RX_IDLE)
+	    {
+		l_RxErrCnt++;
+		EVENT_POST(EVT_AUDIO);	// report it in the main loop
+		l_RxState = RX_IDLE;
+	    }
+	}
+
+	/* Get byte including the error flags from RX data register */
+	rxDataX = l_Audio_USART.UART->RXDATAX;
+	rxData = (uint8_t)rxDataX;
 
-	if (txData != 0)
+	if (rxDataX & (USART_RXDATAX_FERR | USART_RXDATAX_PERR))
 	{
-	    /* Transmit next character */
-	    l_Audio_USART.UART->TXDATA = (uint32_t)txData;
-	    l_TxIdx++;
+	    if (rxDataX & USART_RXDATAX_FERR)
+		l_Telem.UartFerr++;
+	    if (rxDataX & USART_RXDATAX_PERR)
+		l_Telem.UartPerr++;
+
+	    l_RxErrCnt++;	// corrupted byte, e.g. wrong baud rate
+	    EVENT_POST(EVT_AUDIO);
+	    l_RxState = RX_IDLE;
+	    ISR_PROF_EXIT(ISR_PROF_AUDIO_RX);
+	    return;
 	}
-	else
+
+	switch (l_RxState)
 	{
-	    /* Disable Tx interrupt if no more bytes in buffer */
-	    USART_IntDisable(l_Audio_USART.UART, USART_IEN_TXBL);
+	    case RX_IDLE:
+		if (rxData == AUDIO_FRAME_DELIM)
+		{
+		    l_RxState = RX_LEN;
+		}
+		else if (rxData != 0xFF)  // may be sent after power-up - ignore
+		{
+		    l_RxFrame.Data[0] = rxData;
+		    l_RxFrame.Len = 1;
+		    l_RxRemain = AudioRawReplyLen(rxData) - 1;
+		    if (l_RxRemain == 0)
+			AudioRxFrameStore();
+		    else
+			l_RxState = RX_RAW;
+		}
+		break;
+
+	    case RX_RAW:
+		l_RxFrame.Data[l_RxFrame.Len++] = rxData;
+		if (--l_RxRemain == 0)
+		    AudioRxFrameStore();
+		break;
+
+	    case RX_LEN:
+		if (rxData == AUDIO_FRAME_DELIM)
+		    break;		// repeated delimiter - stay in sync
+
+		if (rxData < 3  ||  rxData > AUDIO_FRAME_MAX_DATA + 2)
+		{
+		    l_RxErrCnt++;	// invalid length
+		    l_Telem.FrameErr++;
+		    EVENT_POST(EVT_AUDIO);	// report it in the main loop
+		    l_RxState = RX_IDLE;
+		    break;
+		}
+		l_RxFrame.Len = 0;
+		l_RxRemain = rxData - 2;	// opcode and parameters
+		l_RxCsum = rxData;
+		l_RxState = RX_DATA;
+		break;
 
-	    /* Set flag to indicate data has been transmitted completely */
-	    l_flgTxComplete = true;
+	    case RX_DATA:
+		l_RxFrame.Data[l_RxFrame.Len++] = rxData;
+		l_RxCsum += rxData;
+		if (--l_RxRemain == 0)
+		    l_RxState = RX_CSUM;
+		break;
+
+	    case RX_CSUM:
+		if (rxData == l_RxCsum)
+		{
+		    l_RxState = RX_END;
+		}
+		else
+		{
+		    l_RxErrCnt++;	// checksum error
+		    l_Telem.CsumErr++;
+		    EVENT_POST(EVT_AUDIO);
+		    l_RxState = RX_IDLE;
+		}
+		break;
+
+	    case RX_END:
+		if (rxData == AUDIO_FRAME_DELIM)
+		{
+		    AudioRxFrameStore();
+		}
+		else
+		{
+		    l_RxErrCnt++;	// missing end delimiter
+		    l_Telem.FrameErr++;
+		    EVENT_POST(EVT_AUDIO);
+		    l_RxState = RX_IDLE;
+		}
+		break;
+
+	    default:
+		l_RxState = RX_IDLE;
+		break;
 	}
     }
+
+    ISR_PROF_EXIT(ISR_PROF_AUDIO_RX);
 }
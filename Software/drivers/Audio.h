@@ -2,9 +2,23 @@
  * @file
  * @brief	Header file of module AUDIO.c
  * @author	Peter Loes
- * @version	2019-11-12
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Added DFLT_RECORD_SEGMENT and g_AudioRecSegment.
+2026-10-15,agnt	Added prototype for AudioParmSet().
+2026-10-15,agnt	Added prototype for AudioStorageForecast().
+2026-10-15,agnt	Added g_AudioServiceDate.
+2026-10-15,agnt	Added AUDIO_BAUDRATE.
+2026-10-15,agnt	Added AudioClockChange().
+2026-10-15,agnt	Added AudioPowerFailResume().
+2026-10-14,agnt	Added ALARM_AUDIO_TELEM_TIME and AudioTelemetryReport().
+2026-10-14,agnt	Added DFLT_RECORD_PREROLL, g_AudioPreRoll, AudioPreRollRequest()
+		and AudioPreRollDecide().
+2026-10-14,agnt	Added DFLT_PLAYBACK_CHAIN and g_AudioPlaybackChain.
+2026-10-14,agnt	Added AUDIO_INVENTORY_CACHE.
+2026-10-14,agnt	Added DFLT_AUDIO_IDLE_TIMEOUT, g_AudioIdleTimeout, AudioWake().
+2026-10-14,agnt	Added SendFrame().
 2019-11-13,rage	Added global configuration values.
 2017-11-08,Loes	Initial version.
 */
@@ -17,6 +31,60 @@ Revision History:
 #include "config.h"		// include project configuration parameters
 #include "Control.h"
 
+/*=============================== Definitions ================================*/
+
+    /*!@brief Default idle time in [s] after which the Audio module is powered
+     * off during ON_TIME (keep-warm mode).  0 keeps it powered all the time.
+     */
+#ifndef DFLT_AUDIO_IDLE_TIMEOUT
+    #define DFLT_AUDIO_IDLE_TIMEOUT	0
+#endif
+
+    /*!@brief Default interval in [ms] for playback chaining, i.e. the next
+     * file is started after this time without stopping the current one.
+     * 0 plays one file per KEEP_PLAYBACK duration.
+     */
+#ifndef DFLT_PLAYBACK_CHAIN
+    #define DFLT_PLAYBACK_CHAIN	0
+#endif
+
+    /*!@brief Default maximum duration in [s] of a pre-roll record, which is
+     * started by the light barrier before the transponder ID is known.
+     * 0 disables the pre-roll.
+     */
+#ifndef DFLT_RECORD_PREROLL
+    #define DFLT_RECORD_PREROLL	0
+#endif
+
+    /*!@brief Default maximum length in [ms] of a record file.  A longer record
+     * is continued in the next file, 0 records one file per RECORD duration.
+     */
+#ifndef DFLT_RECORD_SEGMENT
+    #define DFLT_RECORD_SEGMENT	0
+#endif
+
+    /*!@brief Set 1 to keep the file count, the space left, and the next record
+     * number of the Audio module in RAM, so the slow storage queries are only
+     * sent once, and after a record in the background.
+     */
+#ifndef AUDIO_INVENTORY_CACHE
+    #define AUDIO_INVENTORY_CACHE	1
+#endif
+
+    /*!@brief Baud rate of the link to the Audio module.  The factory setting
+     * of the FN-RM01 is 9600, a higher rate requires a module which has been
+     * set up for it.  It is tried at each power-up, and the link falls back
+     * to 9600 when frames are received with errors.
+     */
+#ifndef AUDIO_BAUDRATE
+    #define AUDIO_BAUDRATE	9600
+#endif
+
+    /*!@brief Time (23:50) when the Audio telemetry is logged, see
+     * AudioTelemetryReport().
+     */
+#define ALARM_AUDIO_TELEM_TIME	23, 50
+
 /*================================ Global Data ===============================*/
 
 extern PWR_OUT   g_AudioPower;
@@ -24,6 +92,11 @@ extern uint32_t  g_AudioCfg_VC;
 extern uint32_t  g_AudioCfg_ST;
 extern uint32_t  g_AudioCfg_IM;
 extern uint32_t  g_AudioCfg_RQ;
+extern uint32_t  g_AudioServiceDate;
+extern uint32_t  g_AudioIdleTimeout;
+extern int32_t   g_AudioPlaybackChain;
+extern uint32_t  g_AudioPreRoll;
+extern int32_t   g_AudioRecSegment;
 
 /*================================ Prototypes ================================*/
 
@@ -36,6 +109,16 @@ void	AudioEnable (void);
     /* Disable AUDIO module*/
 void	AudioDisable (void);
 
+    /* Wake-up AUDIO module in keep-warm mode */
+void	AudioWake (void);
+
+    /* Pre-roll record at the start of a visit */
+void	AudioPreRollRequest (void);
+bool	AudioPreRollDecide (int32_t keepPlayback, int32_t keepRecord);
+
+    /* Volume and input mode of the current transponder ID */
+void	AudioParmSet (int32_t volume, int32_t inputMode);
+
     /* Check if to power-on/off AUDIO module */
 void   AudioCheck (void);
 
@@ -45,11 +128,24 @@ bool	IsAudioLocked (void);
    /* Power AUDIO module Off */
 void	AudioPowerOff (void);
 
-    /* AUDIO Power Fail Handler */
+    /* AUDIO Power Fail Handler and fast resume */
 void	AudioPowerFailHandler (void);
+void	AudioPowerFailResume (void);
+
+    /* HF clock has been switched, recalculate the baud rate */
+void	AudioClockChange (void);
 
 /* Send Command to Audio */
 void	SendCmd (const char *pCmdStr);
 
+    /* Send binary Frame to Audio */
+bool	SendFrame (const uint8_t *pBuf, size_t len);
+
+    /* Report the communication statistics */
+void	AudioTelemetryReport (bool flgLog);
+
+    /* Space left and consumption per day of the storage device */
+bool	AudioStorageForecast (uint32_t *pSpaceMB, uint32_t *pKbPerDay);
+
 
 #endif /* __INC_AUDIO_h */
@@ -2,12 +2,39 @@
  * @file
  * @brief	Battery Monitoring
  * @author	Ralf Gerhauser
- * @version	2020-06-18
+ * @version	2026-10-15
  *
  * This module periodically reads status information from the battery pack
  * via its SMBus interface.  It also provides routines to access the registers
  * of the battery controller manually.
  *
+ * Besides the synchronous register read functions, BatteryRegReadAsync()
+ * puts a request into a queue.  The queue is processed by the SMBus interrupt
+ * handler and an msTimer, which provides the transfer timeout and the guard
+ * delay @ref SMB_GUARD_DELAY between two requests.  The result is passed to a
+ * callback function.  EM1 is only required during the transfer itself.
+ *
+ * If @ref SMB_DMA_BLOCK is 1, BatteryRegReadBlock() receives the data of a
+ * block command by a shared DMA channel, see DmaChanAlloc().  SMB_DmaIrq()
+ * only handles the address and command bytes, and the last data byte which
+ * must be answered by a NACK.  The CPU stays in EM1 meanwhile.  The Packet
+ * Error Code of a TI controller is verified once on the completed buffer.
+ *
+ * If @ref BAT_SNAPSHOT_LOG is 1, the periodic battery status is read by
+ * BatterySnapshotReq() in one queued burst into a @ref BAT_SNAPSHOT.  Then
+ * SnapshotLog() only logs the values which changed more than their hysteresis.
+ *
+ * The values of the last snapshot are cached with a time to live each, see
+ * @ref BAT_TTL_VOLTAGE etc.  Consumers get them by BatteryValueGet() from
+ * RAM.  An expired value requests a refresh of the snapshot, which reads
+ * only the expired values in one batch.  Refreshes are at least
+ * @ref BAT_REFRESH_MIN seconds apart, i.e. the SMBus load is bounded.
+ *
+ * If no battery controller answers, and @ref SUPPLY_MON is set, the snapshot
+ * is measured by the ADC instead, see SupplyMon.c.  Then it only contains the
+ * voltage and the state of charge.  BatteryInfoReq() gets these two values
+ * from the last snapshot, all other registers return an error.
+ *
  * @warning
  * The firmware on the battery controller (ATmega32HVB) is quite buggy!
  * When accessing a non-implemented register (e.g. 0x1D), the correct
@@ -23,6 +50,43 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	The DMA configuration is a local variable of SMB_DmaStart().
+2026-10-15,agnt	BatteryRegReadBlock() receives block commands by DMA and
+		verifies their PEC, see SMB_DMA_BLOCK.
+2026-10-15,agnt	The snapshot is a cache with a time to live per value, see
+		BAT_TTL_xxx.  BatterySnapshotReq() only reads the values which
+		are expired.  BatteryValueGet() and BatteryInfoReq() are served
+		from the cache, refreshes are limited by BAT_REFRESH_MIN.
+		LogBatteryInfo() uses the cached voltage and capacity.
+2026-10-15,agnt	Registered BatteryCheck() as task of the main loop, see
+		TASK_REGISTER().
+2026-10-15,agnt	Without a battery controller, the snapshots and the requests
+		of BatteryInfoReq() are served by the supply monitor, see
+		SUPPLY_MON.
+2026-10-15,agnt	The monitoring interval is started by sTimerStartSlack(), so it
+		shares the wake-up of other timers, see BAT_MON_SLACK.
+2026-10-15,agnt	A completed snapshot passes the state of charge to LogFlushSoC(),
+		see LOG_FLUSH_ADAPTIVE.
+2026-10-15,agnt	The trigger flags for probing, monitoring, and the SMBus
+		recovery are bits of <l_BatTrigger>, see FlagTestClr().
+2026-10-15,agnt	SMBus timeouts are measured with the monotonic clock, see
+		ClockMonoTicks().
+2026-10-15,agnt	The I2C clock and EM1 are acquired via ClockMgr.c.
+2026-10-15,agnt	BatteryMonClockChange() recalculates the SMBus clock after a
+		switch of the HF clock, see HF_CLOCK_GOVERNOR.
+2026-10-15,agnt	Use StrFormat() instead of sprintf().
+2026-10-15,agnt	BatteryCtrlProbe() stores the serial number of the Battery
+		Pack, which is compared by BatteryIsUnchanged().
+2026-10-14,agnt	BatteryCheck() is triggered via EVENT_POST(EVT_BATTERY), also
+		by BatteryInfoReq().
+2026-10-14,agnt	Added queue for asynchronous SMBus requests, see
+		BatteryRegReadAsync().  BatteryCheck() handles the requests of
+		BatteryInfoReq() asynchronously, i.e. without msDelay().
+		Added battery status snapshot, see BatterySnapshotReq(), and
+		change-only logging, see BAT_SNAPSHOT_LOG.
+		A completed snapshot drives ControlEnergyGovernor().  The
+		monitoring interval can be stretched by BatteryMonIntervalScale().
+		SMB_IRQHandler: Cycles are measured, see ISR_PROFILE.
 2020-06-18,rage LogBatteryInfo: Removed SBS_ManufacturerData.
 		Disabled workaround for probing prototype battery packs.
 2020-01-22,rage	Added support for battery controller TI bq40z50.
@@ -45,16 +109,24 @@ Revision History:
 
 /*=============================== Header Files ===============================*/
 
+#include <stddef.h>
 #include <string.h>
 #include "em_cmu.h"
 #include "em_i2c.h"
 #include "em_emu.h"
 #include "em_gpio.h"
+#include "em_int.h"
 #include "AlarmClock.h"		// msDelay()
 #include "LEUART.h"
 #include "PowerFail.h"
 #include "BatteryMon.h"
+#include "Control.h"
+#include "IsrProfile.h"
 #include "Logging.h"
+#include "StrFormat.h"
+#include "ClockMgr.h"
+#include "SupplyMon.h"
+#include "DmaChan.h"
 
 /*=============================== Definitions ================================*/
 
@@ -76,6 +148,14 @@ Revision History:
     /*!@brief I2C Recovery Timeout (5s) in RTC ticks */
 #define I2C_RECOVERY_TIMEOUT	(RTC_COUNTS_PER_SEC * 5)
 
+    /*!@brief I2C Transfer Timeout (500ms) for asynchronous requests in [ms] */
+#define SMB_XFER_TIMEOUT	500
+
+    /*!@brief Size of the DMA buffer for a block, i.e. the byte count, up to
+     * 32 data bytes, and the PEC.
+     */
+#define SMB_DMA_BUF_SIZE	40
+
     /*!@brief Structure to hold Information about a Battery Controller */
 typedef struct
 {
@@ -111,6 +191,48 @@ typedef enum
     FRMT_TYPE_CNT	//!< Format Type Count
 } FRMT_TYPE;
 
+    /*!@brief States of the SMBus request queue. */
+typedef enum
+{
+    SMB_IDLE,		//!< No transfer in progress, queue is empty
+    SMB_XFER,		//!< Asynchronous transfer in progress
+    SMB_GUARD,		//!< Waiting for the guard delay to start the next one
+    SMB_SYNC,		//!< Synchronous transfer in progress
+} SMB_STATE;
+
+    /*!@brief Entry of the SMBus request queue. */
+typedef struct
+{
+    SBS_CMD	  Cmd;		//!< SBS command, i.e. register address and size
+    uint8_t	 *pBuf;		//!< Buffer to store the data
+    size_t	  Len;		//!< Number of bytes to read
+    SMB_CALLBACK  Function;	//!< Function to call when done
+} SMB_REQ;
+
+    /*!@brief Definition of a @ref BAT_SNAPSHOT value. */
+typedef struct
+{
+    SBS_CMD	 Cmd;		//!< SBS command to read the value
+    uint8_t	 Offset;	//!< Offset of the value in @ref BAT_SNAPSHOT
+    uint8_t	 Size;		//!< Size of the value in bytes (1 or 2)
+    FRMT_TYPE	 Frmt;		//!< Format for the log message
+    uint16_t	 Hyst;		//!< Hysteresis, change to be logged
+    uint16_t	 Ttl;		//!< Time to live of the cached value in [s]
+    const char	*Name;		//!< Short name for the log message
+} SNAP_DEF;
+
+    /*!@brief States of a block read by DMA, see SMB_DmaIrq(). */
+typedef enum
+{
+    SMB_DMA_OFF,	//!< No DMA transfer, I2C_Transfer() is used
+    SMB_DMA_ADDR_W,	//!< START and address for write have been sent
+    SMB_DMA_CMD,	//!< Command byte has been sent
+    SMB_DMA_ADDR_R,	//!< Repeated START and address for read have been sent
+    SMB_DMA_DATA,	//!< Data bytes are received by DMA
+    SMB_DMA_LAST,	//!< Last byte is received by the CPU
+    SMB_DMA_STOP,	//!< STOP condition has been sent
+} SMB_DMA_STATE;
+
 /*================================== Macros ==================================*/
 
 #ifndef LOGGING		// define as UART output, if logging is not enabled
@@ -157,26 +279,175 @@ static I2C_Init_TypeDef smbInit =
     /* Status of the last SMBus transaction */
 volatile I2C_TransferReturn_TypeDef SMB_Status;
 
-    /*!@brief Flag to trigger Battery Controller Probing. */
-static volatile bool	 l_flgBatteryCtrlProbe = true;
+    /*!@brief Bits of @ref l_BatTrigger. */
+typedef enum
+{
+    BAT_TRG_PROBE,	//!< Trigger Battery Controller Probing
+    BAT_TRG_MONITOR,	//!< Trigger battery monitoring measurement
+    BAT_TRG_SMB_RECOVER,//!< Call SMB_Reset() from BatteryCheck() after a timeout
+    BAT_TRG_REFRESH,	//!< Refresh expired values, see BatteryValueGet()
+} BAT_TRIGGER;
+
+    /*!@brief Trigger flags of @ref BAT_TRIGGER, which are set by timers and
+     * interrupt service routines, and handled by BatteryCheck().  Initially
+     * the Battery Controller is probed.
+     */
+static volatile uint32_t l_BatTrigger = (1 << BAT_TRG_PROBE);
+
+    /*!@brief Serial number of the Battery Pack, see BatteryIsUnchanged(). */
+static uint32_t	 l_BatterySerial;
 
-    /*!@brief Flag to trigger battery monitoring measurement. */
-static volatile bool	 l_flgBatMonTrigger;
+    /*!@brief Flag is true if @ref l_BatterySerial is valid. */
+static bool	 l_flgBatterySerial;
 
 #if BAT_MON_INTERVAL > 0
     /* Timer handle for the battery monitoring interval */
 static TIM_HDL	l_thBatMon = NONE;
 #endif
 
+    /*!@brief Factor for @ref BAT_MON_INTERVAL, see BatteryMonIntervalScale(). */
+static uint8_t	 l_BatMonFactor = 1;
+
     /* Battery Info structure - may hold up to two info requests */
 static BAT_INFO  l_BatInfo;
 
+    /*!@brief Buffers for word requests of @ref l_BatInfo. */
+static uint8_t	 l_BatInfoWord[2][4];
+
+    /*!@brief Flag is true while the requests of @ref l_BatInfo are queued. */
+static volatile bool	 l_flgBatInfoQueued;
+
+    /*!@brief Queue for asynchronous SMBus requests. */
+static SMB_REQ	 l_SMB_Queue[SMB_QUEUE_SIZE];
+
+    /*!@brief Get and put index of @ref l_SMB_Queue. */
+static volatile uint8_t	 l_SMB_QueGet, l_SMB_QuePut;
+
+    /*!@brief Current state of the request queue. */
+static volatile SMB_STATE l_SMB_State = SMB_IDLE;
+
+    /*!@brief Transfer sequence of the current asynchronous request, it must
+     * remain valid until the transfer has been completed.
+     */
+static I2C_TransferSeq_TypeDef l_SMB_Xfer;
+
+    /*!@brief Command byte of the current asynchronous request. */
+static uint8_t	 l_SMB_AddrBuf[1];
+
+    /*!@brief msTimer handle for transfer timeout and guard delay. */
+static volatile TIM_HDL	 l_thSMB = NONE;
+
+#if SMB_DMA_BLOCK
+    /*!@brief State of the block read by DMA. */
+static volatile SMB_DMA_STATE l_SMB_DmaState = SMB_DMA_OFF;
+
+    /*!@brief Shared DMA channel of the block read. */
+static int	 l_SMB_DmaChan = DMA_CHAN_NONE;
+
+    /*!@brief Command byte, and the number of bytes to receive. */
+static uint8_t	 l_SMB_DmaCmd, l_SMB_DmaCnt;
+
+    /*!@brief Final status of the block read, set before the STOP. */
+static int	 l_SMB_DmaResult;
+
+    /*!@brief Receive buffer of the block read, including the PEC. */
+static uint8_t	 l_SMB_DmaBuf[SMB_DMA_BUF_SIZE];
+#endif
+
+    /*!@brief Values of the battery status snapshot.
+     * The order must match the fields of @ref BAT_SNAPSHOT for
+     * @ref BAT_LOG_RECORD.
+     */
+static const SNAP_DEF l_SnapDef[] =
+{
+ { SBS_Voltage,		  offsetof(BAT_SNAPSHOT, Voltage),	     2,
+   FRMT_MILLIVOLT,  BAT_HYST_VOLTAGE,	BAT_TTL_VOLTAGE,	"U"	},
+ { SBS_BatteryCurrent,	  offsetof(BAT_SNAPSHOT, Current),	     2,
+   FRMT_MILLIAMP,   BAT_HYST_CURRENT,	BAT_TTL_CURRENT,	"I"	},
+ { SBS_AverageCurrent,	  offsetof(BAT_SNAPSHOT, AverageCurrent),    2,
+   FRMT_MILLIAMP,   BAT_HYST_CURRENT,	BAT_TTL_CURRENT,	"Iavg"	},
+ { SBS_RemainingCapacity, offsetof(BAT_SNAPSHOT, RemainingCapacity), 2,
+   FRMT_MILLIAMPH,  BAT_HYST_CAPACITY,	BAT_TTL_CAPACITY,	"Cap"	},
+ { SBS_RunTimeToEmpty,	  offsetof(BAT_SNAPSHOT, RunTimeToEmpty),    2,
+   FRMT_DURATION,   BAT_HYST_RUNTIME,	BAT_TTL_RUNTIME,	"Run"	},
+ { SBS_Temperature,	  offsetof(BAT_SNAPSHOT, Temperature),	     2,
+   FRMT_TEMP,	    BAT_HYST_TEMP,	BAT_TTL_TEMP,		"T"	},
+ { SBS_BatteryStatus,	  offsetof(BAT_SNAPSHOT, BatteryStatus),     2,
+   FRMT_HEX,	    1,			BAT_TTL_STATUS,		"Stat"	},
+ { SBS_RelativeStateOfCharge, offsetof(BAT_SNAPSHOT, RelativeStateOfCharge),1,
+   FRMT_PERCENT,    BAT_HYST_SOC,	BAT_TTL_SOC,		"SoC"	},
+};
+
+    /*!@brief Number of values in the snapshot. */
+#define SNAP_CNT	(sizeof(l_SnapDef) / sizeof(l_SnapDef[0]))
+
+    /*!@brief Receive buffers for the snapshot requests. */
+static uint8_t	 l_SnapRaw[SNAP_CNT][4];
+
+    /*!@brief Battery status snapshot that is currently read. */
+static BAT_SNAPSHOT  l_Snapshot;
+
+    /*!@brief Last complete battery status snapshot. */
+static BAT_SNAPSHOT  l_SnapLast;
+
+#if BAT_SNAPSHOT_LOG
+    /*!@brief Values that have been logged the last time. */
+static BAT_SNAPSHOT  l_SnapLogged;
+#endif
+
+    /*!@brief Number of outstanding snapshot requests. */
+static volatile uint8_t	 l_SnapPending;
+
+    /*!@brief Flag is set when a snapshot has been completed. */
+static volatile bool	 l_flgSnapDone;
+
+    /*!@brief Bit mask of the values in @ref l_SnapLast, which have been
+     * read successfully at least once, i.e. which are cached.
+     */
+static volatile uint16_t l_SnapCached;
+
+    /*!@brief Bit mask of the values read successfully by the current batch. */
+static volatile uint16_t l_SnapRead;
+
+    /*!@brief Monotonic time in [s] when the cached values have been read. */
+static uint32_t	 l_SnapTime[SNAP_CNT];
+
+    /*!@brief Monotonic time in [s] when the current or last batch started. */
+static uint32_t	 l_SnapBatchTime;
+
 /*=========================== Forward Declarations ===========================*/
 
 #if BAT_MON_INTERVAL > 0
 static void	BatMonTrigger(TIM_HDL hdl);
 #endif
 static void	BatMonTriggerAlarm(int alarmNum);
+static void	SMB_StartNext(void);
+static void	SMB_Complete(int status);
+static void	SMB_Timer(TIM_HDL hdl);
+#if SMB_DMA_BLOCK
+static bool	SMB_DmaStart(SBS_CMD cmd, size_t rdCnt);
+static void	SMB_DmaIrq(void);
+static void	SMB_DmaDone(unsigned int channel, bool primary, void *user);
+static int	SMB_DmaEnd(int status, uint8_t *pBuf, size_t rdCnt);
+static uint8_t	SMB_Pec(uint8_t crc, const uint8_t *pData, size_t len);
+#endif
+static void	BatInfoDone(SBS_CMD cmd, int status, uint8_t *pBuf);
+static void	SnapshotDone(SBS_CMD cmd, int status, uint8_t *pBuf);
+static int32_t	SnapshotValue(const BAT_SNAPSHOT *pSnap, int idx);
+static void	SnapshotCommit(void);
+static uint32_t	SnapSeconds(void);
+static int	SnapIndex(SBS_CMD cmd);
+static bool	SnapFresh(int idx);
+static bool	SnapCacheRead(SBS_CMD cmd, uint32_t *pValue);
+static bool	BatInfoCached(void);
+#if BAT_SNAPSHOT_LOG
+static void	SnapshotLog(void);
+#endif
+#if SUPPLY_MON
+static bool	BatSupplyFallback(void);
+static void	BatSupplyDone(bool flgOk);
+static int	BatSupplyInfo(SBS_CMD req);
+#endif
 
 
 /***************************************************************************//**
@@ -193,7 +464,7 @@ void	 BatteryMonInit (void)
     CMU_ClockEnable (cmuClock_GPIO, true);
 
     /* Enable clock for I2C controller */
-    CMU_ClockEnable(SMB_I2C_CMUCLOCK, true);
+    ClockAcquire (CLK_OWN_SMB, SMB_I2C_CMUCLOCK);
 
     /* Configure GPIOs for SMBus (I2C) functionality with Pull-Ups */
     GPIO_PinModeSet (SMB_GPIOPORT, SMB_SCL_PIN, gpioModeWiredAndPullUp, 1);
@@ -216,7 +487,7 @@ void	 BatteryMonInit (void)
     {
 	l_thBatMon = sTimerCreate (BatMonTrigger);
 	if (l_thBatMon != NONE)
-	    sTimerStart (l_thBatMon, BAT_MON_INTERVAL);
+	    sTimerStartSlack (l_thBatMon, BAT_MON_INTERVAL, BAT_MON_SLACK);
     }
 #endif
 
@@ -229,8 +500,17 @@ void	 BatteryMonInit (void)
     AlarmSet (ALARM_BATTERY_MON_2, ALARM_BAT_MON_TIME_2);
     AlarmEnable (ALARM_BATTERY_MON_2);
 
+    /* Get a timer handle for asynchronous SMBus requests */
+    if (l_thSMB == NONE)
+	l_thSMB = msTimerCreate (SMB_Timer);
+
     /* Initialize Battery Info structure */
     l_BatInfo.Req_1 = l_BatInfo.Req_2 = SBS_NONE;
+
+#if SUPPLY_MON
+    /* Fallback if no Battery Controller is connected */
+    SupplyMonInit();
+#endif
 }
 
 
@@ -247,11 +527,26 @@ void	 BatteryMonDeinit (void)
     /* Disable SMBus interrupt */
     NVIC_DisableIRQ (SMB_IRQn);
 
+    /* Discard all asynchronous requests */
+    if (l_thSMB != NONE)
+	msTimerCancel (l_thSMB);
+
+    while (l_SMB_QueGet != l_SMB_QuePut)
+    {
+	l_SMB_State = SMB_XFER;		// SMB_Complete() pops the entry
+	SMB_Complete (i2cPowerFail);
+    }
+    if (l_thSMB != NONE)
+	msTimerCancel (l_thSMB);	// no guard delay required
+
+    l_SMB_State = SMB_IDLE;
+    EM1_Release (EM1_MOD_SMB);
+
     /* Reset SMBus controller */
     I2C_Reset (SMB_I2C_CTRL);
 
-    /* Disable clock for I2C controller */
-    CMU_ClockEnable (SMB_I2C_CMUCLOCK, false);
+    /* Release clock for I2C controller */
+    ClockRelease (CLK_OWN_SMB, SMB_I2C_CMUCLOCK);
 
     /* Reset variables */
     g_BatteryCtrlAddr = 0x00;
@@ -260,6 +555,21 @@ void	 BatteryMonDeinit (void)
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Battery Monitor Clock Change
+ *
+ * This routine is called by the HF clock governor after the HF clock has
+ * been switched, see HfClockBoost().  It recalculates the divider of the
+ * SMBus clock.
+ *
+ ******************************************************************************/
+void	 BatteryMonClockChange (void)
+{
+    I2C_BusFreqSet (SMB_I2C_CTRL, 0, smbInit.freq, smbInit.clhr);
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Probe for Controller Type
@@ -271,7 +581,8 @@ void	 BatteryMonDeinit (void)
  * - 0x16 for the TI bq40z50.
  * The address is stored in @ref g_BatteryCtrlAddr, its ASCII name in @ref
  * g_BatteryCtrlName and the controller type is stored as bit definition
- * @ref BC_TYPE in @ref g_BatteryCtrlType.
+ * @ref BC_TYPE in @ref g_BatteryCtrlType.  The serial number of the Battery
+ * Pack is stored for BatteryIsUnchanged().
  *
  ******************************************************************************/
 static void BatteryCtrlProbe (void)
@@ -279,6 +590,7 @@ static void BatteryCtrlProbe (void)
 int	i;
 int	status;
 
+    l_SnapCached = 0;		// the values may be from another Battery Pack
 
     for (i = 0;  l_ProbeList[i].addr != 0x00;  i++)
     {
@@ -316,6 +628,10 @@ int	status;
 	g_BatteryCtrlType = l_ProbeList[1].type;
     }
 #endif
+
+    /* Remember the serial number to detect a change of the Battery Pack */
+    l_flgBatterySerial = (g_BatteryCtrlType != BCT_UNKNOWN
+	&&  BatteryRegReadValue (SBS_SerialNumber, &l_BatterySerial) >= 0);
 }
 
 
@@ -325,16 +641,28 @@ int	status;
  *
  * This handler is executed for each byte transferred via the SMBus interface.
  * It calls the driver function I2C_Transfer() to prepare the next data byte,
- * or generate a STOP condition at the end of a transfer.
+ * or generate a STOP condition at the end of a transfer.  A block read by
+ * DMA is handled by SMB_DmaIrq() instead.
  *
  ******************************************************************************/
 void	 SMB_IRQHandler (void)
 {
     DEBUG_TRACE(0x02);
+    ISR_PROF_ENTER();
 
     /* Update <SMB_Status> */
+#if SMB_DMA_BLOCK
+    if (l_SMB_DmaState != SMB_DMA_OFF)
+	SMB_DmaIrq();
+    else
+#endif
     SMB_Status = I2C_Transfer (SMB_I2C_CTRL);
 
+    /* See if an asynchronous request has been completed */
+    if (l_SMB_State == SMB_XFER  &&  SMB_Status != i2cTransferInProgress)
+	SMB_Complete (SMB_Status);
+
+    ISR_PROF_EXIT(ISR_PROF_SMB);
     DEBUG_TRACE(0x82);
 }
 
@@ -364,11 +692,11 @@ static void  SMB_Reset (void)
 	SMB_I2C_CTRL->ROUTE = I2C_ROUTE_SCLPEN | SMB_LOC;
 
 	/* wait until SCL returns to high */
-	uint32_t start = RTC->CNT;
+	uint32_t start = (uint32_t)ClockMonoTicks();
 	while ((GPIO->P[SMB_GPIOPORT].DIN & (1 << SMB_SCL_PIN)) == 0)
 	{
 	    /* check for timeout */
-	    if (((RTC->CNT - start) & 0x00FFFFFF) > I2C_RECOVERY_TIMEOUT)
+	    if ((uint32_t)ClockMonoTicks() - start > I2C_RECOVERY_TIMEOUT)
 	    {
 		LogError("SMB_Reset: Recovery failed, giving up");
 		break;
@@ -503,9 +831,25 @@ uint8_t addrBuf[1];			// buffer for device address
     if (rdCnt < SBS_CMD_SIZE(cmd))	// if EFM_ASSERT() is empty
 	return i2cInvalidParameter;
 
-    /* Check for power-fail */
-    if (IsPowerFail())
-	return i2cPowerFail;
+    /* Wait until an asynchronous transfer has been completed */
+    while (1)
+    {
+	/* Check for power-fail */
+	if (IsPowerFail())
+	    return i2cPowerFail;
+
+	INT_Disable();
+	if (l_SMB_State != SMB_XFER)
+	{
+	    /* The queue must not start a new transfer in the meantime */
+	    l_SMB_State = SMB_SYNC;
+	    INT_Enable();
+	    break;
+	}
+	INT_Enable();
+
+	EMU_EnterEM1();
+    }
 
     /* Set up SMBus transfer S-Wr-Cmd-Sr-Rd-data1-P */
     smbXfer.addr  = g_BatteryCtrlAddr;	// I2C address of the Battery Controller
@@ -516,230 +860,725 @@ uint8_t addrBuf[1];			// buffer for device address
     smbXfer.buf[1].data = pBuf;		// second buffer to store bytes read
     smbXfer.buf[1].len  = rdCnt;	// number of bytes to read
 
-    /* Start I2C Transfer */
+    /* Start I2C Transfer, the data of a block is received by DMA */
+#if SMB_DMA_BLOCK
+    if (! SMB_DmaStart (cmd, rdCnt))
+#endif
     SMB_Status = I2C_TransferInit (SMB_I2C_CTRL, &smbXfer);
 
-    /* Check early status */
-    if (SMB_Status < 0)
-	return SMB_Status;		// return error code
-
     /* Wait until data is complete or time out */
-    uint32_t start = RTC->CNT;
+    uint32_t start = (uint32_t)ClockMonoTicks();
     while (SMB_Status == i2cTransferInProgress)
     {
 	/* Enter EM1 while waiting for I2C interrupt */
 	EMU_EnterEM1();
 
 	/* check for timeout */
-	if (((RTC->CNT - start) & 0x00FFFFFF) > I2C_XFER_TIMEOUT)
+	if ((uint32_t)ClockMonoTicks() - start > I2C_XFER_TIMEOUT)
 	{
 	    SMB_Reset();
 	    SMB_Status = (I2C_TransferReturn_TypeDef)i2cTransferTimeout;
 	}
     }
 
-    /* Return final status */
+#if SMB_DMA_BLOCK
+    if (l_SMB_DmaChan != DMA_CHAN_NONE)
+	SMB_Status = (I2C_TransferReturn_TypeDef)
+		     SMB_DmaEnd (SMB_Status, pBuf, rdCnt);
+#endif
+
+    /* Let pending asynchronous requests continue after the guard delay */
+    INT_Disable();
+    if (l_SMB_QueGet != l_SMB_QuePut  &&  l_thSMB != NONE)
+    {
+	l_SMB_State = SMB_GUARD;
+	msTimerStart (l_thSMB, SMB_GUARD_DELAY);
+    }
+    else
+    {
+	l_SMB_State = SMB_IDLE;
+    }
+    INT_Enable();
+
+    /* Return final status (including early errors) */
     return SMB_Status;
 }
 
 
+#if SMB_DMA_BLOCK
 /***************************************************************************//**
  *
- * @brief	Item Data String
+ * @brief	Start a Block Read by DMA
  *
- * This routine returns a formatted data string of the specified item data.
- * It uses BatteryRegReadValue() and BatteryRegReadBlock() to read the data
- * directly from the battery controller.
+ * This routine allocates a shared DMA channel, which receives all bytes of
+ * the block except the last one into @ref l_SMB_DmaBuf.  One more byte than
+ * requested is read for the PEC.  Then the START condition and the address
+ * for write are sent, the rest of the transfer is done by SMB_DmaIrq().
  *
  * @param[in] cmd
  *	SBS command, i.e. the register address and number of bytes to read.
  *
- * @param[in] frmt
- *	Format specifier for data representation.
+ * @param[in] rdCnt
+ *	Number of bytes to read.
  *
  * @return
- * 	Static buffer that contains the formatted data string of the item,
- * 	or error message if there was an error, e.g. a read error from the
- * 	battery controller.
- *
- * @warning
- *	This routine is not MT-save (which should not be a problem for this
- *	application)!
+ *	The value <i>true</i> if the transfer has been started, <i>false</i>
+ *	if it is not a block command, or no DMA channel is available.  Then
+ *	the transfer must be done by I2C_Transfer().
  *
  ******************************************************************************/
-static const char *ItemDataString (SBS_CMD cmd, FRMT_TYPE frmt)
+static bool	SMB_DmaStart (SBS_CMD cmd, size_t rdCnt)
 {
-static char	 strBuf[120];	// static buffer to return string into
-uint8_t		 dataBuf[40];	// buffer for I2C data, read from the controller
-uint32_t	 value;		// unsigned data variable
-int		 data = 0;	// generic signed integer data variable
-int		 d, h, m;	// FRMT_DURATION: days, hours, minutes
+/* DMA channel configuration, copied into the controller */
+DMA_CfgChannel_TypeDef chnlCfg =
+{
+    .highPri   = false,			// Normal priority
+    .enableInt = true,			// Interrupt for callback function
+    .select    = DMAREQ_I2C0_RXDATAV,	// Request by a received byte
+    .cb        = NULL,			// Callback is set by DmaChanAlloc()
+};
 
+/* DMA descriptor configuration, from RXDATA into the buffer */
+DMA_CfgDescr_TypeDef descrCfg =
+{
+    .dstInc  = dmaDataInc1,		// Increment destination by a byte
+    .srcInc  = dmaDataIncNone,		// Always read RXDATA
+    .size    = dmaDataSize1,		// Data size is one byte
+    .arbRate = dmaArbitrate1,		// Rearbitrate for each byte
+    .hprot   = 0,			// No read/write source protection
+};
 
-    /* Prepare check for string buffer overflow */
-    strBuf[sizeof(strBuf)-1] = 0x11;
+    if (SBS_CMD_SIZE(cmd) <= 4  ||  rdCnt >= sizeof(l_SMB_DmaBuf))
+	return false;			// words are read by I2C_Transfer()
 
-    if (cmd != SBS_NONE)
-    {
-	/* See how many bytes we need to read */
-	data = SBS_CMD_SIZE(cmd);	// get object size
-	if (data > 4)
-	{
-	    /* More than 32 bits - must be a block, e.g. a string */
-	    EFM_ASSERT(data < (int)sizeof(dataBuf));
+    l_SMB_DmaChan = DmaChanAlloc ("SMBus", &chnlCfg, SMB_DmaDone, NULL);
+    if (l_SMB_DmaChan == DMA_CHAN_NONE)
+	return false;			// all shared channels in use
 
-	    if (BatteryRegReadBlock (cmd, dataBuf, data) < 0)
-		return "READ ERROR";	// READ ERROR
-	}
-	else
-	{
-	    /* Read data word - may be 1, 2, 3, or 4 bytes long */
-	    if (BatteryRegReadValue (cmd, &value) < 0)
-		return "READ ERROR";	// READ ERROR
+    l_SMB_DmaCmd = (uint8_t)cmd;
+    l_SMB_DmaCnt = (uint8_t)(rdCnt + 1);	// including the PEC
 
-	    data = (int)value;
-	}
-    }
+    DMA_CfgDescr (l_SMB_DmaChan, true, &descrCfg);
+    DMA_ActivateBasic (l_SMB_DmaChan, true, false, l_SMB_DmaBuf,
+		       (void *)&SMB_I2C_CTRL->RXDATA, l_SMB_DmaCnt - 2);
 
-    /* Variable <data> contains 16bit raw value, build formatted string */
-    switch (frmt)
-    {
-	case FRMT_STRING:	// return string to be displayed
-	    /*
-	     * The first byte contains the number of ASCII characters WITHOUT
-	     * a trailing 0 as EndOfString marker.  However, in some cases the
-	     * specified byte count is larger than the string - then an EOS
-	     * marker exists in the data read from the controller.
-	     */
-	    data = dataBuf[0];
-	    EFM_ASSERT(data < (int)(sizeof(strBuf)-1));
-	    strncpy (strBuf, (char *)dataBuf+1, data);
-	    strBuf[data] = EOS;		// terminate string
-	    break;
+    SMB_Status = i2cTransferInProgress;
+    l_SMB_DmaState = SMB_DMA_ADDR_W;
 
-	case FRMT_HEXDUMP:	// prepare data as hexdump
-	    data = dataBuf[0];
-	    for (d = 0;  d < data;  d++)	// data = number of bytes
-		sprintf (strBuf + 3*d, "%02X ", dataBuf[d+1]);
-	    strBuf[3*d - 1] = EOS;
-	    break;
+    /* RXDATAV is handled by the DMA, not by the interrupt */
+    SMB_I2C_CTRL->CMD = I2C_CMD_CLEARPC | I2C_CMD_CLEARTX;
+    SMB_I2C_CTRL->IFC = _I2C_IFC_MASK;
+    SMB_I2C_CTRL->IEN = I2C_IEN_ACK | I2C_IEN_NACK | I2C_IEN_MSTOP
+		      | I2C_IEN_ARBLOST | I2C_IEN_BUSERR;
 
-	case FRMT_HEX:		// HEX Digits (8, 16, 24, or 32bit)
-	    switch (SBS_CMD_SIZE(cmd))
-	    {
-		case 1:
-		    sprintf (strBuf, "0x%02X", data);
-		    break;
+    SMB_I2C_CTRL->CMD = I2C_CMD_START;
+    SMB_I2C_CTRL->TXDATA = g_BatteryCtrlAddr & 0xFE;
 
-		case 2:
-		    sprintf (strBuf, "0x%04X", data);
-		    break;
+    return true;
+}
 
-		case 3:
-		    sprintf (strBuf, "0x%06X", data);
-		    break;
 
-		case 4:
-		default:
-		    sprintf (strBuf, "0x%08lX", value);
-		    break;
-	    }
-	    break;
+/***************************************************************************//**
+ *
+ * @brief	SMBus Interrupt of a Block Read by DMA
+ *
+ * This routine is called by SMB_IRQHandler() during a block read which has
+ * been started by SMB_DmaStart().  It sends the command byte and the address
+ * for read after their predecessors have been acknowledged, and enables the
+ * automatic acknowledge for the DMA.  The last byte is answered by a NACK,
+ * then <i>SMB_Status</i> is set when the STOP condition has been sent.
+ *
+ ******************************************************************************/
+static void	SMB_DmaIrq (void)
+{
+uint32_t pending = SMB_I2C_CTRL->IF & SMB_I2C_CTRL->IEN;
 
-	case FRMT_INTEGER:	// Integer Value
-	    sprintf (strBuf, "%d", data);
-	    break;
+    SMB_I2C_CTRL->IFC = pending;
 
-	case FRMT_SERNUM:	// 5-Digit Integer Value
-	    sprintf (strBuf, "%0d", data);
-	    break;
+    if (pending & (I2C_IF_ARBLOST | I2C_IF_BUSERR))
+    {
+	SMB_I2C_CTRL->CMD = I2C_CMD_ABORT;
+	SMB_I2C_CTRL->CTRL &= ~I2C_CTRL_AUTOACK;
+	l_SMB_DmaState = SMB_DMA_OFF;
+	SMB_Status = (pending & I2C_IF_ARBLOST ? i2cTransferArbLost
+					       : i2cTransferBusErr);
+	return;
+    }
 
-	case FRMT_PERCENT:	// Amount in percent
-	    sprintf (strBuf, "%d%%", data);
-	    break;
+    if ((pending & I2C_IF_NACK)  &&  l_SMB_DmaState <= SMB_DMA_ADDR_R)
+    {
+	/* No response to the address or command */
+	l_SMB_DmaResult = i2cTransferNack;
+	l_SMB_DmaState  = SMB_DMA_STOP;
+	SMB_I2C_CTRL->CMD = I2C_CMD_STOP;
+	return;
+    }
 
-	case FRMT_DURATION:	// Duration in [min]
-	    if (data > 65534)		// > 45d
-	    {
-		strcpy (strBuf, "> 45 days");
-	    }
-	    else
+    switch (l_SMB_DmaState)
+    {
+	case SMB_DMA_ADDR_W:
+	    if (pending & I2C_IF_ACK)
 	    {
-		d = data / 60 / 24;
-		data -= (d * 60 * 24);
-		h = data / 60;
-		data -= (h * 60);
-		m = data;
-		sprintf (strBuf, "%2dd %2dh %2dm", d, h, m);
+		l_SMB_DmaState = SMB_DMA_CMD;
+		SMB_I2C_CTRL->TXDATA = l_SMB_DmaCmd;
 	    }
 	    break;
 
-	case FRMT_OC_REATIME:	// Overcurrent Reaction Time in 1/2[ms] units
-	    sprintf (strBuf, "%dms", data/2);
-	    break;
-
-	case FRMT_HC_REATIME:	// Highcurrent Reaction Time in 2[ms] units
-	    sprintf (strBuf, "%dms", data*2);
-	    break;
-
-	case FRMT_VOLT:		// Voltage in [V]
-	    sprintf (strBuf, "%d.%03dV", data / 1000, data % 1000);
-	    break;
-
-	case FRMT_MILLIVOLT:	// Voltage in [mV]
-	    sprintf (strBuf, "%dmV", data);
-	    break;
-
-	case FRMT_MILLIAMP:	// Current in [±mA], +:charging, -:discharging
-	    sprintf (strBuf, "%dmA", (int16_t)data);
-	    break;
-
-	case FRMT_MILLIAMPH:	// Capacity in [mAh]
-	    sprintf (strBuf, "%dmAh", data);
+	case SMB_DMA_CMD:
+	    if (pending & I2C_IF_ACK)
+	    {
+		l_SMB_DmaState = SMB_DMA_ADDR_R;
+		SMB_I2C_CTRL->CMD = I2C_CMD_START;
+		SMB_I2C_CTRL->TXDATA = g_BatteryCtrlAddr | 0x01;
+	    }
 	    break;
 
-	case FRMT_MICROOHM:	// Resistance in [uOhm]
-	    sprintf (strBuf, "%duOhm", data);
+	case SMB_DMA_ADDR_R:
+	    if (pending & I2C_IF_ACK)
+	    {
+		/* The DMA receives all bytes up to the last one */
+		l_SMB_DmaState = SMB_DMA_DATA;
+		SMB_I2C_CTRL->CTRL |= I2C_CTRL_AUTOACK;
+	    }
 	    break;
 
-	case FRMT_DATE:		// Date [15:9=Year|8:5=Month|4:0=Day]
-	    sprintf (strBuf, "%04d-%02d-%02d", 1980 + (data >> 9),
-		     (data >> 5) & 0xF, data & 0x1F);
+	case SMB_DMA_LAST:
+	    if (SMB_I2C_CTRL->STATUS & I2C_STATUS_RXDATAV)
+	    {
+		l_SMB_DmaBuf[l_SMB_DmaCnt - 1] = (uint8_t)SMB_I2C_CTRL->RXDATA;
+		SMB_I2C_CTRL->IEN &= ~I2C_IEN_RXDATAV;
+		l_SMB_DmaResult = i2cTransferDone;
+		l_SMB_DmaState  = SMB_DMA_STOP;
+		SMB_I2C_CTRL->CMD = I2C_CMD_NACK;
+		SMB_I2C_CTRL->CMD = I2C_CMD_STOP;
+	    }
 	    break;
 
-	case FRMT_TEMP:		// Temperature in 1/10[K], convert to [°C]
+	case SMB_DMA_STOP:
+	    if (pending & I2C_IF_MSTOP)
 	    {
-	    data -= 2732;	// subtract base of 273.16K
-	    int degC = data / 10;
-	    if (data < 0)
-		data = -data;
-	    sprintf (strBuf, "%d.%d C", degC, data % 10);
+		l_SMB_DmaState = SMB_DMA_OFF;
+		SMB_Status = (I2C_TransferReturn_TypeDef)l_SMB_DmaResult;
 	    }
 	    break;
 
-	default:		// unsupported format
-	    return "ERROR Unsupported Format";
+	default:
+	    break;
+    }
+}
 
-    }	// switch (pItem->Frmt)
 
-    /* Perform check for string buffer overflow */
-    if (strBuf[sizeof(strBuf)-1] != 0x11)
-    {
-	sprintf (strBuf, "ERROR strBuf Overflow, cmd=%d frmt=%d", cmd, frmt);
-    }
+/***************************************************************************//**
+ *
+ * @brief	DMA of a Block Read Done
+ *
+ * This callback function is called by the DMA controller when all bytes
+ * except the last one have been received.  It disables the automatic
+ * acknowledge, so the last byte can be answered by a NACK in SMB_DmaIrq().
+ *
+ ******************************************************************************/
+static void	SMB_DmaDone (unsigned int channel, bool primary, void *user)
+{
+    (void) channel;  (void) primary;  (void) user;
 
-    return strBuf;
+    if (l_SMB_DmaState != SMB_DMA_DATA)
+	return;				// transfer has been aborted
+
+    SMB_I2C_CTRL->CTRL &= ~I2C_CTRL_AUTOACK;
+    l_SMB_DmaState = SMB_DMA_LAST;
+    SMB_I2C_CTRL->IEN |= I2C_IEN_RXDATAV;
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Log Battery Information
+ * @brief	End of a Block Read by DMA
  *
- * Depending on the @ref BAT_LOG_INFO_LVL, this routine reads miscellaneous
- * information from the battery controller via the SMBus and logs it:
- * - Manufacturer Name
- * - Manufacturer Data
+ * This routine releases the DMA channel of the block read.  If the transfer
+ * has been successful, the PEC of a TI controller is verified, and the data
+ * is copied to the buffer of the caller.  The PEC follows the byte count
+ * and the data, it is only verified if it has been received.
+ *
+ * @param[in] status
+ *	Status of the transfer.
+ *
+ * @param[out] pBuf
+ *	Address of a buffer where to store the data.
+ *
+ * @param[in] rdCnt
+ *	Number of bytes to store.
+ *
+ * @return
+ *	Status code @ref i2cTransferDone (0), @ref i2cPecError, or the error
+ *	code of the transfer.
+ *
+ ******************************************************************************/
+static int	SMB_DmaEnd (int status, uint8_t *pBuf, size_t rdCnt)
+{
+uint8_t	 hdr[3];
+unsigned int n;
+
+    DmaChanFree (l_SMB_DmaChan);
+    l_SMB_DmaChan  = DMA_CHAN_NONE;
+    l_SMB_DmaState = SMB_DMA_OFF;
+    SMB_I2C_CTRL->CTRL &= ~I2C_CTRL_AUTOACK;
+    SMB_I2C_CTRL->IEN = 0;		// is set again by I2C_TransferInit()
+
+    if (status != i2cTransferDone)
+	return status;
+
+    n = l_SMB_DmaBuf[0] + 1;		// byte count and data
+    if (g_BatteryCtrlType == BCT_TI  &&  n < l_SMB_DmaCnt)
+    {
+	hdr[0] = g_BatteryCtrlAddr & 0xFE;
+	hdr[1] = l_SMB_DmaCmd;
+	hdr[2] = g_BatteryCtrlAddr | 0x01;
+
+	if (SMB_Pec (SMB_Pec (0, hdr, 3), l_SMB_DmaBuf, n) != l_SMB_DmaBuf[n])
+	    return i2cPecError;
+    }
+
+    memcpy (pBuf, l_SMB_DmaBuf, rdCnt);
+    return i2cTransferDone;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	SMBus Packet Error Code
+ *
+ * This routine calculates the CRC-8 with the polynomial x^8 + x^2 + x + 1
+ * over the given bytes, as used for the PEC of the SMBus.
+ *
+ * @param[in] crc
+ *	Initial value, 0 for the first bytes of a transfer.
+ *
+ * @param[in] pData
+ *	Address of the bytes.
+ *
+ * @param[in] len
+ *	Number of bytes.
+ *
+ * @return
+ *	The updated CRC.
+ *
+ ******************************************************************************/
+static uint8_t	SMB_Pec (uint8_t crc, const uint8_t *pData, size_t len)
+{
+int	i;
+
+    while (len-- > 0)
+    {
+	crc ^= *pData++;
+	for (i = 0;  i < 8;  i++)
+	    crc = (uint8_t)(crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1);
+    }
+
+    return crc;
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Asynchronous Read from the Battery Controller
+ *
+ * This routine puts a read request into the SMBus request queue and returns
+ * immediately.  The requests are processed in order, with a guard delay of
+ * @ref SMB_GUARD_DELAY between them.  When the request has been completed,
+ * @p function is called in interrupt context.  This routine may also be
+ * called from interrupt context, e.g. from a callback function.
+ *
+ * @param[in] cmd
+ *	SBS command, i.e. the register address and number of bytes to read.
+ *
+ * @param[out] pBuf
+ *	Address of a buffer where to store the data.  It must remain valid
+ *	until the callback function has been called.
+ *
+ * @param[in] bufSize
+ *	Size of the buffer, this must not be less than the size of @p cmd.
+ *
+ * @param[in] function
+ *	Function to be called when the request has been completed.
+ *
+ * @return
+ *	Status code @ref i2cTransferDone (0) if the request has been queued,
+ *	@ref i2cQueueFull or @ref i2cInvalidParameter otherwise.
+ *
+ ******************************************************************************/
+int	BatteryRegReadAsync (SBS_CMD cmd, uint8_t *pBuf, size_t bufSize,
+			     SMB_CALLBACK function)
+{
+SMB_REQ	*pReq;
+uint8_t	 idx;
+
+    /* Check parameters */
+    EFM_ASSERT (SBS_CMD_SIZE(cmd) != 0);// size field must not be 0
+    EFM_ASSERT (pBuf != NULL  &&  function != NULL);
+    EFM_ASSERT (bufSize >= SBS_CMD_SIZE(cmd));	// buffer size
+
+    if (bufSize < SBS_CMD_SIZE(cmd)  ||  l_thSMB == NONE)
+	return i2cInvalidParameter;
+
+    INT_Disable();
+
+    idx = l_SMB_QuePut + 1;
+    if (idx >= SMB_QUEUE_SIZE)
+	idx = 0;
+
+    if (idx == l_SMB_QueGet)
+    {
+	INT_Enable();
+	return i2cQueueFull;
+    }
+
+    pReq = &l_SMB_Queue[l_SMB_QuePut];
+    pReq->Cmd      = cmd;
+    pReq->pBuf     = pBuf;
+    pReq->Len      = SBS_CMD_SIZE(cmd);
+    pReq->Function = function;
+    l_SMB_QuePut   = idx;
+
+    /* Start the transfer if the queue has been idle */
+    if (l_SMB_State == SMB_IDLE)
+	SMB_StartNext();
+
+    INT_Enable();
+
+    return i2cTransferDone;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start the next asynchronous SMBus request
+ *
+ * This internal routine starts the transfer of the first entry in the
+ * request queue, or sets the queue to @ref SMB_IDLE if it is empty.  It is
+ * called from BatteryRegReadAsync() and, after the guard delay, from
+ * SMB_Timer().
+ *
+ ******************************************************************************/
+static void	SMB_StartNext (void)
+{
+SMB_REQ	*pReq;
+int	 status;
+
+    INT_Disable();
+
+    if (l_SMB_QueGet == l_SMB_QuePut)
+    {
+	l_SMB_State = SMB_IDLE;		// no more requests
+	INT_Enable();
+	return;
+    }
+
+    pReq = &l_SMB_Queue[l_SMB_QueGet];
+
+    /* Set up SMBus transfer S-Wr-Cmd-Sr-Rd-data1-P */
+    l_SMB_Xfer.addr  = g_BatteryCtrlAddr;
+    l_SMB_Xfer.flags = I2C_FLAG_WRITE_READ;
+    l_SMB_Xfer.buf[0].data = l_SMB_AddrBuf;
+    l_SMB_AddrBuf[0] = pReq->Cmd;	// register address (strip higher bits)
+    l_SMB_Xfer.buf[0].len  = 1;
+    l_SMB_Xfer.buf[1].data = pReq->pBuf;
+    l_SMB_Xfer.buf[1].len  = pReq->Len;
+
+    l_SMB_State = SMB_XFER;
+
+    if (IsPowerFail())
+    {
+	status = i2cPowerFail;
+    }
+    else
+    {
+	/* The I2C clock requires EM1 until the transfer is done */
+	EM1_Acquire (EM1_MOD_SMB);
+	msTimerStart (l_thSMB, SMB_XFER_TIMEOUT);
+
+	SMB_Status = I2C_TransferInit (SMB_I2C_CTRL, &l_SMB_Xfer);
+	status = SMB_Status;
+    }
+
+    /* Early errors complete the request immediately */
+    if (status != i2cTransferInProgress  &&  l_SMB_State == SMB_XFER)
+	SMB_Complete (status);
+
+    INT_Enable();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Complete the current asynchronous SMBus request
+ *
+ * This internal routine removes the first entry from the request queue and
+ * calls its callback function.  Then the guard delay is started, after that
+ * SMB_Timer() starts the next request.
+ *
+ * @param[in] status
+ *	Status code of the transfer.
+ *
+ ******************************************************************************/
+static void	SMB_Complete (int status)
+{
+SMB_REQ	 req;
+
+    INT_Disable();
+
+    req = l_SMB_Queue[l_SMB_QueGet];
+    if (++l_SMB_QueGet >= SMB_QUEUE_SIZE)
+	l_SMB_QueGet = 0;
+
+    EM1_Release (EM1_MOD_SMB);
+
+    l_SMB_State = SMB_GUARD;
+    msTimerStart (l_thSMB, SMB_GUARD_DELAY);
+
+    INT_Enable();
+
+    req.Function (req.Cmd, status, req.pBuf);
+
+    EVENT_POST(EVT_BATTERY);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	SMBus Timer
+ *
+ * This msTimer function is called when an asynchronous transfer timed out,
+ * or when the guard delay is over.  In case of a timeout, the transfer is
+ * aborted and BatteryCheck() is triggered to call SMB_Reset().  The queue
+ * is stopped until this has been done.
+ *
+ * @param[in] hdl
+ *	Timer handle (not used here).
+ *
+ ******************************************************************************/
+static void	SMB_Timer (TIM_HDL hdl)
+{
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    switch (l_SMB_State)
+    {
+	case SMB_XFER:		// transfer timed out
+	    SMB_I2C_CTRL->CMD = I2C_CMD_ABORT;
+	    FLAG_SET(l_BatTrigger, BAT_TRG_SMB_RECOVER);
+	    SMB_Complete (i2cTransferTimeout);
+	    break;
+
+	case SMB_GUARD:		// guard delay is over
+	    if (FLAG_TEST(l_BatTrigger, BAT_TRG_SMB_RECOVER))
+		msTimerStart (l_thSMB, SMB_GUARD_DELAY);  // wait for recovery
+	    else
+		SMB_StartNext();
+	    break;
+
+	default:		// SMB_IDLE, or SMB_SYNC restarts the timer
+	    break;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Item Data String
+ *
+ * This routine returns a formatted data string of the specified item data.
+ * It uses BatteryRegReadValue() and BatteryRegReadBlock() to read the data
+ * directly from the battery controller.
+ *
+ * @param[in] cmd
+ *	SBS command, i.e. the register address and number of bytes to read.
+ *
+ * @param[in] frmt
+ *	Format specifier for data representation.
+ *
+ * @return
+ * 	Static buffer that contains the formatted data string of the item,
+ * 	or error message if there was an error, e.g. a read error from the
+ * 	battery controller.
+ *
+ * @warning
+ *	This routine is not MT-save (which should not be a problem for this
+ *	application)!
+ *
+ ******************************************************************************/
+static const char *ItemDataString (SBS_CMD cmd, FRMT_TYPE frmt)
+{
+static char	 strBuf[120];	// static buffer to return string into
+uint8_t		 dataBuf[40];	// buffer for I2C data, read from the controller
+uint32_t	 value;		// unsigned data variable
+int		 data = 0;	// generic signed integer data variable
+int		 d, h, m;	// FRMT_DURATION: days, hours, minutes
+
+
+    /* Prepare check for string buffer overflow */
+    strBuf[sizeof(strBuf)-1] = 0x11;
+
+    if (cmd != SBS_NONE)
+    {
+	/* See how many bytes we need to read */
+	data = SBS_CMD_SIZE(cmd);	// get object size
+	if (data > 4)
+	{
+	    /* More than 32 bits - must be a block, e.g. a string */
+	    EFM_ASSERT(data < (int)sizeof(dataBuf));
+
+	    if (BatteryRegReadBlock (cmd, dataBuf, data) < 0)
+		return "READ ERROR";	// READ ERROR
+	}
+	else
+	{
+	    /* Read data word - may be 1, 2, 3, or 4 bytes long */
+	    if (BatteryRegReadValue (cmd, &value) < 0)
+		return "READ ERROR";	// READ ERROR
+
+	    data = (int)value;
+	}
+    }
+
+    /* Variable <data> contains 16bit raw value, build formatted string */
+    switch (frmt)
+    {
+	case FRMT_STRING:	// return string to be displayed
+	    /*
+	     * The first byte contains the number of ASCII characters WITHOUT
+	     * a trailing 0 as EndOfString marker.  However, in some cases the
+	     * specified byte count is larger than the string - then an EOS
+	     * marker exists in the data read from the controller.
+	     */
+	    data = dataBuf[0];
+	    EFM_ASSERT(data < (int)(sizeof(strBuf)-1));
+	    strncpy (strBuf, (char *)dataBuf+1, data);
+	    strBuf[data] = EOS;		// terminate string
+	    break;
+
+	case FRMT_HEXDUMP:	// prepare data as hexdump
+	    data = dataBuf[0];
+	    for (d = 0;  d < data;  d++)	// data = number of bytes
+		StrFormat (strBuf + 3*d, "%02X ", dataBuf[d+1]);
+	    strBuf[3*d - 1] = EOS;
+	    break;
+
+	case FRMT_HEX:		// HEX Digits (8, 16, 24, or 32bit)
+	    switch (SBS_CMD_SIZE(cmd))
+	    {
+		case 1:
+		    StrFormat (strBuf, "0x%02X", data);
+		    break;
+
+		case 2:
+		    StrFormat (strBuf, "0x%04X", data);
+		    break;
+
+		case 3:
+		    StrFormat (strBuf, "0x%06X", data);
+		    break;
+
+		case 4:
+		default:
+		    StrFormat (strBuf, "0x%08lX", value);
+		    break;
+	    }
+	    break;
+
+	case FRMT_INTEGER:	// Integer Value
+	    StrFormat (strBuf, "%d", data);
+	    break;
+
+	case FRMT_SERNUM:	// 5-Digit Integer Value
+	    StrFormat (strBuf, "%0d", data);
+	    break;
+
+	case FRMT_PERCENT:	// Amount in percent
+	    StrFormat (strBuf, "%d%%", data);
+	    break;
+
+	case FRMT_DURATION:	// Duration in [min]
+	    if (data > 65534)		// > 45d
+	    {
+		strcpy (strBuf, "> 45 days");
+	    }
+	    else
+	    {
+		d = data / 60 / 24;
+		data -= (d * 60 * 24);
+		h = data / 60;
+		data -= (h * 60);
+		m = data;
+		StrFormat (strBuf, "%2dd %2dh %2dm", d, h, m);
+	    }
+	    break;
+
+	case FRMT_OC_REATIME:	// Overcurrent Reaction Time in 1/2[ms] units
+	    StrFormat (strBuf, "%dms", data/2);
+	    break;
+
+	case FRMT_HC_REATIME:	// Highcurrent Reaction Time in 2[ms] units
+	    StrFormat (strBuf, "%dms", data*2);
+	    break;
+
+	case FRMT_VOLT:		// Voltage in [V]
+	    StrFormat (strBuf, "%d.%03dV", data / 1000, data % 1000);
+	    break;
+
+	case FRMT_MILLIVOLT:	// Voltage in [mV]
+	    StrFormat (strBuf, "%dmV", data);
+	    break;
+
+	case FRMT_MILLIAMP:	// Current in [±mA], +:charging, -:discharging
+	    StrFormat (strBuf, "%dmA", (int16_t)data);
+	    break;
+
+	case FRMT_MILLIAMPH:	// Capacity in [mAh]
+	    StrFormat (strBuf, "%dmAh", data);
+	    break;
+
+	case FRMT_MICROOHM:	// Resistance in [uOhm]
+	    StrFormat (strBuf, "%duOhm", data);
+	    break;
+
+	case FRMT_DATE:		// Date [15:9=Year|8:5=Month|4:0=Day]
+	    StrFormat (strBuf, "%04d-%02d-%02d", 1980 + (data >> 9),
+		       (data >> 5) & 0xF, data & 0x1F);
+	    break;
+
+	case FRMT_TEMP:		// Temperature in 1/10[K], convert to [°C]
+	    {
+	    data -= 2732;	// subtract base of 273.16K
+	    int degC = data / 10;
+	    if (data < 0)
+		data = -data;
+	    StrFormat (strBuf, "%d.%d C", degC, data % 10);
+	    }
+	    break;
+
+	default:		// unsupported format
+	    return "ERROR Unsupported Format";
+
+    }	// switch (pItem->Frmt)
+
+    /* Perform check for string buffer overflow */
+    if (strBuf[sizeof(strBuf)-1] != 0x11)
+    {
+	StrFormat (strBuf, "ERROR strBuf Overflow, cmd=%d frmt=%d", cmd, frmt);
+    }
+
+    return strBuf;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Log Battery Information
+ *
+ * Depending on the @ref BAT_LOG_INFO_LVL, this routine reads miscellaneous
+ * information from the battery controller via the SMBus and logs it:
+ * - Manufacturer Name
+ * - Manufacturer Data
  * - Device Name
  * - Device Type
  * - Serial Number
@@ -747,147 +1586,802 @@ int		 d, h, m;	// FRMT_DURATION: days, hours, minutes
  * - Actual Voltage and remaining Capacity
  * - Remaining Run Time
  *
- * @param[in] infoLvl
- *	Enum of type @ref BAT_LOG_INFO_LVL which specifies the level of
- *	information.
+ * @param[in] infoLvl
+ *	Enum of type @ref BAT_LOG_INFO_LVL which specifies the level of
+ *	information.
+ *
+ ******************************************************************************/
+void	LogBatteryInfo (BAT_LOG_INFO_LVL infoLvl)
+{
+#ifdef LOGGING
+uint32_t value;		// unsigned data variable
+
+    /* Check if the Battery Controller Probe routine should be called (again) */
+    if (FlagTestClr (&l_BatTrigger, BAT_TRG_PROBE))
+	BatteryCtrlProbe();
+
+    /* Try to read a register from the battery controller */
+    if (! SnapCacheRead (SBS_Voltage, &value)
+	&&  BatteryRegReadValue (SBS_Voltage, NULL) < 0)
+    {
+	/* ERROR */
+	g_BattMilliVolt = (-1);
+	LogError ("Battery Controller Read Error");
+	return;
+    }
+
+    /* No get and log all the information */
+    if (infoLvl == BAT_LOG_INFO_VERBOSE)
+    {
+	Log ("Battery Controller Type is \"%s\" at address 0x%02X",
+	     g_BatteryCtrlName, g_BatteryCtrlAddr);
+
+	Log ("Battery Manufacturer Name : %s",
+	     ItemDataString(SBS_ManufacturerName, FRMT_STRING));
+
+	Log ("Battery Device Name       : %s",
+	     ItemDataString(SBS_DeviceName, FRMT_STRING));
+
+	Log ("Battery Device Type       : %s",
+	     ItemDataString(SBS_DeviceChemistry, FRMT_STRING));
+
+	Log ("Battery Serial Number     : %s",	// display as Hex value now
+	     ItemDataString(SBS_SerialNumber, FRMT_HEX));
+
+	Log ("Battery Design Voltage    : %s%s",
+	     ItemDataString(SBS_DesignVoltage, FRMT_VOLT),
+	     g_BatteryCtrlType==BCT_ATMEL ? " per cell" : "");
+
+	Log ("Battery Design Capacity   : %s",
+	     ItemDataString(SBS_DesignCapacity, FRMT_MILLIAMPH));
+
+	Log ("Battery Full Charge Capac.: %s",
+	     ItemDataString(SBS_FullChargeCapacity, FRMT_MILLIAMPH));
+    }
+
+    drvLEUART_sync();	// to prevent UART buffer overflow
+
+    if (SnapCacheRead (SBS_RemainingCapacity, &value)
+	||  BatteryRegReadValue(SBS_RemainingCapacity, &value) >= 0)
+    {
+	g_BattCapacity = (uint16_t)value;
+	if (infoLvl != BAT_LOG_INFO_DISPLAY_ONLY)
+	    Log ("Battery Remaining Capacity: %ldmAh", value);
+    }
+
+    if (infoLvl != BAT_LOG_INFO_DISPLAY_ONLY)
+    {
+	Log ("Battery Runtime to empty  : %s",
+	     ItemDataString(SBS_RunTimeToEmpty, FRMT_DURATION));
+    }
+
+    if (SnapCacheRead (SBS_Voltage, &value)
+	||  BatteryRegReadValue(SBS_Voltage, &value) >= 0)
+    {
+	g_BattMilliVolt = (int16_t)value;
+	if (infoLvl != BAT_LOG_INFO_DISPLAY_ONLY)
+	    Log ("Battery Actual Voltage    : %2ld.%ldV",
+		 value / 1000, (value % 1000) / 100);
+    }
+
+    if (infoLvl != BAT_LOG_INFO_DISPLAY_ONLY)
+    {
+	Log ("Battery Actual Current    : %s",
+	     ItemDataString(SBS_BatteryCurrent, FRMT_MILLIAMP));
+    }
+
+    drvLEUART_sync();	// to prevent UART buffer overflow
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Battery Check
+ *
+ * This routine is called periodically to check the status of the battery.
+ * It reads the voltage, the remaining capacity, and the remaining run time
+ * from the battery controller via the SMBus.<br>
+ * It also handles the requests for BatteryInfoReq(), resp. BatteryInfoGet().
+ * These are answered from the snapshot cache if possible, otherwise they are
+ * put into the asynchronous request queue, the results are stored by
+ * BatInfoDone().
+ *
+ ******************************************************************************/
+void	BatteryCheck (void)
+{
+bool	flgBatteryCtrlProbe;
+SBS_CMD	req;
+int	i;
+
+    /* Recover from an asynchronous transfer that timed out */
+    if (FLAG_TEST(l_BatTrigger, BAT_TRG_SMB_RECOVER))
+    {
+	SMB_Reset();
+	FLAG_CLR(l_BatTrigger, BAT_TRG_SMB_RECOVER);
+    }
+
+    /* Check if the Battery Controller Probe routine should be called (again) */
+    flgBatteryCtrlProbe = FlagTestClr (&l_BatTrigger, BAT_TRG_PROBE);
+    if (flgBatteryCtrlProbe)
+	BatteryCtrlProbe();
+
+    /* Check for Battery Information Request */
+    if (! l_flgBatInfoQueued)
+    {
+	if (l_BatInfo.Req_1 == SBS_NONE  &&  l_BatInfo.Req_2 == SBS_NONE)
+	{
+	    l_BatInfo.Done = true;
+	}
+#if SUPPLY_MON
+	else if (BatSupplyFallback())
+	{
+	    /* Answer from the last measurement of the supply voltage */
+	    if (l_BatInfo.Req_1 != SBS_NONE)
+		l_BatInfo.Data_1 = BatSupplyInfo (l_BatInfo.Req_1);
+	    if (l_BatInfo.Req_2 != SBS_NONE)
+		l_BatInfo.Data_2 = BatSupplyInfo (l_BatInfo.Req_2);
+	    l_BatInfo.Req_1 = l_BatInfo.Req_2 = SBS_NONE;
+	    l_BatInfo.Done = true;
+	}
+#endif
+	else if (BatInfoCached())
+	{
+	    l_BatInfo.Req_1 = l_BatInfo.Req_2 = SBS_NONE;
+	    l_BatInfo.Done = true;
+	}
+	else
+	{
+	    l_flgBatInfoQueued = true;
+
+	    for (i = 0;  i < 2;  i++)
+	    {
+		req = (i == 0 ? l_BatInfo.Req_1 : l_BatInfo.Req_2);
+		if (req == SBS_NONE)
+		    continue;
+
+		if (SBS_CMD_SIZE(req) > 4)
+		    BatteryRegReadAsync (req, l_BatInfo.Buffer,
+					 sizeof(l_BatInfo.Buffer), BatInfoDone);
+		else
+		    BatteryRegReadAsync (req, l_BatInfoWord[i],
+					 sizeof(l_BatInfoWord[i]), BatInfoDone);
+	    }
+	}
+    }
+
+    /* see if to log battery status */
+    if (FlagTestClr (&l_BatTrigger, BAT_TRG_MONITOR))
+    {
+
+#if BAT_SNAPSHOT_LOG
+	if (flgBatteryCtrlProbe)
+	{
+#if SUPPLY_MON
+	    if (BatSupplyFallback())
+		Log ("No Battery Controller, the supply voltage is measured");
+	    else
+#endif
+	    /* Log verbose information, as the Battery Pack has changed */
+	    LogBatteryInfo (BAT_LOG_INFO_VERBOSE);
+	    l_SnapLogged.Valid = false;		// log all values next time
+	}
+	BatterySnapshotReq();
+#else
+	/* Log verbose information, if Battery Pack has changed */
+	LogBatteryInfo (flgBatteryCtrlProbe ? BAT_LOG_INFO_VERBOSE
+					    : BAT_LOG_INFO_SHORT);
+#if ENERGY_GOVERNOR
+	BatterySnapshotReq();		// state of charge for the governor
+#endif
+#endif
+    }
+
+    /* see if expired values should be refreshed for BatteryValueGet() */
+    if (FlagTestClr (&l_BatTrigger, BAT_TRG_REFRESH))
+	BatterySnapshotReq();
+
+    /* see if a snapshot has been completed */
+    if (l_flgSnapDone)
+    {
+	l_flgSnapDone = false;
+
+	if (l_SnapLast.Valid)
+	{
+	    g_BattMilliVolt = (int16_t)l_SnapLast.Voltage;
+	    g_BattCapacity  = l_SnapLast.RemainingCapacity;
+#if LOG_FLUSH_ADAPTIVE
+	    LogFlushSoC (l_SnapLast.RelativeStateOfCharge);
+#endif
+#if ENERGY_GOVERNOR
+	    ControlEnergyGovernor (l_SnapLast.RelativeStateOfCharge);
+#endif
+	}
+	else
+	{
+	    g_BattMilliVolt = (-1);
+	}
+#if BAT_SNAPSHOT_LOG
+	SnapshotLog();
+#endif
+    }
+}
+TASK_REGISTER(TASK_PRIO_BATTERY, EVT_BATTERY, BatteryCheck);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Request a Battery Status Snapshot
+ *
+ * This routine puts the read requests for the values of a @ref BAT_SNAPSHOT
+ * into the asynchronous SMBus request queue, whose time to live has expired,
+ * see @ref BAT_TTL_VOLTAGE etc.  The other values are taken from the cache.
+ * When all of them have been completed, the snapshot can be read via
+ * BatterySnapshotGet().
+ *
+ * @return
+ *	Returns true if the requests have been queued, false if a previous
+ *	snapshot is still in progress, or the queue is full.
+ *
+ ******************************************************************************/
+bool	BatterySnapshotReq (void)
+{
+unsigned int i, cnt;
+uint16_t     expired;
+
+    if (l_SnapPending != 0)
+	return false;			// still in progress
+
+    l_SnapBatchTime = SnapSeconds();
+
+#if SUPPLY_MON
+    if (BatSupplyFallback())
+    {
+	l_SnapPending = 1;		// cleared by BatSupplyDone()
+	if (SupplyMonReq (&l_Snapshot, BatSupplyDone))
+	    return true;
+
+	l_SnapPending = 0;
+	return false;
+    }
+#endif
+
+    /* Start with the cached values, count the expired ones */
+    l_Snapshot = l_SnapLast;
+    l_Snapshot.Valid = true;		// cleared by SnapshotDone() on error
+    l_Snapshot.Estimated = false;
+    l_SnapRead = 0;
+
+    for (expired = 0, cnt = i = 0;  i < SNAP_CNT;  i++)
+    {
+	if (! SnapFresh (i))
+	{
+	    expired |= (1 << i);
+	    cnt++;
+	}
+    }
+
+    if (cnt == 0)
+    {
+	/* All values are still valid, complete without SMBus transfer */
+	SnapshotCommit();
+	return true;
+    }
+
+    l_SnapPending = cnt;
+
+    for (i = 0;  i < SNAP_CNT;  i++)
+    {
+	if (! (expired & (1 << i)))
+	    continue;
+
+	if (BatteryRegReadAsync (l_SnapDef[i].Cmd, l_SnapRaw[i],
+				 sizeof(l_SnapRaw[i]), SnapshotDone) < 0)
+	{
+	    /* Complete the remaining requests with an error */
+	    while (cnt-- > 0)
+		SnapshotDone (SBS_NONE, i2cQueueFull, NULL);
+	    return false;
+	}
+	cnt--;
+    }
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the last Battery Status Snapshot
+ *
+ * @return
+ *	Address of the last completed snapshot.  Its element <b>Valid</b> is
+ *	false, if no snapshot has been read yet, or a read error occurred.
+ *
+ ******************************************************************************/
+const BAT_SNAPSHOT *BatterySnapshotGet (void)
+{
+    return &l_SnapLast;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Snapshot Request Done
+ *
+ * This callback function is called by the SMBus request queue for each value
+ * of the snapshot.  It stores the value into @ref l_Snapshot.  After the last
+ * one, the snapshot is copied to @ref l_SnapLast, and BatteryCheck() is
+ * triggered.
+ *
+ * @param[in] cmd
+ *	SBS command of the completed request.
+ *
+ * @param[in] status
+ *	Status code of the transfer.
+ *
+ * @param[in] pBuf
+ *	Buffer with the received data, or NULL if the request failed.
+ *
+ ******************************************************************************/
+static void	SnapshotDone (SBS_CMD cmd, int status, uint8_t *pBuf)
+{
+unsigned int	idx;
+uint8_t	       *pValue;
+
+    (void) cmd;		// the value is identified by its buffer
+
+    if (status < 0  ||  pBuf == NULL)
+    {
+	l_Snapshot.Valid = false;
+    }
+    else
+    {
+	idx = (pBuf - l_SnapRaw[0]) / sizeof(l_SnapRaw[0]);
+	pValue = (uint8_t *)&l_Snapshot + l_SnapDef[idx].Offset;
+
+	/* both, target and SMBus data are little endian */
+	memcpy (pValue, pBuf, l_SnapDef[idx].Size);
+	l_SnapRead |= (1 << idx);
+    }
+
+    if (l_SnapPending > 0  &&  --l_SnapPending == 0)
+	SnapshotCommit();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Commit the Snapshot
+ *
+ * This routine copies the snapshot to @ref l_SnapLast, and marks the values
+ * which have been read by the current batch as cached at its start time.
+ * Then BatteryCheck() is triggered.
+ *
+ ******************************************************************************/
+static void	SnapshotCommit (void)
+{
+unsigned int	i;
+
+    for (i = 0;  i < SNAP_CNT;  i++)
+	if (l_SnapRead & (1 << i))
+	    l_SnapTime[i] = l_SnapBatchTime;
+
+    l_SnapCached |= l_SnapRead;
+    l_SnapLast = l_Snapshot;
+    l_flgSnapDone = true;
+    EVENT_POST(EVT_BATTERY);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get a cached Battery Value
+ *
+ * This routine returns a value of the last snapshot from RAM, i.e. without
+ * an SMBus transfer.  If the value is older than its time to live, see
+ * @ref BAT_TTL_VOLTAGE etc., a refresh of the snapshot is triggered in the
+ * background, but not more often than every @ref BAT_REFRESH_MIN seconds.
+ * Then the value returned is the old one until the refresh has been done.
+ *
+ * @param[in] cmd
+ *	SBS command of a value of @ref BAT_SNAPSHOT, e.g. SBS_Voltage.
+ *
+ * @param[out] pValue
+ *	Address of the variable to store the value, current is signed.
+ *
+ * @return
+ *	The value <i>true</i> if a value is available, <i>false</i> if the
+ *	value is not part of the snapshot, or it has not been read yet.
  *
  ******************************************************************************/
-void	LogBatteryInfo (BAT_LOG_INFO_LVL infoLvl)
+bool	BatteryValueGet (SBS_CMD cmd, int32_t *pValue)
 {
-#ifdef LOGGING
-uint32_t value;		// unsigned data variable
+int	idx = SnapIndex (cmd);
 
-    /* Check if the Battery Controller Probe routine should be called (again) */
-    if (l_flgBatteryCtrlProbe)
-    {
-	l_flgBatteryCtrlProbe = false;
-	BatteryCtrlProbe();
-    }
+    if (idx < 0)
+	return false;			// not part of the snapshot
 
-    /* Try to read a register from the battery controller */
-    if (BatteryRegReadValue (SBS_Voltage, NULL) < 0)
+    if (! SnapFresh (idx)  &&  l_SnapPending == 0
+	&&  SnapSeconds() - l_SnapBatchTime >= BAT_REFRESH_MIN)
     {
-	/* ERROR */
-	g_BattMilliVolt = (-1);
-	LogError ("Battery Controller Read Error");
-	return;
+	FLAG_SET(l_BatTrigger, BAT_TRG_REFRESH);
+	EVENT_POST(EVT_BATTERY);
     }
 
-    /* No get and log all the information */
-    if (infoLvl == BAT_LOG_INFO_VERBOSE)
-    {
-	Log ("Battery Controller Type is \"%s\" at address 0x%02X",
-	     g_BatteryCtrlName, g_BatteryCtrlAddr);
+    if (! (l_SnapCached & (1 << idx)))
+	return false;			// not read yet
 
-	Log ("Battery Manufacturer Name : %s",
-	     ItemDataString(SBS_ManufacturerName, FRMT_STRING));
+    *pValue = SnapshotValue (&l_SnapLast, idx);
+    return true;
+}
 
-	Log ("Battery Device Name       : %s",
-	     ItemDataString(SBS_DeviceName, FRMT_STRING));
 
-	Log ("Battery Device Type       : %s",
-	     ItemDataString(SBS_DeviceChemistry, FRMT_STRING));
+/***************************************************************************//**
+ *
+ * @brief	Seconds of the Monotonic Clock
+ *
+ * @return
+ *	Seconds of ClockMonoTicks(), they are not affected by ClockSet().
+ *
+ ******************************************************************************/
+static uint32_t	SnapSeconds (void)
+{
+    return (uint32_t)(ClockMonoTicks() / RTC_COUNTS_PER_SEC);
+}
 
-	Log ("Battery Serial Number     : %s",	// display as Hex value now
-	     ItemDataString(SBS_SerialNumber, FRMT_HEX));
 
-	Log ("Battery Design Voltage    : %s%s",
-	     ItemDataString(SBS_DesignVoltage, FRMT_VOLT),
-	     g_BatteryCtrlType==BCT_ATMEL ? " per cell" : "");
+/***************************************************************************//**
+ *
+ * @brief	Index of a Snapshot Value
+ *
+ * @param[in] cmd
+ *	SBS command of the value.
+ *
+ * @return
+ *	Index of the value in @ref l_SnapDef, or -1 if <i>cmd</i> is not part
+ *	of the snapshot.
+ *
+ ******************************************************************************/
+static int	SnapIndex (SBS_CMD cmd)
+{
+int	idx;
 
-	Log ("Battery Design Capacity   : %s",
-	     ItemDataString(SBS_DesignCapacity, FRMT_MILLIAMPH));
+    for (idx = 0;  idx < (int)SNAP_CNT;  idx++)
+	if (l_SnapDef[idx].Cmd == cmd)
+	    return idx;
 
-	Log ("Battery Full Charge Capac.: %s",
-	     ItemDataString(SBS_FullChargeCapacity, FRMT_MILLIAMPH));
-    }
+    return (-1);
+}
 
-    drvLEUART_sync();	// to prevent UART buffer overflow
 
-    if (BatteryRegReadValue(SBS_RemainingCapacity, &value) >= 0)
+/***************************************************************************//**
+ *
+ * @brief	Check if a cached Snapshot Value is fresh
+ *
+ * @param[in] idx
+ *	Index of the value in @ref l_SnapDef.
+ *
+ * @return
+ *	The value <i>true</i> if the value is cached, and younger than its time
+ *	to live.
+ *
+ ******************************************************************************/
+static bool	SnapFresh (int idx)
+{
+    return ((l_SnapCached & (1 << idx))
+	    &&  SnapSeconds() - l_SnapTime[idx] < l_SnapDef[idx].Ttl);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read a fresh Value from the Snapshot Cache
+ *
+ * @param[in] cmd
+ *	SBS command of the value.
+ *
+ * @param[out] pValue
+ *	Address of the variable to store the value.
+ *
+ * @return
+ *	The value <i>true</i> if a fresh value has been stored, <i>false</i>
+ *	if it must be read via the SMBus.
+ *
+ ******************************************************************************/
+static bool	SnapCacheRead (SBS_CMD cmd, uint32_t *pValue)
+{
+int	idx = SnapIndex (cmd);
+
+    if (idx < 0  ||  ! SnapFresh (idx))
+	return false;
+
+    *pValue = (uint32_t)SnapshotValue (&l_SnapLast, idx);
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Answer the Battery Information Request from the Cache
+ *
+ * @return
+ *	The value <i>true</i> if all requests of @ref l_BatInfo have been
+ *	answered by fresh values of the snapshot, see SnapCacheRead().
+ *
+ ******************************************************************************/
+static bool	BatInfoCached (void)
+{
+uint32_t value_1 = 0, value_2 = 0;
+
+    if (l_BatInfo.Req_1 != SBS_NONE
+	&&  ! SnapCacheRead (l_BatInfo.Req_1, &value_1))
+	return false;
+
+    if (l_BatInfo.Req_2 != SBS_NONE
+	&&  ! SnapCacheRead (l_BatInfo.Req_2, &value_2))
+	return false;
+
+    l_BatInfo.Data_1 = (int)value_1;
+    l_BatInfo.Data_2 = (int)value_2;
+    return true;
+}
+
+
+#if SUPPLY_MON
+/***************************************************************************//**
+ *
+ * @brief	Check for the Supply Monitor Fallback
+ *
+ * @return
+ *	The value <i>true</i> if no battery controller has been found, and the
+ *	supply monitor has a discharge curve, see SupplyMonIsOn().
+ *
+ ******************************************************************************/
+static bool	BatSupplyFallback (void)
+{
+    return (g_BatteryCtrlType == BCT_UNKNOWN  &&  SupplyMonIsOn());
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Supply Measurement Done
+ *
+ * This callback function is called by the supply monitor when the snapshot
+ * has been measured.  Like SnapshotDone(), it copies the snapshot to
+ * @ref l_SnapLast and triggers BatteryCheck().
+ *
+ * @param[in] flgOk
+ *	False if the measurement failed, then the snapshot is invalid.
+ *
+ ******************************************************************************/
+static void	BatSupplyDone (bool flgOk)
+{
+    /* Only voltage and state of charge are cached */
+    l_SnapRead = 0;
+    if (flgOk)
+	l_SnapRead = (1 << SnapIndex (SBS_Voltage))
+		   | (1 << SnapIndex (SBS_RelativeStateOfCharge));
+
+    l_SnapPending = 0;
+    SnapshotCommit();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Battery Information from the Supply Monitor
+ *
+ * @param[in] req
+ *	SBS command of the request.
+ *
+ * @return
+ *	The value of the last snapshot, or @ref i2cTransferNack if the register
+ *	is not known by the supply monitor.
+ *
+ ******************************************************************************/
+static int	BatSupplyInfo (SBS_CMD req)
+{
+    if (! l_SnapLast.Valid)
+	return i2cTransferNack;
+
+    switch (req)
     {
-	g_BattCapacity = (uint16_t)value;
-	if (infoLvl != BAT_LOG_INFO_DISPLAY_ONLY)
-	    Log ("Battery Remaining Capacity: %ldmAh", value);
+	case SBS_Voltage:
+	    return l_SnapLast.Voltage;
+
+	case SBS_RelativeStateOfCharge:
+	    return l_SnapLast.RelativeStateOfCharge;
+
+	default:
+	    return i2cTransferNack;
     }
+}
+#endif
 
-    if (infoLvl != BAT_LOG_INFO_DISPLAY_ONLY)
+
+/***************************************************************************//**
+ *
+ * @brief	Snapshot Value
+ *
+ * This routine returns a value of the snapshot as signed integer.
+ *
+ * @param[in] pSnap
+ *	Address of the snapshot.
+ *
+ * @param[in] idx
+ *	Index of the value in @ref l_SnapDef.
+ *
+ * @return
+ *	Value of the element.
+ *
+ ******************************************************************************/
+static int32_t	SnapshotValue (const BAT_SNAPSHOT *pSnap, int idx)
+{
+const uint8_t *pValue = (const uint8_t *)pSnap + l_SnapDef[idx].Offset;
+
+    if (l_SnapDef[idx].Size == 1)
+	return *pValue;
+
+    if (l_SnapDef[idx].Frmt == FRMT_MILLIAMP)
+	return *(const int16_t *)pValue;	// current is signed
+
+    return *(const uint16_t *)pValue;
+}
+
+
+#if BAT_SNAPSHOT_LOG
+/***************************************************************************//**
+ *
+ * @brief	Log the Changes of the Battery Status Snapshot
+ *
+ * This routine compares the last snapshot with the values that have been
+ * logged before.  Only those which changed by their hysteresis or more are
+ * logged in one line, and stored as new reference.  If @ref BAT_LOG_RECORD
+ * is 1, a compact record with all values is logged instead.
+ *
+ ******************************************************************************/
+static void	SnapshotLog (void)
+{
+char	 line[120];	// log message
+int	 len = 0;	// current length of the message
+int32_t	 value, diff;
+unsigned int i;
+
+    if (! l_SnapLast.Valid)
     {
-	Log ("Battery Runtime to empty  : %s",
-	     ItemDataString(SBS_RunTimeToEmpty, FRMT_DURATION));
+	LogError (l_SnapLast.Estimated ? "Supply Voltage Measurement Error"
+				       : "Battery Controller Read Error");
+	return;
     }
 
-    if (BatteryRegReadValue(SBS_Voltage, &value) >= 0)
+    for (i = 0;  i < SNAP_CNT;  i++)
     {
-	g_BattMilliVolt = (int16_t)value;
-	if (infoLvl != BAT_LOG_INFO_DISPLAY_ONLY)
-	    Log ("Battery Actual Voltage    : %2ld.%ldV",
-		 value / 1000, (value % 1000) / 100);
+	value = SnapshotValue (&l_SnapLast, i);
+	diff  = value - SnapshotValue (&l_SnapLogged, i);
+	if (diff < 0)
+	    diff = -diff;
+
+	if (l_SnapLogged.Valid  &&  diff < l_SnapDef[i].Hyst)
+	    continue;		// no relevant change
+
+	/* The supply monitor only knows the voltage and the state of charge */
+	if (l_SnapLast.Estimated  &&  l_SnapDef[i].Cmd != SBS_Voltage
+	&&  l_SnapDef[i].Cmd != SBS_RelativeStateOfCharge)
+	    continue;
+
+	/* Store value as new reference */
+	memcpy ((uint8_t *)&l_SnapLogged + l_SnapDef[i].Offset,
+		(uint8_t *)&l_SnapLast + l_SnapDef[i].Offset, l_SnapDef[i].Size);
+
+	len += StrFormat (line + len, " %s=", l_SnapDef[i].Name);
+
+	switch (l_SnapDef[i].Frmt)
+	{
+	    case FRMT_MILLIVOLT:
+		len += StrFormat (line + len, "%ldmV", value);
+		break;
+
+	    case FRMT_MILLIAMP:
+		len += StrFormat (line + len, "%ldmA", value);
+		break;
+
+	    case FRMT_MILLIAMPH:
+		len += StrFormat (line + len, "%ldmAh", value);
+		break;
+
+	    case FRMT_DURATION:
+		len += StrFormat (line + len, "%ldmin", value);
+		break;
+
+	    case FRMT_TEMP:	// 1/10[K] to [C]
+		value -= 2732;
+		len += StrFormat (line + len, "%s%ld.%ldC", value < 0 ? "-" : "",
+				  (value < 0 ? -value : value) / 10,
+				  (value < 0 ? -value : value) % 10);
+		break;
+
+	    case FRMT_PERCENT:
+		len += StrFormat (line + len, "%ld%%", value);
+		break;
+
+	    case FRMT_HEX:
+	    default:
+		len += StrFormat (line + len, "0x%04lX", value);
+		break;
+	}
     }
 
-    if (infoLvl != BAT_LOG_INFO_DISPLAY_ONLY)
+    if (len == 0)
+	return;			// nothing has changed
+
+    l_SnapLogged.Valid = true;
+
+#if BAT_LOG_RECORD
+    /* Log all values as compact record */
+    for (i = len = 0;  i < SNAP_CNT;  i++)
     {
-	Log ("Battery Actual Current    : %s",
-	     ItemDataString(SBS_BatteryCurrent, FRMT_MILLIAMP));
+	len += StrFormat (line + len, (l_SnapDef[i].Frmt == FRMT_HEX ?
+			  ",0x%04lX" : ",%ld"), SnapshotValue (&l_SnapLast, i));
     }
-
-    drvLEUART_sync();	// to prevent UART buffer overflow
+    Log ("BAT%s", line);
+#else
+    Log ("Battery:%s", line);
 #endif
 }
+#endif
 
 
 /***************************************************************************//**
  *
- * @brief	Battery Check
+ * @brief	Battery Information Done
  *
- * This routine is called periodically to check the status of the battery.
- * It reads the voltage, the remaining capacity, and the remaining run time
- * from the battery controller via the SMBus.<br>
- * It also handles the requests for BatteryInfoReq(), resp. BatteryInfoGet().
+ * This callback function is called by the SMBus request queue for each request
+ * of @ref l_BatInfo.  It stores the result and sets the request to SBS_NONE.
+ * When both requests have been completed, the <b>Done</b> flag is set.
+ *
+ * @param[in] cmd
+ *	SBS command of the completed request.
+ *
+ * @param[in] status
+ *	Status code of the transfer.
+ *
+ * @param[in] pBuf
+ *	Buffer with the received data.
  *
  ******************************************************************************/
-void	BatteryCheck (void)
+static void	BatInfoDone (SBS_CMD cmd, int status, uint8_t *pBuf)
 {
-bool	flgBatteryCtrlProbe = l_flgBatteryCtrlProbe;
+uint32_t value = 0;
+int	 i;
 
-    /* Check if the Battery Controller Probe routine should be called (again) */
-    if (l_flgBatteryCtrlProbe)
+    /* Build word value (always little endian), or return the error code */
+    if (status >= 0)
     {
-	l_flgBatteryCtrlProbe = false;
-	BatteryCtrlProbe();
+	for (i = SBS_CMD_SIZE(cmd) - 1;  i >= 0;  i--)
+	    value = (value << 8) | pBuf[i];
+	status = (int16_t)value;
     }
 
-    /* Check for Battery Information Request */
-    if (l_BatInfo.Req_1 != SBS_NONE)
+    if (pBuf == l_BatInfoWord[0]  ||  (pBuf == l_BatInfo.Buffer
+				      &&  cmd == l_BatInfo.Req_1))
     {
-	if (SBS_CMD_SIZE(l_BatInfo.Req_1) > 4)
-	    BatteryRegReadBlock (l_BatInfo.Req_1, l_BatInfo.Buffer, 18);
-	else
-	    l_BatInfo.Data_1 = BatteryRegReadWord (l_BatInfo.Req_1);
-	l_BatInfo.Req_1  = SBS_NONE;
+	if (pBuf != l_BatInfo.Buffer)
+	    l_BatInfo.Data_1 = status;
+	l_BatInfo.Req_1 = SBS_NONE;
     }
-
-    if (l_BatInfo.Req_2 != SBS_NONE)
+    else
     {
-	msDelay(100);		// to prevent hang-up of battery controller
-
-	if (SBS_CMD_SIZE(l_BatInfo.Req_2) > 4)
-	    BatteryRegReadBlock (l_BatInfo.Req_2, l_BatInfo.Buffer, 18);
-	else
-	    l_BatInfo.Data_2 = BatteryRegReadWord (l_BatInfo.Req_2);
-	l_BatInfo.Req_2  = SBS_NONE;
+	if (pBuf != l_BatInfo.Buffer)
+	    l_BatInfo.Data_2 = status;
+	l_BatInfo.Req_2 = SBS_NONE;
     }
 
-    l_BatInfo.Done = true;
-
-    /* see if to log battery status */
-    if (l_flgBatMonTrigger)
+    if (l_BatInfo.Req_1 == SBS_NONE  &&  l_BatInfo.Req_2 == SBS_NONE)
     {
-	l_flgBatMonTrigger = false;
-
-	/* Log verbose information, if Battery Pack has changed */
-	LogBatteryInfo (flgBatteryCtrlProbe ? BAT_LOG_INFO_VERBOSE
-					    : BAT_LOG_INFO_SHORT);
+	l_flgBatInfoQueued = false;
+	l_BatInfo.Done = true;
     }
 }
 
@@ -905,10 +2399,37 @@ bool	flgBatteryCtrlProbe = l_flgBatteryCtrlProbe;
 void	BatteryChangeTrigger(void)
 {
     /* Set trigger flags */
-    l_flgBatMonTrigger = true;
-    l_flgBatteryCtrlProbe = true;
+    FLAG_SET(l_BatTrigger, BAT_TRG_MONITOR);
+    FLAG_SET(l_BatTrigger, BAT_TRG_PROBE);
+
+    EVENT_POST(EVT_BATTERY);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if the Battery Pack has not been changed
+ *
+ * This routine is called from PowerFailCheck() after a short power-fail.  It
+ * reads the serial number of the Battery Pack and compares it with the one
+ * stored by the last BatteryCtrlProbe().  The SMBus is accessed synchronously.
+ *
+ * @return
+ * 	The value <i>true</i> if the serial number is the same, <i>false</i>
+ * 	if it differs, or if it could not be read.
+ *
+ ******************************************************************************/
+bool	BatteryIsUnchanged (void)
+{
+uint32_t serial;
+
+    if (! l_flgBatterySerial  ||  FLAG_TEST(l_BatTrigger, BAT_TRG_PROBE))
+	return false;
+
+    if (BatteryRegReadValue (SBS_SerialNumber, &serial) < 0)
+	return false;
 
-    g_flgIRQ = true;	// keep on running
+    return serial == l_BatterySerial;
 }
 
 
@@ -927,16 +2448,40 @@ static void	BatMonTrigger(TIM_HDL hdl)
 
     /* Restart the timer */
     if (l_thBatMon != NONE)
-	sTimerStart (l_thBatMon, BAT_MON_INTERVAL);
+	sTimerStartSlack (l_thBatMon, BAT_MON_INTERVAL * l_BatMonFactor,
+			  BAT_MON_SLACK);
 
     /* Set trigger flag */
-    l_flgBatMonTrigger = true;
+    FLAG_SET(l_BatTrigger, BAT_TRG_MONITOR);
 
-    g_flgIRQ = true;	// keep on running
+    EVENT_POST(EVT_BATTERY);
 }
 #endif
 
 
+/***************************************************************************//**
+ *
+ * @brief	Scale the Battery Monitoring Interval
+ *
+ * This routine stretches the battery monitoring interval to <b>factor</b>
+ * times @ref BAT_MON_INTERVAL.  The new interval becomes effective after
+ * the current one is over.  It has no effect if @ref BAT_MON_INTERVAL is 0.
+ *
+ * @param[in] factor
+ *	Factor for the interval, 1 is the normal interval.
+ *
+ ******************************************************************************/
+void	BatteryMonIntervalScale (unsigned int factor)
+{
+    if (factor < 1)
+	factor = 1;
+    else if (factor > 255)
+	factor = 255;
+
+    l_BatMonFactor = factor;
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Battery Monitoring Trigger Alarm
@@ -951,9 +2496,9 @@ static void	BatMonTriggerAlarm(int alarmNum)
     (void) alarmNum;	// suppress compiler warning "unused parameter"
 
     /* Set trigger flag */
-    l_flgBatMonTrigger = true;
+    FLAG_SET(l_BatTrigger, BAT_TRG_MONITOR);
 
-    g_flgIRQ = true;	// keep on running
+    EVENT_POST(EVT_BATTERY);
 }
 
 
@@ -973,6 +2518,8 @@ void	 BatteryInfoReq (SBS_CMD req_1, SBS_CMD req_2)
     l_BatInfo.Req_2 = req_2;
     strcpy ((char *)l_BatInfo.Buffer, "ERROR");
     l_BatInfo.Done  = false;
+
+    EVENT_POST(EVT_BATTERY);
 }
 
 
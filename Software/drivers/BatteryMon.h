@@ -2,9 +2,20 @@
  * @file
  * @brief	Header file of module BatteryMon.c
  * @author	Ralf Gerhauser
- * @version	2020-01-22
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Added SMB_DMA_BLOCK and error code i2cPecError.
+2026-10-15,agnt	Added BAT_TTL_xxx, BAT_REFRESH_MIN, and BatteryValueGet().
+2026-10-15,agnt	Added element <Estimated> to BAT_SNAPSHOT.
+2026-10-15,agnt	Added BAT_MON_SLACK.
+2026-10-15,agnt	Added prototype for BatteryMonClockChange().
+2026-10-15,agnt	Added prototype for BatteryIsUnchanged().
+2026-10-14,agnt	Added BatteryRegReadAsync(), SMB_CALLBACK, SMB_QUEUE_SIZE,
+		SMB_GUARD_DELAY, and error code i2cQueueFull.
+		Added BAT_SNAPSHOT, BatterySnapshotReq(), BatterySnapshotGet(),
+		BAT_SNAPSHOT_LOG, BAT_LOG_RECORD, and the BAT_HYST_xxx values.
+		Added BatteryMonIntervalScale().
 2020-01-22,rage	Added support for battery controller TI bq40z50.
 2018-03-25,rage	Added prototypes for BatteryInfoReq() and BatteryInfoGet().
 		New SBS_CMD enum SBS_NONE to mark "no request".
@@ -35,6 +46,13 @@ Revision History:
     #define BAT_MON_INTERVAL	0
 #endif
 
+/*!@brief Number of seconds the battery monitoring may be delayed to share
+ * the wake-up of another timer, see sTimerStartSlack().
+ */
+#ifndef BAT_MON_SLACK
+    #define BAT_MON_SLACK	30
+#endif
+
 /*!@brief Time 1 (11:00) when battery status should be logged.  Do not use
  * 12:00, because this is the default, until DCF77 adjusts the real time.  So
  * battery status would be logged twice at power-up.
@@ -43,6 +61,105 @@ Revision History:
 /*!@brief Time 2 (23:00) when battery status should be logged */
 #define ALARM_BAT_MON_TIME_2   23, 00
 
+/*!@brief Number of entries in the queue for asynchronous SMBus requests. */
+#ifndef SMB_QUEUE_SIZE
+    #define SMB_QUEUE_SIZE	10
+#endif
+
+/*!@brief Guard delay in [ms] between two SMBus requests of the queue, this
+ * prevents a hang-up of the battery controller.
+ */
+#ifndef SMB_GUARD_DELAY
+    #define SMB_GUARD_DELAY	100
+#endif
+
+/*!@brief Set this define 1 to receive the data of block commands, i.e. of
+ * more than 4 bytes, by a shared DMA channel in BatteryRegReadBlock().  Then
+ * the SMBus interrupt only occurs for the address and command bytes, and the
+ * PEC of a TI controller is verified on the completed buffer.
+ */
+#ifndef SMB_DMA_BLOCK
+    #define SMB_DMA_BLOCK	1
+#endif
+
+/*!@brief Set this define 1 to read the battery status as a snapshot via the
+ * asynchronous request queue, and to log only the values that changed more
+ * than their hysteresis since they have been logged the last time.  If 0,
+ * LogBatteryInfo() logs all values every time.
+ */
+#ifndef BAT_SNAPSHOT_LOG
+    #define BAT_SNAPSHOT_LOG	0
+#endif
+
+/*!@brief Set this define 1 to log a changed snapshot as compact record with
+ * all values, e.g. <b>BAT,12150,-95,-102,3410,2154,2961,0x00C0,86</b>, for
+ * charting, instead of the text line.  The fields are in the order of
+ * @ref BAT_SNAPSHOT.
+ */
+#ifndef BAT_LOG_RECORD
+    #define BAT_LOG_RECORD	0
+#endif
+
+/*!@name BAT_HYST - Hysteresis of the snapshot values for logging */
+//@{
+#ifndef BAT_HYST_VOLTAGE
+    #define BAT_HYST_VOLTAGE	50	//!< Voltage in [mV]
+#endif
+#ifndef BAT_HYST_CURRENT
+    #define BAT_HYST_CURRENT	20	//!< Current in [mA]
+#endif
+#ifndef BAT_HYST_CAPACITY
+    #define BAT_HYST_CAPACITY	50	//!< Remaining capacity in [mAh]
+#endif
+#ifndef BAT_HYST_RUNTIME
+    #define BAT_HYST_RUNTIME	60	//!< Run time to empty in [min]
+#endif
+#ifndef BAT_HYST_TEMP
+    #define BAT_HYST_TEMP	10	//!< Temperature in [0.1K]
+#endif
+#ifndef BAT_HYST_SOC
+    #define BAT_HYST_SOC	1	//!< Relative state of charge in [%]
+#endif
+//@}
+
+/*!@name BAT_TTL - Time to live of the cached snapshot values in [s]
+ *
+ * A value of the last snapshot is served by BatteryValueGet() and
+ * BatteryInfoReq() without an SMBus transfer, as long as it is younger than
+ * its TTL.  BatterySnapshotReq() only reads the values which are older.
+ */
+//@{
+#ifndef BAT_TTL_VOLTAGE
+    #define BAT_TTL_VOLTAGE	30	//!< Voltage
+#endif
+#ifndef BAT_TTL_CURRENT
+    #define BAT_TTL_CURRENT	10	//!< Current and average current
+#endif
+#ifndef BAT_TTL_CAPACITY
+    #define BAT_TTL_CAPACITY	120	//!< Remaining capacity
+#endif
+#ifndef BAT_TTL_RUNTIME
+    #define BAT_TTL_RUNTIME	120	//!< Run time to empty
+#endif
+#ifndef BAT_TTL_TEMP
+    #define BAT_TTL_TEMP	300	//!< Temperature
+#endif
+#ifndef BAT_TTL_STATUS
+    #define BAT_TTL_STATUS	30	//!< Battery status flags
+#endif
+#ifndef BAT_TTL_SOC
+    #define BAT_TTL_SOC		120	//!< Relative state of charge
+#endif
+//@}
+
+/*!@brief Minimum interval in [s] between two snapshot refreshes requested
+ * by BatteryValueGet().  This bounds the duty cycle of the SMBus and the
+ * battery controller, no matter how many consumers ask for values.
+ */
+#ifndef BAT_REFRESH_MIN
+    #define BAT_REFRESH_MIN	10
+#endif
+
 
 /*!@brief Enumeration of Battery Logging Information Level */
 typedef enum
@@ -237,6 +354,24 @@ typedef enum
      */
 #define i2cPowerFail			-12
 
+    /*!@brief Error code for a full request queue, additionally to @ref
+     * I2C_TransferReturn_TypeDef
+     */
+#define i2cQueueFull			-13
+
+    /*!@brief Error code for a wrong Packet Error Code (PEC) of a block read,
+     * additionally to @ref I2C_TransferReturn_TypeDef
+     */
+#define i2cPecError			-14
+
+/*!@brief Callback function for BatteryRegReadAsync().
+ *
+ * The function is called in interrupt context when the request has been
+ * completed.  Parameter @p status is @ref i2cTransferDone (0), or a negative
+ * error code.  Then @p pBuf contains the received data.
+ */
+typedef void	(* SMB_CALLBACK)(SBS_CMD cmd, int status, uint8_t *pBuf);
+
 /*!@brief Structure to request Battery Information (up to two requests). */
 typedef struct
 {
@@ -248,6 +383,21 @@ typedef struct
     uint8_t	Buffer[18];	// Buffer for Block Commands
 } BAT_INFO;
 
+/*!@brief Snapshot of the battery status, see BatterySnapshotReq(). */
+typedef struct
+{
+    uint16_t	Voltage;		//!< SBS_Voltage in [mV]
+    int16_t	Current;		//!< SBS_BatteryCurrent in [mA]
+    int16_t	AverageCurrent;		//!< SBS_AverageCurrent in [mA]
+    uint16_t	RemainingCapacity;	//!< SBS_RemainingCapacity in [mAh]
+    uint16_t	RunTimeToEmpty;		//!< SBS_RunTimeToEmpty in [min]
+    uint16_t	Temperature;		//!< SBS_Temperature in [0.1K]
+    uint16_t	BatteryStatus;		//!< SBS_BatteryStatus, see SBS_16_BITS
+    uint8_t	RelativeStateOfCharge;	//!< SBS_RelativeStateOfCharge in [%]
+    bool	Valid;			//!< All registers have been read
+    bool	Estimated;		//!< Only U and SoC, see SupplyMon.c
+} BAT_SNAPSHOT;
+
 /*================================ Global Data ===============================*/
 
 extern volatile int16_t   g_BattMilliVolt;
@@ -259,16 +409,25 @@ extern volatile uint16_t  g_BattCapacity;
 void	BatteryMonInit (void);
 void	BatteryMonDeinit (void);
 
+    /* HF clock has been switched, recalculate the SMBus clock */
+void	BatteryMonClockChange (void);
+
     /* Register read functions */
 int	BatteryRegReadWord  (SBS_CMD cmd);
 int	BatteryRegReadValue (SBS_CMD cmd, uint32_t *pValue);
 int	BatteryRegReadBlock (SBS_CMD cmd, uint8_t *pBuf, size_t bufSize);
+int	BatteryRegReadAsync (SBS_CMD cmd, uint8_t *pBuf, size_t bufSize,
+			     SMB_CALLBACK function);
 
     /* Info routines */
 void	LogBatteryInfo (BAT_LOG_INFO_LVL infoLvl);
 void	BatteryCheck (void);
 void	BatteryInfoReq (SBS_CMD req_1, SBS_CMD req_2);
 BAT_INFO *BatteryInfoGet (void);
+bool	BatterySnapshotReq (void);
+const BAT_SNAPSHOT *BatterySnapshotGet (void);
+bool	BatteryValueGet (SBS_CMD cmd, int32_t *pValue);
+void	BatteryMonIntervalScale (unsigned int factor);
 
     /* Power Fail Handler of the battery monitor module */
 void	BatteryMonPowerFailHandler (void);
@@ -276,4 +435,7 @@ void	BatteryMonPowerFailHandler (void);
     /* Call this routine when Battery Pack has been changed */
 void	BatteryChangeTrigger(void);
 
+    /* Check if the Battery Pack is still the same after a power-fail */
+bool	BatteryIsUnchanged (void);
+
 #endif /* __INC_BatteryMon_h */
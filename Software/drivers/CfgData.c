@@ -2,7 +2,7 @@
  * @file
  * @brief	Configuration Data
  * @author	Ralf Gerhauser
- * @version	2018-11-13
+ * @version	2026-10-15
  *
  * This module reads and parses a configuration file from the SD-Card, and
  * stores the data into a database.  It also provides routines to get access
@@ -10,6 +10,97 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	- CfgLookupID() and IDIndexFind() share the buffer l_ID_Found
+		  for the parameters of the found transponder ID.
+2026-10-15,agnt	- Removed the timeline marks of CfgRead().
+2026-10-15,agnt	- Removed the perfect hash of the names, it does not fit into
+		  RAM.  CfgNameFind() compares the name with all entries of
+		  the list again.
+2026-10-15,agnt	- CfgHashBuild() compares the bucket numbers as int.
+2026-10-15,agnt	- CfgDataShow() reports if a full ID table is backed by the
+		  ID index.
+2026-10-15,agnt	- The scratch file of the ID index uses the file handle of the
+		  logging module, see LogFileHandleGet().
+2026-10-15,agnt	- CfgVarListCRC() includes the size of CFG_LIST, so a binary
+		  image of a firmware with another CFG_LIST_SIZE is outdated.
+2026-10-15,agnt	- One configuration file may serve several boxes: the lines
+		  after "[BOX <hwid>]" are only read by the box with this
+		  hardware ID, the sections of other boxes are skipped without
+		  parsing, see CfgSection().  An "[INDEX]" before the sections
+		  lists their file offsets, so CfgRead() jumps straight to the
+		  section of this box.  The binary image records the hardware
+		  ID, increased CFG_BIN_VERSION to 8.
+2026-10-15,agnt	- Added CfgPrefetchIDs() to load the index sectors of the IDs
+		  which are likely to arrive into the sector cache, when a
+		  visit starts.  The search of IDIndexFind() is split into
+		  IDIndexRange() and IDIndexRead() for this purpose.
+2026-10-15,agnt	- An ID entry may specify the fields {VOLUME} and {INPUT_MODE},
+		  which are sent to the Audio module with the playback or
+		  record, see AudioParmSet().  Increased CFG_BIN_VERSION to 7
+		  and CFG_IDX_VERSION to 3.
+2026-10-15,agnt	- An ID entry may specify a fifth field {PLAYBACK_BURST}, the
+		  number of playbacks of the token bucket, see Throttle.c.
+		  Increased CFG_BIN_VERSION to 6 and CFG_IDX_VERSION to 2.
+2026-10-15,agnt	- Transponder IDs may be specified as pattern, e.g. "9E1CE7D0*",
+		  where '?' matches any digit and '*' all remaining ones.  The
+		  patterns are kept in a table which is sorted by the number
+		  of fixed digits, so IDPatternFind() returns the longest
+		  match.  They are consulted after the ID table and the ID
+		  index, and stored into the binary image.  Increased
+		  CFG_BIN_VERSION to 5.
+2026-10-15,agnt	- CfgRead() records the size and modification time of the
+		  configuration file, CfgChanged() compares them with the
+		  current file.
+2026-10-15,agnt	- CfgReadFindID: The line buffer is taken from the scratch pool,
+		  see ScratchGet().
+2026-10-15,agnt	- CfgRead() records its start and end in the timeline, see
+		  TIMELINE.
+2026-10-15,agnt	- Use StrFormat() instead of sprintf().
+2026-10-15,agnt	- CfgDataInit() builds a perfect hash of the variable and enum
+		  names, see CfgHashBuild().  CfgParse() finds a variable or
+		  an enum value with one hash and one string compare instead
+		  of comparing the name with all entries of the list.
+2026-10-15,agnt	- IDs which do not fit into the ID table are stored into the
+		  sorted index file CONFIG.IDX if CFG_ID_INDEX is set, and a
+		  Bloom filter of them is kept in RAM.  CfgLookupID() only
+		  reads the index for IDs which pass the Bloom filter, see
+		  IDIndexBuild() and IDIndexFind().
+2026-10-15,agnt	- The binary image stores the CRC-32 of the text file.  CfgBinLoad()
+		  accepts an image with another time stamp if the content of
+		  the text file matches, e.g. an image of the host tool
+		  cfg_compile, see sim_cfgc.c.  Increased CFG_BIN_VERSION to 4.
+2026-10-14,agnt	- CfgRead() no longer waits for the LEUART after each line,
+		  CfgDataShow() uses drvLEUART_putsWait() instead of
+		  drvLEUART_sync().
+2026-10-14,agnt	- Added CfgVarInfo() to get the configuration variables in
+		  their binary representation, e.g. for the telemetry protocol.
+2026-10-14,agnt	- Added data type CFG_VAR_TYPE_WEEKDAYS, see getWeekdays().
+		  It is stored as bit mask, bit 0 is Sunday.
+2026-10-14,agnt	- CfgActionCompile() resolves the default values of all IDs
+		  once after the configuration has been read, the special IDs
+		  "ANY" and "UNKNOWN" get shared action records.
+		  CfgLookupAction() returns the action of an ID with one
+		  lookup, including the fallback to "ANY" and "UNKNOWN".
+2026-10-14,agnt	- ID_PARM entries are allocated from a static arena instead
+		  of the heap, see CfgArenaAlloc().  CfgDataClear() releases
+		  all of them at once, CfgRead() logs the high-water mark.
+2026-10-14,agnt	- Added data type CFG_VAR_TYPE_LIST, the lists are stored as
+		  an additional section of the binary image.  Increased
+		  CFG_BIN_VERSION to 3.
+2026-10-14,agnt	- Transponder IDs are kept in a sorted in-RAM table of 64bit
+		  keys, built once by CfgRead().  CfgLookupID() uses a binary
+		  search instead of reading the configuration file for each
+		  compare.  The file is only scanned if the table overflowed.
+		- Transponder IDs are handled as binary TRANSPONDER_ID, the
+		  string is only generated by CfgIDToString() for logging.
+		- CfgRead() loads the binary configuration image CONFIG.BIN
+		  if it is consistent with CONFIG.TXT, otherwise the text file
+		  is parsed and a new image is generated.
+		- CfgReadFindID: Use the buffered file reader instead of
+		  calling f_read() for each character.
+		- Durations are stored in milliseconds.  They are specified in
+		  seconds, or in milliseconds with suffix "ms", see
+		  getDuration().  Increased CFG_BIN_VERSION to 2.
 2019-06-01,rage	- Bugfix in getString: Corrected pointer increment and check
 		  for comment or end of line.
 2018-11-13,rage	- The list of Transponder IDs is no more kept in memory, instead
@@ -38,13 +129,158 @@ Revision History:
 #include "ff.h"		// FS_FAT12/16/32
 #include "diskio.h"	// DSTATUS
 #include "microsd.h"
+#include "PowerFail.h"
 #include "Control.h"
+#include "StrFormat.h"
+#include "ScratchPool.h"
+#include "em_device.h"
 
 /*=============================== Definitions ================================*/
 
     /* local debug: show a list of all IDs and settings */
 #define CONFIG_DATA_SHOW	1
 
+    /*!@brief Magic number and version of the binary configuration image. */
+//@{
+#define CFG_BIN_MAGIC		0x42474643	// "CFGB"
+#define CFG_BIN_VERSION		8
+//@}
+
+    /*!@brief Magic number and version of the ID index file. */
+//@{
+#define CFG_IDX_MAGIC		0x58474643	// "CFGX"
+#define CFG_IDX_VERSION		3
+//@}
+
+    /*! Sector size of the ID index file, records do not cross sectors */
+#define CFG_IDX_SECT_SIZE	512
+
+    /*! Number of records of type @ref CFG_IDX_REC per sector */
+#define CFG_IDX_RECS_PER_SECT	(CFG_IDX_SECT_SIZE / sizeof(CFG_IDX_REC))
+
+    /*! Number of bits of the Bloom filter which are set for each ID */
+#define CFG_ID_BLOOM_HASHES	4
+
+    /*! Number of enum types, i.e. CFG_VAR_TYPE_ENUM_1 to CFG_VAR_TYPE_ENUM_5 */
+#define CFG_ENUM_CNT	(CFG_VAR_TYPE_ENUM_5 - CFG_VAR_TYPE_ENUM_1 + 1)
+
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Header of the binary configuration image.
+     *
+     * The header is followed by these sections:
+     * - <b>VarCnt</b> values of type int32_t, one for each configuration
+     *   variable, see CfgVarGet().
+     * - <b>SpecialCnt</b> entries of type @ref CFG_BIN_SPECIAL.
+     * - <b>ParmSetCnt</b> entries of @ref l_ID_ParmSet.
+     * - <b>ID_TableCnt</b> entries of @ref l_ID_Key.
+     * - <b>ID_TableCnt</b> entries of @ref l_ID_ParmIdx.
+     * - <b>PatternCnt</b> entries of @ref l_ID_PatKey, @ref l_ID_PatMask,
+     *   and @ref l_ID_PatParmIdx each.
+     * - One @ref CFG_LIST for each variable of type @ref CFG_VAR_TYPE_LIST.
+     *
+     * The CRC is calculated over all sections, but not the header.  The
+     * image belongs to the text file with <b>SrcSize</b> and
+     * <b>SrcDateTime</b>.  If the time stamp differs, e.g. since the image
+     * has been generated on a host, <b>SrcCRC</b> must match the content.
+     * If the text file contains box sections, the image only belongs to the
+     * box with <b>BoxID</b>, see CfgSection().
+     */
+typedef struct
+{
+    uint32_t Magic;		//!< @ref CFG_BIN_MAGIC
+    uint16_t Version;		//!< @ref CFG_BIN_VERSION
+    uint16_t HdrSize;		//!< size of this header
+    uint32_t SrcSize;		//!< size of the text configuration file
+    uint32_t SrcDateTime;	//!< FAT date and time of the text file
+    uint32_t VarListCRC;	//!< CRC of the variable names and types
+    uint32_t CRC;		//!< CRC of all sections after the header
+    uint16_t VarCnt;		//!< number of configuration variables
+    uint16_t ID_Cnt;		//!< number of IDs in the text file
+    uint16_t ID_TableCnt;	//!< number of entries in the ID table
+    uint16_t ID_TableSize;	//!< @ref CFG_ID_TABLE_SIZE of the firmware
+    uint8_t  ParmSetCnt;	//!< number of parameter sets
+    uint8_t  SpecialCnt;	//!< number of special IDs "ANY", "UNKNOWN"
+    uint8_t  ID_TableFull;	//!< not all IDs fit into the ID table
+    uint8_t  PatternCnt;	//!< number of ID patterns
+    uint32_t SrcCRC;		//!< CRC-32 of the text configuration file
+    TRANSPONDER_ID BoxID;	//!< hardware ID if the file has box sections
+} CFG_BIN_HDR;
+
+    /*!@brief Sections of the configuration file, see CfgSection(). */
+typedef enum
+{
+    CFG_SECT_COMMON,		//!< common part, read by all boxes
+    CFG_SECT_INDEX,		//!< "[INDEX]", file offsets of the sections
+    CFG_SECT_OTHER,		//!< section of another box, skipped
+    CFG_SECT_SEEK,		//!< jumped to the own section via the index
+    CFG_SECT_OWN,		//!< section of this box
+    CFG_SECT_END		//!< behind the own section, nothing more to read
+} CFG_SECT_STATE;
+
+    /*!@brief Position in the sections while the file is read. */
+typedef struct
+{
+    CFG_SECT_STATE State;	//!< current section
+    TRANSPONDER_ID BoxID;	//!< hardware ID of this box
+    DWORD	OwnOffs;	//!< offset of the own section, 0 if not indexed
+    int		OwnLine;	//!< line number of the own section
+    DWORD	OtherOffs;	//!< offset of the section the index jumped from
+    int		OtherLine;	//!< line number of this section
+} CFG_SECT;
+
+    /*!@brief Special ID entry in the binary configuration image. */
+typedef struct
+{
+    TRANSPONDER_ID ID;		//!< @ref ID_ANY or @ref ID_UNKNOWN
+    int32_t  KeepPlayback;	//!< individual KEEP_PLAYBACK duration
+    int32_t  KeepRecord;	//!< individual KEEP_RECORD duration
+    int32_t  PlayType;		//!< individual PLAYBACK_TYPE
+    int32_t  PlayBurst;		//!< individual PLAYBACK_BURST
+    int32_t  Volume;		//!< individual AUDIO_CFG_VC
+    int32_t  InputMode;		//!< individual AUDIO_CFG_IM
+} CFG_BIN_SPECIAL;
+
+    /*!@brief Header of the ID index file.
+     *
+     * The header is followed by the Bloom filter of <b>BloomBits</b> bits,
+     * and by <b>FenceCnt</b> keys, i.e. the first ID of every
+     * <b>FenceStep</b>th sector.  The records of type @ref CFG_IDX_REC start
+     * at <b>DataOffs</b>, sorted by their ID.  Each sector holds
+     * @ref CFG_IDX_RECS_PER_SECT records, the rest of it is unused.
+     *
+     * The index belongs to the text file with <b>SrcSize</b> and
+     * <b>SrcCRC</b>, like the binary configuration image.
+     */
+typedef struct
+{
+    uint32_t Magic;		//!< @ref CFG_IDX_MAGIC
+    uint16_t Version;		//!< @ref CFG_IDX_VERSION
+    uint16_t HdrSize;		//!< size of this header
+    uint32_t SrcSize;		//!< size of the text configuration file
+    uint32_t SrcCRC;		//!< CRC-32 of the text configuration file
+    uint32_t RecCnt;		//!< number of records
+    uint16_t RecSize;		//!< size of a record
+    uint16_t BloomBits;		//!< @ref CFG_ID_BLOOM_BITS of the firmware
+    uint16_t FenceCnt;		//!< number of fence keys
+    uint16_t FenceStep;		//!< number of sectors per fence key
+    uint32_t DataOffs;		//!< file offset of the first record
+    uint32_t CRC;		//!< CRC of the Bloom filter and the fence keys
+} CFG_IDX_HDR;
+
+    /*!@brief Record of the ID index file. */
+typedef struct
+{
+    TRANSPONDER_ID ID;		//!< transponder ID
+    int32_t  KeepPlayback;	//!< individual KEEP_PLAYBACK duration
+    int32_t  KeepRecord;	//!< individual KEEP_RECORD duration
+    int32_t  PlayType;		//!< individual PLAYBACK_TYPE
+    int32_t  PlayBurst;		//!< individual PLAYBACK_BURST
+    int32_t  Volume;		//!< individual AUDIO_CFG_VC
+    int32_t  InputMode;		//!< individual AUDIO_CFG_IM
+} CFG_IDX_REC;
+
 /*================================ Local Data ================================*/
 
     /*! Local pointer to list of configuration variables */
@@ -60,20 +296,147 @@ static FIL	l_fh;
 static ID_PARM *l_pFirstID;
 static ID_PARM *l_pLastID;
 
+    /*! Parameters of the transponder ID found by CfgLookupID(), they are
+     *  valid until the next lookup. */
+static ID_PARM	l_ID_Found;
+
+    /*! Static arena for configuration data, see CfgArenaAlloc() */
+static uint8_t	l_CfgArena[CFG_ARENA_SIZE] __attribute__((aligned(8)));
+
+    /*! Number of bytes used from the arena, and its high-water mark */
+static uint16_t	l_CfgArenaUsed;
+static uint16_t	l_CfgArenaPeak;
+
     /*! Number of IDs in configuration file */
 static uint16_t	l_ID_Cnt;
 
     /*! Flag tells if data has been loaded from file */
 static bool	l_flgDataLoaded;
 
+    /*! Flag is set if the file contains sections of several boxes */
+static bool	l_flgBoxSections;
+
+    /*! Size and modification time of the file the data has been loaded from,
+     *  see CfgChanged() */
+static uint32_t	l_CfgSrcSize;
+static uint32_t	l_CfgSrcDateTime;
+
+    /*! Sorted table of transponder IDs, each packed into a 64bit key */
+static TRANSPONDER_ID l_ID_Key[CFG_ID_TABLE_SIZE];
+
+    /*! Parameter set index for each entry of @ref l_ID_Key */
+static uint8_t	l_ID_ParmIdx[CFG_ID_TABLE_SIZE];
+
+    /*! Different parameter sets used by the ID table, their defaults are
+     *  resolved by CfgActionCompile() */
+static CFG_ACTION l_ID_ParmSet[CFG_ID_PARM_SETS];
+
+    /*! Number of entries in the ID table and of parameter sets */
+static uint16_t	l_ID_TableCnt;
+static uint8_t	l_ID_ParmSetCnt;
+
+    /*! Flag is set if not all IDs could be stored into the ID table */
+static bool	l_flgID_TableFull;
+
+    /*! Table of ID patterns, sorted by decreasing number of fixed digits.
+     *  An ID matches an entry if (ID & mask) equals its key. */
+static TRANSPONDER_ID l_ID_PatKey[CFG_ID_PATTERNS];
+static TRANSPONDER_ID l_ID_PatMask[CFG_ID_PATTERNS];
+
+    /*! Parameter set index for each entry of @ref l_ID_PatKey */
+static uint8_t	l_ID_PatParmIdx[CFG_ID_PATTERNS];
+
+    /*! Number of entries in the pattern table */
+static uint8_t	l_ID_PatCnt;
+
+#if CFG_ID_INDEX
+    /*! File handle for the scratch file while the ID index is built, it is
+     *  borrowed from the logging module, see LogFileHandleGet().
+     */
+static FIL	*l_pFhIdx;
+
+    /*! Bloom filter of all IDs which did not fit into the ID table */
+static uint8_t	l_ID_Bloom[CFG_ID_BLOOM_BITS / 8];
+
+    /*! First ID of every FenceStep-th sector of the index */
+static TRANSPONDER_ID l_ID_Fence[CFG_ID_INDEX_FENCES];
+
+    /*! Header of the index, RecCnt counts the IDs while it is built */
+static CFG_IDX_HDR l_IdxHdr;
+
+    /*! Flag is set if the index is valid, otherwise the file is scanned */
+static bool	l_flgID_Index;
+
+    /*! Flag is set if the scratch file of the index could not be written */
+static bool	l_flgID_IndexErr;
+#endif
+
+    /*! Default values for the actions, see CfgActionCompile() */
+static CFG_ACTION l_ActionDflt;
+
+    /*! Shared action records of the special IDs "ANY" and "UNKNOWN" */
+static CFG_ACTION l_ActionAny, l_ActionUnknown;
+
+    /*! Pointers to the above records, NULL if the special ID is not defined */
+static const CFG_ACTION *l_pActionAny, *l_pActionUnknown;
+
+    /*! Action record of an ID which has been read from the file */
+static CFG_ACTION l_ActionFile;
+
 /*=========================== Forward Declarations ===========================*/
 
-static ID_PARM *CfgReadFindID (char *filename, char *transponderID);
+static ID_PARM *CfgReadFindID (char *filename, const TRANSPONDER_ID *pTransponderID);
 static void  CfgDataClear (void);
-static ID_PARM *CfgParse (int lineNum, char *line, char *transponderID);
+static int   CfgNameFind (const char *pName, int enumNum);
+static void *CfgArenaAlloc (size_t size);
+static ID_PARM *CfgParse (int lineNum, char *line, const TRANSPONDER_ID *pTransponderID);
+static TRANSPONDER_ID CfgBoxID (void);
+static bool  CfgSection (CFG_SECT *pSect, FILE_READER *pRd, DWORD pos,
+			 int *pLineNum, char *line);
+static bool  CfgSectionIndex (CFG_SECT *pSect, int lineNum, char *pStr);
+static bool  CfgSectionStale (CFG_SECT *pSect, FILE_READER *pRd, int *pLineNum);
 static bool  skipSpace (char **ppStr);
 static char *getString (char **ppStr);
 static int32_t getInteger (char **ppStr, int lineNum, int varIdx, int32_t minVal);
+static int32_t getDuration (char **ppStr, int lineNum, int varIdx);
+static bool  getList (char **ppStr, int lineNum, int varIdx, CFG_LIST *pList);
+static int32_t getWeekdays (char **ppStr, int lineNum, int varIdx);
+static char *CfgListToString (const CFG_LIST *pList, char *pBuf);
+static int   IDTableFind (TRANSPONDER_ID key, bool *pFound);
+static void  IDTableAdd (int lineNum, TRANSPONDER_ID key, const ID_PARM *pParm);
+static int   IDParmSetAdd (const ID_PARM *pParm);
+static bool  IDPatternParse (const char *pStr, TRANSPONDER_ID *pKey,
+			     TRANSPONDER_ID *pMask);
+static int   IDPatternDigits (TRANSPONDER_ID mask);
+static void  IDPatternAdd (int lineNum, TRANSPONDER_ID key, TRANSPONDER_ID mask,
+			   const ID_PARM *pParm);
+static int   IDPatternFind (TRANSPONDER_ID id);
+static char *IDPatternToString (int idx, char *pBuf);
+static void  CfgShowIDParm (const char *pName, const CFG_ACTION *pParm);
+static void  CfgActionResolve (CFG_ACTION *pAction, const CFG_ACTION *pParm);
+static ID_PARM *IDOverflowFind (TRANSPONDER_ID key);
+#if CFG_ID_INDEX
+static bool  IDBloomTest (TRANSPONDER_ID key, bool flgSet);
+static void  IDIndexAdd (TRANSPONDER_ID key, const ID_PARM *pParm);
+static void  IDIndexBuild (char *filename);
+static bool  IDIndexLoad (uint32_t srcSize, uint32_t srcCRC);
+static bool  IDIndexRange (TRANSPONDER_ID key, uint32_t *pLo, uint32_t *pHi);
+static int   IDIndexRead (TRANSPONDER_ID key, uint32_t lo, uint32_t hi,
+			  CFG_IDX_REC *pRec);
+static ID_PARM *IDIndexFind (TRANSPONDER_ID key);
+#endif
+#if CFG_BIN_IMAGE
+static bool  CfgBinLoad (char *filename);
+static void  CfgBinSave (char *filename);
+static bool  CfgBinRead (void *pBuf, UINT size, uint32_t *pCRC);
+static bool  CfgBinWrite (const void *pBuf, UINT size, uint32_t *pCRC);
+static bool  CfgBinLists (bool flgWrite, uint32_t *pCRC);
+static bool  CfgFileCRC (char *filename, uint32_t *pCRC);
+static int32_t CfgVarGet (int varIdx);
+static void  CfgVarSet (int varIdx, int32_t value);
+static uint32_t CfgVarListCRC (void);
+static uint32_t CfgCRC32 (uint32_t crc, const void *pData, size_t size);
+#endif
 
 
 /***************************************************************************//**
@@ -113,7 +476,11 @@ void	CfgDataInit (const CFG_VAR_DEF *pCfgVarList, const ENUM_DEF *pEnumDef)
  *
  * @brief	Read configuration file
  *
- * This routine reads the specified configuration file.
+ * This routine reads the specified configuration file.  If @ref CFG_BIN_IMAGE
+ * is enabled, the binary configuration image @ref CFG_BIN_FILE_NAME is loaded
+ * instead, provided it has been generated from the current version of the
+ * text file (same size and modification time).  Otherwise the text file is
+ * parsed, and a new image is written if no errors occurred.
  *
  * @param[in] filename
  *	Name of the configuration file to be read.
@@ -121,8 +488,74 @@ void	CfgDataInit (const CFG_VAR_DEF *pCfgVarList, const ENUM_DEF *pEnumDef)
  ******************************************************************************/
 void	CfgRead (char *filename)
 {
-    /* read configuration file, store variables */
-    CfgReadFindID (filename, NULL);
+#if CFG_BIN_IMAGE
+uint32_t errCnt;
+#endif
+
+#if CFG_BIN_IMAGE
+    /* try to load the binary image first */
+    if (! CfgBinLoad (filename))
+    {
+	errCnt = g_LogErrorCnt;
+#endif
+
+	/* read configuration file, store variables */
+	CfgReadFindID (filename, NULL);
+
+#if CFG_BIN_IMAGE
+	/* generate binary image if the text file could be parsed without errors */
+	if (l_flgDataLoaded  &&  g_LogErrorCnt == errCnt)
+	    CfgBinSave (filename);
+    }
+#endif
+
+    Log ("Config Arena: %d of %d Bytes used, peak %d",
+	 l_CfgArenaUsed, CFG_ARENA_SIZE, l_CfgArenaPeak);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if the Configuration File has been changed
+ *
+ * This routine compares the size and modification time of the specified
+ * configuration file with those of the file the current configuration has
+ * been read from, see CfgRead().
+ *
+ * @param[in] filename
+ *	Name of the configuration file.
+ *
+ * @return
+ *	The value <i>true</i> if the file exists and has been changed, or no
+ *	configuration has been loaded yet.  <i>false</i> if it is unchanged, or
+ *	it cannot be accessed, so the current configuration should be kept.
+ *
+ ******************************************************************************/
+bool	CfgChanged (char *filename)
+{
+FILINFO	 fno;
+FRESULT	 res;
+
+
+    if (IsDiskRemoved())
+	return false;
+
+    /* Be sure to flush current log buffer so it is empty */
+    LogFlush(true);	// keep SD-Card power on!
+
+    res = f_stat (filename, &fno);
+
+    /* Power off the SD-Card Interface */
+    MICROSD_PowerOff();
+
+    if (res != FR_OK)
+    {
+	LogError ("CfgChanged: %s - Error Code %d", filename, res);
+	return false;
+    }
+
+    return (! l_flgDataLoaded  ||  fno.fsize != l_CfgSrcSize
+	    ||  (((uint32_t)fno.fdate << 16) | fno.ftime) != l_CfgSrcDateTime);
 }
 
 
@@ -136,40 +569,61 @@ void	CfgRead (char *filename)
  * @param[in] filename
  *	Name of the configuration file to be read.
  *
- * @param[in] transponderID
- *	Transponder ID to find in the configuration file.
+ * @param[in] pTransponderID
+ *	Address of the transponder ID to find in the configuration file, or
+ *	NULL to read and store all configuration data.
  *
  * @return
- *	Only relevant if @param transponderID is specified for comparison.
+ *	Only relevant if @param pTransponderID is specified for comparison.
  *	Returns a pointer to a @ref ID_PARM structure if ID has been found,
  *	or NULL otherwise.
  *
  ******************************************************************************/
-static ID_PARM *CfgReadFindID (char *filename, char *transponderID)
+static ID_PARM *CfgReadFindID (char *filename, const TRANSPONDER_ID *pTransponderID)
 {
 ID_PARM	*pID = NULL;	// Pointer to the parameter set of the specified ID
 FRESULT	 res;		// FatFs function common result code
+FILE_READER rd;		// buffered file reader
 int	 lineNum;	// current line number
-size_t	 i;		// index within line buffer
-UINT	 cnt = 0;	// number of bytes read
-char	 line[200];	// line buffer (resides on stack)
+int	 len;		// length of the current line
+char	*line;		// line buffer (from the scratch pool)
+FILINFO	 fno;		// size and time of the file
+CFG_SECT sect;		// position in the box sections
+DWORD	 pos;		// file offset of the current line
 
 
-    
+    /* Get the line buffer, SCRATCH_BLOCK_SIZE also limits the line length */
+    line = ScratchGet();
+    if (line == NULL)
+    {
+	LogError ("CfgRead: No line buffer available");
+	if (pTransponderID == NULL)
+	    l_flgDataLoaded = false;
+	return NULL;
+    }
+
     /* Be sure to flush current log buffer so it is empty */
     LogFlush(true);	// keep SD-Card power on!
   
     /* Log reading of the configuration file */
-    if (transponderID == NULL)
+    if (pTransponderID == NULL)
     {
 	Log ("Reading Configuration File %s", filename);
 
 	/* Discard previous configuration data */
 	CfgDataClear();
 
+	/* Remember which version of the file is read, see CfgChanged() */
+	if (f_stat (filename, &fno) == FR_OK)
+	{
+	    l_CfgSrcSize = fno.fsize;
+	    l_CfgSrcDateTime = ((uint32_t)fno.fdate << 16) | fno.ftime;
+	}
+
 	/* Assume data can be loaded */
 	l_flgDataLoaded = true;
 	l_ID_Cnt = 0;
+	l_flgBoxSections = false;
     }
 
     /* Open the file */
@@ -182,102 +636,424 @@ char	 line[200];	// line buffer (resides on stack)
 
 	/* Power off the SD-Card Interface */
 	MICROSD_PowerOff();
+	ScratchPut (line);
 	return NULL;
     }
     
-    /* Read configuration file line by line */
-    for (lineNum = 1;  ;  lineNum++)
-    {
-	/* Read line char by char because f_gets() does not check read errors */
-	for (i = 0;  i < sizeof(line);  i++)
-	{
-	    res = f_read(&l_fh, line + i, 1, &cnt);
-	    if (res != FR_OK)
-	    {
-		LogError ("CfgRead: FILE READ - Error Code %d", res);
-		l_flgDataLoaded = false;
-		break;
-	    }
-	    if (cnt == 0)
-		break;		// end of file detected
+    /* Read configuration file line by line, f_gets() does not check errors */
+    FileReaderInit (&rd, &l_fh, NULL, 0);
 
-	    if (line[i] == '\r')
-		i--;		// ignore <CR>
-	    else if (line[i] == '\n')
-		break;		// read on complete line - process it
-	}
-	if (res != FR_OK)
-	    break;		// abort on error
+    memset (&sect, 0, sizeof(sect));
+    sect.State = CFG_SECT_COMMON;
+    sect.BoxID = CfgBoxID();
 
-	/* terminate line buffer with EOS */
-	line[i] = EOS;		// substitute <NL> with EOS
-
-	/* Parse line (and compare transponder ID) */
-	pID = CfgParse (lineNum, line, transponderID);
+    for (lineNum = 1;  ;  lineNum++)
+    {
+	pos = FileReaderTell (&rd);
+	len = FileReadLine (&rd, line, SCRATCH_BLOCK_SIZE);
 
-	/* Check for end of file or ID found */
-	if (cnt == 0  ||  pID != NULL)
+	if (len == FILE_READ_EOF)
 	    break;		// end of file detected
 
-	if (i >= sizeof(line))
+	if (len == FILE_READ_ERROR)
+	{
+	    LogError ("CfgRead: FILE READ - Error Code %d", rd.Res);
+	    l_flgDataLoaded = false;
+	    break;		// abort on error
+	}
+
+	if (len == FILE_READ_TOO_LONG)
 	{
 	    LogError ("CfgRead: Line %d too long (exceeds %d characters)",
-		      lineNum, sizeof(line));
+		      lineNum, SCRATCH_BLOCK_SIZE - 1);
 	    break;
 	}
 
-	drvLEUART_sync();	// to prevent UART buffer overflow
+	/* Skip the sections of other boxes */
+	if (! CfgSection (&sect, &rd, pos, &lineNum, line))
+	{
+	    if (sect.State == CFG_SECT_END)
+		break;		// the sections of the boxes come last
+	    continue;
+	}
+
+	/* Parse line (and compare transponder ID) */
+	pID = CfgParse (lineNum, line, pTransponderID);
+
+	/* Check if ID found */
+	if (pID != NULL)
+	    break;
     }
 
     /* close file after reading data */
     f_close(&l_fh);
 
+    if (pTransponderID == NULL  &&  l_flgBoxSections)
+    {
+	Log ("Config File: %s box %s",
+	     sect.State == CFG_SECT_OWN  ||  sect.State == CFG_SECT_END
+	     ? "Read the section of" : "No section for",
+	     CfgIDToString (sect.BoxID, line));
+    }
+    ScratchPut (line);
+
+#if CFG_ID_INDEX
+    /* sort the IDs which did not fit into the ID table into the index */
+    if (pTransponderID == NULL)
+	IDIndexBuild (filename);
+#endif
+
     /* Power off the SD-Card Interface */
     MICROSD_PowerOff();
 
 
 #if CONFIG_DATA_SHOW
     /* show a list of all IDs and settings (will not be logged) */
-    if (transponderID == NULL)
+    if (pTransponderID == NULL)
 	CfgDataShow();
 #endif
     return pID;
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Hardware ID of this Box
+ *
+ * @return
+ *	Unique number of the MCU, which main() logs as "HW-ID".  It is written
+ *	like a transponder ID in the section headers "[BOX <hwid>]".
+ *
+ ******************************************************************************/
+static TRANSPONDER_ID CfgBoxID (void)
+{
+    return ((TRANSPONDER_ID)DEVINFO->UNIQUEH << 32) | DEVINFO->UNIQUEL;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Handle the Box Sections of the Configuration File
+ *
+ * One configuration file may serve several boxes.  All lines up to the first
+ * section header "[BOX <hwid>]" are common, the lines of a section are only
+ * read by the box with this hardware ID.  The sections must come last, so
+ * reading ends after the own section.  The sections of other boxes are
+ * skipped without parsing, so their IDs take neither time nor RAM.
+ *
+ * An "[INDEX]" before the sections may contain an entry
+ * "<hwid> = <offset>:<line>" for each section, i.e. the file offset and the
+ * line number of its header, see "cfg_compile -x".  At the first section of
+ * another box, the reader then jumps to the own section.  If there is no
+ * header of this box at the offset, the index is out of date, and the
+ * sections are scanned instead.
+ *
+ * @param[in,out] pSect
+ *	Current position in the sections, updated by this routine.
+ *
+ * @param[in] pRd
+ *	File reader, it is moved when the index is used.
+ *
+ * @param[in] pos
+ *	File offset of the current line.
+ *
+ * @param[in,out] pLineNum
+ *	Number of the current line, it is changed together with the position.
+ *
+ * @param[in] line
+ *	Current line.
+ *
+ * @return
+ *	The value <i>true</i> if the line must be parsed by CfgParse().
+ *
+ ******************************************************************************/
+static bool  CfgSection (CFG_SECT *pSect, FILE_READER *pRd, DWORD pos,
+			 int *pLineNum, char *line)
+{
+char	*pStr = line;
+char	*pEnd;
+TRANSPONDER_ID id;
+bool	 flgValid;
+
+
+    skipSpace(&pStr);		// skip white space
+
+    if (*pStr != '[')
+    {
+	if (pSect->State == CFG_SECT_SEEK)
+	    return CfgSectionStale (pSect, pRd, pLineNum);
+
+	if (pSect->State == CFG_SECT_INDEX)
+	    return CfgSectionIndex (pSect, *pLineNum, pStr);
+
+	return (pSect->State == CFG_SECT_COMMON
+		||  pSect->State == CFG_SECT_OWN);
+    }
+
+    if (strncmp (pStr, "[INDEX]", 7) == 0  &&  ! l_flgBoxSections)
+    {
+	pSect->State = CFG_SECT_INDEX;
+	return false;
+    }
+
+    /* expect "[BOX <hwid>]" */
+    pEnd = strchr (pStr, ']');
+    flgValid = (strncmp (pStr, "[BOX", 4) == 0  &&  isspace((int)pStr[4])
+		&&  pEnd != NULL);
+    if (flgValid)
+    {
+	pStr += 4;
+	skipSpace(&pStr);
+	while (pEnd > pStr  &&  isspace((int)pEnd[-1]))
+	    pEnd--;
+	*pEnd = EOS;
+	for (pEnd = pStr;  *pEnd != EOS;  pEnd++)
+	    *pEnd = toupper((int)*pEnd);	// hex digits may be lower case
+	flgValid = CfgStrToID (pStr, &id);
+    }
+    if (! flgValid)
+    {
+	LogError ("Config File - Line %d: Invalid Section Header", *pLineNum);
+	id = 0;
+    }
+    l_flgBoxSections = true;
+
+    if (pSect->State == CFG_SECT_OWN)
+    {
+	pSect->State = CFG_SECT_END;	// end of the own section
+    }
+    else if (flgValid  &&  id == pSect->BoxID)
+    {
+	pSect->State = CFG_SECT_OWN;
+    }
+    else if (pSect->State == CFG_SECT_SEEK)
+    {
+	return CfgSectionStale (pSect, pRd, pLineNum);
+    }
+    else if (pSect->OwnOffs != 0)
+    {
+	/* jump to the own section, remember where to continue otherwise */
+	pSect->OtherOffs = pos;
+	pSect->OtherLine = *pLineNum;
+	pSect->State = CFG_SECT_SEEK;
+	if (! FileReaderSeek (pRd, pSect->OwnOffs))
+	    return CfgSectionStale (pSect, pRd, pLineNum);
+
+	*pLineNum = pSect->OwnLine - 1;	// incremented by the caller
+    }
+    else
+    {
+	pSect->State = CFG_SECT_OTHER;
+    }
+    return false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Parse an Entry of the Section Index
+ *
+ * This routine parses an entry "<hwid> = <offset>:<line>" of the "[INDEX]".
+ * Only the entry of this box is kept, so the RAM does not depend on the
+ * number of boxes.
+ *
+ * @return
+ *	Always <i>false</i>, the line is not parsed by CfgParse().
+ *
+ ******************************************************************************/
+static bool  CfgSectionIndex (CFG_SECT *pSect, int lineNum, char *pStr)
+{
+char	*pID = pStr;
+char	 saveChar;
+TRANSPONDER_ID id;
+DWORD	 offs;
+int	 num;
+bool	 flgValid;
+
+
+    if (*pStr == EOS  ||  *pStr == '#')
+	return false;		// empty or comment line
+
+    while (isalnum((int)*pStr))
+	pStr++;
+
+    saveChar = *pStr;		// terminate the ID for the conversion
+    *pStr = EOS;
+    flgValid = CfgStrToID (pID, &id);
+    *pStr = saveChar;
+
+    skipSpace(&pStr);
+    if (*pStr == '=')
+	pStr++;
+    else
+	flgValid = false;
+
+    skipSpace(&pStr);
+    for (offs = 0;  isdigit((int)*pStr);  pStr++)
+	offs = offs * 10 + (*pStr - '0');
+
+    if (*pStr == ':')
+	pStr++;
+    else
+	flgValid = false;
+
+    for (num = 0;  isdigit((int)*pStr);  pStr++)
+	num = num * 10 + (*pStr - '0');
+
+    if (offs == 0  ||  num == 0)
+	flgValid = false;
+
+    if (! flgValid)
+	LogError ("Config File - Line %d: Invalid Index Entry", lineNum);
+    else if (id == pSect->BoxID)
+    {
+	pSect->OwnOffs = offs;
+	pSect->OwnLine = num;
+    }
+    return false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	The Section Index is out of Date
+ *
+ * This routine is called if the section index did not lead to the header
+ * of the own section.  The reader returns to the section it jumped from,
+ * and all sections are scanned.
+ *
+ * @return
+ *	Always <i>false</i>, the line is not parsed by CfgParse().
+ *
+ ******************************************************************************/
+static bool  CfgSectionStale (CFG_SECT *pSect, FILE_READER *pRd, int *pLineNum)
+{
+    LogError ("Config File - Line %d: Section Index is out of date",
+	      pSect->OwnLine);
+
+    pSect->OwnOffs = 0;
+    pSect->State = CFG_SECT_COMMON;	// the header is read again
+    FileReaderSeek (pRd, pSect->OtherOffs);
+    *pLineNum = pSect->OtherLine - 1;	// incremented by the caller
+    return false;
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Clear current configuration data
  *
  * This routine frees all memory which was allocated by the current
- * configuration data.
+ * configuration data.  All of it is located in the arena, so this is done
+ * by resetting its fill level.
  *
  ******************************************************************************/
 static void  CfgDataClear (void)
 {
-ID_PARM	*pID, *pID_next;
+int	 i;
 
-    if (l_pFirstID)
-    {
-	/* free memory of ID list */
-	for (pID = l_pFirstID;  pID != NULL;  pID = pID_next)
-	{
-	    pID_next = pID->pNext;
+    /* release the ID list and the actions of the special IDs */
+    l_pFirstID = l_pLastID = NULL;
+    l_CfgArenaUsed = 0;
+    l_pActionAny = l_pActionUnknown = NULL;
+
+    /* discard ID table and patterns */
+    l_ID_TableCnt = 0;
+    l_ID_ParmSetCnt = 0;
+    l_flgID_TableFull = false;
+    l_ID_PatCnt = 0;
+
+#if CFG_ID_INDEX
+    /* discard the index and the Bloom filter */
+    memset (l_ID_Bloom, 0, sizeof(l_ID_Bloom));
+    memset (&l_IdxHdr, 0, sizeof(l_IdxHdr));
+    l_flgID_Index = false;
+    l_flgID_IndexErr = false;
+#endif
 
-	    free (pID);
-	}
+    /* discard all lists */
+    for (i = 0;  l_pCfgVarList[i].name != NULL;  i++)
+	if (l_pCfgVarList[i].type == CFG_VAR_TYPE_LIST)
+	    ((CFG_LIST *)l_pCfgVarList[i].pData)->Cnt = 0;
+}
 
-	l_pFirstID = l_pLastID = NULL;
-    }
+
+/***************************************************************************//**
+ *
+ * @brief	Allocate memory for configuration data
+ *
+ * This routine allocates memory from the static arena @ref l_CfgArena.  The
+ * memory is only released by CfgDataClear(), which discards the complete
+ * configuration data.
+ *
+ * @param[in] size
+ *	Number of bytes to allocate.  The size is rounded up to 8 bytes to keep
+ *	all allocations aligned.
+ *
+ * @return
+ *	Address of the allocated memory, or NULL if the arena is exhausted.
+ *
+ ******************************************************************************/
+static void *CfgArenaAlloc (size_t size)
+{
+void	*pMem;
+
+    size = (size + 7) & ~7;
+    if (size > (size_t)(CFG_ARENA_SIZE - l_CfgArenaUsed))
+	return NULL;
+
+    pMem = l_CfgArena + l_CfgArenaUsed;
+    l_CfgArenaUsed += size;
+    if (l_CfgArenaUsed > l_CfgArenaPeak)
+	l_CfgArenaPeak = l_CfgArenaUsed;
+
+    return pMem;
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Find a variable or enum name
+ *
+ * @param[in] pName
+ *	Name to find, terminated by EOS.
+ *
+ * @param[in] enumNum
+ *	0 to find a variable, or the enum number 1 to @ref CFG_ENUM_CNT.
+ *
+ * @return
+ *	Index of the variable in the list of configuration variables, or the
+ *	value of the enum, or -1 if the name is not valid.
+ *
+ ******************************************************************************/
+static int   CfgNameFind (const char *pName, int enumNum)
+{
+const char **ppEnumName;
+int	 key;
+
+    if (enumNum == 0)
+    {
+	for (key = 0;  l_pCfgVarList[key].name != NULL;  key++)
+	    if (strcmp (pName, l_pCfgVarList[key].name) == 0)
+		return key;
+    }
+    else
+    {
+	ppEnumName = l_pEnumDef[enumNum - 1];
+	for (key = 0;  ppEnumName[key] != NULL;  key++)
+	    if (strcmp (pName, ppEnumName[key]) == 0)
+		return key;
+    }
+
+    return -1;
+}
+
 /***************************************************************************//**
  *
  * @brief	Parse line for variable assignment or comparison
  *
  * This routine parses the given line buffer for a variable name and its value.
- * Comments and empty lines will be skipped.  When parameter transponderID is
+ * Comments and empty lines will be skipped.  When parameter pTransponderID is
  * specified, parsed data is not stored in the respective variables, instead
  * a comparison is made in case of an ID.
  *
@@ -288,16 +1064,16 @@ ID_PARM	*pID, *pID_next;
  * @param[in] line
  *	Line buffer to be parsed.
  *
- * @param[in] transponderID
- *	Transponder ID if used for comparison, NULL otherwise.
+ * @param[in] pTransponderID
+ *	Address of the transponder ID if used for comparison, NULL otherwise.
  *
  * @return
- *	Only relevant if parameter transponderID is specified for comparison.
+ *	Only relevant if parameter pTransponderID is specified for comparison.
  *	Returns a pointer to a @ref ID_PARM structure if ID has been found,
  *	or NULL otherwise.
  *
  ******************************************************************************/
-static ID_PARM *CfgParse(int lineNum, char *line, char *transponderID)
+static ID_PARM *CfgParse(int lineNum, char *line, const TRANSPONDER_ID *pTransponderID)
 {
 char	*pStr = line;
 char	*pStrBegin;
@@ -308,9 +1084,11 @@ int	 hour, minute;
 int32_t	 duration, value = 0;
 static ID_PARM ID_Parm;
 ID_PARM	*pNewID;
+TRANSPONDER_ID id, mask;
+bool	 flgValidID;
+bool	 flgPattern;
 ALARM_TIME *pAlarm;
 CFG_VAR_TYPE cfgVarType;
-const char **ppEnumName;
 
 
     line--;
@@ -336,8 +1114,8 @@ const char **ppEnumName;
     saveChar = *pStr;		// save character
     *pStr = EOS;		// terminate variable name for compare
 
-    /* if parameter <transponderID> is specified, find "ID" */
-    if (transponderID != NULL)
+    /* if parameter <pTransponderID> is specified, find "ID" */
+    if (pTransponderID != NULL)
     {
 	if (strcmp(pStrBegin, "ID") != 0)
 	    return NULL;	// ignore all variables, except "ID"
@@ -347,11 +1125,8 @@ const char **ppEnumName;
     }
     else
     {
-	for (varIdx = 0;  l_pCfgVarList[varIdx].name != NULL;  varIdx++)
-	    if (strcmp(pStrBegin, l_pCfgVarList[varIdx].name) == 0)
-		break;
-
-	if (l_pCfgVarList[varIdx].name == NULL)
+	varIdx = CfgNameFind (pStrBegin, 0);
+	if (varIdx < 0)
 	{
 	    LogError ("Config File - Line %d, pos %ld: Unknown Variable '%s'",
 		      lineNum, (pStrBegin-line), pStrBegin);
@@ -426,49 +1201,66 @@ const char **ppEnumName;
 	    break;
 
 
-	case CFG_VAR_TYPE_DURATION:	// 0 to n seconds
-	    duration = getInteger (&pStr, lineNum, varIdx, 0);
+	case CFG_VAR_TYPE_DURATION:	// 0 to n seconds, or n ms
+	    duration = getDuration (&pStr, lineNum, varIdx);
 	    *((int32_t *)l_pCfgVarList[varIdx].pData) = duration;
 	    break;
 
 
-	case CFG_VAR_TYPE_ID:	// {ID}:{KEEP_PLAYBACK}:{KEEP_RECORD}:{PLAYBACK_TYPE}
+	case CFG_VAR_TYPE_ID:	// {ID}:{KEEP_PLAYBACK}:{KEEP_RECORD}:{PLAYBACK_TYPE}:{PLAYBACK_BURST}:{VOLUME}:{INPUT_MODE}
 	    /* initialize structure */
 	    ID_Parm.pNext = NULL;
 	    ID_Parm.KeepPlayback   = DUR_INVALID;
 	    ID_Parm.KeepRecord = DUR_INVALID;
 	    ID_Parm.PlayType = DUR_INVALID;
-
-	    /* get transponder ID */
-	    for (pStrBegin = pStr;  isalnum((int)*pStr);  pStr++);
+	    ID_Parm.PlayBurst = DUR_INVALID;
+	    ID_Parm.Volume = DUR_INVALID;
+	    ID_Parm.InputMode = DUR_INVALID;
+	    ID_Parm.ID = ID_UNKNOWN;
+
+	    /* get transponder ID, or a pattern with '?' and '*' */
+	    for (pStrBegin = pStr;  isalnum((int)*pStr)  ||  *pStr == '?'
+				    ||  *pStr == '*';  pStr++);
             
             /* must be followed by ':', space, or EOS */
 	    if (*pStr != ':'  &&  ! isspace((int)*pStr)  &&  *pStr != EOS)
 	        break;			// generate error message
-                   
-            
-            /* if parameter <transponderID> is specified, compare it */
-	    if (transponderID != NULL)
-	    {
-		saveChar = *pStr;	// save character
-		*pStr = EOS;		// terminate transponder ID string
 
-		if (strcmp (pStrBegin, transponderID) != 0)
-		    return NULL;	// ID does not match
+	    /* convert transponder ID into its binary representation */
+	    saveChar = *pStr;		// save character
+	    *pStr = EOS;		// terminate transponder ID string
 
-		*pStr = saveChar;	// restore character
+	    flgPattern = (strpbrk (pStrBegin, "?*") != NULL);
+	    if (flgPattern)
+		flgValidID = IDPatternParse (pStrBegin, &id, &mask);
+	    else
+		flgValidID = CfgStrToID (pStrBegin, &id);
 
-		/* Transponder ID does match, get further parameters... */
+	    if (! flgValidID  &&  pTransponderID == NULL)
+	    {
+		LogError ("Config File - Line %d, pos %ld: Invalid ID '%s'",
+			  lineNum, (pStrBegin-line), pStrBegin);
 	    }
 
+	    *pStr = saveChar;		// restore character
+
+	    if (! flgValidID)
+		return NULL;
+
+            /* if parameter <pTransponderID> is specified, compare it */
+	    if (pTransponderID != NULL  &&  (flgPattern  ||  id != *pTransponderID))
+		return NULL;		// ID does not match, patterns are in RAM
+
+	    ID_Parm.ID = id;
+
 	    /* see if {KEEP_PLAYBACK} value follows */
 	    if (*pStr == ':')
 	    {
-		*(pStr++) = EOS;	// terminate transponder ID string
+		pStr++;
 
 		if (isdigit((int)*pStr))
 		{
-		    duration = getInteger (&pStr, lineNum, varIdx, 0);
+		    duration = getDuration (&pStr, lineNum, varIdx);
 	            ID_Parm.KeepPlayback = duration;
 		}
 	    }
@@ -478,10 +1270,10 @@ const char **ppEnumName;
 	    {
 		pStr++;
 
-		/* duration in seconds, or empty */
+		/* duration in seconds or milliseconds, or empty */
 	        if (isdigit((int)*pStr))
 		{
-		    duration = getInteger (&pStr, lineNum, varIdx, 0);
+		    duration = getDuration (&pStr, lineNum, varIdx);
 		    ID_Parm.KeepRecord = duration;
 		}
 	    }
@@ -502,20 +1294,91 @@ const char **ppEnumName;
 		}
 	    }
 
-	    /* if <transponderID> has been found, return parameters */
-	    if (transponderID != NULL)
+	    /* see if {PLAYBACK_BURST} value follows */
+	    if (*pStr == ':')
+	    {
+		pStr++;
+
+		/* field must be a number of playbacks, or empty */
+		if (isdigit((int)*pStr))
+		{
+		    duration = getInteger (&pStr, lineNum, varIdx, 0);
+		    if (duration < 0)
+			return NULL;	// ERROR
+
+		    ID_Parm.PlayBurst = duration;
+		}
+	    }
+
+	    /* see if {VOLUME} value follows */
+	    if (*pStr == ':')
+	    {
+		pStr++;
+
+		/* field must be a volume of 1 to 31, or empty */
+		if (isdigit((int)*pStr))
+		{
+		    duration = getInteger (&pStr, lineNum, varIdx, 1);
+		    if (duration < 0)
+			return NULL;	// ERROR
+
+		    if (duration > 31)
+		    {
+			LogError ("Config File - Line %d, %s: Volume %ld must"
+				  " be <= 31", lineNum, l_pCfgVarList[varIdx].name,
+				  duration);
+			return NULL;
+		    }
+		    ID_Parm.Volume = duration;
+		}
+	    }
+
+	    /* see if {INPUT_MODE} value follows */
+	    if (*pStr == ':')
+	    {
+		pStr++;
+
+		/* field must be an input mode of 0 to 2, or empty */
+		if (isdigit((int)*pStr))
+		{
+		    duration = getInteger (&pStr, lineNum, varIdx, 0);
+		    if (duration < 0)
+			return NULL;	// ERROR
+
+		    if (duration > 2)
+		    {
+			LogError ("Config File - Line %d, %s: Input mode %ld"
+				  " must be <= 2", lineNum,
+				  l_pCfgVarList[varIdx].name, duration);
+			return NULL;
+		    }
+		    ID_Parm.InputMode = duration;
+		}
+	    }
+
+	    /* if <pTransponderID> has been found, return parameters */
+	    if (pTransponderID != NULL)
 	    {
 		return &ID_Parm;
 	    }
 
 	    l_ID_Cnt++;		// count ID
 
-	    /* only special IDs "ANY" and "UNKNOWN" are kept in memory */
-	    if (strcmp (pStrBegin, "ANY") == 0
-	    ||  strcmp (pStrBegin, "UNKNOWN") == 0)
+	    /* patterns are stored into the pattern table */
+	    if (flgPattern)
+	    {
+		IDPatternAdd (lineNum, id, mask, &ID_Parm);
+	    }
+	    /* regular transponder IDs are stored into the ID table */
+	    else if (id != ID_ANY  &&  id != ID_UNKNOWN)
+	    {
+		IDTableAdd (lineNum, id, &ID_Parm);
+	    }
+	    /* special IDs "ANY" and "UNKNOWN" are kept in the ID list */
+	    else
 	    {
 		/* allocate memory an store ID and parameters */
-		pNewID = malloc(sizeof(ID_Parm) + strlen(pStrBegin) + 1);
+		pNewID = CfgArenaAlloc(sizeof(ID_Parm));
 		if (pNewID == NULL)
 		{
 		    LogError ("Config File - Line %d, pos %ld, ID: OUT OF MEMORY",
@@ -524,7 +1387,6 @@ const char **ppEnumName;
 		}
 
 		*pNewID = ID_Parm;
-		strcpy(pNewID->ID, pStrBegin);
 
 		if (l_pLastID)
 		{
@@ -571,13 +1433,9 @@ const char **ppEnumName;
 		return NULL;
 	    }
 
-	    ppEnumName = l_pEnumDef[l_pCfgVarList[varIdx].type
-				    - CFG_VAR_TYPE_ENUM_1];
-
-	    for (i = 0;  ppEnumName[i] != NULL;  i++)
-		if (strcmp (ppEnumName[i], pStrBegin) == 0)
-		    break;
-	    if (ppEnumName[i] == NULL)
+	    i = CfgNameFind (pStrBegin, l_pCfgVarList[varIdx].type
+					- CFG_VAR_TYPE_ENUM_1 + 1);
+	    if (i < 0)
 	    {
 		LogError ("Config File - Line %d, %s: "
 			  "Enum name %s is not valid", lineNum,
@@ -588,6 +1446,20 @@ const char **ppEnumName;
 	    *((PWR_OUT *)l_pCfgVarList[varIdx].pData) = (PWR_OUT)i;
 	    break;        
 
+	case CFG_VAR_TYPE_LIST:		// First[-Last][*Weight], ...
+	    if (! getList (&pStr, lineNum, varIdx,
+			   (CFG_LIST *)l_pCfgVarList[varIdx].pData))
+		return NULL;		// ERROR
+	    break;
+
+	case CFG_VAR_TYPE_WEEKDAYS:	// ALL, or Day[-Day], ...
+	    value = getWeekdays (&pStr, lineNum, varIdx);
+	    if (value < 0)
+		return NULL;		// ERROR
+
+	    *((int32_t *)l_pCfgVarList[varIdx].pData) = value;
+	    break;
+
 
 	default:		// unsupported data type
 	    LogError ("Config File - Line %d, pos %ld, %s: "
@@ -640,6 +1512,184 @@ int32_t value;
     return value;
 }
 
+// returns duration in [ms], or DUR_INVALID in case of error
+static int32_t getDuration (char **ppStr, int lineNum, int varIdx)
+{
+int32_t value;
+
+    value = getInteger (ppStr, lineNum, varIdx, 0);
+
+    /* optional suffix "ms", otherwise the value is given in seconds */
+    if ((*ppStr)[0] == 'm'  &&  (*ppStr)[1] == 's'
+    &&  ! isalnum((int)(*ppStr)[2]))
+    {
+	*ppStr += 2;
+	return value;
+    }
+
+    if (value > INT32_MAX / 1000)
+    {
+	LogError ("Config File - Line %d, %s=%ld: Duration too large",
+		  lineNum, l_pCfgVarList[varIdx].name, value);
+	return DUR_INVALID;
+    }
+
+    return value * 1000;
+}
+
+
+// returns false in case of error, the list is empty then
+static bool getList (char **ppStr, int lineNum, int varIdx, CFG_LIST *pList)
+{
+int32_t	 first, last, weight;
+
+    pList->Cnt = 0;
+
+    while (1)
+    {
+	if (! isdigit((int)**ppStr))
+	{
+	    LogError ("Config File - Line %d, %s: Number expected",
+		      lineNum, l_pCfgVarList[varIdx].name);
+	    break;
+	}
+
+	/* get range, values must be >= 1 */
+	first = last = getInteger (ppStr, lineNum, varIdx, 1);
+	if (first < 0)
+	    break;
+
+	if (**ppStr == '-')
+	{
+	    (*ppStr)++;
+	    last = getInteger (ppStr, lineNum, varIdx, first);
+	    if (last < 0)
+		break;
+	}
+
+	/* optional weight */
+	weight = 1;
+	if (**ppStr == '*')
+	{
+	    (*ppStr)++;
+	    weight = getInteger (ppStr, lineNum, varIdx, 1);
+	    if (weight < 0)
+		break;
+	}
+
+	if (last > UINT16_MAX  ||  weight > UINT16_MAX)
+	{
+	    LogError ("Config File - Line %d, %s: Value too large",
+		      lineNum, l_pCfgVarList[varIdx].name);
+	    break;
+	}
+
+	if (pList->Cnt >= CFG_LIST_SIZE)
+	{
+	    LogError ("Config File - Line %d, %s: More than %d entries",
+		      lineNum, l_pCfgVarList[varIdx].name, CFG_LIST_SIZE);
+	    break;
+	}
+	pList->Entry[pList->Cnt].First  = (uint16_t)first;
+	pList->Entry[pList->Cnt].Last   = (uint16_t)last;
+	pList->Entry[pList->Cnt].Weight = (uint16_t)weight;
+	pList->Cnt++;
+
+	/* entries are separated by ',' */
+	skipSpace(ppStr);
+	if (**ppStr != ',')
+	    return true;
+
+	(*ppStr)++;
+	skipSpace(ppStr);
+    }
+
+    pList->Cnt = 0;		// discard incomplete list
+    return false;
+}
+
+// returns pBuf with the list in the same format as in the configuration file
+static char *CfgListToString (const CFG_LIST *pList, char *pBuf)
+{
+char	*pStr = pBuf;
+int	 i;
+
+    *pStr = EOS;
+    for (i = 0;  i < pList->Cnt;  i++)
+    {
+	pStr += StrFormat (pStr, "%s%d", i > 0 ? ", " : "", pList->Entry[i].First);
+	if (pList->Entry[i].Last != pList->Entry[i].First)
+	    pStr += StrFormat (pStr, "-%d", pList->Entry[i].Last);
+	if (pList->Entry[i].Weight != 1)
+	    pStr += StrFormat (pStr, "*%d", pList->Entry[i].Weight);
+    }
+    return pBuf;
+}
+
+
+// returns the weekday (0 is Sunday) of a 2-letter name, or -1 in case of error
+static int getWeekday (char **ppStr)
+{
+int	i;
+
+    for (i = 0;  i < 7;  i++)
+    {
+	if (toupper((int)(*ppStr)[0]) == g_WeekdayName[i][0]
+	&&  toupper((int)(*ppStr)[1]) == g_WeekdayName[i][1]
+	&&  ! isalnum((int)(*ppStr)[2]))
+	{
+	    *ppStr += 2;
+	    return i;
+	}
+    }
+    return -1;
+}
+
+// returns bit mask of weekdays, bit 0 is Sunday, or -1 in case of error
+static int32_t getWeekdays (char **ppStr, int lineNum, int varIdx)
+{
+int32_t	 mask = 0;
+int	 first, last;
+
+    if (strncmp (*ppStr, "ALL", 3) == 0  &&  ! isalnum((int)(*ppStr)[3]))
+    {
+	*ppStr += 3;
+	return WEEKDAYS_ALL;
+    }
+
+    for (;;)
+    {
+	first = last = getWeekday (ppStr);
+
+	/* optional range, it may wrap, e.g. FR-MO */
+	if (first >= 0  &&  **ppStr == '-')
+	{
+	    (*ppStr)++;
+	    last = getWeekday (ppStr);
+	}
+
+	if (first < 0  ||  last < 0)
+	{
+	    LogError ("Config File - Line %d, %s: Invalid weekday, "
+		      "use SU, MO, TU, WE, TH, FR, SA, or ALL",
+		      lineNum, l_pCfgVarList[varIdx].name);
+	    return -1;
+	}
+
+	for (mask |= (1 << first);  first != last;  mask |= (1 << first))
+	    first = (first + 1) % 7;
+
+	skipSpace (ppStr);
+	if (**ppStr != ',')
+	    break;		// end of list
+
+	(*ppStr)++;
+	skipSpace (ppStr);
+    }
+
+    return mask;
+}
+
 
 // returns pointer to terminated string, or NULL in case of error
 static char *getString (char **ppStr)
@@ -673,7 +1723,9 @@ char	*pStrBegin = *ppStr;
  *
  * @brief	Lookup transponder ID in configuration data
  *
- * This routine searches the specified transponder ID in the @ref ID_PARM list.
+ * This routine searches the specified transponder ID in the in-RAM ID table,
+ * or in the @ref ID_PARM list in case of the special IDs "ANY" and "UNKNOWN".
+ * IDs which did not fit into the table are looked up by IDOverflowFind().
  *
  * @param[in] transponderID
  *	Transponder ID to lookup.
@@ -683,184 +1735,2412 @@ char	*pStrBegin = *ppStr;
  * 	ID could not be found.
  *
  ******************************************************************************/
-ID_PARM *CfgLookupID (char *transponderID)
+ID_PARM *CfgLookupID (TRANSPONDER_ID transponderID)
 {
 ID_PARM	*pID;
+bool	 found;
+int	 idx;
 
-    /* only special IDs "ANY" and "UNKNOWN" are kept in memory */
-    if (strcmp (transponderID, "ANY") == 0
-    ||  strcmp (transponderID, "UNKNOWN") == 0)
+    /* special IDs "ANY" and "UNKNOWN" are kept in the ID list */
+    if (transponderID == ID_ANY  ||  transponderID == ID_UNKNOWN)
     {
 	for (pID = l_pFirstID;  pID != NULL;  pID = pID->pNext)
-	    if (strcmp (pID->ID, transponderID) == 0)
+	    if (pID->ID == transponderID)
 		return pID;
 
 	return NULL;	// special ID not found
     }
 
-    /* transponder IDs must be read from the CONFIG file for comparison */
-    return CfgReadFindID ("CONFIG.TXT", transponderID);
+    /* all other transponder IDs are looked up in the ID table */
+    idx = IDTableFind (transponderID, &found);
+    if (found)
+    {
+	idx = l_ID_ParmIdx[idx];
+	l_ID_Found.pNext = NULL;
+	l_ID_Found.ID = transponderID;
+	l_ID_Found.KeepPlayback = l_ID_ParmSet[idx].KeepPlayback;
+	l_ID_Found.KeepRecord   = l_ID_ParmSet[idx].KeepRecord;
+	l_ID_Found.PlayType     = l_ID_ParmSet[idx].PlayType;
+	l_ID_Found.PlayBurst    = l_ID_ParmSet[idx].PlayBurst;
+	l_ID_Found.Volume       = l_ID_ParmSet[idx].Volume;
+	l_ID_Found.InputMode    = l_ID_ParmSet[idx].InputMode;
+
+	return &l_ID_Found;
+    }
+
+    /* IDs which did not fit into the table must be read from the card */
+    if (l_flgID_TableFull)
+    {
+	pID = IDOverflowFind (transponderID);
+	if (pID != NULL)
+	    return pID;
+    }
+
+    /* the ID is not listed itself, the longest matching pattern applies */
+    idx = IDPatternFind (transponderID);
+    if (idx < 0)
+	return NULL;
+
+    idx = l_ID_PatParmIdx[idx];
+    l_ID_Found.pNext = NULL;
+    l_ID_Found.ID = transponderID;
+    l_ID_Found.KeepPlayback = l_ID_ParmSet[idx].KeepPlayback;
+    l_ID_Found.KeepRecord   = l_ID_ParmSet[idx].KeepRecord;
+    l_ID_Found.PlayType     = l_ID_ParmSet[idx].PlayType;
+    l_ID_Found.PlayBurst    = l_ID_ParmSet[idx].PlayBurst;
+    l_ID_Found.Volume       = l_ID_ParmSet[idx].Volume;
+    l_ID_Found.InputMode    = l_ID_ParmSet[idx].InputMode;
+
+    return &l_ID_Found;
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Show all configuration data
+ * @brief	Prefetch the Index Sectors of likely Transponder IDs
  *
- * This debug routine shows all configuration data on the serial console.
+ * This routine is called when a visit starts, i.e. some hundred milliseconds
+ * before the transponder ID is read.  It powers the SD-Card on and searches
+ * the specified IDs in the index file, so the sectors of the directory, the
+ * FAT, and the index records are in the sector cache of diskio.c, see
+ * _DISK_CACHE_SECTORS.  The card is retained afterwards, see DiskRelease().
+ * When the ID arrives, IDIndexFind() reads them from the cache.  Only IDs
+ * which are not in the in-RAM ID table and pass the Bloom filter are
+ * considered, at most as many as the cache can hold in addition to the
+ * directory and the FAT.  Nothing is done without an ID index.
+ *
+ * @param[in] pIDs
+ *	Array of transponder IDs, the most likely one first.  It is read last,
+ *	so it is the last one to be evicted from the cache.
+ *
+ * @param[in] cnt
+ *	Number of entries in the array.
+ *
+ * @return
+ *	Number of IDs which have been searched in the index file.
  *
  ******************************************************************************/
-void	 CfgDataShow (void)
+int	CfgPrefetchIDs (const TRANSPONDER_ID *pIDs, int cnt)
 {
-char	 line[200];
-char	*pStr;
-int	 i, idx;
-int8_t	 hour, minute;
-int32_t	 duration, value;
-ALARM_TIME *pAlarm;
-ID_PARM	*pID;
-const char **ppEnumName;
+#if CFG_ID_INDEX  &&  _DISK_CACHE_SECTORS > 0
+TRANSPONDER_ID key[_DISK_CACHE_SECTORS];
+uint32_t lo[_DISK_CACHE_SECTORS], hi[_DISK_CACHE_SECTORS];
+CFG_IDX_REC rec;
+int	 i, n;
+bool	 found;
+
+    if (! l_flgID_Index  ||  ! l_flgID_TableFull)
+	return 0;		// all IDs are in RAM
+
+    /* IDs which would be read from the index, leave room for DIR and FAT */
+    for (i = n = 0;  i < cnt  &&  n < _DISK_CACHE_SECTORS - 2;  i++)
+    {
+	if (pIDs[i] == ID_ANY  ||  pIDs[i] == ID_UNKNOWN)
+	    continue;
 
+	IDTableFind (pIDs[i], &found);
+	if (found  ||  ! IDBloomTest (pIDs[i], false)
+	||  ! IDIndexRange (pIDs[i], &lo[n], &hi[n]))
+	    continue;
 
-    drvLEUART_sync();	// to prevent UART buffer overflow
+	key[n++] = pIDs[i];
+    }
+    if (n == 0)
+	return 0;
 
-    if (l_pCfgVarList == NULL  ||  ! l_flgDataLoaded)
+    if (IsDiskRemoved()  ||  IsPowerFail()  ||  DiskAcquire() != 0)
     {
-	drvLEUART_puts ("No Configuration Data loaded\n");
-	return;
+	DiskRelease (false);
+	return 0;
     }
-    
-    drvLEUART_puts ("All times are displayed for timezone ");
-    drvLEUART_puts (g_isdst ? "MESZ\n":"MEZ\n");
-    
-    /* log all values read from configuration file */
-    for (i = 0;  l_pCfgVarList[i].name != NULL;  i++)
+
+    /* the most likely ID is read last */
+    for (i = n - 1;  i >= 0;  i--)
     {
-	pStr = line;
+	if (IDIndexRead (key[i], lo[i], hi[i], &rec) < 0)
+	    break;
+    }
 
-	if (l_pCfgVarList[i].type == CFG_VAR_TYPE_ID)
-	    continue;		// IDs are shown below
+    DiskRelease (i < 0);
 
-	pStr += sprintf (pStr, "%-27s : ", l_pCfgVarList[i].name);
+    return n;
+#else
+    (void) pIDs;  (void) cnt;	// suppress compiler warning "unused parameter"
 
-	switch (l_pCfgVarList[i].type)
-	{
-	    case CFG_VAR_TYPE_TIME:		// 00:00 to 23:59
-		if (! AlarmIsEnabled (FIRST_POWER_ALARM + i))
-		{
-		    pStr += sprintf (pStr, "disabled");
-		    break;
-		}
-		pAlarm = (ALARM_TIME *)l_pCfgVarList[i].pData;
-		if (pAlarm != NULL)
-		{
-		    hour   = pAlarm->Hour;
-		    minute = pAlarm->Minute;
-		}
-		else
-		{
-		    AlarmGet (FIRST_POWER_ALARM + i, &hour, &minute);
-		}
-		pStr += sprintf (pStr, "%02d:%02d", hour, minute);
-		break;
+    return 0;
+#endif
+}
 
-	    case CFG_VAR_TYPE_DURATION:	// 0 to n seconds, or A for always
-		duration = *((int32_t *)l_pCfgVarList[i].pData);
-		if (duration == DUR_INVALID)
-		    pStr += sprintf (pStr, "invalid");
-		else
-		    pStr += sprintf (pStr, "%ld", duration);
-		break;
 
+/***************************************************************************//**
+ *
+ * @brief	Compile the Actions of all Transponder IDs
+ *
+ * This routine must be called after CfgRead(), when the configuration
+ * variables are known.  It resolves the parameters which are not specified
+ * for an ID, i.e. @ref DUR_INVALID, with the given default values.  This is
+ * done once for each parameter set of the ID table, so IDs with the same
+ * settings still share one record.  The special IDs "ANY" and "UNKNOWN" get
+ * shared records that are returned by CfgLookupAction() for all IDs which are
+ * not part of the configuration.
+ *
+ * @param[in] pDflt
+ *	Default values for KEEP_PLAYBACK, KEEP_RECORD, PLAYBACK_TYPE,
+ *	PLAYBACK_BURST, AUDIO_CFG_VC, and AUDIO_CFG_IM.
+ *
+ ******************************************************************************/
+void	CfgActionCompile (const CFG_ACTION *pDflt)
+{
+ID_PARM	*pID;
+CFG_ACTION parm;
+int	 i;
 
-	    case CFG_VAR_TYPE_ID: // {ID}:{PLAYBACK_TYPE}:{KEEP_PLAYBACK}:{KEEP_RECORD}
-		/* IDs will be handled separately */
-		break;
+    l_ActionDflt = *pDflt;
 
+    for (i = 0;  i < l_ID_ParmSetCnt;  i++)
+	CfgActionResolve (&l_ID_ParmSet[i], &l_ID_ParmSet[i]);
 
-	    case CFG_VAR_TYPE_INTEGER:	// a positive integer variable 0..n
-          	value = *((uint32_t *)l_pCfgVarList[i].pData);
-		pStr += sprintf (pStr, "%lu", value);
-		break;
-            
-            case CFG_VAR_TYPE_ENUM_1:	// ENUM types
-	    case CFG_VAR_TYPE_ENUM_2:
-	    case CFG_VAR_TYPE_ENUM_3:
-	    case CFG_VAR_TYPE_ENUM_4:
-	    case CFG_VAR_TYPE_ENUM_5:
-            if (l_pEnumDef == NULL)
-	    {
-		pStr += sprintf (pStr, "ERROR: No enum names defined");
-		    break;
-            }
-	    /* Type cast (PWR_OUT) is used for ALL types of enums */
-	    idx = *((PWR_OUT *)l_pCfgVarList[i].pData);
-	    if (idx < 0)
-	    {
-		pStr += sprintf (pStr, "not set");
-               break;
-	    }
-	    ppEnumName = l_pEnumDef[l_pCfgVarList[i].type
-		       - CFG_VAR_TYPE_ENUM_1];
-            pStr += sprintf (pStr, "%s", ppEnumName[idx]);
-	   break;
-        
-           default:		// unsupported data type
-		LogError ("l_pCfgVarList[%d], %s: Unsupported data type %d",
-			  i, l_pCfgVarList[i].name, l_pCfgVarList[i].type);
-		break;
-	}
+    l_pActionAny = l_pActionUnknown = NULL;
 
-	sprintf (pStr, "\n");
-	drvLEUART_puts (line);
-	drvLEUART_sync();	// to prevent UART buffer overflow
+    for (pID = l_pFirstID;  pID != NULL;  pID = pID->pNext)
+    {
+	parm.KeepPlayback = pID->KeepPlayback;
+	parm.KeepRecord   = pID->KeepRecord;
+	parm.PlayType     = pID->PlayType;
+	parm.PlayBurst    = pID->PlayBurst;
+	parm.Volume       = pID->Volume;
+	parm.InputMode    = pID->InputMode;
+
+	if (pID->ID == ID_ANY  &&  l_pActionAny == NULL)
+	{
+	    CfgActionResolve (&l_ActionAny, &parm);
+	    l_pActionAny = &l_ActionAny;
+	}
+	else if (pID->ID == ID_UNKNOWN  &&  l_pActionUnknown == NULL)
+	{
+	    CfgActionResolve (&l_ActionUnknown, &parm);
+	    l_pActionUnknown = &l_ActionUnknown;
+	}
     }
+}
 
-    /* print number of IDs read from the config file */
-    sprintf (line, "Number of IDs        : %d\n", l_ID_Cnt);
-    drvLEUART_puts (line);
 
-    /* print list of special IDs */
-    if (l_pFirstID == NULL)
-    {
-	drvLEUART_puts ("Warning: Special IDs \"ANY\" and/or \"UNKNOWN\" have"
-			" not been defined\n");
-    }
+/***************************************************************************//**
+ *
+ * @brief	Lookup the Action of a Transponder ID
+ *
+ * This routine returns the action record of the specified transponder ID,
+ * which has been prepared by CfgActionCompile().  If the ID is not part of
+ * the configuration, the record of the longest matching ID pattern is
+ * returned, otherwise the one of the "ANY" entry, or, if this does not
+ * exist, the one of the "UNKNOWN" entry.  Only if the ID table overflowed,
+ * the configuration file is read for IDs not in the table.
+ *
+ * @param[in] transponderID
+ *	Transponder ID to lookup, may also be @ref ID_UNKNOWN.
+ *
+ * @param[out] pMatch
+ *	Address where to store which entry has been found.
+ *
+ * @return
+ * 	Address of the @ref CFG_ACTION record, or NULL if neither the ID nor
+ * 	one of the entries "ANY" and "UNKNOWN" exist.
+ *
+ ******************************************************************************/
+const CFG_ACTION *CfgLookupAction (TRANSPONDER_ID transponderID,
+				   CFG_MATCH *pMatch)
+{
+ID_PARM	*pID;
+CFG_ACTION parm;
+bool	 found;
+int	 idx;
+
+    *pMatch = CFG_MATCH_ID;
+
+    if (transponderID == ID_UNKNOWN  &&  l_pActionUnknown != NULL)
+	return l_pActionUnknown;
+
+    if (transponderID != ID_ANY  &&  transponderID != ID_UNKNOWN)
+    {
+	idx = IDTableFind (transponderID, &found);
+	if (found)
+	    return &l_ID_ParmSet[l_ID_ParmIdx[idx]];
+
+	/* IDs which did not fit into the table must be read from the card */
+	if (l_flgID_TableFull)
+	{
+	    pID = IDOverflowFind (transponderID);
+	    if (pID != NULL)
+	    {
+		parm.KeepPlayback = pID->KeepPlayback;
+		parm.KeepRecord   = pID->KeepRecord;
+		parm.PlayType     = pID->PlayType;
+		parm.PlayBurst    = pID->PlayBurst;
+		parm.Volume       = pID->Volume;
+		parm.InputMode    = pID->InputMode;
+		CfgActionResolve (&l_ActionFile, &parm);
+		return &l_ActionFile;
+	    }
+	}
+
+	/* the ID is not listed itself, the longest matching pattern applies */
+	idx = IDPatternFind (transponderID);
+	if (idx >= 0)
+	{
+	    *pMatch = CFG_MATCH_PATTERN;
+	    return &l_ID_ParmSet[l_ID_PatParmIdx[idx]];
+	}
+    }
+
+    /* ID is not part of the configuration, use the shared records */
+    if (l_pActionAny != NULL)
+    {
+	*pMatch = CFG_MATCH_ANY;
+	return l_pActionAny;
+    }
+
+    *pMatch = CFG_MATCH_UNKNOWN;
+    return l_pActionUnknown;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Convert transponder ID string into binary representation
+ *
+ * This routine converts a transponder ID, which consists of exactly 16
+ * upper-case hexadecimal digits (as generated by the RFID reader), into a
+ * 64bit binary value of type @ref TRANSPONDER_ID.  The special IDs "ANY"
+ * and "UNKNOWN" are converted into @ref ID_ANY and @ref ID_UNKNOWN.
+ *
+ * @param[in] pStr
+ *	Transponder ID string, terminated by EOS.
+ *
+ * @param[out] pID
+ *	Address where to store the resulting transponder ID.
+ *
+ * @return
+ *	The value <i>true</i> if the string is a valid transponder ID,
+ *	<i>false</i> if not.
+ *
+ ******************************************************************************/
+bool	CfgStrToID (const char *pStr, TRANSPONDER_ID *pID)
+{
+TRANSPONDER_ID key = 0;
+int	 i;
+
+    /* check for special IDs */
+    if (strcmp (pStr, "ANY") == 0)
+    {
+	*pID = ID_ANY;
+	return true;
+    }
+    if (strcmp (pStr, "UNKNOWN") == 0)
+    {
+	*pID = ID_UNKNOWN;
+	return true;
+    }
+
+    for (i = 0;  i < 16;  i++, pStr++)
+    {
+	if (*pStr >= '0'  &&  *pStr <= '9')
+	    key = (key << 4) | (*pStr - '0');
+	else if (*pStr >= 'A'  &&  *pStr <= 'F')
+	    key = (key << 4) | (*pStr - 'A' + 10);
+	else
+	    return false;	// not a hex digit
+    }
+
+    if (*pStr != EOS)
+	return false;		// ID too long
+
+    *pID = key;
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Convert transponder ID into a string
+ *
+ * This routine generates the string representation of a transponder ID,
+ * i.e. 16 hexadecimal digits, or "ANY" and "UNKNOWN" for the special IDs.
+ *
+ * @param[in] transponderID
+ *	Transponder ID to convert.
+ *
+ * @param[out] pBuf
+ *	Buffer for the string, must be at least @ref ID_STR_SIZE bytes.
+ *
+ * @return
+ *	Address of the string buffer, i.e. <b>pBuf</b>.
+ *
+ ******************************************************************************/
+char	*CfgIDToString (TRANSPONDER_ID transponderID, char *pBuf)
+{
+static const char HexChar[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+				 '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+int	 i;
+
+    if (transponderID == ID_ANY)
+	return strcpy (pBuf, "ANY");
+
+    if (transponderID == ID_UNKNOWN)
+	return strcpy (pBuf, "UNKNOWN");
+
+    for (i = 15;  i >= 0;  i--)
+    {
+	pBuf[i] = HexChar[transponderID & 0x0F];
+	transponderID >>= 4;
+    }
+    pBuf[16] = EOS;
+
+    return pBuf;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Convert duration into a string
+ *
+ * This routine generates the string representation of a duration, i.e. the
+ * number of seconds if it is a multiple of 1000ms, or the number of
+ * milliseconds followed by "ms" otherwise.  This is the same format as
+ * accepted in the configuration file.
+ *
+ * @param[in] duration
+ *	Duration in milliseconds to convert.
+ *
+ * @param[out] pBuf
+ *	Buffer for the string, must be at least @ref DUR_STR_SIZE bytes.
+ *
+ * @return
+ *	Address of the string buffer, i.e. <b>pBuf</b>.
+ *
+ ******************************************************************************/
+char	*CfgDurationToString (int32_t duration, char *pBuf)
+{
+    if (duration % 1000)
+	StrFormat (pBuf, "%ldms", duration);
     else
+	StrFormat (pBuf, "%ld", duration / 1000);
+
+    return pBuf;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Find key in ID table
+ *
+ * This routine performs a binary search for the specified key in the sorted
+ * ID table @ref l_ID_Key.
+ *
+ * @param[in] key
+ *	Transponder ID key to find.
+ *
+ * @param[out] pFound
+ *	Set to <i>true</i> if the key has been found, <i>false</i> if not.
+ *
+ * @return
+ *	Index of the key if it has been found, or index where the key has to
+ *	be inserted otherwise.
+ *
+ ******************************************************************************/
+static int   IDTableFind (TRANSPONDER_ID key, bool *pFound)
+{
+int	 lo = 0;
+int	 hi = l_ID_TableCnt;
+int	 mid;
+
+    while (lo < hi)
     {
-	drvLEUART_puts ("                     "
-			": KEEP_PLAYBACK : KEEP_RECORD : PLAYBACK_TYPE\n");
+	mid = (lo + hi) / 2;
 
-	for (pID = l_pFirstID;  pID != NULL;  pID = pID->pNext)
+	if (l_ID_Key[mid] == key)
 	{
-	    pStr = line;
+	    *pFound = true;
+	    return mid;
+	}
 
-	    pStr += sprintf (pStr, "%-20s", pID->ID);
+	if (l_ID_Key[mid] < key)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
 
-	    pStr += sprintf (pStr, " :  ");
-	    duration = pID->KeepPlayback;
-	    if (duration == DUR_INVALID)
-		pStr += sprintf (pStr, "default");
-	    else
-		pStr += sprintf (pStr, "%7ld", duration);
+    *pFound = false;
+    return lo;
+}
 
-	    pStr += sprintf (pStr, "  :    ");
-	    duration = pID->KeepRecord; 
-	    if (duration == DUR_INVALID)
-		pStr += sprintf (pStr, "default");
-	    else
-		pStr += sprintf (pStr, "%7ld", duration);
 
-	    pStr += sprintf (pStr, "  :   ");
-	    duration = pID->PlayType;
-	    if (duration == DUR_INVALID)
-		pStr += sprintf (pStr, "default");
-	    else
-		pStr += sprintf (pStr, "%7ld", duration);
+/***************************************************************************//**
+ *
+ * @brief	Add transponder ID to the ID table
+ *
+ * This routine inserts the specified key into the sorted ID table.  Equal
+ * parameter sets are shared between IDs to save memory.  If the ID table or
+ * the list of parameter sets is full, @ref l_flgID_TableFull is set, so
+ * CfgLookupID() reads the configuration file for IDs that could not be
+ * stored, or the ID index if @ref CFG_ID_INDEX is set.  When an ID is
+ * specified more than once, the first entry is used.
+ *
+ * @param[in] lineNum
+ *	Line number, used for error messages.
+ *
+ * @param[in] key
+ *	Transponder ID key.
+ *
+ * @param[in] pParm
+ *	Parameters for this ID.
+ *
+ ******************************************************************************/
+static void  IDTableAdd (int lineNum, TRANSPONDER_ID key, const ID_PARM *pParm)
+{
+bool	 found;
+int	 idx, setIdx;
+
+    if (l_flgID_TableFull)
+    {
+#if CFG_ID_INDEX
+	IDIndexAdd (key, pParm);
+#endif
+	return;			// ID will be read from file
+    }
+
+    idx = IDTableFind (key, &found);
+    if (found)
+    {
+	LogError ("Config File - Line %d: Duplicate ID ignored", lineNum);
+	return;
+    }
+
+    /* share the parameter set with other IDs if possible */
+    setIdx = (l_ID_TableCnt < CFG_ID_TABLE_SIZE ? IDParmSetAdd (pParm) : -1);
 
-	    sprintf (pStr, "\n");
-	    drvLEUART_puts (line);
-	    drvLEUART_sync();		// to prevent UART buffer overflow
+    if (setIdx < 0)
+    {
+#if CFG_ID_INDEX
+	Log ("Config File - Line %d: ID table full, IDs will be stored into"
+	     " %s", lineNum, CFG_IDX_FILE_NAME);
+	IDIndexAdd (key, pParm);
+#else
+	Log ("Config File - Line %d: ID table full, IDs will be read from"
+	     " file", lineNum);
+#endif
+	l_flgID_TableFull = true;
+	return;
+    }
+
+    /* make room for the new entry and insert it */
+    memmove (&l_ID_Key[idx + 1], &l_ID_Key[idx],
+	     (l_ID_TableCnt - idx) * sizeof(l_ID_Key[0]));
+    memmove (&l_ID_ParmIdx[idx + 1], &l_ID_ParmIdx[idx],
+	     (l_ID_TableCnt - idx) * sizeof(l_ID_ParmIdx[0]));
+
+    l_ID_Key[idx] = key;
+    l_ID_ParmIdx[idx] = (uint8_t)setIdx;
+    l_ID_TableCnt++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the parameter set of an ID
+ *
+ * This routine returns the index of the entry of @ref l_ID_ParmSet which
+ * holds the specified parameters.  If no such set exists yet, a new one is
+ * added.  The sets are shared by the ID table and the pattern table.
+ *
+ * @param[in] pParm
+ *	Parameters of the ID.
+ *
+ * @return
+ *	Index of the parameter set, or -1 if all @ref CFG_ID_PARM_SETS sets
+ *	are in use.
+ *
+ ******************************************************************************/
+static int   IDParmSetAdd (const ID_PARM *pParm)
+{
+int	 setIdx;
+
+    /* see if this parameter set already exists */
+    for (setIdx = 0;  setIdx < l_ID_ParmSetCnt;  setIdx++)
+    {
+	if (l_ID_ParmSet[setIdx].KeepPlayback == pParm->KeepPlayback
+	&&  l_ID_ParmSet[setIdx].KeepRecord   == pParm->KeepRecord
+	&&  l_ID_ParmSet[setIdx].PlayType     == pParm->PlayType
+	&&  l_ID_ParmSet[setIdx].PlayBurst    == pParm->PlayBurst
+	&&  l_ID_ParmSet[setIdx].Volume       == pParm->Volume
+	&&  l_ID_ParmSet[setIdx].InputMode    == pParm->InputMode)
+	    return setIdx;
+    }
+
+    if (setIdx >= CFG_ID_PARM_SETS)
+	return -1;
+
+    /* add new parameter set */
+    l_ID_ParmSet[setIdx].KeepPlayback = pParm->KeepPlayback;
+    l_ID_ParmSet[setIdx].KeepRecord   = pParm->KeepRecord;
+    l_ID_ParmSet[setIdx].PlayType     = pParm->PlayType;
+    l_ID_ParmSet[setIdx].PlayBurst    = pParm->PlayBurst;
+    l_ID_ParmSet[setIdx].Volume       = pParm->Volume;
+    l_ID_ParmSet[setIdx].InputMode    = pParm->InputMode;
+    l_ID_ParmSetCnt++;
+
+    return setIdx;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Convert ID pattern string into key and mask
+ *
+ * This routine converts a transponder ID pattern into its binary key and
+ * mask.  The pattern consists of upper-case hexadecimal digits like an ID,
+ * where '?' matches any digit at this position.  A trailing '*' matches all
+ * remaining digits, e.g. "9E1CE7D0*" matches all IDs which start with these
+ * eight digits.  At least one digit must be fixed.
+ *
+ * @param[in] pStr
+ *	Pattern string, terminated by EOS.
+ *
+ * @param[out] pKey
+ *	Address where to store the fixed digits, all others are 0.
+ *
+ * @param[out] pMask
+ *	Address where to store the mask, 0xF for each fixed digit.
+ *
+ * @return
+ *	The value <i>true</i> if the string is a valid pattern, <i>false</i>
+ *	if not.
+ *
+ ******************************************************************************/
+static bool  IDPatternParse (const char *pStr, TRANSPONDER_ID *pKey,
+			     TRANSPONDER_ID *pMask)
+{
+TRANSPONDER_ID key = 0;
+TRANSPONDER_ID mask = 0;
+int	 i;
+
+    for (i = 0;  i < 16  &&  *pStr != '*';  i++, pStr++)
+    {
+	key <<= 4;
+	mask <<= 4;
+
+	if (*pStr == '?')
+	    continue;		// any digit matches
+
+	if (*pStr >= '0'  &&  *pStr <= '9')
+	    key |= (*pStr - '0');
+	else if (*pStr >= 'A'  &&  *pStr <= 'F')
+	    key |= (*pStr - 'A' + 10);
+	else
+	    return false;	// not a hex digit
+
+	mask |= 0x0F;
+    }
+
+    if (*pStr == '*')
+    {
+	if (pStr[1] != EOS  ||  i == 0)
+	    return false;	// '*' must be the last character
+
+	/* align the digits to the left, like those of an ID */
+	key  <<= 4 * (16 - i);
+	mask <<= 4 * (16 - i);
+    }
+    else if (*pStr != EOS)
+    {
+	return false;		// pattern too long
+    }
+
+    if (mask == 0)
+	return false;		// no fixed digit, use "ANY" instead
+
+    *pKey  = key;
+    *pMask = mask;
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Count the fixed digits of an ID pattern
+ *
+ * @param[in] mask
+ *	Mask of the pattern, see IDPatternParse().
+ *
+ * @return
+ *	Number of fixed hexadecimal digits.
+ *
+ ******************************************************************************/
+static int   IDPatternDigits (TRANSPONDER_ID mask)
+{
+int	 digits = 0;
+
+    for ( ;  mask != 0;  mask >>= 4)
+	if (mask & 0x0F)
+	    digits++;
+
+    return digits;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add ID pattern to the pattern table
+ *
+ * This routine inserts the specified pattern into the pattern table.  The
+ * table is sorted by the number of fixed digits in decreasing order, so the
+ * first matching entry is the longest match.  Patterns with the same number
+ * of digits keep the order of the configuration file.  The parameter sets
+ * are shared with the ID table.
+ *
+ * @param[in] lineNum
+ *	Line number, used for error messages.
+ *
+ * @param[in] key
+ *	Fixed digits of the pattern.
+ *
+ * @param[in] mask
+ *	Mask of the fixed digits.
+ *
+ * @param[in] pParm
+ *	Parameters for this pattern.
+ *
+ ******************************************************************************/
+static void  IDPatternAdd (int lineNum, TRANSPONDER_ID key, TRANSPONDER_ID mask,
+			   const ID_PARM *pParm)
+{
+int	 idx, setIdx, digits;
+
+    digits = IDPatternDigits (mask);
+
+    /* insert behind all patterns with at least as many fixed digits */
+    for (idx = 0;  idx < l_ID_PatCnt;  idx++)
+    {
+	if (l_ID_PatKey[idx] == key  &&  l_ID_PatMask[idx] == mask)
+	{
+	    LogError ("Config File - Line %d: Duplicate ID ignored", lineNum);
+	    return;
 	}
+
+	if (IDPatternDigits (l_ID_PatMask[idx]) < digits)
+	    break;
+    }
+
+    setIdx = (l_ID_PatCnt < CFG_ID_PATTERNS ? IDParmSetAdd (pParm) : -1);
+    if (setIdx < 0)
+    {
+	LogError ("Config File - Line %d: ID pattern table full, pattern"
+		  " ignored", lineNum);
+	return;
     }
+
+    /* make room for the new entry and insert it */
+    memmove (&l_ID_PatKey[idx + 1], &l_ID_PatKey[idx],
+	     (l_ID_PatCnt - idx) * sizeof(l_ID_PatKey[0]));
+    memmove (&l_ID_PatMask[idx + 1], &l_ID_PatMask[idx],
+	     (l_ID_PatCnt - idx) * sizeof(l_ID_PatMask[0]));
+    memmove (&l_ID_PatParmIdx[idx + 1], &l_ID_PatParmIdx[idx],
+	     (l_ID_PatCnt - idx) * sizeof(l_ID_PatParmIdx[0]));
+
+    l_ID_PatKey[idx]  = key;
+    l_ID_PatMask[idx] = mask;
+    l_ID_PatParmIdx[idx] = (uint8_t)setIdx;
+    l_ID_PatCnt++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Find the longest ID pattern matching a transponder ID
+ *
+ * This routine is called for IDs which are not part of the configuration
+ * themselves.  Since the pattern table is sorted by the number of fixed
+ * digits, the first match is the longest one.
+ *
+ * @param[in] id
+ *	Transponder ID to match.
+ *
+ * @return
+ *	Index of the matching entry of the pattern table, or -1 if none
+ *	matches.
+ *
+ ******************************************************************************/
+static int   IDPatternFind (TRANSPONDER_ID id)
+{
+int	 idx;
+
+    for (idx = 0;  idx < l_ID_PatCnt;  idx++)
+	if ((id & l_ID_PatMask[idx]) == l_ID_PatKey[idx])
+	    return idx;
+
+    return -1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Convert ID pattern into a string
+ *
+ * This routine generates the string representation of an entry of the
+ * pattern table, as it has been specified in the configuration file, i.e.
+ * trailing wildcards are shown as '*'.
+ *
+ * @param[in] idx
+ *	Index of the entry in the pattern table.
+ *
+ * @param[out] pBuf
+ *	Buffer for the string, must be at least @ref ID_STR_SIZE bytes.
+ *
+ * @return
+ *	Address of the string buffer, i.e. <b>pBuf</b>.
+ *
+ ******************************************************************************/
+static char *IDPatternToString (int idx, char *pBuf)
+{
+static const char HexChar[] = "0123456789ABCDEF";
+TRANSPONDER_ID key  = l_ID_PatKey[idx];
+TRANSPONDER_ID mask = l_ID_PatMask[idx];
+int	 i;
+
+    for (i = 15;  i >= 0;  i--, key >>= 4, mask >>= 4)
+	pBuf[i] = ((mask & 0x0F) ? HexChar[key & 0x0F] : '?');
+
+    /* trailing wildcards are combined to '*' */
+    for (i = 16;  pBuf[i - 1] == '?';  i--)
+	;
+
+    if (i < 16)
+	pBuf[i++] = '*';
+    pBuf[i] = EOS;
+
+    return pBuf;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Resolve the Default Values of an Action
+ *
+ * This routine replaces all parameters which are @ref DUR_INVALID, i.e. not
+ * specified for an ID, by the default values of CfgActionCompile().
+ *
+ * @param[out] pAction
+ *	Address of the resulting action record, may be the same as
+ *	<b>pParm</b>.
+ *
+ * @param[in] pParm
+ *	Parameters as specified for the ID.
+ *
+ ******************************************************************************/
+static void  CfgActionResolve (CFG_ACTION *pAction, const CFG_ACTION *pParm)
+{
+    pAction->KeepPlayback = (pParm->KeepPlayback == DUR_INVALID
+			     ? l_ActionDflt.KeepPlayback : pParm->KeepPlayback);
+    pAction->KeepRecord   = (pParm->KeepRecord == DUR_INVALID
+			     ? l_ActionDflt.KeepRecord : pParm->KeepRecord);
+    pAction->PlayType     = (pParm->PlayType == DUR_INVALID
+			     ? l_ActionDflt.PlayType : pParm->PlayType);
+    pAction->PlayBurst    = (pParm->PlayBurst == DUR_INVALID
+			     ? l_ActionDflt.PlayBurst : pParm->PlayBurst);
+    pAction->Volume       = (pParm->Volume == DUR_INVALID
+			     ? l_ActionDflt.Volume : pParm->Volume);
+    pAction->InputMode    = (pParm->InputMode == DUR_INVALID
+			     ? l_ActionDflt.InputMode : pParm->InputMode);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Find a Transponder ID which is not in the ID table
+ *
+ * This routine is called for IDs which have not been found in the ID table,
+ * when the table overflowed.  If @ref CFG_ID_INDEX is set, the Bloom filter
+ * rejects most of the unknown IDs without any access to the SD-Card, and
+ * the remaining ones are looked up in the ID index.  Otherwise, or if the
+ * index could not be generated, the configuration file is scanned.
+ *
+ * @param[in] key
+ *	Transponder ID to find.
+ *
+ * @return
+ * 	Address of @ref ID_PARM structure of the specified ID, or NULL if the
+ * 	ID could not be found.
+ *
+ ******************************************************************************/
+static ID_PARM *IDOverflowFind (TRANSPONDER_ID key)
+{
+#if CFG_ID_INDEX
+    /* the Bloom filter knows all IDs which did not fit into the ID table */
+    if (! IDBloomTest (key, false))
+	return NULL;
+
+    if (l_flgID_Index)
+	return IDIndexFind (key);
+#endif
+
+    return CfgReadFindID (CONFIG_FILE_NAME, &key);
+}
+
+
+#if CFG_ID_INDEX
+/***************************************************************************//**
+ *
+ * @brief	Test or set the Bits of an ID in the Bloom filter
+ *
+ * The 64bit key is mixed with the finalizer of MurmurHash3, its two halves
+ * are the base and the increment of @ref CFG_ID_BLOOM_HASHES bit positions
+ * (double hashing).  The IDs are often consecutive numbers, so they must be
+ * mixed before.
+ *
+ * @param[in] key
+ *	Transponder ID.
+ *
+ * @param[in] flgSet
+ *	The value <i>true</i> sets the bits of the ID.
+ *
+ * @return
+ *	The value <i>true</i> if all bits had already been set, i.e. the ID
+ *	may be part of the index, <i>false</i> if it is definitely not.
+ *
+ ******************************************************************************/
+static bool  IDBloomTest (TRANSPONDER_ID key, bool flgSet)
+{
+uint32_t h1, h2, bit;
+bool	 flgFound = true;
+int	 i;
+
+    key ^= key >> 33;
+    key *= 0xFF51AFD7ED558CCDULL;
+    key ^= key >> 33;
+    key *= 0xC4CEB9FE1A85EC53ULL;
+    key ^= key >> 33;
+
+    h1 = (uint32_t)key;
+    h2 = (uint32_t)(key >> 32) | 1;
+
+    for (i = 0;  i < CFG_ID_BLOOM_HASHES;  i++)
+    {
+	bit = (h1 + i * h2) & (CFG_ID_BLOOM_BITS - 1);
+
+	if ((l_ID_Bloom[bit >> 3] & (1 << (bit & 7))) == 0)
+	    flgFound = false;
+
+	if (flgSet)
+	    l_ID_Bloom[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+    }
+
+    return flgFound;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add an ID to the ID index
+ *
+ * This routine is called by IDTableAdd() while the configuration file is
+ * parsed, for each ID which does not fit into the ID table.  The ID is
+ * added to the Bloom filter, and its record is appended to the scratch file
+ * @ref CFG_IDX_TMP_FILE_NAME, which is sorted by IDIndexBuild() afterwards.
+ *
+ * @param[in] key
+ *	Transponder ID.
+ *
+ * @param[in] pParm
+ *	Parameters for this ID.
+ *
+ ******************************************************************************/
+static void  IDIndexAdd (TRANSPONDER_ID key, const ID_PARM *pParm)
+{
+CFG_IDX_REC rec;
+UINT	 cnt;
+
+    IDBloomTest (key, true);
+
+    if (l_flgID_IndexErr)
+	return;			// IDs will be read from the text file
+
+    if (l_IdxHdr.RecCnt == 0)
+    {
+	l_pFhIdx = LogFileHandleGet();
+	if (l_pFhIdx == NULL
+	||  f_open (l_pFhIdx, CFG_IDX_TMP_FILE_NAME, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+	{
+	    LogError ("%s: FILE OPEN failed", CFG_IDX_TMP_FILE_NAME);
+	    if (l_pFhIdx != NULL)
+	    {
+		l_pFhIdx->fs = NULL;	// invalidate file handle
+		LogFileHandlePut (l_pFhIdx);
+		l_pFhIdx = NULL;
+	    }
+	    l_flgID_IndexErr = true;
+	    return;
+	}
+    }
+
+    memset (&rec, 0, sizeof(rec));
+    rec.ID = key;
+    rec.KeepPlayback = pParm->KeepPlayback;
+    rec.KeepRecord   = pParm->KeepRecord;
+    rec.PlayType     = pParm->PlayType;
+    rec.PlayBurst    = pParm->PlayBurst;
+    rec.Volume       = pParm->Volume;
+    rec.InputMode    = pParm->InputMode;
+
+    if (f_write (l_pFhIdx, &rec, sizeof(rec), &cnt) != FR_OK
+    ||  cnt != sizeof(rec))
+    {
+	LogError ("%s: FILE WRITE failed", CFG_IDX_TMP_FILE_NAME);
+	l_flgID_IndexErr = true;
+	return;
+    }
+
+    l_IdxHdr.RecCnt++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Build the ID index
+ *
+ * This routine is called after the configuration file has been parsed, the
+ * SD-Card must still be powered.  It sorts the records of the scratch file
+ * into the index file @ref CFG_IDX_FILE_NAME, then the scratch file is
+ * deleted.
+ *
+ * The RAM only holds one sector of records, so each pass over the scratch
+ * file selects the next smallest IDs and writes them as one sector of the
+ * index.  The number of sector reads grows with the square of the number of
+ * sectors, but this is only done when the configuration file has changed,
+ * since the binary configuration image refers to the index afterwards.
+ * For IDs which are specified more than once, the first entry is used.
+ *
+ * @param[in] filename
+ *	Name of the text configuration file the index is generated from.
+ *
+ ******************************************************************************/
+static void  IDIndexBuild (char *filename)
+{
+CFG_IDX_REC buf[CFG_IDX_RECS_PER_SECT];	// next records of the index
+CFG_IDX_REC rec;
+TRANSPONDER_ID last = 0;	// last ID written to the index
+FILINFO	 fno;
+uint32_t recCnt, outCnt, sectCnt, sect, i;
+uint32_t crc;
+UINT	 cnt, n, k;
+bool	 flgOK = false;
+
+
+    if (l_IdxHdr.RecCnt == 0  &&  ! l_flgID_IndexErr)
+	return;			// all IDs fit into the ID table
+
+    if (l_pFhIdx != NULL  &&  l_pFhIdx->fs != NULL)
+	f_close (l_pFhIdx);
+
+    recCnt  = l_IdxHdr.RecCnt;
+    outCnt  = 0;
+    sectCnt = (recCnt + CFG_IDX_RECS_PER_SECT - 1) / CFG_IDX_RECS_PER_SECT;
+
+    do
+    {
+	if (l_flgID_IndexErr  ||  l_pFhIdx == NULL)
+	    break;
+
+	/* identify the text file, see IDIndexLoad() */
+	if (f_stat (filename, &fno) != FR_OK
+	||  ! CfgFileCRC (filename, &crc))
+	    break;
+
+	memset (&l_IdxHdr, 0, sizeof(l_IdxHdr));
+	l_IdxHdr.Magic     = CFG_IDX_MAGIC;
+	l_IdxHdr.Version   = CFG_IDX_VERSION;
+	l_IdxHdr.HdrSize   = sizeof(l_IdxHdr);
+	l_IdxHdr.SrcSize   = fno.fsize;
+	l_IdxHdr.SrcCRC    = crc;
+	l_IdxHdr.RecSize   = sizeof(CFG_IDX_REC);
+	l_IdxHdr.BloomBits = CFG_ID_BLOOM_BITS;
+	l_IdxHdr.FenceStep = (sectCnt + CFG_ID_INDEX_FENCES - 1)
+			     / CFG_ID_INDEX_FENCES;
+	l_IdxHdr.DataOffs  = (sizeof(l_IdxHdr) + sizeof(l_ID_Bloom)
+			      + sizeof(l_ID_Fence) + CFG_IDX_SECT_SIZE - 1)
+			     & ~(CFG_IDX_SECT_SIZE - 1);
+
+	if (f_open (l_pFhIdx, CFG_IDX_TMP_FILE_NAME, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+	{
+	    l_pFhIdx->fs = NULL;	// invalidate file handle
+	    break;
+	}
+	if (f_open (&l_fh, CFG_IDX_FILE_NAME, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+	{
+	    l_fh.fs = NULL;	// invalidate file handle
+	    break;
+	}
+
+	for (sect = 0;  sect < sectCnt;  sect++)
+	{
+	    /* select the smallest IDs above the last one written */
+	    if (f_lseek (l_pFhIdx, 0) != FR_OK)
+		break;
+
+	    for (i = n = 0;  i < recCnt;  i++)
+	    {
+		if (f_read (l_pFhIdx, &rec, sizeof(rec), &cnt) != FR_OK
+		||  cnt != sizeof(rec))
+		    break;
+
+		if (outCnt > 0  &&  rec.ID <= last)
+		    continue;		// already written
+
+		if (n == CFG_IDX_RECS_PER_SECT  &&  rec.ID > buf[n - 1].ID)
+		    continue;		// not within the next sector
+
+		/* insert in order, the first of equal IDs is kept */
+		for (k = n;  k > 0  &&  buf[k - 1].ID > rec.ID;  k--)
+		    ;
+		if (k > 0  &&  buf[k - 1].ID == rec.ID)
+		    continue;
+
+		if (n < CFG_IDX_RECS_PER_SECT)
+		    n++;
+		memmove (&buf[k + 1], &buf[k], (n - 1 - k) * sizeof(buf[0]));
+		buf[k] = rec;
+	    }
+	    if (i < recCnt)
+		break;			// read error
+
+	    if (n == 0)
+	    {
+		flgOK = true;
+		break;			// remaining records were duplicates
+	    }
+
+	    /* write them as the next sector of the index */
+	    if (sect % l_IdxHdr.FenceStep == 0)
+		l_ID_Fence[sect / l_IdxHdr.FenceStep] = buf[0].ID;
+
+	    if (f_lseek (&l_fh, l_IdxHdr.DataOffs + sect * CFG_IDX_SECT_SIZE) != FR_OK
+	    ||  f_write (&l_fh, buf, n * sizeof(buf[0]), &cnt) != FR_OK
+	    ||  cnt != n * sizeof(buf[0]))
+		break;
+
+	    last = buf[n - 1].ID;
+	    outCnt += n;
+	}
+	if (sect == sectCnt)
+	    flgOK = true;
+
+	if (! flgOK)
+	    break;
+
+	/* header, Bloom filter, and fence keys are written at last */
+	flgOK = false;
+	l_IdxHdr.RecCnt   = outCnt;
+	l_IdxHdr.FenceCnt = (sect + l_IdxHdr.FenceStep - 1) / l_IdxHdr.FenceStep;
+	l_IdxHdr.CRC = CfgCRC32 (0, l_ID_Bloom, sizeof(l_ID_Bloom));
+	l_IdxHdr.CRC = CfgCRC32 (l_IdxHdr.CRC, l_ID_Fence,
+				 l_IdxHdr.FenceCnt * sizeof(l_ID_Fence[0]));
+
+	if (f_lseek (&l_fh, 0) != FR_OK
+	||  f_write (&l_fh, &l_IdxHdr, sizeof(l_IdxHdr), &cnt) != FR_OK
+	||  cnt != sizeof(l_IdxHdr)
+	||  f_write (&l_fh, l_ID_Bloom, sizeof(l_ID_Bloom), &cnt) != FR_OK
+	||  cnt != sizeof(l_ID_Bloom)
+	||  f_write (&l_fh, l_ID_Fence, l_IdxHdr.FenceCnt * sizeof(l_ID_Fence[0]), &cnt) != FR_OK
+	||  cnt != l_IdxHdr.FenceCnt * sizeof(l_ID_Fence[0]))
+	    break;
+
+	flgOK = true;
+
+    } while (0);
+
+    if (l_fh.fs != NULL)
+	f_close (&l_fh);
+    if (l_pFhIdx != NULL)
+    {
+	if (l_pFhIdx->fs != NULL)
+	    f_close (l_pFhIdx);
+	LogFileHandlePut (l_pFhIdx);
+	l_pFhIdx = NULL;
+    }
+    f_unlink (CFG_IDX_TMP_FILE_NAME);
+
+    if (flgOK)
+    {
+	Log ("Generated %s with %ld IDs", CFG_IDX_FILE_NAME, (long)outCnt);
+	if (outCnt < recCnt)
+	    LogError ("%s: %ld duplicate IDs ignored", CFG_IDX_FILE_NAME,
+		      (long)(recCnt - outCnt));
+	l_flgID_Index = true;
+    }
+    else
+    {
+	LogError ("%s: FILE WRITE failed, IDs will be read from file",
+		  CFG_IDX_FILE_NAME);
+	f_unlink (CFG_IDX_FILE_NAME);	// do not keep an incomplete index
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Load the ID index
+ *
+ * This routine is called by CfgBinLoad() if the ID table of the binary
+ * configuration image overflowed.  It verifies that the index has been
+ * generated from the same text file, and loads the Bloom filter and the
+ * fence keys.  The SD-Card must be powered.
+ *
+ * @param[in] srcSize
+ *	Size of the text configuration file.
+ *
+ * @param[in] srcCRC
+ *	CRC-32 of the text configuration file.
+ *
+ * @return
+ *	The value <i>true</i> if the index is valid.
+ *
+ ******************************************************************************/
+static bool  IDIndexLoad (uint32_t srcSize, uint32_t srcCRC)
+{
+CFG_IDX_HDR hdr;
+uint32_t crc;
+UINT	 size, cnt;
+bool	 flgOK = false;
+
+    if (f_open (&l_fh, CFG_IDX_FILE_NAME, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+    {
+	l_fh.fs = NULL;		// invalidate file handle
+	return false;
+    }
+
+    do
+    {
+	if (f_read (&l_fh, &hdr, sizeof(hdr), &cnt) != FR_OK
+	||  cnt != sizeof(hdr))
+	    break;
+
+	if (hdr.Magic != CFG_IDX_MAGIC  ||  hdr.Version != CFG_IDX_VERSION
+	||  hdr.HdrSize != sizeof(hdr)
+	||  hdr.SrcSize != srcSize  ||  hdr.SrcCRC != srcCRC
+	||  hdr.RecSize != sizeof(CFG_IDX_REC)
+	||  hdr.BloomBits != CFG_ID_BLOOM_BITS
+	||  hdr.FenceCnt == 0  ||  hdr.FenceCnt > CFG_ID_INDEX_FENCES
+	||  hdr.FenceStep == 0)
+	    break;
+
+	size = hdr.FenceCnt * sizeof(l_ID_Fence[0]);
+	if (f_read (&l_fh, l_ID_Bloom, sizeof(l_ID_Bloom), &cnt) != FR_OK
+	||  cnt != sizeof(l_ID_Bloom)
+	||  f_read (&l_fh, l_ID_Fence, size, &cnt) != FR_OK
+	||  cnt != size)
+	    break;
+
+	crc = CfgCRC32 (0, l_ID_Bloom, sizeof(l_ID_Bloom));
+	crc = CfgCRC32 (crc, l_ID_Fence, size);
+	if (crc != hdr.CRC)
+	{
+	    LogError ("%s: CRC Error", CFG_IDX_FILE_NAME);
+	    break;
+	}
+
+	flgOK = true;
+
+    } while (0);
+
+    f_close(&l_fh);
+
+    if (! flgOK)
+	return false;
+
+    l_IdxHdr = hdr;
+    l_flgID_Index = true;
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Find the Records of an ID in the ID index
+ *
+ * The fence keys in RAM tell which sectors may contain the ID.  This routine
+ * determines the range of records behind the last fence key which is not
+ * above the ID.
+ *
+ * @param[in] key
+ *	Transponder ID to find.
+ *
+ * @param[out] pLo
+ *	First record of the range.
+ *
+ * @param[out] pHi
+ *	Record behind the range.
+ *
+ * @return
+ * 	false if the ID is below the first ID of the index.
+ *
+ ******************************************************************************/
+static bool  IDIndexRange (TRANSPONDER_ID key, uint32_t *pLo, uint32_t *pHi)
+{
+uint32_t lo, hi, mid, perFence;
+
+    /* find the last fence key which is not above the ID */
+    lo = 0;
+    hi = l_IdxHdr.FenceCnt;
+    while (lo < hi)
+    {
+	mid = (lo + hi) / 2;
+	if (l_ID_Fence[mid] <= key)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+    if (lo == 0)
+	return false;		// below the first ID of the index
+
+    /* range of records behind this fence key */
+    perFence = l_IdxHdr.FenceStep * CFG_IDX_RECS_PER_SECT;
+    lo = (lo - 1) * perFence;
+    hi = lo + perFence;
+    if (hi > l_IdxHdr.RecCnt)
+	hi = l_IdxHdr.RecCnt;
+
+    *pLo = lo;
+    *pHi = hi;
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read the Record of an ID from the ID index
+ *
+ * This routine does a binary search for the ID over the specified range of
+ * records, see IDIndexRange().  FatFs keeps the last sector in the buffer
+ * of the file handle, so a hit costs only one sector read, as long as
+ * @ref CFG_ID_INDEX_FENCES covers all sectors.  The SD-Card must have been
+ * powered on by the caller.
+ *
+ * @param[in] key
+ *	Transponder ID to find.
+ *
+ * @param[in] lo
+ *	First record of the range.
+ *
+ * @param[in] hi
+ *	Record behind the range.
+ *
+ * @param[out] pRec
+ *	Record of the ID, only valid if it has been found.
+ *
+ * @return
+ * 	1 if the ID has been found, 0 if not, or -1 if the index file could
+ * 	not be read.
+ *
+ ******************************************************************************/
+static int   IDIndexRead (TRANSPONDER_ID key, uint32_t lo, uint32_t hi,
+			  CFG_IDX_REC *pRec)
+{
+uint32_t mid;
+UINT	 cnt;
+int	 res = 0;
+
+    if (f_open (&l_fh, CFG_IDX_FILE_NAME, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+    {
+	LogError ("%s: FILE OPEN failed", CFG_IDX_FILE_NAME);
+	l_fh.fs = NULL;		// invalidate file handle
+	return -1;
+    }
+
+    while (lo < hi)
+    {
+	mid = (lo + hi) / 2;
+
+	if (f_lseek (&l_fh, l_IdxHdr.DataOffs
+			    + (mid / CFG_IDX_RECS_PER_SECT) * CFG_IDX_SECT_SIZE
+			    + (mid % CFG_IDX_RECS_PER_SECT) * sizeof(*pRec)) != FR_OK
+	||  f_read (&l_fh, pRec, sizeof(*pRec), &cnt) != FR_OK
+	||  cnt != sizeof(*pRec))
+	{
+	    LogError ("%s: FILE READ failed", CFG_IDX_FILE_NAME);
+	    res = -1;
+	    break;
+	}
+
+	if (pRec->ID == key)
+	{
+	    res = 1;
+	    break;
+	}
+
+	if (pRec->ID < key)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    f_close(&l_fh);
+
+    return res;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Find an ID in the ID index
+ *
+ * This routine reads the record of the ID from the index file, see
+ * IDIndexRange() and IDIndexRead(), and converts it into an @ref ID_PARM
+ * structure.  If the sectors have been loaded by CfgPrefetchIDs() when the
+ * visit started, they are taken from the sector cache.
+ *
+ * @param[in] key
+ *	Transponder ID to find.
+ *
+ * @return
+ * 	Address of @ref ID_PARM structure of the specified ID, or NULL if the
+ * 	ID is not part of the index.
+ *
+ ******************************************************************************/
+static ID_PARM *IDIndexFind (TRANSPONDER_ID key)
+{
+CFG_IDX_REC rec;
+uint32_t lo, hi;
+int	 res;
+
+    if (! IDIndexRange (key, &lo, &hi))
+	return NULL;		// below the first ID of the index
+
+    /* Be sure to flush current log buffer so it is empty */
+    LogFlush(true);	// keep SD-Card power on!
+
+    res = IDIndexRead (key, lo, hi, &rec);
+
+    /* Power off the SD-Card Interface */
+    MICROSD_PowerOff();
+
+    if (res <= 0)
+	return NULL;
+
+    l_ID_Found.pNext = NULL;
+    l_ID_Found.ID = key;
+    l_ID_Found.KeepPlayback = rec.KeepPlayback;
+    l_ID_Found.KeepRecord   = rec.KeepRecord;
+    l_ID_Found.PlayType     = rec.PlayType;
+    l_ID_Found.PlayBurst    = rec.PlayBurst;
+    l_ID_Found.Volume       = rec.Volume;
+    l_ID_Found.InputMode    = rec.InputMode;
+
+    return &l_ID_Found;
+}
+#endif	// CFG_ID_INDEX
+
+#if CFG_BIN_IMAGE
+/***************************************************************************//**
+ *
+ * @brief	Load binary configuration image
+ *
+ * This routine loads the binary configuration image @ref CFG_BIN_FILE_NAME.
+ * The image is only used if it matches the size and modification time of the
+ * text configuration file, and the CRC is valid.  If only the modification
+ * time differs, the CRC-32 of the text file is compared instead, so an image
+ * which has been generated on a host can be used, see sim_cfgc.c.
+ *
+ * @param[in] filename
+ *	Name of the text configuration file the image must belong to.
+ *
+ * @return
+ *	The value <i>true</i> if the configuration has been loaded from the
+ *	image, <i>false</i> if the text file must be parsed.
+ *
+ ******************************************************************************/
+static bool  CfgBinLoad (char *filename)
+{
+CFG_BIN_HDR	hdr;
+CFG_BIN_SPECIAL	special;
+FILINFO	 fno;
+int32_t	 var[CFG_BIN_MAX_VARS];
+uint32_t crc = 0;
+ID_PARM	*pNewID;
+bool	 flgOK = false;
+int	 i;
+
+
+    /* Be sure to flush current log buffer so it is empty */
+    LogFlush(true);	// keep SD-Card power on!
+
+    /* Get size and modification time of the text file */
+    if (f_stat (filename, &fno) != FR_OK)
+    {
+	MICROSD_PowerOff();
+	return false;
+    }
+
+    /* Open the image, it is not an error if it does not exist */
+    if (f_open (&l_fh, CFG_BIN_FILE_NAME, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+    {
+	l_fh.fs = NULL;		// invalidate file handle
+	MICROSD_PowerOff();
+	return false;
+    }
+
+    /* Discard previous configuration data */
+    CfgDataClear();
+
+    do
+    {
+	/* read and verify header */
+	if (! CfgBinRead (&hdr, sizeof(hdr), NULL))
+	    break;
+
+	if (hdr.Magic != CFG_BIN_MAGIC  ||  hdr.Version != CFG_BIN_VERSION
+	||  hdr.HdrSize != sizeof(hdr)
+	||  hdr.SrcSize != fno.fsize
+	||  hdr.VarListCRC != CfgVarListCRC()
+	||  hdr.VarCnt > CFG_BIN_MAX_VARS
+	||  hdr.ID_TableSize != CFG_ID_TABLE_SIZE
+	||  hdr.ID_TableCnt > CFG_ID_TABLE_SIZE
+	||  hdr.ParmSetCnt > CFG_ID_PARM_SETS
+	||  hdr.PatternCnt > CFG_ID_PATTERNS)
+	{
+	    Log ("%s is outdated", CFG_BIN_FILE_NAME);
+	    break;
+	}
+
+	/* the sections of another box have been read */
+	if (hdr.BoxID != 0  &&  hdr.BoxID != CfgBoxID())
+	{
+	    Log ("%s belongs to another box", CFG_BIN_FILE_NAME);
+	    break;
+	}
+
+	/* another time stamp, the content of the text file must match */
+	if (hdr.SrcDateTime != (((uint32_t)fno.fdate << 16) | fno.ftime))
+	{
+	    f_close(&l_fh);
+
+	    if (! CfgFileCRC (filename, &crc)  ||  crc != hdr.SrcCRC)
+	    {
+		Log ("%s is outdated", CFG_BIN_FILE_NAME);
+		break;
+	    }
+
+	    /* re-open the image and continue after the header */
+	    if (f_open (&l_fh, CFG_BIN_FILE_NAME, FA_READ | FA_OPEN_EXISTING) != FR_OK
+	    ||  f_lseek (&l_fh, sizeof(hdr)) != FR_OK)
+		break;
+
+	    crc = 0;
+	}
+
+	/* read all sections directly into their final location */
+	if (! CfgBinRead (var, hdr.VarCnt * sizeof(var[0]), &crc))
+	    break;
+
+	for (i = 0;  i < hdr.SpecialCnt;  i++)
+	{
+	    if (! CfgBinRead (&special, sizeof(special), &crc))
+		break;
+
+	    pNewID = CfgArenaAlloc(sizeof(ID_PARM));
+	    if (pNewID == NULL)
+		break;
+
+	    pNewID->pNext = NULL;
+	    pNewID->ID = special.ID;
+	    pNewID->KeepPlayback = special.KeepPlayback;
+	    pNewID->KeepRecord   = special.KeepRecord;
+	    pNewID->PlayType     = special.PlayType;
+	    pNewID->PlayBurst    = special.PlayBurst;
+	    pNewID->Volume       = special.Volume;
+	    pNewID->InputMode    = special.InputMode;
+
+	    if (l_pLastID)
+		l_pLastID->pNext = pNewID;
+	    else
+		l_pFirstID = pNewID;
+	    l_pLastID = pNewID;
+	}
+	if (i < hdr.SpecialCnt)
+	    break;
+
+	if (! CfgBinRead (l_ID_ParmSet, hdr.ParmSetCnt * sizeof(l_ID_ParmSet[0]), &crc)
+	||  ! CfgBinRead (l_ID_Key, hdr.ID_TableCnt * sizeof(l_ID_Key[0]), &crc)
+	||  ! CfgBinRead (l_ID_ParmIdx, hdr.ID_TableCnt * sizeof(l_ID_ParmIdx[0]), &crc)
+	||  ! CfgBinRead (l_ID_PatKey, hdr.PatternCnt * sizeof(l_ID_PatKey[0]), &crc)
+	||  ! CfgBinRead (l_ID_PatMask, hdr.PatternCnt * sizeof(l_ID_PatMask[0]), &crc)
+	||  ! CfgBinRead (l_ID_PatParmIdx, hdr.PatternCnt * sizeof(l_ID_PatParmIdx[0]), &crc)
+	||  ! CfgBinLists (false, &crc))
+	    break;
+
+	if (crc != hdr.CRC)
+	{
+	    LogError ("%s: CRC Error", CFG_BIN_FILE_NAME);
+	    break;
+	}
+
+	flgOK = true;
+
+    } while (0);
+
+    /* close file after reading data */
+    f_close(&l_fh);
+
+#if CFG_ID_INDEX
+    /* IDs which did not fit into the ID table must be in the index */
+    if (flgOK  &&  hdr.ID_TableFull  &&  ! IDIndexLoad (hdr.SrcSize, hdr.SrcCRC))
+    {
+	Log ("%s is outdated", CFG_IDX_FILE_NAME);
+	flgOK = false;
+    }
+#endif
+
+    /* Power off the SD-Card Interface */
+    MICROSD_PowerOff();
+
+    if (! flgOK)
+    {
+	CfgDataClear();		// discard partially loaded data
+	return false;
+    }
+
+    /* image is valid - store variables */
+    l_ID_TableCnt   = hdr.ID_TableCnt;
+    l_ID_ParmSetCnt = hdr.ParmSetCnt;
+    l_flgID_TableFull = hdr.ID_TableFull;
+    l_ID_PatCnt = hdr.PatternCnt;
+    l_ID_Cnt = hdr.ID_Cnt;
+    l_flgBoxSections = (hdr.BoxID != 0);
+
+    for (i = 0;  i < hdr.VarCnt;  i++)
+	CfgVarSet (i, var[i]);
+
+    l_flgDataLoaded = true;
+    l_CfgSrcSize = fno.fsize;
+    l_CfgSrcDateTime = ((uint32_t)fno.fdate << 16) | fno.ftime;
+
+    Log ("Configuration loaded from %s", CFG_BIN_FILE_NAME);
+
+#if CONFIG_DATA_SHOW
+    /* show a list of all IDs and settings (will not be logged) */
+    CfgDataShow();
+#endif
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Save binary configuration image
+ *
+ * This routine writes the current configuration data into the binary image
+ * @ref CFG_BIN_FILE_NAME, so it can be loaded by CfgBinLoad() next time.
+ *
+ * @param[in] filename
+ *	Name of the text configuration file the image has been generated from.
+ *
+ ******************************************************************************/
+static void  CfgBinSave (char *filename)
+{
+CFG_BIN_HDR	hdr;
+CFG_BIN_SPECIAL	special;
+FILINFO	 fno;
+int32_t	 var[CFG_BIN_MAX_VARS];
+uint32_t crc = 0;
+ID_PARM	*pID;
+UINT	 cnt;
+bool	 flgOK = false;
+int	 i;
+
+
+    /* build header */
+    memset (&hdr, 0, sizeof(hdr));
+    hdr.Magic   = CFG_BIN_MAGIC;
+    hdr.Version = CFG_BIN_VERSION;
+    hdr.HdrSize = sizeof(hdr);
+    hdr.VarListCRC = CfgVarListCRC();
+    hdr.ID_Cnt  = l_ID_Cnt;
+    hdr.ID_TableCnt  = l_ID_TableCnt;
+    hdr.ID_TableSize = CFG_ID_TABLE_SIZE;
+    hdr.ParmSetCnt   = l_ID_ParmSetCnt;
+    hdr.ID_TableFull = l_flgID_TableFull;
+    hdr.PatternCnt   = l_ID_PatCnt;
+    hdr.BoxID = (l_flgBoxSections ? CfgBoxID() : 0);
+
+    for (i = 0;  l_pCfgVarList[i].name != NULL;  i++)
+    {
+	if (i >= CFG_BIN_MAX_VARS)
+	{
+	    LogError ("%s: Too many variables", CFG_BIN_FILE_NAME);
+	    return;
+	}
+	var[i] = CfgVarGet (i);
+    }
+    hdr.VarCnt = i;
+
+    for (pID = l_pFirstID;  pID != NULL;  pID = pID->pNext)
+	hdr.SpecialCnt++;
+
+    /* Switch the SD-Card Interface on again */
+    MICROSD_PowerOn();
+
+    if (disk_initialize(0) != 0)
+    {
+	MICROSD_PowerOff();
+	return;
+    }
+
+    if (f_stat (filename, &fno) != FR_OK)
+    {
+	MICROSD_PowerOff();
+	return;
+    }
+    hdr.SrcSize = fno.fsize;
+    hdr.SrcDateTime = ((uint32_t)fno.fdate << 16) | fno.ftime;
+
+    if (! CfgFileCRC (filename, &hdr.SrcCRC))
+    {
+	MICROSD_PowerOff();
+	return;
+    }
+
+    if (f_open (&l_fh, CFG_BIN_FILE_NAME, FA_WRITE | FA_CREATE_ALWAYS) != FR_OK)
+    {
+	LogError ("%s: FILE OPEN failed", CFG_BIN_FILE_NAME);
+	l_fh.fs = NULL;		// invalidate file handle
+	MICROSD_PowerOff();
+	return;
+    }
+
+    do
+    {
+	/* header is written again when the CRC is known */
+	if (! CfgBinWrite (&hdr, sizeof(hdr), NULL)
+	||  ! CfgBinWrite (var, hdr.VarCnt * sizeof(var[0]), &crc))
+	    break;
+
+	for (pID = l_pFirstID;  pID != NULL;  pID = pID->pNext)
+	{
+	    memset (&special, 0, sizeof(special));
+	    special.ID = pID->ID;
+	    special.KeepPlayback = pID->KeepPlayback;
+	    special.KeepRecord   = pID->KeepRecord;
+	    special.PlayType     = pID->PlayType;
+	    special.PlayBurst    = pID->PlayBurst;
+	    special.Volume       = pID->Volume;
+	    special.InputMode    = pID->InputMode;
+
+	    if (! CfgBinWrite (&special, sizeof(special), &crc))
+		break;
+	}
+	if (pID != NULL)
+	    break;
+
+	if (! CfgBinWrite (l_ID_ParmSet, hdr.ParmSetCnt * sizeof(l_ID_ParmSet[0]), &crc)
+	||  ! CfgBinWrite (l_ID_Key, hdr.ID_TableCnt * sizeof(l_ID_Key[0]), &crc)
+	||  ! CfgBinWrite (l_ID_ParmIdx, hdr.ID_TableCnt * sizeof(l_ID_ParmIdx[0]), &crc)
+	||  ! CfgBinWrite (l_ID_PatKey, hdr.PatternCnt * sizeof(l_ID_PatKey[0]), &crc)
+	||  ! CfgBinWrite (l_ID_PatMask, hdr.PatternCnt * sizeof(l_ID_PatMask[0]), &crc)
+	||  ! CfgBinWrite (l_ID_PatParmIdx, hdr.PatternCnt * sizeof(l_ID_PatParmIdx[0]), &crc)
+	||  ! CfgBinLists (true, &crc))
+	    break;
+
+	hdr.CRC = crc;
+
+	if (f_lseek (&l_fh, 0) != FR_OK
+	||  f_write (&l_fh, &hdr, sizeof(hdr), &cnt) != FR_OK
+	||  cnt != sizeof(hdr))
+	    break;
+
+	flgOK = true;
+
+    } while (0);
+
+    f_close(&l_fh);
+
+    if (flgOK)
+    {
+	Log ("Generated %s", CFG_BIN_FILE_NAME);
+    }
+    else
+    {
+	LogError ("%s: FILE WRITE failed", CFG_BIN_FILE_NAME);
+	f_unlink (CFG_BIN_FILE_NAME);	// do not keep an incomplete image
+    }
+
+    /* Power off the SD-Card Interface */
+    MICROSD_PowerOff();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Calculate CRC of the text configuration file
+ *
+ * This routine reads the complete text file and calculates its CRC-32, see
+ * CfgCRC32().  It uses the file handle @ref l_fh, which must not be open.
+ *
+ * @param[in] filename
+ *	Name of the text configuration file.
+ *
+ * @param[out] pCRC
+ *	Address to store the CRC.
+ *
+ * @return
+ *	The value <i>true</i> if the file could be read.
+ *
+ ******************************************************************************/
+static bool  CfgFileCRC (char *filename, uint32_t *pCRC)
+{
+uint8_t	 buf[64];
+uint32_t crc = 0;
+FRESULT	 res;
+UINT	 cnt;
+
+    if (f_open (&l_fh, filename, FA_READ | FA_OPEN_EXISTING) != FR_OK)
+    {
+	l_fh.fs = NULL;		// invalidate file handle
+	return false;
+    }
+
+    do
+    {
+	res = f_read (&l_fh, buf, sizeof(buf), &cnt);
+	crc = CfgCRC32 (crc, buf, cnt);
+    } while (res == FR_OK  &&  cnt == sizeof(buf));
+
+    f_close(&l_fh);
+
+    *pCRC = crc;
+    return (res == FR_OK);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read or write the lists of the binary image
+ *
+ * This routine transfers the @ref CFG_LIST of all variables of type
+ * @ref CFG_VAR_TYPE_LIST, in the order of the list of configuration
+ * variables.
+ *
+ * @param[in] flgWrite
+ *	The value <i>true</i> writes the lists, <i>false</i> reads them.
+ *
+ * @param[in,out] pCRC
+ *	Address of the CRC to update.
+ *
+ * @return
+ *	The value <i>true</i> if all lists could be transferred.
+ *
+ ******************************************************************************/
+static bool  CfgBinLists (bool flgWrite, uint32_t *pCRC)
+{
+CFG_LIST *pList;
+int	 i;
+
+    for (i = 0;  l_pCfgVarList[i].name != NULL;  i++)
+    {
+	if (l_pCfgVarList[i].type != CFG_VAR_TYPE_LIST)
+	    continue;
+
+	pList = (CFG_LIST *)l_pCfgVarList[i].pData;
+	if (flgWrite ? ! CfgBinWrite (pList, sizeof(CFG_LIST), pCRC)
+		     : ! CfgBinRead (pList, sizeof(CFG_LIST), pCRC))
+	    return false;
+
+	if (pList->Cnt > CFG_LIST_SIZE)
+	    return false;
+    }
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read section of the binary image
+ *
+ * This routine reads the specified number of bytes from the binary image and
+ * updates the CRC.
+ *
+ * @param[out] pBuf
+ *	Buffer to store the data.
+ *
+ * @param[in] size
+ *	Number of bytes to read.
+ *
+ * @param[in,out] pCRC
+ *	Address of the CRC to update, or NULL.
+ *
+ * @return
+ *	The value <i>true</i> if all data could be read, <i>false</i> if not.
+ *
+ ******************************************************************************/
+static bool  CfgBinRead (void *pBuf, UINT size, uint32_t *pCRC)
+{
+FRESULT	 res;
+UINT	 cnt = 0;
+
+    if (size == 0)
+	return true;
+
+    res = f_read (&l_fh, pBuf, size, &cnt);
+    if (res != FR_OK)
+    {
+	LogError ("%s: FILE READ - Error Code %d", CFG_BIN_FILE_NAME, res);
+	return false;
+    }
+    if (cnt != size)
+    {
+	LogError ("%s: Unexpected end of file", CFG_BIN_FILE_NAME);
+	return false;
+    }
+
+    if (pCRC != NULL)
+	*pCRC = CfgCRC32 (*pCRC, pBuf, size);
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write section of the binary image
+ *
+ * This routine writes the specified number of bytes to the binary image and
+ * updates the CRC.
+ *
+ * @param[in] pBuf
+ *	Data to write.
+ *
+ * @param[in] size
+ *	Number of bytes to write.
+ *
+ * @param[in,out] pCRC
+ *	Address of the CRC to update, or NULL.
+ *
+ * @return
+ *	The value <i>true</i> if all data could be written, <i>false</i> if not.
+ *
+ ******************************************************************************/
+static bool  CfgBinWrite (const void *pBuf, UINT size, uint32_t *pCRC)
+{
+UINT	 cnt = 0;
+
+    if (size == 0)
+	return true;
+
+    if (f_write (&l_fh, pBuf, size, &cnt) != FR_OK  ||  cnt != size)
+	return false;
+
+    if (pCRC != NULL)
+	*pCRC = CfgCRC32 (*pCRC, pBuf, size);
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get value of a configuration variable
+ *
+ * This routine returns the value of the specified configuration variable
+ * as 32bit integer for the binary image.  Alarm times are returned in MEZ,
+ * i.e. as specified in the configuration file, and encoded as
+ * <i>(hour << 8) | minute</i>, or as -1 if the alarm is disabled.
+ *
+ * @param[in] varIdx
+ *	Index of the variable within the list of configuration variables.
+ *
+ * @return
+ *	Value of the variable.
+ *
+ ******************************************************************************/
+static int32_t CfgVarGet (int varIdx)
+{
+int8_t	 hour, minute;
+
+    switch (l_pCfgVarList[varIdx].type)
+    {
+	case CFG_VAR_TYPE_TIME:
+	    if (! AlarmIsEnabled (ALARM_ON_TIME_1 + varIdx))
+		return -1;
+
+	    AlarmGet (ALARM_ON_TIME_1 + varIdx, &hour, &minute);
+
+	    /* alarm has been adjusted for MESZ - store time in MEZ */
+	    if (g_isdst)
+		hour = (hour == 0 ? 23 : hour - 1);
+
+	    return ((int32_t)hour << 8) | minute;
+
+	case CFG_VAR_TYPE_DURATION:
+	case CFG_VAR_TYPE_INTEGER:
+	case CFG_VAR_TYPE_WEEKDAYS:
+	    return *((int32_t *)l_pCfgVarList[varIdx].pData);
+
+	case CFG_VAR_TYPE_ENUM_1:
+	case CFG_VAR_TYPE_ENUM_2:
+	case CFG_VAR_TYPE_ENUM_3:
+	case CFG_VAR_TYPE_ENUM_4:
+	case CFG_VAR_TYPE_ENUM_5:
+	    /* Type cast (PWR_OUT) is used for ALL types of enums */
+	    return *((PWR_OUT *)l_pCfgVarList[varIdx].pData);
+
+	default:		// IDs are stored separately
+	    return 0;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get Information about a configuration variable
+ *
+ * This routine returns name, type, and value of the specified configuration
+ * variable.  The value is encoded as for the binary image, see CfgVarGet().
+ *
+ * @param[in] varIdx
+ *	Index of the variable within the list of configuration variables.
+ *
+ * @param[out] ppName
+ *	Address of a pointer to store the variable name.
+ *
+ * @param[out] pValue
+ *	Address of a variable to store the value.
+ *
+ * @return
+ *	Type of the variable (@ref CFG_VAR_TYPE), or -1 if <b>varIdx</b> is
+ *	beyond the end of the list.
+ *
+ ******************************************************************************/
+int	 CfgVarInfo (int varIdx, const char **ppName, int32_t *pValue)
+{
+int	 i;
+
+    if (l_pCfgVarList == NULL  ||  varIdx < 0)
+	return -1;
+
+    for (i = 0;  i < varIdx;  i++)
+	if (l_pCfgVarList[i].name == NULL)
+	    return -1;		// beyond the end of the list
+
+    if (l_pCfgVarList[varIdx].name == NULL)
+	return -1;
+
+    *ppName = l_pCfgVarList[varIdx].name;
+    *pValue = CfgVarGet (varIdx);
+
+    return l_pCfgVarList[varIdx].type;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set value of a configuration variable
+ *
+ * This routine stores a value from the binary image into the specified
+ * configuration variable.  See CfgVarGet() for the encoding.
+ *
+ * @param[in] varIdx
+ *	Index of the variable within the list of configuration variables.
+ *
+ * @param[in] value
+ *	Value of the variable.
+ *
+ ******************************************************************************/
+static void  CfgVarSet (int varIdx, int32_t value)
+{
+int	 hour, minute;
+ALARM_TIME *pAlarm;
+
+    switch (l_pCfgVarList[varIdx].type)
+    {
+	case CFG_VAR_TYPE_TIME:
+	    if (value < 0)
+		break;		// alarm is disabled
+
+	    hour   = (value >> 8) & 0xFF;
+	    minute = value & 0xFF;
+
+	    /* all times are given in MEZ - add +1h for MESZ */
+	    if (g_isdst)
+	    {
+		if (++hour > 23)
+		    hour = 0;
+	    }
+
+	    /* store hours and minutes into variable if one is defined */
+	    if (l_pCfgVarList[varIdx].pData != NULL)
+	    {
+		pAlarm = (ALARM_TIME *)l_pCfgVarList[varIdx].pData;
+		pAlarm->Hour   = hour;
+		pAlarm->Minute = minute;
+	    }
+
+	    /* set alarm time and enable it */
+	    AlarmSet (ALARM_ON_TIME_1 + varIdx, hour, minute);
+	    AlarmEnable (ALARM_ON_TIME_1 + varIdx);
+	    break;
+
+	case CFG_VAR_TYPE_DURATION:
+	case CFG_VAR_TYPE_INTEGER:
+	case CFG_VAR_TYPE_WEEKDAYS:
+	    *((int32_t *)l_pCfgVarList[varIdx].pData) = value;
+	    break;
+
+	case CFG_VAR_TYPE_ENUM_1:
+	case CFG_VAR_TYPE_ENUM_2:
+	case CFG_VAR_TYPE_ENUM_3:
+	case CFG_VAR_TYPE_ENUM_4:
+	case CFG_VAR_TYPE_ENUM_5:
+	    /* Type cast (PWR_OUT) is used for ALL types of enums */
+	    *((PWR_OUT *)l_pCfgVarList[varIdx].pData) = (PWR_OUT)value;
+	    break;
+
+	default:		// IDs are stored separately
+	    break;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Calculate CRC of the list of configuration variables
+ *
+ * This CRC is stored in the binary image to detect a firmware with a
+ * different list of configuration variables, or a different size of the
+ * @ref CFG_LIST data.
+ *
+ * @return
+ *	CRC over all variable names and types, and the size of a list.
+ *
+ ******************************************************************************/
+static uint32_t CfgVarListCRC (void)
+{
+uint32_t crc = 0;
+uint16_t listSize = sizeof(CFG_LIST);
+uint8_t	 type;
+int	 i;
+
+    for (i = 0;  l_pCfgVarList[i].name != NULL;  i++)
+    {
+	type = (uint8_t)l_pCfgVarList[i].type;
+	crc = CfgCRC32 (crc, l_pCfgVarList[i].name,
+			strlen(l_pCfgVarList[i].name));
+	crc = CfgCRC32 (crc, &type, 1);
+    }
+
+    return CfgCRC32 (crc, &listSize, sizeof(listSize));
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Calculate CRC-32
+ *
+ * This routine calculates a CRC-32 (polynomial 0xEDB88320, as used by ZIP)
+ * over the specified data.  It uses a nibble table to keep the code small.
+ *
+ * @param[in] crc
+ *	Initial CRC, use 0 for the first call.
+ *
+ * @param[in] pData
+ *	Data to calculate the CRC for.
+ *
+ * @param[in] size
+ *	Number of bytes.
+ *
+ * @return
+ *	Updated CRC.
+ *
+ ******************************************************************************/
+static uint32_t CfgCRC32 (uint32_t crc, const void *pData, size_t size)
+{
+static const uint32_t crcTab[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+const uint8_t *p = pData;
+
+    crc = ~crc;
+    while (size--)
+    {
+	crc ^= *p++;
+	crc = (crc >> 4) ^ crcTab[crc & 0x0F];
+	crc = (crc >> 4) ^ crcTab[crc & 0x0F];
+    }
+
+    return ~crc;
+}
+#endif	// CFG_BIN_IMAGE
+
+
+/***************************************************************************//**
+ *
+ * @brief	Show all configuration data
+ *
+ * This debug routine shows all configuration data on the serial console.
+ *
+ ******************************************************************************/
+void	 CfgDataShow (void)
+{
+char	 line[200];
+char	 listStr[CFG_LIST_SIZE * 20];
+char	 idStr[ID_STR_SIZE];
+char	 durStr[DUR_STR_SIZE];
+char	*pStr;
+int	 i, idx;
+int8_t	 hour, minute;
+int32_t	 duration, value;
+ALARM_TIME *pAlarm;
+ID_PARM	*pID;
+CFG_ACTION parm;
+const char **ppEnumName;
+
+
+    if (l_pCfgVarList == NULL  ||  ! l_flgDataLoaded)
+    {
+	drvLEUART_putsWait ("No Configuration Data loaded\n");
+	return;
+    }
+    
+    drvLEUART_putsWait ("All times are displayed for timezone ");
+    drvLEUART_putsWait (g_isdst ? "MESZ\n":"MEZ\n");
+    
+    /* log all values read from configuration file */
+    for (i = 0;  l_pCfgVarList[i].name != NULL;  i++)
+    {
+	pStr = line;
+
+	if (l_pCfgVarList[i].type == CFG_VAR_TYPE_ID)
+	    continue;		// IDs are shown below
+
+	pStr += StrFormat (pStr, "%-27s : ", l_pCfgVarList[i].name);
+
+	switch (l_pCfgVarList[i].type)
+	{
+	    case CFG_VAR_TYPE_TIME:		// 00:00 to 23:59
+		if (! AlarmIsEnabled (FIRST_POWER_ALARM + i))
+		{
+		    pStr += StrFormat (pStr, "disabled");
+		    break;
+		}
+		pAlarm = (ALARM_TIME *)l_pCfgVarList[i].pData;
+		if (pAlarm != NULL)
+		{
+		    hour   = pAlarm->Hour;
+		    minute = pAlarm->Minute;
+		}
+		else
+		{
+		    AlarmGet (FIRST_POWER_ALARM + i, &hour, &minute);
+		}
+		pStr += StrFormat (pStr, "%02d:%02d", hour, minute);
+		break;
+
+	    case CFG_VAR_TYPE_DURATION:	// 0 to n seconds, or n ms
+		duration = *((int32_t *)l_pCfgVarList[i].pData);
+		if (duration == DUR_INVALID)
+		    pStr += StrFormat (pStr, "invalid");
+		else
+		    pStr += StrFormat (pStr, "%s",
+				       CfgDurationToString (duration, durStr));
+		break;
+
+
+	    case CFG_VAR_TYPE_ID: // {ID}:{PLAYBACK_TYPE}:{KEEP_PLAYBACK}:{KEEP_RECORD}
+		/* IDs will be handled separately */
+		break;
+
+
+	    case CFG_VAR_TYPE_INTEGER:	// a positive integer variable 0..n
+          	value = *((uint32_t *)l_pCfgVarList[i].pData);
+		pStr += StrFormat (pStr, "%lu", value);
+		break;
+            
+            case CFG_VAR_TYPE_ENUM_1:	// ENUM types
+	    case CFG_VAR_TYPE_ENUM_2:
+	    case CFG_VAR_TYPE_ENUM_3:
+	    case CFG_VAR_TYPE_ENUM_4:
+	    case CFG_VAR_TYPE_ENUM_5:
+            if (l_pEnumDef == NULL)
+	    {
+		pStr += StrFormat (pStr, "ERROR: No enum names defined");
+		    break;
+            }
+	    /* Type cast (PWR_OUT) is used for ALL types of enums */
+	    idx = *((PWR_OUT *)l_pCfgVarList[i].pData);
+	    if (idx < 0)
+	    {
+		pStr += StrFormat (pStr, "not set");
+               break;
+	    }
+	    ppEnumName = l_pEnumDef[l_pCfgVarList[i].type
+		       - CFG_VAR_TYPE_ENUM_1];
+            pStr += StrFormat (pStr, "%s", ppEnumName[idx]);
+	   break;
+
+	    case CFG_VAR_TYPE_LIST:	// First[-Last][*Weight], ...
+		CfgListToString ((CFG_LIST *)l_pCfgVarList[i].pData, listStr);
+		pStr += StrFormat (pStr, "%.*s", (int)(sizeof(line) - 40), listStr);
+		break;
+
+	    case CFG_VAR_TYPE_WEEKDAYS:	// ALL, or Day[-Day], ...
+		value = *((uint32_t *)l_pCfgVarList[i].pData);
+		if (value == WEEKDAYS_ALL)
+		    pStr += StrFormat (pStr, "ALL");
+		else if (value == 0)
+		    pStr += StrFormat (pStr, "none");
+		for (idx = 0;  value != WEEKDAYS_ALL  &&  idx < 7;  idx++)
+		    if (value & (1 << idx))
+			pStr += StrFormat (pStr, "%s%s", g_WeekdayName[idx],
+					   (value >> (idx + 1)) ? ",":"");
+		break;
+        
+           default:		// unsupported data type
+		LogError ("l_pCfgVarList[%d], %s: Unsupported data type %d",
+			  i, l_pCfgVarList[i].name, l_pCfgVarList[i].type);
+		break;
+	}
+
+	StrFormat (pStr, "\n");
+	drvLEUART_putsWait (line);
+    }
+
+    /* print number of IDs read from the config file */
+    StrFormat (line, "Number of IDs        : %d\n", l_ID_Cnt);
+    drvLEUART_putsWait (line);
+
+    /* print usage of the ID table */
+    StrFormat (line, "IDs in RAM table     : %d (%d parameter sets)%s\n",
+	       l_ID_TableCnt, l_ID_ParmSetCnt,
+	       ! l_flgID_TableFull ? "" :
+#if CFG_ID_INDEX
+	       l_flgID_Index ? " - FULL, using index" :
+#endif
+	       " - FULL, reading file");
+    drvLEUART_putsWait (line);
+
+#if CFG_ID_INDEX
+    /* print usage of the ID index */
+    if (l_flgID_Index)
+    {
+	StrFormat (line, "IDs in index file    : %ld (%d sectors per fence)\n",
+		   (long)l_IdxHdr.RecCnt, l_IdxHdr.FenceStep);
+	drvLEUART_putsWait (line);
+    }
+#endif
+
+    /* print list of special IDs */
+    if (l_pFirstID == NULL)
+    {
+	drvLEUART_putsWait ("Warning: Special IDs \"ANY\" and/or \"UNKNOWN\" have"
+			" not been defined\n");
+    }
+    else
+    {
+	drvLEUART_putsWait ("                     "
+			": KEEP_PLAYBACK : KEEP_RECORD : PLAYBACK_TYPE"
+			" : PLAYBACK_BURST : VOLUME : INPUT_MODE\n");
+
+	for (pID = l_pFirstID;  pID != NULL;  pID = pID->pNext)
+	{
+	    parm.KeepPlayback = pID->KeepPlayback;
+	    parm.KeepRecord   = pID->KeepRecord;
+	    parm.PlayType     = pID->PlayType;
+	    parm.PlayBurst    = pID->PlayBurst;
+	    parm.Volume       = pID->Volume;
+	    parm.InputMode    = pID->InputMode;
+	    CfgShowIDParm (CfgIDToString (pID->ID, idStr), &parm);
+	}
+    }
+
+    /* print list of ID patterns, longest match first */
+    if (l_ID_PatCnt > 0)
+    {
+	drvLEUART_putsWait ("ID patterns          "
+			": KEEP_PLAYBACK : KEEP_RECORD : PLAYBACK_TYPE"
+			" : PLAYBACK_BURST : VOLUME : INPUT_MODE\n");
+
+	for (i = 0;  i < l_ID_PatCnt;  i++)
+	    CfgShowIDParm (IDPatternToString (i, idStr),
+			   &l_ID_ParmSet[l_ID_PatParmIdx[i]]);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Show the parameters of an ID
+ *
+ * This routine is called by CfgDataShow() to show one line with the name
+ * and the parameters of a special ID or an ID pattern.
+ *
+ * @param[in] pName
+ *	Name of the ID or the pattern.
+ *
+ * @param[in] pParm
+ *	Parameters to show, @ref DUR_INVALID is shown as "default".
+ *
+ ******************************************************************************/
+static void  CfgShowIDParm (const char *pName, const CFG_ACTION *pParm)
+{
+char	 line[120];
+char	 durStr[DUR_STR_SIZE];
+char	*pStr = line;
+int32_t	 duration;
+
+    pStr += StrFormat (pStr, "%-20s", pName);
+
+    pStr += StrFormat (pStr, " :  ");
+    duration = pParm->KeepPlayback;
+    if (duration == DUR_INVALID)
+	pStr += StrFormat (pStr, "default");
+    else
+	pStr += StrFormat (pStr, "%7s", CfgDurationToString (duration, durStr));
+
+    pStr += StrFormat (pStr, "  :    ");
+    duration = pParm->KeepRecord;
+    if (duration == DUR_INVALID)
+	pStr += StrFormat (pStr, "default");
+    else
+	pStr += StrFormat (pStr, "%7s", CfgDurationToString (duration, durStr));
+
+    pStr += StrFormat (pStr, "  :   ");
+    duration = pParm->PlayType;
+    if (duration == DUR_INVALID)
+	pStr += StrFormat (pStr, "default");
+    else
+	pStr += StrFormat (pStr, "%7ld", duration);
+
+    pStr += StrFormat (pStr, "  :    ");
+    duration = pParm->PlayBurst;
+    if (duration == DUR_INVALID)
+	pStr += StrFormat (pStr, "default");
+    else
+	pStr += StrFormat (pStr, "%7ld", duration);
+
+    pStr += StrFormat (pStr, "  : ");
+    duration = pParm->Volume;
+    if (duration == DUR_INVALID)
+	pStr += StrFormat (pStr, "default");
+    else
+	pStr += StrFormat (pStr, "%7ld", duration);
+
+    pStr += StrFormat (pStr, " :   ");
+    duration = pParm->InputMode;
+    if (duration == DUR_INVALID)
+	pStr += StrFormat (pStr, "default");
+    else
+	pStr += StrFormat (pStr, "%7ld", duration);
+
+    StrFormat (pStr, "\n");
+    drvLEUART_putsWait (line);
 }
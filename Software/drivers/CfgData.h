@@ -2,9 +2,39 @@
  * @file
  * @brief	Header file of module CfgData.c
  * @author	Ralf Gerhauser
- * @version	2018-03-25
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Reduced CFG_ID_BLOOM_BITS to 1024 and CFG_ID_INDEX_FENCES to 8.
+2026-10-15,agnt	Removed CFG_HASH_SIZE and CFG_HASH_BUCKETS.
+2026-10-15,agnt	CFG_ID_INDEX defaults to 1, reduced CFG_ID_TABLE_SIZE to 64,
+		CFG_ID_BLOOM_BITS to 2048, and CFG_ID_INDEX_FENCES to 16.
+		Reduced CFG_ID_PARM_SETS, CFG_ID_PATTERNS, and CFG_LIST_SIZE
+		to 8, and CFG_ARENA_SIZE to 128.
+2026-10-15,agnt	Added CFG_ID_PREFETCH and the prototype for CfgPrefetchIDs(),
+		CFG_ID_PREFETCH defaults to 0 without the sector cache.
+2026-10-15,agnt	Added Volume and InputMode to ID_PARM and CFG_ACTION.
+2026-10-15,agnt	Added PlayBurst to ID_PARM and CFG_ACTION.
+2026-10-15,agnt	Added CFG_ID_PATTERNS and CFG_MATCH_PATTERN.
+2026-10-15,agnt	Increased CFG_HASH_SIZE to 256 and CFG_HASH_BUCKETS to 64.
+2026-10-15,agnt	Added prototype for CfgChanged().
+2026-10-15,agnt	Increased CFG_BIN_MAX_VARS to 64.
+2026-10-15,agnt	Added CFG_HASH_SIZE and CFG_HASH_BUCKETS.
+2026-10-15,agnt	Added CFG_ID_INDEX, CFG_ID_BLOOM_BITS, and CFG_ID_INDEX_FENCES.
+2026-10-14,agnt	- Added prototype for CfgVarInfo().
+2026-10-14,agnt	- Added data type CFG_VAR_TYPE_WEEKDAYS, increased CFG_BIN_MAX_VARS
+		  to 48.
+2026-10-14,agnt	- Added CFG_ACTION, CFG_MATCH, and the prototypes for
+		  CfgActionCompile() and CfgLookupAction().
+2026-10-14,agnt	- Added CFG_ARENA_SIZE.
+2026-10-14,agnt	- Added data type CFG_VAR_TYPE_LIST and structure CFG_LIST.
+2026-10-14,agnt	- Added CFG_ID_TABLE_SIZE and CFG_ID_PARM_SETS for the in-RAM
+		  transponder ID table.
+		- ID_PARM stores the ID as binary TRANSPONDER_ID.
+		- Added prototypes for CfgStrToID() and CfgIDToString().
+		- Added CFG_BIN_IMAGE and CFG_BIN_MAX_VARS.
+		- CFG_VAR_TYPE_DURATION is stored in milliseconds, added
+		  DUR_STR_SIZE and CfgDurationToString().
 2018-03-25,rage	- Added ENUM_DEF to be able to use ENUM definitions.
 		- Defined CFG_VAR_TYPE_ENUM_1 to 5.
 		- Changed prototype for CfgDataInit().
@@ -19,6 +49,7 @@ Revision History:
 /*=============================== Header Files ===============================*/
 
 #include "config.h"		// include project configuration parameters
+#include "ffconf.h"		// _DISK_CACHE_SECTORS
 
 /*=============================== Definitions ================================*/
 
@@ -26,7 +57,7 @@ Revision History:
 typedef enum
 {
     CFG_VAR_TYPE_TIME,		//!< 00:00 to 23:59
-    CFG_VAR_TYPE_DURATION,	//!< 0 to n seconds
+    CFG_VAR_TYPE_DURATION,	//!< 0 to n seconds, or n ms (stored in [ms])
     CFG_VAR_TYPE_ID,		//!< transponder ID with optional parameters
     CFG_VAR_TYPE_INTEGER,	//!< positive integer variable (0 to n)
     CFG_VAR_TYPE_CONFIG,	//!< configuration data
@@ -35,12 +66,113 @@ typedef enum
     CFG_VAR_TYPE_ENUM_3,	//!< enumeration 3
     CFG_VAR_TYPE_ENUM_4,	//!< enumeration 4
     CFG_VAR_TYPE_ENUM_5,	//!< enumeration 5
+    CFG_VAR_TYPE_LIST,		//!< list of integer ranges with weights
+    CFG_VAR_TYPE_WEEKDAYS,	//!< "ALL", or list of weekdays, e.g. "MO-FR,SU"
     END_CFG_VAR_TYPE
 } CFG_VAR_TYPE;
 
+#ifndef CFG_ID_TABLE_SIZE
+    /*!@brief Maximum number of transponder IDs kept in the in-RAM table, each
+     * one takes 9 bytes of RAM.  Further IDs go into the ID index, see
+     * @ref CFG_ID_INDEX.
+     */
+    #define CFG_ID_TABLE_SIZE	64
+#endif
+
+#ifndef CFG_ID_PARM_SETS
+    /*!@brief Maximum number of different parameter sets for the ID table.  If
+     * another set is needed, this and all further IDs go into the ID index,
+     * see @ref CFG_ID_INDEX.
+     */
+    #define CFG_ID_PARM_SETS	8
+#endif
+
+#ifndef CFG_ID_PATTERNS
+    /*!@brief Maximum number of ID patterns like "9E1CE7D0*", each one takes
+     * 17 bytes of RAM.  Further patterns are ignored with an error message.
+     */
+    #define CFG_ID_PATTERNS	8
+#endif
+
+#ifndef CFG_ID_INDEX
+    /*!@brief Set 1 to store the IDs which do not fit into the ID table into
+     * the sorted index file @ref CFG_IDX_FILE_NAME, and to keep a Bloom
+     * filter of them in RAM, see CfgLookupID().  Otherwise the configuration
+     * file is scanned for each of these IDs.  This needs about 250 bytes of
+     * RAM, the scratch file borrows the file handle of the logging module.
+     */
+    #define CFG_ID_INDEX	1
+#endif
+
+#ifndef CFG_ID_BLOOM_BITS
+    /*!@brief Number of bits of the Bloom filter, must be a power of 2.  With
+     * 8 bits per ID, i.e. up to 128 IDs in the index, about 2.5% of the
+     * unknown IDs have to be looked up in the index file.
+     */
+    #define CFG_ID_BLOOM_BITS	1024
+#endif
+
+#ifndef CFG_ID_INDEX_FENCES
+    /*!@brief Number of keys of the index file which are kept in RAM.  A hit
+     * costs one sector read as long as the index has no more sectors, i.e.
+     * up to 128 IDs.
+     */
+    #define CFG_ID_INDEX_FENCES	8
+#endif
+
+#ifndef CFG_ID_PREFETCH
+    /*!@brief Maximum number of transponder IDs whose index sectors are loaded
+     * into the sector cache when a visit starts, see CfgPrefetchIDs().  The
+     * IDs are taken from the presence table of the RFID reader, and the
+     * visit statistics.  Use 0 to disable this.  It requires the sector
+     * cache, see _DISK_CACHE_SECTORS in ffconf.h.
+     */
+    #if _DISK_CACHE_SECTORS > 0
+	#define CFG_ID_PREFETCH	4
+    #else
+	#define CFG_ID_PREFETCH	0
+    #endif
+#endif
+
+#ifndef CFG_BIN_IMAGE
+    /*!@brief Set 1 to use (and generate) the binary configuration image
+     * @ref CFG_BIN_FILE_NAME, see CfgRead().
+     */
+    #define CFG_BIN_IMAGE	1
+#endif
+
+#if CFG_ID_INDEX  &&  ! CFG_BIN_IMAGE
+    #error "CFG_ID_INDEX requires CFG_BIN_IMAGE"
+#endif
+
+#if CFG_ID_BLOOM_BITS & (CFG_ID_BLOOM_BITS - 1)
+    #error "CFG_ID_BLOOM_BITS must be a power of 2"
+#endif
+
+#ifndef CFG_BIN_MAX_VARS
+    /*!@brief Maximum number of configuration variables in the binary image */
+    #define CFG_BIN_MAX_VARS	64
+#endif
+
+#ifndef CFG_ARENA_SIZE
+    /*!@brief Size of the static arena in bytes, from which the configuration
+     * data, i.e. the @ref ID_PARM entries of the special IDs "ANY" and
+     * "UNKNOWN", is allocated.  An entry takes 40 bytes.
+     */
+    #define CFG_ARENA_SIZE	128
+#endif
+
+#ifndef CFG_LIST_SIZE
+    /*!@brief Maximum number of entries of a @ref CFG_VAR_TYPE_LIST */
+    #define CFG_LIST_SIZE	8
+#endif
+
     /*!@brief Special states for @ref CFG_VAR_TYPE_DURATION. */
 #define DUR_INVALID (-1)	//!< entry is invalid
 
+    /*!@brief Buffer size for CfgDurationToString(), e.g. "2147483647ms". */
+#define DUR_STR_SIZE	14
+
     /*!@brief Structure to define configuration variables. */
 typedef struct
 {
@@ -49,6 +181,21 @@ typedef struct
     const void	      *pData;	//!< address of data variable
 } CFG_VAR_DEF;
 
+    /*!@brief Entry of a @ref CFG_LIST, i.e. "First-Last*Weight". */
+typedef struct
+{
+    uint16_t	First;		//!< first value of the range
+    uint16_t	Last;		//!< last value of the range
+    uint16_t	Weight;		//!< weight of all values, default 1
+} CFG_LIST_ENTRY;
+
+    /*!@brief Data of a @ref CFG_VAR_TYPE_LIST, e.g. "1-3, 4*2, 6-9*3". */
+typedef struct
+{
+    uint16_t	   Cnt;		//!< number of valid entries
+    CFG_LIST_ENTRY Entry[CFG_LIST_SIZE];	//!< the ranges
+} CFG_LIST;
+
     /*!@brief Type for a list of enum definitions. */
 typedef const char **ENUM_DEF;	//!< list of enum names
 
@@ -59,9 +206,35 @@ typedef struct _ID_PARM
     int32_t  KeepPlayback;	// individual KEEP_PLAYBACK duration
     int32_t  KeepRecord;	// individual KEEP_RECORD duration
     int32_t  PlayType;	        // individual PLAYBACK_TYPE
-    char     ID[];		//!< ID string follows
+    int32_t  PlayBurst;		// individual PLAYBACK_BURST
+    int32_t  Volume;		// individual AUDIO_CFG_VC
+    int32_t  InputMode;		// individual AUDIO_CFG_IM
+    TRANSPONDER_ID ID;		//!< (binary) transponder ID
 } ID_PARM;
 
+    /*!@brief Action for a transponder ID, i.e. its parameters with the
+     * defaults resolved, see CfgActionCompile().  Equal actions are shared
+     * between IDs.
+     */
+typedef struct
+{
+    int32_t  KeepPlayback;	//!< KEEP_PLAYBACK duration
+    int32_t  KeepRecord;	//!< KEEP_RECORD duration
+    int32_t  PlayType;		//!< PLAYBACK_TYPE
+    int32_t  PlayBurst;		//!< PLAYBACK_BURST, see ThrottleCheck()
+    int32_t  Volume;		//!< AUDIO_CFG_VC, see AudioParmSet()
+    int32_t  InputMode;		//!< AUDIO_CFG_IM, see AudioParmSet()
+} CFG_ACTION;
+
+    /*!@brief Entry which has been found by CfgLookupAction(). */
+typedef enum
+{
+    CFG_MATCH_ID,		//!< the ID itself is part of the configuration
+    CFG_MATCH_PATTERN,		//!< ID not found, using the longest pattern
+    CFG_MATCH_ANY,		//!< ID not found, using the "ANY" entry
+    CFG_MATCH_UNKNOWN		//!< ID not found, using the "UNKNOWN" entry
+} CFG_MATCH;
+
 
 /*================================ Prototypes ================================*/
 
@@ -71,9 +244,31 @@ void	 CfgDataInit (const CFG_VAR_DEF *pCfgVarList, const ENUM_DEF *pEnumDef);
     /* Read configuration file */
 void	 CfgRead	(char *filename);
 
+    /* Check if the configuration file differs from the one that was read */
+bool	 CfgChanged	(char *filename);
+
     /* Lookup transponder ID in database */
-ID_PARM *CfgLookupID	(char *transponderID);
+ID_PARM *CfgLookupID	(TRANSPONDER_ID transponderID);
+
+    /* Load the index sectors of likely IDs into the sector cache */
+int	 CfgPrefetchIDs	(const TRANSPONDER_ID *pIDs, int cnt);
+
+    /* Resolve the defaults of all IDs after the configuration has been read */
+void	 CfgActionCompile (const CFG_ACTION *pDflt);
+
+    /* Lookup the action for a transponder ID, including ANY and UNKNOWN */
+const CFG_ACTION *CfgLookupAction (TRANSPONDER_ID transponderID,
+				   CFG_MATCH *pMatch);
+
+    /* Convert between string and binary representation of a transponder ID */
+bool	 CfgStrToID	(const char *pStr, TRANSPONDER_ID *pID);
+char	*CfgIDToString	(TRANSPONDER_ID transponderID, char *pBuf);
+
+    /* Convert duration [ms] into a string */
+char	*CfgDurationToString (int32_t duration, char *pBuf);
 
+    /* Get name, type, and value of a configuration variable */
+int	 CfgVarInfo	(int varIdx, const char **ppName, int32_t *pValue);
     /* Show all configuration data */
 void	 CfgDataShow (void);
 
@@ -0,0 +1,299 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Peripheral Clock and EM1 Manager
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module keeps track of who needs a peripheral clock, and who needs
+ * EM1.  Each driver acquires the clock of its peripheral with ClockAcquire()
+ * and its owner ID of @ref CLK_OWNERS, instead of calling CMU_ClockEnable()
+ * directly.  A clock is enabled by the first owner, and disabled as soon as
+ * its last owner has called ClockRelease().  This way a driver can neither
+ * switch off a clock which is still used by another one, e.g. the GPIO, nor
+ * leave a clock running because it assumes somebody else needs it.
+ *
+ * EM1_Acquire() and EM1_Release() are used for the bits of
+ * @ref g_EM1_ModuleMask.  ClockMgrReport(), console command "PWR", shows
+ * the owners of each enabled clock, and the modules which keep the system in
+ * EM1.  It also compares the register CMU->HFPERCLKEN0 with the managed
+ * clocks, so a peripheral which has been enabled behind the back of this
+ * module is reported as well.  How long each module has kept the system in
+ * EM1 is shown by the energy mode profiler, see @ref EM_PROFILE.
+ *
+ * Acquiring a clock or EM1 is not counted per call: an owner holds a clock
+ * once, no matter how often it has acquired it, and a single release ends
+ * it.  This matches the drivers, which set up their peripheral in one place
+ * and shut it down in another.  All routines may be called from interrupt
+ * context.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	The table g_EM1_ModName is constant, i.e. kept in flash.
+2026-10-15,agnt	Added owner "SUPPLY" and EM1 module "SUPPLY".
+2026-10-15,agnt	Added owner "SOUND" and clock ACMP1.
+2026-10-15,agnt	Added owner "GPS".
+2026-10-15,agnt	Added owner "TEMP".
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_int.h"
+#include "ClockMgr.h"
+#include "LEUART.h"
+#include "StrFormat.h"
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Peripheral clock which is managed by this module. */
+typedef struct
+{
+    CMU_Clock_TypeDef	Clock;		//!< clock of the peripheral
+    const char	       *pName;		//!< name of the peripheral
+} CLK_DESC;
+
+/*================================ Global Data ===============================*/
+
+    /*!@brief Names of the modules that require EM1 - keep in sync with enum
+     * @ref EM1_MODULES!
+     */
+const char * const g_EM1_ModName[END_EM1_MODULES] =
+{ "RFID", "AUDIO", "SMB", "CONSOLE", "SUPPLY" };
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Names of the clock owners - keep in sync with enum
+     * @ref CLK_OWNERS!
+     */
+static const char *l_ClkOwnerName[END_CLK_OWNERS] =
+{ "SYSTEM", "RFID", "AUDIO", "SMB", "DISK", "PWRFAIL", "EXTINT", "LB", "LOG",
+  "TEMP", "GPS", "SOUND", "SUPPLY" };
+
+    /*!@brief Peripheral clocks which may be acquired. */
+static const CLK_DESC l_ClkDesc[] =
+{
+    { cmuClock_GPIO,	"GPIO"    },
+    { cmuClock_USART0,	"USART0"  },
+    { cmuClock_USART1,	"USART1"  },
+    { cmuClock_USART2,	"USART2"  },
+    { cmuClock_LEUART1,	"LEUART1" },
+    { cmuClock_I2C0,	"I2C0"    },
+    { cmuClock_ADC0,	"ADC0"    },
+    { cmuClock_VCMP,	"VCMP"    },
+    { cmuClock_ACMP1,	"ACMP1"   },
+    { cmuClock_PRS,	"PRS"     },
+    { cmuClock_TIMER0,	"TIMER0"  },
+    { cmuClock_TIMER1,	"TIMER1"  },
+    { cmuClock_TIMER2,	"TIMER2"  },
+    { cmuClock_PCNT0,	"PCNT0"   },
+    { cmuClock_PCNT1,	"PCNT1"   },
+    { cmuClock_PCNT2,	"PCNT2"   },
+    { cmuClock_AES,	"AES"     },
+};
+
+    /*! Number of entries in @ref l_ClkDesc */
+#define NUM_CLK_DESC	(sizeof(l_ClkDesc) / sizeof(l_ClkDesc[0]))
+
+    /*! Bit mask of the owners of each clock, 0 if it is disabled */
+static uint16_t	l_ClkOwners[NUM_CLK_DESC];
+
+    /*! Number of requests for clocks which are not in @ref l_ClkDesc */
+static uint16_t	l_ClkUnknownCnt;
+
+/*=========================== Forward Declarations ===========================*/
+
+static int	ClockIndex (CMU_Clock_TypeDef clock);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Acquire a Peripheral Clock
+ *
+ * This routine registers <b>owner</b> as a user of <b>clock</b>.  The first
+ * owner enables the clock.
+ *
+ * @param[in] owner
+ *	Module which needs the clock, see @ref CLK_OWNERS.
+ *
+ * @param[in] clock
+ *	Clock of the peripheral, it must be listed in @ref l_ClkDesc.
+ *
+ ******************************************************************************/
+void	ClockAcquire (CLK_OWNERS owner, CMU_Clock_TypeDef clock)
+{
+int	idx = ClockIndex (clock);
+
+    EFM_ASSERT(0 <= owner  &&  owner < END_CLK_OWNERS);
+
+    if (idx < 0)
+    {
+	/* Not managed, enable it anyway */
+	l_ClkUnknownCnt++;
+	CMU_ClockEnable (clock, true);
+	return;
+    }
+
+    INT_Disable();
+
+    if (l_ClkOwners[idx] == 0)
+	CMU_ClockEnable (clock, true);
+    l_ClkOwners[idx] |= (1 << owner);
+
+    INT_Enable();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Release a Peripheral Clock
+ *
+ * This routine removes <b>owner</b> from the users of <b>clock</b>.  If it
+ * has been the last one, the clock is disabled.  Releasing a clock which is
+ * not held by this owner has no effect.
+ *
+ * @param[in] owner
+ *	Module which no longer needs the clock, see @ref CLK_OWNERS.
+ *
+ * @param[in] clock
+ *	Clock of the peripheral.
+ *
+ ******************************************************************************/
+void	ClockRelease (CLK_OWNERS owner, CMU_Clock_TypeDef clock)
+{
+int	idx = ClockIndex (clock);
+
+    EFM_ASSERT(0 <= owner  &&  owner < END_CLK_OWNERS);
+
+    if (idx < 0)
+    {
+	l_ClkUnknownCnt++;
+	CMU_ClockEnable (clock, false);
+	return;
+    }
+
+    INT_Disable();
+
+    if (l_ClkOwners[idx] & (1 << owner))
+    {
+	l_ClkOwners[idx] &= ~(1 << owner);
+	if (l_ClkOwners[idx] == 0)
+	    CMU_ClockEnable (clock, false);
+    }
+
+    INT_Enable();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Acquire EM1
+ *
+ * This routine sets the bit of <b>module</b> in @ref g_EM1_ModuleMask, so the
+ * main loop does not enter EM2 while the module needs its HF peripherals.
+ *
+ * @param[in] module
+ *	Module which requires EM1, see @ref EM1_MODULES.
+ *
+ ******************************************************************************/
+void	EM1_Acquire (EM1_MODULES module)
+{
+    EFM_ASSERT(0 <= module  &&  module < END_EM1_MODULES);
+
+    Bit(g_EM1_ModuleMask, module) = 1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Release EM1
+ *
+ * This routine clears the bit of <b>module</b> in @ref g_EM1_ModuleMask.
+ *
+ * @param[in] module
+ *	Module which no longer requires EM1, see @ref EM1_MODULES.
+ *
+ ******************************************************************************/
+void	EM1_Release (EM1_MODULES module)
+{
+    EFM_ASSERT(0 <= module  &&  module < END_EM1_MODULES);
+
+    Bit(g_EM1_ModuleMask, module) = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Clock and EM1 Holders
+ *
+ * This routine shows each enabled clock with its owners, and the modules
+ * which require EM1.  Bits of
+ * CMU->HFPERCLKEN0 which are set, but not held by an owner, are reported as
+ * unmanaged.
+ *
+ ******************************************************************************/
+void	ClockMgrReport (void)
+{
+char	 line[120];
+int	 len;
+uint32_t managed = 0;		// HFPERCLKEN0 bits held via this module
+uint32_t stray;
+int	 idx, i;
+
+    for (idx = 0;  idx < (int)NUM_CLK_DESC;  idx++)
+    {
+	if (l_ClkOwners[idx] == 0)
+	    continue;
+
+	if (((l_ClkDesc[idx].Clock >> CMU_EN_REG_POS) & CMU_EN_REG_MASK)
+	    == CMU_HFPERCLKEN0_EN_REG)
+	    managed |= 1 << ((l_ClkDesc[idx].Clock >> CMU_EN_BIT_POS)
+			     & CMU_EN_BIT_MASK);
+
+	len = StrFormat (line, "Clock %s held by", l_ClkDesc[idx].pName);
+	for (i = 0;  i < END_CLK_OWNERS;  i++)
+	{
+	    if (l_ClkOwners[idx] & (1 << i))
+		len += StrFormat (line + len, " %s", l_ClkOwnerName[i]);
+	}
+	StrFormat (line + len, "\n");
+	drvLEUART_puts (line);
+    }
+
+    len = StrFormat (line, "EM1 held by");
+    for (i = 0;  i < END_EM1_MODULES;  i++)
+    {
+	if (Bit(g_EM1_ModuleMask, i))
+	    len += StrFormat (line + len, " %s", g_EM1_ModName[i]);
+    }
+    StrFormat (line + len, "%s\n", g_EM1_ModuleMask ? "" : " none");
+    drvLEUART_puts (line);
+
+    stray = CMU->HFPERCLKEN0 & ~managed;
+    if (stray != 0  ||  l_ClkUnknownCnt != 0)
+    {
+	StrFormat (line, "Unmanaged HFPERCLKEN0 bits 0x%04lX, %d requests"
+		   " for unknown clocks\n", stray, l_ClkUnknownCnt);
+	drvLEUART_puts (line);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Find a Clock
+ *
+ * @return
+ * 	Index of <b>clock</b> in @ref l_ClkDesc, or -1 if it is not managed.
+ *
+ ******************************************************************************/
+static int	ClockIndex (CMU_Clock_TypeDef clock)
+{
+int	idx;
+
+    for (idx = 0;  idx < (int)NUM_CLK_DESC;  idx++)
+    {
+	if (l_ClkDesc[idx].Clock == clock)
+	    return idx;
+    }
+    return -1;
+}
@@ -0,0 +1,45 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module ClockMgr.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	g_EM1_ModName is a constant table.
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_ClockMgr_h
+#define __INC_ClockMgr_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "em_cmu.h"
+#include "config.h"		// include project configuration parameters
+
+/*======================== External Data and Routines ========================*/
+
+extern const char * const g_EM1_ModName[END_EM1_MODULES];	// see EM1_MODULES
+
+/*================================ Prototypes ================================*/
+
+    /* Enable a peripheral clock on behalf of an owner */
+void	ClockAcquire (CLK_OWNERS owner, CMU_Clock_TypeDef clock);
+
+    /* Release a peripheral clock, the last owner disables it */
+void	ClockRelease (CLK_OWNERS owner, CMU_Clock_TypeDef clock);
+
+    /* Module requires EM1, sets its bit in g_EM1_ModuleMask */
+void	EM1_Acquire (EM1_MODULES module);
+
+    /* Module no longer requires EM1 */
+void	EM1_Release (EM1_MODULES module);
+
+    /* Show the clock and EM1 holders on the console */
+void	ClockMgrReport (void);
+
+
+#endif /* __INC_ClockMgr_h */
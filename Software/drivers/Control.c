@@ -2,7 +2,7 @@
  * @file
  * @brief	Sequence Control
  * @author      Ralf Gerhauser / Peter Loes  
- * @version	2018-08-03
+ * @version	2026-10-15
  *
  * This is the automatic sequence control module.  It controls the power
  * outputs that may be activated via alarm times @ref alarm_times.
@@ -10,8 +10,93 @@
  * This module also defines the configuration variables for the file
  * <a href="../../CONFIG.TXT"><i>CONFIG.TXT</i></a>.
  *
+ * If @ref ENERGY_GOVERNOR is 1, ControlEnergyGovernor() reduces durations
+ * and settings when the state of charge of the battery drops below the
+ * thresholds GOV_SOC_SAVE and GOV_SOC_CRITICAL, so the system runs for some
+ * extra days.
+ *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	- The power outputs are no longer accounted in an energy ledger.
+2026-10-15,agnt	- Removed the latency stamp of the ID lookup.
+2026-10-15,agnt	- PlayRecAction(), PlaybackRun(), and RecordRun() emit ITM trace
+		  records of the requests for the Audio module, see ITM_TRACE.
+2026-10-15,agnt	- Added configuration variables SESSION_TIME_1, SESSION_TIME_2,
+		  and SESSION_LENGTH for stimulus sessions at fixed times, see
+		  SessionControl().
+2026-10-15,agnt	- Added PowerOutputMask(), which switches a set of power
+		  outputs by one write of DOUT per GPIO port, and logs them in
+		  one message.  PowerOutput(), PowerOutputSwitch(), and
+		  ControlPowerFailHandler() use it.
+2026-10-15,agnt	- Added configuration variable RECORD_SEGMENT.
+2026-10-15,agnt	- ControlUpdateID() passes the volume and input mode of the ID
+		  to AudioParmSet(), the volume is reduced like AUDIO_CFG_VC by
+		  the energy governor, see GovernorVolume().
+2026-10-15,agnt	- Added configuration variables PLAYBACK_RATE and PLAYBACK_BURST.
+		  ControlUpdateID() suppresses the playback if the token bucket
+		  of the ID is empty, see ThrottleCheck().
+2026-10-15,agnt	- ControlUpdateID: Logs if the action of an ID pattern is used.
+2026-10-15,agnt	- Added configuration variable SUPPLY_CURVE for the supply
+		  monitor.
+2026-10-15,agnt	- Added configuration variables SOUND_THRESHOLD and
+		  SOUND_HANG_TIME for the sound-activity detector.
+2026-10-15,agnt	- ControlConfigReload() applies a changed configuration file
+		  without switching the devices off, RFID_Init() and
+		  AudioInit() are only called if their settings changed.
+		  ClearConfiguration() uses ControlDefaults() for the values.
+2026-10-15,agnt	- ControlUpdateID: The line buffer is taken from the scratch
+		  pool, see ScratchGet().
+2026-10-15,agnt	- ControlUpdateID: The transponder line is logged by LogEvent(),
+		  see LOG_PRIORITY.
+2026-10-15,agnt	- The run and stop flags of playback and record are bits of
+		  the flag word <l_AudioReq>, see FLAG_SET().
+2026-10-15,agnt	- PowerControl: The devices are powered up by the sequencer,
+		  see PWR_SEQ.
+2026-10-15,agnt	- PowerOutputSwitch: The RFID reader and the Audio module are
+		  accounted in the energy ledger, see EnergyLedger.c.
+2026-10-15,agnt	- Added configuration variable AUDIO_SERVICE_DATE.
+2026-10-15,agnt	- Added configuration variables RFID2_TYPE and RFID2_POWER.
+2026-10-15,agnt	- PowerOutputSwitch() switches a power output without log
+		  message, PowerOutput() uses it.
+2026-10-15,agnt	- Added configuration variables RFID_DUTY_ON and
+		  RFID_DUTY_PERIOD.
+2026-10-15,agnt	- Added configuration variable RFID_EARLY_OFF.
+2026-10-15,agnt	- Added configuration variables LB1_FILTER_MS, LB2_FILTER_MS,
+		  LB_DEBOUNCE_ON_MS, and LB_DEBOUNCE_OFF_MS.
+2026-10-15,agnt	- ControlUpdateID() counts the ID for the visit statistics, see
+		  VISIT_STATS.
+2026-10-15,agnt	- Use StrFormat() instead of sprintf().
+2026-10-14,agnt	- PWR_OUT_DEF contains the port and pin of the power enable
+		  pin instead of its bit-band address, see PWR_OUT_BIT().
+2026-10-14,agnt	- Added configuration variables ON_TIME_2~5, OFF_TIME_2~5, and
+		  WEEKDAYS_1~5.  PowerControl() switches according to the
+		  compiled power schedule, see PowerScheduleIsOn().
+2026-10-14,agnt	- ControlCompileActions() resolves the default durations and
+		  the playback type once after the configuration has been read,
+		  ControlUpdateID() only needs one lookup, see
+		  CfgLookupAction().
+2026-10-14,agnt	- ControlUpdateID() is called in the main loop only, see
+		  RFID_Check().
+2026-10-14,agnt	- PlayRecAction(), PlaybackRun(), RecordRun(): AudioCheck() is
+		  triggered via EVENT_POST(EVT_AUDIO).
+2026-10-14,agnt	- Added configuration variable RECORD_PREROLL, ControlUpdateID()
+		  decides about the pre-roll record.
+2026-10-14,agnt	- Added configuration variable PLAYBACK_CHAIN.
+2026-10-14,agnt	- Added configuration variables STIM_SET_1 to STIM_SET_4.
+2026-10-14,agnt	- Added configuration variables PLAYLIST and PLAYLIST_NO_REPEAT.
+2026-10-14,agnt	- Added configuration variable RECORD_NAMING.
+2026-10-14,agnt	- Added configuration variable AUDIO_IDLE_TIMEOUT.
+2026-10-14,agnt	- Added configuration variable RFID_ABSENT_TIMEOUT.
+2026-10-14,agnt	- ControlUpdateID: The lookup is stamped for the latency trace.
+2026-10-14,agnt	- Added energy governor, see ControlEnergyGovernor(), and
+		  configuration variables GOV_SOC_SAVE and GOV_SOC_CRITICAL.
+2026-10-14,agnt	- Added configuration variable DCF77_MAX_ERROR.
+2026-10-14,agnt	- Added configuration variables LOG_LEVEL and
+		  LB_SUMMARY_INTERVAL.
+2026-10-14,agnt	- ControlUpdateID: Transponder ID is passed as TRANSPONDER_ID,
+		  the string is only generated for the log message.
+		- Playback and record durations are given in milliseconds and
+		  run by an msTimer instead of an sTimer.
 2020-01-03,rage	- Start and Stop Playback & Record
 2017-05-02,rage	- ControlInit: Added CONTROL_INIT structure to specify the
 		  power output.
@@ -26,7 +111,8 @@ Revision History:
 
 /*=============================== Header Files ===============================*/
 
-
+#include <stddef.h>
+#include <string.h>
 #include "em_cmu.h"
 #include "em_int.h"
 #include "em_gpio.h"
@@ -34,9 +120,21 @@ Revision History:
 #include "LightBarrier.h"
 #include "AlarmClock.h"
 #include "RFID.h"
+#include "RecordSeq.h"
+#include "Playlist.h"
 #include "Audio.h"
 #include "CfgData.h"
+#include "DCF77.h"
+#include "BatteryMon.h"
 #include "Control.h"
+#include "ItmTrace.h"
+#include "VisitStats.h"
+#include "PowerSeq.h"
+#include "StrFormat.h"
+#include "ScratchPool.h"
+#include "SoundDetect.h"
+#include "SupplyMon.h"
+#include "Throttle.h"
 
 
 /*=============================== Definitions ================================*/
@@ -44,22 +142,58 @@ Revision History:
     /*!@brief Structure to define power outputs. */
 typedef struct
 {
-    __IO uint32_t *BitBandAddr;	// Bit band address of GPIO power enable pin
+    GPIO_Port_TypeDef Port;	// GPIO port of the power enable pin
+    uint8_t	   Pin;		// GPIO pin number of the power enable pin
     bool	   HighActive;	// true: The power enable pin is high-active
 } PWR_OUT_DEF;
 
-    /*!@brief Macro to calculate a GPIO bit address for a port and pin. */
-#define GPIO_BIT_ADDR(port, pin)					\
-	IO_BIT_ADDR((&(GPIO->P[(port)].DOUT)), (pin))
+    /*!@brief Macro to access the output bit of a power enable pin via its
+     * bit-band address.  The parameter is a pointer to the @ref PWR_OUT_DEF.
+     */
+#define PWR_OUT_BIT(pDef)	IO_Bit(GPIO->P[pDef->Port].DOUT, pDef->Pin)
 
-/*!@brief Macro to extract the port number from a GPIO bit address.  */
-#define GPIO_BIT_ADDR_TO_PORT(bitAddr)		(GPIO_Port_TypeDef)	\
-	(((((uint32_t)(bitAddr) - BITBAND_PER_BASE) >> 5)		\
-	 + PER_MEM_BASE - GPIO_BASE) / sizeof(GPIO_P_TypeDef))
+    /*!@brief Bits of @ref l_AudioReq, the requests for the Audio module. */
+typedef enum
+{
+    AUDIO_REQ_PLAY_RUN,		//!< Playback run
+    AUDIO_REQ_PLAY_STOP,	//!< Playback stop
+    AUDIO_REQ_REC_RUN,		//!< Record run
+    AUDIO_REQ_REC_STOP,		//!< Record stop
+} AUDIO_REQ;
+
+    /*!@brief Energy levels of the governor. */
+typedef enum
+{
+    GOV_NORMAL,		//!< Normal operation
+    GOV_SAVE,		//!< Battery is low, save energy
+    GOV_CRITICAL,	//!< Battery is nearly empty, reduce to the minimum
+    NUM_GOV_LEVEL
+} GOV_LEVEL;
 
-    /*!@brief Macro to extract the pin number from a GPIO bit address.  */
-#define GPIO_BIT_ADDR_TO_PIN(bitAddr)					\
-	(((uint32_t)(bitAddr) >> 2) & 0x1F)
+    /*!@brief Structure to define the settings of an energy level. */
+typedef struct
+{
+    const char *Name;		//!< Name of the level for the log message
+    uint8_t	BatMonFactor;	//!< Factor for the battery monitor interval
+    uint8_t	DetectPercent;	//!< RFID_DETECT_TIMEOUT in [%]
+    uint8_t	DurationPercent;//!< PLAYBACK and RECORD durations in [%]
+    uint8_t	VolumeReduce;	//!< AUDIO_CFG_VC is reduced by this value
+} GOV_LEVEL_DEF;
+
+    /*!@brief Settings which require to initialize a device again, see
+     * ControlConfigReload().
+     */
+typedef struct
+{
+    RFID_TYPE	RFID_Type;	//!< RFID_TYPE
+    PWR_OUT	RFID_Power;	//!< RFID_POWER
+#if RFID_READERS > 1
+    RFID_TYPE	RFID2_Type;	//!< RFID2_TYPE
+    PWR_OUT	RFID2_Power;	//!< RFID2_POWER
+#endif
+    PWR_OUT	AudioPower;	//!< AUDIO_POWER
+    uint32_t	AudioCfg[4];	//!< AUDIO_CFG_VC, _ST, _IM, _RQ
+} DEV_CFG;
           
 /*================================ Global Data ===============================*/
 
@@ -72,11 +206,37 @@ const char *g_enum_PowerOutput[] = { "UA2", "UA", NULL };
      * @ref PWR_OUT and string array @ref g_enum_PowerOutput !
      */
 static const PWR_OUT_DEF  l_PwrOutDef[NUM_PWR_OUT] =
-{   //   BitBandAddr,              HighActive
-    { GPIO_BIT_ADDR(gpioPortA,  4), true },	// PWR_OUT_UA2
-    { GPIO_BIT_ADDR(gpioPortA,  6), true },	// PWR_OUT_UA
+{   //   Port,    Pin, HighActive
+    { gpioPortA,  4, true },	// PWR_OUT_UA2
+    { gpioPortA,  6, true },	// PWR_OUT_UA
 };
 
+    /*!@brief Settings of the energy levels - keep in sync with @ref GOV_LEVEL.
+     */
+static const GOV_LEVEL_DEF l_GovLevelDef[NUM_GOV_LEVEL] =
+{   //  Name,     BatMon, Detect, Duration, Volume
+    { "NORMAL",     1,     100,     100,      0 },	// GOV_NORMAL
+    { "SAVE",       2,      50,      50,      4 },	// GOV_SAVE
+    { "CRITICAL",   4,      25,      25,      8 },	// GOV_CRITICAL
+};
+
+    /*!@brief State of charge in [%] for GOV_SAVE, set by GOV_SOC_SAVE. */
+static int32_t		l_GovSocSave = DFLT_GOV_SOC_SAVE;
+
+    /*!@brief State of charge in [%] for GOV_CRITICAL, set by
+     * GOV_SOC_CRITICAL.
+     */
+static int32_t		l_GovSocCritical = DFLT_GOV_SOC_CRITICAL;
+
+    /*!@brief Current energy level of the governor. */
+static GOV_LEVEL	l_GovLevel = GOV_NORMAL;
+
+    /*!@brief Configured RFID_DETECT_TIMEOUT while the level is not NORMAL. */
+static int32_t		l_GovCfgDetectTimeout;
+
+    /*!@brief Configured AUDIO_CFG_VC while the level is not NORMAL. */
+static uint32_t		l_GovCfgVC;
+
     /*!@brief Default value of the playback_type, set by PLAYBACK_TYPE. */
 static int32_t		l_dfltPlayType = DFLT_PLAY_TYPE;
 
@@ -95,6 +255,16 @@ static int32_t		l_dfltKeepRecord = DFLT_KEEP_RECORD_DURATION;
     /*!@brief Actual keep Record duration, set by ID. */
 static int32_t		l_KeepRecord = DFLT_KEEP_RECORD_DURATION;
 
+    /*!@brief Playback duration of a stimulus session, set by SESSION_LENGTH. */
+static int32_t		l_SessionLength;
+
+    /*!@brief Log text for the entry found by CfgLookupAction() - keep in
+     * sync with @ref CFG_MATCH!
+     */
+static const char *l_MatchStr[] =
+{ "", " not found - using pattern", " not found - using ANY",
+  " not found - using UNKNOWN" };
+
     /*!@brief List of configuration variables.
      * Alarm times, i.e. @ref CFG_VAR_TYPE_TIME must be defined first, because
      * the array index is used to specify the alarm number \<alarmNum\>,
@@ -103,24 +273,82 @@ static int32_t		l_KeepRecord = DFLT_KEEP_RECORD_DURATION;
 static const CFG_VAR_DEF l_CfgVarList[] =
 {
  { "ON_TIME_1",		       CFG_VAR_TYPE_TIME,	NULL		},
+ { "ON_TIME_2",		       CFG_VAR_TYPE_TIME,	NULL		},
+ { "ON_TIME_3",		       CFG_VAR_TYPE_TIME,	NULL		},
+ { "ON_TIME_4",		       CFG_VAR_TYPE_TIME,	NULL		},
+ { "ON_TIME_5",		       CFG_VAR_TYPE_TIME,	NULL		},
  { "OFF_TIME_1",	       CFG_VAR_TYPE_TIME,	NULL		},
+ { "OFF_TIME_2",	       CFG_VAR_TYPE_TIME,	NULL		},
+ { "OFF_TIME_3",	       CFG_VAR_TYPE_TIME,	NULL		},
+ { "OFF_TIME_4",	       CFG_VAR_TYPE_TIME,	NULL		},
+ { "OFF_TIME_5",	       CFG_VAR_TYPE_TIME,	NULL		},
+ { "SESSION_TIME_1",	       CFG_VAR_TYPE_TIME,	NULL		},
+ { "SESSION_TIME_2",	       CFG_VAR_TYPE_TIME,	NULL		},
+ { "WEEKDAYS_1",	       CFG_VAR_TYPE_WEEKDAYS,	&g_PowerWeekdays[0] },
+ { "WEEKDAYS_2",	       CFG_VAR_TYPE_WEEKDAYS,	&g_PowerWeekdays[1] },
+ { "WEEKDAYS_3",	       CFG_VAR_TYPE_WEEKDAYS,	&g_PowerWeekdays[2] },
+ { "WEEKDAYS_4",	       CFG_VAR_TYPE_WEEKDAYS,	&g_PowerWeekdays[3] },
+ { "WEEKDAYS_5",	       CFG_VAR_TYPE_WEEKDAYS,	&g_PowerWeekdays[4] },
  { "LB_FILTER_DURATION",       CFG_VAR_TYPE_INTEGER,    &g_LB_FilterDuration  },
+ { "LB1_FILTER_MS",            CFG_VAR_TYPE_INTEGER,    &g_LB_FilterMs[0]     },
+#if LB2_ENABLE
+ { "LB2_FILTER_MS",            CFG_VAR_TYPE_INTEGER,    &g_LB_FilterMs[1]     },
+#endif
+ { "LB_DEBOUNCE_ON_MS",        CFG_VAR_TYPE_INTEGER,    &g_LB_DebounceOn      },
+ { "LB_DEBOUNCE_OFF_MS",       CFG_VAR_TYPE_INTEGER,    &g_LB_DebounceOff     },
+ { "LB_SUMMARY_INTERVAL",      CFG_VAR_TYPE_INTEGER,    &g_LB_SummaryInterval },
  { "RFID_TYPE",		       CFG_VAR_TYPE_ENUM_1,	&g_RFID_Type	},
  { "RFID_POWER",	       CFG_VAR_TYPE_ENUM_2,	&g_RFID_Power	},
+#if RFID_READERS > 1
+ { "RFID2_TYPE",	       CFG_VAR_TYPE_ENUM_1,	&g_RFID2_Type	},
+ { "RFID2_POWER",	       CFG_VAR_TYPE_ENUM_2,	&g_RFID2_Power	},
+#endif
  { "RFID_DETECT_TIMEOUT",      CFG_VAR_TYPE_INTEGER,	&g_RFID_DetectTimeout },
+ { "RFID_ABSENT_TIMEOUT",      CFG_VAR_TYPE_INTEGER,	&g_RFID_AbsentDetectTimeout },
+ { "RFID_EARLY_OFF",           CFG_VAR_TYPE_INTEGER,	&g_RFID_EarlyOff },
+ { "RFID_DUTY_ON",             CFG_VAR_TYPE_INTEGER,	&g_RFID_DutyOn },
+ { "RFID_DUTY_PERIOD",         CFG_VAR_TYPE_INTEGER,	&g_RFID_DutyPeriod },
  { "AUDIO_POWER",              CFG_VAR_TYPE_ENUM_2,     &g_AudioPower	},
  { "AUDIO_CFG_VC",             CFG_VAR_TYPE_INTEGER,	&g_AudioCfg_VC	},
  { "AUDIO_CFG_ST",             CFG_VAR_TYPE_INTEGER,	&g_AudioCfg_ST	},
  { "AUDIO_CFG_IM",             CFG_VAR_TYPE_INTEGER,	&g_AudioCfg_IM	},
  { "AUDIO_CFG_RQ",             CFG_VAR_TYPE_INTEGER,	&g_AudioCfg_RQ	},
+ { "AUDIO_SERVICE_DATE",       CFG_VAR_TYPE_INTEGER,	&g_AudioServiceDate },
+ { "AUDIO_IDLE_TIMEOUT",       CFG_VAR_TYPE_INTEGER,	&g_AudioIdleTimeout },
  { "PLAYBACK",                 CFG_VAR_TYPE_DURATION,	&l_dfltKeepPlayback },
  { "RECORD",	               CFG_VAR_TYPE_DURATION,	&l_dfltKeepRecord   },
+ { "RECORD_NAMING",            CFG_VAR_TYPE_ENUM_3,	&g_RecordNaming     },
+ { "RECORD_PREROLL",           CFG_VAR_TYPE_INTEGER,	&g_AudioPreRoll     },
+ { "RECORD_SEGMENT",           CFG_VAR_TYPE_DURATION,	&g_AudioRecSegment  },
+#if SOUND_DETECT
+ { "SOUND_THRESHOLD",          CFG_VAR_TYPE_INTEGER,	&g_SoundThreshold   },
+ { "SOUND_HANG_TIME",          CFG_VAR_TYPE_INTEGER,	&g_SoundHangTime    },
+#endif
  { "PLAYBACK_TYPE",            CFG_VAR_TYPE_INTEGER,	&l_dfltPlayType     },
+ { "PLAYBACK_CHAIN",           CFG_VAR_TYPE_DURATION,	&g_AudioPlaybackChain },
+ { "SESSION_LENGTH",           CFG_VAR_TYPE_DURATION,	&l_SessionLength    },
+#if PLAY_THROTTLE
+ { "PLAYBACK_RATE",            CFG_VAR_TYPE_DURATION,	&g_PlaybackRate     },
+ { "PLAYBACK_BURST",           CFG_VAR_TYPE_INTEGER,	&g_PlaybackBurst    },
+#endif
+ { "PLAYLIST",                 CFG_VAR_TYPE_LIST,	&g_Playlist         },
+ { "PLAYLIST_NO_REPEAT",       CFG_VAR_TYPE_INTEGER,	&g_PlaylistNoRepeat },
+ { "STIM_SET_1",               CFG_VAR_TYPE_LIST,	&g_StimSet[0]       },
+ { "STIM_SET_2",               CFG_VAR_TYPE_LIST,	&g_StimSet[1]       },
+ { "STIM_SET_3",               CFG_VAR_TYPE_LIST,	&g_StimSet[2]       },
+ { "STIM_SET_4",               CFG_VAR_TYPE_LIST,	&g_StimSet[3]       },
+ { "LOG_LEVEL",                CFG_VAR_TYPE_INTEGER,	&g_LogLevel         },
+ { "DCF77_MAX_ERROR",          CFG_VAR_TYPE_INTEGER,	&g_DCF77_MaxError   },
+ { "GOV_SOC_SAVE",             CFG_VAR_TYPE_INTEGER,	&l_GovSocSave       },
+ { "GOV_SOC_CRITICAL",         CFG_VAR_TYPE_INTEGER,	&l_GovSocCritical   },
+#if SUPPLY_MON
+ { "SUPPLY_CURVE",             CFG_VAR_TYPE_LIST,	&g_SupplyCurve      },
+#endif
  { "ID",                       CFG_VAR_TYPE_ID,	        NULL	            },
  {  NULL,                      END_CFG_VAR_TYPE,        NULL		    }
 };
 
-/*!@brief Timer handle to keep the playback or record for a while. */
+/*!@brief msTimer handle to keep the playback or record for a while. */
 static volatile TIM_HDL	l_hdlPlayRec = NONE;
 
     /*!@brief List of all enum definitions. */
@@ -128,6 +356,7 @@ static const ENUM_DEF l_EnumList[] =
 {
     g_enum_RFID_Type,		// CFG_VAR_TYPE_ENUM_1
     g_enum_PowerOutput,		// CFG_VAR_TYPE_ENUM_2
+    g_enum_RecordNaming,	// CFG_VAR_TYPE_ENUM_3
 };
 
     /*!@brief Flag if playback should run. */
@@ -141,6 +370,9 @@ static volatile bool	l_flgAudioRfidPower;	// is false for default
 
 /*!@brief If current ID appears twice lock: true means locked, false means unlocked. */
 static volatile bool	l_flgTwiceIDLocked;	// is false for default
+
+    /*!@brief Flag if a stimulus session is currently run. */
+static volatile bool	l_flgSession;
 /*=========================== Forward Declarations ===========================*/
 
 static void	PlayRecAction (TIM_HDL hdl);
@@ -148,18 +380,19 @@ static void	PlaybackRun (void);
 static void	RecordRun (void);
 
 static void	PowerControl (int alarmNum);
-
-    /*!@brief Current state of the AudioPlaybackRun: true means ON, false means OFF. */
-static volatile bool	l_flgAudioPlayRun;	// is false for default
-
-    /*!@brief Current state of the AudioPlaybackStop: true means ON, false means OFF. */
-static volatile bool	l_flgAudioPlayStop; // is false for default
-
-    /*!@brief Current state of the AudiRecordRun: true means ON, false means OFF. */
-static volatile bool	l_flgAudioRecRun; // is false for default
-
-/*!@brief Current state of the AudiRecordStop: true means ON, false means OFF. */
-static volatile bool	l_flgAudioRecStop; // is false for default
+static void	SessionControl (int alarmNum);
+static bool	PowerOutputCheck (PWR_OUT output, bool enable);
+static uint32_t	PowerOutputApply (uint32_t mask, uint32_t enable);
+static void	ControlDefaults (void);
+static void	DevCfgGet (DEV_CFG *pCfg);
+static void	GovernorApply (GOV_LEVEL level);
+static int32_t	GovernorDuration (int32_t duration);
+static int32_t	GovernorVolume (int32_t volume);
+
+    /*!@brief Run and stop flags of playback and record, see @ref AUDIO_REQ.
+     * They are set by the timers and read by AudioCheck(), e.g. via
+     * IsControlPlayRun(). */
+static volatile uint32_t l_AudioReq;	// all flags are cleared for default
 
 /*!@brief Current state of the PlaybackType:  1 to 9. */
 static volatile int	AudioPlaybackType; // is <= 9 
@@ -184,19 +417,22 @@ int	i;
     for (i = 0;  i < NUM_PWR_OUT;  i++)
     {
 	/* Configure Power Enable Pin, switch it OFF per default */
-	GPIO_PinModeSet (GPIO_BIT_ADDR_TO_PORT(l_PwrOutDef[i].BitBandAddr),
-			 GPIO_BIT_ADDR_TO_PIN (l_PwrOutDef[i].BitBandAddr),
+	GPIO_PinModeSet (l_PwrOutDef[i].Port, l_PwrOutDef[i].Pin,
 			 gpioModePushPull, l_PwrOutDef[i].HighActive ? 0:1);
     }
 
     /* Get a timer handle to playback or record audio files for a while */
     if (l_hdlPlayRec == NONE)
-	l_hdlPlayRec = sTimerCreate (PlayRecAction);
+	l_hdlPlayRec = msTimerCreate (PlayRecAction);
     
     /* Use same routine for all power-related alarms */
     for (i = FIRST_POWER_ALARM;  i <= LAST_POWER_ALARM;  i++)
 	AlarmAction (i, PowerControl);
 
+    /* The stimulus sessions and their warm-up use another routine */
+    for (i = FIRST_SESSION_ALARM;  i <= LAST_SESSION_ALARM;  i++)
+	AlarmAction (i, SessionControl);
+
     /* Initialize configuration with default values */
     ClearConfiguration();
 }
@@ -221,16 +457,64 @@ int	i;
     {
 	if (AlarmIsEnabled(i))
 	{
-	    if (i >= ALARM_OFF_TIME_1)
-		ExecuteAlarmAction(i);	// OFF-Time: Switch device off
-
 	    AlarmDisable(i);		// Disable this alarm
+
+	    if (i >= ALARM_OFF_TIME_1)
+		ExecuteAlarmAction(i);	// empty schedule: Switch device off
 	}
     }
+
+    /* Disable the stimulus sessions */
+    for (i = FIRST_SESSION_ALARM;  i <= LAST_SESSION_ALARM;  i++)
+	AlarmDisable(i);
+
+    /* Set the configuration variables to their default values */
+    ControlDefaults();
+
+    l_AudioReq = 0;
+    
+    l_flgTwiceIDLocked = false;
+    l_flgPlaybackIsRun = false;
+    l_flgSession = false;
+
+    /* Deactivate timer */
+     if (l_hdlPlayRec != NONE)
+	  msTimerCancel (l_hdlPlayRec);
+      
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set the Default Configuration
+ *
+ * This routine sets all configuration variables to their default values.
+ * In contrast to ClearConfiguration(), it neither changes the power alarms,
+ * nor the state of the devices or a running playback or record.
+ *
+ ******************************************************************************/
+static void	ControlDefaults (void)
+{
+int	i;
+
+    /* Power windows are valid on all weekdays per default */
+    for (i = 0;  i < NUM_POWER_ALARMS;  i++)
+	g_PowerWeekdays[i] = WEEKDAYS_ALL;
     
+    /* Restore the configured settings before they are set again */
+    GovernorApply (GOV_NORMAL);
+
     /* Disable RFID functionality */
     g_RFID_Type = RFID_TYPE_NONE;
     g_RFID_Power = PWR_OUT_NONE;
+#if RFID_READERS > 1
+    g_RFID2_Type = RFID_TYPE_NONE;
+    g_RFID2_Power = PWR_OUT_NONE;
+#endif
+    g_RFID_AbsentDetectTimeout = DFLT_RFID_ABSENT_TIMEOUT;
+    g_RFID_EarlyOff = DFLT_RFID_EARLY_OFF;
+    g_RFID_DutyOn = 0;
+    g_RFID_DutyPeriod = 0;
     
     /* Disable Audio functionality */
     g_AudioPower = PWR_OUT_NONE;
@@ -238,24 +522,205 @@ int	i;
     g_AudioCfg_ST = 0;
     g_AudioCfg_IM = 0;
     g_AudioCfg_RQ = 0;
+    g_AudioServiceDate = 0;
+    g_AudioIdleTimeout = DFLT_AUDIO_IDLE_TIMEOUT;
+    g_AudioPlaybackChain = DFLT_PLAYBACK_CHAIN;
+    g_AudioPreRoll = DFLT_RECORD_PREROLL;
+    g_AudioRecSegment = DFLT_RECORD_SEGMENT;
+    g_RecordNaming = REC_NAME_SEQUENCE;
+#if SOUND_DETECT
+    g_SoundThreshold = 0;
+    g_SoundHangTime = DFLT_SOUND_HANG_TIME;
+#endif
     
     /* Disable Control functionality */
     l_KeepPlayback = 0;
     l_KeepRecord = 0;
     l_PlayType = 0;
-    
-    l_flgAudioPlayRun = false;
-    l_flgAudioPlayStop = false;
-    l_flgAudioRecRun = false;
-    l_flgAudioRecStop = false;
-    
-    l_flgTwiceIDLocked = false;
-    l_flgPlaybackIsRun = false;
-      
-    /* Deactivate timer */
-     if (l_hdlPlayRec != NONE)
-	  sTimerCancel (l_hdlPlayRec);
-      
+    l_SessionLength = 0;
+    g_Playlist.Cnt = 0;
+    for (i = 0;  i < PLAYLIST_STIM_SETS;  i++)
+	g_StimSet[i].Cnt = 0;
+    g_PlaylistNoRepeat = 0;
+    PlaylistReset();		// start with a new sequence
+#if PLAY_THROTTLE
+    g_PlaybackRate = 0;
+    g_PlaybackBurst = DFLT_PLAYBACK_BURST;
+#endif
+
+    /* Default log level and light barrier summary */
+    g_LogLevel = DFLT_LOG_LEVEL;
+    g_LB_SummaryInterval = DFLT_LB_SUMMARY_INTERVAL;
+
+    /* Light barriers use LB_FILTER_DURATION without debouncing */
+    for (i = 0;  i < LB_NUM;  i++)
+	g_LB_FilterMs[i] = 0;
+    g_LB_DebounceOn = 0;
+    g_LB_DebounceOff = 0;
+    g_DCF77_MaxError = DFLT_DCF77_MAX_ERROR;
+    l_GovSocSave = DFLT_GOV_SOC_SAVE;
+    l_GovSocCritical = DFLT_GOV_SOC_CRITICAL;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Reload the Configuration
+ *
+ * This routine reads the configuration file again while the system keeps
+ * running, e.g. when the SD-Card has been swapped, or by console command
+ * "CFG".  Unless <b>flgForce</b> is set, nothing is done if size and
+ * modification time of the file are unchanged, see CfgChanged().
+ * The ID table, the durations, and the power schedule are replaced by the
+ * new values.  The RFID reader or the Audio module are only initialized
+ * again if their settings have changed, otherwise they continue to run.
+ * Finally the devices are switched on or off, if the new power schedule
+ * requires another state at the current time.
+ *
+ * @param[in] filename
+ *	Name of the configuration file.
+ *
+ * @param[in] flgForce
+ *	If true, read the file even if it has not been changed.
+ *
+ ******************************************************************************/
+void	ControlConfigReload (char *filename, bool flgForce)
+{
+DEV_CFG	 oldCfg, newCfg;
+int	 i;
+
+    if (! flgForce  &&  ! CfgChanged (filename))
+    {
+	Log ("Configuration %s unchanged", filename);
+	return;
+    }
+
+    /* Compare the configured values, not those of the energy governor */
+    GovernorApply (GOV_NORMAL);
+    DevCfgGet (&oldCfg);
+
+    /* Disable the power and session alarms, the new schedule enables them */
+    for (i = FIRST_POWER_ALARM;  i <= LAST_SESSION_ALARM;  i++)
+	AlarmDisable(i);
+
+    ControlDefaults();
+    CfgRead (filename);
+    ControlCompileActions();
+
+    DevCfgGet (&newCfg);
+
+    /* Initialize only the devices whose settings have changed */
+    if (memcmp (&oldCfg, &newCfg, offsetof(DEV_CFG, AudioPower)) != 0)
+	RFID_Init();
+    else
+	Log ("RFID settings unchanged, reader keeps running");
+
+    if (memcmp (&oldCfg.AudioPower, &newCfg.AudioPower,
+		sizeof(DEV_CFG) - offsetof(DEV_CFG, AudioPower)) != 0)
+	AudioInit();
+    else
+	Log ("Audio settings unchanged, module keeps running");
+
+    /* Switch the devices only if the new schedule requires it */
+    if (g_PowerUpTime != 0
+    &&  PowerScheduleIsOn(NULL) != l_flgAudioRfidPower)
+	ExecuteAlarmAction (l_flgAudioRfidPower ? ALARM_OFF_TIME_1
+						: ALARM_ON_TIME_1);
+
+    /* New configuration - all tasks must check their state */
+    EVENT_POST_ALL();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the Device Settings
+ *
+ * This routine copies the configuration variables which are used by
+ * RFID_Init() and AudioInit() into a @ref DEV_CFG structure.
+ *
+ * @param[out] pCfg
+ *	Structure to be filled.
+ *
+ ******************************************************************************/
+static void	DevCfgGet (DEV_CFG *pCfg)
+{
+    memset (pCfg, 0, sizeof(DEV_CFG));	// clear padding for memcmp()
+
+    pCfg->RFID_Type   = g_RFID_Type;
+    pCfg->RFID_Power  = g_RFID_Power;
+#if RFID_READERS > 1
+    pCfg->RFID2_Type  = g_RFID2_Type;
+    pCfg->RFID2_Power = g_RFID2_Power;
+#endif
+    pCfg->AudioPower  = g_AudioPower;
+    pCfg->AudioCfg[0] = g_AudioCfg_VC;
+    pCfg->AudioCfg[1] = g_AudioCfg_ST;
+    pCfg->AudioCfg[2] = g_AudioCfg_IM;
+    pCfg->AudioCfg[3] = g_AudioCfg_RQ;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Compile the Actions of the Configuration
+ *
+ * This routine must be called after CfgRead().  It passes the configured
+ * default values for KEEP_PLAYBACK, KEEP_RECORD, PLAYBACK_TYPE, and
+ * PLAYBACK_BURST to CfgActionCompile(), which resolves them for all
+ * transponder IDs, so ControlUpdateID() gets the final values by one lookup.
+ * The volume and input mode are left at @ref DUR_INVALID, so IDs without
+ * their own values use AUDIO_CFG_VC and AUDIO_CFG_IM as currently set.
+ * Finally the warm-up alarm of each stimulus session is set
+ * @ref SESSION_WARMUP_MIN minutes before its SESSION_TIME_n.
+ *
+ ******************************************************************************/
+void	ControlCompileActions (void)
+{
+CFG_ACTION dflt;
+int8_t	 hour, minute;
+int	 i;
+
+    dflt.KeepPlayback = l_dfltKeepPlayback;
+    dflt.KeepRecord   = l_dfltKeepRecord;
+    dflt.PlayType     = l_dfltPlayType;
+#if PLAY_THROTTLE
+    dflt.PlayBurst    = g_PlaybackBurst;
+#else
+    dflt.PlayBurst    = 0;		// not used
+#endif
+    dflt.Volume       = DUR_INVALID;
+    dflt.InputMode    = DUR_INVALID;
+
+    CfgActionCompile (&dflt);
+
+    /* sessions need a SESSION_LENGTH and the Audio module */
+    for (i = 0;  i < NUM_SESSIONS;  i++)
+    {
+	AlarmDisable (ALARM_SESSION_WARM_1 + i);
+
+	if (! AlarmIsEnabled (ALARM_SESSION_1 + i))
+	    continue;
+
+	if (l_SessionLength <= 0  ||  g_AudioPower == PWR_OUT_NONE)
+	{
+	    LogError ("SESSION_TIME_%d needs SESSION_LENGTH and AUDIO_POWER",
+		      i + 1);
+	    AlarmDisable (ALARM_SESSION_1 + i);
+	    continue;
+	}
+
+	/* warm-up time, the alarm times are already adjusted for MESZ */
+	AlarmGet (ALARM_SESSION_1 + i, &hour, &minute);
+	minute -= SESSION_WARMUP_MIN;
+	if (minute < 0)
+	{
+	    minute += 60;
+	    hour = (hour == 0 ? 23 : hour - 1);
+	}
+	AlarmSet (ALARM_SESSION_WARM_1 + i, hour, minute);
+	AlarmEnable (ALARM_SESSION_WARM_1 + i);
+    }
 }
 
 
@@ -283,96 +748,90 @@ bool	IsAudioRfidOn (void)
  * @brief	Inform the control module about a new transponder ID
  *
  * This routine must be called to inform the control module about a new
- * transponder ID.
+ * transponder ID.  It is called by RFID_Check() in the main loop, for each
+ * ID that has been queued by the decoder or the detect timeout.
  *
  * @warning
- * This function calls a blocking delay routine, therefore it must not be
- * called from interrupt context!
+ * This function looks up the ID in the configuration and logs a message,
+ * therefore it must not be called from interrupt context!
  *
  ******************************************************************************/
-void	ControlUpdateID (char *transponderID)
+void	ControlUpdateID (TRANSPONDER_ID transponderID)
 {
-char	 line[120];
+char	*line;
 char	*pStr;
-ID_PARM	*pID;
+char	 idStr[ID_STR_SIZE];
+char	 durStr[DUR_STR_SIZE];
+const CFG_ACTION *pAction;
+CFG_MATCH match;
+bool	 flgThrottled = false;
 
 
-    pStr = line;
-    if(!l_flgTwiceIDLocked)
-    {      
-    pID = CfgLookupID (transponderID);
-    }
-    if (pID == NULL)
-    {
-	if(!l_flgTwiceIDLocked)
-        {
-        /* specified ID not found, look for an "ANY" entry */
-	pID = CfgLookupID ("ANY");
-        }
-	if (pID == NULL)
-	{
-	    if(!l_flgTwiceIDLocked)
-            {
-            /* no "ANY" entry defined, treat ID as "UNKNOWN" */
-	    pID = CfgLookupID ("UNKNOWN");
-            }
-	    if (pID == NULL)
-	    {
-		/* even no "UNKNOWN" entry exists - abort */
-		Log ("Transponder: %s not found - aborting", transponderID);
-		return;
-	    }
-	    else
-	    {
-		if(!l_flgTwiceIDLocked)
-                { 
-                 pStr += sprintf (pStr, "Transponder: %s not found -"
-				 " using UNKNOWN", transponderID); 
-                }
-	    }
-    
-	}
-	else
-	{
-	   if(!l_flgTwiceIDLocked)
-           {  
-           pStr += sprintf (pStr, "Transponder: %s not found -"
-			     " using ANY", transponderID);	   
-           }
-           else
-           {
-             l_flgTwiceIDLocked = true;
-           }
-        }
-    }
-    else
+    CfgIDToString (transponderID, idStr);
+
+    /* the main loop always finds a free block, see ScratchPool.c */
+    pStr = line = ScratchGet();
+    if (line == NULL)
     {
-	pStr += sprintf (pStr, "Transponder: %s", transponderID);
+	LogError ("Transponder: %s - no line buffer available", idStr);
+	return;
     }
-    
-    if(!l_flgTwiceIDLocked)
-    {
 
-    /* prepare the associated variables */
-    l_KeepPlayback = (pID->KeepPlayback == DUR_INVALID	? l_dfltKeepPlayback
-							: pID->KeepPlayback);
-    l_KeepRecord   = (pID->KeepRecord == DUR_INVALID	? l_dfltKeepRecord
-							: pID->KeepRecord);
-    l_PlayType     = (pID->PlayType  == DUR_INVALID	? l_dfltPlayType
-							: pID->PlayType);
-  
-      /* append current parameters to ID */
-      pStr += sprintf (pStr, ":%ld", l_KeepPlayback);
-      pStr += sprintf (pStr, ":%ld", l_KeepRecord);
-      pStr += sprintf (pStr, ":%ld", l_PlayType);
-       
-       l_flgTwiceIDLocked = true;
+#if VISIT_STATS
+    /* count the visit, even if the Audio module is locked */
+    VisitStatsID (transponderID);
+#endif
+
+    if (l_flgTwiceIDLocked)
+    {
+	pStr += StrFormat (pStr, "Transponder: %s - Audio: Is locked", idStr);
     }
     else
     {
-       pStr += sprintf (pStr, " - Audio: Is locked"); 
+	/* one lookup, defaults and the ANY/UNKNOWN fallback are resolved */
+	pAction = CfgLookupAction (transponderID, &match);
+	if (pAction == NULL)
+	{
+	    /* even no "UNKNOWN" entry exists - abort */
+	    LogEvent ("Transponder: %s not found - aborting", idStr);
+	    ScratchPut (line);
+	    return;
+	}
+
+	pStr += StrFormat (pStr, "Transponder: %s%s", idStr, l_MatchStr[match]);
+
+	/* prepare the associated variables */
+	l_KeepPlayback = GovernorDuration (pAction->KeepPlayback);
+	l_KeepRecord   = GovernorDuration (pAction->KeepRecord);
+	l_PlayType     = pAction->PlayType;
+
+	/* sent by the Audio module with the playback or record, if changed */
+	AudioParmSet (GovernorVolume (pAction->Volume), pAction->InputMode);
+
+#if PLAY_THROTTLE
+	/* a bird staying at the feeder must not start playback after playback */
+	if (l_KeepPlayback > 0
+	&&  ! ThrottleCheck (transponderID, pAction->PlayBurst))
+	{
+	    l_KeepPlayback = 0;
+	    flgThrottled = true;
+	}
+#endif
+
+	/* append current parameters to ID */
+	pStr += StrFormat (pStr, ":%s", CfgDurationToString (l_KeepPlayback, durStr));
+	pStr += StrFormat (pStr, ":%s", CfgDurationToString (l_KeepRecord, durStr));
+	pStr += StrFormat (pStr, ":%ld", l_PlayType);
+	if (flgThrottled)
+	    pStr += StrFormat (pStr, " - playback throttled");
+
+	l_flgTwiceIDLocked = true;
     }
-     Log(line);
+    LogEvent (line);
+    ScratchPut (line);
+
+       /* keep, continue, or stop the record of the arrival */
+       AudioPreRollDecide (l_KeepPlayback, l_KeepRecord);
   
        /* playback or record (may already be done) */
        if (l_KeepPlayback > 0)
@@ -385,7 +844,7 @@ ID_PARM	*pID;
            { 	
 	         /* start playing */
 	         PlaybackRun();
-                 sTimerStart (l_hdlPlayRec, l_KeepPlayback);
+                 msTimerStart (l_hdlPlayRec, l_KeepPlayback);
            }
         }
         else
@@ -400,7 +859,7 @@ ID_PARM	*pID;
                  /* start record */
 	           RecordRun(); 
                   /* start KeepRecord timer */
-                  sTimerStart (l_hdlPlayRec, l_KeepRecord);
+                  msTimerStart (l_hdlPlayRec, l_KeepRecord);
             }
           }
       }
@@ -428,12 +887,12 @@ static void	PlayRecAction (TIM_HDL hdl)
  
         /* Deactivate timer */
 	if (l_hdlPlayRec != NONE)
-	    sTimerCancel (l_hdlPlayRec);
+	    msTimerCancel (l_hdlPlayRec);
         
         /* Playback stop has been set - inform Audio module 
          * via IsControlPlayStop */
-        l_flgAudioPlayStop = true;
-        l_flgAudioPlayRun = false;
+        FLAG_SET(l_AudioReq, AUDIO_REQ_PLAY_STOP);
+        FLAG_CLR(l_AudioReq, AUDIO_REQ_PLAY_RUN);
         
         /* it follows a KEEP_RECORD duration */
 	if (l_KeepRecord > 0)
@@ -442,7 +901,7 @@ static void	PlayRecAction (TIM_HDL hdl)
             /* start record */
 	    RecordRun();
             /* start KeepRecord timer */
-            sTimerStart (l_hdlPlayRec, l_KeepRecord);
+            msTimerStart (l_hdlPlayRec, l_KeepRecord);
         }
         l_flgPlaybackRun = false;
     }
@@ -453,14 +912,27 @@ static void	PlayRecAction (TIM_HDL hdl)
         
         /* Deactivate timer */
         if (l_hdlPlayRec != NONE)
-	    sTimerCancel (l_hdlPlayRec);
+	    msTimerCancel (l_hdlPlayRec);
         
          /* Record stop has been set - inform Audio module 
           * via IsControlRecStop */
-         l_flgAudioRecStop = true;
-         l_flgAudioRecRun = false;
+         FLAG_SET(l_AudioReq, AUDIO_REQ_REC_STOP);
+         FLAG_CLR(l_AudioReq, AUDIO_REQ_REC_RUN);
     }
     l_flgTwiceIDLocked = false;
+
+    /* switch the Audio module off again after a session outside the window */
+    if (l_flgSession)
+    {
+	l_flgSession = false;
+	LogEvent ("Session: Finished");
+
+	if (! l_flgAudioRfidPower)
+	    AudioDisable();
+    }
+
+    ITM_TRACE_STATE(ITM_MOD_CONTROL, l_AudioReq);
+    EVENT_POST(EVT_AUDIO);
 }
 
 
@@ -469,7 +941,7 @@ static void	PlayRecAction (TIM_HDL hdl)
  * @brief	PlaybackRun for Control.c
  *
  * This routine initiates to playback sounds. This is done by setting
- * int AudioPlaybackType and l_flgAudioPlayRun. 
+ * int AudioPlaybackType and AUDIO_REQ_PLAY_RUN. 
  *
  ******************************************************************************/
 static void	PlaybackRun (void)
@@ -483,8 +955,10 @@ static void	PlaybackRun (void)
         /* Playback run with a new Playback_Type has been set - inform Audio module 
          * via IsControlPlaybackType(), IsControlPlayRun */
         AudioPlaybackType = l_PlayType;
-        l_flgAudioPlayRun = true;
-        l_flgAudioPlayStop = false;
+        FLAG_SET(l_AudioReq, AUDIO_REQ_PLAY_RUN);
+        FLAG_CLR(l_AudioReq, AUDIO_REQ_PLAY_STOP);
+        ITM_TRACE_STATE(ITM_MOD_CONTROL, l_AudioReq);
+        EVENT_POST(EVT_AUDIO);
     }    
 }
 
@@ -494,7 +968,7 @@ static void	PlaybackRun (void)
  * @brief	RecordRun for Control.c
  *
  * This routine initiates to record sounds. This is done by setting
- * l_flgAudioRecRun.
+ * AUDIO_REQ_REC_RUN.
  *
  ******************************************************************************/
 static void	RecordRun (void)
@@ -506,8 +980,10 @@ static void	RecordRun (void)
        l_flgPlaybackIsRun = false;
         
        /* Record run has been set - inform Audio module via IsControlRecRun */
-       l_flgAudioRecRun = true;
-       l_flgAudioRecStop = false;
+       FLAG_SET(l_AudioReq, AUDIO_REQ_REC_RUN);
+       FLAG_CLR(l_AudioReq, AUDIO_REQ_REC_STOP);
+       ITM_TRACE_STATE(ITM_MOD_CONTROL, l_AudioReq);
+       EVENT_POST(EVT_AUDIO);
    }
 }
 
@@ -525,7 +1001,7 @@ static void	RecordRun (void)
  ******************************************************************************/
 bool	IsControlPlayRun ()
 {
-    return l_flgAudioPlayRun;
+    return FLAG_TEST(l_AudioReq, AUDIO_REQ_PLAY_RUN);
 }
 
 
@@ -558,7 +1034,7 @@ int	IsControlPlaybackType ()
  ******************************************************************************/
 bool	IsControlRecRun (void)
 {
-    return l_flgAudioRecRun;
+    return FLAG_TEST(l_AudioReq, AUDIO_REQ_REC_RUN);
 }
 
 
@@ -575,7 +1051,7 @@ bool	IsControlRecRun (void)
  ******************************************************************************/
 bool	IsControlPlayStop (void)
 {
-    return l_flgAudioPlayStop;
+    return FLAG_TEST(l_AudioReq, AUDIO_REQ_PLAY_STOP);
 }
 
 
@@ -592,7 +1068,7 @@ bool	IsControlPlayStop (void)
  ******************************************************************************/
 bool	IsControlRecStop (void)
 {
-    return l_flgAudioRecStop;
+    return FLAG_TEST(l_AudioReq, AUDIO_REQ_REC_STOP);
 }
 
 
@@ -606,10 +1082,8 @@ bool	IsControlRecStop (void)
  ******************************************************************************/
 void	ControlPowerFailHandler (void)
 {
-int	i;
-
     if (l_hdlPlayRec != NONE)
-	sTimerCancel (l_hdlPlayRec);
+	msTimerCancel (l_hdlPlayRec);
 
 #ifdef LOGGING
     /* Generate Log Message */
@@ -617,8 +1091,7 @@ int	i;
 #endif
 
     /* Switch off all power outputs immediately */
-    for (i = 0;  i < NUM_PWR_OUT;  i++)
-	PowerOutput ((PWR_OUT)i, PWR_OFF);
+    PowerOutputMask (PWR_MASK_ALL, 0);
 }
 
 
@@ -638,10 +1111,108 @@ int	i;
  *****************************************************************************/
 void	PowerOutput (PWR_OUT output, bool enable)
 {
-    
-    /* Parameter check */
+    if (PowerOutputCheck (output, enable))
+	PowerOutputMask (PWR_MASK(output), enable ? PWR_MASK(output) : 0);
+}
+
+
+/******************************************************************************
+ *
+ * @brief	Switch the specified power output without log message
+ *
+ * This routine enables or disables the specified power output like
+ * PowerOutput(), but does not log the change.  It is used to pulse an
+ * output, e.g. for the duty cycling of the RFID reader.
+ *
+ * @param[in] output
+ *	Power output to be changed.
+ *
+ * @param[in] enable
+ *	If true (PWR_ON), the power output will be enabled, false (PWR_OFF)
+ *	disables it.
+ *
+ * @return
+ *	The value <i>true</i> if the state of the power output has changed.
+ *
+ *****************************************************************************/
+bool	PowerOutputSwitch (PWR_OUT output, bool enable)
+{
+    if (! PowerOutputCheck (output, enable))
+	return false;
+
+    return (PowerOutputApply (PWR_MASK(output),
+			      enable ? PWR_MASK(output) : 0) != 0);
+}
+
+
+/******************************************************************************
+ *
+ * @brief	Switch a set of power outputs on or off
+ *
+ * This routine switches all power outputs of <b>mask</b> at once, i.e. the
+ * output register of each GPIO port is written only once.  The outputs which
+ * changed their state are logged in one message.  It may be called from
+ * interrupt context, e.g. for load shedding by ControlPowerFailHandler().
+ *
+ * @param[in] mask
+ *	Power outputs to be changed, see PWR_MASK() and @ref PWR_MASK_ALL.
+ *
+ * @param[in] enable
+ *	Power outputs of <b>mask</b> to be enabled, all others of <b>mask</b>
+ *	are disabled.
+ *
+ * @return
+ *	Mask of the power outputs which have changed their state.
+ *
+ *****************************************************************************/
+uint32_t PowerOutputMask (uint32_t mask, uint32_t enable)
+{
+uint32_t changed = PowerOutputApply (mask, enable);
+#ifdef LOGGING
+char	 line[80];
+char	*pStr = line;
+const char *pSep = "";
+int	 i;
+
+    if (changed == 0)
+	return 0;	// nothing has been changed
+
+    pStr += StrFormat (pStr, "Power Output");
+    for (i = 0;  i < NUM_PWR_OUT;  i++)
+    {
+	if (changed & PWR_MASK(i))
+	{
+	    pStr += StrFormat (pStr, "%s %s %sabled", pSep,
+			       g_enum_PowerOutput[i],
+			       enable & PWR_MASK(i) ? "en":"dis");
+	    pSep = ",";
+	}
+    }
+    Log ("%s", line);
+#endif
+
+    return changed;
+}
+
+
+/******************************************************************************
+ *
+ * @brief	Check the power output parameter
+ *
+ * @param[in] output
+ *	Power output to be changed, PWR_OUT_NONE is ignored.
+ *
+ * @param[in] enable
+ *	New state of the output, for the error message only.
+ *
+ * @return
+ *	The value <i>true</i> if the output is valid.
+ *
+ *****************************************************************************/
+static bool	PowerOutputCheck (PWR_OUT output, bool enable)
+{
     if (output == PWR_OUT_NONE)
-	return;		// power output not assigned, nothing to be done
+	return false;	// power output not assigned, nothing to be done
 
     if ((PWR_OUT)0 > output  ||  output >= NUM_PWR_OUT)
     {
@@ -649,21 +1220,75 @@ void	PowerOutput (PWR_OUT output, bool enable)
 	/* Generate Error Log Message */
 	LogError ("PowerOutput(%d, %d): Invalid output parameter",
 		  output, enable);
+#else
+	(void) enable;
 #endif
-	return;
+	return false;
     }
 
-    /* See if Power Output is already in the right state */
-    if ((bool)*l_PwrOutDef[output].BitBandAddr == enable)
-	return;		// Yes - nothing to be done
+    return true;
+}
 
-    /* Switch power output on or off */
-    *l_PwrOutDef[output].BitBandAddr = enable;
 
-#ifdef LOGGING
-    Log ("Power Output %s %sabled",
-	 g_enum_PowerOutput[output], enable ? "en":"dis");
-#endif
+/******************************************************************************
+ *
+ * @brief	Apply a set of power output changes
+ *
+ * This routine determines which outputs of <b>mask</b> really change their
+ * state, and collects their pins per GPIO port.  Then DOUT of each affected
+ * port is written once with interrupts disabled.
+ *
+ * @param[in] mask
+ *	Power outputs to be changed.
+ *
+ * @param[in] enable
+ *	Power outputs of <b>mask</b> to be enabled.
+ *
+ * @return
+ *	Mask of the power outputs which have changed their state.
+ *
+ *****************************************************************************/
+static uint32_t	PowerOutputApply (uint32_t mask, uint32_t enable)
+{
+uint32_t changed, todo, setBits, clrBits;
+GPIO_Port_TypeDef port;
+int	 i, j;
+
+    INT_Disable();
+
+    /* See which Power Outputs are not already in the right state */
+    for (changed = 0, i = 0;  i < NUM_PWR_OUT;  i++)
+    {
+	if ((mask & PWR_MASK(i))
+	&&  IsPowerOutputOn ((PWR_OUT)i) != ((enable & PWR_MASK(i)) != 0))
+	    changed |= PWR_MASK(i);
+    }
+
+    /* Write DOUT once for all outputs of the same port */
+    for (todo = changed, i = 0;  todo != 0;  i++)
+    {
+	if (! (todo & PWR_MASK(i)))
+	    continue;
+
+	port = l_PwrOutDef[i].Port;
+	setBits = clrBits = 0;
+	for (j = i;  j < NUM_PWR_OUT;  j++)
+	{
+	    if ((todo & PWR_MASK(j))  &&  l_PwrOutDef[j].Port == port)
+	    {
+		if (enable & PWR_MASK(j))
+		    setBits |= (1 << l_PwrOutDef[j].Pin);
+		else
+		    clrBits |= (1 << l_PwrOutDef[j].Pin);
+		todo &= ~PWR_MASK(j);
+	    }
+	}
+	GPIO->P[port].DOUT = (GPIO->P[port].DOUT & ~clrBits) | setBits;
+    }
+
+    INT_Enable();
+
+    return changed;
 }
 
 
@@ -679,6 +1304,8 @@ void	PowerOutput (PWR_OUT output, bool enable)
  *****************************************************************************/
 bool	IsPowerOutputOn (PWR_OUT output)
 {
+const PWR_OUT_DEF *pDef = &l_PwrOutDef[output];
+
     /* Parameter check */
     if (output == PWR_OUT_NONE)
 	return false;	// power output not assigned, return false (off)
@@ -686,7 +1313,152 @@ bool	IsPowerOutputOn (PWR_OUT output)
     EFM_ASSERT ((PWR_OUT)0 <= output  &&  output < NUM_PWR_OUT);
 
     /* Determine the current state of this power output */
-    return (*l_PwrOutDef[output].BitBandAddr ? true : false);
+    return (PWR_OUT_BIT(pDef) ? true : false);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Energy Governor
+ *
+ * This routine is called by BatteryCheck() with the current state of charge
+ * of the battery.  If it drops below GOV_SOC_SAVE or GOV_SOC_CRITICAL, the
+ * governor changes to the respective energy level, which stretches the
+ * battery monitoring interval, reduces RFID_DETECT_TIMEOUT, shortens the
+ * PLAYBACK and RECORD durations, and lowers the volume AUDIO_CFG_VC, see
+ * @ref l_GovLevelDef.  A level is left when the state of charge has risen
+ * @ref GOV_SOC_HYSTERESIS above its threshold.  Each change is logged.
+ * A threshold of 0 disables the respective level.
+ *
+ * @param[in] soc
+ *	Relative state of charge of the battery in [%].
+ *
+ ******************************************************************************/
+void	ControlEnergyGovernor (int soc)
+{
+GOV_LEVEL level = l_GovLevel;
+
+    /* Enter a lower level immediately, leave it with hysteresis */
+    if (soc < l_GovSocCritical)
+	level = GOV_CRITICAL;
+    else if (soc < l_GovSocSave)
+    {
+	if (level != GOV_CRITICAL
+	||  soc >= l_GovSocCritical + GOV_SOC_HYSTERESIS)
+	    level = GOV_SAVE;
+    }
+    else if (level == GOV_NORMAL
+	 ||  soc >= l_GovSocSave + GOV_SOC_HYSTERESIS)
+	level = GOV_NORMAL;
+    else if (level == GOV_CRITICAL
+	 &&  soc >= l_GovSocCritical + GOV_SOC_HYSTERESIS)
+	level = GOV_SAVE;
+
+    if (level == l_GovLevel)
+	return;			// no change
+
+    GovernorApply (level);
+
+    Log ("Energy Governor: SoC %d%%, level %s, RFID_DETECT_TIMEOUT=%lds,"
+	 " AUDIO_CFG_VC=%ld, durations %d%%", soc, l_GovLevelDef[level].Name,
+	 g_RFID_DetectTimeout, g_AudioCfg_VC,
+	 l_GovLevelDef[level].DurationPercent);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Apply Energy Level
+ *
+ * This routine sets the RFID detect timeout, the audio volume and the
+ * battery monitoring interval according to the specified energy level.  The
+ * configured values are saved when leaving GOV_NORMAL, and restored when
+ * returning to it.
+ *
+ * @param[in] level
+ *	New energy level.
+ *
+ ******************************************************************************/
+static void	GovernorApply (GOV_LEVEL level)
+{
+const GOV_LEVEL_DEF *pDef = &l_GovLevelDef[level];
+
+    if (level == l_GovLevel)
+	return;
+
+    /* Save the configured values */
+    if (l_GovLevel == GOV_NORMAL)
+    {
+	l_GovCfgDetectTimeout = g_RFID_DetectTimeout;
+	l_GovCfgVC = g_AudioCfg_VC;
+    }
+
+    g_RFID_DetectTimeout = l_GovCfgDetectTimeout * pDef->DetectPercent / 100;
+    if (g_RFID_DetectTimeout < 1)
+	g_RFID_DetectTimeout = 1;
+
+    /* A volume of 0 means "not configured" */
+    g_AudioCfg_VC = l_GovCfgVC;
+    if (g_AudioCfg_VC > 0)
+    {
+	if (g_AudioCfg_VC > 1U + pDef->VolumeReduce)
+	    g_AudioCfg_VC -= pDef->VolumeReduce;
+	else
+	    g_AudioCfg_VC = 1;
+    }
+
+    BatteryMonIntervalScale (pDef->BatMonFactor);
+
+    l_GovLevel = level;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Governor Duration
+ *
+ * This routine scales a PLAYBACK or RECORD duration according to the current
+ * energy level.
+ *
+ * @param[in] duration
+ *	Configured duration in [ms].
+ *
+ * @return
+ *	Duration in [ms] for the current energy level.
+ *
+ ******************************************************************************/
+static int32_t	GovernorDuration (int32_t duration)
+{
+    if (duration <= 0  ||  l_GovLevel == GOV_NORMAL)
+	return duration;	// nothing to be scaled
+
+    return duration / 100 * l_GovLevelDef[l_GovLevel].DurationPercent;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Governor Volume
+ *
+ * This routine reduces the volume of a transponder ID like AUDIO_CFG_VC
+ * according to the current energy level.
+ *
+ * @param[in] volume
+ *	Volume 1 to 31, or a negative value for AUDIO_CFG_VC.
+ *
+ * @return
+ *	Volume for the current energy level.
+ *
+ ******************************************************************************/
+static int32_t	GovernorVolume (int32_t volume)
+{
+int32_t	reduce;
+
+    if (volume <= 0  ||  l_GovLevel == GOV_NORMAL)
+	return volume;		// nothing to be reduced
+
+    reduce = l_GovLevelDef[l_GovLevel].VolumeReduce;
+    return (volume > 1 + reduce ? volume - reduce : 1);
 }
 
 
@@ -696,6 +1468,9 @@ bool	IsPowerOutputOn (PWR_OUT output)
  *
  * This routine is called when one of the power alarm times has been reached.
  * The alarm number is an enum value @ref ALARM_ON_TIME_1.<br>
+ * Since the power windows may overlap, or be restricted to some weekdays,
+ * the switching state is always taken from the power schedule, see
+ * PowerScheduleIsOn().<br>
  * When an RFID reader has been installed, the function decides whether to
  * call RFID_Enable(), or RFID_Disable().  If Audio module has been configured,
  * this will also be switched on or off together the RFID reader.
@@ -710,21 +1485,99 @@ int	 pwrState;
 		&& alarmNum <= LAST_POWER_ALARM);
 
     /* Determine switching state */
-    pwrState = (alarmNum >= ALARM_OFF_TIME_1 ? PWR_OFF:PWR_ON);
+    pwrState = (PowerScheduleIsOn(NULL) ? PWR_ON:PWR_OFF);
 
     /* RFID reader and Audio module are always switched on or off together */
     if (pwrState == PWR_ON)
     {
         l_flgAudioRfidPower = true;
+#if PWR_SEQ
+	PowerSeqStart();	// staggered power-up, see PowerSeq.c
+#else
         RFIDPower_Enable();
         AudioEnable();
+#endif
     }
     else
     {
+#if PWR_SEQ
+       PowerSeqCancel();
+#endif
        l_flgAudioRfidPower = false;
-       l_flgTwiceIDLocked = false;
        RFID_Disable();
-       AudioDisable();
+
+       /* a running session keeps the Audio module until its end */
+       if (! l_flgSession)
+       {
+	   l_flgTwiceIDLocked = false;
+	   AudioDisable();
+       }
     }
-    g_flgIRQ = true;	// keep on running
+    EVENT_POST(EVT_WAKE);	// keep on running
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Alarm routine for Stimulus Sessions
+ *
+ * This routine is called when a SESSION_TIME_n, or its warm-up time
+ * @ref SESSION_WARMUP_MIN minutes earlier, has been reached.  The warm-up
+ * alarm powers the Audio module on, also outside the power schedule, so it
+ * is ready when the session starts.  Until then the system stays in EM2.
+ * Since alarms are due at the first second of their minute, the playback of
+ * PLAYBACK_TYPE starts at the scheduled time and lasts SESSION_LENGTH, which
+ * is scaled by the energy governor like the durations of an ID.  The session
+ * uses the timer of ControlUpdateID(), so transponder IDs are locked until
+ * PlayRecAction() ends it.  A record of a visit is stopped for the session.
+ *
+ * @param[in] alarmNum
+ *	Alarm number, @ref ALARM_SESSION_1 to @ref ALARM_SESSION_WARM_2.
+ *
+ ******************************************************************************/
+static void	SessionControl (int alarmNum)
+{
+char	 durStr[DUR_STR_SIZE];
+int32_t	 duration;
+
+    /* Parameter check */
+    EFM_ASSERT (FIRST_SESSION_ALARM <= alarmNum
+		&& alarmNum <= LAST_SESSION_ALARM);
+
+    if (alarmNum >= ALARM_SESSION_WARM_1)
+    {
+	Log ("Session %d: Audio warm-up", alarmNum - ALARM_SESSION_WARM_1 + 1);
+	AudioEnable();
+	return;
+    }
+
+    duration = GovernorDuration (l_SessionLength);
+    if (duration <= 0  ||  l_hdlPlayRec == NONE)
+    {
+	Log ("Session %d: Skipped", alarmNum - ALARM_SESSION_1 + 1);
+	if (! l_flgSession  &&  ! l_flgAudioRfidPower)
+	    AudioDisable();
+	return;
+    }
+
+    /* a record of a visit is stopped, the session takes precedence */
+    if (! l_flgPlaybackRun)
+    {
+	FLAG_SET(l_AudioReq, AUDIO_REQ_REC_STOP);
+	FLAG_CLR(l_AudioReq, AUDIO_REQ_REC_RUN);
+    }
+
+    l_flgSession = true;
+    l_flgTwiceIDLocked = true;	// visits must not cut the session short
+    l_KeepRecord = 0;
+    l_PlayType = l_dfltPlayType;
+    AudioParmSet (-1, -1);	// AUDIO_CFG_VC and AUDIO_CFG_IM
+
+    LogEvent ("Session %d: Playback type %ld for %s",
+	      alarmNum - ALARM_SESSION_1 + 1, l_PlayType,
+	      CfgDurationToString (duration, durStr));
+
+    AudioEnable();		// in case the warm-up has been missed
+    PlaybackRun();
+    msTimerStart (l_hdlPlayRec, duration);
 }
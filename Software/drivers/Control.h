@@ -2,9 +2,17 @@
  * @file
  * @brief	Header file of module Control.c
  * @author	Ralf Gerhauser
- * @version	2017-01-25
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Added SESSION_WARMUP_MIN.
+2026-10-15,agnt	Added PWR_MASK(), PWR_MASK_ALL, and PowerOutputMask().
+2026-10-15,agnt	Added prototype for ControlConfigReload().
+2026-10-15,agnt	Added prototype for PowerOutputSwitch().
+2026-10-14,agnt	Added prototype for ControlCompileActions().
+2026-10-14,agnt	Added ENERGY_GOVERNOR and ControlEnergyGovernor().
+2026-10-14,agnt	ControlUpdateID() takes a binary TRANSPONDER_ID.
+		Default durations are specified in milliseconds.
 2020-02-06,feeder is MomoAudio
 2017-01-25,rage	Initial version.
 */
@@ -28,13 +36,46 @@ Revision History:
 #endif
 
 #ifndef DFLT_KEEP_PLAYING_DURATION
-    /*!@brief Default PLAYING duration for the audio module (in seconds). */
-    #define DFLT_KEEP_PLAYING_DURATION	120	// 2min
+    /*!@brief Default PLAYING duration for the audio module (in ms). */
+    #define DFLT_KEEP_PLAYING_DURATION	(120 * 1000)	// 2min
 #endif
 
 #ifndef DFLT_KEEP_RECORD_DURATION
-    /*!@brief Default RECORD duration for the audio module (in seconds). */
-    #define DFLT_KEEP_RECORD_DURATION	240	// 4min
+    /*!@brief Default RECORD duration for the audio module (in ms). */
+    #define DFLT_KEEP_RECORD_DURATION	(240 * 1000)	// 4min
+#endif
+
+#ifndef SESSION_WARMUP_MIN
+    /*!@brief Minutes the Audio module is powered on before the start time
+     * of a stimulus session, see SESSION_TIME_1.  If AUDIO_IDLE_TIMEOUT is
+     * set, it should be longer, otherwise the module is powered off again
+     * before the session starts.
+     */
+    #define SESSION_WARMUP_MIN		1
+#endif
+
+/*!@brief Set this define 1 to enable the energy governor, see
+ * ControlEnergyGovernor().
+ */
+#ifndef ENERGY_GOVERNOR
+    #define ENERGY_GOVERNOR		0
+#endif
+
+#ifndef DFLT_GOV_SOC_SAVE
+    /*!@brief Default state of charge in [%] to enter energy level SAVE. */
+    #define DFLT_GOV_SOC_SAVE		30
+#endif
+
+#ifndef DFLT_GOV_SOC_CRITICAL
+    /*!@brief Default state of charge in [%] to enter energy level CRITICAL. */
+    #define DFLT_GOV_SOC_CRITICAL	10
+#endif
+
+#ifndef GOV_SOC_HYSTERESIS
+    /*!@brief The state of charge in [%] must rise by this value above a
+     * threshold, before the governor returns to the higher level.
+     */
+    #define GOV_SOC_HYSTERESIS		5
 #endif
 
     /*!@brief Power output selection - keep in sync with string array
@@ -48,6 +89,12 @@ typedef enum
     NUM_PWR_OUT
 } PWR_OUT;
 
+    /*!@brief Bit of a power output in the mask of PowerOutputMask(). */
+#define PWR_MASK(output)	(1UL << (output))
+
+    /*!@brief Mask of all power outputs. */
+#define PWR_MASK_ALL		(PWR_MASK(NUM_PWR_OUT) - 1)
+
     /*!@brief Power control. */
 //@{
 #define PWR_OFF		false	//!< Switch power output off (disable power)
@@ -66,6 +113,12 @@ void	ControlInit (void);
     /* Clear Configuration variables (set default values) */
 void	ClearConfiguration (void);
 
+    /* Resolve the per-ID actions after the configuration has been read */
+void	ControlCompileActions (void);
+
+    /* Apply a changed configuration file without switching devices off */
+void	ControlConfigReload (char *filename, bool flgForce);
+
     /* Determine if Audio or Rfid is on */
 bool	IsAudioRfidOn (void);
 
@@ -85,14 +138,19 @@ bool	IsControlPlayStop (void);
 bool	IsControlRecStop (void);
 
     /* Inform the control module about a new transponder ID */
-void	ControlUpdateID (char *transponderID);
+void	ControlUpdateID (TRANSPONDER_ID transponderID);
 
     /* Switch power output on or off */
 void	PowerOutput	(PWR_OUT output, bool enable);
+bool	PowerOutputSwitch (PWR_OUT output, bool enable);
 bool	IsPowerOutputOn (PWR_OUT output);
+uint32_t PowerOutputMask (uint32_t mask, uint32_t enable);
 
     /* Power Fail Handler of the control module */
 void	ControlPowerFailHandler (void);
 
+    /* Adapt the settings to the battery state of charge */
+void	ControlEnergyGovernor (int soc);
+
 
 #endif /* __INC_Control_h */
@@ -0,0 +1,81 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Selective Critical Sections
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * INT_Disable() sets PRIMASK, i.e. it locks out all interrupts, even those
+ * which never touch the protected data.  The critical sections of this file
+ * use BASEPRI instead: CritEnter() only masks the interrupts with the given
+ * priority level and all lower ones (numerically greater), the interrupts of
+ * a higher priority are still served.
+ *
+ * Each shared structure declares the priority of its most urgent user as its
+ * ceiling, see the INT_CEIL_xxx defines in config.h.  Every routine which
+ * accesses the structure, from the main loop or from an interrupt service
+ * routine at or below the ceiling, does so between CritEnter() and
+ * CritExit().  A ceiling of 0 is not possible, since a BASEPRI of 0 disables
+ * the masking - such structures still need INT_Disable().
+ *
+ * The sections may be nested, CritEnter() never lowers the current mask, and
+ * CritExit() restores the value which has been returned by CritEnter().  Do
+ * not sleep in a section, a masked interrupt does not wake up the MCU.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_CritSect_h
+#define __INC_CritSect_h
+
+/*=============================== Header Files ===============================*/
+
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Saved mask of a critical section, see CritEnter(). */
+typedef uint32_t	CRIT_STATE;
+
+/*================================ Functions =================================*/
+
+/***************************************************************************//**
+ *
+ * @brief	Enter a Critical Section
+ *
+ * @param[in] ceiling
+ *	Priority level of the most urgent user of the protected structure,
+ *	1 to 7.
+ *
+ * @return
+ *	Previous mask, to be passed to CritExit().
+ *
+ ******************************************************************************/
+static inline CRIT_STATE CritEnter (uint32_t ceiling)
+{
+CRIT_STATE state = __get_BASEPRI();
+uint32_t   mask  = (ceiling << (8 - __NVIC_PRIO_BITS)) & 0xFF;
+
+    if (state == 0  ||  mask < state)
+	__set_BASEPRI (mask);
+
+    return state;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Leave a Critical Section
+ *
+ * @param[in] state
+ *	Mask returned by the corresponding CritEnter().
+ *
+ ******************************************************************************/
+static inline void CritExit (CRIT_STATE state)
+{
+    __set_BASEPRI (state);
+}
+
+
+#endif /* __INC_CritSect_h */
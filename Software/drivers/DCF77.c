@@ -2,7 +2,7 @@
  * @file
  * @brief	DCF77 Atomic Clock Decoder
  * @author	Ralf Gerhauser
- * @version	2020-05-12
+ * @version	2026-10-15
  *
  * This module implements an Atomic Clock Decoder for the signal of the
  * German-based DCF77 long wave transmitter.
@@ -39,6 +39,46 @@
  * indicator for receiving a DCF77 signal, please refer to the configuration
  * parameters @ref DCF77_DISPLAY_PROGRESS and @ref DCF77_INDICATOR.
  *
+ * If @ref DCF77_SAMPLE_MODE is 1, only the rising edge of bit 0 and of the
+ * minute mark generate an interrupt.  The other bits are sampled by an
+ * msTimer, see SignalSample().  The sampled level is converted into the
+ * time stamps of a 100ms or 200ms pulse, which are then passed to the same
+ * DCF77Handler() as the real edges.  The EFM32G provides no timer that is
+ * able to capture edges in EM2, so the pulse widths cannot be collected by
+ * hardware.
+ *
+ * If @ref DCF77_VOTE_FRAMES is not 0, all bits of a frame are collected in a
+ * 64-bit value and the recent frames are kept in a history.  Instead of
+ * requiring FRAME_SEQ_CNT consecutive error-free frames, FrameVote() checks
+ * the parity of each field separately and uses the values which occur most
+ * often in the history.
+ *
+ * The received time is passed to TimeSrcSync(), which sets the system clock
+ * and converts the alarm times on a change between MEZ and MESZ.  The DCF77
+ * receiver is one of the time sources of TimeSrc.c, see @ref g_TimeSrcDCF77.
+ *
+ * If @ref DCF77_ADAPTIVE_SYNC is 1, TimeSynchronize() measures the deviation
+ * of the system clock since the previous synchronization.  The daily wake-up
+ * is skipped while the expected error stays below @ref g_DCF77_MaxError, see
+ * SyncSchedule() and DCF77WakeUp().  With @ref TEMP_COMP, only the residual
+ * error after the temperature compensation is measured, see TempComp.c.
+ *
+ * If @ref DCF77_LEARN_WINDOW is 1, every daily synchronization attempt is
+ * recorded with the hour (MEZ) it started in, whether it succeeded, and the
+ * minutes it took.  The records are programmed into two flash pages, which
+ * are defined by the linker script as <b>DCFHIST</b>, in the same way as
+ * RecordSeq.c does.  When a page is full, the other one is erased, so the
+ * histogram always covers the recent 128 to 256 attempts.  LearnSchedule()
+ * moves @ref ALARM_DCF77_WAKE_UP to minute 55 of the hour with the best
+ * success rate, hours without any attempt are tried first when the current
+ * one fails.  On the last Sundays of March and October the wake-up stays at
+ * 01:55 MEZ to receive the change of the time zone.  While an attempt is
+ * running, LearnCheck() counts the valid and invalid pulse widths per minute,
+ * and aborts the attempt when the signal has been futile for several minutes
+ * or @ref DCF77_SYNC_TIMEOUT has elapsed.  With @ref DCF77_SAMPLE_MODE, the
+ * sampled bits always have a valid width, so a weak signal is detected while
+ * searching for the minute mark only.
+ *
  * @see
  * https://de.wikipedia.org/wiki/DCF77 for a description of the DCF77 signal,
  * and the <a href="../X200_DCF77.pdf">data sheet</a> of the DCF77
@@ -57,6 +97,32 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	The hourly reception statistics use 8-bit counters.
+2026-10-15,agnt	The receiver is no longer accounted in an energy ledger.
+2026-10-15,agnt	Registered DCF77Check() as task of the main loop, see
+		TASK_REGISTER().
+2026-10-15,agnt	The signal supervisor is started by sTimerStartSlack(), see
+		DCF77_SUPERVISOR_SLACK.
+2026-10-15,agnt	Added DCF77_LEARN_WINDOW to learn the hour with the best
+		reception, and to abort futile attempts, see LearnSchedule()
+		and LearnCheck().
+2026-10-15,agnt	TimeSynchronize: The system clock is set and the alarm times
+		are converted by TimeSrcSync(), see TimeSrc.c.  Added
+		g_TimeSrcDCF77.
+2026-10-15,agnt	Time synchronization and time zone changes are logged by
+		LogEvent(), see LOG_PRIORITY.
+2026-10-15,agnt	DCF77Handler: Pulse and pause lengths are measured with the
+		monotonic clock, see ClockMonoStamp(), so the time stamps need
+		no correction after the RTC has been restarted by ClockSet().
+2026-10-15,agnt	SyncSchedule: With TEMP_COMP, the deviation is the residual
+		error after the temperature compensation, the correction is
+		logged along with it, see TempCompSyncMs().
+2026-10-15,agnt	The receiver is accounted in the energy ledger, see
+		EnergyLedger.c.
+2026-10-14,agnt	Added DCF77_SAMPLE_MODE to sample the DCF77 bits by an msTimer.
+		Added DCF77_VOTE_FRAMES for majority voting over several frames.
+		Added DCF77_ADAPTIVE_SYNC to schedule the next synchronization
+		depending on the measured clock drift.
 2020-05-12,rage	TimeSynchronize: Call ClockSet() after converting alarm times
 		from/to MESZ to provide correct alarms to CheckAlarmTimes().
 2016-04-06,rage	Made local variables of type "volatile".
@@ -79,6 +145,7 @@ Revision History:
 /*=============================== Header Files ===============================*/
 
 #include <stdio.h>
+#include <string.h>
 #include "em_device.h"
 #include "em_assert.h"
 #include "em_cmu.h"
@@ -86,9 +153,15 @@ Revision History:
 #include "DCF77.h"
 #include "ExtInt.h"
 #include "AlarmClock.h"
+#include "TempComp.h"
+#include "TimeSrc.h"
 #if DCF77_DISPLAY_PROGRESS
   #include "SegmentLCD.h"
 #endif
+#if DCF77_LEARN_WINDOW
+  #include "em_int.h"
+  #include "em_msc.h"
+#endif
 
 /*=============================== Definitions ================================*/
 
@@ -109,6 +182,53 @@ Revision History:
 /*!@brief Time when DCF77 will be activated for switching from MESZ to MEZ */
 #define ALARM_MESZ_TO_MEZ   2, 55
 
+#if DCF77_VOTE_FRAMES
+/*!@brief Get @p len bits of a 64-bit DCF77 frame, starting at bit @p first */
+#define FRAME_BITS(frame, first, len)	\
+		((uint32_t)((frame) >> (first)) & ((1UL << (len)) - 1))
+
+/*!@brief Convert a BCD value into binary */
+#define BCD2BIN(bcd)	(((bcd) >> 4) * 10 + ((bcd) & 0x0F))
+#endif
+
+#if DCF77_LEARN_WINDOW
+#if ! DCF77_ONCE_PER_DAY
+    #error "DCF77_LEARN_WINDOW requires DCF77_ONCE_PER_DAY"
+#endif
+
+/*!@brief Hour (MEZ) of the default wake-up time @ref ALARM_MEZ_TO_MESZ */
+#define LEARN_DFLT_HOUR		1
+
+/*!@brief Interval in [s] of the signal quality check, see LearnCheck() */
+#define LEARN_CHECK_INTERVAL	60
+
+/*!@brief Minimum number of valid pulses per check interval */
+#define LEARN_MIN_PULSES	30
+
+/*!@brief Number of consecutive futile intervals to abort an attempt */
+#define LEARN_FUTILE_CNT	5
+
+/*!@brief Maximum number of retries per day after aborted attempts */
+#define LEARN_RETRY_CNT		3
+
+/*!@brief Number of record words per flash page */
+#define LEARN_WORDS		(FLASH_PAGE_SIZE / 4)
+
+/*!@brief Value of an erased flash word */
+#define LEARN_ERASED		0xFFFFFFFFUL
+
+/*!@brief Flash word of a 16bit record, and its validity check */
+#define LEARN_WORD(r)		((~(uint32_t)(r) << 16) | ((r) & 0xFFFF))
+#define LEARN_VALID(w)		(((w) >> 16) == (~(w) & 0xFFFF))
+
+/*!@brief Fields of a record: hour (MEZ), success, minutes, page generation */
+#define LEARN_REC(hour, ok, min)	((hour) | ((ok) << 5) | ((min) << 6))
+#define LEARN_HOUR(r)		((r) & 0x1F)
+#define LEARN_OK(r)		(((r) >> 5) & 0x01)
+#define LEARN_MIN(r)		(((r) >> 6) & 0x3F)
+#define LEARN_GEN(r)		(((r) >> 12) & 0x0F)
+#endif
+
 /*=========================== Typedefs and Structs ===========================*/
 
     /*!@brief Local states of the DCF77 signal */
@@ -121,6 +241,26 @@ typedef enum
     STATE_UP_TO_DATE,		//!< 4: [E] Received complete time information
 } DCF_STATE;
 
+#if DCF77_VOTE_FRAMES
+    /*!@brief Entry of the DCF77 frame history */
+typedef struct
+{
+    uint64_t	Frame;		//!< Received bits 0 to 58 of the frame
+    time_t	Time;		//!< System time of the minute mark, 0 if empty
+} DCF_FRAME;
+#endif
+
+#if DCF77_LEARN_WINDOW
+    /*!@brief Synchronization attempts of one hour of the day.  The counters
+     * are halved before they overflow, see HourStatAdd(). */
+typedef struct
+{
+    uint8_t	Attempts;	//!< Number of attempts started in this hour
+    uint8_t	Success;	//!< Number of successful attempts
+    uint16_t	SyncMin;	//!< Sum of the minutes of the successful ones
+} DCF_HOUR_STAT;
+#endif
+
 /*======================== External Data and Routines ========================*/
 
 #if DCF77_INDICATOR
@@ -133,6 +273,15 @@ typedef enum
     /*!@brief DCF77 date and time structure. */
 struct tm    dcf77;	// not intended to be used by other modules
 
+    /*!@brief Maximum expected clock error in [ms] for DCF77_ADAPTIVE_SYNC. */
+int32_t	     g_DCF77_MaxError = DFLT_DCF77_MAX_ERROR;
+
+    /*!@brief DCF77 receiver as time source, see TimeSrc.c. */
+const TIME_SRC	g_TimeSrcDCF77 =
+{
+    "DCF77", DCF77Init, DCF77Enable, DCF77Disable
+};
+
 /*================================ Local Data ================================*/
 
     /*!@brief Current DCF77 state */
@@ -144,12 +293,107 @@ static volatile TIM_HDL	 l_TimHdl = NONE;
     /*!@brief Frame sequence counter (1..FRAME_SEQ_CNT) */
 static volatile uint8_t	 l_FrameSeqCnt = 1;
 
+#if DCF77_SAMPLE_MODE
+    /*!@brief msTimer handle to sample the DCF77 signal. */
+static volatile TIM_HDL	 l_hdlSample = NONE;
+
+    /*!@brief RTC time stamp of the rising edge of bit 0. */
+static volatile uint32_t l_SampleBase;
+
+    /*!@brief Number of the bit to be sampled next, 59 means second 59. */
+static volatile int8_t	 l_SampleBit;
+
+    /*!@brief Flag is true while the signal is sampled, i.e. EXTI is off. */
+static volatile bool	 l_flgSampleActive;
+
+    /*!@brief Flag is true while DCF77Handler() is called by SignalSample(). */
+static volatile bool	 l_flgSampleEdge;
+#endif
+
+#if DCF77_VOTE_FRAMES
+    /*!@brief History of the recently received frames */
+static DCF_FRAME	 l_FrameHist[DCF77_VOTE_FRAMES];
+
+    /*!@brief Index of the next entry in @ref l_FrameHist to be written */
+static uint8_t		 l_FrameHistIdx;
+#endif
+
+#if DCF77_ADAPTIVE_SYNC
+    /*!@brief DCF77 time of the previous synchronization, 0 if none */
+static time_t		 l_SyncTime;
+
+    /*!@brief Number of daily wake-ups to be skipped */
+static volatile int	 l_SyncSkipDays;
+#endif
+
+#if DCF77_LEARN_WINDOW
+    /* Flash area of the reception history, defined by the linker script */
+extern uint32_t		 __DcfHistStart[], __DcfHistEnd[];
+
+    /*!@brief Histogram of the synchronization attempts per hour (MEZ) */
+static DCF_HOUR_STAT	 l_HourStat[24];
+
+    /*!@brief Next flash word to be programmed, and records in its page */
+static uint32_t		*l_pLearnNext;
+static int		 l_LearnCnt;
+
+    /*!@brief Generation of the current flash page (0 to 15) */
+static uint8_t		 l_LearnGen;
+
+    /*!@brief Record to be programmed by DCF77Check(), NONE if none */
+static volatile int32_t	 l_LearnPending = NONE;
+
+    /*!@brief sTimer handle for LearnCheck() */
+static volatile TIM_HDL	 l_hdlLearn = NONE;
+
+    /*!@brief Hour (MEZ) of the running attempt, NONE if no attempt */
+static volatile int8_t	 l_LearnHour = NONE;
+
+    /*!@brief Monotonic time in [ms] when the running attempt started */
+static uint64_t		 l_LearnStartMs;
+
+    /*!@brief Valid and invalid pulse widths in the current check interval */
+static volatile uint16_t l_PulseGood, l_PulseBad;
+
+    /*!@brief Number of consecutive futile check intervals */
+static uint8_t		 l_FutileCnt;
+
+    /*!@brief Number of retries after aborted attempts on this day */
+static uint8_t		 l_RetryCnt;
+#endif
+
 
 /*=========================== Forward Declarations ===========================*/
 
 static void	TimeSynchronize (struct tm *pTime);
 static void	SignalSuperVisor (TIM_HDL hdl);
 static void	StateChange (DCF_STATE newState);
+#if DCF77_SAMPLE_MODE
+static void	SampleStart (uint32_t timeStamp);
+static void	SampleSchedule (void);
+static uint32_t	SampleStamp (int bitNum, uint32_t ms);
+static void	SignalSample (TIM_HDL hdl);
+#endif
+#if DCF77_VOTE_FRAMES
+static int	FrameVote (uint64_t frame);
+static bool	FrameParity (uint64_t frame, int first, int last);
+static int	FrameMajority (const int32_t *pValue, int32_t *pResult);
+#endif
+#if DCF77_ADAPTIVE_SYNC
+static void	DCF77WakeUp (int alarmNum);
+static void	SyncSchedule (struct tm *pTime, bool changeOccurred);
+#endif
+#if DCF77_LEARN_WINDOW
+static int	LearnLoad (void);
+static void	LearnWrite (uint32_t rec);
+static void	LearnStart (void);
+static void	LearnCheck (TIM_HDL hdl);
+static void	LearnRecord (bool success);
+static void	HourStatAdd (DCF_HOUR_STAT *pStat, bool success, uint32_t min);
+static void	LearnSchedule (bool retry);
+static int	LearnBest (int firstHour, int lastHour);
+static bool	IsChangeSunday (struct tm *pTime);
+#endif
 
 
 /***************************************************************************//**
@@ -184,16 +428,39 @@ void	DCF77Init (void)
     if (l_TimHdl == NONE)
 	l_TimHdl = sTimerCreate (SignalSuperVisor);
 
+#if DCF77_SAMPLE_MODE
+    /* The DCF77 bits are sampled by a high-resolution timer */
+    if (l_hdlSample == NONE)
+	l_hdlSample = msTimerCreate (SignalSample);
+#endif
+
 #if DCF77_ONCE_PER_DAY
     /*
      * Set up wake-up time for DCF77 receiver and decoder. The initial time zone
      * is MEZ.  Alarm times will be converted during first time synchronization
      * if daylight saving time (MESZ) is active.
      */
+#if DCF77_ADAPTIVE_SYNC
+    AlarmAction (ALARM_DCF77_WAKE_UP, DCF77WakeUp);
+#else
     AlarmAction (ALARM_DCF77_WAKE_UP, (ALARM_FCT)DCF77Enable);
+#endif
     AlarmSet (ALARM_DCF77_WAKE_UP, ALARM_MEZ_TO_MESZ);
     AlarmEnable (ALARM_DCF77_WAKE_UP);
 #endif
+
+#if DCF77_LEARN_WINDOW
+    /* The signal quality is checked while an attempt is running */
+    if (l_hdlLearn == NONE)
+	l_hdlLearn = sTimerCreate (LearnCheck);
+
+    /* The wake-up time is moved after the first synchronization */
+    int cnt = LearnLoad();
+  #ifdef LOGGING
+    if (cnt > 0)
+	Log ("DCF77: Reception history of %d attempts", cnt);
+  #endif
+#endif
 }
 
 /***************************************************************************//**
@@ -224,6 +491,16 @@ void	DCF77Enable (void)
     /* Reset frame counter */
     l_FrameSeqCnt = 1;
 
+#if DCF77_LEARN_WINDOW
+    /* Record this attempt in the reception history */
+    LearnStart();
+#endif
+
+#if DCF77_VOTE_FRAMES
+    /* Frames of the last synchronization are too old */
+    memset (l_FrameHist, 0, sizeof(l_FrameHist));
+#endif
+
     /* Interrupt enable */
     ExtIntEnable (DCF77_SIGNAL_PIN);
 
@@ -231,6 +508,55 @@ void	DCF77Enable (void)
     StateChange (STATE_NO_SIGNAL);
 }
 
+#if DCF77_ADAPTIVE_SYNC
+/***************************************************************************//**
+ *
+ * @brief	Daily DCF77 wake-up
+ *
+ * This routine is called by the alarm @ref ALARM_DCF77_WAKE_UP.  It enables
+ * the DCF77 decoder, except if SyncSchedule() has determined that further
+ * days may be skipped.  The last Sundays of March and October, when the time
+ * zone may change, are never skipped.
+ *
+ * @param[in] alarmNum
+ *	Alarm number (not used here).
+ *
+ ******************************************************************************/
+static void	DCF77WakeUp (int alarmNum)
+{
+struct tm now;
+
+    (void) alarmNum;	// suppress compiler warning "unused parameter"
+
+    if (l_SyncSkipDays > 0)
+    {
+	/* Calculate the weekday, the system clock uses a 2-digit year */
+	ClockGet (&now);
+	now.tm_isdst = 0;		// always 0 for mktime()
+	if (now.tm_year < 100)
+	    now.tm_year += 100;
+	mktime (&now);
+
+	if ((now.tm_mon != 2  &&  now.tm_mon != 9)
+	||  now.tm_mday < 25  ||  now.tm_wday != 0)
+	{
+	    l_SyncSkipDays--;
+#ifdef LOGGING
+	    Log ("DCF77: Synchronization skipped, %d more day(s)",
+		 l_SyncSkipDays);
+#endif
+#if DCF77_LEARN_WINDOW
+	    /* a change of the time zone may be ahead */
+	    LearnSchedule (false);
+#endif
+	    return;
+	}
+    }
+
+    DCF77Enable();
+}
+#endif
+
 /***************************************************************************//**
  *
  * @brief	Disable the DCF77 decoder
@@ -246,6 +572,20 @@ void	DCF77Disable (void)
     if (l_TimHdl != NONE)
 	sTimerCancel (l_TimHdl);
 
+#if DCF77_LEARN_WINDOW
+    /* An attempt that has not been finished is not recorded */
+    if (l_hdlLearn != NONE)
+	sTimerCancel (l_hdlLearn);
+    l_LearnHour = NONE;
+#endif
+
+#if DCF77_SAMPLE_MODE
+    /* Stop sampling */
+    if (l_hdlSample != NONE)
+	msTimerCancel (l_hdlSample);
+    l_flgSampleActive = false;
+#endif
+
     /* Interrupt disable */
     ExtIntDisable (DCF77_SIGNAL_PIN);
 
@@ -319,23 +659,29 @@ void testChangeTZ (void)
  *
  * @note
  * The time stamp is read from the Real Time Counter (RTC), so its resolution
- * depends on the RTC.  Use the define @ref RTC_COUNTS_PER_SEC to convert the
- * RTC value into a duration.
+ * depends on the RTC.  It is converted to the monotonic clock, which is not
+ * affected when the RTC is restarted by ClockSet().  Use the define
+ * @ref RTC_COUNTS_PER_SEC to convert the ticks into a duration.
  *
  ******************************************************************************/
 void	DCF77Handler (int extiNum, bool extiLvl, uint32_t timeStamp)
 {
 static int8_t	bitNum = NONE;	// bit number, or NONE if waiting for SYNC
 static uint32_t	pulseLength=0;	// length of high-pulse in number of RTC tics
-static uint32_t	tsRising;	// time-stamp of previous rising edge
+static uint64_t	tsRising;	// time-stamp of previous rising edge
 static uint32_t	value;		// general purpose variable
 static bool	flgMESZ;	// true for MESZ (daylight saving time)
 #if DCF77_ONCE_PER_DAY
 static bool	flgAwaitChange;	// true if awaiting MEZ/MESZ change
 #endif
+#if DCF77_VOTE_FRAMES
+static uint64_t	frame;		// all bits of the current frame
+#else
 static time_t	prevTime;	// previous time in seconds (UNIX time)
+#endif
 static bool	parity;		// data parity bit
 bool		bit;		// current data bit
+uint64_t	ts;		// time-stamp of this edge (monotonic clock)
 
 
     (void) extiNum;	// suppress compiler warning "unused parameter"
@@ -344,6 +690,17 @@ bool		bit;		// current data bit
     if (timeStamp == 0)
 	return;
 
+    ts = ClockMonoStamp (timeStamp);
+
+#if DCF77_SAMPLE_MODE
+    /* Ignore real edges while sampling, e.g. after ExtIntEnableAll() */
+    if (l_flgSampleActive  &&  ! l_flgSampleEdge)
+    {
+	ExtIntDisable (DCF77_SIGNAL_PIN);
+	return;
+    }
+#endif
+
     /* Check state to see if decoder is enabled */
     if (l_State == STATE_OFF)
     {
@@ -362,7 +719,7 @@ bool		bit;		// current data bit
 
     /* Start timer to detect future signal inactivity after 5s */
     if (l_TimHdl != NONE)
-	sTimerStart (l_TimHdl, 5);
+	sTimerStartSlack (l_TimHdl, 5, DCF77_SUPERVISOR_SLACK);
 
     /* See if rising or falling edge */
     if (extiLvl)
@@ -392,6 +749,14 @@ bool		bit;		// current data bit
 	    testChangeTZ();	// test routine for "change time zone"
 #endif
 
+#if DCF77_VOTE_FRAMES
+	    /*
+	     * Since DCF77 data may be faulty due to signal weakness, every
+	     * field must have been received in FRAME_SEQ_CNT frames.  The
+	     * number of matching frames is returned as "sequence count".
+	     */
+	    l_FrameSeqCnt = FrameVote (frame);
+#else
 	    /*
 	     * Since DCF77 data may be faulty due to signal weakness, we have
 	     * to receive a sequence of valid frames.  These must show a time
@@ -405,6 +770,7 @@ bool		bit;		// current data bit
 
 	    currTimeTM.tm_isdst = 0;		// always 0 for mktime()
 	    currTime = mktime (&currTimeTM);	// current time in seconds
+#endif
 
 	    /*
 	     * Flag to detect whether MEZ<=>MESZ change occurred.  The system
@@ -415,6 +781,7 @@ bool		bit;		// current data bit
 	     */
 	    bool changeOccurred = (g_isdst != (bool)dcf77.tm_isdst);
 
+#if ! DCF77_VOTE_FRAMES
 	    /* Consider timezone change only when really expected */
 	    expDiff = (flgAwaitChange && changeOccurred ?
 			(g_isdst ? -3540 : +3660) : +60);
@@ -425,6 +792,7 @@ bool		bit;		// current data bit
 		l_FrameSeqCnt = 1;	// reset frame counter
 
 	    prevTime = currTime;	// save time for next compare
+#endif
 
 #ifdef LOGGING
 	    Log ("DCF77: Time Frame %d is 20%02d%02d%02d-%02d%02d%02d",
@@ -447,8 +815,7 @@ bool		bit;		// current data bit
 		/* set local time, show time on display */
 		TimeSynchronize (&dcf77);
 
-		/* RTC is 0, correct timeStamp and tsRising values */
-		tsRising -= timeStamp;
+		/* RTC is 0, correct timeStamp for SampleStart() */
 		timeStamp = 0;
 
 #if DCF77_ONCE_PER_DAY
@@ -489,13 +856,20 @@ bool		bit;		// current data bit
 	    uint32_t pauseLen;
 
 		/* Previous pulse was valid - check distance of rising edges */
-		pauseLen = (timeStamp - tsRising) & 0x00FFFFFF;
+		pauseLen = (uint32_t)(ts - tsRising);
 		if (MS2TICS(1800) < pauseLen  &&  pauseLen < MS2TICS(2200))
 		{
 		    /* SYNC detected - bit 0 will follow, receive data */
 		    if (l_State != STATE_UP_TO_DATE)
 			StateChange (STATE_RECV_DATA);
 		    bitNum = 0;
+#if DCF77_VOTE_FRAMES
+		    frame  = 0;
+#endif
+#if DCF77_SAMPLE_MODE
+		    /* the bits of this frame are sampled by the msTimer */
+		    SampleStart (timeStamp);
+#endif
 		}
 	    }
 	}
@@ -506,7 +880,7 @@ bool		bit;		// current data bit
 	}
 
 	/* Save time stamp for rising edge */
-	tsRising = timeStamp;
+	tsRising = ts;
 
 	return;		// DONE - return from interrupt
     }
@@ -531,8 +905,16 @@ bool		bit;		// current data bit
   #endif
 #endif
 
-    /* Measure pulse length (24bit) - consider wrap-around */
-    pulseLength = (timeStamp - tsRising) & 0x00FFFFFF;
+    /* Measure pulse length */
+    pulseLength = (uint32_t)(ts - tsRising);
+
+#if DCF77_LEARN_WINDOW
+    /* Signal quality for LearnCheck() */
+    if (MS2TICS(40) < pulseLength  &&  pulseLength < MS2TICS(230))
+	l_PulseGood++;
+    else
+	l_PulseBad++;
+#endif
 
     /* Ignore pulse if still seeking for SYNC */
     if (bitNum == NONE)
@@ -558,6 +940,12 @@ bool		bit;		// current data bit
 	return;
     }
 
+#if DCF77_VOTE_FRAMES
+    /* Collect the bits, the fields are verified by FrameVote() */
+    if (bit)
+	frame |= (uint64_t)1 << bitNum;
+#endif
+
     /* Perform data processing according to the bit number */
     switch (bitNum)
     {
@@ -764,20 +1152,374 @@ bool		bit;		// current data bit
     }
 
     /* When the code arrives here, invalid data has been received */
+#if DCF77_VOTE_FRAMES
+    DBG_PUTC('P');	// continue, other fields of this frame may be valid
+#else
     StateChange (STATE_SYNC_WAIT);
     bitNum = NONE;
+#endif
+}
+
+#if DCF77_SAMPLE_MODE
+/***************************************************************************//**
+ *
+ * @brief	Start sampling the DCF77 signal
+ *
+ * This routine is called by DCF77Handler() when the rising edge of bit 0 has
+ * been detected after the SYNC pause.  It disables the EXTI of the DCF77
+ * signal and starts the msTimer to sample bit 0.
+ *
+ * @param[in] timeStamp
+ *	Time stamp (24bit) of the rising edge of bit 0.
+ *
+ ******************************************************************************/
+static void	SampleStart (uint32_t timeStamp)
+{
+    if (l_hdlSample == NONE)
+	return;
+
+    ExtIntDisable (DCF77_SIGNAL_PIN);
+
+    l_SampleBase = timeStamp;
+    l_SampleBit  = 0;
+    l_flgSampleActive = true;
+
+    SampleSchedule();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Schedule the next sample
+ *
+ * This routine starts the msTimer for the bit number @ref l_SampleBit.  The
+ * sample time refers to the rising edge of bit 0, so the latency of the
+ * previous msTimer interrupts does not accumulate.
+ *
+ ******************************************************************************/
+static void	SampleSchedule (void)
+{
+uint32_t delay;		// RTC ticks until the sample point
+
+    /* second 59 has no pulse, after the middle the EXTI is enabled again */
+    if (l_SampleBit > 58)
+	delay = SampleStamp (58, 500);
+    else
+	delay = SampleStamp (l_SampleBit, DCF77_SAMPLE_POINT);
+
+    delay = (delay - RTC->CNT) & 0x00FFFFFF;
+    if (delay > 2 * RTC_COUNTS_PER_SEC)
+	delay = 0;		// sample point has already been passed
+
+    msTimerStart (l_hdlSample, delay * 1000 / RTC_COUNTS_PER_SEC + 1);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Time stamp within a DCF77 frame
+ *
+ * This routine calculates the RTC time stamp of @p ms milliseconds after the
+ * rising edge of the specified bit.  The value 0 is reserved for an EXTI that
+ * has been "replayed", so it is never returned.
+ *
+ * @param[in] bitNum
+ *	Bit number 0 to 58.
+ *
+ * @param[in] ms
+ *	Milliseconds after the rising edge of this bit.
+ *
+ * @return
+ *	Time stamp (24bit).
+ *
+ ******************************************************************************/
+static uint32_t	SampleStamp (int bitNum, uint32_t ms)
+{
+uint32_t timeStamp;
+
+    timeStamp = (l_SampleBase + bitNum * RTC_COUNTS_PER_SEC + MS2TICS(ms))
+		& 0x00FFFFFF;
+
+    return (timeStamp == 0 ? 1 : timeStamp);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Sample the DCF77 signal
+ *
+ * This function is called by the msTimer at @ref DCF77_SAMPLE_POINT after the
+ * rising edge of each bit.  If the signal is still high, this must be a 1-bit,
+ * otherwise a 0-bit.  The respective rising and falling edges are passed to
+ * DCF77Handler(), i.e. the decoding itself is not changed.  When a bit could
+ * not be decoded, or after bit 58 has been sampled, the EXTI is enabled again.
+ *
+ * @note
+ * Be aware, this function is called in interrupt context!
+ *
+ * @param[in] hdl
+ *	Timer handle (not used here).
+ *
+ ******************************************************************************/
+static void	SignalSample (TIM_HDL hdl)
+{
+int	bitNum = l_SampleBit;
+bool	level;			// signal level at the sample point
+
+    (void) hdl;
+
+    if (! l_flgSampleActive)
+	return;
+
+    if (bitNum <= 58)
+    {
+	level = GPIO_PinInGet (DCF77_SIGNAL_PORT, DCF77_SIGNAL_PIN);
+
+	l_flgSampleEdge = true;
+
+	/* the rising edge of bit 0 has been a real EXTI */
+	if (bitNum > 0)
+	    DCF77Handler (DCF77_SIGNAL_PIN, 1, SampleStamp (bitNum, 0));
+
+	/* a still high signal means 200ms (1-bit), otherwise 100ms (0-bit) */
+	DCF77Handler (DCF77_SIGNAL_PIN, 0,
+		      SampleStamp (bitNum, level ? 200 : 100));
+
+	l_flgSampleEdge = false;
+
+	/* see if the decoder is still receiving data */
+	if (l_State == STATE_RECV_DATA  ||  l_State == STATE_UP_TO_DATE)
+	{
+	    l_SampleBit++;
+	    SampleSchedule();
+	    return;
+	}
+    }
+
+    /* let the EXTI detect the next edge */
+    l_flgSampleActive = false;
+    if (l_State != STATE_OFF)
+	ExtIntEnable (DCF77_SIGNAL_PIN);
+}
+#endif
+
+#if DCF77_VOTE_FRAMES
+/***************************************************************************//**
+ *
+ * @brief	Majority voting over the recent DCF77 frames
+ *
+ * This routine is called by DCF77Handler() at the minute mark.  It stores
+ * the received frame in the history @ref l_FrameHist, then decodes all frames
+ * of the history.  Each field is only considered if its parity is correct.
+ * The minutes of older frames are advanced by their age, which is derived
+ * from the system time.  Frames from the previous hour are ignored.  For
+ * every field, the value that occurs most often is stored in @ref dcf77.
+ *
+ * @param[in] frame
+ *	Bits 0 to 58 of the current frame.
+ *
+ * @return
+ *	Number of frames that agree in each field, i.e. the minimum of all
+ *	fields.  If this is 0, the contents of @ref dcf77 is not changed.
+ *
+ ******************************************************************************/
+static int	FrameVote (uint64_t frame)
+{
+struct tm now;			// current system time
+time_t	  sysTime;		// current system time in seconds
+int32_t	  minute[DCF77_VOTE_FRAMES];	// values referred to the current
+int32_t	  hour  [DCF77_VOTE_FRAMES];	// frame, or NONE if invalid
+int32_t	  date  [DCF77_VOTE_FRAMES];
+int32_t	  mesz  [DCF77_VOTE_FRAMES];
+int	  age   [DCF77_VOTE_FRAMES];	// [min], NONE if minute is known
+int32_t	  value;
+int	  votes, cnt, i;
+uint64_t  f;
+
+    /* Store the current frame with its system time */
+    ClockGet (&now);
+    now.tm_isdst = 0;			// always 0 for mktime()
+    sysTime = mktime (&now);
+
+    l_FrameHist[l_FrameHistIdx].Frame = frame;
+    l_FrameHist[l_FrameHistIdx].Time  = sysTime;
+    if (++l_FrameHistIdx >= DCF77_VOTE_FRAMES)
+	l_FrameHistIdx = 0;
+
+    /* Decode the fields of all frames */
+    for (i = 0;  i < DCF77_VOTE_FRAMES;  i++)
+    {
+	f = l_FrameHist[i].Frame;
+	age[i] = (sysTime - l_FrameHist[i].Time + 30) / 60;	// [min]
+	minute[i] = hour[i] = date[i] = mesz[i] = NONE;
+
+	/* Bit 0 must be 0, bit 20 must be 1, bits 17 and 18 must differ */
+	if (l_FrameHist[i].Time == 0  ||  age[i] < 0  ||  age[i] > 59
+	||  (f & 1)  ||  ! FRAME_BITS(f, 20, 1)
+	||  FRAME_BITS(f, 17, 1) == FRAME_BITS(f, 18, 1))
+	    continue;
+
+	/* Bit 21~27: Minutes as BCD, bit 28: parity */
+	value = FRAME_BITS(f, 21, 7);
+	if (FrameParity (f, 21, 28)  &&  (value & 0x0F) <= 9)
+	{
+	    value = BCD2BIN(value) + age[i];
+	    if (value > 59)
+		continue;		// frame is from the previous hour
+	    minute[i] = value;
+	    age[i] = NONE;		// hour is known to be the current one
+	}
+
+	/* Bit 29~34: Hours as BCD, bit 35: parity */
+	value = FRAME_BITS(f, 29, 6);
+	if (FrameParity (f, 29, 35)  &&  (value & 0x0F) <= 9
+	&&  BCD2BIN(value) <= 23)
+	    hour[i] = BCD2BIN(value);
+
+	/* Bit 36~57: Day, weekday, month, and year as BCD, bit 58: parity */
+	value = FRAME_BITS(f, 36, 22);
+	if (FrameParity (f, 36, 58)  &&  (value & 0x3F) != 0
+	&&  ((value >> 9) & 0x1F) != 0  &&  BCD2BIN((value >> 9) & 0x1F) <= 12)
+	    date[i] = value;
+
+	/* Bit 17: 0=MEZ, 1=MESZ */
+	mesz[i] = FRAME_BITS(f, 17, 1);
+    }
+
+    /* Each field must have been received in <votes> frames at least */
+    votes = FrameMajority (minute, &minute[0]);
+
+    /*
+     * Older frames with a corrupted minutes field are from the current hour,
+     * if their age does not exceed the minutes of the current frame.
+     */
+    for (i = 0;  i < DCF77_VOTE_FRAMES;  i++)
+    {
+	if (age[i] > 0  &&  (votes == 0  ||  age[i] > minute[0]))
+	    hour[i] = date[i] = mesz[i] = NONE;
+    }
+
+    cnt = FrameMajority (hour, &hour[0]);
+    if (cnt < votes)
+	votes = cnt;
+    cnt = FrameMajority (date, &date[0]);
+    if (cnt < votes)
+	votes = cnt;
+    cnt = FrameMajority (mesz, &mesz[0]);
+    if (cnt < votes)
+	votes = cnt;
+
+    if (votes == 0)
+	return 0;		// at least one field has never been received
+
+    /* Store the result */
+    value = date[0];
+    dcf77.tm_min   = minute[0];
+    dcf77.tm_hour  = hour[0];
+    dcf77.tm_mday  = BCD2BIN(value & 0x3F);
+    dcf77.tm_mon   = BCD2BIN((value >> 9) & 0x1F) - 1;
+    dcf77.tm_year  = BCD2BIN((value >> 14) & 0xFF);
+    dcf77.tm_isdst = mesz[0];
+
+    /*
+     * The system clock will be set to the DCF77 time, so the history must
+     * be moved to the new time base.
+     */
+    if (votes >= FRAME_SEQ_CNT)
+    {
+	now = dcf77;
+	now.tm_isdst = 0;		// always 0 for mktime()
+	sysTime = mktime (&now) - sysTime;
+
+	for (i = 0;  i < DCF77_VOTE_FRAMES;  i++)
+	    if (l_FrameHist[i].Time != 0)
+		l_FrameHist[i].Time += sysTime;
+    }
+
+    return votes;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Check the parity of a DCF77 field
+ *
+ * DCF77 uses even parity, i.e. the number of 1-bits of the field, including
+ * its parity bit, must be even.
+ *
+ * @param[in] frame
+ *	DCF77 frame.
+ *
+ * @param[in] first
+ *	First bit of the field.
+ *
+ * @param[in] last
+ *	Last bit of the field, this is the parity bit.
+ *
+ * @return
+ *	Returns true if the parity is correct.
+ *
+ ******************************************************************************/
+static bool	FrameParity (uint64_t frame, int first, int last)
+{
+bool	parity = 0;
+
+    for ( ;  first <= last;  first++)
+	parity ^= (bool)((frame >> first) & 1);
+
+    return ! parity;
 }
 
+/***************************************************************************//**
+ *
+ * @brief	Determine the most frequent value
+ *
+ * This routine searches the value which occurs most often in the array of
+ * @ref DCF77_VOTE_FRAMES entries.  Entries of value NONE are ignored.
+ *
+ * @param[in] pValue
+ *	Array of values.
+ *
+ * @param[out] pResult
+ *	The most frequent value is stored here.  This is not modified if all
+ *	entries are NONE.
+ *
+ * @return
+ *	Number of entries with the most frequent value.
+ *
+ ******************************************************************************/
+static int	FrameMajority (const int32_t *pValue, int32_t *pResult)
+{
+int	i, j, cnt, maxCnt = 0;
+int32_t	result = NONE;
+
+    for (i = 0;  i < DCF77_VOTE_FRAMES;  i++)
+    {
+	if (pValue[i] == NONE)
+	    continue;
+
+	for (j = cnt = 0;  j < DCF77_VOTE_FRAMES;  j++)
+	    if (pValue[j] == pValue[i])
+		cnt++;
+
+	if (cnt > maxCnt)
+	{
+	    maxCnt = cnt;
+	    result = pValue[i];
+	}
+    }
+
+    if (maxCnt > 0)
+	*pResult = result;
+
+    return maxCnt;
+}
+#endif
+
 /***************************************************************************//**
  *
  * @brief	Time Synchronization
  *
  * This function is called from the DCF77 interrupt handler after a sequence
  * of consecutive valid frames has been received, so we can be sure the time
- * information is valid.  It sets the system clock via ClockSet() and updates
- * the display with the new time.
- * It also checks for a change of MEZ to MESZ and vice versa.  If this happens,
- * all configured alarm times will be adjusted accordingly.
+ * information is valid.  It sets the system clock via TimeSrcSync(), which
+ * also checks for a change of MEZ to MESZ and vice versa.
  *
  * @note
  * Be aware, this function is called in interrupt context!
@@ -788,59 +1530,546 @@ bool		bit;		// current data bit
  ******************************************************************************/
 static void	TimeSynchronize (struct tm *pTime)
 {
-    /* flag to detect whether MEZ<=>MESZ change occurred */
-    bool changeOccurred = (g_isdst != (bool)pTime->tm_isdst);
-
-    /* set system clock to DCF77 time in "tm" format */
-    g_CurrDateTime = *pTime;
-    g_isdst = pTime->tm_isdst;		// flag for daylight saving time
+#if DCF77_ADAPTIVE_SYNC
+    /* measure the clock drift before the system clock is set */
+    SyncSchedule (pTime, (g_isdst != (bool)pTime->tm_isdst));
+#endif
 
 #if DCF77_ONCE_PER_DAY  &&  defined(LOGGING)
     /* log current DCF77 time */
-    Log("DCF77: Time Synchronization %02d:%02d:%02d (%s)",
-	pTime->tm_hour, pTime->tm_min, pTime->tm_sec, g_isdst ? "MESZ" : "MEZ");
+    LogEvent ("DCF77: Time Synchronization %02d:%02d:%02d (%s)",
+	pTime->tm_hour, pTime->tm_min, pTime->tm_sec,
+	pTime->tm_isdst ? "MESZ" : "MEZ");
+#endif
+
+    /*
+     * DCF77 may be activated once per day only.  The ALARM_DCF77_WAKE_UP is
+     * switched between 01:55 (MEZ) and 02:55 (MESZ) by TimeSrcSync(), so a
+     * change of the time zone is always received.  The clock is set at the
+     * minute mark, i.e. the time is not older than the processing here.
+     */
+    TimeSrcSync (pTime, 0);
+
+#if DCF77_LEARN_WINDOW
+    /* Record the attempt, and move the wake-up to the best hour */
+    if (l_LearnHour != NONE)
+	LearnRecord (true);
+    LearnSchedule (false);
+#endif
+}
+
+#if DCF77_ADAPTIVE_SYNC
+/***************************************************************************//**
+ *
+ * @brief	Schedule the next synchronization
+ *
+ * This routine is called by TimeSynchronize() before the system clock is set.
+ * It compares the system clock with the DCF77 time, and calculates the drift
+ * since the previous synchronization in ppm.  From that, the number of days
+ * is derived until the expected error exceeds @ref g_DCF77_MaxError.  The
+ * result is limited to 1 ... @ref DCF77_SYNC_MAX_DAYS.
+ *
+ * @note
+ * Be aware, this function is called in interrupt context!
+ *
+ * @param[in] pTime
+ *	Pointer to a <b>tm</b> structure that holds the DCF77 time.
+ *
+ * @param[in] changeOccurred
+ *	True if the time zone changes, the system clock cannot be compared then.
+ *
+ ******************************************************************************/
+static void	SyncSchedule (struct tm *pTime, bool changeOccurred)
+{
+struct tm    currTime;
+unsigned int ms;		// milliseconds of the system clock
+time_t	     sysTime;		// system time in seconds
+time_t	     dcfTime;		// DCF77 time in seconds
+int32_t	     elapsed;		// seconds since the previous synchronization
+int32_t	     delta;		// deviation of the system clock in [ms]
+int32_t	     ppm;		// drift in parts per million
+int32_t	     days = 1;		// days until the next synchronization
+#if TEMP_COMP
+int32_t	     comp;		// temperature compensation in [ms]
+
+    /* correction since the previous synchronization, starts over */
+    comp = TempCompSyncMs();
 #endif
 
+    ClockGetMilliSec (&currTime, &ms);
+    currTime.tm_isdst = 0;		// always 0 for mktime()
+    sysTime = mktime (&currTime);
+
+    currTime = *pTime;
+    currTime.tm_isdst = 0;
+    dcfTime = mktime (&currTime);
+
+    elapsed = (int32_t)(dcfTime - l_SyncTime);
+
     /*
-     * DCF77 may be activated once per day only.  To detect a change
-     * between MEZ and MESZ properly, the DCF77 will be switched-on at
-     * the right time.  When such a change is detected, all alarm times
-     * must be corrected to still occur at the same effective time.
-     * This includes the ALARM_DCF77_WAKE_UP, which is switched between
-     * 01:55 (MEZ) and 02:55 (MESZ) properly.
+     * A drift can only be measured if the clock has been synchronized before,
+     * at least one hour ago, and the deviation is plausible.
      */
-    if (changeOccurred)
+    if (l_SyncTime != 0  &&  ! changeOccurred  &&  elapsed >= 3600
+    &&  -60 < dcfTime - sysTime  &&  dcfTime - sysTime < 60
+    &&  g_DCF77_MaxError > 0)
     {
-    int	    alarm;
-    int8_t  hour, minute;
+	delta = (int32_t)(dcfTime - sysTime) * 1000 - (int32_t)ms;
+	ppm = delta * 1000 / elapsed;
 
-	if (g_isdst)
-	    Log ("DCF77: Changing time zone from MEZ to MESZ");
+	if (ppm == 0)
+	    days = DCF77_SYNC_MAX_DAYS;
 	else
-	    Log ("DCF77: Changing time zone from MESZ to MEZ");
+	    days = g_DCF77_MaxError * 1000 / (ppm < 0 ? -ppm : ppm)
+		   * 1000 / (24 * 3600);
+
+	if (days < 1)
+	    days = 1;
+	else if (days > DCF77_SYNC_MAX_DAYS)
+	    days = DCF77_SYNC_MAX_DAYS;
+
+#if defined(LOGGING)  &&  TEMP_COMP
+	Log ("DCF77: Clock deviation %ldms in %lds (%ldppm) after compensating"
+	     " %ldms, next synchronization in %ld day(s)",
+	     delta, elapsed, ppm, comp, days);
+#elif defined(LOGGING)
+	Log ("DCF77: Clock deviation %ldms in %lds (%ldppm),"
+	     " next synchronization in %ld day(s)", delta, elapsed, ppm, days);
+#endif
+    }
+
+    l_SyncTime = dcfTime;
+    l_SyncSkipDays = days - 1;
+}
+#endif
 
-	/* MEZ <-> MESZ change detected */
-	for (alarm = 0;  alarm < MAX_ALARMS;  alarm++)
+#if DCF77_LEARN_WINDOW
+/***************************************************************************//**
+ *
+ * @brief	Load the reception history
+ *
+ * This routine reads the records of both flash pages into the histogram
+ * @ref l_HourStat, and determines the next word to be programmed.  If both
+ * pages contain records, the current page is the one whose generation follows
+ * that of the other page.
+ *
+ * @return
+ *	Number of records in flash.
+ *
+ ******************************************************************************/
+static int	LearnLoad (void)
+{
+DCF_HOUR_STAT stat[24];
+uint32_t *pPage[2];
+int	 cnt[2], gen[2];
+int	 p, i, cur, total = 0;
+uint32_t w;
+
+    memset (stat, 0, sizeof(stat));
+
+    for (p = 0;  p < 2;  p++)
+    {
+	pPage[p] = __DcfHistStart + p * LEARN_WORDS;
+	cnt[p] = gen[p] = 0;
+
+	for (i = 0;  i < LEARN_WORDS;  i++)
 	{
-	    AlarmGet (alarm, &hour, &minute);
+	    w = pPage[p][i];
+	    if (! LEARN_VALID(w)  ||  LEARN_HOUR(w) > 23)
+		continue;
 
-	    hour += (g_isdst ? +1 : -1);
-	    if (hour < 0)
-		hour = 23;
-	    else if (hour > 23)
-		hour = 0;
+	    if (cnt[p]++ == 0)
+		gen[p] = LEARN_GEN(w);
 
-	    AlarmSet (alarm, hour, minute);
+	    HourStatAdd (&stat[LEARN_HOUR(w)], LEARN_OK(w), LEARN_MIN(w));
 	}
+	total += cnt[p];
     }
 
-    /* Set System Clock also in UNIX time and check initially alarm times */
-    ClockSet (&g_CurrDateTime, true);	// set milliseconds of RTC to zero
+    if (cnt[0] > 0  &&  cnt[1] > 0)
+	cur = (gen[1] == ((gen[0] + 1) & 0x0F) ? 1 : 0);
+    else
+	cur = (cnt[1] > 0 ? 1 : 0);
+
+    INT_Disable();
+    memcpy (l_HourStat, stat, sizeof(l_HourStat));
+    l_LearnCnt  = cnt[cur];
+    l_LearnGen  = gen[cur];
+    l_pLearnNext = pPage[cur] + cnt[cur];
+    INT_Enable();
 
-    /* Show time on display (if applicable) */
-    ClockUpdate (false);	// g_CurrDateTime is already up to date
+    return total;
 }
 
+/***************************************************************************//**
+ *
+ * @brief	Store the result of a synchronization attempt
+ *
+ * This routine is called from the main loop via EVENT_POST(EVT_DCF77).  It
+ * programs the record which has been prepared by LearnRecord() into flash.
+ * The histogram is loaded again afterwards, since the oldest records are lost
+ * when a page has been erased.
+ *
+ ******************************************************************************/
+void	DCF77Check (void)
+{
+int32_t	rec;
+
+    INT_Disable();
+    rec = l_LearnPending;
+    l_LearnPending = NONE;
+    INT_Enable();
+
+    if (rec == NONE)
+	return;
+
+    LearnWrite ((uint32_t)rec);
+    LearnLoad();
+}
+#if TIME_SOURCE == TIME_SRC_DCF77
+TASK_REGISTER(TASK_PRIO_DCF77, EVT_DCF77, DCF77Check);
+#endif
+
+/***************************************************************************//**
+ *
+ * @brief	Program a record into flash
+ *
+ * The record is programmed into the next erased word of the current page.
+ * If the page is full, the other page is erased and used with the next
+ * generation.
+ *
+ * @param[in] rec
+ *	Record without page generation, see LEARN_REC().
+ *
+ ******************************************************************************/
+static void	LearnWrite (uint32_t rec)
+{
+uint32_t	  *pWord = l_pLearnNext;
+uint32_t	   word;
+msc_Return_TypeDef res = mscReturnOk;
+
+    if (l_LearnCnt >= LEARN_WORDS)
+    {
+	/* page is full, continue with the other one */
+	pWord = (pWord >= __DcfHistEnd ? __DcfHistStart : pWord);
+	l_LearnGen = (l_LearnGen + 1) & 0x0F;
+	l_LearnCnt = 0;
+    }
+
+    MSC_Init();
+
+    /* Erase the page if the new record starts it */
+    if (l_LearnCnt == 0  ||  *pWord != LEARN_ERASED)
+    {
+	pWord -= (pWord - __DcfHistStart) % LEARN_WORDS;
+	l_LearnCnt = 0;
+	res = MSC_ErasePage (pWord);
+    }
+
+    word = LEARN_WORD(rec | ((uint32_t)l_LearnGen << 12));
+    if (res == mscReturnOk)
+	res = MSC_WriteWord (pWord, &word, 4);
+
+    MSC_Deinit();
+
+    if (res == mscReturnOk)
+    {
+	l_pLearnNext = pWord + 1;
+	l_LearnCnt++;
+    }
+    else
+    {
+	LogError ("DCF77: Flash Error %d", res);
+    }
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Start a synchronization attempt
+ *
+ * This routine is called by DCF77Enable().  If the system clock has been set,
+ * the hour (MEZ) is noted, and the signal quality check is started.  The
+ * initial synchronization is never aborted, since there is no other source
+ * for the time.
+ *
+ ******************************************************************************/
+static void	LearnStart (void)
+{
+struct tm now;
+
+    if (g_PowerUpTime == 0  ||  l_hdlLearn == NONE)
+	return;
+
+    ClockGet (&now);
+    l_LearnHour = (now.tm_hour - g_isdst + 24) % 24;
+    l_LearnStartMs = ClockMonoMs();
+    l_PulseGood = l_PulseBad = 0;
+    l_FutileCnt = 0;
+
+    sTimerStart (l_hdlLearn, LEARN_CHECK_INTERVAL);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Check the signal quality
+ *
+ * This function is called by the sTimer every @ref LEARN_CHECK_INTERVAL
+ * seconds while an attempt is running.  An interval is futile if less than
+ * @ref LEARN_MIN_PULSES pulses had a valid width, or more than 20% had an
+ * invalid width.  After @ref LEARN_FUTILE_CNT futile intervals in a row, or
+ * @ref DCF77_SYNC_TIMEOUT, the attempt is aborted and retried in the next
+ * best hour of the day.
+ *
+ * @note
+ * Be aware, this function is called in interrupt context!
+ *
+ * @param[in] hdl
+ *	Timer handle (not used here).
+ *
+ ******************************************************************************/
+static void	LearnCheck (TIM_HDL hdl)
+{
+uint16_t good = l_PulseGood;
+uint16_t bad  = l_PulseBad;
+uint32_t min;
+
+    (void) hdl;
+
+    if (l_LearnHour == NONE)
+	return;
+
+    l_PulseGood = l_PulseBad = 0;
+
+    if (good < LEARN_MIN_PULSES  ||  bad * 5 > good + bad)
+	l_FutileCnt++;
+    else
+	l_FutileCnt = 0;
+
+    min = (uint32_t)((ClockMonoMs() - l_LearnStartMs) / 60000);
+
+    if (l_FutileCnt < LEARN_FUTILE_CNT  &&  min < DCF77_SYNC_TIMEOUT)
+    {
+	sTimerStart (l_hdlLearn, LEARN_CHECK_INTERVAL);
+	return;
+    }
+
+#ifdef LOGGING
+    Log ("DCF77: Reception aborted after %lumin, pulses valid %u invalid %u",
+	 (unsigned long)min, good, bad);
+#endif
+    LearnRecord (false);
+    DCF77Disable();
+    LearnSchedule (true);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Record the result of the running attempt
+ *
+ * The attempt is added to the histogram, and the record is passed to
+ * DCF77Check() to be programmed into flash.
+ *
+ * @note
+ * Be aware, this function is called in interrupt context!
+ *
+ * @param[in] success
+ *	True if the system clock has been synchronized.
+ *
+ ******************************************************************************/
+static void	LearnRecord (bool success)
+{
+int	 hour = l_LearnHour;
+uint32_t min;
+
+    l_LearnHour = NONE;
+    if (hour == NONE)
+	return;
+
+    min = (uint32_t)((ClockMonoMs() - l_LearnStartMs) / 60000);
+    if (min > 63)
+	min = 63;
+
+    HourStatAdd (&l_HourStat[hour], success, min);
+
+    l_LearnPending = LEARN_REC(hour, success, min);
+    EVENT_POST(EVT_DCF77);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Add an attempt to the statistics of an hour
+ *
+ * Both flash pages can hold more attempts than an 8-bit counter.  Before
+ * @ref DCF_HOUR_STAT::Attempts overflows, all counters of the hour are halved,
+ * this keeps the success rate and the average synchronization time.
+ *
+ * @param[in] pStat
+ *	Statistics of the hour.
+ *
+ * @param[in] success
+ *	True if the attempt synchronized the system clock.
+ *
+ * @param[in] min
+ *	Duration of the attempt in minutes.
+ *
+ ******************************************************************************/
+static void	HourStatAdd (DCF_HOUR_STAT *pStat, bool success, uint32_t min)
+{
+    if (pStat->Attempts == 0xFF)
+    {
+	pStat->Attempts /= 2;
+	pStat->Success  /= 2;
+	pStat->SyncMin  /= 2;
+    }
+
+    pStat->Attempts++;
+    if (success)
+    {
+	pStat->Success++;
+	pStat->SyncMin += min;
+    }
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Move the wake-up to the best hour
+ *
+ * This routine sets @ref ALARM_DCF77_WAKE_UP to minute 55 of the hour with
+ * the best success rate, see LearnBest().  After an aborted attempt, the
+ * remaining hours of the day are tried, up to @ref LEARN_RETRY_CNT times,
+ * then the next attempt takes place on the following day.  If the next
+ * window falls on the last Sunday of March or October, the default 01:55 MEZ
+ * is used, so the change of the time zone is received.  The histogram uses
+ * MEZ, the alarm is converted into the current time zone.
+ *
+ * @note
+ * Be aware, this function is called in interrupt context!
+ *
+ * @param[in] retry
+ *	True if the current attempt has been aborted.
+ *
+ ******************************************************************************/
+static void	LearnSchedule (bool retry)
+{
+struct tm now, day;
+int	hour = NONE;
+int	next;			// first hour (MEZ) whose window is ahead
+int8_t	alarmHour, alarmMin;
+
+    ClockGet (&now);
+    next = (now.tm_hour - g_isdst + 24) % 24 + (now.tm_min < 55 ? 0 : 1);
+
+    if (retry  &&  l_RetryCnt < LEARN_RETRY_CNT)
+    {
+	/* retry later on this day */
+	l_RetryCnt++;
+	hour = LearnBest (next, 23);
+    }
+    if (hour == NONE)
+    {
+	/* after too many retries, the next attempt is on the following day */
+	l_RetryCnt = 0;
+	if (retry  &&  next > 0)
+	    hour = LearnBest (0, next - 1);
+	if (hour == NONE)
+	    hour = LearnBest (0, 23);
+    }
+
+    /* Calculate the weekday, the system clock uses a 2-digit year */
+    day = now;
+    day.tm_isdst = 0;			// always 0 for mktime()
+    if (day.tm_year < 100)
+	day.tm_year += 100;
+    mktime (&day);
+
+    /* the time zone changes today, keep the default window */
+    if (IsChangeSunday (&day)  &&  next <= LEARN_DFLT_HOUR)
+	hour = LEARN_DFLT_HOUR;
+
+    /* the time zone changes tomorrow, and the window has passed today */
+    day.tm_mday++;
+    mktime (&day);
+    if (IsChangeSunday (&day)  &&  hour < next)
+	hour = LEARN_DFLT_HOUR;
+
+    AlarmGet (ALARM_DCF77_WAKE_UP, &alarmHour, &alarmMin);
+    if (alarmHour == (hour + g_isdst) % 24  &&  alarmMin == 55)
+	return;
+
+    AlarmSet (ALARM_DCF77_WAKE_UP, (hour + g_isdst) % 24, 55);
+
+#ifdef LOGGING
+    Log ("DCF77: Wake-up moved to %02d:55, %u of %u attempts successful",
+	 (hour + g_isdst) % 24, l_HourStat[hour].Success,
+	 l_HourStat[hour].Attempts);
+#endif
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Determine the hour with the best reception
+ *
+ * The success rate of an hour is estimated as (success + 1) / (attempts + 2),
+ * so an hour without any attempt rates 50%.  On equal rates, the hour with
+ * the shorter average duration wins.  The hours are searched starting with
+ * the default 01:00 MEZ, so this is kept as long as there is no history.
+ *
+ * @param[in] firstHour
+ *	First hour (MEZ) to be considered.
+ *
+ * @param[in] lastHour
+ *	Last hour (MEZ) to be considered.
+ *
+ * @return
+ *	The best hour (MEZ), or NONE if the range is empty.
+ *
+ ******************************************************************************/
+static int	LearnBest (int firstHour, int lastHour)
+{
+int	 i, hour, best = NONE;
+uint32_t rate, avg, bestRate = 0, bestAvg = 0;
+
+    for (i = 0;  i < 24;  i++)
+    {
+	hour = (LEARN_DFLT_HOUR + i) % 24;
+	if (hour < firstHour  ||  hour > lastHour)
+	    continue;
+
+	rate = (l_HourStat[hour].Success + 1) * 1000UL
+	       / (l_HourStat[hour].Attempts + 2);
+	avg  = (l_HourStat[hour].Success > 0 ? l_HourStat[hour].SyncMin
+		/ l_HourStat[hour].Success : 63);
+
+	if (best == NONE  ||  rate > bestRate
+	||  (rate == bestRate  &&  avg < bestAvg))
+	{
+	    best = hour;
+	    bestRate = rate;
+	    bestAvg  = avg;
+	}
+    }
+
+    return best;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Check for a change of the time zone
+ *
+ * @param[in] pTime
+ *	Date, normalized by mktime().
+ *
+ * @return
+ *	True if this is the last Sunday of March or October.
+ *
+ ******************************************************************************/
+static bool	IsChangeSunday (struct tm *pTime)
+{
+    return ((pTime->tm_mon == 2  ||  pTime->tm_mon == 9)
+	    &&  pTime->tm_mday >= 25  &&  pTime->tm_wday == 0);
+}
+#endif
+
 /***************************************************************************//**
  *
  * @brief	Signal Supervision
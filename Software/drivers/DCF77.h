@@ -2,9 +2,15 @@
  * @file
  * @brief	Header file of module DCF77.c
  * @author	Ralf Gerhauser
- * @version	2014-11-21
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Added DCF77_SUPERVISOR_SLACK.
+2026-10-15,agnt	Added DCF77_LEARN_WINDOW, DCF77_SYNC_TIMEOUT, and prototype for
+		DCF77Check().
+2026-10-14,agnt	Added DCF77_SAMPLE_MODE and DCF77_SAMPLE_POINT.
+		Added DCF77_VOTE_FRAMES.
+		Added DCF77_ADAPTIVE_SYNC and g_DCF77_MaxError.
 2016-04-13,rage	Removed DCF_TRIG_MASK (no more required by EXTI module).
 2016-04-05,rage	Reverted DCF77_ENABLE_PIN to 1 and DCF77_SIGNAL_PIN to 2.
 2015-07-28,rage	Changed DCF77_ENABLE_PIN to 2 and DCF77_SIGNAL_PIN to 1.
@@ -52,6 +58,84 @@ Revision History:
     #define DCF77_INDICATOR		0
 #endif
 
+#ifndef DCF77_SAMPLE_MODE
+    /*!@brief Set 1 to sample the DCF77 signal by an msTimer.
+     * After the SYNC pause, the EXTI of the DCF77 signal is disabled and
+     * the bits 0 to 58 are sampled once per second at @ref DCF77_SAMPLE_POINT
+     * after their (predicted) rising edge.  This halves the number of
+     * interrupts while receiving a frame.  The EXTI is enabled again for the
+     * second 59, to catch the rising edge of the minute mark exactly.
+     */
+    #define DCF77_SAMPLE_MODE		0
+#endif
+
+#ifndef DCF77_SAMPLE_POINT
+    /*!@brief Sample point in [ms] after the rising edge of a DCF77 bit.  A
+     * 0-bit is a pulse of 100ms, a 1-bit of 200ms, so the signal is still
+     * high at this time for a 1-bit only.
+     */
+    #define DCF77_SAMPLE_POINT		150
+#endif
+
+#ifndef DCF77_VOTE_FRAMES
+    /*!@brief Number of DCF77 frames to keep for majority voting, 0 disables
+     * this feature.  If not 0, a frame with a parity error does no longer
+     * abort the reception.  Every field (minutes, hours, date, and MEZ/MESZ)
+     * is checked separately, and the time is accepted as soon as each field
+     * has been received correctly in FRAME_SEQ_CNT of the recent frames.
+     * The frames do not need to be consecutive.
+     */
+    #define DCF77_VOTE_FRAMES		0
+#endif
+
+#ifndef DCF77_ADAPTIVE_SYNC
+    /*!@brief Set 1 to skip the daily synchronization while the clock drift is
+     * low.  At each synchronization the deviation of the system clock is
+     * measured, and the next synchronization takes place when the expected
+     * error exceeds @ref g_DCF77_MaxError, after @ref DCF77_SYNC_MAX_DAYS at
+     * the latest.  This requires @ref DCF77_ONCE_PER_DAY to be 1.
+     */
+    #define DCF77_ADAPTIVE_SYNC		0
+#endif
+
+#ifndef DCF77_SYNC_MAX_DAYS
+    /*!@brief Maximum number of days between two synchronizations. */
+    #define DCF77_SYNC_MAX_DAYS		7
+#endif
+
+#ifndef DFLT_DCF77_MAX_ERROR
+    /*!@brief Default for the maximum expected clock error in [ms], 0 means
+     * to synchronize every day.
+     */
+    #define DFLT_DCF77_MAX_ERROR	250
+#endif
+
+#ifndef DCF77_LEARN_WINDOW
+    /*!@brief Set 1 to learn the hour of the day with the best reception.  The
+     * result and the duration of each daily synchronization are kept in a
+     * histogram per hour in flash, and the daily wake-up is moved to the hour
+     * with the highest success rate.  An attempt is aborted when the pulse
+     * widths show that the signal is too weak, or after
+     * @ref DCF77_SYNC_TIMEOUT, and retried in the next best hour.  This
+     * requires @ref DCF77_ONCE_PER_DAY to be 1.
+     */
+    #define DCF77_LEARN_WINDOW		0
+#endif
+
+#ifndef DCF77_SYNC_TIMEOUT
+    /*!@brief Maximum duration in [min] of a daily synchronization attempt
+     * with @ref DCF77_LEARN_WINDOW.
+     */
+    #define DCF77_SYNC_TIMEOUT		30
+#endif
+
+#ifndef DCF77_SUPERVISOR_SLACK
+    /*!@brief Number of seconds the detection of a lost signal may be delayed
+     * to share the wake-up of another timer, see sTimerStartSlack().
+     */
+    #define DCF77_SUPERVISOR_SLACK	2
+#endif
+
 /*!@brief Here follows the definition of GPIO ports and pins used to connect
  * to the external DCF77 hardware module.
  */
@@ -67,6 +151,10 @@ Revision History:
 /*!@brief Bit mask of the affected external interrupt (EXTI). */
 #define DCF_EXTI_MASK		(1 << DCF77_SIGNAL_PIN)
 
+/*======================== External Data and Routines ========================*/
+
+extern int32_t	g_DCF77_MaxError;
+
 /*================================ Prototypes ================================*/
 
 /* Initialize DCF77 hardware */
@@ -81,5 +169,8 @@ void	DCF77Disable (void);
 /* Signal handler, called from interrupt service routine */
 void	DCF77Handler	(int extiNum, bool extiLvl, uint32_t timeStamp);
 
+/* Store the result of a synchronization attempt, called from the main loop */
+void	DCF77Check (void);
+
 
 #endif /* __INC_DCF77_h */
@@ -0,0 +1,209 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Deferred Work of the Interrupt Service Routines
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * The interrupts of the UARTs, the DMA, and the SMBus share one priority
+ * level, and the RTC and the EXTIs share another one.  So an interrupt
+ * service routine which does a lot of work, e.g. the alarm clock calling its
+ * timer functions, delays all others of its level.  With @ref DEFER_WORK,
+ * such a routine is split into two halves:
+ * - The top half runs in the interrupt.  It only reads the hardware, e.g.
+ *   the captured time stamp of an edge, clears the interrupt flags, and
+ *   queues a work item via DeferCall().
+ * - The bottom half is the function of the work item.  It is called by
+ *   PendSV_Handler(), which has the lowest priority @ref INT_PRIO_DEFER.
+ *   The PendSV exception is taken as soon as no other interrupt is active,
+ *   i.e. still before the main loop continues or enters a sleep mode.
+ *
+ * The work items are executed one after the other, in the order they have
+ * been queued.  So the bottom halves lock out each other, like interrupt
+ * service routines of the same priority, while all top halves may preempt
+ * them.  This is used by the alarm clock, see RTC_IRQHandler(), and for the
+ * light barriers and DCF77, see ExtIntDeferInit().
+ *
+ * If the queue is full, DeferCall() returns false, and the caller has to
+ * handle this, e.g. by calling the function at once.  The maximum number
+ * of queued items, and the number of full conditions are shown by
+ * DeferReport().
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	DeferCall() emits an ITM trace record of the queue depth.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_int.h"
+#include "Defer.h"
+#include "IsrProfile.h"
+#include "ItmTrace.h"
+#include "LEUART.h"
+#include "StrFormat.h"
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Work item of the queue. */
+typedef struct
+{
+    DEFER_FCT	Fct;		//!< function to be called
+    uint32_t	Arg1;		//!< first argument
+    uint32_t	Arg2;		//!< second argument
+} DEFER_ITEM;
+
+/*================================ Local Data ================================*/
+
+#if DEFER_WORK
+    /*! Queue of the work items */
+static DEFER_ITEM	l_Queue[DEFER_QUEUE_SIZE];
+
+    /*! Indexes into the queue, they are only incremented */
+static volatile uint16_t l_QuePut, l_QueGet;
+
+    /*! Maximum number of items in the queue */
+static uint16_t	l_QueMax;
+
+    /*! Number of work items which did not fit into the queue */
+static uint16_t	l_QueFullCnt;
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Deferred Work
+ *
+ * This routine sets the priority of the PendSV exception to
+ * @ref INT_PRIO_DEFER.  It must be called once before any interrupt is
+ * enabled.
+ *
+ ******************************************************************************/
+void	DeferInit (void)
+{
+#if DEFER_WORK
+    NVIC_SetPriority(PendSV_IRQn, INT_PRIO_DEFER);
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Queue a Work Item
+ *
+ * This routine queues a call of <b>fct</b> for the PendSV handler.  It may be
+ * called from any interrupt service routine, and from the main loop.  If
+ * @ref DEFER_WORK is 0, the function is called at once.
+ *
+ * @param[in] fct
+ *	Function to be called.
+ *
+ * @param[in] arg1
+ *	First argument of the function.
+ *
+ * @param[in] arg2
+ *	Second argument of the function.
+ *
+ * @return
+ * 	The value <i>false</i> if the queue is full, the item is discarded then.
+ *
+ ******************************************************************************/
+bool	DeferCall (DEFER_FCT fct, uint32_t arg1, uint32_t arg2)
+{
+#if DEFER_WORK
+DEFER_ITEM *pItem;
+uint16_t cnt;
+
+    INT_Disable();
+
+    cnt = (uint16_t)(l_QuePut - l_QueGet);
+    if (cnt >= DEFER_QUEUE_SIZE)
+    {
+	l_QueFullCnt++;
+	INT_Enable();
+	return false;
+    }
+    if (cnt >= l_QueMax)
+	l_QueMax = cnt + 1;
+
+    pItem = &l_Queue[l_QuePut % DEFER_QUEUE_SIZE];
+    pItem->Fct  = fct;
+    pItem->Arg1 = arg1;
+    pItem->Arg2 = arg2;
+    l_QuePut++;
+    ITM_TRACE_QUEUE(ITM_QUE_DEFER, cnt + 1);
+
+    SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+
+    INT_Enable();
+#else
+    fct (arg1, arg2);
+#endif
+
+    return true;
+}
+
+
+#if DEFER_WORK
+/***************************************************************************//**
+ *
+ * @brief	PendSV Handler
+ *
+ * This is the handler of the PendSV exception.  It calls the functions of all
+ * queued work items, including those which are queued meanwhile.
+ *
+ ******************************************************************************/
+void	PendSV_Handler (void)
+{
+DEFER_ITEM item;
+
+    ISR_PROF_ENTER();
+
+    INT_Disable();
+    while (l_QueGet != l_QuePut)
+    {
+	item = l_Queue[l_QueGet % DEFER_QUEUE_SIZE];
+	l_QueGet++;
+	INT_Enable();
+
+	item.Fct (item.Arg1, item.Arg2);
+
+	INT_Disable();
+    }
+    INT_Enable();
+
+    ISR_PROF_EXIT(ISR_PROF_DEFER);
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Queue Statistics
+ *
+ * This routine shows the maximum number of queued work items, and how often
+ * the queue has been full.  The cycles of the PendSV handler are part of the
+ * ISR profile, see IsrProfileReport().
+ *
+ * @param[in] flgReset
+ *	If true, the statistics are reset afterwards.
+ *
+ ******************************************************************************/
+void	DeferReport (bool flgReset)
+{
+#if DEFER_WORK
+char	line[80];
+
+    StrFormat (line, "Deferred work: max %d of %d items queued, %d times"
+	       " full\n", l_QueMax, DEFER_QUEUE_SIZE, l_QueFullCnt);
+    drvLEUART_puts (line);
+
+    if (flgReset)
+    {
+	INT_Disable();
+	l_QueMax = 0;
+	l_QueFullCnt = 0;
+	INT_Enable();
+    }
+#endif
+}
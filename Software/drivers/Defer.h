@@ -0,0 +1,63 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Defer.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Reduced DEFER_QUEUE_SIZE to 8.
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_Defer_h
+#define __INC_Defer_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to execute the work of DeferCall() in the
+ * PendSV handler, i.e. after all other interrupts.  If 0, the function is
+ * called at once by DeferCall().
+ */
+#ifndef DEFER_WORK
+    #define DEFER_WORK		0
+#endif
+
+/*!@brief Number of work items in the queue, must be a power of 2.  Each item
+ * takes 12 bytes of RAM.  The RTC queues at most one item, the EXTI one per
+ * deferred edge.  If the queue is full, DeferCall() returns false, and the
+ * caller does the work at once.
+ */
+#ifndef DEFER_QUEUE_SIZE
+    #define DEFER_QUEUE_SIZE	8
+#endif
+
+/*!@brief Priority of the PendSV handler, the lowest one. */
+#ifndef INT_PRIO_DEFER
+    #define INT_PRIO_DEFER	7
+#endif
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Function of a work item, with the arguments of DeferCall(). */
+typedef void	(* DEFER_FCT)(uint32_t arg1, uint32_t arg2);
+
+/*================================ Prototypes ================================*/
+
+    /* Set the priority of the PendSV handler */
+void	DeferInit (void);
+
+    /* Queue a work item for the PendSV handler */
+bool	DeferCall (DEFER_FCT fct, uint32_t arg1, uint32_t arg2);
+
+    /* Show the queue statistics on the console, optionally reset them */
+void	DeferReport (bool flgReset);
+
+
+#endif /* __INC_Defer_h */
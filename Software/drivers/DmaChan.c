@@ -0,0 +1,252 @@
+/***************************************************************************//**
+ * @file
+ * @brief	DMA Channel Allocator
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module manages the 8 channels of the DMA controller, their callback
+ * structures in @ref g_DMA_Callback, and their owners.  There are two kinds
+ * of channels:
+ * - The channels below @ref DMA_CHAN_SHARED_FIRST are assigned to drivers
+ *   which keep them all the time, e.g. a receiver which is always armed.
+ *   Their numbers are defined in config.h, see DMA Channel Assignment.
+ *   A driver sets up its channel by DmaChanConfig(), which may be called
+ *   again, e.g. after a power-up, but fails if the channel belongs to
+ *   another driver.
+ * - The channels from @ref DMA_CHAN_SHARED_FIRST on are shared by users
+ *   which need a channel only for the duration of a transfer.  DmaChanAlloc()
+ *   returns a free channel, and DmaChanFree() releases it after the
+ *   transfer.  If all of them are in use, the caller must fall back to a
+ *   transfer by the CPU.
+ *
+ * Both functions set the callback function and its user pointer, the
+ * priority and the request source of the channel are taken from the channel
+ * configuration, as it is passed to DMA_CfgChannel().  The descriptors are
+ * still set up by the driver.  DmaChanAlloc() and DmaChanFree() may be called
+ * from interrupt context.
+ *
+ * The DMA controller itself is initialized by drvLEUART_Init().
+ * DmaChanReport() shows the owner of each channel, how often the shared
+ * channels have been allocated, and how often no channel was available.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_int.h"
+#include "DmaChan.h"
+#include "LEUART.h"
+#include "Logging.h"
+#include "StrFormat.h"
+
+/*=============================== Definitions ================================*/
+
+#if DMA_CHAN_SHARED_FIRST > DMA_CHAN_COUNT
+    #error "DMA_CHAN_SHARED_FIRST exceeds the number of DMA channels"
+#endif
+
+/*================================ Global Data ===============================*/
+
+extern DMA_CB_TypeDef g_DMA_Callback[];
+
+/*================================ Local Data ================================*/
+
+    /*! Owner of each channel, NULL if the channel is free */
+static const char *l_DmaOwner[DMA_CHAN_COUNT];
+
+    /*! Number of allocations of the shared channels, and of failures */
+static uint32_t	l_DmaAllocCnt, l_DmaFailCnt;
+
+    /*! Peak number of shared channels in use at the same time */
+static uint8_t	l_DmaUsed, l_DmaPeak;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	DmaChanSetup (unsigned int chan, const char *pOwner,
+			      DMA_CfgChannel_TypeDef *pCfg,
+			      DMA_FuncPtr_TypeDef cbFunc, void *userPtr);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Configure an Assigned Channel
+ *
+ * This routine sets up channel <b>chan</b> for its driver, which keeps it
+ * until the next call.  It must be called from the initialization of the
+ * driver, after the DMA controller has been initialized.
+ *
+ * @param[in] chan
+ *	DMA channel as assigned in config.h.
+ *
+ * @param[in] pOwner
+ *	Name of the driver, it also identifies the owner of the channel.
+ *
+ * @param[in] pCfg
+ *	Configuration of the channel, its callback pointer is set here.
+ *
+ * @param[in] cbFunc
+ *	Function to be called when the transfer is done, or NULL.
+ *
+ * @param[in] userPtr
+ *	User pointer for the callback function.
+ *
+ * @return
+ * 	The value <i>false</i> if the channel belongs to another driver.
+ *
+ ******************************************************************************/
+bool	DmaChanConfig (unsigned int chan, const char *pOwner,
+		       DMA_CfgChannel_TypeDef *pCfg,
+		       DMA_FuncPtr_TypeDef cbFunc, void *userPtr)
+{
+    if (chan >= DMA_CHAN_SHARED_FIRST
+    ||  (l_DmaOwner[chan] != NULL  &&  l_DmaOwner[chan] != pOwner))
+    {
+	LogError ("DMA: Channel %d requested by %s is not available",
+		  chan, pOwner);
+	return false;
+    }
+
+    DmaChanSetup (chan, pOwner, pCfg, cbFunc, userPtr);
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Allocate a Shared Channel
+ *
+ * This routine allocates a free channel from @ref DMA_CHAN_SHARED_FIRST on,
+ * and configures it.  The channel must be released by DmaChanFree() when the
+ * transfer is done.
+ *
+ * @param[in] pOwner
+ *	Name of the user, it is shown by DmaChanReport().
+ *
+ * @param[in] pCfg
+ *	Configuration of the channel, its callback pointer is set here.
+ *
+ * @param[in] cbFunc
+ *	Function to be called when the transfer is done, or NULL.
+ *
+ * @param[in] userPtr
+ *	User pointer for the callback function.
+ *
+ * @return
+ * 	Number of the channel, or @ref DMA_CHAN_NONE if all shared channels
+ * 	are in use.
+ *
+ ******************************************************************************/
+int	DmaChanAlloc (const char *pOwner, DMA_CfgChannel_TypeDef *pCfg,
+		      DMA_FuncPtr_TypeDef cbFunc, void *userPtr)
+{
+unsigned int chan;
+
+    INT_Disable();
+
+    for (chan = DMA_CHAN_SHARED_FIRST;  chan < DMA_CHAN_COUNT;  chan++)
+    {
+	if (l_DmaOwner[chan] == NULL)
+	    break;
+    }
+
+    if (chan >= DMA_CHAN_COUNT)
+    {
+	l_DmaFailCnt++;
+	INT_Enable();
+	return DMA_CHAN_NONE;
+    }
+
+    l_DmaOwner[chan] = pOwner;
+    l_DmaAllocCnt++;
+    if (++l_DmaUsed > l_DmaPeak)
+	l_DmaPeak = l_DmaUsed;
+
+    INT_Enable();
+
+    DmaChanSetup (chan, pOwner, pCfg, cbFunc, userPtr);
+    return (int)chan;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Release a Shared Channel
+ *
+ * This routine disables a channel which has been allocated by DmaChanAlloc(),
+ * including its interrupt, and makes it available again.
+ *
+ * @param[in] chan
+ *	Number of the channel, @ref DMA_CHAN_NONE is ignored.
+ *
+ ******************************************************************************/
+void	DmaChanFree (int chan)
+{
+    if (chan < DMA_CHAN_SHARED_FIRST  ||  chan >= DMA_CHAN_COUNT)
+	return;
+
+    INT_Disable();
+
+    if (l_DmaOwner[chan] != NULL)
+    {
+	DMA->CHENC = (1 << chan);
+	DMA->IEN  &= ~(1 << chan);
+	g_DMA_Callback[chan].cbFunc  = NULL;
+	g_DMA_Callback[chan].userPtr = NULL;
+	l_DmaOwner[chan] = NULL;
+	l_DmaUsed--;
+    }
+
+    INT_Enable();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set up a Channel
+ *
+ * This routine stores the owner and the callback of the channel, and
+ * configures it.
+ *
+ ******************************************************************************/
+static void	DmaChanSetup (unsigned int chan, const char *pOwner,
+			      DMA_CfgChannel_TypeDef *pCfg,
+			      DMA_FuncPtr_TypeDef cbFunc, void *userPtr)
+{
+    l_DmaOwner[chan] = pOwner;
+
+    g_DMA_Callback[chan].cbFunc  = cbFunc;
+    g_DMA_Callback[chan].userPtr = userPtr;
+    pCfg->cb = (cbFunc != NULL ? &g_DMA_Callback[chan] : NULL);
+
+    DMA_CfgChannel (chan, pCfg);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Channel Owners
+ *
+ * This routine shows the owner of each DMA channel, and the allocation
+ * statistics of the shared channels on the console.
+ *
+ ******************************************************************************/
+void	DmaChanReport (void)
+{
+char	line[80];
+unsigned int chan;
+
+    for (chan = 0;  chan < DMA_CHAN_COUNT;  chan++)
+    {
+	StrFormat (line, "DMA %d%s: %s\n", chan,
+		   (chan >= DMA_CHAN_SHARED_FIRST ? " (shared)" : ""),
+		   (l_DmaOwner[chan] != NULL ? l_DmaOwner[chan] : "-"));
+	drvLEUART_puts (line);
+    }
+
+    StrFormat (line, "DMA shared: %ld allocations, peak %d, %ld failed\n",
+	       l_DmaAllocCnt, l_DmaPeak, l_DmaFailCnt);
+    drvLEUART_puts (line);
+}
@@ -0,0 +1,51 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module DmaChan.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_DmaChan_h
+#define __INC_DmaChan_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "em_dma.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief First DMA channel which is allocated on demand by DmaChanAlloc().
+ * The channels below are assigned to their drivers, see the DMA Channel
+ * Assignment in config.h.
+ */
+#ifndef DMA_CHAN_SHARED_FIRST
+    #define DMA_CHAN_SHARED_FIRST	(DMA_CHAN_RFID2_RX + 1)
+#endif
+
+/*!@brief Return value of DmaChanAlloc() if no channel is available. */
+#define DMA_CHAN_NONE		(-1)
+
+/*================================ Prototypes ================================*/
+
+    /* Configure an assigned channel for its driver */
+bool	DmaChanConfig (unsigned int chan, const char *pOwner,
+		       DMA_CfgChannel_TypeDef *pCfg,
+		       DMA_FuncPtr_TypeDef cbFunc, void *userPtr);
+
+    /* Allocate and configure a shared channel, and release it again */
+int	DmaChanAlloc (const char *pOwner, DMA_CfgChannel_TypeDef *pCfg,
+		      DMA_FuncPtr_TypeDef cbFunc, void *userPtr);
+void	DmaChanFree (int chan);
+
+    /* Show the owners of the channels on the console */
+void	DmaChanReport (void);
+
+
+#endif /* __INC_DmaChan_h */
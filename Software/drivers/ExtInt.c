@@ -2,7 +2,7 @@
  * @file
  * @brief	External Interrupt Handling
  * @author	Ralf Gerhauser
- * @version	2018-03-14
+ * @version	2026-10-15
  *
  * The purpose of this module is to handle any kind of external interrupts
  * (EXTI).  In detail, this includes:
@@ -19,6 +19,20 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	The capture channels are kept in the bit map l_CapChMap instead
+		of the dispatch table.
+2026-10-15,agnt	EXTI_Handler posts EVT_WAKE instead of setting g_flgIRQ.
+2026-10-15,agnt	Added ExtIntDeferInit(): The handlers of selected EXTIs are
+		called in the PendSV handler, see Defer.c.
+2026-10-15,agnt	The capture clocks are acquired via ClockMgr.c.
+2026-10-15,agnt	ExtIntClockChange() recalculates the scale of the captures after
+		a switch of the HF clock, see HF_CLOCK_GOVERNOR.
+2026-10-15,agnt	Added ExtIntCaptureInit(): Edges of selected EXTIs are captured
+		by a TIMER via PRS, the time stamp passed to the handler is
+		corrected by the interrupt latency, see EXTI_CAPTURE.
+2026-10-15,agnt	EXTI_Handler: Dispatch via table l_ExtiDispatch[], which is built
+		by ExtIntInit() and holds the handler and the bit-band address
+		of the input level for each EXTI.
 2018-03-14,rage	Set interrupt priority for GPIO_EVEN_IRQn and GPIO_ODD_IRQn.
 2017-05-12,rage	Implemented ExtIntReplay().
 2017-05-02,rage	ExtIntEnableAll: Manually set all configured EXTI interrupts to
@@ -43,14 +57,44 @@ Revision History:
 #include "em_device.h"
 #include "em_assert.h"
 #include "em_bitband.h"
+#include "em_cmu.h"
 #include "config.h"		// include project configuration parameters
+#include "IsrProfile.h"
+#include "AlarmClock.h"
+#include "ClockMgr.h"
+#include "Defer.h"
 
 
 /*=============================== Definitions ================================*/
 
+    /*!@brief Address to read the level of the GPIO input connected to an
+     * EXTI, and the level itself (0 or 1).  The host simulation has no
+     * bit-band area, the data input register is used there.
+     */
+#ifdef SIMULATION
+#define EXTI_LEVEL_ADDR(portNum, extiNum)  (&GPIO->P[portNum].DIN)
+#define EXTI_LEVEL(pLevel, extiNum)	   ((*(pLevel) >> (extiNum)) & 1)
+#else
+#define EXTI_LEVEL_ADDR(portNum, extiNum)					\
+	IO_BIT_ADDR(&GPIO->P[portNum].DIN, extiNum)
+#define EXTI_LEVEL(pLevel, extiNum)	   (*(pLevel))
+#endif
+
+#if EXTI_CAPTURE
+    /*! Number of capture channels of a TIMER */
+#define EXTI_CAPTURE_CH_CNT	3
+    /*! Capture channel of an EXTI in @ref l_CapBitMask, see l_CapChMap */
+#define EXTI_CAP_CH(extiNum)	((int)(l_CapChMap >> (2 * (extiNum))) & 0x3)
+#endif
 
 /*=========================== Typedefs and Structs ===========================*/
 
+    /*!@brief Dispatch entry of an EXTI. */
+typedef struct
+{
+    EXTI_FCT	   Fct;		//!< handler, or extiCallAll() for several
+    __I  uint32_t *pLevel;	//!< address of the input level, see EXTI_LEVEL
+} EXTI_DISPATCH;
 
 /*======================== External Data and Routines ========================*/
 
@@ -69,9 +113,34 @@ static volatile uint32_t l_extiBitMask;
     /*! Flag is set during the "replay" of external interrupts */
 static volatile bool	 l_flgExtiReplay;
 
+    /*! Dispatch table, indexed by the EXTI number */
+static EXTI_DISPATCH	 l_ExtiDispatch[16];
+
+    /*! Bit mask of the EXTIs whose handlers are deferred */
+static uint32_t		 l_DeferBitMask;
+
+#if EXTI_CAPTURE
+    /*! Factor to convert TIMER ticks into RTC ticks, 16 bit fraction */
+static uint32_t		 l_CapScale;
+
+    /*! Bit mask of the EXTIs which are captured by the TIMER */
+static uint32_t		 l_CapBitMask;
+
+    /*! Capture channel of each EXTI, 2 bits per EXTI number */
+static uint32_t		 l_CapChMap;
+#endif
+
 /*=========================== Forward Declarations ===========================*/
 
 void	EXTI_Handler (void);
+static void extiCallAll (int extiNum, bool extiLvl, uint32_t timeStamp);
+static void extiLevelAddrUpdate (int extiNum);
+static void extiDeferred (uint32_t arg1, uint32_t timeStamp);
+#if EXTI_CAPTURE
+static uint32_t extiCaptureTime (int capCh, uint32_t timeStamp,
+				 uint32_t timerCnt);
+static void extiCaptureClear (int capCh);
+#endif
 
 
 /***************************************************************************//**
@@ -94,9 +163,16 @@ void	EXTI_Handler (void);
  *	This routine does not enable the interrupts, call ExtIntEnableAll()
  *	for that purpose, or enable individual interrupt via ExtIntEnable().
  *
+ * @note
+ *	The dispatch table l_ExtiDispatch[] is built here.  The GPIO port of
+ *	an EXTI is determined when enabling it, so a pin may be re-connected
+ *	via GPIO_IntConfig() while its EXTI is disabled, as RFID_Init() does.
+ *
  ******************************************************************************/
 void	ExtIntInit (const EXTI_INIT *pInitStruct)
 {
+int	extiNum;
+
     /* Parameter check */
     EFM_ASSERT(pInitStruct != NULL);
 
@@ -115,10 +191,28 @@ void	ExtIntInit (const EXTI_INIT *pInitStruct)
      */
     l_extiBitMask = 0;
 
+    for (extiNum = 0;  extiNum < 16;  extiNum++)
+    {
+	l_ExtiDispatch[extiNum].Fct = NULL;
+    }
+
     while (pInitStruct->IntBitMask != 0)
     {
 	l_extiBitMask |= pInitStruct->IntBitMask;	// add to bit mask
 
+	/* enter handler, several handlers for an EXTI are called in turn */
+	for (extiNum = 0;  extiNum < 16;  extiNum++)
+	{
+	    if (pInitStruct->IntBitMask & (1 << extiNum))
+	    {
+		if (l_ExtiDispatch[extiNum].Fct == NULL)
+		    l_ExtiDispatch[extiNum].Fct = pInitStruct->IntFct;
+		else
+		    l_ExtiDispatch[extiNum].Fct = extiCallAll;
+
+		extiLevelAddrUpdate (extiNum);
+	    }
+	}
 	pInitStruct++;
     }
 
@@ -136,6 +230,133 @@ void	ExtIntInit (const EXTI_INIT *pInitStruct)
     NVIC_EnableIRQ (GPIO_ODD_IRQn);
 }
 
+#if EXTI_CAPTURE
+/***************************************************************************//**
+ *
+ * @brief	Capture External Interrupts by a TIMER
+ *
+ * The time stamp of an EXTI is read from the RTC when EXTI_Handler() runs,
+ * i.e. it includes the latency of the interrupt, which may be some
+ * milliseconds when other interrupt service routines run first.  For the
+ * specified EXTIs, the GPIO signal is routed via PRS to a capture channel of
+ * @ref EXTI_CAPTURE_TIMER, which latches its counter on each edge.
+ * EXTI_Handler() then subtracts the time elapsed since the capture from the
+ * time stamp.
+ *
+ * The TIMER is clocked by HFPERCLK, which is stopped in EM2.  For an edge
+ * that wakes up the CPU from EM2 no capture exists, the latency is small in
+ * this case and the RTC value is used as before.
+ *
+ * @param[in] extiMask
+ *	Bit mask of the EXTIs to be captured, up to three.  These must have
+ *	been configured by ExtIntInit() before.
+ *
+ * @note
+ *	PRS channels @ref EXTI_CAPTURE_PRS_CH and the following are used.
+ *
+ ******************************************************************************/
+void	ExtIntCaptureInit (uint32_t extiMask)
+{
+int	extiNum;
+int	capCh = 0;
+uint32_t freq;
+
+    /* Parameter check */
+    EFM_ASSERT((extiMask & ~l_extiBitMask) == 0);
+
+    ClockAcquire (CLK_OWN_EXTINT, cmuClock_PRS);
+    ClockAcquire (CLK_OWN_EXTINT, EXTI_CAPTURE_CLOCK);
+
+    /* Free running 16 bit counter with HFPERCLK / 256 */
+    EXTI_CAPTURE_TIMER->CTRL = TIMER_CTRL_MODE_UP | TIMER_CTRL_PRESC_DIV256;
+    EXTI_CAPTURE_TIMER->TOP  = 0xFFFF;
+
+    freq = CMU_ClockFreqGet (EXTI_CAPTURE_CLOCK) / 256;
+    if (freq == 0)
+	return;			// no capture possible
+
+    l_CapScale = (uint32_t)(((uint64_t)RTC_COUNTS_PER_SEC << 16) / freq);
+    l_CapBitMask = 0;
+    l_CapChMap = 0;
+
+    for (extiNum = 0;  extiNum < 16;  extiNum++)
+    {
+	if ((extiMask & (1 << extiNum)) == 0)
+	    continue;
+
+	EFM_ASSERT(capCh < EXTI_CAPTURE_CH_CNT);
+	if (capCh >= EXTI_CAPTURE_CH_CNT)
+	    break;
+
+	/* Route the GPIO signal of the EXTI to the PRS channel */
+	PRS->CH[EXTI_CAPTURE_PRS_CH + capCh].CTRL =
+		(extiNum < 8 ? PRS_CH_CTRL_SOURCESEL_GPIOL
+			     : PRS_CH_CTRL_SOURCESEL_GPIOH)
+		| ((extiNum & 0x7) << _PRS_CH_CTRL_SIGSEL_SHIFT)
+		| PRS_CH_CTRL_EDSEL_OFF;
+
+	/* Capture both edges of the PRS channel */
+	EXTI_CAPTURE_TIMER->CC[capCh].CTRL = TIMER_CC_CTRL_MODE_INPUTCAPTURE
+		| TIMER_CC_CTRL_INSEL
+		| ((EXTI_CAPTURE_PRS_CH + capCh) << _TIMER_CC_CTRL_PRSSEL_SHIFT)
+		| TIMER_CC_CTRL_ICEDGE_BOTH | TIMER_CC_CTRL_ICEVCTRL_EVERYEDGE;
+
+	l_CapChMap |= ((uint32_t)capCh++ << (2 * extiNum));
+	l_CapBitMask |= (1 << extiNum);
+    }
+
+    EXTI_CAPTURE_TIMER->IFC = _TIMER_IFC_MASK;
+    EXTI_CAPTURE_TIMER->CMD = TIMER_CMD_START;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Defer the Handlers of External Interrupts
+ *
+ * For the specified EXTIs, EXTI_Handler() only reads the time stamp and the
+ * level of the input, and queues the call of the handler via DeferCall().
+ * The handler is then executed by the PendSV handler, after all other
+ * interrupts, so it may do more work without delaying them.  Since the
+ * time stamp has been taken in the interrupt, it is not affected.
+ *
+ * @param[in] extiMask
+ *	Bit mask of the EXTIs to be deferred.  These must have been
+ *	configured by ExtIntInit() before.
+ *
+ ******************************************************************************/
+void	ExtIntDeferInit (uint32_t extiMask)
+{
+    /* Parameter check */
+    EFM_ASSERT((extiMask & ~l_extiBitMask) == 0);
+
+    l_DeferBitMask = extiMask;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Clock Change of the Capture TIMER
+ *
+ * This routine is called by the HF clock governor after the HF clock has
+ * been switched, see HfClockBoost().  It recalculates the factor to convert
+ * TIMER ticks into RTC ticks.  An edge that has been captured before the
+ * switch is corrected with the new factor, the error is limited by
+ * @ref EXTI_CAPTURE_MAX_MS.
+ *
+ ******************************************************************************/
+void	ExtIntClockChange (void)
+{
+uint32_t freq;
+
+    if (l_CapScale == 0)
+	return;			// capture is not in use
+
+    freq = CMU_ClockFreqGet (EXTI_CAPTURE_CLOCK) / 256;
+    if (freq > 0)
+	l_CapScale = (uint32_t)(((uint64_t)RTC_COUNTS_PER_SEC << 16) / freq);
+}
+#endif
+
 /***************************************************************************//**
  *
  * @brief	Disable all External Interrupts
@@ -159,6 +380,22 @@ void	ExtIntDisableAll (void)
  ******************************************************************************/
 void	ExtIntEnableAll (void)
 {
+int	extiNum;
+
+    /* GPIO ports may have been re-connected */
+    for (extiNum = 0;  extiNum < 16;  extiNum++)
+    {
+	if (l_extiBitMask & (1 << extiNum))
+	{
+	    extiLevelAddrUpdate (extiNum);
+#if EXTI_CAPTURE
+	    /* discard captures of edges that are not serviced */
+	    if (l_CapBitMask & (1 << extiNum))
+		extiCaptureClear (EXTI_CAP_CH(extiNum));
+#endif
+	}
+    }
+
     /* Clear any pending interrupt */
     GPIO->IFC = 0xFFFF;
 
@@ -230,6 +467,15 @@ void	ExtIntEnable (int extiNum)
     /* Parameter check */
     EFM_ASSERT(0 <= extiNum  &&  extiNum <= 15);
 
+    /* GPIO port may have been re-connected */
+    extiLevelAddrUpdate (extiNum);
+
+#if EXTI_CAPTURE
+    /* Discard captures of edges that are not serviced */
+    if (l_CapBitMask & (1 << extiNum))
+	extiCaptureClear (EXTI_CAP_CH(extiNum));
+#endif
+
     /* Clear any pending interrupt */
     GPIO->IFC = (1 << extiNum);
 
@@ -248,7 +494,9 @@ void	ExtIntEnable (int extiNum)
 void	GPIO_EVEN_IRQHandler (void)
 {
     DEBUG_TRACE(0x04);
+    ISR_PROF_ENTER();
     EXTI_Handler();
+    ISR_PROF_EXIT(ISR_PROF_EXTI);
     DEBUG_TRACE(0x84);
 }
 
@@ -263,7 +511,9 @@ void	GPIO_EVEN_IRQHandler (void)
 void	GPIO_ODD_IRQHandler (void)
 {
     DEBUG_TRACE(0x05);
+    ISR_PROF_ENTER();
     EXTI_Handler();
+    ISR_PROF_EXIT(ISR_PROF_EXTI);
     DEBUG_TRACE(0x85);
 }
 
@@ -276,31 +526,38 @@ void	GPIO_ODD_IRQHandler (void)
  * The sequence of operations in detail:
  * -# Receive EXTI on rising or falling edge.
  * -# Read current RTC value for time stamp.
- * -# For each interrupt perform the following actions:
- *    - Determine and call the corresponding handler.
- *    - Change the trigger type, i.e. rising to falling edge, and vice versa.
+ * -# For each interrupt, read the level of its input, and call the handler
+ *    from the dispatch table l_ExtiDispatch[].  This does not depend on the
+ *    number of entries in the EXTI configuration.
  * -# Clear all received interrupts at once.
  * -# Return from interrupt.
  *
  * @note
  * The time stamp is read from the Real Time Counter (RTC), so its resolution
  * depends on the RTC.  A time stamp of 0 indicates a "replay" of the external
- * interrupts, see ExtIntReplay().
+ * interrupts, see ExtIntReplay().  For EXTIs which are captured by a TIMER,
+ * the time stamp is corrected by the latency, see ExtIntCaptureInit().
+ * The handlers of deferred EXTIs are called later, see ExtIntDeferInit().
  *
  ******************************************************************************/
 void	EXTI_Handler (void)
 {
 uint32_t  timeStamp;		// current time value from RTC
+#if EXTI_CAPTURE
+uint32_t  timerCnt;		// current value of the capture TIMER
+#endif
+uint32_t  extiTime;		// time stamp of an EXTI
+bool	  extiLvl;		// level of the EXTI input
 uint32_t  status;		// interrupt status flags
 uint32_t  irqMask;		// bit mask of active external interrupts
 int	  extiNum;		// EXTI number
-uint32_t  extiBitMask;		// bit mask for EXTI number <extiNum>
-int	  portNum;		// GPIO port number of an EXTI
-bool	  extiLvl;		// current level of EXTI
-const EXTI_INIT *pExtIntCfg;	// pointer to EXTI configuration data
+const EXTI_DISPATCH *pDispatch;	// dispatch entry of this EXTI
 
     /* get time stamp from RTC, or set 0 for "replay" */
     timeStamp = l_flgExtiReplay ? 0 : RTC->CNT;
+#if EXTI_CAPTURE
+    timerCnt  = EXTI_CAPTURE_TIMER->CNT;
+#endif
 
     /* get EXTI status and mask out all disabled interrupts */
     status  = GPIO->IF;
@@ -318,34 +575,153 @@ const EXTI_INIT *pExtIntCfg;	// pointer to EXTI configuration data
     {
 	/* get bit number of the highest EXTI from the bit mask */
 	extiNum = 31 - __CLZ (irqMask);
-	extiBitMask = (0x1 << extiNum);
 
 	/* remove this interrupt from the bit mask */
-	irqMask &= ~extiBitMask;
-
-	/* get associated port number */
-	if (extiNum < 8)
-	    portNum = (GPIO->EXTIPSELL >> (extiNum * 4)) & 0x7;
-	else
-	    portNum = (GPIO->EXTIPSELH >> ((extiNum-8) * 4)) & 0x7;
-
-	/* determine whether rising or falling edge */
-	extiLvl = GPIO->P[portNum].DIN & extiBitMask ? true : false;
-
-	/* see which functions to be called for this EXTI */
-	for (pExtIntCfg = l_pExtIntCfg;
-	     pExtIntCfg->IntBitMask != 0;  pExtIntCfg++)
-	{
-	    if (pExtIntCfg->IntBitMask & extiBitMask)
-	    {
-		/* call all handlers that request this EXTI */
-		pExtIntCfg->IntFct(extiNum, extiLvl, timeStamp);
-	    }
-	}
+	irqMask &= ~(0x1 << extiNum);
+
+	/* level determines whether rising or falling edge */
+	pDispatch = &l_ExtiDispatch[extiNum];
+	extiLvl = (EXTI_LEVEL(pDispatch->pLevel, extiNum) != 0);
+	extiTime = timeStamp;
+#if EXTI_CAPTURE
+	if ((l_CapBitMask & (1 << extiNum))  &&  timeStamp != 0)
+	    extiTime = extiCaptureTime (EXTI_CAP_CH(extiNum), timeStamp, timerCnt);
+#endif
+
+	/* handler may be deferred, it is called at once if the queue is full */
+	if ((l_DeferBitMask & (1 << extiNum)) == 0
+	||  ! DeferCall (extiDeferred, extiNum | (extiLvl << 8), extiTime))
+	    pDispatch->Fct(extiNum, extiLvl, extiTime);
     }
 
     /* clear interrupt status bits */
     GPIO->IFC = status;
 
-    g_flgIRQ = true;	// keep on running
+    EVENT_POST(EVT_WAKE);	// keep on running
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Call the Handler of a deferred EXTI
+ *
+ * This routine is queued by EXTI_Handler() via DeferCall().  It calls the
+ * handler of the EXTI from the dispatch table.
+ *
+ * @param[in] arg1
+ *	EXTI number in bits 0 to 7, level of the input in bit 8.
+ *
+ * @param[in] timeStamp
+ *	Time stamp of the EXTI, as read by EXTI_Handler().
+ *
+ ******************************************************************************/
+static void extiDeferred (uint32_t arg1, uint32_t timeStamp)
+{
+int	extiNum = (int)(arg1 & 0xFF);
+
+    l_ExtiDispatch[extiNum].Fct(extiNum, (arg1 >> 8) & 1, timeStamp);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Call all Handlers of an EXTI
+ *
+ * This routine is entered into the dispatch table for an EXTI that is
+ * requested by more than one entry of the EXTI configuration.  It calls all
+ * these handlers in the order of the configuration.
+ *
+ ******************************************************************************/
+static void extiCallAll (int extiNum, bool extiLvl, uint32_t timeStamp)
+{
+const EXTI_INIT *pExtIntCfg;	// pointer to EXTI configuration data
+
+    for (pExtIntCfg = l_pExtIntCfg;  pExtIntCfg->IntBitMask != 0;  pExtIntCfg++)
+	if (pExtIntCfg->IntBitMask & (1 << extiNum))
+	    pExtIntCfg->IntFct(extiNum, extiLvl, timeStamp);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Update the Level Address of an EXTI
+ *
+ * Determines the GPIO port that is currently connected to the specified EXTI
+ * and enters the address to read its input level into the dispatch table.
+ *
+ * @param[in] extiNum
+ *	Number of the external interrupt.
+ *
+ ******************************************************************************/
+static void extiLevelAddrUpdate (int extiNum)
+{
+int	portNum;		// GPIO port number of the EXTI
+
+    if (extiNum < 8)
+	portNum = (GPIO->EXTIPSELL >> (extiNum * 4)) & 0x7;
+    else
+	portNum = (GPIO->EXTIPSELH >> ((extiNum-8) * 4)) & 0x7;
+
+    l_ExtiDispatch[extiNum].pLevel = EXTI_LEVEL_ADDR(portNum, extiNum);
+}
+
+#if EXTI_CAPTURE
+/***************************************************************************//**
+ *
+ * @brief	Time Stamp of a captured EXTI
+ *
+ * Corrects the time stamp by the TIMER ticks elapsed since the last edge has
+ * been captured.  If there is no capture, e.g. the edge woke up the CPU from
+ * EM2, or the capture is too old, the time stamp is returned unchanged.
+ *
+ * @param[in] capCh
+ *	Capture channel of the TIMER.
+ *
+ * @param[in] timeStamp
+ *	RTC value read by EXTI_Handler().
+ *
+ * @param[in] timerCnt
+ *	TIMER value read together with the RTC.
+ *
+ * @return
+ *	RTC value of the edge, never 0.
+ *
+ ******************************************************************************/
+static uint32_t extiCaptureTime (int capCh, uint32_t timeStamp,
+				 uint32_t timerCnt)
+{
+uint32_t ccv;			// captured TIMER value
+uint32_t ticks;			// latency in RTC ticks
+
+    if ((EXTI_CAPTURE_TIMER->IF & (TIMER_IF_CC0 << capCh)) == 0)
+	return timeStamp;
+
+    /* use the latest capture, the buffer may hold a second one */
+    do
+	ccv = EXTI_CAPTURE_TIMER->CC[capCh].CCV;
+    while (EXTI_CAPTURE_TIMER->STATUS & (TIMER_STATUS_ICV0 << capCh));
+
+    EXTI_CAPTURE_TIMER->IFC = (TIMER_IF_CC0 | TIMER_IF_ICBOF0) << capCh;
+
+    /* a capture after timerCnt has been read results in a large value */
+    ticks = (uint32_t)(((uint64_t)((timerCnt - ccv) & 0xFFFF) * l_CapScale) >> 16);
+    if (ticks > MS2TICS(EXTI_CAPTURE_MAX_MS))
+	return timeStamp;
+
+    timeStamp = (timeStamp - ticks) & 0x00FFFFFF;	// 24 bit RTC
+    return (timeStamp == 0 ? 1 : timeStamp);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Discard the Captures of a TIMER Channel
+ *
+ ******************************************************************************/
+static void extiCaptureClear (int capCh)
+{
+int	i;
+
+    for (i = 0;  i < 2  &&  (EXTI_CAPTURE_TIMER->STATUS
+			     & (TIMER_STATUS_ICV0 << capCh));  i++)
+	(void) EXTI_CAPTURE_TIMER->CC[capCh].CCV;
+
+    EXTI_CAPTURE_TIMER->IFC = (TIMER_IF_CC0 | TIMER_IF_ICBOF0) << capCh;
 }
+#endif
@@ -2,9 +2,12 @@
  * @file
  * @brief	Header file of module ExtInt.c
  * @author	Ralf Gerhauser
- * @version	2016-02-16
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Added prototype for ExtIntDeferInit().
+2026-10-15,agnt	Added prototype for ExtIntClockChange().
+2026-10-15,agnt	Added prototype for ExtIntCaptureInit().
 2017-05-12,rage	Added prototype for ExtIntReplay().
 2016-04-13,rage	Removed element <IntTrigMask> from structure EXTI_INIT.
 2016-02-16,rage	Added prototypes for ExtIntEnableAll() and ExtIntDisableAll().
@@ -60,6 +63,9 @@ void	ExtIntDisableAll (void);
 void	ExtIntEnable (int extiNum);
 void	ExtIntDisable(int extiNum);
 void	ExtIntReplay (void);
+void	ExtIntCaptureInit (uint32_t extiMask);
+void	ExtIntDeferInit (uint32_t extiMask);
+void	ExtIntClockChange (void);
 
 
 #endif /* __INC_ExtInt_h */
@@ -0,0 +1,286 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Forecast of the Storage and Battery Runway
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module predicts how many days are left until a resource runs out, so
+ * the field service can be planned.  Once a day at @ref ALARM_FORECAST_TIME,
+ * ForecastCheck() logs one line, e.g.
+ * @code
+ * Forecast [days]: Audio 42, SD-Card 310, Battery 12, RTTE 9
+ * @endcode
+ * The forecasts are made from data that is collected anyway, no additional
+ * command is sent to the Audio module, and the battery controller is not
+ * read via the SMBus:
+ * - Audio: The space left of the storage device and its consumption per
+ *   day, i.e. the observed record rate at the bit rate of the recording
+ *   quality, see AudioStorageForecast().
+ * - SD-Card: The free space as known by FatFs, see DiskFreeKnown().  The
+ *   growth of the log files per day is the decrease since the first sample.
+ * - Battery: The relative state of charge of the last battery snapshot, see
+ *   BatterySnapshotGet().  The slope per day is taken since the first
+ *   sample.
+ * - RTTE: The value SBS_RunTimeToEmpty of the same snapshot, i.e. at the
+ *   current load.  It is not known if the snapshot has been estimated from
+ *   the supply voltage, see SupplyMon.c.
+ *
+ * If the free space or the state of charge increases, e.g. after the
+ * SD-Card or the battery has been changed, the observation starts over.  A
+ * slope is only used after @ref FORECAST_MIN_OBSERVE seconds.  A forecast
+ * which is not known yet is shown as "?", and no consumption as
+ * @ref FORECAST_DAYS_MAX.  The console command "FC" shows the forecast.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Registered ForecastCheck() as task of the main loop, see
+		TASK_REGISTER().
+2026-10-15,agnt	RTTE is not known for a snapshot of the supply monitor.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include <time.h>
+#include "AlarmClock.h"
+#include "Forecast.h"
+#include "Audio.h"
+#include "BatteryMon.h"
+#include "LEUART.h"
+#include "Logging.h"
+#include "ff.h"		// FS_FAT12/16/32
+#include "diskio.h"	// DSTATUS
+#include "microsd.h"
+#include "StrFormat.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Value of a forecast which is not known yet. */
+#define FC_UNKNOWN	(-1)
+
+    /*!@brief Size of a forecast string, see fcDaysStr(). */
+#define FC_STR_SIZE	8
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief First sample of a resource, the slope is taken from it. */
+typedef struct
+{
+    uint32_t	Value;		//!< Amount of the resource left
+    uint32_t	Time;		//!< time() of the sample, 0 if none
+} FC_SAMPLE;
+
+/*================================ Local Data ================================*/
+
+    /*! First sample of the free space of the SD-Card in [KB] */
+static FC_SAMPLE	l_SdFirst;
+
+    /*! First sample of the relative state of charge in [%] */
+static FC_SAMPLE	l_SocFirst;
+
+    /*! Flag set by ForecastAlarm(), handled by ForecastCheck(). */
+static volatile bool	l_flgReport;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	ForecastAlarm (int alarmNum);
+static int32_t	fcSlope (FC_SAMPLE *pFirst, uint32_t value, uint32_t now);
+static int32_t	fcDays (uint64_t left, uint64_t perDay);
+static char    *fcDaysStr (int32_t days, char *pBuf);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Forecast
+ *
+ * This routine must be called once after AlarmClockInit().  It sets up the
+ * alarm at @ref ALARM_FORECAST_TIME to log the forecast.
+ *
+ ******************************************************************************/
+void	ForecastInit (void)
+{
+    memset (&l_SdFirst,  0, sizeof(l_SdFirst));
+    memset (&l_SocFirst, 0, sizeof(l_SocFirst));
+    l_flgReport = false;
+
+    AlarmAction (ALARM_FORECAST, ForecastAlarm);
+    AlarmSet (ALARM_FORECAST, ALARM_FORECAST_TIME);
+    AlarmEnable (ALARM_FORECAST);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Forecast Check
+ *
+ * This routine is called from the main loop via EVENT_POST(EVT_FORECAST).
+ * It logs the forecast if the alarm time has been reached.
+ *
+ ******************************************************************************/
+void	ForecastCheck (void)
+{
+    if (! l_flgReport)
+	return;
+
+    l_flgReport = false;
+    ForecastReport (true);
+}
+#if FORECAST
+TASK_REGISTER(TASK_PRIO_FORECAST, EVT_FORECAST, ForecastCheck);
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Forecast
+ *
+ * This routine generates the forecast line, see the module description.
+ *
+ * @param[in] flgLog
+ *	If true, the line is logged.  If false, it is only shown on the debug
+ *	console.
+ *
+ ******************************************************************************/
+void	ForecastReport (bool flgLog)
+{
+char	 line[80];
+char	 audio[FC_STR_SIZE], sd[FC_STR_SIZE], soc[FC_STR_SIZE];
+char	 rtte[FC_STR_SIZE];
+const BAT_SNAPSHOT *pSnap;
+uint32_t now = (uint32_t)time(NULL);
+uint32_t spaceMB, kbPerDay, freeKB;
+int32_t	 days;
+
+    /* Storage device of the Audio module */
+    days = FC_UNKNOWN;
+    if (AudioStorageForecast (&spaceMB, &kbPerDay))
+	days = fcDays ((uint64_t)spaceMB * 1024, kbPerDay);
+    fcDaysStr (days, audio);
+
+    /* SD-Card of the MCU */
+    days = FC_UNKNOWN;
+    if (DiskFreeKnown (&freeKB))
+	days = fcSlope (&l_SdFirst, freeKB, now);
+    fcDaysStr (days, sd);
+
+    /* Battery, from the last snapshot */
+    pSnap = BatterySnapshotGet();
+    days = FC_UNKNOWN;
+    if (pSnap->Valid)
+	days = fcSlope (&l_SocFirst, pSnap->RelativeStateOfCharge, now);
+    fcDaysStr (days, soc);
+
+    /* 65535 means the battery is not discharged */
+    days = FC_UNKNOWN;
+    if (pSnap->Valid  &&  ! pSnap->Estimated)
+	days = (pSnap->RunTimeToEmpty == 0xFFFF ? FORECAST_DAYS_MAX
+		: fcDays (pSnap->RunTimeToEmpty, 24 * 60));
+    fcDaysStr (days, rtte);
+
+    StrFormat (line, "Forecast [days]: Audio %s, SD-Card %s, Battery %s,"
+	       " RTTE %s", audio, sd, soc, rtte);
+    if (flgLog)
+    {
+	Log (line);
+    }
+    else
+    {
+	drvLEUART_puts (line);
+	drvLEUART_puts ("\n");
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Alarm Routine for the Forecast
+ *
+ * This routine is called by the alarm clock at @ref ALARM_FORECAST_TIME.
+ * It triggers ForecastReport() in ForecastCheck().
+ *
+ ******************************************************************************/
+static void ForecastAlarm (int alarmNum)
+{
+    (void) alarmNum;	// suppress compiler warning "unused parameter"
+
+    l_flgReport = true;
+    EVENT_POST(EVT_FORECAST);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Forecast from the Slope since the first Sample
+ *
+ * The first call stores the sample.  If the value increased since then, the
+ * resource has been renewed, and the observation starts over.
+ *
+ * @param[in,out] pFirst
+ *	First sample of the resource.
+ *
+ * @param[in] value
+ *	Amount of the resource left.
+ *
+ * @param[in] now
+ *	Current time().
+ *
+ * @return
+ *	Days left, or @ref FC_UNKNOWN.
+ *
+ ******************************************************************************/
+static int32_t	fcSlope (FC_SAMPLE *pFirst, uint32_t value, uint32_t now)
+{
+uint32_t observed;
+
+    if (pFirst->Time == 0  ||  value > pFirst->Value  ||  now < pFirst->Time)
+    {
+	pFirst->Value = value;
+	pFirst->Time  = now;
+	return FC_UNKNOWN;
+    }
+
+    observed = now - pFirst->Time;
+    if (observed < FORECAST_MIN_OBSERVE)
+	return FC_UNKNOWN;
+
+    /* value / ((first - value) / observed days) */
+    return fcDays ((uint64_t)value * observed,
+		   (uint64_t)(pFirst->Value - value) * 24 * 3600);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Days left at a Consumption per Day
+ *
+ * @return
+ *	Days left, limited to @ref FORECAST_DAYS_MAX.
+ *
+ ******************************************************************************/
+static int32_t	fcDays (uint64_t left, uint64_t perDay)
+{
+    if (perDay == 0  ||  left / perDay >= FORECAST_DAYS_MAX)
+	return FORECAST_DAYS_MAX;
+
+    return (int32_t)(left / perDay);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Forecast as String
+ *
+ * @return
+ *	The buffer, which contains "?" for @ref FC_UNKNOWN.
+ *
+ ******************************************************************************/
+static char    *fcDaysStr (int32_t days, char *pBuf)
+{
+    if (days == FC_UNKNOWN)
+	strcpy (pBuf, "?");
+    else
+	StrFormat (pBuf, "%ld", days);
+
+    return pBuf;
+}
@@ -0,0 +1,63 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Forecast.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_Forecast_h
+#define __INC_Forecast_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to log once a day the number of days until the
+ * storage of the Audio module, the SD-Card, and the battery run out.
+ */
+#ifndef FORECAST
+    #define FORECAST		0
+#endif
+
+/*!@brief Time when to log the forecast, as hour and minute.  It should be
+ * after @ref ALARM_BAT_MON_TIME_2, so the battery snapshot is recent.
+ */
+#ifndef ALARM_FORECAST_TIME
+    #define ALARM_FORECAST_TIME	23, 55
+#endif
+
+/*!@brief Minimum time in [s] a consumption must be observed, before a
+ * forecast is made from it.
+ */
+#ifndef FORECAST_MIN_OBSERVE
+    #define FORECAST_MIN_OBSERVE	(24 * 3600)
+#endif
+
+/*!@brief Upper limit of a forecast in [days], also reported if nothing is
+ * consumed.
+ */
+#ifndef FORECAST_DAYS_MAX
+    #define FORECAST_DAYS_MAX	9999
+#endif
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize the forecast */
+void	ForecastInit (void);
+
+    /* Log the forecast if the alarm time has been reached */
+void	ForecastCheck (void);
+
+    /* Show or log the forecast */
+void	ForecastReport (bool flgLog);
+
+
+#endif /* __INC_Forecast_h */
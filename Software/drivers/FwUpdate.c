@@ -0,0 +1,248 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Firmware Update Staging
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module verifies a firmware update image (*.UPD) on the SD-Card before
+ * control is passed to the booter, which erases and programs the complete
+ * application area.  The image is the raw binary of the application, as
+ * generated by "objcopy", to be programmed at @ref FW_APP_START.
+ *
+ * FwUpdateCheck() reads the image once and performs the following checks:
+ * - The size must fit into the application area, which ends with the flash
+ *   pages of the record sequence counter and the log journal.
+ * - The vector table must contain a stack pointer within SRAM, and a reset
+ *   vector within the image.
+ * - The image must contain a project information structure @ref PRJ_INFO,
+ *   its version, date, and time are logged.
+ * - Each 512-byte flash page of the image is compared with the running
+ *   firmware.  If no page differs, the update is skipped.
+ *
+ * The EFM32G has no CRC unit.  The data blocks read from the SD-Card are
+ * protected by their CRC, so a damaged transfer is reported as read error
+ * by FatFs.  The byte-wise comparison with the flash replaces a checksum to
+ * detect an identical image.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	FwUpdateCheck() borrows the file handle of the logging module,
+		see LogFileHandleGet().
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_device.h"
+#include "FwUpdate.h"
+#include "Logging.h"
+#include "ff.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Number of bytes read from the image at once, must be a divisor
+     * of FLASH_PAGE_SIZE.
+     */
+#define FW_CHUNK_SIZE	64
+
+    /*!@brief Minimum size of an image, i.e. the vector table. */
+#define FW_MIN_SIZE	(16 * 4)
+
+/*================================ Global Data ===============================*/
+
+extern PRJ_INFO const  prj;		// Project Information
+
+/*=========================== Forward Declarations ===========================*/
+
+static bool	FwImageCheck (FIL *pFh, const char *pFileName);
+static bool	FwVectorsValid (const uint32_t *pVectors, uint32_t size);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Verify a Firmware Update Image
+ *
+ * This routine is called after an SD-Card has been mounted, and a file
+ * "*.UPD" exists.  It verifies the image as described in the module header
+ * and logs the result.
+ *
+ * @param[in] pFileName
+ *	Name of the update image in the root directory of the SD-Card.
+ *
+ * @return
+ * 	The value <i>true</i> if the image is valid and differs from the
+ * 	running firmware, i.e. the booter must be started.  The value
+ * 	<i>false</i> if it is identical, or it is not valid.
+ *
+ ******************************************************************************/
+bool	FwUpdateCheck (const char *pFileName)
+{
+FIL	*pFh;
+bool	 flgUpdate;
+
+    /* The image is read only once, borrow a file handle for it */
+    pFh = LogFileHandleGet();
+    if (pFh == NULL)
+    {
+	LogError ("Firmware Update %s: No file handle", pFileName);
+	return false;
+    }
+
+    flgUpdate = FwImageCheck (pFh, pFileName);
+
+    LogFileHandlePut (pFh);
+
+    return flgUpdate;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read and Check the Image
+ *
+ * This routine opens the image with the given file handle, performs the
+ * checks of FwUpdateCheck(), and closes it again.
+ *
+ * @param[in] pFh
+ *	File handle, borrowed by FwUpdateCheck().
+ *
+ * @param[in] pFileName
+ *	Name of the update image in the root directory of the SD-Card.
+ *
+ * @return
+ * 	The value <i>true</i> if the booter must be started.
+ *
+ ******************************************************************************/
+static bool	FwImageCheck (FIL *pFh, const char *pFileName)
+{
+uint32_t buf[FW_CHUNK_SIZE / 4];
+uint8_t	 info[sizeof(PRJ_INFO)];	// PRJ_INFO of the image
+const PRJ_INFO *pInfo = (const PRJ_INFO *)info;
+const uint8_t  *pFlash = FW_APP_FLASH;
+const uint8_t  *pData  = (const uint8_t *)buf;
+uint32_t size, offs;
+uint32_t pages = 0, changed = 0;
+bool	 flgPageDiff = false;
+unsigned int infoLen = 0;
+FRESULT	 res;
+UINT	 cnt, i;
+
+    res = f_open (pFh, (char *)pFileName, FA_READ | FA_OPEN_EXISTING);
+    if (res != FR_OK)
+    {
+	LogError ("Firmware Update %s: Open Error %d", pFileName, res);
+	return false;
+    }
+
+    size = f_size(pFh);
+    if (size < FW_MIN_SIZE  ||  size > FW_APP_SIZE)
+    {
+	LogError ("Firmware Update %s: Invalid size %ld", pFileName, size);
+	f_close (pFh);
+	return false;
+    }
+
+    for (offs = 0;  offs < size;  offs += cnt)
+    {
+	res = f_read (pFh, buf, sizeof(buf), &cnt);
+	if (res != FR_OK  ||  cnt == 0)
+	    break;
+
+	if (offs == 0  &&  ! FwVectorsValid (buf, size))
+	{
+	    LogError ("Firmware Update %s: Invalid vector table", pFileName);
+	    f_close (pFh);
+	    return false;
+	}
+
+	/* Compare with the running firmware */
+	if (memcmp (pData, pFlash + offs, cnt) != 0)
+	    flgPageDiff = true;
+
+	if ((offs + cnt) % FLASH_PAGE_SIZE == 0  ||  offs + cnt >= size)
+	{
+	    pages++;
+	    if (flgPageDiff)
+		changed++;
+	    flgPageDiff = false;
+	}
+
+	/* Look for the project information, the ID is the same as ours */
+	for (i = 0;  i < cnt  &&  infoLen < sizeof(info);  i++)
+	{
+	    if (infoLen < sizeof(prj.ID)  &&  pData[i] != (uint8_t)prj.ID[infoLen])
+	    {
+		infoLen = (pData[i] == (uint8_t)prj.ID[0] ? 1 : 0);
+		info[0] = pData[i];
+	    }
+	    else
+	    {
+		info[infoLen++] = pData[i];
+	    }
+	}
+    }
+
+    f_close (pFh);
+
+    if (res != FR_OK  ||  offs < size)
+    {
+	LogError ("Firmware Update %s: Read Error %d", pFileName, res);
+	return false;
+    }
+
+    if (infoLen < sizeof(info))
+    {
+	LogError ("Firmware Update %s: No project information", pFileName);
+	return false;
+    }
+
+    if (changed == 0)
+    {
+	Log ("Firmware Update %s: V%.*s (%.*s %.*s) is identical, skipped",
+	     pFileName, (int)sizeof(pInfo->Version), pInfo->Version,
+	     (int)sizeof(pInfo->Date), pInfo->Date,
+	     (int)sizeof(pInfo->Time), pInfo->Time);
+	return false;
+    }
+
+    Log ("Firmware Update %s: V%.*s (%.*s %.*s), %ld of %ld pages differ",
+	 pFileName, (int)sizeof(pInfo->Version), pInfo->Version,
+	 (int)sizeof(pInfo->Date), pInfo->Date,
+	 (int)sizeof(pInfo->Time), pInfo->Time, changed, pages);
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check the Vector Table of an Image
+ *
+ * The initial stack pointer must be within the SRAM, and the reset vector
+ * must be a Thumb address within the image.
+ *
+ * @param[in] pVectors
+ *	First words of the image, at least @ref FW_MIN_SIZE bytes.
+ *
+ * @param[in] size
+ *	Size of the image in bytes.
+ *
+ * @return
+ * 	The value <i>true</i> if the vector table is valid.
+ *
+ ******************************************************************************/
+static bool	FwVectorsValid (const uint32_t *pVectors, uint32_t size)
+{
+uint32_t sp    = pVectors[0];
+uint32_t reset = pVectors[1];
+
+    if (sp <= SRAM_BASE  ||  sp > SRAM_BASE + SRAM_SIZE  ||  (sp & 3) != 0)
+	return false;
+
+    if ((reset & 1) == 0  ||  reset < FW_APP_START + FW_MIN_SIZE
+    ||  reset >= FW_APP_START + size)
+	return false;
+
+    return true;
+}
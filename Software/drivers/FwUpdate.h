@@ -0,0 +1,52 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module FwUpdate.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	FW_APP_SIZE excludes the flash pages of the parameter store.
+2026-10-15,agnt	FW_APP_SIZE excludes the flash pages of the DCF77 reception
+		history.
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_FwUpdate_h
+#define __INC_FwUpdate_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Start address of the application in flash, the booter resides
+ * below, see linker script "efm32g_0x8000.ld".
+ */
+#define FW_APP_START	0x00008000UL
+
+/*!@brief Size of the application area, i.e. the LENGTH of region FLASH in
+ * the linker script.  The flash pages of the parameter store, the DCF77
+ * reception history, the record sequence counter, and the log journal follow.
+ */
+#define FW_APP_SIZE	(96 * 1024 - 4608 - 1024 - 1024 - 1024)
+
+/*!@brief Address of the running firmware.  The host simulation provides an
+ * erased flash area instead.
+ */
+#ifdef SIMULATION
+    #define FW_APP_FLASH	((const uint8_t *)g_SimAppFlash)
+#else
+    #define FW_APP_FLASH	((const uint8_t *)FW_APP_START)
+#endif
+
+/*================================ Prototypes ================================*/
+
+    /* Verify a firmware update image, true if the booter must be started */
+bool	FwUpdateCheck (const char *pFileName);
+
+
+#endif /* __INC_FwUpdate_h */
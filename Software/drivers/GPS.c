@@ -0,0 +1,658 @@
+/***************************************************************************//**
+ * @file
+ * @brief	GPS Receiver with PPS as Time Source
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module synchronizes the system clock with a GPS receiver.  It is an
+ * alternative to the DCF77 receiver, which is poor at some sites and only
+ * provides the time to the second.  It is selected by @ref TIME_SOURCE, see
+ * TimeSrc.c.  The receiver is connected to the DCF77 socket: the enable pin
+ * is PD1 (low-active), and the PPS (pulse per second) signal is PD2.  The
+ * NMEA data is received by LEUART1 at PC7 via DMA, so the second RFID
+ * reader cannot be used, i.e. @ref RFID_READERS must be 1.
+ *
+ * The rising edge of the PPS signal marks the begin of a UTC second.  Its
+ * RTC time stamp is captured by a TIMER via PRS, see ExtIntCaptureInit(),
+ * so it does not include the interrupt latency.  The $GPRMC (or $GNRMC)
+ * sentence which follows the edge carries its time and date.  At the next
+ * edge, the received sentences are parsed, and the time of this edge is
+ * known to be one second later.  It is converted into MEZ or MESZ by
+ * TimeSrcLocalTime(), and compared with the system clock in RTC ticks, see
+ * ClockGetTicks():
+ * - If the clock has never been set, the deviation is one second or more,
+ *   or the time zone changes, the clock is set via TimeSrcSync().
+ * - Otherwise the phase is corrected by ClockAdjust(), i.e. to one RTC tick
+ *   (30.5us).  The deviation of the first edge in a window is the drift
+ *   since the previous window, which is logged.  With @ref TEMP_COMP, it
+ *   is the residual drift after the temperature compensation, and half of
+ *   it is fed back to the model by TempCompTrim().
+ *
+ * The receiver is only powered for a short synchronization window.  After
+ * the clock has been aligned to @ref GPS_PPS_EDGES edges, or after
+ * @ref GPS_SYNC_WINDOW seconds without a valid fix, it is switched off, and
+ * powered again after @ref GPS_SYNC_INTERVAL.  Additionally, a window is
+ * opened every day at 02:00 MEZ (03:00 MESZ) via @ref ALARM_DCF77_WAKE_UP to
+ * detect the change of the time zone, which happens at 01:00 UTC.
+ *
+ * A window is logged like this:
+ * @code
+ * GPS: Enabled
+ * GPS: Clock deviation -412us in 21632s (-19ppb) after compensating 1203ms
+ * GPS: Aligned to 4 PPS edges after 12s, residual error 30us
+ * @endcode
+ *
+ * @note
+ * The high-speed mode of the console switches the clock of both LEUARTs,
+ * see drvLEUART_HighSpeed().  The NMEA sentences received during this time
+ * are discarded by their checksum.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	The receiver is no longer accounted in an energy ledger.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_device.h"
+#include "em_cmu.h"
+#include "em_dma.h"
+#include "em_leuart.h"
+#include "GPS.h"
+#include "ExtInt.h"
+#include "AlarmClock.h"
+#include "ClockMgr.h"
+#include "DmaChan.h"
+#include "Logging.h"
+#include "TempComp.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Tolerance of the PPS period in RTC ticks, otherwise an edge has been
+     * missed, or the signal is disturbed. */
+#define GPS_PPS_TOLERANCE	(RTC_COUNTS_PER_SEC / 100)
+
+    /*! A drift is only measured if the previous window is at least this
+     * number of seconds ago. */
+#define GPS_DRIFT_MIN_SECS	600
+
+/*================================ Local Data ================================*/
+
+#if TIME_SOURCE == TIME_SRC_GPS
+
+#if RFID_READERS > 1
+    #error "The GPS receiver requires LEUART1, set RFID_READERS to 1"
+#endif
+
+    /*! Timer handle for the window timeout and the interval. */
+static TIM_HDL	l_thGPS = NONE;
+
+    /*! Flag if the receiver is powered. */
+static volatile bool l_flgOn;
+
+    /*! Receive buffer for the NMEA sentences of one second. */
+static uint8_t	l_RxBuf[GPS_RX_BUF_SIZE];
+
+    /*! Monotonic clock of the previous PPS edge, 0 if none. */
+static uint64_t	l_PrevEdge;
+
+    /*! Monotonic clock when the receiver has been powered on. */
+static uint64_t	l_OnTicks;
+
+    /*! Monotonic clock of the last edge the clock was aligned to, 0 if it
+     * has been set since then. */
+static uint64_t	l_SyncEdge;
+
+    /*! Number of edges the clock has been aligned to in this window. */
+static int	l_EdgeCnt;
+
+    /*! Maximum deviation in RTC ticks after the first edge of a window. */
+static int32_t	l_MaxResidual;
+
+    /*! Setting up LEUART1 at 8N1 for the NMEA data. */
+static LEUART_Init_TypeDef l_LeuartInit =
+{
+    .enable   = leuartEnableRx,		// Receiver only
+    .refFreq  = 0,			// Use the current reference clock
+    .baudrate = GPS_BAUDRATE,
+    .databits = leuartDatabits8,
+    .parity   = leuartNoParity,
+    .stopbits = leuartStopbits1,
+};
+
+    /*! DMA channel for Rx, the buffer is processed at each PPS edge. */
+static DMA_CfgChannel_TypeDef l_ChnlCfgRx =
+{
+    .highPri   = false,			// Normal priority
+    .enableInt = false,			// No interrupt
+    .select    = DMAREQ_LEUART1_RXDATAV,
+    .cb        = NULL,			// Callback is set by DmaChanConfig()
+};
+
+    /*! DMA descriptor for Rx. */
+static DMA_CfgDescr_TypeDef l_DescrCfgRx =
+{
+    .dstInc  = dmaDataInc1,		// Increment destination by one byte
+    .srcInc  = dmaDataIncNone,		// Do not increment source address
+    .size    = dmaDataSize1,		// One byte per transfer
+    .arbRate = dmaArbitrate1,		// Rearbitrate for each byte received
+    .hprot   = 0,			// No read/write source protection
+};
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	gpsTimeout (TIM_HDL hdl);
+static void	gpsWindowEnd (void);
+static void	gpsAlign (struct tm *pTime, uint32_t timeStamp, uint64_t edge);
+static void	gpsRxStart (void);
+static int	gpsRxCount (void);
+static bool	gpsParseRMC (const char *pBuf, int cnt, struct tm *pTime);
+static const char *gpsField (const char *pField, const char *pEnd, int n);
+static int	gpsNum (const char *pStr, const char *pEnd, int digits);
+static int	gpsHex (char c);
+
+/*========================= Global Data and Routines =========================*/
+
+    /*!@brief GPS receiver as time source, see TimeSrc.c. */
+const TIME_SRC	g_TimeSrcGPS =
+{
+    "GPS", GPS_Init, GPS_Enable, GPS_Disable
+};
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the GPS Hardware
+ *
+ * This routine configures the enable pin, the PPS input, and the DMA channel
+ * of the receiver, and sets up the daily synchronization window.  Call
+ * GPS_Enable() after module ExtInt has been initialized.
+ *
+ ******************************************************************************/
+void	GPS_Init (void)
+{
+    /* Be sure to enable clock to GPIO (should already be done) */
+    CMU_ClockEnable (cmuClock_GPIO, true);
+
+    /* Low-active enable pin, set to 1 for OFF */
+    GPIO_PinModeSet (GPS_ENABLE_PORT, GPS_ENABLE_PIN, gpioModePushPull, 1);
+
+    /* PPS input, the interrupt is enabled by ExtIntInit() */
+    GPIO_PinModeSet (GPS_PPS_PORT, GPS_PPS_PIN, gpioModeInput, 0);
+    GPIO_IntConfig  (GPS_PPS_PORT, GPS_PPS_PIN, false, false, false);
+
+    GPIO_PinModeSet (GPS_RX_PORT, GPS_RX_PIN, gpioModeInput, 0);
+
+    /* The DMA controller is already initialized */
+    DmaChanConfig (DMA_CHAN_GPS_RX, "GPS Rx", &l_ChnlCfgRx, NULL, NULL);
+    DMA_CfgDescr (DMA_CHAN_GPS_RX, true, &l_DescrCfgRx);
+
+    if (l_thGPS == NONE)
+	l_thGPS = sTimerCreate (gpsTimeout);
+
+    /* The initial time zone is MEZ, see TimeSrcSync() */
+    AlarmAction (ALARM_DCF77_WAKE_UP, (ALARM_FCT)GPS_Enable);
+    AlarmSet (ALARM_DCF77_WAKE_UP, ALARM_GPS_WAKE_UP_TIME);
+    AlarmEnable (ALARM_DCF77_WAKE_UP);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Power the GPS Receiver on
+ *
+ * This routine powers the receiver on, starts the reception of the NMEA
+ * data, and enables the PPS interrupt.  The window ends after
+ * @ref GPS_SYNC_WINDOW seconds at the latest.
+ *
+ ******************************************************************************/
+void	GPS_Enable (void)
+{
+    if (l_flgOn)
+	return;
+
+#ifdef LOGGING
+    Log ("GPS: Enabled");
+#endif
+
+    ClockAcquire (CLK_OWN_GPS, cmuClock_LEUART1);
+    LEUART_Init (LEUART1, &l_LeuartInit);
+    LEUART_IntClear (LEUART1, _LEUART_IF_MASK);
+    LEUART1->ROUTE = LEUART_ROUTE_RXPEN | LEUART_ROUTE_LOCATION_LOC0;
+
+    /* Make sure the LEUART wakes up the DMA on RX data */
+    LEUART1->CTRL |= LEUART_CTRL_RXDMAWU;
+    gpsRxStart();
+
+    /* Set low-active enable pin of the receiver to 0 */
+    GPIO->P[GPS_ENABLE_PORT].DOUTCLR = (1 << GPS_ENABLE_PIN);
+
+    l_PrevEdge = 0;
+    l_EdgeCnt = 0;
+    l_MaxResidual = 0;
+    l_OnTicks = ClockMonoTicks();
+    l_flgOn = true;
+
+    ExtIntEnable (GPS_PPS_PIN);
+
+    if (l_thGPS != NONE)
+	sTimerStart (l_thGPS, GPS_SYNC_WINDOW);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Power the GPS Receiver off
+ *
+ * This routine disables the PPS interrupt and the reception, and powers the
+ * receiver off.  The interval timer is cancelled, so the next window is
+ * opened by @ref ALARM_DCF77_WAKE_UP, or by GPS_Enable().
+ *
+ ******************************************************************************/
+void	GPS_Disable (void)
+{
+    if (l_thGPS != NONE)
+	sTimerCancel (l_thGPS);
+
+    if (! l_flgOn)
+	return;
+
+    l_flgOn = false;
+    ExtIntDisable (GPS_PPS_PIN);
+
+    DMA->CHENC = (1 << DMA_CHAN_GPS_RX);
+    LEUART1->ROUTE = 0;
+    LEUART_Enable (LEUART1, leuartDisable);
+    ClockRelease (CLK_OWN_GPS, cmuClock_LEUART1);
+
+    /* Set low-active enable pin of the receiver to 1 */
+    GPIO->P[GPS_ENABLE_PORT].DOUTSET = (1 << GPS_ENABLE_PIN);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	PPS Handler
+ *
+ * This routine is called by the EXTI module for both edges of the PPS
+ * signal.  At the rising edge, the NMEA sentences received since the
+ * previous edge are parsed, and the reception starts anew.  If a valid RMC
+ * sentence has been received, and the edges are one second apart, the
+ * clock is aligned to this edge, see gpsAlign().
+ *
+ * @note
+ * Be aware, this function is called in interrupt context!
+ *
+ * @param[in] extiNum
+ *	EXTI number (not used here).
+ *
+ * @param[in] extiLvl
+ *	EXTI level, true for the rising edge.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value of the edge.
+ *
+ ******************************************************************************/
+void	GPS_PPSHandler (int extiNum, bool extiLvl, uint32_t timeStamp)
+{
+struct tm time;
+uint64_t  edge;			// monotonic clock of this edge
+uint64_t  prev = l_PrevEdge;	// monotonic clock of the previous edge
+bool	  flgValid;
+
+    (void) extiNum;	// suppress compiler warning "unused parameter"
+
+    if (! extiLvl  ||  ! l_flgOn)
+	return;			// only the rising edge marks the second
+
+    edge = ClockMonoStamp (timeStamp);
+    l_PrevEdge = edge;
+
+    /* The sentences since the previous edge refer to it */
+    flgValid = gpsParseRMC ((const char *)l_RxBuf, gpsRxCount(), &time);
+    gpsRxStart();
+
+    if (! flgValid  ||  prev == 0
+    ||  edge - prev < RTC_COUNTS_PER_SEC - GPS_PPS_TOLERANCE
+    ||  edge - prev > RTC_COUNTS_PER_SEC + GPS_PPS_TOLERANCE)
+	return;			// no fix yet, or an edge is missing
+
+    /* This edge is one second after the RMC time, mktime() normalizes it */
+    time.tm_sec++;
+    TimeSrcLocalTime (&time);
+
+    gpsAlign (&time, timeStamp, edge);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Align the Clock to a PPS Edge
+ *
+ * This routine compares the system clock with the time of the PPS edge.
+ * The clock is set by TimeSrcSync() if necessary, otherwise its phase is
+ * corrected by ClockAdjust().  At the first edge of a window, the drift
+ * since the previous window is logged.  After @ref GPS_PPS_EDGES edges the
+ * window ends.
+ *
+ * @param[in] pTime
+ *	Local time of the edge.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value of the edge.
+ *
+ * @param[in] edge
+ *	Monotonic clock of the edge.
+ *
+ ******************************************************************************/
+static void	gpsAlign (struct tm *pTime, uint32_t timeStamp, uint64_t edge)
+{
+struct tm time = *pTime;
+int64_t	  error;		// deviation of the system clock in RTC ticks
+int32_t	  elapsed;		// seconds since the previous window
+int32_t	  ppb;			// drift in parts per billion
+#if TEMP_COMP
+int32_t	  comp;			// temperature compensation in [ms]
+#endif
+
+    time.tm_isdst = 0;			// always 0 for mktime()
+    error = (int64_t)mktime (&time) * RTC_COUNTS_PER_SEC
+	    - ClockGetTicks (timeStamp);
+
+    if (g_PowerUpTime == 0  ||  (bool)pTime->tm_isdst != g_isdst
+    ||  error >= RTC_COUNTS_PER_SEC  ||  error <= -RTC_COUNTS_PER_SEC)
+    {
+#ifdef LOGGING
+	LogEvent ("GPS: Time Synchronization %02d:%02d:%02d (%s)",
+		  pTime->tm_hour, pTime->tm_min, pTime->tm_sec,
+		  pTime->tm_isdst ? "MESZ" : "MEZ");
+#endif
+#if TEMP_COMP
+	(void) TempCompSyncMs();	// correction starts over
+#endif
+	TimeSrcSync (pTime, (int32_t)((RTC->CNT - timeStamp) & 0xFFFFFF));
+
+	/* No drift can be measured across a jump */
+	l_SyncEdge = 0;
+	l_EdgeCnt = 0;
+	return;
+    }
+
+    if (l_EdgeCnt == 0)
+    {
+	elapsed = (int32_t)((edge - l_SyncEdge) / RTC_COUNTS_PER_SEC);
+	if (l_SyncEdge != 0  &&  elapsed >= GPS_DRIFT_MIN_SECS)
+	{
+	    ppb = (int32_t)(error * 1000000000LL / (int64_t)(edge - l_SyncEdge));
+#if TEMP_COMP
+	    comp = TempCompSyncMs();
+	    TempCompTrim (-ppb / 2);
+#endif
+#if defined(LOGGING)  &&  TEMP_COMP
+	    Log ("GPS: Clock deviation %ldus in %lds (%ldppb) after"
+		 " compensating %ldms",
+		 (int32_t)(error * 1000000 / RTC_COUNTS_PER_SEC), elapsed, ppb,
+		 comp);
+#elif defined(LOGGING)
+	    Log ("GPS: Clock deviation %ldus in %lds (%ldppb)",
+		 (int32_t)(error * 1000000 / RTC_COUNTS_PER_SEC), elapsed, ppb);
+#endif
+	}
+    }
+    else if (error > l_MaxResidual  ||  -error > l_MaxResidual)
+    {
+	l_MaxResidual = (int32_t)(error < 0 ? -error : error);
+    }
+
+    ClockAdjust ((int32_t)error);
+    l_SyncEdge = edge;
+
+    if (++l_EdgeCnt >= GPS_PPS_EDGES)
+    {
+#ifdef LOGGING
+	Log ("GPS: Aligned to %d PPS edges after %lds, residual error %ldus",
+	     l_EdgeCnt, (int32_t)((edge - l_OnTicks) / RTC_COUNTS_PER_SEC),
+	     l_MaxResidual * 1000000 / RTC_COUNTS_PER_SEC);
+#endif
+	gpsWindowEnd();
+    }
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Window and Interval Timer
+ *
+ * This routine is called by the sTimer.  If the receiver is on, the window
+ * is over without a synchronization.  Until the clock has been set for the
+ * first time, the receiver remains powered.  If the receiver is off, the
+ * interval is over and the next window is opened.
+ *
+ * @param[in] hdl
+ *	Timer handle (not used here).
+ *
+ ******************************************************************************/
+static void	gpsTimeout (TIM_HDL hdl)
+{
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    if (! l_flgOn)
+    {
+	GPS_Enable();
+    }
+    else if (g_PowerUpTime == 0)
+    {
+	sTimerStart (l_thGPS, GPS_SYNC_WINDOW);
+    }
+    else
+    {
+#ifdef LOGGING
+	Log ("GPS: No synchronization within %ds", GPS_SYNC_WINDOW);
+#endif
+	gpsWindowEnd();
+    }
+}
+
+/***************************************************************************//**
+ *
+ * @brief	End of a Synchronization Window
+ *
+ * The receiver is powered off, and the interval timer is started.
+ *
+ ******************************************************************************/
+static void	gpsWindowEnd (void)
+{
+    GPS_Disable();
+    sTimerStart (l_thGPS, GPS_SYNC_INTERVAL);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Start the Reception
+ *
+ * The DMA stores the received bytes from the begin of @ref l_RxBuf.  It
+ * stops when the buffer is full.
+ *
+ ******************************************************************************/
+static void	gpsRxStart (void)
+{
+    DMA_ActivateBasic (DMA_CHAN_GPS_RX,		// Activate channel selected
+		       true,			// Use primary descriptor
+		       false,			// No DMA burst
+		       (void *) l_RxBuf,	// Destination address
+		       (void *) &LEUART1->RXDATA, // Source address is register
+		       GPS_RX_BUF_SIZE - 1);	// Size of buffer - 1
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Number of received Bytes
+ *
+ * @return
+ *	Number of bytes the DMA has stored in @ref l_RxBuf.
+ *
+ ******************************************************************************/
+static int	gpsRxCount (void)
+{
+DMA_DESCRIPTOR_TypeDef *pDescr = (DMA_DESCRIPTOR_TypeDef *)DMA->CTRLBASE
+				 + DMA_CHAN_GPS_RX;
+
+    if ((pDescr->CTRL & _DMA_CTRL_CYCLE_CTRL_MASK)
+	== _DMA_CTRL_CYCLE_CTRL_INVALID)
+	return GPS_RX_BUF_SIZE;		// buffer is full
+
+    return GPS_RX_BUF_SIZE - 1 - (int)((pDescr->CTRL & _DMA_CTRL_N_MINUS_1_MASK)
+				       >> _DMA_CTRL_N_MINUS_1_SHIFT);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Parse the RMC Sentence
+ *
+ * This routine searches the buffer for an RMC sentence with a valid checksum
+ * and status 'A' (valid fix), e.g.
+ * @code
+ * $GPRMC,123519.00,A,4807.038,N,01131.000,E,0.0,0.0,151026,,,A*5C
+ * @endcode
+ * If there are several, the last one is used.
+ *
+ * @param[in] pBuf
+ *	Received data.
+ *
+ * @param[in] cnt
+ *	Number of bytes in the buffer.
+ *
+ * @param[out] pTime
+ *	UTC time and date of the sentence, with a 2-digit year.
+ *
+ * @return
+ *	true if a valid sentence has been found.
+ *
+ ******************************************************************************/
+static bool	gpsParseRMC (const char *pBuf, int cnt, struct tm *pTime)
+{
+const char *pEnd = pBuf + cnt;
+const char *p, *pStar;		// begin and end of a sentence
+const char *pTimeFld, *pStatFld, *pDateFld;
+uint8_t	    csum;
+bool	    flgFound = false;
+int	    value[6];		// hh mm ss dd mm yy
+int	    i;
+
+    for (p = pBuf;  p < pEnd;  p++)
+    {
+	if (*p != '$')
+	    continue;
+
+	/* The checksum is the XOR of all characters between '$' and '*' */
+	csum = 0;
+	for (pStar = p + 1;  pStar < pEnd  &&  *pStar != '*'  &&  *pStar != '$';
+	     pStar++)
+	    csum ^= (uint8_t)*pStar;
+
+	if (pStar + 2 >= pEnd  ||  *pStar != '*'
+	||  gpsHex (pStar[1]) < 0  ||  gpsHex (pStar[2]) < 0
+	||  csum != gpsHex (pStar[1]) * 16 + gpsHex (pStar[2]))
+	    continue;
+
+	/* Talker ID GP, GN, GL, ... and sentence type RMC */
+	if (pStar - p < 7  ||  p[1] != 'G'  ||  strncmp (p + 3, "RMC,", 4) != 0)
+	    continue;
+
+	pTimeFld = p + 7;
+	pStatFld = gpsField (pTimeFld, pStar, 1);
+	if (pStatFld == NULL  ||  *pStatFld != 'A')
+	    continue;			// no valid fix
+
+	pDateFld = gpsField (pTimeFld, pStar, 8);
+	if (pDateFld == NULL)
+	    continue;
+
+	for (i = 0;  i < 3;  i++)
+	{
+	    value[i]   = gpsNum (pTimeFld + 2 * i, pStar, 2);
+	    value[i+3] = gpsNum (pDateFld + 2 * i, pStar, 2);
+	}
+	if (value[0] < 0  ||  value[0] > 23  ||  value[1] < 0  ||  value[1] > 59
+	||  value[2] < 0  ||  value[2] > 60  ||  value[3] < 1  ||  value[3] > 31
+	||  value[4] < 1  ||  value[4] > 12  ||  value[5] < 0)
+	    continue;
+
+	memset (pTime, 0, sizeof(*pTime));
+	pTime->tm_hour = value[0];
+	pTime->tm_min  = value[1];
+	pTime->tm_sec  = value[2];
+	pTime->tm_mday = value[3];
+	pTime->tm_mon  = value[4] - 1;
+	pTime->tm_year = value[5];
+	flgFound = true;
+    }
+
+    return flgFound;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Find a Field of an NMEA Sentence
+ *
+ * @param[in] pField
+ *	First field after the sentence type.
+ *
+ * @param[in] pEnd
+ *	End of the sentence, i.e. the '*'.
+ *
+ * @param[in] n
+ *	Number of the field, 0 for the first one.
+ *
+ * @return
+ *	Begin of the field, or NULL if the sentence has not as many fields.
+ *
+ ******************************************************************************/
+static const char *gpsField (const char *pField, const char *pEnd, int n)
+{
+    while (n > 0)
+    {
+	if (pField >= pEnd)
+	    return NULL;
+	if (*pField++ == ',')
+	    n--;
+    }
+    return pField;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Decimal Number of an NMEA Field
+ *
+ * @return
+ *	Value of the specified number of digits, or -1 if one is not a digit.
+ *
+ ******************************************************************************/
+static int	gpsNum (const char *pStr, const char *pEnd, int digits)
+{
+int	value = 0;
+
+    while (digits-- > 0)
+    {
+	if (pStr >= pEnd  ||  *pStr < '0'  ||  *pStr > '9')
+	    return -1;
+	value = value * 10 + (*pStr++ - '0');
+    }
+    return value;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Hexadecimal Digit
+ *
+ * @return
+ *	Value of the digit, or -1 if it is none.
+ *
+ ******************************************************************************/
+static int	gpsHex (char c)
+{
+    if (c >= '0'  &&  c <= '9')
+	return c - '0';
+    if (c >= 'A'  &&  c <= 'F')
+	return c - 'A' + 10;
+    return -1;
+}
+
+#endif	/* TIME_SOURCE == TIME_SRC_GPS */
@@ -0,0 +1,90 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module GPS.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_GPS_h
+#define __INC_GPS_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "em_gpio.h"
+#include "config.h"		// include project configuration parameters
+#include "TimeSrc.h"
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Baud rate of the NMEA output of the GPS receiver. */
+#ifndef GPS_BAUDRATE
+    #define GPS_BAUDRATE	9600
+#endif
+
+/*!@brief Interval in [s] between two synchronization windows. */
+#ifndef GPS_SYNC_INTERVAL
+    #define GPS_SYNC_INTERVAL	(6 * 3600)
+#endif
+
+/*!@brief Maximum duration in [s] of a synchronization window, i.e. the time
+ * the receiver may need for a fix.  Until the system clock has been set for
+ * the first time, the receiver remains powered.
+ */
+#ifndef GPS_SYNC_WINDOW
+    #define GPS_SYNC_WINDOW	300
+#endif
+
+/*!@brief Number of PPS edges the clock is aligned to in a window. */
+#ifndef GPS_PPS_EDGES
+    #define GPS_PPS_EDGES	4
+#endif
+
+/*!@brief Time (02:00 MEZ) of the daily synchronization window, which also
+ * detects a change between MEZ and MESZ.  It uses @ref ALARM_DCF77_WAKE_UP.
+ */
+#define ALARM_GPS_WAKE_UP_TIME	2, 00
+
+/*!@brief Size of the receive buffer, it must hold the NMEA sentences of one
+ * second.
+ */
+#define GPS_RX_BUF_SIZE		256
+
+/*!@brief DMA channel of the GPS receiver, LEUART1 is shared with the second
+ * RFID reader.
+ */
+#define DMA_CHAN_GPS_RX		DMA_CHAN_RFID2_RX
+
+/*!@brief Here follows the definition of GPIO ports and pins used to connect
+ * to the GPS receiver.  Enable and PPS use the pins of the DCF77 receiver,
+ * the NMEA data is received by LEUART1.
+ */
+#define GPS_ENABLE_PORT		gpioPortD	//!< low-active, like DCF77
+#define GPS_ENABLE_PIN		1
+#define GPS_PPS_PORT		gpioPortD
+#define GPS_PPS_PIN		2
+#define GPS_RX_PORT		gpioPortC	//!< LEUART1 Rx, location 0
+#define GPS_RX_PIN		7
+
+/*!@brief Bit mask of the affected external interrupt (EXTI). */
+#define GPS_PPS_EXTI_MASK	(1 << GPS_PPS_PIN)
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize the GPS hardware */
+void	GPS_Init (void);
+
+    /* Power the GPS receiver on or off */
+void	GPS_Enable (void);
+void	GPS_Disable (void);
+
+    /* PPS handler, called from interrupt service routine */
+void	GPS_PPSHandler (int extiNum, bool extiLvl, uint32_t timeStamp);
+
+
+#endif /* __INC_GPS_h */
@@ -0,0 +1,198 @@
+/***************************************************************************//**
+ * @file
+ * @brief	HF Clock Governor
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module runs the core and the HF peripherals from the internal RC
+ * oscillator, band @ref HF_CLOCK_HFRCO_BAND, if @ref HF_CLOCK_GOVERNOR is 1.
+ * The current in EM0 and EM1 scales with the frequency, and most wake-ups,
+ * e.g. an RTC tick or a received RFID frame, are short.  The external 32MHz
+ * XTAL is only started for bursts which need the throughput: HfClockBoost()
+ * requests it, and the last HfClockRelease() returns to the HFRCO.  The
+ * SD-Card driver keeps a boost while the card is in use, i.e. for the block
+ * transfers, parsing the configuration file, and flushing the log buffer.
+ * The high-speed mode of the console holds one as well.
+ *
+ * After each switch, the functions of the list passed to HfClockInit() are
+ * called to recalculate the dividers of their peripherals, e.g. the baud
+ * rates of the USARTs.  A byte which is received during the switch may be
+ * lost, the frames of the RFID reader and the Audio module are checked
+ * anyway.
+ *
+ * The switches are counted, and the time at the HFXO is accumulated, see
+ * HfClockReport().
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	The HFXO is no longer accounted in an energy ledger.
+2026-10-15,agnt	The boost time is taken from the monotonic clock, see
+		ClockMonoTicks().
+2026-10-15,agnt	The HFXO is accounted in the energy ledger, see EnergyLedger.c.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_int.h"
+#include "AlarmClock.h"		// ClockMonoTicks()
+#include "HfClock.h"
+#include "LEUART.h"
+#include "StrFormat.h"
+
+/*================================ Local Data ================================*/
+
+    /*! 0-terminated list of the clock change handlers */
+static const HF_CLOCK_FCT *l_pFct;
+
+    /*! Number of pending boost requests */
+static volatile uint8_t	l_BoostCnt;
+
+    /*! Number of switches to the HFXO */
+static uint32_t	l_BoostTotal;
+
+    /*! Monotonic clock (lower 32 bits) when the HFXO has been selected */
+static uint32_t	l_BoostStart;
+
+    /*! RTC ticks at the HFXO, without the current boost */
+static uint32_t	l_BoostTicks;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	HfClockSelect (bool flgHFXO);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the HF Clock Governor
+ *
+ * This routine is called once from cmuSetup() in main.c, instead of
+ * selecting the HFXO.  It sets the HFRCO to @ref HF_CLOCK_HFRCO_BAND.
+ *
+ * @param[in] pFct
+ *	0-terminated list of functions to be called after each switch.
+ *
+ ******************************************************************************/
+void	HfClockInit (const HF_CLOCK_FCT *pFct)
+{
+    l_pFct = pFct;
+
+#if HF_CLOCK_GOVERNOR
+    CMU_HFRCOBandSet (HF_CLOCK_HFRCO_BAND);
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Request the HFXO
+ *
+ * The first request starts the HFXO and switches the HF clock to it, this
+ * takes the start-up time of the XTAL.  The requests may be nested, each
+ * one must be followed by HfClockRelease().  It must be called from the
+ * main loop.
+ *
+ ******************************************************************************/
+void	HfClockBoost (void)
+{
+#if HF_CLOCK_GOVERNOR
+    if (l_BoostCnt++ == 0)
+    {
+	/* Start HFXO and wait until it is stable */
+	CMU_OscillatorEnable (cmuOsc_HFXO, true, true);
+
+	HfClockSelect (true);
+
+	l_BoostTotal++;
+	l_BoostStart = (uint32_t)ClockMonoTicks();
+    }
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Release the HFXO
+ *
+ * The last release switches the HF clock back to the HFRCO, and stops the
+ * HFXO.  It must be called from the main loop.
+ *
+ ******************************************************************************/
+void	HfClockRelease (void)
+{
+#if HF_CLOCK_GOVERNOR
+    if (l_BoostCnt == 0)
+	return;			// not requested
+
+    if (--l_BoostCnt == 0)
+    {
+	l_BoostTicks += (uint32_t)ClockMonoTicks() - l_BoostStart;
+
+	/* Start HFRCO and wait until it is stable */
+	CMU_OscillatorEnable (cmuOsc_HFRCO, true, true);
+
+	HfClockSelect (false);
+    }
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Select the HF Clock
+ *
+ * This routine selects the HFXO or the HFRCO as source of the HF clock,
+ * which must already be running, and stops the other one.  Then the clock
+ * change handlers are called.  Interrupts are disabled meanwhile, so no
+ * interrupt service routine uses a stale divider.
+ *
+ ******************************************************************************/
+static void	HfClockSelect (bool flgHFXO)
+{
+const HF_CLOCK_FCT *pFct;
+
+    INT_Disable();
+
+    if (flgHFXO)
+    {
+	CMU_ClockSelectSet (cmuClock_HF, cmuSelect_HFXO);
+	CMU_OscillatorEnable (cmuOsc_HFRCO, false, false);
+    }
+    else
+    {
+	CMU_ClockSelectSet (cmuClock_HF, cmuSelect_HFRCO);
+	CMU_OscillatorEnable (cmuOsc_HFXO, false, false);
+    }
+
+    for (pFct = l_pFct;  pFct != NULL  &&  *pFct != NULL;  pFct++)
+	(*pFct)();
+
+    INT_Enable();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Clock Statistics
+ *
+ * This routine shows the current HF clock, the number of switches to the
+ * HFXO, and the total time at the HFXO on the console, e.g. via the console
+ * command "CLK".
+ *
+ ******************************************************************************/
+void	HfClockReport (void)
+{
+char	 line[100];
+uint32_t freq = CMU_ClockFreqGet (cmuClock_HF);
+uint32_t ticks = l_BoostTicks;
+
+    if (l_BoostCnt > 0)
+	ticks += (uint32_t)ClockMonoTicks() - l_BoostStart;
+
+    StrFormat (line, "HF Clock %s at %ldkHz, %ld boosts, %ld.%03lds at HFXO\n",
+	       CMU_ClockSelectGet (cmuClock_HF) == cmuSelect_HFXO
+	       ? "HFXO" : "HFRCO", freq / 1000, l_BoostTotal,
+	       ticks / RTC_COUNTS_PER_SEC,
+	       (ticks % RTC_COUNTS_PER_SEC) * 1000 / RTC_COUNTS_PER_SEC);
+    drvLEUART_puts (line);
+}
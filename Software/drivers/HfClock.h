@@ -0,0 +1,74 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module HfClock.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_HfClock_h
+#define __INC_HfClock_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "em_cmu.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to run the core from the HFRCO, and to start the
+ * HFXO only while a boost is requested, see HfClockBoost().
+ */
+#ifndef HF_CLOCK_GOVERNOR
+    #define HF_CLOCK_GOVERNOR	0
+#endif
+
+/*!@brief Band of the HFRCO when no boost is requested.  The USARTs of the
+ * RFID reader and the Audio module need at least 1MHz for 9600 baud.
+ */
+#ifndef HF_CLOCK_HFRCO_BAND
+    #define HF_CLOCK_HFRCO_BAND	cmuHFRCOBand_7MHz
+#endif
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Array of functions to be called after the HF clock has changed.
+ *
+ * Each module that derives a divider from the HF peripheral clock, e.g. the
+ * baud rate of a USART, provides such a function to recalculate it.  The
+ * functions are called with interrupts disabled, and must return
+ * immediately if their peripheral is not in use.  This array must be
+ * 0-terminated.
+ *
+ * <b>Typical Example:</b>
+ * @code
+ * static const HF_CLOCK_FCT l_HfClockChange[] =
+ * {
+ *     RFID_ClockChange,
+ *     NULL
+ * };
+ * @endcode
+ */
+typedef void	(* HF_CLOCK_FCT)(void);
+
+/*================================ Prototypes ================================*/
+
+    /* Run from the HFRCO, register the clock change handlers */
+void	HfClockInit (const HF_CLOCK_FCT *pFct);
+
+    /* Request the HFXO, calls may be nested */
+void	HfClockBoost (void);
+
+    /* Release the HFXO, the last release returns to the HFRCO */
+void	HfClockRelease (void);
+
+    /* Show the clock statistics on the console */
+void	HfClockReport (void);
+
+
+#endif /* __INC_HfClock_h */
@@ -0,0 +1,130 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Interrupt Service Routine Profiler
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module measures the execution time of the interrupt service routines
+ * and DMA callbacks by the DWT cycle counter of the Cortex-M3.  For each of
+ * them, the number of calls, and the minimum, average, and maximum number of
+ * CPU cycles are recorded in @ref g_IsrProf.  The routines are instrumented
+ * by @ref ISR_PROF_ENTER() and @ref ISR_PROF_EXIT(), which are empty unless
+ * @ref ISR_PROFILE is 1.  The statistics are shown by IsrProfileReport(),
+ * e.g. via the console command "ISR".
+ *
+ * @note
+ * The cycles of an ISR include the time of higher-priority interrupts that
+ * preempted it, e.g. an SMBus interrupt during the RTC interrupt.  The cycle
+ * counter stops in EM1 and EM2, but an ISR always runs in EM0.  The work
+ * of the RTC and the EXTIs which has been deferred to the PendSV handler is
+ * accounted to DEFER, not to RTC or EXTI, see Defer.c.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	g_IsrProf[] only takes RAM if ISR_PROFILE is set.
+2026-10-15,agnt	Added the PendSV handler of the deferred work.
+2026-10-15,agnt	IsrProfileReport() notes the clock of HF_CLOCK_GOVERNOR.
+2026-10-15,agnt	Use StrFormat() instead of sprintf().
+2026-10-14,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_cmu.h"
+#include "em_int.h"
+#include "IsrProfile.h"
+#include "LEUART.h"
+#include "StrFormat.h"
+
+/*================================ Global Data ===============================*/
+
+#if ISR_PROFILE
+    /*!@brief Cycle statistics of all profiled routines. */
+ISR_PROF	 g_IsrProf[NUM_ISR_PROF];
+#endif
+
+/*================================ Local Data ================================*/
+
+#if ISR_PROFILE
+    /*!@brief Names of the profiled routines - keep in sync with enum
+     * @ref ISR_PROF_ID!
+     */
+static const char *l_IsrProfName[NUM_ISR_PROF] =
+{ "RTC", "EXTI", "SMB", "AUDIO_RX", "AUDIO_TX", "RFID_RX", "LEUART_TX",
+  "SD_DMA", "DEFER" };
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the ISR Profiler
+ *
+ * This routine enables the DWT cycle counter.  It must be called once before
+ * the interrupts are enabled.  If @ref ISR_PROFILE is 0, it does nothing.
+ *
+ ******************************************************************************/
+void	IsrProfileInit (void)
+{
+#if ISR_PROFILE
+    /* Enable trace in core debug, then the free running cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the ISR Profile
+ *
+ * This routine shows one line per profiled routine on the console, with the
+ * number of calls, and the minimum, average, and maximum number of CPU
+ * cycles.  The maximum is also given in microseconds, to be compared with
+ * the time budget of the routine.  It is based on the current HF clock, with
+ * @ref HF_CLOCK_GOVERNOR the cycles may have been counted at another one.
+ *
+ * @param[in] flgReset
+ *	If true, the statistics are reset after they have been reported.
+ *
+ ******************************************************************************/
+void	IsrProfileReport (bool flgReset)
+{
+#if ! ISR_PROFILE
+    (void) flgReset;	// suppress compiler warning "unused parameter"
+    drvLEUART_puts ("ISR Profile: not enabled, see ISR_PROFILE\n");
+#else
+char	 line[100];
+ISR_PROF prof;
+uint32_t mhz;
+int	 i;
+
+    mhz = CMU_ClockFreqGet (cmuClock_CORE) / 1000000;
+    if (mhz == 0)
+	mhz = 1;
+
+    for (i = 0;  i < NUM_ISR_PROF;  i++)
+    {
+	/* Take a consistent copy of the statistics */
+	INT_Disable();
+	prof = g_IsrProf[i];
+	if (flgReset)
+	{
+	    g_IsrProf[i].Cnt = g_IsrProf[i].Max = 0;
+	    g_IsrProf[i].Sum = 0;
+	}
+	INT_Enable();
+
+	if (prof.Cnt == 0)
+	    continue;		// routine has not been called
+
+	StrFormat (line, "ISR %-9s n=%lu min=%lu avg=%lu max=%lu (%luus)\n",
+		   l_IsrProfName[i], prof.Cnt, prof.Min,
+		   (uint32_t)(prof.Sum / prof.Cnt), prof.Max, prof.Max / mhz);
+	drvLEUART_puts (line);
+    }
+
+    if (flgReset)
+	drvLEUART_puts ("ISR Profile has been reset\n");
+#endif
+}
@@ -0,0 +1,141 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module IsrProfile.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	g_IsrProf[] and IsrProfileAccount() only exist if ISR_PROFILE.
+2026-10-15,agnt	ISR_PROF_EXIT() also emits an ITM trace record if ITM_TRACE.
+2026-10-15,agnt	Added ISR_PROF_DEFER for the PendSV handler of Defer.c.
+2026-10-14,agnt	Initial version.
+*/
+
+#ifndef __INC_IsrProfile_h
+#define __INC_IsrProfile_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+#include "ItmTrace.h"
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to measure the execution time of the interrupt
+ * service routines by the DWT cycle counter, see IsrProfileInit().
+ */
+#ifndef ISR_PROFILE
+    #define ISR_PROFILE		0
+#endif
+
+/*!@brief Interrupt service routines and DMA callbacks to be profiled - keep
+ * in sync with the names @ref l_IsrProfName!
+ */
+typedef enum
+{
+    ISR_PROF_RTC,		//!< RTC_IRQHandler(), alarm clock and timers
+    ISR_PROF_EXTI,		//!< EXTI_Handler(), DCF77 and light barriers
+    ISR_PROF_SMB,		//!< SMB_IRQHandler(), battery monitor
+    ISR_PROF_AUDIO_RX,		//!< USART0_RX_IRQHandler(), Audio module
+    ISR_PROF_AUDIO_TX,		//!< DMA callback AudioTxDone()
+    ISR_PROF_RFID_RX,		//!< DMA callback RFID_RxDone() of USART1 RX
+    ISR_PROF_LEUART_TX,		//!< DMA callback dmaTransferDone() of LEUART
+    ISR_PROF_SD_DMA,		//!< DMA callbacks of the SD-Card interface
+    ISR_PROF_DEFER,		//!< PendSV_Handler(), deferred work of Defer.c
+    NUM_ISR_PROF
+} ISR_PROF_ID;
+
+/*!@brief Cycle statistics of one interrupt service routine. */
+typedef struct
+{
+    uint32_t	Cnt;		//!< Number of calls
+    uint32_t	Min;		//!< Minimum number of CPU cycles
+    uint32_t	Max;		//!< Maximum number of CPU cycles
+    uint64_t	Sum;		//!< Total number of CPU cycles for the average
+} ISR_PROF;
+
+/*!@brief Macros to be placed at the entry and all exits of a profiled
+ * routine.  Their overhead is a few cycles only, without @ref ISR_PROFILE
+ * and @ref ITM_TRACE they are empty.  With @ref ITM_TRACE, the exit emits
+ * a record of type ITM_REC_ISR with the entry time and the cycles.
+ *
+ * @code
+   void	SMB_IRQHandler (void)
+   {
+       ISR_PROF_ENTER();
+       ...
+       ISR_PROF_EXIT(ISR_PROF_SMB);
+   }
+   @endcode
+ */
+//@{
+#if ISR_PROFILE  &&  ITM_TRACE
+    #define ISR_PROF_ENTER()	uint32_t isrProfStart = DWT->CYCCNT
+    #define ISR_PROF_EXIT(id)						\
+	do {								\
+	    uint32_t isrProfCycles = DWT->CYCCNT - isrProfStart;	\
+	    IsrProfileAccount(id, isrProfCycles);			\
+	    ITM_TRACE_ISR(id, isrProfStart, isrProfCycles);		\
+	} while (0)
+#elif ISR_PROFILE
+    #define ISR_PROF_ENTER()	uint32_t isrProfStart = DWT->CYCCNT
+    #define ISR_PROF_EXIT(id)	IsrProfileAccount(id, DWT->CYCCNT - isrProfStart)
+#elif ITM_TRACE
+    #define ISR_PROF_ENTER()	uint32_t isrProfStart = DWT->CYCCNT
+    #define ISR_PROF_EXIT(id)						\
+	ITM_TRACE_ISR(id, isrProfStart, DWT->CYCCNT - isrProfStart)
+#else
+    #define ISR_PROF_ENTER()
+    #define ISR_PROF_EXIT(id)
+#endif
+//@}
+
+/*================================ Global Data ===============================*/
+
+#if ISR_PROFILE
+extern ISR_PROF	 g_IsrProf[NUM_ISR_PROF];
+#endif
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize the DWT cycle counter */
+void	IsrProfileInit (void);
+
+    /* Show the statistics on the console, optionally reset them */
+void	IsrProfileReport (bool flgReset);
+
+
+#if ISR_PROFILE
+/***************************************************************************//**
+ *
+ * @brief	Account the Cycles of an Interrupt Service Routine
+ *
+ * This inline function is called by @ref ISR_PROF_EXIT() with the number of
+ * CPU cycles since @ref ISR_PROF_ENTER().  An ISR cannot preempt itself, so
+ * no interrupt lock is required.
+ *
+ * @param[in] id
+ *	Identifier of the interrupt service routine.
+ *
+ * @param[in] cycles
+ *	Number of CPU cycles of this call.
+ *
+ ******************************************************************************/
+static __INLINE void IsrProfileAccount (ISR_PROF_ID id, uint32_t cycles)
+{
+ISR_PROF *pProf = &g_IsrProf[id];
+
+    if (cycles < pProf->Min  ||  pProf->Cnt == 0)
+	pProf->Min = cycles;
+    if (cycles > pProf->Max)
+	pProf->Max = cycles;
+    pProf->Sum += cycles;
+    pProf->Cnt++;
+}
+#endif
+
+
+#endif /* __INC_IsrProfile_h */
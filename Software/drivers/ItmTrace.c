@@ -0,0 +1,238 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Binary Event Trace via ITM and SWO
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module streams compact binary records of the firmware events through
+ * the ITM of the Cortex-M3 to the SWO pin, so the timing of a visit can be
+ * watched in the lab without the delay of a text log via the LEUART.  A
+ * record is emitted in a few cycles, the data is shifted out by the TPIU.
+ * It is enabled by @ref ITM_TRACE, and the host decoder "tools/ItmDecode.c"
+ * converts a capture of the SWO stream into a list of events.
+ *
+ * Each record consists of two 32 bit words, which are written to two
+ * stimulus ports, so the decoder finds the start of a record even after a
+ * word has been lost:
+ * - Port @ref ITM_TRACE_PORT: The DWT cycle counter at the event.
+ * - Port @ref ITM_TRACE_PORT + 1: The type of @ref ITM_REC_TYPE in bits
+ *   31..28, an identifier in bits 27..20, and a value in bits 19..0.
+ *
+ * The records are emitted by these macros, which are empty without
+ * @ref ITM_TRACE:
+ * - ISR_PROF_EXIT() of "IsrProfile.h": The entry of an interrupt service
+ *   routine of @ref ISR_PROF_ID, with its number of cycles as value.
+ * - ITM_TRACE_TASK(): A task of the main loop is called.
+ * - ITM_TRACE_STATE(): A state transition of a module of @ref ITM_MOD.
+ * - ITM_TRACE_QUEUE(): The depth of a queue of @ref ITM_QUE.
+ * - ITM_TRACE_SYNC(): The main loop has woken up from EM1 or EM2.
+ *
+ * The cycle counter stops while the MCU sleeps, and its rate depends on the
+ * HF clock.  Therefore the main loop emits the lower 24 bits of the
+ * monotonic RTC clock after each wake-up, see ItmTraceSync(), and the HF
+ * clock is emitted at the start and after each change, see ItmTraceClock().
+ * The decoder derives the time of each record from the last synchronization
+ * and the cycles since then.
+ *
+ * A record takes 10 bytes on the SWO line, i.e. 50us at 2MBit/s.  If the
+ * stimulus port is still busy when a record is to be emitted, the record is
+ * discarded instead of waiting for the SWO line, and counted in
+ * @ref g_ItmTraceLost.  The next record is preceded by a record of type
+ * @ref ITM_REC_LOST with this number.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_cmu.h"
+#include "em_gpio.h"
+#include "em_int.h"
+#include "AlarmClock.h"		// ClockMonoTicks()
+#include "ItmTrace.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Encode the second word of a record. */
+#define ITM_REC_WORD(type, id, value)					\
+	(((uint32_t)(type) << 28) | (((id) & 0xFF) << 20)		\
+	 | ((value) > 0xFFFFF ? 0xFFFFF : (value)))
+
+/*================================ Global Data ===============================*/
+
+    /*!@brief Number of records which have been lost since the last one. */
+volatile uint32_t g_ItmTraceLost;
+
+/*================================ Local Data ================================*/
+
+#if ITM_TRACE
+    /*!@brief Flag if the ITM has been set up by ItmTraceInit(). */
+static bool	l_flgItmTraceOn;
+#endif
+
+/*=========================== Forward Declarations ===========================*/
+
+#if ITM_TRACE
+static void	ItmPut (int port, uint32_t word);
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the ITM Trace
+ *
+ * This routine routes SWO to pin PF2, starts the AUXHFRCO as SWO clock, and
+ * enables the ITM with the stimulus ports of the trace, and the DWT cycle
+ * counter.  Port 0 is also enabled for the text of DEBUG_VIA_ITM.  It must
+ * be called once after the clocks have been set up, and emits the HF clock
+ * as first record.  If @ref ITM_TRACE is 0, it does nothing.
+ *
+ ******************************************************************************/
+void	ItmTraceInit (void)
+{
+#if ITM_TRACE
+    /* Enable the SWO pin PF2, location 0 */
+    GPIO->ROUTE = (GPIO->ROUTE & ~_GPIO_ROUTE_SWLOCATION_MASK)
+		| GPIO_ROUTE_SWOPEN | GPIO_ROUTE_SWLOCATION_LOC0;
+    GPIO_PinModeSet (gpioPortF, 2, gpioModePushPull, 0);
+
+    /* The AUXHFRCO clocks the SWO output */
+    CMU_OscillatorEnable (cmuOsc_AUXHFRCO, true, true);
+
+    /* Enable trace in core debug, then the free running cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;
+
+    /* TPIU: asynchronous NRZ output, no formatter */
+    TPI->SPPR = 2;
+    TPI->ACPR = ITM_TRACE_SWO_PRESCALER - 1;
+    TPI->FFCR = 0x00000100;
+
+    /* ITM: unlock, trace bus ID 1, enable the stimulus ports */
+    ITM->LAR = 0xC5ACCE55;
+    ITM->TCR = (1 << ITM_TCR_TraceBusID_Pos) | ITM_TCR_SYNCENA_Msk
+	     | ITM_TCR_ITMENA_Msk;
+    ITM->TPR = 0;
+    ITM->TER = (1 << 0) | (3 << ITM_TRACE_PORT);
+
+    l_flgItmTraceOn = true;
+
+    ItmTraceClock();
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Emit a Trace Record
+ *
+ * These routines emit a record of the given type.  ItmTrace() takes the
+ * current value of the cycle counter, ItmTraceRec() a given one, e.g. the
+ * entry of an ISR.  They may be called from any context.  If the stimulus
+ * port is busy, the record is discarded and counted in @ref g_ItmTraceLost.
+ *
+ * @param[in] cycles
+ *	Value of the DWT cycle counter at the event.
+ *
+ * @param[in] type
+ *	Type of the record, see @ref ITM_REC_TYPE.
+ *
+ * @param[in] id
+ *	Identifier of the source, 0 to 255, e.g. @ref ITM_MOD.
+ *
+ * @param[in] value
+ *	Value of the record, 0 to 0xFFFFF, larger values are saturated.
+ *
+ ******************************************************************************/
+void	ItmTrace (ITM_REC_TYPE type, uint32_t id, uint32_t value)
+{
+#if ITM_TRACE
+    ItmTraceRec (DWT->CYCCNT, type, id, value);
+#else
+    (void) type;  (void) id;  (void) value;
+#endif
+}
+
+void	ItmTraceRec (uint32_t cycles, ITM_REC_TYPE type, uint32_t id,
+		     uint32_t value)
+{
+#if ITM_TRACE
+    if (! l_flgItmTraceOn)
+	return;
+
+    INT_Disable();
+
+    if (ITM->PORT[ITM_TRACE_PORT].u32 == 0)
+    {
+	g_ItmTraceLost++;	// stimulus port is busy - discard record
+    }
+    else
+    {
+	if (g_ItmTraceLost > 0)
+	{
+	    ItmPut (ITM_TRACE_PORT, cycles);
+	    ItmPut (ITM_TRACE_PORT + 1,
+		    ITM_REC_WORD(ITM_REC_LOST, 0, g_ItmTraceLost));
+	    g_ItmTraceLost = 0;
+	}
+	ItmPut (ITM_TRACE_PORT, cycles);
+	ItmPut (ITM_TRACE_PORT + 1, ITM_REC_WORD(type, id, value));
+    }
+
+    INT_Enable();
+#else
+    (void) cycles;  (void) type;  (void) id;  (void) value;
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Emit the Synchronization Records
+ *
+ * ItmTraceSync() is called by the main loop after it has woken up from EM1
+ * or EM2, with interrupts still disabled, so the record precedes those of
+ * the interrupt which caused the wake-up.  It emits the lower 24 bits of the
+ * monotonic clock, which are extended by the decoder, because the MCU wakes
+ * up at least every 256s in tickless mode.<br>
+ * ItmTraceClock() emits the current HF clock in [kHz], the rate of the cycle
+ * counter.  It is a handler of HfClockInit().
+ *
+ ******************************************************************************/
+void	ItmTraceSync (void)
+{
+#if ITM_TRACE
+uint32_t ticks = (uint32_t)ClockMonoTicks() & 0xFFFFFF;
+
+    ItmTraceRec (DWT->CYCCNT, ITM_REC_SYNC, ticks >> 20, ticks & 0xFFFFF);
+#endif
+}
+
+void	ItmTraceClock (void)
+{
+#if ITM_TRACE
+    ItmTrace (ITM_REC_CLOCK, 0, CMU_ClockFreqGet (cmuClock_CORE) / 1000);
+#endif
+}
+
+
+#if ITM_TRACE
+/***************************************************************************//**
+ *
+ * @brief	Write a Word to a Stimulus Port
+ *
+ * This routine waits until the stimulus port can take another word, which
+ * is at most the time to shift out the previous one, and writes the word.
+ *
+ ******************************************************************************/
+static void	ItmPut (int port, uint32_t word)
+{
+    while (ITM->PORT[port].u32 == 0)
+	;
+
+    ITM->PORT[port].u32 = word;
+}
+#endif
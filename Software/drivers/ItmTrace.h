@@ -0,0 +1,123 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module ItmTrace.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_ItmTrace_h
+#define __INC_ItmTrace_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to stream binary trace records via the ITM
+ * stimulus port @ref ITM_TRACE_PORT and SWO, see ItmTraceInit().
+ */
+#ifndef ITM_TRACE
+    #define ITM_TRACE		0
+#endif
+
+/*!@brief ITM stimulus port of the trace records.  Port 0 remains for the
+ * text of DEBUG_VIA_ITM.
+ */
+#ifndef ITM_TRACE_PORT
+    #define ITM_TRACE_PORT	1
+#endif
+
+/*!@brief Prescaler of the SWO clock, i.e. the AUXHFRCO of 14MHz.  The
+ * default of 7 gives 2MBit/s, which most debug probes can capture.
+ */
+#ifndef ITM_TRACE_SWO_PRESCALER
+    #define ITM_TRACE_SWO_PRESCALER	7
+#endif
+
+/*!@brief Types of the trace records - keep in sync with the host decoder
+ * "tools/ItmDecode.c"!
+ */
+typedef enum
+{
+    ITM_REC_SYNC,	//!< 0: Wake-up from EM1 or EM2, data is the RTC counter
+    ITM_REC_CLOCK,	//!< 1: HF clock of the cycle counter in [kHz]
+    ITM_REC_LOST,	//!< 2: Number of records lost before this one
+    ITM_REC_ISR,	//!< 3: ISR of @ref ISR_PROF_ID, value is its cycles
+    ITM_REC_TASK,	//!< 4: Task of the main loop called, id is @ref EVT_TASK
+    ITM_REC_STATE,	//!< 5: State transition of a module of @ref ITM_MOD
+    ITM_REC_QUEUE,	//!< 6: Depth of a queue of @ref ITM_QUE
+    NUM_ITM_REC
+} ITM_REC_TYPE;
+
+/*!@brief Modules of the @ref ITM_REC_STATE records. */
+typedef enum
+{
+    ITM_MOD_AUDIO,	//!< 0: State of the Audio module, AUDIO_STATE
+    ITM_MOD_CONTROL,	//!< 1: Playback and record requests, AUDIO_REQ bits
+    ITM_MOD_LB,		//!< 2: Mask of the active light barriers
+    ITM_MOD_TRANSIT,	//!< 3: Transit detection of the light barriers
+    NUM_ITM_MOD
+} ITM_MOD;
+
+/*!@brief Queues of the @ref ITM_REC_QUEUE records. */
+typedef enum
+{
+    ITM_QUE_DEFER,	//!< 0: Work items of Defer.c
+    ITM_QUE_RFID,	//!< 1: Transponder IDs of RFID.c
+    ITM_QUE_AUDIO_TX,	//!< 2: Bytes of the Audio command ring
+    ITM_QUE_LOG,	//!< 3: Bytes of the log buffer
+    NUM_ITM_QUE
+} ITM_QUE;
+
+/*!@brief Macros to emit the trace records, they are empty without
+ * @ref ITM_TRACE.  ITM_TRACE_TASK() takes the event mask of the task, the
+ * record contains the number of its lowest event.  The ISR records are
+ * emitted by ISR_PROF_EXIT(), see "IsrProfile.h".
+ */
+//@{
+#if ITM_TRACE
+    #define ITM_TRACE_ISR(id, start, cycles)				\
+	ItmTraceRec(start, ITM_REC_ISR, id, cycles)
+    #define ITM_TRACE_TASK(mask)					\
+	ItmTrace(ITM_REC_TASK, __builtin_ctz(mask), 0)
+    #define ITM_TRACE_STATE(mod, state)					\
+	ItmTrace(ITM_REC_STATE, mod, state)
+    #define ITM_TRACE_QUEUE(que, depth)					\
+	ItmTrace(ITM_REC_QUEUE, que, depth)
+    #define ITM_TRACE_SYNC()	ItmTraceSync()
+#else
+    #define ITM_TRACE_ISR(id, start, cycles)
+    #define ITM_TRACE_TASK(mask)
+    #define ITM_TRACE_STATE(mod, state)
+    #define ITM_TRACE_QUEUE(que, depth)
+    #define ITM_TRACE_SYNC()
+#endif
+//@}
+
+/*================================ Global Data ===============================*/
+
+extern volatile uint32_t g_ItmTraceLost;
+
+/*================================ Prototypes ================================*/
+
+    /* Route SWO and enable the stimulus port and the cycle counter */
+void	ItmTraceInit (void);
+
+    /* Emit a record with the current cycle counter, or a given one */
+void	ItmTrace (ITM_REC_TYPE type, uint32_t id, uint32_t value);
+void	ItmTraceRec (uint32_t cycles, ITM_REC_TYPE type, uint32_t id,
+		     uint32_t value);
+
+    /* Emit the RTC counter after a wake-up, or the new HF clock */
+void	ItmTraceSync (void);
+void	ItmTraceClock (void);
+
+
+#endif /* __INC_ItmTrace_h */
@@ -3,14 +3,40 @@
  * @brief	LEUART Driver
  * @author	Energy Micro AS
  * @author	Ralf Gerhauser
- * @version	2018-03-19
+ * @version	2026-10-15
  *
  * This is the driver for the Low Energy UART.  It is used to write log and
  * debug information to a connected host system.  The LEUART device to use
  * can be set via the @ref LEUART define, for an assignment of the DMA channel,
  * see @ref DMA_CHAN_LEUART_RX and @ref DMA_CHAN_LEUART_TX.
  *
- * @note This driver only supports data transmission.
+ * Backpressure: drvLEUART_puts() never blocks, a string that does not fit
+ * into the transmit FIFO is discarded as a whole and counted, the number is
+ * reported with the next string that fits.  drvLEUART_putsWait() sleeps in
+ * EM1 instead, until the DMA has made enough space.  drvLEUART_free()
+ * returns the free space, so producers can decide themselves.
+ *
+ * Transmit DMA: The channel runs in ping-pong mode over the two halves of the
+ * transmit FIFO.  While the DMA sends the data of one descriptor, the other
+ * one is armed with the next chunk, so the output streams without gaps, and
+ * there is at most one interrupt per half of the FIFO.
+ *
+ * Receive DMA: The channel runs in ping-pong mode over the two halves of
+ * the receive ring, so the reception never stops, and the CPU is not
+ * involved for the single bytes.  The signal frame of the LEUART (\<LF>)
+ * wakes it up once per complete command line, or binary telemetry frame,
+ * see Telemetry.c, and once per half of the ring for re-arming the
+ * descriptor.  The interrupt handler only notifies the main loop, where
+ * drvLEUART_CmdLineGet() copies one line after the other from the ring into
+ * @ref g_CmdLine.  So lines which arrive back to back are not overwritten
+ * before they have been processed.
+ *
+ * High-speed mode: All USARTs are in use, so the LEUART itself provides a
+ * fast monitor link for the lab.  drvLEUART_HighSpeed() clocks it from
+ * HFCORECLK/2 instead of the LFXO, and sets @ref LEUART_HS_BAUD.  As long as
+ * this mode is active, the system stays in EM1, see @ref EM1_MOD_CONSOLE.
+ * If no command line has been received for @ref LEUART_HS_IDLE_TIMEOUT
+ * seconds, the driver falls back to the initial baudrate and EM2 operation.
  *
  ******************************************************************************
  * @section License
@@ -42,6 +68,38 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Reduced TX_FIFO_SIZE from 1500 to 512, the firmware must fit
+		into 16KB of RAM.
+2026-10-15,agnt	LEUART_IRQHandler is executed from flash again, it only handles
+		the end of a command line since the receive DMA ring.
+2026-10-15,agnt	The FIFO indexes and the receive ring are protected by
+		CritEnter(), see INT_CEIL_CONSOLE.  txWait() does not sleep
+		within such a critical section.
+2026-10-15,agnt	The receive DMA runs in ping-pong mode over a ring buffer, the
+		command lines are fetched by drvLEUART_CmdLineGet().
+2026-10-15,agnt	The DMA channels are set up via DmaChanConfig().
+2026-10-15,agnt	LEUART_IRQHandler is executed from RAM, see RAMFUNC.
+2026-10-15,agnt	EM1 of the high-speed mode is acquired via ClockMgr.c.
+2026-10-15,agnt	The high-speed mode holds a boost of the HF clock governor, so
+		the baud rate does not change, see HF_CLOCK_GOVERNOR.
+2026-10-15,agnt	Use StrFormat() instead of sprintf().
+2026-10-14,agnt	The transmit DMA runs in ping-pong mode over the two halves of
+		txFIFO, see dmaTransferStart().  This replaces the basic mode,
+		which had to be restarted after each transfer.
+2026-10-14,agnt	Added a high-speed mode, where the LEUART is clocked from
+		HFCORECLK/2 with LEUART_HS_BAUD, and the system stays in EM1,
+		see drvLEUART_HighSpeed().
+2026-10-14,agnt	Backpressure: drvLEUART_puts() writes a string completely or
+		discards it, counted by drvLEUART_dropCount(), and reports the
+		number of discarded strings with the next one that fits.
+		drvLEUART_putsWait() instead waits in EM1 until there is enough
+		space.  drvLEUART_sync() sleeps in EM1 instead of busy-waiting.
+		Added drvLEUART_free().
+2026-10-14,agnt	The length of a command line is stored in g_CmdLineLen, it may
+		contain binary data, see Telemetry.c.  Added drvLEUART_write()
+		to send binary frames without <LF> translation.
+2026-10-14,agnt	A new command line triggers CheckCommand() via
+		EVENT_POST(EVT_COMMAND).
 2018-03-19,rage	Increased TX_FIFO_SIZE from 1024 to 1500.
 		Changed dmaTransferStart() to limit transfers to 1024 bytes.
 		Set interrupt priority for DMA_IRQn.
@@ -53,6 +111,7 @@ Revision History:
 
 /*=============================== Header Files ===============================*/
 
+#include <string.h>
 #include "em_chip.h"
 #include "em_device.h"
 #include "em_cmu.h"
@@ -60,6 +119,13 @@ Revision History:
 #include "em_int.h"
 #include "em_leuart.h"
 #include "LEUART.h"
+#include "DmaChan.h"
+#include "AlarmClock.h"
+#include "IsrProfile.h"
+#include "StrFormat.h"
+#include "HfClock.h"
+#include "ClockMgr.h"
+#include "CritSect.h"
 
 /*=============================== Definitions ================================*/
 
@@ -76,12 +142,34 @@ Revision History:
 #define LEUART_PIN_RX		5		//!< Rx pin
 //@}
 
-    /*! Size of the transmit FIFO in bytes */
-#define TX_FIFO_SIZE		1500
+    /*! Size of the transmit FIFO in bytes, the console output waits for
+     * space in the FIFO if necessary, see txWait(). */
+#define TX_FIFO_SIZE		512
+
+    /*! Half of the transmit FIFO, each DMA descriptor stays within one half */
+#define TX_FIFO_HALF		(TX_FIFO_SIZE / 2)
+
+#if TX_FIFO_HALF > 1024
+    #error "A DMA descriptor can handle maximum 1024 bytes per transfer"
+#endif
+
+    /*! DMA descriptor for Tx, 0 is the primary, 1 the alternate structure */
+#define TX_DESCR(n)	(&g_DMA_ControlBlock[DMA_CHAN_LEUART_TX		\
+					     + ((n) ? DMA_CHAN_COUNT : 0)])
 
 #if ENABLE_LEUART_RECEIVER
     /*! Size of the command line buffer in bytes */
 #define CMD_LINE_SIZE		40
+
+    /*! Size of the receive ring in bytes, must be a power of 2 */
+#define RX_RING_SIZE		128
+
+    /*! Half of the receive ring, i.e. the size of one DMA descriptor */
+#define RX_RING_HALF		(RX_RING_SIZE / 2)
+
+    /*! DMA descriptor for Rx, 0 is the primary, 1 the alternate structure */
+#define RX_DESCR(n)	(&g_DMA_ControlBlock[DMA_CHAN_LEUART_RX		\
+					     + ((n) ? DMA_CHAN_COUNT : 0)])
 #endif
 
 /*======================== External Data and Routines ========================*/
@@ -100,6 +188,9 @@ volatile bool	g_flgCmdLine;
 
 /*!@brief Command line buffer */
 char	 g_CmdLine[CMD_LINE_SIZE];
+
+/*!@brief Number of bytes in g_CmdLine, without <LF> and EOS */
+volatile int	g_CmdLineLen;
 #endif
 
 /*================================ Local Data ================================*/
@@ -132,7 +223,7 @@ static DMA_CfgChannel_TypeDef chnlCfgTx =
     .highPri   = false,			// Normal priority
     .enableInt = false,			// No interrupt for callback function
     .select    = DMAREQ_LEUART_TXBL,	// DMA Req. is LEUARTx TX buffer empty
-    .cb = &(g_DMA_Callback[DMA_CHAN_LEUART_TX]), // Callback for DMA TX done
+    .cb        = NULL,			// Callback is set by DmaChanConfig()
 };
 
 /* Setting up channel descriptor for Tx  */
@@ -150,9 +241,9 @@ DMA_CfgDescr_TypeDef descrCfgTx =
 static DMA_CfgChannel_TypeDef chnlCfgRx =
 {
     .highPri   = false,			// Normal priority
-    .enableInt = false,			// No interrupt for callback function
+    .enableInt = true,			// Interrupt for callback function
     .select    = DMAREQ_LEUART_RXDATAV,	// DMA Req. is LEUARTx RX data available
-    .cb        = NULL,			// No callback function
+    .cb        = NULL,			// Callback is set by DmaChanConfig()
 };
 
 /* Setting up channel descriptor */
@@ -166,89 +257,166 @@ DMA_CfgDescr_TypeDef descrCfgRx =
 };
 #endif
 
+#if ENABLE_LEUART_RECEIVER
+/* Receive ring, the DMA fills one half while the other one is re-armed */
+static uint8_t	 rxRing[RX_RING_SIZE];
+
+/* Number of completed halves, and ring position of the next line, both
+ * are running counters, i.e. the index is (counter % RX_RING_SIZE) */
+static volatile uint32_t rxHalfCnt;
+static uint32_t		 rxIdxGet;
+#endif
+
 /* Transmit FIFO and index variables */
 static uint8_t	 txFIFO[TX_FIFO_SIZE];
-static volatile uint16_t txIdxPut, txIdxGet, txIdxGetNext;
+static volatile uint16_t txIdxPut, txIdxGet;
+
+/* End index of the data in each DMA descriptor, the descriptor the DMA works
+   on, and the number of descriptors which are armed (0 to 2) */
+static uint16_t		txDescEnd[2];
+static uint8_t		txDescGet;
+static uint8_t		txDescCnt;
 
 /* Flag if DMA transfer is in progress */
 static volatile bool	flgDMArun;
 
+/* Baudrate of the low-power mode, as set by drvLEUART_Init() */
+static uint32_t		 lowPowerBaud;
+
+/* Timer for the idle timeout of the high-speed mode, and the timeout flag */
+static TIM_HDL		 hdlSpeedIdle = NONE;
+static volatile bool	 flgSpeedIdle;
+
+/* Number of strings discarded, and how many of them have been reported */
+static volatile uint32_t txDropCnt;
+static uint32_t		 txDropReported;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	txPuts (const char *pStr, bool flgWait);
+static bool	txWait (int cnt);
+static void	speedIdleTimeout (TIM_HDL hdl);
+#if ENABLE_LEUART_RECEIVER
+static void	rxRingDone (unsigned int channel, bool primary, void *user);
+static uint32_t	rxRingPut (void);
+#endif
+
 
 /**************************************************************************//**
- * @brief  DMA Callback function
+ * @brief  Start or continue the DMA Transfer
+ *
+ * This routine hands the data of the transmit FIFO to the DMA.  The channel
+ * runs in ping-pong mode: the descriptors which the DMA has completed are
+ * retired first, i.e. @ref txIdxGet is advanced.  Then every free descriptor
+ * is armed with the next chunk of data, which ends at the next half of the
+ * FIFO at the latest.  If the channel was stopped, it is restarted with the
+ * primary descriptor.
  *
- * When the DMA transfer is completed, disables the DMA wake-up on TX in the
- * LEUART to enable the DMA to sleep even when the LEUART buffer is empty.
+ * A completed descriptor is recognized by its cycle control field, which the
+ * DMA controller sets to "invalid".  So it does not matter if the interrupts
+ * of both descriptors are served at once.  If the channel stopped just before
+ * a descriptor was armed, the data of this descriptor is armed again.
+ *
+ * @note
+ * This routine is called by the producers and via dmaTransferDone() from the
+ * DMA interrupt.
  *
  ******************************************************************************/
 void dmaTransferStart (void)
 {
-uint16_t	idxPut;		// local index variable
-int16_t		cnt;		// number of bytes to send
-
-
-    INT_Disable();
-
-    if (flgDMArun)
-    {
-	INT_Enable();
-	return;			// do not disturb a running DMA transfer
-    }
+uint16_t	idxStart, idxEnd;	// chunk of the transmit FIFO
+int		n;			// descriptor to arm
+bool		flgRun;			// DMA channel is running
+CRIT_STATE crit;
 
-    flgDMArun = true;		// set flag for DMA activity
-    INT_Enable();
 
-    /* Use local index that will not change */
-    idxPut = txIdxPut;
+    crit = CritEnter (INT_CEIL_CONSOLE);
 
-    /* Calculate how many bytes to transfer */
-    cnt = idxPut - txIdxGet;
+    /* Get channel state first - a descriptor may complete in the meantime */
+    flgRun = flgDMArun  &&  DMA_ChannelEnabled(DMA_CHAN_LEUART_TX);
 
-    if (cnt == 0)
+    /* Retire descriptors which have been completed, in the order of the DMA */
+    while (txDescCnt > 0  &&  (TX_DESCR(txDescGet)->CTRL
+		& _DMA_CTRL_CYCLE_CTRL_MASK) == _DMA_CTRL_CYCLE_CTRL_INVALID)
     {
-	flgDMArun = false;	// clear flag again
-	return;
+	txIdxGet = txDescEnd[txDescGet];
+	txDescGet ^= 1;
+	txDescCnt--;
     }
 
-    if (cnt < 0)
+    if (! flgRun)
     {
-	/* Limit DMA transfer to end of FIFO buffer */
-	idxPut = sizeof(txFIFO);
-	cnt = idxPut - txIdxGet;	// calculate number of bytes
+	/* Channel has stopped, invalidate a descriptor that was armed too late */
+	TX_DESCR(0)->CTRL &= ~_DMA_CTRL_CYCLE_CTRL_MASK;
+	TX_DESCR(1)->CTRL &= ~_DMA_CTRL_CYCLE_CTRL_MASK;
+	txDescCnt = 0;
+	txDescGet = 0;		// restart with the primary descriptor
     }
-    else if (cnt > 1024)
+
+    /* Arm the free descriptors with the data not handed to the DMA yet */
+    while (txDescCnt < 2)
     {
-	/* DMA can maximum handle 1024 bytes per transfer - limit it */
-	cnt = 1024;
-	idxPut = txIdxGet + cnt;	// calculate source end address
-    }
+	n = (txDescGet + txDescCnt) & 1;
+	idxStart = (txDescCnt == 0 ? txIdxGet : txDescEnd[txDescGet]);
+	idxEnd = txIdxPut;
+
+	if (idxStart == idxEnd)
+	    break;			// no more data
+
+	/* Limit the chunk to the end of the current FIFO half */
+	if (idxEnd < idxStart  ||  idxEnd > TX_FIFO_HALF)
+	{
+	    if (idxStart < TX_FIFO_HALF)
+		idxEnd = TX_FIFO_HALF;
+	    else if (idxEnd < idxStart)
+		idxEnd = TX_FIFO_SIZE;
+	}
 
-    /* Calculate next value of the Get Index */
-    txIdxGetNext = txIdxGet + cnt;
-    if (txIdxGetNext >= sizeof(txFIFO))
-	txIdxGetNext -= sizeof(txFIFO);
+	txDescEnd[n] = (idxEnd < TX_FIFO_SIZE ? idxEnd : 0);
 
-    /* Set new DMA source end address directly in the DMA descriptor */
-    g_DMA_ControlBlock[DMA_CHAN_LEUART_TX].SRCEND = &txFIFO[idxPut-1];
+	DMA_RefreshPingPong(DMA_CHAN_LEUART_TX, // Channel to use
+			    n == 0,		// Primary or alternate descriptor
+			    false,		// No DMA burst
+			    NULL,		// Keep destination address
+			    &txFIFO[idxStart],	// Source address
+			    idxEnd - idxStart - 1, // Size of chunk - 1
+			    false);		// Continue with next descriptor
+	txDescCnt++;
+    }
 
-    /* Enable DMA wake-up from LEUART TX */
-    IO_Bit(LEUART->CTRL, _LEUART_CTRL_TXDMAWU_SHIFT) = 1;
+    if (! flgRun)
+    {
+	if (txDescCnt > 0)
+	{
+	    /* Enable DMA wake-up from LEUART TX */
+	    IO_Bit(LEUART->CTRL, _LEUART_CTRL_TXDMAWU_SHIFT) = 1;
+
+	    /* (Re)start the channel with the primary descriptor */
+	    DMA->CHALTC = (1 << DMA_CHAN_LEUART_TX);
+	    g_DMA_Callback[DMA_CHAN_LEUART_TX].primary = true;
+	    DMA->CHENS  = (1 << DMA_CHAN_LEUART_TX);
+	    flgDMArun = true;
+	}
+	else
+	{
+	    /* Disable DMA wake-up from LEUART TX, the DMA may sleep now */
+	    IO_Bit(LEUART->CTRL, _LEUART_CTRL_TXDMAWU_SHIFT) = 0;
+	    flgDMArun = false;
+	}
+    }
 
-    /* (Re)starting the transfer. Using Basic Mode */
-    DMA_ActivateBasic(DMA_CHAN_LEUART_TX, // Activate channel selected
-		      true,		// Use primary descriptor
-		      false,		// No DMA burst
-		      NULL,		// Keep destination address
-		      NULL,		// Keep source address
-		      cnt - 1);		// Size of buffer - 1
+    CritExit (crit);
 }
 
 
 /**************************************************************************//**
  * @brief  DMA Callback function
  *
- * When the DMA transfer is completed, disables the DMA wake-up on TX in the
- * LEUART to enable the DMA to sleep even when the LEUART buffer is empty.
+ * This routine is called from the DMA interrupt whenever a descriptor has
+ * been completed.  It retires the descriptor and arms it with the next chunk
+ * of data, while the DMA already continues with the other one.  If there is
+ * no more data, the DMA wake-up on TX in the LEUART is disabled, to enable
+ * the DMA to sleep even when the LEUART buffer is empty.
  *
  ******************************************************************************/
 void dmaTransferDone(unsigned int channel, bool primary, void *user)
@@ -257,17 +425,12 @@ void dmaTransferDone(unsigned int channel, bool primary, void *user)
     (void) primary;
     (void) user;
 
-    /* Disable DMA wake-up from LEUART TX */
-    IO_Bit(LEUART->CTRL, _LEUART_CTRL_TXDMAWU_SHIFT) = 0;
-
-    /* Update Get Index */
-    txIdxGet = txIdxGetNext;
+    ISR_PROF_ENTER();
 
-    /* Clear DMA running flag */
-    flgDMArun = false;
-
-    /* Check if still data to send */
+    /* Retire completed descriptors, check if still data to send */
     dmaTransferStart();
+
+    ISR_PROF_EXIT(ISR_PROF_LEUART_TX);
 }
 
 
@@ -282,18 +445,17 @@ void dmaTransferDone(unsigned int channel, bool primary, void *user)
  *****************************************************************************/
 static void setupLeuartDma(void)
 {
-    /* Setting call-back function */
-    g_DMA_Callback[DMA_CHAN_LEUART_TX].cbFunc  = dmaTransferDone;
-    g_DMA_Callback[DMA_CHAN_LEUART_TX].userPtr = NULL;
-
-    /* Initializing DMA, channel and descriptor for Tx */
+    /* Initializing DMA, channel with call-back, and descriptor for Tx */
     DMA_Init(&dmaInit);
     NVIC_DisableIRQ(DMA_IRQn);
-    DMA_CfgChannel(DMA_CHAN_LEUART_TX, &chnlCfgTx);
-    DMA_CfgDescr(DMA_CHAN_LEUART_TX, true, &descrCfgTx);
+    DmaChanConfig(DMA_CHAN_LEUART_TX, "LEUART Tx", &chnlCfgTx,
+		  dmaTransferDone, NULL);
+    DMA_CfgDescr(DMA_CHAN_LEUART_TX, true,  &descrCfgTx);
+    DMA_CfgDescr(DMA_CHAN_LEUART_TX, false, &descrCfgTx);
 
-    /* Set new DMA destination end address directly in the DMA descriptor */
-    g_DMA_ControlBlock[DMA_CHAN_LEUART_TX].DSTEND = &LEUART->TXDATA;
+    /* Set DMA destination end address directly in both DMA descriptors */
+    TX_DESCR(0)->DSTEND = &LEUART->TXDATA;
+    TX_DESCR(1)->DSTEND = &LEUART->TXDATA;
 
     /* Enable DMA Transfer Complete Interrupt */
     DMA->IEN = (DMA_IEN_CH0DONE << DMA_CHAN_LEUART_TX);
@@ -303,19 +465,25 @@ static void setupLeuartDma(void)
     NVIC_EnableIRQ(DMA_IRQn);
 
 #if ENABLE_LEUART_RECEIVER
-    /* Initializing DMA, channel and descriptor */
-    DMA_CfgChannel(DMA_CHAN_LEUART_RX, &chnlCfgRx);
-    DMA_CfgDescr(DMA_CHAN_LEUART_RX, true, &descrCfgRx);
-
-    /* Starting the transfer. Using Basic Mode */
-    DMA_ActivateBasic(DMA_CHAN_LEUART_RX, // Activate channel selected
-		      true,		// Use primary descriptor
-		      false,		// No DMA burst
-		      (void *) g_CmdLine,	// Destination address
-		      (void *) &LEUART->RXDATA,	// Source address is register
-		      CMD_LINE_SIZE - 1);	// Size of buffer - 1
-
-    /* Set LEUART signal frame to <NL> (or <CR>) */
+    /* Initializing DMA, channel with call-back, and descriptors for Rx */
+    DmaChanConfig(DMA_CHAN_LEUART_RX, "LEUART Rx", &chnlCfgRx,
+		  rxRingDone, NULL);
+    DMA_CfgDescr(DMA_CHAN_LEUART_RX, true,  &descrCfgRx);
+    DMA_CfgDescr(DMA_CHAN_LEUART_RX, false, &descrCfgRx);
+
+    /* Starting the transfer, each descriptor covers one half of the ring */
+    rxHalfCnt = rxIdxGet = 0;
+    DMA_ActivatePingPong(DMA_CHAN_LEUART_RX,
+			 false,			// No DMA burst
+			 (void *) rxRing,	// Primary destination
+			 (void *) &LEUART->RXDATA,	// Source is register
+			 RX_RING_HALF - 1,
+			 (void *) (rxRing + RX_RING_HALF), // Alternate dest.
+			 (void *) &LEUART->RXDATA,	// Source is register
+			 RX_RING_HALF - 1);
+
+    /* Set LEUART signal frame to <LF>, this also terminates the binary
+     * telemetry frames, see TLM_FRAME_END */
     LEUART->SIGFRAME = '\n';
 
     /* Enable LEUART Signal Frame Interrupt */
@@ -351,6 +519,7 @@ void	drvLEUART_Init (uint32_t baud)
 
     /* Reseting and initializing LEUART */
     LEUART_Reset(LEUART);
+    lowPowerBaud = baud;
     leuartInit.baudrate = baud;
     LEUART_Init(LEUART, &leuartInit);
 
@@ -385,13 +554,14 @@ void	drvLEUART_Init (uint32_t baud)
 /**************************************************************************//**
  * @brief LEUART IRQ handler
  *
- * When a character has been received by the LEUART, this interrupt routine will
- * store the character into the rxFIFO.
+ * When the signal frame (\<LF>) has been received by the LEUART, a command
+ * line is complete in the receive ring.  This interrupt routine only notifies
+ * the main loop, the line is fetched there by drvLEUART_CmdLineGet().
  *
  *****************************************************************************/
 void LEUART_IRQHandler(void)
 {
-uint32_t leuartif, len;
+uint32_t leuartif;
 
     /* Store and reset pending interrupts */
     leuartif = LEUART_IntGet(LEUART);
@@ -400,23 +570,132 @@ uint32_t leuartif, len;
     /* Check for frame found */
     if (leuartif & LEUART_IF_SIGF)
     {
-	/* Zero-terminate RX command line buffer */
-	len = CMD_LINE_SIZE - 2
-	    - ((g_DMA_ControlBlock[DMA_CHAN_LEUART_RX].CTRL >> 4) & 0x3FF);
-
-	g_CmdLine[len] = EOS;
+	/* the host is still attached - restart the idle timeout */
+	if (Bit(g_EM1_ModuleMask, EM1_MOD_CONSOLE))
+	    sTimerStart (hdlSpeedIdle, LEUART_HS_IDLE_TIMEOUT);
 
 	/* set flag to notify new command is available */
 	g_flgCmdLine = true;
+	EVENT_POST(EVT_COMMAND);
+    }
+}
 
-	/* Re-start DMA */
-	DMA_ActivateBasic(DMA_CHAN_LEUART_RX, // Activate channel selected
-			  true,		// Use primary descriptor
-			  false,	// No DMA burst
-			  NULL,		// keep destination address
-			  NULL,		// keep source address
-			  CMD_LINE_SIZE - 1);	// Size of buffer - 1
+
+/***************************************************************************//**
+ *
+ * @brief  Receive DMA has filled one Half of the Ring
+ *
+ * This routine is called from the DMA interrupt whenever a descriptor has
+ * been completed.  The descriptor is re-armed at once for the same half of
+ * the ring, while the DMA already continues with the other one.
+ *
+ ******************************************************************************/
+static void rxRingDone(unsigned int channel, bool primary, void *user)
+{
+    (void) user;
+
+    DMA_RefreshPingPong(channel, primary, false, NULL, NULL,
+			RX_RING_HALF - 1, false);
+    rxHalfCnt++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Current Write Position of the Receive DMA
+ *
+ * The position is calculated from the number of completed halves, and the
+ * remaining transfers of the active descriptor.  If a descriptor has just
+ * been completed, but rxRingDone() has not been called yet, the active
+ * descriptor does not match the number of completed halves.
+ *
+ * @return
+ *	Running counter of the received bytes.
+ *
+ ******************************************************************************/
+static uint32_t	rxRingPut (void)
+{
+uint32_t alt, remain, pos;
+CRIT_STATE crit;
+
+    crit = CritEnter (INT_CEIL_CONSOLE);
+
+    alt = (DMA->CHALTS >> DMA_CHAN_LEUART_RX) & 1;
+    remain = RX_DESCR(alt)->CTRL;
+    remain = ((remain & _DMA_CTRL_CYCLE_CTRL_MASK) == _DMA_CTRL_CYCLE_CTRL_INVALID ? 0
+	      : ((remain & _DMA_CTRL_N_MINUS_1_MASK)
+		 >> _DMA_CTRL_N_MINUS_1_SHIFT) + 1);
+
+    pos = rxHalfCnt * RX_RING_HALF + (RX_RING_HALF - remain);
+    if (alt != (rxHalfCnt & 1))
+	pos += RX_RING_HALF;	// call-back is still pending
+
+    CritExit (crit);
+
+    return pos;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Fetch the next Command Line
+ *
+ * This routine is called from the main loop, after LEUART_IRQHandler() has
+ * set @ref g_flgCmdLine.  It copies the next complete line from the receive
+ * ring into @ref g_CmdLine, without the \<LF>, and stores its length in
+ * @ref g_CmdLineLen.  A line which is longer than the buffer is truncated.
+ * If there are more complete lines in the ring, @ref g_flgCmdLine is set
+ * again, so CheckCommand() is called for each of them.
+ *
+ * @return
+ *	true if a command line has been stored in @ref g_CmdLine, false if
+ *	there is no complete line in the ring.
+ *
+ ******************************************************************************/
+bool	 drvLEUART_CmdLineGet (void)
+{
+uint32_t put, idx;
+int	 len;
+uint8_t	 ch;
+
+    put = rxRingPut();
+
+    /* Discard the data which has already been overwritten by the DMA */
+    if (put - rxIdxGet > RX_RING_SIZE)
+	rxIdxGet = put - RX_RING_SIZE;
+
+    /* Look for the end of the next line */
+    for (idx = rxIdxGet;  idx != put;  idx++)
+	if (rxRing[idx % RX_RING_SIZE] == '\n')
+	    break;
+
+    if (idx == put)
+	return false;		// line not complete yet
+
+    /* Copy the line, the DMA only writes behind put */
+    for (len = 0;  rxIdxGet != idx;  rxIdxGet++)
+    {
+	ch = rxRing[rxIdxGet % RX_RING_SIZE];
+	if (len < CMD_LINE_SIZE - 1)
+	    g_CmdLine[len++] = ch;
+    }
+    rxIdxGet++;			// skip <LF>
+
+    g_CmdLine[len] = EOS;
+    g_CmdLineLen = len;
+
+    /* Check for further complete lines */
+    for (idx = rxIdxGet;  idx != put;  idx++)
+    {
+	if (rxRing[idx % RX_RING_SIZE] == '\n')
+	{
+	    g_flgCmdLine = true;
+	    EVENT_POST(EVT_COMMAND);
+	    break;
+	}
     }
+
+    return true;
 }
 #endif
 
@@ -426,8 +705,10 @@ uint32_t leuartif, len;
  * @brief  Put string into transmit FIFO
  *
  * This routine writes the specified string into the transmit FIFO, where it
- * is transferred to the LEUART via DMA.  If there is no more space in the
- * FIFO, characters will be discarded.
+ * is transferred to the LEUART via DMA.  If there is not enough space in the
+ * FIFO, the complete string is discarded and counted, see
+ * drvLEUART_dropCount().  This routine never blocks, so it can be used as
+ * @ref LOG_MONITOR_FUNCTION, also from interrupt context.
  *
  * @param[in] pStr
  *	Address pointer of the string to write into the FIFO.
@@ -435,21 +716,85 @@ uint32_t leuartif, len;
  ******************************************************************************/
 void	 drvLEUART_puts (const char *pStr)
 {
-int16_t	cnt;			// free buffer space in number of bytes
+    txPuts (pStr, false);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Put string into transmit FIFO, wait for space
+ *
+ * This routine writes the specified string into the transmit FIFO like
+ * drvLEUART_puts(), but if there is not enough space, it waits in EM1 until
+ * the DMA has transferred enough data.  Use it for console output which must
+ * be complete, e.g. CfgDataShow().  In interrupt context, or with interrupts
+ * disabled, it does not wait but discards the string.
+ *
+ * @param[in] pStr
+ *	Address pointer of the string to write into the FIFO.
+ *
+ ******************************************************************************/
+void	 drvLEUART_putsWait (const char *pStr)
+{
+    txPuts (pStr, true);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Put string into transmit FIFO, common part
+ *
+ * This routine calculates the space required for the string, including the
+ * \<CR> characters for @ref g_flgLEUART_LF2CRLF, then writes it completely,
+ * or discards it.  If strings have been discarded before, a note with their
+ * number is written first, as soon as there is enough space again.
+ *
+ * @param[in] pStr
+ *	Address pointer of the string to write into the FIFO.
+ *
+ * @param[in] flgWait
+ *	If true, wait until there is enough space.
+ *
+ ******************************************************************************/
+static void	txPuts (const char *pStr, bool flgWait)
+{
+char	note[48];		// note about discarded strings
+const char *p;
+int	len;
 bool	sendCR = false;		// set true to write <CR> to buffer
 
 
-    while (*pStr != EOS)
+    /* Calculate the number of bytes to write */
+    for (len = 0, p = pStr;  *p != EOS;  p++, len++)
+	if (g_flgLEUART_LF2CRLF  &&  *p == '\n')
+	    len++;		// additional <CR>
+
+    if (len == 0)
+	return;
+
+    note[0] = EOS;
+    if (txDropCnt != txDropReported)
+    {
+	StrFormat (note, "\n<%ld messages discarded>\n",
+		   txDropCnt - txDropReported);
+	len += strlen(note) + 2;	// 2x <CR>
+    }
+
+    if (len > drvLEUART_free()  &&  ! (flgWait  &&  txWait (len)))
     {
-	/* Non-blocking: discard string if FIFO is full */
-	cnt  = txIdxPut;
-	cnt -= txIdxGet;
-	if (cnt < 0)
-	    cnt += sizeof(txFIFO);
+	/* Not enough space: discard the complete string and count it */
+	txDropCnt++;
+	return;
+    }
 
-	if (cnt > (int16_t)(sizeof(txFIFO) - 2))
-	    break;
+    if (note[0] != EOS)
+    {
+	txDropReported = txDropCnt;
+	txPuts (note, false);	// there is enough space for it
+    }
 
+    while (*pStr != EOS)
+    {
 	/* Check if to translate <LF> to <CR><LF> */
 	if (g_flgLEUART_LF2CRLF  &&  (*pStr == '\n')  &&  ! sendCR)
 	{
@@ -474,6 +819,85 @@ bool	sendCR = false;		// set true to write <CR> to buffer
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief  Wait for space in the transmit FIFO
+ *
+ * This routine waits in EM1 until at least <b>cnt</b> bytes are free in the
+ * transmit FIFO.  The CPU is woken up by the DMA done interrupt, see
+ * dmaTransferDone().  Interrupts are disabled while checking the condition,
+ * so the wake-up cannot be missed - WFI returns on a pending interrupt.
+ *
+ * @param[in] cnt
+ *	Number of bytes required.
+ *
+ * @return
+ *	The value <i>true</i> if the space is available, <i>false</i> if it is
+ *	not possible to wait, i.e. in interrupt context, with interrupts
+ *	disabled or masked by a critical section, see CritEnter(), or if the
+ *	FIFO is too small.
+ *
+ ******************************************************************************/
+static bool	txWait (int cnt)
+{
+    if (__get_IPSR() != 0  ||  INT_LockCnt != 0  ||  __get_BASEPRI() != 0
+    ||  cnt > (int)sizeof(txFIFO) - 2)
+	return false;
+
+    INT_Disable();
+    while (drvLEUART_free() < cnt)
+    {
+	dmaTransferStart();	// be sure the DMA is running
+	EMU_EnterEM1();		// returns on the next interrupt
+	INT_Enable();		// let the interrupt be served
+	INT_Disable();
+    }
+    INT_Enable();
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Put binary data into transmit FIFO
+ *
+ * This routine writes the specified bytes into the transmit FIFO, without
+ * translating \<LF> or stopping at EOS.  It is used for binary frames, which
+ * must not be truncated, so the data is only written if there is enough
+ * space for all bytes.
+ *
+ * @param[in] pBuf
+ *	Address pointer of the data to write into the FIFO.
+ *
+ * @param[in] cnt
+ *	Number of bytes to write.
+ *
+ * @return
+ *	The value <i>true</i> if the data has been written, <i>false</i> if it
+ *	has been discarded because the FIFO is full.
+ *
+ ******************************************************************************/
+bool	 drvLEUART_write (const uint8_t *pBuf, int cnt)
+{
+    if (cnt > drvLEUART_free())
+	return false;		// not enough space, discard data
+
+    while (cnt-- > 0)
+    {
+	txFIFO[txIdxPut] = *pBuf++;
+
+	if (++txIdxPut >= sizeof(txFIFO))
+	    txIdxPut = 0;	// wrap around
+    }
+
+    /* Be sure to enable DMA for data transfer */
+    dmaTransferStart();
+
+    return true;
+}
+
+
 /***************************************************************************//**
  *
  * @brief  Put character into the transmit FIFO
@@ -505,12 +929,160 @@ char	 buffer[2];	// temporary character buffer
  * @brief  Synchronize LEUART
  *
  * This routine waits until all characters have been written to the serial
- * interface, i.e. the transmit FIFO is empty.
+ * interface, i.e. the transmit FIFO is empty.  It sleeps in EM1 until the
+ * DMA transfers are done.  In interrupt context it returns immediately.
  *
  ******************************************************************************/
 void	 drvLEUART_sync(void)
 {
-    while (txIdxPut != txIdxGet)
+    txWait (sizeof(txFIFO) - 2);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Switch the Speed of the LEUART
+ *
+ * This routine switches the LEUART between the low-power mode, where it is
+ * clocked by the LFXO with the baudrate of drvLEUART_Init(), and works in
+ * EM2, and the high-speed mode with @ref LEUART_HS_BAUD.  Then it is clocked
+ * from HFCORECLK/2, so the system must stay in EM1, and the HFXO is requested
+ * from the HF clock governor meanwhile.  The LEUART prescaler is set so that
+ * the clock divider is within range.  The transmit FIFO is sent with the old
+ * baudrate before.  It must be called from the main loop.
+ *
+ * @param[in] flgEnable
+ *	If true, switch to high-speed mode, otherwise to low-power mode.
+ *
+ ******************************************************************************/
+void	 drvLEUART_HighSpeed (bool flgEnable)
+{
+CMU_ClkDiv_TypeDef div;
+uint32_t	freq;
+
+
+    if (hdlSpeedIdle == NONE)
+	hdlSpeedIdle = sTimerCreate (speedIdleTimeout);
+
+    /* Be sure all data has been sent, then wait for the last stop bits */
+    drvLEUART_sync();
+    while (! (LEUART->STATUS & LEUART_STATUS_TXC))
 	;
+
+    LEUART_Enable(LEUART, leuartDisable);
+
+    if (flgEnable)
+    {
+#if HF_CLOCK_GOVERNOR
+	/* HFCORECLK must not change while it clocks the LEUART */
+	if (! Bit(g_EM1_ModuleMask, EM1_MOD_CONSOLE))
+	    HfClockBoost();
+#endif
+	EM1_Acquire (EM1_MOD_CONSOLE);
+
+	CMU_ClockSelectSet(cmuClock_LFB, cmuSelect_CORELEDIV2);
+	freq = CMU_ClockFreqGet(cmuClock_LFB);
+
+	/* LEUART clock divider allows fLEUART / baud < 129 */
+	for (div = cmuClkDiv_1;  div < cmuClkDiv_8;  div *= 2)
+	    if (freq / div / LEUART_HS_BAUD < 129)
+		break;
+
+	CMU_ClockDivSet(cmuClock_LEUART, div);
+	LEUART_BaudrateSet(LEUART, 0, LEUART_HS_BAUD);
+
+	sTimerStart (hdlSpeedIdle, LEUART_HS_IDLE_TIMEOUT);
+    }
+    else
+    {
+	sTimerCancel (hdlSpeedIdle);
+
+	CMU_ClockSelectSet(cmuClock_LFB, cmuSelect_LFXO);
+	CMU_ClockDivSet(cmuClock_LEUART, cmuClkDiv_1);
+	LEUART_BaudrateSet(LEUART, 0, lowPowerBaud);
+
+#if HF_CLOCK_GOVERNOR
+	if (Bit(g_EM1_ModuleMask, EM1_MOD_CONSOLE))
+	    HfClockRelease();
+#endif
+	EM1_Release (EM1_MOD_CONSOLE);
+    }
+
+    LEUART_Enable(LEUART, leuartInit.enable);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Check the Idle Timeout of the High-Speed Mode
+ *
+ * This routine is called by CheckCommand().  If the idle timeout of the
+ * high-speed mode has elapsed, it switches back to low-power mode.
+ *
+ ******************************************************************************/
+void	 drvLEUART_SpeedCheck (void)
+{
+    if (! flgSpeedIdle)
+	return;
+
+    flgSpeedIdle = false;
+
+    if (Bit(g_EM1_ModuleMask, EM1_MOD_CONSOLE))
+	drvLEUART_HighSpeed (false);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Idle Timeout of the High-Speed Mode
+ *
+ * This routine is called by the RTC interrupt handler, when no command line
+ * has been received for @ref LEUART_HS_IDLE_TIMEOUT seconds.  The speed is
+ * switched in the main loop, see drvLEUART_SpeedCheck().
+ *
+ ******************************************************************************/
+static void	speedIdleTimeout (TIM_HDL hdl)
+{
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    flgSpeedIdle = true;
+    EVENT_POST(EVT_COMMAND);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Free space in the transmit FIFO
+ *
+ * @return
+ *	Number of bytes which can be written into the transmit FIFO.
+ *
+ ******************************************************************************/
+int	 drvLEUART_free (void)
+{
+int16_t	used;			// used buffer space in number of bytes
+
+
+    used  = txIdxPut;
+    used -= txIdxGet;
+    if (used < 0)
+	used += sizeof(txFIFO);
+
+    return (int)sizeof(txFIFO) - 2 - used;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief  Number of discarded Strings
+ *
+ * @return
+ *	Number of strings which have been discarded by drvLEUART_puts(),
+ *	because there was not enough space in the transmit FIFO.
+ *
+ ******************************************************************************/
+uint32_t drvLEUART_dropCount (void)
+{
+    return txDropCnt;
 }
 
@@ -5,6 +5,12 @@
  * @version	2018-03-19
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Added prototype for drvLEUART_CmdLineGet().
+2026-10-14,agnt	Added LEUART_HS_BAUD, LEUART_HS_IDLE_TIMEOUT, drvLEUART_HighSpeed(),
+		and drvLEUART_SpeedCheck().
+2026-10-14,agnt	Added drvLEUART_putsWait(), drvLEUART_free(), and
+		drvLEUART_dropCount().
+2026-10-14,agnt	Added g_CmdLineLen and drvLEUART_write().
 2018-03-19,rage	Added prototype for drvLEUART_sync().
 2015-02-03,rage	Initial version.
 */
@@ -26,25 +32,59 @@ Revision History:
     /*! Switch to enable the receive part of the driver */
 #define ENABLE_LEUART_RECEIVER	1
 
+    /*! Baudrate of the high-speed mode, see drvLEUART_HighSpeed() */
+#ifndef LEUART_HS_BAUD
+    #define LEUART_HS_BAUD	115200
+#endif
+
+    /*! Duration in [s] without a command line, after which the high-speed
+     * mode falls back to the normal baudrate.
+     */
+#ifndef LEUART_HS_IDLE_TIMEOUT
+    #define LEUART_HS_IDLE_TIMEOUT	600
+#endif
+
 /*================================ Global Data ===============================*/
 
 extern volatile bool	g_flgLEUART_LF2CRLF;
 extern volatile bool	g_flgCmdLine;
 extern char		g_CmdLine[];
+extern volatile int	g_CmdLineLen;
 
 /*================================ Prototypes ================================*/
 
 /* Initialize Low Energy UART */
 void	 drvLEUART_Init (uint32_t baud);
 
-/* Put string into transmit FIFO */
+/* Put string into transmit FIFO, discard it if there is no space */
 void	 drvLEUART_puts (const char *pStr);
 
+/* Put string into transmit FIFO, wait in EM1 if there is no space */
+void	 drvLEUART_putsWait (const char *pStr);
+
+/* Put binary data into transmit FIFO, all or nothing */
+bool	 drvLEUART_write (const uint8_t *pBuf, int cnt);
+
 /* Put character into transmit FIFO */
 void	 drvLEUART_putc (char c);
 
 /* Wait until transmit FIFO is empty */
 void	 drvLEUART_sync(void);
 
+/* Switch between high-speed (EM1) and low-power (EM2) mode */
+void	 drvLEUART_HighSpeed (bool flgEnable);
+
+/* Fall back to low-power mode after the idle timeout */
+void	 drvLEUART_SpeedCheck (void);
+
+/* Get the number of free bytes in the transmit FIFO */
+int	 drvLEUART_free (void);
+
+/* Get the number of strings discarded because the FIFO was full */
+uint32_t drvLEUART_dropCount (void);
+
+/* Fetch the next command line from the receive ring into g_CmdLine */
+bool	 drvLEUART_CmdLineGet (void);
+
 
 #endif /* __INC_LEUART_h */
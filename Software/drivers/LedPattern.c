@@ -0,0 +1,246 @@
+/***************************************************************************//**
+ * @file
+ * @brief	LED Pattern Engine
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module drives the LEDs of the board.  An LED is either switched on or
+ * off by LedSet(), or it shows an @ref LED_PATTERN, which is started by
+ * LedPatternStart().  Each LED has its own msTimer.  Consecutive steps with
+ * the same state are combined into one timer period, so the CPU is only
+ * woken up when the LED changes, and the system remains in EM2 in between.
+ *
+ * The LEDs are connected to PA2 and PA5.  These pins can neither be driven
+ * by the LETIMER, nor by a TIMER, and the EFM32G cannot route PRS channels
+ * to pins.  This is why the RTC based msTimers are used.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_device.h"
+#include "em_assert.h"
+#include "em_gpio.h"
+#include "em_int.h"
+#include "AlarmClock.h"
+#include "LedPattern.h"
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief GPIO pin of an LED. */
+typedef struct
+{
+    GPIO_Port_TypeDef	Port;	//!< GPIO port
+    uint8_t		Pin;	//!< pin number
+} LED_PIN;
+
+    /*!@brief State of an LED. */
+typedef struct
+{
+    const LED_PATTERN *pPattern;	//!< running pattern, NULL if none
+    TIM_HDL	       hdl;		//!< msTimer for the steps
+    uint8_t	       Step;		//!< next step of the pattern
+    uint8_t	       Remain;		//!< remaining repetitions
+} LED_STATE;
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Pins of the LEDs - keep in sync with enum @ref LED_ID! */
+static const LED_PIN l_LedPin[NUM_LED] =
+{
+    { POWER_LED_PORT,		POWER_LED_PIN		},
+    { LOG_FLUSH_LED_PORT,	LOG_FLUSH_LED_PIN	},
+};
+
+    /*!@brief State of the LEDs. */
+static LED_STATE l_Led[NUM_LED] =
+{
+    { NULL, NONE, 0, 0 },
+    { NULL, NONE, 0, 0 },
+};
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	LedStep (TIM_HDL hdl);
+static void	LedRun (LED_ID led);
+static void	LedOutput (LED_ID led, bool on);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the LED Pattern Engine
+ *
+ * This routine must be called once after AlarmClockInit().  It allocates
+ * the msTimers of the LEDs.  The pins have already been configured as
+ * outputs by main().
+ *
+ ******************************************************************************/
+void	LedInit (void)
+{
+int	i;
+
+    for (i = 0;  i < NUM_LED;  i++)
+	if (l_Led[i].hdl == NONE)
+	    l_Led[i].hdl = msTimerCreate (LedStep);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Switch an LED on or off
+ *
+ * A running pattern of this LED is stopped.  The routine may be called from
+ * interrupt context.
+ *
+ * @param[in] led
+ *	LED to be switched.
+ *
+ * @param[in] on
+ *	The value <i>true</i> to switch the LED on.
+ *
+ ******************************************************************************/
+void	LedSet (LED_ID led, bool on)
+{
+    INT_Disable();
+
+    if (l_Led[led].pPattern != NULL)
+    {
+	l_Led[led].pPattern = NULL;
+	msTimerCancel (l_Led[led].hdl);
+    }
+    LedOutput (led, on);
+
+    INT_Enable();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start an LED Pattern
+ *
+ * The pattern replaces the current state of the LED.  It runs in the
+ * background, use LedIsBusy() to see if it is done.  If LedInit() has not
+ * been called, the LED is just switched off.
+ *
+ * @param[in] led
+ *	LED to show the pattern.
+ *
+ * @param[in] pPattern
+ *	Address of the pattern.  It must be valid until the pattern is done.
+ *
+ ******************************************************************************/
+void	LedPatternStart (LED_ID led, const LED_PATTERN *pPattern)
+{
+    /* Parameter check */
+    EFM_ASSERT(pPattern != NULL  &&  pPattern->Steps >= 1
+	       &&  pPattern->Steps <= 32);
+
+    INT_Disable();
+
+    if (l_Led[led].hdl == NONE)
+    {
+	LedOutput (led, false);
+    }
+    else
+    {
+	l_Led[led].pPattern = pPattern;
+	l_Led[led].Step   = 0;
+	l_Led[led].Remain = pPattern->Repeat;
+	LedRun (led);
+    }
+
+    INT_Enable();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if an LED Pattern is running
+ *
+ * @param[in] led
+ *	LED to check.
+ *
+ * @return
+ * 	The value <i>true</i> if a pattern is running on this LED.
+ *
+ ******************************************************************************/
+bool	LedIsBusy (LED_ID led)
+{
+    return l_Led[led].pPattern != NULL;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	LED Step Timer
+ *
+ * This routine is called from the RTC interrupt handler when the current
+ * state of an LED is over.
+ *
+ ******************************************************************************/
+static void	LedStep (TIM_HDL hdl)
+{
+int	i;
+
+    for (i = 0;  i < NUM_LED;  i++)
+    {
+	if (l_Led[i].hdl == hdl  &&  l_Led[i].pPattern != NULL)
+	    LedRun ((LED_ID)i);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Execute the next Steps of a Pattern
+ *
+ * The LED is set to the state of the next step.  All following steps with
+ * the same state are combined, then the msTimer is started for this period.
+ * After the last repetition, the LED is switched off.
+ *
+ ******************************************************************************/
+static void	LedRun (LED_ID led)
+{
+LED_STATE	  *pLed = &l_Led[led];
+const LED_PATTERN *pPat = pLed->pPattern;
+bool	on;
+int	n;
+
+    if (pLed->Step >= pPat->Steps)
+    {
+	pLed->Step = 0;
+	if (pPat->Repeat > 0  &&  --pLed->Remain == 0)
+	{
+	    pLed->pPattern = NULL;
+	    LedOutput (led, false);
+	    return;
+	}
+    }
+
+    on = (pPat->Bits >> pLed->Step) & 1;
+    LedOutput (led, on);
+
+    for (n = 1;  pLed->Step + n < pPat->Steps;  n++)
+	if (((pPat->Bits >> (pLed->Step + n)) & 1) != on)
+	    break;
+
+    pLed->Step += n;
+    msTimerStart (pLed->hdl, n * pPat->StepTime);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set the Output of an LED
+ *
+ ******************************************************************************/
+static void	LedOutput (LED_ID led, bool on)
+{
+    if (on)
+	GPIO_PinOutSet   (l_LedPin[led].Port, l_LedPin[led].Pin);
+    else
+	GPIO_PinOutClear (l_LedPin[led].Port, l_LedPin[led].Pin);
+}
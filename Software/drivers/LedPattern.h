@@ -0,0 +1,68 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module LedPattern.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_LedPattern_h
+#define __INC_LedPattern_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief LEDs of the board - keep in sync with @ref l_LedPin! */
+typedef enum
+{
+    LED_POWER,		//!< red Power-On LED, also error and DCF77 indicator
+    LED_LOG_FLUSH,	//!< green Log Flush LED
+    NUM_LED
+} LED_ID;
+
+/*!@brief LED Pattern.
+ *
+ * A pattern consists of up to 32 steps of the same duration.  Bit n of
+ * <b>Bits</b> is the state of the LED in step n, the steps are executed
+ * starting with bit 0.  The LED is off after the last repetition.
+ *
+ * <b>Typical Example:</b> 3 flashes of 100ms, separated by 100ms
+ * @code
+ * static const LED_PATTERN l_Flash3 =
+ * { //	Bits,	Steps,	Repeat,	StepTime
+ *	0x01,	2,	3,	100
+ * };
+ * @endcode
+ */
+typedef struct
+{
+    uint32_t	Bits;		//!< state of the LED per step, bit 0 first
+    uint8_t	Steps;		//!< number of steps, 1 to 32
+    uint8_t	Repeat;		//!< number of repetitions, 0 is endless
+    uint16_t	StepTime;	//!< duration of a step [ms]
+} LED_PATTERN;
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize the LED pattern engine */
+void	LedInit (void);
+
+    /* Switch an LED on or off, this stops a running pattern */
+void	LedSet (LED_ID led, bool on);
+
+    /* Start a pattern, it must be valid until it is done */
+void	LedPatternStart (LED_ID led, const LED_PATTERN *pPattern);
+
+    /* Check if a pattern is running */
+bool	LedIsBusy (LED_ID led);
+
+
+#endif /* __INC_LedPattern_h */
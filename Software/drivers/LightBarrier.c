@@ -2,14 +2,89 @@
  * @file
  * @brief	Light Barrier Logic
  * @author	Ralf Gerhauser
- * @version	2017-01-27
+ * @version	2026-10-15
  *
  * This module receives the interrupts from the light barrier logic and
  * triggers the associated actions.  It contains an initialization routine
  * to set up the GPIOs, and an interrupt handler which processes the events.
+ * Instead of logging every edge, the edges and the active time of each light
+ * barrier are summarized for an interval of @ref g_LB_SummaryInterval seconds,
+ * see LB_Summary().  Optionally, the edges are counted by the Pulse Counters
+ * without any interrupts, see @ref LB_USE_PCNT.
+ *
+ * If @ref LB_TIMELINE is set, each change of the light barrier states is
+ * recorded by LB_TimelinePut() into a ring buffer, which LB_TimelineFlush()
+ * appends to @ref LB_TIMELINE_FILE_NAME along with the log.  An entry is
+ * either a delta entry, or a sync entry:
+ * - Delta entry: The value <i>((ticks << 2) | state) + 1</i> as unsigned
+ *   LEB128, i.e. 7 bits per byte, least significant first, bit 7 set if
+ *   another byte follows.  <i>ticks</i> is the number of RTC ticks since the
+ *   previous entry, <i>state</i> has bit 0 set if LB1 is active, and bit 1
+ *   if LB2 is active.  A change within 4ms takes 1 byte, within 0.5s 2 bytes,
+ *   and within 64s 3 bytes.
+ * - Sync entry: A byte 0x00, followed by the time in seconds as returned by
+ *   time() (4 bytes), the sub-seconds in RTC ticks (2 bytes), both little
+ *   endian, and the state (1 byte).  It is written for the first change
+ *   after @ref LB_TIMELINE_SYNC seconds, and after entries have been lost
+ *   because the ring buffer was full.
+ *
+ * With @ref LB_USE_PCNT, the edges which are counted by the PCNT are not
+ * part of the timeline.
+ *
+ * The light barrier filter runs on an msTimer.  Each light barrier may have
+ * its own filter duration in milliseconds, see @ref g_LB_FilterMs, otherwise
+ * @ref g_LB_FilterDuration applies.  When the last light barrier becomes
+ * inactive, the filter expires after the longest remaining duration of the
+ * light barriers that were active during the visit.  Optionally, a new state
+ * must be stable for @ref g_LB_DebounceOn or @ref g_LB_DebounceOff
+ * milliseconds before it is applied, see LB_DebounceExpired().  Debouncing
+ * affects the power control and the visit only, the summary and the timeline
+ * still contain every edge.
+ *
+ * If @ref LB_TRANSIT is set, the debounced states of both light barriers are
+ * fed into a small state machine, see LB_Transit().  It classifies each
+ * transit from the order of the light barriers, and logs it as entry, exit,
+ * or aborted transit.  Its times are those of the edges, i.e. of the EXTI
+ * capture, not of the deferred handler.
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Removed the latency stamp of the first active light barrier.
+2026-10-15,agnt	LB_Transit() only reports an aborted transit if the second
+		light barrier has been reached within LB_TRANSIT_GAP_MS, a
+		perch visit at one light barrier is not logged as transit.
+2026-10-15,agnt	LB_Update() emits ITM trace records of the activity mask and the
+		transit state, see ITM_TRACE.
+2026-10-15,agnt	Direction of a transit, see LB_TRANSIT and LB_Transit().
+2026-10-15,agnt	LB_TimelinePut: The sub-seconds of a sync entry consider the
+		tick offset of the time base, see ClockAdjust().
+2026-10-15,agnt	Post EVT_WAKE instead of setting g_flgIRQ.
+2026-10-15,agnt	The PCNT clocks are acquired via ClockMgr.c.
+2026-10-15,agnt	LB_Update calls RFID_LB_Edge() for the duty cycling of the RFID
+		reader.
+2026-10-15,agnt	Light barrier filter with millisecond resolution and per light
+		barrier durations, optional debouncing, see LB_Update().
+2026-10-15,agnt	The occupancy timeline is an output stream of the logging
+		module, see LogStreamRegister().  It shares the file handle of
+		all streams, and LB_TimelinePut() requests a flush when the
+		ring buffer is three quarters full.
+2026-10-15,agnt	Optional occupancy timeline, see LB_TIMELINE.
+2026-10-15,agnt	The edges of a visit are counted for its record, see
+		VISIT_RECORDS.
+2026-10-15,agnt	LB_Handler and InitiatePowerOff report the active time of the
+		light barriers and the end of a visit, see VISIT_STATS.
+2026-10-15,agnt	Use StrFormat() instead of sprintf().
+2026-10-14,agnt	LB_Handler: The first and the last active light barrier trigger
+		AudioCheck() via EVENT_POST(EVT_AUDIO), as its idle timer
+		depends on them.
+2026-10-14,agnt	LB_Handler: The first edge of a visit also calls
+		AudioPreRollRequest().
+2026-10-14,agnt	LB_Handler: The first edge of a visit calls AudioWake().
+2026-10-14,agnt	InitiatePowerOff: Calls RFID_LB_Idle(), see RFID_LB_POWER.
+2026-10-14,agnt	LB_Handler: Activation is stamped for the latency trace.
+2026-10-14,agnt	LB_Handler: Edges are logged as debug messages, see LOG_LEVEL_LB.
+		Edges are counted and logged as summary, see LB_Summary().
+		Optional pulse counter mode, see LB_USE_PCNT.
 2017-01-27,rage	Initialize LB2 only if LB2_ENABLE is set.
 2016-04-05,rage	Made variable <g_LB_ActiveMask> of type "volatile".
 2014-11-26,rage	Initial version.
@@ -17,13 +92,22 @@ Revision History:
 
 /*=============================== Header Files ===============================*/
 
+#include <time.h>
 #include "em_cmu.h"
+#include "em_int.h"
+#include "em_pcnt.h"
 #include "LightBarrier.h"
+#include "ExtInt.h"
+#include "ItmTrace.h"
 #include "PowerFail.h"
 #include "AlarmClock.h"
 #include "RFID.h"
+#include "Audio.h"
 #include "Logging.h"
 #include "Control.h"
+#include "VisitStats.h"
+#include "StrFormat.h"
+#include "ClockMgr.h"
 
 /*=============================== Definitions ================================*/
 
@@ -36,6 +120,57 @@ Revision History:
     #define DBG_PUTS(str)
 #endif
 
+    // Module Log Level
+#ifndef LOG_LEVEL_LB
+    #define LOG_LEVEL_LB	LOG_LEVEL
+#endif
+#undef  LOG_MODULE_LEVEL
+#define LOG_MODULE_LEVEL	LOG_LEVEL_LB
+
+/*!@brief Statistics of one light barrier for the summary. */
+typedef struct
+{
+    uint32_t	EdgeCnt;	//!< Number of edges in the current interval
+    uint32_t	ActiveTicks;	//!< RTC ticks the light barrier was active
+    uint32_t	ActiveStart;	//!< RTC counter when it became active
+    bool	flgActive;	//!< Light barrier is currently active
+} LB_STAT;
+
+#if LB_USE_PCNT
+/*!@brief Pulse counter assignment of a light barrier. */
+typedef struct
+{
+    PCNT_TypeDef	*pPCNT;		//!< Pulse counter
+    CMU_Clock_TypeDef	 Clock;		//!< Clock of the pulse counter
+    uint32_t		 Location;	//!< Location of the S0IN pin
+    GPIO_Port_TypeDef	 Port;		//!< GPIO port of the S0IN pin
+    int			 Pin;		//!< Pin number, also the EXTI number
+} LB_PCNT_DEF;
+
+    /*! The counters have 8 bits only */
+#define LB_PCNT_TOP	0xFF
+#endif
+
+#if LB_TIMELINE
+    /*! Maximum size of a timeline entry, i.e. of a sync entry */
+#define LB_TL_ENTRY_MAX	8
+#endif
+
+#if LB_TRANSIT
+/*!@brief States of the transit detection, see LB_Transit(). */
+typedef enum
+{
+    LB_TR_IDLE,		//!< no light barrier is active
+    LB_TR_FIRST,	//!< only the first light barrier has been active
+    LB_TR_BOTH,		//!< both light barriers have been active
+    LB_TR_UNKNOWN,	//!< state has been replayed, wait until all inactive
+} LB_TR_STATE;
+#endif
+
+    /*! Convert RTC ticks into milliseconds without 32bit overflow */
+#define LB_TICKS2MS(t)	((t) / RTC_COUNTS_PER_SEC * 1000		\
+			 + (t) % RTC_COUNTS_PER_SEC * 1000 / RTC_COUNTS_PER_SEC)
+
 /*========================= Global Data and Routines =========================*/
 
     /*!@brief Bit mask what Light Barriers are active. */
@@ -45,6 +180,18 @@ volatile uint32_t  g_LB_ActiveMask;
               g_LB_FilterDuration = 0 (0=inactive). */
 uint32_t  g_LB_FilterDuration;
 
+    /*!@brief Filter duration of each light barrier in milliseconds, 0 uses
+              @ref g_LB_FilterDuration. */
+int32_t   g_LB_FilterMs[LB_NUM];
+
+    /*!@brief Milliseconds a light barrier must be active, or inactive,
+              before the new state is applied, 0 applies it immediately. */
+int32_t   g_LB_DebounceOn, g_LB_DebounceOff;
+
+    /*!@brief Interval in seconds for the summary of light barrier edges,
+              0 logs no summary. */
+int32_t   g_LB_SummaryInterval = DFLT_LB_SUMMARY_INTERVAL;
+
 /*================================ Local Data ================================*/
 
     /*!@brief Timer handle for the light barrier filter. */
@@ -53,9 +200,112 @@ static volatile TIM_HDL	l_hdlLB_Filter = NONE;
     /*!@brief State of the light barrier filter output. */
 static volatile bool	l_LB_FilterOutput;
 
+    /*!@brief Light barriers which were active since the filter expired. */
+static uint32_t		l_LB_VisitMask;
+
+    /*!@brief RTC counter when each light barrier became inactive. */
+static uint32_t		l_LB_OffStamp[LB_NUM];
+
+    /*!@brief msTimer handles to debounce each light barrier. */
+static volatile TIM_HDL	l_hdlLB_Debounce[LB_NUM] = { NONE,
+#if LB2_ENABLE
+							     NONE
+#endif
+							   };
+
+    /*!@brief Level and time stamp of the last edge during debouncing. */
+static bool		l_LB_PendingLvl[LB_NUM];
+static uint32_t		l_LB_PendingStamp[LB_NUM];
+
+    /*!@brief Timer handle for the summary interval. */
+static volatile TIM_HDL	l_hdlLB_Summary = NONE;
+
+    /*!@brief Duration in seconds of the current summary interval, 0 if no
+     * interval is running.
+     */
+static int32_t		l_LB_SummaryIntvl;
+
+    /*!@brief Statistics for the summary of each light barrier. */
+static LB_STAT		l_LB_Stat[LB_NUM];
+
+#if LB_USE_PCNT
+    /*!@brief Pulse counters of the light barriers. */
+static const LB_PCNT_DEF l_LB_PCNT_Def[LB_NUM] =
+{   //  pPCNT      Clock           Location      Port      Pin
+    { LB1_PCNT, LB1_PCNT_CLOCK, LB1_PCNT_LOC, LB1_PORT, LB1_PIN },
+#if LB2_ENABLE
+    { LB2_PCNT, LB2_PCNT_CLOCK, LB2_PCNT_LOC, LB2_PORT, LB2_PIN },
+#endif
+};
+
+    /*!@brief Timer handle to check the light barriers counted by the PCNT. */
+static volatile TIM_HDL	l_hdlLB_Poll = NONE;
+
+    /*!@brief Light barrier is counted by the PCNT, its EXTI is disabled. */
+static bool		l_flgLB_Hold[LB_NUM];
+
+    /*!@brief PCNT value when the EXTI has been disabled, and at the last poll.
+     * The PCNT counts rising edges, i.e. when a light barrier gets inactive.
+     */
+static uint8_t		l_LB_PCNT_Base[LB_NUM], l_LB_PCNT_Last[LB_NUM];
+#endif
+
+#if LB_TIMELINE
+    /*!@brief Ring buffer of the occupancy timeline, see LB_TimelinePut(). */
+static uint8_t		l_LB_TL[LB_TIMELINE_SIZE];
+static volatile int	l_LB_TL_Put, l_LB_TL_Get;
+
+    /*!@brief RTC counter and time in seconds of the last entry. */
+static uint32_t		l_LB_TL_Stamp, l_LB_TL_Sec;
+
+    /*!@brief Bit mask of the light barriers, before debouncing. */
+static uint32_t		l_LB_TL_Mask;
+
+    /*!@brief The next entry must be a sync entry. */
+static bool		l_flgLB_TL_Sync = true;
+
+    /*!@brief Number of entries lost because the ring buffer was full. */
+static volatile uint32_t l_LB_TL_Lost;
+
+    /*!@brief Output stream of the timeline, see LogStreamRegister(). */
+static const LOG_STREAM	l_LB_TL_Stream =
+{
+    "LB", LB_TIMELINE_FILE_NAME, LB_TimelineFlush
+};
+#endif
+
+#if LB_TRANSIT
+    /*!@brief State of the transit detection. */
+static LB_TR_STATE	l_LB_TrState;
+
+    /*!@brief Index of the light barrier which has been active first. */
+static int		l_LB_TrFirst;
+
+    /*!@brief RTC counter when the first and the second light barrier
+     * became active.
+     */
+static uint32_t		l_LB_TrStart, l_LB_TrCross;
+#endif
+
 /*=========================== Forward Declarations ===========================*/
 
+static void LB_Update(int extiNum, bool extiLvl, uint32_t timeStamp);
+static void LB_DebounceExpired(TIM_HDL hdl);
+static uint32_t LB_FilterRemain(uint32_t now);
 static void InitiatePowerOff(void);
+static void LB_CountEdge(int idx, bool extiLvl, uint32_t timeStamp);
+static void LB_Summary(TIM_HDL hdl);
+#if LB_USE_PCNT
+static void LB_PCNT_Hold(int idx);
+static void LB_PCNT_Release(int idx);
+static void LB_PCNT_Poll(TIM_HDL hdl);
+#endif
+#if LB_TIMELINE
+static void LB_TimelinePut(uint32_t timeStamp);
+#endif
+#if LB_TRANSIT
+static void LB_Transit(int idx, uint32_t timeStamp);
+#endif
 
 
 /***************************************************************************//**
@@ -69,6 +319,11 @@ static void InitiatePowerOff(void);
  ******************************************************************************/
 void	LB_Init (void)
 {
+#if LB_USE_PCNT
+PCNT_Init_TypeDef pcntInit = PCNT_INIT_DEFAULT;
+#endif
+int	i;
+
     /* Be sure to enable clock to GPIO (should already be done) */
     CMU_ClockEnable (cmuClock_GPIO, true);
 
@@ -88,7 +343,42 @@ void	LB_Init (void)
 
     /* Get a timer handle for the light barrier filter */
     if (l_hdlLB_Filter == NONE)
-	l_hdlLB_Filter = sTimerCreate ((TIMER_FCT)InitiatePowerOff);
+	l_hdlLB_Filter = msTimerCreate ((TIMER_FCT)InitiatePowerOff);
+
+    /* Get timer handles to debounce the light barriers */
+    for (i = 0;  i < LB_NUM;  i++)
+	if (l_hdlLB_Debounce[i] == NONE)
+	    l_hdlLB_Debounce[i] = msTimerCreate (LB_DebounceExpired);
+
+    /* Get a timer handle for the summary interval */
+    if (l_hdlLB_Summary == NONE)
+	l_hdlLB_Summary = sTimerCreate (LB_Summary);
+
+#if LB_USE_PCNT
+    /*
+     * Configure the pulse counters to count rising edges of their S0IN pin.
+     * Oversampling mode uses LFACLK and enables the filter.
+     */
+    pcntInit.mode   = pcntModeOvsSingle;
+    pcntInit.top    = LB_PCNT_TOP;
+    pcntInit.filter = true;
+
+    for (i = 0;  i < LB_NUM;  i++)
+    {
+	ClockAcquire (CLK_OWN_LB, l_LB_PCNT_Def[i].Clock);
+	PCNT_Init (l_LB_PCNT_Def[i].pPCNT, &pcntInit);
+	l_LB_PCNT_Def[i].pPCNT->ROUTE = l_LB_PCNT_Def[i].Location;
+    }
+
+    /* Get a timer handle to check the light barriers */
+    if (l_hdlLB_Poll == NONE)
+	l_hdlLB_Poll = sTimerCreate (LB_PCNT_Poll);
+#endif
+
+#if LB_TIMELINE
+    /* The timeline is written along with the log file */
+    LogStreamRegister (&l_LB_TL_Stream);
+#endif
 }
 
 
@@ -97,10 +387,8 @@ void	LB_Init (void)
  * @brief	Light Barrier handler
  *
  * This handler is called by the EXTI interrupt service routine whenever the
- * state of a light barrier changes.  It controls the power state of the RFID
- * reader and the state of the AUDIO module,
- * i.e. this is enabled as long as a minimum of one light barrier
- * indicates an object.
+ * state of a light barrier changes.  It counts the edge, and applies the new
+ * state via LB_Update(), immediately or after debouncing.
  *
  * @param[in] extiNum
  *	EXTernal Interrupt number of a light barrier.  This is identical with
@@ -113,15 +401,119 @@ void	LB_Init (void)
  *	state, level 0 indicates an object.
  *
  * @param[in] timeStamp
- *	Time stamp when the event has been received.  This parameter is not
- *	used here.
+ *	Time stamp when the event has been received, 0 if the state is replayed
+ *	by ExtIntReplay().  Replayed states are applied without
+ *	debouncing.
  *
  ******************************************************************************/
 void	LB_Handler (int extiNum, bool extiLvl, uint32_t timeStamp)
 {
+int	idx = (extiNum == LB1_PIN ? 0 : 1);	// index of the light barrier
+int32_t	debounce;
+
+    /* Generate Log Message, count the edge for the summary */
+    if (timeStamp != 0)
+    {
+	LOG_DBG ("LB%c:%s", extiNum == LB1_PIN ? '1':'2',
+			    extiLvl == 0 ? "ON":"off");
+
+	LB_CountEdge (idx, extiLvl, timeStamp);
+#if LB_TIMELINE
+	Bit(l_LB_TL_Mask, extiNum) = ! extiLvl;
+	LB_TimelinePut (timeStamp);
+#endif
+
+#if LB_USE_PCNT
+	/* further edges are counted by the PCNT */
+	if (extiLvl == 0)
+	    LB_PCNT_Hold (idx);
+	else
+	    l_flgLB_Hold[idx] = false;	// EXTI enabled
+#endif
+    }
+
+    /*
+     * If a debounce time is specified for the new state, (re-)start the
+     * timer, the state is applied by LB_DebounceExpired() when it has been
+     * stable for this time.  Otherwise apply it now.
+     */
+    debounce = (extiLvl == 0 ? g_LB_DebounceOn : g_LB_DebounceOff);
+
+    if (l_hdlLB_Debounce[idx] != NONE)
+    {
+	if (debounce > 0  &&  timeStamp != 0)
+	{
+	    l_LB_PendingLvl[idx] = extiLvl;
+	    l_LB_PendingStamp[idx] = timeStamp;
+	    msTimerStart (l_hdlLB_Debounce[idx], debounce);
+
+	    EVENT_POST(EVT_WAKE);	// keep on running
+	    return;
+	}
+
+	msTimerCancel (l_hdlLB_Debounce[idx]);
+    }
+
+    LB_Update (extiNum, extiLvl, timeStamp);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Debounce time of a light barrier is over
+ *
+ * This routine is called by the msTimer when the state of a light barrier
+ * has been stable for @ref g_LB_DebounceOn or @ref g_LB_DebounceOff
+ * milliseconds.  It applies the state of the last edge, if it differs from
+ * the current one.
+ *
+ * @param[in] hdl
+ *	Timer handle, identifies the light barrier.
+ *
+ ******************************************************************************/
+static void LB_DebounceExpired(TIM_HDL hdl)
+{
+int	extiNum;
+int	idx;
+
+    for (idx = 0;  idx < LB_NUM;  idx++)
+	if (l_hdlLB_Debounce[idx] == hdl)
+	    break;
+
+    if (idx == LB_NUM)
+	return;
+
+    extiNum = (idx == 0 ? LB1_PIN : LB2_PIN);
+    if (Bit(g_LB_ActiveMask, extiNum) != ! l_LB_PendingLvl[idx])
+	LB_Update (extiNum, l_LB_PendingLvl[idx], l_LB_PendingStamp[idx]);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Apply the state of a light barrier
+ *
+ * This routine is called by LB_Handler(), or after debouncing by
+ * LB_DebounceExpired().  It controls the power state of the RFID reader and
+ * the state of the AUDIO module, i.e. this is enabled as long as a minimum
+ * of one light barrier indicates an object, and for the filter duration
+ * after the last one became inactive.
+ *
+ * @param[in] extiNum
+ *	EXTernal Interrupt number of the light barrier.
+ *
+ * @param[in] extiLvl
+ *	Logic level of the light barrier, 0 indicates an object.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value of the edge, 0 if the state is replayed.
+ *
+ ******************************************************************************/
+static void LB_Update(int extiNum, bool extiLvl, uint32_t timeStamp)
+{
 uint32_t  prevActiveMask;
+uint32_t  remain;		// remaining filter duration in [ms]
 static bool prevPowerFail, prevAudioRfidOn;
 bool	isPowerFail, isAudioRfidOn;
+int	idx = (extiNum == LB1_PIN ? 0 : 1);
 
     /* Save the current state of activity mask before changing it */
     prevActiveMask = g_LB_ActiveMask;
@@ -129,13 +521,37 @@ bool	isPowerFail, isAudioRfidOn;
     /* Set or clear the corresponding bit in the activity mask */
     Bit(g_LB_ActiveMask, extiNum) = ! extiLvl;
 
-    /* Generate Log Message */
-#ifdef LOGGING
-    if (timeStamp != 0)
-    Log ("LB%c:%s", extiNum == LB1_PIN ? '1':'2',
-		    extiLvl == 0 ? "ON":"off");
+    /* Remember the light barriers of this visit for the filter */
+    if (extiLvl == 0)
+	l_LB_VisitMask |= (1UL << idx);
+    else if (Bit(prevActiveMask, extiNum))
+	l_LB_OffStamp[idx] = (timeStamp != 0 ? timeStamp : RTC->CNT);
+
+    /* The reader returns to continuous mode */
+    if (prevActiveMask != g_LB_ActiveMask)
+    {
+	ITM_TRACE_STATE(ITM_MOD_LB, g_LB_ActiveMask);
+	RFID_LB_Edge();
+    }
+
+#if LB_TRANSIT
+    /* The order of the light barriers is the direction of a transit */
+    if (prevActiveMask != g_LB_ActiveMask)
+    {
+	LB_Transit (idx, timeStamp);
+	ITM_TRACE_STATE(ITM_MOD_TRANSIT, l_LB_TrState);
+    }
 #endif
-    
+
+    /* AudioCheck() considers the light barriers being active or not */
+    if ((prevActiveMask == 0) != (g_LB_ActiveMask == 0))
+    {
+	EVENT_POST(EVT_AUDIO);
+#if VISIT_STATS
+	VisitStatsPerch (g_LB_ActiveMask != 0);	// perch time of the visit
+#endif
+    }
+
   /* Get current state of power-fail and feeder */
     isPowerFail = IsPowerFail();
     isAudioRfidOn  = IsAudioRfidOn();
@@ -143,9 +559,9 @@ bool	isPowerFail, isAudioRfidOn;
     
 #if MOD_DEBUG
     char tmpBuf[90];
-    sprintf (tmpBuf, " DBG LB_Handler: prevPowerFail=%d isPowerFail=%d"
-		      " prevAudioRfidOn=%d isAudioRfidOn=%d\n",
-                     prevPowerFail, isPowerFail, prevAudioRfidOn, isAudioRfidOn);                       
+    StrFormat (tmpBuf, " DBG LB_Handler: prevPowerFail=%d isPowerFail=%d"
+			" prevAudioRfidOn=%d isAudioRfidOn=%d\n",
+		       prevPowerFail, isPowerFail, prevAudioRfidOn, isAudioRfidOn);                       
     DBG_PUTS(tmpBuf);
 #endif        
     
@@ -169,6 +585,10 @@ bool	isPowerFail, isAudioRfidOn;
     /* If one or more Light Barriers are active, LB Filter Output is true */
     if (g_LB_ActiveMask)
     {
+	/* The visit goes on, cancel a possibly running filter */
+	if (prevActiveMask == 0  &&  l_hdlLB_Filter != NONE)
+	    msTimerCancel (l_hdlLB_Filter);
+
 	/*
 	 * Check if filter state is already set and for power-fail
       	 * and if is AudioRfid in ON mode
@@ -178,6 +598,8 @@ bool	isPowerFail, isAudioRfidOn;
 	    l_LB_FilterOutput = true;
 	    DBG_PUTS(" DBG LB_Handler: setting l_LB_FilterOutput=1\n");
 	    RFID_Enable();		
+	    AudioWake();
+	    AudioPreRollRequest();
 	}
     }
     else
@@ -189,21 +611,22 @@ bool	isPowerFail, isAudioRfidOn;
 	if (prevActiveMask != 0)
 	{
 	    /*
-	     * LB inactivity happened at this moment.  If LB_FILTER_DURATION
-	     * has been specified, (re-)start the timer.  If not, immediately
-	     * initiate a timed power-off.
+	     * LB inactivity happened at this moment.  If a filter duration
+	     * has been specified, (re-)start the timer with the remaining
+	     * time.  If not, immediately initiate a timed power-off.
 	     */
-	    if (g_LB_FilterDuration > 0)
+	    remain = LB_FilterRemain (l_LB_OffStamp[idx]);
+	    if (remain > 0)
 	    {
 		/* (re-)start timer to switch-off */
 		if (l_hdlLB_Filter != NONE)
-		    sTimerStart (l_hdlLB_Filter, g_LB_FilterDuration);
+		    msTimerStart (l_hdlLB_Filter, remain);
     	    }
 	    else
 	    {
 		/* Cancel possibly running timer */
 		if (l_hdlLB_Filter != NONE)
-		    sTimerCancel (l_hdlLB_Filter);
+		    msTimerCancel (l_hdlLB_Filter);
 
 		/* Immediately initiate a timed power-off */
 		InitiatePowerOff();
@@ -211,7 +634,51 @@ bool	isPowerFail, isAudioRfidOn;
 	}
     }
 
-    g_flgIRQ = true;		// keep on running
+    EVENT_POST(EVT_WAKE);	// keep on running
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Remaining filter duration
+ *
+ * This routine is called by LB_Update() when the last light barrier became
+ * inactive.  The filter duration of each light barrier is counted from the
+ * time it became inactive, the longest remaining one of all light barriers
+ * that were active during the visit applies.
+ *
+ * @param[in] now
+ *	RTC counter value when the last light barrier became inactive.
+ *
+ * @return
+ *	Remaining filter duration in milliseconds, 0 if none.
+ *
+ ******************************************************************************/
+static uint32_t LB_FilterRemain(uint32_t now)
+{
+uint32_t remain = 0;
+uint32_t ms, elapsed;
+int	 i;
+
+    for (i = 0;  i < LB_NUM;  i++)
+    {
+	if ((l_LB_VisitMask & (1UL << i)) == 0)
+	    continue;
+
+	if (g_LB_FilterMs[i] > 0)
+	    ms = (g_LB_FilterMs[i] < LB_FILTER_MS_MAX ? g_LB_FilterMs[i]
+						       : LB_FILTER_MS_MAX);
+	else
+	    ms = g_LB_FilterDuration * 1000;
+
+	/* consider 24bit wrap-around of the RTC counter */
+	elapsed = (now - l_LB_OffStamp[i]) & 0xFFFFFF;
+	elapsed = LB_TICKS2MS(elapsed);
+
+	if (ms > elapsed  &&  ms - elapsed > remain)
+	    remain = ms - elapsed;
+    }
+
+    return remain;
 }
 
 /***************************************************************************//**
@@ -219,13 +686,457 @@ bool	isPowerFail, isAudioRfidOn;
  * @brief	Initiate a timed power-off
  *
  * This routine is called when the light barriers turn to inactive state.
- * If the configuration variable LB_FILTER_DURATION specifies a value of more
- * zero seconds, this happens after this duration, otherwise the routine is
- * called immediately.
+ * If a filter duration has been configured, see LB_FilterRemain(), this
+ * happens after this duration, otherwise the routine is called immediately.
  *
  ******************************************************************************/
 static void InitiatePowerOff(void)
 {
     l_LB_FilterOutput = false;	// clear filter flag
+    l_LB_VisitMask = 0;		// the next edge starts a new visit
     DBG_PUTS(" DBG InitiatePowerOff: setting l_LB_FilterOutput=0\n");
+
+    /* RFID reader may be powered off until the next light barrier edge */
+    RFID_LB_Idle();
+
+#if VISIT_STATS
+    /* The visit is over */
+    VisitStatsPerchEnd();
+#endif
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Count a light barrier edge
+ *
+ * This routine is called by LB_Handler() for every edge of a light barrier.
+ * It updates the statistics for the summary, and starts a new summary
+ * interval, if none is running.
+ *
+ * @param[in] idx
+ *	Index of the light barrier, i.e. 0 for LB1, and 1 for LB2.
+ *
+ * @param[in] extiLvl
+ *	EXTernal Interrupt level: 0 means the light barrier became active.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value when the edge has been received.
+ *
+ ******************************************************************************/
+static void LB_CountEdge(int idx, bool extiLvl, uint32_t timeStamp)
+{
+LB_STAT	*pStat = &l_LB_Stat[idx];
+
+
+    pStat->EdgeCnt++;
+#if VISIT_STATS
+    VisitStatsEdges (idx, 1);
+#endif
+
+    if (extiLvl == 0)
+    {
+	pStat->ActiveStart = timeStamp;
+	pStat->flgActive = true;
+    }
+    else if (pStat->flgActive)
+    {
+	/* consider 24bit wrap-around of the RTC counter */
+	pStat->ActiveTicks += (timeStamp - pStat->ActiveStart) & 0xFFFFFF;
+	pStat->flgActive = false;
+    }
+
+    /* Start a new summary interval */
+    if (l_LB_SummaryIntvl == 0  &&  g_LB_SummaryInterval > 0
+    &&  l_hdlLB_Summary != NONE)
+    {
+	l_LB_SummaryIntvl = g_LB_SummaryInterval;
+	if (l_LB_SummaryIntvl > LB_SUMMARY_INTERVAL_MAX)
+	    l_LB_SummaryIntvl = LB_SUMMARY_INTERVAL_MAX;
+
+	sTimerStart (l_hdlLB_Summary, l_LB_SummaryIntvl);
+    }
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Log the light barrier summary
+ *
+ * This routine is called by the sTimer at the end of a summary interval.
+ * It logs one line for each light barrier with edges or activity, e.g.
+ * "LB1: 37 edges, active 2.3 s in 10 s", and clears the statistics.  If a
+ * light barrier is still active, the next interval starts immediately.
+ * The RTC interrupt has the same priority as the EXTI interrupt, so the
+ * statistics cannot be changed by LB_Handler() in the meantime.
+ *
+ * @param[in] hdl
+ *	Timer handle, not used here.
+ *
+ ******************************************************************************/
+static void LB_Summary(TIM_HDL hdl)
+{
+LB_STAT	*pStat;
+uint32_t now = RTC->CNT;	// current RTC counter value
+uint32_t tenth;			// active time in 1/10s
+bool	 flgActive = false;	// a light barrier is still active
+int	 i;
+
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    for (i = 0;  i < LB_NUM;  i++)
+    {
+	pStat = &l_LB_Stat[i];
+	if (pStat->flgActive)
+	{
+	    pStat->ActiveTicks += (now - pStat->ActiveStart) & 0xFFFFFF;
+	    pStat->ActiveStart = now;
+	    flgActive = true;
+	}
+
+	if (pStat->EdgeCnt > 0  ||  pStat->ActiveTicks > 0)
+	{
+	    tenth = (pStat->ActiveTicks * 10 + RTC_COUNTS_PER_SEC / 2)
+		    / RTC_COUNTS_PER_SEC;
+	    LOG_INFO ("LB%d: %ld edges, active %ld.%ld s in %ld s", i + 1,
+		      pStat->EdgeCnt, tenth / 10, tenth % 10,
+		      l_LB_SummaryIntvl);
+
+	    pStat->EdgeCnt = 0;
+	    pStat->ActiveTicks = 0;
+	}
+    }
+
+    /* Continue if a light barrier is still active */
+    if (flgActive  &&  g_LB_SummaryInterval > 0)
+	sTimerStart (l_hdlLB_Summary, l_LB_SummaryIntvl);
+    else
+	l_LB_SummaryIntvl = 0;
+}
+
+#if LB_USE_PCNT
+/***************************************************************************//**
+ *
+ * @brief	Let the PCNT count a light barrier
+ *
+ * This routine is called by LB_Handler() when a light barrier became active.
+ * It disables the EXTI of the light barrier, i.e. further edges are only
+ * counted by the PCNT, and starts polling its state.
+ *
+ * @param[in] idx
+ *	Index of the light barrier, i.e. 0 for LB1, and 1 for LB2.
+ *
+ ******************************************************************************/
+static void LB_PCNT_Hold(int idx)
+{
+int	i;
+
+    ExtIntDisable (l_LB_PCNT_Def[idx].Pin);
+
+    l_LB_PCNT_Base[idx] = l_LB_PCNT_Last[idx] =
+			PCNT_CounterGet (l_LB_PCNT_Def[idx].pPCNT);
+
+    /* Start polling, if not already running for the other light barrier */
+    for (i = 0;  i < LB_NUM;  i++)
+	if (l_flgLB_Hold[i])
+	    break;
+
+    l_flgLB_Hold[idx] = true;
+
+    if (i == LB_NUM  &&  l_hdlLB_Poll != NONE)
+	sTimerStart (l_hdlLB_Poll, LB_PCNT_POLL_INTERVAL);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Release a light barrier from the PCNT
+ *
+ * This routine is called by LB_PCNT_Poll() when a light barrier has been
+ * inactive for the poll interval.  The edges that have been counted by the
+ * PCNT are added to the summary, then LB_Handler() is called for the
+ * inactive state, and the EXTI is enabled again.
+ *
+ * @param[in] idx
+ *	Index of the light barrier, i.e. 0 for LB1, and 1 for LB2.
+ *
+ ******************************************************************************/
+static void LB_PCNT_Release(int idx)
+{
+const LB_PCNT_DEF *pDef = &l_LB_PCNT_Def[idx];
+int	cnt;		// rising edges, the last one is reported to LB_Handler()
+
+    l_flgLB_Hold[idx] = false;
+
+    cnt = (l_LB_PCNT_Last[idx] - l_LB_PCNT_Base[idx]) & LB_PCNT_TOP;
+    if (cnt > 1)
+    {
+	l_LB_Stat[idx].EdgeCnt += 2 * (cnt - 1);
+#if VISIT_STATS
+	VisitStatsEdges (idx, 2 * (cnt - 1));
+#endif
+    }
+
+    LB_Handler (pDef->Pin, 1, RTC->CNT);
+
+    ExtIntEnable (pDef->Pin);
+
+    /* The light barrier may have become active again in the meantime */
+    if (GPIO_PinInGet (pDef->Port, pDef->Pin) == 0)
+	LB_Handler (pDef->Pin, 0, RTC->CNT);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Poll the light barriers counted by the PCNT
+ *
+ * This routine is called by the sTimer every @ref LB_PCNT_POLL_INTERVAL
+ * seconds, as long as a light barrier is counted by the PCNT.  If the light
+ * barrier is inactive now, and the PCNT did not count any rising edge since
+ * the last poll, it is inactive for the whole interval.  Then it is released
+ * via LB_PCNT_Release().  The software filter @ref g_LB_FilterDuration starts
+ * at this time.
+ *
+ * @param[in] hdl
+ *	Timer handle, not used here.
+ *
+ ******************************************************************************/
+static void LB_PCNT_Poll(TIM_HDL hdl)
+{
+uint8_t	cnt;		// current counter value
+bool	flgHold = false;	// a light barrier is still counted by the PCNT
+int	i;
+
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    for (i = 0;  i < LB_NUM;  i++)
+    {
+	if (! l_flgLB_Hold[i])
+	    continue;
+
+	cnt = PCNT_CounterGet (l_LB_PCNT_Def[i].pPCNT);
+
+	if (GPIO_PinInGet (l_LB_PCNT_Def[i].Port, l_LB_PCNT_Def[i].Pin) != 0
+	&&  cnt == l_LB_PCNT_Last[i]  &&  cnt != l_LB_PCNT_Base[i])
+	{
+	    LB_PCNT_Release (i);
+	}
+	else
+	{
+	    l_LB_PCNT_Last[i] = cnt;
+	}
+
+	if (l_flgLB_Hold[i])
+	    flgHold = true;
+    }
+
+    if (flgHold)
+	sTimerStart (l_hdlLB_Poll, LB_PCNT_POLL_INTERVAL);
 }
+#endif
+
+#if LB_TIMELINE
+/***************************************************************************//**
+ *
+ * @brief	Append the occupancy timeline to its file
+ *
+ * This routine is called by LogFlush() while the SD-Card is acquired.  It
+ * appends the entries of the ring buffer to @ref LB_TIMELINE_FILE_NAME.  If
+ * the file cannot be written, the entries are kept for the next call.
+ *
+ ******************************************************************************/
+void	LB_TimelineFlush (void)
+{
+int	 get = l_LB_TL_Get;
+int	 put = l_LB_TL_Put;	// entries after this are written next time
+uint32_t lost;
+bool	 ok;
+
+
+    if (get == put  ||  IsPowerFail())
+	return;
+
+    /* the ring buffer may wrap around */
+    if (put < get)
+	ok = LogStreamAppend (&l_LB_TL_Stream, 1,
+			      l_LB_TL + get, LB_TIMELINE_SIZE - get,
+			      l_LB_TL, put);
+    else
+	ok = LogStreamAppend (&l_LB_TL_Stream, 1,
+			      l_LB_TL + get, put - get, NULL, 0);
+    if (! ok)
+	return;
+
+    INT_Disable();
+    l_LB_TL_Get = put;
+    lost = l_LB_TL_Lost;
+    l_LB_TL_Lost = 0;
+    INT_Enable();
+
+    if (lost > 0)
+	LogError ("LB: %ld timeline entries lost", lost);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Record a change of the light barrier states
+ *
+ * This routine is called by LB_Handler() for every edge of a light barrier.
+ * It puts a delta entry, or a sync entry if required, into the ring buffer
+ * of the timeline.  If there is not enough space, the entry is lost, and the
+ * next one will be a sync entry.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value when the edge has been received.
+ *
+ ******************************************************************************/
+static void LB_TimelinePut(uint32_t timeStamp)
+{
+uint8_t	 entry[LB_TL_ENTRY_MAX];
+uint32_t now = (uint32_t)time(NULL);
+uint32_t state, value;
+int	 len = 0;
+int	 room, i;
+
+    state = (l_LB_TL_Mask & LB1_EXTI_MASK ? 0x01 : 0x00)
+	  | (l_LB_TL_Mask & LB2_EXTI_MASK ? 0x02 : 0x00);
+
+    if (l_flgLB_TL_Sync  ||  now - l_LB_TL_Sec >= LB_TIMELINE_SYNC)
+    {
+	/* the sub-seconds of time() are those of the RTC counter plus offset */
+	value = (timeStamp + clockGetTickOffset()) % RTC_COUNTS_PER_SEC;
+	if ((RTC->CNT + clockGetTickOffset()) % RTC_COUNTS_PER_SEC < value)
+	    now--;		// a second has elapsed since the edge
+
+	entry[len++] = 0x00;
+	for (i = 0;  i < 4;  i++)
+	    entry[len++] = (uint8_t)(now >> (8 * i));
+	entry[len++] = (uint8_t)value;
+	entry[len++] = (uint8_t)(value >> 8);
+	entry[len++] = (uint8_t)state;
+    }
+    else
+    {
+	/* consider 24bit wrap-around of the RTC counter */
+	value = ((((timeStamp - l_LB_TL_Stamp) & 0xFFFFFF) << 2) | state) + 1;
+	do
+	{
+	    entry[len++] = (uint8_t)((value & 0x7F) | (value > 0x7F ? 0x80 : 0));
+	    value >>= 7;
+	} while (value != 0);
+    }
+
+    /* one byte remains free to distinguish a full from an empty buffer */
+    room = (l_LB_TL_Get - l_LB_TL_Put - 1 + LB_TIMELINE_SIZE) % LB_TIMELINE_SIZE;
+    if (len > room)
+    {
+	l_LB_TL_Lost++;
+	l_flgLB_TL_Sync = true;
+	return;
+    }
+
+    for (i = 0;  i < len;  i++)
+    {
+	l_LB_TL[l_LB_TL_Put] = entry[i];
+	l_LB_TL_Put = (l_LB_TL_Put + 1) % LB_TIMELINE_SIZE;
+    }
+
+    /* write the timeline before it overflows, once per crossing */
+    room -= len;
+    if (room < LB_TIMELINE_SIZE / 4  &&  room + len >= LB_TIMELINE_SIZE / 4)
+	LogFlushRequest();
+
+    l_LB_TL_Stamp = timeStamp;
+    l_LB_TL_Sec = now;
+    l_flgLB_TL_Sync = false;
+}
+#endif
+
+#if LB_TRANSIT
+/***************************************************************************//**
+ *
+ * @brief	Detect the direction of a transit
+ *
+ * This routine is called by LB_Update() for every change of the debounced
+ * light barrier states, i.e. in the same context as LB_Handler().  A transit
+ * starts when the first light barrier becomes active, and ends when both
+ * are inactive again:
+ * - If both light barriers have been active, and the last one to become
+ *   inactive is not the first one, it is an entry from LB1 to LB2, or an
+ *   exit from LB2 to LB1.
+ * - If both light barriers have been active, but the first one is also the
+ *   last to become inactive, the object turned back, i.e. it is aborted.
+ * - If the second light barrier has not been reached within
+ *   @ref LB_TRANSIT_GAP_MS, or not at all, it is a perch visit, which is no
+ *   transit and not reported here.
+ *
+ * A replayed state has no time stamp, then the transit is discarded, and
+ * the next one starts when both light barriers are inactive.
+ *
+ * @param[in] idx
+ *	Index of the light barrier, i.e. 0 for LB1, and 1 for LB2.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value of the edge, 0 if the state is replayed.
+ *
+ ******************************************************************************/
+static void LB_Transit(int idx, uint32_t timeStamp)
+{
+uint32_t duration, cross;	// times of the transit in [ms]
+
+
+    if (timeStamp == 0)
+    {
+	l_LB_TrState = (g_LB_ActiveMask ? LB_TR_UNKNOWN : LB_TR_IDLE);
+	return;
+    }
+
+    switch (l_LB_TrState)
+    {
+	case LB_TR_IDLE:		// the first light barrier became active
+	    l_LB_TrFirst = idx;
+	    l_LB_TrStart = timeStamp;
+	    l_LB_TrState = LB_TR_FIRST;
+	    return;
+
+	case LB_TR_FIRST:
+	    if (idx != l_LB_TrFirst  &&  g_LB_ActiveMask != 0)
+	    {
+		l_LB_TrCross = timeStamp;	// the second one became active
+		l_LB_TrState = LB_TR_BOTH;
+		return;
+	    }
+	    break;
+
+	case LB_TR_BOTH:
+	    break;
+
+	default:			// wait until all are inactive
+	    if (g_LB_ActiveMask == 0)
+		l_LB_TrState = LB_TR_IDLE;
+	    return;
+    }
+
+    if (g_LB_ActiveMask != 0)
+	return;				// the transit goes on
+
+    /* consider 24bit wrap-around of the RTC counter */
+    duration = LB_TICKS2MS((timeStamp - l_LB_TrStart) & 0xFFFFFF);
+    cross    = LB_TICKS2MS((l_LB_TrCross - l_LB_TrStart) & 0xFFFFFF);
+
+    /* a perch visit at one light barrier is no transit */
+    if (l_LB_TrState == LB_TR_BOTH  &&  cross <= LB_TRANSIT_GAP_MS)
+    {
+	if (idx != l_LB_TrFirst)
+	{
+	    LOG_INFO ("LB: %s from LB%d to LB%d in %ldms, crossing after %ldms",
+		      l_LB_TrFirst == 0 ? "Entry" : "Exit", l_LB_TrFirst + 1,
+		      idx + 1, duration, cross);
+	}
+	else
+	{
+	    LOG_INFO ("LB: Aborted at LB%d after %ldms", l_LB_TrFirst + 1,
+		      duration);
+	}
+    }
+
+    l_LB_TrState = LB_TR_IDLE;
+}
+#endif
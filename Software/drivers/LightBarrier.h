@@ -2,9 +2,18 @@
  * @file
  * @brief	Header file of module LightBarrier.c
  * @author	Ralf Gerhauser
- * @version	2017-01-27
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	A transit must reach the second light barrier within
+		LB_TRANSIT_GAP_MS, otherwise it is a perch visit.
+2026-10-15,agnt	Reduced LB_TIMELINE_SIZE to 128.
+2026-10-15,agnt	Added LB_TRANSIT and LB_TRANSIT_GAP_MS.
+2026-10-15,agnt	Added g_LB_FilterMs, g_LB_DebounceOn, g_LB_DebounceOff, and
+		LB_FILTER_MS_MAX.
+2026-10-15,agnt	Added LB_TIMELINE and LB_TimelineFlush().
+2026-10-14,agnt	Added g_LB_SummaryInterval and DFLT_LB_SUMMARY_INTERVAL.
+		Added optional pulse counter mode, see LB_USE_PCNT.
 2017-01-27,rage	Initialize LB2 only if LB2_ENABLE is set.
 2016-04-13,rage	Removed LB_TRIG_MASK (no more required by EXTI module).
 2016-04-05,rage	Made variable <g_LB_ActiveMask> of type "volatile".
@@ -31,28 +40,129 @@ Revision History:
  */
 #define LB2_ENABLE	1
 
+/*!@brief Set this define 1 to count the edges of the light barriers by the
+ * Pulse Counters (PCNT).  Then only the first activation generates an
+ * interrupt.  The EXTI is disabled until the light barrier has been inactive
+ * for @ref LB_PCNT_POLL_INTERVAL seconds, see LB_PCNT_Poll().  The PCNT runs
+ * in oversampling mode from LFACLK, i.e. it counts and debounces in EM2.
+ * The light barrier signals must be connected to the S0IN pins of the PCNTs,
+ * so this mode requires a modified board.  LESENSE is not available on the
+ * EFM32G, and its PCNTs cannot take their input from PRS.
+ */
+#ifndef LB_USE_PCNT
+    #define LB_USE_PCNT	0
+#endif
+
 /*!@brief Here follows the definition of the two light barriers and their
  * related hardware configuration.
  */
-#define LB1_PORT	gpioPortE
-#define LB1_PIN		13
+#if LB_USE_PCNT
+ #define LB1_PORT	gpioPortC	// PCNT0_S0IN #0
+ #define LB1_PIN	13
+ #define LB1_PCNT	PCNT0
+ #define LB1_PCNT_CLOCK	cmuClock_PCNT0
+ #define LB1_PCNT_LOC	PCNT_ROUTE_LOCATION_LOC0
+#else
+ #define LB1_PORT	gpioPortE
+ #define LB1_PIN	13
+#endif
 #define LB1_EXTI_MASK	(1 << LB1_PIN)
 
 #if LB2_ENABLE
- #define LB2_PORT	gpioPortE
- #define LB2_PIN	14
+ #if LB_USE_PCNT
+  #define LB2_PORT	gpioPortE	// PCNT2_S0IN #1
+  #define LB2_PIN	8
+  #define LB2_PCNT	PCNT2
+  #define LB2_PCNT_CLOCK cmuClock_PCNT2
+  #define LB2_PCNT_LOC	PCNT_ROUTE_LOCATION_LOC1
+ #else
+  #define LB2_PORT	gpioPortE
+  #define LB2_PIN	14
+ #endif
  #define LB2_EXTI_MASK	(1 << LB2_PIN)
 #else
  #define LB2_EXTI_MASK	0
 #endif
 
+/*!@brief Interval in seconds to check if a light barrier, which is counted by
+ * the PCNT, became inactive.
+ */
+#define LB_PCNT_POLL_INTERVAL	1
+
 /*!@brief Bit mask of all affected external interrupts (EXTIs). */
 #define LB_EXTI_MASK	(LB2_EXTI_MASK | LB1_EXTI_MASK)
 
+/*!@brief Number of light barriers. */
+#define LB_NUM		(LB2_ENABLE ? 2 : 1)
+
+/*!@brief Default interval in seconds for the summary of light barrier edges,
+ * see LB_SUMMARY_INTERVAL in the configuration file.  0 disables summaries.
+ */
+#ifndef DFLT_LB_SUMMARY_INTERVAL
+    #define DFLT_LB_SUMMARY_INTERVAL	10
+#endif
+
+/*!@brief Maximum summary interval, limited by the 24bit RTC counter. */
+#define LB_SUMMARY_INTERVAL_MAX		500
+
+/*!@brief Maximum filter duration of a single light barrier in milliseconds,
+ * limited by the 24bit RTC counter, see LB1_FILTER_MS.
+ */
+#define LB_FILTER_MS_MAX		500000
+
+/*!@brief Set this define 1 to record the occupancy timeline of the light
+ * barriers, i.e. each change of their state with RTC tick resolution, in
+ * a compact run-length format.  It is appended to @ref LB_TIMELINE_FILE_NAME
+ * by LogFlush(), see LB_TimelineFlush().
+ */
+#ifndef LB_TIMELINE
+    #define LB_TIMELINE	0
+#endif
+
+/*!@brief Size of the ring buffer for the timeline in bytes.  A flush is
+ * requested when less than a quarter of it is free.
+ */
+#ifndef LB_TIMELINE_SIZE
+    #define LB_TIMELINE_SIZE	128
+#endif
+
+/*!@brief Seconds after which the timeline starts with a sync entry again,
+ * must be below the 24bit wrap-around of the RTC counter, i.e. 512s.
+ */
+#ifndef LB_TIMELINE_SYNC
+    #define LB_TIMELINE_SYNC	256
+#endif
+
+/*!@brief Set this define 1 to detect the direction of a transit through
+ * both light barriers, see LB_Transit().  LB1 is the outer light barrier,
+ * i.e. an entry passes LB1 first, then LB2.  Each transit is logged as
+ * entry, exit, or aborted, e.g. "LB: Entry from LB1 to LB2 in 350ms".  A
+ * visit which only interrupts one light barrier is no transit.
+ * This requires @ref LB2_ENABLE.
+ */
+#ifndef LB_TRANSIT
+    #define LB_TRANSIT	1
+#endif
+#if ! LB2_ENABLE
+    #undef  LB_TRANSIT
+    #define LB_TRANSIT	0
+#endif
+
+/*!@brief Maximum time in milliseconds from the activation of the first
+ * light barrier to that of the second one.  If it takes longer, the order
+ * is not significant, and it is a perch visit instead of a transit.
+ */
+#ifndef LB_TRANSIT_GAP_MS
+    #define LB_TRANSIT_GAP_MS	2000
+#endif
+
 /*================================ Global Data ===============================*/
 
 extern volatile uint32_t  g_LB_ActiveMask;
 extern uint32_t   g_LB_FilterDuration;
+extern int32_t    g_LB_FilterMs[LB_NUM];
+extern int32_t    g_LB_DebounceOn, g_LB_DebounceOff;
+extern int32_t    g_LB_SummaryInterval;
 
 /*================================ Prototypes ================================*/
 
@@ -62,5 +172,8 @@ void	LB_Init (void);
 /* Light Barrier Handler, called from interrupt service routine */
 void	LB_Handler	(int extiNum, bool extiLvl, uint32_t timeStamp);
 
+/* Append the occupancy timeline to its file, called by LogFlush() */
+void	LB_TimelineFlush (void);
+
 
 #endif /* __INC_LightBarrier_h */
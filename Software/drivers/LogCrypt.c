@@ -0,0 +1,182 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Encryption of the Log File
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module encrypts the log file with AES-128 in counter mode (CTR), so
+ * the transponder IDs and visits on a lost SD-Card cannot be read.  It is
+ * used by LogFlush() if @ref LOG_ENCRYPT is set.
+ *
+ * The key is provisioned into the user data page of the flash at
+ * @ref LOG_CRYPT_KEY_ADDR.  It is neither taken from the configuration file
+ * nor from any other file, because the SD-Card would carry its own key then.
+ * An erased key, i.e. all bytes 0xFF, or a key of all 0x00, disables the
+ * encryption.
+ *
+ * Each time the log file is opened, LogCryptHeader() generates a new nonce,
+ * which is written as plain text header line into the log file.  All bytes
+ * after it are encrypted.  The counter block consists of the nonce and the
+ * block number, i.e. the file offset divided by 16, as 32 bit big endian
+ * value:
+ * @code
+   +------------------+------------+----------+-------------------+
+   | DEVINFO->UNIQUEL | time(NULL) | RTC->CNT | file offset / 16  |
+   +------------------+------------+----------+-------------------+
+   @endcode
+ * So each part of the file can be encrypted independently, and a page may
+ * start at any offset.  The unique number of the device makes the nonce
+ * unique between boxes, the RTC counter between two opens at the same time
+ * stamp, e.g. when the clock has not been set yet.
+ *
+ * The AES peripheral encrypts a block in 54 cycles.  The blocks are written
+ * and read by the CPU, since a DMA transfer requires two channels, and its
+ * set-up for each 16 byte block would take longer than these few register
+ * accesses.  A page of 512 bytes takes 32 blocks, which is small compared
+ * to writing the page to the SD-Card.
+ *
+ * The host tool "LogAnalyzer" decrypts the log with option <b>-k</b>.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	The AES clock is acquired via ClockMgr.c.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include <time.h>
+#include "em_device.h"
+#include "em_aes.h"
+#include "em_cmu.h"
+#include "LogCrypt.h"
+#include "StrFormat.h"
+#include "ClockMgr.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Size of an AES block in bytes, as in "em_aes.c" */
+#define AES_BLOCKSIZE	16
+
+/*================================ Local Data ================================*/
+
+    /*! AES-128 key from the user data page */
+static uint32_t	l_Key[AES_BLOCKSIZE / 4];
+
+    /*! Counter block, the last 4 bytes are the block number */
+static uint32_t	l_Ctr[AES_BLOCKSIZE / 4];
+
+
+/***************************************************************************//**
+ *
+ * @brief	Load the Key
+ *
+ * This routine is called by LogInit().  It copies the key from the
+ * user data page.
+ *
+ * @return
+ * 	The value <i>true</i> if a key has been provisioned.
+ *
+ ******************************************************************************/
+bool	LogCryptInit (void)
+{
+const uint8_t *pKey = (const uint8_t *)LOG_CRYPT_KEY_ADDR;
+bool	 flgErased = true, flgCleared = true;
+int	 i;
+
+    for (i = 0;  i < AES_BLOCKSIZE;  i++)
+    {
+	if (pKey[i] != 0xFF)
+	    flgErased = false;
+	if (pKey[i] != 0x00)
+	    flgCleared = false;
+    }
+    memcpy (l_Key, pKey, sizeof(l_Key));
+
+    return ! (flgErased  ||  flgCleared);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Generate a new Nonce
+ *
+ * This routine is called when the log file has been opened.  It generates a
+ * new nonce, and the header line for it, which must be written as plain text
+ * at the current position of the file.
+ *
+ * @param[out] pBuf
+ *	Buffer of @ref LOG_CRYPT_HDR_SIZE bytes for the header line.
+ *
+ * @return
+ * 	Length of the header line, without EOS.
+ *
+ ******************************************************************************/
+int	LogCryptHeader (char *pBuf)
+{
+const uint8_t *pNonce = (const uint8_t *)l_Ctr;
+int	 len, i;
+
+    l_Ctr[0] = DEVINFO->UNIQUEL;
+    l_Ctr[1] = (uint32_t)time(NULL);
+    l_Ctr[2] = RTC->CNT;
+
+    len = StrFormat (pBuf, LOG_CRYPT_HDR_TAG);
+    for (i = 0;  i < LOG_CRYPT_NONCE_SIZE;  i++)
+	len += StrFormat (pBuf + len, "%02X", pNonce[i]);
+    strcpy (pBuf + len, "\r\n");
+
+    return len + 2;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Encrypt Data
+ *
+ * This routine encrypts data in place with the nonce of the last call of
+ * LogCryptHeader().  Since the key stream is XORed, the same routine also
+ * decrypts.
+ *
+ * @param[in,out] pBuf
+ *	Data to be encrypted.
+ *
+ * @param[in] len
+ *	Number of bytes.
+ *
+ * @param[in] offs
+ *	Offset of the data in the log file.
+ *
+ ******************************************************************************/
+void	LogCryptApply (uint8_t *pBuf, unsigned int len, uint32_t offs)
+{
+uint8_t	*pCtr = (uint8_t *)l_Ctr;
+uint32_t stream[AES_BLOCKSIZE / 4];	// key stream of the current block
+const uint8_t *pStream = (const uint8_t *)stream;
+uint32_t block;
+unsigned int i;
+
+    ClockAcquire (CLK_OWN_LOG, cmuClock_AES);
+
+    while (len > 0)
+    {
+	block = offs / AES_BLOCKSIZE;
+	pCtr[12] = (uint8_t)(block >> 24);
+	pCtr[13] = (uint8_t)(block >> 16);
+	pCtr[14] = (uint8_t)(block >> 8);
+	pCtr[15] = (uint8_t)block;
+
+	AES_ECB128 ((uint8_t *)stream, pCtr, AES_BLOCKSIZE,
+		    (const uint8_t *)l_Key, true);
+
+	for (i = offs % AES_BLOCKSIZE;  i < AES_BLOCKSIZE  &&  len > 0;  i++)
+	{
+	    *pBuf++ ^= pStream[i];
+	    offs++;
+	    len--;
+	}
+    }
+
+    ClockRelease (CLK_OWN_LOG, cmuClock_AES);
+}
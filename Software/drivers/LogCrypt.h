@@ -0,0 +1,51 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module LogCrypt.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_LogCrypt_h
+#define __INC_LogCrypt_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Address of the AES-128 key in the user data page of the flash.
+ * The 16 bytes are provisioned by the flash programmer.
+ */
+#define LOG_CRYPT_KEY_ADDR	(USERDATA_BASE + 0x00)
+
+/*!@brief Size of the nonce, the remaining 4 bytes of the counter block are
+ * the block number.
+ */
+#define LOG_CRYPT_NONCE_SIZE	12
+
+/*!@brief Tag of the header line, the nonce follows as hex digits. */
+#define LOG_CRYPT_HDR_TAG	"#LOG-AES-CTR "
+
+/*!@brief Size of the header line, including <CR><LF> and EOS. */
+#define LOG_CRYPT_HDR_SIZE	(sizeof(LOG_CRYPT_HDR_TAG) + 2 * LOG_CRYPT_NONCE_SIZE + 2)
+
+/*================================ Prototypes ================================*/
+
+    /* Load the key, false if none has been provisioned */
+bool	LogCryptInit (void);
+
+    /* Generate a new nonce and its header line, returns the length */
+int	LogCryptHeader (char *pBuf);
+
+    /* Encrypt data in place, located at the specified file offset */
+void	LogCryptApply (uint8_t *pBuf, unsigned int len, uint32_t offs);
+
+
+#endif /* __INC_LogCrypt_h */
@@ -2,13 +2,87 @@
  * @file
  * @brief	Logging
  * @author	Ralf Gerhauser
- * @version	2018-03-16
+ * @version	2026-10-15
  *
  * This module provides a logging facility to send messages to the LEUART and
  * store them into a file on the SD-Card.
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	The reset cause is no longer recorded in a timeline.
+2026-10-15,agnt	LOG_JOURNAL_BUILD_TAG casts the address via uintptr_t.
+2026-10-15,agnt	The file handle of the output streams may be borrowed by other
+		modules for a short file access, see LogFileHandleGet().
+2026-10-15,agnt	logBufReserve() emits an ITM trace record of the allocated space
+		of the log buffer, see ITM_TRACE.
+2026-10-15,agnt	Registered LogFlushCheck() as task of the main loop, see
+		TASK_REGISTER().
+2026-10-15,agnt	logRetainCheck: The reset cause is read by WarmStartInit(), see
+		g_ResetCause.
+2026-10-15,agnt	The flush pause, the hold time of LOG_FLUSH_ADAPTIVE, and the
+		alive interval are started by sTimerStartSlack(), so they share
+		the wake-ups of other timers, see LOG_FLUSH_SLACK and
+		LOG_ALIVE_SLACK.
+2026-10-15,agnt	The shared structures are protected by CritEnter() instead of
+		INT_Disable(), see INT_CEIL_LOG and INT_CEIL_CLOCK.
+2026-10-15,agnt	The milliseconds of binary records consider the tick offset of
+		the time base, see ClockAdjust().
+2026-10-15,agnt	Output streams of other modules are registered by
+		LogStreamRegister() and flushed by LogFlush() in the same
+		SD-Card power cycle as the log file.  They share one file
+		handle, see LogStreamAppend().  This replaces the direct calls
+		of VisitStatsFlush() and LB_TimelineFlush().
+2026-10-15,agnt	logMsg: The buffer for a message which does not fit into the
+		log buffer is taken from the scratch pool, see ScratchGet().
+		The alive message also reports the usage of the pool.
+2026-10-15,agnt	Entries have a priority, see LOG_PRIORITY and LogPrio().  Low
+		priority entries are dropped while the log buffer is filled
+		beyond their reserve, and summarized by logDropReport().
+2026-10-15,agnt	Adaptive flushing, see LOG_FLUSH_ADAPTIVE.  Small batches are
+		held back, the threshold is halved while busy or at risk, and
+		LogFlushSoC() takes the battery state of charge into account.
+2026-10-15,agnt	The reset cause is recorded in the timeline, see TIMELINE.
+2026-10-15,agnt	Added LogFlushRequest() to flush the buffer without waiting for
+		LOG_SAMPLE_TIMEOUT, e.g. by the power-up sequencer.
+2026-10-15,agnt	LogFlush() appends the light barrier timeline, see LB_TIMELINE.
+2026-10-15,agnt	LogFlush() appends the visit records, see VISIT_RECORDS.
+2026-10-15,agnt	Messages are formatted by StrFormatV() instead of vsnprintf().
+		Binary records are restricted to its conversions.
+2026-10-15,agnt	Optional compression of the flushed text, see LOG_COMPRESS.
+2026-10-15,agnt	Optional integrity record after each flushed block of text, see
+		LOG_INTEGRITY.  Pages are filled by logPagePut().
+2026-10-15,agnt	Optional encryption of the log file, see LOG_ENCRYPT.  Each
+		page is encrypted by logPageWrite() before it is written.
+2026-10-15,agnt	The Log Flush LED is flashed by the LED pattern engine, see
+		l_LogFlushPattern.
+2026-10-14,agnt	LOG_MEMORY_BARRIER() is a compiler barrier only for the host
+		simulation, see SIMULATION.
+2026-10-14,agnt	The text of all messages is also kept in a ring buffer of
+		LOG_TAIL_SIZE bytes, see LogTailGet().  Added LogLostCount().
+2026-10-14,agnt	logAliveMsg() also reports the memory usage, see MEM_MONITOR.
+2026-10-14,agnt	logMsg() formats the message directly into the log buffer, the
+		unused part of the reserved space is given back, see
+		logBufReserve() and logBufCommit().  LogFlush() releases entries
+		via logBufRelease() when they have been written.  With
+		LOG_FLUSH_PAGED the entries are collected into sector aligned
+		pages, so full pages are written directly by disk_write().
+2026-10-14,agnt	LogFlush() uses DiskAcquire() and DiskRelease(), so the SD-Card
+		is retained between flushes instead of being re-initialized.
+2026-10-14,agnt	Every new entry triggers LogFlushCheck() via EVENT_POST(EVT_LOG).
+2026-10-14,agnt	LogError() counts all error messages in g_LogErrorCnt.
+		The Log Flush LED uses its own msTimer handle.
+		Optional binary log records (LOG_BINARY) which are converted
+		to text when flushed, or sent to the monitor output.
+		Reserve log buffer space via LDREX/STREX and copy entries
+		without disabling interrupts.
+		Flushes due to LOG_SAMPLE_MAX_SIZE defer f_sync(), see
+		LOG_SYNC_INTERVAL.
+		Optional rotation of the log file by date and size, see
+		LOG_ROTATE.
+		Optional power-fail journal in flash, see LOG_JOURNAL.
+		Optionally keep the log buffer after a warm reset, see
+		LOG_RETAIN.
+		Added runtime log level g_LogLevel.
 2018-03-16,rage	Disable interrupts for a minimum of time to prevent data loss
 		in conjunction with other interrupt handlers.
 2016-09-27,rage	LogFlushCheck: Flush log buffer if threshold has been reached,
@@ -22,17 +96,27 @@ Revision History:
 /*=============================== Header Files ===============================*/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
 #include "em_device.h"
 #include "em_assert.h"
-#include "em_int.h"
+#include "em_msc.h"
+#include "em_rmu.h"
 #include "AlarmClock.h"
+#include "ItmTrace.h"
 #include "PowerFail.h"
 #include "Logging.h"
+#include "LedPattern.h"
+#include "LogCrypt.h"
+#include "MemMonitor.h"
+#include "ScratchPool.h"
+#include "StrFormat.h"
 #include "ff.h"		// FS_FAT12/16/32
 #include "diskio.h"	// DSTATUS
 #include "microsd.h"
+#include "CritSect.h"
+#include "WarmStart.h"
 
 /*=============================== Definitions ================================*/
 
@@ -40,66 +124,334 @@ Revision History:
     #undef LOG_MONITOR_FUNCTION
 #endif
 
+    /* logMsg() uses a scratch block if the log buffer is full */
+#if LOG_ENTRY_MAX_SIZE > SCRATCH_BLOCK_SIZE
+    #error "LOG_ENTRY_MAX_SIZE exceeds SCRATCH_BLOCK_SIZE"
+#endif
+
 
     /*!@name Hardware Configuration: Log Flush LED. */
 //@{
-    /*! Get or set level of the Log Flush LED */
-#define LOG_FLUSH_LED  IO_Bit(GPIO->P[LOG_FLUSH_LED_PORT].DOUT, LOG_FLUSH_LED_PIN)
   #define LOG_FLASH_LED_DELAY	50	// Delay [ms] between toggling the LED
   #define LOG_FLASH_LED_CNT	5	// How often the LED is flashing
 //@}
 
+    /*! Length byte of an entry which is reserved, but not yet committed */
+#define LOG_ENTRY_BUSY		0xFF
+
+    /*! Prevent the compiler and CPU from reordering memory accesses */
+#ifdef SIMULATION
+    #define LOG_MEMORY_BARRIER()	__ASM volatile ("" ::: "memory")
+#else
+    #define LOG_MEMORY_BARRIER()	__ASM volatile ("dmb" ::: "memory")
+#endif
+
+#if LOG_BINARY
+    /*!@name Binary Log Records. */
+//@{
+#define LOG_REC_BINARY		0x01	// marker of a binary record
+#define LOG_REC_FLG_ERROR	0x01	// message has been logged by LogError()
+#define LOG_REC_HDR_SIZE	12	// marker, flags, format, time, and [ms]
+    /*! Characters of a conversion specification before the type */
+#define LOG_REC_SPEC_CHARS	"-+ #0123456789.hlLqjzt"
+    /*! Maximum size of a binary record when it is converted to text */
+#define LOG_TEXT_MAX_SIZE	(LOG_ENTRY_MAX_SIZE + 32)
+//@}
+#endif
+
+#if LOG_JOURNAL
+    /*!@name Power-Fail Journal. */
+//@{
+#define LOG_JOURNAL_MAGIC	0x4C4A524EUL	// "LJRN", header is valid
+#define LOG_JOURNAL_SIZE	(FLASH_PAGE_SIZE + LOG_BUF_SIZE)
+    /*! Address of the journal data, i.e. the copy of the log buffer */
+#define LOG_JOURNAL_DATA	((const char *)__LogJournalStart + FLASH_PAGE_SIZE)
+    /*! Identifies the firmware, binary records refer to its format strings */
+#define LOG_JOURNAL_BUILD_TAG	((uint32_t)(uintptr_t)LogInit)
+//@}
+
+    /*! Header in the first flash page of the journal, Magic is written last */
+typedef struct
+{
+    uint32_t	IdxGet;		// index of the first entry
+    uint32_t	IdxPut;		// index after the last entry
+    uint32_t	BuildTag;	// see LOG_JOURNAL_BUILD_TAG
+    uint32_t	Magic;		// LOG_JOURNAL_MAGIC
+} LOG_JOURNAL_HDR;
+
+    /* Flash area of the journal, defined by the linker script */
+extern uint32_t	__LogJournalStart[], __LogJournalEnd[];
+#endif
+
+#if LOG_RETAIN
+    /*! Place a variable into the RAM section which is not cleared at reset */
+#define LOG_NOINIT		__attribute__((section(".noinit")))
+#define LOG_RETAIN_MAGIC	((uint32_t)0x4C524554)	// "LRET", buffer is valid
+    /*! Reset causes which do not retain the RAM contents */
+#define LOG_RETAIN_RST_MASK	(RMU_RSTCAUSE_PORST | RMU_RSTCAUSE_BODUNREGRST \
+				 | RMU_RSTCAUSE_BODREGRST)
+#else
+#define LOG_NOINIT
+#endif
+
 /*========================= Global Data and Routines =========================*/
 
     /*!@brief Filename of the current Log File on the SD-Card */
-char	g_LogFilename[14];
+char	g_LogFilename[LOG_FILENAME_SIZE];
+
+    /*!@brief Number of error messages generated via LogError() */
+uint32_t g_LogErrorCnt;
+
+    /*!@brief Runtime log level, see LOG_LEVEL_ENABLED(). */
+int32_t	g_LogLevel = DFLT_LOG_LEVEL;
 
 /*================================ Local Data ================================*/
 
 /*!
  * The Log Buffer and its indices.  To ensure efficient data handling, all log
  * messages are directly stored as a consecutive stream of characters into the
- * log buffer, terminated by 0.  If the remaining amount of bytes to the end of
- * the buffer is less than LOG_ENTRY_MAX_SIZE, the storage wraps around, and
- * @ref idxLogPut is set to 0, i.e. the beginning of the buffer.  This is marked
- * by an extra 0 byte, directly after the terminating 0 of the previous string.
+ * log buffer, terminated by 0.  If @ref LOG_BINARY is set, an entry may also
+ * be a binary record, see logMsgBinary().  If the remaining amount of bytes
+ * to the end of the buffer is less than LOG_ENTRY_MAX_SIZE, the storage wraps
+ * around, and @ref idxLogPut is set to 0, i.e. the beginning of the buffer.
+ * This is marked by an extra 0 byte, directly after the terminating 0 of the
+ * previous string.  Unused space is filled with @ref LOG_ENTRY_BUSY, see
+ * logBufPut().  The buffer is word aligned, so it can be programmed into the
+ * flash journal, see @ref LOG_JOURNAL.  With @ref LOG_RETAIN it is located in
+ * the <b>.noinit</b> section, see logRetainCheck().
  */
-static char	l_LogBuf[LOG_BUF_SIZE];
-static int	idxLogPut, idxLogGet;
+static char	l_LogBuf[LOG_BUF_SIZE] LOG_NOINIT __attribute__((aligned(4)));
+static volatile int idxLogPut LOG_NOINIT, idxLogGet LOG_NOINIT;
+
+#if LOG_FLUSH_PAGED
+    /*! Size of a page, this is the sector size of the SD-Card */
+#define LOG_PAGE_SIZE	512
+
+    /*! Page buffer to collect the log messages by LogFlush() */
+static char	l_LogPage[LOG_PAGE_SIZE] __attribute__((aligned(4)));
+
+    /*! Used and usable bytes of the page buffer, see logPagePut() */
+static int	l_LogPageLen, l_LogPageSize;
+#endif
+
+#if LOG_COMPRESS
+    /*!@name Compression of the text into LZ77 frames, see logLzPut(). */
+//@{
+#define LOG_LZ_TAG	 "#LZ\r\n"	//!< start of a frame
+#define LOG_LZ_END	 "\0\r\n"	//!< end of a frame
+#define LOG_LZ_WINDOW	 512		//!< maximum distance of a match
+#define LOG_LZ_CHUNK	 128		//!< bytes compressed at once
+#define LOG_LZ_MIN_MATCH 3		//!< minimum length of a match
+#define LOG_LZ_MAX_MATCH (LOG_LZ_MIN_MATCH + 63) //!< maximum length
+#define LOG_LZ_MAX_LIT	 127		//!< maximum number of literals
+#define LOG_LZ_HASH_BITS 8		//!< size of the hash table
+//@}
+
+    /*! Window and the chunk to be compressed */
+static uint8_t	l_LzBuf[LOG_LZ_WINDOW + LOG_LZ_CHUNK];
+
+    /*! Number of bytes in @ref l_LzBuf, 0 if no frame has been started */
+static int	l_LzLen;
+
+    /*! Stream position of l_LzBuf[0], modulo 2^16 */
+static uint16_t	l_LzPos;
+
+    /*! Most recent stream position of each hash of 3 bytes */
+static uint16_t	l_LzHead[1 << LOG_LZ_HASH_BITS];
+
+    /*! Text is compressed before it is put into the page buffer */
+#define LOG_TEXT_PUT	logLzPut
+#else
+#define LOG_TEXT_PUT	logPagePut
+#endif
+
+#if LOG_INTEGRITY
+    /*! Tag of an integrity record */
+#define LOG_CHK_TAG	"#CHK "
+
+    /*! Length of a time stamp, see logMsg() */
+#define LOG_STAMP_LEN	19
+
+    /*! Maximum size of an integrity record, including EOS */
+#define LOG_CHK_SIZE	(sizeof(LOG_CHK_TAG) + 10 + 2 * (LOG_STAMP_LEN + 1) \
+			 + 10 + 1 + 8 + 2)
+#endif
+
+#if LOG_RETAIN
+    /* Magic and its complement, set when the log buffer is initialized */
+static uint32_t	l_LogRetainMagic[2] LOG_NOINIT;
+#endif
+
+#if LOG_BINARY  &&  defined(LOG_MONITOR_FUNCTION)
+    /* Index of the next entry to be sent to the monitor output */
+static int	idxLogMon;
+#endif
 
     /* Counter for lost log entries */
-static uint32_t	l_LostEntryCnt;
+static uint32_t	l_LostEntryCnt LOG_NOINIT;
 
     /* Counter how many error messages may still be generated */
 static int	l_ErrMsgCnt;
 
+#if LOG_PRIORITY
+    /* Free space in bytes which must remain after an entry of a priority */
+static const uint16_t l_LogPrioReserve[LOG_PRIO_HIGH] =
+{
+    LOG_RESERVE_LOW,		// LOG_PRIO_LOW
+    LOG_RESERVE_NORMAL,		// LOG_PRIO_NORMAL
+};
+
+    /* Counters for entries which have been dropped because of their priority */
+static uint32_t	l_LogDropCnt[LOG_PRIO_HIGH];
+#endif
+
     /* Flag to trigger a flush of the log buffer, see LOG_SAMPLE_TIMEOUT. */
 static volatile bool l_flgLogFlushTrigger;
 
     /* Flag to inhibit flushing the log buffer, see LOG_FLUSH_PAUSE. */
 static volatile bool l_flgLogFlushInhibit;
 
-    /* Counter to specify how often the Log Flush LED will flash */
-static volatile uint8_t l_LogFlushLED_FlashCnt;
+    /* Flag to defer synchronizing the file system, see LOG_SYNC_INTERVAL. */
+static bool	l_flgLogSyncDefer;
+
+    /* Number of flushes since the file system has been synchronized */
+static uint8_t	l_LogSyncCnt;
+
+#if LOG_FLUSH_ADAPTIVE
+    /* Flag to flush the log buffer regardless of its fill level. */
+static volatile bool l_flgLogFlushForce;
+
+    /* Time in [s] when the oldest entry has been stored into the buffer. */
+static volatile uint32_t l_LogOldest;
+
+    /* Logging is busy until this time in [s], see LOG_FLUSH_BUSY_TIME. */
+static uint32_t	l_LogBusyUntil;
+
+    /* Battery state of charge in [%], -1 if not known yet. */
+static int	l_LogSoC = -1;
+#endif
 
     /* File handle for log file */
 static FIL	l_fh;
 
+    /* Registered output streams, see LogStreamRegister() */
+static const LOG_STREAM *l_LogStream[LOG_STREAM_MAX];
+static int	l_LogStreamCnt;
+
+    /* File handle shared by all output streams, see LogStreamAppend() */
+static FIL	l_StreamFh;
+
+    /* Flag if the file handle has been borrowed, see LogFileHandleGet() */
+static bool	l_flgStreamFhBusy;
+
+#if LOG_ROTATE
+    /* Directory of the log file segments, i.e. basename of the log file */
+static char	l_LogDir[9];
+
+    /* Date (YYMMDD) and number of the current segment */
+static uint32_t	l_SegDate;
+static uint8_t	l_SegNum;
+#endif
+
     /* Timer handle for the log buffer flushing control */
 static TIM_HDL	l_thLogFlushCtrl = NONE;
 
+    /* LED pattern for flashing the Log Flush LED */
+static const LED_PATTERN l_LogFlushPattern =
+{ //	Bits,	Steps,	Repeat,			StepTime
+	0x01,	2,	LOG_FLASH_LED_CNT,	LOG_FLASH_LED_DELAY
+};
+
 #if LOG_ALIVE_INTERVAL > 0
     /* Timer handle for the alive interval */
 static TIM_HDL	l_thLogAliveIntvl = NONE;
 #endif
 
+#if LOG_JOURNAL
+    /* Flag if the journal is in use, i.e. is not erased */
+static bool	l_flgJournalUsed = true;
+#endif
+
+#if LOG_TAIL_SIZE > 0
+    /* Ring buffer with the text of the most recent messages, see LogTailGet() */
+static char	l_LogTail[LOG_TAIL_SIZE];
+static int	l_LogTailPut;
+static bool	l_flgLogTailWrap;
+#endif
+
+#if LOG_ENCRYPT
+    /* Flag if a key has been provisioned, see LogCryptInit() */
+static bool	l_flgLogCryptKey;
+
+    /* Flag if the data after the header line of the log file is encrypted */
+static bool	l_flgLogCrypt;
+#endif
+
+#if LOG_INTEGRITY
+    /* Sequence number of the last integrity record */
+static uint32_t	l_LogChkSeq;
+#endif
+
 /*=========================== Forward Declarations ===========================*/
 
-static void	logMsg(const char *prefix, const char *frmt, va_list args);
-static void	logFlushLED(void);
+static void	logMsg(int prio, const char *prefix, const char *frmt,
+		       va_list args);
+static bool	logBufPut(char *pEntry, int len, int prio);
+static int	logBufReserve(int len, int prio);
+#if LOG_PRIORITY
+static void	logDropReport(void);
+#endif
+static void	logBufCommit(int idxPut, int size, int len);
+static void	logBufRelease(int idx);
+static FRESULT	logFileWrite(const char *pStr, UINT len);
+#if LOG_FLUSH_PAGED
+static FRESULT	logPagePut(const char *pStr, int len, int idxRelease);
+static FRESULT	logPageWrite(int len);
+#endif
+#if LOG_COMPRESS
+static FRESULT	logLzPut(const char *pStr, int len, int idxRelease);
+static FRESULT	logLzLiterals(int from, int to, int idxRelease);
+static FRESULT	logLzEnd(int idxRelease);
+#endif
+#if LOG_INTEGRITY
+static uint32_t	logCrc32(uint32_t crc, const char *pData, int len);
+#endif
+#if LOG_BINARY
+static bool	logMsgBinary(int prio, const char *prefix, const char *frmt,
+			     va_list args);
+static int	logExpand(const char *pRec, char *pBuf);
+#ifdef LOG_MONITOR_FUNCTION
+static void	logMonitor(void);
+#endif
+#endif
+static FRESULT	logFileOpen(const char *filename);
+#if LOG_ROTATE
+static uint32_t	logSegmentDate(void);
+static void	logSegmentName(char *pName);
+static bool	logIndexRead(void);
+static void	logIndexWrite(const char *pName);
+static FRESULT	logSegmentOpen(char *pName);
+static FRESULT	logRotateCheck(void);
+static FRESULT	logRotateOpen(char *filepattern, char *filename, char *pName);
+#endif
+#if LOG_RETAIN
+static int	logRetainCheck(void);
+#endif
+#if LOG_JOURNAL
+static void	logJournalReplay(bool flgRestore);
+static void	logJournalErase(void);
+#endif
 static void	logFlushCtrl(TIM_HDL hdl);
+#if LOG_FLUSH_ADAPTIVE
+static uint32_t	logNow(void);
+static bool	logAtRisk(void);
+static bool	logFlushDue(int cnt);
+#endif
 #if LOG_ALIVE_INTERVAL > 0
 static void	logAliveMsg(TIM_HDL hdl);
+#if LOG_TAIL_SIZE > 0
+static void	logTailPut(const char *pStr);
+#endif
 #endif
 
 
@@ -110,13 +462,55 @@ static void	logAliveMsg(TIM_HDL hdl);
  * This routine must be called once to initialize the logging facility.
  * It sets up the log buffer and allocates timers.  Disk access is not done
  * here because it is not available at this early point, see function
- * @ref LogFlushCheck() for this.
+ * @ref LogFlushCheck() for this.  If @ref LOG_RETAIN is set, the log buffer
+ * is kept after a warm reset.  If @ref LOG_JOURNAL is set, the entries which
+ * have been saved by LogPowerFailHandler() are restored.
  *
  ******************************************************************************/
 void	 LogInit (void)
 {
-    /* initialize indices */
-    idxLogGet = idxLogPut = 0;
+#if LOG_RETAIN  ||  LOG_JOURNAL
+static bool	 flgInitDone;	// only the first call is after a reset
+#endif
+int	 num = -1;		// number of retained log entries
+
+
+#if LOG_RETAIN
+    /* See if the log buffer survived the reset */
+    if (! flgInitDone)
+	num = logRetainCheck();
+#endif
+
+    if (num < 0)
+    {
+	/* initialize indices and mark all entries as not committed */
+	idxLogGet = idxLogPut = 0;
+	memset (l_LogBuf, LOG_ENTRY_BUSY, sizeof(l_LogBuf));
+#if LOG_RETAIN
+	if (! flgInitDone)
+	    l_LostEntryCnt = 0;		// not cleared by the startup code
+
+	l_LogRetainMagic[0] =  LOG_RETAIN_MAGIC;
+	l_LogRetainMagic[1] = ~LOG_RETAIN_MAGIC;
+#endif
+    }
+#if LOG_BINARY  &&  defined(LOG_MONITOR_FUNCTION)
+    idxLogMon = idxLogPut;	// retained entries have already been sent
+#endif
+
+#if LOG_JOURNAL
+    /* Restore log entries from the journal, unless retained, then erase it */
+    if (! flgInitDone)
+	logJournalReplay (num < 0);
+#endif
+#if LOG_RETAIN  ||  LOG_JOURNAL
+    flgInitDone = true;
+#endif
+
+#if LOG_ENCRYPT
+    /* Load the key from the user data page */
+    l_flgLogCryptKey = LogCryptInit();
+#endif
 
     /* Get a timer handle for the log sample timeout */
     if (l_thLogFlushCtrl == NONE)
@@ -128,9 +522,13 @@ void	 LogInit (void)
     {
 	l_thLogAliveIntvl = sTimerCreate (logAliveMsg);
 	if (l_thLogAliveIntvl != NONE)
-	    sTimerStart (l_thLogAliveIntvl, LOG_ALIVE_INTERVAL);
+	    sTimerStartSlack (l_thLogAliveIntvl, LOG_ALIVE_INTERVAL,
+			      LOG_ALIVE_SLACK);
     }
 #endif
+
+    if (num >= 0)
+	Log ("Log Buffer: Retained %d Entries after Reset", num);
 }
 
 
@@ -138,7 +536,8 @@ void	 LogInit (void)
  *
  * @brief	Open Log File
  *
- * This routine (re-)opens the log file for writing.
+ * This routine (re-)opens the log file for writing.  If @ref LOG_ROTATE is
+ * set, the log file is split into segments, see logRotateOpen().
  *
  * @param[in] filepattern
  *	Filename to compare all file entries in the root directory of the disk
@@ -155,12 +554,21 @@ void	 LogInit (void)
 void	 LogFileOpen (char *filepattern, char *filename)
 {
 FRESULT	 res;		// FatFs function common result code
+#if LOG_ROTATE
+char	 name[LOG_FILENAME_SIZE];	// filename of the segment
+#else
 char	*pStr;		// string pointer
+#endif
 
 
     /* Parameter Check */
     EFM_ASSERT(filename != NULL);
 
+#if LOG_ROTATE
+    /* Discard old file handle, open the current segment */
+    res = logRotateOpen (filepattern, filename, name);
+    filename = name;
+#else
     if (filepattern != NULL)
     {
 	/* Find filename with specified pattern on the SD-Card */
@@ -169,6 +577,10 @@ char	*pStr;		// string pointer
 	    filename = pStr;	// found pattern on disk
     }
 
+    /* Discard old file handle, open new file */
+    res = logFileOpen (filename);
+#endif
+
     /* Log filename change */
     if (g_LogFilename[0] != EOS)
 	Log ("Media Change: %s -> %s", g_LogFilename, filename);
@@ -177,12 +589,10 @@ char	*pStr;		// string pointer
 
     strcpy (g_LogFilename, filename);
 
-    /* Discard old file handle, open new file */
-    res = f_open (&l_fh, filename,  FA_READ | FA_WRITE | FA_OPEN_ALWAYS);
-    if (res == FR_OK)
-    {
-	res = f_lseek (&l_fh, f_size(&l_fh));
-    }
+#if LOG_ENCRYPT
+    if (! l_flgLogCryptKey)
+	LogError ("LogFileOpen: No key provisioned, log is not encrypted");
+#endif
 
     if (res != FR_OK)
     {
@@ -192,6 +602,7 @@ char	*pStr;		// string pointer
     else
     {
 	l_ErrMsgCnt = 2;
+	l_LogSyncCnt = 0;
     }
 
     /* Power off the SD-Card Interface */
@@ -217,7 +628,7 @@ va_list	 args;
 
     /* build variable argument list and call logMsg() */
     va_start(args, frmt);
-    logMsg (NULL, frmt, args);
+    logMsg (LOG_PRIO_NORMAL, NULL, frmt, args);
     va_end(args);
 }
 
@@ -238,9 +649,37 @@ void	 LogError (const char *frmt, ...)
 va_list	 args;
 
 
+    g_LogErrorCnt++;		// count error messages
+
+    /* build variable argument list and call logMsg() */
+    va_start(args, frmt);
+    logMsg (LOG_PRIO_HIGH, "ERROR ", frmt, args);
+    va_end(args);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Log a Message with Priority
+ *
+ * This routine writes a log message of the specified priority into the
+ * buffer.  If @ref LOG_PRIORITY is set, an entry of low or normal priority is
+ * dropped when the log buffer is filled beyond its reserve.  It may be called
+ * from interrupt context.
+ *
+ * @param[in] prio
+ *	Priority of the message, @ref LOG_PRIO_LOW, @ref LOG_PRIO_NORMAL, or
+ *	@ref LOG_PRIO_HIGH.
+ *
+ ******************************************************************************/
+void	 LogPrio (int prio, const char *frmt, ...)
+{
+va_list	 args;
+
+
     /* build variable argument list and call logMsg() */
     va_start(args, frmt);
-    logMsg ("ERROR ", frmt, args);
+    logMsg (prio, NULL, frmt, args);
     va_end(args);
 }
 
@@ -261,8 +700,23 @@ va_list	 args;
 void	 LogFlush (bool flgKeepPowerOn)
 {
 FRESULT	 res = FR_DISK_ERR;	// FatFs function common result code
-int	 cnt;
-UINT	 bytesWr;
+bool	 flgSynced = false;	// file system has been synchronized
+int	 cnt, len;
+int	 idxRd;			// read index, entries are released later
+char	*pStr;			// text to write
+#if LOG_FLUSH_PAGED
+int	 idxCopied;		// entries up to here are in the page buffer
+#endif
+#if LOG_INTEGRITY
+uint32_t chkCrc = 0xFFFFFFFF;	// CRC-32 of the text written by this flush
+uint32_t chkLen = 0;		// number of bytes covered by the CRC
+char	 chkFirst[] = "00000000-000000.000";	// time stamp of first entry
+char	 chkLast[]  = "00000000-000000.000";	// time stamp of last entry
+char	 rec[LOG_CHK_SIZE];	// integrity record
+#endif
+#if LOG_BINARY
+char	 text[LOG_TEXT_MAX_SIZE];	// binary record converted to text
+#endif
 
 
     /* Check for power-fail */
@@ -273,252 +727,2278 @@ UINT	 bytesWr;
     if (IsFileHandleValid(&l_fh) == false)
 	return;			// no file open or invalid file handle
 
-    /* Switch the SD-Card Interface on */
-    MICROSD_PowerOn();
-
-    /* Re-Initialize disk (mount is still the same!) */
-    if (disk_initialize(0) != 0)
+    /* Switch the SD-Card Interface on, re-initialize it if required */
+    if (DiskAcquire() != 0)
     {
 	if (--l_ErrMsgCnt >= 0)
 	    LogError ("LogFlush: SD-Card Initialization Failed");
     }
     else
     {
+	res = FR_OK;
+
+#if LOG_ROTATE
+	/* Start a new segment of the log file if required */
+	res = logRotateCheck();
+#endif
+
 	/* Write all log messages to disk */
-	while (idxLogGet != idxLogPut)
+	idxRd = idxLogGet;
+#if LOG_FLUSH_PAGED
+	/* The first page fills the current sector of the log file */
+	idxCopied = idxRd;
+	l_LogPageLen  = 0;
+	l_LogPageSize = LOG_PAGE_SIZE - (int)(l_fh.fptr % LOG_PAGE_SIZE);
+#endif
+#if LOG_COMPRESS
+	l_LzLen = 0;		// a new frame is started
+#endif
+	while (res == FR_OK  &&  idxRd != idxLogPut)
 	{
 	    /* again, check for power-fail */
 	    if (IsPowerFail())
 		break;
 
-	    cnt = l_LogBuf[idxLogGet];	// get string length
+#if LOG_BINARY  &&  defined(LOG_MONITOR_FUNCTION)
+	    /* binary records must be sent to the monitor before discarded */
+	    logMonitor();
+#endif
+
+	    cnt = (uint8_t)l_LogBuf[idxRd];	// get string length
 	    if (cnt == 0)
 	    {
-		idxLogGet = 0;		// length of 0 indicates wrap-around
-		cnt = l_LogBuf[idxLogGet];
+		/* length of 0 indicates wrap-around, see logBufRelease() */
+		idxRd = 0;
+		cnt = (uint8_t)l_LogBuf[idxRd];
 	    }
 
+	    if (cnt == LOG_ENTRY_BUSY)
+		break;			// entry is not committed yet
+
 	    /* consistency check: last char must be <NL> */
-	    if (l_LogBuf[idxLogGet + cnt] != '\n')
+	    if (l_LogBuf[idxRd + cnt] != '\n')
 	    {
 		LogError ("LogFlush: Consistency Check failed - c=0x%02X",
-			  l_LogBuf[idxLogGet + cnt]);
+			  l_LogBuf[idxRd + cnt]);
 		LogInit();	// reset logging system
+#if LOG_FLUSH_PAGED
+		idxCopied = idxLogGet;	// nothing left to release
+#endif
 		break;
 	    }
 
-	    /* write string to file without the terminating 0 (EOS) */
-	    res = f_write (&l_fh, l_LogBuf + idxLogGet + 1, cnt, &bytesWr);
-	    if (res != FR_OK)
+	    pStr = l_LogBuf + idxRd + 1;
+	    len  = cnt;			// length of text, <NL> included
+
+#if LOG_BINARY
+	    /* convert binary record to text */
+	    if (*pStr == LOG_REC_BINARY)
 	    {
-		if (--l_ErrMsgCnt >= 0)
-		    LogError ("LogFlush: Error Code %d", res);
-		break;
+		len  = logExpand (pStr, text);
+		pStr = text;
 	    }
+#endif
+	    idxRd += (cnt + 2);		// consider <len> byte and EOS
 
-	    if (bytesWr < cnt)
+#if LOG_INTEGRITY
+	    /* the text of the entry is covered by the integrity record */
+	    chkCrc  = logCrc32 (chkCrc, pStr, len);
+	    chkLen += len;
+	    if (len > LOG_STAMP_LEN)
 	    {
-		if (--l_ErrMsgCnt >= 0)
-		    LogError ("LogFlush: SD-Card Full");
-		res = FR_DISK_ERR;
-		break;
+		if (chkLen == (uint32_t)len)
+		    memcpy (chkFirst, pStr, LOG_STAMP_LEN);
+		memcpy (chkLast, pStr, LOG_STAMP_LEN);
 	    }
+#endif
 
-	    /* update index, consider <len> byte and EOS */
-	    idxLogGet += (cnt + 2);
-	}   // while (idxLogGet != idxLogPut)
+#if LOG_FLUSH_PAGED
+	    /* copy text into the page, write each page as soon as it is full */
+	    res = LOG_TEXT_PUT (pStr, len, idxCopied);
+	    if (res == FR_OK)
+		idxCopied = idxRd;
+#else
+	    /* write string to file without the terminating 0 (EOS) */
+	    res = logFileWrite (pStr, len);
+	    if (res == FR_OK)
+		logBufRelease (idxRd);
+#endif
+	}   // while (idxRd != idxLogPut)
+
+#if LOG_INTEGRITY
+	/* Append the integrity record of the text written by this flush */
+	if (res == FR_OK  &&  chkLen > 0)
+	{
+	    len = StrFormat (rec, LOG_CHK_TAG "%lu %s %s %lu %08lX\r\n",
+			     (unsigned long)++l_LogChkSeq, chkFirst, chkLast,
+			     (unsigned long)chkLen, (unsigned long)~chkCrc);
+#if LOG_FLUSH_PAGED
+	    res = LOG_TEXT_PUT (rec, len, idxCopied);
+#else
+	    res = logFileWrite (rec, len);
+#endif
+	}
+#endif
+
+#if LOG_COMPRESS
+	/* Terminate the frame */
+	if (res == FR_OK)
+	    res = logLzEnd (idxCopied);
+#endif
+
+#if LOG_FLUSH_PAGED
+	/* The rest is kept in the sector buffer of the file by FatFs */
+	if (res == FR_OK  &&  l_LogPageLen > 0)
+	    res = logPageWrite (l_LogPageLen);
+	if (res == FR_OK)
+	    logBufRelease (idxCopied);
+#endif
+
+	/* Let the other output streams write while the SD-Card is on */
+	for (cnt = 0;  res == FR_OK  &&  cnt < l_LogStreamCnt;  cnt++)
+	    l_LogStream[cnt]->Flush();
 
-	/* Synchronize file system */
+	/*
+	 * Synchronize file system.  During a series of flushes because of
+	 * LOG_SAMPLE_MAX_SIZE, this is only done every LOG_SYNC_INTERVAL
+	 * times.  In between FatFs writes complete sectors of its file buffer
+	 * only, without updating FAT and directory entry.
+	 */
 	if (res == FR_OK)
-	    f_sync (&l_fh);
+	{
+	    if (! l_flgLogSyncDefer  ||  ++l_LogSyncCnt >= LOG_SYNC_INTERVAL)
+	    {
+		f_sync (&l_fh);
+		l_LogSyncCnt = 0;
+		flgSynced = true;
+	    }
+	}
     }
+    l_flgLogSyncDefer = false;
+
+#if LOG_JOURNAL
+    /* Power is back, the entries of the journal are on the SD-Card now */
+    if (flgSynced  &&  l_flgJournalUsed  &&  ! IsPowerFail())
+	logJournalErase();
+#endif
 
     /* Check if SD-Card power should be left on */
     if (flgKeepPowerOn  &&  ! IsPowerFail())
 	return;
 
-    /* Switch the SD-Card Interface off */
-    MICROSD_PowerOff();
+    /* Retain the SD-Card Interface if all went well, otherwise switch off */
+    DiskRelease (res == FR_OK);
 
-    if (! IsPowerFail())
+    /* LED is only flashing if the log file is consistent on the SD-Card */
+    if (flgSynced  &&  ! IsPowerFail())
     {
 	/* Signal that Log Flushing is done by flashing the LED */
-	l_LogFlushLED_FlashCnt = LOG_FLASH_LED_CNT;
-	LOG_FLUSH_LED = 1;			// switch LED on
-	msTimerAction (logFlushLED);
-	msTimerStart (LOG_FLASH_LED_DELAY);	// flashing delay/frequency
+	LedPatternStart (LED_LOG_FLUSH, &l_LogFlushPattern);
     }
 
     /* Start timer to handle log flushing pause */
     if (l_thLogFlushCtrl != NONE)
-	sTimerStart (l_thLogFlushCtrl, LOG_FLUSH_PAUSE);
+	sTimerStartSlack (l_thLogFlushCtrl, LOG_FLUSH_PAUSE, LOG_FLUSH_SLACK);
 
     /* Inhibit flushing the log buffer for that time */
     l_flgLogFlushInhibit = true;
-    l_flgLogFlushTrigger = false;
+
+    /* If not synchronized yet, the next flush is done after the pause */
+    l_flgLogFlushTrigger = (res == FR_OK  &&  ! flgSynced);
+#if LOG_FLUSH_ADAPTIVE
+    l_flgLogFlushForce = l_flgLogFlushTrigger;
+#endif
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Check if Log Buffer should be Flushed
+ * @brief	Write Text into the Log File
  *
- * This routine is periodically called from the main loop to check if the log
- * buffer should be flushed, i.e. l_flgLogFlushTrigger is set, or more than
- * @ref LOG_SAMPLE_MAX_SIZE bytes have been stored in the log buffer.
+ * This routine is called by LogFlush() to write a log message, or a page of
+ * log messages, into the log file.  Errors are logged.
+ *
+ * @param[in] pStr
+ *	Text to write, there is no terminating 0 (EOS) required.
+ *
+ * @param[in] len
+ *	Number of bytes to write.
+ *
+ * @return
+ *	FatFs result code, FR_DISK_ERR if the SD-Card is full.
  *
  ******************************************************************************/
-void	 LogFlushCheck (void)
+static FRESULT	logFileWrite(const char *pStr, UINT len)
 {
-int	 cnt;			// allocated space in the log buffer
+FRESULT	 res;		// FatFs function common result code
+UINT	 bytesWr;
 
 
-    cnt = idxLogPut - idxLogGet;	// calculate allocated space
-    if (cnt < 0)
-	cnt += LOG_BUF_SIZE;		// wrap around
+    res = f_write (&l_fh, pStr, len, &bytesWr);
+    if (res != FR_OK)
+    {
+	if (--l_ErrMsgCnt >= 0)
+	    LogError ("LogFlush: Error Code %d", res);
+    }
+    else if (bytesWr < len)
+    {
+	if (--l_ErrMsgCnt >= 0)
+	    LogError ("LogFlush: SD-Card Full");
+	res = FR_DISK_ERR;
+    }
+    return res;
+}
 
-    if (cnt > LOG_SAMPLE_MAX_SIZE	// always flush if threshold is reached
-    ||  (l_flgLogFlushTrigger  &&  ! l_flgLogFlushInhibit))
+
+#if LOG_FLUSH_PAGED
+/***************************************************************************//**
+ *
+ * @brief	Put Text into the Page Buffer
+ *
+ * This routine is called by LogFlush() to copy text into @ref l_LogPage.
+ * Each time the page is full, it is written into the log file, and the
+ * entries which are completely written are released.
+ *
+ * @param[in] pStr
+ *	Text to copy, there is no terminating 0 (EOS) required.
+ *
+ * @param[in] len
+ *	Number of bytes to copy.
+ *
+ * @param[in] idxRelease
+ *	Index of the first entry which is not completely in the page buffer.
+ *
+ * @return
+ *	FatFs result code, FR_DISK_ERR if the SD-Card is full.
+ *
+ ******************************************************************************/
+static FRESULT	logPagePut(const char *pStr, int len, int idxRelease)
+{
+FRESULT	 res = FR_OK;	// FatFs function common result code
+int	 n;
+
+
+    while (len > 0)
     {
-	l_flgLogFlushTrigger = false;
+	n = l_LogPageSize - l_LogPageLen;
+	if (len < n)
+	    n = len;
+	memcpy (l_LogPage + l_LogPageLen, pStr, n);
+	l_LogPageLen += n;
+	pStr += n;
+	len  -= n;
+
+	if (l_LogPageLen == l_LogPageSize)
+	{
+	    res = logPageWrite (l_LogPageLen);
+	    if (res != FR_OK)
+		break;
 
-	LogFlush(false);
+	    /* release all entries which are completely written */
+	    logBufRelease (idxRelease);
+	    l_LogPageLen  = 0;
+	    l_LogPageSize = LOG_PAGE_SIZE;
+	}
     }
+    return res;
 }
 
 
 /***************************************************************************//**
  *
- * @brief	Log Message
+ * @brief	Write the Page Buffer into the Log File
  *
- * This routine writes the current time stamp, an optional prefix, and the
- * specified log message into the buffer.
+ * This routine is called by LogFlush() to write @ref l_LogPage.  With
+ * @ref LOG_ENCRYPT, the page is encrypted in place before, since it is built
+ * again from the log buffer if the write fails.
  *
- * The format of a log message is:
- * 20151231-235900 \<prefix\> \<message\>
+ * @param[in] len
+ *	Number of bytes to write.
+ *
+ * @return
+ *	FatFs result code, FR_DISK_ERR if the SD-Card is full.
  *
  ******************************************************************************/
-static void	logMsg(const char *prefix, const char *frmt, va_list args)
+static FRESULT	logPageWrite(int len)
 {
-char	 tmpBuffer[LOG_ENTRY_MAX_SIZE];	// use this if the log buffer is full
-char	*pBuf;				// pointer to the buffer to use
-int	 len, cnt, num;			// message length, available space
-struct tm    time;			// current time (hh:mm:ss)
-unsigned int ms;			// current [ms]
-
+#if LOG_ENCRYPT
+    if (l_flgLogCrypt)
+	LogCryptApply ((uint8_t *)l_LogPage, len, l_fh.fptr);
+#endif
 
-    /* Start timer to handle sample timeout */
-    if (l_flgLogFlushInhibit)
-	l_flgLogFlushTrigger = true;	// set flag for later
-    else if (l_thLogFlushCtrl != NONE)
-	sTimerStart (l_thLogFlushCtrl, LOG_SAMPLE_TIMEOUT);
+    return logFileWrite (l_LogPage, len);
+}
+#endif
 
-    /*
-     * First write complete log message into local buffer
-     */
-    pBuf = tmpBuffer;
 
-    /* Reserve one byte for string length information */
-    len = 1;
+#if LOG_COMPRESS
+/***************************************************************************//**
+ *
+ * @brief	Compress Text into the Page Buffer
+ *
+ * This routine is called by LogFlush() instead of logPagePut().  The first
+ * call after LogFlush() has been entered starts a frame, see
+ * @ref LOG_COMPRESS.  The text is appended to the window in chunks of up to
+ * @ref LOG_LZ_CHUNK bytes.  For each position, the most recent position
+ * with the same hash of the next 3 bytes is the only candidate of a match,
+ * so the effort per byte is constant.  All literals are put at the end of
+ * each call, so an entry is complete in the page buffer when it is released.
+ *
+ * @param[in] pStr
+ *	Text to compress, there is no terminating 0 (EOS) required.
+ *
+ * @param[in] len
+ *	Number of bytes.
+ *
+ * @param[in] idxRelease
+ *	Index of the first entry which is not completely in the page buffer.
+ *
+ * @return
+ *	FatFs result code, FR_DISK_ERR if the SD-Card is full.
+ *
+ ******************************************************************************/
+static FRESULT	logLzPut(const char *pStr, int len, int idxRelease)
+{
+FRESULT	 res = FR_OK;	// FatFs function common result code
+uint8_t	 token[2];	// token of a match
+uint32_t hash;
+int	 pos, lit, end;	// current position, first literal, end of chunk
+int	 dist, match, max;
+int	 n;
 
-    /* Store timestamp */
-    ClockGetMilliSec (&time, &ms);
 
-    if (time.tm_year != 0)
-    {
-	len += sprintf (pBuf + len,
-			"20%02d%02d%02d-%02d%02d%02d.%03d ",
-			time.tm_year,
-			time.tm_mon + 1,
-			time.tm_mday,
-			time.tm_hour,
-			time.tm_min,
-			time.tm_sec,
-			ms);
-    }
-    else
-    {
-	strcpy (pBuf + len, "00000000-000000.000 ");
-	len += 20;
-    }
+    if (l_LzLen == 0)
+	res = logPagePut (LOG_LZ_TAG, sizeof(LOG_LZ_TAG) - 1, idxRelease);
 
-    /* Store optional prefix */
-    if (prefix != NULL)
+    while (res == FR_OK  &&  len > 0)
     {
-	if (*prefix != EOS)
+	/* Keep the last LOG_LZ_WINDOW bytes, then append the next chunk */
+	n = (len < LOG_LZ_CHUNK ? len : LOG_LZ_CHUNK);
+	if (l_LzLen + n > (int)sizeof(l_LzBuf))
 	{
-	    strcpy (pBuf + len, prefix);
-	    len += strlen(prefix);
+	    l_LzPos += l_LzLen - LOG_LZ_WINDOW;
+	    memmove (l_LzBuf, l_LzBuf + l_LzLen - LOG_LZ_WINDOW, LOG_LZ_WINDOW);
+	    l_LzLen = LOG_LZ_WINDOW;
 	}
-    }
+	memcpy (l_LzBuf + l_LzLen, pStr, n);
+	pos = lit = l_LzLen;
+	end = l_LzLen += n;
+	pStr += n;
+	len  -= n;
 
-    /* Build and store the log message */
-    len += vsprintf(pBuf + len, frmt, args);
+	while (res == FR_OK  &&  pos < end)
+	{
+	    match = 0;
+	    if (end - pos >= LOG_LZ_MIN_MATCH)
+	    {
+		/* Candidate is the last position with the same hash */
+		hash = ((uint32_t)l_LzBuf[pos] << 16 | l_LzBuf[pos + 1] << 8
+			| l_LzBuf[pos + 2]) * 2654435761U;
+		hash >>= (32 - LOG_LZ_HASH_BITS);
+		dist = (uint16_t)(l_LzPos + pos - l_LzHead[hash]);
+		l_LzHead[hash] = (uint16_t)(l_LzPos + pos);
+
+		if (dist >= 1  &&  dist <= LOG_LZ_WINDOW  &&  dist <= pos)
+		{
+		    max = end - pos;
+		    if (max > LOG_LZ_MAX_MATCH)
+			max = LOG_LZ_MAX_MATCH;
+		    while (match < max
+			   &&  l_LzBuf[pos - dist + match] == l_LzBuf[pos + match])
+			match++;
+		}
+	    }
+
+	    if (match >= LOG_LZ_MIN_MATCH)
+	    {
+		res = logLzLiterals (lit, pos, idxRelease);
+		if (res == FR_OK)
+		{
+		    token[0] = 0x80 | (match - LOG_LZ_MIN_MATCH) << 1
+			       | (dist - 1) >> 8;
+		    token[1] = (uint8_t)(dist - 1);
+		    res = logPagePut ((const char *)token, 2, idxRelease);
+		}
+		pos += match;
+		lit  = pos;
+	    }
+	    else if (++pos - lit == LOG_LZ_MAX_LIT)
+	    {
+		res = logLzLiterals (lit, pos, idxRelease);
+		lit = pos;
+	    }
+	}
+
+	if (res == FR_OK)
+	    res = logLzLiterals (lit, end, idxRelease);
+    }
+
+    return res;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Put Literals of the Window into the Page Buffer
+ *
+ * @param[in] from
+ *	Index of the first literal in @ref l_LzBuf.
+ *
+ * @param[in] to
+ *	Index after the last literal, at most @ref LOG_LZ_MAX_LIT bytes.
+ *
+ * @param[in] idxRelease
+ *	Index of the first entry which is not completely in the page buffer.
+ *
+ * @return
+ *	FatFs result code, FR_DISK_ERR if the SD-Card is full.
+ *
+ ******************************************************************************/
+static FRESULT	logLzLiterals(int from, int to, int idxRelease)
+{
+FRESULT	 res = FR_OK;	// FatFs function common result code
+char	 token;
+
+
+    if (to > from)
+    {
+	token = (char)(to - from);
+	res = logPagePut (&token, 1, idxRelease);
+	if (res == FR_OK)
+	    res = logPagePut ((const char *)l_LzBuf + from, to - from,
+			      idxRelease);
+    }
+    return res;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Terminate the Current Frame
+ *
+ * @param[in] idxRelease
+ *	Index of the first entry which is not completely in the page buffer.
+ *
+ * @return
+ *	FatFs result code, FR_DISK_ERR if the SD-Card is full.
+ *
+ ******************************************************************************/
+static FRESULT	logLzEnd(int idxRelease)
+{
+    if (l_LzLen == 0)
+	return FR_OK;		// no frame started
+
+    l_LzLen = 0;
+    return logPagePut (LOG_LZ_END, sizeof(LOG_LZ_END) - 1, idxRelease);
+}
+#endif
+
+
+#if LOG_INTEGRITY
+/***************************************************************************//**
+ *
+ * @brief	Update a CRC-32
+ *
+ * This routine calculates the CRC-32 of zlib, i.e. the reflected polynomial
+ * 0xEDB88320, with a table of 16 entries, so two steps are done per byte.
+ * The EFM32G has no CRC unit.  The CRC must be initialized with 0xFFFFFFFF,
+ * and the final value is inverted.
+ *
+ * @param[in] crc
+ *	Current value of the CRC.
+ *
+ * @param[in] pData
+ *	Data to add.
+ *
+ * @param[in] len
+ *	Number of bytes.
+ *
+ * @return
+ *	Updated CRC.
+ *
+ ******************************************************************************/
+static uint32_t	logCrc32(uint32_t crc, const char *pData, int len)
+{
+static const uint32_t crcTab[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+    while (len-- > 0)
+    {
+	crc ^= (uint8_t)*pData++;
+	crc = (crc >> 4) ^ crcTab[crc & 0x0F];
+	crc = (crc >> 4) ^ crcTab[crc & 0x0F];
+    }
+    return crc;
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if Log Buffer should be Flushed
+ *
+ * This routine is periodically called from the main loop to check if the log
+ * buffer should be flushed, i.e. l_flgLogFlushTrigger is set, or more than
+ * @ref LOG_SAMPLE_MAX_SIZE bytes have been stored in the log buffer.
+ * In the latter case synchronizing the file system is deferred, see
+ * @ref LOG_SYNC_INTERVAL.  Binary records are sent to the monitor output here.
+ *
+ * If @ref LOG_FLUSH_ADAPTIVE is set, the threshold is halved for
+ * @ref LOG_FLUSH_BUSY_TIME seconds after it has been reached, or while the
+ * buffered entries are at risk, see logAtRisk().  A triggered flush may be
+ * held back by logFlushDue().  The pause of @ref LOG_FLUSH_PAUSE after a
+ * flush, i.e. the time to remove the SD-Card after the LED has flashed, is
+ * not changed.
+ *
+ ******************************************************************************/
+void	 LogFlushCheck (void)
+{
+int	 cnt;			// allocated space in the log buffer
+int	 maxSize = LOG_SAMPLE_MAX_SIZE;	// threshold to flush in any case
+
+#if LOG_BINARY  &&  defined(LOG_MONITOR_FUNCTION)
+    /* send new binary records to the monitor output */
+    logMonitor();
+#endif
+
+    cnt = idxLogPut - idxLogGet;	// calculate allocated space
+    if (cnt < 0)
+	cnt += LOG_BUF_SIZE;		// wrap around
+
+#if LOG_FLUSH_ADAPTIVE
+    /* Keep more space free while busy, or if the entries are at risk */
+    if ((int32_t)(l_LogBusyUntil - logNow()) > 0  ||  logAtRisk())
+	maxSize = LOG_SAMPLE_MAX_SIZE / 2;
+#endif
+
+    if (cnt > maxSize			// always flush if threshold is reached
+    ||  (l_flgLogFlushTrigger  &&  ! l_flgLogFlushInhibit))
+    {
+#if LOG_FLUSH_ADAPTIVE
+	if (cnt <= maxSize  &&  ! logFlushDue(cnt))
+	{
+	    l_flgLogFlushTrigger = false;	// held back, see logFlushDue()
+	    return;
+	}
+	if (cnt > maxSize)
+	    l_LogBusyUntil = logNow() + LOG_FLUSH_BUSY_TIME;
+	l_flgLogFlushForce = false;
+#endif
+	/* log messages are still arriving, file may be synchronized later */
+	l_flgLogSyncDefer = (cnt > maxSize);
+	l_flgLogFlushTrigger = false;
+
+	LogFlush(false);
+#if LOG_PRIORITY
+	logDropReport();
+#endif
+    }
+}
+TASK_REGISTER(TASK_PRIO_LOG, EVT_LOG, LogFlushCheck);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Request to Flush the Log Buffer
+ *
+ * This routine triggers LogFlushCheck() to flush the log buffer, without
+ * waiting for @ref LOG_SAMPLE_TIMEOUT.  A pause of @ref LOG_FLUSH_PAUSE is
+ * still observed.  It may be called in interrupt context.
+ *
+ ******************************************************************************/
+void	 LogFlushRequest (void)
+{
+#if LOG_FLUSH_ADAPTIVE
+    l_flgLogFlushForce = true;		// do not hold back
+#endif
+    l_flgLogFlushTrigger = true;
+    EVENT_POST(EVT_LOG);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Register an Output Stream
+ *
+ * This routine adds an output stream of another module to the list of
+ * streams which are flushed by LogFlush().  All streams are written in the
+ * same power cycle of the SD-Card as the log file, so additional files do
+ * not cause additional wake-ups of the card.  It must be called during
+ * initialization, i.e. before the first LogFlush().
+ *
+ * @param[in] pStream
+ *	Address of the stream descriptor, must be static.
+ *
+ * @return
+ *	Returns true if the stream has been registered, or false if the table
+ *	is full, see @ref LOG_STREAM_MAX.
+ *
+ ******************************************************************************/
+bool	 LogStreamRegister (const LOG_STREAM *pStream)
+{
+int	 i;
+
+
+    EFM_ASSERT (pStream != NULL  &&  pStream->Flush != NULL);
+
+    for (i = 0;  i < l_LogStreamCnt;  i++)
+	if (l_LogStream[i] == pStream)
+	    return true;		// already registered
+
+    if (l_LogStreamCnt >= LOG_STREAM_MAX)
+    {
+	LogError ("Log: No room to register output stream %s",
+		  pStream->Name);
+	return false;
+    }
+
+    l_LogStream[l_LogStreamCnt++] = pStream;
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Append Data to the File of an Output Stream
+ *
+ * This routine is called by the flush function of an output stream, i.e.
+ * from LogFlush() while the SD-Card is switched on.  It opens the file of
+ * the stream, appends up to two pieces of data, e.g. both parts of a wrapped
+ * ring buffer, and closes the file again.  All streams share one file handle
+ * to save the RAM for the sector buffer of each FIL structure.
+ *
+ * @param[in] pStream
+ *	Address of the stream descriptor.
+ *
+ * @param[in] align
+ *	Size of a record in the file.  A partial record at the end of the file,
+ *	e.g. after a power-fail, is overwritten.  Use 1 for a text file.
+ *
+ * @param[in] pData1
+ *	Address of the first piece of data.
+ *
+ * @param[in] len1
+ *	Length of the first piece, may be 0.
+ *
+ * @param[in] pData2
+ *	Address of the second piece of data.
+ *
+ * @param[in] len2
+ *	Length of the second piece, may be 0.
+ *
+ * @return
+ *	Returns true if all data has been written.  Otherwise an error has been
+ *	logged, and the caller should keep the data for the next call.
+ *
+ ******************************************************************************/
+bool	 LogStreamAppend (const LOG_STREAM *pStream, unsigned int align,
+			  const void *pData1, unsigned int len1,
+			  const void *pData2, unsigned int len2)
+{
+FRESULT	 res;
+UINT	 cnt;
+DWORD	 size;
+
+
+    if (l_flgStreamFhBusy)
+	res = FR_LOCKED;		// borrowed by another module
+    else
+	res = f_open (&l_StreamFh, pStream->FileName,
+		      FA_WRITE | FA_OPEN_ALWAYS);
+    if (res == FR_OK)
+    {
+	/* a new file may have been created */
+	size = f_size(&l_StreamFh);
+	if (size == 0)
+	    FindFileCacheInvalidate();
+
+	if (align > 1)
+	    size -= size % align;
+
+	res = f_lseek (&l_StreamFh, size);
+
+	if (res == FR_OK  &&  len1 > 0)
+	{
+	    res = f_write (&l_StreamFh, pData1, len1, &cnt);
+	    if (res == FR_OK  &&  cnt != len1)
+		res = FR_DENIED;		// disk full
+	}
+	if (res == FR_OK  &&  len2 > 0)
+	{
+	    res = f_write (&l_StreamFh, pData2, len2, &cnt);
+	    if (res == FR_OK  &&  cnt != len2)
+		res = FR_DENIED;
+	}
+
+	if (f_close (&l_StreamFh) != FR_OK  &&  res == FR_OK)
+	    res = FR_DISK_ERR;
+    }
+
+    if (res != FR_OK)
+    {
+	LogError ("%s: Error Code %d writing %s", pStream->Name, res,
+		  pStream->FileName);
+	return false;
+    }
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Borrow the File Handle of the Output Streams
+ *
+ * The file handle of the output streams is only used by LogStreamAppend()
+ * while LogFlush() runs.  A module which needs a file for a short time, e.g.
+ * to export its data, borrows this handle by LogFileHandleGet() instead of
+ * keeping a FIL structure of its own, and returns it by LogFileHandlePut().
+ * The file must be opened and closed again in between, without a call of
+ * LogFlush().  Both routines must only be called from the main loop.
+ *
+ * @return
+ *	Address of the file handle, or NULL if it has already been borrowed.
+ *
+ ******************************************************************************/
+FIL	*LogFileHandleGet (void)
+{
+    if (l_flgStreamFhBusy)
+	return NULL;
+
+    l_flgStreamFhBusy = true;
+    return &l_StreamFh;
+}
+
+void	 LogFileHandlePut (FIL *pFh)
+{
+    EFM_ASSERT (pFh == &l_StreamFh  &&  l_flgStreamFhBusy);
+
+    l_flgStreamFhBusy = false;
+}
+
+
+#if LOG_FLUSH_ADAPTIVE
+/***************************************************************************//**
+ *
+ * @brief	Set the Battery State of Charge
+ *
+ * This routine is called by the battery monitor with the current state of
+ * charge.  It is used by logFlushDue() and logAtRisk().
+ *
+ * @param[in] soc
+ *	Relative state of charge of the battery in [%].
+ *
+ ******************************************************************************/
+void	 LogFlushSoC (int soc)
+{
+    l_LogSoC = soc;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Current Time in Seconds
+ *
+ * This routine returns the monotonic clock in seconds, see ClockMonoTicks().
+ *
+ ******************************************************************************/
+static uint32_t	logNow(void)
+{
+    return (uint32_t)(ClockMonoTicks() / RTC_COUNTS_PER_SEC);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if the Buffered Entries are at Risk
+ *
+ * The entries in the log buffer are at risk, if a power-fail is active or
+ * likely, i.e. the state of charge is below @ref LOG_FLUSH_SOC_RISK, or if
+ * the journal is not available to save them, see LogPowerFailHandler().
+ *
+ * @return
+ *	true if the log buffer should not be held back.
+ *
+ ******************************************************************************/
+static bool	logAtRisk(void)
+{
+    if (IsPowerFail())
+	return true;
+
+    if (l_LogSoC >= 0  &&  l_LogSoC < LOG_FLUSH_SOC_RISK)
+	return true;
+
+#if LOG_JOURNAL
+    if (l_flgJournalUsed)
+	return true;		// journal has not been erased yet
+#endif
+
+    return false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if a triggered Flush is Due
+ *
+ * This routine is called by LogFlushCheck() after @ref LOG_SAMPLE_TIMEOUT.
+ * The log buffer is flushed if requested by LogFlushRequest(), if the file
+ * is not synchronized yet, if the entries are at risk, or if at least
+ * @ref LOG_FLUSH_MIN_BATCH bytes are buffered.  A smaller batch is held back
+ * until its oldest entry is @ref LOG_FLUSH_MAX_HOLD seconds old, twice as
+ * long below @ref LOG_FLUSH_SOC_SAVE, since each flush costs a power cycle
+ * of the SD-Card.  The timer is then started for the remaining time.
+ *
+ * @param[in] cnt
+ *	Number of bytes in the log buffer.
+ *
+ * @return
+ *	true if the log buffer should be flushed now.
+ *
+ ******************************************************************************/
+static bool	logFlushDue(int cnt)
+{
+uint32_t hold = LOG_FLUSH_MAX_HOLD;	// maximum hold time in [s]
+uint32_t age;				// age of the oldest entry in [s]
+
+
+    if (l_flgLogFlushForce  ||  cnt >= LOG_FLUSH_MIN_BATCH  ||  logAtRisk())
+	return true;
+
+    if (cnt == 0)
+	return false;			// nothing to write
+
+    if (l_LogSoC >= 0  &&  l_LogSoC < LOG_FLUSH_SOC_SAVE)
+	hold *= 2;			// save SD-Card power cycles
+
+    age = logNow() - l_LogOldest;
+    if (age >= hold)
+	return true;
+
+    /* Check again when the hold time is over */
+    if (l_thLogFlushCtrl != NONE)
+	sTimerStartSlack (l_thLogFlushCtrl, hold - age, LOG_FLUSH_SLACK);
+
+    return false;
+}
+#endif
+
+
+#if LOG_JOURNAL
+/***************************************************************************//**
+ *
+ * @brief	Log Power-Fail Handler
+ *
+ * This routine is called by PowerFailCheck() in case of power-fail.  It saves
+ * the entries of the log buffer, which have not been written to the SD-Card
+ * yet, into the journal.  Only the used part of the log buffer is programmed,
+ * at the same offset as in @ref l_LogBuf.  The header is written last, so an
+ * interrupted write results in an invalid journal.  The journal must have
+ * been erased before, i.e. it is only written once until the entries are on
+ * the SD-Card, see logJournalErase().
+ *
+ ******************************************************************************/
+void	 LogPowerFailHandler (void)
+{
+LOG_JOURNAL_HDR	 hdr;		// header of the journal
+uint32_t	*pData = (uint32_t *)LOG_JOURNAL_DATA;
+int		 idx;		// word aligned index of the first entry
+msc_Return_TypeDef res;
+
+
+    if (l_flgJournalUsed)
+	return;			// journal not erased, or not available
+
+    /* snapshot of the indices, later entries are not saved */
+    hdr.IdxGet = idxLogGet;
+    hdr.IdxPut = idxLogPut;
+    if (hdr.IdxGet == hdr.IdxPut)
+	return;			// log buffer is empty
+
+    hdr.BuildTag = LOG_JOURNAL_BUILD_TAG;
+    hdr.Magic = LOG_JOURNAL_MAGIC;
+
+    l_flgJournalUsed = true;
+
+    MSC_Init();
+
+    /* program the entries, consider wrap-around */
+    idx = hdr.IdxGet & ~3;
+    if (hdr.IdxPut > hdr.IdxGet)
+    {
+	res = MSC_WriteWord (pData + idx / 4, l_LogBuf + idx,
+			     ((hdr.IdxPut + 3) & ~3) - idx);
+    }
+    else
+    {
+	res = MSC_WriteWord (pData + idx / 4, l_LogBuf + idx,
+			     LOG_BUF_SIZE - idx);
+	if (res == mscReturnOk  &&  hdr.IdxPut > 0)
+	    res = MSC_WriteWord (pData, l_LogBuf, (hdr.IdxPut + 3) & ~3);
+    }
+
+    /* write the header, the magic is the last word */
+    if (res == mscReturnOk)
+	res = MSC_WriteWord (__LogJournalStart, &hdr, sizeof(hdr) - 4);
+    if (res == mscReturnOk)
+	res = MSC_WriteWord (__LogJournalStart + 3, &hdr.Magic, 4);
+
+    MSC_Deinit();
+
+    if (res != mscReturnOk)
+	LogError ("LogPowerFailHandler: Journal Write Error %d", res);
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Log Message
+ *
+ * This routine writes the current time stamp, an optional prefix, and the
+ * specified log message into the buffer.  If @ref LOG_BINARY is enabled, the
+ * message is stored as binary record, see logMsgBinary(), and converted to
+ * text later.
+ *
+ * The format of a log message is:
+ * 20151231-235900 \<prefix\> \<message\>
+ *
+ ******************************************************************************/
+static void	logMsg(int prio, const char *prefix, const char *frmt,
+		       va_list args)
+{
+char	*tmpBuffer = NULL;		// use this if the log buffer is full
+char	*pBuf;				// pointer to the buffer to use
+int	 idxPut;			// reserved entry in the log buffer
+int	 len;				// message length
+struct tm    time;			// current time (hh:mm:ss)
+unsigned int ms;			// current [ms]
+#if LOG_BINARY
+va_list	 argsCopy;			// arguments for logMsgBinary()
+bool	 flgDone;
+#endif
+
+
+#if LOG_FLUSH_ADAPTIVE
+    /* Remember the age of the oldest entry, see logFlushDue() */
+    if (idxLogPut == idxLogGet)
+	l_LogOldest = logNow();
+#endif
+
+    /* Start timer to handle sample timeout */
+    if (l_flgLogFlushInhibit)
+	l_flgLogFlushTrigger = true;	// set flag for later
+    else if (l_thLogFlushCtrl != NONE)
+	sTimerStart (l_thLogFlushCtrl, LOG_SAMPLE_TIMEOUT);
+
+#if LOG_BINARY
+    /* Try to store a binary record, otherwise use the text format */
+    va_copy (argsCopy, args);
+    flgDone = logMsgBinary (prio, prefix, frmt, argsCopy);
+    va_end (argsCopy);
+
+    if (flgDone)
+	return;
+#endif
+
+    /*
+     * Reserve the maximum entry size in the log buffer, so the message can
+     * directly be written into it.  A scratch block is only used if there
+     * is not enough space, then logBufPut() tries to store the exact size.
+     * Without a free block, e.g. in an interrupt which preempted the main
+     * loop while it holds all of them, the message is lost.
+     */
+    idxPut = logBufReserve (LOG_ENTRY_MAX_SIZE, prio);
+    if (idxPut >= 0)
+    {
+	pBuf = l_LogBuf + idxPut;
+    }
+    else
+    {
+	pBuf = tmpBuffer = ScratchGet();
+	if (pBuf == NULL)
+	{
+	    l_LostEntryCnt++;
+	    return;
+	}
+    }
+
+    /* Reserve one byte for string length information */
+    len = 1;
+
+    /* Store timestamp */
+    ClockGetMilliSec (&time, &ms);
+
+    if (time.tm_year != 0)
+    {
+	len += StrFormat (pBuf + len,
+			  "20%02d%02d%02d-%02d%02d%02d.%03d ",
+			  time.tm_year,
+			  time.tm_mon + 1,
+			  time.tm_mday,
+			  time.tm_hour,
+			  time.tm_min,
+			  time.tm_sec,
+			  ms);
+    }
+    else
+    {
+	strcpy (pBuf + len, "00000000-000000.000 ");
+	len += 20;
+    }
+
+    /* Store optional prefix */
+    if (prefix != NULL)
+    {
+	if (*prefix != EOS)
+	{
+	    strcpy (pBuf + len, prefix);
+	    len += strlen(prefix);
+	}
+    }
+
+    /* Build and store the log message, leave space for <CR><LF> EOS */
+    len += StrFormatV (pBuf + len, LOG_ENTRY_MAX_SIZE - 3 - len, frmt, args);
+
+    /* add <CR><LF> */
+    strcpy (pBuf + len, "\r\n");
+    len += 3;			// <CR> <LF> EOS
+
+    if (idxPut >= 0)
+    {
+	logBufCommit (idxPut, LOG_ENTRY_MAX_SIZE, len);
+    }
+    else if (! logBufPut (tmpBuffer, len, prio))
+    {
+#ifdef LOG_MONITOR_FUNCTION
+	/* first output the original message */
+	LOG_MONITOR_FUNCTION (tmpBuffer + 1);
+
+	/* then generate and output error message */
+	StrFormat (tmpBuffer + 1, "ERROR: Log Buffer Out of Memory"
+				  " - lost %ld Messages\n", LogLostCount());
+#endif
+    }
+
+    /* Finally send the complete log message to the monitor output */
+#ifdef LOG_MONITOR_FUNCTION
+    LOG_MONITOR_FUNCTION (pBuf + 1);
+#endif
+#if LOG_TAIL_SIZE > 0
+    logTailPut (pBuf + 1);
+#endif
+    ScratchPut (tmpBuffer);
+}
+
+
+#if LOG_TAIL_SIZE > 0
+/***************************************************************************//**
+ *
+ * @brief	Put Message into the Tail Buffer
+ *
+ * This routine copies the text of a log message into the ring buffer
+ * @ref l_LogTail, where the oldest text is overwritten.  \<CR> characters
+ * are omitted.  It may be called from interrupt context.
+ *
+ * @param[in] pStr
+ *	Log message, terminated by \<LF> and EOS.
+ *
+ ******************************************************************************/
+static void	logTailPut(const char *pStr)
+{
+CRIT_STATE crit;
+
+    crit = CritEnter (INT_CEIL_LOG);
+
+    for ( ;  *pStr != EOS;  pStr++)
+    {
+	if (*pStr == '\r')
+	    continue;
+
+	l_LogTail[l_LogTailPut] = *pStr;
+	if (++l_LogTailPut >= LOG_TAIL_SIZE)
+	{
+	    l_LogTailPut = 0;
+	    l_flgLogTailWrap = true;
+	}
+    }
+
+    CritExit (crit);
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the most recent Log Messages
+ *
+ * This routine copies the text of the most recent log messages from the tail
+ * buffer, see @ref LOG_TAIL_SIZE, into the specified buffer.  The oldest
+ * message comes first, and the text always starts at the beginning of a
+ * message.  The buffer is not terminated by EOS.
+ *
+ * @param[out] pBuf
+ *	Buffer to store the text.
+ *
+ * @param[in] size
+ *	Size of the buffer in bytes.
+ *
+ * @return
+ *	Number of bytes stored in the buffer, 0 if there are no messages.
+ *
+ ******************************************************************************/
+int	 LogTailGet (char *pBuf, int size)
+{
+#if LOG_TAIL_SIZE > 0
+int	 cnt, idx, skip;
+CRIT_STATE crit;
+
+
+    crit = CritEnter (INT_CEIL_LOG);
+
+    cnt = (l_flgLogTailWrap ? LOG_TAIL_SIZE : l_LogTailPut);
+    skip = (cnt > size  ||  l_flgLogTailWrap);	// first line may be partial
+    if (cnt > size)
+	cnt = size;
+
+    idx = l_LogTailPut - cnt;
+    if (idx < 0)
+	idx += LOG_TAIL_SIZE;
+
+    /* skip the partial message at the beginning */
+    while (skip  &&  cnt > 0)
+    {
+	cnt--;
+	skip = (l_LogTail[idx] != '\n');
+	if (++idx >= LOG_TAIL_SIZE)
+	    idx = 0;
+    }
+
+    for (size = 0;  size < cnt;  size++)
+    {
+	pBuf[size] = l_LogTail[idx];
+	if (++idx >= LOG_TAIL_SIZE)
+	    idx = 0;
+    }
+
+    CritExit (crit);
+
+    return cnt;
+#else
+    (void) pBuf;
+    (void) size;
+
+    return 0;
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Number of lost Log Entries
+ *
+ * @return
+ *	Number of log entries, which have been lost because the log buffer was
+ *	full.
+ *
+ ******************************************************************************/
+uint32_t LogLostCount (void)
+{
+#if LOG_PRIORITY
+    return l_LostEntryCnt + l_LogDropCnt[LOG_PRIO_LOW]
+			  + l_LogDropCnt[LOG_PRIO_NORMAL];
+#else
+    return l_LostEntryCnt;
+#endif
+}
+
+
+#if LOG_PRIORITY
+/***************************************************************************//**
+ *
+ * @brief	Report dropped Log Entries
+ *
+ * This routine is called by LogFlushCheck() after the log buffer has been
+ * flushed.  If entries have been dropped because of their priority, their
+ * number is logged and the counters are cleared.  This is deferred while
+ * entries of low priority would still be dropped, e.g. without SD-Card.
+ *
+ ******************************************************************************/
+static void	logDropReport(void)
+{
+uint32_t cntLow, cntNormal;
+int	 cnt;			// allocated space in the log buffer
+CRIT_STATE crit;
+
+
+    cnt = idxLogPut - idxLogGet;
+    if (cnt < 0)
+	cnt += LOG_BUF_SIZE;
+    if (cnt + LOG_ENTRY_MAX_SIZE + LOG_RESERVE_LOW >= LOG_BUF_SIZE)
+	return;			// still under pressure
+
+    crit = CritEnter (INT_CEIL_LOG);
+    cntLow    = l_LogDropCnt[LOG_PRIO_LOW];
+    cntNormal = l_LogDropCnt[LOG_PRIO_NORMAL];
+    l_LogDropCnt[LOG_PRIO_LOW] = l_LogDropCnt[LOG_PRIO_NORMAL] = 0;
+    CritExit (crit);
+
+    if (cntLow + cntNormal > 0)
+	LogEvent ("Log Buffer: Dropped %ld low and %ld normal priority"
+		  " entries", cntLow, cntNormal);
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Put Entry into the Log Buffer
+ *
+ * This routine copies a log entry into the log buffer.  The entry consists
+ * of the length byte, the message which must end with \<NL\>, and EOS.  If
+ * there is not enough space in the buffer, the entry is counted as lost.
+ * An entry which is rejected because of its priority is counted as dropped,
+ * see @ref LOG_PRIORITY.
+ *
+ * The buffer space is reserved by advancing @ref idxLogPut via LDREX/STREX,
+ * i.e. without disabling interrupts.  If an interrupt handler logs a message
+ * in between, the exclusive store fails and the reservation is repeated.
+ * The message is then copied outside of any critical section, and finally
+ * committed by writing its length byte, which has been set to
+ * @ref LOG_ENTRY_BUSY before.  LogFlush() stops at uncommitted entries.
+ *
+ * @param[in] pEntry
+ *	Address of the entry, its length byte is set by this routine.
+ *
+ * @param[in] len
+ *	Size of the entry including the length byte and EOS.
+ *
+ * @param[in] prio
+ *	Priority of the entry, see logBufReserve().
+ *
+ * @return
+ *	The value <i>true</i> if the entry has been stored, <i>false</i> if it
+ *	has been lost.
+ *
+ ******************************************************************************/
+static bool	logBufPut(char *pEntry, int len, int prio)
+{
+int	 idxPut;			// reserved entry
+CRIT_STATE crit;
+
+
+    /* Reserve space in the log buffer */
+    idxPut = logBufReserve (len, prio);
+    if (idxPut < 0)
+    {
+	/* Not enough space in buffer - skip entry and count as "lost" */
+	crit = CritEnter (INT_CEIL_LOG);
+#if LOG_PRIORITY
+	if (prio < LOG_PRIO_HIGH)
+	    l_LogDropCnt[prio]++;
+	else
+#endif
+	l_LostEntryCnt++;
+	CritExit (crit);
+
+	return false;
+    }
+
+    /* copy message into log buffer, length byte is still LOG_ENTRY_BUSY */
+    memcpy (l_LogBuf + idxPut + 1, pEntry + 1, len - 1);
+
+    /* Commit entry by storing its string length */
+    logBufCommit (idxPut, len, len);
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Reserve Space in the Log Buffer
+ *
+ * This routine reserves <b>len</b> bytes in the log buffer.  If the remaining
+ * space to the end of the buffer is too small, the entry wraps around.  It
+ * may be called from interrupt context, the reservation is done lock-free.
+ *
+ * @param[in] len
+ *	Number of bytes to reserve, including <len> byte and EOS.
+ *
+ * @param[in] prio
+ *	Priority of the entry.  If @ref LOG_PRIORITY is set, the free space
+ *	after an entry of low or normal priority must not fall below
+ *	@ref LOG_RESERVE_LOW or @ref LOG_RESERVE_NORMAL respectively.
+ *
+ * @return
+ *	Index of the reserved entry, or -1 if there is not enough space.
+ *
+ ******************************************************************************/
+static int	logBufReserve(int len, int prio)
+{
+int	 cnt, num;			// available space
+int	 idxPut, idxNext;		// reserved entry, next entry
+int	 need = len;			// required free space
+
+#if LOG_PRIORITY
+    if (prio < LOG_PRIO_HIGH)
+	need += l_LogPrioReserve[prio];
+#else
+    (void) prio;
+#endif
+
+
+    do
+    {
+	idxPut = (int)__LDREXW((volatile uint32_t *)&idxLogPut);
+
+	/* Check if there is enough space in the log buffer */
+	num = LOG_BUF_SIZE - idxPut;	// distance to end of buffer
+	if (num > len + 1)
+	    num = 0;			// enough space, no additional memory
+
+	cnt = idxPut + num - idxLogGet;	// calculate allocated space
+	if (cnt < 0)
+	    cnt += LOG_BUF_SIZE;	// wrap around
+
+	cnt = LOG_BUF_SIZE - cnt - 1;	// calculate free space
+
+	if (cnt < need)
+	{
+	    __CLREX();
+	    return -1;			// not enough space in buffer
+	}
+
+	idxNext = (num > 0 ? len : idxPut + len);
+
+    } while (__STREXW((uint32_t)idxNext, (volatile uint32_t *)&idxLogPut) != 0);
+
+    ITM_TRACE_QUEUE(ITM_QUE_LOG, LOG_BUF_SIZE - 1 - cnt + len);
+
+    if (num > 0)
+    {
+	l_LogBuf[idxPut] = 0;		// mark wrap-around
+	idxPut = 0;			// adjust start of new log message
+    }
+
+    return idxPut;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Commit an Entry in the Log Buffer
+ *
+ * This routine commits an entry which has been reserved by logBufReserve().
+ * If the entry is shorter than the reserved space, the rest is given back,
+ * unless another entry has been reserved meanwhile, e.g. from an interrupt.
+ * In this case the message is padded with blanks.
+ *
+ * @param[in] idxPut
+ *	Index of the reserved entry.
+ *
+ * @param[in] size
+ *	Number of reserved bytes.
+ *
+ * @param[in] len
+ *	Length of the entry, including <len> byte and EOS.
+ *
+ ******************************************************************************/
+static void	logBufCommit(int idxPut, int size, int len)
+{
+    if (len < size)
+    {
+	/* the next entry starts here, it must be marked as not committed */
+	memset (l_LogBuf + idxPut + len, LOG_ENTRY_BUSY, size - len);
+	LOG_MEMORY_BARRIER();
+
+	do
+	{
+	    if ((int)__LDREXW((volatile uint32_t *)&idxLogPut) != idxPut + size)
+	    {
+		__CLREX();
+
+		/* space is in use - move <CR><LF> EOS to the end */
+		memset (l_LogBuf + idxPut + len - 3, ' ', size - len);
+		strcpy (l_LogBuf + idxPut + size - 3, "\r\n");
+		len = size;
+		break;
+	    }
+	} while (__STREXW((uint32_t)(idxPut + len),
+			  (volatile uint32_t *)&idxLogPut) != 0);
+    }
+
+    /* Commit entry by storing its string length */
+    LOG_MEMORY_BARRIER();
+    l_LogBuf[idxPut] = len - 2;		// no <len> byte, no EOS
+
+    EVENT_POST(EVT_LOG);		// LogFlushCheck() may flush the buffer
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Release Entries of the Log Buffer
+ *
+ * This routine is called by LogFlush() to release all entries from
+ * @ref idxLogGet up to the specified index, after they have been written to
+ * the log file.  The space is filled with @ref LOG_ENTRY_BUSY again.
+ *
+ * @param[in] idx
+ *	Index of the first entry which is not released.
+ *
+ ******************************************************************************/
+static void	logBufRelease(int idx)
+{
+int	 cnt;
+
+
+    while (idxLogGet != idx)
+    {
+	cnt = (uint8_t)l_LogBuf[idxLogGet];	// get string length
+	if (cnt == 0)
+	{
+	    /* length of 0 indicates wrap-around, release rest of buffer */
+	    memset (l_LogBuf + idxLogGet, LOG_ENTRY_BUSY,
+		    LOG_BUF_SIZE - idxLogGet);
+	    LOG_MEMORY_BARRIER();
+	    idxLogGet = 0;
+	    continue;
+	}
+
+	/* release entry, update index, consider <len> byte and EOS */
+	memset (l_LogBuf + idxLogGet, LOG_ENTRY_BUSY, cnt + 2);
+	LOG_MEMORY_BARRIER();
+	idxLogGet += (cnt + 2);
+    }
+}
+
+
+#if LOG_BINARY
+/***************************************************************************//**
+ *
+ * @brief	Log Message as Binary Record
+ *
+ * This routine stores a log message as binary record into the log buffer.
+ * Instead of the formatted text, only the address of the format string, the
+ * UNIX time with milliseconds, and the raw arguments are stored.  Strings
+ * (%s) are copied into the record, since they may be located on the stack.
+ * The record is converted to text by logExpand() when the log buffer is
+ * flushed, or the log monitor is called from LogFlushCheck().
+ *
+ * The record has the following layout (after the length byte):
+ * - @ref LOG_REC_BINARY as marker
+ * - flags, i.e. @ref LOG_REC_FLG_ERROR
+ * - address of the format string (4 bytes)
+ * - UNIX time (4 bytes) and milliseconds (2 bytes)
+ * - one 32bit word for each argument, or the EOS
+ *   terminated string for "%s"
+ * - \<NL\> for the consistency check of LogFlush()
+ *
+ * @return
+ *	The value <i>true</i> if the message has been handled, <i>false</i> if
+ *	it must be logged as text.  This is the case if the format string is
+ *	not located in flash memory, contains unsupported conversions, or the
+ *	record would exceed @ref LOG_ENTRY_MAX_SIZE.
+ *
+ ******************************************************************************/
+static bool	logMsgBinary(int prio, const char *prefix, const char *frmt,
+			     va_list args)
+{
+char	 rec[LOG_ENTRY_MAX_SIZE];	// <len> byte and record
+char	*pRec;				// current position in the record
+char	*pEnd;				// end of record, consider <NL> and EOS
+const char *pFrmt;			// current position in format string
+const char *pStr;			// string argument
+int	 longCnt, len;
+uint32_t word, subSec;
+CRIT_STATE crit;
+
+
+    /* Format string is evaluated later, it must be a constant in flash */
+    if ((uint32_t)frmt >= SRAM_BASE)
+	return false;
+
+    pRec = rec + 1 + LOG_REC_HDR_SIZE;
+    pEnd = rec + sizeof(rec) - 2;
+
+    for (pFrmt = frmt;  *pFrmt != EOS;  pFrmt++)
+    {
+	if (*pFrmt != '%')
+	    continue;
+
+	if (*++pFrmt == '%')
+	    continue;		// "%%" has no argument
+
+	/* skip flags, width, precision, and length modifiers */
+	for (longCnt = 0;  *pFrmt != EOS  &&  strchr (LOG_REC_SPEC_CHARS, *pFrmt);
+	     pFrmt++)
+	{
+	    if (*pFrmt == 'l')
+		longCnt++;
+	}
+
+	switch (*pFrmt)
+	{
+	    case 's':
+		pStr = va_arg (args, const char *);
+		len = strlen (pStr) + 1;
+		if (pRec + len > pEnd)
+		    return false;	// record too large
+		memcpy (pRec, pStr, len);
+		pRec += len;
+		break;
+
+	    case 'd':
+	    case 'i':
+	    case 'u':
+	    case 'x':
+	    case 'X':
+	    case 'c':
+		if (longCnt >= 2)
+		    return false;	// "ll" is not supported by StrFormatV()
+		if (pRec + sizeof(word) > pEnd)
+		    return false;	// record too large
+		word = va_arg (args, uint32_t);
+		memcpy (pRec, &word, sizeof(word));
+		pRec += sizeof(word);
+		break;
+
+	    default:		// unsupported conversion, e.g. '*' or float
+		return false;
+	}
+    }
+
+    /* Header: marker, flags, format string, and time stamp */
+    rec[1] = LOG_REC_BINARY;
+    rec[2] = (prefix != NULL ? LOG_REC_FLG_ERROR : 0);
+    memcpy (rec + 3, &frmt, sizeof(frmt));
+
+    crit = CritEnter (INT_CEIL_CLOCK);
+#if RTC_TICKLESS
+    subSec = (RTC->CNT + clockGetTickOffset()) % RTC_COUNTS_PER_SEC;
+#else
+    subSec = (RTC->CNT - RTC->COMP0) % RTC_COUNTS_PER_SEC;
+#endif
+    word   = (uint32_t)time (NULL);
+    CritExit (crit);
+    memcpy (rec + 7, &word, sizeof(word));
+    rec[11] = (subSec * 1000 / RTC_COUNTS_PER_SEC) & 0xFF;
+    rec[12] = (subSec * 1000 / RTC_COUNTS_PER_SEC) >> 8;
+
+    /* Terminate record */
+    *pRec++ = '\n';
+    *pRec++ = EOS;
+
+    logBufPut (rec, pRec - rec, prio);
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Expand Binary Record to Text
+ *
+ * This routine converts a binary log record, which has been stored by
+ * logMsgBinary(), into the same text format as generated by logMsg().
+ *
+ * @param[in] pRec
+ *	Address of the binary record, i.e. the byte after the length byte.
+ *
+ * @param[out] pBuf
+ *	Buffer for the text, must be at least @ref LOG_TEXT_MAX_SIZE bytes.
+ *
+ * @return
+ *	Length of the text without EOS.
+ *
+ ******************************************************************************/
+static int	logExpand(const char *pRec, char *pBuf)
+{
+const char *pFrmt;			// current position in format string
+const char *pArg;			// current argument of the record
+char	 spec[12];			// conversion specification
+struct tm    time;			// time of the record
+time_t	 t;
+uint32_t word;
+int	 len, n, longCnt;
+CRIT_STATE crit;
+const int max = LOG_TEXT_MAX_SIZE - 3;	// reserve <CR> <LF> EOS
+
+
+    /* Get format string and time stamp */
+    memcpy (&pFrmt, pRec + 2, sizeof(pFrmt));
+    memcpy (&word, pRec + 6, sizeof(word));
+    t = (time_t)word;
+
+    /* localtime() is also used by the RTC interrupt */
+    crit = CritEnter (INT_CEIL_CLOCK);
+    time = *localtime (&t);
+    CritExit (crit);
+
+    if (time.tm_year != 0)
+    {
+	len = StrFormat (pBuf, "20%02d%02d%02d-%02d%02d%02d.%03d ",
+			 time.tm_year, time.tm_mon + 1, time.tm_mday,
+			 time.tm_hour, time.tm_min, time.tm_sec,
+			 (uint8_t)pRec[10] | ((uint8_t)pRec[11] << 8));
+    }
+    else
+    {
+	strcpy (pBuf, "00000000-000000.000 ");
+	len = 20;
+    }
+
+    /* Optional prefix */
+    if (pRec[1] & LOG_REC_FLG_ERROR)
+    {
+	strcpy (pBuf + len, "ERROR ");
+	len += 6;
+    }
+
+    /* Format message, one conversion after another */
+    pArg = pRec + LOG_REC_HDR_SIZE;
+
+    while (*pFrmt != EOS  &&  len < max)
+    {
+	if (*pFrmt != '%')
+	{
+	    pBuf[len++] = *pFrmt++;
+	    continue;
+	}
+
+	if (pFrmt[1] == '%')
+	{
+	    pBuf[len++] = '%';
+	    pFrmt += 2;
+	    continue;
+	}
+
+	/* copy conversion specification */
+	n = 0;
+	spec[n++] = *pFrmt++;
+	for (longCnt = 0;  *pFrmt != EOS  &&  strchr (LOG_REC_SPEC_CHARS, *pFrmt);
+	     pFrmt++)
+	{
+	    if (*pFrmt == 'l')
+		longCnt++;
+	    if (n < (int)sizeof(spec) - 2)
+		spec[n++] = *pFrmt;
+	}
+	if (*pFrmt == EOS)
+	    break;
+	spec[n++] = *pFrmt;
+	spec[n] = EOS;
+
+	if (*pFrmt == 's')
+	{
+	    len += StrFormatN (pBuf + len, max - len, spec, pArg);
+	    pArg += strlen (pArg) + 1;
+	}
+	else
+	{
+	    /* pass the word with the type of the conversion */
+	    memcpy (&word, pArg, sizeof(word));
+	    pArg += sizeof(word);
+	    if (longCnt == 0)
+		len += StrFormatN (pBuf + len, max - len, spec, (int)word);
+	    else if (*pFrmt == 'd'  ||  *pFrmt == 'i')
+		len += StrFormatN (pBuf + len, max - len, spec,
+				   (long)(int32_t)word);
+	    else
+		len += StrFormatN (pBuf + len, max - len, spec,
+				   (unsigned long)word);
+	}
+	pFrmt++;
+    }
+
+    if (len > max)
+	len = max;		// text has been truncated
+
+    /* add <CR><LF> */
+    strcpy (pBuf + len, "\r\n");
+
+    return len + 2;
+}
+
+
+#ifdef LOG_MONITOR_FUNCTION
+/***************************************************************************//**
+ *
+ * @brief	Log Monitor for Binary Records
+ *
+ * This routine sends all binary records, which have been stored since the
+ * last call, as text to the monitor output.  Text entries have already been
+ * sent by logMsg().  It is called from LogFlushCheck() and LogFlush(), i.e.
+ * outside of interrupt context.
+ *
+ ******************************************************************************/
+static void	logMonitor(void)
+{
+char	 text[LOG_TEXT_MAX_SIZE];
+int	 cnt;
+
+    while (idxLogMon != idxLogPut)
+    {
+	cnt = (uint8_t)l_LogBuf[idxLogMon];	// get string length
+	if (cnt == 0)
+	{
+	    idxLogMon = 0;		// length of 0 indicates wrap-around
+	    continue;
+	}
+
+	if (cnt == LOG_ENTRY_BUSY)
+	    break;			// entry is not committed yet
+
+	if (l_LogBuf[idxLogMon + 1] == LOG_REC_BINARY)
+	{
+	    logExpand (l_LogBuf + idxLogMon + 1, text);
+	    LOG_MONITOR_FUNCTION (text);
+#if LOG_TAIL_SIZE > 0
+	    logTailPut (text);
+#endif
+	}
 
-    /* add <CR><LF> */
-    strcpy (pBuf + len, "\r\n");
-    len += 3;			// <CR> <LF> EOS
+	/* update index, consider <len> byte and EOS */
+	idxLogMon += (cnt + 2);
+    }
+}
+#endif
+#endif	// LOG_BINARY
 
-    /* disable interrupts to prevent interfering of other logs */
-    INT_Disable();
 
-    /* Check if there is enough space in the log buffer */
-    num = LOG_BUF_SIZE - idxLogPut;	// distance to end of buffer
-    if (num > len + 1)
-	num = 0;			// enough space, no additional memory
+#if LOG_ROTATE
+/***************************************************************************//**
+ *
+ * @brief	Current Date of the Log File Segment
+ *
+ * This routine returns the current date as decimal number YYMMDD, which is
+ * part of the segment filename.
+ *
+ * @return
+ *	Current date, or 0 if the clock has not been set yet.
+ *
+ ******************************************************************************/
+static uint32_t	logSegmentDate(void)
+{
+struct tm   time;
+
+
+    ClockGet (&time);
+
+    if (time.tm_year == 0)
+	return 0;		// date is not known yet
+
+    return (time.tm_year % 100) * 10000L + (time.tm_mon + 1) * 100 + time.tm_mday;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Build Filename of the Log File Segment
+ *
+ * This routine builds the path of the current segment, i.e.
+ * "<dir>/YYMMDDnn.TXT", from @ref l_LogDir, @ref l_SegDate, and
+ * @ref l_SegNum.
+ *
+ * @param[out] pName
+ *	Buffer of @ref LOG_FILENAME_SIZE bytes for the filename.
+ *
+ ******************************************************************************/
+static void	logSegmentName(char *pName)
+{
+    StrFormat (pName, "%s/%06lu%02u.TXT", l_LogDir,
+	       (unsigned long)l_SegDate, (unsigned int)l_SegNum);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read Log Index File
+ *
+ * This routine reads @ref LOG_INDEX_FILE, which contains the path of the
+ * current segment, and sets @ref l_LogDir, @ref l_SegDate, and
+ * @ref l_SegNum accordingly.  The file handle @ref l_fh is used, since
+ * there is not enough stack for another file object.
+ *
+ * @return
+ *	The value <i>true</i> if a valid index has been read.
+ *
+ ******************************************************************************/
+static bool	logIndexRead(void)
+{
+char	 buf[LOG_FILENAME_SIZE + 2];
+char	*pSep;
+UINT	 cnt;
+int	 i;
 
-    cnt = idxLogPut + num - idxLogGet;	// calculate allocated space
-    if (cnt < 0)
-	cnt += LOG_BUF_SIZE;		// wrap around
 
-    cnt = LOG_BUF_SIZE - cnt - 1;	// calculate free space
+    if (f_open (&l_fh, LOG_INDEX_FILE, FA_READ) != FR_OK)
+	return false;		// no index file on this SD-Card
 
-    if (cnt < len)
+    if (f_read (&l_fh, buf, sizeof(buf) - 1, &cnt) != FR_OK)
+	cnt = 0;
+    f_close (&l_fh);
+    buf[cnt] = EOS;
+
+    /* Expected format is "<dir>/YYMMDDnn.TXT" */
+    pSep = strchr (buf, '/');
+    if (pSep == NULL  ||  pSep == buf  ||  pSep - buf >= (int)sizeof(l_LogDir))
+	return false;
+
+    for (i = 1;  i <= 8;  i++)
     {
-	/* Not enough space in buffer - skip entry and count as "lost" */
-	l_LostEntryCnt++;
+	if (pSep[i] < '0'  ||  pSep[i] > '9')
+	    return false;
+    }
+    if (strncmp (pSep + 9, ".TXT", 4) != 0)
+	return false;
 
-	/* enable interrupts again */
-	INT_Enable();
+    *pSep = EOS;
+    strcpy (l_LogDir, buf);
+    l_SegNum = (pSep[7] - '0') * 10 + (pSep[8] - '0');
+    pSep[7] = EOS;
+    l_SegDate = strtoul (pSep + 1, NULL, 10);
 
-#ifdef LOG_MONITOR_FUNCTION
-	/* first output the original message */
-	LOG_MONITOR_FUNCTION (tmpBuffer + 1);
+    return true;
+}
 
-	/* then generate and output error message */
-	sprintf (tmpBuffer + 1, "ERROR: Log Buffer Out of Memory"
-				" - lost %ld Messages\n", l_LostEntryCnt);
-#endif
+
+/***************************************************************************//**
+ *
+ * @brief	Write Log Index File
+ *
+ * This routine writes the path of the new segment into @ref LOG_INDEX_FILE.
+ * It must be called while @ref l_fh is not in use.
+ *
+ * @param[in] pName
+ *	Path of the new segment.
+ *
+ ******************************************************************************/
+static void	logIndexWrite(const char *pName)
+{
+FRESULT	 res;
+UINT	 cnt;
+
+
+    res = f_open (&l_fh, LOG_INDEX_FILE, FA_WRITE | FA_CREATE_ALWAYS);
+    if (res == FR_OK)
+    {
+	res = f_write (&l_fh, pName, strlen(pName), &cnt);
+	if (res == FR_OK)
+	    res = f_write (&l_fh, "\r\n", 2, &cnt);
+	f_close (&l_fh);
+	FindFileCacheInvalidate();	// file may have been created
+    }
+
+    if (res != FR_OK)
+	LogError ("Log Index File: Error Code %d", res);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Open a Log File Segment
+ *
+ * This routine creates the directory of the segments if required, writes
+ * the index file, and opens the current segment, see logSegmentName().
+ *
+ * @param[out] pName
+ *	Buffer of @ref LOG_FILENAME_SIZE bytes for the filename.
+ *
+ * @return
+ *	FatFs result code.
+ *
+ ******************************************************************************/
+static FRESULT	logSegmentOpen(char *pName)
+{
+FRESULT	 res;
+
+
+    logSegmentName (pName);
+
+    res = f_mkdir (l_LogDir);
+    if (res != FR_OK  &&  res != FR_EXIST)
+	return res;
+
+    logIndexWrite (pName);
+
+    return logFileOpen (pName);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check for Log File Rotation
+ *
+ * This routine is called by LogFlush() after the SD-Card has been
+ * initialized.  A new segment is started if the date has changed, or the
+ * current segment exceeds @ref LOG_ROTATE_SIZE bytes.
+ *
+ * @return
+ *	FatFs result code, FR_OK if the log file can be written.
+ *
+ ******************************************************************************/
+static FRESULT	logRotateCheck(void)
+{
+char	 name[LOG_FILENAME_SIZE];
+uint32_t date;
+FRESULT	 res;
+
+
+    date = logSegmentDate();
+
+    if (date == 0  ||  date == l_SegDate)
+    {
+	/* same day (or unknown), check size of the segment */
+	if (LOG_ROTATE_SIZE == 0  ||  f_size(&l_fh) < LOG_ROTATE_SIZE
+	||  l_SegNum >= 99)
+	    return FR_OK;
+
+	l_SegNum++;
     }
     else
     {
-	/* There is enough memory in log buffer */
-	if (num > 0)
+	l_SegDate = date;
+	l_SegNum  = 0;
+    }
+
+    /* Close the current segment, continue with the next one */
+    logSegmentName (name);
+    res = f_close (&l_fh);
+    if (res == FR_OK)
+	res = logSegmentOpen (name);
+
+    Log ("Log File Rotation: %s -> %s", g_LogFilename, name);
+    strcpy (g_LogFilename, name);
+
+    if (res != FR_OK)
+    {
+	LogError ("Log File Rotation: Error Code %d", res);
+	l_fh.fs = NULL;		// invalidate file handle
+    }
+
+    return res;
+}
+/***************************************************************************//**
+ *
+ * @brief	Open Log File Segment for a new SD-Card
+ *
+ * This routine is called by LogFileOpen() if @ref LOG_ROTATE is set.  If
+ * the SD-Card contains a valid @ref LOG_INDEX_FILE, its segment is opened
+ * directly, or a new one if the date has changed.  Otherwise the root
+ * directory is searched for @p filepattern as without rotation, and the
+ * basename of the file is used as directory for the segments.
+ *
+ * @param[in] filepattern
+ *	Filename pattern, see LogFileOpen().
+ *
+ * @param[in] filename
+ *	Fall-back filename, see LogFileOpen().
+ *
+ * @param[out] pName
+ *	Buffer of @ref LOG_FILENAME_SIZE bytes for the segment filename.
+ *
+ * @return
+ *	FatFs result code.
+ *
+ ******************************************************************************/
+static FRESULT	logRotateOpen(char *filepattern, char *filename, char *pName)
+{
+uint32_t date;
+char	*pStr;		// string pointer
+int	 i;
+
+
+    date = logSegmentDate();
+
+    if (logIndexRead())
+    {
+	/* continue with the current segment, must be opened first */
+	if (date == 0  ||  date == l_SegDate)
+	{
+	    logSegmentName (pName);
+	    return logFileOpen (pName);
+	}
+
+	/* the date has changed, start a new segment */
+	l_SegDate = date;
+	l_SegNum  = 0;
+	return logSegmentOpen (pName);
+    }
+
+    if (filepattern != NULL)
+    {
+	/* Find filename with specified pattern on the SD-Card */
+	pStr = FindFile ("/", filepattern);
+	if (pStr != NULL)
+	    filename = pStr;	// found pattern on disk
+    }
+
+    /* The basename of the log file is used as directory for the segments */
+    for (i = 0;  i < (int)sizeof(l_LogDir) - 1  &&  filename[i] != '.'
+		 &&  filename[i] != EOS;  i++)
+	l_LogDir[i] = filename[i];
+    l_LogDir[i] = EOS;
+
+    l_SegDate = date;
+    l_SegNum  = 0;
+
+    return logSegmentOpen (pName);
+}
+
+
+#endif	// LOG_ROTATE
+
+
+/***************************************************************************//**
+ *
+ * @brief	Open File and Seek to its End
+ *
+ * This routine opens the specified file for appending log messages.
+ *
+ * @param[in] filename
+ *	Path of the log file.
+ *
+ * @return
+ *	FatFs result code.
+ *
+ ******************************************************************************/
+static FRESULT	logFileOpen(const char *filename)
+{
+FRESULT	 res;		// FatFs function common result code
+#if LOG_ENCRYPT
+char	 hdr[LOG_CRYPT_HDR_SIZE];	// header line with the nonce
+#endif
+
+
+    res = f_open (&l_fh, filename,  FA_READ | FA_WRITE | FA_OPEN_ALWAYS);
+    if (res == FR_OK)
+    {
+	/* a new file may have been created */
+	if (f_size(&l_fh) == 0)
+	    FindFileCacheInvalidate();
+
+	/*
+	 * Seek to the end of the file.  The fast seek mode of FatFs is not
+	 * used here, because creating its cluster link map also follows the
+	 * whole cluster chain, and a file in this mode cannot be expanded.
+	 * Following the chain is cheap anyway, since FatFs caches the FAT
+	 * sector, i.e. only one sector is read for 128 clusters (FAT32).
+	 */
+	res = f_lseek (&l_fh, f_size(&l_fh));
+    }
+
+#if LOG_ENCRYPT
+    /*
+     * Everything appended from now on is encrypted with a new nonce, which
+     * is written as plain text header line.  The file ends with a complete
+     * entry, so the header line always starts at the beginning of a line.
+     */
+    l_flgLogCrypt = false;
+    if (res == FR_OK  &&  l_flgLogCryptKey)
+    {
+	res = logFileWrite (hdr, LogCryptHeader (hdr));
+	l_flgLogCrypt = (res == FR_OK);
+    }
+#endif
+
+    return res;
+}
+
+
+#if LOG_RETAIN
+/***************************************************************************//**
+ *
+ * @brief	Check the Retained Log Buffer
+ *
+ * This routine is called once by LogInit() to see if the log buffer in the
+ * <b>.noinit</b> section is still valid after a reset.  This is not the case
+ * after a power-on or brown-out reset, or if the magic has not been set by a
+ * previous LogInit().  The buffer is changed without locks, so there is no
+ * checksum over its contents.  Instead, all entries from @ref idxLogGet to
+ * @ref idxLogPut must pass the consistency check of LogFlush().  An entry
+ * which fails, e.g. because it has not been committed before the reset,
+ * and all entries after it, are discarded.
+ *
+ * @return
+ *	Number of retained entries, or -1 if the log buffer is not valid.
+ *
+ ******************************************************************************/
+static int	logRetainCheck(void)
+{
+uint32_t cause;			// reset cause
+int	 idx, cnt;		// index and length of an entry
+bool	 flgWrapped = false;
+int	 num = 0;		// number of retained entries
+
+
+    cause = g_ResetCause;	// read by WarmStartInit()
+
+    if ((cause & LOG_RETAIN_RST_MASK) != 0
+    ||  l_LogRetainMagic[0] != LOG_RETAIN_MAGIC
+    ||  l_LogRetainMagic[1] != ~LOG_RETAIN_MAGIC
+    ||  idxLogGet < 0  ||  idxLogGet >= LOG_BUF_SIZE
+    ||  idxLogPut < 0  ||  idxLogPut >= LOG_BUF_SIZE)
+	return -1;
+
+    for (idx = idxLogGet;  idx != idxLogPut;  idx += cnt + 2)
+    {
+	cnt = (uint8_t)l_LogBuf[idx];
+	if (cnt == 0)
 	{
-	    l_LogBuf[idxLogPut] = 0;	// mark wrap-around
-	    idxLogPut = 0;		// adjust start of new log message
+	    if (flgWrapped)
+		break;			// inconsistent buffer
+	    flgWrapped = true;		// wrap-around, continue at index 0
+	    idx = 0;
+	    if (idx == idxLogPut)
+		break;
+	    cnt = (uint8_t)l_LogBuf[idx];
 	}
 
-	pBuf = l_LogBuf + idxLogPut;	// use standard log buffer
+	if (cnt == LOG_ENTRY_BUSY  ||  idx + cnt + 2 > LOG_BUF_SIZE
+	||  (flgWrapped  &&  idx + cnt + 2 > idxLogGet)
+	||  l_LogBuf[idx + cnt] != '\n'  ||  l_LogBuf[idx + cnt + 1] != EOS)
+	    break;
+
+	num++;
+    }
+
+    /* discard the remaining entries, mark free space as not committed */
+    idxLogPut = idx;
+    if (idx >= idxLogGet)
+    {
+	memset (l_LogBuf + idx, LOG_ENTRY_BUSY, LOG_BUF_SIZE - idx);
+	memset (l_LogBuf, LOG_ENTRY_BUSY, idxLogGet);
+    }
+    else
+    {
+	memset (l_LogBuf + idx, LOG_ENTRY_BUSY, idxLogGet - idx);
+    }
+
+    return num;
+}
+#endif
 
-	/* Store string length */
-	tmpBuffer[0] = len - 2;		// no <len> byte, no EOS
 
-	/* Update index */
-	idxLogPut += len;
+#if LOG_JOURNAL
+/***************************************************************************//**
+ *
+ * @brief	Replay the Power-Fail Journal
+ *
+ * This routine is called once by LogInit().  If the journal contains a valid
+ * header, all consistent entries are copied into the log buffer, so they are
+ * written to the log file by the next LogFlush().  Binary records are only
+ * restored if the journal has been written by the same firmware, since they
+ * refer to its format strings.  Afterwards the journal is erased, i.e. it can
+ * be used by LogPowerFailHandler() again.
+ *
+ * @param[in] flgRestore
+ *	If <i>false</i>, the entries are not restored, because the log buffer
+ *	has been retained, i.e. it still contains them, see logRetainCheck().
+ *
+ ******************************************************************************/
+static void	logJournalReplay(bool flgRestore)
+{
+const LOG_JOURNAL_HDR *pHdr = (const LOG_JOURNAL_HDR *)__LogJournalStart;
+const char	*pData = LOG_JOURNAL_DATA;
+const uint32_t	*pWord;		// pointer to check if the journal is erased
+uint32_t	 idx, cnt;	// index and length of an entry
+bool		 flgWrapped = false;
+int		 num = 0;	// number of restored entries
 
-	/* copy message from temporary buffer into log buffer */
-	memcpy (pBuf, tmpBuffer, len);
 
-	/* enable interrupts again */
-	INT_Enable();
+    /* see if the linker script reserves enough flash memory */
+    if ((char *)__LogJournalEnd - (char *)__LogJournalStart < LOG_JOURNAL_SIZE)
+    {
+	LogError ("LogInit: Journal requires %d bytes of flash",
+		  LOG_JOURNAL_SIZE);
+	return;			// l_flgJournalUsed remains set
     }
 
-    /* Finally send the complete log message to the monitor output */
-#ifdef LOG_MONITOR_FUNCTION
-    LOG_MONITOR_FUNCTION (tmpBuffer + 1);
+    if (flgRestore  &&  pHdr->Magic == LOG_JOURNAL_MAGIC
+    &&  pHdr->IdxGet < LOG_BUF_SIZE  &&  pHdr->IdxPut < LOG_BUF_SIZE)
+    {
+	for (idx = pHdr->IdxGet;  idx != pHdr->IdxPut;  idx += cnt + 2)
+	{
+	    cnt = (uint8_t)pData[idx];
+	    if (cnt == 0)
+	    {
+		if (flgWrapped)
+		    break;		// inconsistent journal
+		flgWrapped = true;	// wrap-around, continue at index 0
+		idx = 0;
+		if (idx == pHdr->IdxPut)
+		    break;
+		cnt = (uint8_t)pData[idx];
+	    }
+
+	    /* same consistency check as LogFlush() */
+	    if (cnt == LOG_ENTRY_BUSY  ||  idx + cnt + 2 > LOG_BUF_SIZE
+	    ||  pData[idx + cnt] != '\n')
+		break;
+
+#if LOG_BINARY
+	    if (pData[idx + 1] == LOG_REC_BINARY
+	    &&  pHdr->BuildTag != LOG_JOURNAL_BUILD_TAG)
+		continue;		// format strings may have moved
 #endif
+	    if (logBufPut ((char *)pData + idx, cnt + 2, LOG_PRIO_HIGH))
+		num++;
+	}
+
+	Log ("Power-Fail Journal: Restored %d Log Entries", num);
+    }
+
+    /* erase the journal, if not already done */
+    for (pWord = __LogJournalStart;  pWord < __LogJournalEnd;  pWord++)
+    {
+	if (*pWord != 0xFFFFFFFF)
+	{
+	    logJournalErase();
+	    return;
+	}
+    }
+
+    l_flgJournalUsed = false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Erase the Power-Fail Journal
+ *
+ * This routine erases all flash pages of the journal.  This takes about 20ms
+ * per page, and is only done after a power-fail, i.e. by LogInit() after the
+ * journal has been replayed, or by LogFlush() when power came back and the
+ * log buffer has been written to the SD-Card.
+ *
+ ******************************************************************************/
+static void	logJournalErase(void)
+{
+uint32_t	*pPage;
+msc_Return_TypeDef res = mscReturnOk;
+
+
+    MSC_Init();
+
+    for (pPage = __LogJournalStart;  pPage < __LogJournalEnd
+	 &&  res == mscReturnOk;  pPage += FLASH_PAGE_SIZE / 4)
+	res = MSC_ErasePage (pPage);
+
+    MSC_Deinit();
+
+    if (res != mscReturnOk)
+	LogError ("Power-Fail Journal: Erase Error %d", res);
+    else
+	l_flgJournalUsed = false;
 }
+#endif
 
 
 /***************************************************************************//**
@@ -545,7 +3025,7 @@ static void	logFlushCtrl(TIM_HDL hdl)
     else
 	l_flgLogFlushTrigger = true;
 
-    g_flgIRQ = true;	// keep on running
+    EVENT_POST(EVT_LOG);
 }
 
 
@@ -564,37 +3044,16 @@ static void	logAliveMsg(TIM_HDL hdl)
 
     /* Restart the timer */
     if (l_thLogAliveIntvl != NONE)
-	sTimerStart (l_thLogAliveIntvl, LOG_ALIVE_INTERVAL);
+	sTimerStartSlack (l_thLogAliveIntvl, LOG_ALIVE_INTERVAL, LOG_ALIVE_SLACK);
 
     /* Write Alive Message */
     Log ("Alive");
+
+#if MEM_MONITOR
+    /* Along with the current memory usage */
+    MemMonitorReport (true);
+    ScratchReport (true);
+#endif
 }
 #endif
 
-
-/***************************************************************************//**
- *
- * @brief	Log Flush LED
- *
- * This routine controls the Log Flush LED.  The LED flashes for a short
- * time to indicate that the log buffer has been flushed now and will not
- * be flushed for the next @ref LOG_FLUSH_PAUSE seconds.  This gives the
- * user the ability to remove the SD-Card in a save way.
- *
- ******************************************************************************/
-static void	logFlushLED(void)
-{
-    /* Start condition is LED on */
-    if (LOG_FLUSH_LED)
-    {
-	LOG_FLUSH_LED = 0;
-	l_LogFlushLED_FlashCnt--;
-    }
-    else
-    {
-	LOG_FLUSH_LED = 1;
-    }
-
-    if (l_LogFlushLED_FlashCnt > 0)
-	msTimerStart(LOG_FLASH_LED_DELAY);
-}
\ No newline at end of file
@@ -2,9 +2,32 @@
  * @file
  * @brief	Header file of module Logging.c
  * @author	Ralf Gerhauser
- * @version	2018-03-16
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	LOG_FLUSH_PAGED defaults to 0, its page buffer does not fit
+		into 16KB of RAM.
+2026-10-15,agnt	Added LogFileHandleGet() and LogFileHandlePut().
+2026-10-15,agnt	Added LOG_FLUSH_SLACK and LOG_ALIVE_SLACK.
+2026-10-15,agnt	Added LOG_STREAM_MAX, LOG_STREAM, LogStreamRegister(), and
+		LogStreamAppend().
+2026-10-15,agnt	Added LOG_PRIORITY, the priorities LOG_PRIO_xxx, LogPrio(), and
+		LogEvent().  LOG_WARN() logs with high, LOG_INFO() and LOG_DBG()
+		with low priority.
+2026-10-15,agnt	Added LOG_FLUSH_ADAPTIVE with its parameters, and LogFlushSoC().
+2026-10-15,agnt	Added prototype for LogFlushRequest().
+2026-10-15,agnt	Added define LOG_COMPRESS.
+2026-10-15,agnt	Added define LOG_INTEGRITY.
+2026-10-15,agnt	Added define LOG_ENCRYPT.
+2026-10-14,agnt	Added define LOG_TAIL_SIZE, LogTailGet(), and LogLostCount().
+2026-10-14,agnt	Added define LOG_FLUSH_PAGED.
+2026-10-14,agnt	Added global variable g_LogErrorCnt.
+		Added defines LOG_BINARY and LOG_SYNC_INTERVAL.
+		Added defines for the log file rotation, see LOG_ROTATE.
+		Added define LOG_JOURNAL and LogPowerFailHandler().
+		Added define LOG_RETAIN.
+		Added log levels with the macros LOG_ERR(), LOG_WARN(),
+		LOG_INFO(), LOG_DBG(), and the runtime level g_LogLevel.
 2019-02-10,rage	Increased LOG_SAMPLE_MAX_SIZE from 100 to 120 characters.
 2018-03-16,rage Added prototype for LogFlushTrigger().
 2015-04-02,rage	Initial version.
@@ -16,6 +39,7 @@ Revision History:
 /*=============================== Header Files ===============================*/
 
 #include "config.h"		// include project configuration parameters
+#include "ff.h"			// FIL
 
 /*=============================== Definitions ================================*/
 
@@ -44,6 +68,69 @@ Revision History:
     #define LOG_FLUSH_PAUSE	15
 #endif
 
+    /*!@brief Number of seconds the end of the flush pause, or of the hold
+     * time of @ref LOG_FLUSH_ADAPTIVE, may be delayed to share the wake-up
+     * of another timer, see sTimerStartSlack().
+     */
+#ifndef LOG_FLUSH_SLACK
+    #define LOG_FLUSH_SLACK	10
+#endif
+
+    /*!@brief Number of flushes because of @ref LOG_SAMPLE_MAX_SIZE after which
+     * the file system is synchronized, i.e. FAT and directory entry are
+     * updated.  Flushes in between only write complete sectors, and do not
+     * flash the Log Flush LED, since the SD-Card must not be removed then.
+     * Set this define 1 to synchronize after every flush.
+     */
+#ifndef LOG_SYNC_INTERVAL
+    #define LOG_SYNC_INTERVAL	4
+#endif
+
+    /*!@brief Set this define 1 to adapt the flushing of the log buffer to the
+     * fill level and the power state.  A small batch is held back up to
+     * @ref LOG_FLUSH_MAX_HOLD seconds after the @ref LOG_SAMPLE_TIMEOUT, and
+     * the threshold @ref LOG_SAMPLE_MAX_SIZE is halved while messages are
+     * arriving fast, or if the entries in RAM are at risk.
+     */
+#ifndef LOG_FLUSH_ADAPTIVE
+    #define LOG_FLUSH_ADAPTIVE	0
+#endif
+
+    /*!@brief Fill level in bytes, from which the log buffer is flushed after
+     * @ref LOG_SAMPLE_TIMEOUT.  Smaller batches are held back.
+     */
+#ifndef LOG_FLUSH_MIN_BATCH
+    #define LOG_FLUSH_MIN_BATCH	512
+#endif
+
+    /*!@brief Maximum time in seconds the oldest entry of a small batch is held
+     * back in the log buffer.  It is doubled below @ref LOG_FLUSH_SOC_SAVE.
+     */
+#ifndef LOG_FLUSH_MAX_HOLD
+    #define LOG_FLUSH_MAX_HOLD	300
+#endif
+
+    /*!@brief Time in seconds after a flush because of @ref LOG_SAMPLE_MAX_SIZE,
+     * during which the logging is considered as busy.
+     */
+#ifndef LOG_FLUSH_BUSY_TIME
+    #define LOG_FLUSH_BUSY_TIME	60
+#endif
+
+    /*!@brief Battery state of charge in [%] below which small batches are
+     * held back twice as long, to save SD-Card power cycles.
+     */
+#ifndef LOG_FLUSH_SOC_SAVE
+    #define LOG_FLUSH_SOC_SAVE	30
+#endif
+
+    /*!@brief Battery state of charge in [%] below which a power-fail is
+     * likely, so nothing is held back.
+     */
+#ifndef LOG_FLUSH_SOC_RISK
+    #define LOG_FLUSH_SOC_RISK	10
+#endif
+
     /*!@brief Interval in seconds after there is an "alive" message logged.
      * Set this define 0 to disable any alive messages.
      */
@@ -51,6 +138,13 @@ Revision History:
     #define LOG_ALIVE_INTERVAL	10*60
 #endif
 
+    /*!@brief Number of seconds the "alive" message may be delayed to share
+     * the wake-up of another timer, see sTimerStartSlack().
+     */
+#ifndef LOG_ALIVE_SLACK
+    #define LOG_ALIVE_SLACK	60
+#endif
+
     /*!@brief   Maximum size of one log entry in bytes.
      * @details This value specifies the maximum length of one log message.
      * It is important for the management of the log buffer @ref l_LogBuf in
@@ -70,10 +164,249 @@ Revision History:
     #define LOG_MONITOR_FUNCTION	NONE
 #endif
 
+    /*!@brief Set this define 1 to store log messages as binary records,
+     * i.e. only the address of the format string, the time stamp, and the
+     * arguments.  Formatting is deferred until the log buffer is flushed, or
+     * the records are sent to the monitor output by LogFlushCheck().  This
+     * reduces the time spent in Log(), especially in interrupt context.
+     */
+#ifndef LOG_BINARY
+    #define LOG_BINARY		0
+#endif
+
+    /*!@brief Set this define 1 to split the log file into segments.  They are
+     * stored as <b>YYMMDDnn.TXT</b> in a directory named like the basename of
+     * the log file, e.g. <b>BOX0123/26101400.TXT</b>.  A new segment is
+     * started when the date changes, or the segment exceeds
+     * @ref LOG_ROTATE_SIZE bytes.  The path of the current segment is stored
+     * in @ref LOG_INDEX_FILE, so it can be opened without searching.
+     */
+#ifndef LOG_ROTATE
+    #define LOG_ROTATE		0
+#endif
+
+    /*!@brief Maximum size of a log file segment in bytes, 0 for no limit. */
+#ifndef LOG_ROTATE_SIZE
+    #define LOG_ROTATE_SIZE	(1024L * 1024L)
+#endif
+
+    /*!@brief Name of the index file which refers to the current segment. */
+#ifndef LOG_INDEX_FILE
+    #define LOG_INDEX_FILE	"LOG.IDX"
+#endif
+
+    /*!@brief Set this define 1 to save the log buffer into a journal in case
+     * of power-fail.  The journal consists of the last flash pages, which are
+     * reserved by the linker script, see symbols <b>__LogJournalStart</b> and
+     * <b>__LogJournalEnd</b>.  They must provide one flash page for the
+     * header, plus @ref LOG_BUF_SIZE bytes.  The journal is replayed into
+     * the log buffer by LogInit() after the next reset.
+     */
+#ifndef LOG_JOURNAL
+    #define LOG_JOURNAL		0
+#endif
+
+    /*!@brief Set this define 1 to keep the log buffer after a warm reset,
+     * e.g. via Reboot(), a lockup, or the reset pin.  The log buffer and its
+     * indices are located in the <b>.noinit</b> section, which is not
+     * cleared by the startup code.  LogInit() checks the reset cause and the
+     * consistency of all entries, before they are kept.
+     */
+#ifndef LOG_RETAIN
+    #define LOG_RETAIN		0
+#endif
+
+    /*!@brief Set this define 1 to collect the log messages into 512 byte
+     * pages, aligned to the sectors of the log file, when the log buffer is
+     * flushed.  Full pages are passed to one f_write() call each, which
+     * transfers them directly via disk_write().  This requires a static page
+     * buffer of 512 bytes.  Set 0 to write every entry by a separate call,
+     * FatFs then collects them in its sector buffer.
+     */
+#ifndef LOG_FLUSH_PAGED
+    #define LOG_FLUSH_PAGED	0
+#endif
+
+    /*!@brief Size of a ring buffer in bytes, which keeps the text of the most
+     * recent log messages, independent of flushing the log buffer.  It can be
+     * read by LogTailGet(), e.g. for the telemetry protocol.  Set 0 to omit
+     * the ring buffer.
+     */
+#ifndef LOG_TAIL_SIZE
+    #define LOG_TAIL_SIZE	0
+#endif
+
+    /*!@brief Set this define 1 to encrypt the log file with AES-128 in
+     * counter mode, see "LogCrypt.c".  The key is provisioned into the user
+     * data page of the flash, the log remains plain text without it.  The
+     * pages of @ref LOG_FLUSH_PAGED are encrypted in place, which requires
+     * this option.
+     */
+#ifndef LOG_ENCRYPT
+    #define LOG_ENCRYPT		0
+#endif
+
+#if LOG_ENCRYPT  &&  ! LOG_FLUSH_PAGED
+    #error "LOG_ENCRYPT requires LOG_FLUSH_PAGED"
+#endif
+
+    /*!@brief Set this define 1 to append an integrity record to the text
+     * written by each LogFlush().  It is a line of the format
+     * <b>\#CHK seq first last length crc</b>, with a sequence number, the
+     * time stamps of the first and the last entry, the number of bytes, and
+     * their CRC-32 (as zlib) in hex.  The text covered by a record starts
+     * after the previous record, so a host tool can verify the log block by
+     * block, and resynchronize at the next record after a damaged block.
+     */
+#ifndef LOG_INTEGRITY
+    #define LOG_INTEGRITY	0
+#endif
+
+    /*!@brief Set this define 1 to compress the text written by each
+     * LogFlush() into a frame of the format <b>\#LZ</b> \<CR>\<LF>,
+     * LZ77 tokens, 0x00, \<CR>\<LF>.  A token 0x01 to 0x7F is followed by
+     * as many literal bytes.  A token 0x80 to 0xFF and the next byte are a
+     * match: bits 14 to 9 are its length - 3, bits 8 to 0 the distance - 1.
+     * Each frame is independent, its window is the preceding text of the
+     * same frame, up to 512 bytes.  This requires about 1.2KB of RAM, and
+     * @ref LOG_FLUSH_PAGED.  The host tool "LogAnalyzer" decompresses the
+     * frames.
+     */
+#ifndef LOG_COMPRESS
+    #define LOG_COMPRESS	0
+#endif
+
+#if LOG_COMPRESS  &&  ! LOG_FLUSH_PAGED
+    #error "LOG_COMPRESS requires LOG_FLUSH_PAGED"
+#endif
+
+    /*!@brief Set this define 1 to keep free space in the log buffer for the
+     * important entries.  An entry of @ref LOG_PRIO_LOW is dropped if less
+     * than @ref LOG_RESERVE_LOW bytes would remain free, an entry of
+     * @ref LOG_PRIO_NORMAL if less than @ref LOG_RESERVE_NORMAL.  Errors,
+     * warnings, and events of LogEvent() may use the whole buffer.  Dropped
+     * entries are counted, and a summary is logged after the next flush.
+     */
+#ifndef LOG_PRIORITY
+    #define LOG_PRIORITY	0
+#endif
+
+    /*!@brief Free space in bytes which is kept for entries of
+     * @ref LOG_PRIO_NORMAL and above.
+     */
+#ifndef LOG_RESERVE_LOW
+    #define LOG_RESERVE_LOW	(LOG_BUF_SIZE / 2)
+#endif
+
+    /*!@brief Free space in bytes which is kept for entries of
+     * @ref LOG_PRIO_HIGH.
+     */
+#ifndef LOG_RESERVE_NORMAL
+    #define LOG_RESERVE_NORMAL	(LOG_BUF_SIZE / 8)
+#endif
+
+    /*!@brief Size of a log filename, considers "<dir>/YYMMDDnn.TXT" and EOS. */
+#define LOG_FILENAME_SIZE	22
+
+    /*!@name Log Levels, see LOG_ERR(), LOG_WARN(), LOG_INFO(), and LOG_DBG(). */
+//@{
+#define LOG_LVL_ERR	1	//!< Errors, always logged if compiled in
+#define LOG_LVL_WARN	2	//!< Warnings
+#define LOG_LVL_INFO	3	//!< Normal operation
+#define LOG_LVL_DBG	4	//!< Detailed messages for debugging
+//@}
+
+    /*!@name Priorities of log entries, see LOG_PRIORITY and LogPrio(). */
+//@{
+#define LOG_PRIO_LOW	0	//!< Routine messages, LOG_INFO() and LOG_DBG()
+#define LOG_PRIO_NORMAL	1	//!< Messages of Log()
+#define LOG_PRIO_HIGH	2	//!< Errors, warnings, and LogEvent()
+//@}
+
+    /*!@brief Compile-time log level, messages above this level are removed.
+     * A module may specify its own threshold by redefining
+     * @ref LOG_MODULE_LEVEL after including this header file, e.g.
+     * <b>\#define LOG_MODULE_LEVEL LOG_LEVEL_LB</b>.
+     */
+#ifndef LOG_LEVEL
+    #define LOG_LEVEL		LOG_LVL_DBG
+#endif
+
+    /*!@brief Compile-time log level of the current module. */
+#define LOG_MODULE_LEVEL	LOG_LEVEL
+
+    /*!@brief Default for the runtime log level @ref g_LogLevel, which can be
+     * set by the variable <b>LOG_LEVEL</b> in the configuration file.
+     */
+#ifndef DFLT_LOG_LEVEL
+    #define DFLT_LOG_LEVEL	LOG_LVL_DBG
+#endif
+
+    /*!@brief Maximum number of output streams besides the log file, see
+     * LogStreamRegister().
+     */
+#ifndef LOG_STREAM_MAX
+    #define LOG_STREAM_MAX	4
+#endif
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Output stream of another module, which has its own file and
+     * buffer.  Its flush function is called by LogFlush() while the SD-Card
+     * is switched on, and usually appends the buffer by LogStreamAppend().
+     */
+typedef struct
+{
+    const char	*Name;		//!< Prefix of the error messages
+    const char	*FileName;	//!< Name of the file on the SD-Card
+    void	(*Flush)(void);	//!< Writes the buffered data
+} LOG_STREAM;
+
+/*================================== Macros ==================================*/
+
+    /*!@brief See if a message of level <b>lvl</b> has to be logged.  The first
+     * comparison is a constant, i.e. the compiler removes the message
+     * completely, including its format string.
+     */
+#define LOG_LEVEL_ENABLED(lvl)	(LOG_MODULE_LEVEL >= (lvl)		\
+				 &&  g_LogLevel >= (lvl))
+
+    /*!@brief Log an error, it can only be removed at compile-time. */
+#define LOG_ERR(...)							\
+	do { if (LOG_MODULE_LEVEL >= LOG_LVL_ERR)			\
+		LogError (__VA_ARGS__); } while (0)
+
+    /*!@brief Log a warning, the format must be a string literal. */
+#define LOG_WARN(frmt, ...)						\
+	do { if (LOG_LEVEL_ENABLED(LOG_LVL_WARN))			\
+		LogPrio (LOG_PRIO_HIGH, "WARNING " frmt, ##__VA_ARGS__);	\
+	} while (0)
+
+    /*!@brief Log an informational message. */
+#define LOG_INFO(...)							\
+	do { if (LOG_LEVEL_ENABLED(LOG_LVL_INFO))			\
+		LogPrio (LOG_PRIO_LOW, __VA_ARGS__); } while (0)
+
+    /*!@brief Log a debug message. */
+#define LOG_DBG(...)							\
+	do { if (LOG_LEVEL_ENABLED(LOG_LVL_DBG))			\
+		LogPrio (LOG_PRIO_LOW, __VA_ARGS__); } while (0)
+
+    /*!@brief Log an event which must survive a full log buffer, e.g. a time
+     * synchronization or a transponder visit.
+     */
+#define LogEvent(...)	LogPrio (LOG_PRIO_HIGH, __VA_ARGS__)
+
 /*================================ Global Data ===============================*/
 
     /* Filename of the current Log File on the SD-Card */
-extern char	g_LogFilename[14];
+extern char	g_LogFilename[LOG_FILENAME_SIZE];
+
+    /* Number of error messages generated via LogError() */
+extern uint32_t	g_LogErrorCnt;
+
+    /* Runtime log level, set by the configuration variable LOG_LEVEL */
+extern int32_t	g_LogLevel;
 
 /*================================ Prototypes ================================*/
 
@@ -81,8 +414,24 @@ void	 LogInit (void);		// Initialize the logging facility
 void	 LogFileOpen (char *filepattern, char *filename); // Open Log File
 void	 Log (const char *frmt, ...);		// Log a message
 void	 LogError (const char *frmt, ...);	// Log an error
+void	 LogPrio (int prio, const char *frmt, ...); // Log with priority
 void	 LogFlush (bool flgKeepPowerOn);	// Flush the log buffer
 void	 LogFlushCheck (void);		// Check if to flush the log buffer
+void	 LogFlushRequest (void);	// Flush the log buffer soon
+#if LOG_FLUSH_ADAPTIVE
+void	 LogFlushSoC (int soc);		// Battery state of charge in [%]
+#endif
+#if LOG_JOURNAL
+void	 LogPowerFailHandler (void);	// Save log buffer into the journal
+#endif
+bool	 LogStreamRegister (const LOG_STREAM *pStream); // Add output stream
+bool	 LogStreamAppend (const LOG_STREAM *pStream, unsigned int align,
+			  const void *pData1, unsigned int len1,
+			  const void *pData2, unsigned int len2);
+FIL	*LogFileHandleGet (void);	// Borrow the stream file handle
+void	 LogFileHandlePut (FIL *pFh);	// Return the borrowed file handle
+int	 LogTailGet (char *pBuf, int size);	// Get the recent messages
+uint32_t LogLostCount (void);		// Number of lost log entries
 
 
 #endif /* __INC_Logging_h */
@@ -0,0 +1,353 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Memory Monitor
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module measures the RAM headroom of the running firmware.  At boot,
+ * MemMonitorInit() fills the unused part of the stacks with the pattern
+ * @ref MEM_PAINT_PATTERN.  Later, the high-water mark of a stack is found
+ * by scanning from its bottom for the first word that has been overwritten.
+ *
+ * If @ref MEM_ISR_STACK_SIZE is not 0, MemMonitorInit() also moves the
+ * interrupt service routines to a separate stack: main() continues on the
+ * linker stack, which now becomes the process stack (PSP), and the main
+ * stack pointer (MSP), which is used by all exceptions, is set to the top of
+ * @ref l_IsrStack.  So the stack usage of interrupt context, including the
+ * nesting of interrupts, is measured separately from that of main().
+ *
+ * The stack of main() may grow below the linker stack limit as long as it
+ * does not reach the heap, so its headroom is the distance to the current
+ * top of the heap.  The heap of newlib is never given back by sbrk(), so its
+ * current size is also its peak.
+ *
+ * MemMonitorCheck() is called periodically from the main loop.  It updates
+ * the figures and logs an error once, if the headroom of a stack falls below
+ * @ref MEM_HEADROOM_WARN.  MemMonitorReport() is called by the alive message
+ * and by the console command "MEM".
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Registered MemMonitorCheck() as task of the main loop, see
+		TASK_REGISTER().
+2026-10-15,agnt	Use StrFormat() instead of sprintf().
+2026-10-14,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <unistd.h>
+#include "em_int.h"
+#include "MemMonitor.h"
+#include "LEUART.h"
+#include "Logging.h"
+#include "StrFormat.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Pattern to paint the unused stack space. */
+#define MEM_PAINT_PATTERN	0xA5A5A5A5
+
+    /*!@brief Number of bytes below the stack pointer that are not painted to
+     * keep the frame of MemMonitorInit() intact.
+     */
+#define MEM_PAINT_MARGIN	32
+
+    /*!@brief Bit SPSEL of the CONTROL register, selects the PSP. */
+#define CONTROL_SPSEL		0x2
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Painted area of a stack. */
+typedef struct
+{
+    uint32_t	*pBottom;	//!< Lowest painted word
+    uint32_t	*pTop;		//!< Top of stack, i.e. first word above
+    uint32_t	*pHighWater;	//!< Lowest word that has been overwritten
+    bool	 flgWarned;	//!< Low headroom has already been logged
+} MEM_STACK;
+
+/*================================ Global Data ===============================*/
+
+    /* Start of the heap and top of the stack, symbols of the linker script */
+extern uint32_t __end__;
+extern uint32_t __StackTop;
+
+/*================================ Local Data ================================*/
+
+#if MEM_MONITOR
+#if MEM_ISR_STACK_SIZE > 0
+    /*!@brief Separate stack for the interrupt service routines. */
+static uint32_t	 l_IsrStack[MEM_ISR_STACK_SIZE / 4] __attribute__((aligned(8)));
+
+    /*!@brief Painted area of the interrupt stack. */
+static MEM_STACK l_StackIsr;
+#endif
+
+    /*!@brief Painted area of the stack of main(). */
+static MEM_STACK l_StackMain;
+
+    /*!@brief Top of the heap, as seen by the last MemHeapTop(). */
+static uint32_t	*l_pHeapTop;
+#endif
+
+/*=========================== Forward Declarations ===========================*/
+
+#if MEM_MONITOR
+static void	MemStackPaint (MEM_STACK *pStack, uint32_t *pBottom,
+			       uint32_t *pTop, uint32_t *pEnd);
+static uint32_t	MemStackScan (MEM_STACK *pStack);
+static uint32_t	MemStackUsed (MEM_STACK *pStack);
+static void	MemHeapTop (void);
+static void	MemStackCheck (MEM_STACK *pStack, uint32_t headroom,
+			       const char *name);
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Memory Monitor
+ *
+ * This routine must be called first in main(), i.e. before any interrupt
+ * has been enabled.  It paints the unused part of the stack of main(), from
+ * the top of the heap up to the current stack pointer.  If
+ * @ref MEM_ISR_STACK_SIZE is not 0, it paints @ref l_IsrStack, switches
+ * thread mode to the process stack pointer, which keeps the current value,
+ * and sets the main stack pointer to the top of the interrupt stack.
+ *
+ ******************************************************************************/
+void	MemMonitorInit (void)
+{
+#if MEM_MONITOR
+uint32_t *pSP = (uint32_t *)__get_MSP();
+
+    MemHeapTop();
+
+    MemStackPaint (&l_StackMain, l_pHeapTop, &__StackTop,
+		   pSP - MEM_PAINT_MARGIN / 4);
+
+#if MEM_ISR_STACK_SIZE > 0
+    MemStackPaint (&l_StackIsr, l_IsrStack,
+		   l_IsrStack + MEM_ISR_STACK_SIZE / 4,
+		   l_IsrStack + MEM_ISR_STACK_SIZE / 4);
+
+    /*
+     * Let thread mode continue on the same stack via the PSP, then the MSP
+     * is no longer in use and can be moved to the interrupt stack.
+     */
+    INT_Disable();
+    __set_PSP ((uint32_t)pSP);
+    __set_CONTROL (__get_CONTROL() | CONTROL_SPSEL);
+    __ISB();
+    __set_MSP ((uint32_t)(l_IsrStack + MEM_ISR_STACK_SIZE / 4));
+    INT_Enable();
+#endif
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check the Memory Usage
+ *
+ * This routine is called periodically from the main loop.  It updates the
+ * top of the heap and the high-water marks of the stacks, and logs an error
+ * if the headroom of a stack is below @ref MEM_HEADROOM_WARN.
+ *
+ ******************************************************************************/
+void	MemMonitorCheck (void)
+{
+#if MEM_MONITOR
+    MemHeapTop();
+
+    MemStackCheck (&l_StackMain, MemStackScan(&l_StackMain), "Main");
+#if MEM_ISR_STACK_SIZE > 0
+    MemStackCheck (&l_StackIsr, MemStackScan(&l_StackIsr), "ISR");
+#endif
+#endif
+}
+TASK_REGISTER(TASK_PRIO_MEM_MONITOR, EVT_BATTERY, MemMonitorCheck);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Memory Usage
+ *
+ * This routine generates one line with the peak usage and the headroom of the
+ * stacks in bytes, and the size of the heap.  It may also be called from
+ * interrupt context, e.g. by the alive message.
+ *
+ * @param[in] flgLog
+ *	If true, the line is logged.  If false, it is only shown on the debug
+ *	console.
+ *
+ ******************************************************************************/
+void	MemMonitorReport (bool flgLog)
+{
+#if MEM_MONITOR
+char	 line[120];
+int	 len;
+uint32_t headroom;
+
+    headroom = MemStackScan (&l_StackMain);
+    len = StrFormat (line, "Memory: Stack %ld used, %ld free",
+		     MemStackUsed(&l_StackMain), headroom);
+#if MEM_ISR_STACK_SIZE > 0
+    headroom = MemStackScan (&l_StackIsr);
+    len += StrFormat (line + len, ", ISR Stack %ld used, %ld free",
+		      MemStackUsed(&l_StackIsr), headroom);
+#endif
+    StrFormat (line + len, ", Heap %ld",
+	       (uint32_t)(l_pHeapTop - &__end__) * 4);
+
+    if (flgLog)
+    {
+	Log (line);
+    }
+    else
+    {
+	drvLEUART_puts (line);
+	drvLEUART_puts ("\n");
+    }
+#else
+    if (! flgLog)
+	drvLEUART_puts ("MEM_MONITOR is not enabled\n");
+#endif
+}
+
+
+#if MEM_MONITOR
+/***************************************************************************//**
+ *
+ * @brief	Paint a Stack
+ *
+ * This routine fills the area from <b>pBottom</b> to <b>pEnd</b> with
+ * @ref MEM_PAINT_PATTERN and initializes the descriptor of the stack.
+ *
+ * @param[in] pStack
+ *	Descriptor of the stack.
+ *
+ * @param[in] pBottom
+ *	Lowest word of the stack.
+ *
+ * @param[in] pTop
+ *	Top of the stack, i.e. the first word above it.
+ *
+ * @param[in] pEnd
+ *	First word above the area to be painted, i.e. the words from here up
+ *	to <b>pTop</b> are already in use.
+ *
+ ******************************************************************************/
+static void	MemStackPaint (MEM_STACK *pStack, uint32_t *pBottom,
+			       uint32_t *pTop, uint32_t *pEnd)
+{
+uint32_t *pWord;
+
+    for (pWord = pBottom;  pWord < pEnd;  pWord++)
+	*pWord = MEM_PAINT_PATTERN;
+
+    pStack->pBottom    = pBottom;
+    pStack->pTop       = pTop;
+    pStack->pHighWater = pEnd;
+    pStack->flgWarned  = false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Scan a Stack for its High-Water Mark
+ *
+ * This routine searches upwards from the bottom of the stack for the first
+ * word that has been overwritten, and returns the headroom below it.  The
+ * stack of main() is limited by the top of the heap, i.e. words that became
+ * part of the heap are skipped.  The high-water mark only moves downwards,
+ * so the scan ends there.
+ *
+ * @param[in] pStack
+ *	Descriptor of the stack.
+ *
+ * @return
+ *	Headroom of the stack in bytes.
+ *
+ ******************************************************************************/
+static uint32_t	MemStackScan (MEM_STACK *pStack)
+{
+uint32_t *pLimit = pStack->pBottom;
+uint32_t *pWord;
+
+    if (pStack == &l_StackMain  &&  pLimit < l_pHeapTop)
+	pLimit = l_pHeapTop;
+
+    for (pWord = pLimit;  pWord < pStack->pHighWater;  pWord++)
+	if (*pWord != MEM_PAINT_PATTERN)
+	    break;
+
+    INT_Disable();
+    if (pWord < pStack->pHighWater)
+	pStack->pHighWater = pWord;
+    INT_Enable();
+
+    return (uint32_t)(pWord - pLimit) * 4;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Peak Usage of a Stack
+ *
+ * @param[in] pStack
+ *	Descriptor of the stack.
+ *
+ * @return
+ *	Number of bytes between the top of the stack and its high-water mark,
+ *	as found by the last MemStackScan().
+ *
+ ******************************************************************************/
+static uint32_t	MemStackUsed (MEM_STACK *pStack)
+{
+    return (uint32_t)(pStack->pTop - pStack->pHighWater) * 4;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the Top of the Heap
+ *
+ * This routine updates @ref l_pHeapTop with the current end of the heap,
+ * rounded up to a word boundary.
+ *
+ ******************************************************************************/
+static void	MemHeapTop (void)
+{
+    l_pHeapTop = (uint32_t *)(((uint32_t)sbrk(0) + 3) & ~3);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check the Headroom of a Stack
+ *
+ * This routine logs an error once, if the headroom of a stack falls below
+ * @ref MEM_HEADROOM_WARN.
+ *
+ * @param[in] pStack
+ *	Descriptor of the stack.
+ *
+ * @param[in] headroom
+ *	Current headroom of the stack in bytes, see MemStackScan().
+ *
+ * @param[in] name
+ *	Name of the stack for the log message.
+ *
+ ******************************************************************************/
+static void	MemStackCheck (MEM_STACK *pStack, uint32_t headroom,
+			       const char *name)
+{
+    if (headroom < MEM_HEADROOM_WARN  &&  ! pStack->flgWarned)
+    {
+	pStack->flgWarned = true;
+	LogError ("MemMonitor: %s Stack headroom only %ld Bytes (%ld used)",
+		  name, headroom, MemStackUsed(pStack));
+    }
+}
+#endif
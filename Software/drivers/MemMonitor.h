@@ -0,0 +1,61 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module MemMonitor.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	MEM_ISR_STACK_SIZE defaults to 0, the interrupts share the
+		linker stack with main().
+2026-10-15,agnt	Reduced MEM_ISR_STACK_SIZE to 768, the buffer of logMsg() for
+		a full log buffer is taken from the scratch pool.
+2026-10-14,agnt	Initial version.
+*/
+
+#ifndef __INC_MemMonitor_h
+#define __INC_MemMonitor_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to paint the stacks at boot and to track their
+ * high-water marks and the heap usage, see MemMonitorInit().
+ */
+#ifndef MEM_MONITOR
+    #define MEM_MONITOR		0
+#endif
+
+/*!@brief Size of the separate interrupt stack in bytes.  If not 0, the
+ * interrupt service routines run on their own stack, while main() continues
+ * on the linker stack.  The default 0 uses one common stack, which saves
+ * this RAM on devices with 16KB, the high-water mark then covers main() and
+ * the interrupts together.
+ */
+#ifndef MEM_ISR_STACK_SIZE
+    #define MEM_ISR_STACK_SIZE	0
+#endif
+
+/*!@brief Headroom in bytes below which a stack is reported as an error. */
+#ifndef MEM_HEADROOM_WARN
+    #define MEM_HEADROOM_WARN	128
+#endif
+
+/*================================ Prototypes ================================*/
+
+    /* Paint the stacks, must be called first in main() */
+void	MemMonitorInit (void);
+
+    /* Update the high-water marks, log an error if the headroom is low */
+void	MemMonitorCheck (void);
+
+    /* Show or log the memory usage */
+void	MemMonitorReport (bool flgLog);
+
+
+#endif /* __INC_MemMonitor_h */
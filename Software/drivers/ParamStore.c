@@ -0,0 +1,274 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Parameter Store in the internal Flash
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module keeps small parameters of the other modules in two flash
+ * pages, which are defined by the linker script as <b>PARAMS</b>.  So they
+ * survive a power-on reset without powering the SD-Card, e.g. the trim of
+ * the temperature compensation, or the inventory of the Audio module.  Each
+ * parameter is a 32 bit value, identified by a key of @ref PARAM_KEY.
+ *
+ * The pages are used as a journal:  ParamSet() programs a record, i.e. the
+ * value and a key word, into the next erased slot of the active page.  The
+ * key word holds the key and a check sum over key and value, and is written
+ * after the value, so an interrupted write leaves an invalid record, which
+ * is skipped.  The last valid record of a key is its current value.
+ *
+ * If the active page is full, the other page is erased, the current values
+ * of all keys are copied to it, and its header is written at last.  The
+ * header holds a sequence number, ParamStoreInit() selects the page with
+ * the newer one.  So the old values are never lost by an interrupted erase,
+ * and every page is only erased after about 127 changes.
+ *
+ * The record sequence counter, the DCF77 reception history, and the journal
+ * of the log buffer keep their own flash areas, see RecordSeq.c, DCF77.c,
+ * and LOG_JOURNAL.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_assert.h"
+#include "em_msc.h"
+#include "ParamStore.h"
+#include "Logging.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Number of words per flash page. */
+#define PARAM_PAGE_WORDS	(FLASH_PAGE_SIZE / 4)
+
+    /*!@brief Value of an erased flash word. */
+#define PARAM_ERASED		0xFFFFFFFFUL
+
+    /*!@brief Page header, "PS" and a 16bit sequence number. */
+#define PARAM_HDR(seq)		(0x50530000UL | ((seq) & 0xFFFF))
+#define PARAM_HDR_VALID(w)	(((w) >> 16) == 0x5053)
+
+    /*!@brief Key word of a record, with the check sum over key and value. */
+#define PARAM_CHECK(k, v)	((~((k) + ((v) & 0xFFFF) + ((v) >> 16))) & 0xFFFF)
+#define PARAM_KEY_WORD(k, v)	((PARAM_CHECK(k, v) << 16) | (k))
+
+/*================================ Local Data ================================*/
+
+    /* Flash area of the parameters, defined by the linker script */
+extern uint32_t	__ParamStart[], __ParamEnd[];
+
+    /*! Current values, and a bit mask of the keys which have a value */
+static uint32_t	l_Param[END_PARAM_KEY];
+static uint32_t	l_ParamValid;
+
+    /*! Active page, NULL if none, its sequence number and next free slot */
+static uint32_t	*l_pPage;
+static uint16_t	l_PageSeq;
+static uint32_t	*l_pFree;
+
+/*=========================== Forward Declarations ===========================*/
+
+static msc_Return_TypeDef ParamWrite (uint32_t *pSlot, uint32_t key,
+				      uint32_t value);
+static msc_Return_TypeDef ParamCompact (void);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Parameter Store
+ *
+ * This routine selects the page with the newer header, and reads the current
+ * values of all keys from its records.  It must be called once before the
+ * first ParamGet(), e.g. by main() after LogInit().
+ *
+ ******************************************************************************/
+void	ParamStoreInit (void)
+{
+uint32_t *pPage, *pWord;
+uint32_t key;
+
+    l_pPage = NULL;
+    l_ParamValid = 0;
+
+    for (pPage = __ParamStart;  pPage < __ParamEnd;  pPage += PARAM_PAGE_WORDS)
+    {
+	if (PARAM_HDR_VALID(*pPage)  &&  (l_pPage == NULL
+		||  (int16_t)((*pPage & 0xFFFF) - l_PageSeq) > 0))
+	{
+	    l_pPage = pPage;
+	    l_PageSeq = *pPage & 0xFFFF;
+	}
+    }
+
+    if (l_pPage == NULL)
+	return;			// no parameters yet
+
+    for (pWord = l_pPage + 1;  pWord + 1 < l_pPage + PARAM_PAGE_WORDS;
+	 pWord += 2)
+    {
+	if (pWord[0] == PARAM_ERASED  &&  pWord[1] == PARAM_ERASED)
+	    break;			// first free slot
+
+	key = pWord[1] & 0xFFFF;
+	if (key < END_PARAM_KEY  &&  pWord[1] == PARAM_KEY_WORD(key, pWord[0]))
+	{
+	    l_Param[key] = pWord[0];
+	    l_ParamValid |= (1 << key);
+	}
+    }
+    l_pFree = pWord;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read a Parameter
+ *
+ * @param[in] key
+ *	Key of the parameter.
+ *
+ * @param[out] pValue
+ *	Address of the variable where to store the value.  It is not changed
+ *	if the parameter has not been stored yet.
+ *
+ * @return
+ *	The value <i>true</i> if the parameter exists.
+ *
+ ******************************************************************************/
+bool	ParamGet (PARAM_KEY key, uint32_t *pValue)
+{
+    EFM_ASSERT (key < END_PARAM_KEY  &&  pValue != NULL);
+
+    if ((l_ParamValid & (1 << key)) == 0)
+	return false;
+
+    *pValue = l_Param[key];
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write a Parameter
+ *
+ * This routine stores the new value of a parameter in the flash, if it has
+ * changed.  It programs the flash, so it must not be called in interrupt
+ * context.
+ *
+ * @param[in] key
+ *	Key of the parameter.
+ *
+ * @param[in] value
+ *	New value of the parameter.
+ *
+ * @return
+ *	The value <i>true</i> if the value has been stored.
+ *
+ ******************************************************************************/
+bool	ParamSet (PARAM_KEY key, uint32_t value)
+{
+msc_Return_TypeDef res;
+
+    EFM_ASSERT (key < END_PARAM_KEY);
+
+    if ((l_ParamValid & (1 << key))  &&  l_Param[key] == value)
+	return true;			// nothing to do
+
+    l_Param[key] = value;
+    l_ParamValid |= (1 << key);
+
+    if (l_pPage == NULL  ||  l_pFree + 1 >= l_pPage + PARAM_PAGE_WORDS)
+    {
+	/* Page is full, copy the current values into the other one */
+	res = ParamCompact();
+    }
+    else
+    {
+	res = ParamWrite (l_pFree, key, value);
+	l_pFree += 2;			// slot is used, even if it failed
+    }
+
+    if (res != mscReturnOk)
+    {
+	LogError ("Parameter Store: Flash Error %d", res);
+	return false;
+    }
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Program a Record
+ *
+ * The value is programmed before the key word, which validates the record.
+ *
+ ******************************************************************************/
+static msc_Return_TypeDef ParamWrite (uint32_t *pSlot, uint32_t key,
+				      uint32_t value)
+{
+msc_Return_TypeDef res;
+uint32_t word = PARAM_KEY_WORD(key, value);
+
+    MSC_Init();
+    res = MSC_WriteWord (pSlot, &value, 4);
+    if (res == mscReturnOk)
+	res = MSC_WriteWord (pSlot + 1, &word, 4);
+    MSC_Deinit();
+
+    return res;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Copy the current Values into the other Page
+ *
+ * The other page is erased, and gets a record for each key which has a
+ * value.  The header is programmed at last, so the page only becomes the
+ * active one if it is complete.
+ *
+ ******************************************************************************/
+static msc_Return_TypeDef ParamCompact (void)
+{
+msc_Return_TypeDef res;
+uint32_t *pPage, *pSlot;
+uint32_t key, hdr;
+
+    if (l_pPage == NULL  ||  l_pPage + PARAM_PAGE_WORDS >= __ParamEnd)
+	pPage = __ParamStart;
+    else
+	pPage = l_pPage + PARAM_PAGE_WORDS;
+
+    MSC_Init();
+    res = MSC_ErasePage (pPage);
+    MSC_Deinit();
+
+    pSlot = pPage + 1;
+    for (key = 0;  key < END_PARAM_KEY  &&  res == mscReturnOk;  key++)
+    {
+	if (l_ParamValid & (1 << key))
+	{
+	    res = ParamWrite (pSlot, key, l_Param[key]);
+	    pSlot += 2;
+	}
+    }
+
+    if (res != mscReturnOk)
+	return res;			// keep the old page
+
+    hdr = PARAM_HDR(l_PageSeq + 1);
+    MSC_Init();
+    res = MSC_WriteWord (pPage, &hdr, 4);
+    MSC_Deinit();
+
+    if (res == mscReturnOk)
+    {
+	l_pPage = pPage;
+	l_PageSeq++;
+	l_pFree = pSlot;
+    }
+    return res;
+}
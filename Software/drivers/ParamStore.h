@@ -0,0 +1,43 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module ParamStore.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_ParamStore_h
+#define __INC_ParamStore_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Keys of the parameters in the internal flash, see ParamSet().
+ * The numbers are stored in the flash, so only append new keys!
+ */
+typedef enum
+{
+    PARAM_TC_TRIM,	//!< 0: Trim of the temperature compensation in [ppb]
+    PARAM_AUDIO_INV,	//!< 1: Audio inventory, file count and space left
+    END_PARAM_KEY
+} PARAM_KEY;
+
+/*================================ Prototypes ================================*/
+
+    /* Find the current values in the flash */
+void	ParamStoreInit (void);
+
+    /* Read and write a parameter */
+bool	ParamGet (PARAM_KEY key, uint32_t *pValue);
+bool	ParamSet (PARAM_KEY key, uint32_t value);
+
+
+#endif /* __INC_ParamStore_h */
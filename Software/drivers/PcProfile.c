@@ -0,0 +1,346 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Statistical Program Counter Profiler
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module samples the program counter by the SysTick interrupt at
+ * @ref PC_PROFILE_HZ.  The interrupted address is taken from the exception
+ * stack frame and counted in a histogram with buckets of 2^@ref
+ * PC_PROFILE_SHIFT bytes, which covers the application in flash.  Samples
+ * in the @ref RAMFUNC code, and all others, e.g. in the booter, are only
+ * counted.  Where the ISR profile (see IsrProfile.c) shows the time of the
+ * interrupt service routines, this profile shows where the main loop and
+ * the deferred work spend their time.
+ *
+ * The histogram is dumped by PcProfileReport(), e.g. via the console commands
+ * "PCS" and "PCSC", or written to @ref PC_PROFILE_FILE_NAME on the SD-Card
+ * by PcProfileWrite(), console command "PCSD".  The host tool "PcResolve"
+ * assigns the buckets to the functions of the map file of the same build,
+ * i.e. <b>armgcc/lst/AUDIO.map</b>.
+ *
+ * @note
+ * SysTick does not run in EM1 and EM2, so only the time in EM0 is sampled.
+ * It uses @ref INT_PRIO_PCPROF to preempt all other interrupts, but code
+ * executed with INT_Disable() is accounted to the instruction after
+ * INT_Enable().  The sampling is suspended while the histogram is dumped.
+ * Without @ref PC_PROFILE, this module is empty.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_cmu.h"
+#include "em_int.h"
+#include "PcProfile.h"
+#include "FwUpdate.h"
+#include "LEUART.h"
+#include "Logging.h"
+#include "PowerFail.h"
+#include "ff.h"		// FS_FAT12/16/32
+#include "diskio.h"	// DSTATUS
+#include "microsd.h"
+#include "StrFormat.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Number of histogram buckets to cover the application. */
+#define PC_PROF_BUCKETS	((FW_APP_SIZE + (1 << PC_PROFILE_SHIFT) - 1)	\
+			 >> PC_PROFILE_SHIFT)
+
+    /*!@brief Maximum length of a line of the dump. */
+#define PC_PROF_LINE_SIZE	100
+
+#if PC_PROFILE
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Histogram of the sampled addresses, saturates at 0xFFFF. */
+static volatile uint16_t l_PcHist[PC_PROF_BUCKETS];
+
+    /*!@brief Total number of samples, samples in RAM, and all others. */
+static volatile uint32_t l_PcTotal, l_PcRam, l_PcOther;
+
+    /*!@brief File handle for PcProfileWrite(). */
+static FIL	 l_fh;
+
+    /* Boundaries of the RAM functions, see "efm32g_0x8000.ld" */
+extern char	 __ramfunc_start__[], __ramfunc_end__[];
+
+/*=========================== Forward Declarations ===========================*/
+
+void	SysTick_Handler (void) __attribute__ ((naked));
+void	PcProfileSample (uint32_t pc) __attribute__ ((used));
+static void	pcProfileStart (void);
+static void	pcProfileStop (void);
+static int	pcProfileLine (char *pBuf, int idx, bool flgReset,
+			       const char *pEOL);
+
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the PC Profiler
+ *
+ * This routine starts the SysTick timer at @ref PC_PROFILE_HZ.  It must be
+ * called once after the clocks have been set up.  If @ref PC_PROFILE is 0,
+ * it does nothing.
+ *
+ ******************************************************************************/
+void	PcProfileInit (void)
+{
+#if PC_PROFILE
+    NVIC_SetPriority (SysTick_IRQn, INT_PRIO_PCPROF);
+    pcProfileStart();
+#endif
+}
+
+
+#if PC_PROFILE
+/***************************************************************************//**
+ *
+ * @brief	HF Clock has been changed
+ *
+ * This routine is called by HfClock.c after the HF clock has been switched.
+ * It recalculates the SysTick reload value, so the sampling rate remains
+ * @ref PC_PROFILE_HZ.
+ *
+ ******************************************************************************/
+void	PcProfileClockChange (void)
+{
+    if ((SysTick->CTRL & SysTick_CTRL_ENABLE_Msk) != 0)
+	pcProfileStart();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	SysTick Interrupt Handler
+ *
+ * This naked handler takes the stacked PC from the exception frame, which
+ * is on the process stack if the main loop has been interrupted, or on the
+ * main stack for an interrupt service routine (bit 2 of EXC_RETURN), and
+ * jumps to PcProfileSample().  Its return is the exception return.
+ *
+ ******************************************************************************/
+void	SysTick_Handler (void)
+{
+    __asm volatile (
+	"	tst	lr, #4		\n"	// EXC_RETURN: which stack
+	"	ite	eq		\n"
+	"	mrseq	r0, msp		\n"
+	"	mrsne	r0, psp		\n"
+	"	ldr	r0, [r0, #24]	\n"	// stacked PC
+	"	b	PcProfileSample	\n"
+    );
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Account a Sample
+ *
+ * This routine is only called by SysTick_Handler().
+ *
+ * @param[in] pc
+ *	Program counter of the interrupted code.
+ *
+ ******************************************************************************/
+void	PcProfileSample (uint32_t pc)
+{
+uint32_t idx = (pc - FW_APP_START) >> PC_PROFILE_SHIFT;	// wraps below
+
+    l_PcTotal++;
+
+    if (idx < PC_PROF_BUCKETS)
+    {
+	if (l_PcHist[idx] < 0xFFFF)
+	    l_PcHist[idx]++;
+    }
+    else if (pc >= (uint32_t)__ramfunc_start__
+	 &&  pc <  (uint32_t)__ramfunc_end__)
+    {
+	l_PcRam++;
+    }
+    else
+    {
+	l_PcOther++;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start and Stop the Sampling
+ *
+ * pcProfileStart() (re-)programs the SysTick timer for the current HF clock,
+ * pcProfileStop() halts it, e.g. while the histogram is dumped.
+ *
+ ******************************************************************************/
+static void	pcProfileStart (void)
+{
+uint32_t reload = CMU_ClockFreqGet (cmuClock_CORE) / PC_PROFILE_HZ;
+
+    if (reload > SysTick_LOAD_RELOAD_Msk)
+	reload = SysTick_LOAD_RELOAD_Msk;
+
+    SysTick->CTRL = 0;
+    SysTick->LOAD = reload - 1;
+    SysTick->VAL  = 0;
+    SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk
+		  | SysTick_CTRL_ENABLE_Msk;
+}
+
+static void	pcProfileStop (void)
+{
+    SysTick->CTRL = 0;
+    SCB->ICSR = SCB_ICSR_PENDSTCLR_Msk;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Format a Line of the Dump
+ *
+ * This routine formats the header line for an index of -1, or the line of
+ * the histogram bucket @p idx.  A bucket without samples results in an
+ * empty string.
+ *
+ * @return
+ *	Length of the line.
+ *
+ ******************************************************************************/
+static int	pcProfileLine (char *pBuf, int idx, bool flgReset,
+			       const char *pEOL)
+{
+uint32_t cnt;
+
+    if (idx < 0)
+    {
+	StrFormat (pBuf, "PCS base=0x%08lx shift=%d hz=%d total=%lu ram=%lu"
+		   " other=%lu%s", FW_APP_START, PC_PROFILE_SHIFT,
+		   PC_PROFILE_HZ, l_PcTotal, l_PcRam, l_PcOther, pEOL);
+	if (flgReset)
+	    l_PcTotal = l_PcRam = l_PcOther = 0;
+    }
+    else
+    {
+	cnt = l_PcHist[idx];
+	if (cnt == 0)
+	{
+	    *pBuf = EOS;
+	    return 0;
+	}
+	if (flgReset)
+	    l_PcHist[idx] = 0;
+
+	StrFormat (pBuf, "PCS 0x%08lx %lu%s",
+		   FW_APP_START + ((uint32_t)idx << PC_PROFILE_SHIFT),
+		   cnt, pEOL);
+    }
+    return strlen (pBuf);
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the PC Profile
+ *
+ * This routine dumps the histogram on the console.  The first line contains
+ * the base address, the bucket size as power of two, the sampling rate, and
+ * the number of samples in total, in RAM, and outside of the application.
+ * Then there is one line with the address and the number of samples per
+ * non-empty bucket.
+ *
+ * @param[in] flgReset
+ *	If true, the histogram is reset after it has been reported.
+ *
+ ******************************************************************************/
+void	PcProfileReport (bool flgReset)
+{
+#if ! PC_PROFILE
+    (void) flgReset;
+    drvLEUART_puts ("PC Profile: not enabled, see PC_PROFILE\n");
+#else
+char	 line[PC_PROF_LINE_SIZE];
+int	 i;
+
+    pcProfileStop();
+
+    for (i = -1;  i < PC_PROF_BUCKETS;  i++)
+	if (pcProfileLine (line, i, flgReset, "\n") > 0)
+	    drvLEUART_puts (line);
+
+    if (flgReset)
+	drvLEUART_puts ("PC Profile has been reset\n");
+
+    pcProfileStart();
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write the PC Profile to the SD-Card
+ *
+ * This routine writes the histogram in the same format as PcProfileReport()
+ * to the file @ref PC_PROFILE_FILE_NAME.  The histogram is not reset.
+ *
+ ******************************************************************************/
+void	PcProfileWrite (void)
+{
+#if ! PC_PROFILE
+    drvLEUART_puts ("PC Profile: not enabled, see PC_PROFILE\n");
+#else
+char	 line[PC_PROF_LINE_SIZE];
+FRESULT	 res;
+UINT	 cnt;
+int	 i, len;
+
+    /* Check for power-fail */
+    if (IsPowerFail())
+	return;
+
+    /* Switch the SD-Card Interface on, re-initialize it if required */
+    if (IsDiskRemoved()  ||  DiskAcquire() != 0)
+    {
+	LogError ("PcProfile: SD-Card Initialization Failed");
+	DiskRelease (false);
+	return;
+    }
+
+    pcProfileStop();
+
+    res = f_open (&l_fh, PC_PROFILE_FILE_NAME, FA_WRITE | FA_CREATE_ALWAYS);
+    if (res == FR_OK)
+    {
+	for (i = -1;  i < PC_PROF_BUCKETS  &&  res == FR_OK;  i++)
+	{
+	    len = pcProfileLine (line, i, false, "\r\n");
+	    if (len > 0)
+		res = f_write (&l_fh, line, len, &cnt);
+	}
+
+	if (f_close (&l_fh) != FR_OK  &&  res == FR_OK)
+	    res = FR_DISK_ERR;
+	FindFileCacheInvalidate();	// file may have been created
+    }
+
+    DiskRelease (res == FR_OK);
+
+    pcProfileStart();
+
+    if (res != FR_OK)
+	LogError ("PcProfile: Error Code %d writing %s", res,
+		  PC_PROFILE_FILE_NAME);
+    else
+	Log ("PcProfile: %lu samples written to %s", l_PcTotal,
+	     PC_PROFILE_FILE_NAME);
+#endif
+}
@@ -0,0 +1,64 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module PcProfile.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_PcProfile_h
+#define __INC_PcProfile_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to sample the program counter by the SysTick
+ * interrupt, see PcProfileInit().  Without it, no code or RAM is used.
+ */
+#ifndef PC_PROFILE
+    #define PC_PROFILE		0
+#endif
+
+#ifdef SIMULATION
+    /* The host simulation has no SysTick and no exception stack frame */
+    #undef  PC_PROFILE
+    #define PC_PROFILE		0
+#endif
+
+/*!@brief Sampling rate of the program counter in [Hz]. */
+#ifndef PC_PROFILE_HZ
+    #define PC_PROFILE_HZ	2000
+#endif
+
+/*!@brief Size of a histogram bucket as power of two, i.e. 7 for 128 bytes.
+ * The histogram covers the application in flash, so it takes 2 bytes of RAM
+ * per bucket, i.e. 1.4KB for 128 bytes.
+ */
+#ifndef PC_PROFILE_SHIFT
+    #define PC_PROFILE_SHIFT	7
+#endif
+
+/*================================ Prototypes ================================*/
+
+    /* Start the SysTick sampling */
+void	PcProfileInit (void);
+
+    /* HF clock has been switched, recalculate the SysTick reload */
+void	PcProfileClockChange (void);
+
+    /* Dump the histogram on the console, optionally reset it */
+void	PcProfileReport (bool flgReset);
+
+    /* Write the histogram to the SD-Card */
+void	PcProfileWrite (void);
+
+
+#endif /* __INC_PcProfile_h */
@@ -0,0 +1,479 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Playlist
+ * @author	agent
+ * @version	2026-10-14
+ *
+ * This module selects the playback files for the random PLAYBACK_TYPEs.
+ * Instead of drawing each file independently with rand(), it uses a shuffle
+ * bag: every file is put into a sequence as often as its weight says, the
+ * sequence is shuffled once, and the files are played in this order.  When
+ * the sequence has been played completely, a new one is generated.  This
+ * guarantees that all files are played with the configured ratio within each
+ * sequence, and picking the next file is a simple table access.
+ *
+ * The files of a sequence depend on the PLAYBACK_TYPE:
+ * - 6 to 9 use the files P001 to P002 ... P005, each with weight 1.
+ * - @ref PLAY_TYPE_PLAYLIST uses the list of the configuration variable
+ *   PLAYLIST, e.g. <b>PLAYLIST = 1-3, 4*2, 6-9*3</b>, where a range gives
+ *   several files and the number after '*' their weight.
+ * - @ref PLAY_TYPE_STIM_SET and the following types use the stimulus groups
+ *   STIM_SET_1 to STIM_SET_n, e.g. <b>STIM_SET_1 = 1-40</b>, in the same
+ *   format.  File numbers up to @ref PLAYLIST_MAX_FILE are possible.
+ *
+ * If a file list has more entries than @ref PLAYLIST_SEQ_SIZE, each sequence
+ * is a random sample of the list (reservoir sampling), so all files get the
+ * same chance on average.
+ *
+ * Every PLAYBACK_TYPE has its own position within its own sequence.  Only
+ * the sequence of the type that is used at the moment is kept in RAM, when
+ * a transponder with a different type is served, this sequence is generated
+ * again from its seed, see @ref PLAYLIST_STATE.  Changing between types does
+ * therefore not disturb the balance of a sequence.
+ *
+ * The configuration variable PLAYLIST_NO_REPEAT specifies the number of
+ * other playbacks which must be between two playbacks of the same file.
+ * This is considered across the boundary of sequences, too.  If the weights
+ * do not allow this, the constraint is violated as rarely as possible.
+ *
+ * The random numbers are generated by a xorshift generator, which is seeded
+ * from the clock and the RTC counter.  Its state is kept in the RAM section
+ * that is not cleared at reset, so a reset does not repeat a sequence.
+ * Random numbers in a range are generated by rejection, i.e. without the
+ * modulo bias of <b>rand() % n</b>.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	- Added stimulus groups STIM_SET_1 to STIM_SET_n, file numbers
+		  up to P999, and reservoir sampling for large file lists.
+		- Every PLAYBACK_TYPE keeps its own sequence position, the
+		  sequence is generated again from its seed.
+2026-10-14,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <time.h>
+#include <string.h>
+#include "em_rtc.h"
+#include "Playlist.h"
+#include "Logging.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Place a variable into the RAM section which is not cleared at
+     * reset, see @ref l_Random. */
+#define PLAYLIST_NOINIT		__attribute__((section(".noinit")))
+
+    /*!@brief Magic value of a valid random generator state ("PRNG"). */
+#define PLAYLIST_RND_MAGIC	((uint32_t)0x50524E47)
+
+    /*!@brief Number of PLAYBACK_TYPEs with a sequence, 6 to @ref PLAY_TYPE_MAX */
+#define PLAYLIST_SLOTS		(PLAY_TYPE_MAX - PLAY_TYPE_FIXED_MAX)
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief State of the sequence of one PLAYBACK_TYPE.
+     *
+     * A sequence is completely defined by the <b>Seed</b> of its random
+     * generator and the recent playbacks before the sequence started, which
+     * are required for the no-repeat window.
+     */
+typedef struct
+{
+    uint32_t	Seed;			//!< seed of the sequence, 0 if none
+    uint16_t	Idx;			//!< index of the next playback
+    uint16_t	Len;			//!< length of the sequence
+    uint16_t	History[PLAYLIST_NO_REPEAT_MAX]; //!< before the sequence
+} PLAYLIST_STATE;
+
+/*========================= Global Data and Routines =========================*/
+
+    /*!@brief Files and weights for @ref PLAY_TYPE_PLAYLIST, set by PLAYLIST. */
+CFG_LIST	g_Playlist;
+
+    /*!@brief Stimulus groups, set by STIM_SET_1 to STIM_SET_n. */
+CFG_LIST	g_StimSet[PLAYLIST_STIM_SETS];
+
+    /*!@brief Minimum number of other playbacks between two playbacks of the
+     * same file, set by PLAYLIST_NO_REPEAT. */
+int32_t		g_PlaylistNoRepeat;
+
+/*================================ Local Data ================================*/
+
+    /*! State of the random generator, survives a reset. */
+static struct
+{
+    uint32_t	Magic;			//!< @ref PLAYLIST_RND_MAGIC
+    uint32_t	State;			//!< xorshift state, never 0
+    uint32_t	Check;			//!< inverted state
+} l_Random PLAYLIST_NOINIT;
+
+    /*! Sequence position of each PLAYBACK_TYPE. */
+static PLAYLIST_STATE l_State[PLAYLIST_SLOTS];
+
+    /*! Sequence of file numbers of the PLAYBACK_TYPE in @ref l_SeqSlot. */
+static uint16_t	l_Seq[PLAYLIST_SEQ_SIZE];
+
+    /*! Index of @ref l_State the sequence belongs to, or -1. */
+static int	l_SeqSlot = -1;
+
+/*=========================== Forward Declarations ===========================*/
+
+static uint32_t	PlaylistRandom (uint32_t *pState, uint32_t range);
+static int	PlaylistWindow (void);
+static bool	PlaylistConflict (const uint16_t *pHistory, int file, int pos,
+				  int window);
+static const CFG_LIST *PlaylistFiles (int slot, CFG_LIST *pDflt);
+static void	PlaylistBuild (int slot);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Playlist
+ *
+ * This routine checks the state of the random generator, which is kept over
+ * a reset.  After power-on it is seeded from the current time and the RTC
+ * counter.  It must be called after the clock has been initialized.
+ *
+ ******************************************************************************/
+void	PlaylistInit (void)
+{
+    if (l_Random.Magic != PLAYLIST_RND_MAGIC  ||  l_Random.State == 0
+    ||  l_Random.Check != ~l_Random.State)
+    {
+	l_Random.State = (uint32_t)time(NULL) ^ (RTC->CNT << 8) ^ 0x9E3779B9;
+	if (l_Random.State == 0)
+	    l_Random.State = 0x9E3779B9;
+
+	l_Random.Check = ~l_Random.State;
+	l_Random.Magic = PLAYLIST_RND_MAGIC;
+    }
+
+    PlaylistReset();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Reset the Playlist
+ *
+ * This routine discards the sequences of all PLAYBACK_TYPEs, so the next
+ * call of PlaylistNext() generates a new one.  It is called when the
+ * configuration is read again.
+ *
+ ******************************************************************************/
+void	PlaylistReset (void)
+{
+    memset (l_State, 0, sizeof(l_State));
+    l_SeqSlot = -1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the File Number for the next Playback
+ *
+ * This routine returns the next file number of the sequence of the specified
+ * PLAYBACK_TYPE.  A new sequence is generated when the current one has been
+ * played completely.
+ *
+ * @param[in] playType
+ *	PLAYBACK_TYPE, 6 to @ref PLAY_TYPE_MAX.
+ *
+ * @return
+ *	File number 1 to @ref PLAYLIST_MAX_FILE, or 0 for an invalid type.
+ *
+ ******************************************************************************/
+int	PlaylistNext (int playType)
+{
+PLAYLIST_STATE *pState;
+int	slot, k, window;
+
+    slot = playType - PLAY_TYPE_FIXED_MAX - 1;
+    if (slot < 0  ||  slot >= PLAYLIST_SLOTS)
+    {
+	LogError ("Playlist: Invalid PLAYBACK_TYPE %d", playType);
+	return 0;
+    }
+    pState = &l_State[slot];
+
+    if (pState->Seed != 0  &&  pState->Idx >= pState->Len)
+    {
+	/* sequence is over - get the history for the next one */
+	if (slot != l_SeqSlot)
+	    PlaylistBuild (slot);
+
+	window = PlaylistWindow();
+	for (k = window - 1;  k >= 0;  k--)
+	{
+	    pState->History[k] = (k < pState->Len ? l_Seq[pState->Len - 1 - k]
+				  : pState->History[k - pState->Len]);
+	}
+	pState->Seed = 0;
+    }
+
+    if (pState->Seed == 0)
+    {
+	/* new sequence with the next seed of the random generator */
+	do
+	{
+	    pState->Seed = PlaylistRandom (&l_Random.State, 0xFFFFFFFFUL);
+	} while (pState->Seed == 0);
+	l_Random.Check = ~l_Random.State;
+
+	pState->Idx = 0;
+	l_SeqSlot = -1;		// must be generated
+    }
+
+    if (slot != l_SeqSlot)
+	PlaylistBuild (slot);
+
+    return l_Seq[pState->Idx++];
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Generate a Sequence
+ *
+ * This routine puts all files of the selected PLAYBACK_TYPE, each according
+ * to its weight, into @ref l_Seq and shuffles them (Fisher-Yates).  Then the
+ * sequence is scanned for files which have been played within the no-repeat
+ * window, each of these is exchanged with a later file which has not.  Files
+ * with a high weight are placed early enough, so they do not accumulate at
+ * the end of the sequence.
+ *
+ * All random numbers are derived from the seed in @ref l_State, so the same
+ * sequence is generated again after another PLAYBACK_TYPE has been used.
+ *
+ * @param[in] slot
+ *	Index of the PLAYBACK_TYPE in @ref l_State.
+ *
+ ******************************************************************************/
+static void	PlaylistBuild (int slot)
+{
+PLAYLIST_STATE	*pState = &l_State[slot];
+CFG_LIST	 dflt;
+const CFG_LIST	*pList;
+const CFG_LIST_ENTRY *pEntry;
+uint32_t rnd = pState->Seed;
+uint32_t total = 0;
+int	 i, j, file, weight, window, len;
+int	 violations = 0;
+uint8_t	 cnt[PLAYLIST_SEQ_SIZE];
+uint16_t tmp;
+uint8_t	 tmpCnt;
+
+
+    /* put the files of the list into the sequence, sample large lists */
+    pList = PlaylistFiles (slot, &dflt);
+    for (i = 0;  i < pList->Cnt;  i++)
+    {
+	pEntry = &pList->Entry[i];
+	for (file = pEntry->First;  file <= pEntry->Last;  file++)
+	{
+	    if (file > PLAYLIST_MAX_FILE)
+	    {
+		LogError ("Playlist: File number %d is out of range 1-%d",
+			  file, PLAYLIST_MAX_FILE);
+		break;
+	    }
+	    for (weight = 0;  weight < pEntry->Weight;  weight++, total++)
+	    {
+		if (total < PLAYLIST_SEQ_SIZE)
+		{
+		    l_Seq[total] = (uint16_t)file;
+		}
+		else
+		{
+		    j = (int)PlaylistRandom (&rnd, total + 1);
+		    if (j < PLAYLIST_SEQ_SIZE)
+			l_Seq[j] = (uint16_t)file;
+		}
+	    }
+	}
+    }
+
+    if (total == 0)
+	l_Seq[total++] = 1;	// nothing valid, play P001
+
+    len = (total < PLAYLIST_SEQ_SIZE ? (int)total : PLAYLIST_SEQ_SIZE);
+
+    /* shuffle */
+    for (i = len - 1;  i > 0;  i--)
+    {
+	j = (int)PlaylistRandom (&rnd, i + 1);
+	tmp = l_Seq[i];  l_Seq[i] = l_Seq[j];  l_Seq[j] = tmp;
+    }
+
+    /*
+     * Enforce the no-repeat window.  The remaining part of the sequence is
+     * the (shuffled) pool, the first file which is not within the window is
+     * moved to the current position.  A file with so many remaining
+     * playbacks that it needs every (window+1)th position is taken first.
+     * <cnt> is the number of entries of the same file in the pool.
+     */
+    window = PlaylistWindow();
+    for (i = 0;  window > 0  &&  i < len;  i++)
+    {
+	for (cnt[i] = 0, j = 0;  j < len;  j++)
+	    if (l_Seq[j] == l_Seq[i])
+		cnt[i]++;
+    }
+
+    for (i = 0;  window > 0  &&  i < len;  i++)
+    {
+	for (file = i, j = i + 1;  j < len;  j++)
+	    if (cnt[j] > cnt[file])
+		file = j;
+
+	if ((cnt[file] - 1) * (window + 1) < len - i - 1
+	||  PlaylistConflict (pState->History, l_Seq[file], i, window))
+	{
+	    /* no file must be taken now */
+	    for (file = i;  file < len;  file++)
+		if (! PlaylistConflict (pState->History, l_Seq[file], i, window))
+		    break;
+	}
+
+	if (file < len)
+	{
+	    tmp = l_Seq[i];  l_Seq[i] = l_Seq[file];  l_Seq[file] = tmp;
+	    tmpCnt = cnt[i];  cnt[i] = cnt[file];  cnt[file] = tmpCnt;
+	}
+	else
+	{
+	    violations++;	// the weights do not allow the constraint
+	}
+
+	/* this entry leaves the pool */
+	for (j = i + 1;  j < len;  j++)
+	    if (l_Seq[j] == l_Seq[i])
+		cnt[j]--;
+    }
+
+    l_SeqSlot   = slot;
+    pState->Len = (uint16_t)len;
+
+    if (pState->Idx == 0)
+    {
+	LOG_DBG ("Playlist: New sequence of %d playbacks%s", len,
+		 violations ? ", no-repeat window violated" : "");
+	if (total > PLAYLIST_SEQ_SIZE)
+	    LOG_DBG ("Playlist: Sampled %d of %lu list entries", len, total);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the File List of a PLAYBACK_TYPE
+ *
+ * This routine returns the list of files and weights for the specified
+ * PLAYBACK_TYPE.  If the respective configuration variable is not defined,
+ * P001 to P005 are used.
+ *
+ * @param[in] slot
+ *	Index of the PLAYBACK_TYPE in @ref l_State.
+ *
+ * @param[out] pDflt
+ *	Buffer to build a list for the PLAYBACK_TYPEs 6 to 9, or the default.
+ *
+ * @return
+ *	Address of the list.
+ *
+ ******************************************************************************/
+static const CFG_LIST *PlaylistFiles (int slot, CFG_LIST *pDflt)
+{
+int	playType = slot + PLAY_TYPE_FIXED_MAX + 1;
+
+    pDflt->Cnt = 1;
+    pDflt->Entry[0].First  = 1;
+    pDflt->Entry[0].Last   = PLAY_TYPE_FIXED_MAX;
+    pDflt->Entry[0].Weight = 1;
+
+    if (playType <= PLAY_TYPE_SHUFFLE_MAX)
+    {
+	pDflt->Entry[0].Last = playType - 4;
+	return pDflt;
+    }
+
+    if (playType == PLAY_TYPE_PLAYLIST)
+    {
+	if (g_Playlist.Cnt > 0)
+	    return &g_Playlist;
+
+	LogError ("Playlist: PLAYLIST is not defined, using P001-P005");
+	return pDflt;
+    }
+
+    if (g_StimSet[playType - PLAY_TYPE_STIM_SET].Cnt > 0)
+	return &g_StimSet[playType - PLAY_TYPE_STIM_SET];
+
+    LogError ("Playlist: STIM_SET_%d is not defined, using P001-P005",
+	      playType - PLAY_TYPE_STIM_SET + 1);
+    return pDflt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check the No-Repeat Window
+ *
+ * This routine checks if the specified file has been played within the
+ * no-repeat window before position <b>pos</b> of the new sequence.  The
+ * window extends into <b>pHistory</b>, i.e. the end of the last sequence.
+ *
+ ******************************************************************************/
+static bool	PlaylistConflict (const uint16_t *pHistory, int file, int pos,
+				  int window)
+{
+int	k;
+
+    for (k = 1;  k <= window;  k++)
+    {
+	if ((pos - k >= 0 ? l_Seq[pos - k] : pHistory[k - pos - 1]) == file)
+	    return true;
+    }
+    return false;
+}
+
+
+// returns the effective size of the no-repeat window
+static int	PlaylistWindow (void)
+{
+    if (g_PlaylistNoRepeat > PLAYLIST_NO_REPEAT_MAX)
+	return PLAYLIST_NO_REPEAT_MAX;
+
+    return (int)g_PlaylistNoRepeat;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Generate a Random Number
+ *
+ * This routine advances the specified xorshift state and returns a uniformly
+ * distributed random number in the range 0 to <b>range</b>-1.  Values above
+ * the largest multiple of <b>range</b> are rejected, so there is no modulo
+ * bias.
+ *
+ ******************************************************************************/
+static uint32_t	PlaylistRandom (uint32_t *pState, uint32_t range)
+{
+uint32_t x, limit;
+
+    limit = 0xFFFFFFFFUL - (0xFFFFFFFFUL % range);
+
+    do
+    {
+	x = *pState;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*pState = x;
+    } while (x >= limit);
+
+    return x % range;
+}
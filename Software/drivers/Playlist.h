@@ -0,0 +1,81 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Playlist.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Reduced PLAYLIST_SEQ_SIZE to 64.
+2026-10-14,agnt	Added PLAY_TYPE_STIM_SET and PLAYLIST_STIM_SETS, file numbers
+		up to P999.
+2026-10-14,agnt	Initial version.
+*/
+
+#ifndef __INC_Playlist_h
+#define __INC_Playlist_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+#include "CfgData.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief PLAYBACK_TYPE values 1 to 5 play this file number only. */
+#define PLAY_TYPE_FIXED_MAX	5
+
+    /*!@brief PLAYBACK_TYPE values 6 to 9 shuffle P001 to P002 ... P005. */
+#define PLAY_TYPE_SHUFFLE_MAX	9
+
+    /*!@brief PLAYBACK_TYPE which shuffles the files of @ref g_Playlist. */
+#define PLAY_TYPE_PLAYLIST	10
+
+    /*!@brief First PLAYBACK_TYPE which shuffles a stimulus group, 11 for
+     * STIM_SET_1, 12 for STIM_SET_2, and so on. */
+#define PLAY_TYPE_STIM_SET	11
+
+#ifndef PLAYLIST_STIM_SETS
+    /*!@brief Number of stimulus groups STIM_SET_1 to STIM_SET_n. */
+    #define PLAYLIST_STIM_SETS	4
+#endif
+
+    /*!@brief Highest PLAYBACK_TYPE. */
+#define PLAY_TYPE_MAX		(PLAY_TYPE_STIM_SET + PLAYLIST_STIM_SETS - 1)
+
+    /*!@brief Highest file number the playback command can address (P999). */
+#define PLAYLIST_MAX_FILE	999
+
+#ifndef PLAYLIST_SEQ_SIZE
+    /*!@brief Maximum length of a playlist sequence, each entry takes 2 bytes
+     * of RAM.  If the sum of all file weights is larger, each sequence is a
+     * random sample of the list. */
+    #define PLAYLIST_SEQ_SIZE	64
+#endif
+
+#ifndef PLAYLIST_NO_REPEAT_MAX
+    /*!@brief Maximum value of @ref g_PlaylistNoRepeat. */
+    #define PLAYLIST_NO_REPEAT_MAX	8
+#endif
+
+/*================================ Global Data ===============================*/
+
+extern CFG_LIST	g_Playlist;
+extern CFG_LIST	g_StimSet[PLAYLIST_STIM_SETS];
+extern int32_t	g_PlaylistNoRepeat;
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize the random generator */
+void	PlaylistInit (void);
+
+    /* Discard the current sequence, e.g. after a new configuration */
+void	PlaylistReset (void);
+
+    /* Get the file number for the next playback */
+int	PlaylistNext (int playType);
+
+
+#endif /* __INC_Playlist_h */
@@ -2,12 +2,39 @@
  * @file
  * @brief	Power Fail Logic
  * @author	Ralf Gerhauser
- * @version	2020-01-22
+ * @version	2026-10-15
  *
- * This module handles all actions required in case of a power-fail.
+ * This module handles all actions required in case of a power-fail.  The
+ * power-fail handlers are called in stages, see POWER_FAIL_STAGE: first the
+ * high-current loads are cut, then the log journal is saved into flash, and
+ * finally the SD-Card is parked.  The duration of each stage is measured and
+ * logged after the power has come back, see PowerFailReport().
+ *
+ * After a short outage of at most @ref PF_FAST_RESUME_TIME seconds, and if
+ * the Battery Pack has not been changed, the resume functions restore the
+ * previous state of the modules.  Otherwise the battery is probed again, and
+ * the power schedule decides which devices are switched on.
+ *
+ * If @ref PF_VCMP_WARNING is set, the voltage comparator (VCMP) monitors VDD.
+ * Falling below @ref PF_VCMP_LEVEL is treated like a power-fail, so the
+ * shutdown begins before the power-fail signal of the regulator is asserted,
+ * and there is more hold-up time for the stages.
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	The statistics of a power-fail stage take 6 instead of 12 bytes.
+2026-10-15,agnt	The VCMP and ADC clocks are acquired via ClockMgr.c.
+2026-10-15,agnt	Use StrFormat() instead of sprintf().
+2026-10-15,agnt	Fast resume after a short outage with the same Battery Pack,
+		see PF_FAST_RESUME_TIME and BatteryIsUnchanged().
+2026-10-15,agnt	Early warning by the voltage comparator, see PF_VCMP_WARNING.
+		IsPowerFail() also returns true while VDD is below the level.
+2026-10-15,agnt	Staged shutdown: PowerFailCheck() executes a list of stages,
+		each with a time budget and a minimum supply voltage, which is
+		measured by PowerFailSupply().  The external interrupts are
+		replayed after the loads have been switched off.
+2026-10-14,agnt	PowerFailHandler: Posts events for all main loop tasks, so they
+		check their state after the power-fail has disappeared.
 2020-05-12,rage	Call CheckAlarmTimes() after Power Fail has disappeared.
 2020-01-22,rage	PowerFailCheck: call BatteryChangeTrigger() when power good.
 2017-01-31,rage	Initial version.
@@ -17,36 +44,108 @@ Revision History:
 
 #include "em_assert.h"
 #include "em_cmu.h"
+#include "em_int.h"
 #include "ExtInt.h"
 #include "PowerFail.h"
 #include "BatteryMon.h"
 #include "AlarmClock.h"		// import CheckAlarmTimes()
+#include <time.h>
 #include "Logging.h"
+#include "StrFormat.h"
+#include "ClockMgr.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Maximum number of power-fail stages */
+#define PF_MAX_STAGES		4
+
+    /*! Number of status polls until an ADC conversion must be done, or the
+     *  voltage comparator must be active */
+#define PF_ADC_TIMEOUT		1000
+
+#if PF_VCMP_WARNING
+    /*! Trigger level of the VCMP: VDD = 1.667V + 0.034V * TRIGLEVEL */
+#define PF_VCMP_TRIGLEVEL	((PF_VCMP_LEVEL - 1667 + 17) / 34)
+#endif
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*! Result of a power-fail stage */
+typedef enum
+{
+    PF_STAGE_NONE,		//!< no power-fail since reset
+    PF_STAGE_DONE,		//!< all handlers have been executed
+    PF_STAGE_SKIP_TIME,		//!< skipped, hold-up time is exceeded
+    PF_STAGE_SKIP_SUPPLY,	//!< skipped, supply voltage is too low
+} PF_STAGE_RESULT;
+
+    /*! Statistics of a power-fail stage */
+typedef struct
+{
+    uint8_t	    Result;	//!< result of the last power-fail, PF_STAGE_RESULT
+    uint16_t	    Ticks;	//!< duration [RTC ticks] of the last execution,
+				//!< limited to 0xFFFF (2s)
+    uint16_t	    Supply;	//!< supply [mV] before the stage, 0 unknown
+} PF_STAGE_STAT;
 
 /*================================ Local Data ================================*/
 
-    /*! Local pointer to list of power-fail handlers */
-static const POWER_FAIL_FCT *l_pPowerFailFct;
+    /*! Local pointer to list of power-fail stages */
+static const POWER_FAIL_STAGE *l_pPowerFailStage;
+
+    /*! Local pointer to list of resume functions */
+static const POWER_FAIL_FCT *l_pResumeFct;
 
     /* Flag to save power-fail state */
 static volatile bool l_flgPowerFail;
 
+    /*! System time [s] when the last power-fail began */
+static time_t	l_PowerFailTime;
+
+    /*! Statistics of the power-fail stages */
+static PF_STAGE_STAT l_StageStat[PF_MAX_STAGES];
+
+#if PF_VCMP_WARNING
+    /*! Flag is set while VDD is below @ref PF_VCMP_LEVEL */
+static volatile bool l_flgSupplyLow;
+#endif
+
+/*=========================== Forward Declarations ===========================*/
+
+static void PowerFailStages (void);
+static void PowerFailReport (void);
+#if PF_VCMP_WARNING
+static void PowerFailVcmpInit (void);
+#endif
+
 
 /***************************************************************************//**
  *
  * @brief	Initialize the power fail module
  *
  * This routine must be called once to introduce an array of power-fail
- * handlers, i.e. functions which are called in case of power-fail.
+ * stages, each with a list of functions which are called in case of
+ * power-fail.  The resume functions are called instead of the full
+ * recovery after a short outage, see PowerFailCheck().
+ *
+ * @param[in] pPowerFailStage
+ *	Address of the 0-terminated array of stages, at most @ref PF_MAX_STAGES.
+ *	This must be valid over the whole life time of the program.
+ *
+ * @param[in] pResumeFct
+ *	Address of the 0-terminated array of resume functions, may be NULL.
+ *	This must be valid over the whole life time of the program.
  *
  ******************************************************************************/
-void	PowerFailInit (const POWER_FAIL_FCT *pPowerFailFct)
+void	PowerFailInit (const POWER_FAIL_STAGE *pPowerFailStage,
+		       const POWER_FAIL_FCT *pResumeFct)
 {
     /* Parameter check */
-    EFM_ASSERT(pPowerFailFct != NULL);
+    EFM_ASSERT(pPowerFailStage != NULL);
 
-    /* Save list of power-fail handlers */
-    l_pPowerFailFct = pPowerFailFct;
+    /* Save list of power-fail stages and resume functions */
+    l_pPowerFailStage = pPowerFailStage;
+    l_pResumeFct = pResumeFct;
 
     /* Be sure to enable clock to GPIO (should already be done) */
     CMU_ClockEnable (cmuClock_GPIO, true);
@@ -54,16 +153,100 @@ void	PowerFailInit (const POWER_FAIL_FCT *pPowerFailFct)
     /* Initialize the GPIO pin for power-fail detection, configure interrupt */
     GPIO_PinModeSet (POWER_FAIL_PORT, POWER_FAIL_PIN, gpioModeInput, 0);
     GPIO_IntConfig  (POWER_FAIL_PORT, POWER_FAIL_PIN, false, false, false);
+
+#if PF_VCMP_WARNING
+    /* Monitor VDD for the early warning */
+    PowerFailVcmpInit();
+#endif
 }
 
 
+#if PF_VCMP_WARNING
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Voltage Comparator
+ *
+ * The VCMP compares VDD with the level @ref PF_VCMP_LEVEL.  It also works in
+ * EM2, and generates an interrupt for both edges of its output, see
+ * VCMP_IRQHandler().  The hysteresis prevents repeated interrupts while VDD
+ * is near the level.
+ *
+ ******************************************************************************/
+static void PowerFailVcmpInit (void)
+{
+int	i;
+
+    ClockAcquire (CLK_OWN_PWRFAIL, cmuClock_VCMP);
+
+    VCMP->INPUTSEL = ((PF_VCMP_TRIGLEVEL << _VCMP_INPUTSEL_TRIGLEVEL_SHIFT)
+		      & _VCMP_INPUTSEL_TRIGLEVEL_MASK)
+		   | VCMP_INPUTSEL_LPREF;
+
+    VCMP->CTRL = VCMP_CTRL_EN | VCMP_CTRL_HYSTEN
+	       | VCMP_CTRL_IRISE | VCMP_CTRL_IFALL
+	       | VCMP_CTRL_HALFBIAS | (0x7 << _VCMP_CTRL_BIASPROG_SHIFT)
+	       | VCMP_CTRL_WARMTIME_512CYCLES;
+
+    /* Wait until the comparator is active, then get the current state */
+    for (i = 0;  i < PF_ADC_TIMEOUT;  i++)
+	if (VCMP->STATUS & VCMP_STATUS_VCMPACT)
+	    break;
+
+    l_flgSupplyLow = ((VCMP->STATUS & (VCMP_STATUS_VCMPACT
+				       | VCMP_STATUS_VCMPOUT))
+		      == VCMP_STATUS_VCMPACT);
+
+    VCMP->IFC = VCMP_IFC_EDGE | VCMP_IFC_WARMUP;
+    VCMP->IEN = VCMP_IEN_EDGE;
+
+    NVIC_SetPriority (VCMP_IRQn, INT_PRIO_VCMP);
+    NVIC_ClearPendingIRQ (VCMP_IRQn);
+    NVIC_EnableIRQ (VCMP_IRQn);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Voltage Comparator Interrupt Handler
+ *
+ * This handler is called when VDD falls below @ref PF_VCMP_LEVEL, or rises
+ * above it again.  Like PowerFailHandler(), it logs a message and posts
+ * events for all tasks of the main loop, so PowerFailCheck() is called.
+ *
+ ******************************************************************************/
+void	VCMP_IRQHandler (void)
+{
+bool	flgLow;
+
+    VCMP->IFC = VCMP_IFC_EDGE;
+
+    flgLow = (VCMP->STATUS & VCMP_STATUS_VCMPOUT) == 0;
+    if (flgLow != l_flgSupplyLow)
+    {
+	l_flgSupplyLow = flgLow;
+#ifdef LOGGING
+	Log ("Power-Fail: Supply %s %dmV (early warning)",
+	     flgLow ? "below":"above", 1667 + 34 * PF_VCMP_TRIGLEVEL);
+#endif
+    }
+
+    EVENT_POST_ALL();		// keep on running, check all tasks
+}
+#endif
+
+
 /***************************************************************************//**
  *
  * @brief	Check for power-fail
  *
  * This routine is called from the main execution loop to check if power-fail
- * happened.  It then performs the required actions, i.e. it all handler, which
- * have been previously introduced via PowerFailInit() will be executed.
+ * happened.  It then performs the required actions, i.e. the stages which
+ * have been previously introduced via PowerFailInit() will be executed, see
+ * PowerFailStages().  When the power has come back, the durations of the
+ * stages are logged.  If the outage took at most @ref PF_FAST_RESUME_TIME
+ * seconds and the Battery Pack is still the same, the resume functions
+ * restore the previous state.  Otherwise the battery is probed and logged
+ * again, and the power schedule is checked.
  *
  * @return
  * 	The value <i>true</i> if power-fail is active, <i>false</i> if not.
@@ -72,7 +255,7 @@ void	PowerFailInit (const POWER_FAIL_FCT *pPowerFailFct)
 bool	PowerFailCheck (void)
 {
 const POWER_FAIL_FCT *pFct;
-
+uint32_t outage;		// duration of the outage [s]
 
     if (IsPowerFail())
     {
@@ -80,13 +263,10 @@ const POWER_FAIL_FCT *pFct;
 	{
 	    /* Set flag to inhibit further executions */
 	    l_flgPowerFail = true;
+	    l_PowerFailTime = time (NULL);
 
-	    /* Replay external interrupts to consider new power state */
-	    ExtIntReplay();
-
-	    /* Call all power-fail handlers from the list */
-	    for (pFct = l_pPowerFailFct;  *pFct != NULL;  pFct++)
-		(*pFct)();
+	    /* Execute the power-fail stages, then replay external interrupts */
+	    PowerFailStages();
 	}
 
 	return true;
@@ -101,11 +281,27 @@ const POWER_FAIL_FCT *pFct;
 	    /* Replay external interrupts to consider new power state */
 	    ExtIntReplay();
 
-	    /* We assume the Battery Pack has been changed */
-	    BatteryChangeTrigger();
+	    /* Log the durations of the stages */
+	    PowerFailReport();
 
-	    /* See if devices must be switched on at this time */
-	    CheckAlarmTimes();
+	    outage = (uint32_t)(time (NULL) - l_PowerFailTime);
+	    if (outage <= PF_FAST_RESUME_TIME  &&  l_pResumeFct != NULL
+	    &&  BatteryIsUnchanged())
+	    {
+		/* Short outage, same Battery Pack - restore previous state */
+		Log ("Power-Fail: Fast resume after %lds", outage);
+
+		for (pFct = l_pResumeFct;  *pFct != NULL;  pFct++)
+		    (*pFct)();
+	    }
+	    else
+	    {
+		/* We assume the Battery Pack has been changed */
+		BatteryChangeTrigger();
+
+		/* See if devices must be switched on at this time */
+		CheckAlarmTimes();
+	    }
 	}
 
 	return false;
@@ -119,6 +315,8 @@ const POWER_FAIL_FCT *pFct;
  *
  * This routine should be called by critical parts of software that control
  * power consuming actions, so these can be aborted, in case of power-fail.
+ * With @ref PF_VCMP_WARNING, a supply below @ref PF_VCMP_LEVEL is also
+ * treated as power-fail.
  *
  * @return
  * 	The value <i>true</i> if power-fail is active, <i>false</i> if not.
@@ -126,10 +324,194 @@ const POWER_FAIL_FCT *pFct;
  ******************************************************************************/
 bool	IsPowerFail (void)
 {
+#if PF_VCMP_WARNING
+    if (l_flgSupplyLow)
+	return true;
+#endif
     return IO_Bit(GPIO->P[POWER_FAIL_PORT].DIN, POWER_FAIL_PIN) == 0;
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Measure the Supply Voltage
+ *
+ * This routine measures VDD/3 with the ADC and the internal 1.25V reference.
+ * The ADC is only clocked during the conversion, which takes some
+ * microseconds.
+ *
+ * @return
+ * 	Supply voltage in [mV], or 0 if the conversion did not complete.
+ *
+ ******************************************************************************/
+uint32_t PowerFailSupply (void)
+{
+uint32_t freq;			// HFPERCLK in [MHz]
+uint32_t data = 0;
+int	 i;
+
+    ClockAcquire (CLK_OWN_PWRFAIL, cmuClock_ADC0);
+
+    /* 1us time base for the warm-up, ADC clock about 1MHz */
+    freq = (CMU_ClockFreqGet (cmuClock_HFPER) + 999999) / 1000000;
+    if (freq < 1)
+	freq = 1;
+    ADC0->CTRL = ADC_CTRL_WARMUPMODE_NORMAL
+	       | (((freq - 1) << _ADC_CTRL_TIMEBASE_SHIFT) & _ADC_CTRL_TIMEBASE_MASK)
+	       | (((freq - 1) << _ADC_CTRL_PRESC_SHIFT) & _ADC_CTRL_PRESC_MASK);
+
+    ADC0->SINGLECTRL = ADC_SINGLECTRL_INPUTSEL_VDDDIV3
+		     | ADC_SINGLECTRL_REF_1V25
+		     | ADC_SINGLECTRL_RES_12BIT
+		     | ADC_SINGLECTRL_AT_32CYCLES;
+
+    ADC0->CMD = ADC_CMD_SINGLESTART;
+
+    for (i = 0;  i < PF_ADC_TIMEOUT;  i++)
+    {
+	if (ADC0->STATUS & ADC_STATUS_SINGLEDV)
+	{
+	    data = ADC0->SINGLEDATA & 0xFFF;
+	    break;
+	}
+    }
+
+    ClockRelease (CLK_OWN_PWRFAIL, cmuClock_ADC0);
+
+    /* VDD = 3 * 1.25V * data / 4096 */
+    return (data * 3 * 1250) / 4096;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Execute the Power-Fail Stages
+ *
+ * The stages are executed in the order of the array passed to
+ * PowerFailInit().  The first stage is always executed.  For every further
+ * stage the following conditions are checked, otherwise it is skipped:
+ * - The time since the begin of the first stage plus the budget of this
+ *   stage must not exceed the hold-up time @ref PF_HOLDUP_TIME.
+ * - If the stage specifies a <b>MinSupply</b>, the supply voltage measured
+ *   by PowerFailSupply() must not be lower.  If the voltage cannot be
+ *   measured, the stage is executed.
+ *
+ * The external interrupts are replayed after all stages, so the loads have
+ * been cut as soon as possible.
+ *
+ ******************************************************************************/
+static void PowerFailStages (void)
+{
+const POWER_FAIL_STAGE *pStage;
+const POWER_FAIL_FCT *pFct;
+PF_STAGE_STAT	*pStat;
+uint32_t	 start, begin;	// RTC value at the begin of all, of a stage
+uint32_t	 elapsed;	// time since start [ms]
+uint32_t	 ticks;		// duration of a stage
+int		 i;
+
+
+    start = RTC->CNT;
+
+    for (i = 0, pStage = l_pPowerFailStage;
+	 i < PF_MAX_STAGES  &&  pStage->pFct != NULL;  i++, pStage++)
+    {
+	pStat = &l_StageStat[i];
+	pStat->Ticks  = 0;
+	pStat->Supply = 0;
+
+	if (i > 0)
+	{
+	    elapsed = ((RTC->CNT - start) & 0x00FFFFFF) * 1000
+		      / RTC_COUNTS_PER_SEC;
+	    if (elapsed + pStage->Budget > PF_HOLDUP_TIME)
+	    {
+		pStat->Result = PF_STAGE_SKIP_TIME;
+		continue;
+	    }
+
+	    if (pStage->MinSupply != 0)
+	    {
+		pStat->Supply = (uint16_t)PowerFailSupply();
+		if (pStat->Supply != 0  &&  pStat->Supply < pStage->MinSupply)
+		{
+		    pStat->Result = PF_STAGE_SKIP_SUPPLY;
+		    continue;
+		}
+	    }
+	}
+
+	/* Call all power-fail handlers of this stage */
+	begin = RTC->CNT;
+	for (pFct = pStage->pFct;  *pFct != NULL;  pFct++)
+	    (*pFct)();
+
+	ticks = (RTC->CNT - begin) & 0x00FFFFFF;
+	pStat->Ticks  = (uint16_t)(ticks < 0xFFFF ? ticks : 0xFFFF);
+	pStat->Result = PF_STAGE_DONE;
+    }
+
+    /* Replay external interrupts to consider new power state */
+    ExtIntReplay();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Power-Fail Stages
+ *
+ * This routine is called when the power has come back.  It logs one line
+ * with the result of each stage of the last power-fail, i.e. its duration,
+ * or the reason why it has been skipped.  A stage that exceeded its budget
+ * is additionally logged as error.
+ *
+ ******************************************************************************/
+static void PowerFailReport (void)
+{
+const POWER_FAIL_STAGE *pStage;
+PF_STAGE_STAT	*pStat;
+char		 line[120];
+int		 len = 0;
+uint32_t	 us;
+int		 i;
+
+
+    for (i = 0, pStage = l_pPowerFailStage;
+	 i < PF_MAX_STAGES  &&  pStage->pFct != NULL
+	 &&  len < (int)sizeof(line) - 40;  i++, pStage++)
+    {
+	pStat = &l_StageStat[i];
+
+	switch (pStat->Result)
+	{
+	    case PF_STAGE_DONE:
+		us = (uint32_t)((uint64_t)pStat->Ticks * 1000000
+				/ RTC_COUNTS_PER_SEC);
+		len += StrFormat (line + len, " %s %ldus", pStage->pName, us);
+		if (us > pStage->Budget * 1000UL)
+		    LogError ("Power-Fail Stage %s: %ldus exceeds budget of %dms",
+			      pStage->pName, us, pStage->Budget);
+		break;
+
+	    case PF_STAGE_SKIP_TIME:
+		len += StrFormat (line + len, " %s skipped (time)", pStage->pName);
+		break;
+
+	    case PF_STAGE_SKIP_SUPPLY:
+		len += StrFormat (line + len, " %s skipped (%dmV)",
+				  pStage->pName, pStat->Supply);
+		break;
+
+	    default:
+		break;
+	}
+    }
+
+    if (len > 0)
+	Log ("Power-Fail Stages:%s", line);
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Power Fail Handler
@@ -138,7 +520,8 @@ bool	IsPowerFail (void)
  * state of the power-fail input pin changes.  This pin is connected with
  * <i>Power Good</i> signal of the power regulator.
  * The handler just logs a message and wakes-up the main execution loop, so
- * that PowerFailCheck() will be called.
+ * that PowerFailCheck() will be called.  Events are posted for all tasks of
+ * the main loop, which check their state again.
  *
  * @param[in] extiNum
  *	EXTernal Interrupt number of power-fail signal.  This is identical with
@@ -165,5 +548,5 @@ void	PowerFailHandler (int extiNum, bool extiLvl, uint32_t timeStamp)
 	     extiLvl == 0 ? "FAIL":"GOOD");
 #endif
 
-    g_flgIRQ = true;		// keep on running
+    EVENT_POST_ALL();		// keep on running, check all tasks
 }
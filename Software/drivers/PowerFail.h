@@ -2,9 +2,12 @@
  * @file
  * @brief	Header file of module PowerFail.c
  * @author	Ralf Gerhauser
- * @version	2017-01-27
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	PowerFailInit() takes a list of resume functions.
+2026-10-15,agnt	Added POWER_FAIL_STAGE, PowerFailInit() takes a list of stages.
+		Added prototype for PowerFailSupply().
 2017-01-27,rage	Initial version.
 */
 
@@ -47,11 +50,37 @@ Revision History:
  */
 typedef void	(* POWER_FAIL_FCT)(void);
 
+/*!@brief Stage of the power-fail shutdown.
+ *
+ * The power-fail handlers are called in stages, see PowerFailCheck().  The
+ * first stage cuts the high-current loads and is always executed.  A later
+ * stage is skipped, if it does not fit into the remaining hold-up time
+ * @ref PF_HOLDUP_TIME, or if the supply voltage is below <b>MinSupply</b>.
+ * The array of stages is terminated by an entry with <b>pFct</b> NULL.
+ *
+ * <b>Typical Example:</b>
+ * @code
+ * static const POWER_FAIL_STAGE l_PowerFailStages[] =
+ * { //	pName,		pFct,		MinSupply,	Budget
+ *    {	"Loads",	l_PF_Loads,	0,		1	},
+ *    {	NULL,		NULL,		0,		0	}
+ * };
+ * @endcode
+ */
+typedef struct
+{
+    const char		 *pName;	//!< name of the stage for the log
+    const POWER_FAIL_FCT *pFct;		//!< 0-terminated list of handlers
+    uint16_t		  MinSupply;	//!< minimum supply [mV], 0 for any
+    uint16_t		  Budget;	//!< time budget of the stage [ms]
+} POWER_FAIL_STAGE;
+
 
 /*================================ Prototypes ================================*/
 
-/* Initialize Light Barrier hardware */
-void	PowerFailInit (const POWER_FAIL_FCT *pPowerFailFct);
+/* Initialize the power-fail module with the stages of the shutdown */
+void	PowerFailInit (const POWER_FAIL_STAGE *pPowerFailStage,
+		       const POWER_FAIL_FCT *pResumeFct);
 
 /* Check if power-fail happened and perform all required actions */
 bool	PowerFailCheck (void);
@@ -59,6 +88,9 @@ bool	PowerFailCheck (void);
 /* Probe routine, true means power-fail is active */
 bool	IsPowerFail (void);
 
+/* Measure the supply voltage in [mV], 0 if not available */
+uint32_t PowerFailSupply (void);
+
 /* Power-Fail Handler, called from interrupt service routine */
 void	PowerFailHandler (int extiNum, bool extiLvl, uint32_t timeStamp);
 
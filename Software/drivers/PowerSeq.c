@@ -0,0 +1,177 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Power-up Sequencer
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module powers up the devices at the begin of a power window, see
+ * PowerControl().  The devices are described by the table @ref l_PwrSeq,
+ * with a warm-up time each, i.e. the time from the start until the device
+ * is operational.  The devices are started @ref PWR_SEQ_STAGGER ms apart,
+ * so their inrush currents do not add up, and warm up concurrently:
+ * -# Audio module: Boot, prompt, and @ref PWR_SEQ_WARMUP_AUDIO.
+ * -# RFID reader: Settling time @ref PWR_SEQ_WARMUP_RFID.
+ * -# SD-Card: Initialization and flush of the pending log messages,
+ *    @ref PWR_SEQ_WARMUP_LOG.  The flush is requested by LogFlushRequest()
+ *    at once, instead of waiting for @ref LOG_SAMPLE_TIMEOUT.
+ *
+ * The slowest device is started first, so the system is operational after
+ * the longest warm-up time plus the stagger delays before it, instead of the
+ * sum of all warm-up times.  This moment is logged.  The start routines
+ * only post the request to the respective main loop task, so they may be
+ * called by the msTimer in interrupt context.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_int.h"
+#include "AlarmClock.h"
+#include "PowerSeq.h"
+#include "Audio.h"
+#include "RFID.h"
+#include "Logging.h"
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Device of the power-up sequence. */
+typedef struct
+{
+    const char	*Name;		//!< Name of the device
+    uint16_t	 WarmUp;	//!< Time in [ms] until it is operational
+    void	(*Start)(void);	//!< Routine to start the power-up
+} PWR_SEQ_DEV;
+
+/*================================ Local Data ================================*/
+
+    /*!@brief Devices in the order of their start, the slowest one first. */
+static const PWR_SEQ_DEV l_PwrSeq[] =
+{ //  Name,	WarmUp,			Start
+    { "Audio",	PWR_SEQ_WARMUP_AUDIO,	AudioEnable	  },
+    { "RFID",	PWR_SEQ_WARMUP_RFID,	RFIDPower_Enable  },
+    { "Log",	PWR_SEQ_WARMUP_LOG,	LogFlushRequest	  },
+};
+
+    /*! msTimer for the stagger delays and the ready time */
+static TIM_HDL	l_hdlPwrSeq = NONE;
+
+    /*! Index of the next device to be started, ELEM_CNT(l_PwrSeq) waits for
+     * the ready time, more means idle. */
+static volatile unsigned int l_PwrSeqIdx = ELEM_CNT(l_PwrSeq) + 1;
+
+    /*! Time in [ms] after the start of the sequence when all devices are
+     * operational, and the device which determines it */
+static uint32_t	l_PwrSeqReady;
+static unsigned int l_PwrSeqSlowest;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	PowerSeqStep (TIM_HDL hdl);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Power-up Sequencer
+ *
+ * This routine must be called once after AlarmClockInit().  It creates the
+ * msTimer and calculates the ready time from the table @ref l_PwrSeq.
+ *
+ ******************************************************************************/
+void	PowerSeqInit (void)
+{
+unsigned int i;
+uint32_t ready;
+
+    if (l_hdlPwrSeq == NONE)
+	l_hdlPwrSeq = msTimerCreate (PowerSeqStep);
+
+    l_PwrSeqReady = 0;
+    for (i = 0;  i < ELEM_CNT(l_PwrSeq);  i++)
+    {
+	ready = i * PWR_SEQ_STAGGER + l_PwrSeq[i].WarmUp;
+	if (ready > l_PwrSeqReady)
+	{
+	    l_PwrSeqReady = ready;
+	    l_PwrSeqSlowest = i;
+	}
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start the Power-up Sequence
+ *
+ * This routine is called by PowerControl() when a power window begins.  The
+ * first device is started at once, the others by PowerSeqStep().  A running
+ * sequence starts over, devices which are already on are not affected.
+ *
+ ******************************************************************************/
+void	PowerSeqStart (void)
+{
+    PowerSeqCancel();
+
+    l_PwrSeqIdx = 0;
+    PowerSeqStep (l_hdlPwrSeq);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Cancel the Power-up Sequence
+ *
+ * This routine is called by PowerControl() when a power window ends.  The
+ * devices which have not been started yet are skipped.
+ *
+ ******************************************************************************/
+void	PowerSeqCancel (void)
+{
+    if (l_hdlPwrSeq != NONE)
+	msTimerCancel (l_hdlPwrSeq);
+
+    l_PwrSeqIdx = ELEM_CNT(l_PwrSeq) + 1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Step of the Power-up Sequence
+ *
+ * This routine starts the next device, and re-starts the msTimer for the
+ * following one.  After the last device, the timer expires at the ready
+ * time, which is logged.
+ *
+ * @param[in] hdl
+ *	Handle of the msTimer.
+ *
+ ******************************************************************************/
+static void	PowerSeqStep (TIM_HDL hdl)
+{
+unsigned int idx = l_PwrSeqIdx;
+
+    if (idx < ELEM_CNT(l_PwrSeq))
+    {
+	l_PwrSeqIdx = idx + 1;
+	l_PwrSeq[idx].Start();
+
+	if (hdl != NONE)
+	{
+	    if (idx + 1 < ELEM_CNT(l_PwrSeq))
+		msTimerStart (hdl, PWR_SEQ_STAGGER);
+	    else
+		msTimerStart (hdl, l_PwrSeqReady - idx * PWR_SEQ_STAGGER);
+	}
+    }
+    else if (idx == ELEM_CNT(l_PwrSeq))
+    {
+	l_PwrSeqIdx = idx + 1;
+
+#ifdef LOGGING
+	Log ("Power-up: All devices ready after %ldms (%s)", l_PwrSeqReady,
+	     l_PwrSeq[l_PwrSeqSlowest].Name);
+#endif
+    }
+}
@@ -0,0 +1,60 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module PowerSeq.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_PowerSeq_h
+#define __INC_PowerSeq_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to power up the devices at the begin of a power
+ * window by the sequencer, see PowerSeqStart().
+ */
+#ifndef PWR_SEQ
+    #define PWR_SEQ		0
+#endif
+
+/*!@brief Time in [ms] between the start of two devices, so their inrush
+ * currents do not add up.
+ */
+#ifndef PWR_SEQ_STAGGER
+    #define PWR_SEQ_STAGGER	100
+#endif
+
+/*!@brief Warm-up times in [ms] until a device is operational. */
+//@{
+#ifndef PWR_SEQ_WARMUP_AUDIO
+    #define PWR_SEQ_WARMUP_AUDIO	7000	//!< prompt and POWER_UP_DELAY
+#endif
+#ifndef PWR_SEQ_WARMUP_RFID
+    #define PWR_SEQ_WARMUP_RFID		500	//!< reader settles
+#endif
+#ifndef PWR_SEQ_WARMUP_LOG
+    #define PWR_SEQ_WARMUP_LOG		1000	//!< SD-Card init and log flush
+#endif
+//@}
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize the power-up sequencer */
+void	PowerSeqInit (void);
+
+    /* Start or cancel the power-up sequence */
+void	PowerSeqStart (void);
+void	PowerSeqCancel (void);
+
+
+#endif /* __INC_PowerSeq_h */
@@ -0,0 +1,105 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Protothreads - Stackless Coroutines
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * A protothread is a function which is called again and again, e.g. from the
+ * main loop, and continues where it returned the last time.  This allows a
+ * sequence of steps with waits in between, like "send a command, wait for
+ * the response, send the next one", to be written as straight code instead
+ * of a state machine.  The only state is the line number of the last wait,
+ * which is kept in a variable of type @ref PT.
+ *
+ * <b>Example:</b>
+   @code
+   static PT l_Pt;
+
+   static int Sequence (void)
+   {
+       PT_BEGIN(&l_Pt);
+
+       SendCommand();
+       PT_WAIT_UNTIL(&l_Pt, l_flgResponse);
+
+       if (! l_flgOK)
+	   PT_EXIT(&l_Pt);
+
+       SendNextCommand();
+
+       PT_END(&l_Pt);
+   }
+   @endcode
+ *
+ * @note
+ * The macros are implemented by a <b>switch</b> statement with a case label
+ * at each wait.  Therefore local variables do not keep their values across a
+ * wait, use static ones instead, and a wait must not be located within a
+ * <b>switch</b> statement of the protothread itself.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Added PT_FALLTHROUGH for the case label of PT_WAIT_UNTIL().
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_Protothread_h
+#define __INC_Protothread_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdint.h>
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Return values of a protothread. */
+//@{
+#define PT_WAITING	0	//!< protothread waits for a condition
+#define PT_ENDED	1	//!< protothread has ended or exited
+//@}
+
+/*!@brief Line number of a protothread which has ended. */
+#define PT_LC_END	0xFFFF
+
+/*!@brief Initialize a protothread, the next call starts at PT_BEGIN(). */
+#define PT_INIT(pt)	((pt)->LC = 0)
+
+/*!@brief Check if a protothread has ended or exited. */
+#define PT_IS_ENDED(pt)	((pt)->LC == PT_LC_END)
+
+/*!@brief Start of the protothread body. */
+#define PT_BEGIN(pt)	switch ((pt)->LC) { case 0:
+
+/*!@brief The code before the case label of a wait falls through to it on
+ * purpose, this tells GCC 7 or later not to warn about it.
+ */
+#if defined(__GNUC__)  &&  __GNUC__ >= 7
+    #define PT_FALLTHROUGH	__attribute__ ((fallthrough))
+#else
+    #define PT_FALLTHROUGH
+#endif
+
+/*!@brief Return from the protothread until <b>cond</b> is true, the next
+ * call continues here.
+ */
+#define PT_WAIT_UNTIL(pt, cond)						\
+	do { (pt)->LC = __LINE__;  PT_FALLTHROUGH;  case __LINE__:	\
+	     if (! (cond))  return PT_WAITING;  } while (0)
+
+/*!@brief Leave the protothread, further calls do nothing. */
+#define PT_EXIT(pt)							\
+	do { (pt)->LC = PT_LC_END;  return PT_ENDED;  } while (0)
+
+/*!@brief End of the protothread body. */
+#define PT_END(pt)	} (pt)->LC = PT_LC_END;  return PT_ENDED
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Continuation of a protothread, i.e. the line of the last wait. */
+typedef struct
+{
+    uint16_t	LC;		//!< line number, 0 for start, or PT_LC_END
+} PT;
+
+
+#endif /* __INC_Protothread_h */
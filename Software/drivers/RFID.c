@@ -2,16 +2,30 @@
  * @file
  * @brief	RFID Reader
  * @author	Ralf Gerhauser / Peter Loes
- * @version	2020-08-07
+ * @version	2026-10-15
  *
  * This module provides the functionality to communicate with the @ref
  * RFID_Reader.
  * It contains the following parts:
  * - Initialize functionality according to the configuration variables.
  * - Power management for RFID reader and UART
- * - UART driver to receive data from the RFID reader
+ * - UART driver to receive data from the RFID reader via DMA
  * - Decoders to handle the received data for Short and Long Range readers
  *
+ * If @ref RFID_READERS is 2, a second reader may be connected to LEUART1.
+ * Each reader has its own UART, DMA channel, and decoder state, see
+ * @ref RFID_READER.  The frames of both readers are put into the same ring
+ * buffer in the order of their reception, so RFID_Check() decodes a merged
+ * stream, and an ID which has already been reported by one reader is not
+ * reported again by the other one.  Each ID in @ref l_IdQueue carries the
+ * reader and the time of its frame, so the log tells which reader has seen
+ * the transponder first, and how much later the other one followed.
+ *
+ * If @ref RFID_EM2_RX is 1, the only reader is connected to LEUART1 instead
+ * of USART1.  The LEUART runs from the LFXO and its RXDMAWU bit lets the DMA
+ * fetch each byte without waking up the CPU, which is interrupted once per
+ * complete frame only.  The MCU therefore stays in EM2 during long visits.
+ *
  * @see LightBarriers.c
  *
  ****************************************************************************//*
@@ -45,6 +59,90 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	- The LEUART setup of the second reader is kept on the stack.
+2026-10-15,agnt	- The DMA configuration of the Rx channels is kept on the stack.
+2026-10-15,agnt	- The counters and durations of the readiness statistics are
+		  16 bit, they are reset after each ON time.
+2026-10-15,agnt	- Removed the timeline marks of the power transitions.
+2026-10-15,agnt	- Removed the latency stamp of a new transponder.
+2026-10-15,agnt	- The DMA descriptors are addressed via uintptr_t.
+2026-10-15,agnt	- RFID_PresenceDepart() logs the visit time from the first to
+		  the last read only if the transponder has been read more
+		  than once.
+2026-10-15,agnt	- RFID_Enable() requests the prefetch of the ID index, so the
+		  IDs of the presence table and the most frequent IDs of the
+		  visit statistics are in the sector cache when the frame
+		  arrives, see RFID_Prefetch() and CfgPrefetchIDs().
+2026-10-15,agnt	- RFID_IdPost() emits an ITM trace record of the depth of the ID
+		  queue, see ITM_TRACE.
+2026-10-15,agnt	- Registered RFID_Check() as task of the main loop, see
+		  TASK_REGISTER().
+2026-10-15,agnt	- RFID_EM2_RX connects the reader to LEUART1, which wakes up
+		  the DMA in EM2, so EM1 is only required while a USART is
+		  in use.
+2026-10-15,agnt	- The DMA channels are set up via DmaChanConfig().
+2026-10-15,agnt	- Arrival and departure of a transponder are logged by
+		  LogEvent(), see LOG_PRIORITY.
+2026-10-15,agnt	- The power transitions are recorded in the timeline, except
+		  for the duty cycling, see TIMELINE.
+2026-10-15,agnt	- The UART clocks and EM1 are acquired via ClockMgr.c.
+2026-10-15,agnt	- RFID_ClockChange() recalculates the baud rate of the USART
+		  after a switch of the HF clock, see HF_CLOCK_GOVERNOR.
+2026-10-15,agnt	- RFID_Decode() only verifies the prefix and stores each byte,
+		  the checksum is verified once per complete frame by
+		  RFID_FrameCheck(), i.e. the XOR sum of the SR frame, or the
+		  CRC-CCITT (KERMIT) of the LR frame, which is calculated with
+		  a nibble table.  The frame format is described by
+		  RFID_TYPE_PARMS.  RFID_BenchDecode() selects the reader type
+		  and returns the number of IDs.
+2026-10-15,agnt	- Dual Reader: A second reader may be connected to LEUART1,
+		  configured by RFID2_TYPE and RFID2_POWER.  USART_Parms became
+		  a table with one entry per reader, the decoder state moved
+		  into RFID_READER.  The frames of both readers are merged in
+		  l_RxRing, l_IdQueue holds RFID_DETECTION entries with reader
+		  and time stamp.
+2026-10-15,agnt	- Duty Cycling: While a transponder is present, the reader is
+		  powered for RFID_DUTY_ON ms every RFID_DUTY_PERIOD ms only,
+		  see RFID_DutyStep().
+2026-10-15,agnt	- Early End of the Detect Window: If the reader did not send
+		  anything until the light barrier filter expired, and keeps
+		  silent for RFID_EARLY_OFF ms, the ID is UNKNOWN and the
+		  reader is powered off until the next light barrier edge,
+		  see RFID_EarlyOff().
+2026-10-15,agnt	- Use StrFormat() instead of sprintf().
+2026-10-15,agnt	- RFID_PowerFailResume() restores the state of the reader after
+		  a short outage.
+2026-10-14,agnt	- Added RFID_BenchDecode() for the micro-benchmark, see bench.c.
+2026-10-14,agnt	- Added RFID_PresenceGet() to read the presence table.
+2026-10-14,agnt	- New transponder IDs are queued in l_IdQueue, also the UNKNOWN
+		  ID of the detect timeout, which is posted in interrupt
+		  context.  RFID_Check() passes them to ControlUpdateID() in
+		  the main loop, so no ID is overwritten by a later one.
+2026-10-14,agnt	- RFID_Check() is triggered via EVENT_POST(EVT_RFID).  The
+		  gap timer also limits the readiness detection to
+		  RFID_READY_MAX, so its timeout is checked without polling.
+2026-10-14,agnt	- Readiness Detection: The first edge on the Rx pin, or the
+		  first valid frame after power-on marks the reader ready, the
+		  duration is collected in a histogram, see RFID_ReadyReport().
+		- RFID_LB_POWER powers the reader at the first light barrier
+		  edge, see RFID_Enable() and RFID_LB_Idle().
+2026-10-14,agnt	- The cache of recently seen IDs became a presence table with
+		  first-seen, last-seen and read count per transponder.  It is
+		  aged every RFID_PRESENCE_TICK seconds, arrival and departure
+		  are logged once per visit, see RFID_PresenceUpdate().
+2026-10-14,agnt	- Absence Detection: Recently seen IDs are kept in a small LRU
+		  cache, an ID is only reported again after it has been absent
+		  for RFID_ABSENT_TIMEOUT seconds, see RFID_IdCacheCheck().
+2026-10-14,agnt	- RFID_RxDone only copies the frame into a ring buffer, data is
+		  decoded by RFID_Check() in the main loop.  After a gap of
+		  RFID_RX_GAP_TIMEOUT, an incomplete frame is passed to the
+		  decoder and the DMA is re-aligned to the next frame.
+2026-10-14,agnt	RFID_RxDone: Cycles are measured, see ISR_PROFILE.
+		RFID_Decode: A new ID is stamped for the latency trace.
+2026-10-14,agnt	- Received data is transferred by DMA channel DMA_CHAN_RFID_RX
+		  in ping-pong mode, one interrupt per frame instead of per byte.
+2026-10-14,agnt	- The transponder ID is stored as binary TRANSPONDER_ID in
+		  g_Transponder, no more string conversion in RFID_Decode().
 2020-06-03,rage	- BugFix: Corrected decoding of SR transponder ID.
 2019-02-10,rage	- BugFix: Absent detection didn't work if transponder ID has
 		  been read just once before disappearing again.
@@ -80,10 +178,23 @@ Revision History:
 #include "em_cmu.h"
 #include "em_gpio.h"
 #include "em_usart.h"
+#include "em_leuart.h"
+#include "em_dma.h"
+#include "em_int.h"
+#include "clock.h"
 #include "AlarmClock.h"
+#include "ExtInt.h"
 #include "RFID.h"
 #include "Logging.h"
 #include "Control.h"
+#include "CfgData.h"
+#include "IsrProfile.h"
+#include "ItmTrace.h"
+#include "StrFormat.h"
+#include "ClockMgr.h"
+#include "DmaChan.h"
+#include "TimeSrc.h"
+#include "VisitStats.h"
 
 /*=============================== Definitions ================================*/
 
@@ -96,26 +207,98 @@ Revision History:
     #define DBG_PUTS(str)
 #endif
 
+    /*!@brief Maximum frame size of all RFID reader types, see
+     * RFID_TYPE_PARMS.FrameSize. */
+#define RFID_FRAME_SIZE_MAX	14
+
+#if RFID_EM2_RX  &&  RFID_READERS > 1
+    #error "RFID_EM2_RX uses LEUART1 for the first reader, set RFID_READERS to 1"
+#endif
+#if RFID_EM2_RX  &&  TIME_SOURCE == TIME_SRC_GPS
+    #error "RFID_EM2_RX and the GPS receiver both require LEUART1"
+#endif
+
+/*======================== External Data and Routines ========================*/
+
+extern DMA_DESCRIPTOR_TypeDef g_DMA_ControlBlock[];
+
 /*=========================== Typedefs and Structs ===========================*/
 
-/*!@brief Structure to hold UART specific parameters */
+/*!@brief Structure to hold UART specific parameters.  A reader is either
+ * connected to a USART or to a LEUART, the other pointer is NULL.
+ */
 typedef struct
 {
-    USART_TypeDef *	const	UART;		//!< UART device to use
+    USART_TypeDef *	const	UART;		//!< USART device to use
+    LEUART_TypeDef *	const	LEUART;		//!< LEUART device to use
     CMU_Clock_TypeDef	const	cmuClock_UART;	//!< CMU clock for the UART
-    IRQn_Type		const	UART_Rx_IRQn;	//!< Rx interrupt number
+    unsigned int	const	DMA_Req_Rx;	//!< DMA request for Rx
+    unsigned int	const	DMA_Chan_Rx;	//!< DMA channel for Rx
     GPIO_Port_TypeDef	const	UART_Rx_Port;	//!< Port for RX pin
     uint32_t		const	UART_Rx_Pin;	//!< Rx pin on this port
     uint32_t		const	UART_Route;	//!< Route location
 } USART_Parms;
 
-/*!@brief Structure to hold RFID reader type specific parameters. */
+/*!@brief Run-time data of an RFID reader. */
+typedef struct
+{
+    RFID_CONFIG		Cfg;		//!< Type is NONE if the reader is unused
+    uint16_t	RxDMA_Buf[2][RFID_FRAME_SIZE_MAX]; //!< Ping-pong buffers
+    volatile bool	flgRxPrimary;	//!< DMA fills the primary buffer
+    volatile TIM_HDL	hdlRxGap;	//!< msTimer for the gap timeout
+    uint8_t		State;		//!< State (index) of RFID_Decode()
+    uint8_t	w[RFID_FRAME_SIZE_MAX];	//!< Received bytes of the frame
+} RFID_READER;
+
+/*!@brief Frame received by the DMA, see @ref l_RxRing. */
+typedef struct
+{
+    uint8_t	Len;				//!< Number of valid entries
+    uint8_t	Reader;				//!< Index of the reader
+    uint32_t	TimeStamp;			//!< RTC counter at reception
+    uint16_t	Data[RFID_FRAME_SIZE_MAX];	//!< RXDATAX incl. error flags
+} RFID_RX_FRAME;
+
+/*!@brief Transponder ID detected by a reader, see @ref l_IdQueue. */
+typedef struct
+{
+    TRANSPONDER_ID	ID;		//!< Transponder ID, or ID_UNKNOWN
+    uint32_t		TimeStamp;	//!< RTC counter of the frame
+    int8_t		Reader;		//!< Index of the reader, NONE if timeout
+} RFID_DETECTION;
+
+/*!@brief Number of bins of the readiness histogram. */
+#define RFID_READY_BINS		9
+
+/*!@brief Statistics of the reader readiness, see RFID_ReadyReport(). */
+typedef struct
+{
+    uint16_t	Cnt;			//!< Number of power-ups with activity
+    uint16_t	EdgeCnt;		//!< Ready by an edge on the Rx pin
+    uint16_t	NoneCnt;		//!< No activity within RFID_READY_MAX
+    uint16_t	Min;			//!< Minimum duration in [ms]
+    uint16_t	Max;			//!< Maximum duration in [ms]
+    uint16_t	Hist[RFID_READY_BINS];	//!< Histogram, see l_ReadyBinLimit
+    uint32_t	Sum;			//!< Sum of all durations in [ms]
+} RFID_READY_STAT;
+
+/*!@brief Structure to hold RFID reader type specific parameters.  The
+ * checksum covers <b>ChkCnt</b> bytes from <b>ChkOffs</b> on, it follows
+ * these bytes, a CRC with the low byte first.
+ */
 typedef struct
 {
     uint32_t		   const Baudrate;	//!< Baudrate for RFID reader
     USART_Databits_TypeDef const DataBits;	//!< Number of data bits
     USART_Parity_TypeDef   const Parity;	//!< Parity mode
     USART_Stopbits_TypeDef const StopBits;	//!< Number of stop bits
+    uint8_t		   const FrameSize;	//!< Bytes per DMA transfer
+    const uint8_t *	   const pPrefix;	//!< Fixed bytes at frame start
+    uint8_t		   const PrefixLen;	//!< Number of prefix bytes
+    uint8_t		   const IdOffs;	//!< Offset of the ID's MSB
+    uint8_t		   const ChkOffs;	//!< First byte of the checksum
+    uint8_t		   const ChkCnt;	//!< Bytes covered by checksum
+    bool		   const flgCrc;	//!< CRC-16 if set, else XOR
 } RFID_TYPE_PARMS;
 
 /*========================= Global Data and Routines =========================*/
@@ -127,8 +310,31 @@ RFID_TYPE g_RFID_Type;
     /*!@brief RFID power output. */
 PWR_OUT   g_RFID_Power = PWR_OUT_NONE;
 
+#if RFID_READERS > 1
+    /*!@brief Type and power output of the second reader at LEUART1. */
+RFID_TYPE g_RFID2_Type = RFID_TYPE_NONE;
+PWR_OUT   g_RFID2_Power = PWR_OUT_NONE;
+#endif
+
 int32_t  g_RFID_DetectTimeout = DFLT_RFID_DETECT_TIMEOUT;
 
+    /*!@brief Duration in [s] a transponder must be absent, before it is
+     * reported again, set by RFID_ABSENT_TIMEOUT.
+     */
+uint32_t g_RFID_AbsentDetectTimeout = DFLT_RFID_ABSENT_TIMEOUT;
+
+    /*!@brief Duration in [ms] the reader must keep silent after the light
+     * barrier filter has expired to end the detect window early, set by
+     * RFID_EARLY_OFF, 0 disables this.
+     */
+int32_t  g_RFID_EarlyOff = DFLT_RFID_EARLY_OFF;
+
+    /*!@brief On time and period in [ms] of the duty cycling while a
+     * transponder is present, set by RFID_DUTY_ON and RFID_DUTY_PERIOD,
+     * 0 disables it.
+     */
+int32_t  g_RFID_DutyOn, g_RFID_DutyPeriod;
+
     /*!@brief Framing and Parity error counters of the USARTs. */
 uint16_t g_FERR_Cnt;
 uint16_t g_PERR_Cnt;
@@ -137,34 +343,63 @@ uint16_t g_PERR_Cnt;
 const char *g_enum_RFID_Type[] = { "SR", "LR", NULL };
 
     /*!@brief Transponder number */
-char	 g_Transponder[18];
+TRANSPONDER_ID g_Transponder;
 
 /*================================ Local Data ================================*/
 
     /*!@brief Flag that determines if RFID reader is in use. */
 bool	 l_flgRFID_Activate;
 
-    /*! Local structure to RFID type and power output configuration */
-static RFID_CONFIG l_pRFID_Cfg;
+    /*! Run-time data of the RFID readers */
+static RFID_READER l_Reader[RFID_READERS];
+
+    /*! Frame prefixes of the RFID readers. */
+static const uint8_t l_PrefixSR[] = { 0x0E, 0x00, 0x11, 0x00, 0x05 };
+static const uint8_t l_PrefixLR[] = { 0x54 };	// 'T'
 
     /*! RFID Reader specific parameters.  Entries are addresses via
      * enums @ref RFID_TYPE.
      */
 static const RFID_TYPE_PARMS l_RFID_Type_Parms[NUM_RFID_TYPE] =
 {
-   {	// RFID_TYPE_SR - 0: Short Range RFID reader
-	  9600,  usartDatabits8,  usartEvenParity,  usartStopbits1
+   {	// RFID_TYPE_SR - 0: Short Range RFID reader, XOR of bytes 0~12
+	  9600,  usartDatabits8,  usartEvenParity,  usartStopbits1,  14,
+	 l_PrefixSR,  sizeof(l_PrefixSR),  12,  0, 13,  false
    },
-   {	// RFID_TYPE_LR - 1: Long Range RFID reader
-	 38400,  usartDatabits8,  usartNoParity,    usartStopbits1
+   {	// RFID_TYPE_LR - 1: Long Range RFID reader, CRC of bytes 1~8
+	 38400,  usartDatabits8,  usartNoParity,    usartStopbits1,  11,
+	 l_PrefixLR,  sizeof(l_PrefixLR),   8,  1,  8,  true
    }
 };
+
+    /*! Nibble table of the CRC-CCITT (KERMIT), polynomial x^16+x^12+x^5+1
+     * reflected, i.e. entry n is n * 0x1081. */
+static const uint16_t l_CrcNibble[16] =
+{
+    0x0000, 0x1081, 0x2102, 0x3183, 0x4204, 0x5285, 0x6306, 0x7387,
+    0x8408, 0x9489, 0xA50A, 0xB58B, 0xC60C, 0xD68D, 0xE70E, 0xF78F
+};
   
-    /*! USART specific parameters for each RFID reader */
-static const USART_Parms l_USART_Parms =
+    /*! UART specific parameters for each RFID reader */
+static const USART_Parms l_USART_Parms[RFID_READERS] =
 {
-    USART1, cmuClock_USART1, USART1_RX_IRQn,
-    gpioPortC,  1, USART_ROUTE_LOCATION_LOC0
+#if RFID_EM2_RX
+   {	// Reader 1: LEUART1, Rx at PC7, clocked by the LFXO, works in EM2
+	NULL, LEUART1, cmuClock_LEUART1, DMAREQ_LEUART1_RXDATAV,
+	DMA_CHAN_RFID_RX, gpioPortC,  7, LEUART_ROUTE_LOCATION_LOC0
+   },
+#else
+   {	// Reader 1: USART1, Rx at PC1
+	USART1, NULL, cmuClock_USART1, DMAREQ_USART1_RXDATAV, DMA_CHAN_RFID_RX,
+	gpioPortC,  1, USART_ROUTE_LOCATION_LOC0
+   },
+#endif
+#if RFID_READERS > 1
+   {	// Reader 2: LEUART1, Rx at PC7, clocked by the LFXO
+	NULL, LEUART1, cmuClock_LEUART1, DMAREQ_LEUART1_RXDATAV,
+	DMA_CHAN_RFID2_RX, gpioPortC,  7, LEUART_ROUTE_LOCATION_LOC0
+   },
+#endif
 };
 
     /*! Flag if RFID reader should be powered on. */
@@ -173,26 +408,134 @@ static volatile bool	l_flgRFID_On;
     /*! Flag if RFID reader is currently powered on. */
 static volatile bool	l_flgRFID_IsOn;
 
+    /*! Flag if RFID reader was on before the power-fail. */
+static volatile bool	l_flgRFID_Resume;
+
     /*! Flag indicates if an object with transponder is present. */
 static volatile bool	l_flgObjectNewID;
 
     /*! Timer handler for the ID detection timeout */
 static volatile TIM_HDL	l_hdlRFID_DetectTimeout = NONE;
 
+    /*! Flag if the ID detection timeout is running. */
+static volatile bool	l_flgDetectRun;
+
+    /*! msTimer handle to end the detect window early, see RFID_EarlyOff(). */
+static volatile TIM_HDL	l_hdlEarlyOff = NONE;
+
+    /*! Flag if the reader has sent any data during this run. */
+static volatile bool	l_flgRxActivity;
+
+    /*! Flag if the reader has been powered off by RFID_EarlyOff(). */
+static volatile bool	l_flgEarlyOff;
+
+    /*! msTimer handle for the duty cycling, see RFID_DutyStep(). */
+static volatile TIM_HDL	l_hdlDuty = NONE;
+
+    /*! Flag if the reader is duty cycled. */
+static volatile bool	l_flgDuty;
+
+    /*! Flag if the reader has sent any data during the current on phase. */
+static volatile bool	l_flgDutyRx;
+
+    /*! Flag if the reader is off for the duty cycling, i.e. without any log
+     *  message.  Powering it on again is not logged either. */
+static volatile bool	l_flgDutyPulse;
+
     /*! Flag if a new run has been started, i.e. the module is prepared to
      *  receive a transponder number. */
 static volatile bool	l_flgNewRun;
 
-    /*! Flag to notify a new transponder ID */
-static volatile bool	l_flgNewID;
+    /*! Queue of new transponder IDs, to be passed to ControlUpdateID(). */
+static RFID_DETECTION	l_IdQueue[RFID_ID_QUEUE_SIZE];
+
+    /*! Put and get index of @ref l_IdQueue. */
+static volatile uint8_t	l_IdQueuePut, l_IdQueueGet;
+
+    /*! Number of IDs lost because @ref l_IdQueue was full. */
+static volatile uint16_t l_IdQueueOverrun;
+
+    /*! Ring buffer of received frames, to be decoded by RFID_Check(). */
+static RFID_RX_FRAME	l_RxRing[RFID_RX_RING_FRAMES];
+
+    /*! Put and get index of @ref l_RxRing. */
+static volatile uint8_t	l_RxRingPut, l_RxRingGet;
+
+    /*! Number of frames lost because @ref l_RxRing was full. */
+static volatile uint16_t l_RxRingOverrun;
+
+    /*! Presence table, the most recently seen ID first. */
+static RFID_PRESENCE	l_Presence[RFID_PRESENCE_SIZE];
+
+    /*! sTimer handle to age the presence table periodically. */
+static volatile TIM_HDL	l_hdlPresenceTick = NONE;
+
+    /*! Flag is set by the sTimer to age the presence table. */
+static volatile bool	l_flgPresenceAge;
+
+#if CFG_ID_INDEX  &&  CFG_ID_PREFETCH > 0
+    /*! Flag is set by RFID_Enable() to prefetch the ID index. */
+static volatile bool	l_flgPrefetch;
+#endif
+
+    /*! Flag if the reader is powered but has not shown any activity yet. */
+static volatile bool	l_flgReadyWait;
+
+    /*! RTC counter value when the reader has been powered on. */
+static volatile uint32_t l_PwrOnTime;
+
+    /*! Readiness statistics of the reader. */
+static volatile RFID_READY_STAT l_ReadyStat;
+
+    /*! Flag to log the readiness statistics at the end of the ON time. */
+static volatile bool	l_flgReadyReport;
+
+    /*! Upper limits in [ms] of the readiness histogram bins. */
+static const uint16_t	l_ReadyBinLimit[RFID_READY_BINS-1] =
+{ 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+
+#if RFID_LB_POWER
+    /*! Flag if the RFID reader may be powered, i.e. during ON_TIME. */
+static volatile bool	l_flgRFID_Window;
+#endif
+
+    /*! Flag notifies a present ID that has not been reported again. */
+static volatile bool	l_flgHoldID;
+
+#if RFID_READERS > 1
+    /*! The ID which has been reported last, see RFID_CrossRead(). */
+static RFID_DETECTION	l_LastID;
 
-    /*! State (index) variable for RFID_Decode. */
-static volatile uint8_t	l_State;
+    /*! Flag if the other reader has also read @ref l_LastID. */
+static bool		l_flgCrossRead;
+#endif
 
 /*=========================== Forward Declarations ===========================*/
 
 static void RFID_DetectTimeout(TIM_HDL hdl);
-static void uartSetup(void);
+static void RFID_EarlyOff(TIM_HDL hdl);
+static void RFID_DutyStart(void);
+static void RFID_DutyStop(void);
+static void RFID_DutyStep(TIM_HDL hdl);
+static void uartSetup(int rd);
+static void RFID_RxDone(unsigned int channel, bool primary, void *user);
+static void RFID_RxStart(int rd);
+static void RFID_RxPush(int rd, const uint16_t *pData, int cnt);
+static void RFID_IdPost(TRANSPONDER_ID id, int rd, uint32_t timeStamp);
+static void RFID_RxGap(TIM_HDL hdl);
+static void RFID_Decode(int rd, uint32_t byte, uint32_t timeStamp);
+static bool RFID_FrameCheck (const RFID_TYPE_PARMS *pType, const uint8_t *w);
+#if RFID_READERS > 1
+static void RFID_CrossRead(int rd, TRANSPONDER_ID id, uint32_t timeStamp);
+#endif
+static bool RFID_PresenceUpdate(TRANSPONDER_ID id);
+static void RFID_PresenceDepart(int idx, const char *pReason);
+static void RFID_PresenceAge(void);
+static void RFID_PresenceTick(TIM_HDL hdl);
+#if CFG_ID_INDEX  &&  CFG_ID_PREFETCH > 0
+static void RFID_Prefetch(void);
+#endif
+static void RFID_Ready(uint32_t timeStamp, bool flgEdge);
 
 /***************************************************************************//**
  *
@@ -205,6 +548,7 @@ static void uartSetup(void);
  ******************************************************************************/
 void	RFID_Init (void)
 {
+int	rd;
    
     /* Check if RFID reader is already in use */
     if (l_flgRFID_Activate)
@@ -213,13 +557,26 @@ void	RFID_Init (void)
 
     /* Now the RFID reader isn't active any more */
     l_flgRFID_Activate = false;
+
+    for (rd = 0;  rd < RFID_READERS;  rd++)
+	l_Reader[rd].Cfg.RFID_Type = RFID_TYPE_NONE;
        
      if (g_RFID_Type == RFID_TYPE_NONE  ||  g_RFID_Power == PWR_OUT_NONE)
 	return;
 
+#if RFID_EM2_RX
+    /* The LEUART supports 9600 baud only */
+    if (g_RFID_Type != RFID_TYPE_SR)
+    {
+	LogError ("RFID_TYPE %s is not supported at LEUART1",
+		  g_enum_RFID_Type[g_RFID_Type]);
+	return;
+    }
+#endif
+
     /* Build new structure based on the configuration variables */
-    l_pRFID_Cfg.RFID_Type   = g_RFID_Type;
-    l_pRFID_Cfg.RFID_PwrOut = g_RFID_Power;
+    l_Reader[0].Cfg.RFID_Type   = g_RFID_Type;
+    l_Reader[0].Cfg.RFID_PwrOut = g_RFID_Power;
     
     /* RFID reader should be activated */
     l_flgRFID_Activate = true;
@@ -228,10 +585,65 @@ void	RFID_Init (void)
     Log ("Initializing RFID reader of type %s for Power Output %s",
 	 g_enum_RFID_Type[g_RFID_Type], g_enum_PowerOutput[g_RFID_Power]);
 #endif
+
+#if RFID_READERS > 1
+    /* The second reader is optional, the LEUART supports 9600 baud only */
+    if (g_RFID2_Type != RFID_TYPE_NONE  &&  g_RFID2_Power != PWR_OUT_NONE)
+    {
+	if (g_RFID2_Type != RFID_TYPE_SR)
+	{
+	    LogError ("RFID2_TYPE %s is not supported at LEUART1",
+		      g_enum_RFID_Type[g_RFID2_Type]);
+	}
+	else
+	{
+	    l_Reader[1].Cfg.RFID_Type   = g_RFID2_Type;
+	    l_Reader[1].Cfg.RFID_PwrOut = g_RFID2_Power;
+#ifdef LOGGING
+	    Log ("Initializing RFID reader 2 of type %s for Power Output %s",
+		 g_enum_RFID_Type[g_RFID2_Type],
+		 g_enum_PowerOutput[g_RFID2_Power]);
+#endif
+	}
+    }
+#endif
     
     /* Create another timer for the ID detection timeout */
     if (l_hdlRFID_DetectTimeout == NONE)
 	l_hdlRFID_DetectTimeout = sTimerCreate (RFID_DetectTimeout);
+
+    /* Create a timer to end the detect window early */
+    if (l_hdlEarlyOff == NONE)
+	l_hdlEarlyOff = msTimerCreate (RFID_EarlyOff);
+
+    /* Create a timer for the duty cycling */
+    if (l_hdlDuty == NONE)
+	l_hdlDuty = msTimerCreate (RFID_DutyStep);
+
+#if RFID_RX_GAP_TIMEOUT > 0
+    /* Create a timer for the receive gap timeout of each reader */
+    for (rd = 0;  rd < RFID_READERS;  rd++)
+    {
+	if (l_Reader[rd].Cfg.RFID_Type != RFID_TYPE_NONE
+	&&  l_Reader[rd].hdlRxGap == NONE)
+	    l_Reader[rd].hdlRxGap = msTimerCreate (RFID_RxGap);
+    }
+#endif
+
+    /* Connect the Rx pin of the first reader to its EXTI, it is enabled by
+     * RFID_PowerOn() */
+    ExtIntDisable (RFID_RX_EXTI_NUM);
+    GPIO_IntConfig (l_USART_Parms[0].UART_Rx_Port,
+		    l_USART_Parms[0].UART_Rx_Pin, false, false, false);
+
+    /* Create a timer to age the presence table, start with an empty one */
+    if (l_hdlPresenceTick == NONE)
+	l_hdlPresenceTick = sTimerCreate (RFID_PresenceTick);
+    else
+	sTimerCancel (l_hdlPresenceTick);
+
+    memset (l_Presence, 0, sizeof(l_Presence));
+    l_flgPresenceAge = false;
 }
 
 
@@ -272,17 +684,47 @@ void RFID_Enable (void)
         if (l_hdlRFID_DetectTimeout != NONE)
         sTimerCancel(l_hdlRFID_DetectTimeout);
         l_flgObjectNewID = false;
+        l_flgDetectRun = false;
     }
     else
     {
         if (l_hdlRFID_DetectTimeout != NONE)
         sTimerStart(l_hdlRFID_DetectTimeout, g_RFID_DetectTimeout);
+        l_flgDetectRun = true;
     }
       
     /* re-trigger "new run" flag */
     l_flgNewRun = true;
     DBG_PUTS(" DBG RFID_Enable: setting l_flgNewRun=1\n");
+
+    /* The new run has not seen any data yet, the visit goes on */
+    l_flgRxActivity = false;
+    if (l_hdlEarlyOff != NONE)
+	msTimerCancel (l_hdlEarlyOff);
+
+    /* Power the reader on again after it has been powered off early */
+    if (l_flgEarlyOff)
+    {
+	l_flgEarlyOff = false;
+	l_flgRFID_On = true;
+	EVENT_POST(EVT_RFID);
+    }
+
+#if RFID_LB_POWER
+    /* Pre-warming: the first light barrier edge powers the reader on */
+    if (l_flgRFID_Window)
+    {
+	l_flgRFID_On = true;
+	EVENT_POST(EVT_RFID);
+    }
+#endif
     
+#if CFG_ID_INDEX  &&  CFG_ID_PREFETCH > 0
+    /* The SD-Card is idle until the frame arrives, prefetch the ID index */
+    l_flgPrefetch = true;
+    EVENT_POST(EVT_RFID);
+#endif
+
     /* (re-)start timer for RFID timeout detection */
     DBG_PUTS(" DBG RFID_Enable: starting Detect Timeout\n");
 }
@@ -296,8 +738,59 @@ void RFID_Enable (void)
  ******************************************************************************/
 void RFIDPower_Enable (void)
 {
+#if RFID_LB_POWER
+   /* the reader will be powered by the first light barrier edge */
+   l_flgRFID_Window = true;
+#else
    /* initiate power-on of the RFID reader */
    l_flgRFID_On = true;
+   EVENT_POST(EVT_RFID);
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Light Barriers are idle
+ *
+ * This routine is called by the light barrier module after the light
+ * barriers became inactive and LB_FILTER_DURATION has elapsed.  If
+ * @ref RFID_LB_POWER is set, the RFID reader is powered off until the next
+ * light barrier edge.  If the reader has not sent anything during this run,
+ * the detect window may end early, see RFID_EarlyOff().
+ *
+ ******************************************************************************/
+void RFID_LB_Idle (void)
+{
+    /* The visit is over, the next one starts in continuous mode */
+    RFID_DutyStop();
+
+#if RFID_LB_POWER
+    if (l_flgRFID_On)
+    {
+	l_flgRFID_On = false;	// mark RFID reader to be powered off
+	EVENT_POST(EVT_RFID);
+    }
+#endif
+
+    if (g_RFID_EarlyOff > 0  &&  l_flgDetectRun  &&  ! l_flgRxActivity
+    &&  l_hdlEarlyOff != NONE)
+	msTimerStart (l_hdlEarlyOff, g_RFID_EarlyOff);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	A Light Barrier changed
+ *
+ * This routine is called by the light barrier module whenever the state of
+ * a light barrier changes.  The bird has moved, so the reader returns to
+ * continuous mode, see RFID_DutyStep().
+ *
+ ******************************************************************************/
+void RFID_LB_Edge (void)
+{
+    RFID_DutyStop();
 }
 
 
@@ -315,9 +808,38 @@ void RFID_Disable (void)
       /* no transpondered object is present, clear flag */
     l_flgObjectNewID = false;
 
+    /* the next ON time powers the reader in any case */
+    l_flgEarlyOff = false;
+    if (l_hdlEarlyOff != NONE)
+	msTimerCancel (l_hdlEarlyOff);
+
+    /* end the duty cycling, log if the reader is off for it */
+    RFID_DutyStop();
+    if (l_flgDutyPulse)
+    {
+	l_flgDutyPulse = false;
+#ifdef LOGGING
+	Log ("RFID is powered off");
+#endif
+    }
+
+#if RFID_LB_POWER
+    l_flgRFID_Window = false;
+#endif
+
+    /* log the readiness statistics of this ON time */
+    if (l_ReadyStat.Cnt > 0  ||  l_ReadyStat.NoneCnt > 0)
+    {
+	l_flgReadyReport = true;
+	EVENT_POST(EVT_RFID);
+    }
+
     /* be sure to cancel timeout timer */
     if (l_hdlRFID_DetectTimeout != NONE)
 	sTimerCancel (l_hdlRFID_DetectTimeout);
+    l_flgDetectRun = false;
+
+    l_flgRFID_Resume = false;
     
     if (l_flgRFID_On)
     {
@@ -342,24 +864,59 @@ void RFID_Disable (void)
  ******************************************************************************/
 void RFID_PowerOn (void)
 {
+int	rd;
+bool	flgEM1 = false;
+
     if (l_flgRFID_Activate)
     {
+	/* Generate Log Message, except for the duty cycling */
+	if (! l_flgDutyPulse)
+	{
 #ifdef LOGGING
-	/* Generate Log Message */
-	Log ("RFID is powered ON");
+	    Log ("RFID is powered ON");
 #endif
+	}
+
+	for (rd = 0;  rd < RFID_READERS;  rd++)
+	{
+	    if (l_Reader[rd].Cfg.RFID_Type == RFID_TYPE_NONE)
+		continue;
+
+	    /* A USART is not clocked in EM2, a LEUART is */
+	    if (l_USART_Parms[rd].UART != NULL)
+		flgEM1 = true;
+
+	    /* Prepare UART to receive Transponder ID */
+	    uartSetup(rd);
+
+	    /* Set Power Enable Pin for the RFID receiver to ON, only once if
+	     * both readers share the same power output */
+	    if (rd == 0  ||  l_Reader[rd].Cfg.RFID_PwrOut
+			     != l_Reader[0].Cfg.RFID_PwrOut)
+	    {
+		if (l_flgDutyPulse)
+		    PowerOutputSwitch (l_Reader[rd].Cfg.RFID_PwrOut, PWR_ON);
+		else
+		    PowerOutput (l_Reader[rd].Cfg.RFID_PwrOut, PWR_ON);
+	    }
 
-	/* Module RFID requires EM1, set bit in bit mask */
-	Bit(g_EM1_ModuleMask, EM1_MOD_RFID) = 1;
+	    /* Reset index */
+	    l_Reader[rd].State = 0;
+	}
+	l_flgDutyPulse = false;
 
-	/* Prepare UART to receive Transponder ID */
-	uartSetup();
+	/* Module RFID requires EM1, if any reader is connected to a USART */
+	if (flgEM1)
+	    EM1_Acquire (EM1_MOD_RFID);
 
-	/* Set Power Enable Pin for the RFID receiver to ON */
-	PowerOutput (l_pRFID_Cfg.RFID_PwrOut, PWR_ON);
+	/* Wait for the first activity of the (first) reader */
+	l_PwrOnTime = RTC->CNT;
+	l_flgReadyWait = true;
+	ExtIntEnable (RFID_RX_EXTI_NUM);
 
-	/* Reset index */
-	l_State = 0;
+	/* The gap timer triggers RFID_Check() if the reader keeps silent */
+	if (l_Reader[0].hdlRxGap != NONE)
+	    msTimerStart (l_Reader[0].hdlRxGap, RFID_READY_MAX);
     }
 }
 
@@ -373,25 +930,55 @@ void RFID_PowerOn (void)
  ******************************************************************************/
 void RFID_PowerOff (void)
 {
-    /* Set Power Enable Pin for the RFID receiver to OFF */
-    PowerOutput (l_pRFID_Cfg.RFID_PwrOut, PWR_OFF);
+int	rd;
+
+    /* Stop readiness detection */
+    ExtIntDisable (RFID_RX_EXTI_NUM);
+    l_flgReadyWait = false;
+
+    for (rd = 0;  rd < RFID_READERS;  rd++)
+    {
+	RFID_READER *pRd = &l_Reader[rd];
+	const USART_Parms *pParms = &l_USART_Parms[rd];
+
+	if (pRd->Cfg.RFID_Type == RFID_TYPE_NONE)
+	    continue;
+
+	/* Set Power Enable Pin for the RFID receiver to OFF, only once */
+	if (rd == 0  ||  pRd->Cfg.RFID_PwrOut != l_Reader[0].Cfg.RFID_PwrOut)
+	{
+	    if (l_flgDutyPulse)
+		PowerOutputSwitch (pRd->Cfg.RFID_PwrOut, PWR_OFF);
+	    else
+		PowerOutput (pRd->Cfg.RFID_PwrOut, PWR_OFF);
+	}
+
+	/* Stop DMA reception */
+	DMA->CHENC = (1 << pParms->DMA_Chan_Rx);
+	if (pRd->hdlRxGap != NONE)
+	    msTimerCancel (pRd->hdlRxGap);
+
+	/* Release clock for UART module */
+	ClockRelease (CLK_OWN_RFID, pParms->cmuClock_UART);
 
-    /* Disable clock for USART module */
-    CMU_ClockEnable(l_USART_Parms.cmuClock_UART, false);
+	/* Disable Rx pin */
+	GPIO_PinModeSet(pParms->UART_Rx_Port,
+			pParms->UART_Rx_Pin, gpioModeDisabled, 0);
 
-    /* Disable Rx pin */
-    GPIO_PinModeSet(l_USART_Parms.UART_Rx_Port,
-		    l_USART_Parms.UART_Rx_Pin, gpioModeDisabled, 0);
+	/* Reset indexes */
+	pRd->State = 0;
+    }
 
-    /* Reset indexes */
-    l_State = 0;
+    /* Discard received data */
+    l_RxRingGet = l_RxRingPut;
 
-    /* Module RFID is no longer active, clear bit in bit mask */
-    Bit(g_EM1_ModuleMask, EM1_MOD_RFID) = 0;
+    /* Module RFID is no longer active */
+    EM1_Release (EM1_MOD_RFID);
 
 #ifdef LOGGING
-    /* Generate Log Message */
-    Log ("RFID is powered off");
+    /* Generate Log Message, except for the duty cycling */
+    if (! l_flgDutyPulse)
+	Log ("RFID is powered off");
 #endif
 }
 
@@ -424,23 +1011,114 @@ void	RFID_Check (void)
 	/* RFID reader should be powered OFF */
 	if (l_flgRFID_IsOn)
 	{
+           l_flgDutyPulse = l_flgDuty;	// quiet for the duty cycling
            RFID_PowerOff();
            l_flgRFID_IsOn = false;
 	}
     }
 
-    if (l_flgNewID)
+    /* Decode the received frames */
+    while (l_RxRingGet != l_RxRingPut)
     {
- 
-       l_flgNewID = false;
-     
-       if (l_hdlRFID_DetectTimeout != NONE)
-	  sTimerCancel (l_hdlRFID_DetectTimeout);
-        
-        /* New transponder ID has been set - inform control module */
-	ControlUpdateID(g_Transponder);
+	RFID_RX_FRAME *pFrame = &l_RxRing[l_RxRingGet % RFID_RX_RING_FRAMES];
+	int i;
+
+	for (i = 0;  i < pFrame->Len;  i++)
+	    RFID_Decode (pFrame->Reader, pFrame->Data[i], pFrame->TimeStamp);
+
+	l_RxRingGet++;
+    }
+
+    if (l_RxRingOverrun)
+    {
+	LogError ("RFID: %d frames lost", l_RxRingOverrun);
+	l_RxRingOverrun = 0;
+    }
+
+    if (l_flgPresenceAge)
+    {
+	l_flgPresenceAge = false;
+	RFID_PresenceAge();
+    }
+
+#if CFG_ID_INDEX  &&  CFG_ID_PREFETCH > 0
+    if (l_flgPrefetch)
+    {
+	l_flgPrefetch = false;
+
+	/* not required if the ID has already been read */
+	if (l_IdQueueGet == l_IdQueuePut)
+	    RFID_Prefetch();
+    }
+#endif
+
+    /* See if the reader did not show any activity after power-on */
+    if (l_flgReadyWait  &&  ((RTC->CNT - l_PwrOnTime) & 0xFFFFFF)
+			    >= MS2TICS(RFID_READY_MAX))
+    {
+	INT_Disable();
+	if (l_flgReadyWait)
+	{
+	    l_flgReadyWait = false;
+	    ExtIntDisable (RFID_RX_EXTI_NUM);
+	    l_ReadyStat.NoneCnt++;
+	}
+	INT_Enable();
+    }
+
+    if (l_flgReadyReport)
+    {
+	l_flgReadyReport = false;
+	RFID_ReadyReport (true);
+    }
+
+    if (l_flgHoldID)
+    {
+	/* ID is still present - no need to wait for it any longer */
+	l_flgHoldID = false;
+
+	if (l_hdlRFID_DetectTimeout != NONE)
+	    sTimerCancel (l_hdlRFID_DetectTimeout);
+	l_flgDetectRun = false;
+
+	RFID_DutyStart();
+    }
+
+    /* Inform the control module about the new transponder IDs */
+    while (l_IdQueueGet != l_IdQueuePut)
+    {
+	RFID_DETECTION det = l_IdQueue[l_IdQueueGet % RFID_ID_QUEUE_SIZE];
+
+	l_IdQueueGet++;
+
+	if (l_hdlRFID_DetectTimeout != NONE)
+	    sTimerCancel (l_hdlRFID_DetectTimeout);
+	l_flgDetectRun = false;
+
+#if RFID_READERS > 1
+	/* Tell which reader has seen the transponder first */
+	if (det.Reader != NONE  &&  l_Reader[1].Cfg.RFID_Type != RFID_TYPE_NONE)
+	{
+	    char idStr[ID_STR_SIZE];
+
+	    Log ("Transponder %s read by RFID reader %d",
+		 CfgIDToString (det.ID, idStr), det.Reader + 1);
+	}
+#endif
+	ControlUpdateID(det.ID);
+
+	/* A transponder is present, duty cycle the reader */
+	if (det.ID != ID_UNKNOWN)
+	    RFID_DutyStart();
+    }
+
+    if (l_IdQueueOverrun)
+    {
+	LogError ("RFID: %d transponder IDs lost", l_IdQueueOverrun);
+	l_IdQueueOverrun = 0;
     }
 }
+TASK_REGISTER(TASK_PRIO_RFID, EVT_RFID, RFID_Check);
 
 
 /***************************************************************************//**
@@ -457,8 +1135,16 @@ void	RFID_PowerFailHandler (void)
    /* Cancel timer */ 
    if (l_hdlRFID_DetectTimeout != NONE)
 	sTimerCancel (l_hdlRFID_DetectTimeout);
+   l_flgDetectRun = false;
+
+   /* The reader is on after the outage, if it was on before */
+   RFID_DutyStop();
 
-    /* Switch RFID reader off */
+   if (l_hdlEarlyOff != NONE)
+	msTimerCancel (l_hdlEarlyOff);
+
+    /* Switch RFID reader off, remember its state */
+    l_flgRFID_Resume = l_flgRFID_On;
     l_flgRFID_On = false;
 
     if (l_flgRFID_IsOn)
@@ -469,6 +1155,56 @@ void	RFID_PowerFailHandler (void)
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	RFID Fast Resume after Power Fail
+ *
+ * This function is called by PowerFailCheck() after a short outage.  If the
+ * RFID reader was on before the power-fail, and has not been disabled
+ * meanwhile, it is powered on again.
+ *
+ ******************************************************************************/
+void	RFID_PowerFailResume (void)
+{
+    if (l_flgRFID_Resume)
+    {
+	l_flgRFID_Resume = false;
+	l_flgRFID_On = true;
+	EVENT_POST(EVT_RFID);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	RFID Clock Change
+ *
+ * This function is called by the HF clock governor after the HF clock has
+ * been switched, see HfClockBoost().  It recalculates the baud rate of the
+ * USART of each active reader.  The LEUART of the second reader is clocked
+ * by the LFXO, and therefore not affected.
+ *
+ ******************************************************************************/
+void	RFID_ClockChange (void)
+{
+int	rd;
+
+    if (! l_flgRFID_IsOn)
+	return;		// UARTs are not in use
+
+    for (rd = 0;  rd < RFID_READERS;  rd++)
+    {
+	if (l_Reader[rd].Cfg.RFID_Type == RFID_TYPE_NONE
+	||  l_USART_Parms[rd].UART == NULL)
+	    continue;
+
+	USART_BaudrateAsyncSet (l_USART_Parms[rd].UART, 0,
+		l_RFID_Type_Parms[l_Reader[rd].Cfg.RFID_Type].Baudrate,
+		usartOVS16);
+    }
+}
+
+
 /***************************************************************************//**
  *
  * @brief	RFID Detect Timeout occurred
@@ -485,15 +1221,17 @@ static void RFID_DetectTimeout(TIM_HDL hdl)
 
     DBG_PUTS(" DBG RFID_DetectTimeout: Detect Timeout over, set UNKNOWN\n");
     
-    strcpy (g_Transponder, "UNKNOWN");
+    l_flgDetectRun = false;
+    g_Transponder = ID_UNKNOWN;
 
 #if defined(LOGGING)  &&  ! defined (MOD_CONTROL_EXISTS)
 	/* Generate Log Message if there is no external module to handle this */
-	Log ("Transponder: %s", g_Transponder);
+	Log ("Transponder: UNKNOWN");
 #endif
         
-    /* Set flag to notify new transponder ID */
-    l_flgNewID = true;
+    /* Queue the new transponder ID for RFID_Check() */
+    RFID_IdPost (ID_UNKNOWN, NONE, RTC->CNT);
+    EVENT_POST(EVT_RFID);
         
   
 }
@@ -501,215 +1239,767 @@ static void RFID_DetectTimeout(TIM_HDL hdl)
 
 /***************************************************************************//**
  *
- * @brief	Decode RFID
- *
- * This routine is called from the UART interrupt handler, whenever a new
- * byte has been received.  It contains a state machine to extract a valid
- * transponder ID from the data stream, store it into the global variable
- * @ref g_Transponder, and initiate a display update.  The transponder number
- * is additionally logged, if logging is enabled.
- *
- * The following RFID reader types are supported:
- * - @ref RFID_TYPE_SR : Short Range reader (14 byte frame)
- * - @ref RFID_TYPE_LR : Long Range reader (11 byte frame)
+ * @brief	End the Detect Window early
  *
- * @note
- * The RFID reader permanently sends the ID as long as the transponder resides
- * in its range.  To prevent a huge amount of log messages, the received data
- * is compared with the previous ID.  It will only be logged if it differs,
- * or the flag @ref l_flgNewRun is set, which indicates a transponder detection
- * after a period of "absence".
+ * This routine is called from the RTC interrupt handler, when the reader
+ * did not send any data until the light barrier filter expired, and for
+ * further @ref g_RFID_EarlyOff milliseconds.  Since the bird has gone
+ * without a transponder, the detect timeout is cancelled and its action is
+ * performed now, i.e. the ID is set to "UNKNOWN".  The reader is powered off
+ * until the next light barrier edge, see RFID_Enable().
  *
  ******************************************************************************/
-static void RFID_Decode(uint32_t byte)
+static void RFID_EarlyOff(TIM_HDL hdl)
 {
-const  uint8_t	 v[5] = { 0x0E, 0x00, 0x11, 0x00, 0x05};
-const  char	 HexChar[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
- 				'8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
-static uint8_t	 xorsum;  // checksum variables
-static uint8_t	 w[14];   // buffer for storing received bytes
-static uint16_t	 crc;     // checksum variables
-uint16_t	 val;
-bool	 flgRecvdID = false;
-char	 newTransponder[50]; // also used to store data in case of error message
-int	 offs = 0;	// byte offset within the received transponder message
-int	 i, pos;
-
+    /* Data received meanwhile, or the detect window is over already */
+    if (l_flgRxActivity  ||  ! l_flgDetectRun)
+	return;
 
-    /* count communication errors for debugging purposes */
-    if (byte & USART_RXDATAX_FERR)
-	g_FERR_Cnt++;
+    if (l_hdlRFID_DetectTimeout != NONE)
+	sTimerCancel (l_hdlRFID_DetectTimeout);
 
-    if (byte & USART_RXDATAX_PERR)
-	g_PERR_Cnt++;
+    RFID_DetectTimeout (hdl);
+
+    if (l_flgRFID_On)
+    {
+	l_flgRFID_On = false;	// mark RFID reader to be powered off
+	l_flgEarlyOff = true;	// RFID_Enable() powers it on again
+	EVENT_POST(EVT_RFID);
+    }
+}
 
-    /* store current byte into receive buffer */
-    byte &= 0xFF;		// only bit 7~0 contains the data
-    DBG_PUTC('[');DBG_PUTC(HexChar[(byte >> 4) & 0xF]);
-    DBG_PUTC(HexChar[byte & 0xF]);DBG_PUTC(']');
-    w[l_State] = (uint8_t)byte;
 
-    /* handle data according to the respective RFID reader type */
-    switch (l_pRFID_Cfg.RFID_Type)
+/***************************************************************************//**
+ *
+ * @brief	Start the Duty Cycling
+ *
+ * This routine is called by RFID_Check() when a transponder has been read,
+ * or is still present.  If @ref g_RFID_DutyOn and @ref g_RFID_DutyPeriod
+ * are set, the reader is powered for the on time every period only, see
+ * RFID_DutyStep().
+ *
+ ******************************************************************************/
+static void RFID_DutyStart(void)
+{
+    if (g_RFID_DutyOn <= 0  ||  g_RFID_DutyPeriod <= g_RFID_DutyOn
+    ||  l_flgDuty  ||  ! l_flgRFID_On  ||  l_hdlDuty == NONE)
+	return;
+
+    /* The current on phase lasts for the on time */
+    l_flgDutyRx = false;
+    l_flgDuty = true;
+    msTimerStart (l_hdlDuty, g_RFID_DutyOn);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop the Duty Cycling
+ *
+ * This routine returns the reader to continuous mode, i.e. it is powered on
+ * again if it is in the off phase.  It is called when a light barrier
+ * changes, the visit is over, and when the reader is disabled.
+ *
+ ******************************************************************************/
+static void RFID_DutyStop(void)
+{
+    INT_Disable();
+
+    if (l_flgDuty)
     {
-	case RFID_TYPE_SR:	// Short Range reader (14 byte frame, 133kHz)
-	    /*
-	     * NOTE: Most of the code has been taken from file "RFID_tag.c"
-	     */
-	    switch (l_State)	// the state machine!
-	    {
-	    case 0:
-		xorsum = 0;
-		/* no break */
-	    case 1:
-	    case 2:
-	    case 3:
-	    case 4:
-		// Verify prefix
-		if (byte != v[l_State])
-		{
-		    l_State = 0;	// restart state machine
-		    break;		// break!
-		}
-		/* no break */
-	    case 5:
-	    case 6:
-	    case 7:
-	    case 8:
-	    case 9:
-	    case 10:
-	    case 11:
-	    case 12:
-		xorsum ^= byte;		// build checksum
-		l_State++;		// go on
-		break;			// break!
-
-	    case 13:
-		if (w[13] != xorsum)	// handle ERROR case
-		{
-		    /* Print Hex Codes of the wrong message */
-		    pos = 0;
-		    for (i=0; i <= 13; i++)
-		    {
-			newTransponder[pos++] = ' ';
-			newTransponder[pos++] = HexChar[(w[i] >> 4) & 0x0F];
-			newTransponder[pos++] = HexChar[(w[i]) & 0x0F];
-		    }
-		    newTransponder[pos] = '\0';
-		    LogError("RFID_Decode(): recv.XOR=0x%02X, calc.XOR=0x%02X,"
-			     " data is%s", w[13], xorsum, newTransponder);
-		    l_State = 0;	// restart state machine
-		    break;
-		}
+	l_flgDuty = false;
+	if (l_hdlDuty != NONE)
+	    msTimerCancel (l_hdlDuty);
 
-		flgRecvdID = true;	// ID has been received - set flag
-		offs = 12;		// byte offset within the message
-		break;
+	if (! l_flgRFID_On)
+	{
+	    l_flgRFID_On = true;
+	    EVENT_POST(EVT_RFID);
+	}
+    }
 
-	    default:
-		l_State = 0;	// restart state machine
-		break;
-	    }
-	    break;
+    INT_Enable();
+}
 
-	case RFID_TYPE_LR:	// Long Range reader (11 byte frame, 133kHz)
-	    switch (l_State)	// the state machine!
-	    {
-	    case 0:	// expect prefix 0x54 ('T')
-		if (byte != 0x54)
-		{		// (there may be leading zeros)
-		    l_State = 0; // restart state machine
-		    break;		// break!
-		}
-		/* no break */
-	    case 1:
-		crc = 0x0000;	// init w/ 0
-		/* no break */
-	    case 2:
-	    case 3:
-	    case 4:
-	    case 5:
-	    case 6:
-	    case 7:
-	    case 8:
-		/*
-		 * calculate CRC-CCITT as used by KERMIT (the protocol,
-		 * not the frog ;-)  polynomial: x^16+x^12+x^5+1
-		 * http://www.columbia.edu/kermit/ftp/e/kproto.doc
-		 */
-		val = crc;
-		val = (val >> 4) ^ (((val ^ (byte >> 0)) & 0x0F) * 4225);
-		val = (val >> 4) ^ (((val ^ (byte >> 4)) & 0x0F) * 4225);
-		crc = val;
-		/* no break */
-	    case 9:
-		l_State++;	// increase position in buffer
-		break;			// break!
-
-	    case 10:	// received complete frame
-		val = (w[10] << 8) | w[9];
-		if (val != crc)		// handle ERROR case
-		{
-		    /* Print Hex Codes of the wrong message */
-		    pos = 0;
-		    for (i=0; i <= 10; i++)
-		    {
-			newTransponder[pos++] = ' ';
-			newTransponder[pos++] = HexChar[(w[i] >> 4) & 0x0F];
-			newTransponder[pos++] = HexChar[(w[i]) & 0x0F];
-		    }
-		    newTransponder[pos] = '\0';
-		    LogError("RFID_Decode(): recv.CRC=0x%04X, calc.CRC=0x%04X,"
-			     " data is%s", val, crc, newTransponder);
-		    l_State = 0;	// restart state machine
-		    break;
-		}
 
-		flgRecvdID = true;	// ID has been received - set flag
-		offs = 8;		// byte offset within the message
-		break;
+/***************************************************************************//**
+ *
+ * @brief	Next Phase of the Duty Cycling
+ *
+ * This routine is called from the RTC interrupt handler at the end of the on
+ * phase and of the off phase.  At the end of the on phase, the reader is
+ * powered off, if it has received data during this phase.  If not, the
+ * transponder has gone, and the reader stays on in continuous mode to catch
+ * the next one.  The presence table is updated by the data of the on phases,
+ * see RFID_PresenceUpdate().
+ *
+ * @param[in] hdl
+ *	Timer handle of the duty cycling.
+ *
+ ******************************************************************************/
+static void RFID_DutyStep(TIM_HDL hdl)
+{
+    if (! l_flgDuty)
+	return;
 
-	    default:
-		l_State = 0;	// restart state machine
-		break;
-	    }
-	    break;
+    if (l_flgRFID_On)
+    {
+	if (! l_flgDutyRx)
+	{
+	    l_flgDuty = false;		// transponder has gone
+	    return;
+	}
 
-	default:		// unknown RFID reader type
-	    l_State = 0;	// restart state machine
-	    break;
+	l_flgRFID_On = false;		// off phase
+	msTimerStart (hdl, g_RFID_DutyPeriod - g_RFID_DutyOn);
+    }
+    else
+    {
+	l_flgDutyRx = false;
+	l_flgRFID_On = true;		// on phase
+	msTimerStart (hdl, g_RFID_DutyOn);
+    }
+
+    EVENT_POST(EVT_RFID);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Decode RFID
+ *
+ * This routine is called from RFID_Check() for every byte which has been
+ * received via DMA.  It contains a state machine to extract a valid
+ * transponder ID from the data stream, store it into the global variable
+ * @ref g_Transponder, and initiate a display update.  The transponder number
+ * is additionally logged, if logging is enabled.
+ *
+ * The following RFID reader types are supported:
+ * - @ref RFID_TYPE_SR : Short Range reader (14 byte frame)
+ * - @ref RFID_TYPE_LR : Long Range reader (11 byte frame)
+ *
+ * The format of a frame is described by @ref RFID_TYPE_PARMS.  For each
+ * byte, the state machine only verifies the prefix and stores the byte.  The
+ * checksum is verified once per complete frame by RFID_FrameCheck().
+ *
+ * @note
+ * The RFID reader permanently sends the ID as long as the transponder resides
+ * in its range.  To prevent a huge amount of log messages, the received data
+ * is compared with the previous ID.  It will only be logged if it differs,
+ * or the flag @ref l_flgNewRun is set, which indicates a transponder detection
+ * after a period of "absence".  If @ref g_RFID_AbsentDetectTimeout is set, an
+ * ID which has been seen within this duration is not reported again, see
+ * RFID_PresenceUpdate().  This comparison is common to all readers, so an ID
+ * is reported once, by the reader which has read it first.
+ *
+ * @param[in] rd
+ *	Index of the reader, the state machine is kept per reader.
+ *
+ * @param[in] byte
+ *	Received data from RXDATAX, including the error flags.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value when the frame has been received.
+ *
+ ******************************************************************************/
+static void RFID_Decode(int rd, uint32_t byte, uint32_t timeStamp)
+{
+#if MOD_DEBUG
+const  char	 HexChar[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+ 				'8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+#endif
+RFID_READER *pRd = &l_Reader[rd];
+const RFID_TYPE_PARMS *pType;
+uint8_t	*w = pRd->w;	// buffer for storing received bytes
+TRANSPONDER_ID newTransponder;
+#if defined(LOGGING)  &&  ! defined (MOD_CONTROL_EXISTS)
+char	 idStr[ID_STR_SIZE];
+#endif
+int	 i;
+
+
+    /* count communication errors for debugging purposes */
+    if (byte & USART_RXDATAX_FERR)
+	g_FERR_Cnt++;
+
+    if (byte & USART_RXDATAX_PERR)
+	g_PERR_Cnt++;
+
+    byte &= 0xFF;		// only bit 7~0 contains the data
+    DBG_PUTC('[');DBG_PUTC(HexChar[(byte >> 4) & 0xF]);
+    DBG_PUTC(HexChar[byte & 0xF]);DBG_PUTC(']');
+
+    if (pRd->Cfg.RFID_Type < 0  ||  pRd->Cfg.RFID_Type >= NUM_RFID_TYPE)
+    {
+	pRd->State = 0;		// unknown RFID reader type
+	return;
+    }
+    pType = &l_RFID_Type_Parms[pRd->Cfg.RFID_Type];
+
+    /* verify prefix */
+    if (pRd->State < pType->PrefixLen  &&  byte != pType->pPrefix[pRd->State])
+    {
+	pRd->State = 0;		// restart state machine
+	return;
     }
 
+    /* store current byte into receive buffer, wait for the complete frame */
+    w[pRd->State++] = (uint8_t)byte;
+    if (pRd->State < pType->FrameSize)
+	return;
+
+    pRd->State = 0;		// restart state machine
+
     /* see if a transponder ID has been received */
-    if (flgRecvdID)
+    if (RFID_FrameCheck (pType, w))
     {
-        l_State = 0;		// restart state machine
+	/* A valid frame marks the reader ready, if no edge did before */
+	if (l_flgReadyWait  &&  rd == 0)
+	    RFID_Ready (timeStamp, false);
+
+	newTransponder = 0;
+	for (i=0; i < 8; i++)	// pack w into 64bit value, MSB first
+	    newTransponder = (newTransponder << 8) | w[pType->IdOffs - i];
 
-	for (i=0; i < 8; i++)	// copy w and convert to ASCII HEX
+	/* see if this ID is still present, i.e. has not been absent */
+	if (RFID_PresenceUpdate (newTransponder))
 	{
-	    newTransponder[2*i]	  = HexChar[(w[offs-i]>>4) & 0x0F];
-	    newTransponder[2*i+1] = HexChar[(w[offs-i]) & 0x0F];
+	    if (l_flgNewRun)
+	    {
+		l_flgNewRun = false;	// this run has found its ID
+		l_flgObjectNewID = true;
+		l_flgHoldID = true;	// cancel detect timeout
+	    }
 	}
-	newTransponder[16] = '\0';
-
         /* see if a new run - or Transponder Number has changed */
-	if (l_flgNewRun  ||  strcmp (newTransponder, g_Transponder))
+	else if (l_flgNewRun  ||  newTransponder != g_Transponder)
 	{
 	    l_flgNewRun = false;	// clear flag
 
 	    /* store new Transponder Number */
-	    strcpy (g_Transponder, newTransponder);
+	    g_Transponder = newTransponder;
 
 #if defined(LOGGING)  &&  ! defined (MOD_CONTROL_EXISTS)
 	    /* Generate Log Message */
-	    Log ("Transponder: %s", g_Transponder);
+	    Log ("Transponder: %s", CfgIDToString (g_Transponder, idStr));
+#endif
+	    /* Queue the new transponder ID, RFID_Check() passes it on */
+	    RFID_IdPost (newTransponder, rd, timeStamp);
+#if RFID_READERS > 1
+	    l_LastID.ID = newTransponder;
+	    l_LastID.TimeStamp = timeStamp;
+	    l_LastID.Reader = rd;
+	    l_flgCrossRead = false;
 #endif
-	    /* Set flag to notify new transponder ID */
-	    l_flgNewID = true;
             
             /* Set flag to notify there is an transpondered object */
 	    l_flgObjectNewID = true;
 	}
+#if RFID_READERS > 1
+	RFID_CrossRead (rd, newTransponder, timeStamp);
+#endif
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Verify the Checksum of a Frame
+ *
+ * This routine is called by RFID_Decode() for each complete frame.  It
+ * calculates the XOR sum, or the CRC-CCITT (KERMIT) as used by the Long
+ * Range reader, over the bytes specified in @ref RFID_TYPE_PARMS, and
+ * compares it with the received one.  The CRC is calculated nibble by nibble
+ * with @ref l_CrcNibble, 32 bytes of flash instead of 512 for a byte table.
+ * A wrong frame is logged with its data.
+ *
+ * @param[in] pType
+ *	Parameters of the reader type.
+ *
+ * @param[in] w
+ *	Complete frame.
+ *
+ * @return
+ *	The value <i>true</i> if the checksum is valid.
+ *
+ ******************************************************************************/
+static bool RFID_FrameCheck (const RFID_TYPE_PARMS *pType, const uint8_t *w)
+{
+const  char	 HexChar[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+ 				'8', '9', 'A', 'B', 'C', 'D', 'E', 'F'};
+const uint8_t	*pData = w + pType->ChkOffs;
+const uint8_t	*pEnd  = pData + pType->ChkCnt;
+uint16_t	 calc = 0, recvd;
+char		 errData[3 * RFID_FRAME_SIZE_MAX + 1];
+int		 i, pos;
+
+    if (pType->flgCrc)
+    {
+	/* calculate CRC-CCITT as used by KERMIT (the protocol, not the frog ;-)
+	 * http://www.columbia.edu/kermit/ftp/e/kproto.doc */
+	for ( ;  pData < pEnd;  pData++)
+	{
+	    calc = (calc >> 4) ^ l_CrcNibble[(calc ^ *pData) & 0x0F];
+	    calc = (calc >> 4) ^ l_CrcNibble[(calc ^ (*pData >> 4)) & 0x0F];
+	}
+	recvd = (pEnd[1] << 8) | pEnd[0];
+    }
+    else
+    {
+	for ( ;  pData < pEnd;  pData++)
+	    calc ^= *pData;
+	recvd = pEnd[0];
+    }
+
+    if (recvd == calc)
+	return true;
+
+    /* Print Hex Codes of the wrong message */
+    pos = 0;
+    for (i = 0;  i < pType->FrameSize;  i++)
+    {
+	errData[pos++] = ' ';
+	errData[pos++] = HexChar[(w[i] >> 4) & 0x0F];
+	errData[pos++] = HexChar[(w[i]) & 0x0F];
+    }
+    errData[pos] = '\0';
+
+    if (pType->flgCrc)
+	LogError("RFID_Decode(): recv.CRC=0x%04X, calc.CRC=0x%04X,"
+		 " data is%s", recvd, calc, errData);
+    else
+	LogError("RFID_Decode(): recv.XOR=0x%02X, calc.XOR=0x%02X,"
+		 " data is%s", recvd, calc, errData);
+
+    return false;
+}
+
+
+#if RFID_READERS > 1
+/***************************************************************************//**
+ *
+ * @brief	ID has been read by the other Reader
+ *
+ * This routine is called by RFID_Decode() for every valid frame.  If the ID
+ * has been reported last, but by the other reader, the delay between both
+ * readers is logged once, so the direction of a passage can be told from the
+ * log.
+ *
+ ******************************************************************************/
+static void RFID_CrossRead(int rd, TRANSPONDER_ID id, uint32_t timeStamp)
+{
+char	 idStr[ID_STR_SIZE];
+
+    if (l_LastID.Reader == rd  ||  l_LastID.ID != id  ||  l_flgCrossRead)
+	return;
+
+    l_flgCrossRead = true;
+    Log ("Transponder %s read by RFID reader %d after %ldms",
+	 CfgIDToString (id, idStr), rd + 1,
+	 (long)((uint64_t)((timeStamp - l_LastID.TimeStamp) & 0xFFFFFF)
+		* 1000 / RTC_COUNTS_PER_SEC));
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Update the Presence Table
+ *
+ * This routine implements the "Absence Detection".  The entry of the
+ * specified ID in @ref l_Presence gets the current time as last-seen
+ * timestamp, and its read count is incremented.  The entry is moved to the
+ * front of the table, so the least recently seen ID is the last one.  A new
+ * ID is logged as arrival and takes a free entry, or replaces the least
+ * recently seen one, which is reported as departure then.  An ID is treated
+ * as present as long as it has been seen within the last
+ * @ref g_RFID_AbsentDetectTimeout seconds.
+ *
+ * @param[in] id
+ *	Transponder ID that has been received.
+ *
+ * @return
+ *	The value <i>true</i> if the ID is still present and must not be
+ *	reported again, <i>false</i> if it is a new or returning ID, or the
+ *	absence detection is disabled.
+ *
+ ******************************************************************************/
+static bool RFID_PresenceUpdate(TRANSPONDER_ID id)
+{
+time_t	 now = time (NULL);
+bool	 flgPresent = false;
+RFID_PRESENCE entry;
+char	 idStr[ID_STR_SIZE];
+int	 i;
+
+    if (g_RFID_AbsentDetectTimeout == 0)
+	return false;		// absence detection is disabled
+
+    /* Search the ID, or a free entry, the last entry is used if not found */
+    for (i = 0;  i < RFID_PRESENCE_SIZE - 1;  i++)
+    {
+	if (l_Presence[i].ID == id  ||  l_Presence[i].ID == 0)
+	    break;
+    }
+
+    if (l_Presence[i].ID == id)
+    {
+	if (now >= l_Presence[i].LastSeen
+	&&  now - l_Presence[i].LastSeen < (time_t)g_RFID_AbsentDetectTimeout)
+	    flgPresent = true;
+	else
+	    RFID_PresenceDepart (i, "absent");	// not aged yet
+    }
+    else if (l_Presence[i].ID != 0)
+    {
+	RFID_PresenceDepart (i, "replaced");	// table is full
+    }
+
+    if (flgPresent)
+    {
+	entry = l_Presence[i];
+    }
+    else
+    {
+	/* New visit of this transponder */
+	entry.ID = id;
+	entry.FirstSeen = now;
+	entry.ReadCnt = 0;
+
+#ifdef LOGGING
+	LogEvent ("Transponder %s arrived", CfgIDToString (id, idStr));
+#endif
+    }
+    entry.LastSeen = now;
+    entry.ReadCnt++;
+
+    /* Move the entry to the front */
+    for ( ;  i > 0;  i--)
+	l_Presence[i] = l_Presence[i-1];
+
+    l_Presence[0] = entry;
+
+    /* Be sure the presence table is aged */
+    if (l_hdlPresenceTick != NONE  &&  ! flgPresent)
+	sTimerStart (l_hdlPresenceTick, RFID_PRESENCE_TICK);
+
+    return flgPresent;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Transponder departed
+ *
+ * This routine logs the summary of a visit, i.e. the number of reads, and
+ * the time from the first to the last read, and frees the specified entry of
+ * @ref l_Presence.  A single read has no visit time.
+ *
+ * @param[in] idx
+ *	Index of the entry in the presence table.
+ *
+ * @param[in] pReason
+ *	Reason why the transponder is treated as departed.
+ *
+ ******************************************************************************/
+static void RFID_PresenceDepart(int idx, const char *pReason)
+{
+RFID_PRESENCE *pEntry = &l_Presence[idx];
+char	 idStr[ID_STR_SIZE];
+
+#ifdef LOGGING
+    if (pEntry->ReadCnt > 1)
+    {
+	LogEvent ("Transponder %s departed (%s), visit %lds, %lu reads",
+		  CfgIDToString (pEntry->ID, idStr), pReason,
+		  (long)(pEntry->LastSeen - pEntry->FirstSeen),
+		  pEntry->ReadCnt);
+    }
+    else
+    {
+	LogEvent ("Transponder %s departed (%s), 1 read",
+		  CfgIDToString (pEntry->ID, idStr), pReason);
+    }
+#else
+    (void) pReason;
+    (void) idStr;
+#endif
+
+    pEntry->ID = 0;		// mark entry free
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Age the Presence Table
+ *
+ * This routine is called by RFID_Check() every @ref RFID_PRESENCE_TICK
+ * seconds.  All transponders that have not been seen for
+ * @ref g_RFID_AbsentDetectTimeout seconds are reported as departed and
+ * removed from @ref l_Presence.  The timer is restarted as long as there
+ * are present transponders.
+ *
+ ******************************************************************************/
+static void RFID_PresenceAge(void)
+{
+time_t	now = time (NULL);
+int	i, j;
+
+    for (i = j = 0;  i < RFID_PRESENCE_SIZE;  i++)
+    {
+	if (l_Presence[i].ID == 0)
+	    continue;
+
+	/* Clock may have been set back, e.g. by DCF77 */
+	if (now < l_Presence[i].LastSeen)
+	    l_Presence[i].LastSeen = now;
+
+	if (g_RFID_AbsentDetectTimeout == 0
+	||  now - l_Presence[i].LastSeen >= (time_t)g_RFID_AbsentDetectTimeout)
+	{
+	    RFID_PresenceDepart (i, "absent");
+	}
+	else
+	{
+	    /* Still present, keep the order of the entries */
+	    l_Presence[j++] = l_Presence[i];
+	}
+    }
+
+    for (i = j;  i < RFID_PRESENCE_SIZE;  i++)
+	l_Presence[i].ID = 0;
+
+    if (j > 0  &&  l_hdlPresenceTick != NONE)
+	sTimerStart (l_hdlPresenceTick, RFID_PRESENCE_TICK);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Presence Table Tick
+ *
+ * This routine is called from the RTC interrupt handler every
+ * @ref RFID_PRESENCE_TICK seconds while transponders are present.  It
+ * notifies RFID_Check() to age the presence table.
+ *
+ ******************************************************************************/
+static void RFID_PresenceTick(TIM_HDL hdl)
+{
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    l_flgPresenceAge = true;
+    EVENT_POST(EVT_RFID);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get an Entry of the Presence Table
+ *
+ * This routine copies the specified entry of the presence table.  The table
+ * is only changed in the main loop, so it must also be called from there.
+ *
+ * @param[in] idx
+ *	Index of the entry, 0 is the most recently seen ID.
+ *
+ * @param[out] pEntry
+ *	Address of the structure to store the entry.  Its <b>ID</b> is 0 if the
+ *	entry is unused.
+ *
+ * @return
+ *	The value <i>false</i> if <b>idx</b> is beyond @ref RFID_PRESENCE_SIZE.
+ *
+ ******************************************************************************/
+bool	RFID_PresenceGet (int idx, RFID_PRESENCE *pEntry)
+{
+    if (idx < 0  ||  idx >= RFID_PRESENCE_SIZE)
+	return false;
+
+    *pEntry = l_Presence[idx];
+
+    return true;
+}
+
+
+#if CFG_ID_INDEX  &&  CFG_ID_PREFETCH > 0
+/***************************************************************************//**
+ *
+ * @brief	Prefetch the ID Index
+ *
+ * This routine is called by RFID_Check() after a visit has started.  The
+ * most likely IDs are the ones of the presence table, the most recently seen
+ * first, followed by the IDs with the most visits, see VisitStatsTopIDs().
+ * Their records of the ID index are loaded into the sector cache by
+ * CfgPrefetchIDs(), so the lookup of the ID does not have to wait for the
+ * SD-Card.
+ *
+ ******************************************************************************/
+static void RFID_Prefetch(void)
+{
+TRANSPONDER_ID ids[CFG_ID_PREFETCH];
+#if VISIT_STATS
+TRANSPONDER_ID top[CFG_ID_PREFETCH];
+int	m, j;
+#endif
+int	i, n = 0;
+
+    for (i = 0;  i < RFID_PRESENCE_SIZE  &&  n < CFG_ID_PREFETCH;  i++)
+    {
+	if (l_Presence[i].ID != 0)
+	    ids[n++] = l_Presence[i].ID;
+    }
+
+#if VISIT_STATS
+    m = VisitStatsTopIDs (top, CFG_ID_PREFETCH);
+    for (i = 0;  i < m  &&  n < CFG_ID_PREFETCH;  i++)
+    {
+	for (j = 0;  j < n  &&  ids[j] != top[i];  j++)
+	    ;
+	if (j == n)
+	    ids[n++] = top[i];	// not in the presence table
+    }
+#endif
+
+    if (n > 0)
+	CfgPrefetchIDs (ids, n);
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Edge on the Rx Pin
+ *
+ * This handler is called by the EXTI interrupt service routine for an edge
+ * on the USART Rx pin.  The EXTI is only enabled after the reader has been
+ * powered on.  The first start bit, i.e. falling edge, marks the reader ready
+ * and disables the EXTI again, so the following data bits do not cause any
+ * further interrupts.
+ *
+ * @param[in] extiNum
+ *	EXTernal Interrupt number, this is @ref RFID_RX_EXTI_NUM.
+ *
+ * @param[in] extiLvl
+ *	EXTernal Interrupt level: 0 means falling edge.
+ *
+ * @param[in] timeStamp
+ *	Time stamp when the event has been received, 0 for a "replay".
+ *
+ ******************************************************************************/
+void	RFID_RxEdge (int extiNum, bool extiLvl, uint32_t timeStamp)
+{
+    if (timeStamp != 0  &&  ! extiLvl  &&  l_flgReadyWait)
+	RFID_Ready (timeStamp, true);
+
+    if (! l_flgReadyWait)
+	ExtIntDisable (extiNum);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Reader is ready
+ *
+ * This routine is called for the first activity of the reader after it has
+ * been powered on.  The duration since power-on is accounted in
+ * @ref l_ReadyStat.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value of the activity.
+ *
+ * @param[in] flgEdge
+ *	True if detected by an edge on the Rx pin, false for a valid frame.
+ *
+ ******************************************************************************/
+static void RFID_Ready(uint32_t timeStamp, bool flgEdge)
+{
+uint32_t ms;
+int	 i;
+
+    INT_Disable();
+
+    if (l_flgReadyWait)
+    {
+	l_flgReadyWait = false;
+	ExtIntDisable (RFID_RX_EXTI_NUM);
+
+	ms = ((timeStamp - l_PwrOnTime) & 0xFFFFFF) * 1000 / RTC_COUNTS_PER_SEC;
+	if (ms >= RFID_READY_MAX)
+	{
+	    l_ReadyStat.NoneCnt++;	// activity came too late
+	}
+	else
+	{
+	    if (l_ReadyStat.Cnt == 0  ||  ms < l_ReadyStat.Min)
+		l_ReadyStat.Min = ms;
+	    if (ms > l_ReadyStat.Max)
+		l_ReadyStat.Max = ms;
+	    l_ReadyStat.Sum += ms;
+	    l_ReadyStat.Cnt++;
+	    if (flgEdge)
+		l_ReadyStat.EdgeCnt++;
+
+	    for (i = 0;  i < RFID_READY_BINS - 1;  i++)
+		if (ms < l_ReadyBinLimit[i])
+		    break;
+	    l_ReadyStat.Hist[i]++;
+	}
+    }
+
+    INT_Enable();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Readiness Statistics
+ *
+ * This routine generates a line with the number of power-ups, the minimum,
+ * average, and maximum duration in [ms] until the reader showed the first
+ * activity, and the histogram.  Power-ups without activity within
+ * @ref RFID_READY_MAX are counted as "none".
+ *
+ * @param[in] flgLog
+ *	If true, the summary is logged and the statistics are reset.  If false,
+ *	it is only shown on the debug console.
+ *
+ ******************************************************************************/
+void	RFID_ReadyReport (bool flgLog)
+{
+char	 line[140];
+int	 len;
+RFID_READY_STAT stat;
+int	 i;
+
+    INT_Disable();
+    stat = l_ReadyStat;
+    if (flgLog)
+	memset ((void *)&l_ReadyStat, 0, sizeof(l_ReadyStat));
+    INT_Enable();
+
+    len = StrFormat (line, "RFID ready n=%d edge=%d none=%d"
+		     " min=%d avg=%ld max=%dms", stat.Cnt, stat.EdgeCnt,
+		     stat.NoneCnt, stat.Min, stat.Cnt ? stat.Sum / stat.Cnt : 0,
+		     stat.Max);
+
+    for (i = 0;  i < RFID_READY_BINS;  i++)
+    {
+	if (i < RFID_READY_BINS - 1)
+	    len += StrFormat (line + len, " <%d:%d", l_ReadyBinLimit[i],
+			      stat.Hist[i]);
+	else
+	    len += StrFormat (line + len, " >=%d:%d", l_ReadyBinLimit[i-1],
+			      stat.Hist[i]);
+    }
+
+    if (flgLog)
+    {
+	Log (line);
+    }
+    else
+    {
+	drvLEUART_puts (line);
+	drvLEUART_puts ("\n");
     }
 }
 
@@ -725,76 +2015,363 @@ static USART_InitAsync_TypeDef uartInit = USART_INITASYNC_DEFAULT;
 /******************************************************************************
 * @brief  uartSetup function
 *
+* This routine initializes the USART or LEUART of the specified reader and
+* its DMA channel.  The DMA configuration is copied into the controller, so
+* it lives on the stack.
+*
 ******************************************************************************/
-static void uartSetup(void)
+static void uartSetup(int rd)
 {
-int	type = l_pRFID_Cfg.RFID_Type;
+const USART_Parms *pParms = &l_USART_Parms[rd];
+const RFID_TYPE_PARMS *pType = &l_RFID_Type_Parms[l_Reader[rd].Cfg.RFID_Type];
+unsigned int chan = pParms->DMA_Chan_Rx;
 
-  /* Enable clock for USART module */
-  CMU_ClockEnable(l_USART_Parms.cmuClock_UART, true);
+/* Setting up DMA channel for Rx */
+DMA_CfgChannel_TypeDef chnlCfgRx =
+{
+    .highPri   = false,			// Normal priority
+    .enableInt = true,			// Interrupt for callback function
+    .select    = pParms->DMA_Req_Rx,
+    .cb        = NULL,			// Callback is set by DmaChanConfig()
+};
+
+/* Setting up channel descriptor for Rx, same for primary and alternate */
+DMA_CfgDescr_TypeDef descrCfgRx =
+{
+    .dstInc  = dmaDataInc2,		// Increment destination by one halfword
+    .srcInc  = dmaDataIncNone,		// Do not increment source address
+    .size    = dmaDataSize2,		// RXDATAX is a halfword
+    .arbRate = dmaArbitrate1,		// Rearbitrate for each byte received
+    .hprot   = 0,			// No read/write source protection
+};
+
+  /* Enable clock for UART module */
+  ClockAcquire (CLK_OWN_RFID, pParms->cmuClock_UART);
 
   /* Configure GPIO Rx pin */
-  GPIO_PinModeSet(l_USART_Parms.UART_Rx_Port,
-		  l_USART_Parms.UART_Rx_Pin, gpioModeInput, 0);
-
-  /* Prepare struct for initializing UART in asynchronous mode */
-  uartInit.enable       = usartDisable;   // Don't enable UART upon initialization
-  uartInit.refFreq      = 0;              // Set to 0 to use reference frequency
-  uartInit.baudrate     = l_RFID_Type_Parms[type].Baudrate;
-  uartInit.oversampling = usartOVS16;     // Oversampling. Range is 4x, 6x, 8x or 16x
-  uartInit.databits     = l_RFID_Type_Parms[type].DataBits;
-  uartInit.parity       = l_RFID_Type_Parms[type].Parity;
-  uartInit.stopbits     = l_RFID_Type_Parms[type].StopBits;
+  GPIO_PinModeSet(pParms->UART_Rx_Port,
+		  pParms->UART_Rx_Pin, gpioModeInput, 0);
+
+  if (pParms->UART != NULL)
+  {
+    /* Prepare struct for initializing UART in asynchronous mode */
+    uartInit.enable       = usartDisable;   // Don't enable UART upon initialization
+    uartInit.refFreq      = 0;              // Set to 0 to use reference frequency
+    uartInit.baudrate     = pType->Baudrate;
+    uartInit.oversampling = usartOVS16;     // Oversampling. Range is 4x, 6x, 8x or 16x
+    uartInit.databits     = pType->DataBits;
+    uartInit.parity       = pType->Parity;
+    uartInit.stopbits     = pType->StopBits;
 #if defined( USART_INPUT_RXPRS ) && defined( USART_CTRL_MVDIS )
-  uartInit.mvdis        = false;          // Disable majority voting
-  uartInit.prsRxEnable  = false;          // Enable USART Rx via Peripheral Reflex System
-  uartInit.prsRxCh      = usartPrsRxCh0;  // Select PRS channel if enabled
+    uartInit.mvdis        = false;          // Disable majority voting
+    uartInit.prsRxEnable  = false;          // Enable USART Rx via Peripheral Reflex System
+    uartInit.prsRxCh      = usartPrsRxCh0;  // Select PRS channel if enabled
 #endif
 
-  /* Initialize USART with uartInit struct */
-  USART_InitAsync(l_USART_Parms.UART, &uartInit);
+    /* Initialize USART with uartInit struct */
+    USART_InitAsync(pParms->UART, &uartInit);
+
+    /* No UART Rx interrupts, data is fetched by the DMA */
+    USART_IntClear(pParms->UART, _USART_IF_MASK);
+  }
+  else
+  {
+    /* Setup LEUART for the second reader, only needed by LEUART_Init() */
+    LEUART_Init_TypeDef leuartInit = LEUART_INIT_DEFAULT;
+
+    /* The LEUART is clocked by the LFXO, 8 data bits and 1 stop bit */
+    leuartInit.enable   = leuartDisable;
+    leuartInit.refFreq  = 0;
+    leuartInit.baudrate = pType->Baudrate;
+    leuartInit.databits = leuartDatabits8;
+    leuartInit.parity   = (pType->Parity == usartEvenParity ? leuartEvenParity
+			 : pType->Parity == usartOddParity  ? leuartOddParity
+			 : leuartNoParity);
+    leuartInit.stopbits = leuartStopbits1;
+
+    LEUART_Init(pParms->LEUART, &leuartInit);
+
+    /* No LEUART Rx interrupts, data is fetched by the DMA */
+    LEUART_IntClear(pParms->LEUART, _LEUART_IF_MASK);
+  }
+
+  /* Prepare DMA channel, the DMA controller is already initialized */
+  DmaChanConfig(chan, (rd == 0 ? "RFID Rx" : "RFID2 Rx"), &chnlCfgRx,
+		RFID_RxDone, &l_Reader[rd]);
+  DMA_CfgDescr(chan, true,  &descrCfgRx);
+  DMA_CfgDescr(chan, false, &descrCfgRx);
+
+  /* Receive one frame into each buffer, alternating between them */
+  l_RxRingGet = l_RxRingPut;
+  RFID_RxStart(rd);
+
+  if (pParms->UART != NULL)
+  {
+    /* Enable I/O pins at UART location */
+    pParms->UART->ROUTE = USART_ROUTE_RXPEN | pParms->UART_Route;
+
+    /* Enable UART receiver only */
+    USART_Enable(pParms->UART, usartEnableRx);
+  }
+  else
+  {
+    pParms->LEUART->ROUTE = LEUART_ROUTE_RXPEN | pParms->UART_Route;
+
+    /* Make sure the LEUART wakes up the DMA on RX data */
+    pParms->LEUART->CTRL |= LEUART_CTRL_RXDMAWU;
+    LEUART_Enable(pParms->LEUART, leuartEnableRx);
+  }
+}
 
-  /* Prepare UART Rx interrupts */
-  USART_IntClear(l_USART_Parms.UART, _USART_IF_MASK);
-  USART_IntEnable(l_USART_Parms.UART, USART_IF_RXDATAV);
-  NVIC_SetPriority(l_USART_Parms.UART_Rx_IRQn, INT_PRIO_UART);
-  NVIC_ClearPendingIRQ(l_USART_Parms.UART_Rx_IRQn);
-  NVIC_EnableIRQ(l_USART_Parms.UART_Rx_IRQn);
 
-  /* Enable I/O pins at UART location #2 */
-  l_USART_Parms.UART->ROUTE = USART_ROUTE_RXPEN | l_USART_Parms.UART_Route;
+/**************************************************************************//**
+ *
+ * @brief DMA Callback function for RFID Rx
+ *
+ * This routine is called from the DMA interrupt handler whenever one of the
+ * ping-pong buffers has been filled with a frame's worth of data from the
+ * RFID reader.  The descriptor is re-armed at once, while the DMA already
+ * continues with the other buffer.  The frame is copied into @ref l_RxRing,
+ * and decoded later by RFID_Check() in the main loop, so the buffer may be
+ * re-used by the DMA immediately.  Parameter <b>user</b> points to the
+ * @ref RFID_READER.
+ *
+ * NOTE:
+ * The frame boundaries do not need to match the buffer boundaries, since
+ * RFID_Decode() processes the data as a continuous stream.  The gap timer
+ * re-aligns them after a pause, see RFID_RxGap().
+ *
+ *****************************************************************************/
+static void RFID_RxDone(unsigned int channel, bool primary, void *user)
+{
+RFID_READER *pRd = (RFID_READER *)user;
+uint16_t *pBuf = pRd->RxDMA_Buf[primary ? 0 : 1];
+int	  cnt  = l_RFID_Type_Parms[pRd->Cfg.RFID_Type].FrameSize;
+
+    DEBUG_TRACE(0x07);
+    ISR_PROF_ENTER();
+
+    /* Re-activate the descriptor which just has been completed */
+    DMA_RefreshPingPong(channel, primary, false, NULL, NULL, cnt - 1, false);
+    pRd->flgRxPrimary = ! primary;
+
+    /* Pass the frame to RFID_Check() */
+    RFID_RxPush (pRd - l_Reader, pBuf, cnt);
+
+    /* (Re-)start the gap timeout */
+    if (pRd->hdlRxGap != NONE)
+	msTimerStart (pRd->hdlRxGap, RFID_RX_GAP_TIMEOUT);
+
+    EVENT_POST(EVT_RFID);
 
-  /* Enable UART receiver only */
-  USART_Enable(l_USART_Parms.UART, usartEnableRx);
+    ISR_PROF_EXIT(ISR_PROF_RFID_RX);
+    DEBUG_TRACE(0x87);
 }
 
 
 /**************************************************************************//**
  *
- * @brief UART 1 RX IRQ Handler
+ * @brief Start the DMA for RFID Rx
  *
- * This interrupt service routine is called whenever a byte has been received
- * from the RFID reader associated with UART 1.  It calls RFID_Decode() to
- * extract a valid ID from the data stream.
+ * This routine activates the DMA channel of the specified reader in
+ * ping-pong mode, starting with the primary buffer.  Each buffer receives
+ * one frame.
  *
- * NOTE:
- * Since both UARTs use the same interrupt priority, no interference is
- * possible between the two UARTs.
+ *****************************************************************************/
+static void RFID_RxStart(int rd)
+{
+RFID_READER *pRd = &l_Reader[rd];
+const USART_Parms *pParms = &l_USART_Parms[rd];
+int	cnt = l_RFID_Type_Parms[pRd->Cfg.RFID_Type].FrameSize;
+void   *pSrc;
+
+  pSrc = (pParms->UART != NULL ? (void *) &pParms->UART->RXDATAX
+			       : (void *) &pParms->LEUART->RXDATAX);
+
+  pRd->flgRxPrimary = true;
+  DMA_ActivatePingPong(pParms->DMA_Chan_Rx,
+		       false,				// No DMA burst
+		       (void *) pRd->RxDMA_Buf[0],	// Primary destination
+		       pSrc,				// Source
+		       cnt - 1,
+		       (void *) pRd->RxDMA_Buf[1],	// Alternate destination
+		       pSrc,				// Source
+		       cnt - 1);
+}
+
+
+/**************************************************************************//**
+ *
+ * @brief Put received Data into the Ring Buffer
+ *
+ * This routine copies <b>cnt</b> words of received data into the next entry
+ * of @ref l_RxRing, together with the index of the reader and the current
+ * RTC counter.  The frames of all readers share the ring, so they are
+ * decoded in the order of their reception.  If the ring is full, the data
+ * is discarded and counted in @ref l_RxRingOverrun.  It is called in
+ * interrupt context.
  *
  *****************************************************************************/
-void USART1_RX_IRQHandler(void)
+static void RFID_RxPush(int rd, const uint16_t *pData, int cnt)
 {
-    DEBUG_TRACE(0x07);
+RFID_RX_FRAME *pFrame;
+
+    l_flgRxActivity = true;	// the reader is not silent
+    l_flgDutyRx = true;
 
-    /* Check for RX data valid interrupt */
-    if (USART1->STATUS & USART_STATUS_RXDATAV)
+    if ((uint8_t)(l_RxRingPut - l_RxRingGet) >= RFID_RX_RING_FRAMES)
     {
-	/* Decode data */
-	RFID_Decode (USART1->RXDATA);
+	l_RxRingOverrun++;
+	return;
+    }
+
+    pFrame = &l_RxRing[l_RxRingPut % RFID_RX_RING_FRAMES];
+    memcpy (pFrame->Data, pData, cnt * sizeof(pFrame->Data[0]));
+    pFrame->Len = cnt;
+    pFrame->Reader = rd;
+    pFrame->TimeStamp = RTC->CNT;
+    l_RxRingPut++;
+}
 
-	/* Clear RXDATAV interrupt */
-	USART_IntClear(USART1, USART_IF_RXDATAV);
+
+/***************************************************************************//**
+ *
+ * @brief	Post a new Transponder ID
+ *
+ * This routine puts a new transponder ID into @ref l_IdQueue, it is passed
+ * to ControlUpdateID() by RFID_Check() in the main loop.  If the queue is
+ * full, the ID is discarded and counted in @ref l_IdQueueOverrun.  It may be
+ * called from interrupt context.
+ *
+ * @param[in] id
+ *	New transponder ID.
+ *
+ * @param[in] rd
+ *	Index of the reader which has read the ID, NONE for the timeout.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value when the ID has been received.
+ *
+ ******************************************************************************/
+static void RFID_IdPost(TRANSPONDER_ID id, int rd, uint32_t timeStamp)
+{
+RFID_DETECTION *pDet;
+
+    INT_Disable();
+
+    if ((uint8_t)(l_IdQueuePut - l_IdQueueGet) >= RFID_ID_QUEUE_SIZE)
+    {
+	l_IdQueueOverrun++;
+    }
+    else
+    {
+	pDet = &l_IdQueue[l_IdQueuePut % RFID_ID_QUEUE_SIZE];
+	pDet->ID = id;
+	pDet->TimeStamp = timeStamp;
+	pDet->Reader = rd;
+	l_IdQueuePut++;
+	ITM_TRACE_QUEUE(ITM_QUE_RFID, (uint8_t)(l_IdQueuePut - l_IdQueueGet));
     }
 
-    DEBUG_TRACE(0x87);
+    INT_Enable();
+}
+
+
+/**************************************************************************//**
+ *
+ * @brief Receive Gap Timeout
+ *
+ * This routine is called by the msTimer @ref RFID_RX_GAP_TIMEOUT of a reader
+ * after its last complete frame, when no further frame followed.  If the
+ * active DMA buffer contains the first bytes of a frame, they are passed to
+ * the decoder, and the DMA is restarted, so the next frame is aligned to the
+ * buffer again.  The EFM32G USART has no idle-line detection, therefore the
+ * timer is used for this purpose.  After power-on, the timer of the first
+ * reader is started with @ref RFID_READY_MAX, so RFID_Check() notices a
+ * reader without activity.
+ *
+ *****************************************************************************/
+static void RFID_RxGap(TIM_HDL hdl)
+{
+DMA_DESCRIPTOR_TypeDef *pDescr;
+RFID_READER *pRd;
+unsigned int chan;
+int	cnt, recvd, rd;
+
+    for (rd = 0;  rd < RFID_READERS - 1;  rd++)
+	if (l_Reader[rd].hdlRxGap == hdl)
+	    break;
+
+    pRd  = &l_Reader[rd];
+    chan = l_USART_Parms[rd].DMA_Chan_Rx;
+    cnt  = l_RFID_Type_Parms[pRd->Cfg.RFID_Type].FrameSize;
+
+    INT_Disable();
+
+    /* Get the number of bytes received into the active buffer */
+    pDescr = (pRd->flgRxPrimary
+	      ? (DMA_DESCRIPTOR_TypeDef *)(uintptr_t)DMA->CTRLBASE
+	      : (DMA_DESCRIPTOR_TypeDef *)(uintptr_t)DMA->ALTCTRLBASE)
+	   + chan;
+    recvd = cnt - 1 - (int)((pDescr->CTRL & _DMA_CTRL_N_MINUS_1_MASK)
+			    >> _DMA_CTRL_N_MINUS_1_SHIFT);
+
+    if (recvd > 0  &&  recvd < cnt)
+    {
+	/* Stop the DMA, pass the data, and start anew */
+	DMA->CHENC = (1 << chan);
+	RFID_RxPush (rd, pRd->RxDMA_Buf[pRd->flgRxPrimary ? 0 : 1], recvd);
+	RFID_RxStart(rd);
+    }
+
+    INT_Enable();
+
+    /* Process the data, or check the readiness timeout */
+    EVENT_POST(EVT_RFID);
+}
+
+
+#ifdef BENCH
+/**************************************************************************//**
+ *
+ * @brief Decode a Buffer for the Micro-Benchmark
+ *
+ * This routine passes the bytes to RFID_Decode(), in the same way as
+ * RFID_Check() does for the received frames of the first reader, which is
+ * temporarily set to the specified type.  The transponder IDs which have
+ * been posted are counted and discarded, so the benchmark does not trigger
+ * the control module, see bench.c.
+ *
+ * @param[in] type
+ *	Reader type of the frames.
+ *
+ * @param[in] pData
+ *	Bytes to be decoded, i.e. frames of this reader type.
+ *
+ * @param[in] cnt
+ *	Number of bytes.
+ *
+ * @return
+ *	Number of transponder IDs which have been posted.
+ *
+ *****************************************************************************/
+int RFID_BenchDecode(RFID_TYPE type, const uint8_t *pData, int cnt)
+{
+RFID_TYPE cfgType = l_Reader[0].Cfg.RFID_Type;
+int	i, ids;
+
+    l_Reader[0].Cfg.RFID_Type = type;
+
+    for (i = 0;  i < cnt;  i++)
+	RFID_Decode (0, pData[i], RTC->CNT);
+
+    l_Reader[0].Cfg.RFID_Type = cfgType;
+
+    INT_Disable();
+    ids = (uint8_t)(l_IdQueuePut - l_IdQueueGet);
+    l_IdQueueGet = l_IdQueuePut;
+    INT_Enable();
+
+    return ids;
 }
+#endif
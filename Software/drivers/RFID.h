@@ -2,9 +2,25 @@
  * @file
  * @brief	Header file of module RFID.c
  * @author	Ralf Gerhauser / Peter Loes
- * @version	2020-07-27
+ * @version	2026-10-15
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Added RFID_EM2_RX, RFID_RX_EXTI_NUM depends on it.
+2026-10-15,agnt	Added prototype for RFID_ClockChange().
+2026-10-15,agnt	RFID_BenchDecode() takes the reader type, returns the IDs.
+2026-10-15,agnt	Added RFID_READERS, g_RFID2_Type, and g_RFID2_Power.
+2026-10-15,agnt	Added g_RFID_DutyOn, g_RFID_DutyPeriod, and RFID_LB_Edge().
+2026-10-15,agnt	Added g_RFID_EarlyOff and DFLT_RFID_EARLY_OFF.
+2026-10-15,agnt	Added prototype for RFID_PowerFailResume().
+2026-10-14,agnt	Added prototype for RFID_BenchDecode().
+2026-10-14,agnt	Moved RFID_PRESENCE here, added RFID_PresenceGet().
+2026-10-14,agnt	Added RFID_ID_QUEUE_SIZE.
+2026-10-14,agnt	Added RFID_LB_POWER, RFID_READY_MAX, RFID_RX_EXTI_MASK, and the
+		prototypes for RFID_RxEdge(), RFID_LB_Idle(), RFID_ReadyReport().
+2026-10-14,agnt	Added RFID_RX_RING_FRAMES and RFID_RX_GAP_TIMEOUT.
+		Added RFID_PRESENCE_SIZE, RFID_PRESENCE_TICK, and
+		DFLT_RFID_ABSENT_TIMEOUT.
+2026-10-14,agnt	g_Transponder is of type TRANSPONDER_ID now.
 2018-03-26,rage - RFID_TRIGGERED_BY_LIGHT_BARRIER lets you select whether the
 		- RFID reader is controlled by light-barriers or alarm times.
                 - Added prototypes for IsRFID_Active() and IsRFID_Enabled().
@@ -21,6 +37,7 @@ Revision History:
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <time.h>
 #include "em_device.h"
 #include "config.h"		// include project configuration parameters
 #include "Control.h"
@@ -33,6 +50,99 @@ Revision History:
     #define DFLT_RFID_DETECT_TIMEOUT		10
 #endif
 
+    /*!@brief Number of received frames which can be buffered until they are
+     * decoded by RFID_Check().
+     */
+#ifndef RFID_RX_RING_FRAMES
+    #define RFID_RX_RING_FRAMES		4
+#endif
+
+    /*!@brief Number of new transponder IDs which can be queued until they
+     * are passed to ControlUpdateID() by RFID_Check().
+     */
+#ifndef RFID_ID_QUEUE_SIZE
+    #define RFID_ID_QUEUE_SIZE		4
+#endif
+
+    /*!@brief Gap in [ms] after the last complete frame, after which the bytes
+     * of an incomplete frame are passed to the decoder and the DMA starts
+     * anew, i.e. aligned to the next frame.  Use 0 to disable this.
+     */
+#ifndef RFID_RX_GAP_TIMEOUT
+    #define RFID_RX_GAP_TIMEOUT		50
+#endif
+
+    /*!@brief Number of entries in the presence table, i.e. transponders that
+     * may be present at the same time, see @ref g_RFID_AbsentDetectTimeout.
+     */
+#ifndef RFID_PRESENCE_SIZE
+    #define RFID_PRESENCE_SIZE		4
+#endif
+
+    /*!@brief Default duration in [ms] without any data from the reader after
+     * the light barrier filter has expired, after which the detect window
+     * ends early, see @ref g_RFID_EarlyOff.  0 disables this.
+     */
+#ifndef DFLT_RFID_EARLY_OFF
+    #define DFLT_RFID_EARLY_OFF		0
+#endif
+
+    /*!@brief Interval in [s] to age the presence table. */
+#ifndef RFID_PRESENCE_TICK
+    #define RFID_PRESENCE_TICK		5
+#endif
+
+    /*!@brief Default duration in [s] a transponder must be absent, before it
+     * is reported again (0 disables the absence detection).
+     */
+#ifndef DFLT_RFID_ABSENT_TIMEOUT
+    #define DFLT_RFID_ABSENT_TIMEOUT	0
+#endif
+
+    /*!@brief Set 1 to power the RFID reader only while the light barriers are
+     * active.  The first LB edge powers the reader on (pre-warming), it is
+     * powered off again after LB_FILTER_DURATION.  If 0, the reader stays
+     * powered during the whole ON_TIME interval.
+     */
+#ifndef RFID_LB_POWER
+    #define RFID_LB_POWER		0
+#endif
+
+    /*!@brief Maximum duration in [ms] after power-on, the first activity of
+     * the reader is accounted for the readiness histogram.
+     */
+#ifndef RFID_READY_MAX
+    #define RFID_READY_MAX		10000
+#endif
+
+    /*!@brief Number of RFID readers.  The first one is connected to USART1,
+     * the second one to LEUART1 (Rx at PC7), see RFID2_TYPE and RFID2_POWER.
+     * Since the LEUART is clocked by the LFXO, the second reader must be a
+     * Short Range reader (9600 baud).
+     */
+#ifndef RFID_READERS
+    #define RFID_READERS		1
+#endif
+
+    /*!@brief Set 1 to connect the (only) reader to LEUART1 (Rx at PC7)
+     * instead of USART1.  The LEUART is clocked by the LFXO and wakes up the
+     * DMA on received data, so the MCU may stay in EM2 while the reader is
+     * streaming frames.  This requires RFID_READERS to be 1, a time source
+     * other than GPS, and a Short Range reader (9600 baud).
+     */
+#ifndef RFID_EM2_RX
+    #define RFID_EM2_RX		0
+#endif
+
+    /*!@brief EXTI of the Rx pin (PC1, or PC7 for RFID_EM2_RX) to detect
+     * reader activity. */
+#if RFID_EM2_RX
+    #define RFID_RX_EXTI_NUM	7
+#else
+    #define RFID_RX_EXTI_NUM	1
+#endif
+#define RFID_RX_EXTI_MASK	(1 << RFID_RX_EXTI_NUM)
+
 
     /*!@brief RFID types. */
 typedef enum
@@ -50,15 +160,30 @@ typedef struct
     PWR_OUT		RFID_PwrOut;		//!< Power output selection
 } RFID_CONFIG;
 
+/*!@brief Entry of the presence table, see RFID_PresenceGet(). */
+typedef struct
+{
+    TRANSPONDER_ID	ID;		//!< Transponder ID, 0 if entry is unused
+    time_t		FirstSeen;	//!< Time of arrival
+    time_t		LastSeen;	//!< Time when the ID has been read last
+    uint32_t		ReadCnt;	//!< Number of reads during this visit
+} RFID_PRESENCE;
+
 /*================================ Global Data ===============================*/
 
 extern int32_t	 g_RFID_DetectTimeout;
 
 extern RFID_TYPE g_RFID_Type;
 extern PWR_OUT	 g_RFID_Power;
+#if RFID_READERS > 1
+extern RFID_TYPE g_RFID2_Type;
+extern PWR_OUT	 g_RFID2_Power;
+#endif
 extern uint32_t	 g_RFID_AbsentDetectTimeout;
+extern int32_t	 g_RFID_EarlyOff;
+extern int32_t	 g_RFID_DutyOn, g_RFID_DutyPeriod;
 extern const char *g_enum_RFID_Type[];
-extern char	 g_Transponder[18];
+extern TRANSPONDER_ID g_Transponder;
 
 /*================================ Prototypes ================================*/
 
@@ -83,8 +208,31 @@ void	RFID_Check (void);
     /* Power RFID reader Off */
 void	RFID_PowerOff (void);
 
-    /* RFID Power Fail Handler */
+    /* RFID Power Fail Handler and fast resume */
 void	RFID_PowerFailHandler (void);
+void	RFID_PowerFailResume (void);
+
+    /* HF clock has been switched, recalculate the baud rate */
+void	RFID_ClockChange (void);
+
+    /* Edge on the USART Rx pin, marks the reader ready */
+void	RFID_RxEdge (int extiNum, bool extiLvl, uint32_t timeStamp);
+
+    /* Light barriers are idle, power-off reader if RFID_LB_POWER */
+void	RFID_LB_Idle (void);
+
+    /* A light barrier changed its state, end the duty cycling */
+void	RFID_LB_Edge (void);
+
+    /* Report the readiness statistics */
+void	RFID_ReadyReport (bool flgLog);
+    /* Get an entry of the presence table */
+bool	RFID_PresenceGet (int idx, RFID_PRESENCE *pEntry);
+
+#ifdef BENCH
+    /* Decode a buffer for the micro-benchmark, see bench.c */
+int	RFID_BenchDecode (RFID_TYPE type, const uint8_t *pData, int cnt);
+#endif
 
 
 #endif /* __INC_RFID_h */
@@ -0,0 +1,268 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Record Sequence
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module allocates the file names for the recordings of the Audio
+ * module.  The firmware owns a monotonic sequence counter, so the name of
+ * the next record file is known at once, without asking the Audio module for
+ * the number of files on its storage device.  The counter is kept in two
+ * flash pages, which are defined by the linker script as <b>RECSEQ</b>.
+ * Every allocation programs the new counter value into the next erased word,
+ * the upper half of the word is the inverted counter, so words which do not
+ * contain a counter, e.g. old program code, are ignored.
+ * If a page is full, the other page is erased and used, so the last value
+ * is never lost by an interrupted erase.  RecordSeqInit() takes the highest
+ * value of both pages.
+ *
+ * The name of a record file consists of 'R' and three characters, the
+ * configuration variable RECORD_NAMING selects the scheme, see
+ * @ref RECORD_NAMING:
+ * - SEQUENCE: R001 to R999, then R001 again.
+ * - HOUR: R and the hour of the day, followed by a number 0 to 9 within
+ *   this hour, e.g. R143 is the 4th record between 14:00 and 14:59.
+ * - DAY: R and the day of the month, followed by a number 0 to 9 within
+ *   this day, e.g. R070 is the first record on the 7th.
+ *
+ * With HOUR and DAY, the names repeat every day or month, and the number
+ * within a period restarts after a reset.  The sequence counter is advanced
+ * in any case.
+ *
+ * If the flash does not contain a counter yet, RecordSeqSeed() is called
+ * with the number of records that already exist on the card.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Use StrFormat() instead of sprintf().
+2026-10-14,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <time.h>
+#include "em_msc.h"
+#include "RecordSeq.h"
+#include "Logging.h"
+#include "StrFormat.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Number of counter words per flash page. */
+#define REC_SEQ_WORDS		(FLASH_PAGE_SIZE / 4)
+
+    /*!@brief Value of an erased flash word. */
+#define REC_SEQ_ERASED		0xFFFFFFFFUL
+
+    /*!@brief Flash word of a 16bit counter value, and its validity check. */
+#define REC_SEQ_WORD(v)		((~(uint32_t)(v) << 16) | ((v) & 0xFFFF))
+#define REC_SEQ_VALID(w)	(((w) >> 16) == (~(w) & 0xFFFF))
+
+/*========================= Global Data and Routines =========================*/
+
+    /*!@brief Naming scheme of the record files. */
+RECORD_NAMING g_RecordNaming = REC_NAME_SEQUENCE;
+
+    /*!@brief Enum names for @ref g_RecordNaming. */
+const char *g_enum_RecordNaming[] = { "SEQUENCE", "HOUR", "DAY", NULL };
+
+/*================================ Local Data ================================*/
+
+    /* Flash area of the sequence counter, defined by the linker script */
+extern uint32_t	__RecSeqStart[], __RecSeqEnd[];
+
+    /*! Current value of the sequence counter, i.e. the number of records. */
+static uint32_t	l_RecSeq;
+
+    /*! Address of the word which holds @ref l_RecSeq, NULL if none. */
+static uint32_t	*l_pRecSeq;
+
+    /*! Period (hour or day) and number of records in this period. */
+static int	l_PeriodKey = -1;
+static int	l_PeriodCnt;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	RecordSeqWrite (uint32_t value);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Record Sequence
+ *
+ * This routine searches both flash pages for the highest counter value.
+ * It is called by AudioInit().
+ *
+ ******************************************************************************/
+void	RecordSeqInit (void)
+{
+uint32_t *pWord;
+
+    l_pRecSeq = NULL;
+    l_RecSeq  = 0;
+
+    for (pWord = __RecSeqStart;  pWord < __RecSeqEnd;  pWord++)
+    {
+	if (REC_SEQ_VALID(*pWord)  &&  (l_pRecSeq == NULL
+					||  (*pWord & 0xFFFF) > l_RecSeq))
+	{
+	    l_RecSeq  = *pWord & 0xFFFF;
+	    l_pRecSeq = pWord;
+	}
+    }
+
+#ifdef LOGGING
+    if (l_pRecSeq != NULL)
+	Log ("Record Sequence: %ld records, naming scheme %s", l_RecSeq,
+	     g_enum_RecordNaming[g_RecordNaming]);
+    else
+	Log ("Record Sequence: No counter in flash yet");
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if the Record Sequence is valid
+ *
+ * @return
+ *	The value <i>true</i> if the flash contains a sequence counter, i.e. the
+ *	number of files on the storage device is not required any more.
+ *
+ ******************************************************************************/
+bool	RecordSeqIsValid (void)
+{
+    return (l_pRecSeq != NULL);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Seed the Record Sequence
+ *
+ * This routine is called with the number of records on the storage device,
+ * as long as the flash does not contain a counter, so the sequence continues
+ * with the records of former firmware versions.
+ *
+ * @param[in] recordCnt
+ *	Number of existing record files.
+ *
+ ******************************************************************************/
+void	RecordSeqSeed (int recordCnt)
+{
+    if (l_pRecSeq != NULL)
+	return;			// sequence is owned by the firmware
+
+    if (recordCnt < 0)
+	recordCnt = 0;
+
+    RecordSeqWrite (recordCnt);
+
+#ifdef LOGGING
+    Log ("Record Sequence: Starting after %d existing records", recordCnt);
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Allocate the next Record File
+ *
+ * This routine advances the sequence counter, programs it into the flash,
+ * and builds the three characters of the file name, which follow the 'R',
+ * according to @ref g_RecordNaming.
+ *
+ * @param[out] pName
+ *	Buffer of 4 bytes for the characters and the terminating EOS.
+ *
+ * @return
+ *	The sequence number of the record file, 1 to @ref RECORD_SEQ_MAX.
+ *
+ ******************************************************************************/
+int	RecordSeqNext (char *pName)
+{
+time_t	 t;
+struct tm *pTime;
+int	 num, key;
+
+    RecordSeqWrite (l_RecSeq + 1);
+
+    num = (int)((l_RecSeq - 1) % RECORD_SEQ_MAX) + 1;
+    if (num == 1  &&  l_RecSeq > 1)
+	LOG_WARN ("Record Sequence: Wrapped around to R001");
+
+    if (g_RecordNaming == REC_NAME_HOUR  ||  g_RecordNaming == REC_NAME_DAY)
+    {
+	t = time (NULL);
+	pTime = localtime (&t);
+	key = (g_RecordNaming == REC_NAME_HOUR ? pTime->tm_hour
+					       : pTime->tm_mday);
+	if (key != l_PeriodKey)
+	{
+	    l_PeriodKey = key;
+	    l_PeriodCnt = 0;
+	}
+	StrFormat (pName, "%02d%d", key, l_PeriodCnt % 10);
+	l_PeriodCnt++;
+    }
+    else
+    {
+	StrFormat (pName, "%03d", num);
+    }
+
+    return num;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write the Sequence Counter
+ *
+ * This routine programs the new counter value into the word after the
+ * current one.  If the current page is full, the other page is erased first.
+ * In case of a flash error, the value is only kept in RAM.
+ *
+ * @param[in] value
+ *	New value of the sequence counter.
+ *
+ ******************************************************************************/
+static void	RecordSeqWrite (uint32_t value)
+{
+uint32_t	  *pWord;
+uint32_t	   word;
+msc_Return_TypeDef res = mscReturnOk;
+
+    if (value > 0xFFFE)
+	value = 0xFFFE;			// keep the maximum
+    word = REC_SEQ_WORD(value);
+
+    if (l_pRecSeq == NULL)
+	pWord = __RecSeqStart;		// first value after erase
+    else
+	pWord = l_pRecSeq + 1;
+
+    if (pWord >= __RecSeqEnd)
+	pWord = __RecSeqStart;		// wrap to the first page
+
+    MSC_Init();
+
+    /* Erase the page if the new value starts it */
+    if (((pWord - __RecSeqStart) % REC_SEQ_WORDS) == 0
+    ||  *pWord != REC_SEQ_ERASED)
+    {
+	pWord -= (pWord - __RecSeqStart) % REC_SEQ_WORDS;
+	res = MSC_ErasePage (pWord);
+    }
+
+    if (res == mscReturnOk)
+	res = MSC_WriteWord (pWord, &word, 4);
+
+    MSC_Deinit();
+
+    l_RecSeq = value;
+
+    if (res == mscReturnOk)
+	l_pRecSeq = pWord;
+    else
+	LogError ("Record Sequence: Flash Error %d", res);
+}
@@ -0,0 +1,57 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module RecordSeq.c
+ * @author	agent
+ * @version	2026-10-14
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+*/
+
+#ifndef __INC_RecordSeq_h
+#define __INC_RecordSeq_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Highest record file number, the sequence wraps to R001 after it. */
+#define RECORD_SEQ_MAX		999
+
+/*!@brief Naming schemes of the record files, see @ref g_RecordNaming.
+ * Keep in sync with @ref g_enum_RecordNaming!
+ */
+typedef enum
+{
+    REC_NAME_SEQUENCE,	//!< R001 to R999, continuous sequence number
+    REC_NAME_HOUR,	//!< Rhhn, hour of the day and number 0 to 9
+    REC_NAME_DAY,	//!< Rddn, day of the month and number 0 to 9
+    NUM_REC_NAME
+} RECORD_NAMING;
+
+/*================================ Global Data ===============================*/
+
+extern RECORD_NAMING g_RecordNaming;
+extern const char   *g_enum_RecordNaming[];
+
+/*================================ Prototypes ================================*/
+
+    /* Read the record sequence counter from flash */
+void	RecordSeqInit (void);
+
+    /* Check if the sequence counter is valid */
+bool	RecordSeqIsValid (void);
+
+    /* Set the sequence counter from the number of existing records */
+void	RecordSeqSeed (int recordCnt);
+
+    /* Allocate the name of the next record file */
+int	RecordSeqNext (char *pName);
+
+
+#endif /* __INC_RecordSeq_h */
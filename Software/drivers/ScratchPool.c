@@ -0,0 +1,162 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Scratch Buffer Pool
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * Some routines need a large buffer for a short time, e.g. a line of the
+ * configuration file, or a log message when the log buffer is full.  If
+ * these buffers are located on the stack, both stacks have to be reserved
+ * for the sum of them, as they may be nested, and interrupts may add their
+ * own on top.  This module provides a small pool of @ref SCRATCH_BLOCK_CNT
+ * fixed blocks of @ref SCRATCH_BLOCK_SIZE bytes instead, which is shared by
+ * all of these routines.
+ *
+ * ScratchGet() allocates a block and ScratchPut() returns it.  Both may be
+ * called from interrupt context, the bitmap of the allocated blocks is
+ * protected by disabling the interrupts.  A block must be returned by the
+ * same routine which got it, i.e. an interrupt service routine never holds a
+ * block after its return.  So the main loop can always rely on the blocks
+ * that are not used by itself, only interrupt service routines may find the
+ * pool empty and must handle this, see logMsg().
+ *
+ * The number of requests, the peak number of blocks in use, and the number
+ * of failed requests are shown by ScratchReport().
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_int.h"
+#include "ScratchPool.h"
+#include "LEUART.h"
+#include "Logging.h"
+#include "StrFormat.h"
+
+/*=============================== Definitions ================================*/
+
+#if SCRATCH_BLOCK_CNT > 32  ||  (SCRATCH_BLOCK_SIZE % 4) != 0
+    #error "Invalid SCRATCH_BLOCK_CNT or SCRATCH_BLOCK_SIZE"
+#endif
+
+/*================================ Local Data ================================*/
+
+    /*! Storage of the blocks, word aligned */
+static uint32_t	l_ScratchPool[SCRATCH_BLOCK_CNT][SCRATCH_BLOCK_SIZE / 4];
+
+    /*! Bitmap of the blocks in use */
+static volatile uint32_t l_ScratchMap;
+
+    /*! Number of blocks in use, and its peak value */
+static uint8_t	l_ScratchUsed, l_ScratchPeak;
+
+    /*! Number of requests, and of those which could not be served */
+static uint32_t	l_ScratchGetCnt, l_ScratchFailCnt;
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get a Scratch Block
+ *
+ * This routine allocates a block of @ref SCRATCH_BLOCK_SIZE bytes from the
+ * pool.  It may be called from interrupt context.
+ *
+ * @return
+ * 	Address of the block, or NULL if all blocks are in use.
+ *
+ ******************************************************************************/
+void   *ScratchGet (void)
+{
+int	 i;
+
+    INT_Disable();
+
+    l_ScratchGetCnt++;
+    for (i = 0;  i < SCRATCH_BLOCK_CNT;  i++)
+    {
+	if ((l_ScratchMap & (1UL << i)) == 0)
+	{
+	    l_ScratchMap |= (1UL << i);
+	    if (++l_ScratchUsed > l_ScratchPeak)
+		l_ScratchPeak = l_ScratchUsed;
+
+	    INT_Enable();
+	    return l_ScratchPool[i];
+	}
+    }
+    l_ScratchFailCnt++;
+
+    INT_Enable();
+    return NULL;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Return a Scratch Block
+ *
+ * This routine returns a block which has been allocated by ScratchGet() to
+ * the pool.  It may be called from interrupt context.
+ *
+ * @param[in] pBlock
+ *	Address of the block, NULL is ignored.
+ *
+ ******************************************************************************/
+void	ScratchPut (void *pBlock)
+{
+int	 i;
+
+    if (pBlock == NULL)
+	return;
+
+    i = (uint32_t *)pBlock - l_ScratchPool[0];
+    if (i < 0  ||  i >= SCRATCH_BLOCK_CNT * (SCRATCH_BLOCK_SIZE / 4)
+	||  (i % (SCRATCH_BLOCK_SIZE / 4)) != 0)
+	return;				// not a block of the pool
+
+    i /= SCRATCH_BLOCK_SIZE / 4;
+
+    INT_Disable();
+    if (l_ScratchMap & (1UL << i))
+    {
+	l_ScratchMap &= ~(1UL << i);
+	l_ScratchUsed--;
+    }
+    INT_Enable();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Usage of the Pool
+ *
+ * This routine generates one line with the number of blocks in use, the
+ * peak number, and the number of requests and failed requests.
+ *
+ * @param[in] flgLog
+ *	If true, the line is logged.  If false, it is only shown on the debug
+ *	console.
+ *
+ ******************************************************************************/
+void	ScratchReport (bool flgLog)
+{
+char	 line[100];
+
+    StrFormat (line, "Scratch Pool: %d of %d blocks of %d bytes in use,"
+	       " peak %d, %ld requests, %ld failed",
+	       l_ScratchUsed, SCRATCH_BLOCK_CNT, SCRATCH_BLOCK_SIZE,
+	       l_ScratchPeak, l_ScratchGetCnt, l_ScratchFailCnt);
+
+    if (flgLog)
+    {
+	Log (line);
+    }
+    else
+    {
+	drvLEUART_puts (line);
+	drvLEUART_puts ("\n");
+    }
+}
@@ -0,0 +1,50 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module ScratchPool.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_ScratchPool_h
+#define __INC_ScratchPool_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Size of a scratch block in bytes, must be a multiple of 4.  This is
+ * also the maximum length of a line in the configuration file, including
+ * the EOS.
+ */
+#ifndef SCRATCH_BLOCK_SIZE
+    #define SCRATCH_BLOCK_SIZE	200
+#endif
+
+/*!@brief Number of scratch blocks, at most 32.  The main loop holds up to two
+ * blocks at the same time, i.e. ControlUpdateID() and CfgReadFindID().
+ */
+#ifndef SCRATCH_BLOCK_CNT
+    #define SCRATCH_BLOCK_CNT	2
+#endif
+
+/*================================ Prototypes ================================*/
+
+    /* Get a block from the pool, NULL if all are in use */
+void   *ScratchGet (void);
+
+    /* Return a block to the pool */
+void	ScratchPut (void *pBlock);
+
+    /* Show or log the usage of the pool */
+void	ScratchReport (bool flgLog);
+
+
+#endif /* __INC_ScratchPool_h */
@@ -0,0 +1,227 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Sound-Activity Detector
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * Without this module, a record lasts for the whole KEEP_RECORD duration,
+ * i.e. the storage device of the Audio module is mostly filled with silence.
+ * With @ref SOUND_DETECT, a tap of the microphone input is connected to the
+ * analog comparator @ref SOUND_ACMP.  Its negative input is the scaled VDD
+ * at the level of the configuration variable SOUND_THRESHOLD (1 to 63, i.e.
+ * VDD * SOUND_THRESHOLD / 63), which must be above the DC bias of the tap.
+ * Each rising edge of the comparator output means the signal exceeds the
+ * threshold, i.e. there is sound.
+ *
+ * The detector is armed by AudioCheck() while Control.c requests a record,
+ * see SoundDetectArm().  The first edge raises an interrupt, which marks
+ * sound activity at once, so the record is started without delay.  Further
+ * edges do not interrupt, an msTimer checks the edge flag once per second
+ * instead.  If no edge has been seen for SOUND_HANG_TIME seconds, the
+ * activity ends and the record is stopped.  The next sound starts a new
+ * record file, as long as the KEEP_RECORD duration is not over.
+ *
+ * The comparator is only clocked while the detector is armed.  Without
+ * SOUND_THRESHOLD, SoundIsActive() is always true, i.e. the records are
+ * not gated.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_int.h"
+#include "AlarmClock.h"
+#include "SoundDetect.h"
+#include "ClockMgr.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Number of status polls until the comparator must be active. */
+#define SOUND_ACMP_TIMEOUT	5000
+
+    /*! Period of the check of the edge flag in [ms]. */
+#define SOUND_CHECK_PERIOD	1000
+
+/*================================ Global Data ===============================*/
+
+    /*!@brief Threshold of the detector, VDDLEVEL of the comparator, 0 is off. */
+int32_t		g_SoundThreshold;
+
+    /*!@brief Seconds without sound after which a record is stopped. */
+int32_t		g_SoundHangTime = DFLT_SOUND_HANG_TIME;
+
+/*================================ Local Data ================================*/
+
+    /*! Timer handle for the check of the edge flag. */
+static TIM_HDL	l_thSound = NONE;
+
+    /*! Flag if the detector is armed, i.e. the comparator is enabled. */
+static bool	l_flgArmed;
+
+    /*! Flag if there is sound activity, set by the interrupt handler. */
+static volatile bool l_flgActive;
+
+    /*! Seconds without an edge of the comparator output. */
+static volatile int32_t	l_Silence;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	SoundTick (TIM_HDL hdl);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Sound-Activity Detector
+ *
+ * This routine must be called once after AlarmClockInit().  It creates the
+ * msTimer, the comparator is enabled by SoundDetectArm().
+ *
+ ******************************************************************************/
+void	SoundDetectInit (void)
+{
+    if (l_thSound == NONE)
+	l_thSound = msTimerCreate (SoundTick);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Arm or disarm the Sound-Activity Detector
+ *
+ * This routine is called by AudioCheck() in each pass.  While a record is
+ * requested, the comparator is enabled, and the edge flag is checked once
+ * per second.  Otherwise the comparator is disabled and its clock released.
+ * Without SOUND_THRESHOLD, the detector is never armed.
+ *
+ * @param[in] flgArm
+ *	True if a record is requested.
+ *
+ ******************************************************************************/
+void	SoundDetectArm (bool flgArm)
+{
+int	i;
+
+    if (g_SoundThreshold <= 0  ||  l_thSound == NONE)
+	flgArm = false;
+
+    if (flgArm == l_flgArmed)
+	return;			// nothing to do
+
+    l_flgArmed = flgArm;
+
+    if (! flgArm)
+    {
+	msTimerCancel (l_thSound);
+	NVIC_DisableIRQ (ACMP0_IRQn);
+	SOUND_ACMP->IEN  = 0;
+	SOUND_ACMP->CTRL = 0;
+	GPIO_PinModeSet (SOUND_ACMP_PORT, SOUND_ACMP_PIN, gpioModeDisabled, 0);
+	ClockRelease (CLK_OWN_SOUND, SOUND_ACMP_CLOCK);
+	l_flgActive = false;
+	return;
+    }
+
+    ClockAcquire (CLK_OWN_SOUND, SOUND_ACMP_CLOCK);
+    GPIO_PinModeSet (SOUND_ACMP_PORT, SOUND_ACMP_PIN, gpioModeDisabled, 0);
+
+    SOUND_ACMP->INPUTSEL = (SOUND_ACMP_CHANNEL << _ACMP_INPUTSEL_POSSEL_SHIFT)
+		| ACMP_INPUTSEL_NEGSEL_VDD | ACMP_INPUTSEL_LPREF
+		| ((g_SoundThreshold << _ACMP_INPUTSEL_VDDLEVEL_SHIFT)
+		   & _ACMP_INPUTSEL_VDDLEVEL_MASK);
+
+    SOUND_ACMP->CTRL = ACMP_CTRL_EN | ACMP_CTRL_IRISE
+		     | ACMP_CTRL_HYSTSEL_HYST4 | ACMP_CTRL_HALFBIAS
+		     | (0x7 << _ACMP_CTRL_BIASPROG_SHIFT)
+		     | ACMP_CTRL_WARMTIME_512CYCLES;
+
+    /* Wait until the comparator is active, the inactive output is low */
+    for (i = 0;  i < SOUND_ACMP_TIMEOUT;  i++)
+	if (SOUND_ACMP->STATUS & ACMP_STATUS_ACMPACT)
+	    break;
+
+    l_flgActive = false;
+    l_Silence = 0;
+
+    SOUND_ACMP->IFC = ACMP_IFC_EDGE | ACMP_IFC_WARMUP;
+    SOUND_ACMP->IEN = ACMP_IEN_EDGE;
+
+    NVIC_SetPriority (ACMP0_IRQn, INT_PRIO_ACMP);
+    NVIC_ClearPendingIRQ (ACMP0_IRQn);
+    NVIC_EnableIRQ (ACMP0_IRQn);
+
+    msTimerStart (l_thSound, SOUND_CHECK_PERIOD);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check for Sound Activity
+ *
+ * @return
+ *	The value <i>true</i> if a record should run, i.e. there has been sound
+ *	within the last SOUND_HANG_TIME seconds, or the detector is off.
+ *
+ ******************************************************************************/
+bool	SoundIsActive (void)
+{
+    return (g_SoundThreshold <= 0  ||  l_flgActive);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Analog Comparator Interrupt Handler
+ *
+ * This handler is called for the first rising edge of the comparator output,
+ * i.e. when sound starts.  It marks the activity, and disables the interrupt,
+ * so the audio signal does not cause an interrupt per period.  SoundTick()
+ * enables it again after the activity has ended.
+ *
+ ******************************************************************************/
+void	ACMP0_IRQHandler (void)
+{
+    SOUND_ACMP->IEN = 0;
+
+    l_Silence = 0;
+    if (! l_flgActive)
+    {
+	l_flgActive = true;
+	EVENT_POST(EVT_AUDIO);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Sound Timer Routine
+ *
+ * This routine is called by the msTimer once per second while the detector
+ * is armed.  An edge since the previous call restarts the hang time, its
+ * expiry ends the sound activity.  It has the same interrupt priority as
+ * ACMP0_IRQHandler(), see @ref INT_PRIO_ACMP.
+ *
+ ******************************************************************************/
+static void	SoundTick (TIM_HDL hdl)
+{
+    if (SOUND_ACMP->IF & ACMP_IF_EDGE)
+    {
+	SOUND_ACMP->IFC = ACMP_IFC_EDGE;
+	l_Silence = 0;
+	if (! l_flgActive)
+	{
+	    l_flgActive = true;
+	    EVENT_POST(EVT_AUDIO);
+	}
+    }
+    else if (l_flgActive  &&  ++l_Silence >= g_SoundHangTime)
+    {
+	l_flgActive = false;
+	SOUND_ACMP->IEN = ACMP_IEN_EDGE;	// wait for the next sound
+	EVENT_POST(EVT_AUDIO);
+    }
+
+    msTimerStart (hdl, SOUND_CHECK_PERIOD);
+}
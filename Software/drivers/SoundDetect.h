@@ -0,0 +1,65 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module SoundDetect.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_SoundDetect_h
+#define __INC_SoundDetect_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "em_gpio.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to gate the records by a sound-activity detector
+ * at a tap of the microphone input, see SoundDetect.c.  It is only active
+ * if the configuration variable SOUND_THRESHOLD is set.
+ */
+#ifndef SOUND_DETECT
+    #define SOUND_DETECT	0
+#endif
+
+/*!@brief Default number of seconds without sound after which a record is
+ * stopped, see configuration variable SOUND_HANG_TIME.
+ */
+#ifndef DFLT_SOUND_HANG_TIME
+    #define DFLT_SOUND_HANG_TIME	5
+#endif
+
+/*!@brief Analog comparator and input channel of the microphone tap.
+ * ACMP1_CH0 is pin PC8, the channels of ACMP0 are used by other functions.
+ */
+#define SOUND_ACMP		ACMP1
+#define SOUND_ACMP_CLOCK	cmuClock_ACMP1
+#define SOUND_ACMP_CHANNEL	0
+#define SOUND_ACMP_PORT		gpioPortC
+#define SOUND_ACMP_PIN		8
+
+/*======================== External Data and Routines ========================*/
+
+extern int32_t	g_SoundThreshold;	// VDDLEVEL of the ACMP, 0 is off
+extern int32_t	g_SoundHangTime;	// seconds of silence to stop a record
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize the sound-activity detector */
+void	SoundDetectInit (void);
+
+    /* Switch the detector on while a record is requested */
+void	SoundDetectArm (bool flgArm);
+
+    /* Check if a record should run */
+bool	SoundIsActive (void);
+
+
+#endif /* __INC_SoundDetect_h */
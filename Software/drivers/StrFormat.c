@@ -0,0 +1,295 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Integer String Formatter
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module replaces sprintf() and vsnprintf() of the C library.  Those
+ * support floating point and all kinds of conversions, which costs several
+ * kilobytes of flash, and some hundred bytes of stack for each call.  The
+ * firmware only needs integers and strings, so StrFormatV() implements just
+ * the following subset of printf():
+ * - flags <b>-</b> (left adjust) and <b>0</b> (pad with zeros)
+ * - field width as decimal number or <b>*</b>
+ * - precision as <b>.</b> followed by a decimal number or <b>*</b>,
+ *   only for <b>%s</b> where it limits the number of characters
+ * - length modifier <b>l</b> for long arguments, <b>h</b> is ignored
+ * - conversions <b>d i u x X c s %</b>
+ *
+ * Other conversions, e.g. <b>%f</b> or <b>%lld</b>, are not supported, the
+ * conversion character is copied as it is.  All routines only work on their
+ * parameters and local variables, so they can be called from interrupt
+ * context, and the stack usage is bounded by @ref STR_FORMAT_DIGITS and a
+ * few registers.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Mark the fall through from 'x' to 'u' for GCC.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include <stdbool.h>
+#include "StrFormat.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Size of the digit buffer, 3 digits per byte are enough for
+     * decimal and hexadecimal numbers of type unsigned long.
+     */
+#define STR_FORMAT_DIGITS	(3 * sizeof(unsigned long))
+
+    /*!@brief Store a character, if the buffer is not full. */
+#define STR_PUT(c)	do { if (len < max) pBuf[len++] = (c); } while (0)
+
+/*================================ Local Data ================================*/
+
+    /*! Digits for upper and lower case hexadecimal numbers */
+static const char l_DigitsUC[] = "0123456789ABCDEF";
+static const char l_DigitsLC[] = "0123456789abcdef";
+
+
+/***************************************************************************//**
+ *
+ * @brief	Format a String with an Argument List
+ *
+ * This is the vsnprintf() of the project, see the file description for the
+ * supported conversions.  The result is always terminated with EOS.
+ *
+ * @param[out] pBuf
+ *	Buffer for the result.
+ *
+ * @param[in] size
+ *	Size of the buffer in bytes, including the EOS.
+ *
+ * @param[in] frmt
+ *	Format string.
+ *
+ * @param[in] args
+ *	Arguments of the conversions.
+ *
+ * @return
+ *	Number of characters stored, without EOS.  Different to vsnprintf(),
+ *	this is not the length the result would have had without truncation.
+ *
+ ******************************************************************************/
+int	StrFormatV (char *pBuf, size_t size, const char *frmt, va_list args)
+{
+char	 digits[STR_FORMAT_DIGITS];	// digits of a number, or a character
+const char *pStr;			// characters of the conversion
+const char *pDigits;			// upper or lower case digits
+unsigned long value;			// absolute value of a number
+unsigned int  base;
+size_t	 len, max;
+int	 width, prec, cnt, pad;
+bool	 flgLeft, flgZero, flgLong, flgNeg, flgNum;
+long	 sValue;
+
+
+    if (size == 0)
+	return 0;
+
+    len = 0;
+    max = size - 1;		// reserve EOS
+
+    while (*frmt != EOS  &&  len < max)
+    {
+	if (*frmt != '%')
+	{
+	    pBuf[len++] = *frmt++;
+	    continue;
+	}
+	frmt++;
+
+	/* Flags */
+	flgLeft = flgZero = false;
+	for ( ;  *frmt == '-'  ||  *frmt == '0';  frmt++)
+	{
+	    if (*frmt == '-')
+		flgLeft = true;
+	    else
+		flgZero = true;
+	}
+
+	/* Field width */
+	width = 0;
+	if (*frmt == '*')
+	{
+	    width = va_arg (args, int);
+	    if (width < 0)
+	    {
+		flgLeft = true;
+		width = -width;
+	    }
+	    frmt++;
+	}
+	else
+	{
+	    while (*frmt >= '0'  &&  *frmt <= '9')
+		width = 10 * width + (*frmt++ - '0');
+	}
+
+	/* Precision, only used for strings */
+	prec = -1;
+	if (*frmt == '.')
+	{
+	    frmt++;
+	    prec = 0;
+	    if (*frmt == '*')
+	    {
+		prec = va_arg (args, int);
+		frmt++;
+	    }
+	    else
+	    {
+		while (*frmt >= '0'  &&  *frmt <= '9')
+		    prec = 10 * prec + (*frmt++ - '0');
+	    }
+	}
+
+	/* Length modifier */
+	flgLong = false;
+	for ( ;  *frmt == 'l'  ||  *frmt == 'h';  frmt++)
+	{
+	    if (*frmt == 'l')
+		flgLong = true;
+	}
+
+	if (*frmt == EOS)
+	    break;
+
+	/* Conversion */
+	flgNeg = flgNum = false;
+	pStr = digits;
+	cnt  = 0;
+	base = 10;
+	value = 0;
+
+	switch (*frmt)
+	{
+	    case 'd':
+	    case 'i':
+		sValue = (flgLong ? va_arg (args, long) : va_arg (args, int));
+		if (sValue < 0)
+		{
+		    flgNeg = true;
+		    value = (unsigned long)(-(sValue + 1)) + 1;	// LONG_MIN
+		}
+		else
+		{
+		    value = (unsigned long)sValue;
+		}
+		flgNum = true;
+		break;
+
+	    case 'x':
+	    case 'X':
+		base = 16;
+		/* fall through */
+	    case 'u':
+		value = (flgLong ? va_arg (args, unsigned long)
+				 : va_arg (args, unsigned int));
+		flgNum = true;
+		break;
+
+	    case 'c':
+		digits[0] = (char)va_arg (args, int);
+		cnt = 1;
+		break;
+
+	    case 's':
+		pStr = va_arg (args, const char *);
+		if (pStr == NULL)
+		    pStr = "(null)";
+		for (cnt = 0;  pStr[cnt] != EOS  &&  cnt != prec;  cnt++)
+		    ;
+		break;
+
+	    default:		// "%%" or unsupported conversion
+		digits[0] = *frmt;
+		cnt = 1;
+		break;
+	}
+
+	if (flgNum)
+	{
+	    /* generate the digits in reverse order */
+	    pDigits = (*frmt == 'x' ? l_DigitsLC : l_DigitsUC);
+	    do
+	    {
+		digits[sizeof(digits) - 1 - cnt++] = pDigits[value % base];
+		value /= base;
+	    } while (value != 0);
+
+	    pStr = digits + sizeof(digits) - cnt;
+	}
+	frmt++;
+
+	/* Output with padding */
+	pad = width - cnt - (flgNeg ? 1 : 0);
+
+	if (! flgLeft  &&  ! (flgZero  &&  flgNum))
+	    for ( ;  pad > 0;  pad--)
+		STR_PUT(' ');
+
+	if (flgNeg)
+	    STR_PUT('-');
+
+	if (! flgLeft)
+	    for ( ;  pad > 0;  pad--)
+		STR_PUT('0');
+
+	for ( ;  cnt > 0;  cnt--)
+	    STR_PUT(*pStr++);
+
+	for ( ;  pad > 0;  pad--)
+	    STR_PUT(' ');
+    }
+
+    pBuf[len] = EOS;
+
+    return (int)len;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Format a String into a Buffer of limited Size
+ *
+ * This is the snprintf() of the project, see StrFormatV().
+ *
+ ******************************************************************************/
+int	StrFormatN (char *pBuf, size_t size, const char *frmt, ...)
+{
+va_list	 args;
+int	 len;
+
+    va_start (args, frmt);
+    len = StrFormatV (pBuf, size, frmt, args);
+    va_end (args);
+
+    return len;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Format a String
+ *
+ * This is the sprintf() of the project, see StrFormatV().  The caller must
+ * provide a buffer that is large enough for the result.
+ *
+ ******************************************************************************/
+int	StrFormat (char *pBuf, const char *frmt, ...)
+{
+va_list	 args;
+int	 len;
+
+    va_start (args, frmt);
+    len = StrFormatV (pBuf, (size_t)-1, frmt, args);
+    va_end (args);
+
+    return len;
+}
@@ -0,0 +1,51 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module StrFormat.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	No format check in the host simulation, see SIMULATION.
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_StrFormat_h
+#define __INC_StrFormat_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdarg.h>
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Let GCC check the arguments against the format string, like it does
+ * for printf().  Other compilers do not know this attribute.  The firmware
+ * prints uint32_t with <b>%ld</b>, which is <b>unsigned long</b> on the
+ * target, but <b>unsigned int</b> on the host, so the host simulation does not
+ * check the format.
+ */
+#if defined(__GNUC__)  &&  ! defined(SIMULATION)
+    #define STR_FORMAT_CHECK(frmtIdx, argIdx)	\
+		__attribute__ ((format (printf, frmtIdx, argIdx)))
+#else
+    #define STR_FORMAT_CHECK(frmtIdx, argIdx)
+#endif
+
+/*================================ Prototypes ================================*/
+
+    /* Format into a buffer of the specified size, returns the length */
+int	StrFormatV (char *pBuf, size_t size, const char *frmt, va_list args)
+			STR_FORMAT_CHECK(3, 0);
+
+    /* Format into a buffer of the specified size, returns the length */
+int	StrFormatN (char *pBuf, size_t size, const char *frmt, ...)
+			STR_FORMAT_CHECK(3, 4);
+
+    /* Format into a buffer that is large enough, returns the length */
+int	StrFormat (char *pBuf, const char *frmt, ...)
+			STR_FORMAT_CHECK(2, 3);
+
+
+#endif /* __INC_StrFormat_h */
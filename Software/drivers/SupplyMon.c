@@ -0,0 +1,398 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Supply Voltage Monitor
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * Without a battery controller on the SMBus, BatteryMon.c has no battery
+ * status, so neither ControlEnergyGovernor() nor the battery forecast of
+ * Forecast.c can work.  This module is the fallback: the supply voltage is
+ * connected via the divider @ref SUPPLY_DIVIDER to the ADC input
+ * @ref SUPPLY_ADC_PIN, and it is measured whenever BatterySnapshotReq()
+ * is called, i.e. at the low duty cycle of the battery monitoring.
+ *
+ * A measurement is a burst of @ref SUPPLY_BURST conversions, which are
+ * transferred by a shared DMA channel into a buffer, see DmaChanAlloc().  The
+ * ADC runs in repetitive mode, so the burst only takes about one millisecond.
+ * The average is converted into [mV], and the state of charge is taken from
+ * the discharge curve of the configuration variable SUPPLY_CURVE.  It is a
+ * list of "mV*SoC" points with ascending voltages, e.g.
+ * "3400*5, 3600*20, 3750*50, 3900*80, 4100*100".  Between two points, the
+ * state of charge is interpolated, below the first one it is 0%.
+ *
+ * The result is stored into a @ref BAT_SNAPSHOT with only the voltage and
+ * the state of charge, see element <b>Estimated</b>.  If no DMA channel is
+ * available, the conversions are read by the CPU.  If the burst does not
+ * complete within @ref SUPPLY_DMA_TIMEOUT, e.g. because PowerFailSupply()
+ * has used the ADC meanwhile, the snapshot is invalid.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	The DMA configuration is a local variable of SupplyMonReq().
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_cmu.h"
+#include "em_dma.h"
+#include "em_gpio.h"
+#include "em_int.h"
+#include "AlarmClock.h"
+#include "SupplyMon.h"
+#include "DmaChan.h"
+#include "ClockMgr.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Time in [ms] until the DMA burst must be complete. */
+#define SUPPLY_DMA_TIMEOUT	10
+
+    /*! Number of status polls until an ADC conversion must be done. */
+#define SUPPLY_ADC_TIMEOUT	1000
+
+/*================================ Global Data ===============================*/
+
+    /*!@brief Discharge curve, list of "mV*SoC" points, empty is off. */
+CFG_LIST	g_SupplyCurve;
+
+/*================================ Local Data ================================*/
+
+    /*! Buffer of the ADC samples of a burst. */
+static uint16_t	l_Sample[SUPPLY_BURST];
+
+    /*! Shared DMA channel of the current burst. */
+static volatile int	l_DmaChan = DMA_CHAN_NONE;
+
+    /*! msTimer handle for the timeout of the burst. */
+static TIM_HDL	l_thSupply = NONE;
+
+    /*! Snapshot and callback function of the current request. */
+static BAT_SNAPSHOT   *l_pSnap;
+static SUPPLY_CALLBACK l_Function;
+
+    /*! Flag is true while a measurement is in progress. */
+static volatile bool	l_flgBusy;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	SupplyAdcSetup (uint32_t singleCtrl);
+static bool	SupplyBurstCPU (void);
+static void	SupplyDmaDone (unsigned int channel, bool primary, void *user);
+static void	SupplyTimeout (TIM_HDL hdl);
+static void	SupplyDone (bool flgOk);
+static uint8_t	SupplySoC (int32_t milliVolt);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Supply Monitor
+ *
+ * This routine must be called once after AlarmClockInit().  It creates the
+ * msTimer for the burst timeout and disables the digital input of the ADC
+ * pin.
+ *
+ ******************************************************************************/
+void	SupplyMonInit (void)
+{
+    GPIO_PinModeSet (SUPPLY_ADC_PORT, SUPPLY_ADC_PIN, gpioModeDisabled, 0);
+
+    if (l_thSupply == NONE)
+	l_thSupply = msTimerCreate (SupplyTimeout);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if the Supply Monitor is on
+ *
+ * @return
+ *	The value <i>true</i> if a discharge curve has been configured.
+ *
+ ******************************************************************************/
+bool	SupplyMonIsOn (void)
+{
+    return (g_SupplyCurve.Cnt > 0  &&  l_thSupply != NONE);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Request a Measurement of the Supply Voltage
+ *
+ * This routine starts a burst of ADC conversions.  When it is complete, the
+ * voltage and the state of charge are stored into <b>pSnap</b>, and
+ * <b>function</b> is called in interrupt context.  If no DMA channel is
+ * available, the burst is read by the CPU before this routine returns.
+ *
+ * @param[out] pSnap
+ *	Address of the snapshot to be filled in, it must remain valid until
+ *	the callback function is called.
+ *
+ * @param[in] function
+ *	Function to call when the measurement is done.
+ *
+ * @return
+ *	Returns true if the measurement has been started, false if the supply
+ *	monitor is off, or a measurement is still in progress.
+ *
+ ******************************************************************************/
+bool	SupplyMonReq (BAT_SNAPSHOT *pSnap, SUPPLY_CALLBACK function)
+{
+/* DMA channel configuration, copied into the controller */
+DMA_CfgChannel_TypeDef chnlCfg =
+{
+    .highPri   = false,			// Normal priority
+    .enableInt = true,			// Interrupt for callback function
+    .select    = DMAREQ_ADC0_SINGLE,	// Request by a single conversion
+    .cb        = NULL,			// Callback is set by DmaChanAlloc()
+};
+
+/* DMA descriptor configuration, from SINGLEDATA into the buffer */
+DMA_CfgDescr_TypeDef descrCfg =
+{
+    .dstInc  = dmaDataInc2,		// Increment destination by a halfword
+    .srcInc  = dmaDataIncNone,		// Always read SINGLEDATA
+    .size    = dmaDataSize2,		// Data size is one halfword
+    .arbRate = dmaArbitrate1,		// Rearbitrate for each sample
+    .hprot   = 0,			// No read/write source protection
+};
+
+    if (! SupplyMonIsOn()  ||  l_flgBusy)
+	return false;
+
+    l_flgBusy  = true;
+    l_pSnap    = pSnap;
+    l_Function = function;
+
+    ClockAcquire (CLK_OWN_SUPPLY, cmuClock_ADC0);
+
+    l_DmaChan = DmaChanAlloc ("Supply", &chnlCfg, SupplyDmaDone, NULL);
+    if (l_DmaChan == DMA_CHAN_NONE)
+    {
+	/* All shared channels in use, read the samples by the CPU */
+	SupplyDone (SupplyBurstCPU());
+	return true;
+    }
+
+    EM1_Acquire (EM1_MOD_SUPPLY);	// the DMA does not work in EM2
+
+    SupplyAdcSetup (ADC_SINGLECTRL_REP);
+    msTimerStart (l_thSupply, SUPPLY_DMA_TIMEOUT);
+
+    DMA_CfgDescr (l_DmaChan, true, &descrCfg);
+    DMA_ActivateBasic (l_DmaChan, true, false, l_Sample,
+		       (void *)&ADC0->SINGLEDATA, SUPPLY_BURST - 1);
+
+    ADC0->CMD = ADC_CMD_SINGLESTART;
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set up the ADC for the Supply Voltage
+ *
+ * @param[in] singleCtrl
+ *	Additional bits for SINGLECTRL, e.g. the repetitive mode.
+ *
+ ******************************************************************************/
+static void	SupplyAdcSetup (uint32_t singleCtrl)
+{
+uint32_t freq;			// HFPERCLK in [MHz]
+
+    /* 1us time base for the warm-up, ADC clock about 1MHz */
+    freq = (CMU_ClockFreqGet (cmuClock_HFPER) + 999999) / 1000000;
+    if (freq < 1)
+	freq = 1;
+
+    ADC0->CTRL = ADC_CTRL_WARMUPMODE_NORMAL
+	       | (((freq - 1) << _ADC_CTRL_TIMEBASE_SHIFT) & _ADC_CTRL_TIMEBASE_MASK)
+	       | (((freq - 1) << _ADC_CTRL_PRESC_SHIFT) & _ADC_CTRL_PRESC_MASK);
+
+    ADC0->SINGLECTRL = SUPPLY_ADC_INPUT
+		     | ADC_SINGLECTRL_REF_2V5
+		     | ADC_SINGLECTRL_RES_12BIT
+		     | ADC_SINGLECTRL_AT_32CYCLES
+		     | singleCtrl;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read a Burst by the CPU
+ *
+ * Interrupts are disabled during the burst, since PowerFailSupply() uses the
+ * ADC in interrupt context.
+ *
+ * @return
+ *	The value <i>true</i> if all conversions have been completed.
+ *
+ ******************************************************************************/
+static bool	SupplyBurstCPU (void)
+{
+int	n, i;
+
+    INT_Disable();
+
+    SupplyAdcSetup (0);
+
+    for (n = 0;  n < SUPPLY_BURST;  n++)
+    {
+	ADC0->CMD = ADC_CMD_SINGLESTART;
+
+	for (i = 0;  i < SUPPLY_ADC_TIMEOUT;  i++)
+	    if (ADC0->STATUS & ADC_STATUS_SINGLEDV)
+		break;
+
+	if (i >= SUPPLY_ADC_TIMEOUT)
+	    break;
+
+	l_Sample[n] = ADC0->SINGLEDATA & 0xFFF;
+    }
+
+    INT_Enable();
+
+    return (n == SUPPLY_BURST);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	DMA Callback of the Burst
+ *
+ * Called from the DMA interrupt handler when all samples have been
+ * transferred.
+ *
+ ******************************************************************************/
+static void	SupplyDmaDone (unsigned int channel, bool primary, void *user)
+{
+    (void) channel;		// suppress compiler warnings "unused parameter"
+    (void) primary;
+    (void) user;
+
+    msTimerCancel (l_thSupply);
+
+    /* The ADC must still have been set up for the supply voltage */
+    SupplyDone ((ADC0->SINGLECTRL & _ADC_SINGLECTRL_INPUTSEL_MASK)
+		== SUPPLY_ADC_INPUT);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Timeout of the Burst
+ *
+ * The DMA did not complete the burst in time, probably since the ADC has been
+ * reconfigured by another module meanwhile.
+ *
+ ******************************************************************************/
+static void	SupplyTimeout (TIM_HDL hdl)
+{
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    INT_Disable();
+    if (l_DmaChan != DMA_CHAN_NONE)
+	DMA->CHENC = (1 << l_DmaChan);
+    INT_Enable();
+
+    SupplyDone (false);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Complete a Measurement
+ *
+ * This routine stops the ADC, releases its resources, and stores the average
+ * of the samples into the snapshot of the request.  Then the callback
+ * function is called.
+ *
+ * @param[in] flgOk
+ *	False if the burst failed.
+ *
+ ******************************************************************************/
+static void	SupplyDone (bool flgOk)
+{
+uint32_t sum;
+int32_t	 milliVolt;
+int	 i;
+
+    INT_Disable();
+    if (! l_flgBusy)
+    {
+	INT_Enable();
+	return;			// DMA and timeout at the same time
+    }
+    l_flgBusy = false;
+
+    ADC0->CMD = ADC_CMD_SINGLESTOP;
+    if (l_DmaChan != DMA_CHAN_NONE)
+    {
+	DmaChanFree (l_DmaChan);
+	l_DmaChan = DMA_CHAN_NONE;
+	EM1_Release (EM1_MOD_SUPPLY);
+    }
+    INT_Enable();
+
+    ClockRelease (CLK_OWN_SUPPLY, cmuClock_ADC0);
+
+    for (sum = 0, i = 0;  i < SUPPLY_BURST;  i++)
+	sum += l_Sample[i];
+
+    milliVolt = (sum * SUPPLY_REF_MV * SUPPLY_DIVIDER) / (4096 * SUPPLY_BURST);
+
+    memset (l_pSnap, 0, sizeof(*l_pSnap));
+    l_pSnap->Voltage = (uint16_t)milliVolt;
+    l_pSnap->RelativeStateOfCharge = SupplySoC (milliVolt);
+    l_pSnap->Estimated = true;
+    l_pSnap->Valid = flgOk;
+
+    if (l_Function != NULL)
+	l_Function (flgOk);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	State of Charge from the Discharge Curve
+ *
+ * @param[in] milliVolt
+ *	Supply voltage in [mV].
+ *
+ * @return
+ *	State of charge in [%], interpolated between the points of
+ *	@ref g_SupplyCurve.
+ *
+ ******************************************************************************/
+static uint8_t	SupplySoC (int32_t milliVolt)
+{
+const CFG_LIST_ENTRY *pPrev, *pNext;
+int32_t	 soc;
+int	 i;
+
+    if (g_SupplyCurve.Cnt == 0
+    ||  milliVolt < g_SupplyCurve.Entry[0].First)
+	return 0;
+
+    for (i = 1;  i < g_SupplyCurve.Cnt;  i++)
+	if (milliVolt < g_SupplyCurve.Entry[i].First)
+	    break;
+
+    pPrev = &g_SupplyCurve.Entry[i - 1];
+    if (i >= g_SupplyCurve.Cnt)
+    {
+	soc = pPrev->Weight;		// above the last point
+    }
+    else
+    {
+	pNext = &g_SupplyCurve.Entry[i];
+	soc = pPrev->Weight + ((int32_t)pNext->Weight - pPrev->Weight)
+			    * (milliVolt - pPrev->First)
+			    / (pNext->First - pPrev->First);
+    }
+
+    return (uint8_t)(soc > 100 ? 100 : (soc < 0 ? 0 : soc));
+}
@@ -0,0 +1,71 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module SupplyMon.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_SupplyMon_h
+#define __INC_SupplyMon_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "em_adc.h"
+#include "config.h"		// include project configuration parameters
+#include "CfgData.h"
+#include "BatteryMon.h"
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to measure the supply voltage with the ADC if no
+ * battery controller answers on the SMBus, see SupplyMon.c.  It is only
+ * active if the configuration variable SUPPLY_CURVE is set.
+ */
+#ifndef SUPPLY_MON
+    #define SUPPLY_MON		0
+#endif
+
+/*!@name Hardware Configuration: ADC input of the supply voltage divider. */
+//@{
+#define SUPPLY_ADC_INPUT	ADC_SINGLECTRL_INPUTSEL_CH6 //!< ADC0_CH6
+#define SUPPLY_ADC_PORT		gpioPortD	//!< Port of the ADC input
+#define SUPPLY_ADC_PIN		6		//!< Pin PD6
+#define SUPPLY_REF_MV		2500		//!< ADC reference in [mV]
+#define SUPPLY_DIVIDER		2		//!< Supply voltage / ADC input
+//@}
+
+/*!@brief Number of ADC samples which are averaged for one measurement. */
+#ifndef SUPPLY_BURST
+    #define SUPPLY_BURST	16
+#endif
+
+/*!@brief Callback function for SupplyMonReq().
+ *
+ * The function is called in interrupt context when the measurement has been
+ * completed.  Parameter @p flgOk is false if it failed.
+ */
+typedef void	(* SUPPLY_CALLBACK)(bool flgOk);
+
+/*======================== External Data and Routines ========================*/
+
+extern CFG_LIST	g_SupplyCurve;		// discharge curve "mV*SoC, ..."
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize the supply monitor */
+void	SupplyMonInit (void);
+
+    /* Check if a discharge curve has been configured */
+bool	SupplyMonIsOn (void);
+
+    /* Measure the supply voltage into a battery status snapshot */
+bool	SupplyMonReq (BAT_SNAPSHOT *pSnap, SUPPLY_CALLBACK function);
+
+
+#endif /* __INC_SupplyMon_h */
@@ -0,0 +1,814 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Telemetry Protocol
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module implements a binary request/response protocol on the LEUART
+ * console.  It transfers the diagnostic data in its binary representation,
+ * which is much more compact than the text reports at 9600bd.
+ *
+ * Frame format, requests and responses are encoded in the same way:
+ * @code
+   TLM_FRAME_START  COBS(Payload CRC_Hi CRC_Lo) ^ TLM_FRAME_END  TLM_FRAME_END
+   @endcode
+ * The payload and its CRC-16/CCITT (polynomial 0x1021, initial value 0xFFFF)
+ * are COBS encoded, so they contain no 0x00 bytes.  Every encoded byte is
+ * then XORed with @ref TLM_FRAME_END, so the \<LF> can terminate the frame,
+ * just like a text command line.  @ref TLM_FRAME_START never starts a text
+ * command, so CheckCommand() passes these lines to TelemetryRequest().
+ *
+ * A request payload consists of the command byte, see @ref TLM_CMD, and an
+ * optional argument byte, which is the first index for paged tables.  The
+ * file commands take the arguments shown below, <b>Path</b> is the rest of
+ * the request, e.g. "BOX0999/26101400.TXT", up to @ref TLM_PATH_MAX
+ * characters.
+ * A response payload starts with the command byte, ORed with 0x80, and the
+ * status byte, see @ref TLM_STATUS, followed by the data.  All multi-byte
+ * values are little endian:
+ * - @ref TLM_CMD_PING: TLM_VERSION(1), firmware version string
+ * - @ref TLM_CMD_COUNTERS: Time(4), PowerUpTime(4), LogErrorCnt(4),
+ *   LogLostCnt(4), BattMilliVolt(2), BattCapacity(2), LB_ActiveMask(4),
+ *   ConsoleDropCnt(4), see drvLEUART_dropCount()
+ * - @ref TLM_CMD_CONFIG: Total(1), First(1), then for each variable
+ *   Type(1), Value(4), NameLen(1), Name
+ * - @ref TLM_CMD_PRESENCE: Total(1), First(1), then for each used entry
+ *   Index(1), ID(8), FirstSeen(4), LastSeen(4), ReadCnt(4)
+ * - @ref TLM_CMD_PERF: Total(1), First(1), then for each ISR
+ *   Cnt(4), Min(4), Max(4), Sum(8)
+ * - @ref TLM_CMD_LOG_TAIL: Text of the most recent log messages, see
+ *   LogTailGet()
+ * - @ref TLM_CMD_DIR, request First(2), Path: Next(2), then for each
+ *   entry of the directory Attr(1), Size(4), NameLen(1), Name.  Next is
+ *   the index of the following page, or 0 at the end of the directory.
+ * - @ref TLM_CMD_FILE_READ, request Offset(4), Path: FileSize(4),
+ *   Offset(4), Data.  There is no data if Offset is at or behind the end of
+ *   the file.
+ *
+ * Paged responses contain as many entries as fit into @ref TLM_PAYLOAD_MAX
+ * bytes, the host requests the next page with the following index.
+ *
+ * If @ref TLM_FILE_EXPORT is set, the host can copy the log segments, the
+ * visit records, and the statistics files without removing the SD-Card,
+ * i.e. without interrupting the logging.  It walks the directories by
+ * @ref TLM_CMD_DIR, and reads each file by @ref TLM_CMD_FILE_READ chunk by
+ * chunk.  Each chunk is protected by the CRC of its frame.  The host asks
+ * for the next offset only after a valid response, so a transfer is resumed
+ * by repeating the request, even after a lost connection.  The console
+ * should be switched to @ref LEUART_HS_BAUD before, see console command
+ * "HS".  The SD-Card is retained by DiskRelease() between the requests.  On
+ * error, the status is @ref TLM_ERR_FILE, and the data is the FatFs result
+ * code(1).
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	The response frame is built in a scratch block, see ScratchGet().
+2026-10-15,agnt	The response is encoded in place, the payload is built at the
+		end of the frame buffer, see TLM_COBS_OVERHEAD.
+2026-10-15,agnt	tlmPerf() reports zeros without ISR_PROFILE, see g_IsrProf[].
+2026-10-15,agnt	tlmFileRead() borrows the file handle of the logging module,
+		see LogFileHandleGet().
+2026-10-15,agnt	Commands DIR and FILE_READ to export the files of the SD-Card,
+		see TLM_FILE_EXPORT.
+2026-10-14,agnt	COUNTERS also returns the number of discarded console strings.
+2026-10-14,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include <time.h>
+#include "em_int.h"
+#include "Telemetry.h"
+#include "LEUART.h"
+#include "Logging.h"
+#include "CfgData.h"
+#include "RFID.h"
+#include "BatteryMon.h"
+#include "LightBarrier.h"
+#include "AlarmClock.h"
+#include "IsrProfile.h"
+#include "ScratchPool.h"
+#if TLM_FILE_EXPORT
+#include "PowerFail.h"
+#include "ff.h"		// FS_FAT12/16/32
+#include "diskio.h"	// DSTATUS
+#include "microsd.h"
+#endif
+
+#if TELEMETRY
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Size of the CRC in bytes. */
+#define TLM_CRC_SIZE		2
+
+    /*!@brief Bit to mark a response. */
+#define TLM_RESPONSE		0x80
+
+    /*!@brief Maximum number of code bytes which COBS adds to the payload. */
+#define TLM_COBS_OVERHEAD	((TLM_PAYLOAD_MAX + TLM_CRC_SIZE) / 254 + 1)
+
+    /*!@brief Size of an encoded frame, including start byte, COBS overhead,
+     * and delimiter.
+     */
+#define TLM_FRAME_SIZE	(1 + TLM_COBS_OVERHEAD + TLM_PAYLOAD_MAX + TLM_CRC_SIZE + 1)
+
+    /* the response frame is built in a scratch block */
+#if TLM_FRAME_SIZE > SCRATCH_BLOCK_SIZE
+    #error "TLM_PAYLOAD_MAX exceeds SCRATCH_BLOCK_SIZE"
+#endif
+
+/*======================== External Data and Routines ========================*/
+
+extern PRJ_INFO const  prj;		// Project Information
+
+/*================================ Local Data ================================*/
+
+    /*! Payload of the response, plus CRC, while TelemetryRequest() runs.  It
+     *  is located behind the start byte and the COBS overhead of the frame,
+     *  so tlmEncode() never overwrites a byte of the payload before it has
+     *  been read.
+     */
+static uint8_t	*l_TlmPayload;
+
+/*=========================== Forward Declarations ===========================*/
+
+static int	tlmDecode (uint8_t *pBuf, int len);
+static int	tlmEncode (const uint8_t *pSrc, int len, uint8_t *pDst);
+static uint16_t	tlmCRC16 (const uint8_t *pData, int len);
+static uint8_t *tlmPut (uint8_t *pDst, uint32_t value, int size);
+static int	tlmCounters (uint8_t *pData);
+static int	tlmConfig (uint8_t *pData, int first);
+static int	tlmPresence (uint8_t *pData, int first);
+static int	tlmPerf (uint8_t *pData, int first);
+#if TLM_FILE_EXPORT
+static int	tlmDir (uint8_t *pData, const uint8_t *pReq, int len);
+static int	tlmFileRead (uint8_t *pData, const uint8_t *pReq, int len);
+static FRESULT	tlmFileAccess (char *pPath, const uint8_t *pReq, int len);
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Handle a Telemetry Request
+ *
+ * This routine is called by CheckCommand() for a command line which starts
+ * with @ref TLM_FRAME_START.  It decodes and verifies the request, builds the
+ * response in a scratch block, and writes it to the LEUART as one frame.  If
+ * there is no free scratch block, or not enough space in the transmit FIFO,
+ * the response is discarded, the host will repeat the request after a
+ * timeout.
+ *
+ * @param[in] pFrame
+ *	Encoded request, without @ref TLM_FRAME_START and @ref TLM_FRAME_END.
+ *	The buffer is decoded in place.
+ *
+ * @param[in] len
+ *	Number of bytes of the encoded request.
+ *
+ ******************************************************************************/
+void	TelemetryRequest (uint8_t *pFrame, int len)
+{
+uint8_t	*pTlmFrame;
+uint8_t	*pData;
+int	 cmd, arg, cnt;
+uint16_t crc;
+
+
+    pTlmFrame = ScratchGet();
+    if (pTlmFrame == NULL)
+	return;			// the host repeats the request
+
+    l_TlmPayload = pTlmFrame + 1 + TLM_COBS_OVERHEAD;
+    pData = l_TlmPayload + 2;	// behind command and status byte
+
+    len = tlmDecode (pFrame, len);
+
+    cnt = 0;
+    if (len < 1 + TLM_CRC_SIZE
+    ||  tlmCRC16 (pFrame, len - TLM_CRC_SIZE)
+	!= ((pFrame[len - 2] << 8) | pFrame[len - 1]))
+    {
+	cmd = 0x7F;			// command is not known
+	l_TlmPayload[1] = TLM_ERR_FRAME;
+    }
+    else
+    {
+	cmd = pFrame[0];
+	arg = (len > 1 + TLM_CRC_SIZE ? pFrame[1] : 0);
+	l_TlmPayload[1] = TLM_OK;
+
+	switch (cmd)
+	{
+	    case TLM_CMD_PING:
+		pData[0] = TLM_VERSION;
+		cnt = strlen (prj.Version);
+		memcpy (pData + 1, prj.Version, cnt);
+		cnt++;
+		break;
+
+	    case TLM_CMD_COUNTERS:
+		cnt = tlmCounters (pData);
+		break;
+
+	    case TLM_CMD_CONFIG:
+		cnt = tlmConfig (pData, arg);
+		break;
+
+	    case TLM_CMD_PRESENCE:
+		cnt = tlmPresence (pData, arg);
+		break;
+
+	    case TLM_CMD_PERF:
+		cnt = tlmPerf (pData, arg);
+		break;
+
+	    case TLM_CMD_LOG_TAIL:
+		cnt = LogTailGet ((char *)pData, TLM_PAYLOAD_MAX - 2);
+		break;
+
+#if TLM_FILE_EXPORT
+	    case TLM_CMD_DIR:
+		cnt = tlmDir (pData, pFrame + 1, len - 1 - TLM_CRC_SIZE);
+		break;
+
+	    case TLM_CMD_FILE_READ:
+		cnt = tlmFileRead (pData, pFrame + 1, len - 1 - TLM_CRC_SIZE);
+		break;
+#endif
+
+	    default:
+		l_TlmPayload[1] = TLM_ERR_CMD;
+		break;
+	}
+    }
+
+    l_TlmPayload[0] = cmd | TLM_RESPONSE;
+    cnt += 2;
+
+    crc = tlmCRC16 (l_TlmPayload, cnt);
+    l_TlmPayload[cnt++] = crc >> 8;
+    l_TlmPayload[cnt++] = crc & 0xFF;
+
+    /* Build the frame in place and send it */
+    pTlmFrame[0] = TLM_FRAME_START;
+    cnt = tlmEncode (l_TlmPayload, cnt, pTlmFrame + 1) + 1;
+    pTlmFrame[cnt++] = TLM_FRAME_END;
+
+    drvLEUART_write (pTlmFrame, cnt);
+
+    ScratchPut (pTlmFrame);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Decode a Frame
+ *
+ * This routine removes the XOR with @ref TLM_FRAME_END and the COBS encoding.
+ * The frame is decoded in place, since the decoded data is never longer than
+ * the encoded data.
+ *
+ * @param[in,out] pBuf
+ *	Encoded frame, receives the decoded data.
+ *
+ * @param[in] len
+ *	Number of bytes of the encoded frame.
+ *
+ * @return
+ *	Number of decoded bytes, or 0 if the encoding is invalid.
+ *
+ ******************************************************************************/
+static int	tlmDecode (uint8_t *pBuf, int len)
+{
+int	 in, out, code, i;
+
+
+    for (in = 0;  in < len;  in++)
+	pBuf[in] ^= TLM_FRAME_END;
+
+    for (in = out = 0;  in < len;  )
+    {
+	code = pBuf[in++];
+	if (code == 0  ||  in + code - 1 > len)
+	    return 0;		// invalid encoding
+
+	for (i = 1;  i < code;  i++)
+	    pBuf[out++] = pBuf[in++];
+
+	/* a code of 0xFF, or the end of the frame adds no 0 byte */
+	if (code != 0xFF  &&  in < len)
+	    pBuf[out++] = 0;
+    }
+
+    return out;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Encode a Frame
+ *
+ * This routine COBS encodes the data, and XORs every byte with
+ * @ref TLM_FRAME_END, so the encoded frame contains no delimiter.
+ *
+ * @param[in] pSrc
+ *	Data to encode.
+ *
+ * @param[in] len
+ *	Number of bytes to encode.
+ *
+ * @param[out] pDst
+ *	Buffer for the encoded frame, it must provide <b>len</b> bytes, plus
+ *	one byte for each block of 254 bytes, plus one.  It may overlap the
+ *	data, if <b>pSrc</b> is at least this overhead behind <b>pDst</b>.
+ *
+ * @return
+ *	Number of encoded bytes.
+ *
+ ******************************************************************************/
+static int	tlmEncode (const uint8_t *pSrc, int len, uint8_t *pDst)
+{
+int	 idxCode = 0;		// index of the current code byte
+int	 out = 1;
+int	 i;
+uint8_t	 code = 1;
+
+
+    while (len-- > 0)
+    {
+	if (*pSrc != 0)
+	{
+	    pDst[out++] = *pSrc;
+	    code++;
+	}
+
+	if (*pSrc++ == 0  ||  code == 0xFF)
+	{
+	    pDst[idxCode] = code;	// complete the current block
+	    idxCode = out++;
+	    code = 1;
+	}
+    }
+    pDst[idxCode] = code;
+
+    for (i = 0;  i < out;  i++)
+	pDst[i] ^= TLM_FRAME_END;
+
+    return out;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Calculate CRC-16/CCITT
+ *
+ * This routine calculates the CRC with polynomial 0x1021 and the initial
+ * value 0xFFFF bit by bit, which needs no table in flash.
+ *
+ * @param[in] pData
+ *	Data to calculate the CRC for.
+ *
+ * @param[in] len
+ *	Number of bytes.
+ *
+ * @return
+ *	CRC value.
+ *
+ ******************************************************************************/
+static uint16_t	tlmCRC16 (const uint8_t *pData, int len)
+{
+uint16_t crc = 0xFFFF;
+int	 i;
+
+
+    while (len-- > 0)
+    {
+	crc ^= (uint16_t)*pData++ << 8;
+	for (i = 0;  i < 8;  i++)
+	    crc = (crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1);
+    }
+
+    return crc;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Put a Value into the Payload
+ *
+ * This routine stores the specified number of bytes of a value, little
+ * endian, independent of the alignment of the destination.
+ *
+ * @param[out] pDst
+ *	Destination address.
+ *
+ * @param[in] value
+ *	Value to store.
+ *
+ * @param[in] size
+ *	Number of bytes to store, 1 to 4.
+ *
+ * @return
+ *	Address behind the stored value.
+ *
+ ******************************************************************************/
+static uint8_t *tlmPut (uint8_t *pDst, uint32_t value, int size)
+{
+    while (size-- > 0)
+    {
+	*pDst++ = value & 0xFF;
+	value >>= 8;
+    }
+
+    return pDst;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Counters
+ *
+ * This routine stores the current time, the error counters, and the battery
+ * status into the payload.
+ *
+ * @param[out] pData
+ *	Address of the data part of the payload.
+ *
+ * @return
+ *	Number of bytes stored.
+ *
+ ******************************************************************************/
+static int	tlmCounters (uint8_t *pData)
+{
+uint8_t	*pPut = pData;
+
+
+    pPut = tlmPut (pPut, (uint32_t)time (NULL), 4);
+    pPut = tlmPut (pPut, (uint32_t)g_PowerUpTime, 4);
+    pPut = tlmPut (pPut, g_LogErrorCnt, 4);
+    pPut = tlmPut (pPut, LogLostCount(), 4);
+    pPut = tlmPut (pPut, (uint16_t)g_BattMilliVolt, 2);
+    pPut = tlmPut (pPut, g_BattCapacity, 2);
+    pPut = tlmPut (pPut, g_LB_ActiveMask, 4);
+    pPut = tlmPut (pPut, drvLEUART_dropCount(), 4);
+
+    return pPut - pData;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Configuration Variables
+ *
+ * This routine stores as many configuration variables as fit into the
+ * payload, starting with index <b>first</b>.  The values are encoded as in
+ * the binary configuration image, see CfgVarInfo().
+ *
+ * @param[out] pData
+ *	Address of the data part of the payload.
+ *
+ * @param[in] first
+ *	Index of the first variable.
+ *
+ * @return
+ *	Number of bytes stored.
+ *
+ ******************************************************************************/
+static int	tlmConfig (uint8_t *pData, int first)
+{
+uint8_t	*pPut = pData + 2;
+const char *pName;
+int32_t	 value;
+int	 i, type, len;
+
+
+    for (i = first;  (type = CfgVarInfo (i, &pName, &value)) >= 0;  i++)
+    {
+	len = strlen (pName);
+	if (pPut + 6 + len > pData + TLM_PAYLOAD_MAX - 2)
+	    break;		// no more space, continue with next page
+
+	*pPut++ = type;
+	pPut = tlmPut (pPut, (uint32_t)value, 4);
+	*pPut++ = len;
+	memcpy (pPut, pName, len);
+	pPut += len;
+    }
+
+    /* total number of variables */
+    while (CfgVarInfo (i, &pName, &value) >= 0)
+	i++;
+
+    pData[0] = i;
+    pData[1] = first;
+
+    return pPut - pData;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Presence Table
+ *
+ * This routine stores the used entries of the presence table into the
+ * payload, starting with index <b>first</b>.
+ *
+ * @param[out] pData
+ *	Address of the data part of the payload.
+ *
+ * @param[in] first
+ *	Index of the first entry.
+ *
+ * @return
+ *	Number of bytes stored.
+ *
+ ******************************************************************************/
+static int	tlmPresence (uint8_t *pData, int first)
+{
+uint8_t	*pPut = pData + 2;
+RFID_PRESENCE entry;
+int	 i;
+
+
+    pData[0] = RFID_PRESENCE_SIZE;
+    pData[1] = first;
+
+    for (i = first;  RFID_PresenceGet (i, &entry);  i++)
+    {
+	if (pPut + 21 > pData + TLM_PAYLOAD_MAX - 2)
+	    break;		// no more space, continue with next page
+
+	if (entry.ID == 0)
+	    continue;		// skip unused entries
+
+	*pPut++ = i;
+	pPut = tlmPut (pPut, (uint32_t)entry.ID, 4);
+	pPut = tlmPut (pPut, (uint32_t)(entry.ID >> 32), 4);
+	pPut = tlmPut (pPut, (uint32_t)entry.FirstSeen, 4);
+	pPut = tlmPut (pPut, (uint32_t)entry.LastSeen, 4);
+	pPut = tlmPut (pPut, entry.ReadCnt, 4);
+    }
+
+    return pPut - pData;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	ISR Profile Statistics
+ *
+ * This routine stores the cycle statistics of the interrupt service routines
+ * into the payload, starting with index <b>first</b>, see @ref ISR_PROF_ID.
+ * The values are all 0 if @ref ISR_PROFILE is not enabled.
+ *
+ * @param[out] pData
+ *	Address of the data part of the payload.
+ *
+ * @param[in] first
+ *	Index of the first interrupt service routine.
+ *
+ * @return
+ *	Number of bytes stored.
+ *
+ ******************************************************************************/
+static int	tlmPerf (uint8_t *pData, int first)
+{
+uint8_t	*pPut = pData + 2;
+ISR_PROF prof;
+int	 i;
+
+
+    pData[0] = NUM_ISR_PROF;
+    pData[1] = first;
+
+    for (i = first;  i < NUM_ISR_PROF;  i++)
+    {
+	if (pPut + 20 > pData + TLM_PAYLOAD_MAX - 2)
+	    break;		// no more space, continue with next page
+
+#if ISR_PROFILE
+	/* get a consistent copy of the statistics */
+	INT_Disable();
+	prof = g_IsrProf[i];
+	INT_Enable();
+#else
+	memset (&prof, 0, sizeof(prof));
+#endif
+
+	pPut = tlmPut (pPut, prof.Cnt, 4);
+	pPut = tlmPut (pPut, prof.Min, 4);
+	pPut = tlmPut (pPut, prof.Max, 4);
+	pPut = tlmPut (pPut, (uint32_t)prof.Sum, 4);
+	pPut = tlmPut (pPut, (uint32_t)(prof.Sum >> 32), 4);
+    }
+
+    return pPut - pData;
+}
+
+
+#if TLM_FILE_EXPORT
+/***************************************************************************//**
+ *
+ * @brief	Directory of the SD-Card
+ *
+ * This routine stores as many entries of the specified directory as fit
+ * into the payload, starting with index <b>First</b> of the request.  The
+ * entries "." and ".." are skipped.
+ *
+ * @param[out] pData
+ *	Address of the data part of the payload.
+ *
+ * @param[in] pReq
+ *	Arguments of the request, First(2) and Path.
+ *
+ * @param[in] len
+ *	Number of bytes of the arguments.
+ *
+ * @return
+ *	Number of bytes stored.
+ *
+ ******************************************************************************/
+static int	tlmDir (uint8_t *pData, const uint8_t *pReq, int len)
+{
+uint8_t	*pPut = pData + 2;
+char	 path[TLM_PATH_MAX + 1];
+DIR	 dir;
+FILINFO	 fno;
+FRESULT	 res;
+int	 first, idx, nameLen;
+
+
+    if (len < 2)
+	return 0;		// no index, just an empty directory
+
+    first = pReq[0] | (pReq[1] << 8);
+    idx = 0;
+
+    res = tlmFileAccess (path, pReq + 2, len - 2);
+    if (res == FR_OK)
+    {
+	res = f_opendir (&dir, path);
+
+	while (res == FR_OK)
+	{
+	    res = f_readdir (&dir, &fno);
+	    if (res != FR_OK  ||  fno.fname[0] == EOS)
+	    {
+		idx = 0;		// end of directory
+		break;
+	    }
+
+	    if (idx++ < first  ||  fno.fname[0] == '.')
+		continue;
+
+	    nameLen = strlen (fno.fname);
+	    if (pPut + 6 + nameLen > pData + TLM_PAYLOAD_MAX - 2)
+	    {
+		idx--;		// continue with this entry on the next page
+		break;
+	    }
+
+	    *pPut++ = fno.fattrib;
+	    pPut = tlmPut (pPut, fno.fsize, 4);
+	    *pPut++ = nameLen;
+	    memcpy (pPut, fno.fname, nameLen);
+	    pPut += nameLen;
+	}
+
+	DiskRelease (res == FR_OK);
+    }
+
+    if (res != FR_OK)
+    {
+	l_TlmPayload[1] = TLM_ERR_FILE;
+	pData[0] = res;
+	return 1;
+    }
+
+    tlmPut (pData, idx, 2);
+
+    return pPut - pData;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Chunk of a File
+ *
+ * This routine reads as many bytes of the specified file as fit into the
+ * payload, starting at the byte <b>Offset</b> of the request.  The file is
+ * opened and closed again for each chunk, so it may still grow, e.g. the
+ * current log file.  The file handle is borrowed from the logging module,
+ * see LogFileHandleGet().
+ *
+ * @param[out] pData
+ *	Address of the data part of the payload.
+ *
+ * @param[in] pReq
+ *	Arguments of the request, Offset(4) and Path.
+ *
+ * @param[in] len
+ *	Number of bytes of the arguments.
+ *
+ * @return
+ *	Number of bytes stored.
+ *
+ ******************************************************************************/
+static int	tlmFileRead (uint8_t *pData, const uint8_t *pReq, int len)
+{
+char	 path[TLM_PATH_MAX + 1];
+uint32_t offset;
+FIL	*pFh;
+FRESULT	 res;
+UINT	 cnt = 0;
+
+
+    if (len < 4)
+	return 0;		// no offset, no data
+
+    offset = pReq[0] | (pReq[1] << 8) | (pReq[2] << 16)
+	   | ((uint32_t)pReq[3] << 24);
+
+    res = tlmFileAccess (path, pReq + 4, len - 4);
+    if (res == FR_OK)
+    {
+	pFh = LogFileHandleGet();
+	if (pFh == NULL)
+	    res = FR_LOCKED;		// file handle is in use
+	else
+	    res = f_open (pFh, path, FA_READ);
+	if (res == FR_OK)
+	{
+	    if (offset < f_size(pFh))
+	    {
+		res = f_lseek (pFh, offset);
+		if (res == FR_OK)
+		    res = f_read (pFh, pData + 8,
+				  TLM_PAYLOAD_MAX - 2 - 8, &cnt);
+	    }
+	    tlmPut (pData, f_size(pFh), 4);
+	    f_close (pFh);
+	}
+	if (pFh != NULL)
+	    LogFileHandlePut (pFh);
+
+	DiskRelease (res == FR_OK);
+    }
+
+    if (res != FR_OK)
+    {
+	l_TlmPayload[1] = TLM_ERR_FILE;
+	pData[0] = res;
+	return 1;
+    }
+
+    tlmPut (pData + 4, offset, 4);
+
+    return 8 + cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Prepare a File Access
+ *
+ * This routine copies the path of a request as string, and switches the
+ * SD-Card on.  If it succeeds, DiskRelease() must be called afterwards.
+ *
+ * @param[out] pPath
+ *	Buffer for the path, @ref TLM_PATH_MAX + 1 characters.
+ *
+ * @param[in] pReq
+ *	Path in the request, not terminated.
+ *
+ * @param[in] len
+ *	Length of the path.
+ *
+ * @return
+ *	FR_OK if the file system can be accessed.
+ *
+ ******************************************************************************/
+static FRESULT	tlmFileAccess (char *pPath, const uint8_t *pReq, int len)
+{
+    if (len > TLM_PATH_MAX)
+	return FR_INVALID_NAME;
+
+    memcpy (pPath, pReq, len);
+    pPath[len] = EOS;
+
+    if (IsPowerFail()  ||  IsDiskRemoved())
+	return FR_NOT_READY;
+
+    if (DiskAcquire() != 0)
+    {
+	DiskRelease (false);
+	return FR_NOT_READY;
+    }
+
+    return FR_OK;
+}
+#endif	// TLM_FILE_EXPORT
+
+#endif	// TELEMETRY
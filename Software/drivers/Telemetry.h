@@ -0,0 +1,92 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Telemetry.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Reduced TLM_PAYLOAD_MAX to 192, the frame is a scratch block.
+2026-10-15,agnt	Added TLM_FILE_EXPORT, TLM_PATH_MAX, TLM_CMD_DIR,
+		TLM_CMD_FILE_READ, and TLM_ERR_FILE.
+2026-10-14,agnt	Initial version.
+*/
+
+#ifndef __INC_Telemetry_h
+#define __INC_Telemetry_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to enable the binary telemetry protocol on the
+ * LEUART console, see module Telemetry.c.
+ */
+#ifndef TELEMETRY
+    #define TELEMETRY		0
+#endif
+
+/*!@brief Maximum size of the payload of a response frame in bytes, without
+ * the CRC.  The encoded frame must fit into a scratch block, see
+ * @ref SCRATCH_BLOCK_SIZE.
+ */
+#ifndef TLM_PAYLOAD_MAX
+    #define TLM_PAYLOAD_MAX	192
+#endif
+
+/*!@brief Set this define 1 to enable the commands @ref TLM_CMD_DIR and
+ * @ref TLM_CMD_FILE_READ, which export the files of the SD-Card without
+ * removing it.  This needs RAM for one more file handle.
+ */
+#ifndef TLM_FILE_EXPORT
+    #define TLM_FILE_EXPORT	0
+#endif
+
+/*!@brief Maximum length of a path in a request.  The whole request frame must
+ * fit into the command line buffer of the LEUART.
+ */
+#define TLM_PATH_MAX		28
+
+/*!@brief First byte of a telemetry frame, it never starts a text command. */
+#define TLM_FRAME_START		0x01
+
+/*!@brief Frame delimiter, this is the \<LF> of a command line. */
+#define TLM_FRAME_END		'\n'
+
+/*!@brief Version of the protocol, returned by @ref TLM_CMD_PING. */
+#define TLM_VERSION		1
+
+/*!@brief Telemetry commands, the response has bit 7 set. */
+typedef enum
+{
+    TLM_CMD_PING,		//!< 0x00: Protocol and firmware version
+    TLM_CMD_COUNTERS,		//!< 0x01: Time, error and battery counters
+    TLM_CMD_CONFIG,		//!< 0x02: Configuration variables, from index
+    TLM_CMD_PRESENCE,		//!< 0x03: Presence table, from index
+    TLM_CMD_PERF,		//!< 0x04: ISR profile statistics, from index
+    TLM_CMD_LOG_TAIL,		//!< 0x05: Text of the most recent log messages
+    TLM_CMD_DIR,		//!< 0x06: Directory of the SD-Card, from index
+    TLM_CMD_FILE_READ,		//!< 0x07: Chunk of a file, from offset
+    NUM_TLM_CMD
+} TLM_CMD;
+
+/*!@brief Status byte of a response. */
+typedef enum
+{
+    TLM_OK,			//!< Request has been executed
+    TLM_ERR_CMD,		//!< Unknown command
+    TLM_ERR_FRAME,		//!< Invalid encoding, or CRC error
+    TLM_ERR_FILE,		//!< SD-Card or file access failed
+} TLM_STATUS;
+
+/*================================ Prototypes ================================*/
+
+    /* Handle a telemetry request frame received via the console */
+void	TelemetryRequest (uint8_t *pFrame, int len);
+
+
+#endif /* __INC_Telemetry_h */
@@ -0,0 +1,474 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Temperature Compensation of the LFXO
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * The RTC is clocked by a 32768Hz tuning fork crystal.  Its frequency is
+ * highest at the turnover temperature @ref TEMP_COMP_TURNOVER, and drops
+ * with the square of the distance to it, i.e. by about 0.034ppm/°C².  At
+ * -10°C the clock loses 3.6 seconds per day, which is why the DCF77 receiver
+ * must synchronize it so often.  This module measures the temperature with
+ * the on-chip sensor of the EFM32 every @ref TEMP_COMP_INTERVAL seconds, and
+ * calculates the drift of the crystal by the parabolic model
+ * @code
+ * drift [ppb] = TEMP_COMP_OFFSET - TEMP_COMP_COEFF * (T - TEMP_COMP_TURNOVER)²
+ * @endcode
+ * The mean drift of two consecutive samples, multiplied by the RTC ticks of
+ * the monotonic clock in between, is the error of the time base.  Whole
+ * ticks are corrected via ClockAdjust(), which only changes the tick offset
+ * of time() in clock.c, the RTC keeps running.  The fraction of a tick is
+ * kept for the next period, so the correction does not lose precision.
+ *
+ * The temperature sensor is calibrated in the production, see DEVINFO.  If
+ * this data is missing, the compensation is off.  With
+ * @ref DCF77_ADAPTIVE_SYNC, the DCF77 synchronization only measures the
+ * residual error, which extends the interval to the next synchronization.
+ * The correction since the previous synchronization is logged along with
+ * the deviation, see TempCompSyncMs(), so the model can be verified.
+ *
+ * Once a day, i.e. after the samples of 24 hours, a summary is logged, e.g.
+ * @code
+ * TempComp: 4.5C (min -2.0C, max 8.5C), drift -14.29ppm, corrected 1120ms
+ * @endcode
+ * The console command "TC" shows the current values.
+ *
+ * A precise time source like the GPS receiver measures the residual drift
+ * after the compensation.  It is fed back via TempCompTrim(), which moves
+ * the frequency offset of the model, i.e. it calibrates
+ * @ref TEMP_COMP_OFFSET of the particular crystal over time.  The trim is
+ * kept in the internal flash with the daily summary, see ParamStore.c, so
+ * the calibration is not lost by a power-on reset.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Registered TempCompCheck() as task of the main loop, see
+		TASK_REGISTER().
+2026-10-15,agnt	The trim of the model is saved in the parameter store.
+2026-10-15,agnt	Added TempCompTrim() to correct the frequency offset of the
+		model by the residual drift, which is measured by the GPS
+		receiver.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_int.h"
+#include "em_cmu.h"
+#include "AlarmClock.h"
+#include "TempComp.h"
+#include "ClockMgr.h"
+#include "LEUART.h"
+#include "ParamStore.h"
+#include "Logging.h"
+#include "StrFormat.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Gradient of the temperature sensor in [1/100 LSB/°C] for the
+     * 1.25V reference and 12 bit resolution, i.e. -1.92mV/°C. */
+#define TC_GRADIENT		629
+
+    /*! Number of status polls until the ADC conversion must be done. */
+#define TC_ADC_TIMEOUT		5000
+
+    /*! Value of @ref l_Temp if no temperature has been measured yet. */
+#define TC_TEMP_UNKNOWN		(-32768)
+
+    /*! Number of samples after which a summary is logged. */
+#define TC_SAMPLES_PER_DAY	(24 * 3600 / TEMP_COMP_INTERVAL)
+
+    /*! Denominator of a drift in [ppb]. */
+#define TC_PPB			1000000000LL
+
+/*================================ Local Data ================================*/
+
+    /*! Timer handle for the sample interval. */
+static TIM_HDL	l_thTempComp = NONE;
+
+    /*! Flag set by TempCompTrigger(), handled by TempCompCheck(). */
+static volatile bool l_flgSample;
+
+    /*! Calibration temperature in [°C] and the ADC value measured there. */
+static int32_t	l_CalTemp;
+static int32_t	l_CalValue;
+
+    /*! Last temperature in [0.1°C], and the minimum and maximum since the
+     * last summary. */
+static int32_t	l_Temp = TC_TEMP_UNKNOWN;
+static int32_t	l_TempMin, l_TempMax;
+
+    /*! Drift of the crystal in [ppb] at the last temperature. */
+static int32_t	l_DriftPpb;
+
+    /*! Correction of the frequency offset in [ppb], see TempCompTrim(). */
+static volatile int32_t	l_TrimPpb;
+
+    /*! Monotonic clock of the last sample. */
+static uint64_t	l_LastTicks;
+
+    /*! Correction which has not been applied yet, in [10^-9 ticks]. */
+static int64_t	l_Residue;
+
+    /*! Corrected RTC ticks since the last summary and since the last call
+     * of TempCompSyncMs(). */
+static int32_t	l_CorrTicks;
+static volatile int32_t	l_SyncTicks;
+
+    /*! Number of samples since the last summary, and failed conversions. */
+static uint16_t	l_SampleCnt;
+static uint16_t	l_ErrorCnt;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	TempCompTrigger (TIM_HDL hdl);
+static int32_t	tcTemperature (void);
+static int32_t	tcDrift (int32_t temp);
+static int	tcTempStr (char *pBuf, int32_t temp);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Temperature Compensation
+ *
+ * This routine must be called once after AlarmClockInit().  It reads the
+ * calibration data of the temperature sensor and the saved trim of the
+ * model, and starts the sample timer.
+ * The first sample is taken by the main loop right away, it only serves as
+ * reference for the next one.
+ *
+ ******************************************************************************/
+void	TempCompInit (void)
+{
+uint32_t trim;
+
+    if (ParamGet (PARAM_TC_TRIM, &trim))
+	TempCompTrim ((int32_t)trim);
+
+    l_CalTemp  = (DEVINFO->CAL & _DEVINFO_CAL_TEMP_MASK)
+		 >> _DEVINFO_CAL_TEMP_SHIFT;
+    l_CalValue = (DEVINFO->ADC0CAL2 & _DEVINFO_ADC0CAL2_TEMP1V25_MASK)
+		 >> _DEVINFO_ADC0CAL2_TEMP1V25_SHIFT;
+
+    /* Without calibration data the compensation remains off */
+    if (l_CalValue == 0  ||  l_CalValue == 0xFFF  ||  l_CalTemp == 0xFF)
+	return;
+
+    if (l_thTempComp == NONE)
+    {
+	l_thTempComp = sTimerCreate (TempCompTrigger);
+	if (l_thTempComp == NONE)
+	    return;
+    }
+    sTimerStart (l_thTempComp, TEMP_COMP_INTERVAL);
+
+    l_flgSample = true;
+    EVENT_POST(EVT_TEMP_COMP);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Temperature Compensation Check
+ *
+ * This routine is called from the main loop via EVENT_POST(EVT_TEMP_COMP).
+ * If the sample interval is over, it measures the temperature, and corrects
+ * the time base by the drift since the previous sample.  A failed
+ * conversion is skipped, the next sample covers the whole period then.
+ *
+ ******************************************************************************/
+void	TempCompCheck (void)
+{
+int32_t	 temp, drift, ticks;
+uint64_t now;
+
+    if (! l_flgSample)
+	return;
+
+    l_flgSample = false;
+
+    temp = tcTemperature();
+    now  = ClockMonoTicks();
+    if (temp == TC_TEMP_UNKNOWN)
+    {
+	l_ErrorCnt++;
+	return;
+    }
+
+    drift = tcDrift (temp);
+
+    if (l_Temp == TC_TEMP_UNKNOWN)
+    {
+	l_TempMin = l_TempMax = temp;
+    }
+    else
+    {
+	/* A lower frequency lets the clock lag, so it must be advanced */
+	l_Residue -= (int64_t)(now - l_LastTicks) * (l_DriftPpb + drift) / 2;
+	ticks = (int32_t)(l_Residue / TC_PPB);
+	if (ticks != 0)
+	{
+	    l_Residue -= (int64_t)ticks * TC_PPB;
+	    ClockAdjust (ticks);
+
+	    INT_Disable();
+	    l_CorrTicks += ticks;
+	    l_SyncTicks += ticks;
+	    INT_Enable();
+	}
+
+	if (temp < l_TempMin)
+	    l_TempMin = temp;
+	if (temp > l_TempMax)
+	    l_TempMax = temp;
+    }
+
+    l_Temp = temp;
+    l_DriftPpb = drift;
+    l_LastTicks = now;
+
+    if (++l_SampleCnt >= TC_SAMPLES_PER_DAY)
+	TempCompReport (true);
+}
+#if TEMP_COMP
+TASK_REGISTER(TASK_PRIO_TEMP_COMP, EVT_TEMP_COMP, TempCompCheck);
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Correction since the last Synchronization
+ *
+ * This routine is called by the DCF77 module before the system clock is
+ * set.  It returns the correction since its previous call, and starts over.
+ * It may be called in interrupt context.
+ *
+ * @return
+ *	Correction in [ms], positive if the clock has been advanced.
+ *
+ ******************************************************************************/
+int32_t	TempCompSyncMs (void)
+{
+int32_t	ticks;
+
+    INT_Disable();
+    ticks = l_SyncTicks;
+    l_SyncTicks = 0;
+    INT_Enable();
+
+    return ticks * 1000 / RTC_COUNTS_PER_SEC;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Trim the Model
+ *
+ * This routine is called by a time source which measures the residual drift
+ * of the compensated clock, see GPS.c.  The value is added to the frequency
+ * offset of the model, limited to @ref TEMP_COMP_TRIM_MAX.  It takes effect
+ * with the next sample.  It may be called in interrupt context.
+ *
+ * @param[in] ppb
+ *	Correction in [ppb], negative if the clock still lags.
+ *
+ ******************************************************************************/
+void	TempCompTrim (int32_t ppb)
+{
+int32_t	trim = l_TrimPpb + ppb;
+
+    if (trim > TEMP_COMP_TRIM_MAX)
+	trim = TEMP_COMP_TRIM_MAX;
+    else if (trim < -TEMP_COMP_TRIM_MAX)
+	trim = -TEMP_COMP_TRIM_MAX;
+
+    l_TrimPpb = trim;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Temperature Compensation
+ *
+ * This routine generates one line with the last temperature, its minimum
+ * and maximum, the drift of the crystal there, and the correction since
+ * the last summary, see the module description.  A new trim of the model
+ * is saved with the logged summary.
+ *
+ * @param[in] flgLog
+ *	If true, the line is logged and the summary starts over.  If false, it
+ *	is only shown on the debug console.
+ *
+ ******************************************************************************/
+void	TempCompReport (bool flgLog)
+{
+char	line[120];
+int	len;
+int32_t	drift;
+
+    len = StrFormat (line, "TempComp: ");
+
+    if (l_thTempComp == NONE)
+    {
+	StrFormat (line + len, "No calibration data of the temperature sensor");
+    }
+    else if (l_Temp == TC_TEMP_UNKNOWN)
+    {
+	StrFormat (line + len, "No temperature measured, %d ADC errors",
+		   l_ErrorCnt);
+    }
+    else
+    {
+	drift = (l_DriftPpb < 0 ? -l_DriftPpb : l_DriftPpb) / 10;
+	len += tcTempStr (line + len, l_Temp);
+	len += StrFormat (line + len, " (min ");
+	len += tcTempStr (line + len, l_TempMin);
+	len += StrFormat (line + len, ", max ");
+	len += tcTempStr (line + len, l_TempMax);
+	len += StrFormat (line + len, "), drift %s%ld.%02ldppm, corrected %ldms",
+			  l_DriftPpb < 0 ? "-" : "", drift / 100, drift % 100,
+			  l_CorrTicks * 1000 / RTC_COUNTS_PER_SEC);
+	if (l_TrimPpb != 0)
+	    len += StrFormat (line + len, ", trim %ldppb", l_TrimPpb);
+	if (l_ErrorCnt > 0)
+	    StrFormat (line + len, ", %d ADC errors", l_ErrorCnt);
+    }
+
+    if (flgLog)
+    {
+	Log (line);
+	ParamSet (PARAM_TC_TRIM, (uint32_t)l_TrimPpb);
+	l_TempMin = l_TempMax = l_Temp;
+	l_CorrTicks = 0;
+	l_SampleCnt = 0;
+	l_ErrorCnt = 0;
+    }
+    else
+    {
+	drvLEUART_puts (line);
+	drvLEUART_puts ("\n");
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Sample Timer Routine
+ *
+ * This routine is called by the sTimer after @ref TEMP_COMP_INTERVAL.  It
+ * triggers the next sample in TempCompCheck().
+ *
+ ******************************************************************************/
+static void	TempCompTrigger (TIM_HDL hdl)
+{
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    /* Restart the timer */
+    sTimerStart (l_thTempComp, TEMP_COMP_INTERVAL);
+
+    l_flgSample = true;
+    EVENT_POST(EVT_TEMP_COMP);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Measure the Temperature
+ *
+ * This routine measures the on-chip temperature sensor with the ADC and the
+ * internal 1.25V reference.  Interrupts are disabled during the conversion,
+ * since PowerFailSupply() uses the ADC in interrupt context.
+ *
+ * @return
+ * 	Temperature in [0.1°C], or @ref TC_TEMP_UNKNOWN if the conversion did
+ * 	not complete.
+ *
+ ******************************************************************************/
+static int32_t	tcTemperature (void)
+{
+uint32_t freq;			// HFPERCLK in [MHz]
+int32_t	 data = TC_TEMP_UNKNOWN;
+int	 i;
+
+    ClockAcquire (CLK_OWN_TEMP, cmuClock_ADC0);
+
+    /* 1us time base for the warm-up, ADC clock about 1MHz */
+    freq = (CMU_ClockFreqGet (cmuClock_HFPER) + 999999) / 1000000;
+    if (freq < 1)
+	freq = 1;
+
+    INT_Disable();
+
+    ADC0->CTRL = ADC_CTRL_WARMUPMODE_NORMAL
+	       | (((freq - 1) << _ADC_CTRL_TIMEBASE_SHIFT) & _ADC_CTRL_TIMEBASE_MASK)
+	       | (((freq - 1) << _ADC_CTRL_PRESC_SHIFT) & _ADC_CTRL_PRESC_MASK);
+
+    ADC0->SINGLECTRL = ADC_SINGLECTRL_INPUTSEL_TEMP
+		     | ADC_SINGLECTRL_REF_1V25
+		     | ADC_SINGLECTRL_RES_12BIT
+		     | ADC_SINGLECTRL_AT_256CYCLES;
+
+    ADC0->CMD = ADC_CMD_SINGLESTART;
+
+    for (i = 0;  i < TC_ADC_TIMEOUT;  i++)
+    {
+	if (ADC0->STATUS & ADC_STATUS_SINGLEDV)
+	{
+	    data = ADC0->SINGLEDATA & 0xFFF;
+	    break;
+	}
+    }
+
+    INT_Enable();
+
+    ClockRelease (CLK_OWN_TEMP, cmuClock_ADC0);
+
+    if (data == TC_TEMP_UNKNOWN)
+	return TC_TEMP_UNKNOWN;
+
+    /* The voltage of the sensor decreases with the temperature */
+    return l_CalTemp * 10 + (l_CalValue - data) * 1000 / TC_GRADIENT;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Drift of the Crystal
+ *
+ * @param[in] temp
+ *	Temperature in [0.1°C].
+ *
+ * @return
+ *	Frequency deviation in [ppb] according to the parabolic model,
+ *	including the trim of TempCompTrim().
+ *
+ ******************************************************************************/
+static int32_t	tcDrift (int32_t temp)
+{
+int32_t	dist = temp - TEMP_COMP_TURNOVER * 10;
+
+    return TEMP_COMP_OFFSET + l_TrimPpb - TEMP_COMP_COEFF * dist * dist / 100;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Format a Temperature
+ *
+ * @param[out] pBuf
+ *	Buffer for the string, e.g. "-2.5C".
+ *
+ * @param[in] temp
+ *	Temperature in [0.1°C].
+ *
+ * @return
+ *	Number of characters stored in the buffer.
+ *
+ ******************************************************************************/
+static int	tcTempStr (char *pBuf, int32_t temp)
+{
+int32_t	value = (temp < 0 ? -temp : temp);
+
+    return StrFormat (pBuf, "%s%ld.%ldC", temp < 0 ? "-" : "",
+		      value / 10, value % 10);
+}
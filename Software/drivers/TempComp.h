@@ -0,0 +1,84 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module TempComp.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Added TEMP_COMP_TRIM_MAX and prototype for TempCompTrim().
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_TempComp_h
+#define __INC_TempComp_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to compensate the temperature drift of the LFXO
+ * by the on-chip temperature sensor, see TempComp.c.  It requires
+ * @ref RTC_TICKLESS.
+ */
+#ifndef TEMP_COMP
+    #define TEMP_COMP		0
+#endif
+
+/*!@brief Interval in [s] between two temperature samples. */
+#ifndef TEMP_COMP_INTERVAL
+    #define TEMP_COMP_INTERVAL	600
+#endif
+
+/*!@brief Turnover temperature of the tuning fork crystal in [°C], i.e. the
+ * temperature of its highest frequency.
+ */
+#ifndef TEMP_COMP_TURNOVER
+    #define TEMP_COMP_TURNOVER	25
+#endif
+
+/*!@brief Parabolic coefficient of the crystal in [ppb/°C²], the frequency
+ * is lower by this value times the square of the distance to
+ * @ref TEMP_COMP_TURNOVER.  The typical value is 0.034ppm/°C².
+ */
+#ifndef TEMP_COMP_COEFF
+    #define TEMP_COMP_COEFF	34
+#endif
+
+/*!@brief Frequency offset of the crystal at the turnover temperature in
+ * [ppb], e.g. the calibration tolerance of a particular board.
+ */
+#ifndef TEMP_COMP_OFFSET
+    #define TEMP_COMP_OFFSET	0
+#endif
+
+/*!@brief Maximum correction of the model in [ppb] by an external time
+ * reference, see TempCompTrim().
+ */
+#ifndef TEMP_COMP_TRIM_MAX
+    #define TEMP_COMP_TRIM_MAX	20000
+#endif
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize the temperature compensation */
+void	TempCompInit (void);
+
+    /* Sample the temperature and adjust the clock if the interval is over */
+void	TempCompCheck (void);
+
+    /* Correction in [ms] since the last call, for the DCF77 synchronization */
+int32_t	TempCompSyncMs (void);
+
+    /* Correct the model by the drift measured against a time reference */
+void	TempCompTrim (int32_t ppb);
+
+    /* Show or log the temperature and the drift */
+void	TempCompReport (bool flgLog);
+
+
+#endif /* __INC_TempComp_h */
@@ -0,0 +1,137 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Playback Throttling per Transponder ID
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * A bird which stays at the feeder triggers ControlUpdateID() again and
+ * again, and each time the Audio module starts another playback.  This
+ * wastes energy and weakens the stimulus.  With @ref PLAY_THROTTLE, each
+ * transponder ID has a token bucket of PLAYBACK_BURST tokens, i.e. that
+ * many playbacks in a row, which is refilled by one token per PLAYBACK_RATE.
+ * ControlUpdateID() calls ThrottleCheck() before any Audio command is
+ * queued, and suppresses the playback if the bucket is empty.  The burst
+ * may be set per ID entry of the configuration file, see CfgParse().
+ *
+ * The bucket is not stored as number of tokens, but as the time when it is
+ * full again.  So a check needs neither a timer nor a loop over the elapsed
+ * intervals.  The buckets are kept in a direct-mapped table of
+ * @ref THROTTLE_SLOTS entries, which is indexed by a hash of the ID, so the
+ * check takes constant time.  If two IDs share a slot, the newer ID starts
+ * with a full bucket, i.e. throttling fails open rather than blocking a bird
+ * which has not been seen before.  A slot only keeps the ID folded to 32
+ * bits, since two IDs of the same slot must also match in their fold to
+ * share a bucket.
+ *
+ * Without PLAYBACK_RATE, ThrottleCheck() always returns true.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	A slot keeps the folded 32bit ID instead of the 64bit ID.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <time.h>
+#include "Throttle.h"
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Token bucket of a transponder ID. */
+typedef struct
+{
+    uint32_t	Tag;		//!< folded transponder ID of this slot
+    time_t	Full;		//!< time when the bucket is full again
+} THROTTLE_SLOT;
+
+/*================================ Global Data ===============================*/
+
+    /*!@brief Refill interval of one token in [ms], 0 is off. */
+int32_t		g_PlaybackRate;
+
+    /*!@brief Size of the token bucket, i.e. playbacks in a row. */
+int32_t		g_PlaybackBurst = DFLT_PLAYBACK_BURST;
+
+/*================================ Local Data ================================*/
+
+    /*! Table of the token buckets, indexed by ThrottleHash() */
+static THROTTLE_SLOT l_Slot[THROTTLE_SLOTS];
+
+/*=========================== Forward Declarations ===========================*/
+
+static int	ThrottleHash (uint32_t tag);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if a Transponder ID may start another Playback
+ *
+ * This routine takes one token from the bucket of the specified ID.  The
+ * bucket holds up to <b>burst</b> tokens and gets one token back per
+ * PLAYBACK_RATE.  With <b>Full</b> being the time when the bucket is full,
+ * there are (Full - now) / PLAYBACK_RATE tokens missing.
+ *
+ * @param[in] id
+ *	Transponder ID, may also be @ref ID_UNKNOWN.
+ *
+ * @param[in] burst
+ *	Size of the bucket of this ID, 0 means no playback at all.
+ *
+ * @return
+ *	The value <i>true</i> if the playback may be started, <i>false</i> if
+ *	the bucket is empty.
+ *
+ ******************************************************************************/
+bool	ThrottleCheck (TRANSPONDER_ID id, int32_t burst)
+{
+THROTTLE_SLOT *pSlot;
+time_t	 now, rate;
+uint32_t tag;
+
+    if (g_PlaybackRate <= 0)
+	return true;		// throttling is off
+
+    rate  = (g_PlaybackRate + 999) / 1000;	// [s], at least 1
+    now   = time (NULL);
+    tag   = (uint32_t)id ^ (uint32_t)(id >> 32);
+    pSlot = &l_Slot[ThrottleHash (tag)];
+
+    /* another ID, a full bucket, or the clock has been set back */
+    if (pSlot->Tag != tag  ||  pSlot->Full < now
+    ||  pSlot->Full - now > (time_t)burst * rate)
+    {
+	pSlot->Tag = tag;
+	pSlot->Full = now;
+    }
+
+    /* at least one token must be left */
+    if (pSlot->Full - now > (time_t)(burst - 1) * rate)
+	return false;
+
+    pSlot->Full += rate;
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Slot of a Transponder ID
+ *
+ * This routine spreads the folded 64bit ID by a multiplicative hash, since
+ * the IDs of one batch differ only in a few digits.
+ *
+ * @param[in] tag
+ *	Transponder ID, folded to 32 bits.
+ *
+ * @return
+ *	Index of the slot in @ref l_Slot.
+ *
+ ******************************************************************************/
+static int	ThrottleHash (uint32_t tag)
+{
+uint32_t h = tag;
+
+    h *= 0x9E3779B1;		// 2^32 / golden ratio
+    return (int)(h >> 16) & (THROTTLE_SLOTS - 1);
+}
@@ -0,0 +1,62 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module Throttle.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Reduced THROTTLE_SLOTS to 8.
+2026-10-15,agnt	Reduced THROTTLE_SLOTS to 16.
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_Throttle_h
+#define __INC_Throttle_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdbool.h>
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to limit the playbacks per transponder ID by a
+ * token bucket, see Throttle.c.  It is only active if the configuration
+ * variable PLAYBACK_RATE is set.
+ */
+#ifndef PLAY_THROTTLE
+    #define PLAY_THROTTLE	0
+#endif
+
+/*!@brief Number of transponder IDs whose token bucket is kept, must be a
+ * power of 2.  Each slot needs 8 bytes of RAM.  Only the birds which come
+ * back within PLAYBACK_RATE compete for the slots, and a collision lets a
+ * playback pass, see Throttle.c.
+ */
+#ifndef THROTTLE_SLOTS
+    #define THROTTLE_SLOTS	8
+#endif
+
+#if THROTTLE_SLOTS & (THROTTLE_SLOTS - 1)
+    #error "THROTTLE_SLOTS must be a power of 2"
+#endif
+
+/*!@brief Default number of playbacks in a row, see configuration variable
+ * PLAYBACK_BURST.
+ */
+#ifndef DFLT_PLAYBACK_BURST
+    #define DFLT_PLAYBACK_BURST	1
+#endif
+
+/*======================== External Data and Routines ========================*/
+
+extern int32_t	g_PlaybackRate;		// [ms] per token, 0 is off
+extern int32_t	g_PlaybackBurst;	// size of the token bucket
+
+/*================================ Prototypes ================================*/
+
+    /* Check if a transponder ID may start another playback */
+bool	ThrottleCheck (TRANSPONDER_ID id, int32_t burst);
+
+
+#endif /* __INC_Throttle_h */
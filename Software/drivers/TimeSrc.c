@@ -0,0 +1,274 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Time Source Interface
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module decouples the system clock from the receiver which provides
+ * the time.  A time source is described by a @ref TIME_SRC structure with
+ * routines to initialize, enable, and disable it.  The source is selected by
+ * @ref TIME_SOURCE at compile time, since the receivers share the same pins:
+ * - @ref TIME_SRC_DCF77 is the DCF77 long wave receiver, see DCF77.c.  It
+ *   sets the clock to the second.
+ * - @ref TIME_SRC_GPS is a GPS receiver, see GPS.c.  The time is taken from
+ *   its NMEA data, and the phase of the clock is aligned with the PPS
+ *   (pulse per second) signal to a few RTC ticks.
+ *
+ * Whenever a source has received a valid time, it calls TimeSrcSync().  This
+ * routine corrects the system clock and handles the change between MEZ and
+ * MESZ, i.e. all alarm times are moved by one hour to still occur at the same
+ * effective time.  Sources which provide UTC can use TimeSrcLocalTime() to
+ * convert it into MEZ or MESZ by the rules of the European Union.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	TimeSrcSync: Small offsets up to CLOCK_SLEW_MAX_MS are slewed
+		by ClockSlew(), the clock is only set if the offset is larger,
+		at the first synchronization, or when the time zone changes.
+2026-10-15,agnt	TimeSrcSync: Save the time of the synchronization for a warm
+		restart, see WarmStartSave().
+2026-10-15,agnt	Initial version, TimeSrcSync() is based on TimeSynchronize()
+		of DCF77.c.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include "em_device.h"
+#include "em_assert.h"
+#include "AlarmClock.h"
+#include "Logging.h"
+#include "TimeSrc.h"
+#include "WarmStart.h"
+
+/*================================ Local Data ================================*/
+
+    /*! Selected time source. */
+#if TIME_SOURCE == TIME_SRC_GPS
+static const TIME_SRC	*l_pTimeSrc = &g_TimeSrcGPS;
+#else
+static const TIME_SRC	*l_pTimeSrc = &g_TimeSrcDCF77;
+#endif
+
+/*=========================== Forward Declarations ===========================*/
+
+static time_t	tsLastSunday (int year, int mon);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Time Source
+ *
+ * This routine initializes the hardware of the time source which has been
+ * selected by @ref TIME_SOURCE.  Call TimeSrcEnable() after the EXTIs have
+ * been initialized to start the first synchronization.
+ *
+ ******************************************************************************/
+void	TimeSrcInit (void)
+{
+    l_pTimeSrc->Init();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Enable the Time Source
+ *
+ * This routine powers the receiver on and starts a synchronization.  It is
+ * switched off again by the time source itself, depending on its settings.
+ *
+ ******************************************************************************/
+void	TimeSrcEnable (void)
+{
+    l_pTimeSrc->Enable();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Disable the Time Source
+ *
+ * This routine powers the receiver off, e.g. before a reboot.
+ *
+ ******************************************************************************/
+void	TimeSrcDisable (void)
+{
+    l_pTimeSrc->Disable();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Time Synchronization
+ *
+ * This function is called by the time source when it has received a valid
+ * time.  It sets the system clock via ClockSet() and updates the display
+ * with the new time.  If @ref CLOCK_SLEW is enabled and the offset of the
+ * system clock is below @ref CLOCK_SLEW_MAX_MS, it is absorbed by ClockSlew()
+ * instead, so the time base remains monotonic.
+ * It also checks for a change of MEZ to MESZ and vice versa.  If this happens,
+ * all configured alarm times will be adjusted accordingly.  This includes the
+ * @ref ALARM_DCF77_WAKE_UP, so a daily synchronization remains at the same
+ * effective time.
+ *
+ * @note
+ * Be aware, this function is called in interrupt context!
+ *
+ * @param[in] pTime
+ *	Pointer to a <b>tm</b> structure that holds the received time.  Field
+ *	<b>tm_isdst</b> specifies whether this is MESZ.
+ *
+ * @param[in] ageTicks
+ *	Number of RTC ticks which elapsed since the moment <b>pTime</b> refers
+ *	to.  The clock is advanced by this value after it has been set.
+ *
+ ******************************************************************************/
+void	TimeSrcSync (struct tm *pTime, int32_t ageTicks)
+{
+    /* flag to detect whether MEZ<=>MESZ change occurred */
+    bool changeOccurred = (g_isdst != (bool)pTime->tm_isdst);
+#if CLOCK_SLEW
+struct tm time;		// received time for mktime()
+int64_t	  offset;	// offset of the system clock in RTC ticks
+#endif
+
+    EFM_ASSERT (pTime != NULL);
+
+#if CLOCK_SLEW
+    /* Slew a small offset, unless this is the initial synchronization */
+    if (! changeOccurred  &&  g_PowerUpTime != 0)
+    {
+	time = *pTime;
+	time.tm_isdst = 0;		// always 0 for mktime(), see ClockSet()
+	offset = (int64_t)mktime (&time) * RTC_COUNTS_PER_SEC + ageTicks
+		 - ClockGetTicks (RTC->CNT);
+
+	if (offset > -MS2TICS(CLOCK_SLEW_MAX_MS)
+	&&  offset <  MS2TICS(CLOCK_SLEW_MAX_MS))
+	{
+	    ClockSlew ((int32_t)offset);
+	    LogEvent ("%s: Slewing clock by %ldms", l_pTimeSrc->Name,
+		      (long)(offset * 1000 / RTC_COUNTS_PER_SEC));
+#if WARM_START
+	    WarmStartSave (true);
+#endif
+	    ClockUpdate (true);
+	    return;
+	}
+    }
+#endif
+
+    /* set system clock to the received time in "tm" format */
+    g_CurrDateTime = *pTime;
+    g_isdst = pTime->tm_isdst;		// flag for daylight saving time
+
+    /*
+     * The time source may be activated once per day only.  To detect a
+     * change between MEZ and MESZ properly, it will be switched-on at the
+     * right time.  When such a change is detected, all alarm times must be
+     * corrected to still occur at the same effective time.
+     */
+    if (changeOccurred)
+    {
+    int	    alarm;
+    int8_t  hour, minute;
+
+	if (g_isdst)
+	    LogEvent ("%s: Changing time zone from MEZ to MESZ",
+		      l_pTimeSrc->Name);
+	else
+	    LogEvent ("%s: Changing time zone from MESZ to MEZ",
+		      l_pTimeSrc->Name);
+
+	/* MEZ <-> MESZ change detected */
+	for (alarm = 0;  alarm < MAX_ALARMS;  alarm++)
+	{
+	    AlarmGet (alarm, &hour, &minute);
+
+	    hour += (g_isdst ? +1 : -1);
+	    if (hour < 0)
+		hour = 23;
+	    else if (hour > 23)
+		hour = 0;
+
+	    AlarmSet (alarm, hour, minute);
+	}
+    }
+
+    /* Set System Clock also in UNIX time and check initially alarm times */
+    ClockSet (&g_CurrDateTime, true);	// set milliseconds of RTC to zero
+
+    /* Consider the time since the reception */
+    ClockAdjust (ageTicks);
+
+#if WARM_START
+    /* Remember the time of this synchronization for a warm restart */
+    WarmStartSave (true);
+#endif
+
+    /* Show time on display (if applicable) */
+    ClockUpdate (false);	// g_CurrDateTime is already up to date
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Convert UTC into local Time
+ *
+ * This routine converts the UTC time in the specified <b>tm</b> structure
+ * into MEZ or MESZ, and sets field <b>tm_isdst</b> accordingly.  The
+ * daylight saving time lasts from the last Sunday of March to the last
+ * Sunday of October, and changes at 01:00 UTC each.  Like the system clock,
+ * the structure uses a 2-digit year, i.e. <b>tm_year</b> is 0 to 99.
+ *
+ * @param[in,out] pTime
+ *	Pointer to a <b>tm</b> structure with the UTC time, it is overwritten
+ *	by the local time.
+ *
+ ******************************************************************************/
+void	TimeSrcLocalTime (struct tm *pTime)
+{
+struct tm time;
+time_t	  utc;
+bool	  isdst;
+
+    EFM_ASSERT (pTime != NULL);
+
+    /* The weekdays are only correct for the real year */
+    time = *pTime;
+    time.tm_year += 100;
+    time.tm_isdst = 0;			// always 0 for mktime()
+    utc = mktime (&time);
+
+    isdst = (utc >= tsLastSunday (time.tm_year, 2)
+	     &&  utc < tsLastSunday (time.tm_year, 9));
+
+    utc += (isdst ? 2 : 1) * 3600;
+    *pTime = *localtime (&utc);
+    pTime->tm_year -= 100;
+    pTime->tm_isdst = isdst;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Last Sunday of a Month
+ *
+ * @param[in] year
+ *	Year since 1900.
+ *
+ * @param[in] mon
+ *	Month, 2 for March or 9 for October.
+ *
+ * @return
+ *	Time of the last Sunday of the month at 01:00 UTC.
+ *
+ ******************************************************************************/
+static time_t	tsLastSunday (int year, int mon)
+{
+struct tm time = { 0 };
+time_t	  last;
+
+    /* March and October have 31 days, mktime() calculates the weekday */
+    time.tm_year = year;
+    time.tm_mon  = mon;
+    time.tm_mday = 31;
+    time.tm_hour = 1;
+    last = mktime (&time);
+
+    return last - time.tm_wday * 24 * 3600;
+}
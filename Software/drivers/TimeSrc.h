@@ -0,0 +1,78 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module TimeSrc.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_TimeSrc_h
+#define __INC_TimeSrc_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <time.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Time sources which can be selected by @ref TIME_SOURCE. */
+//@{
+#define TIME_SRC_DCF77		0	//!< DCF77 receiver, see DCF77.c
+#define TIME_SRC_GPS		1	//!< GPS receiver with PPS, see GPS.c
+//@}
+
+/*!@brief Time source which synchronizes the system clock.  Both receivers
+ * are connected to the same pins, so only one of them can be used.
+ */
+#ifndef TIME_SOURCE
+    #define TIME_SOURCE		TIME_SRC_DCF77
+#endif
+
+/*!@brief External interrupt and its handler of the selected time source,
+ * for the EXTI configuration in main.c.
+ */
+#if TIME_SOURCE == TIME_SRC_GPS
+    #define TIME_SRC_EXTI_MASK	GPS_PPS_EXTI_MASK
+    #define TIME_SRC_HANDLER	GPS_PPSHandler
+#else
+    #define TIME_SRC_EXTI_MASK	DCF_EXTI_MASK
+    #define TIME_SRC_HANDLER	DCF77Handler
+#endif
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Interface of a time source. */
+typedef struct
+{
+    const char	*Name;			//!< Name, used as prefix of log messages
+    void	(*Init)(void);		//!< Initialize the hardware
+    void	(*Enable)(void);	//!< Start a synchronization
+    void	(*Disable)(void);	//!< Power the receiver off
+} TIME_SRC;
+
+/*======================== External Data and Routines ========================*/
+
+extern const TIME_SRC	g_TimeSrcDCF77;
+extern const TIME_SRC	g_TimeSrcGPS;
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize, enable, and disable the selected time source */
+void	TimeSrcInit (void);
+void	TimeSrcEnable (void);
+void	TimeSrcDisable (void);
+
+    /* Set the system clock to the time received by the time source */
+void	TimeSrcSync (struct tm *pTime, int32_t ageTicks);
+
+    /* Convert UTC into MEZ or MESZ */
+void	TimeSrcLocalTime (struct tm *pTime);
+
+
+#endif /* __INC_TimeSrc_h */
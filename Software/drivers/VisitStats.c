@@ -0,0 +1,1039 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Visit Statistics per Transponder ID
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module accumulates a table of statistics per transponder ID on the
+ * device, so the daily activity of each bird is available without analyzing
+ * the log file.  For each ID, the following values are counted:
+ * - Visits: Number of visits, an ID that is read several times during the
+ *   same visit is only counted once.
+ * - PerchSec: Time in seconds any light barrier was active during a visit.
+ * - PlaySec: Time in seconds from "Playback ON" to "Playback off".
+ * - RecSec: Time in seconds from "Record ON" to "Record off".
+ * - LastSeen: Time when the ID has been read the last time.
+ *
+ * A visit starts with the first active light barrier and ends when the light
+ * barrier filter expires, see InitiatePowerOff().  LB_Handler() reports the
+ * active times via VisitStatsPerch() in interrupt context, they are summed
+ * up and credited by VisitStatsCheck() to the ID which has been read during
+ * this visit by ControlUpdateID(), otherwise they are summed up separately.
+ * The Audio times are reported by AudioCmdDone() via VisitStatsAudio().
+ * They are credited to the current ID when the playback or record has been
+ * started.  If a visit is going on whose ID has not been read yet, e.g. for
+ * the record of the arrival, the ID of this visit is taken at the stop.
+ *
+ * Once a day at @ref ALARM_VISIT_STATS_TIME, the table is written to the
+ * file @ref VISIT_STATS_FILE_NAME, e.g. "STATS288.TXT" for the 288th day of
+ * the year, in CSV format:
+ * @code
+ * #STATS 20261014-083000 20261014-235900 IDs=1 Lost=0 NoIdPerchSec=0
+ * ID,Visits,PerchSec,PlaySec,RecSec,LastSeen
+ * D2ECE7D001AF0001,1,3,5,12,20261014-083100
+ * @endcode
+ * The first line contains the period and the number of IDs.  <b>Lost</b>
+ * counts the readings of IDs which did not fit into the table of
+ * @ref VISIT_STATS_SIZE entries.  After the file has been written, the
+ * table starts over.  If the file could not be written, the statistics are
+ * kept and written with the next day.  The console command "VST" shows the
+ * current table.
+ *
+ * If @ref VISIT_RECORDS is set, a binary @ref VISIT_RECORD is generated for
+ * each visit, which links the transponder ID with the light barrier edges
+ * and the numbers of the playback and record files.  A visit record is
+ * completed when the next visit starts, or latest at
+ * @ref ALARM_VISIT_STATS_TIME, because the Audio actions of a visit may
+ * last longer than the visit itself.  The completed records are queued, and
+ * LogFlush() calls VisitStatsFlush() as an output stream, see
+ * LogStreamRegister(), to append them to @ref VISIT_REC_FILE_NAME while the
+ * SD-Card is switched on anyway.
+ *
+ * Each record file is reported by VisitStatsSegment() with the time of its
+ * acknowledge by the Audio module, and queued at once as @ref VISIT_SEGMENT
+ * with the number of the visit.  With RECORD_SEGMENT, a long record is split
+ * into several files, so every segment can be aligned to the light barrier
+ * and RFID events.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	visitWrite() borrows the file handle of the logging module,
+		see LogFileHandleGet().
+2026-10-15,agnt	Added VisitStatsTopIDs() for the prefetch of the ID index at
+		the start of a visit, see CfgPrefetchIDs().
+2026-10-15,agnt	Registered VisitStatsCheck() as task of the main loop, see
+		TASK_REGISTER().
+2026-10-15,agnt	Added VisitStatsSegment() for a @ref VISIT_SEGMENT per record
+		file, which is queued along with the visit records.
+2026-10-15,agnt	The visit records are an output stream of the logging module,
+		see LogStreamRegister().  A flush is requested when the queue
+		is three quarters full.
+2026-10-15,agnt	Binary visit records, see VISIT_RECORDS.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include <time.h>
+#include "em_int.h"
+#include "AlarmClock.h"
+#include "VisitStats.h"
+#include "CfgData.h"
+#include "LEUART.h"
+#include "Logging.h"
+#include "PowerFail.h"
+#include "ff.h"		// FS_FAT12/16/32
+#include "diskio.h"	// DSTATUS
+#include "microsd.h"
+#include "StrFormat.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Size of a time string "YYYYMMDD-hhmmss", including EOS. */
+#define VISIT_TIME_STR_SIZE	16
+
+    /*!@brief Maximum length of a line of the statistics file. */
+#define VISIT_LINE_SIZE		100
+
+    /*!@brief Column names of the statistics file. */
+#define VISIT_CSV_HEADER	"ID,Visits,PerchSec,PlaySec,RecSec,LastSeen\r\n"
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Statistics of a transponder ID. */
+typedef struct
+{
+    TRANSPONDER_ID ID;		//!< transponder ID
+    uint32_t	Visits;		//!< number of visits
+    uint32_t	PerchSec;	//!< active time of the light barriers [s]
+    uint32_t	PlaySec;	//!< playback time [s]
+    uint32_t	RecSec;		//!< record time [s]
+    time_t	LastSeen;	//!< time when the ID has been read last
+} VISIT_STAT;
+
+    /*!@brief Running playback or record. */
+typedef struct
+{
+    bool	flgOn;		//!< playback or record is running
+    int		Idx;		//!< entry of the ID, -1 if not known yet
+    uint32_t	Seq;		//!< visit during which it has been started
+    time_t	Start;		//!< start time
+} VISIT_RUN;
+
+/*================================ Local Data ================================*/
+
+    /*! Table of the transponder IDs, @ref l_StatCnt entries are in use */
+static VISIT_STAT l_Stat[VISIT_STATS_SIZE];
+static int	  l_StatCnt;
+
+    /*! Number of readings of IDs which did not fit into the table */
+static uint32_t	l_Lost;
+
+    /*! Active time of the light barriers during visits without an ID */
+static uint32_t	l_NoIdPerchSec;
+
+    /*! Start time of the current statistics period, i.e. of the first ID */
+static time_t	l_Since;
+
+    /*! Entry of the current ID, and the visit during which it has been read */
+static int	l_CurIdx = -1;
+static uint32_t	l_CurSeq;
+
+    /*! Running playback and record */
+static VISIT_RUN l_Play, l_Rec;
+
+    /*! Number of the current visit, incremented when a visit is over */
+static volatile uint32_t l_VisitSeq;
+
+    /*! A light barrier is active since @ref l_PerchStart */
+static volatile bool	 l_flgPerch;
+static volatile time_t	 l_PerchStart;
+
+    /*! Active time of the light barriers during the current visit */
+static volatile uint32_t l_PerchSec;
+
+    /*! Active time of the last visit, to be credited by VisitStatsCheck() */
+static volatile bool	 l_flgDone;
+static volatile uint32_t l_DoneSeq;
+static volatile uint32_t l_DoneSec;
+
+    /*! Flag set by VisitStatsAlarm(), handled by VisitStatsCheck() */
+static volatile bool	 l_flgWrite;
+
+#if VISIT_RECORDS
+    /*! A visit is going on since @ref l_VisitStart */
+static volatile bool	 l_flgVisit;
+static volatile uint32_t l_VisitStart;
+
+    /*! Edges of the light barriers during the current visit */
+static volatile uint16_t l_Edges[2];
+
+    /*! Start, end, and edges of the last visit, see @ref l_DoneSeq */
+static volatile uint32_t l_DoneStart, l_DoneEnd;
+static volatile uint16_t l_DoneEdges[2];
+
+    /*! Record of the visit @ref l_OpenSeq, which is not completed yet */
+static VISIT_RECORD l_Open;
+static bool	l_flgOpen;
+static uint32_t	l_OpenSeq;
+
+    /*! Completed records, to be written by VisitStatsFlush() */
+static VISIT_RECORD l_RecQueue[VISIT_REC_QUEUE_SIZE];
+static int	l_RecCnt;
+
+    /*! Number of records which did not fit into the queue */
+static uint32_t	l_RecLost;
+
+    /*! Output stream of the visit records, see LogStreamRegister() */
+static const LOG_STREAM	l_RecStream =
+{
+    "VisitStats", VISIT_REC_FILE_NAME, VisitStatsFlush
+};
+#endif
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	VisitStatsAlarm (int alarmNum);
+static void	visitClear (void);
+static int	visitFind (TRANSPONDER_ID id);
+static int	visitRunStop (VISIT_RUN *pRun, uint32_t *pSec);
+static bool	visitWrite (void);
+static char    *visitTimeStr (time_t t, char *pBuf);
+#if VISIT_RECORDS
+static VISIT_RECORD *visitRecGet (uint32_t seq);
+static void	visitRecQueue (void);
+static void	visitRecPut (const void *pRec);
+static void	visitRecAudio (uint16_t flag, int fileNum);
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Visit Statistics
+ *
+ * This routine must be called once after AlarmClockInit().  It clears the
+ * table and sets up the alarm at @ref ALARM_VISIT_STATS_TIME to write the
+ * statistics file.
+ *
+ ******************************************************************************/
+void	VisitStatsInit (void)
+{
+    visitClear();
+
+    AlarmAction (ALARM_VISIT_STATS, VisitStatsAlarm);
+    AlarmSet (ALARM_VISIT_STATS, ALARM_VISIT_STATS_TIME);
+    AlarmEnable (ALARM_VISIT_STATS);
+
+#if VISIT_RECORDS
+    /* The visit records are written along with the log file */
+    LogStreamRegister (&l_RecStream);
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Count a Transponder ID
+ *
+ * This routine is called by ControlUpdateID() for each transponder ID.  A new
+ * ID is added to the table.  The visit is counted if the ID has not been
+ * read during the current visit already.  The ID becomes the current one,
+ * perch and Audio times of this visit are credited to it.
+ *
+ * @param[in] id
+ *	Transponder ID that has been read.
+ *
+ ******************************************************************************/
+void	VisitStatsID (TRANSPONDER_ID id)
+{
+uint32_t seq = l_VisitSeq;
+int	 idx;
+#if VISIT_RECORDS
+VISIT_RECORD *pRec;
+#endif
+
+
+    idx = l_CurIdx;
+    if (idx < 0  ||  l_Stat[idx].ID != id)
+	idx = visitFind (id);
+
+    if (idx < 0)
+    {
+	l_Lost++;		// table is full
+	l_CurIdx = -1;
+	return;
+    }
+
+    if (idx != l_CurIdx  ||  seq != l_CurSeq)
+	l_Stat[idx].Visits++;
+
+    l_Stat[idx].LastSeen = time(NULL);
+    if (l_Since == 0)
+	l_Since = l_Stat[idx].LastSeen;
+
+#if VISIT_RECORDS
+    /* the first ID of the visit is recorded */
+    pRec = visitRecGet (seq);
+    if (! (pRec->Flags & VISIT_FLG_ID))
+    {
+	pRec->ID = id;
+	pRec->Flags |= VISIT_FLG_ID;
+    }
+    else if (pRec->ID != id)
+    {
+	pRec->Flags |= VISIT_FLG_MULTI_ID;
+    }
+#endif
+    l_CurIdx = idx;
+    l_CurSeq = seq;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Light Barriers changed their State
+ *
+ * This routine is called by LB_Handler() in interrupt context when the first
+ * light barrier becomes active, or the last one inactive.  The active time
+ * is summed up for the current visit.  The first activation starts a new
+ * visit.
+ *
+ * @param[in] flgActive
+ *	The value <i>true</i> if a light barrier is active now.
+ *
+ ******************************************************************************/
+void	VisitStatsPerch (bool flgActive)
+{
+time_t	 now = time(NULL);
+
+
+    if (flgActive)
+    {
+	if (! l_flgPerch)
+	{
+	    l_flgPerch = true;
+	    l_PerchStart = now;
+	}
+#if VISIT_RECORDS
+	if (! l_flgVisit)
+	{
+	    /* VisitStatsCheck() completes the record of the previous visit */
+	    l_flgVisit = true;
+	    l_VisitStart = (uint32_t)now;
+	    EVENT_POST(EVT_STATS);
+	}
+#endif
+    }
+    else if (l_flgPerch)
+    {
+	l_flgPerch = false;
+	l_PerchSec += (uint32_t)(now - l_PerchStart);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	A Visit is over
+ *
+ * This routine is called by InitiatePowerOff() in interrupt context when the
+ * light barrier filter has expired.  The active time of the visit is handed
+ * over to VisitStatsCheck(), and the next visit starts.
+ *
+ ******************************************************************************/
+void	VisitStatsPerchEnd (void)
+{
+    if (l_flgPerch)
+	VisitStatsPerch (false);
+
+#if VISIT_RECORDS
+    l_DoneStart = l_VisitStart;
+    l_DoneEnd   = (uint32_t)time(NULL);
+    l_DoneEdges[0] = l_Edges[0];
+    l_DoneEdges[1] = l_Edges[1];
+    l_Edges[0] = l_Edges[1] = 0;
+    l_flgVisit = false;
+#endif
+    l_DoneSec += l_PerchSec;
+    l_DoneSeq  = l_VisitSeq++;
+    l_PerchSec = 0;
+    l_flgDone  = true;
+
+    EVENT_POST(EVT_STATS);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Count Light Barrier Edges
+ *
+ * This routine is called in interrupt context for each edge of a light
+ * barrier, or for the edges which have been counted by the PCNT.
+ *
+ * @param[in] idx
+ *	Index of the light barrier, i.e. 0 for LB1, and 1 for LB2.
+ *
+ * @param[in] cnt
+ *	Number of edges.
+ *
+ ******************************************************************************/
+void	VisitStatsEdges (int idx, unsigned int cnt)
+{
+#if VISIT_RECORDS
+    if (l_Edges[idx] + cnt > 0xFFFF)
+	l_Edges[idx] = 0xFFFF;
+    else
+	l_Edges[idx] += cnt;
+#else
+    (void) idx;		// suppress compiler warning "unused parameter"
+    (void) cnt;
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Account a Playback or Record
+ *
+ * This routine is called by AudioCmdDone() when the Audio module has
+ * acknowledged the start or the stop of a playback or record, or rejected
+ * it.  Further starts, e.g. of a playback chain, continue the running one.
+ * At the stop, the time is credited to the ID of the start, see
+ * visitRunStop().
+ *
+ * @param[in] evt
+ *	Audio event, see @ref VISIT_AUDIO.
+ *
+ * @param[in] fileNum
+ *	Number of the playback or record file, 0 for the stop events.
+ *
+ ******************************************************************************/
+void	VisitStatsAudio (VISIT_AUDIO evt, int fileNum)
+{
+bool	   flgPlay = (evt == VISIT_PLAY_ON  ||  evt == VISIT_PLAY_OFF
+		      ||  evt == VISIT_PLAY_FAIL);
+VISIT_RUN *pRun = (flgPlay ? &l_Play : &l_Rec);
+uint32_t   sec;
+int	   idx;
+
+
+    (void) fileNum;	// not used without VISIT_RECORDS
+
+    switch (evt)
+    {
+	case VISIT_PLAY_ON:
+	case VISIT_REC_ON:
+	    if (! pRun->flgOn)
+	    {
+		pRun->flgOn = true;
+		pRun->Seq   = l_VisitSeq;
+		pRun->Start = time(NULL);
+
+		/* the ID of a visit that is going on may not be read yet */
+		pRun->Idx = (l_flgPerch  &&  l_CurSeq != pRun->Seq
+			     ? -1 : l_CurIdx);
+	    }
+#if VISIT_RECORDS
+	    visitRecAudio (flgPlay ? VISIT_FLG_PLAY : VISIT_FLG_REC, fileNum);
+#endif
+	    break;
+
+	case VISIT_PLAY_OFF:
+	case VISIT_REC_OFF:
+	    if ((idx = visitRunStop (pRun, &sec)) >= 0)
+	    {
+		if (flgPlay)
+		    l_Stat[idx].PlaySec += sec;
+		else
+		    l_Stat[idx].RecSec  += sec;
+	    }
+	    break;
+
+	default:		// VISIT_PLAY_FAIL, VISIT_REC_FAIL
+#if VISIT_RECORDS
+	    visitRecAudio (flgPlay ? VISIT_FLG_PLAY_FAIL : VISIT_FLG_REC_FAIL,
+			   fileNum);
+#endif
+	    break;
+    }
+}
+
+
+#if VISIT_RECORDS
+/***************************************************************************//**
+ *
+ * @brief	Report a Record File
+ *
+ * This routine is called by AudioCmdDone() when the Audio module has
+ * acknowledged a record.  A @ref VISIT_SEGMENT is queued for the visit which
+ * is going on, or for the last visit as long as its record is open.  The time
+ * stamp is converted to the time of day with sub-seconds.
+ *
+ * @param[in] fileNum
+ *	Number of the record file.
+ *
+ * @param[in] segment
+ *	Number of the segment, 0 for the first file of a record.
+ *
+ * @param[in] timeStamp
+ *	RTC counter value when the acknowledge has been received.
+ *
+ ******************************************************************************/
+void	VisitStatsSegment (int fileNum, int segment, uint32_t timeStamp)
+{
+VISIT_SEGMENT seg;
+uint32_t cnt = RTC->CNT;
+uint64_t ticks;
+
+
+    memset (&seg, 0, sizeof(seg));
+    seg.Magic = VISIT_SEG_MAGIC;
+
+    if (l_flgVisit)
+	seg.Seq = (uint16_t)l_VisitSeq;
+    else if (l_flgOpen)
+	seg.Seq = (uint16_t)l_OpenSeq;
+    else
+	return;			// no visit, e.g. console command
+
+    /* now, minus the 24bit RTC counts which have elapsed since the stamp */
+    ticks = (uint64_t)time(NULL) * RTC_COUNTS_PER_SEC
+	  + (cnt + clockGetTickOffset()) % RTC_COUNTS_PER_SEC
+	  - ((cnt - timeStamp) & 0xFFFFFF);
+
+    seg.Start   = (uint32_t)(ticks / RTC_COUNTS_PER_SEC);
+    seg.SubSec  = (uint16_t)(ticks % RTC_COUNTS_PER_SEC);
+    seg.RecFile = (uint16_t)fileNum;
+    seg.Segment = (uint16_t)segment;
+
+    visitRecPut (&seg);
+}
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check the Visit Statistics
+ *
+ * This routine is called from the main loop for @ref EVT_STATS.  It credits
+ * the active time of a finished visit, and writes the statistics file if
+ * the alarm has been triggered.  With @ref VISIT_RECORDS, the record of the
+ * last visit is completed if a new visit has started.
+ *
+ ******************************************************************************/
+void	VisitStatsCheck (void)
+{
+uint32_t sec, seq;
+bool	 flgDone;
+#if VISIT_RECORDS
+VISIT_RECORD *pRec;
+VISIT_RECORD  done;		// start, end, and edges of the visit
+#endif
+
+
+    INT_Disable();
+    flgDone = l_flgDone;
+    sec = l_DoneSec;
+    seq = l_DoneSeq;
+#if VISIT_RECORDS
+    done.Start = l_DoneStart;
+    done.End   = l_DoneEnd;
+    done.Edges[0] = l_DoneEdges[0];
+    done.Edges[1] = l_DoneEdges[1];
+#endif
+    l_flgDone = false;
+    l_DoneSec = 0;
+    INT_Enable();
+
+    if (flgDone)
+    {
+	if (l_CurIdx >= 0  &&  l_CurSeq == seq)
+	    l_Stat[l_CurIdx].PerchSec += sec;
+	else
+	    l_NoIdPerchSec += sec;
+
+#if VISIT_RECORDS
+	/* the Audio actions may go on, the record is completed later */
+	pRec = visitRecGet (seq);
+	pRec->Start = done.Start;
+	pRec->End   = done.End;
+	pRec->PerchSec = (sec > 0xFFFF ? 0xFFFF : (uint16_t)sec);
+	pRec->Edges[0] = done.Edges[0];
+	pRec->Edges[1] = done.Edges[1];
+	pRec->Flags |= VISIT_FLG_ENDED;
+#endif
+    }
+
+#if VISIT_RECORDS
+    /* A new visit, or the end of the day, completes the record */
+    if (l_flgOpen  &&  ((l_flgVisit  &&  l_OpenSeq != l_VisitSeq)
+		    ||  (l_flgWrite  &&  (l_Open.Flags & VISIT_FLG_ENDED))))
+	visitRecQueue();
+#endif
+
+    if (l_flgWrite)
+    {
+	l_flgWrite = false;
+	if (visitWrite())
+	    visitClear();
+    }
+}
+#if VISIT_STATS
+TASK_REGISTER(TASK_PRIO_STATS, EVT_STATS, VisitStatsCheck);
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the most frequent Transponder IDs
+ *
+ * This routine returns the IDs of the table with the most visits, e.g. to
+ * prefetch their entries of the ID index when a visit starts, see
+ * CfgPrefetchIDs().  The table is small, so the IDs are simply selected one
+ * after the other.
+ *
+ * @param[out] pIDs
+ *	Array to store the IDs, the most frequent one first.
+ *
+ * @param[in] maxCnt
+ *	Maximum number of IDs to return.
+ *
+ * @return
+ *	Number of IDs stored in the array.
+ *
+ ******************************************************************************/
+int	VisitStatsTopIDs (TRANSPONDER_ID *pIDs, int maxCnt)
+{
+uint32_t prev = 0xFFFFFFFF;	// visits of the previous rank
+int	 prevIdx = l_StatCnt;	// entry of the previous rank
+int	 i, n, best;
+
+    for (n = 0;  n < maxCnt;  n++)
+    {
+	/* the next entry in the order of visits, then of the table */
+	best = -1;
+	for (i = 0;  i < l_StatCnt;  i++)
+	{
+	    if (l_Stat[i].Visits > prev
+	    ||  (l_Stat[i].Visits == prev  &&  i <= prevIdx))
+		continue;	// already returned
+
+	    if (best < 0  ||  l_Stat[i].Visits > l_Stat[best].Visits)
+		best = i;
+	}
+	if (best < 0)
+	    break;
+
+	pIDs[n]  = l_Stat[best].ID;
+	prev	 = l_Stat[best].Visits;
+	prevIdx  = best;
+    }
+
+    return n;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Show the Visit Statistics
+ *
+ * This routine is called by the console command "VST".  It shows the table
+ * in the format of the statistics file.
+ *
+ ******************************************************************************/
+void	VisitStatsReport (void)
+{
+char	 line[VISIT_LINE_SIZE];
+char	 idStr[ID_STR_SIZE];
+char	 timeStr[VISIT_TIME_STR_SIZE];
+int	 i;
+
+
+    StrFormat (line, "#STATS %s IDs=%d Lost=%lu NoIdPerchSec=%lu\n",
+	       visitTimeStr (l_Since != 0 ? l_Since : time(NULL), timeStr),
+	       l_StatCnt, (unsigned long)l_Lost, (unsigned long)l_NoIdPerchSec);
+    drvLEUART_puts (line);
+
+    for (i = 0;  i < l_StatCnt;  i++)
+    {
+	StrFormat (line, "%s,%lu,%lu,%lu,%lu,%s\n",
+		   CfgIDToString (l_Stat[i].ID, idStr),
+		   (unsigned long)l_Stat[i].Visits,
+		   (unsigned long)l_Stat[i].PerchSec,
+		   (unsigned long)l_Stat[i].PlaySec,
+		   (unsigned long)l_Stat[i].RecSec,
+		   visitTimeStr (l_Stat[i].LastSeen, timeStr));
+	drvLEUART_puts (line);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Append the Visit Records
+ *
+ * This routine is called by LogFlush() while the SD-Card is acquired.  It
+ * appends the completed visit records to @ref VISIT_REC_FILE_NAME.  A
+ * partial record at the end of the file, e.g. after a power-fail, is
+ * overwritten.  If the file cannot be written, the records are kept for
+ * the next call.
+ *
+ ******************************************************************************/
+void	VisitStatsFlush (void)
+{
+#if VISIT_RECORDS
+    if (l_RecCnt == 0  ||  IsPowerFail())
+	return;
+
+    if (! LogStreamAppend (&l_RecStream, sizeof(VISIT_RECORD),
+			   l_RecQueue, l_RecCnt * sizeof(VISIT_RECORD), NULL, 0))
+	return;
+
+    l_RecCnt = 0;
+
+    if (l_RecLost > 0)
+    {
+	LogError ("VisitStats: %lu visit records lost",
+		  (unsigned long)l_RecLost);
+	l_RecLost = 0;
+    }
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Alarm Routine for the Statistics File
+ *
+ * This routine is called by the alarm clock at @ref ALARM_VISIT_STATS_TIME.
+ * It triggers visitWrite() in VisitStatsCheck().
+ *
+ ******************************************************************************/
+static void VisitStatsAlarm (int alarmNum)
+{
+    (void) alarmNum;	// suppress compiler warning "unused parameter"
+
+    l_flgWrite = true;
+    EVENT_POST(EVT_STATS);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Clear the Table
+ *
+ * All entries are removed and a new statistics period starts.  Running
+ * playbacks or records are not credited to any ID.
+ *
+ ******************************************************************************/
+static void	visitClear (void)
+{
+    memset (l_Stat, 0, sizeof(l_Stat));
+    l_StatCnt = 0;
+    l_Lost = 0;
+    l_NoIdPerchSec = 0;
+    l_CurIdx = -1;
+    l_Play.flgOn = l_Rec.flgOn = false;
+    l_Since = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Find a Transponder ID
+ *
+ * @param[in] id
+ *	Transponder ID to look for, it is added if not found.
+ *
+ * @return
+ *	Index of the entry, or -1 if the table is full.
+ *
+ ******************************************************************************/
+static int	visitFind (TRANSPONDER_ID id)
+{
+int	 i;
+
+
+    for (i = 0;  i < l_StatCnt;  i++)
+	if (l_Stat[i].ID == id)
+	    return i;
+
+    if (l_StatCnt >= VISIT_STATS_SIZE)
+	return -1;
+
+    l_Stat[l_StatCnt].ID = id;
+    return l_StatCnt++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Stop a Playback or Record
+ *
+ * @param[in,out] pRun
+ *	Running playback or record.
+ *
+ * @param[out] pSec
+ *	Duration in seconds.
+ *
+ * @return
+ *	Entry of the ID the duration is to be credited to, or -1 if there is
+ *	none.  An unknown ID of the start is taken from the current one, if it
+ *	has been read during the same visit.
+ *
+ ******************************************************************************/
+static int	visitRunStop (VISIT_RUN *pRun, uint32_t *pSec)
+{
+    if (! pRun->flgOn)
+	return -1;
+
+    pRun->flgOn = false;
+    *pSec = (uint32_t)(time(NULL) - pRun->Start);
+
+    if (pRun->Idx < 0  &&  l_CurSeq == pRun->Seq)
+	return l_CurIdx;
+
+    return pRun->Idx;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write the Statistics File
+ *
+ * This routine writes the table to @ref VISIT_STATS_FILE_NAME, the number
+ * is the current day of the year.  An existing file is overwritten.
+ *
+ * @return
+ *	The value <i>true</i> if the file has been written.
+ *
+ ******************************************************************************/
+static bool	visitWrite (void)
+{
+char	 name[16];
+char	 line[VISIT_LINE_SIZE];
+char	 idStr[ID_STR_SIZE];
+char	 sinceStr[VISIT_TIME_STR_SIZE];
+char	 timeStr[VISIT_TIME_STR_SIZE];
+struct tm tm;
+time_t	 now;
+FIL	*pFh;
+FRESULT	 res;
+UINT	 cnt;
+int	 i;
+
+
+    /* Check for power-fail */
+    if (IsPowerFail())
+	return false;
+
+    /* Switch the SD-Card Interface on, re-initialize it if required */
+    if (IsDiskRemoved()  ||  DiskAcquire() != 0)
+    {
+	LogError ("VisitStats: SD-Card Initialization Failed");
+	DiskRelease (false);
+	return false;
+    }
+
+    now = time(NULL);
+
+    /* localtime() is also used by the RTC interrupt */
+    INT_Disable();
+    tm = *localtime (&now);
+    INT_Enable();
+
+    StrFormat (name, VISIT_STATS_FILE_NAME, tm.tm_yday + 1);
+
+    pFh = LogFileHandleGet();
+    if (pFh == NULL)
+	res = FR_LOCKED;		// file handle is in use
+    else
+	res = f_open (pFh, name, FA_WRITE | FA_CREATE_ALWAYS);
+    if (res == FR_OK)
+    {
+	StrFormat (line, "#STATS %s %s IDs=%d Lost=%lu NoIdPerchSec=%lu\r\n",
+		   visitTimeStr (l_Since != 0 ? l_Since : now, sinceStr),
+		   visitTimeStr (now, timeStr), l_StatCnt,
+		   (unsigned long)l_Lost, (unsigned long)l_NoIdPerchSec);
+	res = f_write (pFh, line, strlen(line), &cnt);
+	if (res == FR_OK)
+	    res = f_write (pFh, VISIT_CSV_HEADER, strlen(VISIT_CSV_HEADER),
+			   &cnt);
+
+	for (i = 0;  i < l_StatCnt  &&  res == FR_OK;  i++)
+	{
+	    StrFormat (line, "%s,%lu,%lu,%lu,%lu,%s\r\n",
+		       CfgIDToString (l_Stat[i].ID, idStr),
+		       (unsigned long)l_Stat[i].Visits,
+		       (unsigned long)l_Stat[i].PerchSec,
+		       (unsigned long)l_Stat[i].PlaySec,
+		       (unsigned long)l_Stat[i].RecSec,
+		       visitTimeStr (l_Stat[i].LastSeen, timeStr));
+	    res = f_write (pFh, line, strlen(line), &cnt);
+	}
+
+	if (f_close (pFh) != FR_OK  &&  res == FR_OK)
+	    res = FR_DISK_ERR;
+	FindFileCacheInvalidate();	// file may have been created
+    }
+    if (pFh != NULL)
+	LogFileHandlePut (pFh);
+
+    DiskRelease (res == FR_OK);
+
+    if (res != FR_OK)
+    {
+	LogError ("VisitStats: Error Code %d writing %s", res, name);
+	return false;
+    }
+
+    Log ("VisitStats: %d IDs written to %s", l_StatCnt, name);
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Convert a Time into a String
+ *
+ * @param[in] t
+ *	Time to be converted.
+ *
+ * @param[out] pBuf
+ *	Buffer of @ref VISIT_TIME_STR_SIZE bytes for the string.
+ *
+ * @return
+ *	Address of the buffer.
+ *
+ ******************************************************************************/
+static char    *visitTimeStr (time_t t, char *pBuf)
+{
+struct tm tm;
+
+
+    /* localtime() is also used by the RTC interrupt */
+    INT_Disable();
+    tm = *localtime (&t);
+    INT_Enable();
+
+    StrFormat (pBuf, "20%02d%02d%02d-%02d%02d%02d",
+	       tm.tm_year, tm.tm_mon + 1, tm.tm_mday,
+	       tm.tm_hour, tm.tm_min, tm.tm_sec);
+    return pBuf;
+}
+
+
+#if VISIT_RECORDS
+/***************************************************************************//**
+ *
+ * @brief	Get the Record of a Visit
+ *
+ * If the open record belongs to another visit, it is completed, and a new
+ * record is opened.
+ *
+ * @param[in] seq
+ *	Number of the visit.
+ *
+ * @return
+ *	Address of the open record.
+ *
+ ******************************************************************************/
+static VISIT_RECORD *visitRecGet (uint32_t seq)
+{
+    if (l_flgOpen  &&  l_OpenSeq != seq)
+	visitRecQueue();
+
+    if (! l_flgOpen)
+    {
+	memset (&l_Open, 0, sizeof(l_Open));
+	l_Open.Magic = VISIT_REC_MAGIC;
+	l_Open.Seq   = (uint16_t)seq;
+	l_OpenSeq = seq;
+	l_flgOpen = true;
+    }
+
+    return &l_Open;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Complete the open Record
+ *
+ * The record is moved into the queue for VisitStatsFlush(), see
+ * visitRecPut().
+ *
+ ******************************************************************************/
+static void	visitRecQueue (void)
+{
+    visitRecPut (&l_Open);
+
+    l_flgOpen = false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Queue a Record
+ *
+ * A @ref VISIT_RECORD or @ref VISIT_SEGMENT is copied into the queue for
+ * VisitStatsFlush().  If the queue is full, it is counted as lost.
+ *
+ * @param[in] pRec
+ *	Address of the record, both types have the same size.
+ *
+ ******************************************************************************/
+static void	visitRecPut (const void *pRec)
+{
+    if (l_RecCnt < VISIT_REC_QUEUE_SIZE)
+	memcpy (&l_RecQueue[l_RecCnt++], pRec, sizeof(VISIT_RECORD));
+    else
+	l_RecLost++;
+
+    /* write the queue before it overflows */
+    if (l_RecCnt == VISIT_REC_QUEUE_SIZE * 3 / 4)
+	LogFlushRequest();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Record an Audio Action
+ *
+ * The action belongs to the visit which is going on.  If there is none, it
+ * belongs to the last visit, as long as its record is open.
+ *
+ * @param[in] flag
+ *	Outcome flag, see VISIT_FLG_PLAY etc.
+ *
+ * @param[in] fileNum
+ *	Number of the playback or record file.
+ *
+ ******************************************************************************/
+static void	visitRecAudio (uint16_t flag, int fileNum)
+{
+VISIT_RECORD *pRec;
+
+
+    if (l_flgVisit)
+	pRec = visitRecGet (l_VisitSeq);
+    else if (l_flgOpen)
+	pRec = &l_Open;
+    else
+	return;			// no visit, e.g. console command
+
+    pRec->Flags |= flag;
+
+    if (flag & (VISIT_FLG_PLAY | VISIT_FLG_PLAY_FAIL))
+    {
+	if (pRec->PlayFile == 0)
+	    pRec->PlayFile = (uint16_t)fileNum;
+    }
+    else
+    {
+	if (pRec->RecFile == 0)
+	    pRec->RecFile = (uint16_t)fileNum;
+    }
+}
+#endif
@@ -0,0 +1,167 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module VisitStats.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Reduced VISIT_STATS_SIZE to 8.
+2026-10-15,agnt	Reduced VISIT_STATS_SIZE to 16 and VISIT_REC_QUEUE_SIZE to 4.
+2026-10-15,agnt	Added prototype for VisitStatsTopIDs().
+2026-10-15,agnt	Added VISIT_SEG_MAGIC, VISIT_SEGMENT, and VisitStatsSegment().
+2026-10-15,agnt	Added VISIT_RECORDS and the binary VISIT_RECORD.
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_VisitStats_h
+#define __INC_VisitStats_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to accumulate statistics per transponder ID, which
+ * are written once a day to @ref VISIT_STATS_FILE_NAME.
+ */
+#ifndef VISIT_STATS
+    #define VISIT_STATS		0
+#endif
+
+/*!@brief Number of transponder IDs in the table, further IDs of the same
+ * day are only counted as lost.  Each entry takes 28 bytes of RAM.
+ */
+#ifndef VISIT_STATS_SIZE
+    #define VISIT_STATS_SIZE	8
+#endif
+
+/*!@brief Time when to write the statistics file, as hour and minute. */
+#ifndef ALARM_VISIT_STATS_TIME
+    #define ALARM_VISIT_STATS_TIME	23, 59
+#endif
+
+/*!@brief Set this define 1 to append a @ref VISIT_RECORD for each visit to
+ * @ref VISIT_REC_FILE_NAME, this requires @ref VISIT_STATS.
+ */
+#ifndef VISIT_RECORDS
+    #define VISIT_RECORDS	0
+#endif
+
+/*!@brief Number of visit records which are kept until the next LogFlush(),
+ * further records are lost.
+ */
+#ifndef VISIT_REC_QUEUE_SIZE
+    #define VISIT_REC_QUEUE_SIZE	4
+#endif
+
+/*!@brief Magic number at the start of each @ref VISIT_RECORD, "VR". */
+#define VISIT_REC_MAGIC		0x5256
+
+/*!@brief Magic number at the start of each @ref VISIT_SEGMENT, "VS". */
+#define VISIT_SEG_MAGIC		0x5356
+
+/*!@brief Outcome flags of a @ref VISIT_RECORD. */
+//@{
+#define VISIT_FLG_ID		0x0001	//!< a transponder ID has been read
+#define VISIT_FLG_MULTI_ID	0x0002	//!< more than one ID has been read
+#define VISIT_FLG_PLAY		0x0004	//!< a playback has been started
+#define VISIT_FLG_REC		0x0008	//!< a record has been started
+#define VISIT_FLG_PLAY_FAIL	0x0010	//!< Audio module rejected a playback
+#define VISIT_FLG_REC_FAIL	0x0020	//!< Audio module rejected a record
+#define VISIT_FLG_ENDED		0x0040	//!< filter expired, <b>End</b> is valid
+//@}
+
+/*!@brief Audio events which are accounted to the current transponder ID. */
+typedef enum
+{
+    VISIT_PLAY_ON,	//!< Audio module acknowledged a playback
+    VISIT_PLAY_OFF,	//!< Audio module acknowledged the stop of a playback
+    VISIT_PLAY_FAIL,	//!< Audio module rejected a playback
+    VISIT_REC_ON,	//!< Audio module acknowledged a record
+    VISIT_REC_OFF,	//!< Audio module acknowledged the stop of a record
+    VISIT_REC_FAIL,	//!< Audio module rejected a record
+} VISIT_AUDIO;
+
+/*!@brief Binary record of a visit.
+ *
+ * The records are appended to @ref VISIT_REC_FILE_NAME, 32 bytes each,
+ * little endian.  Times are in seconds as returned by time().  File numbers
+ * are those of the playback file "Pnnn" and the record file "Rnnn", 0 means
+ * none.  If a visit has been rejected by the Audio module, the file number
+ * of the request is stored along with the FAIL flag.
+ */
+typedef struct
+{
+    uint16_t	Magic;		//!< @ref VISIT_REC_MAGIC
+    uint16_t	Seq;		//!< number of the visit since reset
+    uint32_t	Start;		//!< first light barrier became active
+    uint32_t	End;		//!< light barrier filter expired
+    uint16_t	PerchSec;	//!< active time of the light barriers [s]
+    uint16_t	Flags;		//!< outcome, see VISIT_FLG_ID etc.
+    TRANSPONDER_ID ID;		//!< first transponder ID, 0 if none
+    uint16_t	Edges[2];	//!< number of edges of LB1 and LB2
+    uint16_t	PlayFile;	//!< first playback file number
+    uint16_t	RecFile;	//!< first record file number
+} VISIT_RECORD;
+
+/*!@brief Binary record of a record file (segment).
+ *
+ * This record has the size of a @ref VISIT_RECORD and is written to the same
+ * file, it is told apart by its <b>Magic</b>.  It is written when the Audio
+ * module has acknowledged a record, i.e. usually before the record of the
+ * visit <b>Seq</b> which is completed later.  <b>Start</b> and
+ * <b>SubSec</b> are taken from the RTC when the acknowledge has been
+ * received, like the light barrier events of the timeline.
+ */
+typedef struct
+{
+    uint16_t	Magic;		//!< @ref VISIT_SEG_MAGIC
+    uint16_t	Seq;		//!< number of the visit, see VISIT_RECORD
+    uint32_t	Start;		//!< time() of the acknowledge
+    uint16_t	SubSec;		//!< plus RTC counts, 1/RTC_COUNTS_PER_SEC
+    uint16_t	RecFile;	//!< record file number
+    uint16_t	Segment;	//!< 0 for the first file of a record
+    uint16_t	Reserved[9];	//!< 0, pads the record to 32 bytes
+} VISIT_SEGMENT;
+
+/*================================ Prototypes ================================*/
+
+    /* Initialize the statistics and the alarm to write them */
+void	VisitStatsInit (void);
+
+    /* Count a transponder ID, it becomes the current one */
+void	VisitStatsID (TRANSPONDER_ID id);
+
+    /* Light barriers changed between active and inactive (interrupt) */
+void	VisitStatsPerch (bool flgActive);
+
+    /* Count edges of a light barrier for the visit record (interrupt) */
+void	VisitStatsEdges (int idx, unsigned int cnt);
+
+    /* The light barrier filter has expired, the visit is over (interrupt) */
+void	VisitStatsPerchEnd (void);
+
+    /* Account a playback or record to the current transponder ID */
+void	VisitStatsAudio (VISIT_AUDIO evt, int fileNum);
+
+    /* Record file started at RTC time stamp, see VISIT_SEGMENT */
+void	VisitStatsSegment (int fileNum, int segment, uint32_t timeStamp);
+
+    /* Apply the perch time of a visit, write the file if requested */
+void	VisitStatsCheck (void);
+
+    /* Get the IDs with the most visits */
+int	VisitStatsTopIDs (TRANSPONDER_ID *pIDs, int maxCnt);
+
+    /* Show the statistics on the console */
+void	VisitStatsReport (void);
+
+    /* Append the queued visit records, called by LogFlush() */
+void	VisitStatsFlush (void);
+
+
+#endif /* __INC_VisitStats_h */
@@ -0,0 +1,314 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Watchdog Supervision and Warm Restart
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module supervises the firmware by the watchdog (WDOG), and resumes
+ * operation quickly after a warm reset:
+ * - The reset cause of the RMU is read once by WarmStartInit() and stored
+ *   in @ref g_ResetCause, since the causes must be cleared after reading.
+ *   LogInit() also refers to it, see @ref LOG_RETAIN.
+ * - The watchdog runs from the ULFRCO, also in EM2.  It is only fed if all
+ *   heartbeats of @ref WDOG_HB have been reported since the last feed, i.e.
+ *   the sTimer of this module has expired (@ref WDOG_HB_TIMER), and the
+ *   main loop has called WarmStartCheck() afterwards (@ref WDOG_HB_MAIN).
+ *   If the main loop, or the RTC, is stuck, the watchdog resets the MCU
+ *   after @ref WDOG_TIMEOUT seconds.
+ * - Each time the watchdog is fed, and after each synchronization by the
+ *   time source, the current time is saved into a state block in the
+ *   <b>.noinit</b> section, together with the time of the last
+ *   synchronization and the daylight saving flag.
+ * - After a warm reset, i.e. no power-on or brown-out reset, and a valid
+ *   state block, WarmStartRestore() sets the system clock to the saved time
+ *   plus the estimated duration of the outage.  So CheckAlarmTimes() is not
+ *   blocked until the next DCF77 synchronization, and the power windows are
+ *   switched as soon as the configuration has been read.  The time source
+ *   is still enabled and corrects the clock with its next synchronization.
+ *
+ * The configuration and the audio inventory are not retained, they are read
+ * from the SD-Card again, which is required for the log file and the audio
+ * files anyway.  The @ref POWER_UP_DELAY of the Audio module also remains,
+ * since its power output is switched off by the reset.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include <time.h>
+#include "em_device.h"
+#include "em_int.h"
+#include "em_rmu.h"
+#include "AlarmClock.h"
+#include "Logging.h"
+#include "WarmStart.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Place a variable into the RAM section which is not cleared at reset */
+#define WARM_NOINIT		__attribute__((section(".noinit")))
+#define WARM_START_MAGIC	((uint32_t)0x5753544D)	// "WSTM", state is valid
+    /*! Reset causes which do not retain the RAM contents */
+#define WARM_START_RST_MASK	(RMU_RSTCAUSE_PORST | RMU_RSTCAUSE_BODUNREGRST \
+				 | RMU_RSTCAUSE_BODREGRST)
+
+    /*! Flags of the retained state */
+#define WARM_FLG_VALID		0x01	//!< Time has been set
+#define WARM_FLG_DST		0x02	//!< Daylight saving time, see g_isdst
+#define WARM_FLG_SYNCED		0x04	//!< LastSync is valid
+
+    /*! Bit mask of all heartbeats */
+#define WDOG_HB_ALL		((1 << END_WDOG_HB) - 1)
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief State which is retained in RAM across a warm reset. */
+typedef struct
+{
+    uint32_t	Check;		//!< Check sum over the following words
+    uint32_t	Magic;		//!< @ref WARM_START_MAGIC
+    int32_t	Time;		//!< Time of the last save
+    int32_t	LastSync;	//!< Time of the last synchronization
+    uint32_t	Restarts;	//!< Warm restarts since the last cold start
+    uint32_t	Flags;		//!< WARM_FLG_xxx
+} WARM_STATE;
+
+/*========================= Global Data and Routines =========================*/
+
+    /*!@brief Reset cause of the RMU, read by WarmStartInit(). */
+uint32_t	g_ResetCause;
+
+/*================================ Local Data ================================*/
+
+#if WARM_START
+    /*! State block in the <b>.noinit</b> section */
+static WARM_STATE	l_State WARM_NOINIT;
+
+    /*! Flag if this is a warm start with a valid state block */
+static bool		l_flgWarm;
+
+    /*! Heartbeats reported since the last feed, see @ref WDOG_HB */
+static volatile uint32_t l_HbMask;
+
+    /*! sTimer for the heartbeat of the RTC */
+static TIM_HDL		l_hdlWdogCheck = NONE;
+
+/*=========================== Forward Declarations ===========================*/
+
+static uint32_t	stateCheckSum (void);
+static void	wdogTick (TIM_HDL hdl);
+#endif
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the Warm Start Module
+ *
+ * This routine must be called once before LogInit().  It reads and clears
+ * the reset cause of the RMU, checks the retained state, and starts the
+ * watchdog.
+ *
+ ******************************************************************************/
+void	WarmStartInit (void)
+{
+    g_ResetCause = RMU_ResetCauseGet();
+    RMU_ResetCauseClear();	// causes are accumulated otherwise
+
+#if WARM_START
+    l_flgWarm = ((g_ResetCause & WARM_START_RST_MASK) == 0
+		 &&  l_State.Magic == WARM_START_MAGIC
+		 &&  l_State.Check == stateCheckSum());
+    if (l_flgWarm)
+    {
+	l_State.Restarts++;
+    }
+    else
+    {
+	memset (&l_State, 0, sizeof(l_State));
+	l_State.Magic = WARM_START_MAGIC;
+    }
+    l_State.Check = stateCheckSum();
+
+    /* Start the watchdog, it also runs in EM2 */
+    while (WDOG->SYNCBUSY & WDOG_SYNCBUSY_CTRL)
+	;
+    WDOG->CTRL = WDOG_CTRL_EN | WDOG_CTRL_EM2RUN | WDOG_CTRL_CLKSEL_ULFRCO
+	       | (WDOG_PERSEL << _WDOG_CTRL_PERSEL_SHIFT);
+#endif
+}
+
+#if WARM_START
+/***************************************************************************//**
+ *
+ * @brief	Restore the System Clock after a Warm Reset
+ *
+ * This routine must be called once after AlarmClockInit().  It starts the
+ * sTimer for the heartbeat @ref WDOG_HB_TIMER.  After a warm reset with a
+ * valid state block, the system clock is set to the saved time plus the
+ * estimated outage:  The watchdog expires @ref WDOG_TIMEOUT seconds after
+ * the last feed, i.e. the last save, a reboot saves the time just before,
+ * and other resets occur between two saves.
+ *
+ ******************************************************************************/
+void	WarmStartRestore (void)
+{
+struct tm tm;
+time_t	 t;
+uint32_t outage;
+
+    if (l_hdlWdogCheck == NONE)
+    {
+	l_hdlWdogCheck = sTimerCreate (wdogTick);
+	if (l_hdlWdogCheck != NONE)
+	    sTimerStart (l_hdlWdogCheck, WDOG_CHECK_INTERVAL);
+    }
+
+    if (! l_flgWarm  ||  (l_State.Flags & WARM_FLG_VALID) == 0)
+	return;
+
+    if (g_ResetCause & RMU_RSTCAUSE_WDOGRST)
+	outage = WDOG_TIMEOUT;
+    else if (g_ResetCause & RMU_RSTCAUSE_SYSREQRST)
+	outage = 0;			// saved by Reboot() just before
+    else
+	outage = WDOG_CHECK_INTERVAL / 2;
+
+    t = (time_t)l_State.Time + outage;
+    tm = *localtime (&t);
+    g_isdst = (l_State.Flags & WARM_FLG_DST) != 0;
+    ClockSet (&tm, true);
+
+    if (l_State.Flags & WARM_FLG_SYNCED)
+	LogEvent ("Warm Restart #%ld (Reset 0x%02lX): Time +%lds, last Sync "
+		  "%ldmin ago", (long)l_State.Restarts,
+		  (unsigned long)g_ResetCause, (long)outage,
+		  (long)(l_State.Time - l_State.LastSync) / 60);
+    else
+	LogEvent ("Warm Restart #%ld (Reset 0x%02lX): Time +%lds, not synced",
+		  (long)l_State.Restarts, (unsigned long)g_ResetCause,
+		  (long)outage);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Report a Heartbeat
+ *
+ * This routine may be called from any context.  The watchdog is only fed if
+ * all heartbeats of @ref WDOG_HB have been reported, see WarmStartCheck().
+ *
+ * @param[in] hb
+ *	Heartbeat to be reported.
+ *
+ ******************************************************************************/
+void	WarmStartHeartbeat (WDOG_HB hb)
+{
+    FLAG_SET(l_HbMask, hb);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Check the Heartbeats
+ *
+ * This routine is called by each pass of the main loop, which reports the
+ * heartbeat @ref WDOG_HB_MAIN this way.  If all heartbeats are present, the
+ * watchdog is fed, the heartbeats are cleared, and the current state is
+ * saved.
+ *
+ ******************************************************************************/
+void	WarmStartCheck (void)
+{
+int	hb;
+
+    FLAG_SET(l_HbMask, WDOG_HB_MAIN);
+    if ((l_HbMask & WDOG_HB_ALL) != WDOG_HB_ALL)
+	return;
+
+    /* A heartbeat which is lost here is reported again by the next pass */
+    for (hb = 0;  hb < END_WDOG_HB;  hb++)
+	FLAG_CLR(l_HbMask, hb);
+
+    /* Feed the watchdog, a clear command in progress is sufficient */
+    if ((WDOG->SYNCBUSY & WDOG_SYNCBUSY_CMD) == 0)
+	WDOG->CMD = WDOG_CMD_CLEAR;
+
+    WarmStartSave (false);
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Save the Current State
+ *
+ * This routine saves the current time into the retained state block.  It is
+ * called when the watchdog is fed, by TimeSrcSync() after a synchronization,
+ * and before a reboot.
+ *
+ * @param[in] flgSynced
+ *	If true, the clock has just been synchronized by the time source.
+ *
+ ******************************************************************************/
+void	WarmStartSave (bool flgSynced)
+{
+struct tm now;
+int32_t	  t;
+
+    if (g_PowerUpTime == 0)
+	return;			// no valid time set yet
+
+    ClockGet (&now);
+    now.tm_isdst = 0;		// always 0 for mktime()
+    t = (int32_t)mktime (&now);	// also valid for Y2K38_WORKAROUND
+
+    INT_Disable();
+    l_State.Time  = t;
+    if (flgSynced)
+    {
+	l_State.LastSync = t;
+	l_State.Flags |= WARM_FLG_SYNCED;
+    }
+    l_State.Flags = (l_State.Flags & WARM_FLG_SYNCED) | WARM_FLG_VALID
+		  | (g_isdst ? WARM_FLG_DST : 0);
+    l_State.Check = stateCheckSum();
+    INT_Enable();
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Check Sum of the State Block
+ *
+ * This routine calculates the check sum over all words of @ref l_State
+ * after its <b>Check</b> field.
+ *
+ ******************************************************************************/
+static uint32_t	stateCheckSum (void)
+{
+const uint32_t *pWord = (const uint32_t *)&l_State.Magic;
+uint32_t sum = ~WARM_START_MAGIC;
+unsigned int i;
+
+    for (i = 1;  i < sizeof(l_State) / sizeof(uint32_t);  i++)
+	sum = ((sum << 1) | (sum >> 31)) ^ *pWord++;
+
+    return sum;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Heartbeat of the RTC
+ *
+ * This routine is called by the sTimer every @ref WDOG_CHECK_INTERVAL
+ * seconds.  It reports the heartbeat @ref WDOG_HB_TIMER and requests
+ * another pass of the main loop, which checks the heartbeats.
+ *
+ ******************************************************************************/
+static void	wdogTick (TIM_HDL hdl)
+{
+    sTimerStartSlack (hdl, WDOG_CHECK_INTERVAL, WDOG_CHECK_INTERVAL / 2);
+
+    WarmStartHeartbeat (WDOG_HB_TIMER);
+    EVENT_POST(EVT_WAKE);
+}
+#endif
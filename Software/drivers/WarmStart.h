@@ -0,0 +1,78 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of module WarmStart.c
+ * @author	agent
+ * @version	2026-10-15
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+#ifndef __INC_WarmStart_h
+#define __INC_WarmStart_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdbool.h>
+#include "em_device.h"
+#include "config.h"		// include project configuration parameters
+
+/*=============================== Definitions ================================*/
+
+/*!@brief Set this define 1 to supervise the main loop and the timers by the
+ * watchdog, and to restore the system clock after a warm reset from the
+ * state retained in RAM, see WarmStartRestore().
+ */
+#ifndef WARM_START
+    #define WARM_START		0
+#endif
+
+/*!@brief Period select of the watchdog, it expires after 2^(3+n)+1 cycles
+ * of the ULFRCO (1kHz), i.e. 15 is about 262 seconds.
+ */
+#ifndef WDOG_PERSEL
+    #define WDOG_PERSEL		15
+#endif
+
+/*!@brief Approximate watchdog period in seconds, see @ref WDOG_PERSEL. */
+#define WDOG_TIMEOUT	(((1UL << (3 + WDOG_PERSEL)) + 1) / 1000)
+
+/*!@brief Interval in seconds the heartbeats are checked and the watchdog
+ * is fed.  It must be well below @ref WDOG_TIMEOUT.
+ */
+#ifndef WDOG_CHECK_INTERVAL
+    #define WDOG_CHECK_INTERVAL	60
+#endif
+
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Heartbeats which must all be present to feed the watchdog. */
+typedef enum
+{
+    WDOG_HB_MAIN,	//!< 0: the main loop passes WarmStartCheck()
+    WDOG_HB_TIMER,	//!< 1: the sTimers of the RTC are processed
+    END_WDOG_HB
+} WDOG_HB;
+
+/*======================== External Data and Routines ========================*/
+
+extern uint32_t	g_ResetCause;	//!< Reset cause of the RMU, see RMU_RSTCAUSE
+
+/*================================ Prototypes ================================*/
+
+    /* Read the reset cause, check the retained state, start the watchdog */
+void	WarmStartInit (void);
+
+    /* Restore the system clock after a warm reset */
+void	WarmStartRestore (void);
+
+    /* Report a heartbeat, check the heartbeats in the main loop */
+void	WarmStartHeartbeat (WDOG_HB hb);
+void	WarmStartCheck (void);
+
+    /* Save the current state into the retained RAM */
+void	WarmStartSave (bool flgSynced);
+
+
+#endif /* __INC_WarmStart_h */
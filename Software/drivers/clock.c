@@ -33,6 +33,16 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Added clockSlew() to apply a correction gradually, one tick per
+		a number of counter ticks.  The due part is added to the tick
+		offset by time() and clockGetTickOffset(), so the time base
+		remains monotonic.  A new start time cancels the slew.
+2026-10-15,agnt	Added clockAdjust() and clockGetTickOffset().  The tick offset
+		is added to the counter in time(), it is reset when a new start
+		time is set.
+2026-10-14,agnt	time() does not divide by rtcCountsPerSec before clockInit()
+		has been called.  The Cortex-M3 returns 0 in this case, but the
+		host simulation would trap.
 2015-06-10,rage	Be sure to set tm_isdst to 0 before calling mktime().
 		Added __getzone() for the IAR version of mktime().
 2014-04-10,rage	Made rtcStartTime global, renamed to g_rtcStartTime.
@@ -52,6 +62,7 @@ Revision History:
 #include "em_device.h"
 #include "em_bitband.h"
 #include "em_rtc.h"
+#include "em_int.h"
 
 /* Include system clock*/
 #include "clock.h"
@@ -62,6 +73,13 @@ time_t	          g_rtcStartTime        = 0;
 static uint32_t   rtcOverflowCounter    = 0;
 static uint32_t   rtcOverflowInterval   = 0;
 static uint32_t   rtcOverflowIntervalR  = 0;
+static uint32_t   rtcTickOffset         = 0;	/* RAGE: 0..rtcCountsPerSec-1 */
+static int32_t    rtcSlewRemain         = 0;	/* RAGE: ticks still to slew */
+static uint32_t   rtcSlewDiv            = 1;	/* RAGE: ticks per slew step */
+static uint32_t   rtcSlewCnt            = 0;	/* RAGE: counter of last step */
+
+/* RAGE: Forward declaration */
+static void clockSlewUpdate(void);
 
 
 
@@ -87,6 +105,9 @@ time_t time( time_t * timer )
 {
   time_t t;
 
+  /* RAGE: Add the part of a slew which is due */
+  clockSlewUpdate();
+
   /* Add the time offset */
   t = g_rtcStartTime;
 
@@ -102,8 +123,11 @@ time_t time( time_t * timer )
     t += (rtcOverflowCounter * rtcOverflowIntervalR) / rtcCountsPerSec;
   }
 
-  /* Add the number of seconds for RTC */
-  t += ( RTC->CNT / rtcCountsPerSec );
+  /* Add the number of seconds for RTC (if clockInit() has been called) */
+  if ( rtcCountsPerSec != 0 )
+  {
+    t += ( (RTC->CNT + rtcTickOffset) / rtcCountsPerSec );
+  }
 
   /* RAGE: Enable overflow interrupt again */
   BITBAND_Peripheral (&(RTC->IEN), _RTC_IEN_OF_SHIFT, 1);
@@ -156,6 +180,8 @@ void clockSetStartCalendar(struct tm * timeptr)
 {
   timeptr->tm_isdst = 0;		// always 0 for mktime()
   g_rtcStartTime = mktime(timeptr);
+  rtcTickOffset = 0;
+  rtcSlewRemain = 0;			/* RAGE: cancel slew */
 }
 
 
@@ -170,6 +196,8 @@ void clockSetStartCalendar(struct tm * timeptr)
 void clockSetStartTime(time_t offset)
 {
   g_rtcStartTime = offset;
+  rtcTickOffset = 0;
+  rtcSlewRemain = 0;			/* RAGE: cancel slew */
 }
 
 
@@ -191,6 +219,142 @@ time_t clockGetStartTime(void)
 
 
 
+/***************************************************************************//**
+ * @brief RAGE: Advance or retard the time base by a number of RTC ticks
+ *
+ * The ticks are added to the tick offset, whole seconds are moved to the
+ * epoch offset, so the tick offset always stays below rtcCountsPerSec.
+ * Interrupts must be disabled by the caller.
+ *
+ * @param[in] ticks
+ *   Number of RTC ticks, positive to advance the time
+ *
+ ******************************************************************************/
+void clockAdjust(int32_t ticks)
+{
+  int32_t offset;
+
+  if ( rtcCountsPerSec == 0 )
+  {
+    return;
+  }
+
+  offset = (int32_t)rtcTickOffset + ticks;
+
+  g_rtcStartTime += offset / (int32_t)rtcCountsPerSec;
+  offset %= (int32_t)rtcCountsPerSec;
+  if ( offset < 0 )
+  {
+    offset += rtcCountsPerSec;
+    g_rtcStartTime--;
+  }
+  rtcTickOffset = (uint32_t)offset;
+}
+
+
+
+/***************************************************************************//**
+ * @brief RAGE: Get the tick offset which is added to the counter by time()
+ *
+ * @return
+ *   Tick offset, 0 .. rtcCountsPerSec-1
+ *
+ ******************************************************************************/
+uint32_t clockGetTickOffset(void)
+{
+  clockSlewUpdate();
+  return rtcTickOffset;
+}
+
+
+
+/***************************************************************************//**
+ * @brief RAGE: Slew the time base by a number of RTC ticks
+ *
+ * In contrast to clockAdjust(), the correction is applied gradually: the
+ * tick offset is changed by one tick after each <div> counter ticks, i.e.
+ * the clock runs faster or slower by 1/<div>.  Since a step never exceeds
+ * the ticks elapsed since the previous one, the time base remains monotonic.
+ * The due part is applied by time() and clockGetTickOffset(), which must be
+ * called at least every 512s, i.e. once per counter wrap-around.  A new
+ * call replaces a slew which is still in progress.  Interrupts must be
+ * disabled by the caller.
+ *
+ * @param[in] ticks
+ *   Number of RTC ticks, positive to advance the time
+ *
+ * @param[in] div
+ *   Number of counter ticks per slew step, at least 2
+ *
+ ******************************************************************************/
+void clockSlew(int32_t ticks, uint32_t div)
+{
+  rtcSlewRemain = ticks;
+  rtcSlewDiv    = (div < 2 ? 2 : div);
+  rtcSlewCnt    = RTC->CNT;
+}
+
+
+
+/***************************************************************************//**
+ * @brief RAGE: Get the number of RTC ticks which are still to be slewed
+ *
+ * @return
+ *   Remaining ticks, positive if the time is advanced
+ *
+ ******************************************************************************/
+int32_t clockGetSlew(void)
+{
+  return rtcSlewRemain;
+}
+
+
+
+/***************************************************************************//**
+ * @brief RAGE: Apply the part of the slew which is due
+ *
+ ******************************************************************************/
+static void clockSlewUpdate(void)
+{
+  uint32_t steps;
+
+  if ( rtcSlewRemain == 0 )
+  {
+    return;
+  }
+
+  INT_Disable();
+
+  steps = ((RTC->CNT - rtcSlewCnt) & 0x00FFFFFF) / rtcSlewDiv;
+  if ( steps > 0 && rtcSlewRemain != 0 )
+  {
+    rtcSlewCnt = (rtcSlewCnt + steps * rtcSlewDiv) & 0x00FFFFFF;
+
+    if ( rtcSlewRemain > 0 )
+    {
+      if ( steps > (uint32_t)rtcSlewRemain )
+      {
+        steps = (uint32_t)rtcSlewRemain;
+      }
+      clockAdjust((int32_t)steps);
+      rtcSlewRemain -= (int32_t)steps;
+    }
+    else
+    {
+      if ( steps > (uint32_t)(-rtcSlewRemain) )
+      {
+        steps = (uint32_t)(-rtcSlewRemain);
+      }
+      clockAdjust(-(int32_t)steps);
+      rtcSlewRemain += (int32_t)steps;
+    }
+  }
+
+  INT_Enable();
+}
+
+
+
 /***************************************************************************//**
  * @brief Call this function on counter overflow to let CLOCK know how many
  *        overflows has occurred since start time
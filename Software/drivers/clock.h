@@ -33,6 +33,8 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	Added prototypes for clockSlew() and clockGetSlew().
+2026-10-15,agnt	Added prototypes for clockAdjust() and clockGetTickOffset().
 2014-04-10,rage	Added global variable g_rtcStartTime.
 */
 
@@ -104,5 +106,9 @@ time_t clockGetStartTime(void);
 uint32_t clockOverflow(void);
 void clockSetOverflowCounter(uint32_t of);
 uint32_t clockGetOverflowCounter(void);
+void clockAdjust(int32_t ticks);
+uint32_t clockGetTickOffset(void);
+void clockSlew(int32_t ticks, uint32_t div);
+int32_t clockGetSlew(void);
 
 #endif
@@ -3,7 +3,7 @@
  * @brief	Driver for the SD-Card interface
  * @author	Silicon Labs
  * @author	Ralf Gerhauser
- * @version	2015-03-30
+ * @version	2026-10-15
  *
  * This is the driver for the SD-Card interface.  It provides all required
  * board-specific functionality to access an SD-Card via SPI.
@@ -24,6 +24,75 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	The DMA configurations are local variables of the routines which
+		use them.
+2026-10-15,agnt	The SD-Card supply is no longer accounted in an energy ledger.
+2026-10-15,agnt	Removed the timeline marks of DiskCheck().
+2026-10-15,agnt	Removed the SD-Card health monitor, it did not fit into the
+		RAM of the device.
+2026-10-15,agnt	Test the alignment of a buffer via uintptr_t.
+2026-10-15,agnt	A CRC error only requests the lower SPI clock, it is applied by
+		SpiClkDowngrade() when no DMA transfer is active, i.e. after
+		the last block of MICROSD_MultiBlockRx().
+2026-10-15,agnt	The FAT scan of DiskFreeScanStep() and MICROSD_SpiClkTune()
+		read their sectors into the window of the file system, since
+		FILE_READ_BUF_SIZE is smaller than a sector now.
+2026-10-15,agnt	Added FileReaderTell() and FileReaderSeek() to move the file
+		reader to a line which is known by its offset.
+2026-10-15,agnt	Added MICROSD_MultiBlockRx() for CMD18, the CRC16 of a block
+		is verified while the DMA receives the next one.  The Tx
+		channel which clocks the dummy words of a read raises no
+		interrupt any more.  MICROSD_BlockRx() has been split into
+		BlockRxToken(), BlockRxStart(), BlockRxEnd(), and
+		BlockRxCrcCheck().
+2026-10-15,agnt	The DMA channels are set up via DmaChanConfig().
+2026-10-15,agnt	Record the busy times of the data commands, the timeouts, and
+		the initialization time of the SD-Card.  A slow card is flagged
+		in the log at mount time, see DISK_HEALTH and DiskHealthReport().
+2026-10-15,agnt	DiskCheck() records the mount stages in the timeline, see
+		TIMELINE.
+2026-10-15,agnt	MICROSD_XferSpi() is executed from RAM, see RAMFUNC.  It
+		accesses the USART directly instead of USART_SpiTransfer(),
+		so the polling loop does not run from flash.
+2026-10-15,agnt	Added DiskFreeDefer() to report the free space of the first
+		mount later, see FAST_BOOT.
+2026-10-15,agnt	The SPI clock is acquired via ClockMgr.c, MICROSD_Init() no
+		longer leaves it running until the card is powered.
+2026-10-15,agnt	The SD-Card holds a boost of the HF clock governor while it is
+		in use, see DiskHfBoost() and HF_CLOCK_GOVERNOR.
+2026-10-15,agnt	Use StrFormat() instead of sprintf().
+2026-10-14,agnt	DiskRelease() and DiskPowerFailHandler() write back the sector
+		cache of diskio.c, see _DISK_CACHE_SECTORS.  Added
+		DiskCacheReport().  MICROSD_SpiClkTune() reads sector 0 directly
+		via CMD17, bypassing the cache.
+2026-10-14,agnt	MICROSD_BlockRx: Verify the CRC16 of the data block, reduce the
+		SPI clock on CRC errors, see MICROSD_CRC_CHECK.
+		MICROSD_SpiClkTune: Select the fastest SPI clock with error-free
+		block reads after initialization of a new SD-Card.
+2026-10-15,agnt	The SD-Card supply is accounted in the energy ledger, see
+		EnergyLedger.c.
+2026-10-15,agnt	Added DiskFreeKnown() to get the free space without any
+		access to the SD-Card.
+2026-10-14,agnt	Implemented DiskAcquire() and DiskRelease() to retain an idle
+		SD-Card with its supply kept up for DISK_RETAIN_TIME seconds,
+		the USART clock is switched off meanwhile.  Added
+		DiskPowerFailHandler().
+2026-10-14,agnt	Implemented CD_Handler() to detect SD-Card insertion and removal
+		by an external interrupt, see DISK_CD_EXTI.  The CD signal is
+		debounced by DISK_CD_DEBOUNCE.
+2026-10-14,agnt	DiskCheck() is triggered via EVENT_POST(EVT_DISK), and every
+		DISK_CD_POLL_INTERVAL seconds by the sTimer DiskPollTimeout().
+2026-10-14,agnt	DMA callbacks: Cycles are measured, see ISR_PROFILE.
+2026-10-14,agnt	Implemented a buffered file reader, see FileReadLine().
+		get_fattime: Use ClockGet() to consider the tickless RTC mode.
+		MICROSD_BlockTx: Transmit data blocks via DMA, the CPU sleeps
+		in EM1 meanwhile.
+		MICROSD_BlockRx: Receive data blocks via DMA, a second channel
+		transmits the dummy words.
+		FindFile: Cache results, known patterns are looked up by a
+		single directory scan after mounting.
+		DiskSize: Trust the FSInfo free cluster count, otherwise scan
+		the FAT in the background, see DiskFreeScanStep().
 2016-09-27,rage	Use INT_En/Disable() instead of __en/disable_irq().
 2016-04-05,rage	Made local variables of type "volatile".
 2016-02-21,rage	Added IsDiskRemoved() to query CF-Card removal.
@@ -33,13 +102,23 @@ Revision History:
 
 /*=============================== Header Files ===============================*/
 
+#include <stdio.h>
 #include <string.h>
 #include "em_cmu.h"
+#include "em_dma.h"
+#include "em_emu.h"
 #include "em_int.h"
 #include "em_usart.h"
 #include "microsd.h"
 #include "AlarmClock.h"
 #include "Logging.h"
+#include "LEUART.h"
+#include "PowerFail.h"
+#include "IsrProfile.h"
+#include "StrFormat.h"
+#include "HfClock.h"
+#include "ClockMgr.h"
+#include "DmaChan.h"
 
 /*=============================== Definitions ================================*/
 
@@ -58,6 +137,7 @@ Revision History:
 #define IS_DISK_PRESENT		(IO_Bit(GPIO->P[MICROSD_SPI_GPIO_PORT].DIN, \
 					MICROSD_CD_PIN) == 0)
 
+
 /*=========================== Typedefs and Structs ===========================*/
 
 /*!@brief Enumeration of Disk States
@@ -76,13 +156,134 @@ typedef enum
     END_DISK_STATE
 } DISK_STATE;
 
+/*!@brief Cached result of FindFile() */
+typedef struct
+{
+    char	Pattern[13];	//!< Filename pattern
+    char	Name[13];	//!< Matching filename, empty if not found
+} FIND_FILE_ENTRY;
+
+
+/*========================= Global Data and Routines =========================*/
+
+#if MICROSD_USE_DMA
+    /* DMA Control Block, see DMA_ControlBlock.c */
+extern DMA_DESCRIPTOR_TypeDef g_DMA_ControlBlock[];
+#endif
+
 /*================================ Local Data ================================*/
 
 static volatile uint32_t timeOut, xfersPrMsec;
+
+    /*! SPI clock used by MICROSD_SpiClkFast(), see MICROSD_SpiClkTune() */
+static uint32_t		 l_SpiFreq = MICROSD_HI_SPI_FREQ;
+
+    /*! USART settings saved by BlockRxStart() */
+static uint32_t		 l_RxFrame, l_RxCtrl;
+
+#if MICROSD_CRC_CHECK
+    /*! Flag is set while MICROSD_SpiClkTune() is in progress */
+static bool		 l_flgSpiTune;
+
+    /*! Flag is set by a CRC error, see MICROSD_RxCrcError() */
+static bool		 l_flgCrcError;
+
+    /*! Flag is set by a CRC error, see SpiClkDowngrade() */
+static bool		 l_flgSpiClkDown;
+
+    /*! Number of CRC errors of received data blocks */
+static uint32_t		 l_CrcErrCnt;
+
+    /*! Nibble table for the CRC16 (CCITT polynomial 0x1021) */
+static const uint16_t	 l_CRC16_Nibble[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+#endif
 static FATFS		 l_FatFS;
 static volatile DISK_STATE l_DiskState = DS_UNKNOWN;
 static volatile DISK_STATE l_PrevDiskState;
 
+    /*! Cache of FindFile() results for the root directory */
+static FIND_FILE_ENTRY	 l_FindCache[FIND_FILE_CACHE_SIZE];
+static uint8_t		 l_FindCacheCnt, l_FindCacheNext;
+
+    /*! Flag if the SD-Card interface is powered on */
+static bool		 l_flgPowerOn;
+
+    /*! Timer handle to poll the Card-Detect signal */
+static volatile TIM_HDL	 l_hdlDiskPoll = NONE;
+
+    /*! Timer handle to power off a retained SD-Card, see DiskRelease() */
+static volatile TIM_HDL	 l_hdlRetain = NONE;
+
+    /*! Flag if the SD-Card is retained, i.e. powered on but idle */
+static volatile bool	 l_flgRetained;
+
+    /*! Flag is set when the retain time of the SD-Card has elapsed */
+static volatile bool	 l_flgRetainExpired;
+
+#if HF_CLOCK_GOVERNOR
+    /*! Flag if the SD-Card holds a boost of the HF clock governor */
+static bool		 l_flgHfBoost;
+#endif
+
+    /*!@brief Flag is set while the CD signal is being debounced. */
+static volatile bool	 l_flgCD_Debounce;
+
+    /*! State of the background FAT scan, see DiskFreeScanStep() */
+static bool		 l_flgFreeScan;		//!< scan is active
+static uint32_t		 l_FreeScanSect;	//!< next FAT sector to read
+static uint32_t		 l_FreeScanCnt;		//!< free clusters so far
+static uint32_t		 l_FreeScanLastClust;	//!< to detect allocations
+
+    /*! Free space is not reported at mount time, see DiskFreeDefer() */
+static bool		 l_flgFreeDefer;	//!< deferral requested
+static bool		 l_flgFreePending;	//!< report is due
+static uint8_t		 l_FreeScanRetry;	//!< remaining restarts
+
+
+    /*! Shared buffer for the file reader, see FileReaderInit() */
+static uint8_t		 l_FileReadBuf[FILE_READ_BUF_SIZE] __attribute__((aligned(4)));
+
+#if MICROSD_USE_DMA
+    /*! Flag if a DMA transfer is in progress */
+static volatile bool	 l_flgTxDMArun;
+
+    /*! Flag if a DMA receive transfer is in progress */
+static volatile bool	 l_flgRxDMArun;
+
+    /*! Dummy word to be transmitted while receiving a data block */
+static const uint16_t	 l_DummyTx = 0xFFFF;
+#endif
+
+/*=========================== Forward Declarations ===========================*/
+
+static void DiskPollTimeout (TIM_HDL hdl);
+static void DiskRetainTimeout (TIM_HDL hdl);
+static void DiskFreeScanStep (void);
+static void DiskFreeLog (void);
+static void FindFilePrescan (void);
+static bool FindFileScan (const char *dirpath, const char * const *patterns,
+			  int cnt, char (*names)[13]);
+static bool FileMatch (const char *fname, const char *filepattern);
+static void DiskHfBoost (bool flgOn);
+
+#if MICROSD_USE_DMA
+static void MICROSD_TxDone(unsigned int channel, bool primary, void *user);
+static void MICROSD_RxDone(unsigned int channel, bool primary, void *user);
+static void MICROSD_DMA_Wait(volatile bool *pFlgRun);
+#endif
+static bool BlockRxToken(void);
+static bool BlockRxStart(uint8_t *buff, uint32_t btr);
+static uint16_t BlockRxEnd(uint8_t *buff, uint32_t btr, bool flgDMA);
+static int BlockRxCrcCheck(const uint8_t *pBuf, uint32_t cnt, uint16_t crc);
+#if MICROSD_CRC_CHECK
+static void SpiClkDowngrade(void);
+static uint16_t MICROSD_CRC16(const uint8_t *pBuf, uint32_t cnt);
+#endif
+
 
 //==============================================================================
 //
@@ -101,6 +302,81 @@ void	 DiskInit (void)
 {
     /* Initialize the SPI peripheral and GPIOs for microSD card usage */
     MICROSD_Init();
+
+#if DISK_CD_EXTI
+    /*
+     * Enable the internal pull-up of the Card-Detect (CD) pin and connect
+     * it to the external interrupt, the EXTI itself is configured later by
+     * calling ExtIntInit(), see CD_Handler().
+     */
+    GPIO_PinModeSet (MICROSD_SPI_GPIO_PORT, MICROSD_CD_PIN, gpioModeInputPull, 1);
+    GPIO_IntConfig  (MICROSD_SPI_GPIO_PORT, MICROSD_CD_PIN, false, false, false);
+#endif
+
+    /* Create timer to poll the Card-Detect signal, see DiskCheck() */
+    if (l_hdlDiskPoll == NONE)
+	l_hdlDiskPoll = sTimerCreate (DiskPollTimeout);
+
+#if DISK_RETAIN_TIME > 0
+    /* Create timer to power off a retained SD-Card, see DiskRelease() */
+    if (l_hdlRetain == NONE)
+	l_hdlRetain = sTimerCreate (DiskRetainTimeout);
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Card-Detect Handler
+ *
+ * This handler is called by the EXTI interrupt service routine whenever the
+ * level of the Card-Detect (CD) signal changes, i.e. an SD-Card has been
+ * inserted or removed.  Each edge restarts the poll timer with a duration
+ * of @ref DISK_CD_DEBOUNCE, so DiskCheck() is triggered once the contacts
+ * of the socket have settled.
+ *
+ * @param[in] extiNum
+ *	EXTernal Interrupt number, this is identical with @ref MICROSD_CD_PIN.
+ *
+ * @param[in] extiLvl
+ *	EXTernal Interrupt level: 0 means an SD-Card is present, 1 that it has
+ *	been removed.  The level is not used here, it is sampled again after
+ *	debouncing.
+ *
+ * @param[in] timeStamp
+ *	Time stamp when the event has been received.  This parameter is not
+ *	used here.
+ *
+ ******************************************************************************/
+void	 CD_Handler (int extiNum, bool extiLvl, uint32_t timeStamp)
+{
+    (void) extiNum;	// suppress compiler warning "unused parameter"
+    (void) extiLvl;
+    (void) timeStamp;
+
+    /* Evaluate the CD signal after it has been stable for a while */
+    l_flgCD_Debounce = true;
+    if (l_hdlDiskPoll != NONE)
+	sTimerStart (l_hdlDiskPoll, DISK_CD_DEBOUNCE);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Disk Poll Timeout
+ *
+ * This routine is called from the RTC interrupt handler every
+ * @ref DISK_CD_POLL_INTERVAL seconds to trigger DiskCheck().  In EXTI mode
+ * it is also called @ref DISK_CD_DEBOUNCE seconds after the last edge of
+ * the Card-Detect signal, see CD_Handler().
+ *
+ ******************************************************************************/
+static void DiskPollTimeout (TIM_HDL hdl)
+{
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    l_flgCD_Debounce = false;	// CD signal is stable now
+    EVENT_POST(EVT_DISK);
 }
 
 
@@ -108,12 +384,20 @@ void	 DiskInit (void)
  *
  * @brief	Disk Check
  *
- * This routine checks if an SD-Card has been inserted or removed.  This is
- * done in polling mode by switching on an external low impedance pull-up
- * resistor for the Card-Detect (CD) pin and reading the current state of
- * this signal.  It then takes the appropriate action to mount or invalidate
- * the file system of the media.  Finally the pull-up resistor is switched
- * off again for power saving reasons.
+ * This routine checks if an SD-Card has been inserted or removed.  If
+ * @ref DISK_CD_EXTI is 0, this is done in polling mode by switching on an
+ * external low impedance pull-up resistor for the Card-Detect (CD) pin and
+ * reading the current state of this signal.  It then takes the appropriate
+ * action to mount or invalidate the file system of the media.  Finally the
+ * pull-up resistor is switched off again for power saving reasons.  The main
+ * loop calls this routine for @ref EVT_DISK, which is posted by the state
+ * machine itself, and every @ref DISK_CD_POLL_INTERVAL seconds.
+ * In EXTI mode the CD pin keeps its internal pull-up, and CD_Handler() posts
+ * @ref EVT_DISK after a card has been inserted or removed.  The periodic
+ * poll is then only used to retry the initialization of an inserted card.
+ * While the CD signal is being debounced, its state is not evaluated.
+ * A retained SD-Card is powered off here when its retain time has elapsed,
+ * see DiskRelease().
  *
  * @return
  *	Disk state: <b>true</b> if a new file system has been mounted,
@@ -127,11 +411,26 @@ void	 DiskInit (void)
 bool	 DiskCheck (void)
 {
 bool	 state = false;
+FRESULT	 res;
 
 
+    /* Power off a retained SD-Card after its retain time has elapsed */
+    if (l_flgRetainExpired)
+    {
+	l_flgRetainExpired = false;
+	if (l_flgRetained)
+	    MICROSD_PowerOff();
+    }
+
+#if DISK_CD_EXTI
+    /* Wait until the CD signal is stable, see CD_Handler() */
+    if (l_flgCD_Debounce)
+	return false;
+#else
     /* Enable Card Detect (CD) Pin with Pull-Up */
     GPIO_PinModeSet(MICROSD_SPI_GPIO_PORT, MICROSD_CD_PULLUP_PIN,
                     gpioModePushPull, 1);
+#endif
 
     /* Save current state for next time */
     l_PrevDiskState = l_DiskState;
@@ -156,12 +455,14 @@ bool	 state = false;
 
 		/* Invalidate current File System */
 		l_FatFS.fs_type = 0;
+		FindFileCacheInvalidate();
+		l_flgFreeScan = false;
 		disk_ioctl(0, CTRL_INVALIDATE, NULL);
 
 		/* Shut Down and Power Off the SD-Card */
 		MICROSD_Deinit();
 	    }
-	    /* no break */
+	    /* fall through */
 
 	case DS_UNKNOWN:	// Unknown state after power-up or reset
 	    /* Check for card insertion */
@@ -188,6 +489,9 @@ bool	 state = false;
 	    {
 		l_DiskState = DS_INITIALIZED;
 		Log ("SD-Card Initialized");
+
+		/* Select the fastest SPI clock this SD-Card can deal with */
+		MICROSD_SpiClkTune();
 	    }
 	    else
 	    {
@@ -197,20 +501,21 @@ bool	 state = false;
 
 	case DS_INITIALIZED:	// The SD-Card is initialized
 	    /* Try mounting the File System on the SD-Card */
-	    if (f_mount(0, &l_FatFS) == FR_OK)
+	    res = f_mount(0, &l_FatFS);
+	    if (res == FR_OK)
 	    {
-	    uint32_t	sizeMB;
-
 		l_DiskState = DS_MOUNTED;
 		Log ("SD-Card File System mounted");
 		state = true;	// Inform caller about the new mount
 
-		/* Log Disk Size and display it on the LCD */
-		sizeMB = DiskSize();
-		if (sizeMB > 0)
-		{
-		    Log ("SD-Card %ldMB free", sizeMB);
-		}
+		/* Look up the known file patterns by a single scan */
+		FindFilePrescan();
+
+		/* Log Disk Size, unless this is deferred */
+		if (l_flgFreeDefer)
+		    l_flgFreePending = true;
+		else
+		    DiskFreeLog();
 	    }
 	    else
 	    {
@@ -221,6 +526,8 @@ bool	 state = false;
 
 	case DS_MOUNTED:	// File System on the SD-Card has been mounted
 	    /* Remain in this state until card removal */
+	    if (l_flgFreeScan)
+		DiskFreeScanStep();	// count free clusters in background
 	    break;
 
 	case DS_MOUNT_FAILED:	// Mounting the File System failed
@@ -234,16 +541,208 @@ bool	 state = false;
 
     /* See if Disk State has changed */
     if (l_DiskState != l_PrevDiskState)
-	g_flgIRQ = true;		// immediately process the new state
+	EVENT_POST(EVT_DISK);		// immediately process the new state
 
+#if DISK_CD_EXTI
+    /* An inserted card that could not be initialized is polled again */
+    if (l_DiskState == DS_INSERTED  &&  l_hdlDiskPoll != NONE)
+	sTimerStart (l_hdlDiskPoll, DISK_CD_POLL_INTERVAL);
+#else
     /* Disable Card Detect (CD) Pin again */
     GPIO_PinModeSet(MICROSD_SPI_GPIO_PORT, MICROSD_CD_PULLUP_PIN,
                     gpioModeDisabled, 0);
 
+    /* Poll the Card-Detect signal again after a while */
+    if (l_hdlDiskPoll != NONE)
+	sTimerStart (l_hdlDiskPoll, DISK_CD_POLL_INTERVAL);
+#endif
+
     return state;
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Acquire the SD-Card
+ *
+ * This routine must be called before accessing the mounted file system.  If
+ * the SD-Card has been retained by DiskRelease(), only the clock of the SPI
+ * interface is switched on again.  Otherwise the SD-Card interface is powered
+ * on and the card is re-initialized via disk_initialize(), which runs the
+ * complete CMD0/CMD8/ACMD41 sequence at low SPI clock.
+ *
+ * @return
+ *	Disk status, 0 if the SD-Card is ready, see disk_initialize().
+ *
+ * @see DiskRelease().
+ *
+ ******************************************************************************/
+DSTATUS	 DiskAcquire (void)
+{
+bool	 flgRetained = l_flgRetained;
+
+
+    /* Power on the SD-Card interface, this also ends a retained state */
+    MICROSD_PowerOn();
+
+    /* A retained SD-Card is still initialized */
+    if (flgRetained)
+	return 0;
+
+    /* Re-Initialize disk (mount is still the same!) */
+    return disk_initialize(0);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Release the SD-Card
+ *
+ * This routine must be called when the access to the file system is finished.
+ * If <b>flgRetain</b> is set, the SD-Card is kept deselected with its supply
+ * up and the clock of the SPI interface is switched off.  This avoids the
+ * re-initialization of the card by the next DiskAcquire() within
+ * @ref DISK_RETAIN_TIME seconds.  After this time DiskCheck() powers the
+ * card off.  In case of power-fail, or if @ref DISK_RETAIN_TIME is 0, the
+ * SD-Card is powered off immediately.  Dirty sectors of the sector cache
+ * are always written back before.
+ *
+ * @param[in] flgRetain
+ *	Set <b>true</b> to retain the SD-Card, this should only be done if the
+ *	previous accesses have been successful.  <b>false</b> powers it off.
+ *
+ * @see DiskAcquire().
+ *
+ ******************************************************************************/
+void	 DiskRelease (bool flgRetain)
+{
+    /* Write back the sector cache while the SPI clock is still running */
+    if (l_flgPowerOn  &&  ! l_flgRetained)
+	disk_ioctl(0, CTRL_SYNC, NULL);
+
+    if (flgRetain  &&  l_flgPowerOn  &&  l_hdlRetain != NONE
+    &&  ! IsPowerFail())
+    {
+	/* SD-Card is already deselected, stop the clock of the SPI */
+	ClockRelease (CLK_OWN_DISK, MICROSD_CMUCLOCK);
+	DiskHfBoost (false);
+
+	l_flgRetainExpired = false;
+	l_flgRetained = true;
+	sTimerStart (l_hdlRetain, DISK_RETAIN_TIME);
+    }
+    else
+    {
+	MICROSD_PowerOff();
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Boost of the HF Clock
+ *
+ * This routine requests the HFXO, see HfClockBoost(), when the SPI interface
+ * of the SD-Card is used, and releases it when the card is powered off or
+ * retained.  So the block transfers, and the parsing and writing of files,
+ * run at 32MHz, while the remaining work runs from the HFRCO.
+ *
+ * @param[in] flgOn
+ *	If true, request the boost, otherwise release it.  Further calls with
+ *	the same value have no effect.
+ *
+ ******************************************************************************/
+static void DiskHfBoost (bool flgOn)
+{
+#if HF_CLOCK_GOVERNOR
+    if (flgOn == l_flgHfBoost)
+	return;
+
+    l_flgHfBoost = flgOn;
+    if (flgOn)
+	HfClockBoost();
+    else
+	HfClockRelease();
+#else
+    (void) flgOn;	// suppress compiler warning "unused parameter"
+#endif
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Disk Retain Timeout
+ *
+ * This routine is called from the RTC interrupt handler when the retain time
+ * of the SD-Card has elapsed.  It triggers DiskCheck() to power off the card.
+ *
+ ******************************************************************************/
+static void DiskRetainTimeout (TIM_HDL hdl)
+{
+    (void) hdl;		// suppress compiler warning "unused parameter"
+
+    l_flgRetainExpired = true;
+    EVENT_POST(EVT_DISK);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Disk Power-Fail Handler
+ *
+ * This routine is called by PowerFailCheck() in case of power-fail.  It
+ * writes back the sector cache and powers off the SD-Card, because the main
+ * loop does not call DiskCheck() during power-fail.  A retained SD-Card has
+ * been synchronized by DiskRelease() already.
+ *
+ ******************************************************************************/
+void	 DiskPowerFailHandler (void)
+{
+    if (! l_flgPowerOn)
+	return;
+
+    if (! l_flgRetained)
+	disk_ioctl(0, CTRL_SYNC, NULL);
+
+    MICROSD_PowerOff();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Sector Cache Statistics
+ *
+ * This routine generates a line with the hits, misses, and write-backs of
+ * the sector cache in diskio.c, see _DISK_CACHE_SECTORS.
+ *
+ * @param[in] flgLog
+ *	If true, the summary is logged and the counters are reset.  If false,
+ *	it is only shown on the debug console.
+ *
+ ******************************************************************************/
+void	 DiskCacheReport (bool flgLog)
+{
+char	 line[80];
+DISK_CACHE_STAT stat;
+
+
+    disk_cache_stat (&stat, flgLog);
+
+    StrFormat (line, "SD-Card Cache %d Sectors: hit=%ld miss=%ld wb=%ld",
+	       _DISK_CACHE_SECTORS, stat.Hits, stat.Misses, stat.WriteBacks);
+
+    if (flgLog)
+    {
+	Log (line);
+    }
+    else
+    {
+	drvLEUART_puts (line);
+	drvLEUART_puts ("\n");
+    }
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Is Disk Removed
@@ -294,17 +793,45 @@ bool	 IsFileHandleValid (FIL *pHdl)
  *
  * @brief	Available Disk Size in MB
  *
- * This routine returns the free disk space in megabyte.
+ * This routine returns the free disk space in megabyte.  The number of free
+ * clusters is taken from the FSInfo sector which is read by FatFs when the
+ * file system is mounted, and maintained by FatFs for each cluster that is
+ * allocated or released.  If this count is not available, the FAT is not
+ * scanned at once, but in steps of @ref DISK_FREE_SCAN_SECTORS sectors by
+ * DiskCheck(), see DiskFreeScanStep().  If @ref DISK_FREE_VERIFY is set,
+ * such a background scan is also started to verify a valid FSInfo count.
  *
  * @return
- *	Free disk space in MB.
+ *	Free disk space in MB, or 0 if it is not known yet.
  *
  ******************************************************************************/
 uint32_t	 DiskSize (void)
 {
 DWORD	 clustCnt;		// Number of available cluster
 FATFS	*pFAT;			// Pointer to FAT structure currently in use
+DIR	 dir;			// Directory object
+
+
+    /* FatFs mounts the volume with the first access */
+    if (f_opendir(&dir, "/") != FR_OK)
+	return 0;
 
+    l_flgFreeScan = false;
+
+    /* FAT12 volumes are small, FatFs can count their clusters immediately */
+    if (l_FatFS.fs_type != FS_FAT12
+    &&  (DISK_FREE_VERIFY  ||  l_FatFS.free_clust > l_FatFS.n_fatent - 2))
+    {
+	/* Start background scan of the FAT */
+	l_FreeScanSect = l_FreeScanCnt = 0;
+	l_FreeScanLastClust = l_FatFS.last_clust;
+	l_FreeScanRetry = DISK_FREE_SCAN_RETRY;
+	l_flgFreeScan = true;
+	EVENT_POST(EVT_DISK);		// perform first step in the main loop
+
+	if (l_FatFS.free_clust > l_FatFS.n_fatent - 2)
+	    return 0;		// free clusters are not known yet
+    }
 
     /* Get free space of the whole disk */
     if (f_getfree("/", &clustCnt, &pFAT) == FR_OK)
@@ -320,12 +847,220 @@ FATFS	*pFAT;			// Pointer to FAT structure currently in use
 }
 
 
+/***************************************************************************//**
+ *
+ * @brief	Defer the Free Disk Space Report
+ *
+ * When <b>flgDefer</b> is set, DiskCheck() does not call DiskSize() after
+ * mounting the file system, so neither the FSInfo sector is read nor a
+ * background FAT scan is started while the system is booting.  The report
+ * is then done by the call of this routine with <b>false</b>, usually when
+ * the main loop has become idle, see @ref FAST_BOOT.
+ *
+ * @param[in] flgDefer
+ *	If true, defer the report of the next mount, otherwise do a deferred
+ *	report now.
+ *
+ ******************************************************************************/
+void	 DiskFreeDefer (bool flgDefer)
+{
+    l_flgFreeDefer = flgDefer;
+
+    if (flgDefer  ||  ! l_flgFreePending)
+	return;
+
+    l_flgFreePending = false;
+
+    /* SD-Card may have been removed or switched off meanwhile */
+    if (l_DiskState != DS_MOUNTED)
+	return;
+
+    if (DiskAcquire() == 0)
+    {
+	DiskFreeLog();
+	DiskRelease (true);
+    }
+    else
+    {
+	DiskRelease (false);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Log the Free Disk Space
+ *
+ * This routine logs the free disk space, if it is already known from the
+ * FSInfo sector.  Otherwise the background scan of DiskSize() logs it when
+ * complete.
+ *
+ ******************************************************************************/
+static void	 DiskFreeLog (void)
+{
+uint32_t	sizeMB;
+
+    sizeMB = DiskSize();
+    if (sizeMB > 0)
+    {
+	Log ("SD-Card %ldMB free", sizeMB);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Known Free Disk Space in KB
+ *
+ * This routine returns the free disk space as far as it is already known
+ * from the FatFs free cluster count, see DiskSize().  In contrast to
+ * DiskSize(), the SD-Card is neither mounted nor scanned, so it may be
+ * called at any time, e.g. for the forecast of Forecast.c.
+ *
+ * @param[out] pKB
+ *	Free disk space in [KB].
+ *
+ * @return
+ *	The value <i>true</i> if the free cluster count is known.
+ *
+ ******************************************************************************/
+bool	 DiskFreeKnown (uint32_t *pKB)
+{
+    if (l_FatFS.fs_type == 0  ||  l_FatFS.free_clust > l_FatFS.n_fatent - 2)
+	return false;		// not mounted or free clusters not known yet
+
+    *pKB = l_FatFS.free_clust * l_FatFS.csize / 2;
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Background Scan for Free Clusters
+ *
+ * This routine is called by DiskCheck() while a FAT scan is active, see
+ * DiskSize().  It reads the next @ref DISK_FREE_SCAN_SECTORS sectors of the
+ * FAT into the sector window of the file system and counts their free
+ * entries.  The window then holds a clean copy of the last sector, so FatFs
+ * stays consistent.  While the window contains data to be written back, the
+ * step is postponed to the next poll of DiskCheck().  Afterwards the main loop is kept running for the next step.
+ * The SD-Card remains powered on for the scan, unless it is switched off by
+ * LogFlush(), in which case it is re-initialized.
+ *
+ * If any cluster is allocated during the scan, the count is not reliable
+ * and the scan is restarted, up to @ref DISK_FREE_SCAN_RETRY times.  When
+ * the scan is complete, the result is stored as FatFs free cluster count.
+ * On FAT32 volumes, it is written to the FSInfo sector with the next
+ * f_sync(), so the following mount does not require a scan.
+ *
+ ******************************************************************************/
+static void	 DiskFreeScanStep (void)
+{
+uint32_t entries;		// FAT entries per sector
+uint32_t cnt;			// sectors to read in this step
+uint32_t clust, i;
+
+
+    if (l_FatFS.last_clust != l_FreeScanLastClust)
+    {
+	/* clusters have been allocated meanwhile - restart the scan */
+	if (l_FreeScanRetry-- == 0)
+	{
+	    l_flgFreeScan = false;
+	    LogError ("SD-Card: FAT Scan aborted");
+	    return;
+	}
+	l_FreeScanSect = l_FreeScanCnt = 0;
+	l_FreeScanLastClust = l_FatFS.last_clust;
+    }
+
+    if (! l_flgPowerOn  ||  l_flgRetained)
+    {
+	/* SD-Card has been switched off or retained, e.g. by LogFlush() */
+	if (DiskAcquire() != 0)
+	{
+	    l_flgFreeScan = false;
+	    LogError ("SD-Card: FAT Scan Initialization Failed");
+	    return;
+	}
+    }
+
+    if (l_FatFS.wflag)
+	return;			// window is dirty, retry with the next poll
+
+    entries = (l_FatFS.fs_type == FS_FAT16 ? 512 / 2 : 512 / 4);
+
+    for (cnt = DISK_FREE_SCAN_SECTORS;  cnt > 0;  cnt--, l_FreeScanSect++)
+    {
+	clust = l_FreeScanSect * entries;	// first entry of this sector
+	if (clust >= l_FatFS.n_fatent)
+	    break;			// end of FAT reached
+
+	l_FatFS.winsect = 0;		// invalidate window
+	if (disk_read (0, l_FatFS.win, l_FatFS.fatbase + l_FreeScanSect, 1)
+	    != RES_OK)
+	{
+	    l_flgFreeScan = false;
+	    LogError ("SD-Card: FAT Scan Read Error");
+	    MICROSD_PowerOff();
+	    return;
+	}
+
+	l_FatFS.winsect = l_FatFS.fatbase + l_FreeScanSect;
+
+	for (i = 0;  i < entries  &&  clust + i < l_FatFS.n_fatent;  i++)
+	{
+	    if (l_FatFS.fs_type == FS_FAT16)
+	    {
+		if (LD_WORD(l_FatFS.win + i * 2) == 0)
+		    l_FreeScanCnt++;
+	    }
+	    else
+	    {
+		if ((LD_DWORD(l_FatFS.win + i * 4) & 0x0FFFFFFF) == 0)
+		    l_FreeScanCnt++;
+	    }
+	}
+    }
+
+    if (l_FreeScanSect * entries < l_FatFS.n_fatent)
+    {
+	EVENT_POST(EVT_DISK);		// continue with the next step
+	return;
+    }
+
+    /* Scan is complete */
+    l_flgFreeScan = false;
+    MICROSD_PowerOff();
+
+    if (l_FatFS.free_clust <= l_FatFS.n_fatent - 2
+    &&  l_FatFS.free_clust != l_FreeScanCnt)
+    {
+	LogError ("SD-Card: FSInfo reports %ld free Clusters"
+		  " instead of %ld", l_FatFS.free_clust, l_FreeScanCnt);
+    }
+
+    if (l_FatFS.free_clust != l_FreeScanCnt)
+    {
+	l_FatFS.free_clust = l_FreeScanCnt;
+	if (l_FatFS.fs_type == FS_FAT32)
+	    l_FatFS.fsi_flag = 1;	// update FSInfo with next f_sync()
+    }
+
+    Log ("SD-Card %ldMB free", l_FreeScanCnt / 2 * l_FatFS.csize / 1024);
+}
+
+
 /***************************************************************************//**
  *
  * @brief	Find File
  *
  * This function compares all filenames in the specified @p dirpath with
- * the filename pattern specified by parameter @p filepattern.
+ * the filename pattern specified by parameter @p filepattern.  Results for
+ * the root directory are kept in a small cache, which is filled for all
+ * @ref FIND_FILE_PATTERNS by a single directory scan when the file system
+ * is mounted, see FindFilePrescan().  Other patterns are cached after their
+ * first lookup.
  *
  * @param[in] dirpath
  *	Directory path to read filenames from.
@@ -348,99 +1083,420 @@ FATFS	*pFAT;			// Pointer to FAT structure currently in use
 char	*FindFile (char *dirpath, char *filepattern)
 {
 static char filefound[13];
-DIR	 dir;		// File objects
-FILINFO	 fileinfo;	// File info object
-int	 i, j;
+FIND_FILE_ENTRY	*pEntry;
+bool	 flgRoot;
+int	 i;
 
 
     /* check parameters */
     EFM_ASSERT (dirpath != NULL);
     EFM_ASSERT (filepattern != NULL);
+    EFM_ASSERT (strlen(filepattern) < sizeof(pEntry->Pattern));
+
+    /* only the root directory is cached */
+    flgRoot = (strcmp (dirpath, "/") == 0);
+
+    if (flgRoot)
+    {
+	for (i = 0;  i < l_FindCacheCnt;  i++)
+	{
+	    if (strcmp (l_FindCache[i].Pattern, filepattern) == 0)
+	    {
+		if (l_FindCache[i].Name[0] == EOS)
+		    return NULL;		// known to be not present
+
+		strcpy (filefound, l_FindCache[i].Name);
+		return filefound;
+	    }
+	}
+    }
+
+    /* not cached yet, scan directory */
+    filefound[0] = EOS;
+    if (! FindFileScan (dirpath, (const char * const *)&filepattern, 1,
+			&filefound))
+	return NULL;	// abort on error, result is not cached
+
+    if (flgRoot)
+    {
+	/* store result, replace the oldest entry if cache is full */
+	if (l_FindCacheCnt < FIND_FILE_CACHE_SIZE)
+	    i = l_FindCacheCnt++;
+	else
+	    i = l_FindCacheNext++ % FIND_FILE_CACHE_SIZE;
+
+	pEntry = &l_FindCache[i];
+	strcpy (pEntry->Pattern, filepattern);
+	strcpy (pEntry->Name, filefound);
+    }
+
+    return (filefound[0] == EOS ? NULL : filefound);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Invalidate Find File Cache
+ *
+ * This routine discards all cached results of FindFile().  It is called by
+ * DiskCheck() when the SD-Card state changes, and must be called whenever
+ * a file is created or removed in the root directory.
+ *
+ ******************************************************************************/
+void	 FindFileCacheInvalidate (void)
+{
+    l_FindCacheCnt = l_FindCacheNext = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Pre-Scan Root Directory
+ *
+ * This routine is called once after mounting the file system.  It reads the
+ * root directory in a single pass and stores the results for all patterns
+ * of @ref FIND_FILE_PATTERNS into the cache of FindFile().
+ *
+ ******************************************************************************/
+static void	 FindFilePrescan (void)
+{
+static const char * const patterns[] = { FIND_FILE_PATTERNS };
+char	 names[ELEM_CNT(patterns)][13];
+int	 i;
+
+
+    FindFileCacheInvalidate();
+
+    EFM_ASSERT (ELEM_CNT(patterns) <= FIND_FILE_CACHE_SIZE);
+
+    for (i = 0;  i < (int)ELEM_CNT(patterns);  i++)
+	names[i][0] = EOS;
+
+    if (! FindFileScan ("/", patterns, ELEM_CNT(patterns), names))
+	return;		// error, cache remains empty
+
+    for (i = 0;  i < (int)ELEM_CNT(patterns);  i++)
+    {
+	strcpy (l_FindCache[i].Pattern, patterns[i]);
+	strcpy (l_FindCache[i].Name, names[i]);
+    }
+    l_FindCacheCnt = i;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Scan Directory for File Patterns
+ *
+ * This routine reads all filenames of the specified directory once, and
+ * stores the first matching filename for each of the specified patterns.
+ * The scan stops as soon as all patterns have been found.
+ *
+ * @param[in] dirpath
+ *	Directory path to read filenames from.
+ *
+ * @param[in] patterns
+ *	Array of filename patterns, see FindFile().
+ *
+ * @param[in] cnt
+ *	Number of patterns.
+ *
+ * @param[in,out] names
+ *	Array of @p cnt filenames where to store the results.  All filenames
+ *	must be initialized with EOS, they remain empty if no file matches.
+ *
+ * @return
+ *	<b>true</b> if the directory has been read, <b>false</b> on error.
+ *
+ ******************************************************************************/
+static bool	 FindFileScan (const char *dirpath, const char * const *patterns,
+			       int cnt, char (*names)[13])
+{
+DIR	 dir;		// File objects
+FILINFO	 fileinfo;	// File info object
+int	 i, remain;
+
 
     /* open the specified directory */
     if (f_opendir(&dir, dirpath) != FR_OK)
-	return NULL;	// abort on error
+	return false;	// abort on error
 
     /* read directory contents name by name */
-    while (1)
+    for (remain = cnt;  remain > 0;  )
     {
 	if (f_readdir(&dir, &fileinfo) != FR_OK)
-	    return NULL;	// abort on error
+	    return false;	// abort on error
 
 	if (fileinfo.fname[0] == EOS)
-	    return NULL;	// no  more files in current directory
+	    break;	// no  more files in current directory
 
 	if (fileinfo.fattrib & (AM_DIR | AM_VOL | AM_SYS))
 	    continue;	// ignore subdirectories, volume labels and system files
 
-	/* compare basename */
-	for (i=j=0;  (i < 8)  &&  fileinfo.fname[i] != '.'
-			      &&  fileinfo.fname[i] != EOS;  i++, j++)
+	for (i = 0;  i < cnt;  i++)
 	{
-	    if (filepattern[j] == '*')
-		break;	// wildcard - ignore the rest of the basename
-
-	    if (fileinfo.fname[i] != filepattern[j])
-		break;	// not equal - file does not match
+	    if (names[i][0] == EOS  &&  FileMatch (fileinfo.fname, patterns[i]))
+	    {
+		strcpy (names[i], fileinfo.fname);
+		remain--;
+	    }
 	}
+    }
 
-	/* check for wildcard */
-	if (filepattern[j] == '*')		// "base*[.ext]"
-	{
-	    j++;			// skip '*'
+    return true;
+}
 
-	    /* skip the rest of the basename */
-	    for ( ;  (i < 8)  &&  fileinfo.fname[i] != '.'
-			      &&  fileinfo.fname[i] != EOS;  i++)
-		;
-	}
 
-	/*
-	 * Basenames are equal:
-	 * a) "basename"  == "basename"
-	 * b) "basename"  == "base*"
-	 * c) "basename." == "basename."
-	 * d) "basename." == "base*."
-	 */
-	if (fileinfo.fname[i] != filepattern[j])
-	    continue;	// file does not match, try the next file
+/***************************************************************************//**
+ *
+ * @brief	Match Filename
+ *
+ * This routine compares a filename with a pattern, see FindFile().
+ *
+ * @param[in] fname
+ *	Filename in DOS 8.3 notation.
+ *
+ * @param[in] filepattern
+ *	Filename pattern, an asterisk (*) at the end of the basename or/and
+ *	extension is treated as wildcard.
+ *
+ * @return
+ *	<b>true</b> if the filename matches the pattern, <b>false</b> otherwise.
+ *
+ ******************************************************************************/
+static bool	 FileMatch (const char *fname, const char *filepattern)
+{
+int	 i, j;
+
+
+    /* compare basename */
+    for (i=j=0;  (i < 8)  &&  fname[i] != '.'
+			  &&  fname[i] != EOS;  i++, j++)
+    {
+	if (filepattern[j] == '*')
+	    break;	// wildcard - ignore the rest of the basename
+
+	if (fname[i] != filepattern[j])
+	    break;	// not equal - file does not match
+    }
+
+    /* check for wildcard */
+    if (filepattern[j] == '*')		// "base*[.ext]"
+    {
+	j++;			// skip '*'
+
+	/* skip the rest of the basename */
+	for ( ;  (i < 8)  &&  fname[i] != '.'
+			  &&  fname[i] != EOS;  i++)
+	    ;
+    }
+
+    /*
+     * Basenames are equal:
+     * a) "basename"  == "basename"
+     * b) "basename"  == "base*"
+     * c) "basename." == "basename."
+     * d) "basename." == "base*."
+     */
+    if (fname[i] != filepattern[j])
+	return false;	// file does not match
+
+    /* check for extension */
+    if (fname[i] == EOS)
+	return true;	// no extension - filename does match
+
+    /* verify if a dot follows the basename */
+    EFM_ASSERT (filepattern[j] == '.');	// dot must follow
+    if (filepattern[j] != '.')
+	return false;			// invalid pattern
+
+    /* skip dot, compare extension */
+    for (i++, j++;  fname[i] != EOS;  i++, j++)
+    {
+	if (filepattern[j] == '*')
+	    break;	// wildcard - ignore the rest of the extension
+
+	if (fname[i] != filepattern[j])
+	    break;	// not equal - file does not match
+    }
+
+    /* check for wildcard */
+    if (filepattern[j] == '*')
+	return true;	// wildcard - filename does match
+
+    if (fname[i] != filepattern[j])
+	return false;	// file does not match
+
+    EFM_ASSERT (filepattern[j] == EOS);	// EOS must follow
+
+    return (filepattern[j] == EOS);	// complete match
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize File Reader
+ *
+ * This routine initializes a buffered file reader for the specified file,
+ * which must already be opened for reading.  Instead of calling f_read() for
+ * each character, the file is read in blocks of the buffer size.  Lines can
+ * then be fetched via FileReadLine().
+ *
+ * @param[out] pRd
+ *	File reader structure to initialize.
+ *
+ * @param[in] pFh
+ *	File handle of the opened file.
+ *
+ * @param[in] pBuf
+ *	Read buffer, or NULL to use the shared buffer of this module.  The
+ *	shared buffer may only be used by one file reader at a time.
+ *
+ * @param[in] size
+ *	Size of the read buffer, ignored if <b>pBuf</b> is NULL.
+ *
+ ******************************************************************************/
+void	 FileReaderInit (FILE_READER *pRd, FIL *pFh, void *pBuf, UINT size)
+{
+    /* check parameters */
+    EFM_ASSERT (pRd != NULL);
+    EFM_ASSERT (pFh != NULL);
 
-	/* check for extension */
-	if (fileinfo.fname[i] == EOS)
-	    break;	// no extension - filename does match
+    if (pBuf == NULL)
+    {
+	pBuf = l_FileReadBuf;
+	size = sizeof(l_FileReadBuf);
+    }
+
+    pRd->pFh    = pFh;
+    pRd->pBuf   = pBuf;
+    pRd->Size   = size;
+    pRd->Idx    = 0;
+    pRd->Cnt    = 0;
+    pRd->Res    = FR_OK;
+    pRd->flgEOF = false;
+}
 
-	/* verify if a dot follows the basename */
-	EFM_ASSERT (filepattern[j] == '.');	// dot must follow
-	if (filepattern[j] != '.')
-	    return NULL;			// abort on error
 
-	/* skip dot, compare extension */
-	for (i++, j++;  fileinfo.fname[i] != EOS;  i++, j++)
+/***************************************************************************//**
+ *
+ * @brief	Read Line from File
+ *
+ * This routine reads the next line from a file via the file reader.  <CR>
+ * characters are ignored, the terminating <NL> is replaced by EOS.  A last
+ * line without <NL> is also returned.  In contrast to f_gets(), read errors
+ * are reported to the caller.
+ *
+ * @param[in] pRd
+ *	File reader, see FileReaderInit().
+ *
+ * @param[out] pLine
+ *	Line buffer.
+ *
+ * @param[in] size
+ *	Size of the line buffer, including the terminating EOS.
+ *
+ * @return
+ *	Length of the line, or @ref FILE_READ_EOF if there are no more lines.
+ *	In case of an error, @ref FILE_READ_ERROR (the FatFs result code is
+ *	stored in <b>pRd->Res</b>), or @ref FILE_READ_TOO_LONG is returned.
+ *
+ ******************************************************************************/
+int	 FileReadLine (FILE_READER *pRd, char *pLine, size_t size)
+{
+size_t	 len = 0;
+char	 c = EOS;
+
+    while (1)
+    {
+	/* refill buffer if all data has been consumed */
+	if (pRd->Idx >= pRd->Cnt)
 	{
-	    if (filepattern[j] == '*')
-		break;	// wildcard - ignore the rest of the extension
+	    if (pRd->flgEOF)
+		break;		// end of file detected
+
+	    pRd->Idx = 0;
+	    pRd->Res = f_read (pRd->pFh, pRd->pBuf, pRd->Size, &pRd->Cnt);
+	    if (pRd->Res != FR_OK)
+	    {
+		pRd->Cnt = 0;
+		return FILE_READ_ERROR;
+	    }
 
-	    if (fileinfo.fname[i] != filepattern[j])
-		break;	// not equal - file does not match
+	    if (pRd->Cnt < pRd->Size)
+		pRd->flgEOF = true;	// this was the last block
+
+	    if (pRd->Cnt == 0)
+		break;		// end of file detected
 	}
 
-	/* check for wildcard */
-	if (filepattern[j] == '*')
-	    break;	// wildcard - filename does match
+	c = (char)pRd->pBuf[pRd->Idx++];
+
+	if (c == '\r')
+	    continue;		// ignore <CR>
+
+	if (c == '\n')
+	    break;		// read one complete line
+
+	if (len + 1 >= size)
+	    return FILE_READ_TOO_LONG;
+
+	pLine[len++] = c;
+    }
+
+    if (len == 0  &&  c != '\n')
+	return FILE_READ_EOF;	// no more data
+
+    pLine[len] = EOS;		// terminate line buffer with EOS
+    return (int)len;
+}
 
-	if (fileinfo.fname[i] != filepattern[j])
-	    continue;	// file does not match, try the next file
 
-	EFM_ASSERT (filepattern[j] == EOS);	// EOS must follow
-	if (filepattern[j] != EOS)
-	    return NULL;			// abort on error
+/***************************************************************************//**
+ *
+ * @brief	Current Position of the File Reader
+ *
+ * @param[in] pRd
+ *	File reader, see FileReaderInit().
+ *
+ * @return
+ *	File offset of the next line which FileReadLine() returns.
+ *
+ ******************************************************************************/
+DWORD	 FileReaderTell (const FILE_READER *pRd)
+{
+    return f_tell(pRd->pFh) - (pRd->Cnt - pRd->Idx);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Move the File Reader
+ *
+ * This routine moves the file reader to the specified offset, e.g. to a
+ * line whose offset has been obtained by FileReaderTell() before.  The
+ * buffer is discarded and refilled by the next call of FileReadLine().
+ *
+ * @param[in] pRd
+ *	File reader, see FileReaderInit().
+ *
+ * @param[in] offset
+ *	File offset of the next line to read.
+ *
+ * @return
+ *	The value <i>true</i> if the offset is within the file.
+ *
+ ******************************************************************************/
+bool	 FileReaderSeek (FILE_READER *pRd, DWORD offset)
+{
+    pRd->Idx = pRd->Cnt = 0;
+    pRd->flgEOF = false;
 
-	break;		// complete match - leave the loop
-    }
+    if (offset > pRd->pFh->fsize)
+	return false;
 
-    /* file name does match */
-    strcpy (filefound, fileinfo.fname);
-    return filefound;
+    pRd->Res = f_lseek (pRd->pFh, offset);
+    return (pRd->Res == FR_OK);
 }
 
 
@@ -461,9 +1517,38 @@ int	 i, j;
 void MICROSD_Init(void)
 {
 USART_InitSync_TypeDef init = USART_INITSYNC_DEFAULT;
+#if MICROSD_USE_DMA
+/* Setting up DMA channel for Tx */
+DMA_CfgChannel_TypeDef chnlCfgTx =
+{
+    .highPri   = false,			// Normal priority
+    .enableInt = true,			// Interrupt for callback function
+    .select    = MICROSD_DMAREQ_TX,	// DMA Req. is USART TXBL
+    .cb        = NULL,			// Callback is set by DmaChanConfig()
+};
+
+/* Setting up DMA channel for Rx */
+DMA_CfgChannel_TypeDef chnlCfgRx =
+{
+    .highPri   = true,			// Prevent Rx overflow
+    .enableInt = true,			// Interrupt for callback function
+    .select    = MICROSD_DMAREQ_RX,	// DMA Req. is USART RXDATAV
+    .cb        = NULL,			// Callback is set by DmaChanConfig()
+};
+
+/* Setting up channel descriptor for Rx */
+DMA_CfgDescr_TypeDef descrCfgRx =
+{
+    .dstInc  = dmaDataInc2,		// Increment destination address by 16bit
+    .srcInc  = dmaDataIncNone,		// Do not increment source address
+    .size    = dmaDataSize2,		// Data size is 16bit (RXDOUBLE)
+    .arbRate = dmaArbitrate1,		// Rearbitrate for each transfer
+    .hprot   = 0,			// No read/write destination protection
+};
+#endif
 
     /* Enabling clock to USART and GPIO */
-    CMU_ClockEnable(MICROSD_CMUCLOCK, true);
+    ClockAcquire (CLK_OWN_DISK, MICROSD_CMUCLOCK);
     CMU_ClockEnable(cmuClock_GPIO, true);
 
     /* Initialize USART in SPI master mode. */
@@ -491,14 +1576,94 @@ USART_InitSync_TypeDef init = USART_INITSYNC_DEFAULT;
     GPIO_PinModeSet(MICROSD_SPI_GPIO_PORT, MICROSD_SPI_CS_PIN,   gpioModePushPull, 1);
     GPIO_PinModeSet(MICROSD_SPI_GPIO_PORT, MICROSD_SPI_CLK_PIN,  gpioModePushPull, 0);
 
+#if ! DISK_CD_EXTI
    /*
     * Configure the Card-Detect (CD) pin as pure input.  There is an external
     * low impedance pull-up resistor which is switched on for 16us to check
     * the current state of the SD-Card socket (card removed or inserted).
-    * This is done in polling mode by function DiskCheck().
+    * This is done in polling mode by function DiskCheck().  In EXTI mode
+    * the pin is configured by DiskInit().
     */
     GPIO_PinModeSet(MICROSD_SPI_GPIO_PORT, MICROSD_CD_PIN, gpioModeInput, 0);
+#endif
+
+#if MICROSD_USE_DMA
+    /* Prepare DMA channel for Tx, the DMA controller is already initialized */
+    DmaChanConfig(DMA_CHAN_MICROSD_TX, "SD-Card Tx", &chnlCfgTx,
+		  MICROSD_TxDone, NULL);
+
+    /* Prepare DMA channel for Rx */
+    DmaChanConfig(DMA_CHAN_MICROSD_RX, "SD-Card Rx", &chnlCfgRx,
+		  MICROSD_RxDone, NULL);
+    DMA_CfgDescr(DMA_CHAN_MICROSD_RX, true, &descrCfgRx);
+#endif
+
+    /* The SPI keeps its settings, its clock is not needed until power-on */
+    if (! l_flgPowerOn  ||  l_flgRetained)
+	ClockRelease (CLK_OWN_DISK, MICROSD_CMUCLOCK);
+}
+
+
+#if MICROSD_USE_DMA
+/**************************************************************************//**
+ * @brief  DMA Callback function for SD-Card Tx
+ *
+ * Called from the DMA interrupt handler when a data block has been
+ * transferred to the USART.  This terminates the wait loop in
+ * MICROSD_BlockTx().
+ *****************************************************************************/
+static void MICROSD_TxDone(unsigned int channel, bool primary, void *user)
+{
+    (void) channel;		// suppress compiler warnings "unused parameter"
+    (void) primary;
+    (void) user;
+
+    ISR_PROF_ENTER();
+    l_flgTxDMArun = false;
+    ISR_PROF_EXIT(ISR_PROF_SD_DMA);
+}
+
+
+/**************************************************************************//**
+ * @brief  DMA Callback function for SD-Card Rx
+ *
+ * Called from the DMA interrupt handler when a data block has been
+ * received.  This terminates the wait loop in MICROSD_BlockRx().
+ *****************************************************************************/
+static void MICROSD_RxDone(unsigned int channel, bool primary, void *user)
+{
+    (void) channel;		// suppress compiler warnings "unused parameter"
+    (void) primary;
+    (void) user;
+
+    ISR_PROF_ENTER();
+    l_flgRxDMArun = false;
+    ISR_PROF_EXIT(ISR_PROF_SD_DMA);
+}
+
+
+/**************************************************************************//**
+ * @brief  Wait for the End of a DMA Transfer
+ *
+ * Sleep in EM1 until the DMA callback clears the flag.  Interrupts are
+ * disabled to prevent the DMA interrupt from occurring between the check of
+ * the flag and entering EM1, WFI returns on pending interrupts anyway.
+ *
+ * @param[in] pFlgRun
+ *	Address of the flag which is cleared by the DMA callback.
+ *****************************************************************************/
+static void MICROSD_DMA_Wait(volatile bool *pFlgRun)
+{
+    INT_Disable();
+    while (*pFlgRun)
+    {
+	EMU_EnterEM1();
+	INT_Enable();
+	INT_Disable();
+    }
+    INT_Enable();
 }
+#endif
 
 
 /**************************************************************************//**
@@ -523,6 +1688,11 @@ static uint8_t WaitReady(void)
 uint8_t res;
 uint32_t retryCount;
 
+    /* Fast path if the card is not busy */
+    res = MICROSD_XferSpi(0xff);
+    if (res == 0xFF)
+	return res;
+
     /* Wait for ready in timeout of 500ms */
     retryCount = 500 * xfersPrMsec;
     do
@@ -544,14 +1714,20 @@ uint32_t retryCount;
  * @return
  *  Byte received.
  *****************************************************************************/
-uint8_t MICROSD_XferSpi(uint8_t data)
+RAMFUNC uint8_t MICROSD_XferSpi(uint8_t data)
 {
     if ( timeOut )
     {
 	timeOut--;
     }
 
-    return USART_SpiTransfer(MICROSD_USART, data);
+    /* Same as USART_SpiTransfer(), but without leaving RAM */
+    while (!(MICROSD_USART->STATUS & USART_STATUS_TXBL))
+	;
+    MICROSD_USART->TXDATA = (uint32_t)data;
+    while (!(MICROSD_USART->STATUS & USART_STATUS_TXC))
+	;
+    return (uint8_t)MICROSD_USART->RXDATA;
 }
 
 
@@ -586,11 +1762,22 @@ int MICROSD_Select(void)
  *****************************************************************************/
 void MICROSD_PowerOn(void)
 {
+    /* SPI transfers need the HFXO, the baud rate is based on it */
+    DiskHfBoost (true);
+
+    /* End a retained state, see DiskRelease() */
+    if (l_flgRetained)
+    {
+	sTimerCancel (l_hdlRetain);
+	l_flgRetained = false;
+    }
+
     /* Enable SD-Card power */
     SET_MICROSD_PWR_PIN(MICROSD_PWR_ON);
+    l_flgPowerOn = true;
 
     /* Enable SPI clock */
-    CMU_ClockEnable(MICROSD_CMUCLOCK, true);
+    ClockAcquire (CLK_OWN_DISK, MICROSD_CMUCLOCK);
 
     /* IO configuration of the SPI */
     GPIO_PinModeSet(MICROSD_SPI_GPIO_PORT, MICROSD_SPI_MOSI_PIN, gpioModePushPull, 0);
@@ -605,6 +1792,15 @@ void MICROSD_PowerOn(void)
  *****************************************************************************/
 void MICROSD_PowerOff(void)
 {
+    /* A retained SD-Card needs the SPI clock for the final handshake */
+    if (l_flgRetained)
+    {
+	sTimerCancel (l_hdlRetain);
+	l_flgRetained = false;
+	DiskHfBoost (true);
+	ClockAcquire (CLK_OWN_DISK, MICROSD_CMUCLOCK);
+    }
+
     /* Wait for micro SD card ready */
     MICROSD_Select();
     MICROSD_Deselect();    /* Wait for micro SD card ready */
@@ -612,7 +1808,7 @@ void MICROSD_PowerOff(void)
     MICROSD_Deselect();
 
     /* Disable SPI clock */
-    CMU_ClockEnable(MICROSD_CMUCLOCK, false);
+    ClockRelease (CLK_OWN_DISK, MICROSD_CMUCLOCK);
 
     /* Reset IO configuration - except the CD pin*/
     GPIO_PinModeSet(MICROSD_SPI_GPIO_PORT, MICROSD_SPI_MOSI_PIN, gpioModeDisabled, 0);
@@ -622,41 +1818,71 @@ void MICROSD_PowerOff(void)
 
     /* Disable SD-Card power */
     SET_MICROSD_PWR_PIN(MICROSD_PWR_OFF);
+    l_flgPowerOn = false;
+
+    /* Return to the HFRCO */
+    DiskHfBoost (false);
 }
 
 
 /**************************************************************************//**
- * @brief Receive a data block from micro SD card.
- * @param[out] buff
- *  Data buffer to store received data.
- * @param btr
- *  Byte count (must be multiple of 4).
- * @return
- *  1:OK, 0:Failed.
+ * @brief Wait for the data token of a block.
+ * @return true:Token received, false:Timeout or error token.
  *****************************************************************************/
-int MICROSD_BlockRx(uint8_t *buff, uint32_t btr)
+static bool BlockRxToken(void)
 {
 uint8_t token;
-uint16_t val;
-uint32_t retryCount, framectrl, ctrl;
+uint32_t retryCount;
 
 
     /* Wait for data packet in timeout of 100ms */
-    retryCount = 100 * xfersPrMsec;
-    do
+    token = MICROSD_XferSpi(0xff);
+    if (token == 0xFF)
     {
-	token = MICROSD_XferSpi(0xff);
-    } while ((token == 0xFF) && --retryCount);
-
-    if (token != 0xFE)
-    {
-	/* Invalid data token */
-	return 0;
+	retryCount = 100 * xfersPrMsec;
+	do
+	{
+	    token = MICROSD_XferSpi(0xff);
+	} while ((token == 0xFF) && --retryCount);
     }
 
+    /* Anything else than 0xFE is an invalid data token */
+    return (token == 0xFE);
+}
+
+
+/**************************************************************************//**
+ * @brief Start the reception of the data of a block.
+ *
+ * The USART is switched to 16 bit frames.  If the buffer is aligned, the
+ * DMA receives the data, and the CPU may do other work until BlockRxEnd()
+ * is called.  Only the Rx channel raises an interrupt, the Tx channel which
+ * clocks the dummy words runs silently.
+ *
+ * @param[out] buff
+ *  Data buffer to store received data.
+ * @param btr
+ *  Byte count (must be multiple of 4).
+ * @return
+ *  true:The DMA receives the data, false:BlockRxEnd() must do it.
+ *****************************************************************************/
+static bool BlockRxStart(uint8_t *buff, uint32_t btr)
+{
+#if MICROSD_USE_DMA
+/* Setting up channel descriptor for Tx of dummy words */
+DMA_CfgDescr_TypeDef descrCfgTxDummy =
+{
+    .dstInc  = dmaDataIncNone,		// Do not increment destination address
+    .srcInc  = dmaDataIncNone,		// Always send the same dummy word
+    .size    = dmaDataSize2,		// Data size is 16bit (TXDOUBLE)
+    .arbRate = dmaArbitrate1,		// Rearbitrate for each transfer
+    .hprot   = 0,			// No read/write source protection
+};
+#endif
+
     /* Save current configuration. */
-    framectrl = MICROSD_USART->FRAME;
-    ctrl      = MICROSD_USART->CTRL;
+    l_RxFrame = MICROSD_USART->FRAME;
+    l_RxCtrl  = MICROSD_USART->CTRL;
 
     /* Set frame length to 16 bit. This will increase the effective data rate. */
     MICROSD_USART->FRAME = (MICROSD_USART->FRAME & (~_USART_FRAME_DATABITS_MASK))
@@ -675,11 +1901,82 @@ uint32_t retryCount, framectrl, ctrl;
 	timeOut = 0;
     }
 
-    /* Pipelining - The USART has two buffers of 16 bit in both
-    * directions. Make sure that at least one is in the pipe at all
-    * times to maximize throughput. */
-    MICROSD_USART->TXDOUBLE = 0xffff;
-    do
+#if MICROSD_USE_DMA
+    /* DMA transfers 16bit words, i.e. the buffer must be aligned */
+    if (((uintptr_t)buff & 1) == 0)
+    {
+	/*
+	 * The Rx channel stores the received words into the buffer, the Tx
+	 * channel clocks the dummy words.  Rx must be activated first.
+	 */
+	l_flgRxDMArun = true;
+	DMA_ActivateBasic(DMA_CHAN_MICROSD_RX,	// Activate channel selected
+			  true,			// Use primary descriptor
+			  false,		// No DMA burst
+			  (void *)buff,		// Destination address
+			  (void *)&MICROSD_USART->RXDOUBLE, // Source address
+			  btr / 2 - 1);		// Number of 16bit transfers - 1
+
+	DMA->IEN &= ~(1 << DMA_CHAN_MICROSD_TX);
+	DMA_CfgDescr(DMA_CHAN_MICROSD_TX, true, &descrCfgTxDummy);
+	DMA_ActivateBasic(DMA_CHAN_MICROSD_TX,	// Activate channel selected
+			  true,			// Use primary descriptor
+			  false,		// No DMA burst
+			  (void *)&MICROSD_USART->TXDOUBLE, // Destination address
+			  (void *)&l_DummyTx,	// Source address
+			  btr / 2 - 1);		// Number of 16bit transfers - 1
+	return true;
+    }
+#else
+    (void) buff;		// suppress compiler warning "unused parameter"
+#endif
+
+    return false;
+}
+
+
+/**************************************************************************//**
+ * @brief Finish the reception of the data of a block.
+ *
+ * This routine waits for the DMA, or receives the data by the CPU, and then
+ * receives the CRC16.  The previous settings of the USART are restored.
+ *
+ * @param[out] buff
+ *  Data buffer to store received data.
+ * @param btr
+ *  Byte count (must be multiple of 4).
+ * @param flgDMA
+ *  Return value of BlockRxStart().
+ * @return
+ *  CRC16 as transmitted by the SD-Card after the data block.
+ *****************************************************************************/
+static uint16_t BlockRxEnd(uint8_t *buff, uint32_t btr, bool flgDMA)
+{
+uint16_t val;
+
+
+#if MICROSD_USE_DMA
+    if (flgDMA)
+    {
+	/* Sleep in EM1 until the last word has been received */
+	MICROSD_DMA_Wait(&l_flgRxDMArun);
+
+	/* Next two bytes is the CRC */
+	MICROSD_USART->TXDOUBLE = 0xffff;
+	btr = 0;
+    }
+    else
+#else
+    (void) flgDMA;		// suppress compiler warning "unused parameter"
+#endif
+    {
+	/* Pipelining - The USART has two buffers of 16 bit in both
+	* directions. Make sure that at least one is in the pipe at all
+	* times to maximize throughput. */
+	MICROSD_USART->TXDOUBLE = 0xffff;
+    }
+
+    while (btr)
     {
 	MICROSD_USART->TXDOUBLE = 0xffff;
 
@@ -691,17 +1988,216 @@ uint32_t retryCount, framectrl, ctrl;
 	*buff++ = val >> 8;
 
 	btr -= 2;
-    } while (btr);
+    }
 
-    /* Next two bytes is the CRC which we discard. */
+    /* Next two bytes is the CRC, the first byte is its MSB */
     while (!(MICROSD_USART->STATUS & USART_STATUS_RXDATAV));
-    MICROSD_USART->RXDOUBLE;
+    val = MICROSD_USART->RXDOUBLE;
 
     /* Restore old settings. */
-    MICROSD_USART->FRAME = framectrl;
-    MICROSD_USART->CTRL  = ctrl;
+    MICROSD_USART->FRAME = l_RxFrame;
+    MICROSD_USART->CTRL  = l_RxCtrl;
+
+    return (uint16_t)((val << 8) | (val >> 8));
+}
 
-    return 1;     /* Return with success */
+
+/**************************************************************************//**
+ * @brief Verify the CRC16 of a received data block.
+ *
+ * A CRC error requests a retry at a reduced SPI clock, unless the clock is
+ * being tuned, see MICROSD_RxCrcError().  The clock must not be changed while
+ * the DMA receives the next block, so the caller applies it afterwards via
+ * SpiClkDowngrade().
+ *
+ * @param[in] pBuf
+ *  Received data block.
+ * @param cnt
+ *  Byte count.
+ * @param crc
+ *  CRC16 as returned by BlockRxEnd().
+ * @return
+ *  1:OK, 0:CRC error.
+ *****************************************************************************/
+static int BlockRxCrcCheck(const uint8_t *pBuf, uint32_t cnt, uint16_t crc)
+{
+#if MICROSD_CRC_CHECK
+    if (MICROSD_CRC16(pBuf, cnt) != crc)
+    {
+	l_CrcErrCnt++;
+
+	/* The SPI clock is being tuned, MICROSD_SpiClkTune() handles this */
+	if (l_flgSpiTune)
+	    return 0;
+
+	/* Request a lower SPI clock, the caller may retry the read */
+	l_flgCrcError = true;
+	l_flgSpiClkDown = true;
+	return 0;
+    }
+#else
+    (void) pBuf;		// suppress compiler warnings "unused parameter"
+    (void) cnt;
+    (void) crc;
+#endif
+
+    return 1;
+}
+
+
+/**************************************************************************//**
+ * @brief Receive a data block from micro SD card.
+ * @param[out] buff
+ *  Data buffer to store received data.
+ * @param btr
+ *  Byte count (must be multiple of 4).
+ * @return
+ *  1:OK, 0:Failed.
+ *****************************************************************************/
+int MICROSD_BlockRx(uint8_t *buff, uint32_t btr)
+{
+uint16_t crc;
+
+
+    if (! BlockRxToken())
+	return 0;
+
+    crc = BlockRxEnd(buff, btr, BlockRxStart(buff, btr));
+
+    if (! BlockRxCrcCheck(buff, btr, crc))
+    {
+#if MICROSD_CRC_CHECK
+	SpiClkDowngrade();
+#endif
+	return 0;
+    }
+
+    return 1;
+}
+
+
+/**************************************************************************//**
+ * @brief Receive consecutive data blocks of a multiple block read.
+ *
+ * This routine receives <b>cnt</b> blocks of 512 bytes after CMD18.  The
+ * data token of each block is awaited by the CPU, as the card may insert
+ * any number of idle bytes before it.  The data of a block is then received
+ * by the DMA, while the CPU verifies the CRC16 of the previous block.  So
+ * the CRC check does not delay the transfer, and there is only one DMA
+ * interrupt per block.
+ *
+ * @param[out] buff
+ *  Data buffer to store the received blocks.
+ * @param cnt
+ *  Number of blocks.
+ * @return
+ *  1:OK, 0:Failed.
+ *****************************************************************************/
+int MICROSD_MultiBlockRx(uint8_t *buff, uint32_t cnt)
+{
+uint8_t *pPrev = NULL;		// previous block and its CRC16
+uint16_t crcPrev = 0;
+bool	 flgDMA;
+int	 ok = 1;
+
+
+    while (cnt--)
+    {
+	if (! BlockRxToken())
+	{
+	    ok = 0;
+	    break;
+	}
+
+	flgDMA = BlockRxStart(buff, 512);
+
+	/* Verify the previous block while the DMA receives the current one */
+	if (pPrev != NULL  &&  ! BlockRxCrcCheck(pPrev, 512, crcPrev))
+	{
+	    BlockRxEnd(buff, 512, flgDMA);
+	    pPrev = NULL;
+	    ok = 0;
+	    break;
+	}
+
+	crcPrev = BlockRxEnd(buff, 512, flgDMA);
+	pPrev = buff;
+	buff += 512;
+    }
+
+    /* Verify the last block */
+    if (pPrev != NULL  &&  ! BlockRxCrcCheck(pPrev, 512, crcPrev))
+	ok = 0;
+
+#if MICROSD_CRC_CHECK
+    /* No DMA transfer is active any more, the SPI clock may be changed now */
+    SpiClkDowngrade();
+#endif
+
+    return ok;
+}
+
+
+#if MICROSD_CRC_CHECK
+/**************************************************************************//**
+ * @brief Reduce the SPI clock after a CRC error.
+ *
+ * BlockRxCrcCheck() only requests the lower SPI clock, since it may be
+ * called while the DMA receives the next block.  This routine applies the
+ * request, it must only be called when no DMA transfer is active.
+ *****************************************************************************/
+static void SpiClkDowngrade(void)
+{
+    if (! l_flgSpiClkDown)
+	return;
+
+    l_flgSpiClkDown = false;
+    if (l_SpiFreq > MICROSD_SPI_FREQ_STEP)
+    {
+	l_SpiFreq -= MICROSD_SPI_FREQ_STEP;
+	MICROSD_SpiClkFast();
+    }
+    LogError ("SD-Card CRC Error #%ld - SPI Clock %ldkHz",
+	      l_CrcErrCnt, USART_BaudrateGet(MICROSD_USART) / 1000);
+}
+
+
+/**************************************************************************//**
+ * @brief Calculate the CRC16 (CCITT polynomial 0x1021) of a data block.
+ * @param[in] pBuf Data block.
+ * @param cnt Number of bytes.
+ * @return CRC16 as transmitted by the SD-Card after the data block.
+ *****************************************************************************/
+static uint16_t MICROSD_CRC16(const uint8_t *pBuf, uint32_t cnt)
+{
+uint16_t crc = 0;
+
+
+    while (cnt--)
+    {
+	crc = (crc << 4) ^ l_CRC16_Nibble[(crc >> 12) ^ (*pBuf >> 4)];
+	crc = (crc << 4) ^ l_CRC16_Nibble[(crc >> 12) ^ (*pBuf & 0x0F)];
+	pBuf++;
+    }
+    return crc;
+}
+#endif
+
+
+/**************************************************************************//**
+ * @brief Return and clear the CRC error flag of MICROSD_BlockRx().
+ * @return true:A CRC error occurred, the SPI clock has been reduced.
+ *****************************************************************************/
+bool MICROSD_RxCrcError(void)
+{
+#if MICROSD_CRC_CHECK
+bool flgCrcError = l_flgCrcError;
+
+    l_flgCrcError = false;
+    return flgCrcError;
+#else
+    return false;
+#endif
 }
 
 
@@ -718,6 +2214,17 @@ uint8_t resp;
 uint16_t val;
 uint32_t bc = 512;
 uint32_t framectrl, ctrl;
+#if MICROSD_USE_DMA
+/* Setting up channel descriptor for Tx */
+DMA_CfgDescr_TypeDef descrCfgTx =
+{
+    .dstInc  = dmaDataIncNone,		// Do not increment destination address
+    .srcInc  = dmaDataInc2,		// Increment source address by 16bit
+    .size    = dmaDataSize2,		// Data size is 16bit (TXDOUBLE)
+    .arbRate = dmaArbitrate1,		// Rearbitrate for each transfer
+    .hprot   = 0,			// No read/write source protection
+};
+#endif
 
 
     if (WaitReady() != 0xFF)
@@ -754,7 +2261,30 @@ uint32_t framectrl, ctrl;
 	timeOut = 0;
     }
 
-    do
+#if MICROSD_USE_DMA
+    /* DMA transfers 16bit words, i.e. the buffer must be aligned */
+    if (((uintptr_t)buff & 1) == 0)
+    {
+	/* Let the DMA transmit the 512 byte data block, see BlockRxStart() */
+	DMA->IFC  = (1 << DMA_CHAN_MICROSD_TX);
+	DMA->IEN |= (1 << DMA_CHAN_MICROSD_TX);
+	l_flgTxDMArun = true;
+	DMA_CfgDescr(DMA_CHAN_MICROSD_TX, true, &descrCfgTx);
+	DMA_ActivateBasic(DMA_CHAN_MICROSD_TX,	// Activate channel selected
+			  true,			// Use primary descriptor
+			  false,		// No DMA burst
+			  (void *)&MICROSD_USART->TXDOUBLE, // Destination address
+			  (void *)buff,		// Source address
+			  bc / 2 - 1);		// Number of 16bit transfers - 1
+
+	/* Sleep in EM1 until the DMA is done */
+	MICROSD_DMA_Wait(&l_flgTxDMArun);
+
+	bc = 0;
+    }
+#endif
+
+    while (bc)
     {
 	/* Transmit a 512 byte data block to the SD-Card. */
 	val  = *buff++;
@@ -765,7 +2295,7 @@ uint32_t framectrl, ctrl;
 	    ;
 
 	MICROSD_USART->TXDOUBLE = val;
-    } while (bc);
+    }
 
     while (!(MICROSD_USART->STATUS & USART_STATUS_TXBL));
 
@@ -827,6 +2357,7 @@ uint32_t retryCount;
 	return 0xFF;
     }
 
+
     /* Send command packet */
     MICROSD_XferSpi(0x40 | cmd);            /* Start + Command index */
     MICROSD_XferSpi((uint8_t)(arg >> 24));  /* Argument[31..24] */
@@ -874,8 +2405,59 @@ void MICROSD_SpiClkSlow(void)
  *****************************************************************************/
 void MICROSD_SpiClkFast(void)
 {
-    USART_BaudrateSyncSet(MICROSD_USART, 0, MICROSD_HI_SPI_FREQ);
-    xfersPrMsec = MICROSD_HI_SPI_FREQ / 8000;
+    USART_BaudrateSyncSet(MICROSD_USART, 0, l_SpiFreq);
+    xfersPrMsec = l_SpiFreq / 8000;
+}
+
+
+/**************************************************************************//**
+ * @brief
+ *  Tune the SPI clock for the initialized micro SD card. Starting with
+ *  @ref MICROSD_HI_SPI_FREQ, the clock is increased by
+ *  @ref MICROSD_SPI_FREQ_STEP up to @ref MICROSD_MAX_SPI_FREQ, as long as
+ *  @ref MICROSD_SPI_TUNE_READS CRC verified reads of sector 0 succeed.
+ *  The result is used by MICROSD_SpiClkFast() until the next tuning.
+ *****************************************************************************/
+void MICROSD_SpiClkTune(void)
+{
+    l_SpiFreq = MICROSD_HI_SPI_FREQ;
+
+#if MICROSD_CRC_CHECK  &&  MICROSD_SPI_TUNE_READS > 0
+uint32_t freq;
+int	 i, ok;
+
+    l_flgSpiTune = true;
+
+    for (freq = MICROSD_HI_SPI_FREQ + MICROSD_SPI_FREQ_STEP;
+	 freq <= MICROSD_MAX_SPI_FREQ;  freq += MICROSD_SPI_FREQ_STEP)
+    {
+	USART_BaudrateSyncSet(MICROSD_USART, 0, freq);
+	xfersPrMsec = freq / 8000;
+
+	for (i = 0;  i < MICROSD_SPI_TUNE_READS;  i++)
+	{
+	    /* READ_SINGLE_BLOCK, address 0 is valid for any card type */
+	    ok = (MICROSD_SendCmd(CMD17, 0) == 0
+		  &&  MICROSD_BlockRx(l_FatFS.win, 512));
+	    MICROSD_Deselect();
+	    if (! ok)
+		break;
+	}
+	if (i < MICROSD_SPI_TUNE_READS)
+	    break;		// errors at this clock, keep the previous one
+
+	l_SpiFreq = freq;
+    }
+
+    l_flgSpiTune = false;
+
+    /* the file system is mounted afterwards, which reloads the window */
+    l_FatFS.winsect = 0;
+    l_FatFS.wflag = 0;
+#endif
+
+    MICROSD_SpiClkFast();
+    Log ("SD-Card SPI Clock %ldkHz", USART_BaudrateGet(MICROSD_USART) / 1000);
 }
 
 
@@ -921,10 +2503,8 @@ struct tm CurrDateTime;
 DWORD	  fatTimeDate;
 
 
-    /* be sure that structure is not changed during copy */
-    INT_Disable();
-    CurrDateTime = g_CurrDateTime;
-    INT_Enable();
+    /* get a consistent copy of the current time and date */
+    ClockGet (&CurrDateTime);
 
     /* build FAT time stamp from current time and date */
     fatTimeDate = ((CurrDateTime.tm_year + 2000 - 1980) << 25)
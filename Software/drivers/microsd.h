@@ -3,7 +3,7 @@
  * @brief	Header file of module microsd.c
  * @author	Silicon Labs
  * @author	Ralf Gerhauser
- * @version	2016-02-21
+ * @version	2026-10-15
  *
  * This header file contains the configuration and prototypes for the
  * SD-Card interface.  The name "microsd.h" must not be changed, because the
@@ -20,6 +20,29 @@
  *
  ***************************************************************************//**
 Revision History:
+2026-10-15,agnt	Reduced FIND_FILE_CACHE_SIZE to 2.
+2026-10-15,agnt	Removed DISK_HEALTH, DISK_SLOW_BUSY_MS, DISK_SLOW_INIT_MS, and
+		the prototype for DiskHealthReport().
+2026-10-15,agnt	Reduced FILE_READ_BUF_SIZE to 64.
+2026-10-15,agnt	Added prototypes for FileReaderTell() and FileReaderSeek().
+2026-10-15,agnt	Added prototype for MICROSD_MultiBlockRx().
+2026-10-15,agnt	Added DISK_HEALTH, DISK_SLOW_BUSY_MS, DISK_SLOW_INIT_MS, and
+		prototype for DiskHealthReport().
+2026-10-15,agnt	Added prototype for DiskFreeDefer().
+2026-10-15,agnt	Added prototype for DiskFreeKnown().
+2026-10-14,agnt	Added prototype for DiskCacheReport().
+2026-10-14,agnt	Added MICROSD_MAX_SPI_FREQ, MICROSD_SPI_FREQ_STEP,
+		MICROSD_SPI_TUNE_READS, MICROSD_CRC_CHECK, and prototypes for
+		MICROSD_SpiClkTune() and MICROSD_RxCrcError().
+2026-10-14,agnt	Added DISK_RETAIN_TIME and prototypes for DiskAcquire(),
+		DiskRelease(), and DiskPowerFailHandler().
+2026-10-14,agnt	Added DISK_CD_EXTI, DISK_CD_DEBOUNCE, and MICROSD_CD_EXTI_MASK.
+2026-10-14,agnt	Added DISK_CD_POLL_INTERVAL.
+2026-10-14,agnt	Added FILE_READER and prototypes for the buffered file reader.
+		Added define MICROSD_USE_DMA.
+		Added FIND_FILE_CACHE_SIZE, FIND_FILE_PATTERNS, and prototype
+		for FindFileCacheInvalidate().
+		Added defines for the background FAT scan of DiskSize().
 2016-02-21,rage	Added prototype for IsDiskRemoved().
 2015-02-18,rage	Initial version, derived from EFM32GG_DK3750 development kit.
 */
@@ -53,12 +76,128 @@ Revision History:
 #define MICROSD_WP_PIN		7		//!< Write Protect Pin
 #define MICROSD_CD_PULLUP_PIN	12		//!< Pull-Up for CD Signal
 
+    /*!@brief Bit mask of the Card-Detect EXTI, see CD_Handler(). */
+#define MICROSD_CD_EXTI_MASK	(1 << MICROSD_CD_PIN)
+
 #define MICROSD_USART		USART2		//!< Use USART2 for SPI
 #define MICROSD_CMUCLOCK	cmuClock_USART2	//!< Enable clock for USART
 #define MICROSD_LOC		USART_ROUTE_LOCATION_LOC0  //!< Use location 0
 
 #define MICROSD_HI_SPI_FREQ	8000000		//!< High speed is 8MHz
+#define MICROSD_MAX_SPI_FREQ	16000000	//!< Limit is HFPERCLK / 2
+#define MICROSD_SPI_FREQ_STEP	4000000		//!< Step for tuning/downgrade
 #define MICROSD_LO_SPI_FREQ	 100000		//!< Low speed is 100kHz
+#define MICROSD_DMAREQ_TX	DMAREQ_USART2_TXBL //!< DMA request for Tx
+#define MICROSD_DMAREQ_RX	DMAREQ_USART2_RXDATAV //!< DMA request for Rx
+//@}
+
+#ifndef MICROSD_USE_DMA
+    /*!@brief Set this define 1 to transfer data blocks via DMA channels
+     * @ref DMA_CHAN_MICROSD_TX and @ref DMA_CHAN_MICROSD_RX, while the CPU
+     * is sleeping in EM1.
+     */
+    #define MICROSD_USE_DMA	1
+#endif
+
+#ifndef MICROSD_CRC_CHECK
+    /*!@brief Set 1 to verify the CRC16 of each received data block.  A CRC
+     * error reduces the SPI clock by @ref MICROSD_SPI_FREQ_STEP, and the read
+     * is retried.  This is also required to tune the SPI clock on mount.
+     */
+    #define MICROSD_CRC_CHECK	1
+#endif
+
+#ifndef MICROSD_SPI_TUNE_READS
+    /*!@brief Number of CRC verified block reads MICROSD_SpiClkTune() performs
+     * at each SPI clock step.  Set 0 to disable tuning, i.e. always use
+     * @ref MICROSD_HI_SPI_FREQ.
+     */
+    #define MICROSD_SPI_TUNE_READS	4
+#endif
+
+#ifndef FILE_READ_BUF_SIZE
+    /*!@brief Size of the shared buffer of the file reader, see FileReaderInit().
+     * A multiple of the sector size lets FatFs transfer the data directly into
+     * the buffer.  A smaller buffer is filled from the sector buffer of
+     * FatFs, which costs a copy, but no additional sector read.
+     */
+    #define FILE_READ_BUF_SIZE	64
+#endif
+
+#ifndef FIND_FILE_CACHE_SIZE
+    /*!@brief Number of FindFile() results which are cached, at least the
+     * number of @ref FIND_FILE_PATTERNS.
+     */
+    #define FIND_FILE_CACHE_SIZE	2
+#endif
+
+#ifndef FIND_FILE_PATTERNS
+    /*!@brief Filename patterns which are looked up by a single scan of the
+     * root directory after mounting, see FindFile().
+     */
+    #define FIND_FILE_PATTERNS	"*.UPD", "BOX*.TXT"
+#endif
+
+#ifndef DISK_CD_POLL_INTERVAL
+    /*!@brief Interval in [s] for polling the Card-Detect signal, i.e. how
+     * often DiskCheck() is triggered without any other event.  In EXTI mode
+     * this is only used to retry the initialization of an inserted card.
+     */
+    #define DISK_CD_POLL_INTERVAL	5
+#endif
+
+#ifndef DISK_CD_EXTI
+    /*!@brief Set 1 to detect SD-Card insertion and removal by an external
+     * interrupt, see CD_Handler().  The internal pull-up of the CD pin is
+     * then permanently enabled.  Set 0 to poll the CD signal every
+     * @ref DISK_CD_POLL_INTERVAL seconds with the duty-cycled external
+     * pull-up resistor instead.
+     */
+    #define DISK_CD_EXTI	1
+#endif
+
+#ifndef DISK_CD_DEBOUNCE
+    /*!@brief Time in [s] the CD signal must be stable after its last edge
+     * before DiskCheck() evaluates it.
+     */
+    #define DISK_CD_DEBOUNCE	1
+#endif
+
+#ifndef DISK_RETAIN_TIME
+    /*!@brief Time in [s] an idle SD-Card is retained, i.e. deselected with
+     * its supply kept up, after DiskRelease().  A following DiskAcquire()
+     * within this time needs no re-initialization of the card.  Set 0 to
+     * power off the card immediately.
+     */
+    #define DISK_RETAIN_TIME	60
+#endif
+
+#ifndef DISK_FREE_SCAN_SECTORS
+    /*!@brief Number of FAT sectors which are read per main loop pass when
+     * counting free clusters in the background, see DiskSize().
+     */
+    #define DISK_FREE_SCAN_SECTORS	32
+#endif
+
+#ifndef DISK_FREE_SCAN_RETRY
+    /*!@brief Number of times the background FAT scan is restarted, if
+     * clusters have been allocated meanwhile.
+     */
+    #define DISK_FREE_SCAN_RETRY	3
+#endif
+
+#ifndef DISK_FREE_VERIFY
+    /*!@brief Set this define 1 to verify the free cluster count of the FSInfo
+     * sector by a background FAT scan.  With 0, a valid count is trusted.
+     */
+    #define DISK_FREE_VERIFY	0
+#endif
+
+/*!@name Special return values of FileReadLine(). */
+//@{
+#define FILE_READ_EOF		(-1)	//!< End of file, no more lines
+#define FILE_READ_ERROR		(-2)	//!< Read error, see FILE_READER.Res
+#define FILE_READ_TOO_LONG	(-3)	//!< Line exceeds the line buffer
 //@}
 
 /*!@name Definitions for MMC/SDC commands */
@@ -83,6 +222,20 @@ Revision History:
 #define CMD58	(58)		//!< READ_OCR
 //@}
 
+/*=========================== Typedefs and Structs ===========================*/
+
+/*!@brief Buffered file reader, see FileReaderInit() and FileReadLine(). */
+typedef struct
+{
+    FIL		*pFh;		//!< File handle of the opened file
+    uint8_t	*pBuf;		//!< Read buffer
+    UINT	 Size;		//!< Size of the read buffer
+    UINT	 Idx;		//!< Index of the next character in the buffer
+    UINT	 Cnt;		//!< Number of valid bytes in the buffer
+    FRESULT	 Res;		//!< Result of the last f_read() call
+    bool	 flgEOF;	//!< End of file has been reached
+} FILE_READER;
+
 /*================================ Prototypes ================================*/
 
 /* High Level Routines */
@@ -91,8 +244,21 @@ bool	 DiskCheck (void);
 bool	 IsDiskRemoved (void);
 bool	 IsFileHandleValid (FIL *pHdl);
 void	 CD_Handler (int extiNum, bool extiLvl, uint32_t timeStamp);
+DSTATUS	 DiskAcquire (void);
+void	 DiskRelease (bool flgRetain);
+void	 DiskPowerFailHandler (void);
+void	 DiskCacheReport (bool flgLog);
 uint32_t DiskSize (void);
+void	 DiskFreeDefer (bool flgDefer);
+bool	 DiskFreeKnown (uint32_t *pKB);
 char	*FindFile (char *dirpath, char *filename);
+void	 FindFileCacheInvalidate (void);
+
+/* Buffered File Reader */
+void	 FileReaderInit (FILE_READER *pRd, FIL *pFh, void *pBuf, UINT size);
+int	 FileReadLine (FILE_READER *pRd, char *pLine, size_t size);
+DWORD	 FileReaderTell (const FILE_READER *pRd);
+bool	 FileReaderSeek (FILE_READER *pRd, DWORD offset);
 
 /* Initialize the SD-Card interface */
 void      MICROSD_Init(void);
@@ -105,6 +271,7 @@ void      MICROSD_PowerOn(void);
 void      MICROSD_PowerOff(void);
 
 int       MICROSD_BlockRx(uint8_t *buff, uint32_t btr);
+int       MICROSD_MultiBlockRx(uint8_t *buff, uint32_t cnt);
 int       MICROSD_BlockTx(const uint8_t *buff, uint8_t token);
 
 uint8_t   MICROSD_SendCmd(uint8_t cmd, DWORD arg);
@@ -112,6 +279,8 @@ uint8_t   MICROSD_XferSpi(uint8_t data);
 
 void      MICROSD_SpiClkFast(void);
 void      MICROSD_SpiClkSlow(void);
+void      MICROSD_SpiClkTune(void);
+bool      MICROSD_RxCrcError(void);
 
 bool      MICROSD_TimeOutElapsed(void);
 void      MICROSD_TimeOutSet(uint32_t msec);
@@ -23,6 +23,14 @@ typedef enum {
 } DRESULT;
 
 
+/* Statistics of the sector cache, see disk_cache_stat() */
+typedef struct {
+	DWORD	Hits;		/* Reads served from the cache */
+	DWORD	Misses;		/* Reads which required a CMD17 */
+	DWORD	WriteBacks;	/* Dirty sectors written to the disk */
+} DISK_CACHE_STAT;
+
+
 /*---------------------------------------*/
 /* Prototypes for disk control functions. */
 
@@ -33,6 +41,7 @@ DRESULT disk_read (BYTE, BYTE*, DWORD, BYTE);
 DRESULT disk_write (BYTE, const BYTE*, DWORD, BYTE);
 #endif
 DRESULT disk_ioctl (BYTE, BYTE, void*);
+void disk_cache_stat (DISK_CACHE_STAT*, int);
 
 
 /* Disk Status Bits (DSTATUS) */
@@ -11,12 +11,99 @@
 /
 /-------------------------------------------------------------------------*/
 
+#include <string.h>
 #include "diskio.h"
 #include "microsd.h"
 
 static DSTATUS stat = STA_NOINIT;  /* Disk status */
 static UINT CardType;
 
+#if _DISK_CACHE_SECTORS > 0
+#define CACHE_UNUSED  0xFFFFFFFF    /* Sector number of an unused entry */
+
+typedef struct {
+  BYTE  buf[512];                   /* Sector data, must be first for DMA alignment */
+  DWORD sector;                     /* Sector number (LBA), or CACHE_UNUSED */
+  DWORD lru;                        /* Access time stamp for LRU eviction */
+  BYTE  dirty;                      /* 1: Must be written back to the disk */
+} CACHE_ENTRY;
+
+static CACHE_ENTRY Cache[_DISK_CACHE_SECTORS] __attribute__((aligned(4)));
+static DWORD CacheClock;            /* Incremented on each cache access */
+static DISK_CACHE_STAT CacheStat;   /* Hit/miss counters */
+static BYTE CacheValid;             /* 1: Entries have been initialized */
+#endif
+
+static DRESULT mmc_read (BYTE *buff, DWORD sector, BYTE count);
+#if _READONLY == 0
+static DRESULT mmc_write (const BYTE *buff, DWORD sector, BYTE count);
+#endif
+
+#if _DISK_CACHE_SECTORS > 0
+/*--------------------------------------------------------------------------
+
+   Sector Cache
+
+---------------------------------------------------------------------------*/
+
+/* Discard all entries, dirty sectors are lost */
+static void cache_invalidate (void)
+{
+  BYTE n;
+
+  for (n = 0; n < _DISK_CACHE_SECTORS; n++) {
+    Cache[n].sector = CACHE_UNUSED;
+    Cache[n].dirty = 0;
+  }
+  CacheValid = 1;
+}
+
+/* Return the entry of the specified sector, or 0 if it is not cached */
+static CACHE_ENTRY *cache_find (DWORD sector)
+{
+  BYTE n;
+
+  for (n = 0; n < _DISK_CACHE_SECTORS; n++) {
+    if (Cache[n].sector == sector) return &Cache[n];
+  }
+  return 0;
+}
+
+/* Free the least recently used entry, write it back if it is dirty */
+static CACHE_ENTRY *cache_alloc (void)
+{
+  CACHE_ENTRY *c = &Cache[0];
+  BYTE n;
+
+  for (n = 0; n < _DISK_CACHE_SECTORS; n++) {
+    if (Cache[n].sector == CACHE_UNUSED) { c = &Cache[n]; break; }
+    if (CacheClock - Cache[n].lru > CacheClock - c->lru) c = &Cache[n];
+  }
+  if (c->dirty) {
+    if (mmc_write(c->buf, c->sector, 1) != RES_OK) return 0;
+    CacheStat.WriteBacks++;
+    c->dirty = 0;
+  }
+  c->sector = CACHE_UNUSED;
+  return c;
+}
+
+/* Write back all dirty sectors */
+static DRESULT cache_flush (void)
+{
+  BYTE n;
+
+  for (n = 0; n < _DISK_CACHE_SECTORS; n++) {
+    if (Cache[n].dirty) {
+      if (mmc_write(Cache[n].buf, Cache[n].sector, 1) != RES_OK) return RES_ERROR;
+      CacheStat.WriteBacks++;
+      Cache[n].dirty = 0;
+    }
+  }
+  return RES_OK;
+}
+#endif
+
 /*--------------------------------------------------------------------------
 
    Public Functions
@@ -100,28 +187,80 @@ DRESULT disk_read (
   BYTE count      /* Sector count (1..255) */
 )
 {
+#if _DISK_CACHE_SECTORS > 0
+  CACHE_ENTRY *c;
+  DRESULT res;
+  BYTE n;
+#endif
+
   if (drv || !count) return RES_PARERR;
   if (stat & STA_NOINIT) return RES_NOTRDY;
 
-  if (!(CardType & CT_BLOCK)) sector *= 512;  /* Convert to byte address if needed */
-
-  if (count == 1) {                           /* Single block read */
-    if ((MICROSD_SendCmd(CMD17, sector) == 0) /* READ_SINGLE_BLOCK */
-      && MICROSD_BlockRx(buff, 512))
-      count = 0;
+#if _DISK_CACHE_SECTORS > 0
+  if (!CacheValid) cache_invalidate();
+  if (count == 1) {                           /* Single sectors are cached */
+    c = cache_find(sector);
+    if (c) {
+      CacheStat.Hits++;
+    } else {
+      CacheStat.Misses++;
+      c = cache_alloc();
+      if (!c) return mmc_read(buff, sector, 1); /* Write-back failed, bypass cache */
+      if (mmc_read(c->buf, sector, 1) != RES_OK) return RES_ERROR;
+      c->sector = sector;
+    }
+    c->lru = ++CacheClock;
+    memcpy(buff, c->buf, 512);
+    return RES_OK;
   }
-  else {                                        /* Multiple block read */
-    if (MICROSD_SendCmd(CMD18, sector) == 0) {  /* READ_MULTIPLE_BLOCK */
-      do {
-        if (!MICROSD_BlockRx(buff, 512)) break;
-        buff += 512;
-      } while (--count);
-      MICROSD_SendCmd(CMD12, 0);                /* STOP_TRANSMISSION */
+
+  res = mmc_read(buff, sector, count);
+  if (res == RES_OK) {                        /* Dirty sectors are newer than the disk */
+    for (n = 0; n < _DISK_CACHE_SECTORS; n++) {
+      c = &Cache[n];
+      if (c->dirty && c->sector - sector < count)
+        memcpy(buff + (c->sector - sector) * 512, c->buf, 512);
     }
   }
-  MICROSD_Deselect();
+  return res;
+#else
+  return mmc_read(buff, sector, count);
+#endif
+}
 
-  return count ? RES_ERROR : RES_OK;
+/*-----------------------------------------------------------------------*/
+/* Read Sector(s) from the Card                                          */
+/*-----------------------------------------------------------------------*/
+
+static DRESULT mmc_read (
+  BYTE *buff,     /* Pointer to the data buffer to store read data */
+  DWORD sector,   /* Start sector number (LBA) */
+  BYTE count      /* Sector count (1..255) */
+)
+{
+  BYTE n, *p, retry = 2;
+
+  if (!(CardType & CT_BLOCK)) sector *= 512;  /* Convert to byte address if needed */
+
+  do {
+    n = count;
+    p = buff;
+    if (n == 1) {                               /* Single block read */
+      if ((MICROSD_SendCmd(CMD17, sector) == 0) /* READ_SINGLE_BLOCK */
+        && MICROSD_BlockRx(p, 512))
+        n = 0;
+    }
+    else {                                      /* Multiple block read */
+      if (MICROSD_SendCmd(CMD18, sector) == 0) {  /* READ_MULTIPLE_BLOCK */
+        if (MICROSD_MultiBlockRx(p, n))         /* CRC check overlaps DMA */
+          n = 0;
+        MICROSD_SendCmd(CMD12, 0);              /* STOP_TRANSMISSION */
+      }
+    }
+    MICROSD_Deselect();
+  } while (n && MICROSD_RxCrcError() && --retry);  /* Retry at the reduced SPI clock */
+
+  return n ? RES_ERROR : RES_OK;
 }
 
 /*-----------------------------------------------------------------------*/
@@ -136,10 +275,57 @@ DRESULT disk_write (
   BYTE count          /* Sector count (1..255) */
 )
 {
+#if _DISK_CACHE_SECTORS > 0
+  CACHE_ENTRY *c;
+  DRESULT res;
+  BYTE n;
+#endif
+
   if (drv || !count) return RES_PARERR;
   if (stat & STA_NOINIT) return RES_NOTRDY;
   if (stat & STA_PROTECT) return RES_WRPRT;
 
+#if _DISK_CACHE_SECTORS > 0
+  if (!CacheValid) cache_invalidate();
+  if (count == 1) {                           /* Cached sectors are written back later */
+    c = cache_find(sector);
+    if (c) {
+      memcpy(c->buf, buff, 512);
+      c->dirty = 1;
+      c->lru = ++CacheClock;
+      return RES_OK;
+    }
+  }
+
+  res = mmc_write(buff, sector, count);
+  for (n = 0; n < _DISK_CACHE_SECTORS; n++) {  /* Update cached copies */
+    c = &Cache[n];
+    if (c->sector - sector < count) {
+      if (res == RES_OK) {
+        memcpy(c->buf, buff + (c->sector - sector) * 512, 512);
+        c->dirty = 0;
+      } else {
+        c->sector = CACHE_UNUSED;             /* Contents on the disk is unknown */
+        c->dirty = 0;
+      }
+    }
+  }
+  return res;
+#else
+  return mmc_write(buff, sector, count);
+#endif
+}
+
+/*-----------------------------------------------------------------------*/
+/* Write Sector(s) to the Card                                           */
+/*-----------------------------------------------------------------------*/
+
+static DRESULT mmc_write (
+  const BYTE *buff,   /* Pointer to the data to be written */
+  DWORD sector,       /* Start sector number (LBA) */
+  BYTE count          /* Sector count (1..255) */
+)
+{
   if (!(CardType & CT_BLOCK)) sector *= 512;  /* Convert to byte address if needed */
 
   if (count == 1) {                           /* Single block write */
@@ -180,11 +366,17 @@ DRESULT disk_ioctl (
 
 
   if (drv) return RES_PARERR;
+#if _DISK_CACHE_SECTORS > 0
+  if (ctrl == CTRL_INVALIDATE) cache_invalidate();  /* Also if not initialized */
+#endif
   if (stat & STA_NOINIT) return RES_NOTRDY;
 
   res = RES_ERROR;
   switch (ctrl) {
     case CTRL_SYNC :                /* Flush dirty buffer if present */
+#if _DISK_CACHE_SECTORS > 0
+      if (cache_flush() != RES_OK) break;
+#endif
       if (MICROSD_Select()) {
         MICROSD_Deselect();
         res = RES_OK;
@@ -278,3 +470,20 @@ DRESULT disk_ioctl (
 
   return res;
 }
+
+/*-----------------------------------------------------------------------*/
+/* Get Sector Cache Statistics                                           */
+/*-----------------------------------------------------------------------*/
+
+void disk_cache_stat (
+  DISK_CACHE_STAT *pStat, /* Pointer to the structure to store the counters */
+  int reset               /* 1: Reset the counters afterwards */
+)
+{
+#if _DISK_CACHE_SECTORS > 0
+  *pStat = CacheStat;
+  if (reset) memset(&CacheStat, 0, sizeof(CacheStat));
+#else
+  memset(pStat, 0, sizeof(*pStat));
+#endif
+}
@@ -2230,7 +2230,8 @@ FRESULT f_mount (
 	}
 	else /* Unmount, Added by Energy Micro AS. */
 	{
-	  disk_ioctl(fs->drv, CTRL_INVALIDATE, (void*)0);
+	  /* RAGE: <fs> is NULL here, the physical drive is the same as <vol> */
+	  disk_ioctl(vol, CTRL_INVALIDATE, (void*)0);
 	}
 	FatFs[vol] = fs;			/* Register new fs object */
 
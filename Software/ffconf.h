@@ -7,6 +7,11 @@
 /
 /----------------------------------------------------------------------------*
 Revision History:
+2026-10-15,agnt	Set _FS_TINY to 1, this saves 512 bytes of RAM per file object.
+2026-10-15,agnt	_FS_TINY, _FS_MINIMIZE, _USE_FASTSEEK, and _WORD_ACCESS may be
+		set via CFLAGS, see target "bench-fatfs" of the Makefile.
+2026-10-14,agnt	Added _DISK_CACHE_SECTORS for the sector cache of diskio.c,
+		the cache is disabled by default.
 2015-03-08,rage	Set _USE_MKFS to 0 as we do not require to format an SD-Card,
 		set _CODE_PAGE to 1250 for "Central Europe".
 */
@@ -18,19 +23,35 @@ Revision History:
 / Functions and Buffer Configurations
 /----------------------------------------------------------------------------*/
 
-#define	_FS_TINY	0	/* 0:Normal or 1:Tiny */
+#ifndef _FS_TINY
+#define	_FS_TINY	1	/* 0:Normal or 1:Tiny */
+#endif
 /* When _FS_TINY is set to 1, FatFs uses the sector buffer in the file system
 /  object instead of the sector buffer in the individual file object for file
 /  data transfer. This reduces memory consumption 512 bytes each file object. */
 
 
+#ifndef _DISK_CACHE_SECTORS
+#define	_DISK_CACHE_SECTORS	0	/* 0:Disable or 1..8 */
+#endif
+/* Number of sectors held by the write-back sector cache in diskio.c. Each
+/  sector costs 512 + 12 bytes of RAM. Single sector reads are cached, writes
+/  only update sectors which are already cached, i.e. FAT and directory
+/  sectors which are always read before modification. Dirty sectors are
+/  written back by CTRL_SYNC, see disk_ioctl(). The cache is disabled by
+/  default, as the 16KB of RAM of the EFM32G have no room for it. A board
+/  with spare RAM opts in via CFLAGS, e.g. -D_DISK_CACHE_SECTORS=4. */
+
+
 #define _FS_READONLY	0	/* 0:Read/Write or 1:Read only */
 /* Setting _FS_READONLY to 1 defines read only configuration. This removes
 /  writing functions, f_write, f_sync, f_unlink, f_mkdir, f_chmod, f_rename,
 /  f_truncate and useless f_getfree. */
 
 
+#ifndef _FS_MINIMIZE
 #define _FS_MINIMIZE	0	/* 0 to 3 */
+#endif
 /* The _FS_MINIMIZE option defines minimization level to remove some functions.
 /
 /   0: Full function.
@@ -52,7 +73,9 @@ Revision History:
 /* To enable f_forward function, set _USE_FORWARD to 1 and set _FS_TINY to 1. */
 
 
+#ifndef _USE_FASTSEEK
 #define	_USE_FASTSEEK	0	/* 0:Disable or 1:Enable */
+#endif
 /* To enable fast seek feature, set _USE_FASTSEEK to 1. */
 
 
@@ -157,7 +180,9 @@ Revision History:
 / System Configurations
 /----------------------------------------------------------------------------*/
 
+#ifndef _WORD_ACCESS
 #define _WORD_ACCESS	0	/* 0 or 1 */
+#endif
 /* Set 0 first and it is always compatible with all platforms. The _WORD_ACCESS
 /  option defines which access method is used to the word data on the FAT volume.
 /
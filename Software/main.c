@@ -2,7 +2,7 @@
  * @file
  * @brief	MOMO_AUDIO
  * @author	Ralf Gerhauser / Peter Loes 
- * @version	2020-07-17
+ * @version	2026-10-15
  *
  * This application consists of the following modules:
  * - main.c - Initialization code and main execution loop.
@@ -12,6 +12,8 @@
  * - ExtInt.c - External interrupt handler.
  * - AlarmClock.c - Alarm clock and timers facility.
  * - DCF77.c - DCF77 Atomic Clock Decoder
+ * - GPS.c - GPS receiver with PPS as alternative time source.
+ * - TimeSrc.c - Interface of the time sources, sets the system clock.
  * - clock.c - An implementation of the POSIX time() function.
  * - LightBarrier.c - Interrupt logic for the two light barriers,
  *   enables the RFID reader.
@@ -26,6 +28,28 @@
  * - Logging.c - Logging facility to send messages to the LEUART and store
  *   them into a file on the SD-Card.
  * - PowerFail.c - Handler to switch off all loads in case of Power Fail.
+ * - IsrProfile.c - Cycle statistics of the interrupt service routines.
+ * - PcProfile.c - Statistical profile of the program counter by SysTick.
+ * - VisitStats.c - Daily statistics per transponder ID.
+ * - Forecast.c - Daily forecast of the days until storage and battery run
+ *   out.
+ * - PowerSeq.c - Staggered power-up of the devices at the begin of a power
+ *   window.
+ * - ClockMgr.c - Owners of the peripheral clocks and of EM1.
+ * - Defer.c - Deferred work of the interrupt service routines in PendSV.
+ * - ScratchPool.c - Pool of blocks for large temporary buffers.
+ * - DmaChan.c - Owners of the DMA channels, allocation of shared channels.
+ * - TempComp.c - Temperature compensation of the LFXO.
+ * - WarmStart.c - Watchdog supervision, the system clock is restored after a
+ *   warm reset.
+ * - ParamStore.c - Parameters of the other modules in the internal flash.
+ * - SoundDetect.c - Sound-activity detector, records are only made while
+ *   there is sound at the microphone.
+ * - SupplyMon.c - Supply voltage by the ADC, if no battery controller is
+ *   connected.
+ * - Throttle.c - Token bucket per transponder ID to limit the playbacks.
+ * - bench.c - Micro-benchmark of the drivers, only part of the image of the
+ *   "bench" target.
  *
  * Parts of the code are based on the example code of AN0006 "tickless calender"
  * from Energy Micro AS.
@@ -61,6 +85,111 @@
  *
  ****************************************************************************//*
 Revision History:
+2026-10-15,agnt	- The energy mode profiler accumulates the ticks in 32 bits.
+2026-10-15,agnt	- Removed the energy ledger, console command "EL".
+2026-10-15,agnt	- Removed the timeline of the boot, console command "TL".
+2026-10-15,agnt	- Removed the SD-Card health monitor, console command "SDH".
+2026-10-15,agnt	- Removed the latency trace, console command "LAT".
+2026-10-15,agnt	- With TASK_SCHED, the main loop calls the tasks by the priority
+		  scheduler TaskSchedule().
+2026-10-15,agnt	- The main loop calls the tasks of the table which the linker
+		  collects from the modules, see TASK_REGISTER().  The SD-Card
+		  handling has been moved into DiskTask().
+2026-10-15,agnt	- Added Throttle.c to the module list.
+2026-10-15,agnt	- Added SupplyMon.c to the module list.
+2026-10-15,agnt	- Call SoundDetectInit() for the sound-activity detector.
+2026-10-15,agnt	- Call ParamStoreInit() after LogInit().
+2026-10-15,agnt	- Call WarmStartInit() before LogInit(), WarmStartRestore() after
+		  AlarmClockInit(), and WarmStartCheck() in each pass of the
+		  main loop.  Reboot() saves the time before the reset, see
+		  WARM_START.
+2026-10-15,agnt	- CheckCommand() fetches each command line from the receive ring
+		  of the LEUART via drvLEUART_CmdLineGet().
+2026-10-15,agnt	- Call DCF77Check() to store the DCF77 reception history, see
+		  DCF77_LEARN_WINDOW.
+2026-10-15,agnt	- The time source is initialized, enabled, and disabled via
+		  TimeSrc.c, which selects the DCF77 or the GPS receiver, see
+		  TIME_SOURCE.  Its EXTI is captured and deferred.
+2026-10-15,agnt	- Call TempCompInit() and TempCompCheck(), console command "TC"
+		  shows the temperature compensation, see TEMP_COMP.
+2026-10-15,agnt	- A new SD-Card after the first one only applies the changes of
+		  the configuration, see ControlConfigReload().  Console
+		  command "CFG" reloads the configuration file.
+2026-10-15,agnt	- Console command "DMA" shows the owners of the DMA channels,
+		  see DmaChan.c.
+2026-10-15,agnt	- Console command "MEM" also shows the usage of the scratch
+		  pool, see ScratchPool.c.
+2026-10-15,agnt	- Console command "SDH" shows the SD-Card health statistics,
+		  see DISK_HEALTH.
+2026-10-15,agnt	- The init steps and the boot stages are recorded in the
+		  timeline, BootDone() logs it, console command "TL" shows it,
+		  see TIMELINE.
+2026-10-15,agnt	- Call PcProfileInit(), console commands "PCS" and "PCSC" dump
+		  the PC profile, "PCSD" writes it to the SD-Card, see
+		  PC_PROFILE.
+2026-10-15,agnt	- Removed g_flgIRQ: The main loop checks <g_EventMask> with
+		  interrupts disabled before it enters EM1 or EM2, so an event
+		  posted after the check cannot be lost.  Added FlagTestClr().
+2026-10-15,agnt	- The energy mode profile and the boot stages are measured with
+		  the monotonic clock, see ClockMonoTicks().
+2026-10-15,agnt	- The duration of the boot stages is logged, see BootStage().
+		  With FAST_BOOT, the MCU and battery information, the battery
+		  probe, and the free disk space are deferred until the main
+		  loop is idle, see BootDone().
+2026-10-15,agnt	- Call PowerSeqInit(), see PWR_SEQ.
+2026-10-15,agnt	- Call EnergyLedgerInit() and EnergyLedgerCheck(), the energy
+		  modes and the HFXO are accounted via EL_EM() and EL_SWITCH(),
+		  console command "EL" shows the ledger, see ENERGY_LEDGER.
+2026-10-15,agnt	- Call ForecastInit() and ForecastCheck(), console command "FC"
+		  shows the forecast, see FORECAST.
+2026-10-15,agnt	- Call DeferInit() and ExtIntDeferInit(), the console commands
+		  "ISR" and "ISRC" also show the queue of the deferred work.
+2026-10-15,agnt	- Peripheral clocks and EM1 are acquired via ClockMgr.c,
+		  console command "PWR" shows their holders.
+2026-10-15,agnt	- Call ItmTraceInit(), the main loop emits ITM trace records of
+		  the tasks and the wake-ups, see ITM_TRACE.
+2026-10-15,agnt	- cmuSetup() passes l_HfClockChange[] to HfClockInit() instead
+		  of selecting the HFXO, console command "CLK" shows the clock
+		  statistics, see HF_CLOCK_GOVERNOR.
+2026-10-15,agnt	- Call VisitStatsInit() and VisitStatsCheck(), console command
+		  "VST" shows the visit statistics, see VISIT_STATS.
+2026-10-15,agnt	- Use StrFormat() instead of sprintf().
+2026-10-15,agnt	- The LEDs are driven by the LED pattern engine, see LedPattern.c.
+		  Reboot() shows its pattern while sleeping in EM2, the dimming
+		  has been removed.
+2026-10-15,agnt	- A firmware update image is verified by FwUpdateCheck() before
+		  rebooting into the booter, an identical image is skipped.
+2026-10-15,agnt	- After a short outage, the state of the RFID reader and the
+		  Audio module is restored by l_PowerFailResume[].
+2026-10-15,agnt	- The power-fail handlers are grouped into the stages of
+		  l_PowerFailStages[], see POWER_FAIL_STAGE.
+		- Edges of the light barriers and DCF77 are captured by a
+		  TIMER, see ExtIntCaptureInit().
+2026-10-14,agnt	- The image of the "bench" target runs BenchRun() after the
+		  SD-Card has been mounted, see bench.c.
+		- Console commands "HS" and "LS" switch the LEUART to
+		  high-speed or low-power mode, see drvLEUART_HighSpeed().
+		- CheckCommand() passes binary frames to TelemetryRequest(), see
+		  TELEMETRY.
+		- Documented the configuration variables WEEKDAYS_1~5.
+		- Added energy mode profiler, see EM_PROFILE, and console
+		  command "EM" to show it.
+		- Initialize the ISR profiler, console commands "ISR" to show,
+		  and "ISRC" to show and reset it.
+		- Call LatencyCheck() from the main loop, console command "LAT"
+		  to show the latency statistics.
+		- Added RFID_RxEdge() to the EXTI handlers, console command
+		  "RDY" shows the RFID reader readiness statistics.
+		- Console command "AUD" shows the Audio telemetry.
+		- Event driven main loop: the tasks are only called when their
+		  bit in g_EventMask has been set, see EVENT_POST().
+		- Added CD_Handler() to the EXTI handlers, see DISK_CD_EXTI.
+		- Added DiskPowerFailHandler() to the power-fail handlers.
+		- Console command "SDC" shows the SD-Card sector cache counters.
+		- Call MemMonitorInit() first, MemMonitorCheck() along with the
+		  battery check, console command "MEM" shows the memory usage.
+		- Call ControlCompileActions() after CfgRead().
+2026-10-14,agnt	- Added LogPowerFailHandler() to the power-fail handlers.
 2020-07-17,rage - Audio Module expansion
 2020-05-12,rage	- Call CheckAlarmTimes() after CONFIG.TXT has been read.
 2019-06-20,rage	- Moved DMA related variables to module "DMA_ControlBlock.c".
@@ -94,7 +223,9 @@ Revision History:
  * 32.768kHz external XTAL.  The MCU and other high performance peripheral
  * uses a high-frequency clock.  The board can be configured to use the
  * internal RC-oscillator, or an external 32MHz XTAL for that purpose,
- * see define @ref USE_EXT_32MHZ_CLOCK.
+ * see define @ref USE_EXT_32MHZ_CLOCK.  If @ref HF_CLOCK_GOVERNOR is set, the
+ * MCU runs from the RC-oscillator, and the XTAL is only started while the
+ * SD-Card is in use, see HfClock.c.
  *
  * @subsection DCF77_Atomic_Clock DCF77 Atomic Clock
  * When powered on, the DCF77 hardware module is enabled to receive the time
@@ -173,8 +304,10 @@ Revision History:
  *      will be displayed on the LCD.
  *   -# The file system on the SD-Card will be mounted and the free space of
  *      the media is reported.
- *   -# If a firmware update file (*.UPD) exists on the SD-Card, a reboot will
- *      be initiated to pass control to the booter.
+ *   -# If a firmware update file (*.UPD) exists on the SD-Card, it is
+ *      verified, and a reboot will be initiated to pass control to the
+ *      booter.  An invalid image, or one that is identical with the running
+ *      firmware is skipped, see FwUpdateCheck().
  *   -# Otherwise the firmware looks for a "BOX<n>.TXT" file to use as new log
  *      file.
  *
@@ -230,6 +363,11 @@ Revision History:
  *    alarm times are converted to the appropriate time zone (MEZ or MESZ)
  * -# Alarm times are checked against the current time, devices are enabled
  *    when time is in range
+ * -# When the main loop is idle for the first time, the duration of the boot
+ *    stages is logged, see BootDone().  With @ref FAST_BOOT, the MCU and
+ *    battery information, the battery probe, and the free disk space are
+ *    deferred until then, so the light barriers, the RFID reader, and the
+ *    Audio module are ready earlier.
  *
  * The program then enters the Service Execution Loop which takes care of:
  * - Power management for the RFID reader
@@ -254,7 +392,10 @@ Revision History:
  *
  * @subsection alarm_times ON_TIME_1~5, OFF_TIME_1~5
  * These variables determine the ON and OFF time for the RFID reader
- * and Audio module.
+ * and Audio module.  Up to 5 windows can be defined, each of them may be
+ * restricted to some weekdays via <b>WEEKDAYS_1~5</b>, e.g. "MO-FR".
+ * The windows are compiled into one power schedule, the devices are ON if
+ * the current time is within any of the windows.
  * @subsection ssb01 Operating time of the MOMO_AUDIO 
  * These variables determine the on and off time of the MOMO_AUDIO.  When it
  * is in the off state, the rifd reader and audio module are switched off.
@@ -417,9 +558,12 @@ Revision History:
 #include "em_cmu.h"
 #include "em_emu.h"
 #include "em_dma.h"
+#include "em_int.h"
 #include "config.h"		// include project configuration parameters
 #include "ExtInt.h"
 #include "DCF77.h"
+#include "GPS.h"
+#include "TimeSrc.h"
 #include "LightBarrier.h"
 #include "RFID.h"
 #include "AlarmClock.h"
@@ -430,6 +574,25 @@ Revision History:
 #include "Control.h"
 #include "PowerFail.h"
 #include "Audio.h"
+#include "IsrProfile.h"
+#include "ItmTrace.h"
+#include "PcProfile.h"
+#include "MemMonitor.h"
+#include "Telemetry.h"
+#include "FwUpdate.h"
+#include "LedPattern.h"
+#include "VisitStats.h"
+#include "Forecast.h"
+#include "TempComp.h"
+#include "PowerSeq.h"
+#include "HfClock.h"
+#include "ClockMgr.h"
+#include "Defer.h"
+#include "ScratchPool.h"
+#include "WarmStart.h"
+#include "ParamStore.h"
+#include "SoundDetect.h"
+#include "DmaChan.h"
 
 #ifdef DEBUG
 #include <malloc.h>
@@ -438,29 +601,20 @@ Revision History:
 #include "ff.h"		// FS_FAT12/16/32
 #include "diskio.h"	// DSTATUS
 #include "microsd.h"
+#include "StrFormat.h"
 
 /*================================ Global Data ===============================*/
 
 extern PRJ_INFO const  prj;		// Project Information
 
 
-/*! @brief Flag to indicate that an Interrupt occurred in the meantime.
- *
- * This flag must be set <b>true</b> by any interrupt service routine that
- * requires actions in the service execution loop of main().  This prevents
- * the system from entering sleep mode, so the action can be taken before.
- */
-
-volatile bool		g_flgIRQ;
-
-
 /*! @brief Modules that require EM1.
  *
  * This global variable is a bit mask for all modules that require EM1.
  * Standard peripherals would stop working in EM2 because clocks, etc. are
  * disabled.  Therefore it is required for software modules that make use
- * of such devices, to set the appropriate bit in this mask, as long as they
- * need EM1.  This prevents the power management of this application to enter
+ * of such devices, to set the appropriate bit in this mask via EM1_Acquire(),
+ * as long as they need EM1.  This prevents the power management of this application to enter
  * EM2.  The enumeration @ref EM1_MODULES lists those modules.
  * Low-Power peripherals, e.g. the LEUART still work in EM1.
  *
@@ -468,15 +622,25 @@ volatile bool		g_flgIRQ;
  *
    @code
    // Module RFID requires EM1, set bit in bit mask
-   Bit(g_EM1_ModuleMask, EM1_MOD_RFID) = 1;
+   EM1_Acquire (EM1_MOD_RFID);
    ...
    // Module RFID is no longer active, clear bit in bit mask
-   Bit(g_EM1_ModuleMask, EM1_MOD_RFID) = 0;
+   EM1_Release (EM1_MOD_RFID);
    @endcode
  */
 volatile uint16_t	g_EM1_ModuleMask;
 
 
+/*! @brief Pending tasks of the main loop.
+ *
+ * Each bit of this mask represents a task of the service execution loop, see
+ * @ref EVT_TASK.  It is set via EVENT_POST() when there is something to do
+ * for the task, and cleared by the main loop before calling it.  Initially
+ * all bits are set, so every task is called once after reset.
+ */
+volatile uint16_t	g_EventMask = EVT_ALL;
+
+
 /*! @brief Error Flags Variable
  *
  * This variable holds the current error state of the system, each bit
@@ -490,23 +654,29 @@ volatile uint16_t	l_ErrorFlags;
 /*! EXTI initialization structure
  *
  * Connect the external interrupts of the push buttons to the key handler, the
- * DCF77 signal to the atomic clock module, the outer and inner light barrier
- * to their handler.
+ * DCF77 signal to the atomic clock module (or the PPS signal to the GPS
+ * module, see TIME_SOURCE), the outer and inner light barrier to their
+ * handler.
  */
 static const EXTI_INIT  l_ExtIntCfg[] =
 {   //	IntBitMask,	IntFct
-    {	DCF_EXTI_MASK,	DCF77Handler		},	// DCF77
+    {	TIME_SRC_EXTI_MASK, TIME_SRC_HANDLER	},	// DCF77 or GPS PPS
     {	PF_EXTI_MASK,	PowerFailHandler	},	// Power Fail
     {	LB_EXTI_MASK,	LB_Handler		},	// Light Barriers
+    {	RFID_RX_EXTI_MASK, RFID_RxEdge		},	// RFID Rx activity
+#if DISK_CD_EXTI
+    {	MICROSD_CD_EXTI_MASK, CD_Handler	},	// SD-Card Detect
+#endif
     {	0,		NULL			}
 };
 
-/*!@brief Array of functions to be called in case of power-fail.
+/*!@brief Arrays of functions to be called in case of power-fail.
  *
- * Initialization array to define the power-fail handlers required for some modules.
- * This array is must be 0-terminated.
+ * Initialization arrays to define the power-fail handlers required for some
+ * modules, one for each stage of l_PowerFailStages[].
+ * These arrays must be 0-terminated.
  */
-static const POWER_FAIL_FCT l_PowerFailFct[] =
+static const POWER_FAIL_FCT l_PF_Loads[] =
 {
     RFID_PowerFailHandler,           // switch off RFID reader
     AudioPowerFailHandler,	     // switch off Audio module
@@ -514,6 +684,118 @@ static const POWER_FAIL_FCT l_PowerFailFct[] =
     NULL
 };
 
+#if LOG_JOURNAL
+static const POWER_FAIL_FCT l_PF_Journal[] =
+{
+    LogPowerFailHandler,	     // save log buffer into flash journal
+    NULL
+};
+#endif
+
+static const POWER_FAIL_FCT l_PF_Disk[] =
+{
+    DiskPowerFailHandler,	     // power off a retained SD-Card
+    NULL
+};
+
+/*!@brief Stages of the power-fail shutdown, see PowerFailCheck(). */
+static const POWER_FAIL_STAGE l_PowerFailStages[] =
+{ //	pName,		pFct,		MinSupply,		Budget
+    {	"Loads",	l_PF_Loads,	0,			PF_LOADS_BUDGET	  },
+#if LOG_JOURNAL
+    {	"Journal",	l_PF_Journal,	PF_JOURNAL_MIN_SUPPLY,	PF_JOURNAL_BUDGET },
+#endif
+    {	"Disk",		l_PF_Disk,	PF_DISK_MIN_SUPPLY,	PF_DISK_BUDGET	  },
+    {	NULL,		NULL,		0,			0		  }
+};
+
+/*!@brief Functions to restore the previous state after a short outage. */
+static const POWER_FAIL_FCT l_PowerFailResume[] =
+{
+    RFID_PowerFailResume,	     // power on RFID reader again
+    AudioPowerFailResume,	     // power on Audio module again
+    NULL
+};
+
+#if HF_CLOCK_GOVERNOR
+/*!@brief Functions to recalculate the clock dividers of the peripherals after
+ * a switch of the HF clock, see HfClockInit().  This array must be
+ * 0-terminated.
+ */
+static const HF_CLOCK_FCT l_HfClockChange[] =
+{
+    RFID_ClockChange,		     // baud rate of the RFID reader
+    AudioClockChange,		     // baud rate of the Audio module
+    BatteryMonClockChange,	     // SMBus clock
+#if EXTI_CAPTURE
+    ExtIntClockChange,		     // time base of the edge capture
+#endif
+#if PC_PROFILE
+    PcProfileClockChange,	     // SysTick sampling rate
+#endif
+#if ITM_TRACE
+    ItmTraceClock,		     // rate of the trace time stamps
+#endif
+    NULL
+};
+#endif
+
+/*!@brief LED pattern before a reboot: 3x 5 short pulses, separated by a
+ * pause, see Reboot(). */
+static const LED_PATTERN l_RebootPattern =
+{ //	Bits,	Steps,	Repeat,	StepTime
+	0x155,	18,	3,	100
+};
+
+#if EM_PROFILE
+    /*!@brief Energy modes of the profiler. */
+typedef enum
+{
+    EM_PROF_EM0,	//!< Running
+    EM_PROF_EM1,	//!< Sleep Mode
+    EM_PROF_EM2,	//!< Deep Sleep Mode
+    NUM_EM_PROF
+} EM_PROF;
+
+    /*!@brief Accumulated RTC ticks per energy mode.  32 bits hold 36h, the
+     * profile is logged and cleared after @ref EM_PROFILE_INTERVAL. */
+static uint32_t	l_EM_ProfTicks[NUM_EM_PROF];
+
+    /*!@brief Accumulated RTC ticks in EM1 per bit of @ref g_EM1_ModuleMask. */
+static uint32_t	l_EM1_ModTicks[END_EM1_MODULES];
+
+    /*!@brief Monotonic clock (lower 32 bits) of the last profiler update. */
+static uint32_t	l_EM_ProfLast;
+#endif
+
+    /*!@brief Stages of the boot, see BootStage(). */
+typedef enum
+{
+    BOOT_INIT,		//!< Initialization from the start of the RTC
+    BOOT_DISK,		//!< Mount the SD-Card and open the log file
+    BOOT_CONFIG,	//!< Read the configuration
+    BOOT_DEVICES,	//!< Initialize the RFID reader and the Audio module
+    BOOT_INFO,		//!< MCU and battery information, free disk space
+    NUM_BOOT_STAGES
+} BOOT_STAGE;
+
+    /*!@brief Flag is set until the main loop is idle for the first time. */
+static bool	l_flgBooting = true;
+
+    /*!@brief Flag is set after the devices have been initialized with the
+     * first configuration, see ControlConfigReload().
+     */
+static bool	l_flgConfigured;
+
+    /*!@brief Duration of the boot stages in [ms]. */
+static uint32_t	l_BootMs[NUM_BOOT_STAGES];
+
+    /*!@brief Duration until the devices are ready in [ms]. */
+static uint32_t	l_BootReadyMs;
+
+    /*!@brief Monotonic clock in [ms] at the end of the previous stage. */
+static uint32_t	l_BootLast;
+
 /* Return code for CMU_Select_TypeDef as string */
 static const char *CMU_Select_String[] =
 { "Error", "Disabled", "LFXO", "LFRCO", "HFXO", "HFRCO", "LEDIV2", "AUXHFRCO" };
@@ -522,27 +804,59 @@ static const char *CMU_Select_String[] =
 
 static void cmuSetup(void);
 static void Reboot(void);
+static void LogSystemInfo(void);
+static void BootStage(BOOT_STAGE stage);
+static void BootDone(void);
+static void DiskTask(void);
+#if TASK_SCHED
+static void TaskSchedule(void);
+#endif
 #if ENABLE_LEUART_RECEIVER
 static void CheckCommand(void);
 #endif
 #ifdef DEBUG
 static void MemInfo (void);
 #endif
+#if EM_PROFILE
+static void EM_ProfileAccount(EM_PROF mode, uint16_t mask);
+static void EM_ProfileReport(bool flgLog);
+#endif
 
 /******************************************************************************
  * @brief  Main function
  *****************************************************************************/
 int main( void )
 {
+#if ! TASK_SCHED
+uint16_t events;	// tasks to be called in this pass
+const TASK_ENTRY *pTask; // entry of the task table
+#endif
+bool	 flgPowerFail;	// power-fail was active in this pass
+
+    /* Paint the stacks, switch interrupts to their own stack */
+    MemMonitorInit();
+
     /* Initialize chip - handle erratas */
     CHIP_Init();
 
     /* EFM32 NVIC implementation provides 8 interrupt levels (0~7) */
     NVIC_SetPriorityGrouping (4);	// 8 priority levels, NO sub-priority
+
+    /* PendSV executes the deferred work at the lowest priority */
+    DeferInit();
         
     /* Set up clocks */
     cmuSetup();
 
+    /* Enable the cycle counter for profiling the ISRs */
+    IsrProfileInit();
+
+    /* Start streaming the binary trace records via SWO */
+    ItmTraceInit();
+
+    /* Start sampling the program counter */
+    PcProfileInit();
+
     /* Init Low Energy UART with 9600bd (this is the maximum) */
     drvLEUART_Init (9600);
 
@@ -567,22 +881,29 @@ int main( void )
      * interrupts, so IRQ handler may be executed immediately!
      */
 
+    /* Read the reset cause and start the watchdog, before LogInit() */
+    WarmStartInit();
+
     /* Initialize Logging (do this early) */
     LogInit();
 
+    /* Read the parameters from the internal flash */
+    ParamStoreInit();
+
     /* Log Firmware Revision and Clock Info */
     Log ("MOMO AUDIO V%s (%s %s)", prj.Version, prj.Date, prj.Time);
     uint32_t freq = CMU_ClockFreqGet(cmuClock_HF);
-    Log ("Using %s Clock at %ld.%03ldMHz",
+    Log ("Using %s Clock at %ld.%03ldMHz%s",
 	 CMU_Select_String[CMU_ClockSelectGet(cmuClock_HF)],
-	 freq / 1000000L, (freq % 1000000L) / 1000L);
+	 freq / 1000000L, (freq % 1000000L) / 1000L,
+	 HF_CLOCK_GOVERNOR ? ", HFXO on demand" : "");
     
 #ifdef DEBUG
     MemInfo();		// report available memory
 #endif
     
-     /* Initialize DCF77 hardware, configure Interrupt */
-    DCF77Init();
+     /* Initialize DCF77 or GPS hardware, configure Interrupt */
+    TimeSrcInit();
   
     /* Initialize Light Barrier hardware, configure Interrupt */
     LB_Init();
@@ -591,29 +912,80 @@ int main( void )
     DiskInit();
 
     /* Introduce Power-Fail Handlers, configure Interrupt */
-    PowerFailInit (l_PowerFailFct);
+    PowerFailInit (l_PowerFailStages, l_PowerFailResume);
 
     /* Initialize External Interrupts */
     ExtIntInit (l_ExtIntCfg);
 
+#if EXTI_CAPTURE
+    /* Time stamps of light barrier and time source edges are captured */
+    ExtIntCaptureInit (LB_EXTI_MASK | TIME_SRC_EXTI_MASK);
+#endif
+
+    /* Light barrier and time source handlers run after all other IRQs */
+    ExtIntDeferInit (LB_EXTI_MASK | TIME_SRC_EXTI_MASK);
+
     /* Initialize the Alarm Clock module */
     AlarmClockInit();
 
+#if WARM_START
+    /* After a warm reset, the clock is restored from the retained state */
+    WarmStartRestore();
+#endif
+
+    /* Initialize LED pattern engine */
+    LedInit();
+
     /* Initialize control module */
     ControlInit();
 
+#if PWR_SEQ
+    /* Initialize the power-up sequencer before the power alarms are due */
+    PowerSeqInit();
+#endif
+
+#if VISIT_STATS
+    /* Initialize the visit statistics */
+    VisitStatsInit();
+#endif
+
+#if FORECAST
+    /* Initialize the storage and battery forecast */
+    ForecastInit();
+#endif
+
+#if TEMP_COMP
+    /* Initialize the temperature compensation of the LFXO */
+    TempCompInit();
+#endif
+
+#if SOUND_DETECT
+    /* Initialize the sound-activity detector of the records */
+    SoundDetectInit();
+#endif
+
     /* Switch Log Flush LED OFF */
-    LOG_FLUSH_LED = 0;
+    LedSet (LED_LOG_FLUSH, false);
 
     /* Initialize Battery Monitor */
     BatteryMonInit();
 
-    /* Enable the DCF77 Atomic Clock Decoder */
-    DCF77Enable();
+    /* Enable the DCF77 Atomic Clock Decoder or the GPS receiver */
+    TimeSrcEnable();
 
     /* Enable all other External Interrupts */
     ExtIntEnableAll();
 
+#if EM_PROFILE
+    /* Start the energy mode profile from here */
+    l_EM_ProfLast = (uint32_t)ClockMonoTicks();
+#endif
+
+#if FAST_BOOT
+    /* The free disk space is reported when the boot is complete */
+    DiskFreeDefer (true);
+#endif
+    BootStage (BOOT_INIT);
 
     /* ============================================ *
      * ========== Service Execution Loop ========== *
@@ -621,93 +993,155 @@ int main( void )
     while (1)
     {
 	/* Check for power-fail */
-	if (! PowerFailCheck())
+	flgPowerFail = PowerFailCheck();
+	if (! flgPowerFail)
 	{
-#if ENABLE_LEUART_RECEIVER
-	    /* Check for command from Debug Console */
-	    CheckCommand();
-#endif
-            /* Check if to power-on or off the RFID reader */
-	    RFID_Check();
-                                    
-            /* Check if to power-on or off Audio module */
-           // AudioCheck();
-            
-       	    /* Check if SD-Card has been inserted or removed */
-	    if (DiskCheck())
-	    {
-		/* First check if an "*.UPD" file exists on this SD-Card */
-		if (FindFile ("/", "*.UPD") != NULL)
+#if TASK_SCHED
+	    /* Call the pending tasks in the order of their priority */
+	    TaskSchedule();
+#else
+	    /* Get the pending tasks, new events are posted for the next pass */
+	    INT_Disable();
+	    events = g_EventMask;
+	    g_EventMask = 0;
+	    INT_Enable();
+
+#if FAST_BOOT
+	    /* The battery probe is deferred until the boot is complete */
+	    if (l_flgBooting)
+		events &= ~(1 << EVT_BATTERY);
+#endif
+
+	    /* Call the tasks with pending events in the order of their
+	     * priority, see TASK_REGISTER() */
+	    for (pTask = __task_start;  pTask < __task_end;  pTask++)
+		if (events & pTask->EventMask)
 		{
-		    /*
-		     * In this case the SD-Card contains update images.  We must
-		     * pass control to the booter to perform a firmware upgrade.
-		     */
-		    Reboot();
+		    ITM_TRACE_TASK(pTask->EventMask);
+		    pTask->pFct();
 		}
+#endif
 
-		/* New File System mounted - (re-)open Log File */
-		LogFileOpen("BOX*.TXT", "BOX0999.TXT");
-
-		/* Be sure to flush current log buffer so it is empty */
-		LogFlush(true);	// keep SD-Card power on!
-
-		/* Log information about the MCU and the battery */
-		uint32_t uniquHi = DEVINFO->UNIQUEH;
-		Log ("MCU: %s HW-ID: 0x%08lX%08lX",
-		     PART_NUMBER, uniquHi, DEVINFO->UNIQUEL);
-		LogBatteryInfo (BAT_LOG_INFO_VERBOSE);
-                
-                /* Clear (previous) Configuration - switch devices off */
-		ClearConfiguration();
-                 
-                /* Read and parse configuration file */
-		CfgRead(CONFIG_FILE_NAME);
-
-                /* Initialize RFID reader according to (new) configuration */
-		RFID_Init();
-               
-                /* Initialize Audio module according to (new) configuration */
-		AudioInit();
-                
-                /* Flush log buffer again and switch SD-Card power off */
-	       LogFlush(false);
-                                   
-               /* See if devices must be switched on at this time */
-               CheckAlarmTimes();
-            }
-            
-	    /* Check Battery State */
-	    BatteryCheck();
-            
-             /* Check if to power-on or off Audio module */
-            AudioCheck();
-                      
-            /* Check if to flush the log buffer */
-	    LogFlushCheck();
-        
+#if EM_PROFILE
+	    /* Check if to log the energy mode profile */
+	    if (l_EM_ProfTicks[EM_PROF_EM0] + l_EM_ProfTicks[EM_PROF_EM1]
+		+ l_EM_ProfTicks[EM_PROF_EM2]
+		>= (uint32_t)EM_PROFILE_INTERVAL * RTC_COUNTS_PER_SEC)
+		EM_ProfileReport(true);
+#endif
+
+	    /* The boot is complete when no more tasks are pending */
+	    if (l_flgBooting  &&  g_EventMask == 0)
+		BootDone();
         }
 
+#if WARM_START
+	/* Report the heartbeat of the main loop, feed the watchdog */
+	WarmStartCheck();
+#endif
+
 	/*
 	 * Check for current power mode:  If a minimum of one active module
 	 * requires EM1, i.e. <g_EM1_ModuleMask> is not 0, this will be
 	 * entered.  If no one requires EM1 activity, EM2 is entered.
+	 * Interrupts are disabled while checking for pending events, so an
+	 * event which is posted after the check cannot be lost: WFI returns
+	 * on a pending interrupt, it is served by INT_Enable().  During a
+	 * power-fail which has already been handled, the events remain
+	 * pending until the power has come back.
 	 */
-	if (! g_flgIRQ)		// enter EM only if no IRQ occurred
+	INT_Disable();
+	if (g_EventMask == 0  ||  (flgPowerFail  &&  IsPowerFail()))
 	{
+#if EM_PROFILE
+	    uint16_t mask = g_EM1_ModuleMask;
+
+	    EM_ProfileAccount(EM_PROF_EM0, 0);	// time since wake-up
+	    if (mask)
+		EMU_EnterEM1();		// EM1 - Sleep Mode
+	    else
+	   	EMU_EnterEM2(true);	// EM2 - Deep Sleep Mode
+	    ITM_TRACE_SYNC();
+	    EM_ProfileAccount(mask ? EM_PROF_EM1 : EM_PROF_EM2, mask);
+#else
 	    if (g_EM1_ModuleMask)
 		EMU_EnterEM1();		// EM1 - Sleep Mode
 	    else
 	   	EMU_EnterEM2(true);	// EM2 - Deep Sleep Mode
+	    ITM_TRACE_SYNC();
+#endif
 	}
-	else
-	{
-	    g_flgIRQ = false;	// clear flag to enter EM the next time
-	}
+	INT_Enable();
     }
 }
 
 
+#if TASK_SCHED
+/******************************************************************************
+ * @brief   Priority Scheduler of the Main Loop
+ *
+ * This local routine is called once per pass of the main loop instead of
+ * calling the pending tasks in one sweep.  Before each call, it takes the
+ * events which have been posted meanwhile, and selects the pending task of
+ * the highest priority which has not been called in this pass yet.  So an
+ * event of a higher priority, e.g. a transponder ID that is decoded while
+ * AudioCheck() is running, is served before the remaining tasks of lower
+ * priority, like by the scheduler of an RTOS at the task boundaries.
+ * A task is called once per pass at most, so a task which posts its own
+ * event cannot starve those of lower priority.  Such events are posted
+ * again for the next pass.  The table may contain up to 32 tasks.
+ *
+ *****************************************************************************/
+static void TaskSchedule(void)
+{
+const TASK_ENTRY *pTask;
+uint32_t events = 0;	// events taken in this pass
+uint32_t done = 0;	// tasks called in this pass, one bit per table entry
+uint32_t doneEvt = 0;	// events of the tasks called in this pass
+uint32_t repost = 0;	// events posted after their task has been called
+uint32_t posted;
+int	 i;
+
+    EFM_ASSERT (__task_end - __task_start <= 32);
+
+    while (1)
+    {
+	INT_Disable();
+	posted = g_EventMask;
+	g_EventMask = 0;
+	INT_Enable();
+
+#if FAST_BOOT
+	/* The battery probe is deferred until the boot is complete */
+	if (l_flgBooting)
+	    posted &= ~(1 << EVT_BATTERY);
+#endif
+	repost |= posted & doneEvt;
+	events |= posted;
+
+	for (pTask = __task_start, i = 0;  pTask < __task_end;  pTask++, i++)
+	    if ((events & pTask->EventMask)  &&  ! (done & (1UL << i)))
+		break;
+
+	if (pTask >= __task_end)
+	    break;		// no more tasks pending in this pass
+
+	done    |= 1UL << i;
+	doneEvt |= pTask->EventMask;
+	ITM_TRACE_TASK(pTask->EventMask);
+	pTask->pFct();
+    }
+
+    if (repost)
+    {
+	INT_Disable();
+	g_EventMask |= repost;
+	INT_Enable();
+    }
+}
+#endif
+
+
 /******************************************************************************
  * @brief   Configure Clocks
  *
@@ -720,7 +1154,10 @@ static void cmuSetup(void)
     /* Start LFXO and wait until it is stable */
     CMU_OscillatorEnable(cmuOsc_LFXO, true, true);
 
-#if USE_EXT_32MHZ_CLOCK
+#if HF_CLOCK_GOVERNOR
+    /* Run from the HFRCO, the HFXO is started on demand */
+    HfClockInit (l_HfClockChange);
+#elif USE_EXT_32MHZ_CLOCK
     /* Start HFXO and wait until it is stable */
     CMU_OscillatorEnable(cmuOsc_HFXO, true, true);
 
@@ -745,8 +1182,8 @@ static void cmuSetup(void)
     /* Enable clock for HF peripherals (ADC, DAC, I2C, TIMER, and USART) */
     CMU_ClockEnable(cmuClock_HFPER, true);
 
-    /* Enable clock to GPIO */
-    CMU_ClockEnable(cmuClock_GPIO, true);
+    /* Enable clock to GPIO, it is never released */
+    ClockAcquire(CLK_OWN_SYSTEM, cmuClock_GPIO);
 }
 
 
@@ -755,13 +1192,12 @@ static void cmuSetup(void)
  *
  * This local routine brings the system into a quiescent state and then
  * generates a reset.  It is typically used to transfer control from the
- * application to the booter for firmware upgrades.
+ * application to the booter for firmware upgrades.  The LED pattern
+ * @ref l_RebootPattern is shown before, the CPU sleeps meanwhile.
  *
  *****************************************************************************/
 static void Reboot(void)
 {
-int	n, i;
-
      /* Disable external interrupts */
     ExtIntDisableAll();
 
@@ -769,43 +1205,111 @@ int	n, i;
     BatteryMonDeinit();
     RFID_PowerOff();
     AudioPowerOff();
-    DCF77Disable();
+    TimeSrcDisable();
 
     drvLEUART_puts ("Shutting down system for reboot\n");
 
-    /*
-     * Show LED Pattern before resetting:
-     * 3x 5-short-pulses, separated by a pause,
-     * finally a dimming LED from maximum brightness to off.
-     */
-    for (n = 0;  n < 3;  n++)		// 3x patterns
+    /* Show LED Pattern before resetting, sleep until it is done */
+    LedPatternStart (LED_POWER, &l_RebootPattern);
+    while (LedIsBusy (LED_POWER))
     {
-	for (i = 0;  i < 5;  i++)	// a' 5 pulses
-	{
-	    POWER_LED = 1;
-	    msDelay(100);
-	    POWER_LED = 0;
-	    msDelay(100);
-	}
-	msDelay(800);			// pause
+	if (g_EM1_ModuleMask)
+	    EMU_EnterEM1();
+	else
+	    EMU_EnterEM2(true);
     }
 
-    for (n = 0;  n < 200;  n++)
-    {
-	POWER_LED = 1;
-	for (i = 0;  i < (200 - n);  i++)
-	    DelayTick();
-
-	POWER_LED = 0;
-	for (i = 0;  i < n;  i++)
-	    DelayTick();
-    }
+#if WARM_START
+    /* The clock is restored after the reset */
+    WarmStartSave (false);
+#endif
 
     /* Perform RESET */
     NVIC_SystemReset();
 }
 
 
+/******************************************************************************
+ * @brief   Log System Information
+ *
+ * This local routine logs the MCU type with its unique ID, and the verbose
+ * information of the battery pack, which is read synchronously via SMBus.
+ *
+ *****************************************************************************/
+static void LogSystemInfo(void)
+{
+uint32_t uniquHi = DEVINFO->UNIQUEH;
+
+    Log ("MCU: %s HW-ID: 0x%08lX%08lX",
+	 PART_NUMBER, uniquHi, DEVINFO->UNIQUEL);
+    LogBatteryInfo (BAT_LOG_INFO_VERBOSE);
+}
+
+
+/******************************************************************************
+ * @brief   End of a Boot Stage
+ *
+ * This local routine adds the time since the end of the previous stage to
+ * the duration of <b>stage</b>.  The first stage starts with the RTC, i.e.
+ * in AlarmClockInit(), see ClockMonoMs().  After the boot, i.e. for another
+ * SD-Card, the call has no effect.
+ *
+ * @param[in] stage
+ *	Boot stage that has been finished.
+ *
+ *****************************************************************************/
+static void BootStage(BOOT_STAGE stage)
+{
+uint32_t ms = (uint32_t)ClockMonoMs();
+int	 i;
+
+    if (! l_flgBooting)
+	return;
+
+    l_BootMs[stage] += ms - l_BootLast;
+    l_BootLast = ms;
+
+    /* The system reacts to visits as soon as the devices are initialized */
+    if (stage == BOOT_DEVICES)
+    {
+	l_BootReadyMs = 0;
+	for (i = 0;  i < NUM_BOOT_STAGES;  i++)
+	    l_BootReadyMs += l_BootMs[i];
+    }
+}
+
+
+/******************************************************************************
+ * @brief   Boot is Complete
+ *
+ * This local routine is called when the main loop is idle for the first
+ * time, i.e. no task is pending.  With @ref FAST_BOOT, it does the work
+ * that has been deferred: the MCU and battery information, the report of
+ * the free disk space, and the battery probe of BatteryCheck(), which has
+ * been held back until now.  Then the duration of the boot stages is
+ * logged.
+ *
+ *****************************************************************************/
+static void BootDone(void)
+{
+#if FAST_BOOT
+    l_BootLast = (uint32_t)ClockMonoMs();	// idle time is not accounted
+    LogSystemInfo();
+    DiskFreeDefer (false);
+    BootStage (BOOT_INFO);
+
+    EVENT_POST(EVT_BATTERY);	// call BatteryCheck() now
+#endif
+
+    Log ("Boot [ms]: Init %ld, Disk %ld, Config %ld, Devices %ld, Info %ld,"
+	 " ready %ld", l_BootMs[BOOT_INIT], l_BootMs[BOOT_DISK],
+	 l_BootMs[BOOT_CONFIG], l_BootMs[BOOT_DEVICES], l_BootMs[BOOT_INFO],
+	 l_BootReadyMs);
+
+    l_flgBooting = false;
+}
+
+
 /***************************************************************************//**
  * @brief   Set Error Condition
  *
@@ -823,7 +1327,7 @@ int	n, i;
 void	SetError (ERR_SRC errorSource)
 {
     Bit(l_ErrorFlags, errorSource) = 1;
-    POWER_LED = 1;
+    LedSet (LED_POWER, true);
 }
 
 
@@ -844,7 +1348,38 @@ void	ClearError (ERR_SRC errorSource)
 {
     Bit(l_ErrorFlags, errorSource) = 0;
     if (l_ErrorFlags == 0)
-       POWER_LED = 0;
+       LedSet (LED_POWER, false);
+}
+
+
+/***************************************************************************//**
+ * @brief   Test and clear a Flag
+ *
+ * @param[in] pWord
+ *	Address of the flag word in SRAM.
+ *
+ * @param[in] bit
+ *	Bit number of the flag within the word.
+ *
+ * @return
+ *	The value <i>true</i> if the flag was set, <i>false</i> if not.
+ *
+ * This routine clears the specified flag, if it is set.  Both accesses are
+ * done via bit-band, so no critical section is required: if the flag is set
+ * again by an interrupt between test and clear, both requests are merged
+ * into one, as if they occurred before the test.
+ *
+ * @see
+ * FLAG_SET(), FLAG_CLR(), FLAG_TEST()
+ *
+ *****************************************************************************/
+bool	FlagTestClr (volatile uint32_t *pWord, int bit)
+{
+    if (Bit(*pWord, bit) == 0)
+	return false;
+
+    Bit(*pWord, bit) = 0;
+    return true;
 }
 
 
@@ -865,7 +1400,7 @@ void	ShowDCF77Indicator (bool enable)
     if (l_ErrorFlags)
        return;		// Errors are set - do not change the red LED
       
-    POWER_LED = enable;
+    LedSet (LED_POWER, enable);
 }
 
 
@@ -880,17 +1415,90 @@ void	ShowDCF77Indicator (bool enable)
 #if ENABLE_LEUART_RECEIVER
 static void CheckCommand(void)
 {
+    /* Fall back to low-power mode if no host is attached any more */
+    drvLEUART_SpeedCheck();
+
     if (! g_flgCmdLine)
 	return;
 
     g_flgCmdLine = false;
 
+    /* Fetch the next command line from the receive ring */
+    if (! drvLEUART_CmdLineGet())
+	return;
+
+#if TELEMETRY
+    /* Binary telemetry request, not to be echoed */
+    if (g_CmdLine[0] == TLM_FRAME_START)
+    {
+	TelemetryRequest ((uint8_t *)g_CmdLine + 1, g_CmdLineLen - 1);
+	return;
+    }
+#endif
+
     if (g_CmdLine[0] != EOS)	// skip empty command lines, i.e. <CR> only
     {
 	drvLEUART_puts(g_CmdLine);
 	drvLEUART_puts("\n");
 	if (strcmp("E", g_CmdLine) == 0)
 	    AudioEnable();
+#if EM_PROFILE
+	else if (strcmp("EM", g_CmdLine) == 0)
+	    EM_ProfileReport(false);
+#endif
+#if HF_CLOCK_GOVERNOR
+	else if (strcmp("CLK", g_CmdLine) == 0)
+	    HfClockReport();
+#endif
+	else if (strcmp("PWR", g_CmdLine) == 0)
+	    ClockMgrReport();
+	else if (strcmp("ISR", g_CmdLine) == 0)
+	{
+	    IsrProfileReport(false);
+	    DeferReport(false);
+	}
+	else if (strcmp("ISRC", g_CmdLine) == 0)
+	{
+	    IsrProfileReport(true);
+	    DeferReport(true);
+	}
+	else if (strcmp("PCS", g_CmdLine) == 0)
+	    PcProfileReport(false);
+	else if (strcmp("PCSC", g_CmdLine) == 0)
+	    PcProfileReport(true);
+	else if (strcmp("PCSD", g_CmdLine) == 0)
+	    PcProfileWrite();
+	else if (strcmp("RDY", g_CmdLine) == 0)
+	    RFID_ReadyReport(false);
+	else if (strcmp("AUD", g_CmdLine) == 0)
+	    AudioTelemetryReport(false);
+	else if (strcmp("SDC", g_CmdLine) == 0)
+	    DiskCacheReport(false);
+	else if (strcmp("DMA", g_CmdLine) == 0)
+	    DmaChanReport();
+	else if (strcmp("CFG", g_CmdLine) == 0)
+	    ControlConfigReload(CONFIG_FILE_NAME, true);
+	else if (strcmp("MEM", g_CmdLine) == 0)
+	{
+	    MemMonitorReport(false);
+	    ScratchReport(false);
+	}
+#if VISIT_STATS
+	else if (strcmp("VST", g_CmdLine) == 0)
+	    VisitStatsReport();
+#endif
+#if FORECAST
+	else if (strcmp("FC", g_CmdLine) == 0)
+	    ForecastReport(false);
+#endif
+#if TEMP_COMP
+	else if (strcmp("TC", g_CmdLine) == 0)
+	    TempCompReport(false);
+#endif
+	else if (strcmp("HS", g_CmdLine) == 0)
+	    drvLEUART_HighSpeed(true);
+	else if (strcmp("LS", g_CmdLine) == 0)
+	    drvLEUART_HighSpeed(false);
 	else if (strcmp("D", g_CmdLine) == 0)
 	    AudioDisable();
 	else
@@ -900,8 +1508,196 @@ static void CheckCommand(void)
 	}
     }
 }
+TASK_REGISTER(TASK_PRIO_COMMAND, EVT_COMMAND, CheckCommand);
+#endif
+
+
+/***************************************************************************//**
+ * @brief   Mount a new SD-Card
+ *
+ * This task is called from the main loop when an SD-Card has been inserted
+ * or removed.  After a new file system has been mounted, a firmware update
+ * image is checked, the log file is opened, and the configuration is read.
+ * The devices are initialized with the first configuration, a later one is
+ * applied to the running devices by ControlConfigReload().
+ *
+ *****************************************************************************/
+static void DiskTask(void)
+{
+char	*pUpdFile;	// firmware update image
+
+    if (! DiskCheck())
+	return;
+
+    /* First check if an "*.UPD" file exists on this SD-Card */
+    pUpdFile = FindFile ("/", "*.UPD");
+    if (pUpdFile != NULL  &&  FwUpdateCheck (pUpdFile))
+    {
+	/*
+	 * In this case the SD-Card contains a new firmware image.  We
+	 * must pass control to the booter to perform the upgrade.
+	 */
+	Reboot();
+    }
+
+    /* New File System mounted - (re-)open Log File */
+    LogFileOpen("BOX*.TXT", "BOX0999.TXT");
+    BootStage (BOOT_DISK);
+
+    /* With FAST_BOOT, this is done by BootDone() */
+    if (! FAST_BOOT  ||  ! l_flgBooting)
+    {
+	/* Be sure to flush current log buffer so it is empty */
+	LogFlush(true);	// keep SD-Card power on!
+
+	/* Log information about the MCU and the battery */
+	LogSystemInfo();
+	BootStage (BOOT_INFO);
+    }
+
+    if (l_flgConfigured)
+    {
+	/* Devices are running - only apply configuration changes */
+	ControlConfigReload(CONFIG_FILE_NAME, false);
+
+	/* Flush log buffer again and switch SD-Card power off */
+	LogFlush(false);
+    }
+    else
+    {
+	/* Clear (previous) Configuration - switch devices off */
+	ClearConfiguration();
+
+	/* Read and parse configuration file */
+	CfgRead(CONFIG_FILE_NAME);
+
+	/* Resolve the actions of all transponder IDs */
+	ControlCompileActions();
+	BootStage (BOOT_CONFIG);
+
+	/* Initialize RFID reader according to (new) configuration */
+	RFID_Init();
+
+	/* Initialize Audio module according to (new) configuration */
+	AudioInit();
+	l_flgConfigured = true;
+
+#ifdef BENCH
+	/* Measure the drivers with this SD-Card, see bench.c */
+	BenchRun();
 #endif
 
+	/* Flush log buffer again and switch SD-Card power off */
+	LogFlush(false);
+	BootStage (BOOT_DEVICES);
+
+	/* See if devices must be switched on at this time */
+	CheckAlarmTimes();
+
+	/* New configuration - all tasks must check their state */
+	EVENT_POST_ALL();
+    }
+}
+TASK_REGISTER(TASK_PRIO_DISK, EVT_DISK, DiskTask);
+
+
+
+#if EM_PROFILE
+/***************************************************************************//**
+ * @brief   Account Time to an Energy Mode
+ *
+ * This routine adds the RTC ticks since its last call to the accumulator of
+ * the specified energy mode.  For EM1, the ticks are also added to each
+ * module whose bit is set in <b>mask</b>.  It is called from the main loop
+ * before entering, and after leaving the EM1 or EM2.  Since the RTC counter
+ * has 24 bits only, a single period must not exceed 512s, which is ensured
+ * by the alarm clock, even in tickless mode.  A longer period means that
+ * ClockSet() has reset the RTC counter, and is discarded.
+ *
+ * @param[in] mode
+ *	Energy mode the system has been in since the last call.
+ *
+ * @param[in] mask
+ *	Value of @ref g_EM1_ModuleMask during this period.
+ *
+ *****************************************************************************/
+static void EM_ProfileAccount(EM_PROF mode, uint16_t mask)
+{
+uint32_t cnt = (uint32_t)ClockMonoTicks();
+uint32_t ticks = cnt - l_EM_ProfLast;
+int	 i;
+
+    l_EM_ProfLast = cnt;
+
+    l_EM_ProfTicks[mode] += ticks;
+
+    for (i = 0;  mask != 0  &&  i < END_EM1_MODULES;  i++, mask >>= 1)
+    {
+	if (mask & 1)
+	    l_EM1_ModTicks[i] += ticks;
+    }
+}
+
+
+/***************************************************************************//**
+ * @brief   Report the Energy Mode Profile
+ *
+ * This routine reports the percentage of time spent in EM0, EM1, and EM2,
+ * followed by the percentage each module kept the system in EM1.  The
+ * percentages refer to the total time since the last periodic report.
+ *
+ * @param[in] flgLog
+ *	If true, the profile is logged, and the accumulators are reset for the
+ *	next @ref EM_PROFILE_INTERVAL.  If false, it is only shown on the
+ *	debug console.
+ *
+ *****************************************************************************/
+static void EM_ProfileReport(bool flgLog)
+{
+char	 line[120];
+int	 len;
+uint32_t total;
+uint32_t pct;
+int	 i;
+
+    total = l_EM_ProfTicks[EM_PROF_EM0] + l_EM_ProfTicks[EM_PROF_EM1]
+	  + l_EM_ProfTicks[EM_PROF_EM2];
+    if (total == 0)
+	total = 1;		// prevent division by zero
+
+    len = StrFormat (line, "EM Profile %lds:", total / RTC_COUNTS_PER_SEC);
+
+    for (i = 0;  i < NUM_EM_PROF;  i++)
+    {
+	pct = (uint32_t)((uint64_t)l_EM_ProfTicks[i] * 1000 / total);
+	len += StrFormat (line + len, " EM%d=%ld.%ld%%", i, pct / 10, pct % 10);
+    }
+
+    for (i = 0;  i < END_EM1_MODULES;  i++)
+    {
+	pct = (uint32_t)((uint64_t)l_EM1_ModTicks[i] * 1000 / total);
+	len += StrFormat (line + len, "%s%s=%ld.%ld%%", i == 0 ? ", EM1 by " : "",
+			  g_EM1_ModName[i], pct / 10, pct % 10);
+	if (i < END_EM1_MODULES - 1)
+	    line[len++] = ' ';
+    }
+    line[len] = EOS;
+
+    if (flgLog)
+    {
+	Log (line);
+
+	/* Start a new interval */
+	memset (l_EM_ProfTicks, 0, sizeof(l_EM_ProfTicks));
+	memset (l_EM1_ModTicks, 0, sizeof(l_EM1_ModTicks));
+    }
+    else
+    {
+	drvLEUART_puts (line);
+	drvLEUART_puts ("\n");
+    }
+}
+#endif
 
 
 #ifdef DEBUG
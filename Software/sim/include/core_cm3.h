@@ -0,0 +1,180 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Cortex-M3 Core Peripherals of the Host Simulation
+ * @author	agent
+ * @version	2026-10-14
+ *
+ * This header includes the original CMSIS file, and moves the System Control
+ * Space (NVIC, SCB, SysTick), and the ITM and DWT into host memory, see
+ * @ref g_SimSCS and @ref g_SimCore.
+ *
+ * The inline functions of the original file are expanded with the hardware
+ * addresses, so they are renamed before it is included, and replaced by
+ * versions which use the simulated registers.  The NVIC registers are only
+ * stored, the interrupts are delivered by sim_hal.c.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+*/
+
+#ifndef __INC_sim_core_cm3_h
+#define __INC_sim_core_cm3_h
+
+#include <stdint.h>
+
+#define NVIC_SetPriorityGrouping	CMSIS_NVIC_SetPriorityGrouping
+#define NVIC_GetPriorityGrouping	CMSIS_NVIC_GetPriorityGrouping
+#define NVIC_EnableIRQ			CMSIS_NVIC_EnableIRQ
+#define NVIC_DisableIRQ			CMSIS_NVIC_DisableIRQ
+#define NVIC_GetPendingIRQ		CMSIS_NVIC_GetPendingIRQ
+#define NVIC_SetPendingIRQ		CMSIS_NVIC_SetPendingIRQ
+#define NVIC_ClearPendingIRQ		CMSIS_NVIC_ClearPendingIRQ
+#define NVIC_GetActive			CMSIS_NVIC_GetActive
+#define NVIC_SetPriority		CMSIS_NVIC_SetPriority
+#define NVIC_GetPriority		CMSIS_NVIC_GetPriority
+#define NVIC_SystemReset		CMSIS_NVIC_SystemReset
+#define SysTick_Config			CMSIS_SysTick_Config
+#define ITM_SendChar			CMSIS_ITM_SendChar
+#define ITM_ReceiveChar			CMSIS_ITM_ReceiveChar
+#define ITM_CheckChar			CMSIS_ITM_CheckChar
+
+#include_next "core_cm3.h"
+
+#undef NVIC_SetPriorityGrouping
+#undef NVIC_GetPriorityGrouping
+#undef NVIC_EnableIRQ
+#undef NVIC_DisableIRQ
+#undef NVIC_GetPendingIRQ
+#undef NVIC_SetPendingIRQ
+#undef NVIC_ClearPendingIRQ
+#undef NVIC_GetActive
+#undef NVIC_SetPriority
+#undef NVIC_GetPriority
+#undef NVIC_SystemReset
+#undef SysTick_Config
+#undef ITM_SendChar
+#undef ITM_ReceiveChar
+#undef ITM_CheckChar
+
+/*=============================== Definitions ================================*/
+
+    /*! Size of the simulated System Control Space at 0xE000E000. */
+#define SIM_SCS_SIZE	0x1000
+    /*! Size of the simulated ITM and DWT space at 0xE0000000. */
+#define SIM_CORE_SIZE	0x2000
+
+    /*! Map a hardware address to the host memory of its area. */
+#define SIM_ADDR(area, base, addr)	((uintptr_t)(area) + ((addr) - (base)))
+#define SIM_SCS(addr)	SIM_ADDR(g_SimSCS,  0xE000E000UL, addr)
+#define SIM_CORE(addr)	SIM_ADDR(g_SimCore, 0xE0000000UL, addr)
+
+/*================================ Global Data ===============================*/
+
+extern uint32_t	g_SimSCS[SIM_SCS_SIZE / 4];
+extern uint32_t	g_SimCore[SIM_CORE_SIZE / 4];
+
+void	SimDSB (void);		// see sim_hal.c
+
+/*============================ Address Redirection ===========================*/
+
+#undef  SCS_BASE
+#define SCS_BASE	SIM_SCS(0xE000E000UL)
+#undef  CoreDebug_BASE
+#define CoreDebug_BASE	SIM_SCS(0xE000EDF0UL)
+#undef  ITM_BASE
+#define ITM_BASE	SIM_CORE(0xE0000000UL)
+#undef  DWT_BASE
+#define DWT_BASE	SIM_CORE(0xE0001000UL)
+#undef  TPI_BASE
+
+/*============================= Inline Functions =============================*/
+
+static inline void NVIC_SetPriorityGrouping (uint32_t PriorityGroup)
+{
+    SCB->AIRCR = (SCB->AIRCR & ~(SCB_AIRCR_VECTKEY_Msk | SCB_AIRCR_PRIGROUP_Msk))
+	       | (0x5FA << SCB_AIRCR_VECTKEY_Pos) | ((PriorityGroup & 7) << 8);
+}
+
+static inline uint32_t NVIC_GetPriorityGrouping (void)
+{
+    return (SCB->AIRCR & SCB_AIRCR_PRIGROUP_Msk) >> SCB_AIRCR_PRIGROUP_Pos;
+}
+
+static inline void NVIC_EnableIRQ (IRQn_Type IRQn)
+{
+    NVIC->ISER[(uint32_t)IRQn >> 5] |= (1 << ((uint32_t)IRQn & 0x1F));
+}
+
+static inline void NVIC_DisableIRQ (IRQn_Type IRQn)
+{
+    NVIC->ISER[(uint32_t)IRQn >> 5] &= ~(1 << ((uint32_t)IRQn & 0x1F));
+}
+
+static inline uint32_t NVIC_GetPendingIRQ (IRQn_Type IRQn)
+{
+    return (NVIC->ISPR[(uint32_t)IRQn >> 5] >> ((uint32_t)IRQn & 0x1F)) & 1;
+}
+
+static inline void NVIC_SetPendingIRQ (IRQn_Type IRQn)
+{
+    NVIC->ISPR[(uint32_t)IRQn >> 5] |= (1 << ((uint32_t)IRQn & 0x1F));
+}
+
+static inline void NVIC_ClearPendingIRQ (IRQn_Type IRQn)
+{
+    NVIC->ISPR[(uint32_t)IRQn >> 5] &= ~(1 << ((uint32_t)IRQn & 0x1F));
+}
+
+static inline uint32_t NVIC_GetActive (IRQn_Type IRQn)
+{
+    return (NVIC->IABR[(uint32_t)IRQn >> 5] >> ((uint32_t)IRQn & 0x1F)) & 1;
+}
+
+static inline void NVIC_SetPriority (IRQn_Type IRQn, uint32_t priority)
+{
+    if (IRQn < 0)
+	SCB->SHP[((uint32_t)IRQn & 0xF) - 4] = (priority << (8 - __NVIC_PRIO_BITS)) & 0xFF;
+    else
+	NVIC->IP[(uint32_t)IRQn] = (priority << (8 - __NVIC_PRIO_BITS)) & 0xFF;
+}
+
+static inline uint32_t NVIC_GetPriority (IRQn_Type IRQn)
+{
+    if (IRQn < 0)
+	return SCB->SHP[((uint32_t)IRQn & 0xF) - 4] >> (8 - __NVIC_PRIO_BITS);
+    else
+	return NVIC->IP[(uint32_t)IRQn] >> (8 - __NVIC_PRIO_BITS);
+}
+
+static inline void NVIC_SystemReset (void)
+{
+    SCB->AIRCR = (0x5FA << SCB_AIRCR_VECTKEY_Pos)
+	       | (SCB->AIRCR & SCB_AIRCR_PRIGROUP_Msk) | SCB_AIRCR_SYSRESETREQ_Msk;
+    SimDSB();				// terminates the simulation
+    while (1)
+	;
+}
+
+static inline uint32_t SysTick_Config (uint32_t ticks)
+{
+    SysTick->LOAD = ticks - 1;		// stored only, there is no SysTick
+    return 0;
+}
+
+static inline uint32_t ITM_SendChar (uint32_t ch)
+{
+    return ch;
+}
+
+static inline int32_t ITM_ReceiveChar (void)
+{
+    return -1;
+}
+
+static inline int32_t ITM_CheckChar (void)
+{
+    return 0;
+}
+
+#endif /* __INC_sim_core_cm3_h */
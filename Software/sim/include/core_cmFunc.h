@@ -0,0 +1,57 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Core Function Access for the Host Simulation
+ * @author	agent
+ * @version	2026-10-14
+ *
+ * This header replaces the CMSIS file of the same name for the host build in
+ * directory sim/.  The interrupt mask PRIMASK and BASEPRI are kept by module
+ * sim_hal.c, which also delivers pending interrupts as soon as they are
+ * enabled again.
+ * The stack pointers and the other special registers are only stored.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+2026-10-15,agnt	__set_BASEPRI() calls SimBasePri().
+*/
+
+#ifndef __CORE_CMFUNC_H
+#define __CORE_CMFUNC_H
+
+#include <stdint.h>
+
+/*================================ Prototypes ================================*/
+
+void	 SimIrqMask (uint32_t priMask);	// see sim_hal.c
+void	 SimBasePri (uint32_t basePri);
+uint32_t SimIrqMaskGet (void);
+uint32_t SimIrqActive (void);
+
+/*======================= Special Register Access ===========================*/
+
+extern uint32_t g_SimCoreReg[8];	// CONTROL, PSP, MSP, BASEPRI, ...
+
+static inline void	__enable_irq (void)	{ SimIrqMask (0); }
+static inline void	__disable_irq (void)	{ SimIrqMask (1); }
+static inline uint32_t	__get_PRIMASK (void)	{ return SimIrqMaskGet(); }
+static inline void	__set_PRIMASK (uint32_t priMask) { SimIrqMask (priMask); }
+
+static inline uint32_t	__get_IPSR (void)	{ return SimIrqActive(); }
+static inline uint32_t	__get_xPSR (void)	{ return SimIrqActive(); }
+static inline uint32_t	__get_APSR (void)	{ return 0; }
+
+static inline uint32_t	__get_CONTROL (void)	{ return g_SimCoreReg[0]; }
+static inline void	__set_CONTROL (uint32_t v) { g_SimCoreReg[0] = v; }
+static inline uint32_t	__get_PSP (void)	{ return g_SimCoreReg[1]; }
+static inline void	__set_PSP (uint32_t v)	{ g_SimCoreReg[1] = v; }
+static inline uint32_t	__get_MSP (void)	{ return g_SimCoreReg[2]; }
+static inline void	__set_MSP (uint32_t v)	{ g_SimCoreReg[2] = v; }
+static inline uint32_t	__get_BASEPRI (void)	{ return g_SimCoreReg[3]; }
+static inline void	__set_BASEPRI (uint32_t v) { SimBasePri (v); }
+static inline uint32_t	__get_FAULTMASK (void)	{ return g_SimCoreReg[4]; }
+static inline void	__set_FAULTMASK (uint32_t v) { g_SimCoreReg[4] = v; }
+static inline void	__enable_fault_irq (void)  { g_SimCoreReg[4] = 0; }
+static inline void	__disable_fault_irq (void) { g_SimCoreReg[4] = 1; }
+
+#endif /* __CORE_CMFUNC_H */
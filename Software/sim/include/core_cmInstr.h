@@ -0,0 +1,106 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Core Instruction Access for the Host Simulation
+ * @author	agent
+ * @version	2026-10-14
+ *
+ * This header replaces the CMSIS file of the same name for the host build in
+ * directory sim/.  The Cortex-M3 instructions are implemented in C, the ones
+ * that affect the simulated system, i.e. the barriers and the sleep
+ * instructions, are passed to module sim_hal.c.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+*/
+
+#ifndef __CORE_CMINSTR_H
+#define __CORE_CMINSTR_H
+
+#include <stdint.h>
+
+/*================================ Prototypes ================================*/
+
+void	SimDSB (void);		// see sim_hal.c
+void	SimWFI (void);
+
+/*=========================== Instruction Access =============================*/
+
+static inline void __NOP (void)	 { }
+static inline void __SEV (void)	 { }
+static inline void __ISB (void)	 { }
+static inline void __DMB (void)	 { }
+static inline void __DSB (void)	 { SimDSB(); }
+static inline void __WFI (void)	 { SimWFI(); }
+static inline void __WFE (void)	 { SimWFI(); }
+
+static inline uint32_t __REV (uint32_t value)
+{
+    return __builtin_bswap32 (value);
+}
+
+static inline uint32_t __REV16 (uint32_t value)
+{
+    return ((value & 0xFF00FF00) >> 8) | ((value & 0x00FF00FF) << 8);
+}
+
+static inline int32_t __REVSH (int32_t value)
+{
+    return (int16_t)__builtin_bswap16 ((uint16_t)value);
+}
+
+static inline uint32_t __RBIT (uint32_t value)
+{
+uint32_t result = 0;
+int	 i;
+
+    for (i = 0;  i < 32;  i++, value >>= 1)
+	result = (result << 1) | (value & 1);
+
+    return result;
+}
+
+static inline uint8_t __CLZ (uint32_t value)
+{
+    return value == 0 ? 32 : (uint8_t)__builtin_clz (value);
+}
+
+    /*
+     * The simulation executes the firmware in a single thread, interrupts are
+     * only taken at well-defined points, so an exclusive access never fails.
+     */
+static inline uint8_t  __LDREXB (volatile uint8_t *addr)  { return *addr; }
+static inline uint16_t __LDREXH (volatile uint16_t *addr) { return *addr; }
+static inline uint32_t __LDREXW (volatile uint32_t *addr) { return *addr; }
+
+static inline uint32_t __STREXB (uint8_t value, volatile uint8_t *addr)
+{
+    *addr = value;
+    return 0;
+}
+
+static inline uint32_t __STREXH (uint16_t value, volatile uint16_t *addr)
+{
+    *addr = value;
+    return 0;
+}
+
+static inline uint32_t __STREXW (uint32_t value, volatile uint32_t *addr)
+{
+    *addr = value;
+    return 0;
+}
+
+static inline void __CLREX (void) { }
+
+#define __SSAT(value, sat)						\
+	((int32_t)(value) > ((1 << ((sat) - 1)) - 1) ? ((1 << ((sat) - 1)) - 1) \
+	: (int32_t)(value) < -(1 << ((sat) - 1)) ? -(1 << ((sat) - 1))	\
+	: (int32_t)(value))
+
+#define __USAT(value, sat)						\
+	((int32_t)(value) < 0 ? 0					\
+	: (uint32_t)(value) > ((1U << (sat)) - 1) ? ((1U << (sat)) - 1)	\
+	: (uint32_t)(value))
+
+#endif /* __CORE_CMINSTR_H */
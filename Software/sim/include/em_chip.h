@@ -0,0 +1,26 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Chip Initialization for the Host Simulation
+ * @author	agent
+ * @version	2026-10-14
+ *
+ * The original CHIP_Init() applies the errata fixes via absolute addresses,
+ * which are not mapped by "em_device.h" of the simulation.  The simulated
+ * chip has no errata, so there is nothing to do.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+*/
+
+#ifndef __EM_CHIP_H
+#define __EM_CHIP_H
+
+#include "em_device.h"
+#include "em_system.h"
+
+static inline void CHIP_Init (void)
+{
+}
+
+#endif /* __EM_CHIP_H */
@@ -0,0 +1,126 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Memory Map of the Host Simulation
+ * @author	agent
+ * @version	2026-10-14
+ *
+ * This header includes the original "em_device.h" of the EFM32G, and moves
+ * the register blocks of all peripherals and the information pages into
+ * host memory, see @ref g_SimPeriph.  The peripheral pointers like
+ * <b>USART0</b> remain address constants, so they may still be used in
+ * static initializers.
+ *
+ * The RTC is the only exception: every access calls SimRTC(), which advances
+ * the virtual time and updates the counter.  This lets busy-wait loops like
+ * msDelay() terminate, and delivers pending interrupts.
+ *
+ * The bit-band areas are removed, so "em_bitband.h" falls back to
+ * read-modify-write, see also SIM_BIT() in "config.h".
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+*/
+
+#ifndef __INC_sim_em_device_h
+#define __INC_sim_em_device_h
+
+#include_next "em_device.h"
+
+#include <stdint.h>
+
+/*=============================== Definitions ================================*/
+
+    /*! Size of the simulated peripheral address space at PER_MEM_BASE. */
+#define SIM_PER_SIZE	0x100000
+    /*! Size of the simulated information pages at 0x0FE00000. */
+#define SIM_INFO_SIZE	0x8200
+
+    /*! Map a hardware address to the host memory of its area, see SIM_ADDR()
+     * in "core_cm3.h".
+     */
+#define SIM_PER(addr)	SIM_ADDR(g_SimPeriph, PER_MEM_BASE, addr)
+#define SIM_INFO(addr)	SIM_ADDR(g_SimInfo, 0x0FE00000UL, addr)
+
+/*================================ Global Data ===============================*/
+
+extern uint32_t	g_SimPeriph[SIM_PER_SIZE / 4];
+extern uint32_t	g_SimInfo[SIM_INFO_SIZE / 4];
+extern uint32_t	g_SimRomTable[16];
+
+void	*SimRTC (void);		// see sim_hal.c
+
+/*============================ Address Redirection ===========================*/
+
+#undef  BITBAND_PER_BASE
+#undef  BITBAND_RAM_BASE
+
+#undef  AES_BASE
+#define AES_BASE	SIM_PER(0x400E0000UL)
+#undef  DMA_BASE
+#define DMA_BASE	SIM_PER(0x400C2000UL)
+#undef  MSC_BASE
+#define MSC_BASE	SIM_PER(0x400C0000UL)
+#undef  EMU_BASE
+#define EMU_BASE	SIM_PER(0x400C6000UL)
+#undef  RMU_BASE
+#define RMU_BASE	SIM_PER(0x400CA000UL)
+#undef  CMU_BASE
+#define CMU_BASE	SIM_PER(0x400C8000UL)
+#undef  TIMER0_BASE
+#define TIMER0_BASE	SIM_PER(0x40010000UL)
+#undef  TIMER1_BASE
+#define TIMER1_BASE	SIM_PER(0x40010400UL)
+#undef  TIMER2_BASE
+#define TIMER2_BASE	SIM_PER(0x40010800UL)
+#undef  USART0_BASE
+#define USART0_BASE	SIM_PER(0x4000C000UL)
+#undef  USART1_BASE
+#define USART1_BASE	SIM_PER(0x4000C400UL)
+#undef  USART2_BASE
+#define USART2_BASE	SIM_PER(0x4000C800UL)
+#undef  LEUART0_BASE
+#define LEUART0_BASE	SIM_PER(0x40084000UL)
+#undef  LEUART1_BASE
+#define LEUART1_BASE	SIM_PER(0x40084400UL)
+#undef  RTC_BASE
+#define RTC_BASE	((uintptr_t) SimRTC())
+#undef  LETIMER0_BASE
+#define LETIMER0_BASE	SIM_PER(0x40082000UL)
+#undef  PCNT0_BASE
+#define PCNT0_BASE	SIM_PER(0x40086000UL)
+#undef  PCNT1_BASE
+#define PCNT1_BASE	SIM_PER(0x40086400UL)
+#undef  PCNT2_BASE
+#define PCNT2_BASE	SIM_PER(0x40086800UL)
+#undef  ACMP0_BASE
+#define ACMP0_BASE	SIM_PER(0x40001000UL)
+#undef  ACMP1_BASE
+#define ACMP1_BASE	SIM_PER(0x40001400UL)
+#undef  PRS_BASE
+#define PRS_BASE	SIM_PER(0x400CC000UL)
+#undef  DAC0_BASE
+#define DAC0_BASE	SIM_PER(0x40004000UL)
+#undef  GPIO_BASE
+#define GPIO_BASE	SIM_PER(0x40006000UL)
+#undef  VCMP_BASE
+#define VCMP_BASE	SIM_PER(0x40000000UL)
+#undef  ADC0_BASE
+#define ADC0_BASE	SIM_PER(0x40002000UL)
+#undef  I2C0_BASE
+#define I2C0_BASE	SIM_PER(0x4000A000UL)
+#undef  WDOG_BASE
+#define WDOG_BASE	SIM_PER(0x40088000UL)
+
+#undef  CALIBRATE_BASE
+#define CALIBRATE_BASE	SIM_INFO(0x0FE08000UL)
+#undef  DEVINFO_BASE
+#define DEVINFO_BASE	SIM_INFO(0x0FE081B0UL)
+#undef  LOCKBITS_BASE
+#define LOCKBITS_BASE	SIM_INFO(0x0FE04000UL)
+#undef  USERDATA_BASE
+#define USERDATA_BASE	SIM_INFO(0x0FE00000UL)
+#undef  ROMTABLE_BASE
+#define ROMTABLE_BASE	((uintptr_t) g_SimRomTable)
+
+#endif /* __INC_sim_em_device_h */
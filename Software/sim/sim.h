@@ -0,0 +1,127 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Header file of the Host Simulation
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This header is included by all modules of the host build in directory
+ * sim/, including the firmware modules, see "-include sim.h" in sim/Makefile.
+ * It must therefore not depend on any other header file of the project.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+2026-10-14,agnt	Added SIM_COUNTERS for the benchmark, the replay of field logs,
+		and reply rules by opcode.
+2026-10-15,agnt	Added g_SimAppFlash.
+2026-10-15,agnt	Added SIM_COUNTERS.RxBytes, SimBenchParser(), and the fuzzer.
+*/
+
+#ifndef __INC_sim_h
+#define __INC_sim_h
+
+/*=============================== Header Files ===============================*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief RTC ticks per second of the virtual time. */
+#define SIM_TICKS_PER_SEC	32768
+
+    /*!@brief Register accesses per RTC tick, i.e. each access to the RTC
+     * advances the virtual time by 1/SIM_SUBTICKS of a tick.
+     */
+#define SIM_SUBTICKS		64
+
+    /*!@brief Virtual time that never comes. */
+#define SIM_NEVER		UINT64_MAX
+
+    /*!@brief Convert milliseconds to RTC ticks of the virtual time. */
+#define SIM_MS2TICKS(ms)	((uint64_t)(ms) * SIM_TICKS_PER_SEC / 1000)
+
+    /*!@brief Write access to a read-only register of the simulated hardware. */
+#define SIM_REG(reg)		(*(volatile uint32_t *)&(reg))
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Function that is executed in interrupt context, see SimIrqPost(). */
+typedef void (*SIM_IRQ_FCT)(uintptr_t arg);
+
+    /*!@brief Counters of the work done by the firmware, see sim_bench.c.
+     * They are only incremented, the benchmark evaluates the differences.
+     */
+typedef struct
+{
+    uint64_t	Blocks;		//!< executed basic blocks of the firmware
+    uint32_t	Irqs;		//!< delivered interrupts
+    uint32_t	ConsoleBytes;	//!< bytes written to the console
+    uint32_t	FileBytes;	//!< bytes written to files by f_write()
+    uint32_t	SectorRd;	//!< sectors read from the SD-Card
+    uint32_t	SectorWr;	//!< sectors written to the SD-Card
+    uint32_t	Syncs;		//!< flushes of the SD-Card, i.e. CTRL_SYNC
+    uint32_t	RxBytes;	//!< bytes received from the serial lines
+} SIM_COUNTERS;
+
+/*======================== External Data and Routines ========================*/
+
+extern bool	g_SimVerbose;		// output the trace of the simulation
+extern SIM_COUNTERS g_SimCnt;		// work of the firmware, see sim_bench.c
+extern uint8_t	g_SimAppFlash[];	// application area, see FwUpdate.h
+
+    /* Bit access for Bit() and IO_Bit(), see SIM_BIT() in "config.h" */
+void	 SimBitSet (volatile void *pVar, size_t size, unsigned int bit,
+		    uint32_t value);
+uint32_t SimBitGet (const volatile void *pVar, size_t size, unsigned int bit);
+
+    /* Virtual time and interrupts, see sim_hal.c */
+void	 SimInit (void);
+uint64_t SimTimeGet (void);
+void	 SimIrqPost (SIM_IRQ_FCT function, uintptr_t arg);
+void	 SimPinSet (int port, int pin, bool level);
+bool	 SimPinGet (int port, int pin);
+void	 SimTrace (const char *frmt, ...) __attribute__((format(printf, 1, 2)));
+void	 SimExit (int status) __attribute__((noreturn));
+
+    /* DMA controller, see sim_dma.c */
+void	 SimDmaSync (void);
+bool	 SimDmaPending (void);
+void	 SimDmaIrq (void);
+bool	 SimDmaRequest (unsigned int channel);
+
+    /* Serial lines of the Audio module and the RFID reader, see sim_script.c */
+bool	 SimScriptLoad (const char *pFileName);
+void	 SimScriptAdd (uint64_t time, const char *pSource, int lineNum,
+		       const char *pCmd);
+uint64_t SimScriptNextTime (void);
+void	 SimScriptRun (uint64_t now);
+void	 SimAudioTx (uint8_t byte);
+void	 SimAudioTxDone (void);
+
+    /* Console, see sim_console.c */
+void	 SimConsoleInput (const char *pLine);
+
+    /* SD-Card image, see sim_disk.c */
+bool	 SimDiskOpen (const char *pImage, bool flgFormat);
+bool	 SimDiskImport (const char *pHostFile);
+void	 SimDiskInsert (bool flgInserted);
+void	 SimDiskStats (void);
+
+    /* Replay of field logs, see sim_replay.c */
+bool	 SimReplayLoad (const char *pFileName);
+
+    /* Benchmark, see sim_bench.c */
+bool	 SimBenchOpen (const char *pCsvFile);
+void	 SimBenchAccount (const char *pClass);
+void	 SimBenchWake (void);
+void	 SimBenchSleep (int mode, uint64_t ticks);
+void	 SimBenchParser (const char *pName, uint64_t blocks, uint32_t bytes);
+void	 SimBenchReport (void);
+
+    /* Fuzzer of the parsers, see sim_fuzz.c */
+bool	 SimFuzzLoad (const char *pSpec);
+const char *SimFuzzConfig (const char *pHostFile, const char *pSeed);
+
+#endif /* __INC_sim_h */
@@ -0,0 +1,483 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Benchmark of the Host Simulation
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module measures the work of the firmware per external event, so an
+ * optimization can be judged with a real workload, e.g. a field log that is
+ * replayed by sim_replay.c.  It is enabled by option <b>-b</b> of the
+ * simulation.
+ *
+ * The work is accounted to the source that woke up the firmware: a command
+ * of the script, a byte on a serial line, or the RTC, see SimBenchAccount()
+ * and SimBenchWake().  Each account is closed by the next wake-up, and
+ * consists of:
+ * - The CPU cycles, estimated by an instruction count model.  The firmware
+ *   modules are compiled with <b>-fsanitize-coverage=trace-pc</b>, so each
+ *   executed basic block calls __sanitizer_cov_trace_pc(), and a basic block
+ *   is assumed to take @ref CYCLES_PER_BLOCK cycles on the Cortex-M3.  The
+ *   code of the simulation itself is not counted.  The model does not know
+ *   the wait states and the other peripherals, so only the relative numbers
+ *   are reliable - on the target, DWT_CYCCNT is used by "IsrProfile.c".
+ * - The bytes written to the console and by f_write() to files, which is
+ *   mainly the log.
+ * - The sectors written to the SD-Card, and its flushes (CTRL_SYNC).
+ *
+ * The energy is estimated from the cycles, and from the time spent in EM1
+ * and EM2, with the currents of the EFM32G data sheet at 3V, without the
+ * peripherals and the power outputs.  The current in EM1 scales with the HF
+ * clock at the time of the sleep, see @ref HF_CLOCK_GOVERNOR.
+ *
+ * Every account is written as a line into a CSV file, and the totals per
+ * source are reported at the end of the simulation, see SimBenchReport().
+ *
+ * The parsers of untrusted input are reported separately, with their
+ * throughput in bytes per second of the CPU, and the worst case of cycles
+ * per input byte, see SimBenchParser():
+ * - <b>rfid</b> and <b>audio</b> are the accounts of these sources which
+ *   received bytes, i.e. the frame decoders of the RFID readers and the
+ *   Audio module, including the handling of the frames.  The bytes that are
+ *   received while the firmware sleeps belong to the account of its wake-up.
+ * - <b>config</b> is the work of CfgRead() per byte of the configuration
+ *   file.  CfgRead() is wrapped by the linker option <b>--wrap=CfgRead</b>.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+2026-10-15,agnt	The current in EM1 scales with the HF clock of the sleep.
+2026-10-15,agnt	Added the report of the parsers, see SimBenchParser().
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "em_cmu.h"
+#include "ff.h"
+#include "CfgData.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Estimated number of CPU cycles per basic block of the firmware */
+#define CYCLES_PER_BLOCK	6
+
+    /*! CPU clock of the firmware, i.e. HFXO */
+#define CPU_FREQ		32000000UL
+
+    /*! Supply voltage [V], and currents [uA] of the EFM32G data sheet */
+#define SUPPLY_VOLTAGE		3.0
+#define CURRENT_EM0		(180.0 * CPU_FREQ / 1000000)	// 180uA/MHz
+#define CURRENT_EM1_MHZ		45.0				//  45uA/MHz
+#define CURRENT_EM2		0.9
+#define CURRENT_EM3		0.6
+
+    /*! Maximum number of sources to account for, and length of a name */
+#define MAX_CLASSES		16
+#define MAX_CLASS_NAME		12
+
+    /*! Maximum number of parsers, see SimBenchParser() */
+#define MAX_PARSERS		4
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*! Totals of a source */
+typedef struct
+{
+    char	 Name[MAX_CLASS_NAME];	//!< source, e.g. "rtc" or "lb"
+    uint32_t	 Events;	//!< number of accounts
+    SIM_COUNTERS Sum;		//!< total work
+} BENCH_CLASS;
+
+    /*! Totals of a parser */
+typedef struct
+{
+    char	 Name[MAX_CLASS_NAME];	//!< parser, e.g. "rfid" or "config"
+    uint64_t	 Blocks;	//!< basic blocks of all inputs
+    uint64_t	 Bytes;		//!< bytes of all inputs
+    double	 Worst;		//!< worst basic blocks per byte of an input
+} BENCH_PARSER;
+
+/*================================ Global Data ===============================*/
+
+SIM_COUNTERS	g_SimCnt;
+
+/*================================ Local Data ================================*/
+
+static bool	l_flgEnabled;		//!< benchmark is enabled by SimBenchOpen()
+static FILE	*l_fpCSV;		//!< CSV file with one line per account
+
+static BENCH_CLASS l_Class[MAX_CLASSES];
+static int	l_ClassCnt;
+static BENCH_CLASS *l_pCurrent;		//!< source of the running account
+static uint64_t	l_StartTime;		//!< virtual time of the account
+static SIM_COUNTERS l_Start;		//!< counters at the start
+static char	l_Pending[MAX_CLASS_NAME];	//!< source of the next wake-up
+static uint32_t	l_RxSleep;		//!< received bytes at the last sleep
+
+static BENCH_PARSER l_Parser[MAX_PARSERS];
+static int	l_ParserCnt;
+
+    /*! Virtual time in RTC ticks spent in EM1 to EM3 */
+static uint64_t	l_SleepTicks[4];
+
+    /*! Virtual time in EM1 multiplied by the HF clock in [MHz] */
+static double	l_SleepEM1_MHz;
+
+/*=========================== Forward Declarations ===========================*/
+
+FRESULT	__real_f_write (FIL *fp, const void *buff, UINT btw, UINT *bw);
+void	__real_CfgRead (char *filename);
+
+static void	AccountStart (const char *pClass);
+static double	Energy (uint64_t blocks);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Count a Basic Block
+ *
+ * This routine is called by the instrumented firmware for each basic block.
+ *
+ ******************************************************************************/
+void	__sanitizer_cov_trace_pc (void)
+{
+    g_SimCnt.Blocks++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Count the Bytes written to Files
+ *
+ * All calls of f_write() outside of "ff.c" are redirected here by the linker
+ * option <b>--wrap=f_write</b>, see sim/Makefile.
+ *
+ ******************************************************************************/
+FRESULT	__wrap_f_write (FIL *fp, const void *buff, UINT btw, UINT *bw)
+{
+FRESULT	res = __real_f_write (fp, buff, btw, bw);
+
+    if (res == FR_OK)
+	g_SimCnt.FileBytes += *bw;
+
+    return res;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Measure the Configuration Parser
+ *
+ * All calls of CfgRead() are redirected here by the linker option
+ * <b>--wrap=CfgRead</b>, see sim/Makefile.  The work is reported per byte
+ * of the configuration file.
+ *
+ ******************************************************************************/
+void	__wrap_CfgRead (char *filename)
+{
+uint64_t blocks = g_SimCnt.Blocks;
+FILINFO	 fno;
+
+    __real_CfgRead (filename);
+
+    if (l_flgEnabled  &&  f_stat (filename, &fno) == FR_OK)
+	SimBenchParser ("config", g_SimCnt.Blocks - blocks, fno.fsize);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Enable the Benchmark
+ *
+ * @param[in] pCsvFile
+ *	Name of the CSV file for the accounts.
+ *
+ * @return
+ *	true if the CSV file could be created.
+ *
+ ******************************************************************************/
+bool	SimBenchOpen (const char *pCsvFile)
+{
+    l_fpCSV = fopen (pCsvFile, "w");
+    if (l_fpCSV == NULL)
+    {
+	perror (pCsvFile);
+	return false;
+    }
+    fprintf (l_fpCSV, "time_ms,source,cycles,console_bytes,file_bytes,"
+	     "sectors_written,syncs,energy_uJ,rx_bytes\n");
+
+    l_flgEnabled = true;
+    l_RxSleep = g_SimCnt.RxBytes;
+    AccountStart ("boot");
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Source of an Event
+ *
+ * This routine is called for each event that may wake up the firmware.  The
+ * last source before the wake-up gets the account, see SimBenchWake().
+ *
+ * @param[in] pClass
+ *	Name of the source, it is truncated to @ref MAX_CLASS_NAME - 1
+ *	characters.
+ *
+ ******************************************************************************/
+void	SimBenchAccount (const char *pClass)
+{
+    strncpy (l_Pending, pClass, MAX_CLASS_NAME - 1);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Wake-up of the Firmware
+ *
+ * This routine is called when the firmware wakes up from a sleep.  It starts
+ * a new account for the reported source, or for the RTC if there was none.
+ *
+ ******************************************************************************/
+void	SimBenchWake (void)
+{
+    AccountStart (l_Pending[0] ? l_Pending : "rtc");
+    l_Pending[0] = '\0';
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Start a new Account
+ *
+ * This routine closes the running account, and starts a new one.  All work
+ * of the firmware from now on is accounted to source @p pClass.
+ *
+ ******************************************************************************/
+static void	AccountStart (const char *pClass)
+{
+SIM_COUNTERS d;
+int	i;
+
+    if (! l_flgEnabled)
+	return;
+
+    if (l_pCurrent)
+    {
+	d.Blocks       = g_SimCnt.Blocks       - l_Start.Blocks;
+	d.Irqs         = g_SimCnt.Irqs         - l_Start.Irqs;
+	d.ConsoleBytes = g_SimCnt.ConsoleBytes - l_Start.ConsoleBytes;
+	d.FileBytes    = g_SimCnt.FileBytes    - l_Start.FileBytes;
+	d.SectorRd     = g_SimCnt.SectorRd     - l_Start.SectorRd;
+	d.SectorWr     = g_SimCnt.SectorWr     - l_Start.SectorWr;
+	d.Syncs        = g_SimCnt.Syncs        - l_Start.Syncs;
+	d.RxBytes      = l_RxSleep             - l_Start.RxBytes;
+
+	l_pCurrent->Events++;
+	l_pCurrent->Sum.Blocks       += d.Blocks;
+	l_pCurrent->Sum.Irqs         += d.Irqs;
+	l_pCurrent->Sum.ConsoleBytes += d.ConsoleBytes;
+	l_pCurrent->Sum.FileBytes    += d.FileBytes;
+	l_pCurrent->Sum.SectorRd     += d.SectorRd;
+	l_pCurrent->Sum.SectorWr     += d.SectorWr;
+	l_pCurrent->Sum.Syncs        += d.Syncs;
+	l_pCurrent->Sum.RxBytes      += d.RxBytes;
+
+	fprintf (l_fpCSV, "%llu,%s,%llu,%u,%u,%u,%u,%.3f,%u\n",
+		 (unsigned long long)(l_StartTime * 1000 / SIM_TICKS_PER_SEC),
+		 l_pCurrent->Name,
+		 (unsigned long long)(d.Blocks * CYCLES_PER_BLOCK),
+		 (unsigned)d.ConsoleBytes, (unsigned)d.FileBytes,
+		 (unsigned)d.SectorWr, (unsigned)d.Syncs, Energy (d.Blocks),
+		 (unsigned)d.RxBytes);
+
+	/* The serial sources are also reported as parsers */
+	if (d.RxBytes > 0)
+	    SimBenchParser (l_pCurrent->Name, d.Blocks, d.RxBytes);
+    }
+
+    for (i = 0;  i < l_ClassCnt;  i++)
+	if (strncmp (l_Class[i].Name, pClass, MAX_CLASS_NAME - 1) == 0)
+	    break;
+
+    if (i == l_ClassCnt)
+    {
+	if (l_ClassCnt >= MAX_CLASSES)
+	    i = MAX_CLASSES - 1;	// the last one takes the rest
+	else
+	    strncpy (l_Class[l_ClassCnt++].Name, pClass, MAX_CLASS_NAME - 1);
+    }
+
+    l_pCurrent  = &l_Class[i];
+    l_StartTime = SimTimeGet();
+    l_Start     = g_SimCnt;
+    l_Start.RxBytes = l_RxSleep;	// bytes of the wake-up belong to us
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Account the Work of a Parser
+ *
+ * This routine adds the work for an input of a parser to its totals, and
+ * keeps the worst case per byte.
+ *
+ * @param[in] pName
+ *	Name of the parser, it is truncated to @ref MAX_CLASS_NAME - 1
+ *	characters.
+ *
+ * @param[in] blocks
+ *	Basic blocks executed for this input.
+ *
+ * @param[in] bytes
+ *	Size of the input in bytes.
+ *
+ ******************************************************************************/
+void	SimBenchParser (const char *pName, uint64_t blocks, uint32_t bytes)
+{
+BENCH_PARSER *pParser;
+int	i;
+
+    if (! l_flgEnabled  ||  bytes == 0)
+	return;
+
+    for (i = 0;  i < l_ParserCnt;  i++)
+	if (strncmp (l_Parser[i].Name, pName, MAX_CLASS_NAME - 1) == 0)
+	    break;
+
+    if (i == l_ParserCnt)
+    {
+	if (l_ParserCnt >= MAX_PARSERS)
+	    return;
+	strncpy (l_Parser[l_ParserCnt++].Name, pName, MAX_CLASS_NAME - 1);
+    }
+
+    pParser = &l_Parser[i];
+    pParser->Blocks += blocks;
+    pParser->Bytes  += bytes;
+    if ((double)blocks / bytes > pParser->Worst)
+	pParser->Worst = (double)blocks / bytes;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Account the Time of a Sleep
+ *
+ * @param[in] mode
+ *	Energy mode, i.e. 1 to 3.
+ *
+ * @param[in] ticks
+ *	Duration of the sleep in RTC ticks.
+ *
+ ******************************************************************************/
+void	SimBenchSleep (int mode, uint64_t ticks)
+{
+    l_RxSleep = g_SimCnt.RxBytes;
+
+    if (mode >= 1  &&  mode <= 3)
+	l_SleepTicks[mode] += ticks;
+
+    if (mode == 1)
+	l_SleepEM1_MHz += (double)ticks * CMU_ClockFreqGet (cmuClock_HF)
+			  / 1000000;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Energy of the executed Basic Blocks
+ *
+ * @return
+ *	Energy in uJ.
+ *
+ ******************************************************************************/
+static double	Energy (uint64_t blocks)
+{
+    return (double)(blocks * CYCLES_PER_BLOCK) / CPU_FREQ
+	   * CURRENT_EM0 * SUPPLY_VOLTAGE;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Report the Results of the Benchmark
+ *
+ * This routine closes the running account, and reports the totals for each
+ * source, and the estimated energy including the sleep modes.
+ *
+ ******************************************************************************/
+void	SimBenchReport (void)
+{
+BENCH_CLASS *pClass;
+uint64_t cycles, blocks = 0;
+double	 seconds, active, energy;
+int	 i;
+
+    if (! l_flgEnabled)
+	return;
+
+    l_RxSleep = g_SimCnt.RxBytes;
+    AccountStart ("end");
+    fclose (l_fpCSV);
+    l_flgEnabled = false;
+
+    printf ("## bench: %-8s %8s %12s %10s %9s %9s %7s %5s %11s\n",
+	    "source", "events", "cycles", "cyc/event", "console", "file",
+	    "sectors", "syncs", "energy[uJ]");
+
+    for (i = 0, pClass = l_Class;  i < l_ClassCnt;  i++, pClass++)
+    {
+	if (pClass->Events == 0)
+	    continue;
+
+	cycles = pClass->Sum.Blocks * CYCLES_PER_BLOCK;
+	blocks += pClass->Sum.Blocks;
+	printf ("## bench: %-8s %8u %12llu %10llu %9u %9u %7u %5u %11.1f\n",
+		pClass->Name, (unsigned)pClass->Events,
+		(unsigned long long)cycles,
+		(unsigned long long)(cycles / pClass->Events),
+		(unsigned)pClass->Sum.ConsoleBytes,
+		(unsigned)pClass->Sum.FileBytes,
+		(unsigned)pClass->Sum.SectorWr, (unsigned)pClass->Sum.Syncs,
+		Energy (pClass->Sum.Blocks));
+    }
+
+    /* The virtual time does not advance while the CPU is running */
+    seconds = (double)SimTimeGet() / SIM_TICKS_PER_SEC;
+    active  = (double)(blocks * CYCLES_PER_BLOCK) / CPU_FREQ;
+    energy  = Energy (blocks)
+	    + l_SleepEM1_MHz / SIM_TICKS_PER_SEC * CURRENT_EM1_MHZ
+	      * SUPPLY_VOLTAGE
+	    + (double)l_SleepTicks[2] / SIM_TICKS_PER_SEC * CURRENT_EM2
+	      * SUPPLY_VOLTAGE
+	    + (double)l_SleepTicks[3] / SIM_TICKS_PER_SEC * CURRENT_EM3
+	      * SUPPLY_VOLTAGE;
+
+    printf ("## bench: %.1fs simulated, EM0 %.3fs, EM1 %.1fs, EM2 %.1fs,"
+	    " EM3 %.1fs\n", seconds, active,
+	    (double)l_SleepTicks[1] / SIM_TICKS_PER_SEC,
+	    (double)l_SleepTicks[2] / SIM_TICKS_PER_SEC,
+	    (double)l_SleepTicks[3] / SIM_TICKS_PER_SEC);
+    printf ("## bench: %.1fuJ total, %.2fuA average\n", energy,
+	    seconds > 0 ? energy / SUPPLY_VOLTAGE / seconds : 0.0);
+
+    if (l_ParserCnt == 0)
+	return;
+
+    printf ("## parse: %-8s %10s %12s %10s %9s %9s\n", "parser", "bytes",
+	    "cycles", "bytes/s", "cyc/byte", "worst");
+
+    for (i = 0;  i < l_ParserCnt;  i++)
+    {
+	cycles = l_Parser[i].Blocks * CYCLES_PER_BLOCK;
+	printf ("## parse: %-8s %10llu %12llu %10.0f %9.1f %9.1f\n",
+		l_Parser[i].Name, (unsigned long long)l_Parser[i].Bytes,
+		(unsigned long long)cycles,
+		cycles ? (double)l_Parser[i].Bytes * CPU_FREQ / cycles : 0.0,
+		(double)cycles / l_Parser[i].Bytes,
+		l_Parser[i].Worst * CYCLES_PER_BLOCK);
+    }
+}
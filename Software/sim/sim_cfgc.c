@@ -0,0 +1,461 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Configuration Compiler of the Host Build
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This program validates a configuration file, and generates the binary
+ * image @ref CFG_BIN_FILE_NAME for it.  It uses the unmodified parser of the
+ * firmware, i.e. CfgRead() in "CfgData.c" with the list of configuration
+ * variables of "Control.c", so it reports exactly the same errors as the
+ * box would do when booting.  The image is copied to the SD-Card together
+ * with the text file.  The firmware then loads it instead of parsing the
+ * text file, also if the time stamp of the file differs, see CfgBinLoad().
+ *
+ * Usage: cfg_compile [-v] [-x] [-b hwid] [-o image] CONFIG.TXT
+ *
+ * - <b>-v</b> also outputs the trace of the simulation.
+ * - <b>-x</b> updates the section index "[INDEX]" of the text file before
+ *   it is compiled, see UpdateIndex().
+ * - <b>-b hwid</b> compiles the file for the box with this hardware ID,
+ *   i.e. the common part and the section "[BOX hwid]".  Default is the
+ *   hardware ID of the simulation.
+ * - <b>-o image</b> specifies the binary image to be written, default is
+ *   @ref CFG_BIN_FILE_NAME in the directory of the text file.
+ *
+ * The text file is copied as @ref CONFIG_FILE_NAME into a temporary SD-Card
+ * image, where the firmware reads it.  The log messages of the firmware,
+ * including the list of all IDs and settings, are written to stdout.  The
+ * exit status is 0 if the file could be parsed without errors, and the image
+ * has been written.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Added option -x to update the section index, and option -b to
+		compile for another box.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <time.h>
+#include "config.h"
+#include "AlarmClock.h"
+#include "CfgData.h"
+#include "Control.h"
+#include "Logging.h"
+#include "LEUART.h"
+#include "microsd.h"
+#include "ff.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Template of the temporary SD-Card image */
+#define CFGC_IMAGE_TEMPLATE	"/tmp/cfg_compileXXXXXX"
+
+    /*! Maximum size of a configuration file for UpdateIndex() */
+#define CFGC_MAX_FILE_SIZE	(4 * 1024 * 1024)
+
+    /*! Maximum number of box sections for UpdateIndex() */
+#define CFGC_MAX_SECTIONS	4096
+
+/*=========================== Forward Declarations ===========================*/
+
+static bool	UpdateIndex (const char *pHostFile);
+static bool	CopyToImage (const char *pHostFile, const char *pName);
+static bool	CopyFromImage (const char *pName, const char *pHostFile);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Show the Usage
+ *
+ ******************************************************************************/
+static void usage (const char *pProg)
+{
+    fprintf (stderr, "usage: %s [-v] [-x] [-b hwid] [-o image] CONFIG.TXT\n",
+	     pProg);
+    exit (2);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Main Routine
+ *
+ ******************************************************************************/
+int	main (int argc, char *argv[])
+{
+static FATFS fs;
+char	 image[] = CFGC_IMAGE_TEMPLATE;
+char	 output[256];
+const char *pOutput = NULL;
+const char *pSep;
+const char *pBoxID = NULL;
+TRANSPONDER_ID boxID = 0;
+uint32_t errCnt;
+bool	 flgOk;
+bool	 flgIndex = false;
+int	 opt, fd;
+
+    g_SimVerbose = false;
+
+    while ((opt = getopt (argc, argv, "vxb:o:")) != -1)
+    {
+	switch (opt)
+	{
+	    case 'v':
+		g_SimVerbose = true;
+		break;
+
+	    case 'x':
+		flgIndex = true;
+		break;
+
+	    case 'b':
+		pBoxID = optarg;
+		if (! CfgStrToID (pBoxID, &boxID))
+		{
+		    fprintf (stderr, "%s: invalid hardware ID\n", pBoxID);
+		    usage (argv[0]);
+		}
+		break;
+
+	    case 'o':
+		pOutput = optarg;
+		break;
+
+	    default:
+		usage (argv[0]);
+	}
+    }
+
+    if (optind != argc - 1)
+	usage (argv[0]);
+
+    if (flgIndex  &&  ! UpdateIndex (argv[optind]))
+	return 1;
+
+    /* Default output is CONFIG.BIN beside the text file */
+    if (pOutput == NULL)
+    {
+	pSep = strrchr (argv[optind], '/');
+	snprintf (output, sizeof(output), "%.*s%s",
+		  pSep ? (int)(pSep - argv[optind] + 1) : 0, argv[optind],
+		  CFG_BIN_FILE_NAME);
+	pOutput = output;
+    }
+
+    /* The firmware uses mktime() and friends with UTC */
+    setenv ("TZ", "UTC", 1);
+    tzset();
+
+    setvbuf (stdout, NULL, _IOLBF, 0);
+
+    SimInit();
+
+    /* Hardware ID which selects the box section, see CfgSection() */
+    if (pBoxID != NULL)
+    {
+	SIM_REG(DEVINFO->UNIQUEH) = (uint32_t)(boxID >> 32);
+	SIM_REG(DEVINFO->UNIQUEL) = (uint32_t)boxID;
+    }
+
+    /* Temporary SD-Card with the configuration file */
+    fd = mkstemp (image);
+    if (fd < 0)
+    {
+	perror (image);
+	return 1;
+    }
+    close (fd);
+
+    if (! SimDiskOpen (image, true))
+    {
+	unlink (image);
+	return 1;
+    }
+    SimDiskInsert (true);
+    f_mount (0, &fs);
+
+    flgOk = CopyToImage (argv[optind], CONFIG_FILE_NAME);
+
+    if (flgOk)
+    {
+	/* The modules which are involved in reading the configuration */
+	drvLEUART_Init (9600);
+	LogInit();
+	DiskInit();
+	AlarmClockInit();
+	ControlInit();
+
+	/* Same sequence as main() after an SD-Card has been mounted */
+	errCnt = g_LogErrorCnt;
+	ClearConfiguration();
+	CfgRead (CONFIG_FILE_NAME);
+	ControlCompileActions();
+	LogFlush (false);
+
+	errCnt = g_LogErrorCnt - errCnt;
+	if (errCnt > 0)
+	{
+	    fprintf (stderr, "%s: %u error(s), no image generated\n",
+		     argv[optind], (unsigned)errCnt);
+	    flgOk = false;
+	}
+	else
+	{
+	    flgOk = CopyFromImage (CFG_BIN_FILE_NAME, pOutput);
+	    if (flgOk)
+		fprintf (stderr, "%s: generated %s\n", argv[optind], pOutput);
+	}
+    }
+
+    f_mount (0, NULL);
+    unlink (image);
+
+    return flgOk ? 0 : 1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Update the Section Index of a Configuration File
+ *
+ * This routine rewrites the "[INDEX]" of the text file, with one entry
+ * "<hwid> = <offset>:<line>" for each section "[BOX <hwid>]", i.e. the file
+ * offset and the line number of its header.  An existing index is replaced,
+ * otherwise the index is inserted before the first section.  The offsets
+ * depend on the size of the index itself, so it is built until its size
+ * does not change any more.
+ *
+ ******************************************************************************/
+static bool	UpdateIndex (const char *pHostFile)
+{
+static char	 in[CFGC_MAX_FILE_SIZE];
+static char	 idx[CFGC_MAX_SECTIONS * 48];
+static size_t	 sectOffs[CFGC_MAX_SECTIONS];
+static int	 sectLine[CFGC_MAX_SECTIONS];
+static char	 sectID[CFGC_MAX_SECTIONS][17];
+FILE	*fp;
+size_t	 size, offs, next, idxBegin, idxEnd, idxLen, len;
+const char *pEOL;
+const char *pStr;
+int	 line, idxLine, oldLines, sectCnt, i, n;
+bool	 flgIndex = false;
+
+    fp = fopen (pHostFile, "rb");
+    if (fp == NULL)
+    {
+	perror (pHostFile);
+	return false;
+    }
+    size = fread (in, 1, sizeof(in), fp);
+    fclose (fp);
+    if (size >= sizeof(in))
+    {
+	fprintf (stderr, "%s: file too large\n", pHostFile);
+	return false;
+    }
+
+    /* Find the index and the sections, index entries start with a digit */
+    idxBegin = idxEnd = size;
+    idxLine = 0;
+    sectCnt = 0;
+    pEOL = "\n";
+    for (offs = 0, line = 1;  offs < size;  offs = next, line++)
+    {
+	for (next = offs;  next < size  &&  in[next] != '\n';  next++)
+	    ;
+	if (next < size)
+	{
+	    if (next > offs  &&  in[next - 1] == '\r')
+		pEOL = "\r\n";
+	    next++;
+	}
+
+	for (pStr = in + offs;  pStr < in + next  &&  (*pStr == ' '
+					    ||  *pStr == '\t');  pStr++)
+	    ;
+
+	if (flgIndex  &&  (pStr >= in + next  ||  ! isxdigit ((int)*pStr)))
+	{
+	    flgIndex = false;		// end of the old index
+	    idxEnd = offs;
+	}
+
+	if (strncmp (pStr, "[INDEX]", 7) == 0  &&  sectCnt == 0)
+	{
+	    flgIndex = true;
+	    idxBegin = offs;
+	    idxLine = line;
+	}
+	else if (strncmp (pStr, "[BOX", 4) == 0)
+	{
+	    if (sectCnt >= CFGC_MAX_SECTIONS)
+	    {
+		fprintf (stderr, "%s: too many sections\n", pHostFile);
+		return false;
+	    }
+	    if (sectCnt == 0  &&  idxLine == 0)
+	    {
+		idxBegin = idxEnd = offs;	// insert the index here
+		idxLine = line;
+	    }
+	    for (pStr += 4;  *pStr == ' '  ||  *pStr == '\t';  pStr++)
+		;
+	    for (i = 0;  i < 16  &&  isxdigit ((int)pStr[i]);  i++)
+		sectID[sectCnt][i] = toupper ((int)pStr[i]);
+	    sectID[sectCnt][i] = EOS;
+	    sectOffs[sectCnt] = offs;
+	    sectLine[sectCnt] = line;
+	    sectCnt++;
+	}
+    }
+    if (flgIndex)
+	idxEnd = size;
+
+    if (sectCnt == 0)
+    {
+	fprintf (stderr, "%s: no sections \"[BOX <hwid>]\"\n", pHostFile);
+	return false;
+    }
+
+    /* The offsets behind the index are shifted by its new size */
+    for (oldLines = 0, offs = idxBegin;  offs < idxEnd;  offs++)
+	if (in[offs] == '\n')
+	    oldLines++;
+
+    for (idxLen = len = 0, i = 0;  i < 8;  i++)
+    {
+	len = sprintf (idx, "[INDEX]%s", pEOL);
+	for (n = 0;  n < sectCnt;  n++)
+	    len += sprintf (idx + len, "%s = %lu:%d%s", sectID[n],
+			    (unsigned long)(sectOffs[n] - (idxEnd - idxBegin)
+					    + idxLen),
+			    sectLine[n] - oldLines + sectCnt + 1, pEOL);
+	if (len == idxLen)
+	    break;		// the offsets match the size of the index
+	idxLen = len;
+    }
+
+    fp = fopen (pHostFile, "wb");
+    if (fp == NULL)
+    {
+	perror (pHostFile);
+	return false;
+    }
+    if (fwrite (in, 1, idxBegin, fp) != idxBegin
+    ||  fwrite (idx, 1, len, fp) != len
+    ||  fwrite (in + idxEnd, 1, size - idxEnd, fp) != size - idxEnd
+    ||  fclose (fp) != 0)
+    {
+	fprintf (stderr, "%s: write error\n", pHostFile);
+	return false;
+    }
+
+    fprintf (stderr, "%s: index of %d sections updated\n", pHostFile, sectCnt);
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Copy a Host File into the Root Directory of the Image
+ *
+ ******************************************************************************/
+static bool	CopyToImage (const char *pHostFile, const char *pName)
+{
+FIL	 fil;
+FILE	*fp;
+uint8_t	 buf[4096];
+size_t	 cnt;
+UINT	 written;
+FRESULT	 res;
+
+    fp = fopen (pHostFile, "rb");
+    if (fp == NULL)
+    {
+	perror (pHostFile);
+	return false;
+    }
+
+    res = f_open (&fil, pName, FA_CREATE_ALWAYS | FA_WRITE);
+    if (res == FR_OK)
+    {
+	while ((cnt = fread (buf, 1, sizeof(buf), fp)) > 0)
+	{
+	    res = f_write (&fil, buf, (UINT)cnt, &written);
+	    if (res != FR_OK  ||  written != cnt)
+	    {
+		if (res == FR_OK)
+		    res = FR_DENIED;	// image is full
+		break;
+	    }
+	}
+	if (f_close (&fil) != FR_OK  &&  res == FR_OK)
+	    res = FR_DISK_ERR;
+    }
+    fclose (fp);
+
+    if (res != FR_OK)
+    {
+	fprintf (stderr, "%s: cannot copy to the image, error %d\n",
+		 pHostFile, res);
+	return false;
+    }
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Copy a File from the Root Directory of the Image to the Host
+ *
+ ******************************************************************************/
+static bool	CopyFromImage (const char *pName, const char *pHostFile)
+{
+FIL	 fil;
+FILE	*fp;
+uint8_t	 buf[4096];
+UINT	 cnt;
+FRESULT	 res;
+
+    res = f_open (&fil, pName, FA_READ | FA_OPEN_EXISTING);
+    if (res != FR_OK)
+    {
+	fprintf (stderr, "%s has not been generated, error %d\n", pName, res);
+	return false;
+    }
+
+    fp = fopen (pHostFile, "wb");
+    if (fp == NULL)
+    {
+	perror (pHostFile);
+	f_close (&fil);
+	return false;
+    }
+
+    while ((res = f_read (&fil, buf, sizeof(buf), &cnt)) == FR_OK  &&  cnt > 0)
+    {
+	if (fwrite (buf, 1, cnt, fp) != cnt)
+	{
+	    res = FR_DISK_ERR;
+	    break;
+	}
+    }
+    f_close (&fil);
+
+    if (fclose (fp) != 0  ||  res != FR_OK)
+    {
+	fprintf (stderr, "%s: write error\n", pHostFile);
+	unlink (pHostFile);
+	return false;
+    }
+    return true;
+}
@@ -0,0 +1,191 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Console of the Host Simulation
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module replaces "LEUART.c" for the host build.  All output is written
+ * to <b>stdout</b> at once, so the transmit FIFO is never full and nothing
+ * is discarded.  Command lines are injected by the script, see
+ * SimConsoleInput(), and are signalled to the firmware in interrupt context,
+ * like the LEUART_IRQHandler() does on the target.  They are fetched one
+ * after the other by drvLEUART_CmdLineGet(), like from the receive ring.
+ *
+ * Since the original drvLEUART_Init() initializes the DMA controller for all
+ * other modules, this is done here as well.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+2026-10-14,agnt	The output is counted in g_SimCnt.ConsoleBytes.
+2026-10-15,agnt	drvLEUART_HighSpeed() acquires EM1 via ClockMgr.c.
+2026-10-15,agnt	Pending lines are fetched by drvLEUART_CmdLineGet().
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <string.h>
+#include "em_device.h"
+#include "em_dma.h"
+#include "LEUART.h"
+#include "ClockMgr.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Size of the command line buffer, must be the same as in "LEUART.c" */
+#define CMD_LINE_SIZE		40
+
+/*========================= Global Data and Routines =========================*/
+
+/*!@brief Global flag to convert \<LF> to \<CR>\<LF> (not used here) */
+volatile bool	g_flgLEUART_LF2CRLF = true;
+
+/*!@brief Global flag to notify new command in g_CmdLine */
+volatile bool	g_flgCmdLine;
+
+/*!@brief Command line buffer */
+char	 g_CmdLine[CMD_LINE_SIZE];
+
+/*!@brief Number of bytes in g_CmdLine, without <LF> and EOS */
+volatile int	g_CmdLineLen;
+
+extern DMA_DESCRIPTOR_TypeDef g_DMA_ControlBlock[];
+
+/*================================ Local Data ================================*/
+
+    /*! Pending command lines, see SimConsoleInput() */
+static char	l_InputLine[8][CMD_LINE_SIZE];
+static unsigned int l_InputIdx;		//!< next entry for SimConsoleInput()
+static unsigned int l_InputRcv;		//!< lines received by the "LEUART"
+static unsigned int l_InputGet;		//!< next line to be fetched
+
+
+/***************************************************************************//**
+ *
+ * @brief	Pass a Command Line to the Firmware
+ *
+ * This routine is executed in interrupt context, see SimConsoleInput().
+ *
+ ******************************************************************************/
+static void	ConsoleRxIrq (uintptr_t arg)
+{
+    (void) arg;
+
+    l_InputRcv++;
+    g_flgCmdLine = true;
+    EVENT_POST(EVT_COMMAND);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Inject a Command Line
+ *
+ * @param[in] pLine
+ *	Command line without \<LF>.
+ *
+ ******************************************************************************/
+void	SimConsoleInput (const char *pLine)
+{
+char	*pBuf = l_InputLine[l_InputIdx++ % 8];
+
+    strncpy (pBuf, pLine, CMD_LINE_SIZE - 1);
+    pBuf[CMD_LINE_SIZE - 1] = EOS;
+
+    if (g_SimVerbose)
+	SimTrace ("CONSOLE < %s", pBuf);
+
+    SimIrqPost (ConsoleRxIrq, (uintptr_t)pBuf);
+}
+
+
+/*=============================================================================
+ *============================= Driver API ====================================
+ *===========================================================================*/
+
+void	drvLEUART_Init (uint32_t baud)
+{
+static DMA_Init_TypeDef dmaInit =
+{
+    .hprot        = 0,
+    .controlBlock = g_DMA_ControlBlock,
+};
+
+    (void) baud;
+
+    DMA_Init (&dmaInit);
+}
+
+void	drvLEUART_puts (const char *pStr)
+{
+    g_SimCnt.ConsoleBytes += strlen (pStr);
+    fputs (pStr, stdout);
+}
+
+void	drvLEUART_putsWait (const char *pStr)
+{
+    drvLEUART_puts (pStr);
+}
+
+bool	drvLEUART_write (const uint8_t *pBuf, int cnt)
+{
+    g_SimCnt.ConsoleBytes += cnt;
+    fwrite (pBuf, 1, cnt, stdout);
+    return true;
+}
+
+void	drvLEUART_putc (char c)
+{
+    g_SimCnt.ConsoleBytes++;
+    putchar (c);
+}
+
+void	drvLEUART_sync (void)
+{
+    fflush (stdout);
+}
+
+void	drvLEUART_HighSpeed (bool flgEnable)
+{
+    if (flgEnable)
+	EM1_Acquire (EM1_MOD_CONSOLE);
+    else
+	EM1_Release (EM1_MOD_CONSOLE);
+}
+
+void	drvLEUART_SpeedCheck (void)
+{
+}
+
+int	drvLEUART_free (void)
+{
+    return 1024;
+}
+
+uint32_t drvLEUART_dropCount (void)
+{
+    return 0;
+}
+
+bool	drvLEUART_CmdLineGet (void)
+{
+const char *pLine;
+int	len;
+
+    if (l_InputGet == l_InputRcv)
+	return false;
+
+    pLine = l_InputLine[l_InputGet++ % 8];
+    len = strlen (pLine);
+    memcpy (g_CmdLine, pLine, len + 1);
+    g_CmdLineLen = len;
+
+    /* Check for further lines */
+    if (l_InputGet != l_InputRcv)
+    {
+	g_flgCmdLine = true;
+	EVENT_POST(EVT_COMMAND);
+    }
+    return true;
+}
@@ -0,0 +1,358 @@
+/***************************************************************************//**
+ * @file
+ * @brief	SD-Card Image of the Host Simulation
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module replaces "diskio.c" for the host build.  The sectors of the
+ * SD-Card are stored in an image file, so the card is not emulated on SPI
+ * level.  The routines of "microsd.c" which access the card directly, e.g.
+ * MICROSD_SpiClkTune(), see a card that never responds, which is harmless.
+ * disk_initialize() powers the socket on like the original, so the power
+ * state and the boost of the HF clock governor match the target.
+ *
+ * SimDiskOpen() may create a new image with an empty FAT16 file system, and
+ * SimDiskImport() copies files of the host into its root directory, e.g. the
+ * configuration file and the sound files.  The card detect signal is
+ * controlled by SimDiskInsert().
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+2026-10-14,agnt	The statistics are kept in g_SimCnt, see sim_bench.c.
+2026-10-15,agnt	disk_initialize() calls MICROSD_PowerOn(), see HF_CLOCK_GOVERNOR.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "em_device.h"
+#include "em_gpio.h"
+#include "microsd.h"
+#include "diskio.h"
+#include "ff.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Geometry of a new image, see DiskFormat() */
+#define IMG_SECTOR_SIZE		512
+#define IMG_SECTOR_CNT		131072		//!< 64MB
+#define IMG_SECT_PER_CLUS	4
+#define IMG_FAT_SIZE		128		//!< sectors per FAT
+#define IMG_ROOT_ENTRIES	512
+
+/*================================ Local Data ================================*/
+
+static int	l_fdImage = -1;		//!< file descriptor of the image
+static DWORD	l_SectorCnt;		//!< size of the image in sectors
+static bool	l_flgInserted;		//!< card is inserted
+static bool	l_flgImport;		//!< SimDiskImport() is running
+static DSTATUS	l_Stat = STA_NOINIT;	//!< disk status
+
+
+/***************************************************************************//**
+ *
+ * @brief	Create an empty FAT16 File System
+ *
+ ******************************************************************************/
+static bool DiskFormat (void)
+{
+static const uint8_t bootHdr[] =
+{
+    0xEB, 0x3C, 0x90, 'M', 'S', 'D', 'O', 'S', '5', '.', '0',
+    (uint8_t)IMG_SECTOR_SIZE, IMG_SECTOR_SIZE >> 8,	// BPB_BytsPerSec
+    IMG_SECT_PER_CLUS,					// BPB_SecPerClus
+    1, 0,						// BPB_RsvdSecCnt
+    2,							// BPB_NumFATs
+    (uint8_t)IMG_ROOT_ENTRIES, IMG_ROOT_ENTRIES >> 8,	// BPB_RootEntCnt
+    0, 0,						// BPB_TotSec16
+    0xF8,						// BPB_Media
+    (uint8_t)IMG_FAT_SIZE, IMG_FAT_SIZE >> 8,		// BPB_FATSz16
+    63, 0, 255, 0,					// SecPerTrk, NumHeads
+    0, 0, 0, 0,						// BPB_HiddSec
+    (uint8_t)IMG_SECTOR_CNT, (uint8_t)(IMG_SECTOR_CNT >> 8),
+    (uint8_t)(IMG_SECTOR_CNT >> 16), (uint8_t)(IMG_SECTOR_CNT >> 24),
+    0x80, 0, 0x29,					// DrvNum, BootSig
+    0x14, 0x10, 0x26, 0x20,				// BS_VolID
+    'N', 'O', ' ', 'N', 'A', 'M', 'E', ' ', ' ', ' ', ' ',
+    'F', 'A', 'T', '1', '6', ' ', ' ', ' ',
+};
+uint8_t	sector[IMG_SECTOR_SIZE];
+int	i;
+
+    if (ftruncate (l_fdImage, 0) != 0
+    ||  ftruncate (l_fdImage, (off_t)IMG_SECTOR_CNT * IMG_SECTOR_SIZE) != 0)
+	return false;
+
+    /* Boot sector */
+    memset (sector, 0, sizeof(sector));
+    memcpy (sector, bootHdr, sizeof(bootHdr));
+    sector[510] = 0x55;
+    sector[511] = 0xAA;
+    if (pwrite (l_fdImage, sector, IMG_SECTOR_SIZE, 0) != IMG_SECTOR_SIZE)
+	return false;
+
+    /* First sector of both FATs, the rest remains zero */
+    memset (sector, 0, sizeof(sector));
+    sector[0] = 0xF8;
+    sector[1] = sector[2] = sector[3] = 0xFF;
+    for (i = 0;  i < 2;  i++)
+	if (pwrite (l_fdImage, sector, IMG_SECTOR_SIZE,
+		    (off_t)(1 + i * IMG_FAT_SIZE) * IMG_SECTOR_SIZE)
+	    != IMG_SECTOR_SIZE)
+	    return false;
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Open the Image File
+ *
+ * @param[in] pImage
+ *	File name of the image.
+ *
+ * @param[in] flgFormat
+ *	If true, the image is (re-)created with an empty FAT16 file system.
+ *
+ * @return
+ *	true if the image could be opened.
+ *
+ ******************************************************************************/
+bool	SimDiskOpen (const char *pImage, bool flgFormat)
+{
+off_t	size;
+
+    l_fdImage = open (pImage, O_RDWR | (flgFormat ? O_CREAT : 0), 0644);
+    if (l_fdImage < 0)
+    {
+	perror (pImage);
+	return false;
+    }
+
+    if (flgFormat  &&  ! DiskFormat())
+    {
+	perror (pImage);
+	return false;
+    }
+
+    size = lseek (l_fdImage, 0, SEEK_END);
+    l_SectorCnt = (DWORD)(size / IMG_SECTOR_SIZE);
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Import a Host File into the Root Directory
+ *
+ * The file name must be a valid 8.3 name, since the firmware does not use
+ * long file names.  This routine must be called before the firmware starts.
+ *
+ * @param[in] pHostFile
+ *	Path of the file on the host.
+ *
+ * @return
+ *	true if the file could be copied.
+ *
+ ******************************************************************************/
+bool	SimDiskImport (const char *pHostFile)
+{
+static FATFS fs;
+FIL	fil;
+FILE	*fp;
+const char *pName;
+char	name[16];
+uint8_t	buf[4096];
+size_t	cnt;
+UINT	written;
+int	i;
+FRESULT	res;
+
+    pName = strrchr (pHostFile, '/');
+    pName = pName ? pName + 1 : pHostFile;
+    for (i = 0;  pName[i]  &&  i < (int)sizeof(name) - 1;  i++)
+	name[i] = toupper ((unsigned char)pName[i]);
+    name[i] = '\0';
+
+    fp = fopen (pHostFile, "rb");
+    if (fp == NULL)
+    {
+	perror (pHostFile);
+	return false;
+    }
+
+    l_flgInserted = true;
+    l_flgImport = true;
+    f_mount (0, &fs);
+    res = f_open (&fil, name, FA_CREATE_ALWAYS | FA_WRITE);
+    if (res == FR_OK)
+    {
+	while ((cnt = fread (buf, 1, sizeof(buf), fp)) > 0)
+	{
+	    res = f_write (&fil, buf, (UINT)cnt, &written);
+	    if (res != FR_OK  ||  written != cnt)
+		break;
+	}
+	if (f_close (&fil) != FR_OK  &&  res == FR_OK)
+	    res = FR_DISK_ERR;
+    }
+    f_mount (0, NULL);
+    l_flgImport = false;
+    fclose (fp);
+
+    if (res != FR_OK)
+    {
+	fprintf (stderr, "%s: cannot import as %s, error %d\n",
+		 pHostFile, name, res);
+	return false;
+    }
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Insert or remove the Card
+ *
+ * This routine sets the card detect signal, which is low while a card is
+ * present, and generates the interrupt for the firmware.
+ *
+ ******************************************************************************/
+void	SimDiskInsert (bool flgInserted)
+{
+    l_flgInserted = flgInserted  &&  l_fdImage >= 0;
+    if (! l_flgInserted)
+	l_Stat = STA_NOINIT;
+
+    SimPinSet (MICROSD_SPI_GPIO_PORT, MICROSD_CD_PIN, ! l_flgInserted);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Show the Statistics of the Image
+ *
+ ******************************************************************************/
+void	SimDiskStats (void)
+{
+    printf ("## disk: %u sectors read, %u written, %u syncs\n",
+	    (unsigned)g_SimCnt.SectorRd, (unsigned)g_SimCnt.SectorWr,
+	    (unsigned)g_SimCnt.Syncs);
+}
+
+
+/*=============================================================================
+ *=========================== FatFs Disk API ==================================
+ *===========================================================================*/
+
+DSTATUS disk_initialize (BYTE drv)
+{
+    if (drv)
+	return STA_NOINIT;		// supports only single drive
+
+    if (! l_flgInserted)
+	return STA_NODISK | STA_NOINIT;
+
+    /* Force socket power on, as "diskio.c" does, but not for the host */
+    if (! l_flgImport)
+	MICROSD_PowerOn();
+
+    l_Stat = 0;
+    return l_Stat;
+}
+
+DSTATUS disk_status (BYTE drv)
+{
+    if (drv)
+	return STA_NOINIT;
+
+    return l_flgInserted ? l_Stat : STA_NODISK | STA_NOINIT;
+}
+
+DRESULT disk_read (BYTE drv, BYTE *buff, DWORD sector, BYTE count)
+{
+size_t	len = (size_t)count * IMG_SECTOR_SIZE;
+
+    if (drv  ||  ! count)
+	return RES_PARERR;
+    if (disk_status (drv) & STA_NOINIT)
+	return RES_NOTRDY;
+    if (sector + count > l_SectorCnt)
+	return RES_PARERR;
+
+    if (pread (l_fdImage, buff, len, (off_t)sector * IMG_SECTOR_SIZE)
+	!= (ssize_t)len)
+	return RES_ERROR;
+
+    g_SimCnt.SectorRd += count;
+    return RES_OK;
+}
+
+DRESULT disk_write (BYTE drv, const BYTE *buff, DWORD sector, BYTE count)
+{
+size_t	len = (size_t)count * IMG_SECTOR_SIZE;
+
+    if (drv  ||  ! count)
+	return RES_PARERR;
+    if (disk_status (drv) & STA_NOINIT)
+	return RES_NOTRDY;
+    if (sector + count > l_SectorCnt)
+	return RES_PARERR;
+
+    if (pwrite (l_fdImage, buff, len, (off_t)sector * IMG_SECTOR_SIZE)
+	!= (ssize_t)len)
+	return RES_ERROR;
+
+    g_SimCnt.SectorWr += count;
+    return RES_OK;
+}
+
+DRESULT disk_ioctl (BYTE drv, BYTE ctrl, void *buff)
+{
+    if (drv)
+	return RES_PARERR;
+
+    if (ctrl == CTRL_INVALIDATE)
+    {
+	l_Stat = STA_NOINIT;
+	return RES_OK;
+    }
+
+    if (disk_status (drv) & STA_NOINIT)
+	return RES_NOTRDY;
+
+    switch (ctrl)
+    {
+	case CTRL_SYNC:
+	    g_SimCnt.Syncs++;
+	    return RES_OK;
+
+	case GET_SECTOR_COUNT:
+	    *(DWORD *)buff = l_SectorCnt;
+	    return RES_OK;
+
+	case GET_SECTOR_SIZE:
+	    *(WORD *)buff = IMG_SECTOR_SIZE;
+	    return RES_OK;
+
+	case GET_BLOCK_SIZE:
+	    *(DWORD *)buff = 1;
+	    return RES_OK;
+
+	default:
+	    return RES_PARERR;
+    }
+}
+
+void disk_cache_stat (DISK_CACHE_STAT *pStat, int reset)
+{
+    (void) reset;
+
+    memset (pStat, 0, sizeof(*pStat));
+}
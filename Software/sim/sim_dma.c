@@ -0,0 +1,432 @@
+/***************************************************************************//**
+ * @file
+ * @brief	DMA Controller of the Host Simulation
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module replaces "em_dma.c" for the host build.  The API routines work
+ * on the same descriptors in @ref g_DMA_ControlBlock as the original ones, so
+ * the firmware may still read the remaining transfer count from a descriptor,
+ * like RFID_RxGap() does.  The channel enable bits are kept locally, because
+ * CHENS and CHENC are set and clear registers, see SimDmaSync().
+ *
+ * The transfers are executed element by element:
+ * - Channels @ref DMA_CHAN_RFID_RX and @ref DMA_CHAN_RFID2_RX receive a
+ *   halfword whenever the script delivers a byte of the respective RFID
+ *   reader, see SimDmaRequest().
+ * - All other channels complete at once, i.e. a peripheral is always ready,
+ *   provided that DMA_CfgChannel() has selected a peripheral for them.
+ *   The bytes written to USART0->TXDATA are passed to SimAudioTx().
+ *
+ * When a cycle is done, the interrupt flag of the channel is set, and
+ * SimDmaIrq() calls the callback like the original DMA_IRQHandler(),
+ * including the toggle of the primary/alternate indicator.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+2026-10-15,agnt	Channel DMA_CHAN_RFID2_RX of the second RFID reader.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <string.h>
+#include "em_device.h"
+#include "em_dma.h"
+#include "config.h"
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Extract a field of the descriptor's CTRL word. */
+#define CTRL_FIELD(ctrl, name)	(((ctrl) & _DMA_CTRL_##name##_MASK)	\
+				 >> _DMA_CTRL_##name##_SHIFT)
+
+/*================================ Local Data ================================*/
+
+    /*! Enabled channels, i.e. the state of CHENS. */
+static uint32_t	l_ChEnabled;
+
+    /*! Channels which currently use the alternate descriptor. */
+static uint32_t	l_ChAlt;
+
+/*=========================== Forward Declarations ===========================*/
+
+static void	DMA_Prepare (unsigned int channel, DMA_CycleCtrl_TypeDef cycleCtrl,
+			     bool primary, void *dst, void *src,
+			     unsigned int nMinus1);
+static void	DmaSetEnd (DMA_DESCRIPTOR_TypeDef *pDescr, void *dst, void *src,
+			   unsigned int nMinus1);
+static bool	DmaElement (DMA_DESCRIPTOR_TypeDef *pDescr);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the active Descriptor of a Channel
+ *
+ ******************************************************************************/
+static DMA_DESCRIPTOR_TypeDef *DmaDescr (unsigned int channel, bool primary)
+{
+    return (DMA_DESCRIPTOR_TypeDef *)(uintptr_t)
+	   (primary ? DMA->CTRLBASE : DMA->ALTCTRLBASE) + channel;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Transfer one Element
+ *
+ * This routine transfers one element of the given descriptor, and updates
+ * its remaining count.  The last element invalidates the descriptor.
+ *
+ * @return
+ *	true if the descriptor is done.
+ *
+ ******************************************************************************/
+static bool DmaElement (DMA_DESCRIPTOR_TypeDef *pDescr)
+{
+uint32_t ctrl = pDescr->CTRL;
+uint32_t n    = CTRL_FIELD(ctrl, N_MINUS_1);
+uint32_t size = 1 << CTRL_FIELD(ctrl, SRC_SIZE);
+uint32_t inc;
+uint8_t *pSrc, *pDst;
+
+    inc  = CTRL_FIELD(ctrl, SRC_INC);
+    pSrc = (uint8_t *)pDescr->SRCEND;
+    if (inc != _DMA_CTRL_SRC_INC_NONE)
+	pSrc -= n << inc;
+
+    inc  = CTRL_FIELD(ctrl, DST_INC);
+    pDst = (uint8_t *)pDescr->DSTEND;
+    if (inc != _DMA_CTRL_DST_INC_NONE)
+	pDst -= n << inc;
+
+    memcpy (pDst, pSrc, size);
+
+    if (pDst == (uint8_t *)&USART0->TXDATA)
+	SimAudioTx (*pSrc);
+
+    if (n == 0)
+    {
+	pDescr->CTRL = ctrl & ~_DMA_CTRL_CYCLE_CTRL_MASK;
+	return true;
+    }
+
+    pDescr->CTRL = (ctrl & ~_DMA_CTRL_N_MINUS_1_MASK)
+		 | ((n - 1) << _DMA_CTRL_N_MINUS_1_SHIFT);
+    return false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Request a Transfer
+ *
+ * This routine is called when a peripheral requests the transfer of one
+ * element, e.g. the USART of the RFID reader has received a byte.
+ *
+ * @param[in] channel
+ *	DMA channel number.
+ *
+ * @return
+ *	true if the element has been transferred, false if the channel is not
+ *	enabled.
+ *
+ ******************************************************************************/
+bool	SimDmaRequest (unsigned int channel)
+{
+uint32_t bit = (1 << channel);
+DMA_DESCRIPTOR_TypeDef *pDescr;
+uint32_t cycleCtrl;
+
+    SimDmaSync();
+
+    if ((l_ChEnabled & bit) == 0)
+	return false;
+
+    pDescr = DmaDescr (channel, (l_ChAlt & bit) == 0);
+    cycleCtrl = CTRL_FIELD(pDescr->CTRL, CYCLE_CTRL);
+    if (cycleCtrl == _DMA_CTRL_CYCLE_CTRL_INVALID)
+    {
+	l_ChEnabled &= ~bit;		// nothing to do
+	return false;
+    }
+
+    if (DmaElement (pDescr))
+    {
+	/* Cycle is done */
+	SIM_REG(DMA->IF) |= bit;
+
+	if (cycleCtrl == _DMA_CTRL_CYCLE_CTRL_PINGPONG)
+	{
+	    /* Continue with the other descriptor, if it is valid */
+	    l_ChAlt ^= bit;
+	    pDescr = DmaDescr (channel, (l_ChAlt & bit) == 0);
+	    if (CTRL_FIELD(pDescr->CTRL, CYCLE_CTRL)
+		== _DMA_CTRL_CYCLE_CTRL_INVALID)
+		l_ChEnabled &= ~bit;
+	}
+	else
+	{
+	    l_ChEnabled &= ~bit;
+	}
+	DMA->CHENS = l_ChEnabled;
+
+	if (channel == DMA_CHAN_AUDIO_TX)
+	    SimAudioTxDone();
+    }
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Synchronize the DMA Registers
+ *
+ * This routine applies the writes to CHENC, IFS, and IFC, and executes the
+ * transfers of the channels which do not wait for a peripheral.  It is
+ * called from the API routines and from the simulated hardware, see
+ * SimRegSync().
+ *
+ ******************************************************************************/
+void	SimDmaSync (void)
+{
+static bool flgBusy;
+unsigned int channel;
+
+    if (DMA->CHENC)
+    {
+	l_ChEnabled &= ~DMA->CHENC;
+	DMA->CHENC = 0;
+    }
+    if (DMA->IFS)
+    {
+	SIM_REG(DMA->IF) |= DMA->IFS;
+	DMA->IFS = 0;
+    }
+    if (DMA->IFC)
+    {
+	SIM_REG(DMA->IF) &= ~DMA->IFC;
+	DMA->IFC = 0;
+    }
+    DMA->CHENS = l_ChEnabled;
+
+    if (flgBusy)
+	return;			// called via SimAudioTx()
+    flgBusy = true;
+
+    for (channel = 0;  channel < DMA_CHAN_COUNT;  channel++)
+    {
+	if (channel == DMA_CHAN_RFID_RX  ||  channel == DMA_CHAN_RFID2_RX)
+	    continue;		// waits for data from the RFID reader
+
+	if (DMA->CH[channel].CTRL == 0)
+	    continue;		// no peripheral selected, i.e. no DMA request
+
+	while (SimDmaRequest (channel))
+	    ;
+    }
+
+    flgBusy = false;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check for a pending DMA Interrupt
+ *
+ ******************************************************************************/
+bool	SimDmaPending (void)
+{
+    return (DMA->IF & DMA->IEN) != 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	DMA Interrupt Handler
+ *
+ * This is the DMA_IRQHandler() of emlib, without the bus error check.
+ *
+ ******************************************************************************/
+void	SimDmaIrq (void)
+{
+DMA_DESCRIPTOR_TypeDef *pDescr = DmaDescr (0, true);
+DMA_CB_TypeDef *cb;
+uint32_t pending = DMA->IF & DMA->IEN & ~DMA_IF_ERR;
+uint32_t primaryCpy;
+unsigned int channel;
+
+    for (channel = 0;  pending;  channel++, pending >>= 1)
+    {
+	if ((pending & 1) == 0)
+	    continue;
+
+	SIM_REG(DMA->IF) &= ~(1 << channel);
+
+	cb = (DMA_CB_TypeDef *)(uintptr_t)pDescr[channel].USER;
+	if (cb)
+	{
+	    primaryCpy   = cb->primary;
+	    cb->primary ^= 1;
+	    if (cb->cbFunc)
+		cb->cbFunc (channel, (bool)primaryCpy, cb->userPtr);
+	}
+    }
+}
+
+
+/*=============================================================================
+ *============================== emlib API ====================================
+ *===========================================================================*/
+
+void	DMA_Init (DMA_Init_TypeDef *init)
+{
+    l_ChEnabled = l_ChAlt = 0;
+    DMA->CTRLBASE    = (uint32_t)(uintptr_t)init->controlBlock;
+    SIM_REG(DMA->ALTCTRLBASE) = (uint32_t)(uintptr_t)
+		       ((DMA_DESCRIPTOR_TypeDef *)init->controlBlock
+			+ DMA_CHAN_COUNT);
+    DMA->IEN = DMA_IEN_ERR;
+    DMA->CONFIG = DMA_CONFIG_EN;
+}
+
+void	DMA_Reset (void)
+{
+    l_ChEnabled = l_ChAlt = 0;
+    DMA->CHENS = 0;
+    DMA->IEN = 0;
+    SIM_REG(DMA->IF) = 0;
+}
+
+void	DMA_CfgChannel (unsigned int channel, DMA_CfgChannel_TypeDef *cfg)
+{
+    DmaDescr (channel, true)->USER = (uint32_t)(uintptr_t)cfg->cb;
+    DMA->CH[channel].CTRL = cfg->select;
+
+    if (cfg->enableInt)
+    {
+	SIM_REG(DMA->IF) &= ~(1 << channel);
+	DMA->IEN |= (1 << channel);
+    }
+    else
+    {
+	DMA->IEN &= ~(1 << channel);
+    }
+}
+
+void	DMA_CfgDescr (unsigned int channel, bool primary,
+		      DMA_CfgDescr_TypeDef *cfg)
+{
+    DmaDescr (channel, primary)->CTRL =
+	  (cfg->dstInc << _DMA_CTRL_DST_INC_SHIFT)
+	| (cfg->size << _DMA_CTRL_DST_SIZE_SHIFT)
+	| (cfg->srcInc << _DMA_CTRL_SRC_INC_SHIFT)
+	| (cfg->size << _DMA_CTRL_SRC_SIZE_SHIFT)
+	| ((uint32_t)(cfg->hprot) << _DMA_CTRL_SRC_PROT_CTRL_SHIFT)
+	| (cfg->arbRate << _DMA_CTRL_R_POWER_SHIFT)
+	| DMA_CTRL_CYCLE_CTRL_INVALID;
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Set the End Addresses of a Descriptor
+ *
+ ******************************************************************************/
+static void DmaSetEnd (DMA_DESCRIPTOR_TypeDef *pDescr, void *dst, void *src,
+		       unsigned int nMinus1)
+{
+uint32_t inc;
+
+    if (src)
+    {
+	inc = CTRL_FIELD(pDescr->CTRL, SRC_INC);
+	pDescr->SRCEND = inc == _DMA_CTRL_SRC_INC_NONE ? src
+			 : (uint8_t *)src + (nMinus1 << inc);
+    }
+    if (dst)
+    {
+	inc = CTRL_FIELD(pDescr->CTRL, DST_INC);
+	pDescr->DSTEND = inc == _DMA_CTRL_DST_INC_NONE ? dst
+			 : (uint8_t *)dst + (nMinus1 << inc);
+    }
+}
+
+/***************************************************************************//**
+ *
+ * @brief	Prepare a Descriptor, see DMA_Prepare() of emlib
+ *
+ ******************************************************************************/
+static void DMA_Prepare (unsigned int channel, DMA_CycleCtrl_TypeDef cycleCtrl,
+			 bool primary, void *dst, void *src,
+			 unsigned int nMinus1)
+{
+DMA_DESCRIPTOR_TypeDef *pDescr = DmaDescr (channel, primary);
+DMA_CB_TypeDef *cb = (DMA_CB_TypeDef *)(uintptr_t)
+		     DmaDescr (channel, true)->USER;
+
+    if (cb)
+	cb->primary = (uint8_t)primary;
+
+    DmaSetEnd (pDescr, dst, src, nMinus1);
+
+    if (primary)
+	l_ChAlt &= ~(1 << channel);
+    else
+	l_ChAlt |= (1 << channel);
+
+    pDescr->CTRL = (pDescr->CTRL & ~(_DMA_CTRL_CYCLE_CTRL_MASK
+				     | _DMA_CTRL_N_MINUS_1_MASK))
+		 | (nMinus1 << _DMA_CTRL_N_MINUS_1_SHIFT)
+		 | ((uint32_t)cycleCtrl << _DMA_CTRL_CYCLE_CTRL_SHIFT);
+}
+
+void	DMA_ActivateBasic (unsigned int channel, bool primary, bool useBurst,
+			   void *dst, void *src, unsigned int nMinus1)
+{
+    (void) useBurst;
+
+    SimDmaSync();
+    DMA_Prepare (channel, dmaCycleCtrlBasic, primary, dst, src, nMinus1);
+    l_ChEnabled |= (1 << channel);
+    DMA->CHENS = l_ChEnabled;
+}
+
+void	DMA_ActivatePingPong (unsigned int channel, bool useBurst,
+			      void *primDst, void *primSrc,
+			      unsigned int primNMinus1,
+			      void *altDst, void *altSrc,
+			      unsigned int altNMinus1)
+{
+    (void) useBurst;
+
+    SimDmaSync();
+    DMA_Prepare (channel, dmaCycleCtrlPingPong, false,
+		 altDst, altSrc, altNMinus1);
+    DMA_Prepare (channel, dmaCycleCtrlPingPong, true,
+		 primDst, primSrc, primNMinus1);
+    l_ChEnabled |= (1 << channel);
+    DMA->CHENS = l_ChEnabled;
+}
+
+void	DMA_RefreshPingPong (unsigned int channel, bool primary, bool useBurst,
+			     void *dst, void *src, unsigned int nMinus1,
+			     bool stop)
+{
+DMA_DESCRIPTOR_TypeDef *pDescr = DmaDescr (channel, primary);
+uint32_t cycleCtrl = stop ? dmaCycleCtrlBasic : dmaCycleCtrlPingPong;
+
+    (void) useBurst;
+
+    DmaSetEnd (pDescr, dst, src, nMinus1);
+    pDescr->CTRL = (pDescr->CTRL & ~(_DMA_CTRL_CYCLE_CTRL_MASK
+				     | _DMA_CTRL_N_MINUS_1_MASK))
+		 | (nMinus1 << _DMA_CTRL_N_MINUS_1_SHIFT)
+		 | (cycleCtrl << _DMA_CTRL_CYCLE_CTRL_SHIFT);
+}
+
+bool	DMA_ChannelEnabled (unsigned int channel)
+{
+    SimDmaSync();
+    return (l_ChEnabled >> channel) & 1;
+}
@@ -0,0 +1,485 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Fuzzer of the Parsers in the Host Simulation
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module feeds the parsers of untrusted input with malformed data, see
+ * options <b>-z</b> and <b>-y</b> of the simulation.  These are the frame
+ * decoders of the RFID readers (RFID_Decode() in "RFID.c"), the frame
+ * assembler of the Audio module (USART0_RX_IRQHandler() and
+ * AudioFrameHandler() in "Audio.c"), and the configuration parser
+ * (CfgParse() in "CfgData.c").  All inputs are derived from a pseudo random
+ * generator, so a run is reproduced by its seed.
+ *
+ * SimFuzzLoad() adds the events to the script, see SimScriptAdd().  The time
+ * is set to 08:29:50 and the Audio module reports its SD-Card, like in
+ * "example.sim", so the power schedule of CONFIG.TXT switches the devices
+ * on.  Then each round passes light barrier 1, and sends some frames of the
+ * RFID readers and the Audio module.  Each frame is either valid, mutated
+ * by random bytes, truncated, or replaced by garbage.  A malformed frame is
+ * followed by a valid one, which the decoder must accept again.
+ *
+ * SimFuzzConfig() writes a mutated copy of the configuration file, which is
+ * imported into the SD-Card image instead of the original.  Lines are
+ * changed, truncated, duplicated, or made longer than the line buffer.  This
+ * is a separate run, since an invalid configuration may switch the devices
+ * off, which the frames of SimFuzzLoad() require.
+ *
+ * Together with the benchmark, i.e. option <b>-b</b>, the throughput and the
+ * worst case cycles per input byte of each parser are reported, see
+ * SimBenchParser().  A parser that crashes or hangs stops the simulation.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include "config.h"
+#include "CfgData.h"
+#include "ScratchPool.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Default number of rounds */
+#define FUZZ_DFLT_ROUNDS	100
+
+    /*! Start of the first round, after the devices have been switched on */
+#define FUZZ_START_TIME		SIM_MS2TICKS(60000)
+
+    /*! Time until the simulation ends after the last round */
+#define FUZZ_TAIL_TIME		SIM_MS2TICKS(10000)
+
+    /*! Maximum number of frames per round */
+#define FUZZ_FRAMES_MAX		4
+
+    /*! Maximum length of a frame, and of a garbage burst */
+#define FUZZ_FRAME_MAX		32
+
+    /*! One of this many lines of the configuration file is mutated */
+#define FUZZ_CFG_RATE		8
+
+    /*! Maximum length of a line of the configuration file */
+#define FUZZ_LINE_MAX		512
+
+    /*! Length of the lines which exceed the line buffer of the firmware */
+#define FUZZ_LINE_LONG		(SCRATCH_BLOCK_SIZE + 40)
+
+    /*! Template of the directory for the mutated configuration file */
+#define FUZZ_DIR_TEMPLATE	"/tmp/sim_fuzzXXXXXX"
+
+    /*! Name of the fuzzer for the script messages */
+#define FUZZ_SOURCE		"fuzz"
+
+    /*! Opcodes of the Audio module, see "Audio.c" */
+#define AUDIO_OP_WORK_STATUS	0xC2
+#define AUDIO_OP_FILE_NUMBERS	0xC5
+#define AUDIO_OP_DEVICE_STATUS	0xCA
+#define AUDIO_OP_SPACE_LEFT	0xCE
+
+/*================================ Local Data ================================*/
+
+    /*! State of the pseudo random generator, see FuzzRand() */
+static uint32_t	l_Rand;
+
+    /*! Opcodes of the frames sent by the Audio module */
+static const uint8_t l_AudioOp[] =
+{ AUDIO_OP_WORK_STATUS, AUDIO_OP_FILE_NUMBERS, AUDIO_OP_DEVICE_STATUS,
+  AUDIO_OP_SPACE_LEFT };
+
+    /*! Values which hit the limits of the integer parser */
+static const char *l_Extreme[] =
+{ "0", "-1", "2147483647", "2147483648", "-2147483649", "4294967296",
+  "99999999999999999999", "0x7FFFFFFF", "1e9", "--1", "+" };
+
+    /*! Characters which have a meaning for the configuration parser */
+static const char l_CfgChars[] = "=,-:*#[] \t\"";
+
+/*=========================== Forward Declarations ===========================*/
+
+static uint32_t	FuzzRand (void);
+static int	FuzzMutate (uint8_t *pFrame, int len);
+static int	FuzzRFID (uint8_t *pFrame, TRANSPONDER_ID id);
+static int	FuzzAudio (uint8_t *pFrame);
+static void	FuzzAdd (uint64_t time, const char *pCmd, const uint8_t *pData,
+			 int cnt);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Load the Events of the Fuzzer
+ *
+ * This routine adds the events of all rounds to the script.
+ *
+ * @param[in] pSpec
+ *	Seed and optional number of rounds, i.e. "seed[:rounds]".
+ *
+ * @return
+ *	true if the specification is valid.
+ *
+ ******************************************************************************/
+bool	SimFuzzLoad (const char *pSpec)
+{
+uint8_t	 frame[FUZZ_FRAME_MAX + 8];
+char	*pEnd;
+const char *pCmd;
+unsigned long seed, rounds = FUZZ_DFLT_ROUNDS;
+uint64_t time = FUZZ_START_TIME, t;
+TRANSPONDER_ID id;
+int	 round, i, n, len, badCnt = 0;
+bool	 flgBad;
+
+    seed = strtoul (pSpec, &pEnd, 0);
+    if (*pEnd == ':')
+	rounds = strtoul (pEnd + 1, &pEnd, 0);
+    if (*pEnd != '\0'  ||  rounds == 0)
+    {
+	fprintf (stderr, "%s: invalid fuzzer specification\n", pSpec);
+	return false;
+    }
+
+    l_Rand = seed ? (uint32_t)seed : 1;	// the state must not be 0
+
+    /* Clock, answers, and SD-Card of the Audio module, see "example.sim" */
+    SimScriptAdd (0, FUZZ_SOURCE, 0, "time 2026-10-14 08:29:50");
+    SimScriptAdd (0, FUZZ_SOURCE, 0, "reply-op C2 = 7E 04 C2 02 C8 7E");
+    SimScriptAdd (0, FUZZ_SOURCE, 0, "reply-op CE = 7E 05 CE 07 A0 7A 7E");
+    SimScriptAdd (0, FUZZ_SOURCE, 0, "reply-op C5 = 7E 05 C5 00 0A D4 7E");
+    SimScriptAdd (0, FUZZ_SOURCE, 0, "reply-op * = 00");
+    SimScriptAdd (SIM_MS2TICKS(11000), FUZZ_SOURCE, 0,
+		  "audio 7E 04 CA 01 CF 7E");
+
+    for (round = 0;  round < (int)rounds;  round++)
+    {
+	SimScriptAdd (time, FUZZ_SOURCE, round, "lb 1 on");
+	t = time + SIM_MS2TICKS(200);
+
+	n = 1 + FuzzRand() % FUZZ_FRAMES_MAX;
+	for (i = 0;  i < n;  i++, t += SIM_MS2TICKS(30 + FuzzRand() % 100))
+	{
+	    id = ((TRANSPONDER_ID)FuzzRand() << 32) | FuzzRand();
+	    flgBad = (FuzzRand() % 4 != 0);
+
+	    switch (FuzzRand() % 3)
+	    {
+		case 0:		// one of the RFID readers
+		    pCmd = (RFID_READERS > 1  &&  (FuzzRand() & 1)
+			    ? "rfid2" : "rfid");
+		    len = FuzzRFID (frame, id);
+		    if (flgBad)
+			len = FuzzMutate (frame, len);
+		    FuzzAdd (t, pCmd, frame, len);
+		    if (flgBad)		// the decoder must resynchronize
+		    {
+			t += SIM_MS2TICKS(30);
+			FuzzAdd (t, pCmd, frame, FuzzRFID (frame, id));
+		    }
+		    break;
+
+		default:	// Audio module
+		    len = FuzzAudio (frame);
+		    if (flgBad)
+			len = FuzzMutate (frame, len);
+		    FuzzAdd (t, "audio", frame, len);
+		    if (flgBad)		// the assembler must resynchronize
+		    {
+			t += SIM_MS2TICKS(30);
+			FuzzAdd (t, "audio", frame, FuzzAudio (frame));
+		    }
+		    break;
+	    }
+	    if (flgBad)
+		badCnt++;
+	}
+
+	SimScriptAdd (time + SIM_MS2TICKS(3000), FUZZ_SOURCE, round,
+		      "lb 1 off");
+	time += SIM_MS2TICKS(5000 + FuzzRand() % 15000);
+    }
+
+    SimScriptAdd (time + FUZZ_TAIL_TIME, FUZZ_SOURCE, round, "quit");
+
+    if (g_SimVerbose)
+	printf ("## fuzz: seed %u, %d rounds, %d malformed frames\n",
+		(unsigned)seed, round, badCnt);
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Mutate the Configuration File
+ *
+ * This routine writes a mutated copy of the configuration file into a new
+ * temporary directory.  Other files are not changed.
+ *
+ * @param[in] pHostFile
+ *	Name of the file on the host.
+ *
+ * @param[in] pSeed
+ *	Seed of the pseudo random generator as string.
+ *
+ * @return
+ *	Name of the copy, @p pHostFile if it is not the configuration file, or
+ *	NULL on error.
+ *
+ ******************************************************************************/
+const char *SimFuzzConfig (const char *pHostFile, const char *pSeed)
+{
+static char dir[] = FUZZ_DIR_TEMPLATE;
+static char path[sizeof(dir) + sizeof(CONFIG_FILE_NAME) + 1];
+const char *pName;
+FILE	*fpIn, *fpOut;
+char	 line[FUZZ_LINE_MAX + FUZZ_LINE_LONG];
+int	 len, pos, lineNum = 0, mutCnt = 0;
+
+    pName = strrchr (pHostFile, '/');
+    pName = (pName ? pName + 1 : pHostFile);
+    if (strcasecmp (pName, CONFIG_FILE_NAME) != 0)
+	return pHostFile;
+
+    l_Rand = (uint32_t)strtoul (pSeed, NULL, 0);
+    if (l_Rand == 0)
+	l_Rand = 1;			// the state must not be 0
+
+    fpIn = fopen (pHostFile, "r");
+    if (fpIn == NULL)
+    {
+	perror (pHostFile);
+	return NULL;
+    }
+
+    if (mkdtemp (dir) == NULL)
+    {
+	perror (dir);
+	fclose (fpIn);
+	return NULL;
+    }
+    snprintf (path, sizeof(path), "%s/%s", dir, CONFIG_FILE_NAME);
+
+    fpOut = fopen (path, "w");
+    if (fpOut == NULL)
+    {
+	perror (path);
+	fclose (fpIn);
+	return NULL;
+    }
+
+    while (fgets (line, FUZZ_LINE_MAX, fpIn))
+    {
+	lineNum++;
+	len = strcspn (line, "\r\n");
+	line[len] = '\0';
+
+	if (FuzzRand() % FUZZ_CFG_RATE == 0)
+	{
+	    pos = (len ? FuzzRand() % len : 0);
+	    mutCnt++;
+
+	    switch (FuzzRand() % 6)
+	    {
+		case 0:		// random byte, but no line end
+		    if (len)
+			line[pos] = (char)(1 + FuzzRand() % 255);
+		    if (line[pos] == '\n'  ||  line[pos] == '\r')
+			line[pos] = ' ';
+		    break;
+
+		case 1:		// truncated line
+		    line[pos] = '\0';
+		    break;
+
+		case 2:		// duplicated line
+		    fprintf (fpOut, "%s\r\n", line);
+		    break;
+
+		case 3:		// value at the limits of the integer parser
+		    snprintf (line + pos, FUZZ_LINE_MAX - pos, "%s",
+			      l_Extreme[FuzzRand() % ELEM_CNT(l_Extreme)]);
+		    break;
+
+		case 4:		// special character of the syntax
+		    line[pos] = l_CfgChars[FuzzRand() % (sizeof(l_CfgChars)-1)];
+		    break;
+
+		default:	// line longer than the line buffer
+		    memset (line + len, 'A', FUZZ_LINE_LONG);
+		    line[len + FUZZ_LINE_LONG] = '\0';
+		    break;
+	    }
+	}
+	fprintf (fpOut, "%s\r\n", line);
+    }
+
+    fclose (fpIn);
+    fclose (fpOut);
+
+    if (g_SimVerbose)
+	printf ("## fuzz: %d of %d lines of %s mutated into %s\n",
+		mutCnt, lineNum, pHostFile, path);
+
+    return path;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Pseudo Random Number
+ *
+ * This is the xorshift generator of Marsaglia, the sequence only depends on
+ * the seed, see SimFuzzLoad().
+ *
+ ******************************************************************************/
+static uint32_t	FuzzRand (void)
+{
+    l_Rand ^= l_Rand << 13;
+    l_Rand ^= l_Rand >> 17;
+    l_Rand ^= l_Rand << 5;
+    return l_Rand;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Make a Frame malformed
+ *
+ * The frame is either changed in some random bytes, truncated, extended by
+ * random bytes, or replaced by a burst of garbage.
+ *
+ * @param[in,out] pFrame
+ *	Frame to be changed, the buffer must hold FUZZ_FRAME_MAX bytes.
+ *
+ * @param[in] len
+ *	Length of the valid frame.
+ *
+ * @return
+ *	Length of the malformed frame, at least 1.
+ *
+ ******************************************************************************/
+static int	FuzzMutate (uint8_t *pFrame, int len)
+{
+int	i, n;
+
+    switch (FuzzRand() % 4)
+    {
+	case 0:		// random bytes
+	    n = 1 + FuzzRand() % 3;
+	    for (i = 0;  i < n;  i++)
+		pFrame[FuzzRand() % len] = (uint8_t)FuzzRand();
+	    break;
+
+	case 1:		// truncated
+	    len = 1 + FuzzRand() % len;
+	    break;
+
+	case 2:		// extended
+	    n = FuzzRand() % (FUZZ_FRAME_MAX - len + 1);
+	    for (i = 0;  i < n;  i++)
+		pFrame[len++] = (uint8_t)FuzzRand();
+	    break;
+
+	default:	// garbage
+	    len = 1 + FuzzRand() % FUZZ_FRAME_MAX;
+	    for (i = 0;  i < len;  i++)
+		pFrame[i] = (uint8_t)FuzzRand();
+	    break;
+    }
+
+    return len;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Build a Frame of the SR RFID Reader
+ *
+ * The frame consists of a fixed prefix, the 8 bytes of the transponder ID
+ * with the least significant byte first, and the XOR of all bytes, see
+ * AddRFID() in sim_replay.c.
+ *
+ * @return
+ *	Length of the frame.
+ *
+ ******************************************************************************/
+static int	FuzzRFID (uint8_t *pFrame, TRANSPONDER_ID id)
+{
+static const uint8_t prefix[5] = { 0x0E, 0x00, 0x11, 0x00, 0x05 };
+int	i;
+
+    memcpy (pFrame, prefix, sizeof(prefix));
+    for (i = 0;  i < 8;  i++)
+	pFrame[5 + i] = (uint8_t)(id >> (8 * i));
+
+    pFrame[13] = 0;
+    for (i = 0;  i < 13;  i++)
+	pFrame[13] ^= pFrame[i];
+
+    return 14;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Build a Frame of the Audio Module
+ *
+ * The frame is either an acknowledge, or a framed answer with a random
+ * opcode of @ref l_AudioOp and random parameters, see AddFrame() in
+ * sim_replay.c.
+ *
+ * @return
+ *	Length of the frame.
+ *
+ ******************************************************************************/
+static int	FuzzAudio (uint8_t *pFrame)
+{
+int	cnt, i;
+uint8_t	csum;
+
+    if (FuzzRand() % 4 == 0)
+    {
+	pFrame[0] = 0x00;		// acknowledge
+	return 1;
+    }
+
+    cnt = 1 + FuzzRand() % 2;		// number of parameters
+    pFrame[0] = 0x7E;
+    pFrame[1] = (uint8_t)(cnt + 3);	// length, opcode, parameters, checksum
+    pFrame[2] = l_AudioOp[FuzzRand() % ELEM_CNT(l_AudioOp)];
+    csum = pFrame[1] + pFrame[2];
+    for (i = 0;  i < cnt;  i++)
+    {
+	pFrame[3 + i] = (uint8_t)FuzzRand();
+	csum += pFrame[3 + i];
+    }
+    pFrame[3 + cnt] = csum;
+    pFrame[4 + cnt] = 0x7E;
+
+    return cnt + 5;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add an Event with the Bytes of a Serial Line
+ *
+ ******************************************************************************/
+static void	FuzzAdd (uint64_t time, const char *pCmd, const uint8_t *pData,
+			 int cnt)
+{
+char	buf[16 + 3 * (FUZZ_FRAME_MAX + 8)];
+int	n, i;
+
+    n = snprintf (buf, sizeof(buf), "%s", pCmd);
+    for (i = 0;  i < cnt;  i++)
+	n += snprintf (buf + n, sizeof(buf) - n, " %02X", pData[i]);
+
+    SimScriptAdd (time, FUZZ_SOURCE, 0, buf);
+}
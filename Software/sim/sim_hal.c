@@ -0,0 +1,1067 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Hardware Abstraction of the Host Simulation
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module provides the simulated hardware for the firmware modules, when
+ * they are built for the host, see sim/Makefile:
+ * - The register blocks of all peripherals, see "include/em_device.h".  Most
+ *   registers are plain memory, only the interrupt flags (IFS/IFC) and the
+ *   GPIO output registers (DOUTSET/DOUTCLR/DOUTTGL) are evaluated by
+ *   SimRegSync().
+ * - The virtual time in RTC ticks.  It only advances by accesses to the RTC,
+ *   see SimRTC(), and by sleeping in EM1 or EM2, see SimSleep().  When the
+ *   firmware sleeps, the time jumps to the next event, i.e. an RTC compare
+ *   match or an event of the script.  This is why a schedule of several
+ *   days is executed within seconds - and always with the same result.
+ * - The RTC counter with its compare and overflow flags.
+ * - The interrupts.  A pending interrupt is taken as soon as PRIMASK is
+ *   cleared, in SimRTC(), and in SimSleep().  Interrupts do not nest, and the
+ *   NVIC enable bits are not evaluated, only the IEN registers of the
+ *   peripherals.  An interrupt whose NVIC priority is masked by BASEPRI is
+ *   not taken, see SimBasePri().  PendSV is taken when nothing else is
+ *   pending.
+ * - The flash pages of the log journal and the record sequence number, and
+ *   the erased application area for FwUpdateCheck().
+ * - Stubs for the emlib modules CMU, EMU, MSC, and I2C.  The I2C bus has no
+ *   battery controller, i.e. all transfers are answered with NACK.  The CMU
+ *   keeps the source of the HF clock and the band of the HFRCO, so
+ *   CMU_ClockFreqGet() reports the clock of the HF clock governor.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+2026-10-14,agnt	SimSleep() reports the sleep time and the wake-up to the
+		benchmark, see sim_bench.c.
+2026-10-15,agnt	Added the application area of the flash, see g_SimAppFlash.
+2026-10-15,agnt	Interrupt flags of LEUART1 for the second RFID reader.
+2026-10-15,agnt	The CMU keeps the source of the HF clock and the HFRCO band,
+		the clock switches are counted, see HF_CLOCK_GOVERNOR.
+2026-10-15,agnt	CMU_ClockEnable() maintains CMU->HFPERCLKEN0, see ClockMgr.c.
+2026-10-15,agnt	PendSV is delivered after all other interrupts, see Defer.c.
+2026-10-15,agnt	The RTC counter is reset while the RTC is disabled, like the
+		hardware does, see ClockSet().
+2026-10-15,agnt	Added the flash pages of the DCF77 reception history.
+2026-10-15,agnt	BASEPRI masks the interrupts by their priority, see
+		SimBasePri().
+2026-10-15,agnt	Added the flash pages of the parameter store.
+2026-10-15,agnt	Added the interrupt flags of ACMP1 for the sound detector.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "em_device.h"
+#include "em_cmu.h"
+#include "em_emu.h"
+#include "em_msc.h"
+#include "em_i2c.h"
+#include "em_int.h"
+#include "config.h"
+#include "FwUpdate.h"		// FW_APP_SIZE
+#include "Defer.h"		// DEFER_WORK
+
+/*=============================== Definitions ================================*/
+
+    /*!@brief Direct pointers to the register blocks, without side effects. */
+#define SIM_RTC		((RTC_TypeDef *)   SIM_PER(0x40080000UL))
+#define SIM_GPIO	((GPIO_TypeDef *)  SIM_PER(0x40006000UL))
+#define SIM_USART0	((USART_TypeDef *) SIM_PER(0x4000C000UL))
+
+    /*!@brief Mask of the 24bit RTC counter. */
+#define RTC_CNT_MASK	0xFFFFFF
+
+    /*!@brief Maximum step of the virtual time, so no RTC event is skipped. */
+#define MAX_TIME_STEP	(1UL << 22)
+
+    /*!@brief Size of the queue for SimIrqPost(). */
+#define IRQ_QUEUE_SIZE	16
+
+    /*!@brief Frequencies reported by CMU_ClockFreqGet(). */
+#define SIM_HF_FREQ	32000000UL
+#define SIM_LF_FREQ	32768UL
+
+    /*!@brief Nominal frequency of the HFRCO bands in [MHz]. */
+#define SIM_HFRCO_MHZ(band)						\
+	((band) == cmuHFRCOBand_1MHz  ?  1 : (band) == cmuHFRCOBand_7MHz  ?  7 :\
+	 (band) == cmuHFRCOBand_11MHz ? 11 : (band) == cmuHFRCOBand_14MHz ? 14 :\
+	 (band) == cmuHFRCOBand_21MHz ? 21 : 28)
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*!@brief Interrupt flag registers of a peripheral. */
+typedef struct
+{
+    uintptr_t	Base;		//!< Address of the register block
+    uint16_t	IF;		//!< Offset of the IF register
+    uint16_t	IFS;		//!< Offset of the IFS register
+    uint16_t	IFC;		//!< Offset of the IFC register
+} SIM_IF_REGS;
+
+    /*!@brief Entry of the queue for SimIrqPost(). */
+typedef struct
+{
+    SIM_IRQ_FCT	Function;	//!< Function to be executed
+    uintptr_t	Arg;		//!< Its argument
+} SIM_IRQ_REQ;
+
+/*================================ Global Data ===============================*/
+
+uint32_t	g_SimPeriph[SIM_PER_SIZE / 4];
+uint32_t	g_SimSCS[SIM_SCS_SIZE / 4];
+uint32_t	g_SimCore[SIM_CORE_SIZE / 4];
+uint32_t	g_SimInfo[SIM_INFO_SIZE / 4];
+uint32_t	g_SimRomTable[16];
+uint32_t	g_SimCoreReg[8];
+
+    /*! Flash pages of the log journal, the record sequence number, the
+     * DCF77 reception history, and the parameter store, the end symbols are defined in sim/Makefile,
+     * like in the linker script. */
+uint32_t	__LogJournalStart[4608 / 4] __attribute__((aligned(512)));
+uint32_t	__RecSeqStart[1024 / 4] __attribute__((aligned(512)));
+uint32_t	__DcfHistStart[1024 / 4] __attribute__((aligned(512)));
+uint32_t	__ParamStart[1024 / 4] __attribute__((aligned(512)));
+
+    /*! Application area of the flash, compared with an update image */
+uint8_t		g_SimAppFlash[FW_APP_SIZE];
+
+bool		g_SimVerbose = true;
+
+/*================================ Local Data ================================*/
+
+    /*! Virtual time in RTC ticks, and the fraction of the current tick. */
+static uint64_t	l_Ticks;
+static uint32_t	l_SubTicks;
+
+    /*! Interrupt mask, and the number of the active interrupt (0 = none). */
+static uint32_t	l_PriMask;
+static uint32_t	l_IrqActive;
+
+    /*! Queue of functions to be executed in interrupt context. */
+static SIM_IRQ_REQ l_IrqQueue[IRQ_QUEUE_SIZE];
+static int	l_IrqQueGet, l_IrqQuePut;
+
+    /*! Statistics of the simulation, see also g_SimCnt. */
+static uint32_t	l_SleepCnt;
+static uint32_t	l_ClkSwitchCnt;
+
+    /*! Source of the HF clock, and band of the HFRCO, as after reset. */
+static CMU_Select_TypeDef    l_HfSelect = cmuSelect_HFRCO;
+static CMU_HFRCOBand_TypeDef l_HfrcoBand = cmuHFRCOBand_14MHz;
+
+    /*! Peripherals with interrupt flag registers, see SimRegSync(). */
+#define SIM_IF(base, type)						\
+	{ SIM_PER(base), offsetof(type, IF), offsetof(type, IFS),	\
+	  offsetof(type, IFC) }
+
+static const SIM_IF_REGS l_IF_Regs[] =
+{
+    SIM_IF(0x40080000UL, RTC_TypeDef),
+    SIM_IF(0x40006000UL, GPIO_TypeDef),
+    SIM_IF(0x4000C000UL, USART_TypeDef),
+    SIM_IF(0x4000C400UL, USART_TypeDef),
+    SIM_IF(0x4000C800UL, USART_TypeDef),
+    SIM_IF(0x4000A000UL, I2C_TypeDef),
+    SIM_IF(0x40084000UL, LEUART_TypeDef),
+    SIM_IF(0x40084400UL, LEUART_TypeDef),
+    SIM_IF(0x40001400UL, ACMP_TypeDef),
+};
+
+/*=========================== Forward Declarations ===========================*/
+
+void	RTC_IRQHandler (void);
+void	GPIO_EVEN_IRQHandler (void);
+void	GPIO_ODD_IRQHandler (void);
+void	USART0_RX_IRQHandler (void);
+void	PendSV_Handler (void);
+
+static void	SimRegSync (void);
+static void	SimTimeAdvance (uint64_t ticks);
+static uint64_t	SimNextEventTime (void);
+static bool	SimIrqDeliver (bool flgCheckOnly);
+static bool	SimIrqMasked (IRQn_Type irq);
+static void	SimSleep (int mode);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Initialize the simulated Hardware
+ *
+ * This routine must be called once before the firmware is started.  It sets
+ * the reset values of the registers which matter for the firmware.
+ *
+ ******************************************************************************/
+void	SimInit (void)
+{
+int	port;
+
+    /* Erased flash pages */
+    memset (__LogJournalStart, 0xFF, sizeof(__LogJournalStart));
+    memset (__RecSeqStart, 0xFF, sizeof(__RecSeqStart));
+    memset (__DcfHistStart, 0xFF, sizeof(__DcfHistStart));
+    memset (__ParamStart, 0xFF, sizeof(__ParamStart));
+    memset (g_SimAppFlash, 0xFF, sizeof(g_SimAppFlash));
+
+    /* Inputs have a pull-up, i.e. all light barriers are inactive */
+    for (port = 0;  port < 6;  port++)
+	SIM_REG(SIM_GPIO->P[port].DIN) = 0xFFFF;
+
+    /* The USARTs are always ready, an SPI read returns 0xFF */
+    SIM_REG(USART0->STATUS) = USART_STATUS_TXBL | USART_STATUS_TXC;
+    SIM_REG(USART1->STATUS) = USART_STATUS_TXBL | USART_STATUS_TXC;
+    SIM_REG(USART2->STATUS) = USART_STATUS_TXBL | USART_STATUS_TXC
+		   | USART_STATUS_RXDATAV;
+    SIM_REG(USART2->RXDATA) = 0xFF;
+
+    /* Device information */
+    SIM_REG(DEVINFO->UNIQUEL) = 0x5EED0001;
+    SIM_REG(DEVINFO->UNIQUEH) = 0x00000230;
+    SIM_REG(DEVINFO->MSIZE)   = (16 << _DEVINFO_MSIZE_SRAM_SHIFT)
+		     | (128 << _DEVINFO_MSIZE_FLASH_SHIFT);
+    SIM_REG(DEVINFO->PART)    = (230 << _DEVINFO_PART_DEVICE_NUMBER_SHIFT)
+		     | (71 << _DEVINFO_PART_DEVICE_FAMILY_SHIFT);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Access the RTC
+ *
+ * This routine is called for each access to the RTC registers, see RTC_BASE
+ * in "include/em_device.h".  It advances the virtual time by a fraction of a
+ * tick, updates the counter, and delivers pending interrupts.
+ *
+ * @return
+ *	Address of the RTC register block.
+ *
+ ******************************************************************************/
+void	*SimRTC (void)
+{
+    if (++l_SubTicks >= SIM_SUBTICKS)
+    {
+	l_SubTicks = 0;
+	SimTimeAdvance (1);
+    }
+
+    /* The counter is reset while the RTC is disabled */
+    if ((SIM_RTC->CTRL & RTC_CTRL_EN) == 0)
+	SIM_REG(SIM_RTC->CNT) = 0;
+
+    SimRegSync();
+    SimIrqDeliver (false);
+
+    return SIM_RTC;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the virtual Time
+ *
+ * @return
+ *	Number of RTC ticks since the start of the simulation.
+ *
+ ******************************************************************************/
+uint64_t SimTimeGet (void)
+{
+    return l_Ticks;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Advance the virtual Time
+ *
+ * This routine advances the virtual time, updates the RTC counter and its
+ * interrupt flags, and executes the events of the script which are due.
+ *
+ * @param[in] ticks
+ *	Number of RTC ticks.
+ *
+ ******************************************************************************/
+static void SimTimeAdvance (uint64_t ticks)
+{
+RTC_TypeDef *pRTC = SIM_RTC;
+uint64_t step, next;
+uint32_t cnt;
+
+    do
+    {
+	/* Do not skip an event of the script */
+	next = SimScriptNextTime();
+	if (next <= l_Ticks)
+	{
+	    SimScriptRun (l_Ticks);
+	    continue;
+	}
+	step = ticks < MAX_TIME_STEP ? ticks : MAX_TIME_STEP;
+	if (next - l_Ticks < step)
+	    step = next - l_Ticks;
+
+	/* The RTC counts only when enabled */
+	if (pRTC->CTRL & RTC_CTRL_EN)
+	{
+	    cnt = pRTC->CNT;
+	    if (((pRTC->COMP0 - cnt - 1) & RTC_CNT_MASK) < step)
+		SIM_REG(pRTC->IF) |= RTC_IF_COMP0;
+	    if (((pRTC->COMP1 - cnt - 1) & RTC_CNT_MASK) < step)
+		SIM_REG(pRTC->IF) |= RTC_IF_COMP1;
+	    if ((RTC_CNT_MASK - cnt) < step)
+		SIM_REG(pRTC->IF) |= RTC_IF_OF;
+	    SIM_REG(pRTC->CNT) = (cnt + step) & RTC_CNT_MASK;
+	}
+	l_Ticks += step;
+	ticks   -= step;
+    } while (ticks > 0);
+
+    /* Events which are due exactly now */
+    if (SimScriptNextTime() <= l_Ticks)
+	SimScriptRun (l_Ticks);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Time of the next Event
+ *
+ * This routine determines the virtual time of the next event which may wake
+ * up the firmware, i.e. an enabled RTC interrupt, or an event of the script.
+ *
+ * @return
+ *	Virtual time of the next event, or @ref SIM_NEVER.
+ *
+ ******************************************************************************/
+static uint64_t SimNextEventTime (void)
+{
+RTC_TypeDef *pRTC = SIM_RTC;
+uint64_t next = SimScriptNextTime();
+uint32_t cnt, dist;
+
+    if (pRTC->CTRL & RTC_CTRL_EN)
+    {
+	cnt = pRTC->CNT;
+	if (pRTC->IEN & RTC_IEN_COMP0)
+	{
+	    dist = ((pRTC->COMP0 - cnt - 1) & RTC_CNT_MASK) + 1;
+	    if (l_Ticks + dist < next)
+		next = l_Ticks + dist;
+	}
+	if (pRTC->IEN & RTC_IEN_COMP1)
+	{
+	    dist = ((pRTC->COMP1 - cnt - 1) & RTC_CNT_MASK) + 1;
+	    if (l_Ticks + dist < next)
+		next = l_Ticks + dist;
+	}
+	if (pRTC->IEN & RTC_IEN_OF)
+	{
+	    dist = RTC_CNT_MASK - cnt + 1;
+	    if (l_Ticks + dist < next)
+		next = l_Ticks + dist;
+	}
+    }
+
+    return next;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Synchronize Registers
+ *
+ * This routine applies the writes to the set and clear registers of the
+ * interrupt flags, and of the GPIO outputs.  These registers are plain
+ * memory, so the last value written is applied, and the register is reset
+ * to 0 afterwards.
+ *
+ ******************************************************************************/
+static void SimRegSync (void)
+{
+const SIM_IF_REGS *pRegs;
+volatile uint32_t *pIF, *pIFS, *pIFC;
+GPIO_P_TypeDef	  *pPort;
+unsigned int	 i;
+
+    for (i = 0;  i < ELEM_CNT(l_IF_Regs);  i++)
+    {
+	pRegs = &l_IF_Regs[i];
+	pIF   = (volatile uint32_t *)(pRegs->Base + pRegs->IF);
+	pIFS  = (volatile uint32_t *)(pRegs->Base + pRegs->IFS);
+	pIFC  = (volatile uint32_t *)(pRegs->Base + pRegs->IFC);
+	if (*pIFS)
+	{
+	    *pIF |= *pIFS;
+	    *pIFS = 0;
+	}
+	if (*pIFC)
+	{
+	    *pIF &= ~*pIFC;
+	    *pIFC = 0;
+	}
+    }
+
+    for (i = 0;  i < 6;  i++)
+    {
+	pPort = &SIM_GPIO->P[i];
+	pPort->DOUT |= pPort->DOUTSET;
+	pPort->DOUT &= ~pPort->DOUTCLR;
+	pPort->DOUT ^= pPort->DOUTTGL;
+	pPort->DOUTSET = pPort->DOUTCLR = pPort->DOUTTGL = 0;
+    }
+
+    SimDmaSync();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set an Input Pin
+ *
+ * This routine sets the level of a GPIO input, as seen by the firmware in
+ * register DIN.  If the pin is connected to an external interrupt which is
+ * sensitive for this edge, the interrupt flag is set.
+ *
+ * @param[in] port
+ *	GPIO port number, i.e. 0 for port A.
+ *
+ * @param[in] pin
+ *	Pin number 0 to 15.
+ *
+ * @param[in] level
+ *	New level of the pin.
+ *
+ ******************************************************************************/
+void	SimPinSet (int port, int pin, bool level)
+{
+GPIO_TypeDef *pGPIO = SIM_GPIO;
+uint32_t mask = (1 << pin);
+uint32_t sel;
+
+    if (((pGPIO->P[port].DIN & mask) != 0) == level)
+	return;			// no edge
+
+    SIM_REG(pGPIO->P[port].DIN) ^= mask;
+
+    /* Check if this port is selected for the EXTI of the pin */
+    sel = (pin < 8 ? pGPIO->EXTIPSELL >> (pin * 4)
+		   : pGPIO->EXTIPSELH >> ((pin - 8) * 4)) & 0x7;
+    if ((int)sel != port)
+	return;
+
+    if ((level ? pGPIO->EXTIRISE : pGPIO->EXTIFALL) & mask)
+	SIM_REG(pGPIO->IF) |= mask;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the Level of a Pin
+ *
+ * @param[in] port
+ *	GPIO port number, i.e. 0 for port A.
+ *
+ * @param[in] pin
+ *	Pin number 0 to 15.
+ *
+ * @return
+ *	Level of the output register DOUT.
+ *
+ ******************************************************************************/
+bool	SimPinGet (int port, int pin)
+{
+    return (SIM_GPIO->P[port].DOUT >> pin) & 1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Post a Function for Interrupt Context
+ *
+ * This routine queues a function, which is executed like an interrupt
+ * service routine as soon as interrupts are enabled.  It is used for the
+ * events of the script which call firmware routines, e.g. the console input.
+ *
+ * @param[in] function
+ *	Function to be called.
+ *
+ * @param[in] arg
+ *	Argument for the function.
+ *
+ ******************************************************************************/
+void	SimIrqPost (SIM_IRQ_FCT function, uintptr_t arg)
+{
+    if (l_IrqQuePut - l_IrqQueGet >= IRQ_QUEUE_SIZE)
+    {
+	SimTrace ("IRQ queue overflow");
+	return;
+    }
+    l_IrqQueue[l_IrqQuePut % IRQ_QUEUE_SIZE].Function = function;
+    l_IrqQueue[l_IrqQuePut % IRQ_QUEUE_SIZE].Arg = arg;
+    l_IrqQuePut++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Deliver pending Interrupts
+ *
+ * This routine calls the interrupt service routines of all pending and
+ * enabled interrupts, as long as PRIMASK is cleared and no other interrupt
+ * is active.  The priorities are fixed: DMA, RTC, GPIO, USART0 Rx, the
+ * functions of SimIrqPost(), and PendSV.
+ *
+ * @param[in] flgCheckOnly
+ *	If true, the interrupts are not delivered, but only checked.
+ *
+ * @return
+ *	true if an interrupt is pending.
+ *
+ ******************************************************************************/
+static bool SimIrqDeliver (bool flgCheckOnly)
+{
+RTC_TypeDef  *pRTC   = SIM_RTC;
+GPIO_TypeDef *pGPIO  = SIM_GPIO;
+USART_TypeDef *pUART = SIM_USART0;
+SIM_IRQ_REQ   req;
+uint32_t      gpio;
+bool	      dma, rtc, uart, post, pendSV;
+
+    while (1)
+    {
+	gpio   = pGPIO->IF & pGPIO->IEN;
+	dma    = SimDmaPending();
+	rtc    = (pRTC->IF & pRTC->IEN) != 0;
+	uart   = (pUART->IF & pUART->IEN & USART_IF_RXDATAV) != 0;
+	post   = (l_IrqQueGet != l_IrqQuePut);
+	pendSV = (SCB->ICSR & SCB_ICSR_PENDSVSET_Msk) != 0;
+
+	if (! dma  &&  ! rtc  &&  gpio == 0  &&  ! uart  &&  ! post
+	&&  ! pendSV)
+	    return false;		// nothing pending
+
+	if (flgCheckOnly)
+	    return true;
+
+	if (l_PriMask  ||  l_IrqActive)
+	    return true;		// pending, but not taken now
+
+	/* Interrupts masked by BASEPRI remain pending */
+	dma  = dma  &&  ! SimIrqMasked (DMA_IRQn);
+	rtc  = rtc  &&  ! SimIrqMasked (RTC_IRQn);
+	uart = uart &&  ! SimIrqMasked (USART0_RX_IRQn);
+	post = post &&  g_SimCoreReg[3] == 0;
+	pendSV = pendSV  &&  ! SimIrqMasked (PendSV_IRQn);
+	if (SimIrqMasked (GPIO_EVEN_IRQn))
+	    gpio &= ~0x5555;
+	if (SimIrqMasked (GPIO_ODD_IRQn))
+	    gpio &= 0x5555;
+
+	if (! dma  &&  ! rtc  &&  gpio == 0  &&  ! uart  &&  ! post
+	&&  ! pendSV)
+	    return true;		// pending, but not taken now
+
+	g_SimCnt.Irqs++;
+	if (dma)
+	{
+	    l_IrqActive = DMA_IRQn + 16;
+	    SimDmaIrq();
+	}
+	else if (rtc)
+	{
+	    l_IrqActive = RTC_IRQn + 16;
+	    RTC_IRQHandler();
+	}
+	else if (gpio & 0x5555)
+	{
+	    l_IrqActive = GPIO_EVEN_IRQn + 16;
+	    GPIO_EVEN_IRQHandler();
+	}
+	else if (gpio)
+	{
+	    l_IrqActive = GPIO_ODD_IRQn + 16;
+	    GPIO_ODD_IRQHandler();
+	}
+	else if (uart)
+	{
+	    l_IrqActive = USART0_RX_IRQn + 16;
+	    USART0_RX_IRQHandler();
+
+	    /* The handler has read RXDATA */
+	    SIM_REG(pUART->IF) &= ~USART_IF_RXDATAV;
+	    SIM_REG(pUART->STATUS) &= ~USART_STATUS_RXDATAV;
+	}
+	else if (post)
+	{
+	    req = l_IrqQueue[l_IrqQueGet % IRQ_QUEUE_SIZE];
+	    l_IrqQueGet++;
+	    l_IrqActive = 1;
+	    req.Function (req.Arg);
+	}
+	else
+	{
+	    SCB->ICSR &= ~SCB_ICSR_PENDSVSET_Msk;
+	    l_IrqActive = PendSV_IRQn + 16;
+#if DEFER_WORK
+	    PendSV_Handler();
+#endif
+	}
+	l_IrqActive = 0;
+
+	SimRegSync();
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set PRIMASK
+ *
+ * This routine implements __enable_irq() and __disable_irq().  Pending
+ * interrupts are delivered when PRIMASK is cleared.
+ *
+ * @param[in] priMask
+ *	New value of PRIMASK.
+ *
+ ******************************************************************************/
+void	SimIrqMask (uint32_t priMask)
+{
+    l_PriMask = priMask & 1;
+    if (! l_PriMask)
+    {
+	SimRegSync();
+	SimIrqDeliver (false);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set BASEPRI
+ *
+ * This routine implements __set_BASEPRI().  Interrupts whose priority is
+ * numerically equal to or greater than BASEPRI are not taken, see
+ * SimIrqMasked().  They are delivered as soon as BASEPRI is lowered again.
+ * The functions of SimIrqPost() have no priority, they are masked by any
+ * value other than 0.
+ *
+ * @param[in] basePri
+ *	New value of BASEPRI, 0 disables the masking.
+ *
+ ******************************************************************************/
+void	SimBasePri (uint32_t basePri)
+{
+uint32_t old = g_SimCoreReg[3];
+
+    g_SimCoreReg[3] = basePri & 0xFF;
+    if (g_SimCoreReg[3] == 0  ||  g_SimCoreReg[3] > old)
+    {
+	SimRegSync();
+	SimIrqDeliver (false);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check if an Interrupt is masked by BASEPRI
+ *
+ * @param[in] irq
+ *	Number of the interrupt, negative for the system exceptions.
+ *
+ * @return
+ *	true if the priority of the interrupt is masked.
+ *
+ ******************************************************************************/
+static bool	SimIrqMasked (IRQn_Type irq)
+{
+uint32_t prio;
+
+    if (g_SimCoreReg[3] == 0)
+	return false;
+
+    prio = (irq < 0 ? SCB->SHP[((uint32_t)irq & 0xF) - 4]
+		    : NVIC->IP[(uint32_t)irq]);
+    return prio >= g_SimCoreReg[3];
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get PRIMASK
+ *
+ ******************************************************************************/
+uint32_t SimIrqMaskGet (void)
+{
+    return l_PriMask;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the active Exception Number, i.e. the IPSR
+ *
+ ******************************************************************************/
+uint32_t SimIrqActive (void)
+{
+    return l_IrqActive;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Sleep until the next Event
+ *
+ * This routine is called for WFI, EM1, and EM2.  If an interrupt is pending,
+ * it returns at once, otherwise the virtual time jumps to the next event.
+ * If there is no more event, the simulation is finished.
+ *
+ * @param[in] mode
+ *	Energy mode of the sleep, i.e. 1 for WFI, 2 for EM2, or 3 for EM3.
+ *
+ ******************************************************************************/
+static void SimSleep (int mode)
+{
+uint64_t next;
+
+    l_SleepCnt++;
+    SimRegSync();
+
+    if (! SimIrqDeliver (true))
+    {
+	next = SimNextEventTime();
+	if (next == SIM_NEVER)
+	{
+	    SimTrace ("no more events - end of simulation");
+	    SimExit (0);
+	}
+	SimBenchSleep (mode, next - l_Ticks);
+	SimTimeAdvance (next - l_Ticks);
+	l_SubTicks = 0;
+	SimBenchWake();
+	SimRegSync();
+    }
+
+    SimIrqDeliver (false);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Implementation of the WFI and WFE Instructions
+ *
+ ******************************************************************************/
+void	SimWFI (void)
+{
+    SimSleep (1);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Implementation of the DSB Instruction
+ *
+ * NVIC_SystemReset() sets SYSRESETREQ in SCB->AIRCR, followed by a DSB.
+ * The simulation ends at this point.
+ *
+ ******************************************************************************/
+void	SimDSB (void)
+{
+    if (SCB->AIRCR & SCB_AIRCR_SYSRESETREQ_Msk)
+    {
+	SimTrace ("system reset requested - end of simulation");
+	SimExit (0);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Bit-Band Write Access
+ *
+ * This routine replaces an assignment to Bit() or IO_Bit(), see SIM_BIT() in
+ * "config.h".
+ *
+ * @param[in] pVar
+ *	Address of the variable or register.
+ *
+ * @param[in] size
+ *	Size of the variable in bytes.
+ *
+ * @param[in] bit
+ *	Bit number.
+ *
+ * @param[in] value
+ *	Only bit 0 is used, like for the bit-band area.
+ *
+ ******************************************************************************/
+void	SimBitSet (volatile void *pVar, size_t size, unsigned int bit,
+		   uint32_t value)
+{
+uint64_t mask = (uint64_t)1 << bit;
+
+    value &= 1;
+    switch (size)
+    {
+	case 1:
+	    *(volatile uint8_t *)pVar = value ? *(volatile uint8_t *)pVar | mask
+					      : *(volatile uint8_t *)pVar & ~mask;
+	    break;
+
+	case 2:
+	    *(volatile uint16_t *)pVar = value ? *(volatile uint16_t *)pVar | mask
+					       : *(volatile uint16_t *)pVar & ~mask;
+	    break;
+
+	case 4:
+	    *(volatile uint32_t *)pVar = value ? *(volatile uint32_t *)pVar | mask
+					       : *(volatile uint32_t *)pVar & ~mask;
+	    break;
+
+	default:
+	    *(volatile uint64_t *)pVar = value ? *(volatile uint64_t *)pVar | mask
+					       : *(volatile uint64_t *)pVar & ~mask;
+	    break;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Bit-Band Read Access
+ *
+ * This routine replaces a read of Bit() or IO_Bit(), see SimBitSet().
+ *
+ * @return
+ *	State of the bit, i.e. 0 or 1.
+ *
+ ******************************************************************************/
+uint32_t SimBitGet (const volatile void *pVar, size_t size, unsigned int bit)
+{
+uint64_t value;
+
+    switch (size)
+    {
+	case 1:	 value = *(const volatile uint8_t *)pVar;	break;
+	case 2:	 value = *(const volatile uint16_t *)pVar;	break;
+	case 4:	 value = *(const volatile uint32_t *)pVar;	break;
+	default: value = *(const volatile uint64_t *)pVar;	break;
+    }
+
+    return (value >> bit) & 1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Output a Trace Message of the Simulation
+ *
+ * The message is prefixed by the virtual time since the start of the
+ * simulation, i.e. <b>days-hours:minutes:seconds.milliseconds</b>.
+ *
+ ******************************************************************************/
+void	SimTrace (const char *frmt, ...)
+{
+va_list	 args;
+uint64_t ms  = l_Ticks * 1000 / SIM_TICKS_PER_SEC;
+uint32_t sec = (uint32_t)(ms / 1000);
+
+    if (! g_SimVerbose)
+	return;
+
+    printf ("## %lu-%02lu:%02lu:%02lu.%03lu ", (unsigned long)(sec / 86400),
+	    (unsigned long)(sec / 3600 % 24), (unsigned long)(sec / 60 % 60),
+	    (unsigned long)(sec % 60), (unsigned long)(ms % 1000));
+    va_start (args, frmt);
+    vprintf (frmt, args);
+    va_end (args);
+    putchar ('\n');
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Finish the Simulation
+ *
+ * This routine reports the statistics of the simulation and terminates the
+ * program.
+ *
+ * @param[in] status
+ *	Exit status of the program.
+ *
+ ******************************************************************************/
+void	SimExit (int status)
+{
+    SimTrace ("%lu interrupts, %lu sleeps, %lu clock switches",
+	      (unsigned long)g_SimCnt.Irqs, (unsigned long)l_SleepCnt,
+	      (unsigned long)l_ClkSwitchCnt);
+    SimDiskStats();
+    SimBenchReport();
+    fflush (stdout);
+    exit (status);
+}
+
+
+/*=============================================================================
+ *============================= emlib Stubs ===================================
+ *===========================================================================*/
+
+/* CMU - all oscillators are ready at once, only the HF clock is switched,
+ * and the enable bits of the HF peripherals are kept for ClockMgrReport() */
+
+void	CMU_ClockEnable (CMU_Clock_TypeDef clock, bool enable)
+{
+uint32_t bit = 1UL << ((clock >> CMU_EN_BIT_POS) & CMU_EN_BIT_MASK);
+
+    if (((clock >> CMU_EN_REG_POS) & CMU_EN_REG_MASK) != CMU_HFPERCLKEN0_EN_REG)
+	return;
+
+    if (enable)
+	CMU->HFPERCLKEN0 |= bit;
+    else
+	CMU->HFPERCLKEN0 &= ~bit;
+}
+
+uint32_t CMU_ClockFreqGet (CMU_Clock_TypeDef clock)
+{
+    switch (clock)
+    {
+	case cmuClock_LFA:
+	case cmuClock_LFB:
+	case cmuClock_RTC:
+	case cmuClock_LEUART0:
+	case cmuClock_LEUART1:
+	case cmuClock_LETIMER0:
+	    return SIM_LF_FREQ;
+
+	default:
+	    if (l_HfSelect == cmuSelect_HFRCO)
+		return SIM_HFRCO_MHZ(l_HfrcoBand) * 1000000UL;
+	    return SIM_HF_FREQ;
+    }
+}
+
+CMU_ClkDiv_TypeDef CMU_ClockDivGet (CMU_Clock_TypeDef clock)
+{
+    (void) clock;
+    return cmuClkDiv_1;
+}
+
+void	CMU_ClockDivSet (CMU_Clock_TypeDef clock, CMU_ClkDiv_TypeDef div)
+{
+    (void) clock;  (void) div;
+}
+
+CMU_Select_TypeDef CMU_ClockSelectGet (CMU_Clock_TypeDef clock)
+{
+    return clock == cmuClock_HF ? l_HfSelect : cmuSelect_LFXO;
+}
+
+void	CMU_ClockSelectSet (CMU_Clock_TypeDef clock, CMU_Select_TypeDef ref)
+{
+    if (clock != cmuClock_HF  ||  ref == l_HfSelect)
+	return;
+
+    l_HfSelect = ref;
+    l_ClkSwitchCnt++;
+}
+
+void	CMU_HFRCOBandSet (CMU_HFRCOBand_TypeDef band)
+{
+    l_HfrcoBand = band;
+}
+
+void	CMU_OscillatorEnable (CMU_Osc_TypeDef osc, bool enable, bool wait)
+{
+    (void) osc;  (void) enable;  (void) wait;
+}
+
+/* EMU - EM1 is entered via __WFI(), see EMU_EnterEM1() */
+
+void	EMU_EnterEM2 (bool restore)
+{
+    (void) restore;
+    SimSleep (2);
+}
+
+void	EMU_EnterEM3 (bool restore)
+{
+    (void) restore;
+    SimSleep (3);
+}
+
+/* MSC - the flash pages are host memory, see __LogJournalStart */
+
+void	MSC_Init (void)
+{
+}
+
+void	MSC_Deinit (void)
+{
+}
+
+msc_Return_TypeDef MSC_WriteWord (uint32_t *address, void const *data,
+				  int numBytes)
+{
+const uint32_t *pData = data;
+int	i;
+
+    if (((uintptr_t)address & 3)  ||  (numBytes & 3))
+	return mscReturnUnaligned;
+
+    /* Flash bits can only be cleared */
+    for (i = 0;  i < numBytes / 4;  i++)
+	address[i] &= pData[i];
+
+    return mscReturnOk;
+}
+
+msc_Return_TypeDef MSC_ErasePage (uint32_t *startAddress)
+{
+    if ((uintptr_t)startAddress & 511)
+	return mscReturnUnaligned;
+
+    memset (startAddress, 0xFF, 512);
+    return mscReturnOk;
+}
+
+/* I2C - there is no device on the bus */
+
+void	I2C_Init (I2C_TypeDef *i2c, const I2C_Init_TypeDef *init)
+{
+    (void) i2c;  (void) init;
+}
+
+void	I2C_Reset (I2C_TypeDef *i2c)
+{
+    (void) i2c;
+}
+
+void	I2C_BusFreqSet (I2C_TypeDef *i2c, uint32_t refFreq, uint32_t freq,
+			I2C_ClockHLR_TypeDef type)
+{
+    (void) i2c;  (void) refFreq;  (void) freq;  (void) type;
+}
+
+I2C_TransferReturn_TypeDef I2C_TransferInit (I2C_TypeDef *i2c,
+					     I2C_TransferSeq_TypeDef *seq)
+{
+    (void) i2c;  (void) seq;
+    return i2cTransferNack;
+}
+
+I2C_TransferReturn_TypeDef I2C_Transfer (I2C_TypeDef *i2c)
+{
+    (void) i2c;
+    return i2cTransferNack;
+}
+
+/* Assertions of emlib */
+
+void	assertEFM (const char *file, int line)
+{
+    SimTrace ("ASSERTION FAILED: %s:%d", file, line);
+    SimExit (2);
+}
@@ -0,0 +1,177 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Main Program of the Host Simulation
+ * @author	agent
+ * @version	2026-10-14
+ *
+ * This is the entry point of the host build.  It parses the command line,
+ * prepares the SD-Card image and the event script, and then calls the main()
+ * routine of the firmware, which is renamed to FirmwareMain() here.  The
+ * simulation ends with the "quit" event of the script, or when there is no
+ * more event to wait for.
+ *
+ * Usage: audio_sim [-q] [-d image [-n]] [-f file]... [-r log] [-b csv]
+ *		    [-z seed[:rounds]] [-y seed] [script]
+ *
+ * - <b>-q</b> switches the trace of the simulation off, only the console
+ *   output of the firmware remains.
+ * - <b>-d image</b> uses this file as SD-Card, it is inserted at the start.
+ * - <b>-n</b> creates a new image with an empty FAT16 file system.
+ * - <b>-f file</b> copies a host file into the root directory of the image.
+ * - <b>-r log</b> replays the external events of a field log, see
+ *   sim_replay.c.  A script is optional then, and may add further events.
+ * - <b>-b csv</b> enables the benchmark, which writes the work of the
+ *   firmware per event into the CSV file, see sim_bench.c.
+ * - <b>-z seed[:rounds]</b> feeds the RFID readers and the Audio module with
+ *   malformed frames, see sim_fuzz.c.  A script is optional then.
+ * - <b>-y seed</b> imports a mutated copy of the configuration file.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+2026-10-14,agnt	Added options -r to replay a field log, and -b for the benchmark.
+2026-10-15,agnt	Added options -z and -y for the fuzzer.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+/*=============================== Definitions ================================*/
+
+    /*! Maximum number of files to import */
+#define MAX_IMPORT	16
+
+/*=========================== Forward Declarations ===========================*/
+
+int	FirmwareMain (void);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Show the Usage
+ *
+ ******************************************************************************/
+static void usage (const char *pProg)
+{
+    fprintf (stderr, "usage: %s [-q] [-d image [-n]] [-f file]... [-r log]"
+	     " [-b csv] [-z seed[:rounds]] [-y seed] [script]\n", pProg);
+    exit (1);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Main Routine
+ *
+ ******************************************************************************/
+int	main (int argc, char *argv[])
+{
+const char *pImage = NULL;
+const char *pReplay = NULL;
+const char *pBench = NULL;
+const char *pFuzz = NULL;
+const char *pFuzzCfg = NULL;
+const char *pFile;
+const char *pImport[MAX_IMPORT];
+int	importCnt = 0;
+bool	flgFormat = false;
+int	opt, i;
+
+    while ((opt = getopt (argc, argv, "qd:nf:r:b:z:y:")) != -1)
+    {
+	switch (opt)
+	{
+	    case 'q':
+		g_SimVerbose = false;
+		break;
+
+	    case 'd':
+		pImage = optarg;
+		break;
+
+	    case 'n':
+		flgFormat = true;
+		break;
+
+	    case 'f':
+		if (importCnt >= MAX_IMPORT)
+		    usage (argv[0]);
+		pImport[importCnt++] = optarg;
+		break;
+
+	    case 'r':
+		pReplay = optarg;
+		break;
+
+	    case 'b':
+		pBench = optarg;
+		break;
+
+	    case 'z':
+		pFuzz = optarg;
+		break;
+
+	    case 'y':
+		pFuzzCfg = optarg;
+		break;
+
+	    default:
+		usage (argv[0]);
+	}
+    }
+
+    if (optind < argc - 1
+    ||  (optind == argc  &&  pReplay == NULL  &&  pFuzz == NULL)
+    ||  (pImage == NULL && (flgFormat || importCnt)))
+	usage (argv[0]);
+
+    /* The firmware uses mktime() and friends with UTC */
+    setenv ("TZ", "UTC", 1);
+    tzset();
+
+    /* stdout carries the console, keep it in order with the trace */
+    setvbuf (stdout, NULL, _IOLBF, 0);
+
+    SimInit();
+
+    if (optind < argc  &&  ! SimScriptLoad (argv[optind]))
+	return 1;
+
+    if (pReplay  &&  ! SimReplayLoad (pReplay))
+	return 1;
+
+    if (pFuzz  &&  ! SimFuzzLoad (pFuzz))
+	return 1;
+
+    if (pBench  &&  ! SimBenchOpen (pBench))
+	return 1;
+
+    if (pImage)
+    {
+	if (! SimDiskOpen (pImage, flgFormat))
+	    return 1;
+
+	for (i = 0;  i < importCnt;  i++)
+	{
+	    pFile = (pFuzzCfg ? SimFuzzConfig (pImport[i], pFuzzCfg)
+			      : pImport[i]);
+	    if (pFile == NULL  ||  ! SimDiskImport (pFile))
+		return 1;
+	}
+
+	SimDiskInsert (true);
+    }
+    else
+    {
+	SimDiskInsert (false);
+    }
+
+    FirmwareMain();
+
+    SimTrace ("firmware main() returned");
+    SimExit (1);
+}
@@ -0,0 +1,324 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Replay of Field Logs in the Host Simulation
+ * @author	agent
+ * @version	2026-10-14
+ *
+ * This module converts a log file of a box, e.g. "BOX0001.TXT", into events
+ * of the script, see SimScriptAdd().  In this way the firmware is fed with
+ * the external events of a real workload, see option <b>-r</b> of the
+ * simulation, and sim_bench.c for the measurement.
+ *
+ * Each line of the log starts with the time stamp of logMsg(), i.e.
+ * <b>YYYYMMDD-HHMMSS.mmm</b>, lines without time stamp are ignored.  The
+ * virtual time of an event is the distance of its time stamp to the first
+ * one.  A <b>DCF77: Time Synchronization</b> marker sets the clock, and
+ * starts a new time base, since the time stamps jump there.  A time stamp
+ * that goes back, e.g. after the synchronization, is taken as the previous
+ * one.
+ *
+ * The following messages are converted:
+ * - <b>LB1:ON</b>, <b>LB1:off</b>, and the same for LB2 become light barrier
+ *   events.
+ * - <b>Transponder: <ID>:...</b>, or <b>Transponder <ID> arrived</b>, become
+ *   a frame of the SR reader, which is received @ref RFID_LEAD_TIME before
+ *   the time stamp.
+ * - <b>Audio: MicroSD card inserted</b> becomes the status prompt of the
+ *   Audio module after power-up.
+ * - <b>Audio: Work Status</b>, <b>Audio: Capacity left (Mb)</b>, and
+ *   <b>Audio: Total file numbers</b> become the answers to the respective
+ *   queries.  Such an answer is defined at the time of the previous answer
+ *   of the same kind, so it is available when the firmware asks for it.
+ *   All other commands of the firmware are acknowledged.
+ *
+ * The simulation ends @ref REPLAY_TAIL_TIME after the last time stamp.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+
+/*=============================== Definitions ================================*/
+
+    /*! Maximum length of a log line */
+#define MAX_LINE_LEN		256
+
+    /*! Time between the RFID frame and the log message of the firmware */
+#define RFID_LEAD_TIME		SIM_MS2TICKS(20)
+
+    /*! Time after the last log message until the simulation ends */
+#define REPLAY_TAIL_TIME	SIM_MS2TICKS(10000)
+
+    /*! Opcodes of the Audio module, see "Audio.c" */
+#define AUDIO_OP_WORK_STATUS	0xC2
+#define AUDIO_OP_FILE_NUMBERS	0xC5
+#define AUDIO_OP_DEVICE_STATUS	0xCA
+#define AUDIO_OP_SPACE_LEFT	0xCE
+
+    /*! Number of answers by opcode, see l_AnswerTime[] */
+#define ANSWER_CNT		3
+
+/*================================ Local Data ================================*/
+
+    /*! Work status of the Audio module, the index is the status byte */
+static const char *l_WorkStatus[] =
+{ "", "Playing", "Stopped", "Paused", "Recording" };
+
+    /*! Opcodes of the answers, and the time of the previous answer */
+static const uint8_t l_AnswerOp[ANSWER_CNT] =
+{ AUDIO_OP_WORK_STATUS, AUDIO_OP_SPACE_LEFT, AUDIO_OP_FILE_NUMBERS };
+static uint64_t	l_AnswerTime[ANSWER_CNT];
+
+/*=========================== Forward Declarations ===========================*/
+
+static bool	ParseStamp (const char *pLine, struct tm *pTm, int *pMs);
+static void	AddFrame (uint64_t time, const char *pFile, int lineNum,
+			  const char *pCmd, uint8_t op, const uint8_t *pParam,
+			  int cnt);
+static void	AddRFID (uint64_t time, const char *pFile, int lineNum,
+			 const char *pID);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Load a Field Log
+ *
+ * This routine reads the log file, and adds the events to the script.
+ *
+ * @param[in] pFileName
+ *	Name of the log file.
+ *
+ * @return
+ *	true if the log could be read.
+ *
+ ******************************************************************************/
+bool	SimReplayLoad (const char *pFileName)
+{
+FILE	*fp;
+char	 line[MAX_LINE_LEN];
+char	 cmd[64];
+char	 id[17];
+const char *pMsg;
+struct tm tm;
+int	 ms, lineNum = 0, eventCnt = 0;
+int64_t	 stamp, base = 0;
+uint64_t time = 0, simBase = 0, t;
+bool	 flgFirst = true;
+uint8_t	 param[2];
+unsigned int i, value;
+
+    fp = fopen (pFileName, "r");
+    if (fp == NULL)
+    {
+	perror (pFileName);
+	return false;
+    }
+
+    /* All other commands of the firmware are acknowledged */
+    SimScriptAdd (0, pFileName, 0, "reply-op * = 00");
+
+    while (fgets (line, sizeof(line), fp))
+    {
+	lineNum++;
+	line[strcspn (line, "\r\n")] = '\0';
+
+	if (! ParseStamp (line, &tm, &ms))
+	    continue;
+	pMsg = line + 20;
+
+	/* Time stamp in ms, relative to the current time base */
+	stamp = (int64_t)timegm (&tm) * 1000 + ms;
+
+	if (flgFirst
+	||  strncmp (pMsg, "DCF77: Time Synchronization", 27) == 0)
+	{
+	    base = stamp;
+	    simBase = time;
+	    snprintf (cmd, sizeof(cmd), "time %04d-%02d-%02d %02d:%02d:%02d",
+		      tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+		      tm.tm_hour, tm.tm_min, tm.tm_sec);
+	    SimScriptAdd (time, pFileName, lineNum, cmd);
+	    flgFirst = false;
+	}
+	else if (stamp > base)
+	{
+	    t = simBase + SIM_MS2TICKS(stamp - base);
+	    if (t > time)
+		time = t;
+	}
+
+	if (strncmp (pMsg, "LB", 2) == 0  &&  (pMsg[2] == '1' || pMsg[2] == '2')
+	&&  (strcmp (pMsg + 3, ":ON") == 0  ||  strcmp (pMsg + 3, ":off") == 0))
+	{
+	    snprintf (cmd, sizeof(cmd), "lb %c %s", pMsg[2],
+		      pMsg[4] == 'O' ? "on" : "off");
+	    SimScriptAdd (time, pFileName, lineNum, cmd);
+	}
+	else if ((sscanf (pMsg, "Transponder: %16[0-9A-F]", id) == 1
+		  &&  pMsg[13 + strlen (id)] == ':')
+	     ||  (sscanf (pMsg, "Transponder %16[0-9A-F]", id) == 1
+		  &&  strncmp (pMsg + 12 + strlen (id), " arrived", 8) == 0))
+	{
+	    if (strlen (id) != 16)
+		continue;
+	    AddRFID (time > RFID_LEAD_TIME ? time - RFID_LEAD_TIME : 0,
+		     pFileName, lineNum, id);
+	}
+	else if (strcmp (pMsg, "Audio: MicroSD card inserted") == 0)
+	{
+	    param[0] = 0x01;
+	    AddFrame (time, pFileName, lineNum, "audio",
+		      AUDIO_OP_DEVICE_STATUS, param, 1);
+	}
+	else if (strncmp (pMsg, "Audio: Work Status ", 19) == 0)
+	{
+	    for (i = 1;  i < sizeof(l_WorkStatus) / sizeof(l_WorkStatus[0]);
+		 i++)
+	    {
+		if (strcmp (pMsg + 19, l_WorkStatus[i]) == 0)
+		{
+		    param[0] = i;
+		    AddFrame (l_AnswerTime[0], pFileName, lineNum,
+			      "reply-op C2 =", AUDIO_OP_WORK_STATUS,
+			      param, 1);
+		    l_AnswerTime[0] = time;
+		}
+	    }
+	}
+	else if (sscanf (pMsg, "Audio: Capacity left (Mb) %u", &value) == 1
+	     ||  sscanf (pMsg, "Audio: Total file numbers %u", &value) == 1)
+	{
+	    i = (pMsg[7] == 'C' ? 1 : 2);
+	    param[0] = (uint8_t)(value >> 8);
+	    param[1] = (uint8_t)value;
+	    snprintf (cmd, sizeof(cmd), "reply-op %02X =", l_AnswerOp[i]);
+	    AddFrame (l_AnswerTime[i], pFileName, lineNum, cmd,
+		      l_AnswerOp[i], param, 2);
+	    l_AnswerTime[i] = time;
+	}
+	else
+	{
+	    continue;
+	}
+	eventCnt++;
+    }
+
+    fclose (fp);
+
+    if (flgFirst)
+    {
+	fprintf (stderr, "%s: no log messages found\n", pFileName);
+	return false;
+    }
+
+    SimScriptAdd (time + REPLAY_TAIL_TIME, pFileName, lineNum, "quit");
+
+    if (g_SimVerbose)
+	printf ("## replay: %d events from %d lines of %s\n",
+		eventCnt, lineNum, pFileName);
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Parse the Time Stamp of a Log Line
+ *
+ * @return
+ *	true if the line starts with "YYYYMMDD-HHMMSS.mmm ".
+ *
+ ******************************************************************************/
+static bool ParseStamp (const char *pLine, struct tm *pTm, int *pMs)
+{
+int	i;
+
+    for (i = 0;  i < 19;  i++)
+    {
+	if (i == 8 ? pLine[i] != '-' : i == 15 ? pLine[i] != '.'
+	    : ! isdigit ((unsigned char)pLine[i]))
+	    return false;
+    }
+    if (pLine[19] != ' ')
+	return false;
+
+    memset (pTm, 0, sizeof(*pTm));
+    if (sscanf (pLine, "%4d%2d%2d-%2d%2d%2d.%3d", &pTm->tm_year, &pTm->tm_mon,
+		&pTm->tm_mday, &pTm->tm_hour, &pTm->tm_min, &pTm->tm_sec,
+		pMs) != 7)
+	return false;
+
+    pTm->tm_year -= 1900;
+    pTm->tm_mon  -= 1;
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add an Event with a Frame of the Audio Module
+ *
+ * The frame consists of the delimiter, the length, the opcode, the
+ * parameters, the checksum, and the delimiter again, see "Audio.c".
+ *
+ ******************************************************************************/
+static void AddFrame (uint64_t time, const char *pFile, int lineNum,
+		      const char *pCmd, uint8_t op, const uint8_t *pParam,
+		      int cnt)
+{
+char	 buf[MAX_LINE_LEN];
+uint8_t	 len = cnt + 3;		// length, opcode, parameters, checksum
+uint8_t	 csum = len + op;
+int	 n, i;
+
+    n = snprintf (buf, sizeof(buf), "%s 7E %02X %02X", pCmd, len, op);
+    for (i = 0;  i < cnt;  i++)
+    {
+	n += snprintf (buf + n, sizeof(buf) - n, " %02X", pParam[i]);
+	csum += pParam[i];
+    }
+    snprintf (buf + n, sizeof(buf) - n, " %02X 7E", csum);
+
+    SimScriptAdd (time, pFile, lineNum, buf);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add an Event with a Frame of the SR RFID Reader
+ *
+ * The frame consists of a fixed prefix, the 8 bytes of the transponder ID
+ * with the least significant byte first, and the XOR of all bytes.
+ *
+ ******************************************************************************/
+static void AddRFID (uint64_t time, const char *pFile, int lineNum,
+		     const char *pID)
+{
+uint8_t	 frame[14] = { 0x0E, 0x00, 0x11, 0x00, 0x05 };
+char	 buf[MAX_LINE_LEN];
+char	 digits[3] = "";
+int	 i, n;
+
+    for (i = 0;  i < 8;  i++)
+    {
+	digits[0] = pID[2 * i];
+	digits[1] = pID[2 * i + 1];
+	frame[12 - i] = (uint8_t)strtoul (digits, NULL, 16);
+    }
+    for (i = 0;  i < 13;  i++)
+	frame[13] ^= frame[i];
+
+    n = snprintf (buf, sizeof(buf), "rfid");
+    for (i = 0;  i < 14;  i++)
+	n += snprintf (buf + n, sizeof(buf) - n, " %02X", frame[i]);
+
+    SimScriptAdd (time, pFile, lineNum, buf);
+}
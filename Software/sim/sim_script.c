@@ -0,0 +1,852 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Event Script of the Host Simulation
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This module reads the script with the external events, and feeds them into
+ * the simulated hardware at their point in virtual time.  A script consists
+ * of one event per line, empty lines and text after '#' are ignored:
+ *
+ *	[@<time>|+<time>] <command> [<arguments>]
+ *
+ * The prefix <b>@</b> specifies an absolute time after the start of the
+ * simulation, <b>+</b> a time relative to the previous event.  Without a
+ * prefix, the event happens at the same time as the previous one.  A time
+ * is a sequence of numbers with the units <b>ms</b>, <b>s</b>, <b>m</b>,
+ * <b>h</b>, or <b>d</b>, e.g. "1h30m".  A number without unit means seconds.
+ *
+ * Commands:
+ * - <b>time YYYY-MM-DD HH:MM:SS</b> sets the clock, like a DCF77 frame.
+ * - <b>dcf YYYY-MM-DD HH:MM:SS</b> passes the time to TimeSrcSync(), like a
+ *   received DCF77 frame, so a small offset is slewed, see ClockSlew().
+ * - <b>cmd <line></b> enters a command line at the console.
+ * - <b>lb 1|2 on|off</b> activates or deactivates a light barrier.
+ * - <b>rfid <hex></b> sends bytes from the RFID reader to USART1.
+ * - <b>rfid2 <hex></b> sends bytes from the second RFID reader to LEUART1.
+ * - <b>audio <hex></b> sends bytes from the Audio module to USART0.
+ * - <b>reply <tx-hex> = <rx-hex></b> defines an automatic answer of the
+ *   Audio module: after the firmware has sent the bytes <tx-hex>, the bytes
+ *   <rx-hex> are received after the reply delay.
+ * - <b>reply-op <op>|* = <rx-hex></b> defines an automatic answer for all
+ *   frames with the opcode <op>, or for all frames ("*"), which do not match
+ *   a "reply" rule.  A new rule for the same opcode replaces the old one.
+ * - <b>reply-delay <ms></b> sets the reply delay, default is 10ms.
+ * - <b>card in|out</b> inserts or removes the SD-Card.
+ * - <b>power fail|ok</b> sets the power fail signal.
+ * - <b>pin <port> <pin> 0|1</b> sets any input pin, e.g. "pin D 2 1".
+ * - <b>sound</b> generates an edge of the comparator of the sound detector,
+ *   i.e. a sound which exceeds SOUND_THRESHOLD.  Sound which lasts longer
+ *   needs one event per second.
+ * - <b>supply <mV></b> sets the supply voltage which is measured by the ADC
+ *   of the supply monitor.
+ * - <b>quit</b> terminates the simulation.
+ *
+ * The bytes of the serial lines are delivered one after the other with the
+ * timing of the baudrate that is currently programmed into the USART.
+ *
+ * Further events may be added by SimScriptAdd(), e.g. from a field log, see
+ * sim_replay.c.  Each event, and each received byte, is accounted by the
+ * benchmark under the name of its command, see SimBenchAccount().
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-14,agnt	Initial version.
+2026-10-14,agnt	Added SimScriptAdd(), command "reply-op", and the accounting of
+		the events for the benchmark.
+2026-10-15,agnt	Added command "rfid2" for the second RFID reader at LEUART1.
+2026-10-15,agnt	Command "rfid" is received by LEUART1 if RFID_EM2_RX is set.
+2026-10-15,agnt	Added command "sound" for the sound-activity detector.
+2026-10-15,agnt	Added command "supply" for the supply monitor.
+2026-10-15,agnt	The received bytes are counted for the benchmark.
+2026-10-15,agnt	Added command "dcf" to synchronize the clock via TimeSrcSync().
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include "em_device.h"
+#include "em_gpio.h"
+#include "em_usart.h"
+#include "em_leuart.h"
+#include "config.h"
+#include "AlarmClock.h"
+#include "LightBarrier.h"
+#include "PowerFail.h"
+#include "RFID.h"
+#include "SoundDetect.h"
+#include "SupplyMon.h"
+#include "TimeSrc.h"
+
+/*=============================== Definitions ================================*/
+
+    /*! Maximum length of a script line */
+#define MAX_LINE_LEN	256
+
+    /*! Maximum number of bytes of a byte stream */
+#define MAX_STREAM_LEN	256
+
+    /*! Maximum number of reply rules, and bytes per pattern */
+#define MAX_REPLIES	32
+#define MAX_PATTERN	16
+
+    /*! Number of bits per character on the serial lines (8N1 plus margin) */
+#define BITS_PER_CHAR	10
+
+    /*! Value of REPLY_RULE.Op for a rule by bytes, and for any opcode */
+#define REPLY_BYTES	-1
+#define REPLY_ANY_OP	0x100
+
+    /*! Delimiter of the frames of the Audio module */
+#define FRAME_DELIM	0x7E
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*! Event of the script */
+typedef struct
+{
+    uint64_t	 Time;		//!< virtual time of the event in RTC ticks
+    const char	*pSource;	//!< file name for error messages
+    int		 LineNum;	//!< line number for error messages
+    char	*pCmd;		//!< command and arguments
+} SCRIPT_EVENT;
+
+    /*! Byte stream which is received by a USART */
+typedef struct
+{
+    const char	*pName;		//!< name for the trace
+    const char	*pClass;	//!< name for the benchmark
+    USART_TypeDef *pUART;	//!< receiving USART
+    LEUART_TypeDef *pLEUART;	//!< receiving LEUART, if pUART is NULL
+    int		 DmaChan;	//!< DMA channel of the LEUART
+    uint8_t	 Data[MAX_STREAM_LEN];	//!< bytes to be received
+    int		 Cnt;		//!< number of bytes in Data[]
+    int		 Idx;		//!< index of the next byte
+    uint64_t	 Next;		//!< time of the next byte
+} BYTE_STREAM;
+
+    /*! Automatic reply of the Audio module */
+typedef struct
+{
+    int		 Op;			//!< opcode, or REPLY_BYTES for Tx[]
+    uint8_t	 Tx[MAX_PATTERN];	//!< bytes sent by the firmware
+    int		 TxCnt;
+    uint8_t	 Rx[MAX_PATTERN];	//!< bytes of the reply
+    int		 RxCnt;
+} REPLY_RULE;
+
+/*================================ Local Data ================================*/
+
+static SCRIPT_EVENT *l_pEvent;		//!< list of events
+static int	l_EventCnt;		//!< number of events
+static int	l_EventIdx;		//!< index of the next event
+static int	l_EventSize;		//!< allocated entries of l_pEvent
+
+static BYTE_STREAM l_AudioRx = { .pName = "AUDIO", .pClass = "audio",
+				  .pUART = USART0 };
+#if RFID_EM2_RX
+static BYTE_STREAM l_RFID_Rx = { .pName = "RFID",  .pClass = "rfid",
+				  .pLEUART = LEUART1,
+				  .DmaChan = DMA_CHAN_RFID_RX };
+#else
+static BYTE_STREAM l_RFID_Rx = { .pName = "RFID",  .pClass = "rfid",
+				  .pUART = USART1 };
+#endif
+static BYTE_STREAM l_RFID2_Rx = { .pName = "RFID2", .pClass = "rfid",
+				  .pLEUART = LEUART1,
+				  .DmaChan = DMA_CHAN_RFID2_RX };
+
+static REPLY_RULE l_Reply[MAX_REPLIES];
+static int	l_ReplyCnt;
+static uint64_t	l_ReplyDelay = SIM_MS2TICKS(10);
+
+    /*! Bytes sent to the Audio module, see SimAudioTx() */
+static uint8_t	l_AudioTx[MAX_PATTERN];
+static int	l_AudioTxCnt;		//!< number of valid bytes
+static char	l_AudioTxTrace[MAX_LINE_LEN];
+
+/*=========================== Forward Declarations ===========================*/
+
+static bool	ParseTime (const char *pStr, uint64_t *pTicks);
+static int	ParseHex (const char *pStr, uint8_t *pBuf, int size);
+static void	StreamAdd (BYTE_STREAM *pStream, uint64_t time,
+			   const uint8_t *pData, int cnt);
+static void	StreamRun (BYTE_STREAM *pStream, uint64_t now);
+static void	EventExec (SCRIPT_EVENT *pEvent, uint64_t now);
+static int	FrameOpcode (void);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Load the Script
+ *
+ * This routine reads the script file, and checks the time prefixes.  The
+ * commands are checked when they are executed.
+ *
+ * @param[in] pFileName
+ *	Name of the script file.
+ *
+ * @return
+ *	true if the script could be loaded.
+ *
+ ******************************************************************************/
+bool	SimScriptLoad (const char *pFileName)
+{
+FILE	*fp;
+char	 line[MAX_LINE_LEN];
+char	*pStr, *pEnd;
+int	 lineNum = 0;
+uint64_t time = 0, ticks;
+
+    fp = fopen (pFileName, "r");
+    if (fp == NULL)
+    {
+	perror (pFileName);
+	return false;
+    }
+
+    while (fgets (line, sizeof(line), fp))
+    {
+	lineNum++;
+
+	pStr = strchr (line, '#');
+	if (pStr)
+	    *pStr = '\0';
+
+	/* Strip white space */
+	for (pStr = line;  isspace ((unsigned char)*pStr);  pStr++)
+	    ;
+	pEnd = pStr + strlen (pStr);
+	while (pEnd > pStr  &&  isspace ((unsigned char)pEnd[-1]))
+	    *--pEnd = '\0';
+	if (*pStr == '\0')
+	    continue;
+
+	if (*pStr == '@'  ||  *pStr == '+')
+	{
+	    for (pEnd = pStr + 1;  *pEnd && ! isspace ((unsigned char)*pEnd);
+		 pEnd++)
+		;
+	    if (*pEnd)
+		*pEnd++ = '\0';
+
+	    if (! ParseTime (pStr + 1, &ticks))
+	    {
+		fprintf (stderr, "%s:%d: invalid time \"%s\"\n",
+			 pFileName, lineNum, pStr);
+		fclose (fp);
+		return false;
+	    }
+
+	    if (*pStr == '+')
+	    {
+		time += ticks;
+	    }
+	    else if (ticks < time)
+	    {
+		fprintf (stderr, "%s:%d: time \"%s\" is before the previous "
+			 "event\n", pFileName, lineNum, pStr);
+		fclose (fp);
+		return false;
+	    }
+	    else
+	    {
+		time = ticks;
+	    }
+
+	    for (pStr = pEnd;  isspace ((unsigned char)*pStr);  pStr++)
+		;
+	    if (*pStr == '\0')
+		continue;		// time only
+	}
+
+	SimScriptAdd (time, pFileName, lineNum, pStr);
+    }
+
+    fclose (fp);
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add an Event
+ *
+ * This routine inserts an event into the list, after all events with the
+ * same or an earlier time.  It must be called before the simulation starts.
+ *
+ * @param[in] time
+ *	Virtual time of the event in RTC ticks.
+ *
+ * @param[in] pSource
+ *	Name of the file the event comes from, it is not copied.
+ *
+ * @param[in] lineNum
+ *	Line number within this file.
+ *
+ * @param[in] pCmd
+ *	Command and arguments, see the description of this module.
+ *
+ ******************************************************************************/
+void	SimScriptAdd (uint64_t time, const char *pSource, int lineNum,
+		      const char *pCmd)
+{
+int	i;
+
+    if (l_EventCnt >= l_EventSize)
+    {
+	l_EventSize = l_EventSize ? l_EventSize * 2 : 64;
+	l_pEvent = realloc (l_pEvent, l_EventSize * sizeof(SCRIPT_EVENT));
+	if (l_pEvent == NULL)
+	{
+	    perror ("realloc");
+	    exit (1);
+	}
+    }
+
+    /* The events are mostly added in order, so search from the end */
+    for (i = l_EventCnt;  i > 0  &&  l_pEvent[i - 1].Time > time;  i--)
+	;
+    memmove (&l_pEvent[i + 1], &l_pEvent[i],
+	     (l_EventCnt - i) * sizeof(SCRIPT_EVENT));
+
+    l_pEvent[i].Time    = time;
+    l_pEvent[i].pSource = pSource;
+    l_pEvent[i].LineNum = lineNum;
+    l_pEvent[i].pCmd    = strdup (pCmd);
+    l_EventCnt++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Time of the next Event
+ *
+ * @return
+ *	Virtual time of the next script event or received byte, or
+ *	@ref SIM_NEVER.
+ *
+ ******************************************************************************/
+uint64_t SimScriptNextTime (void)
+{
+uint64_t next = SIM_NEVER;
+
+    if (l_EventIdx < l_EventCnt)
+	next = l_pEvent[l_EventIdx].Time;
+
+    if (l_AudioRx.Idx < l_AudioRx.Cnt  &&  l_AudioRx.Next < next)
+	next = l_AudioRx.Next;
+
+    if (l_RFID_Rx.Idx < l_RFID_Rx.Cnt  &&  l_RFID_Rx.Next < next)
+	next = l_RFID_Rx.Next;
+
+    if (l_RFID2_Rx.Idx < l_RFID2_Rx.Cnt  &&  l_RFID2_Rx.Next < next)
+	next = l_RFID2_Rx.Next;
+
+    return next;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Execute all due Events
+ *
+ * @param[in] now
+ *	Current virtual time in RTC ticks.
+ *
+ ******************************************************************************/
+void	SimScriptRun (uint64_t now)
+{
+    while (l_EventIdx < l_EventCnt  &&  l_pEvent[l_EventIdx].Time <= now)
+	EventExec (&l_pEvent[l_EventIdx++], now);
+
+    StreamRun (&l_AudioRx, now);
+    StreamRun (&l_RFID_Rx, now);
+    StreamRun (&l_RFID2_Rx, now);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Byte sent to the Audio Module
+ *
+ * This routine is called by the DMA for every byte written to USART0->TXDATA.
+ *
+ ******************************************************************************/
+void	SimAudioTx (uint8_t byte)
+{
+size_t	len = strlen (l_AudioTxTrace);
+
+    if (len < sizeof(l_AudioTxTrace) - 4)
+	sprintf (l_AudioTxTrace + len, " %02X", byte);
+
+    if (l_AudioTxCnt == MAX_PATTERN)
+    {
+	memmove (l_AudioTx, l_AudioTx + 1, MAX_PATTERN - 1);
+	l_AudioTxCnt--;
+    }
+    l_AudioTx[l_AudioTxCnt++] = byte;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	DMA Transfer to the Audio Module done
+ *
+ * This routine traces the transmitted bytes, and checks the reply rules.
+ * The rules by bytes are checked first, then the rules by opcode, where
+ * the rule for a specific opcode has precedence over the one for any.
+ *
+ ******************************************************************************/
+void	SimAudioTxDone (void)
+{
+REPLY_RULE *pRule, *pMatch = NULL;
+int	i, op;
+
+    if (g_SimVerbose)
+	SimTrace ("AUDIO >%s", l_AudioTxTrace);
+    l_AudioTxTrace[0] = '\0';
+
+    for (i = 0, pRule = l_Reply;  i < l_ReplyCnt;  i++, pRule++)
+    {
+	if (pRule->Op == REPLY_BYTES  &&  pRule->TxCnt <= l_AudioTxCnt
+	&&  memcmp (l_AudioTx + l_AudioTxCnt - pRule->TxCnt, pRule->Tx,
+		    pRule->TxCnt) == 0)
+	{
+	    pMatch = pRule;
+	    break;
+	}
+    }
+
+    if (pMatch == NULL  &&  (op = FrameOpcode()) >= 0)
+    {
+	for (i = 0, pRule = l_Reply;  i < l_ReplyCnt;  i++, pRule++)
+	{
+	    if (pRule->Op == op)
+	    {
+		pMatch = pRule;
+		break;
+	    }
+	    if (pRule->Op == REPLY_ANY_OP)
+		pMatch = pRule;
+	}
+    }
+
+    if (pMatch)
+    {
+	StreamAdd (&l_AudioRx, SimTimeGet() + l_ReplyDelay,
+		   pMatch->Rx, pMatch->RxCnt);
+	l_AudioTxCnt = 0;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Opcode of the last Frame sent to the Audio Module
+ *
+ * A frame consists of the delimiter, the length, the opcode, the parameters,
+ * the checksum, and the delimiter again, where the length counts itself, the
+ * opcode, the parameters, and the checksum.
+ *
+ * @return
+ *	Opcode, or -1 if the bytes sent do not end with a complete frame.
+ *
+ ******************************************************************************/
+static int FrameOpcode (void)
+{
+int	i;
+
+    if (l_AudioTxCnt < 5  ||  l_AudioTx[l_AudioTxCnt - 1] != FRAME_DELIM)
+	return -1;
+
+    for (i = l_AudioTxCnt - 5;  i >= 0;  i--)
+    {
+	if (l_AudioTx[i] == FRAME_DELIM
+	&&  l_AudioTx[i + 1] == l_AudioTxCnt - i - 2)
+	    return l_AudioTx[i + 2];
+    }
+    return -1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Parse a Time
+ *
+ ******************************************************************************/
+static bool ParseTime (const char *pStr, uint64_t *pTicks)
+{
+uint64_t ms = 0, val;
+char	*pEnd;
+
+    if (! isdigit ((unsigned char)*pStr))
+	return false;
+
+    while (*pStr)
+    {
+	if (! isdigit ((unsigned char)*pStr))
+	    return false;
+
+	val = strtoull (pStr, &pEnd, 10);
+	pStr = pEnd;
+
+	if (strncmp (pStr, "ms", 2) == 0)
+	    pStr += 2;
+	else if (*pStr == 'd')
+	    val *= 86400000, pStr++;
+	else if (*pStr == 'h')
+	    val *= 3600000, pStr++;
+	else if (*pStr == 'm')
+	    val *= 60000, pStr++;
+	else if (*pStr == 's'  ||  *pStr == '\0')
+	    val *= 1000, pStr += (*pStr != '\0');
+	else
+	    return false;
+
+	ms += val;
+    }
+
+    *pTicks = SIM_MS2TICKS(ms);
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Parse a Sequence of Hex Bytes
+ *
+ * @return
+ *	Number of bytes, or -1 on error.
+ *
+ ******************************************************************************/
+static int ParseHex (const char *pStr, uint8_t *pBuf, int size)
+{
+int	cnt = 0;
+char	digits[3] = "";
+
+    while (*pStr)
+    {
+	if (isspace ((unsigned char)*pStr))
+	{
+	    pStr++;
+	    continue;
+	}
+	if (! isxdigit ((unsigned char)pStr[0])
+	||  ! isxdigit ((unsigned char)pStr[1])  ||  cnt >= size)
+	    return -1;
+
+	digits[0] = pStr[0];
+	digits[1] = pStr[1];
+	pBuf[cnt++] = (uint8_t)strtoul (digits, NULL, 16);
+	pStr += 2;
+    }
+    return cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add Bytes to a Stream
+ *
+ * The bytes are received after the pending ones, but not before @p time.
+ *
+ ******************************************************************************/
+static void StreamAdd (BYTE_STREAM *pStream, uint64_t time,
+		       const uint8_t *pData, int cnt)
+{
+    if (pStream->Idx >= pStream->Cnt)
+    {
+	pStream->Idx = pStream->Cnt = 0;
+	pStream->Next = time;
+    }
+    else if (pStream->Next < time)
+    {
+	pStream->Next = time;
+    }
+
+    if (cnt > MAX_STREAM_LEN - pStream->Cnt)
+    {
+	SimTrace ("%s: stream overflow, %d bytes dropped", pStream->pName,
+		  cnt - (MAX_STREAM_LEN - pStream->Cnt));
+	cnt = MAX_STREAM_LEN - pStream->Cnt;
+    }
+    memcpy (pStream->Data + pStream->Cnt, pData, cnt);
+    pStream->Cnt += cnt;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Deliver the due Bytes of a Stream to its USART
+ *
+ * The Audio USART receives by interrupt, the RFID USART and LEUART by DMA.
+ * A byte which has not been read until the next one arrives is lost, like
+ * on the hardware.
+ *
+ ******************************************************************************/
+static void StreamRun (BYTE_STREAM *pStream, uint64_t now)
+{
+USART_TypeDef *pUART = pStream->pUART;
+LEUART_TypeDef *pLEUART = pStream->pLEUART;
+uint32_t baud;
+uint8_t	 byte;
+
+    while (pStream->Idx < pStream->Cnt  &&  pStream->Next <= now)
+    {
+	byte = pStream->Data[pStream->Idx++];
+	SimBenchAccount (pStream->pClass);
+	g_SimCnt.RxBytes++;
+
+	baud = (pUART ? USART_BaudrateGet (pUART)
+		      : LEUART_BaudrateGet (pLEUART));
+	if (baud == 0)
+	    baud = 9600;
+	pStream->Next += (BITS_PER_CHAR * SIM_TICKS_PER_SEC + baud - 1) / baud;
+
+	if (pUART == NULL)
+	{
+	    /* An RFID reader at the LEUART is received by DMA */
+	    if (pLEUART->STATUS & LEUART_STATUS_RXDATAV)
+		SimTrace ("%s: receive overrun", pStream->pName);
+
+	    SIM_REG(pLEUART->RXDATA)  = byte;
+	    SIM_REG(pLEUART->RXDATAX) = byte;
+	    SIM_REG(pLEUART->STATUS) |= LEUART_STATUS_RXDATAV;
+
+	    if (SimDmaRequest (pStream->DmaChan))
+		SIM_REG(pLEUART->STATUS) &= ~LEUART_STATUS_RXDATAV;
+	    continue;
+	}
+
+	if (pUART->STATUS & USART_STATUS_RXDATAV)
+	    SimTrace ("%s: receive overrun", pStream->pName);
+
+	SIM_REG(pUART->RXDATA)  = byte;
+	SIM_REG(pUART->RXDATAX) = byte;
+	SIM_REG(pUART->STATUS) |= USART_STATUS_RXDATAV;
+
+	if (pUART == USART1)
+	{
+	    /* The RFID reader is received by DMA */
+	    if (SimDmaRequest (DMA_CHAN_RFID_RX))
+		SIM_REG(pUART->STATUS) &= ~USART_STATUS_RXDATAV;
+	}
+	else
+	{
+	    SIM_REG(pUART->IF) |= USART_IF_RXDATAV;
+	}
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Set the Clock in Interrupt Context
+ *
+ ******************************************************************************/
+static void ClockSetIrq (uintptr_t arg)
+{
+    ClockSet ((struct tm *)arg, true);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Synchronize the Clock like a Time Source in Interrupt Context
+ *
+ ******************************************************************************/
+static void TimeSyncIrq (uintptr_t arg)
+{
+    TimeSrcSync ((struct tm *)arg, 0);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Call the Comparator Handler in Interrupt Context
+ *
+ ******************************************************************************/
+static void SoundIrq (uintptr_t arg)
+{
+    (void) arg;
+    ACMP0_IRQHandler();
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Execute an Event
+ *
+ ******************************************************************************/
+static void EventExec (SCRIPT_EVENT *pEvent, uint64_t now)
+{
+static struct tm newTime;
+char	*pCmd = pEvent->pCmd;
+char	*pArg;
+char	 cmd[16];
+uint8_t	 buf[MAX_STREAM_LEN];
+REPLY_RULE *pRule;
+int	 n, num, port;
+char	 arg1[16], arg2[16];
+
+    if (sscanf (pCmd, "%15s%n", cmd, &n) != 1)
+	return;
+    for (pArg = pCmd + n;  isspace ((unsigned char)*pArg);  pArg++)
+	;
+
+    if (g_SimVerbose  &&  strcmp (cmd, "cmd") != 0)
+	SimTrace ("SCRIPT %s", pCmd);
+
+    SimBenchAccount (cmd);
+
+    if (strcmp (cmd, "time") == 0  ||  strcmp (cmd, "dcf") == 0)
+    {
+	memset (&newTime, 0, sizeof(newTime));
+	if (sscanf (pArg, "%d-%d-%d %d:%d:%d", &newTime.tm_year,
+		    &newTime.tm_mon, &newTime.tm_mday, &newTime.tm_hour,
+		    &newTime.tm_min, &newTime.tm_sec) != 6)
+	    goto error;
+	newTime.tm_year -= 1900;
+	newTime.tm_mon  -= 1;
+	mktime (&newTime);		// calculate tm_wday and tm_yday
+	newTime.tm_year -= 100;		// the firmware counts from 2000
+	SimIrqPost (strcmp (cmd, "time") == 0 ? ClockSetIrq : TimeSyncIrq,
+		    (uintptr_t)&newTime);
+    }
+    else if (strcmp (cmd, "cmd") == 0)
+    {
+	SimConsoleInput (pArg);
+    }
+    else if (strcmp (cmd, "lb") == 0)
+    {
+	if (sscanf (pArg, "%d %15s", &num, arg1) != 2
+	||  (num != 1  &&  num != LB_NUM)
+	||  (strcmp (arg1, "on") != 0  &&  strcmp (arg1, "off") != 0))
+	    goto error;
+
+	/* The light barriers are active low */
+	SimPinSet (num == 1 ? LB1_PORT : LB2_PORT,
+		   num == 1 ? LB1_PIN  : LB2_PIN, strcmp (arg1, "on") != 0);
+    }
+    else if (strcmp (cmd, "rfid") == 0  ||  strcmp (cmd, "rfid2") == 0
+	 ||  strcmp (cmd, "audio") == 0)
+    {
+	n = ParseHex (pArg, buf, sizeof(buf));
+	if (n <= 0)
+	    goto error;
+	StreamAdd (cmd[0] == 'a' ? &l_AudioRx
+		   : cmd[4] == '2' ? &l_RFID2_Rx : &l_RFID_Rx, now, buf, n);
+    }
+    else if (strcmp (cmd, "reply") == 0)
+    {
+	char *pRx = strchr (pArg, '=');
+
+	if (pRx == NULL  ||  l_ReplyCnt >= MAX_REPLIES)
+	    goto error;
+	*pRx++ = '\0';
+
+	pRule = &l_Reply[l_ReplyCnt];
+	pRule->Op    = REPLY_BYTES;
+	pRule->TxCnt = ParseHex (pArg, pRule->Tx, MAX_PATTERN);
+	pRule->RxCnt = ParseHex (pRx,  pRule->Rx, MAX_PATTERN);
+	pRx[-1] = '=';
+	if (pRule->TxCnt <= 0  ||  pRule->RxCnt <= 0)
+	    goto error;
+	l_ReplyCnt++;
+    }
+    else if (strcmp (cmd, "reply-op") == 0)
+    {
+	char *pRx = strchr (pArg, '=');
+
+	if (pRx == NULL)
+	    goto error;
+
+	if (*pArg == '*')
+	    num = REPLY_ANY_OP;
+	else if (sscanf (pArg, "%2x", &num) != 1)
+	    goto error;
+
+	/* Replace a rule for the same opcode */
+	for (pRule = l_Reply;  pRule < l_Reply + l_ReplyCnt;  pRule++)
+	    if (pRule->Op == num)
+		break;
+	if (pRule == l_Reply + l_ReplyCnt)
+	{
+	    if (l_ReplyCnt >= MAX_REPLIES)
+		goto error;
+	    l_ReplyCnt++;
+	}
+	pRule->Op    = num;
+	pRule->TxCnt = 0;
+	pRule->RxCnt = ParseHex (pRx + 1, pRule->Rx, MAX_PATTERN);
+	if (pRule->RxCnt <= 0)
+	    goto error;
+    }
+    else if (strcmp (cmd, "reply-delay") == 0)
+    {
+	if (sscanf (pArg, "%d", &num) != 1  ||  num < 0)
+	    goto error;
+	l_ReplyDelay = SIM_MS2TICKS(num);
+    }
+    else if (strcmp (cmd, "card") == 0)
+    {
+	if (strcmp (pArg, "in") != 0  &&  strcmp (pArg, "out") != 0)
+	    goto error;
+	SimDiskInsert (strcmp (pArg, "in") == 0);
+    }
+    else if (strcmp (cmd, "power") == 0)
+    {
+	if (strcmp (pArg, "fail") != 0  &&  strcmp (pArg, "ok") != 0)
+	    goto error;
+
+	/* The power fail signal is low active */
+	SimPinSet (POWER_FAIL_PORT, POWER_FAIL_PIN, strcmp (pArg, "ok") == 0);
+    }
+    else if (strcmp (cmd, "pin") == 0)
+    {
+	if (sscanf (pArg, "%15s %d %15s", arg1, &num, arg2) != 3
+	||  (port = toupper ((unsigned char)arg1[0]) - 'A') < 0  ||  port > 5
+	||  num < 0  ||  num > 15
+	||  (strcmp (arg2, "0") != 0  &&  strcmp (arg2, "1") != 0))
+	    goto error;
+	SimPinSet (port, num, arg2[0] == '1');
+    }
+    else if (strcmp (cmd, "sound") == 0)
+    {
+	/* The edge is only seen while the comparator is enabled */
+	if (SOUND_ACMP->CTRL & ACMP_CTRL_EN)
+	{
+	    SIM_REG(SOUND_ACMP->IF) |= ACMP_IF_EDGE;
+	    if (SOUND_ACMP->IEN & ACMP_IEN_EDGE)
+		SimIrqPost (SoundIrq, 0);
+	}
+    }
+    else if (strcmp (cmd, "supply") == 0)
+    {
+	if (sscanf (pArg, "%d", &num) != 1  ||  num < 0)
+	    goto error;
+
+	/* Result of the ADC conversion at the voltage divider */
+	num = num * 4096 / (SUPPLY_REF_MV * SUPPLY_DIVIDER);
+	SIM_REG(ADC0->SINGLEDATA) = (num > 4095 ? 4095 : num);
+    }
+    else if (strcmp (cmd, "quit") == 0)
+    {
+	SimExit (0);
+    }
+    else
+    {
+	goto error;
+    }
+    return;
+
+error:
+    fprintf (stderr, "%s:%d: invalid event \"%s\"\n",
+	     pEvent->pSource, pEvent->LineNum, pCmd);
+    SimExit (1);
+}
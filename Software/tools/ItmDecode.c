@@ -0,0 +1,429 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Host-side Decoder of the ITM Trace
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This tool decodes a capture of the SWO output of a firmware which has been
+ * built with ITM_TRACE, see "ItmTrace.c", and prints the trace records as a
+ * CSV list with the time of each record, or a summary per ISR, task, and
+ * queue.
+ *
+ * Usage:
+ * @code
+   ItmDecode [-s] [file]
+   @endcode
+ *
+ * The file contains the raw bytes of the ITM protocol as received from the
+ * SWO pin, e.g. by the SWO viewer of the debug probe, or by OpenOCD with
+ * "tpiu config external uart off 14000000 2000000".  Without a file, the
+ * stream is read from stdin.  The synchronization, overflow, hardware, and
+ * timestamp packets are skipped, the text on stimulus port 0 is ignored.
+ *
+ * A record consists of the cycle counter on port @ref ITM_TRACE_PORT and the
+ * record word on the next port.  The time of a record in seconds is derived
+ * from the last record of type SYNC, which contains the lower 24 bits of the
+ * RTC counter, plus the cycles since then at the rate of the last record of
+ * type CLOCK.  Before the first SYNC record, the time is relative to the
+ * first CLOCK record.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+/*=============================== Definitions ================================*/
+
+    /*! Stimulus port of the cycle counter, the record word follows on the
+     *  next port - must match ITM_TRACE_PORT of the firmware */
+#define ITM_TRACE_PORT		1
+
+    /*! Rate of the RTC counter in the SYNC records */
+#define RTC_COUNTS_PER_SEC	32768
+
+    /*! Types of the records - keep in sync with ITM_REC_TYPE of "ItmTrace.h" */
+enum { REC_SYNC, REC_CLOCK, REC_LOST, REC_ISR, REC_TASK, REC_STATE, REC_QUEUE,
+       NUM_REC };
+
+    /*! Maximum number of identifiers per type */
+#define MAX_ID			256
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*! Statistics of an ISR, task, or queue */
+typedef struct
+{
+    unsigned long Cnt;		//!< number of records
+    uint32_t	Min, Max;	//!< minimum and maximum value
+    uint64_t	Sum;		//!< sum of the values
+} STATS;
+
+/*================================ Local Data ================================*/
+
+    /*! Names of the record types, ISRs, tasks, modules, and queues */
+static const char *l_TypeName[NUM_REC] =
+    { "SYNC", "CLOCK", "LOST", "ISR", "TASK", "STATE", "QUEUE" };
+static const char *l_IsrName[] =	// ISR_PROF_ID of "IsrProfile.h"
+    { "RTC", "EXTI", "SMB", "AUDIO_RX", "AUDIO_TX", "RFID_RX", "LEUART_TX",
+      "SD_DMA", "DEFER", NULL };
+static const char *l_TaskName[] =	// EVT_TASK of "config.h"
+    { "COMMAND", "RFID", "DISK", "BATTERY", "AUDIO", "LOG", "STATS",
+      "FORECAST", "TEMP_COMP", "DCF77", "WAKE", NULL };
+static const char *l_ModName[] =	// ITM_MOD of "ItmTrace.h"
+    { "AUDIO", "CONTROL", "LB", "TRANSIT", NULL };
+static const char *l_QueName[] =	// ITM_QUE of "ItmTrace.h"
+    { "DEFER", "RFID", "AUDIO_TX", "LOG", NULL };
+
+    /*! Option -s: only show the summary */
+static bool	l_flgSummary;
+
+    /*! State of the time reconstruction */
+static uint32_t	l_ClockKHz;		// rate of the cycle counter
+static bool	l_flgBase;		// base of the time is valid
+static uint32_t	l_BaseCycles;		// cycle counter at the base
+static double	l_BaseTime;		// time of the base in [s]
+static bool	l_flgSync;		// a SYNC record has been seen
+static uint32_t	l_SyncTicks;		// lower 24 bits of the last SYNC
+static uint64_t	l_SyncWrap;		// wrap-arounds of the 24 bit counter
+
+    /*! Pending cycle counter of the current record */
+static bool	l_flgCycles;
+static uint32_t	l_Cycles;
+
+    /*! Statistics */
+static STATS	l_Stats[NUM_REC][MAX_ID];
+static unsigned long l_Records, l_Lost, l_Overflows, l_Unpaired, l_Text;
+static double	l_FirstTime, l_LastTime;
+
+/*=========================== Forward Declarations ===========================*/
+
+static bool	Decode (FILE *fp);
+static void	Word (int port, uint32_t word);
+static void	Record (uint32_t cycles, uint32_t word);
+static const char *IdName (int type, int id, char *pBuf);
+static void	Summary (void);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Main Routine
+ *
+ ******************************************************************************/
+int	main (int argc, char *argv[])
+{
+bool	 flgOk;
+FILE	*fp = stdin;
+int	 opt;
+
+    while ((opt = getopt (argc, argv, "s")) != -1)
+    {
+	switch (opt)
+	{
+	    case 's':
+		l_flgSummary = true;
+		break;
+
+	    default:
+		optind = argc + 1;
+		break;
+	}
+    }
+
+    if (optind > argc  ||  argc - optind > 1)
+    {
+	fprintf (stderr, "Usage: %s [-s] [file]\n"
+		 "  -s  only show the summary per ISR, task, and queue\n",
+		 argv[0]);
+	return 2;
+    }
+
+    if (optind < argc)
+    {
+	fp = fopen (argv[optind], "rb");
+	if (fp == NULL)
+	{
+	    perror (argv[optind]);
+	    return 1;
+	}
+    }
+
+    if (! l_flgSummary)
+	printf ("Time,Cycles,Type,Id,Value\n");
+
+    flgOk = Decode (fp);
+
+    if (fp != stdin)
+	fclose (fp);
+
+    if (l_Records == 0)
+    {
+	fprintf (stderr, "%s: No trace records found\n", argv[0]);
+	return 1;
+    }
+
+    if (l_flgSummary)
+	Summary();
+
+    return flgOk ? 0 : 1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Decode the ITM Protocol
+ *
+ * This routine reads the packets of the ITM protocol and passes the words of
+ * the software source packets to Word().  An overflow packet discards the
+ * pending cycle counter, because the record word may have been lost.
+ *
+ ******************************************************************************/
+static bool	Decode (FILE *fp)
+{
+int	 hdr, c, size, i;
+uint32_t word;
+
+    while ((hdr = getc (fp)) != EOF)
+    {
+	if (hdr == 0x00  ||  hdr == 0x80)
+	    continue;			// synchronization packet
+
+	if (hdr == 0x70)
+	{
+	    l_Overflows++;		// overflow, data has been lost
+	    l_flgCycles = false;
+	    continue;
+	}
+
+	if ((hdr & 0x03) == 0)
+	{
+	    /* timestamp or extension packet, skip the continuation bytes */
+	    if (hdr & 0x80)
+		while ((c = getc (fp)) != EOF  &&  (c & 0x80))
+		    ;
+	    continue;
+	}
+
+	/* source packet with 1, 2, or 4 bytes of payload */
+	size = (hdr & 0x03) == 3 ? 4 : (hdr & 0x03);
+	for (word = 0, i = 0;  i < size;  i++)
+	{
+	    if ((c = getc (fp)) == EOF)
+	    {
+		fprintf (stderr, "Truncated packet at end of stream\n");
+		return false;
+	    }
+	    word |= (uint32_t)c << (8 * i);
+	}
+
+	if ((hdr & 0x04) == 0)		// hardware source packets are skipped
+	    Word (hdr >> 3, size == 4 ? word : (uint32_t)-1);
+    }
+
+    return ! ferror (fp);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Process a Word of a Stimulus Port
+ *
+ * The trace records are written as 32 bit words, a shorter write is the
+ * text of port 0 or an invalid word, which is passed as -1.
+ *
+ ******************************************************************************/
+static void	Word (int port, uint32_t word)
+{
+    if (port == ITM_TRACE_PORT)
+    {
+	if (l_flgCycles)
+	    l_Unpaired++;		// the record word has been lost
+	l_Cycles = word;
+	l_flgCycles = true;
+    }
+    else if (port == ITM_TRACE_PORT + 1)
+    {
+	if (l_flgCycles  &&  word != (uint32_t)-1)
+	    Record (l_Cycles, word);
+	else
+	    l_Unpaired++;		// the cycle counter has been lost
+	l_flgCycles = false;
+    }
+    else
+    {
+	l_Text++;			// DEBUG_VIA_ITM or another port
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Process a Trace Record
+ *
+ * This routine updates the time base by the SYNC and CLOCK records, and
+ * calculates the time of the record.  It prints the record, or adds it to
+ * the statistics.
+ *
+ ******************************************************************************/
+static void	Record (uint32_t cycles, uint32_t word)
+{
+int	 type  = word >> 28;
+int	 id    = (word >> 20) & 0xFF;
+uint32_t value = word & 0xFFFFF;
+double	 time;
+STATS	*pStats;
+char	 buf[16];
+
+    /* Time of this record, relative to the base */
+    time = l_BaseTime;
+    if (l_flgBase  &&  l_ClockKHz > 0)
+	time += (double)(int32_t)(cycles - l_BaseCycles) / (l_ClockKHz * 1e3);
+
+    switch (type)
+    {
+	case REC_SYNC:			// new base from the RTC counter
+	    value |= (uint32_t)id << 20;
+	    if (l_flgSync  &&  value < l_SyncTicks)
+		l_SyncWrap += 1 << 24;
+	    l_SyncTicks = value;
+	    l_flgSync = true;
+	    time = (double)(l_SyncWrap + value) / RTC_COUNTS_PER_SEC;
+	    l_flgBase = true;
+	    l_BaseCycles = cycles;
+	    l_BaseTime = time;
+	    break;
+
+	case REC_CLOCK:			// new rate from here
+	    l_ClockKHz = value;
+	    l_flgBase = true;
+	    l_BaseCycles = cycles;
+	    l_BaseTime = time;
+	    break;
+
+	case REC_LOST:
+	    l_Lost += value;
+	    break;
+
+	default:
+	    break;
+    }
+
+    if (l_Records++ == 0)
+	l_FirstTime = time;
+    l_LastTime = time;
+
+    if (type < NUM_REC)
+    {
+	pStats = &l_Stats[type][id];
+	if (pStats->Cnt == 0  ||  value < pStats->Min)
+	    pStats->Min = value;
+	if (value > pStats->Max)
+	    pStats->Max = value;
+	pStats->Sum += value;
+	pStats->Cnt++;
+    }
+
+    if (! l_flgSummary)
+	printf ("%.6f,%lu,%s,%s,%lu\n", time, (unsigned long)cycles,
+		type < NUM_REC ? l_TypeName[type] : "?",
+		IdName (type, id, buf), (unsigned long)value);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Name of an Identifier
+ *
+ * This routine returns the name of the ISR, task, module, or queue, or the
+ * number if it is unknown.
+ *
+ ******************************************************************************/
+static const char *IdName (int type, int id, char *pBuf)
+{
+const char **ppName;
+int	 i;
+
+    switch (type)
+    {
+	case REC_ISR:	ppName = l_IsrName;	break;
+	case REC_TASK:	ppName = l_TaskName;	break;
+	case REC_STATE:	ppName = l_ModName;	break;
+	case REC_QUEUE:	ppName = l_QueName;	break;
+	default:	ppName = NULL;		break;
+    }
+
+    for (i = 0;  ppName != NULL  &&  ppName[i] != NULL;  i++)
+	if (i == id)
+	    return ppName[i];
+
+    sprintf (pBuf, "%d", id);
+    return pBuf;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Print the Summary
+ *
+ * This routine prints the number and the cycles of each ISR, the number of
+ * calls of each task, the number of transitions of each module, and the
+ * maximum depth of each queue.
+ *
+ ******************************************************************************/
+static void	Summary (void)
+{
+const STATS *pStats;
+double	 us = l_ClockKHz > 0 ? 1e3 / l_ClockKHz : 0.0;
+char	 buf[16];
+int	 id;
+
+    printf ("%lu records in %.3fs, %lu lost, %lu overflows, %lu unpaired "
+	    "words, clock %lukHz\n", l_Records, l_LastTime - l_FirstTime,
+	    l_Lost, l_Overflows, l_Unpaired, (unsigned long)l_ClockKHz);
+
+    printf ("\n%-10s %8s %8s %8s %8s %10s\n", "ISR", "Count", "Min",
+	    "Avg", "Max", "Max [us]");
+    for (id = 0;  id < MAX_ID;  id++)
+    {
+	pStats = &l_Stats[REC_ISR][id];
+	if (pStats->Cnt > 0)
+	    printf ("%-10s %8lu %8lu %8lu %8lu %10.1f\n",
+		    IdName (REC_ISR, id, buf), pStats->Cnt,
+		    (unsigned long)pStats->Min,
+		    (unsigned long)(pStats->Sum / pStats->Cnt),
+		    (unsigned long)pStats->Max, pStats->Max * us);
+    }
+
+    printf ("\n%-10s %8s\n", "Task", "Calls");
+    for (id = 0;  id < MAX_ID;  id++)
+    {
+	pStats = &l_Stats[REC_TASK][id];
+	if (pStats->Cnt > 0)
+	    printf ("%-10s %8lu\n", IdName (REC_TASK, id, buf), pStats->Cnt);
+    }
+
+    printf ("\n%-10s %8s\n", "State", "Changes");
+    for (id = 0;  id < MAX_ID;  id++)
+    {
+	pStats = &l_Stats[REC_STATE][id];
+	if (pStats->Cnt > 0)
+	    printf ("%-10s %8lu\n", IdName (REC_STATE, id, buf), pStats->Cnt);
+    }
+
+    printf ("\n%-10s %8s %8s\n", "Queue", "Puts", "Max");
+    for (id = 0;  id < MAX_ID;  id++)
+    {
+	pStats = &l_Stats[REC_QUEUE][id];
+	if (pStats->Cnt > 0)
+	    printf ("%-10s %8lu %8lu\n", IdName (REC_QUEUE, id, buf),
+		    pStats->Cnt, (unsigned long)pStats->Max);
+    }
+}
@@ -0,0 +1,2676 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Host-side Analyzer and Decoder of the Box Logs
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This tool reads the log files of many boxes, e.g. <b>BOX0123.TXT</b>, and
+ * generates CSV tables for the analysis, see @ref l_CsvHeader:
+ * - <b>PREFIX_events.csv</b> contains one row per light barrier edge,
+ *   transponder read, playback, recording, clock synchronization, and error.
+ * - <b>PREFIX_visits.csv</b> contains one row per visit, i.e. a series of
+ *   reads of the same transponder, where the gap between two reads is not
+ *   longer than the visit gap (option <b>-g</b>).
+ * - <b>PREFIX_tags.csv</b> contains the totals per box and transponder.
+ * - <b>PREFIX_days.csv</b> contains the totals per box and day.
+ *
+ * Usage:
+ * @code
+   LogAnalyzer [-f AUDIO.UPD] [-a base] [-g gap] [-o prefix] [-p dir]
+	       [-k key] [-d] files...
+   @endcode
+ *
+ * Files with the extension <b>.TXT</b> are text logs.  Each line starts with
+ * the time stamp of logMsg(), i.e. <b>YYYYMMDD-HHMMSS.mmm</b>, lines without
+ * time stamp are counted, but not evaluated.  The box is the basename of the
+ * file.  For segments of @ref LOG_ROTATE, e.g. <b>BOX0123/26101400.TXT</b>,
+ * it is the name of the directory.  Consecutive files of the same box are
+ * processed as one log, so they must be passed in chronological order.
+ *
+ * All other files are binary segments, i.e. a dump of the log buffer, or
+ * of the power-fail journal in flash, see @ref LOG_JOURNAL.  They contain the
+ * entries of the log buffer, which are either text, or binary records of
+ * @ref LOG_BINARY.  A binary record refers to its format string by the
+ * address in flash, so the image of the same build must be specified by
+ * option <b>-f</b>, usually <b>armgcc/exe/AUDIO.UPD</b>.  Its load address
+ * is @ref DFLT_IMAGE_BASE, unless option <b>-a</b> is given.  With option
+ * <b>-d</b> the binary segments are only decoded, and written as text to
+ * stdout, so they can be appended to the respective log file.
+ *
+ * A text log of @ref LOG_ENCRYPT contains a header line with the nonce each
+ * time the box has opened the file, all data after it is encrypted with
+ * AES-128 in counter mode, see "LogCrypt.c".  The key, as provisioned into
+ * the user data page of the box, is specified as 32 hex digits by option
+ * <b>-k</b>.  The header lines are removed when the log is decrypted.  With
+ * option <b>-d</b>, the text logs are written decrypted to stdout.
+ *
+ * The frames of @ref LOG_COMPRESS are decompressed after the decryption.
+ * A damaged frame is reported and discarded, the next frame is searched.
+ *
+ * The integrity records of @ref LOG_INTEGRITY, i.e. the lines
+ * <b>\#CHK seq first last length crc</b>, are verified and removed.  Each
+ * one covers the text after the previous record.  A damaged block is
+ * reported, and it is not evaluated, except with option <b>-d</b>.  Text
+ * after the last record of a file is evaluated without verification.
+ *
+ * The clock of a box is corrected via the <b>DCF77: Time Synchronization</b>
+ * markers.  The jump of the time stamps at a marker is the error of the
+ * clock at this moment.  If there has been a previous marker, the error is
+ * taken as drift, which grew linearly since then.  Otherwise, e.g. after
+ * power-up with an unset clock, all time stamps before the marker are
+ * shifted by this error.  A time stamp that goes back by more than
+ * @ref REBOOT_JUMP_MS starts a new time base, since the box has been reset.
+ * The events are buffered until the next marker, at most @ref MAX_PENDING.
+ * Events after the last marker of a time base are corrected by the drift of
+ * the last <b>DCF77: Clock deviation</b> record, if there is one.
+ *
+ * The times in the tables are ISO 8601, e.g. <b>2020-11-11T10:10:57.564</b>,
+ * without time zone, as the clock of the box runs on local time.
+ *
+ * With option <b>-p</b>, the events of all boxes are merged into one
+ * dataset in the given directory, see @ref l_DsHeader.  Each row carries the
+ * name of the box and its <b>HW-ID</b>, as logged at power-up, so a box can
+ * be identified even if its SD-Card has been moved to another one.  The
+ * dataset also contains the rows of the side files of a box, i.e.
+ * <b>VISITS.BIN</b> of @ref VISIT_RECORDS, <b>STATSnnn.TXT</b> of
+ * @ref VISIT_STATS, and the occupancy timeline <b>LBTIME.BIN</b> of
+ * @ref LB_TIMELINE.  A side file belongs to the box of its directory, or to
+ * the box of the preceding log file.  Their times are those of the box, and
+ * they are corrected like the log lines at the same time, see
+ * @ref DS_KNOT_MS.  The rows are partitioned by day and by transponder:
+ * - <b>days/YYYY-MM-DD.csv</b> contains all rows of a day, sorted by time.
+ * - <b>tags/ID.csv</b> contains all rows of a transponder, sorted by time.
+ * - <b>boxes.csv</b> contains the HW-IDs, row counts, and time ranges of
+ *   the boxes.
+ * - <b>index.csv</b> lists the partitions with their row counts and time
+ *   ranges, so a query only needs to read the partitions it covers.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Fleet dataset partitioned by day and transponder, see option -p.
+		Correct the events after the last synchronization by the drift.
+2026-10-15,agnt	Decompress the frames of LOG_COMPRESS.
+2026-10-15,agnt	Verify the integrity records of LOG_INTEGRITY.
+2026-10-15,agnt	Decrypt text logs of LOG_ENCRYPT, see option -k.
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#define _GNU_SOURCE		// timegm()
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+/*=============================== Definitions ================================*/
+
+    /*! Maximum length of a log line */
+#define MAX_LINE_LEN		512
+
+    /*! Load address of the firmware image, see "efm32g_0x8000.ld" */
+#define DFLT_IMAGE_BASE		0x8000
+
+    /*! Default for the maximum gap in [s] between two reads of a visit */
+#define DFLT_VISIT_GAP		60
+
+    /*! Default prefix of the CSV files */
+#define DFLT_PREFIX		"log"
+
+    /*! A time stamp going back by more than this is a reset of the box */
+#define REBOOT_JUMP_MS		(60 * 1000LL)
+
+    /*! A larger clock error is not treated as drift, but as a time jump */
+#define MAX_DRIFT_MS		(10 * 60 * 1000LL)
+
+    /*! Maximum number of events to be buffered for the clock correction */
+#define MAX_PENDING		(4L * 1024 * 1024)
+
+#define MS_PER_DAY		(24 * 60 * 60 * 1000LL)
+
+    /*! A change of the correction by this amount in [ms] adds a knot */
+#define DS_KNOT_MS		10
+
+    /*!@name Side files of a box, see "config.h". */
+//@{
+#define VISIT_REC_FILE_NAME	"VISITS.BIN"
+#define LB_TIMELINE_FILE_NAME	"LBTIME.BIN"
+#define VISIT_STATS_PREFIX	"STATS"
+#define VISIT_REC_SIZE		32	// size of a visit record or segment
+#define VISIT_REC_MAGIC		0x5256	// "VR", visit record
+#define VISIT_SEG_MAGIC		0x5356	// "VS", segment of a record
+#define VISIT_FLG_ENDED		0x0040	// End is valid
+#define RTC_COUNTS_PER_SEC	32768
+//@}
+
+    /*!@name Log buffer entries and binary records, see "Logging.c". */
+//@{
+#define LOG_ENTRY_BUSY		0xFF	// entry is reserved, not committed
+#define LOG_REC_BINARY		0x01	// marker of a binary record
+#define LOG_REC_FLG_ERROR	0x01	// message has been logged by LogError()
+#define LOG_REC_HDR_SIZE	12	// marker, flags, format, time, and [ms]
+#define LOG_REC_SPEC_CHARS	"-+ #0123456789.hlLqjzt"
+#define LOG_JOURNAL_MAGIC	0x4C4A524EUL	// "LJRN", header is valid
+#define LOG_JOURNAL_HDR_SIZE	16	// IdxGet, IdxPut, BuildTag, Magic
+#define FLASH_PAGE_SIZE		512	// journal data starts at the 2nd page
+//@}
+
+    /*!@name Encryption of the log file, see "LogCrypt.h". */
+//@{
+#define LOG_CRYPT_HDR_TAG	"#LOG-AES-CTR "
+#define LOG_CRYPT_NONCE_SIZE	12	// the block number follows
+#define AES_BLOCKSIZE		16
+//@}
+
+    /*! Tag of an integrity record, see "Logging.c" */
+#define LOG_CHK_TAG		"#CHK "
+
+    /*!@name Compressed frames, see "Logging.c". */
+//@{
+#define LOG_LZ_TAG		"#LZ\r\n"
+#define LOG_LZ_MIN_MATCH	3
+//@}
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*! Type of an event, see @ref l_EventName */
+typedef enum
+{
+    EV_OTHER,			//!< any other message, only counted
+    EV_LB_ON,			//!< light barrier interrupted
+    EV_LB_OFF,			//!< light barrier released
+    EV_READ,			//!< transponder read
+    EV_PLAYBACK,		//!< playback started, parameter is file number
+    EV_RECORD,			//!< recording started
+    EV_SYNC,			//!< clock synchronized by DCF77
+    EV_ERROR,			//!< message of LogError()
+    NUM_EV,
+    DS_VISIT = NUM_EV,		//!< visit record of VISITS.BIN
+    DS_SEGMENT,			//!< record segment of VISITS.BIN
+    DS_OCCUPANCY,		//!< state of the light barriers of LBTIME.BIN
+    DS_STATS,			//!< totals of a transponder of STATSnnn.TXT
+    NUM_DS
+} EV_TYPE;
+
+    /*! Event of a log line, buffered until the clock has been corrected */
+typedef struct
+{
+    int64_t	Stamp;		//!< logged time stamp in [ms]
+    uint64_t	Id;		//!< transponder ID, or 0
+    uint16_t	Param;		//!< light barrier, or file number
+    uint8_t	Type;		//!< see @ref EV_TYPE
+} EVENT;
+
+    /*! Visit of a transponder */
+typedef struct
+{
+    uint64_t	Id;		//!< transponder ID
+    int64_t	Start, End;	//!< time of the first and the last read
+    uint32_t	Reads;		//!< number of reads
+    uint32_t	Playbacks;	//!< number of playbacks
+    uint32_t	Records;	//!< number of recordings
+    uint32_t	LbEdges;	//!< number of interruptions of both barriers
+} VISIT;
+
+    /*! Totals of a transponder */
+typedef struct
+{
+    uint64_t	Id;		//!< transponder ID
+    uint32_t	Visits, Reads, Playbacks, Records;
+    int64_t	Duration;	//!< sum of all visits in [ms]
+    int64_t	First, Last;	//!< start of the first and end of the last visit
+} TAG_STAT;
+
+    /*! Totals of a day */
+typedef struct
+{
+    int64_t	Day;		//!< days since 1970-01-01
+    uint32_t	Lines, Errors, LbOn[2], Reads, Visits, Playbacks, Records;
+    uint32_t	Syncs;
+    int64_t	MaxCorr;	//!< largest clock correction in [ms]
+} DAY_STAT;
+
+    /*! Correction of the clock from a logged time stamp on */
+typedef struct
+{
+    int64_t	Stamp;		//!< logged time stamp in [ms]
+    int64_t	Corr;		//!< correction in [ms]
+} KNOT;
+
+    /*! Row of the dataset, see @ref l_DsHeader */
+typedef struct
+{
+    int64_t	Time;		//!< corrected time in [ms]
+    int64_t	End;		//!< corrected end of a visit in [ms]
+    int64_t	Logged;		//!< time of the box in [ms]
+    uint64_t	Id;		//!< transponder ID, or 0
+    uint32_t	Seq;		//!< order of insertion, makes sorting stable
+    uint32_t	Value;		//!< seconds of a visit, or segment number
+    uint16_t	Box;		//!< index of @ref l_pDsBox
+    uint16_t	Param;		//!< light barrier, file number, or state
+    uint16_t	Flags;		//!< flags of a visit record
+    uint8_t	Type;		//!< see @ref EV_TYPE
+} DS_ROW;
+
+    /*! Box of the dataset, i.e. its name along with a HW-ID */
+typedef struct
+{
+    char	Name[64];	//!< name of the box
+    char	HwId[17];	//!< HW-ID as 16 hex digits, or empty
+    long	Rows;		//!< number of rows
+    int64_t	First, Last;	//!< time of the first and the last row
+} DS_BOX;
+
+    /*! State of the box which is currently processed */
+typedef struct
+{
+    char	 Name[64];	//!< name of the box, e.g. "BOX0123"
+    EVENT	*pPend;		//!< events since the last synchronization
+    long	 PendCnt, PendMax;
+    bool	 flgStamp;	//!< LastStamp is valid
+    int64_t	 LastStamp;	//!< previous logged time stamp
+    bool	 flgSynced;	//!< clock has been synchronized in this time base
+    int64_t	 SyncTime;	//!< time of the last synchronization
+    bool	 flgVisit;	//!< Visit is valid
+    VISIT	 Visit;		//!< current visit
+    TAG_STAT	*pTag;		//!< totals per transponder
+    int		 TagCnt, TagMax;
+    DAY_STAT	*pDay;		//!< totals per day
+    int		 DayCnt, DayMax;
+    char	 HwId[17];	//!< HW-ID of the last "MCU:" line
+    bool	 flgPpm;	//!< DriftPpm is valid
+    long	 DriftPpm;	//!< drift of the last "DCF77: Clock deviation"
+    KNOT	*pKnot;		//!< corrections of the clock, see DS_KNOT_MS
+    long	 KnotCnt, KnotMax;
+    const char **ppSide;	//!< side files, read by BoxEnd()
+    int		 SideCnt, SideMax;
+} BOX;
+
+/*================================ Local Data ================================*/
+
+    /*! Names of the event types for the CSV file */
+static const char *l_EventName[NUM_DS] =
+{ "other", "lb_on", "lb_off", "read", "playback", "record", "sync", "error",
+  "visit", "segment", "occupancy", "stats" };
+
+    /*! Names and headers of the CSV files */
+enum { CSV_EVENTS, CSV_VISITS, CSV_TAGS, CSV_DAYS, NUM_CSV };
+static const char *l_CsvName[NUM_CSV] = { "events", "visits", "tags", "days" };
+static const char *l_CsvHeader[NUM_CSV] =
+{
+    "box,time,logged,type,param,id",
+    "box,id,start,end,duration_s,reads,playbacks,records,lb_edges",
+    "box,id,visits,reads,playbacks,records,duration_s,first,last",
+    "box,date,lines,errors,lb1_on,lb2_on,reads,visits,playbacks,records,"
+	"syncs,clock_corr_ms",
+};
+static FILE	*l_fpCsv[NUM_CSV];
+
+    /*!@brief Header of the partitions of the dataset.
+     *
+     * <b>param</b> is the light barrier, the playback file, the first
+     * playback file of a visit, the record file of a segment, the state of
+     * the light barriers (bit 0 LB1, bit 1 LB2), or the number of visits of
+     * the totals.  <b>value</b> is the perch time of a visit or of the
+     * totals in [s], or the number of a segment.  <b>flags</b> are those of
+     * a visit.  <b>end</b> is only set for a visit which has been ended.
+     */
+static const char *l_DsHeader =
+    "time,end,box,hw_id,type,id,param,value,flags,logged";
+
+    /*! Directory of the dataset (option -p), or NULL */
+static const char *l_pDsDir;
+
+    /*! Rows of the dataset */
+static DS_ROW	*l_pDsRow;
+static long	 l_DsRowCnt, l_DsRowMax;
+
+    /*! Boxes of the dataset, and the index of the current one */
+static DS_BOX	*l_pDsBox;
+static int	 l_DsBoxCnt, l_DsBoxMax, l_DsBoxCur = -1;
+
+    /*! Firmware image for the format strings of binary records */
+static uint8_t	*l_pImage;
+static long	 l_ImageSize;
+static uint32_t	 l_ImageBase = DFLT_IMAGE_BASE;
+
+    /*! Maximum gap between two reads of a visit in [ms] */
+static int64_t	 l_VisitGap = DFLT_VISIT_GAP * 1000LL;
+
+    /*! Binary segments are only decoded to stdout (option -d) */
+static bool	 l_flgDecodeOnly;
+
+    /*! AES-128 key of the encrypted logs (option -k) */
+static uint8_t	 l_Key[AES_BLOCKSIZE];
+static bool	 l_flgKey;
+
+    /*! S-box of AES */
+static const uint8_t l_SBox[256] =
+{
+    0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5,
+    0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+    0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0,
+    0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+    0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC,
+    0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+    0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A,
+    0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+    0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0,
+    0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+    0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B,
+    0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+    0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85,
+    0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+    0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5,
+    0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+    0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17,
+    0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+    0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88,
+    0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+    0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C,
+    0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+    0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9,
+    0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+    0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6,
+    0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+    0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E,
+    0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+    0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94,
+    0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+    0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68,
+    0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16,
+};
+
+    /*! The box which is currently processed */
+static BOX	 l_Box;
+
+    /*! Statistics of the run */
+static long	 l_LineCnt, l_BinRecCnt, l_UnknownFmtCnt, l_JumpCnt;
+static long	 l_ChkOkCnt, l_ChkBadCnt, l_LzBadCnt;
+static long	 l_SideBadCnt;
+
+/*=========================== Forward Declarations ===========================*/
+
+static bool	LoadImage (const char *pFileName);
+static void	BoxName (const char *pFileName, char *pName, int size);
+static bool	IsSideFile (const char *pFileName);
+static void	SideAdd (const char *pFileName);
+static void	BoxBegin (const char *pName);
+static void	BoxEnd (void);
+static bool	ParseKey (const char *pStr);
+static bool	ReadText (const char *pFileName);
+static long	DecryptText (uint8_t *pData, long size, const char *pFileName);
+static uint8_t	*DecompressText (uint8_t *pData, long *pSize,
+				 const char *pFileName);
+static int	DecodeFrame (const uint8_t *pData, long size, uint8_t **ppOut,
+			     long *pOutLen, long *pOutSize);
+static long	VerifyText (uint8_t *pData, long size, const char *pFileName);
+static uint32_t	Crc32 (uint32_t crc, const uint8_t *pData, long len);
+static void	AesEncryptBlock (uint8_t *pBlock, const uint8_t *pKey);
+static bool	ReadBinary (const char *pFileName);
+static void	DecodeEntries (const uint8_t *pData, long size, long idxGet,
+			       long idxPut);
+static int	ExpandRecord (const uint8_t *pRec, int cnt, char *pBuf,
+			      int size);
+static void	HandleLine (const char *pLine);
+static bool	ParseStamp (const char *pLine, int64_t *pStamp);
+static void	FormatTime (int64_t ms, char *pBuf);
+static void	PendAdd (const EVENT *pEv);
+static void	PendFlush (int64_t corr, bool flgDrift);
+static void	PendExtrapolate (void);
+static void	ProcessEvent (const EVENT *pEv, int64_t time);
+static void	VisitEnd (void);
+static TAG_STAT *TagGet (uint64_t id);
+static DAY_STAT *DayGet (int64_t time);
+static int	DayCompare (const void *p1, const void *p2);
+static void	KnotAdd (int64_t stamp, int64_t time);
+static int64_t	KnotCorrect (int64_t stamp);
+static void	ReadSideFile (const char *pFileName);
+static void	ReadVisits (const uint8_t *pData, long size);
+static void	ReadTimeline (const uint8_t *pData, long size);
+static void	ReadStats (const uint8_t *pData, long size);
+static void	DsAdd (DS_ROW *pRow);
+static bool	DsWrite (void);
+static bool	DsMkdir (const char *pName);
+static FILE	*DsOpen (const char *pName, const char *pHeader);
+static void	DsIndex (FILE *fp, const char *pName, const DS_ROW *pRow,
+			 long cnt);
+static void	DsPrint (FILE *fp, const DS_ROW *pRow);
+static int	DsTimeCompare (const void *p1, const void *p2);
+static int	DsTagCompare (const void *p1, const void *p2);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Main Routine
+ *
+ ******************************************************************************/
+int	main (int argc, char *argv[])
+{
+const char *pPrefix = DFLT_PREFIX;
+const char *pImage  = NULL;
+char	 name[sizeof(l_Box.Name)];
+char	 path[256];
+const char *pExt;
+bool	 flgOk = true;
+int	 opt, i;
+
+    while ((opt = getopt (argc, argv, "f:a:g:o:p:k:d")) != -1)
+    {
+	switch (opt)
+	{
+	    case 'f':
+		pImage = optarg;
+		break;
+
+	    case 'a':
+		l_ImageBase = strtoul (optarg, NULL, 0);
+		break;
+
+	    case 'g':
+		l_VisitGap = atoi (optarg) * 1000LL;
+		break;
+
+	    case 'o':
+		pPrefix = optarg;
+		break;
+
+	    case 'p':
+		l_pDsDir = optarg;
+		break;
+
+	    case 'k':
+		if (! ParseKey (optarg))
+		{
+		    fprintf (stderr, "%s: The key must be 32 hex digits\n",
+			     argv[0]);
+		    return 2;
+		}
+		break;
+
+	    case 'd':
+		l_flgDecodeOnly = true;
+		break;
+
+	    default:
+		fprintf (stderr, "Usage: %s [-f image] [-a base] [-g gap] "
+			 "[-o prefix] [-p dir] [-k key] [-d] files...\n"
+			 "  -f  firmware image of the build, e.g. AUDIO.UPD\n"
+			 "  -a  load address of the image, default 0x%X\n"
+			 "  -g  maximum gap between the reads of a visit, "
+			 "default %ds\n"
+			 "  -o  prefix of the CSV files, default \"%s\"\n"
+			 "  -p  directory of the dataset partitioned by day "
+			 "and transponder\n"
+			 "  -k  AES-128 key of encrypted logs, 32 hex digits\n"
+			 "  -d  decode binary segments and decrypt text logs "
+			 "to stdout only\n",
+			 argv[0], DFLT_IMAGE_BASE, DFLT_VISIT_GAP,
+			 DFLT_PREFIX);
+		return 2;
+	}
+    }
+
+    if (pImage != NULL  &&  ! LoadImage (pImage))
+	return 1;
+
+    if (! l_flgDecodeOnly)
+    {
+	for (i = 0;  i < NUM_CSV;  i++)
+	{
+	    snprintf (path, sizeof(path), "%s_%s.csv", pPrefix, l_CsvName[i]);
+	    l_fpCsv[i] = fopen (path, "w");
+	    if (l_fpCsv[i] == NULL)
+	    {
+		perror (path);
+		return 1;
+	    }
+	    fprintf (l_fpCsv[i], "%s\n", l_CsvHeader[i]);
+	}
+    }
+
+    for (i = optind;  i < argc;  i++)
+    {
+	BoxName (argv[i], name, sizeof(name));
+	if (strcmp (name, l_Box.Name) != 0)
+	{
+	    BoxEnd();
+	    BoxBegin (name);
+	}
+
+	pExt = strrchr (argv[i], '.');
+	if (IsSideFile (argv[i]))
+	{
+	    SideAdd (argv[i]);
+	}
+	else if (pExt != NULL  &&  strcasecmp (pExt, ".TXT") == 0)
+	{
+	    flgOk &= ReadText (argv[i]);
+	}
+	else
+	{
+	    flgOk &= ReadBinary (argv[i]);
+	}
+    }
+    BoxEnd();
+
+    for (i = 0;  i < NUM_CSV;  i++)
+    {
+	if (l_fpCsv[i] != NULL)
+	    fclose (l_fpCsv[i]);
+    }
+
+    if (l_pDsDir != NULL  &&  ! l_flgDecodeOnly)
+    {
+	flgOk &= DsWrite();
+	fprintf (stderr, "%ld rows of %d boxes in %s, %ld damaged side file "
+		 "entries\n", l_DsRowCnt, l_DsBoxCnt, l_pDsDir, l_SideBadCnt);
+    }
+
+    fprintf (stderr, "%ld lines, %ld binary records, %ld unknown formats, "
+	     "%ld time jumps, %ld blocks verified, %ld damaged, %ld damaged "
+	     "frames\n", l_LineCnt, l_BinRecCnt, l_UnknownFmtCnt, l_JumpCnt,
+	     l_ChkOkCnt, l_ChkBadCnt, l_LzBadCnt);
+
+    return flgOk ? 0 : 1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Load the Firmware Image
+ *
+ * The image is the binary file of the build, i.e. the content of the flash
+ * from @ref l_ImageBase on.  It contains the format strings of the binary
+ * records.
+ *
+ ******************************************************************************/
+static bool	LoadImage (const char *pFileName)
+{
+FILE	*fp;
+
+    fp = fopen (pFileName, "rb");
+    if (fp == NULL)
+    {
+	perror (pFileName);
+	return false;
+    }
+
+    fseek (fp, 0, SEEK_END);
+    l_ImageSize = ftell (fp);
+    fseek (fp, 0, SEEK_SET);
+
+    l_pImage = malloc (l_ImageSize + 1);
+    if (l_pImage == NULL
+    ||  fread (l_pImage, 1, l_ImageSize, fp) != (size_t)l_ImageSize)
+    {
+	fprintf (stderr, "%s: Read Error\n", pFileName);
+	fclose (fp);
+	return false;
+    }
+    l_pImage[l_ImageSize] = '\0';	// terminate the last string
+
+    fclose (fp);
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the Name of the Box from a File Name
+ *
+ * The name is the basename without extension.  Segments of the log file
+ * rotation are named by date and number, i.e. 8 digits, then the name of
+ * the directory is used.  This also applies to side files, see IsSideFile(),
+ * which belong to the current box if there is no directory.
+ *
+ ******************************************************************************/
+static void	BoxName (const char *pFileName, char *pName, int size)
+{
+const char *pBase, *pEnd, *pDir;
+int	 len, i;
+
+    pBase = strrchr (pFileName, '/');
+    pBase = (pBase != NULL ? pBase + 1 : pFileName);
+    pEnd = strchr (pBase, '.');
+    if (pEnd == NULL)
+	pEnd = pBase + strlen (pBase);
+
+    for (i = 0;  pBase + i < pEnd  &&  isdigit ((unsigned char)pBase[i]);  i++)
+	;
+
+    if (IsSideFile (pFileName)  &&  pBase <= pFileName + 1
+    &&  l_Box.Name[0] != '\0')
+    {
+	/* Side file without directory, it belongs to the current box */
+	snprintf (pName, size, "%s", l_Box.Name);
+	return;
+    }
+
+    if (((i == 8  &&  pBase + i == pEnd)  ||  IsSideFile (pFileName))
+    &&  pBase > pFileName + 1)
+    {
+	/* YYMMDDnn.TXT or side file, use the directory */
+	pEnd = pBase - 1;
+	for (pDir = pEnd;  pDir > pFileName  &&  pDir[-1] != '/';  pDir--)
+	    ;
+	pBase = pDir;
+    }
+
+    len = pEnd - pBase;
+    if (len >= size)
+	len = size - 1;
+    memcpy (pName, pBase, len);
+    pName[len] = '\0';
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Check for a Side File of a Box
+ *
+ * Side files are @ref VISIT_REC_FILE_NAME, @ref LB_TIMELINE_FILE_NAME, and
+ * the daily visit statistics <b>STATSnnn.TXT</b>.
+ *
+ ******************************************************************************/
+static bool	IsSideFile (const char *pFileName)
+{
+const char *pBase;
+int	 i;
+
+    pBase = strrchr (pFileName, '/');
+    pBase = (pBase != NULL ? pBase + 1 : pFileName);
+
+    if (strcasecmp (pBase, VISIT_REC_FILE_NAME) == 0
+    ||  strcasecmp (pBase, LB_TIMELINE_FILE_NAME) == 0)
+	return true;
+
+    if (strncasecmp (pBase, VISIT_STATS_PREFIX, 5) != 0)
+	return false;
+
+    for (i = 5;  i < 8;  i++)
+    {
+	if (! isdigit ((unsigned char)pBase[i]))
+	    return false;
+    }
+    return strcasecmp (pBase + 8, ".TXT") == 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add a Side File to the current Box
+ *
+ * The side files are read by BoxEnd(), when the corrections of the clock
+ * are known from the log.
+ *
+ ******************************************************************************/
+static void	SideAdd (const char *pFileName)
+{
+const char **ppNew;
+
+    if (l_Box.SideCnt >= l_Box.SideMax)
+    {
+	l_Box.SideMax = (l_Box.SideMax ? l_Box.SideMax * 2 : 16);
+	ppNew = realloc (l_Box.ppSide, l_Box.SideMax * sizeof(const char *));
+	if (ppNew == NULL)
+	{
+	    fprintf (stderr, "Out of Memory\n");
+	    exit (1);
+	}
+	l_Box.ppSide = ppNew;
+    }
+
+    l_Box.ppSide[l_Box.SideCnt++] = pFileName;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Begin a new Box
+ *
+ ******************************************************************************/
+static void	BoxBegin (const char *pName)
+{
+    memset (&l_Box, 0, sizeof(l_Box));
+    snprintf (l_Box.Name, sizeof(l_Box.Name), "%s", pName);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	End the current Box
+ *
+ * The remaining events are corrected by PendExtrapolate(), since there is
+ * no further synchronization.  Then the side files are read, and the totals
+ * of the box are written.
+ *
+ ******************************************************************************/
+static void	BoxEnd (void)
+{
+char	 first[32], last[32];
+TAG_STAT *pTag;
+DAY_STAT *pDay;
+int	 i;
+
+    if (l_Box.Name[0] == '\0')
+	return;
+
+    PendExtrapolate();
+    VisitEnd();
+
+    for (i = 0;  i < l_Box.SideCnt;  i++)
+	ReadSideFile (l_Box.ppSide[i]);
+
+    if (! l_flgDecodeOnly)
+    {
+	for (i = 0;  i < l_Box.TagCnt;  i++)
+	{
+	    pTag = &l_Box.pTag[i];
+	    FormatTime (pTag->First, first);
+	    FormatTime (pTag->Last, last);
+	    fprintf (l_fpCsv[CSV_TAGS], "%s,%016llX,%u,%u,%u,%u,%.3f,%s,%s\n",
+		     l_Box.Name, (unsigned long long)pTag->Id, pTag->Visits,
+		     pTag->Reads, pTag->Playbacks, pTag->Records,
+		     pTag->Duration / 1000.0, first, last);
+	}
+
+	qsort (l_Box.pDay, l_Box.DayCnt, sizeof(DAY_STAT), DayCompare);
+	for (i = 0;  i < l_Box.DayCnt;  i++)
+	{
+	    pDay = &l_Box.pDay[i];
+	    FormatTime (pDay->Day * MS_PER_DAY, first);
+	    first[10] = '\0';		// date only
+	    fprintf (l_fpCsv[CSV_DAYS],
+		     "%s,%s,%u,%u,%u,%u,%u,%u,%u,%u,%u,%lld\n",
+		     l_Box.Name, first, pDay->Lines, pDay->Errors,
+		     pDay->LbOn[0], pDay->LbOn[1], pDay->Reads, pDay->Visits,
+		     pDay->Playbacks, pDay->Records, pDay->Syncs,
+		     (long long)pDay->MaxCorr);
+	}
+    }
+
+    free (l_Box.pPend);
+    free (l_Box.pTag);
+    free (l_Box.pDay);
+    free (l_Box.pKnot);
+    free (l_Box.ppSide);
+    memset (&l_Box, 0, sizeof(l_Box));
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Parse the Key of Option -k
+ *
+ ******************************************************************************/
+static bool	ParseKey (const char *pStr)
+{
+int	 i;
+
+    if (strlen (pStr) != 2 * AES_BLOCKSIZE)
+	return false;
+
+    for (i = 0;  i < AES_BLOCKSIZE;  i++)
+    {
+	if (! isxdigit ((unsigned char)pStr[2 * i])
+	||  ! isxdigit ((unsigned char)pStr[2 * i + 1])
+	||  sscanf (pStr + 2 * i, "%2hhx", &l_Key[i]) != 1)
+	    return false;
+    }
+    l_flgKey = true;
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read a Text Log
+ *
+ * The file is read into memory, decrypted by DecryptText(), decompressed by
+ * DecompressText(), and verified by VerifyText().  With option <b>-d</b> it is written to stdout, otherwise
+ * each line is evaluated.
+ *
+ ******************************************************************************/
+static bool	ReadText (const char *pFileName)
+{
+FILE	*fp;
+uint8_t	*pData;
+long	 size;
+char	 line[MAX_LINE_LEN];
+int	 c;
+
+    fp = fopen (pFileName, "rb");
+    if (fp == NULL)
+    {
+	perror (pFileName);
+	return false;
+    }
+
+    fseek (fp, 0, SEEK_END);
+    size = ftell (fp);
+    fseek (fp, 0, SEEK_SET);
+
+    pData = malloc (size + 1);
+    if (pData == NULL  ||  fread (pData, 1, size, fp) != (size_t)size)
+    {
+	fprintf (stderr, "%s: Read Error\n", pFileName);
+	free (pData);
+	fclose (fp);
+	return false;
+    }
+    fclose (fp);
+    pData[size] = '\0';		// terminate the last line
+
+    size = DecryptText (pData, size, pFileName);
+    if (size < 0)
+    {
+	free (pData);
+	return false;
+    }
+    pData = DecompressText (pData, &size, pFileName);
+    if (pData == NULL)
+	return false;
+
+    size = VerifyText (pData, size, pFileName);
+
+    if (l_flgDecodeOnly)
+    {
+	fwrite (pData, 1, size, stdout);
+	free (pData);
+	return true;
+    }
+
+    /* An empty buffer cannot be opened as stream */
+    fp = (size > 0 ? fmemopen (pData, size, "r") : NULL);
+    if (fp == NULL)
+    {
+	free (pData);
+	return size == 0;
+    }
+
+    while (fgets (line, sizeof(line), fp))
+    {
+	/* Discard the rest of an overlong line */
+	if (strchr (line, '\n') == NULL)
+	{
+	    while ((c = getc (fp)) != EOF  &&  c != '\n')
+		;
+	}
+	line[strcspn (line, "\r\n")] = '\0';
+	HandleLine (line);
+    }
+
+    fclose (fp);
+    free (pData);
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Decrypt a Text Log
+ *
+ * A header line of @ref LOG_CRYPT_HDR_TAG may start at the beginning of
+ * each line, since it is plain text.  The data after it is decrypted in
+ * place, the key stream of a byte depends on its offset in the file.  The
+ * header lines are removed.
+ *
+ * @return
+ *	New size of the data, or -1 if the key is missing.
+ *
+ ******************************************************************************/
+static long	DecryptText (uint8_t *pData, long size, const char *pFileName)
+{
+uint8_t	 ctr[AES_BLOCKSIZE];	// counter block, the nonce comes first
+uint8_t	 stream[AES_BLOCKSIZE];	// key stream of the current block
+long	 block = -1;		// block of the key stream
+bool	 flgCrypt = false;	// data is encrypted
+long	 hdrLen = strlen (LOG_CRYPT_HDR_TAG) + 2 * LOG_CRYPT_NONCE_SIZE;
+long	 offs, len = 0;
+int	 i;
+
+    for (offs = 0;  offs < size;  offs++)
+    {
+	/* A header line with a new nonce at the beginning of a line */
+	if ((len == 0  ||  pData[len - 1] == '\n')  &&  size - offs > hdrLen
+	&&  memcmp (pData + offs, LOG_CRYPT_HDR_TAG,
+		    strlen (LOG_CRYPT_HDR_TAG)) == 0)
+	{
+	    if (! l_flgKey)
+	    {
+		fprintf (stderr, "%s: The log is encrypted, use option -k\n",
+			 pFileName);
+		return -1;
+	    }
+	    for (i = 0;  i < LOG_CRYPT_NONCE_SIZE;  i++)
+		sscanf ((char *)pData + offs + strlen (LOG_CRYPT_HDR_TAG)
+			+ 2 * i, "%2hhx", &ctr[i]);
+
+	    /* skip <CR><LF> */
+	    offs += hdrLen;
+	    while (offs < size - 1  &&  pData[offs] != '\n')
+		offs++;
+
+	    flgCrypt = true;
+	    block = -1;
+	    continue;
+	}
+
+	if (flgCrypt)
+	{
+	    if (block != offs / AES_BLOCKSIZE)
+	    {
+		block = offs / AES_BLOCKSIZE;
+		ctr[12] = (uint8_t)(block >> 24);
+		ctr[13] = (uint8_t)(block >> 16);
+		ctr[14] = (uint8_t)(block >> 8);
+		ctr[15] = (uint8_t)block;
+		memcpy (stream, ctr, sizeof(stream));
+		AesEncryptBlock (stream, l_Key);
+	    }
+	    pData[len++] = pData[offs] ^ stream[offs % AES_BLOCKSIZE];
+	}
+	else
+	{
+	    pData[len++] = pData[offs];
+	}
+    }
+
+    return len;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Decompress the Frames of a Text Log
+ *
+ * A frame starts with @ref LOG_LZ_TAG at the beginning of a line, all other
+ * text is copied.  After a damaged frame, the next tag is searched anywhere.
+ *
+ * @return
+ *	New buffer with the text, the old one has been released.  NULL if
+ *	out of memory.
+ *
+ ******************************************************************************/
+static uint8_t	*DecompressText (uint8_t *pData, long *pSize,
+				 const char *pFileName)
+{
+long	 size = *pSize;
+long	 tagLen = strlen (LOG_LZ_TAG);
+long	 outSize = 4 * size + 1;	// size of the output buffer
+long	 out = 0;			// length of the text
+long	 offs = 0;
+bool	 flgResync = false;		// search the next frame
+uint8_t	*pOut, *pTag;
+int	 n;
+
+    pOut = malloc (outSize);
+    while (pOut != NULL  &&  offs < size)
+    {
+	if ((flgResync  ||  out == 0  ||  pOut[out - 1] == '\n')
+	&&  size - offs >= tagLen
+	&&  memcmp (pData + offs, LOG_LZ_TAG, tagLen) == 0)
+	{
+	    offs += tagLen;
+	    n = DecodeFrame (pData + offs, size - offs, &pOut, &out, &outSize);
+	    flgResync = (n < 0);
+	    if (n >= 0)
+	    {
+		offs += n;
+		continue;
+	    }
+
+	    l_LzBadCnt++;
+	    fprintf (stderr, "%s: Compressed frame at offset %ld is damaged\n",
+		     pFileName, offs - tagLen);
+	    pTag = memmem (pData + offs, size - offs, LOG_LZ_TAG, tagLen);
+	    offs = (pTag != NULL ? pTag - pData : size);
+	    continue;
+	}
+
+	if (out + 1 >= outSize)
+	{
+	    outSize *= 2;
+	    pOut = realloc (pOut, outSize);
+	    if (pOut == NULL)
+		break;
+	}
+	pOut[out++] = pData[offs++];
+    }
+
+    free (pData);
+    if (pOut == NULL)
+    {
+	fprintf (stderr, "%s: Out of Memory\n", pFileName);
+	return NULL;
+    }
+
+    pOut[out] = '\0';
+    *pSize = out;
+    return pOut;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Decode a Compressed Frame
+ *
+ * The tokens after @ref LOG_LZ_TAG are decoded up to the terminating 0x00
+ * and \<CR>\<LF>.  The text is appended to the output buffer, which is
+ * enlarged as required.
+ *
+ * @return
+ *	Number of bytes of the frame after the tag, or -1 if it is damaged.
+ *	Then the text of the frame has not been appended.
+ *
+ ******************************************************************************/
+static int	DecodeFrame (const uint8_t *pData, long size, uint8_t **ppOut,
+			     long *pOutLen, long *pOutSize)
+{
+long	 frame = *pOutLen;	// start of the frame in the output
+long	 out = frame;
+long	 offs = 0;
+int	 token, len, dist;
+
+    while (offs < size)
+    {
+	token = pData[offs++];
+	if (token == 0x00)
+	{
+	    /* End of the frame */
+	    if (size - offs < 2  ||  pData[offs] != '\r'
+	    ||  pData[offs + 1] != '\n')
+		break;
+
+	    *pOutLen = out;
+	    return offs + 2;
+	}
+
+	if (token < 0x80)
+	{
+	    len  = token;		// literals
+	    dist = 0;
+	    if (size - offs < len)
+		break;
+	}
+	else
+	{
+	    if (offs >= size)
+		break;
+	    len  = ((token >> 1) & 0x3F) + LOG_LZ_MIN_MATCH;
+	    dist = ((token & 0x01) << 8 | pData[offs++]) + 1;
+	    if (dist > out - frame)
+		break;
+	}
+
+	if (out + len + 1 >= *pOutSize)
+	{
+	    *pOutSize = 2 * (out + len + 1);
+	    *ppOut = realloc (*ppOut, *pOutSize);
+	    if (*ppOut == NULL)
+		return -1;
+	}
+
+	if (dist == 0)
+	{
+	    memcpy (*ppOut + out, pData + offs, len);
+	    offs += len;
+	    out  += len;
+	}
+	else
+	{
+	    /* A match may overlap the text it produces */
+	    for ( ;  len > 0;  len--, out++)
+		(*ppOut)[out] = (*ppOut)[out - dist];
+	}
+    }
+
+    return -1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Verify the Integrity Records of a Text Log
+ *
+ * The CRC-32 and the length of the text since the previous record are
+ * compared with each record.  The records are removed, as well as damaged
+ * blocks, unless option <b>-d</b> is set.
+ *
+ * @return
+ *	New size of the data.
+ *
+ ******************************************************************************/
+static long	VerifyText (uint8_t *pData, long size, const char *pFileName)
+{
+uint32_t crc = 0xFFFFFFFF;	// CRC-32 of the current block
+unsigned long seq, len, crcRec;
+char	 first[20], last[20];
+const uint8_t *pEnd;
+long	 start = 0;		// start of the current block in the output
+long	 offs, next, out = 0;
+
+    for (offs = 0;  offs < size;  offs = next)
+    {
+	pEnd = memchr (pData + offs, '\n', size - offs);
+	next = (pEnd != NULL ? pEnd - pData + 1 : size);
+
+	if (memcmp (pData + offs, LOG_CHK_TAG, strlen (LOG_CHK_TAG)) == 0
+	&&  sscanf ((char *)pData + offs + strlen (LOG_CHK_TAG),
+		    "%lu %19s %19s %lu %lx", &seq, first, last, &len,
+		    &crcRec) == 5)
+	{
+	    if (len == (unsigned long)(out - start)  &&  crcRec == ~crc)
+	    {
+		l_ChkOkCnt++;
+	    }
+	    else
+	    {
+		l_ChkBadCnt++;
+		fprintf (stderr, "%s: Block %lu (%s - %s) is damaged\n",
+			 pFileName, seq, first, last);
+		if (! l_flgDecodeOnly)
+		    out = start;	// discard the damaged block
+	    }
+	    start = out;
+	    crc = 0xFFFFFFFF;
+	    continue;
+	}
+
+	crc = Crc32 (crc, pData + offs, next - offs);
+	memmove (pData + out, pData + offs, next - offs);
+	out += next - offs;
+    }
+
+    return out;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Update a CRC-32
+ *
+ * This is the CRC-32 of zlib, as calculated by logCrc32() of the box.
+ *
+ ******************************************************************************/
+static uint32_t	Crc32 (uint32_t crc, const uint8_t *pData, long len)
+{
+int	 i;
+
+    while (len-- > 0)
+    {
+	crc ^= *pData++;
+	for (i = 0;  i < 8;  i++)
+	    crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+    }
+    return crc;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Encrypt an AES Block
+ *
+ * This is AES-128 as done by the AES peripheral of the box.  The round keys
+ * are expanded on the fly.
+ *
+ ******************************************************************************/
+static void	AesEncryptBlock (uint8_t *pBlock, const uint8_t *pKey)
+{
+uint8_t	 rk[AES_BLOCKSIZE];	// key of the current round
+uint8_t	 t[AES_BLOCKSIZE];
+uint8_t	 rcon = 0x01;
+int	 round, c, i;
+
+    memcpy (rk, pKey, sizeof(rk));
+    for (i = 0;  i < AES_BLOCKSIZE;  i++)
+	pBlock[i] ^= rk[i];
+
+    for (round = 1;  round <= 10;  round++)
+    {
+	/* SubBytes and ShiftRows */
+	for (i = 0;  i < AES_BLOCKSIZE;  i++)
+	    t[i] = l_SBox[pBlock[(i + 4 * (i % 4)) % AES_BLOCKSIZE]];
+
+	/* MixColumns, except in the last round */
+	for (c = 0;  c < 4  &&  round < 10;  c++)
+	{
+	    uint8_t *p = t + 4 * c;
+	    uint8_t  a = p[0] ^ p[1] ^ p[2] ^ p[3];
+	    uint8_t  p0 = p[0];
+
+	    for (i = 0;  i < 4;  i++)
+	    {
+		uint8_t x = p[i] ^ (i < 3 ? p[i + 1] : p0);
+		x = (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1B : 0x00));
+		p[i] ^= a ^ x;
+	    }
+	}
+
+	/* Next round key */
+	rk[0] ^= l_SBox[rk[13]] ^ rcon;
+	rk[1] ^= l_SBox[rk[14]];
+	rk[2] ^= l_SBox[rk[15]];
+	rk[3] ^= l_SBox[rk[12]];
+	for (i = 4;  i < AES_BLOCKSIZE;  i++)
+	    rk[i] ^= rk[i - 4];
+	rcon = (uint8_t)((rcon << 1) ^ ((rcon & 0x80) ? 0x1B : 0x00));
+
+	/* AddRoundKey */
+	for (i = 0;  i < AES_BLOCKSIZE;  i++)
+	    pBlock[i] = t[i] ^ rk[i];
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read a Binary Segment
+ *
+ * A dump of the power-fail journal is identified by the magic number of its
+ * header, the entries are located in the second flash page.  Any other file
+ * is taken as dump of the log buffer, which is decoded from the beginning.
+ *
+ ******************************************************************************/
+static bool	ReadBinary (const char *pFileName)
+{
+FILE	*fp;
+uint8_t	*pData;
+long	 size;
+uint32_t hdr[LOG_JOURNAL_HDR_SIZE / 4];
+
+    fp = fopen (pFileName, "rb");
+    if (fp == NULL)
+    {
+	perror (pFileName);
+	return false;
+    }
+
+    fseek (fp, 0, SEEK_END);
+    size = ftell (fp);
+    fseek (fp, 0, SEEK_SET);
+
+    pData = malloc (size + 1);
+    if (pData == NULL  ||  fread (pData, 1, size, fp) != (size_t)size)
+    {
+	fprintf (stderr, "%s: Read Error\n", pFileName);
+	free (pData);
+	fclose (fp);
+	return false;
+    }
+    fclose (fp);
+
+    /* Target and host are little endian */
+    if (size > FLASH_PAGE_SIZE)
+	memcpy (hdr, pData, sizeof(hdr));
+
+    if (size > FLASH_PAGE_SIZE  &&  hdr[3] == LOG_JOURNAL_MAGIC)
+    {
+	DecodeEntries (pData + FLASH_PAGE_SIZE, size - FLASH_PAGE_SIZE,
+		       hdr[0], hdr[1]);
+    }
+    else
+    {
+	DecodeEntries (pData, size, 0, -1);
+    }
+
+    free (pData);
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Decode the Entries of a Log Buffer
+ *
+ * Each entry consists of a length byte, the text or binary record, which
+ * ends with \<NL\>, and an EOS.  A length of 0 marks the wrap-around to the
+ * start of the buffer.  The same consistency check as in LogFlush() is
+ * applied.  In a plain dump an invalid entry is skipped byte by byte.
+ *
+ * @param[in] idxPut
+ *	Index after the last entry, or -1 to decode the whole buffer.
+ *
+ ******************************************************************************/
+static void	DecodeEntries (const uint8_t *pData, long size, long idxGet,
+			       long idxPut)
+{
+char	 text[MAX_LINE_LEN];
+bool	 flgWrapped = false;
+long	 idx, cnt;
+int	 len;
+
+    for (idx = idxGet;  idx < size  &&  idx != idxPut;  )
+    {
+	cnt = pData[idx];
+	if (cnt == 0)
+	{
+	    if (idxPut < 0)
+	    {
+		idx++;
+		continue;
+	    }
+	    if (flgWrapped)
+		break;		// inconsistent journal
+	    flgWrapped = true;
+	    idx = 0;
+	    continue;
+	}
+
+	if (cnt == LOG_ENTRY_BUSY  ||  idx + cnt + 2 > size
+	||  pData[idx + cnt] != '\n')
+	{
+	    if (idxPut >= 0)
+		break;		// inconsistent journal
+	    idx++;
+	    continue;
+	}
+
+	if (pData[idx + 1] == LOG_REC_BINARY)
+	{
+	    len = ExpandRecord (pData + idx + 1, cnt, text, sizeof(text));
+	    l_BinRecCnt++;
+	}
+	else
+	{
+	    len = (cnt - 1 < (long)sizeof(text) ? cnt - 1 : (long)sizeof(text) - 1);
+	    memcpy (text, pData + idx + 1, len);
+	}
+	text[len] = '\0';
+	text[strcspn (text, "\r\n")] = '\0';
+
+	if (l_flgDecodeOnly)
+	    printf ("%s\r\n", text);
+	else
+	    HandleLine (text);
+
+	idx += cnt + 2;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Expand a Binary Record to Text
+ *
+ * This routine generates the same text as logExpand() in "Logging.c".  The
+ * format string is taken from the firmware image.  The arguments are 32bit
+ * words on the target, so the length modifiers are replaced for the host.
+ * The system clock of the box uses a 2-digit year in tm_year, i.e. the UNIX
+ * time of the record is in the 20th century.
+ *
+ * @param[in] pRec
+ *	Address of the binary record, i.e. the byte after the length byte.
+ *
+ * @param[in] cnt
+ *	Size of the record, including the final \<NL\>.
+ *
+ * @return
+ *	Length of the text.
+ *
+ ******************************************************************************/
+static int	ExpandRecord (const uint8_t *pRec, int cnt, char *pBuf,
+			      int size)
+{
+const uint8_t *pArg = pRec + LOG_REC_HDR_SIZE;
+const uint8_t *pArgEnd = pRec + cnt - 1;
+const char *pFrmt;
+char	 spec[16];
+char	 fmtUnknown[32];
+struct tm tm;
+time_t	 t;
+uint32_t addr, word;
+uint64_t dword;
+int	 len, n, longCnt;
+char	 conv;
+
+    if (cnt < LOG_REC_HDR_SIZE + 1)
+	return snprintf (pBuf, size, "00000000-000000.000 <short record>");
+
+    memcpy (&addr, pRec + 2, sizeof(addr));
+    memcpy (&word, pRec + 6, sizeof(word));
+    t = (time_t)(int32_t)word;
+    gmtime_r (&t, &tm);
+
+    if (tm.tm_year != 0)
+	len = snprintf (pBuf, size, "20%02d%02d%02d-%02d%02d%02d.%03d ",
+			tm.tm_year % 100, tm.tm_mon + 1, tm.tm_mday,
+			tm.tm_hour, tm.tm_min, tm.tm_sec,
+			pRec[10] | (pRec[11] << 8));
+    else
+	len = snprintf (pBuf, size, "00000000-000000.000 ");
+
+    if (pRec[1] & LOG_REC_FLG_ERROR)
+	len += snprintf (pBuf + len, size - len, "ERROR ");
+
+    if (l_pImage != NULL  &&  addr >= l_ImageBase
+    &&  addr - l_ImageBase < (uint32_t)l_ImageSize)
+    {
+	pFrmt = (const char *)l_pImage + (addr - l_ImageBase);
+    }
+    else
+    {
+	/* Without image the arguments cannot be interpreted */
+	snprintf (fmtUnknown, sizeof(fmtUnknown), "<format 0x%08X>", addr);
+	pFrmt = fmtUnknown;
+	l_UnknownFmtCnt++;
+    }
+
+    while (*pFrmt != '\0'  &&  len < size - 1)
+    {
+	if (*pFrmt != '%')
+	{
+	    pBuf[len++] = *pFrmt++;
+	    continue;
+	}
+
+	if (pFrmt[1] == '%')
+	{
+	    pBuf[len++] = '%';
+	    pFrmt += 2;
+	    continue;
+	}
+
+	/* Copy flags, width, and precision, count the "l" modifiers */
+	n = 0;
+	spec[n++] = *pFrmt++;
+	for (longCnt = 0;  *pFrmt != '\0'  &&  strchr (LOG_REC_SPEC_CHARS, *pFrmt);
+	     pFrmt++)
+	{
+	    if (*pFrmt == 'l')
+		longCnt++;
+	    else if (! strchr ("hLqjzt", *pFrmt)  &&  n < (int)sizeof(spec) - 4)
+		spec[n++] = *pFrmt;
+	}
+	if (*pFrmt == '\0')
+	    break;
+	conv = *pFrmt++;
+
+	if (conv == 's')
+	{
+	    spec[n++] = 's';
+	    spec[n] = '\0';
+	    n = strnlen ((const char *)pArg, pArgEnd - pArg);
+	    if (pArg + n >= pArgEnd)
+		break;			// inconsistent record
+	    len += snprintf (pBuf + len, size - len, spec, (const char *)pArg);
+	    pArg += n + 1;
+	}
+	else if (longCnt >= 2)
+	{
+	    if (pArg + sizeof(dword) > pArgEnd)
+		break;
+	    memcpy (&dword, pArg, sizeof(dword));
+	    pArg += sizeof(dword);
+	    spec[n++] = 'l';
+	    spec[n++] = 'l';
+	    spec[n++] = conv;
+	    spec[n] = '\0';
+	    len += snprintf (pBuf + len, size - len, spec, dword);
+	}
+	else
+	{
+	    if (pArg + sizeof(word) > pArgEnd)
+		break;
+	    memcpy (&word, pArg, sizeof(word));
+	    pArg += sizeof(word);
+	    if (conv == 'p')
+	    {
+		len += snprintf (pBuf + len, size - len, "0x%x", word);
+		continue;
+	    }
+	    spec[n++] = conv;
+	    spec[n] = '\0';
+	    if (conv == 'd'  ||  conv == 'i')
+		len += snprintf (pBuf + len, size - len, spec, (int32_t)word);
+	    else
+		len += snprintf (pBuf + len, size - len, spec, word);
+	}
+    }
+
+    if (len > size - 1)
+	len = size - 1;		// text has been truncated
+
+    return len;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Handle a Line of the Log
+ *
+ * The message is classified as event, and buffered until the clock can be
+ * corrected.  A synchronization marker flushes the buffer.  The HW-ID and
+ * the drift of the clock are stored for the box.
+ *
+ ******************************************************************************/
+static void	HandleLine (const char *pLine)
+{
+EVENT	 ev;
+const char *pMsg, *pHwId;
+char	 id[17];
+int64_t	 stamp, corr;
+unsigned int num;
+long	 delta, elapsed, ppm;
+
+    l_LineCnt++;
+
+    if (! ParseStamp (pLine, &stamp))
+	return;
+    pMsg = pLine + 20;
+
+    memset (&ev, 0, sizeof(ev));
+    ev.Stamp = stamp;
+    ev.Type = EV_OTHER;
+
+    if (strncmp (pMsg, "ERROR ", 6) == 0)
+    {
+	ev.Type = EV_ERROR;
+    }
+    else if (strncmp (pMsg, "LB", 2) == 0  &&  (pMsg[2] == '1' || pMsg[2] == '2')
+	 &&  (strcmp (pMsg + 3, ":ON") == 0  ||  strcmp (pMsg + 3, ":off") == 0))
+    {
+	ev.Type  = (pMsg[4] == 'O' ? EV_LB_ON : EV_LB_OFF);
+	ev.Param = pMsg[2] - '0';
+    }
+    else if ((sscanf (pMsg, "Transponder: %16[0-9A-F]", id) == 1
+	      &&  strlen (id) == 16  &&  pMsg[29] == ':')
+	 ||  (sscanf (pMsg, "Transponder %16[0-9A-F]", id) == 1
+	      &&  strlen (id) == 16  &&  strncmp (pMsg + 28, " arrived", 8) == 0))
+    {
+	ev.Type = EV_READ;
+	ev.Id = strtoull (id, NULL, 16);
+    }
+    else if (sscanf (pMsg, "Audio: Playback ON [P%u", &num) == 1)
+    {
+	ev.Type  = EV_PLAYBACK;
+	ev.Param = num;
+    }
+    else if (strncmp (pMsg, "Audio: Record ON", 16) == 0)
+    {
+	ev.Type = EV_RECORD;
+    }
+    else if (strncmp (pMsg, "DCF77: Time Synchronization", 27) == 0)
+    {
+	ev.Type = EV_SYNC;
+    }
+    else if (sscanf (pMsg, "DCF77: Clock deviation %ldms in %lds (%ldppm)",
+		     &delta, &elapsed, &ppm) == 3)
+    {
+	l_Box.flgPpm   = true;
+	l_Box.DriftPpm = ppm;
+    }
+    else if (strncmp (pMsg, "MCU: ", 5) == 0
+	 &&  (pHwId = strstr (pMsg, " HW-ID: 0x")) != NULL)
+    {
+	snprintf (l_Box.HwId, sizeof(l_Box.HwId), "%.16s", pHwId + 10);
+    }
+
+    if (ev.Type == EV_SYNC)
+    {
+	/* The jump of the time stamps is the error of the clock */
+	corr = (l_Box.flgStamp ? stamp - l_Box.LastStamp : 0);
+
+	if (l_Box.flgSynced  &&  llabs (corr) > MAX_DRIFT_MS)
+	{
+	    l_JumpCnt++;
+	    PendFlush (0, false);	// not a drift, leave it uncorrected
+	}
+	else
+	{
+	    PendFlush (corr, l_Box.flgSynced);
+	}
+
+	ProcessEvent (&ev, stamp);
+	if (llabs (corr) > llabs (DayGet (stamp)->MaxCorr))
+	    DayGet (stamp)->MaxCorr = corr;
+
+	l_Box.flgSynced = true;
+	l_Box.SyncTime  = stamp;
+    }
+    else
+    {
+	if (l_Box.flgStamp  &&  stamp < l_Box.LastStamp - REBOOT_JUMP_MS)
+	{
+	    /* Reset of the box, start a new time base */
+	    l_JumpCnt++;
+	    PendExtrapolate();
+	    l_Box.flgSynced = false;
+	}
+	PendAdd (&ev);
+    }
+
+    l_Box.flgStamp  = true;
+    l_Box.LastStamp = stamp;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Parse the Time Stamp of a Log Line
+ *
+ * The time stamp <b>YYYYMMDD-HHMMSS.mmm</b> is followed by a space.  The
+ * time stamp of an unset clock, i.e. <b>00000000-000000.000</b>, is taken as
+ * 1970-01-01.
+ *
+ * @return
+ *	true if the line starts with a time stamp.
+ *
+ ******************************************************************************/
+static bool	ParseStamp (const char *pLine, int64_t *pStamp)
+{
+struct tm tm;
+int	 i, year, mon, day, ms;
+
+    for (i = 0;  i < 19;  i++)
+    {
+	if (i == 8 ? pLine[i] != '-'
+	  : i == 15 ? pLine[i] != '.' : ! isdigit ((unsigned char)pLine[i]))
+	    return false;
+    }
+    if (pLine[19] != ' ')
+	return false;
+
+    memset (&tm, 0, sizeof(tm));
+    if (sscanf (pLine, "%4d%2d%2d-%2d%2d%2d.%3d", &year, &mon, &day,
+		&tm.tm_hour, &tm.tm_min, &tm.tm_sec, &ms) != 7)
+	return false;
+
+    if (year == 0)
+    {
+	year = 1970;
+	mon = day = 1;
+    }
+    tm.tm_year = year - 1900;
+    tm.tm_mon  = mon - 1;
+    tm.tm_mday = day;
+
+    *pStamp = (int64_t)timegm (&tm) * 1000 + ms;
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Format a Time in [ms] as ISO 8601
+ *
+ * @param[out] pBuf
+ *	Buffer of at least 24 characters.
+ *
+ ******************************************************************************/
+static void	FormatTime (int64_t ms, char *pBuf)
+{
+time_t	 t;
+struct tm tm;
+int	 frac;
+
+    frac = (int)(ms % 1000);
+    if (frac < 0)
+	frac += 1000;
+    t = (time_t)((ms - frac) / 1000);
+    gmtime_r (&t, &tm);
+
+    sprintf (pBuf, "%04d-%02d-%02dT%02d:%02d:%02d.%03d",
+	     (tm.tm_year + 1900) % 10000, tm.tm_mon + 1, tm.tm_mday,
+	     tm.tm_hour, tm.tm_min, tm.tm_sec, frac);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Buffer an Event until the Clock is Corrected
+ *
+ ******************************************************************************/
+static void	PendAdd (const EVENT *pEv)
+{
+EVENT	*pNew;
+
+    if (l_Box.PendCnt >= MAX_PENDING)
+    {
+	/* No synchronization for too long, continue without correction */
+	fprintf (stderr, "%s: No DCF77 synchronization within %ld events\n",
+		 l_Box.Name, MAX_PENDING);
+	PendFlush (0, false);
+    }
+
+    if (l_Box.PendCnt >= l_Box.PendMax)
+    {
+	l_Box.PendMax = (l_Box.PendMax ? l_Box.PendMax * 2 : 1024);
+	pNew = realloc (l_Box.pPend, l_Box.PendMax * sizeof(EVENT));
+	if (pNew == NULL)
+	{
+	    fprintf (stderr, "Out of Memory\n");
+	    exit (1);
+	}
+	l_Box.pPend = pNew;
+    }
+
+    l_Box.pPend[l_Box.PendCnt++] = *pEv;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Correct and Process the Buffered Events
+ *
+ * @param[in] corr
+ *	Error of the clock in [ms] at the end of the buffered events.
+ *
+ * @param[in] flgDrift
+ *	If true, the error has grown linearly since @ref BOX::SyncTime, else
+ *	all events are shifted by the error.
+ *
+ ******************************************************************************/
+static void	PendFlush (int64_t corr, bool flgDrift)
+{
+const EVENT *pEv;
+int64_t	 span, time;
+long	 i;
+
+    span = l_Box.LastStamp - l_Box.SyncTime;
+
+    for (i = 0;  i < l_Box.PendCnt;  i++)
+    {
+	pEv = &l_Box.pPend[i];
+	time = pEv->Stamp;
+
+	if (! flgDrift)
+	    time += corr;
+	else if (span > 0  &&  time > l_Box.SyncTime)
+	    time += corr * (time - l_Box.SyncTime) / span;
+
+	ProcessEvent (pEv, time);
+    }
+
+    l_Box.PendCnt = 0;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Correct the Buffered Events by the Drift
+ *
+ * There is no further synchronization in this time base.  If the drift of
+ * the clock is known, its error has grown linearly since the last one,
+ * otherwise the events are processed without correction.  A positive drift
+ * means the clock of the box is slow, see DCF77.c.
+ *
+ ******************************************************************************/
+static void	PendExtrapolate (void)
+{
+    if (l_Box.flgSynced  &&  l_Box.flgPpm)
+	PendFlush ((l_Box.LastStamp - l_Box.SyncTime) * l_Box.DriftPpm
+		   / 1000000, true);
+    else
+	PendFlush (0, false);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Process an Event at its Corrected Time
+ *
+ ******************************************************************************/
+static void	ProcessEvent (const EVENT *pEv, int64_t time)
+{
+DAY_STAT *pDay;
+VISIT	*pVisit = &l_Box.Visit;
+bool	 flgInVisit;
+char	 str[32], logged[32];
+DS_ROW	 row;
+
+    if (l_flgDecodeOnly)
+	return;
+
+    if (l_pDsDir != NULL)
+	KnotAdd (pEv->Stamp, time);
+
+    pDay = DayGet (time);
+    pDay->Lines++;
+
+    if (pEv->Type != EV_OTHER)
+    {
+	FormatTime (time, str);
+	FormatTime (pEv->Stamp, logged);
+	fprintf (l_fpCsv[CSV_EVENTS], "%s,%s,%s,%s,", l_Box.Name, str, logged,
+		 l_EventName[pEv->Type]);
+	if (pEv->Type == EV_LB_ON  ||  pEv->Type == EV_LB_OFF
+	||  pEv->Type == EV_PLAYBACK)
+	    fprintf (l_fpCsv[CSV_EVENTS], "%u", pEv->Param);
+	if (pEv->Type == EV_READ)
+	    fprintf (l_fpCsv[CSV_EVENTS], ",%016llX\n",
+		     (unsigned long long)pEv->Id);
+	else
+	    fprintf (l_fpCsv[CSV_EVENTS], ",\n");
+
+	if (l_pDsDir != NULL)
+	{
+	    memset (&row, 0, sizeof(row));
+	    row.Time   = time;
+	    row.Logged = pEv->Stamp;
+	    row.Id     = pEv->Id;
+	    row.Param  = pEv->Param;
+	    row.Type   = pEv->Type;
+	    DsAdd (&row);
+	}
+    }
+
+    flgInVisit = (l_Box.flgVisit  &&  time - pVisit->End <= l_VisitGap);
+
+    switch (pEv->Type)
+    {
+	case EV_READ:
+	    pDay->Reads++;
+	    if (flgInVisit  &&  pEv->Id == pVisit->Id)
+	    {
+		pVisit->Reads++;
+		if (time > pVisit->End)
+		    pVisit->End = time;
+		break;
+	    }
+	    VisitEnd();
+	    memset (pVisit, 0, sizeof(*pVisit));
+	    pVisit->Id    = pEv->Id;
+	    pVisit->Start = pVisit->End = time;
+	    pVisit->Reads = 1;
+	    l_Box.flgVisit = true;
+	    break;
+
+	case EV_LB_ON:
+	    pDay->LbOn[pEv->Param == 2]++;
+	    if (flgInVisit)
+		pVisit->LbEdges++;
+	    break;
+
+	case EV_PLAYBACK:
+	    pDay->Playbacks++;
+	    if (flgInVisit)
+		pVisit->Playbacks++;
+	    break;
+
+	case EV_RECORD:
+	    pDay->Records++;
+	    if (flgInVisit)
+		pVisit->Records++;
+	    break;
+
+	case EV_SYNC:
+	    pDay->Syncs++;
+	    break;
+
+	case EV_ERROR:
+	    pDay->Errors++;
+	    break;
+
+	default:
+	    break;
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	End the current Visit
+ *
+ * The visit is written, and added to the totals of its transponder and day.
+ *
+ ******************************************************************************/
+static void	VisitEnd (void)
+{
+VISIT	*pVisit = &l_Box.Visit;
+TAG_STAT *pTag;
+char	 start[32], end[32];
+
+    if (! l_Box.flgVisit)
+	return;
+    l_Box.flgVisit = false;
+
+    FormatTime (pVisit->Start, start);
+    FormatTime (pVisit->End, end);
+    fprintf (l_fpCsv[CSV_VISITS], "%s,%016llX,%s,%s,%.3f,%u,%u,%u,%u\n",
+	     l_Box.Name, (unsigned long long)pVisit->Id, start, end,
+	     (pVisit->End - pVisit->Start) / 1000.0, pVisit->Reads,
+	     pVisit->Playbacks, pVisit->Records, pVisit->LbEdges);
+
+    pTag = TagGet (pVisit->Id);
+    if (pTag->Visits == 0  ||  pVisit->Start < pTag->First)
+	pTag->First = pVisit->Start;
+    if (pTag->Visits == 0  ||  pVisit->End > pTag->Last)
+	pTag->Last = pVisit->End;
+    pTag->Visits++;
+    pTag->Reads     += pVisit->Reads;
+    pTag->Playbacks += pVisit->Playbacks;
+    pTag->Records   += pVisit->Records;
+    pTag->Duration  += pVisit->End - pVisit->Start;
+
+    DayGet (pVisit->Start)->Visits++;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the Totals of a Transponder, a new Entry is Allocated
+ *
+ ******************************************************************************/
+static TAG_STAT *TagGet (uint64_t id)
+{
+TAG_STAT *pNew;
+int	 i;
+
+    for (i = 0;  i < l_Box.TagCnt;  i++)
+    {
+	if (l_Box.pTag[i].Id == id)
+	    return &l_Box.pTag[i];
+    }
+
+    if (l_Box.TagCnt >= l_Box.TagMax)
+    {
+	l_Box.TagMax = (l_Box.TagMax ? l_Box.TagMax * 2 : 64);
+	pNew = realloc (l_Box.pTag, l_Box.TagMax * sizeof(TAG_STAT));
+	if (pNew == NULL)
+	{
+	    fprintf (stderr, "Out of Memory\n");
+	    exit (1);
+	}
+	l_Box.pTag = pNew;
+    }
+
+    pNew = &l_Box.pTag[l_Box.TagCnt++];
+    memset (pNew, 0, sizeof(*pNew));
+    pNew->Id = id;
+
+    return pNew;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Get the Totals of a Day, a new Entry is Allocated
+ *
+ * The search starts with the most recent day, which is the usual case.
+ *
+ ******************************************************************************/
+static DAY_STAT *DayGet (int64_t time)
+{
+DAY_STAT *pNew;
+int64_t	 day;
+int	 i;
+
+    day = time / MS_PER_DAY - (time % MS_PER_DAY < 0);
+
+    for (i = l_Box.DayCnt - 1;  i >= 0;  i--)
+    {
+	if (l_Box.pDay[i].Day == day)
+	    return &l_Box.pDay[i];
+    }
+
+    if (l_Box.DayCnt >= l_Box.DayMax)
+    {
+	l_Box.DayMax = (l_Box.DayMax ? l_Box.DayMax * 2 : 64);
+	pNew = realloc (l_Box.pDay, l_Box.DayMax * sizeof(DAY_STAT));
+	if (pNew == NULL)
+	{
+	    fprintf (stderr, "Out of Memory\n");
+	    exit (1);
+	}
+	l_Box.pDay = pNew;
+    }
+
+    pNew = &l_Box.pDay[l_Box.DayCnt++];
+    memset (pNew, 0, sizeof(*pNew));
+    pNew->Day = day;
+
+    return pNew;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Compare two Days for qsort()
+ *
+ ******************************************************************************/
+static int	DayCompare (const void *p1, const void *p2)
+{
+const DAY_STAT *pDay1 = p1, *pDay2 = p2;
+
+    return (pDay1->Day > pDay2->Day) - (pDay1->Day < pDay2->Day);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add a Knot of the Clock Correction
+ *
+ * A knot is only added if the correction has changed by @ref DS_KNOT_MS
+ * since the previous one, or if the time stamp goes back, i.e. a new time
+ * base.  The knots map the times of the side files, see KnotCorrect().
+ *
+ ******************************************************************************/
+static void	KnotAdd (int64_t stamp, int64_t time)
+{
+KNOT	*pNew;
+int64_t	 corr = time - stamp;
+
+    if (l_Box.KnotCnt > 0)
+    {
+	pNew = &l_Box.pKnot[l_Box.KnotCnt - 1];
+	if (stamp >= pNew->Stamp  &&  llabs (corr - pNew->Corr) < DS_KNOT_MS)
+	    return;
+    }
+
+    if (l_Box.KnotCnt >= l_Box.KnotMax)
+    {
+	l_Box.KnotMax = (l_Box.KnotMax ? l_Box.KnotMax * 2 : 1024);
+	pNew = realloc (l_Box.pKnot, l_Box.KnotMax * sizeof(KNOT));
+	if (pNew == NULL)
+	{
+	    fprintf (stderr, "Out of Memory\n");
+	    exit (1);
+	}
+	l_Box.pKnot = pNew;
+    }
+
+    pNew = &l_Box.pKnot[l_Box.KnotCnt++];
+    pNew->Stamp = stamp;
+    pNew->Corr  = corr;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Correct a Time of the Box
+ *
+ * The correction of the last knot before the time stamp is applied.  The
+ * search starts at the knot of the previous call, since the entries of a
+ * side file are usually in chronological order.  A time stamp before the
+ * first knot, e.g. before the first synchronization, gets its correction.
+ *
+ ******************************************************************************/
+static int64_t	KnotCorrect (int64_t stamp)
+{
+static long i;
+
+    if (l_Box.KnotCnt == 0)
+	return stamp;
+
+    if (i >= l_Box.KnotCnt)
+	i = l_Box.KnotCnt - 1;
+    while (i + 1 < l_Box.KnotCnt  &&  l_Box.pKnot[i + 1].Stamp <= stamp)
+	i++;
+    while (i > 0  &&  l_Box.pKnot[i].Stamp > stamp)
+	i--;
+
+    return stamp + l_Box.pKnot[i].Corr;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read a Side File of the current Box
+ *
+ * The file is read into memory, and its entries are added to the dataset.
+ * Without option <b>-p</b> it is skipped.
+ *
+ ******************************************************************************/
+static void	ReadSideFile (const char *pFileName)
+{
+FILE	*fp;
+uint8_t	*pData;
+long	 size;
+const char *pBase;
+
+    if (l_flgDecodeOnly)
+	return;
+
+    if (l_pDsDir == NULL)
+    {
+	fprintf (stderr, "%s: Side files are only evaluated with option -p\n",
+		 pFileName);
+	return;
+    }
+
+    fp = fopen (pFileName, "rb");
+    if (fp == NULL)
+    {
+	perror (pFileName);
+	return;
+    }
+
+    fseek (fp, 0, SEEK_END);
+    size = ftell (fp);
+    fseek (fp, 0, SEEK_SET);
+
+    pData = malloc (size + 1);
+    if (pData == NULL  ||  fread (pData, 1, size, fp) != (size_t)size)
+    {
+	fprintf (stderr, "%s: Read Error\n", pFileName);
+	free (pData);
+	fclose (fp);
+	return;
+    }
+    fclose (fp);
+    pData[size] = '\0';		// terminate the last line
+
+    pBase = strrchr (pFileName, '/');
+    pBase = (pBase != NULL ? pBase + 1 : pFileName);
+
+    if (strcasecmp (pBase, VISIT_REC_FILE_NAME) == 0)
+	ReadVisits (pData, size);
+    else if (strcasecmp (pBase, LB_TIMELINE_FILE_NAME) == 0)
+	ReadTimeline (pData, size);
+    else
+	ReadStats (pData, size);
+
+    free (pData);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read the Visit Records of VISITS.BIN
+ *
+ * The records and segments are 32 bytes each, little endian, see
+ * "VisitStats.h".  A segment gets the transponder ID of the record of its
+ * visit, which may be written later.
+ *
+ ******************************************************************************/
+static void	ReadVisits (const uint8_t *pData, long size)
+{
+const uint8_t *pRec;
+DS_ROW	 row;
+uint16_t magic, seq, seq2, u16;
+uint32_t start, end;
+long	 off, off2;
+
+    for (off = 0;  off + VISIT_REC_SIZE <= size;  off += VISIT_REC_SIZE)
+    {
+	/* Target and host are little endian */
+	pRec = pData + off;
+	memcpy (&magic, pRec, 2);
+	memcpy (&seq, pRec + 2, 2);
+	memcpy (&start, pRec + 4, 4);
+
+	memset (&row, 0, sizeof(row));
+	if (magic == VISIT_REC_MAGIC)
+	{
+	    memcpy (&end, pRec + 8, 4);
+	    memcpy (&u16, pRec + 12, 2);
+	    row.Value = u16;			// PerchSec
+	    memcpy (&row.Flags, pRec + 14, 2);
+	    memcpy (&row.Id, pRec + 16, 8);
+	    memcpy (&row.Param, pRec + 28, 2);	// PlayFile
+	    row.Type   = DS_VISIT;
+	    row.Logged = start * 1000LL;
+	    row.Time   = KnotCorrect (row.Logged);
+	    if (row.Flags & VISIT_FLG_ENDED)
+		row.End = KnotCorrect (end * 1000LL);
+	}
+	else if (magic == VISIT_SEG_MAGIC)
+	{
+	    memcpy (&u16, pRec + 8, 2);		// SubSec
+	    row.Logged = start * 1000LL + u16 * 1000LL / RTC_COUNTS_PER_SEC;
+	    memcpy (&row.Param, pRec + 10, 2);	// RecFile
+	    memcpy (&u16, pRec + 12, 2);
+	    row.Value = u16;			// Segment
+	    row.Type  = DS_SEGMENT;
+	    row.Time  = KnotCorrect (row.Logged);
+
+	    for (off2 = off;  off2 + VISIT_REC_SIZE <= size;
+		 off2 += VISIT_REC_SIZE)
+	    {
+		memcpy (&magic, pData + off2, 2);
+		memcpy (&seq2, pData + off2 + 2, 2);
+		if (magic == VISIT_REC_MAGIC  &&  seq2 == seq)
+		{
+		    memcpy (&row.Id, pData + off2 + 16, 8);
+		    break;
+		}
+	    }
+	}
+	else
+	{
+	    l_SideBadCnt++;
+	    continue;
+	}
+
+	DsAdd (&row);
+    }
+
+    if (off < size)
+	l_SideBadCnt++;		// incomplete record at the end
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read the Occupancy Timeline of LBTIME.BIN
+ *
+ * The entries are decoded as described in "LightBarrier.c".  Delta entries
+ * before the first sync entry cannot be placed in time, they are skipped.
+ *
+ ******************************************************************************/
+static void	ReadTimeline (const uint8_t *pData, long size)
+{
+DS_ROW	 row;
+int64_t	 ticks = 0;	// RTC ticks since 1970
+uint64_t value;
+uint32_t sec;
+uint16_t subSec;
+bool	 flgSync = false;
+int	 state, shift;
+long	 i = 0;
+
+    while (i < size)
+    {
+	if (pData[i] == 0x00)
+	{
+	    /* Sync entry */
+	    if (i + 8 > size)
+	    {
+		l_SideBadCnt++;
+		break;
+	    }
+	    memcpy (&sec, pData + i + 1, 4);
+	    memcpy (&subSec, pData + i + 5, 2);
+	    state = pData[i + 7];
+	    i += 8;
+
+	    ticks = (int64_t)sec * RTC_COUNTS_PER_SEC + subSec;
+	    flgSync = true;
+	}
+	else
+	{
+	    /* Delta entry, unsigned LEB128 */
+	    value = 0;
+	    for (shift = 0;  i < size  &&  shift < 64;  shift += 7)
+	    {
+		value |= (uint64_t)(pData[i] & 0x7F) << shift;
+		if ((pData[i++] & 0x80) == 0)
+		    break;
+	    }
+	    if (shift >= 64  ||  (pData[i - 1] & 0x80))
+	    {
+		l_SideBadCnt++;
+		break;
+	    }
+	    if (! flgSync)
+	    {
+		l_SideBadCnt++;
+		continue;
+	    }
+	    value--;
+	    ticks += value >> 2;
+	    state  = value & 0x03;
+	}
+
+	memset (&row, 0, sizeof(row));
+	row.Type   = DS_OCCUPANCY;
+	row.Param  = state;
+	row.Logged = ticks * 1000 / RTC_COUNTS_PER_SEC;
+	row.Time   = KnotCorrect (row.Logged);
+	DsAdd (&row);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read the Visit Statistics of STATSnnn.TXT
+ *
+ * Each row of a transponder becomes a row of the dataset at the time it has
+ * been seen for the last time.  The header lines are skipped.
+ *
+ ******************************************************************************/
+static void	ReadStats (const uint8_t *pData, long size)
+{
+const char *pLine = (const char *)pData;
+const char *pEnd  = pLine + size;
+char	 line[MAX_LINE_LEN], id[17], when[16], stamp[32];
+unsigned int visits, perchSec, playSec, recSec;
+DS_ROW	 row;
+int	 len;
+
+    for ( ;  pLine < pEnd;  pLine += len + (pLine[len] != '\0'))
+    {
+	len = strcspn (pLine, "\n");
+	snprintf (line, sizeof(line), "%.*s", len, pLine);
+	line[strcspn (line, "\r")] = '\0';
+
+	if (line[0] == '\0'  ||  line[0] == '#'
+	||  strncmp (line, "ID,", 3) == 0)
+	    continue;
+
+	memset (&row, 0, sizeof(row));
+	if (sscanf (line, "%16[0-9A-Fa-f],%u,%u,%u,%u,%15[0-9-]", id, &visits,
+		    &perchSec, &playSec, &recSec, when) != 6)
+	{
+	    l_SideBadCnt++;
+	    continue;
+	}
+	snprintf (stamp, sizeof(stamp), "%s.000 ", when);
+	if (! ParseStamp (stamp, &row.Logged))
+	{
+	    l_SideBadCnt++;
+	    continue;
+	}
+
+	row.Type  = DS_STATS;
+	row.Id    = strtoull (id, NULL, 16);
+	row.Param = visits;
+	row.Value = perchSec;
+	row.Time  = KnotCorrect (row.Logged);
+	DsAdd (&row);
+    }
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add a Row to the Dataset
+ *
+ * The row is assigned to the current box along with its HW-ID.
+ *
+ ******************************************************************************/
+static void	DsAdd (DS_ROW *pRow)
+{
+DS_BOX	*pBox;
+DS_ROW	*pNew;
+int	 i = l_DsBoxCur;
+
+    if (i < 0  ||  strcmp (l_pDsBox[i].Name, l_Box.Name) != 0
+    ||  strcmp (l_pDsBox[i].HwId, l_Box.HwId) != 0)
+    {
+	for (i = 0;  i < l_DsBoxCnt;  i++)
+	{
+	    if (strcmp (l_pDsBox[i].Name, l_Box.Name) == 0
+	    &&  strcmp (l_pDsBox[i].HwId, l_Box.HwId) == 0)
+		break;
+	}
+
+	if (i == l_DsBoxCnt)
+	{
+	    if (l_DsBoxCnt >= l_DsBoxMax)
+	    {
+		l_DsBoxMax = (l_DsBoxMax ? l_DsBoxMax * 2 : 64);
+		pBox = realloc (l_pDsBox, l_DsBoxMax * sizeof(DS_BOX));
+		if (pBox == NULL  ||  l_DsBoxMax > UINT16_MAX + 1)
+		{
+		    fprintf (stderr, "Out of Memory\n");
+		    exit (1);
+		}
+		l_pDsBox = pBox;
+	    }
+	    pBox = &l_pDsBox[l_DsBoxCnt++];
+	    memset (pBox, 0, sizeof(*pBox));
+	    strcpy (pBox->Name, l_Box.Name);
+	    strcpy (pBox->HwId, l_Box.HwId);
+	}
+	l_DsBoxCur = i;
+    }
+
+    pBox = &l_pDsBox[i];
+    if (pBox->Rows == 0  ||  pRow->Time < pBox->First)
+	pBox->First = pRow->Time;
+    if (pBox->Rows == 0  ||  pRow->Time > pBox->Last)
+	pBox->Last = pRow->Time;
+    pBox->Rows++;
+
+    if (l_DsRowCnt >= l_DsRowMax)
+    {
+	l_DsRowMax = (l_DsRowMax ? l_DsRowMax * 2 : 4096);
+	pNew = realloc (l_pDsRow, l_DsRowMax * sizeof(DS_ROW));
+	if (pNew == NULL)
+	{
+	    fprintf (stderr, "Out of Memory\n");
+	    exit (1);
+	}
+	l_pDsRow = pNew;
+    }
+
+    pRow->Box = i;
+    pRow->Seq = l_DsRowCnt;
+    l_pDsRow[l_DsRowCnt++] = *pRow;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write the Dataset
+ *
+ * The rows are sorted by time and written to one partition per day, then
+ * sorted by transponder and written to one partition per transponder.  Each
+ * partition is listed in <b>index.csv</b>.
+ *
+ ******************************************************************************/
+static bool	DsWrite (void)
+{
+FILE	*fpIdx, *fpBox, *fp = NULL;
+char	 name[64], first[32], last[32];
+const DS_ROW *pPart = NULL;
+const DS_BOX *pBox;
+int64_t	 day, partDay = 0;
+uint64_t partId = 0;
+bool	 flgOk = true;
+long	 i;
+
+    if (! DsMkdir (NULL)  ||  ! DsMkdir ("days")  ||  ! DsMkdir ("tags"))
+	return false;
+
+    fpIdx = DsOpen ("index.csv", "partition,rows,first,last");
+    fpBox = DsOpen ("boxes.csv", "box,hw_id,rows,first,last");
+    if (fpIdx == NULL  ||  fpBox == NULL)
+    {
+	if (fpIdx != NULL)
+	    fclose (fpIdx);
+	if (fpBox != NULL)
+	    fclose (fpBox);
+	return false;
+    }
+
+    for (i = 0;  i < l_DsBoxCnt;  i++)
+    {
+	pBox = &l_pDsBox[i];
+	FormatTime (pBox->First, first);
+	FormatTime (pBox->Last, last);
+	fprintf (fpBox, "%s,%s,%ld,%s,%s\n", pBox->Name, pBox->HwId,
+		 pBox->Rows, first, last);
+    }
+    fclose (fpBox);
+
+    /* Partitions per day */
+    qsort (l_pDsRow, l_DsRowCnt, sizeof(DS_ROW), DsTimeCompare);
+    for (i = 0;  i < l_DsRowCnt  &&  flgOk;  i++)
+    {
+	day = l_pDsRow[i].Time / MS_PER_DAY
+	    - (l_pDsRow[i].Time % MS_PER_DAY < 0);
+	if (fp == NULL  ||  day != partDay)
+	{
+	    if (fp != NULL)
+	    {
+		fclose (fp);
+		DsIndex (fpIdx, name, pPart, l_pDsRow + i - pPart);
+	    }
+	    FormatTime (day * MS_PER_DAY, first);
+	    first[10] = '\0';		// date only
+	    snprintf (name, sizeof(name), "days/%s.csv", first);
+	    if ((fp = DsOpen (name, l_DsHeader)) == NULL)
+	    {
+		flgOk = false;
+		break;
+	    }
+	    pPart = l_pDsRow + i;
+	    partDay = day;
+	}
+	DsPrint (fp, l_pDsRow + i);
+    }
+    if (fp != NULL)
+    {
+	fclose (fp);
+	DsIndex (fpIdx, name, pPart, l_pDsRow + i - pPart);
+	fp = NULL;
+    }
+
+    /* Partitions per transponder, the rows without ID are skipped */
+    qsort (l_pDsRow, l_DsRowCnt, sizeof(DS_ROW), DsTagCompare);
+    for (i = 0;  i < l_DsRowCnt  &&  flgOk;  i++)
+    {
+	if (l_pDsRow[i].Id == 0)
+	    continue;
+	if (fp == NULL  ||  l_pDsRow[i].Id != partId)
+	{
+	    if (fp != NULL)
+	    {
+		fclose (fp);
+		DsIndex (fpIdx, name, pPart, l_pDsRow + i - pPart);
+	    }
+	    snprintf (name, sizeof(name), "tags/%016llX.csv",
+		      (unsigned long long)l_pDsRow[i].Id);
+	    if ((fp = DsOpen (name, l_DsHeader)) == NULL)
+	    {
+		flgOk = false;
+		break;
+	    }
+	    pPart = l_pDsRow + i;
+	    partId = l_pDsRow[i].Id;
+	}
+	DsPrint (fp, l_pDsRow + i);
+    }
+    if (fp != NULL)
+    {
+	fclose (fp);
+	DsIndex (fpIdx, name, pPart, l_pDsRow + i - pPart);
+    }
+
+    fclose (fpIdx);
+    return flgOk;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Create a Directory of the Dataset
+ *
+ * @param[in] pName
+ *	Name of the subdirectory, or NULL for the dataset directory itself.
+ *
+ ******************************************************************************/
+static bool	DsMkdir (const char *pName)
+{
+char	 path[512];
+
+    if (pName == NULL)
+	snprintf (path, sizeof(path), "%s", l_pDsDir);
+    else
+	snprintf (path, sizeof(path), "%s/%s", l_pDsDir, pName);
+
+    if (mkdir (path, 0777) != 0  &&  errno != EEXIST)
+    {
+	perror (path);
+	return false;
+    }
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Create a File of the Dataset, and write its Header
+ *
+ ******************************************************************************/
+static FILE	*DsOpen (const char *pName, const char *pHeader)
+{
+char	 path[512];
+FILE	*fp;
+
+    snprintf (path, sizeof(path), "%s/%s", l_pDsDir, pName);
+    fp = fopen (path, "w");
+    if (fp == NULL)
+    {
+	perror (path);
+	return NULL;
+    }
+    fprintf (fp, "%s\n", pHeader);
+    return fp;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	List a Partition in the Index
+ *
+ * The rows of the partition are sorted by time.
+ *
+ ******************************************************************************/
+static void	DsIndex (FILE *fp, const char *pName, const DS_ROW *pRow,
+			 long cnt)
+{
+char	 first[32], last[32];
+
+    FormatTime (pRow[0].Time, first);
+    FormatTime (pRow[cnt - 1].Time, last);
+    fprintf (fp, "%s,%ld,%s,%s\n", pName, cnt, first, last);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Write a Row of the Dataset
+ *
+ ******************************************************************************/
+static void	DsPrint (FILE *fp, const DS_ROW *pRow)
+{
+char	 time[32], end[32], logged[32], id[17];
+const DS_BOX *pBox = &l_pDsBox[pRow->Box];
+
+    FormatTime (pRow->Time, time);
+    FormatTime (pRow->Logged, logged);
+    end[0] = id[0] = '\0';
+    if (pRow->Type == DS_VISIT  &&  (pRow->Flags & VISIT_FLG_ENDED))
+	FormatTime (pRow->End, end);
+    if (pRow->Id != 0)
+	sprintf (id, "%016llX", (unsigned long long)pRow->Id);
+
+    fprintf (fp, "%s,%s,%s,%s,%s,%s,%u,%u,%u,%s\n", time, end, pBox->Name,
+	     pBox->HwId, l_EventName[pRow->Type], id, pRow->Param,
+	     pRow->Value, pRow->Flags, logged);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Compare two Rows by Time for qsort()
+ *
+ ******************************************************************************/
+static int	DsTimeCompare (const void *p1, const void *p2)
+{
+const DS_ROW *pRow1 = p1, *pRow2 = p2;
+
+    if (pRow1->Time != pRow2->Time)
+	return (pRow1->Time > pRow2->Time) - (pRow1->Time < pRow2->Time);
+
+    return (pRow1->Seq > pRow2->Seq) - (pRow1->Seq < pRow2->Seq);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Compare two Rows by Transponder and Time for qsort()
+ *
+ ******************************************************************************/
+static int	DsTagCompare (const void *p1, const void *p2)
+{
+const DS_ROW *pRow1 = p1, *pRow2 = p2;
+
+    if (pRow1->Id != pRow2->Id)
+	return (pRow1->Id > pRow2->Id) - (pRow1->Id < pRow2->Id);
+
+    return DsTimeCompare (p1, p2);
+}
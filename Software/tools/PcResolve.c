@@ -0,0 +1,502 @@
+/***************************************************************************//**
+ * @file
+ * @brief	Host-side Resolver of the PC Profile
+ * @author	agent
+ * @version	2026-10-15
+ *
+ * This tool assigns the samples of the PC profile, see "PcProfile.c", to the
+ * functions of the map file of the same build, and prints a table with the
+ * number of samples and the percentage per function, sorted by the samples.
+ *
+ * Usage:
+ * @code
+   PcResolve -m armgcc/lst/AUDIO.map [-n lines] [files...]
+   @endcode
+ *
+ * The files are console logs with the output of the command "PCS" or "PCSC",
+ * or the file <b>PCPROF.TXT</b> written by "PCSD".  Only the lines starting
+ * with <b>PCS</b> are evaluated, other lines are ignored.  The dumps of
+ * several files, e.g. of several boxes with the same firmware, are added
+ * up.  Without files, the dump is read from stdin.
+ *
+ * The functions are taken from the input sections <b>.text.name</b> of the
+ * map, which are generated by <b>-ffunction-sections</b>, and from the
+ * symbols listed after an input section.  A histogram bucket which covers
+ * several functions is split in proportion to the bytes of each function.
+ * With LTO, a static function may have been inlined or merged into a
+ * partition, then its samples are accounted to the preceding global symbol.
+ * The samples of the @ref RAMFUNC code and outside of the application are
+ * only shown as totals.
+ *
+ ****************************************************************************//*
+Revision History:
+2026-10-15,agnt	Initial version.
+*/
+
+/*=============================== Header Files ===============================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+/*=============================== Definitions ================================*/
+
+    /*! Maximum length of a line of the map or of a dump */
+#define MAX_LINE_LEN		512
+
+    /*! Default number of functions to be shown */
+#define DFLT_LINES		40
+
+    /*! Marker of the map where the sections and symbols begin */
+#define MAP_START_MARKER	"Linker script and memory map"
+
+    /*! Tag of the lines of a dump */
+#define PCS_TAG			"PCS "
+
+/*=========================== Typedefs and Structs ===========================*/
+
+    /*! Address range of a function */
+typedef struct
+{
+    uint32_t	Addr;		//!< start address
+    uint32_t	End;		//!< end address (exclusive)
+    char	Name[64];	//!< function name
+    char	Obj[32];	//!< basename of the object file
+    double	Samples;	//!< samples assigned to this function
+} FUNC;
+
+    /*! Input section of code in the map */
+typedef struct
+{
+    uint32_t	Addr, Size;
+    char	Name[64];	//!< name without ".text.", may be empty
+    char	Obj[32];
+} SECTION;
+
+/*================================ Local Data ================================*/
+
+static FUNC	*l_pFunc;
+static int	 l_FuncCnt, l_FuncMax;
+
+    /*! Header of the current dump */
+static int	 l_Shift = -1;
+static int	 l_Hz;
+
+    /*! Totals of all dumps */
+static unsigned long l_Total, l_Ram, l_Other, l_Dumps;
+static double	 l_Unknown;
+
+/*=========================== Forward Declarations ===========================*/
+
+static bool	ReadMap (const char *pFileName);
+static void	SectionEnd (const SECTION *pSect, int idxSym);
+static FUNC	*FuncAdd (uint32_t addr, const char *pName, const char *pObj);
+static bool	ReadDump (FILE *fp);
+static void	AddBucket (uint32_t addr, unsigned long cnt);
+static int	FuncCompareAddr (const void *p1, const void *p2);
+static int	FuncCompareSamples (const void *p1, const void *p2);
+
+
+/***************************************************************************//**
+ *
+ * @brief	Main Routine
+ *
+ ******************************************************************************/
+int	main (int argc, char *argv[])
+{
+const char *pMap = NULL;
+int	 lines = DFLT_LINES;
+bool	 flgOk = true;
+double	 total;
+FILE	*fp;
+int	 opt, i;
+
+    while ((opt = getopt (argc, argv, "m:n:")) != -1)
+    {
+	switch (opt)
+	{
+	    case 'm':
+		pMap = optarg;
+		break;
+
+	    case 'n':
+		lines = atoi (optarg);
+		break;
+
+	    default:
+		pMap = NULL;
+		optind = argc + 1;
+		break;
+	}
+    }
+
+    if (pMap == NULL  ||  optind > argc)
+    {
+	fprintf (stderr, "Usage: %s -m map [-n lines] [files...]\n"
+		 "  -m  map file of the build, e.g. armgcc/lst/AUDIO.map\n"
+		 "  -n  number of functions to be shown, default %d, "
+		 "0 for all\n", argv[0], DFLT_LINES);
+	return 2;
+    }
+
+    if (! ReadMap (pMap))
+	return 1;
+
+    if (optind == argc)
+	flgOk = ReadDump (stdin);
+
+    for (i = optind;  i < argc;  i++)
+    {
+	fp = fopen (argv[i], "r");
+	if (fp == NULL)
+	{
+	    perror (argv[i]);
+	    flgOk = false;
+	    continue;
+	}
+	flgOk &= ReadDump (fp);
+	fclose (fp);
+    }
+
+    if (l_Dumps == 0)
+    {
+	fprintf (stderr, "%s: No PC profile found\n", argv[0]);
+	return 1;
+    }
+
+    total = l_Total > 0 ? (double)l_Total : 1.0;
+    printf ("%lu samples in %lu dumps (%.1fs at %dHz): flash %lu, "
+	    "RAM %lu, other %lu\n\n", l_Total, l_Dumps,
+	    l_Hz > 0 ? (double)l_Total / l_Hz : 0.0, l_Hz,
+	    l_Total - l_Ram - l_Other, l_Ram, l_Other);
+
+    qsort (l_pFunc, l_FuncCnt, sizeof(FUNC), FuncCompareSamples);
+
+    printf ("%10s %6s  %-40s %s\n", "Samples", "%", "Function", "Object");
+    for (i = 0;  i < l_FuncCnt  &&  l_pFunc[i].Samples > 0.0;  i++)
+    {
+	if (lines > 0  &&  i >= lines)
+	    break;
+	printf ("%10.1f %6.2f  %-40s %s\n", l_pFunc[i].Samples,
+		100.0 * l_pFunc[i].Samples / total, l_pFunc[i].Name,
+		l_pFunc[i].Obj);
+    }
+    if (l_Unknown > 0.0)
+	printf ("%10.1f %6.2f  %-40s\n", l_Unknown, 100.0 * l_Unknown / total,
+		"(not in map)");
+    if (l_Ram > 0)
+	printf ("%10lu %6.2f  %-40s\n", l_Ram, 100.0 * l_Ram / total,
+		"(RAM functions)");
+    if (l_Other > 0)
+	printf ("%10lu %6.2f  %-40s\n", l_Other, 100.0 * l_Other / total,
+		"(outside of the application)");
+
+    return flgOk ? 0 : 1;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read the Map File
+ *
+ * This routine collects the input sections of code, and the symbols listed
+ * after them, into the sorted table @ref l_pFunc.  The name of an input
+ * section may be on a line of its own, followed by a line with address,
+ * size, and object file.
+ *
+ ******************************************************************************/
+static bool	ReadMap (const char *pFileName)
+{
+char	 line[MAX_LINE_LEN];
+char	 tok[4][MAX_LINE_LEN];
+char	 pending[MAX_LINE_LEN] = "";
+SECTION	 sect;
+bool	 flgMap  = false;
+bool	 flgSect = false;
+int	 idxSym = 0;
+uint32_t addr, size;
+const char *pObj;
+FILE	*fp;
+int	 n;
+
+    fp = fopen (pFileName, "r");
+    if (fp == NULL)
+    {
+	perror (pFileName);
+	return false;
+    }
+
+    while (fgets (line, sizeof(line), fp) != NULL)
+    {
+	if (! flgMap)
+	{
+	    flgMap = (strncmp (line, MAP_START_MARKER,
+			       strlen(MAP_START_MARKER)) == 0);
+	    continue;
+	}
+
+	n = sscanf (line, "%s %s %s %s", tok[0], tok[1], tok[2], tok[3]);
+	if (n <= 0)
+	    continue;
+
+	if (line[0] == ' '  &&  line[1] == '.')
+	{
+	    /* New input section, finish the previous one */
+	    if (flgSect)
+		SectionEnd (&sect, idxSym);
+	    flgSect = false;
+	    pending[0] = '\0';
+
+	    if (strcmp (tok[0], ".text") != 0
+	    &&  strncmp (tok[0], ".text.", 6) != 0)
+		continue;		// not code
+
+	    if (n == 1)
+	    {
+		strcpy (pending, tok[0]);	// address is on the next line
+		continue;
+	    }
+	    memmove (tok[0], tok[1], sizeof(tok) - sizeof(tok[0]));
+	    n--;
+	    strcpy (pending, line + 1);
+	    pending[strcspn (pending, " \t\r\n")] = '\0';
+	}
+	else if (pending[0] == '\0')
+	{
+	    /* Symbol of the current input section: address and name */
+	    if (flgSect  &&  n == 2  &&  strncmp (tok[0], "0x", 2) == 0
+	    &&  (isalpha ((unsigned char)tok[1][0])  ||  tok[1][0] == '_'))
+	    {
+		addr = strtoul (tok[0], NULL, 16) & ~1UL;
+		if (addr >= sect.Addr  &&  addr < sect.Addr + sect.Size)
+		    FuncAdd (addr, tok[1], sect.Obj);
+	    }
+	    continue;
+	}
+
+	/* Address, size, and object file of the pending input section */
+	if (n < 3  ||  strncmp (tok[0], "0x", 2) != 0)
+	{
+	    pending[0] = '\0';
+	    continue;
+	}
+	addr = strtoul (tok[0], NULL, 16);
+	size = strtoul (tok[1], NULL, 16);
+	if (size > 0  &&  addr > 0)
+	{
+	    memset (&sect, 0, sizeof(sect));
+	    sect.Addr = addr;
+	    sect.Size = size;
+	    snprintf (sect.Name, sizeof(sect.Name), "%.63s",
+		      strncmp (pending, ".text.", 6) == 0 ? pending + 6 : "");
+	    pObj = strrchr (tok[2], '/');
+	    snprintf (sect.Obj, sizeof(sect.Obj), "%.31s",
+		      pObj != NULL ? pObj + 1 : tok[2]);
+	    flgSect = true;
+	    idxSym  = l_FuncCnt;
+	}
+	pending[0] = '\0';
+    }
+    if (flgSect)
+	SectionEnd (&sect, idxSym);
+
+    fclose (fp);
+
+    if (l_FuncCnt == 0)
+    {
+	fprintf (stderr, "%s: No code sections found\n", pFileName);
+	return false;
+    }
+
+    /* Sort by address, each function ends where the next one starts */
+    qsort (l_pFunc, l_FuncCnt, sizeof(FUNC), FuncCompareAddr);
+    for (n = 0;  n < l_FuncCnt - 1;  n++)
+	if (l_pFunc[n].End > l_pFunc[n+1].Addr)
+	    l_pFunc[n].End = l_pFunc[n+1].Addr;
+
+    return true;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Finish an Input Section
+ *
+ * The symbols of the input section, i.e. the functions from index @p idxSym
+ * on, end at the next symbol or at the end of the section.  If there is no
+ * symbol at its start, e.g. for a static function, the section itself is
+ * added as function with the name of the section, or of the object file.
+ *
+ ******************************************************************************/
+static void	SectionEnd (const SECTION *pSect, int idxSym)
+{
+int	 i;
+
+    for (i = idxSym;  i < l_FuncCnt;  i++)
+	if (l_pFunc[i].Addr == pSect->Addr)
+	    break;
+
+    if (i >= l_FuncCnt)
+	FuncAdd (pSect->Addr, pSect->Name[0] != '\0' ? pSect->Name
+		 : pSect->Obj, pSect->Obj);
+
+    for (i = idxSym;  i < l_FuncCnt;  i++)
+	l_pFunc[i].End = pSect->Addr + pSect->Size;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Add a Function
+ *
+ * The function ends at its start address, until SectionEnd() is called.
+ * The tool exits if it runs out of memory.
+ *
+ * @return
+ *	Address of the new entry.
+ *
+ ******************************************************************************/
+static FUNC	*FuncAdd (uint32_t addr, const char *pName, const char *pObj)
+{
+FUNC	*pFunc;
+
+    if (l_FuncCnt >= l_FuncMax)
+    {
+	l_FuncMax = l_FuncMax > 0 ? 2 * l_FuncMax : 1024;
+	pFunc = realloc (l_pFunc, l_FuncMax * sizeof(FUNC));
+	if (pFunc == NULL)
+	{
+	    fprintf (stderr, "Out of memory\n");
+	    exit (1);
+	}
+	l_pFunc = pFunc;
+    }
+
+    pFunc = &l_pFunc[l_FuncCnt++];
+    memset (pFunc, 0, sizeof(FUNC));
+    pFunc->Addr = pFunc->End = addr;
+    snprintf (pFunc->Name, sizeof(pFunc->Name), "%s", pName);
+    snprintf (pFunc->Obj, sizeof(pFunc->Obj), "%s", pObj);
+
+    return pFunc;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Read a Dump of the PC Profile
+ *
+ * This routine evaluates the header lines and the bucket lines of a dump.
+ * A bucket line before the first header line is an error.
+ *
+ ******************************************************************************/
+static bool	ReadDump (FILE *fp)
+{
+char	 line[MAX_LINE_LEN];
+unsigned long base, total, ram, other, addr, cnt;
+int	 shift, hz;
+char	*pTag;
+bool	 flgOk = true;
+
+    while (fgets (line, sizeof(line), fp) != NULL)
+    {
+	pTag = strstr (line, PCS_TAG);
+	if (pTag == NULL)
+	    continue;
+	pTag += strlen (PCS_TAG);
+
+	if (sscanf (pTag, "base=%lx shift=%d hz=%d total=%lu ram=%lu "
+		    "other=%lu", &base, &shift, &hz, &total, &ram, &other) == 6)
+	{
+	    if (l_Hz != 0  &&  hz != l_Hz)
+		fprintf (stderr, "Warning: Dumps with different sampling "
+			 "rates %dHz and %dHz\n", l_Hz, hz);
+	    l_Shift = shift;
+	    l_Hz    = hz;
+	    l_Total += total;
+	    l_Ram   += ram;
+	    l_Other += other;
+	    l_Dumps++;
+	}
+	else if (sscanf (pTag, "%lx %lu", &addr, &cnt) == 2)
+	{
+	    if (l_Shift < 0)
+	    {
+		fprintf (stderr, "Bucket 0x%08lx without header line\n", addr);
+		flgOk = false;
+		continue;
+	    }
+	    AddBucket (addr, cnt);
+	}
+    }
+
+    return flgOk;
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Assign the Samples of a Bucket
+ *
+ * The samples of the bucket at @p addr are split among the functions in
+ * proportion to their bytes within the bucket.  Bytes of the bucket not
+ * covered by a function are accounted to @ref l_Unknown.
+ *
+ ******************************************************************************/
+static void	AddBucket (uint32_t addr, unsigned long cnt)
+{
+uint32_t end = addr + (1UL << l_Shift);
+uint32_t from, to, covered = 0;
+double	 perByte = (double)cnt / (end - addr);
+int	 lo, hi, mid;
+
+    /* Binary search for the first function ending after the bucket start */
+    lo = 0;  hi = l_FuncCnt;
+    while (lo < hi)
+    {
+	mid = (lo + hi) / 2;
+	if (l_pFunc[mid].End <= addr)
+	    lo = mid + 1;
+	else
+	    hi = mid;
+    }
+
+    for ( ;  lo < l_FuncCnt  &&  l_pFunc[lo].Addr < end;  lo++)
+    {
+	from = l_pFunc[lo].Addr > addr ? l_pFunc[lo].Addr : addr;
+	to   = l_pFunc[lo].End  < end  ? l_pFunc[lo].End  : end;
+	if (to <= from)
+	    continue;
+	l_pFunc[lo].Samples += perByte * (to - from);
+	covered += to - from;
+    }
+
+    l_Unknown += perByte * ((end - addr) - covered);
+}
+
+
+/***************************************************************************//**
+ *
+ * @brief	Compare Functions for qsort()
+ *
+ ******************************************************************************/
+static int	FuncCompareAddr (const void *p1, const void *p2)
+{
+const FUNC *pF1 = p1, *pF2 = p2;
+
+    /* Of several symbols at the same address, the last one is kept */
+    if (pF1->Addr != pF2->Addr)
+	return pF1->Addr < pF2->Addr ? -1 : 1;
+    return (pF1->End > pF2->End) - (pF1->End < pF2->End);
+}
+
+static int	FuncCompareSamples (const void *p1, const void *p2)
+{
+const FUNC *pF1 = p1, *pF2 = p2;
+
+    return (pF2->Samples > pF1->Samples) - (pF2->Samples < pF1->Samples);
+}